@@ -126,6 +126,20 @@ inline ALbuffer *LookupBuffer(ALCdevice *device, ALuint id) noexcept
 }
 
 
+/* Frees a replaced active slot array once the mixer is done with it. The
+ * array also holds storage for the mixer to sort the slots in, after the
+ * active ones.
+ */
+void RetireEffectSlotArray(ALCcontext *context, EffectSlotArray *slots)
+{
+    context->mDevice->retireObject(slots, [](void *ptr) noexcept
+    {
+        auto *array = static_cast<EffectSlotArray*>(ptr);
+        std::destroy_n(array->end(), array->size());
+        delete array;
+    });
+}
+
 void AddActiveEffectSlots(const al::span<ALeffectslot*> auxslots, ALCcontext *context)
 {
     if(auxslots.empty()) return;
@@ -164,10 +178,7 @@ void AddActiveEffectSlots(const al::span<ALeffectslot*> auxslots, ALCcontext *co
     std::uninitialized_fill_n(newarray->end(), newcount, nullptr);
 
     curarray = context->mActiveAuxSlots.exchange(newarray, std::memory_order_acq_rel);
-    context->mDevice->waitForMix();
-
-    std::destroy_n(curarray->end(), curarray->size());
-    delete curarray;
+    RetireEffectSlotArray(context, curarray);
 }
 
 void RemoveActiveEffectSlots(const al::span<ALeffectslot*> auxslots, ALCcontext *context)
@@ -203,10 +214,7 @@ void RemoveActiveEffectSlots(const al::span<ALeffectslot*> auxslots, ALCcontext
     std::uninitialized_fill_n(newarray->end(), newsize, nullptr);
 
     curarray = context->mActiveAuxSlots.exchange(newarray, std::memory_order_acq_rel);
-    context->mDevice->waitForMix();
-
-    std::destroy_n(curarray->end(), curarray->size());
-    delete curarray;
+    RetireEffectSlotArray(context, curarray);
 }
 
 
@@ -290,6 +298,11 @@ void FreeEffectSlot(ALCcontext *context, ALeffectslot *slot)
     const size_t lidx{id >> 6};
     const ALuint slidx{id & 0x3f};
 
+    if(EffectSlotProps *props{slot->mSlot->Update.exchange(nullptr)})
+    {
+        props->State = nullptr;
+        context->mEffectSlotPropsPool.put(props);
+    }
     std::destroy_at(slot);
 
     context->mEffectSlotList[lidx].FreeMask |= 1_u64 << slidx;
@@ -372,7 +385,11 @@ FORCE_ALIGN void AL_APIENTRY alDeleteAuxiliaryEffectSlotsDirect(ALCcontext *cont
                 effectslots[0]);
             return;
         }
+        /* The mixer may still be processing the slot, even though new mixes
+         * won't see it, so wait for it to finish before deleting the slot.
+         */
         RemoveActiveEffectSlots({&slot, 1u}, context);
+        context->mDevice->waitForMix();
         FreeEffectSlot(context, slot);
     }
     else
@@ -405,6 +422,7 @@ FORCE_ALIGN void AL_APIENTRY alDeleteAuxiliaryEffectSlotsDirect(ALCcontext *cont
 
         /* All effectslots are valid, remove and delete them */
         RemoveActiveEffectSlots(slots, context);
+        context->mDevice->waitForMix();
         for(ALeffectslot *slot : slots)
             FreeEffectSlot(context, slot);
     }
@@ -420,13 +438,11 @@ FORCE_ALIGN ALboolean AL_APIENTRY alIsAuxiliaryEffectSlotDirect(ALCcontext *cont
 }
 
 
-AL_API void AL_APIENTRY alAuxiliaryEffectSlotPlaySOFT(ALuint slotid) noexcept
+FORCE_ALIGN void AL_APIENTRY alAuxiliaryEffectSlotPlayDirectSOFT(ALCcontext *context, ALuint slotid) noexcept
 {
-    ContextRef context{GetContextRef()};
-    if(!context) UNLIKELY return;
 
     std::lock_guard<std::mutex> _{context->mEffectSlotLock};
-    ALeffectslot *slot{LookupEffectSlot(context.get(), slotid)};
+    ALeffectslot *slot{LookupEffectSlot(context, slotid)};
     if(!slot) UNLIKELY
     {
         context->setError(AL_INVALID_NAME, "Invalid effect slot ID %u", slotid);
@@ -436,16 +452,14 @@ AL_API void AL_APIENTRY alAuxiliaryEffectSlotPlaySOFT(ALuint slotid) noexcept
         return;
 
     slot->mPropsDirty = false;
-    slot->updateProps(context.get());
+    slot->updateProps(context);
 
-    AddActiveEffectSlots({&slot, 1}, context.get());
+    AddActiveEffectSlots({&slot, 1}, context);
     slot->mState = SlotState::Playing;
 }
 
-AL_API void AL_APIENTRY alAuxiliaryEffectSlotPlayvSOFT(ALsizei n, const ALuint *slotids) noexcept
+FORCE_ALIGN void AL_APIENTRY alAuxiliaryEffectSlotPlayvDirectSOFT(ALCcontext *context, ALsizei n, const ALuint *slotids) noexcept
 {
-    ContextRef context{GetContextRef()};
-    if(!context) UNLIKELY return;
 
     if(n < 0) UNLIKELY
         context->setError(AL_INVALID_VALUE, "Playing %d effect slots", n);
@@ -455,7 +469,7 @@ AL_API void AL_APIENTRY alAuxiliaryEffectSlotPlayvSOFT(ALsizei n, const ALuint *
     std::lock_guard<std::mutex> _{context->mEffectSlotLock};
     for(size_t i{0};i < slots.size();++i)
     {
-        ALeffectslot *slot{LookupEffectSlot(context.get(), slotids[i])};
+        ALeffectslot *slot{LookupEffectSlot(context, slotids[i])};
         if(!slot) UNLIKELY
         {
             context->setError(AL_INVALID_NAME, "Invalid effect slot ID %u", slotids[i]);
@@ -465,37 +479,33 @@ AL_API void AL_APIENTRY alAuxiliaryEffectSlotPlayvSOFT(ALsizei n, const ALuint *
         if(slot->mState != SlotState::Playing)
         {
             slot->mPropsDirty = false;
-            slot->updateProps(context.get());
+            slot->updateProps(context);
         }
         slots[i] = slot;
     };
 
-    AddActiveEffectSlots(slots, context.get());
+    AddActiveEffectSlots(slots, context);
     for(auto slot : slots)
         slot->mState = SlotState::Playing;
 }
 
-AL_API void AL_APIENTRY alAuxiliaryEffectSlotStopSOFT(ALuint slotid) noexcept
+FORCE_ALIGN void AL_APIENTRY alAuxiliaryEffectSlotStopDirectSOFT(ALCcontext *context, ALuint slotid) noexcept
 {
-    ContextRef context{GetContextRef()};
-    if(!context) UNLIKELY return;
 
     std::lock_guard<std::mutex> _{context->mEffectSlotLock};
-    ALeffectslot *slot{LookupEffectSlot(context.get(), slotid)};
+    ALeffectslot *slot{LookupEffectSlot(context, slotid)};
     if(!slot) UNLIKELY
     {
         context->setError(AL_INVALID_NAME, "Invalid effect slot ID %u", slotid);
         return;
     }
 
-    RemoveActiveEffectSlots({&slot, 1}, context.get());
+    RemoveActiveEffectSlots({&slot, 1}, context);
     slot->mState = SlotState::Stopped;
 }
 
-AL_API void AL_APIENTRY alAuxiliaryEffectSlotStopvSOFT(ALsizei n, const ALuint *slotids) noexcept
+FORCE_ALIGN void AL_APIENTRY alAuxiliaryEffectSlotStopvDirectSOFT(ALCcontext *context, ALsizei n, const ALuint *slotids) noexcept
 {
-    ContextRef context{GetContextRef()};
-    if(!context) UNLIKELY return;
 
     if(n < 0) UNLIKELY
         context->setError(AL_INVALID_VALUE, "Stopping %d effect slots", n);
@@ -505,7 +515,7 @@ AL_API void AL_APIENTRY alAuxiliaryEffectSlotStopvSOFT(ALsizei n, const ALuint *
     std::lock_guard<std::mutex> _{context->mEffectSlotLock};
     for(size_t i{0};i < slots.size();++i)
     {
-        ALeffectslot *slot{LookupEffectSlot(context.get(), slotids[i])};
+        ALeffectslot *slot{LookupEffectSlot(context, slotids[i])};
         if(!slot) UNLIKELY
         {
             context->setError(AL_INVALID_NAME, "Invalid effect slot ID %u", slotids[i]);
@@ -515,7 +525,7 @@ AL_API void AL_APIENTRY alAuxiliaryEffectSlotStopvSOFT(ALsizei n, const ALuint *
         slots[i] = slot;
     };
 
-    RemoveActiveEffectSlots(slots, context.get());
+    RemoveActiveEffectSlots(slots, context);
     for(auto slot : slots)
         slot->mState = SlotState::Stopped;
 }
@@ -624,15 +634,19 @@ FORCE_ALIGN void AL_APIENTRY alAuxiliaryEffectSlotiDirect(ALCcontext *context, A
             return;
 
         {
-            std::lock_guard<std::mutex> ___{device->BufferLock};
+            std::unique_lock<std::mutex> buflock{device->BufferLock};
             ALbuffer *buffer{};
             if(value)
             {
                 buffer = LookupBuffer(device, static_cast<ALuint>(value));
                 if(!buffer) return context->setError(AL_INVALID_VALUE, "Invalid buffer ID");
+                WaitForBufferLoad(device, buflock, buffer);
                 if(buffer->mCallback)
                     return context->setError(AL_INVALID_OPERATION,
                         "Callback buffer not valid for effects");
+                if(buffer->mRing)
+                    return context->setError(AL_INVALID_OPERATION,
+                        "Ring buffer not valid for effects");
 
                 IncrementRef(buffer->ref);
             }
@@ -852,6 +866,11 @@ AL_API DECL_FUNC3(void, alGetAuxiliaryEffectSlotfv, ALuint, ALenum, ALfloat*)
 AL_API DECL_FUNC3(void, alGetAuxiliaryEffectSloti, ALuint, ALenum, ALint*)
 AL_API DECL_FUNC3(void, alGetAuxiliaryEffectSlotiv, ALuint, ALenum, ALint*)
 
+AL_API DECL_FUNCEXT1(void, alAuxiliaryEffectSlotPlay,SOFT, ALuint)
+AL_API DECL_FUNCEXT2(void, alAuxiliaryEffectSlotPlayv,SOFT, ALsizei, const ALuint*)
+AL_API DECL_FUNCEXT1(void, alAuxiliaryEffectSlotStop,SOFT, ALuint)
+AL_API DECL_FUNCEXT2(void, alAuxiliaryEffectSlotStopv,SOFT, ALsizei, const ALuint*)
+
 
 ALeffectslot::ALeffectslot(ALCcontext *context)
 {
@@ -875,11 +894,14 @@ ALeffectslot::~ALeffectslot()
         DecrementRef(Buffer->ref);
     Buffer = nullptr;
 
+    /* An unapplied update is still owned by the context's property pool, and
+     * gets freed with it.
+     */
     if(EffectSlotProps *props{mSlot->Update.exchange(nullptr)})
     {
-        TRACE("Freed unapplied AuxiliaryEffectSlot update %p\n",
+        TRACE("Dropped unapplied AuxiliaryEffectSlot update %p\n",
             decltype(std::declval<void*>()){props});
-        delete props;
+        props->State = nullptr;
     }
 
     mSlot->mEffectState = nullptr;
@@ -890,7 +912,12 @@ ALenum ALeffectslot::initEffect(ALenum effectType, const EffectProps &effectProp
     ALCcontext *context)
 {
     EffectSlotType newtype{EffectSlotTypeFromEnum(effectType)};
-    if(newtype != Effect.Type)
+    /* Get a new state if the type is changing, or if the current state can't
+     * handle the new properties without reallocating. A state released from
+     * another slot is reused if there is one, which avoids allocating when
+     * its buffers already fit the device.
+     */
+    if(newtype != Effect.Type || !Effect.State->canApply(&effectProps))
     {
         EffectStateFactory *factory{getFactoryByType(newtype)};
         if(!factory)
@@ -898,9 +925,15 @@ ALenum ALeffectslot::initEffect(ALenum effectType, const EffectProps &effectProp
             ERR("Failed to find factory for effect slot type %d\n", static_cast<int>(newtype));
             return AL_INVALID_ENUM;
         }
-        al::intrusive_ptr<EffectState> state{factory->create()};
-
         ALCdevice *device{context->mALDevice.get()};
+        al::intrusive_ptr<EffectState> state{device->takeEffectState(factory, effectProps)};
+        if(!state)
+        {
+            state = factory->create();
+            state->mFactory = factory;
+            state->reserve(&effectProps);
+        }
+
         std::unique_lock<std::mutex> statelock{device->StateLock};
         state->mOutTarget = device->Dry.Buffer;
         {
@@ -917,7 +950,7 @@ ALenum ALeffectslot::initEffect(ALenum effectType, const EffectProps &effectProp
         Effect.Props = effectProps;
 
     /* Remove state references from old effect slot property updates. */
-    EffectSlotProps *props{context->mFreeEffectslotProps.load()};
+    EffectSlotProps *props{context->mEffectSlotPropsPool.peekFree()};
     while(props)
     {
         props->State = nullptr;
@@ -930,17 +963,7 @@ ALenum ALeffectslot::initEffect(ALenum effectType, const EffectProps &effectProp
 void ALeffectslot::updateProps(ALCcontext *context)
 {
     /* Get an unused property container, or allocate a new one as needed. */
-    EffectSlotProps *props{context->mFreeEffectslotProps.load(std::memory_order_relaxed)};
-    if(!props)
-        props = new EffectSlotProps{};
-    else
-    {
-        EffectSlotProps *next;
-        do {
-            next = props->next.load(std::memory_order_relaxed);
-        } while(context->mFreeEffectslotProps.compare_exchange_weak(props, next,
-                std::memory_order_seq_cst, std::memory_order_acquire) == 0);
-    }
+    EffectSlotProps *props{context->mEffectSlotPropsPool.get()};
 
     /* Copy in current property values. */
     props->Gain = Gain;
@@ -959,10 +982,16 @@ void ALeffectslot::updateProps(ALCcontext *context)
          * freelist.
          */
         props->State = nullptr;
-        AtomicReplaceHead(context->mFreeEffectslotProps, props);
+        context->mEffectSlotPropsPool.put(props);
     }
 }
 
+bool ReserveEffectSlots(ALCcontext *context, size_t count)
+{
+    std::lock_guard<std::mutex> _{context->mEffectSlotLock};
+    return EnsureEffectSlots(context, count);
+}
+
 void UpdateAllEffectSlotProps(ALCcontext *context)
 {
     std::lock_guard<std::mutex> _{context->mEffectSlotLock};
@@ -1519,6 +1548,7 @@ void eax_delete_al_effect_slot(ALCcontext& context, ALeffectslot& effect_slot)
 
     auto effect_slot_ptr = &effect_slot;
     RemoveActiveEffectSlots({&effect_slot_ptr, 1}, &context);
+    context.mDevice->waitForMix();
     FreeEffectSlot(&context, &effect_slot);
 
 #undef EAX_PREFIX
@@ -356,6 +356,11 @@ public:
 #endif // ALSOFT_EAX
 };
 
+/* Allocates storage so count effect slots can be generated without
+ * allocating.
+ */
+bool ReserveEffectSlots(ALCcontext *context, size_t count);
+
 void UpdateAllEffectSlotProps(ALCcontext *context);
 
 #ifdef ALSOFT_EAX
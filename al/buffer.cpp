@@ -26,10 +26,12 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <cinttypes>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <iterator>
 #include <limits>
 #include <memory>
@@ -38,6 +40,8 @@
 #include <numeric>
 #include <optional>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -46,13 +50,19 @@
 #include "AL/alext.h"
 
 #include "albit.h"
+#include "alc/backends/base.h"
 #include "alc/context.h"
 #include "alc/device.h"
 #include "alc/inprogext.h"
 #include "almalloc.h"
 #include "alnumeric.h"
+#include "althrd_setname.h"
 #include "atomic.h"
+#include "core/adpcm.h"
+#include "core/async_event.h"
 #include "core/except.h"
+#include "core/fmt_traits.h"
+#include "core/helpers.h"
 #include "core/logging.h"
 #include "core/voice.h"
 #include "direct_defs.h"
@@ -165,6 +175,137 @@ void eax_x_ram_clear(ALCdevice& al_device, ALbuffer& al_buffer)
 #endif // ALSOFT_EAX
 
 
+/* Sample data given to alBufferData is stored once for all buffers with the
+ * same content, across all devices, keyed by a hash of the data. The store only
+ * holds weak references, so the data is freed with the last buffer using it,
+ * and expired entries are swept as the store grows.
+ */
+using SharedBufferData = al::vector<std::byte,16>;
+
+std::mutex gSharedDataLock;
+std::unordered_multimap<uint64_t,std::weak_ptr<const SharedBufferData>> gSharedData;
+size_t gSharedDataSweepSize{64};
+
+uint64_t HashData(const al::span<const std::byte> data) noexcept
+{
+    /* FNV-1a style, mixing in a word at a time. */
+    static constexpr uint64_t prime{1099511628211u};
+    uint64_t hash{14695981039346656037u ^ data.size()};
+
+    size_t i{0};
+    for(;data.size()-i >= sizeof(uint64_t);i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, data.data()+i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for(;i < data.size();++i)
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * prime;
+    return hash;
+}
+
+/** Returns shared storage holding a copy of the given data. */
+std::shared_ptr<const SharedBufferData> GetSharedData(const al::span<const std::byte> data)
+{
+    const uint64_t hash{HashData(data)};
+    {
+        std::lock_guard<std::mutex> _{gSharedDataLock};
+        auto range = gSharedData.equal_range(hash);
+        for(;range.first != range.second;++range.first)
+        {
+            auto shared = range.first->second.lock();
+            if(shared && shared->size() == data.size()
+                && std::equal(data.begin(), data.end(), shared->begin()))
+                return shared;
+        }
+    }
+
+    /* Not using make_shared, so the data is freed when the last buffer lets
+     * go of it rather than when its store entry is swept.
+     */
+    auto shared = std::shared_ptr<const SharedBufferData>{
+        new SharedBufferData(data.begin(), data.end())};
+
+    std::lock_guard<std::mutex> _{gSharedDataLock};
+    gSharedData.emplace(hash, shared);
+    if(gSharedData.size() >= gSharedDataSweepSize)
+    {
+        for(auto iter = gSharedData.begin();iter != gSharedData.end();)
+        {
+            if(iter->second.expired())
+                iter = gSharedData.erase(iter);
+            else
+                ++iter;
+        }
+        gSharedDataSweepSize = std::max(size_t{64}, gSharedData.size()*2);
+    }
+    return shared;
+}
+
+/**
+ * Counts the buffer's sample storage with the device's memory stats. Shared
+ * data is counted for each buffer using it, and file-backed or caller-owned
+ * storage isn't counted.
+ */
+void UpdateBufferMemory(ALCdevice *device, ALbuffer *ALBuf) noexcept
+{
+    ALBuf->mStorageMemory.set(device->mMemoryStats, MemCategory::Buffers,
+        ALBuf->mDataStorage.capacity() + (ALBuf->mSharedData ? ALBuf->mSharedData->size() : 0));
+}
+
+/**
+ * Gives the buffer its own copy of shared sample data, so it can be written
+ * to. Must not be called while the buffer is in use.
+ */
+void UnshareBufferData(ALCdevice *device, ALbuffer *ALBuf)
+{
+    if(!ALBuf->mSharedData)
+        return;
+
+    decltype(ALBuf->mDataStorage)(ALBuf->mSharedData->begin(), ALBuf->mSharedData->end()).swap(
+        ALBuf->mDataStorage);
+    ALBuf->mData = ALBuf->mDataStorage;
+    ALBuf->mSharedData = nullptr;
+    UpdateBufferMemory(device, ALBuf);
+}
+
+
+/**
+ * Converts samples to the mixer's float planes, one per channel with
+ * planeSize samples each, writing from the given sample offset in each plane.
+ */
+void ConvertToPlanes(float *dst, const size_t planeSize, const size_t dstOffset,
+    const std::byte *src, const FmtType srcType, const size_t numChans, const size_t blockAlign,
+    const size_t numSamples) noexcept
+{
+    const size_t sampleSize{BytesFromFmt(srcType)};
+    for(size_t chan{0};chan < numChans;++chan)
+    {
+        float *plane{dst + chan*planeSize + dstOffset};
+        const std::byte *chanSrc{src + chan*sampleSize};
+#define HANDLE_FMT(T)  case T: al::LoadSampleArray<T>(plane, chanSrc, numChans, numSamples); break
+        switch(srcType)
+        {
+        HANDLE_FMT(FmtUByte);
+        HANDLE_FMT(FmtShort);
+        HANDLE_FMT(FmtFloat);
+        HANDLE_FMT(FmtDouble);
+        HANDLE_FMT(FmtHalf);
+        HANDLE_FMT(FmtMulaw);
+        HANDLE_FMT(FmtAlaw);
+        case FmtIMA4:
+            DecodeIma4Samples(plane, src, chan, 0, numChans, blockAlign, numSamples);
+            break;
+        case FmtMSADPCM:
+            DecodeMsAdpcmSamples(plane, src, chan, 0, numChans, blockAlign, numSamples);
+            break;
+        }
+#undef HANDLE_FMT
+    }
+}
+
+
 constexpr ALbitfieldSOFT INVALID_STORAGE_MASK{~unsigned(AL_MAP_READ_BIT_SOFT |
     AL_MAP_WRITE_BIT_SOFT | AL_MAP_PERSISTENT_BIT_SOFT | AL_PRESERVE_DATA_BIT_SOFT)};
 constexpr ALbitfieldSOFT MAP_READ_WRITE_FLAGS{AL_MAP_READ_BIT_SOFT | AL_MAP_WRITE_BIT_SOFT};
@@ -216,6 +357,23 @@ ALbuffer *AllocBuffer(ALCdevice *device)
     return buffer;
 }
 
+/**
+ * Stops the prefetch thread from calling the buffer's callback, waiting for a
+ * call in progress to return. The device's buffer lock must be held.
+ */
+void StopCallbackPrefetch(ALbuffer *ALBuf)
+{
+    if(!ALBuf->mPrefetch)
+        return;
+
+    {
+        std::lock_guard<std::mutex> _{ALBuf->mPrefetch->mLock};
+        ALBuf->mPrefetch->mCallback = nullptr;
+    }
+    ALBuf->mPrefetch = nullptr;
+    ALBuf->mRingState.mEnded.store(true, std::memory_order_relaxed);
+}
+
 void FreeBuffer(ALCdevice *device, ALbuffer *buffer)
 {
 #ifdef ALSOFT_EAX
@@ -226,6 +384,7 @@ void FreeBuffer(ALCdevice *device, ALbuffer *buffer)
     const size_t lidx{id >> 6};
     const ALuint slidx{id & 0x3f};
 
+    StopCallbackPrefetch(buffer);
     std::destroy_at(buffer);
 
     device->BufferList[lidx].FreeMask |= 1_u64 << slidx;
@@ -245,6 +404,21 @@ inline ALbuffer *LookupBuffer(ALCdevice *device, ALuint id)
 }
 
 
+/* Invalidates the mixers' cached resampled samples when buffer data is
+ * modified, along with the cached decoded samples for ADPCM buffer data, and
+ * gives the buffer a new serial for anything prepared from its data.
+ */
+void InvalidateSampleCaches(ALCdevice *device, ALbuffer *ALBuf, const FmtType type) noexcept
+{
+    static std::atomic<uint64_t> sNextSerial{1u};
+    ALBuf->mSerial = sNextSerial.fetch_add(1u, std::memory_order_relaxed);
+
+    if(type == FmtIMA4 || type == FmtMSADPCM)
+        device->mAdpcmGeneration.fetch_add(1u, std::memory_order_release);
+    device->mBufferGeneration.fetch_add(1u, std::memory_order_release);
+}
+
+
 ALuint SanitizeAlignment(FmtType type, ALuint align)
 {
     if(align == 0)
@@ -279,14 +453,240 @@ ALuint SanitizeAlignment(FmtType type, ALuint align)
 }
 
 
-/** Loads the specified data into the buffer, using the specified format. */
+/**
+ * Gives the loading buffer its data, either shared or its own, or leaves it
+ * empty if loading failed (both null). The device's buffer lock must be held.
+ */
+void CompleteBufferLoad(ALCdevice *device, ALbuffer *ALBuf,
+    std::shared_ptr<const SharedBufferData> shared, SharedBufferData *owned)
+{
+    if(shared)
+    {
+        ALBuf->mData = {const_cast<std::byte*>(shared->data()), shared->size()};
+        ALBuf->mSharedData = std::move(shared);
+    }
+    else if(owned)
+    {
+        owned->swap(ALBuf->mDataStorage);
+        ALBuf->mData = ALBuf->mDataStorage;
+    }
+    else
+    {
+        ALBuf->OriginalSize = 0;
+        ALBuf->mSampleLen = 0;
+        ALBuf->mLoopStart = 0;
+        ALBuf->mLoopEnd = 0;
+    }
+    ALBuf->mLoadPending = false;
+    UpdateBufferMemory(device, ALBuf);
+    InvalidateSampleCaches(device, ALBuf, ALBuf->mType);
+}
+
+/** Queues an event for the given contexts that the buffer finished loading. */
+void PostBufferLoaded(const al::span<ContextBase*> contexts, const ALuint id,
+    const bool success, const std::chrono::nanoseconds time)
+{
+    for(ContextBase *ctxbase : contexts)
+    {
+        auto *context = static_cast<ALCcontext*>(ctxbase);
+        auto enabledevts = context->mEnabledEvts.load(std::memory_order_acquire);
+        if(!enabledevts.test(al::to_underlying(AsyncEnableBits::BufferLoaded)))
+            continue;
+
+        try {
+            std::lock_guard<std::mutex> _{context->mBufferLoadLock};
+            context->mLoadedBuffers.emplace_back(AsyncBufferLoadedEvent{id, success, time});
+        }
+        catch(...) {
+            continue;
+        }
+        context->mEventSem.post();
+    }
+}
+
+void BufferLoaderThread(ALCdevice *device)
+{
+    althrd_setname(BUFFER_LOADER_THREAD_NAME);
+
+    std::unique_lock<std::mutex> loadlock{device->mBufferLoadLock};
+    while(true)
+    {
+        device->mBufferLoadCond.wait(loadlock, [device]() noexcept -> bool
+            { return device->mBufferLoaderQuit || !device->mBufferLoads.empty(); });
+        if(device->mBufferLoaderQuit)
+            break;
+
+        const ALCdevice::BufferLoad load{device->mBufferLoads.front()};
+        device->mBufferLoads.pop_front();
+        loadlock.unlock();
+
+        std::shared_ptr<const SharedBufferData> shared;
+        SharedBufferData owned;
+        bool success{false};
+        try {
+            if(load.mShare)
+                shared = GetSharedData({load.mData, load.mSize});
+            else
+                owned.assign(load.mData, load.mData+load.mSize);
+            success = true;
+        }
+        catch(std::exception &e) {
+            ERR("Failed to load buffer %u: %s\n", load.mId, e.what());
+        }
+
+        {
+            std::lock_guard<std::mutex> _{device->BufferLock};
+            ALbuffer *buffer{LookupBuffer(device, load.mId)};
+            if(buffer && buffer->mLoadPending)
+                CompleteBufferLoad(device, buffer, std::move(shared), success ? &owned : nullptr);
+        }
+        device->mBufferLoadedCond.notify_all();
+
+        {
+            std::lock_guard<std::mutex> _{device->StateLock};
+            PostBufferLoaded(*device->mContexts.load(std::memory_order_acquire), load.mId,
+                success, GetDeviceClockTime(device));
+        }
+
+        loadlock.lock();
+    }
+}
+
+/**
+ * Queues the loading buffer's data to be copied in by the device's loader
+ * thread. The device's buffer lock must be held.
+ */
+void QueueBufferLoad(ALCcontext *context, ALbuffer *ALBuf, const std::byte *data,
+    const size_t size)
+{
+    ALCdevice *device{context->mALDevice.get()};
+    try {
+        if(!device->mBufferLoader.joinable())
+            device->mBufferLoader = std::thread{BufferLoaderThread, device};
+
+        std::lock_guard<std::mutex> _{device->mBufferLoadLock};
+        device->mBufferLoads.emplace_back(ALCdevice::BufferLoad{ALBuf->id, data, size,
+            device->mShareBuffers});
+    }
+    catch(std::exception &e) {
+        ERR("Failed to queue buffer load: %s\n", e.what());
+
+        /* Load it here instead, only reporting to the calling context since
+         * the device's contexts can't be safely accessed here.
+         */
+        std::shared_ptr<const SharedBufferData> shared;
+        SharedBufferData owned;
+        bool success{false};
+        try {
+            if(device->mShareBuffers)
+                shared = GetSharedData({data, size});
+            else
+                owned.assign(data, data+size);
+            success = true;
+        }
+        catch(...) {
+        }
+        CompleteBufferLoad(device, ALBuf, std::move(shared), success ? &owned : nullptr);
+
+        ContextBase *ctxbase{context};
+        PostBufferLoaded({&ctxbase, 1}, ALBuf->id, success, GetDeviceClockTime(device));
+        return;
+    }
+    device->mBufferLoadCond.notify_all();
+}
+
+
+/**
+ * Fills the free space of the callback buffer's ring from the callback, until
+ * it's full or the callback ends the stream.
+ */
+void FillPrefetch(CallbackPrefetch &prefetch)
+{
+    std::lock_guard<std::mutex> _{prefetch.mLock};
+    if(!prefetch.mCallback)
+        return;
+
+    BufferRing &ring = *prefetch.mRing;
+    if(const ALuint underruns{ring.mUnderruns.load(std::memory_order_relaxed)};
+        underruns != prefetch.mUnderruns)
+    {
+        const ALuint count{underruns - prefetch.mUnderruns};
+        WARN("Callback buffer %u underran %u time%s\n", prefetch.mBufferId, count,
+            (count == 1) ? "" : "s");
+        prefetch.mUnderruns = underruns;
+    }
+    if(ring.mEnded.load(std::memory_order_relaxed))
+        return;
+
+    ALuint writePos{ring.mWritePos.load(std::memory_order_relaxed)};
+    ALuint writable{ring.mNumBlocks - ring.readable(writePos,
+        ring.mReadPos.load(std::memory_order_acquire))};
+    while(writable > 0)
+    {
+        /* Fill up to the end of the storage, then wrap around. */
+        const ALuint writeIndex{ring.index(writePos)};
+        const ALuint todo{minu(writable, ring.mNumBlocks - writeIndex)};
+        const int needBytes{static_cast<int>(todo * prefetch.mBlockSize)};
+        const int gotBytes{prefetch.mCallback(prefetch.mUserData,
+            prefetch.mSamples + size_t{writeIndex}*prefetch.mBlockSize, needBytes)};
+        const ALuint gotBlocks{static_cast<ALuint>(maxi(gotBytes, 0)) / prefetch.mBlockSize};
+
+        writePos = ring.advance(writePos, gotBlocks);
+        ring.mWritePos.store(writePos, std::memory_order_release);
+        if(gotBytes < needBytes)
+        {
+            /* Set after the last blocks are published, so the mixer sees them
+             * before it sees the end.
+             */
+            ring.mEnded.store(true, std::memory_order_release);
+            break;
+        }
+        writable -= todo;
+    }
+}
+
+void BufferPrefetchThread(ALCdevice *device)
+{
+    althrd_setname(BUFFER_PREFETCH_THREAD_NAME);
+
+    std::vector<std::shared_ptr<CallbackPrefetch>> prefetches;
+    std::unique_lock<std::mutex> prefetchlock{device->mPrefetchLock};
+    while(!device->mPrefetcherQuit)
+    {
+        /* Drop the buffers that were released, and fill the rest without the
+         * lock held since the callbacks may take a while.
+         */
+        auto &list = device->mPrefetches;
+        list.erase(std::remove_if(list.begin(), list.end(),
+            [](const std::shared_ptr<CallbackPrefetch> &prefetch) noexcept
+            { return prefetch.use_count() == 1; }), list.end());
+        prefetches.assign(list.cbegin(), list.cend());
+        prefetchlock.unlock();
+
+        for(const auto &prefetch : prefetches)
+            FillPrefetch(*prefetch);
+        prefetches.clear();
+
+        prefetchlock.lock();
+        if(device->mPrefetcherQuit)
+            break;
+        device->mPrefetchCond.wait_for(prefetchlock, device->mPrefetchInterval);
+    }
+}
+
+
+/**
+ * Loads the specified data into the buffer, using the specified format. When
+ * async is set, the data is left for the loader thread to copy in.
+ */
 void LoadData(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq, ALuint size,
     const FmtChannels DstChannels, const FmtType DstType, const std::byte *SrcData,
-    ALbitfieldSOFT access)
+    ALbitfieldSOFT access, const bool async)
 {
-    if(ReadRef(ALBuf->ref) != 0 || ALBuf->MappedAccess != 0) UNLIKELY
+    if(ReadRef(ALBuf->ref) != 0 || ALBuf->MappedAccess != 0 || ALBuf->mLoadPending) UNLIKELY
         return context->setError(AL_INVALID_OPERATION, "Modifying storage for in-use buffer %u",
             ALBuf->id);
+    StopCallbackPrefetch(ALBuf);
 
     const ALuint unpackalign{ALBuf->UnpackAlign};
     const ALuint align{SanitizeAlignment(DstType, unpackalign)};
@@ -299,6 +699,9 @@ void LoadData(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq, ALuint size,
 
     if((access&AL_PRESERVE_DATA_BIT_SOFT))
     {
+        if(ALBuf->mPlaneSize != 0) UNLIKELY
+            return context->setError(AL_INVALID_OPERATION, "Preserving converted data of buffer %u",
+                ALBuf->id);
         /* Can only preserve data with the same format and alignment. */
         if(ALBuf->mChannels != DstChannels || ALBuf->mType != DstType) UNLIKELY
             return context->setError(AL_INVALID_VALUE, "Preserving data of mismatched format");
@@ -339,30 +742,81 @@ void LoadData(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq, ALuint size,
     }
 #endif
 
-    /* This could reallocate only when increasing the size or the new size is
-     * less than half the current, but then the buffer's AL_SIZE would not be
-     * very reliable for accounting buffer memory usage, and reporting the real
-     * size could cause problems for apps that use AL_SIZE to try to get the
-     * buffer's play length.
+    /* With the convert-buffers option, data the app can't map gets converted
+     * to float planes for the mixer to read without converting or striding.
+     */
+    const bool convert{context->mALDevice->mConvertBuffers && !async && SrcData != nullptr
+        && !(access&(MAP_READ_WRITE_FLAGS|AL_MAP_PERSISTENT_BIT_SOFT|AL_PRESERVE_DATA_BIT_SOFT))};
+    const ALuint convertLen{convert ? blocks*align : 0u};
+    const ALuint planeSize{RoundUp(convertLen, 4)};
+
+    /* With the share-buffers option, data that won't be written to while in
+     * use can be shared with other buffers holding the same samples, which an
+     * asynchronous load gets once it's copied in. Persistently mappable
+     * buffers can be written to at any time, so they always get their own
+     * storage.
      */
-    if(newsize != ALBuf->mDataStorage.size())
+    if(planeSize > 0)
+    {
+        decltype(ALBuf->mDataStorage)(size_t{planeSize}*NumChannels*sizeof(float),
+            std::byte{}).swap(ALBuf->mDataStorage);
+        ALBuf->mData = ALBuf->mDataStorage;
+        ALBuf->mSharedData = nullptr;
+
+        ConvertToPlanes(reinterpret_cast<float*>(ALBuf->mData.data()), planeSize, 0, SrcData,
+            DstType, NumChannels, align, convertLen);
+    }
+    else if(async)
     {
-        auto newdata = decltype(ALBuf->mDataStorage)(newsize, std::byte{});
-        if((access&AL_PRESERVE_DATA_BIT_SOFT))
+        decltype(ALBuf->mDataStorage){}.swap(ALBuf->mDataStorage);
+        ALBuf->mData = {};
+        ALBuf->mSharedData = nullptr;
+        ALBuf->mLoadPending = true;
+    }
+    else if(context->mALDevice->mShareBuffers && SrcData != nullptr && newsize > 0
+        && !(access&(AL_PRESERVE_DATA_BIT_SOFT|AL_MAP_PERSISTENT_BIT_SOFT)))
+    {
+        auto shared = GetSharedData({SrcData, newsize});
+        decltype(ALBuf->mDataStorage){}.swap(ALBuf->mDataStorage);
+        ALBuf->mData = {const_cast<std::byte*>(shared->data()), shared->size()};
+        ALBuf->mSharedData = std::move(shared);
+    }
+    else
+    {
+        /* This could reallocate only when increasing the size or the new size
+         * is less than half the current, but then the buffer's AL_SIZE would
+         * not be very reliable for accounting buffer memory usage, and
+         * reporting the real size could cause problems for apps that use
+         * AL_SIZE to try to get the buffer's play length.
+         */
+        if(newsize != ALBuf->mDataStorage.size() || ALBuf->mSharedData)
         {
-            const size_t tocopy{minz(newdata.size(), ALBuf->mDataStorage.size())};
-            std::copy_n(ALBuf->mDataStorage.begin(), tocopy, newdata.begin());
+            const al::span<const std::byte> olddata{ALBuf->mSharedData
+                ? al::span<const std::byte>{*ALBuf->mSharedData}
+                : al::span<const std::byte>{ALBuf->mDataStorage}};
+            auto newdata = decltype(ALBuf->mDataStorage)(newsize, std::byte{});
+            if((access&AL_PRESERVE_DATA_BIT_SOFT))
+            {
+                const size_t tocopy{minz(newdata.size(), olddata.size())};
+                std::copy_n(olddata.begin(), tocopy, newdata.begin());
+            }
+            newdata.swap(ALBuf->mDataStorage);
         }
-        newdata.swap(ALBuf->mDataStorage);
+        ALBuf->mData = ALBuf->mDataStorage;
+        ALBuf->mSharedData = nullptr;
+
+        if(SrcData != nullptr && !ALBuf->mData.empty())
+            std::copy_n(SrcData, blocks*BlockSize, ALBuf->mData.begin());
     }
-    ALBuf->mData = ALBuf->mDataStorage;
+    ALBuf->mFileMapping = nullptr;
+    UpdateBufferMemory(context->mALDevice.get(), ALBuf);
 #ifdef ALSOFT_EAX
     eax_x_ram_clear(*context->mALDevice, *ALBuf);
 #endif
 
-    if(SrcData != nullptr && !ALBuf->mData.empty())
-        std::copy_n(SrcData, blocks*BlockSize, ALBuf->mData.begin());
     ALBuf->mBlockAlign = (DstType == FmtIMA4 || DstType == FmtMSADPCM) ? align : 1;
+    ALBuf->mPlaneSize = planeSize;
+    InvalidateSampleCaches(context->mALDevice.get(), ALBuf, DstType);
 
     ALBuf->OriginalSize = size;
 
@@ -375,6 +829,7 @@ void LoadData(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq, ALuint size,
 
     ALBuf->mCallback = nullptr;
     ALBuf->mUserData = nullptr;
+    ALBuf->mRing = nullptr;
 
     ALBuf->mSampleLen = blocks * align;
     ALBuf->mLoopStart = 0;
@@ -391,9 +846,10 @@ void PrepareCallback(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
     const FmtChannels DstChannels, const FmtType DstType, ALBUFFERCALLBACKTYPESOFT callback,
     void *userptr)
 {
-    if(ReadRef(ALBuf->ref) != 0 || ALBuf->MappedAccess != 0) UNLIKELY
+    if(ReadRef(ALBuf->ref) != 0 || ALBuf->MappedAccess != 0 || ALBuf->mLoadPending) UNLIKELY
         return context->setError(AL_INVALID_OPERATION, "Modifying callback for in-use buffer %u",
             ALBuf->id);
+    StopCallbackPrefetch(ALBuf);
 
     const ALuint ambiorder{IsBFormat(DstChannels) ? ALBuf->UnpackAmbiOrder :
         (IsUHJ(DstChannels) ? 1 : 0)};
@@ -412,11 +868,48 @@ void PrepareCallback(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
      * voice will hold a history for the past samples).
      */
     static constexpr size_t line_size{DeviceBase::MixerLineSize*MaxPitch + MaxResamplerEdge};
-    const size_t line_blocks{(line_size + align-1) / align};
+    size_t line_blocks{(line_size + align-1) / align};
+
+    /* With prefetching, the device's prefetch thread calls the callback to
+     * keep a ring filled with the configured number of updates at the
+     * buffer's rate, plus the resampler's "future" samples.
+     */
+    ALCdevice *device{context->mALDevice.get()};
+    std::shared_ptr<CallbackPrefetch> prefetch;
+    if(const ALuint periods{device->mCallbackPrefetch})
+    {
+        /* A loopback device doesn't have an update size, but mixes up to a
+         * full line at a time.
+         */
+        const ALuint updateSize{maxu(device->UpdateSize, DeviceBase::MixerLineSize)};
+        try {
+            prefetch = std::make_shared<CallbackPrefetch>();
+
+            std::lock_guard<std::mutex> _{device->mPrefetchLock};
+            if(!device->mPrefetcher.joinable())
+                device->mPrefetcher = std::thread{BufferPrefetchThread, device};
+            device->mPrefetches.emplace_back(prefetch);
+            device->mPrefetchInterval = std::chrono::nanoseconds{
+                std::chrono::seconds{updateSize}} / device->Frequency;
+        }
+        catch(std::exception &e) {
+            ERR("Failed to prefetch callback buffer %u: %s\n", ALBuf->id, e.what());
+            prefetch = nullptr;
+        }
+        if(prefetch)
+        {
+            const uint64_t samples{uint64_t{periods} * updateSize * static_cast<ALuint>(freq)
+                / device->Frequency + MaxResamplerEdge};
+            line_blocks = static_cast<size_t>((samples + align-1) / align);
+        }
+    }
 
     using BufferVectorType = decltype(ALBuf->mDataStorage);
     BufferVectorType(line_blocks*BlockSize).swap(ALBuf->mDataStorage);
     ALBuf->mData = ALBuf->mDataStorage;
+    ALBuf->mFileMapping = nullptr;
+    ALBuf->mSharedData = nullptr;
+    UpdateBufferMemory(context->mALDevice.get(), ALBuf);
 
 #ifdef ALSOFT_EAX
     eax_x_ram_clear(*context->mALDevice, *ALBuf);
@@ -424,11 +917,109 @@ void PrepareCallback(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
 
     ALBuf->mCallback = callback;
     ALBuf->mUserData = userptr;
+    ALBuf->mRing = nullptr;
+    if(prefetch)
+    {
+        BufferRing &ring = ALBuf->mRingState;
+        ring.mWritePos.store(0u, std::memory_order_relaxed);
+        ring.mReadPos.store(0u, std::memory_order_relaxed);
+        ring.mNumBlocks = static_cast<ALuint>(line_blocks);
+        ring.mPrefetch = true;
+        ring.mEnded.store(false, std::memory_order_relaxed);
+        ring.mUnderruns.store(0u, std::memory_order_relaxed);
+        ALBuf->mRing = &ring;
+
+        std::lock_guard<std::mutex> _{prefetch->mLock};
+        prefetch->mCallback = callback;
+        prefetch->mUserData = userptr;
+        prefetch->mRing = &ring;
+        prefetch->mSamples = ALBuf->mDataStorage.data();
+        prefetch->mBlockSize = BlockSize;
+        prefetch->mBufferId = ALBuf->id;
+        ALBuf->mPrefetch = std::move(prefetch);
+        device->mPrefetchCond.notify_all();
+    }
 
     ALBuf->OriginalSize = 0;
     ALBuf->Access = 0;
 
     ALBuf->mBlockAlign = (DstType == FmtIMA4 || DstType == FmtMSADPCM) ? align : 1;
+    ALBuf->mPlaneSize = 0;
+    ALBuf->mSampleRate = static_cast<ALuint>(freq);
+    ALBuf->mChannels = DstChannels;
+    ALBuf->mType = DstType;
+    ALBuf->mAmbiOrder = ambiorder;
+
+    ALBuf->mSampleLen = 0;
+    ALBuf->mLoopStart = 0;
+    ALBuf->mLoopEnd = ALBuf->mSampleLen;
+}
+
+/** Prepares the buffer to use ring storage of the given size, in bytes. */
+void PrepareRing(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq, ALuint size,
+    const FmtChannels DstChannels, const FmtType DstType)
+{
+    if(ReadRef(ALBuf->ref) != 0 || ALBuf->MappedAccess != 0 || ALBuf->mLoadPending) UNLIKELY
+        return context->setError(AL_INVALID_OPERATION, "Modifying storage for in-use buffer %u",
+            ALBuf->id);
+    StopCallbackPrefetch(ALBuf);
+
+    const ALuint unpackalign{ALBuf->UnpackAlign};
+    const ALuint align{SanitizeAlignment(DstType, unpackalign)};
+    if(align < 1) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "Invalid unpack alignment %u for %s samples",
+            unpackalign, NameFromFormat(DstType));
+
+    const ALuint ambiorder{IsBFormat(DstChannels) ? ALBuf->UnpackAmbiOrder :
+        (IsUHJ(DstChannels) ? 1 : 0)};
+
+    /* Convert the size in bytes to blocks using the unpack block alignment. */
+    const ALuint NumChannels{ChannelsFromFmt(DstChannels, ambiorder)};
+    const ALuint BlockSize{NumChannels *
+        ((DstType == FmtIMA4) ? (align-1)/2 + 4 :
+        (DstType == FmtMSADPCM) ? (align-2)/2 + 7 :
+        (align * BytesFromFmt(DstType)))};
+    if(size == 0 || (size%BlockSize) != 0) UNLIKELY
+        return context->setError(AL_INVALID_VALUE,
+            "Ring size %u is not a multiple of frame size %u (%u unpack alignment)",
+            size, BlockSize, align);
+    const ALuint blocks{size / BlockSize};
+
+    /* The ring positions are kept modulo twice the block count, which needs
+     * to fit with room to spare.
+     */
+    if(blocks > std::numeric_limits<ALuint>::max()/4
+        || blocks > std::numeric_limits<ALsizei>::max()/align) UNLIKELY
+        return context->setError(AL_OUT_OF_MEMORY,
+            "Ring size overflow, %u blocks x %u samples per block", blocks, align);
+
+    using BufferVectorType = decltype(ALBuf->mDataStorage);
+    BufferVectorType(size_t{blocks}*BlockSize, std::byte{}).swap(ALBuf->mDataStorage);
+    ALBuf->mData = ALBuf->mDataStorage;
+    ALBuf->mFileMapping = nullptr;
+    ALBuf->mSharedData = nullptr;
+    UpdateBufferMemory(context->mALDevice.get(), ALBuf);
+
+#ifdef ALSOFT_EAX
+    eax_x_ram_clear(*context->mALDevice, *ALBuf);
+#endif
+
+    ALBuf->mCallback = nullptr;
+    ALBuf->mUserData = nullptr;
+
+    ALBuf->mRingState.mWritePos.store(0u, std::memory_order_relaxed);
+    ALBuf->mRingState.mReadPos.store(0u, std::memory_order_relaxed);
+    ALBuf->mRingState.mNumBlocks = blocks;
+    ALBuf->mRingState.mPrefetch = false;
+    ALBuf->mRingState.mEnded.store(false, std::memory_order_relaxed);
+    ALBuf->mRingState.mUnderruns.store(0u, std::memory_order_relaxed);
+    ALBuf->mRing = &ALBuf->mRingState;
+
+    ALBuf->OriginalSize = size;
+    ALBuf->Access = 0;
+
+    ALBuf->mBlockAlign = (DstType == FmtIMA4 || DstType == FmtMSADPCM) ? align : 1;
+    ALBuf->mPlaneSize = 0;
     ALBuf->mSampleRate = static_cast<ALuint>(freq);
     ALBuf->mChannels = DstChannels;
     ALBuf->mType = DstType;
@@ -443,9 +1034,10 @@ void PrepareCallback(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
 void PrepareUserPtr(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
     const FmtChannels DstChannels, const FmtType DstType, std::byte *sdata, const ALuint sdatalen)
 {
-    if(ReadRef(ALBuf->ref) != 0 || ALBuf->MappedAccess != 0) UNLIKELY
+    if(ReadRef(ALBuf->ref) != 0 || ALBuf->MappedAccess != 0 || ALBuf->mLoadPending) UNLIKELY
         return context->setError(AL_INVALID_OPERATION, "Modifying storage for in-use buffer %u",
             ALBuf->id);
+    StopCallbackPrefetch(ALBuf);
 
     const ALuint unpackalign{ALBuf->UnpackAlign};
     const ALuint align{SanitizeAlignment(DstType, unpackalign)};
@@ -464,6 +1056,7 @@ void PrepareUserPtr(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
         case FmtShort: return alignof(ALshort);
         case FmtFloat: return alignof(ALfloat);
         case FmtDouble: return alignof(ALdouble);
+        case FmtHalf: return alignof(ALushort);
         case FmtMulaw: return alignof(ALubyte);
         case FmtAlaw: return alignof(ALubyte);
         case FmtIMA4: break;
@@ -511,6 +1104,10 @@ void PrepareUserPtr(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
 
     decltype(ALBuf->mDataStorage){}.swap(ALBuf->mDataStorage);
     ALBuf->mData = {static_cast<std::byte*>(sdata), sdatalen};
+    ALBuf->mFileMapping = nullptr;
+    ALBuf->mSharedData = nullptr;
+    UpdateBufferMemory(context->mALDevice.get(), ALBuf);
+    InvalidateSampleCaches(context->mALDevice.get(), ALBuf, DstType);
 
 #ifdef ALSOFT_EAX
     eax_x_ram_clear(*context->mALDevice, *ALBuf);
@@ -518,11 +1115,104 @@ void PrepareUserPtr(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
 
     ALBuf->mCallback = nullptr;
     ALBuf->mUserData = nullptr;
+    ALBuf->mRing = nullptr;
 
     ALBuf->OriginalSize = sdatalen;
     ALBuf->Access = 0;
 
     ALBuf->mBlockAlign = (DstType == FmtIMA4 || DstType == FmtMSADPCM) ? align : 1;
+    ALBuf->mPlaneSize = 0;
+    ALBuf->mSampleRate = static_cast<ALuint>(freq);
+    ALBuf->mChannels = DstChannels;
+    ALBuf->mType = DstType;
+    ALBuf->mAmbiOrder = ambiorder;
+
+    ALBuf->mSampleLen = blocks * align;
+    ALBuf->mLoopStart = 0;
+    ALBuf->mLoopEnd = ALBuf->mSampleLen;
+
+#ifdef ALSOFT_EAX
+    if(ALBuf->eax_x_ram_mode == EaxStorage::Hardware)
+        eax_x_ram_apply(*context->mALDevice, *ALBuf);
+#endif
+}
+
+/** Prepares the buffer to use storage mapped from a range of the named file. */
+void PrepareFile(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
+    const FmtChannels DstChannels, const FmtType DstType, const char *fname,
+    const uint64_t offset, const ALuint size)
+{
+    if(ReadRef(ALBuf->ref) != 0 || ALBuf->MappedAccess != 0 || ALBuf->mLoadPending) UNLIKELY
+        return context->setError(AL_INVALID_OPERATION, "Modifying storage for in-use buffer %u",
+            ALBuf->id);
+    StopCallbackPrefetch(ALBuf);
+
+    const ALuint unpackalign{ALBuf->UnpackAlign};
+    const ALuint align{SanitizeAlignment(DstType, unpackalign)};
+    if(align < 1) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "Invalid unpack alignment %u for %s samples",
+            unpackalign, NameFromFormat(DstType));
+
+    const ALuint ambiorder{IsBFormat(DstChannels) ? ALBuf->UnpackAmbiOrder :
+        (IsUHJ(DstChannels) ? 1 : 0)};
+
+    /* Convert the size in bytes to blocks using the unpack block alignment. */
+    const ALuint NumChannels{ChannelsFromFmt(DstChannels, ambiorder)};
+    const ALuint BlockSize{NumChannels *
+        ((DstType == FmtIMA4) ? (align-1)/2 + 4 :
+        (DstType == FmtMSADPCM) ? (align-2)/2 + 7 :
+        (align * BytesFromFmt(DstType)))};
+    if((size%BlockSize) != 0) UNLIKELY
+        return context->setError(AL_INVALID_VALUE,
+            "Data size %u is not a multiple of frame size %u (%u unpack alignment)",
+            size, BlockSize, align);
+    const ALuint blocks{size / BlockSize};
+
+    if(blocks > std::numeric_limits<ALsizei>::max()/align) UNLIKELY
+        return context->setError(AL_OUT_OF_MEMORY,
+            "Buffer size overflow, %d blocks x %d samples per block", blocks, align);
+
+#ifdef ALSOFT_EAX
+    if(ALBuf->eax_x_ram_mode == EaxStorage::Hardware)
+    {
+        ALCdevice &device = *context->mALDevice;
+        if(!eax_x_ram_check_availability(device, *ALBuf, size))
+            return context->setError(AL_OUT_OF_MEMORY,
+                "Out of X-RAM memory (avail: %u, needed: %u)", device.eax_x_ram_free_size, size);
+    }
+#endif
+
+    /* The samples are paged in from the file as the mixer reads them, so
+     * loading the buffer only needs the range to be mapped.
+     */
+    auto mapping = MapFile(fname, offset, size);
+    if(!mapping.first) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "Failed to map %u bytes at %" PRIu64 " of %s",
+            size, offset, fname);
+    TRACE("Mapped %u bytes at %" PRIu64 " of %s for buffer %u\n", size, offset, fname,
+        ALBuf->id);
+
+    decltype(ALBuf->mDataStorage){}.swap(ALBuf->mDataStorage);
+    ALBuf->mData = {reinterpret_cast<std::byte*>(const_cast<char*>(mapping.second.data())),
+        mapping.second.size()};
+    ALBuf->mFileMapping = std::move(mapping.first);
+    ALBuf->mSharedData = nullptr;
+    UpdateBufferMemory(context->mALDevice.get(), ALBuf);
+    InvalidateSampleCaches(context->mALDevice.get(), ALBuf, DstType);
+
+#ifdef ALSOFT_EAX
+    eax_x_ram_clear(*context->mALDevice, *ALBuf);
+#endif
+
+    ALBuf->mCallback = nullptr;
+    ALBuf->mUserData = nullptr;
+    ALBuf->mRing = nullptr;
+
+    ALBuf->OriginalSize = size;
+    ALBuf->Access = 0;
+
+    ALBuf->mBlockAlign = (DstType == FmtIMA4 || DstType == FmtMSADPCM) ? align : 1;
+    ALBuf->mPlaneSize = 0;
     ALBuf->mSampleRate = static_cast<ALuint>(freq);
     ALBuf->mChannels = DstChannels;
     ALBuf->mType = DstType;
@@ -547,11 +1237,12 @@ std::optional<DecompResult> DecomposeUserFormat(ALenum format)
         FmtChannels channels;
         FmtType type;
     };
-    static const std::array<FormatMap,63> UserFmtList{{
+    static const std::array<FormatMap,65> UserFmtList{{
         { AL_FORMAT_MONO8,             FmtMono, FmtUByte   },
         { AL_FORMAT_MONO16,            FmtMono, FmtShort   },
         { AL_FORMAT_MONO_FLOAT32,      FmtMono, FmtFloat   },
         { AL_FORMAT_MONO_DOUBLE_EXT,   FmtMono, FmtDouble  },
+        { AL_FORMAT_MONO_HALF_SOFT,    FmtMono, FmtHalf    },
         { AL_FORMAT_MONO_IMA4,         FmtMono, FmtIMA4    },
         { AL_FORMAT_MONO_MSADPCM_SOFT, FmtMono, FmtMSADPCM },
         { AL_FORMAT_MONO_MULAW,        FmtMono, FmtMulaw   },
@@ -561,6 +1252,7 @@ std::optional<DecompResult> DecomposeUserFormat(ALenum format)
         { AL_FORMAT_STEREO16,            FmtStereo, FmtShort   },
         { AL_FORMAT_STEREO_FLOAT32,      FmtStereo, FmtFloat   },
         { AL_FORMAT_STEREO_DOUBLE_EXT,   FmtStereo, FmtDouble  },
+        { AL_FORMAT_STEREO_HALF_SOFT,    FmtStereo, FmtHalf    },
         { AL_FORMAT_STEREO_IMA4,         FmtStereo, FmtIMA4    },
         { AL_FORMAT_STEREO_MSADPCM_SOFT, FmtStereo, FmtMSADPCM },
         { AL_FORMAT_STEREO_MULAW,        FmtStereo, FmtMulaw   },
@@ -636,6 +1328,21 @@ std::optional<DecompResult> DecomposeUserFormat(ALenum format)
 } // namespace
 
 
+bool ReserveBuffers(ALCdevice *device, size_t count)
+{
+    std::lock_guard<std::mutex> _{device->BufferLock};
+    return EnsureBuffers(device, count);
+}
+
+void WaitForBufferLoad(ALCdevice *device, std::unique_lock<std::mutex> &buflock,
+    const ALbuffer *buffer)
+{
+    /* Loading buffers can't be deleted, so the buffer stays valid. */
+    device->mBufferLoadedCond.wait(buflock, [buffer]() noexcept -> bool
+        { return !buffer->mLoadPending; });
+}
+
+
 FORCE_ALIGN void AL_APIENTRY alGenBuffersDirect(ALCcontext *context, ALsizei n, ALuint *buffers) noexcept
 {
     if(n < 0) UNLIKELY
@@ -679,10 +1386,12 @@ FORCE_ALIGN void AL_APIENTRY alDeleteBuffersDirect(ALCcontext *context, ALsizei
     if(n <= 0) UNLIKELY return;
 
     ALCdevice *device{context->mALDevice.get()};
-    std::lock_guard<std::mutex> _{device->BufferLock};
+    std::unique_lock<std::mutex> buflock{device->BufferLock};
 
-    /* First try to find any buffers that are invalid or in-use. */
-    auto validate_buffer = [device, &context](const ALuint bid) -> bool
+    /* First try to find any buffers that are invalid or in-use, waiting for
+     * any still loading.
+     */
+    auto validate_buffer = [device, &context, &buflock](const ALuint bid) -> bool
     {
         if(!bid) return true;
         ALbuffer *ALBuf{LookupBuffer(device, bid)};
@@ -691,6 +1400,7 @@ FORCE_ALIGN void AL_APIENTRY alDeleteBuffersDirect(ALCcontext *context, ALsizei
             context->setError(AL_INVALID_NAME, "Invalid buffer ID %u", bid);
             return false;
         }
+        WaitForBufferLoad(device, buflock, ALBuf);
         if(ReadRef(ALBuf->ref) != 0) UNLIKELY
         {
             context->setError(AL_INVALID_OPERATION, "Deleting in-use buffer %u", bid);
@@ -758,7 +1468,38 @@ FORCE_ALIGN void AL_APIENTRY alBufferStorageDirectSOFT(ALCcontext *context, ALui
         else
         {
             LoadData(context, albuf, freq, static_cast<ALuint>(size), usrfmt->channels,
-                usrfmt->type, static_cast<const std::byte*>(data), flags);
+                usrfmt->type, static_cast<const std::byte*>(data), flags, false);
+        }
+    }
+}
+
+FORCE_ALIGN void AL_APIENTRY alBufferDataAsyncDirectSOFT(ALCcontext *context, ALuint buffer,
+    ALenum format, const ALvoid *data, ALsizei size, ALsizei freq) noexcept
+{
+    ALCdevice *device{context->mALDevice.get()};
+    std::lock_guard<std::mutex> _{device->BufferLock};
+
+    ALbuffer *albuf = LookupBuffer(device, buffer);
+    if(!albuf) UNLIKELY
+        context->setError(AL_INVALID_NAME, "Invalid buffer ID %u", buffer);
+    else if(!data) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "NULL data");
+    else if(size <= 0) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Invalid data size %d", size);
+    else if(freq < 1) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Invalid sample rate %d", freq);
+    else
+    {
+        auto usrfmt = DecomposeUserFormat(format);
+        if(!usrfmt) UNLIKELY
+            context->setError(AL_INVALID_ENUM, "Invalid format 0x%04x", format);
+        else
+        {
+            LoadData(context, albuf, freq, static_cast<ALuint>(size), usrfmt->channels,
+                usrfmt->type, static_cast<const std::byte*>(data), 0, true);
+            if(albuf->mLoadPending)
+                QueueBufferLoad(context, albuf, static_cast<const std::byte*>(data),
+                    static_cast<ALuint>(size));
         }
     }
 }
@@ -807,6 +1548,8 @@ FORCE_ALIGN void* AL_APIENTRY alMapBufferDirectSOFT(ALCcontext *context, ALuint
                 "Mapping in-use buffer %u without persistent mapping", buffer);
         else if(albuf->MappedAccess != 0) UNLIKELY
             context->setError(AL_INVALID_OPERATION, "Mapping already-mapped buffer %u", buffer);
+        else if(albuf->mLoadPending) UNLIKELY
+            context->setError(AL_INVALID_OPERATION, "Mapping loading buffer %u", buffer);
         else if((unavailable&AL_MAP_READ_BIT_SOFT)) UNLIKELY
             context->setError(AL_INVALID_VALUE,
                 "Mapping buffer %u for reading without read access", buffer);
@@ -824,6 +1567,11 @@ FORCE_ALIGN void* AL_APIENTRY alMapBufferDirectSOFT(ALCcontext *context, ALuint
                 offset, length, buffer);
         else
         {
+            /* Shared data is only mapped here when the buffer isn't in use,
+             * since persistently mappable buffers don't share.
+             */
+            if((access&AL_MAP_WRITE_BIT_SOFT))
+                UnshareBufferData(device, albuf);
             void *retval{albuf->mData.data() + offset};
             albuf->MappedAccess = access;
             albuf->MappedOffset = offset;
@@ -847,6 +1595,8 @@ FORCE_ALIGN void AL_APIENTRY alUnmapBufferDirectSOFT(ALCcontext *context, ALuint
         context->setError(AL_INVALID_OPERATION, "Unmapping unmapped buffer %u", buffer);
     else
     {
+        if((albuf->MappedAccess&AL_MAP_WRITE_BIT_SOFT))
+            InvalidateSampleCaches(device, albuf, albuf->mType);
         albuf->MappedAccess = 0;
         albuf->MappedOffset = 0;
         albuf->MappedSize = 0;
@@ -908,9 +1658,15 @@ FORCE_ALIGN void AL_APIENTRY alBufferSubDataDirectSOFT(ALCcontext *context, ALui
     if(albuf->isBFormat() && albuf->UnpackAmbiOrder != albuf->mAmbiOrder) UNLIKELY
         return context->setError(AL_INVALID_VALUE,
             "Unpacking data with mismatched ambisonic order");
+    if(albuf->mFileMapping) UNLIKELY
+        return context->setError(AL_INVALID_OPERATION, "Unpacking data into file buffer %u",
+            buffer);
     if(albuf->MappedAccess != 0) UNLIKELY
         return context->setError(AL_INVALID_OPERATION, "Unpacking data into mapped buffer %u",
             buffer);
+    if(albuf->mLoadPending) UNLIKELY
+        return context->setError(AL_INVALID_OPERATION, "Unpacking data into loading buffer %u",
+            buffer);
 
     const ALuint num_chans{albuf->channelsFromFmt()};
     const ALuint byte_align{
@@ -932,8 +1688,28 @@ FORCE_ALIGN void AL_APIENTRY alBufferSubDataDirectSOFT(ALCcontext *context, ALui
             "Sub-range length %d is not a multiple of frame size %d (%d unpack alignment)",
             length, byte_align, align);
 
+    if(albuf->mSharedData)
+    {
+        /* Voices playing the buffer hold onto the current data, so it can't
+         * be replaced while in use.
+         */
+        if(ReadRef(albuf->ref) != 0) UNLIKELY
+            return context->setError(AL_INVALID_OPERATION,
+                "Unpacking data into shared in-use buffer %u", buffer);
+        UnshareBufferData(device, albuf);
+    }
+
     assert(al::to_underlying(usrfmt->type) == al::to_underlying(albuf->mType));
-    memcpy(albuf->mData.data()+offset, data, static_cast<ALuint>(length));
+    if(const ALuint planeSize{albuf->mPlaneSize})
+    {
+        /* Converted data gets the new samples converted into its planes. */
+        ConvertToPlanes(reinterpret_cast<float*>(albuf->mData.data()), planeSize,
+            static_cast<ALuint>(offset)/byte_align*align, static_cast<const std::byte*>(data),
+            albuf->mType, num_chans, align, static_cast<ALuint>(length)/byte_align*align);
+    }
+    else
+        memcpy(albuf->mData.data()+offset, data, static_cast<ALuint>(length));
+    InvalidateSampleCaches(device, albuf, albuf->mType);
 }
 
 
@@ -1194,7 +1970,12 @@ FORCE_ALIGN void AL_APIENTRY alGetBufferiDirect(ALCcontext *context, ALuint buff
         break;
 
     case AL_SIZE:
-        *value = albuf->mCallback ? 0 : static_cast<ALint>(albuf->mData.size());
+        *value = albuf->mCallback ? 0 : (albuf->mLoadPending || albuf->mPlaneSize) ?
+            static_cast<ALint>(albuf->OriginalSize) : static_cast<ALint>(albuf->mData.size());
+        break;
+
+    case AL_BUFFER_LOADING_SOFT:
+        *value = albuf->mLoadPending ? AL_TRUE : AL_FALSE;
         break;
 
     case AL_BYTE_LENGTH_SOFT:
@@ -1256,6 +2037,7 @@ FORCE_ALIGN void AL_APIENTRY alGetBufferivDirect(ALCcontext *context, ALuint buf
     case AL_BITS:
     case AL_CHANNELS:
     case AL_SIZE:
+    case AL_BUFFER_LOADING_SOFT:
     case AL_INTERNAL_FORMAT_SOFT:
     case AL_BYTE_LENGTH_SOFT:
     case AL_SAMPLE_LENGTH_SOFT:
@@ -1312,6 +2094,132 @@ FORCE_ALIGN void AL_APIENTRY alBufferCallbackDirectSOFT(ALCcontext *context, ALu
     }
 }
 
+FORCE_ALIGN void AL_APIENTRY alBufferFileDirectSOFT(ALCcontext *context, ALuint buffer,
+    ALenum format, const ALchar *filename, ALint64SOFT offset, ALsizei size, ALsizei freq) noexcept
+{
+    ALCdevice *device{context->mALDevice.get()};
+    std::lock_guard<std::mutex> _{device->BufferLock};
+
+    ALbuffer *albuf = LookupBuffer(device, buffer);
+    if(!albuf) UNLIKELY
+        context->setError(AL_INVALID_NAME, "Invalid buffer ID %u", buffer);
+    else if(!filename) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "NULL filename");
+    else if(offset < 0) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Negative file offset %" PRId64, int64_t{offset});
+    else if(size <= 0) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Invalid data size %d", size);
+    else if(freq < 1) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Invalid sample rate %d", freq);
+    else
+    {
+        auto usrfmt = DecomposeUserFormat(format);
+        if(!usrfmt) UNLIKELY
+            context->setError(AL_INVALID_ENUM, "Invalid format 0x%04x", format);
+        else
+            PrepareFile(context, albuf, freq, usrfmt->channels, usrfmt->type, filename,
+                static_cast<uint64_t>(offset), static_cast<ALuint>(size));
+    }
+}
+
+FORCE_ALIGN void AL_APIENTRY alBufferRingDirectSOFT(ALCcontext *context, ALuint buffer,
+    ALenum format, ALsizei size, ALsizei freq) noexcept
+{
+    ALCdevice *device{context->mALDevice.get()};
+    std::lock_guard<std::mutex> _{device->BufferLock};
+
+    ALbuffer *albuf = LookupBuffer(device, buffer);
+    if(!albuf) UNLIKELY
+        context->setError(AL_INVALID_NAME, "Invalid buffer ID %u", buffer);
+    else if(size <= 0) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Invalid ring size %d", size);
+    else if(freq < 1) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Invalid sample rate %d", freq);
+    else
+    {
+        auto usrfmt = DecomposeUserFormat(format);
+        if(!usrfmt) UNLIKELY
+            context->setError(AL_INVALID_ENUM, "Invalid format 0x%04x", format);
+        else
+            PrepareRing(context, albuf, freq, static_cast<ALuint>(size), usrfmt->channels,
+                usrfmt->type);
+    }
+}
+
+FORCE_ALIGN void* AL_APIENTRY alMapBufferRingDirectSOFT(ALCcontext *context, ALuint buffer,
+    ALsizei *length) noexcept
+{
+    ALCdevice *device{context->mALDevice.get()};
+    std::lock_guard<std::mutex> _{device->BufferLock};
+
+    ALbuffer *albuf = LookupBuffer(device, buffer);
+    if(!albuf) UNLIKELY
+        context->setError(AL_INVALID_NAME, "Invalid buffer ID %u", buffer);
+    else if(!albuf->mRing || albuf->mPrefetch) UNLIKELY
+        context->setError(AL_INVALID_OPERATION, "Mapping non-ring buffer %u", buffer);
+    else if(!length) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "NULL pointer");
+    else
+    {
+        /* Return the space from the write position up to the read position or
+         * the end of the storage, whichever comes first. The rest of the free
+         * space starts at the beginning of the storage, after committing this.
+         */
+        const BufferRing &ring = *albuf->mRing;
+        const ALuint blockSize{albuf->blockSizeFromFmt()};
+        const ALuint writePos{ring.mWritePos.load(std::memory_order_relaxed)};
+        const ALuint readable{ring.readable(writePos,
+            ring.mReadPos.load(std::memory_order_acquire))};
+        const ALuint writeIndex{ring.index(writePos)};
+        const ALuint writable{minu(ring.mNumBlocks - readable, ring.mNumBlocks - writeIndex)};
+
+        *length = static_cast<ALsizei>(writable * blockSize);
+        return albuf->mData.data() + size_t{writeIndex}*blockSize;
+    }
+
+    return nullptr;
+}
+
+FORCE_ALIGN void AL_APIENTRY alCommitBufferRingDirectSOFT(ALCcontext *context, ALuint buffer,
+    ALsizei length) noexcept
+{
+    ALCdevice *device{context->mALDevice.get()};
+    std::lock_guard<std::mutex> _{device->BufferLock};
+
+    ALbuffer *albuf = LookupBuffer(device, buffer);
+    if(!albuf) UNLIKELY
+        context->setError(AL_INVALID_NAME, "Invalid buffer ID %u", buffer);
+    else if(!albuf->mRing || albuf->mPrefetch) UNLIKELY
+        context->setError(AL_INVALID_OPERATION, "Committing to non-ring buffer %u", buffer);
+    else if(length < 0) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Committing invalid length %d", length);
+    else
+    {
+        BufferRing &ring = *albuf->mRing;
+        const ALuint blockSize{albuf->blockSizeFromFmt()};
+        const ALuint writePos{ring.mWritePos.load(std::memory_order_relaxed)};
+        const ALuint readable{ring.readable(writePos,
+            ring.mReadPos.load(std::memory_order_acquire))};
+        const ALuint blocks{static_cast<ALuint>(length) / blockSize};
+
+        if((static_cast<ALuint>(length)%blockSize) != 0) UNLIKELY
+            context->setError(AL_INVALID_VALUE,
+                "Committed length %d is not a multiple of block size %u", length, blockSize);
+        else if(blocks > ring.mNumBlocks - readable) UNLIKELY
+            context->setError(AL_INVALID_VALUE,
+                "Committing %d bytes to buffer %u with %u bytes free", length, buffer,
+                (ring.mNumBlocks - readable) * blockSize);
+        else
+        {
+            /* Publish the new samples to the mixer. The release store makes
+             * the app's writes to the storage visible to the mixer before the
+             * new position is.
+             */
+            ring.mWritePos.store(ring.advance(writePos, blocks), std::memory_order_release);
+        }
+    }
+}
+
 FORCE_ALIGN void AL_APIENTRY alGetBufferPtrDirectSOFT(ALCcontext *context, ALuint buffer,
     ALenum param, ALvoid **value) noexcept
 {
@@ -1382,6 +2290,11 @@ AL_API DECL_FUNC2(void, alDeleteBuffers, ALsizei, const ALuint*)
 AL_API DECL_FUNC1(ALboolean, alIsBuffer, ALuint)
 DECL_FUNC5(void, alBufferDataStatic, ALuint, ALenum, ALvoid*, ALsizei, ALsizei)
 AL_API DECL_FUNCEXT5(void, alBufferCallback,SOFT, ALuint, ALenum, ALsizei, ALBUFFERCALLBACKTYPESOFT, ALvoid*)
+AL_API DECL_FUNCEXT4(void, alBufferRing,SOFT, ALuint, ALenum, ALsizei, ALsizei)
+AL_API DECL_FUNCEXT6(void, alBufferFile,SOFT, ALuint, ALenum, const ALchar*, ALint64SOFT, ALsizei, ALsizei)
+AL_API DECL_FUNCEXT5(void, alBufferDataAsync,SOFT, ALuint, ALenum, const ALvoid*, ALsizei, ALsizei)
+AL_API DECL_FUNCEXT2(void*, alMapBufferRing,SOFT, ALuint, ALsizei*)
+AL_API DECL_FUNCEXT2(void, alCommitBufferRing,SOFT, ALuint, ALsizei)
 AL_API DECL_FUNCEXT6(void, alBufferStorage,SOFT, ALuint, ALenum, const ALvoid*, ALsizei, ALsizei, ALbitfieldSOFT)
 AL_API DECL_FUNCEXT4(void*, alMapBuffer,SOFT, ALuint, ALsizei, ALsizei, ALbitfieldSOFT)
 AL_API DECL_FUNCEXT1(void, alUnmapBuffer,SOFT, ALuint)
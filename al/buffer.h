@@ -3,6 +3,8 @@
 
 #include <atomic>
 #include <cstddef>
+#include <memory>
+#include <mutex>
 
 #include "AL/al.h"
 
@@ -10,6 +12,7 @@
 #include "almalloc.h"
 #include "atomic.h"
 #include "core/buffer_storage.h"
+#include "core/memory_stats.h"
 #include "vector.h"
 
 #ifdef ALSOFT_EAX
@@ -23,17 +26,56 @@ enum class EaxStorage : uint8_t {
 #endif // ALSOFT_EAX
 
 
+struct ALCdevice;
+
+/* What the prefetch thread needs to fill a callback buffer's ring, shared
+ * with the buffer. The lock is held while calling the callback, so clearing
+ * the callback with it held ensures the callback won't be called again.
+ */
+struct CallbackPrefetch {
+    std::mutex mLock;
+    CallbackType mCallback{nullptr};
+    void *mUserData{nullptr};
+
+    BufferRing *mRing{nullptr};
+    std::byte *mSamples{nullptr};
+    ALuint mBlockSize{0u};
+
+    ALuint mBufferId{0u};
+    /* The ring's underrun count last reported. */
+    ALuint mUnderruns{0u};
+};
+
 struct ALbuffer : public BufferStorage {
     ALbitfieldSOFT Access{0u};
 
     al::vector<std::byte,16> mDataStorage;
 
+    /* Keeps a file mapped for file-backed storage, where mData is the mapped
+     * range. The mapping is read-only.
+     */
+    std::shared_ptr<const void> mFileMapping;
+
+    /* Holds samples shared with other buffers that were given identical data,
+     * possibly on other devices, where mData is the shared storage. The
+     * storage is read-only, and gets copied to mDataStorage before writing.
+     */
+    std::shared_ptr<const al::vector<std::byte,16>> mSharedData;
+
+    /* The sample storage counted with the device's memory stats. */
+    MemoryUsage mStorageMemory;
+
     ALuint OriginalSize{0};
 
     ALuint UnpackAlign{0};
     ALuint PackAlign{0};
     ALuint UnpackAmbiOrder{1};
 
+    /* Set while the loader thread copies in the data from alBufferDataAsync.
+     * The buffer can't be modified or used until it's done.
+     */
+    bool mLoadPending{false};
+
     ALbitfieldSOFT MappedAccess{0u};
     ALsizei MappedOffset{0};
     ALsizei MappedSize{0};
@@ -41,6 +83,12 @@ struct ALbuffer : public BufferStorage {
     ALuint mLoopStart{0u};
     ALuint mLoopEnd{0u};
 
+    /* Read and write positions for ring buffer storage. */
+    BufferRing mRingState;
+
+    /* Set for a callback buffer filled by the device's prefetch thread. */
+    std::shared_ptr<CallbackPrefetch> mPrefetch;
+
     /* Number of times buffer was attached to a source (deletion can only occur when 0) */
     RefCount ref{0u};
 
@@ -55,4 +103,14 @@ struct ALbuffer : public BufferStorage {
 #endif // ALSOFT_EAX
 };
 
+/* Allocates storage so count buffers can be generated without allocating. */
+bool ReserveBuffers(ALCdevice *device, size_t count);
+
+/**
+ * Waits for an asynchronous load into the buffer to finish. The given lock
+ * must hold the device's buffer lock.
+ */
+void WaitForBufferLoad(ALCdevice *device, std::unique_lock<std::mutex> &buflock,
+    const ALbuffer *buffer);
+
 #endif
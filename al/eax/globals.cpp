@@ -4,6 +4,7 @@
 
 
 bool eax_g_is_enabled = true;
+bool eax_g_batch_commits = false;
 
 
 const char eax1_ext_name[] = "EAX";
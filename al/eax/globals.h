@@ -3,6 +3,7 @@
 
 
 extern bool eax_g_is_enabled;
+extern bool eax_g_batch_commits;
 
 
 extern const char eax1_ext_name[];
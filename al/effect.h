@@ -30,6 +30,10 @@ enum {
 extern bool DisabledEffects[MAX_EFFECTS];
 
 extern float ReverbBoost;
+extern bool ReverbLite;
+extern unsigned int ReverbLateDivisor;
+extern bool ConvolutionTailThread;
+extern bool PshifterFast;
 
 struct EffectList {
     const char name[16];
@@ -25,6 +25,7 @@
 #include <windows.h>
 #endif
 
+#include <array>
 #include <atomic>
 #include <csignal>
 #include <cstdarg>
@@ -54,30 +55,41 @@ bool TrapALError{false};
 
 void ALCcontext::setError(ALenum errorCode, const char *msg, ...)
 {
-    auto message = std::vector<char>(256);
-
-    va_list args, args2;
-    va_start(args, msg);
-    va_copy(args2, args);
-    int msglen{std::vsnprintf(message.data(), message.size(), msg, args)};
-    if(msglen >= 0 && static_cast<size_t>(msglen) >= message.size())
+    /* Only format the message when it will be logged or sent as a debug
+     * message. Some apps generate errors often (e.g. probing for features
+     * with invalid enums), which otherwise just need the code recorded.
+     */
+    const bool debugenabled{mDebugEnabled.load(std::memory_order_relaxed)};
+    std::vector<char> dynmsg;
+    std::array<char,256> stcmsg;
+    int msglen{0};
+    if(debugenabled || IsLogLevelEnabled(LogLevel::Warning)) UNLIKELY
     {
-        message.resize(static_cast<size_t>(msglen) + 1u);
-        msglen = std::vsnprintf(message.data(), message.size(), msg, args2);
-    }
-    va_end(args2);
-    va_end(args);
+        va_list args, args2;
+        va_start(args, msg);
+        va_copy(args2, args);
+        char *str{stcmsg.data()};
+        msglen = std::vsnprintf(stcmsg.data(), stcmsg.size(), msg, args);
+        if(msglen >= 0 && static_cast<size_t>(msglen) >= stcmsg.size())
+        {
+            dynmsg.resize(static_cast<size_t>(msglen) + 1u);
+            str = dynmsg.data();
+            msglen = std::vsnprintf(dynmsg.data(), dynmsg.size(), msg, args2);
+        }
+        va_end(args2);
+        va_end(args);
 
-    if(msglen >= 0)
-        msg = message.data();
-    else
-    {
-        msg = "<internal error constructing message>";
-        msglen = static_cast<int>(strlen(msg));
-    }
+        if(msglen >= 0)
+            msg = str;
+        else
+        {
+            msg = "<internal error constructing message>";
+            msglen = static_cast<int>(strlen(msg));
+        }
 
-    WARN("Error generated on context %p, code 0x%04x, \"%s\"\n",
-        decltype(std::declval<void*>()){this}, errorCode, msg);
+        WARN("Error generated on context %p, code 0x%04x, \"%s\"\n",
+            decltype(std::declval<void*>()){this}, errorCode, msg);
+    }
     if(TrapALError)
     {
 #ifdef _WIN32
@@ -92,8 +104,9 @@ void ALCcontext::setError(ALenum errorCode, const char *msg, ...)
     ALenum curerr{AL_NO_ERROR};
     mLastError.compare_exchange_strong(curerr, errorCode);
 
-    debugMessage(DebugSource::API, DebugType::Error, 0, DebugSeverity::High,
-        {msg, static_cast<uint>(msglen)});
+    if(debugenabled) UNLIKELY
+        debugMessage(DebugSource::API, DebugType::Error, 0, DebugSeverity::High,
+            {msg, static_cast<uint>(msglen)});
 }
 
 /* Special-case alGetError since it (potentially) raises a debug signal and
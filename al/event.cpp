@@ -4,7 +4,9 @@
 #include "event.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <cstring>
 #include <exception>
 #include <memory>
@@ -19,11 +21,13 @@
 #include "AL/alc.h"
 
 #include "alc/context.h"
+#include "alc/device.h"
 #include "alc/effects/base.h"
 #include "alc/inprogext.h"
 #include "almalloc.h"
 #include "core/async_event.h"
 #include "core/except.h"
+#include "core/helpers.h"
 #include "core/logging.h"
 #include "core/voice_change.h"
 #include "debug.h"
@@ -31,6 +35,9 @@
 #include "opthelpers.h"
 #include "ringbuffer.h"
 
+#ifdef ALSOFT_EAX
+#include "al/eax/utils.h"
+#endif // ALSOFT_EAX
 
 namespace {
 
@@ -40,73 +47,167 @@ struct overloaded : Ts... { using Ts::operator()...; };
 template<typename... Ts>
 overloaded(Ts...) -> overloaded<Ts...>;
 
+/* Visits the event with the given handlers. For use outside of this
+ * namespace, where overloaded can be ambiguous with the EAX headers' own.
+ */
+template<typename... Ts>
+void VisitEvent(AsyncEvent &event, Ts&&... handlers)
+{ std::visit(overloaded{std::forward<Ts>(handlers)...}, event); }
+
+constexpr ALuint GetSourceStateEnum(AsyncSrcState state) noexcept
+{
+    switch(state)
+    {
+    case AsyncSrcState::Reset: return AL_INITIAL;
+    case AsyncSrcState::Stop: return AL_STOPPED;
+    case AsyncSrcState::Play: return AL_PLAYING;
+    case AsyncSrcState::Pause: return AL_PAUSED;
+    }
+    return AL_NONE;
+}
+
+/* Removes the next event from the queue. The queue must not be empty. */
+AsyncEvent PopAsyncEvent(RingBuffer *ring)
+{
+    auto evt_data = ring->getReadVector().first;
+    auto *evt_ptr = std::launder(reinterpret_cast<AsyncEvent*>(evt_data.buf));
+    AsyncEvent event{std::move(*evt_ptr)};
+    std::destroy_at(evt_ptr);
+    ring->readAdvance(1);
+    return event;
+}
+
 int EventThread(ALCcontext *context)
 {
+    SetThreadAffinity(ThreadRole::Event);
+
+    /* Records for the batch callback, collected while handling the available
+     * events and delivered together.
+     */
+    std::array<ALeventRecordSOFT,64> records{};
+    size_t numrecords{0};
+
     RingBuffer *ring{context->mAsyncEvents.get()};
     bool quitnow{false};
     while(!quitnow)
     {
-        auto evt_data = ring->getReadVector().first;
-        if(evt_data.len == 0)
+#ifdef ALSOFT_EAX
+        /* Commit batched EAX changes once the mixer starts a new update. */
+        if(context->mBatchedUpdatesDue.exchange(false, std::memory_order_acquire)) UNLIKELY
+        {
+            try {
+                std::lock_guard<std::mutex> _{context->mPropLock};
+                context->eaxCommitBatch();
+            }
+            catch(...) {
+                eax_log_exception(__func__);
+            }
+        }
+#endif
+
+        std::vector<AsyncBufferLoadedEvent> loaded;
+        {
+            std::lock_guard<std::mutex> _{context->mBufferLoadLock};
+            loaded.swap(context->mLoadedBuffers);
+        }
+        if(loaded.empty() && ring->readSpace() == 0)
         {
             context->mEventSem.wait();
             continue;
         }
 
         std::lock_guard<std::mutex> _{context->mEventCbLock};
-        do {
-            auto *evt_ptr = std::launder(reinterpret_cast<AsyncEvent*>(evt_data.buf));
-            evt_data.buf += sizeof(AsyncEvent);
-            evt_data.len -= 1;
+        auto flush_records = [context,&records,&numrecords]()
+        {
+            if(numrecords > 0 && context->mEventBatchCb)
+                context->mEventBatchCb(static_cast<ALsizei>(numrecords), records.data(),
+                    context->mEventBatchParam);
+            numrecords = 0;
+        };
+        auto add_record = [context,&records,&numrecords,&flush_records](ALenum type,
+            ALuint object, ALuint param, std::chrono::nanoseconds time)
+        {
+            if(!context->mEventBatchCb)
+                return;
+            records[numrecords++] = ALeventRecordSOFT{time.count(), type, object, param, 0};
+            if(numrecords == records.size())
+                flush_records();
+        };
+
+        auto enabledevts = context->mEnabledEvts.load(std::memory_order_acquire);
+        if(enabledevts.test(al::to_underlying(AsyncEnableBits::BufferLoaded)))
+        {
+            for(const AsyncBufferLoadedEvent &evt : loaded)
+            {
+                const ALuint success{evt.mSuccess ? ALuint{AL_TRUE} : ALuint{AL_FALSE}};
+                add_record(AL_EVENT_TYPE_BUFFER_LOADED_SOFT, evt.mId, success, evt.mTime);
+
+                if(!context->mEventCb)
+                    continue;
+
+                std::string msg{"Buffer ID " + std::to_string(evt.mId)};
+                msg += evt.mSuccess ? " finished loading" : " failed to load";
+                context->mEventCb(AL_EVENT_TYPE_BUFFER_LOADED_SOFT, evt.mId, success,
+                    static_cast<ALsizei>(msg.length()), msg.c_str(), context->mEventParam);
+            }
+        }
 
-            AsyncEvent event{std::move(*evt_ptr)};
-            std::destroy_at(evt_ptr);
-            ring->readAdvance(1);
+        while(ring->readSpace() != 0)
+        {
+            AsyncEvent event{PopAsyncEvent(ring)};
 
             quitnow = std::holds_alternative<AsyncKillThread>(event);
             if(quitnow) UNLIKELY break;
 
-            auto enabledevts = context->mEnabledEvts.load(std::memory_order_acquire);
+            enabledevts = context->mEnabledEvts.load(std::memory_order_acquire);
             auto proc_killthread = [](AsyncKillThread&) { };
-            auto proc_release = [](AsyncEffectReleaseEvent &evt)
+            auto proc_release = [context](AsyncEffectReleaseEvent &evt)
+            { context->mALDevice->recycleEffectState(evt.mEffectState); };
+            auto proc_srcstate = [context,enabledevts,&add_record](AsyncSourceStateEvent &evt)
             {
-                al::intrusive_ptr<EffectState>{evt.mEffectState};
-            };
-            auto proc_srcstate = [context,enabledevts](AsyncSourceStateEvent &evt)
-            {
-                if(!context->mEventCb
-                    || !enabledevts.test(al::to_underlying(AsyncEnableBits::SourceState)))
+                if(!enabledevts.test(al::to_underlying(AsyncEnableBits::SourceState)))
                     return;
 
                 ALuint state{};
-                std::string msg{"Source ID " + std::to_string(evt.mId)};
-                msg += " state has changed to ";
+                const char *statename{};
                 switch(evt.mState)
                 {
                 case AsyncSrcState::Reset:
-                    msg += "AL_INITIAL";
+                    statename = "AL_INITIAL";
                     state = AL_INITIAL;
                     break;
                 case AsyncSrcState::Stop:
-                    msg += "AL_STOPPED";
+                    statename = "AL_STOPPED";
                     state = AL_STOPPED;
                     break;
                 case AsyncSrcState::Play:
-                    msg += "AL_PLAYING";
+                    statename = "AL_PLAYING";
                     state = AL_PLAYING;
                     break;
                 case AsyncSrcState::Pause:
-                    msg += "AL_PAUSED";
+                    statename = "AL_PAUSED";
                     state = AL_PAUSED;
                     break;
                 }
+                add_record(AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT, evt.mId, state, evt.mTime);
+
+                if(!context->mEventCb)
+                    return;
+
+                std::string msg{"Source ID " + std::to_string(evt.mId)};
+                msg += " state has changed to ";
+                msg += statename;
                 context->mEventCb(AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT, evt.mId, state,
                     static_cast<ALsizei>(msg.length()), msg.c_str(), context->mEventParam);
             };
-            auto proc_buffercomp = [context,enabledevts](AsyncBufferCompleteEvent &evt)
+            auto proc_buffercomp = [context,enabledevts,&add_record](AsyncBufferCompleteEvent &evt)
             {
-                if(!context->mEventCb
-                    || !enabledevts.test(al::to_underlying(AsyncEnableBits::BufferCompleted)))
+                if(!enabledevts.test(al::to_underlying(AsyncEnableBits::BufferCompleted)))
+                    return;
+
+                add_record(AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT, evt.mId, evt.mCount, evt.mTime);
+
+                if(!context->mEventCb)
                     return;
 
                 std::string msg{std::to_string(evt.mCount)};
@@ -115,23 +216,46 @@ int EventThread(ALCcontext *context)
                 context->mEventCb(AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT, evt.mId, evt.mCount,
                     static_cast<ALsizei>(msg.length()), msg.c_str(), context->mEventParam);
             };
-            auto proc_disconnect = [context,enabledevts](AsyncDisconnectEvent &evt)
+            auto proc_queuelow = [context,enabledevts,&add_record](AsyncQueueLowEvent &evt)
+            {
+                if(!enabledevts.test(al::to_underlying(AsyncEnableBits::QueueLowWatermark)))
+                    return;
+
+                add_record(AL_EVENT_TYPE_QUEUE_LOW_WATERMARK_SOFT, evt.mId, evt.mRemaining,
+                    evt.mTime);
+
+                if(!context->mEventCb)
+                    return;
+
+                std::string msg{"Source ID " + std::to_string(evt.mId)};
+                msg += " queue below low watermark, ";
+                msg += std::to_string(evt.mRemaining);
+                msg += "ms remaining";
+                context->mEventCb(AL_EVENT_TYPE_QUEUE_LOW_WATERMARK_SOFT, evt.mId, evt.mRemaining,
+                    static_cast<ALsizei>(msg.length()), msg.c_str(), context->mEventParam);
+            };
+            auto proc_disconnect = [context,enabledevts,&add_record](AsyncDisconnectEvent &evt)
             {
                 const std::string_view message{evt.msg};
 
                 context->debugMessage(DebugSource::System, DebugType::Error, 0,
                     DebugSeverity::High, message);
 
-                if(context->mEventCb
-                    && enabledevts.test(al::to_underlying(AsyncEnableBits::Disconnected)))
+                if(!enabledevts.test(al::to_underlying(AsyncEnableBits::Disconnected)))
+                    return;
+
+                add_record(AL_EVENT_TYPE_DISCONNECTED_SOFT, 0, 0, evt.mTime);
+                if(context->mEventCb)
                     context->mEventCb(AL_EVENT_TYPE_DISCONNECTED_SOFT, 0, 0,
                         static_cast<ALsizei>(message.length()), message.data(),
                         context->mEventParam);
             };
 
-            std::visit(overloaded{proc_srcstate, proc_buffercomp, proc_release, proc_disconnect,
-                proc_killthread}, event);
-        } while(evt_data.len != 0);
+            std::visit(overloaded{proc_srcstate, proc_buffercomp, proc_queuelow, proc_release,
+                proc_disconnect, proc_killthread}, event);
+        }
+
+        flush_records();
     }
     return 0;
 }
@@ -155,6 +279,20 @@ void StartEventThrd(ALCcontext *ctx)
 void StopEventThrd(ALCcontext *ctx)
 {
     RingBuffer *ring{ctx->mAsyncEvents.get()};
+    if(!ctx->mEventThread.joinable())
+    {
+        /* Without an event thread, release any effect states still waiting in
+         * the queue.
+         */
+        while(ring->readSpace() > 0)
+        {
+            AsyncEvent event{PopAsyncEvent(ring)};
+            if(auto *release = std::get_if<AsyncEffectReleaseEvent>(&event))
+                ctx->mALDevice->recycleEffectState(release->mEffectState);
+        }
+        return;
+    }
+
     auto evt_data = ring->getWriteVector().first;
     if(evt_data.len == 0)
     {
@@ -189,6 +327,10 @@ FORCE_ALIGN void AL_APIENTRY alEventControlDirectSOFT(ALCcontext *context, ALsiz
                 flags.set(al::to_underlying(AsyncEnableBits::SourceState));
             else if(type == AL_EVENT_TYPE_DISCONNECTED_SOFT)
                 flags.set(al::to_underlying(AsyncEnableBits::Disconnected));
+            else if(type == AL_EVENT_TYPE_BUFFER_LOADED_SOFT)
+                flags.set(al::to_underlying(AsyncEnableBits::BufferLoaded));
+            else if(type == AL_EVENT_TYPE_QUEUE_LOW_WATERMARK_SOFT)
+                flags.set(al::to_underlying(AsyncEnableBits::QueueLowWatermark));
             else
                 return false;
             return true;
@@ -231,5 +373,97 @@ FORCE_ALIGN void AL_APIENTRY alEventCallbackDirectSOFT(ALCcontext *context,
     context->mEventParam = userParam;
 }
 
+FORCE_ALIGN void AL_APIENTRY alEventBatchCallbackDirectSOFT(ALCcontext *context,
+    ALEVENTBATCHPROCSOFT callback, void *userParam) noexcept
+{
+    std::lock_guard<std::mutex> _{context->mPropLock};
+    std::lock_guard<std::mutex> __{context->mEventCbLock};
+    context->mEventBatchCb = callback;
+    context->mEventBatchParam = userParam;
+}
+
+FORCE_ALIGN ALsizei AL_APIENTRY alPollEventsDirectSOFT(ALCcontext *context, ALsizei count,
+    ALeventRecordSOFT *events) noexcept
+{
+    if(!context->mEventPolling) UNLIKELY
+    {
+        context->setError(AL_INVALID_OPERATION, "Event polling not enabled for the context");
+        return 0;
+    }
+    if(count < 0) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Polling %d events", count);
+    if(count <= 0) UNLIKELY return 0;
+    if(!events) UNLIKELY
+    {
+        context->setError(AL_INVALID_VALUE, "NULL pointer");
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> _{context->mEventCbLock};
+    ALsizei total{0};
+    {
+        std::lock_guard<std::mutex> __{context->mBufferLoadLock};
+        auto &loaded = context->mLoadedBuffers;
+        const auto enabledevts = context->mEnabledEvts.load(std::memory_order_acquire);
+        const bool enabled{enabledevts.test(al::to_underlying(AsyncEnableBits::BufferLoaded))};
+        auto evtiter = loaded.begin();
+        for(;evtiter != loaded.end() && total < count;++evtiter)
+        {
+            if(enabled)
+                events[total++] = ALeventRecordSOFT{evtiter->mTime.count(),
+                    AL_EVENT_TYPE_BUFFER_LOADED_SOFT, evtiter->mId,
+                    evtiter->mSuccess ? ALuint{AL_TRUE} : ALuint{AL_FALSE}, 0};
+        }
+        loaded.erase(loaded.begin(), evtiter);
+    }
+
+    RingBuffer *ring{context->mAsyncEvents.get()};
+    while(total < count && ring->readSpace() > 0)
+    {
+        AsyncEvent event{PopAsyncEvent(ring)};
+
+        auto enabledevts = context->mEnabledEvts.load(std::memory_order_acquire);
+        auto add_record = [events,&total](ALenum type, ALuint object, ALuint param,
+            std::chrono::nanoseconds time)
+        { events[total++] = ALeventRecordSOFT{time.count(), type, object, param, 0}; };
+
+        auto proc_killthread = [](AsyncKillThread&) { };
+        auto proc_release = [context](AsyncEffectReleaseEvent &evt)
+        { context->mALDevice->recycleEffectState(evt.mEffectState); };
+        auto proc_srcstate = [enabledevts,&add_record](AsyncSourceStateEvent &evt)
+        {
+            if(enabledevts.test(al::to_underlying(AsyncEnableBits::SourceState)))
+                add_record(AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT, evt.mId,
+                    GetSourceStateEnum(evt.mState), evt.mTime);
+        };
+        auto proc_buffercomp = [enabledevts,&add_record](AsyncBufferCompleteEvent &evt)
+        {
+            if(enabledevts.test(al::to_underlying(AsyncEnableBits::BufferCompleted)))
+                add_record(AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT, evt.mId, evt.mCount,
+                    evt.mTime);
+        };
+        auto proc_queuelow = [enabledevts,&add_record](AsyncQueueLowEvent &evt)
+        {
+            if(enabledevts.test(al::to_underlying(AsyncEnableBits::QueueLowWatermark)))
+                add_record(AL_EVENT_TYPE_QUEUE_LOW_WATERMARK_SOFT, evt.mId, evt.mRemaining,
+                    evt.mTime);
+        };
+        auto proc_disconnect = [context,enabledevts,&add_record](AsyncDisconnectEvent &evt)
+        {
+            context->debugMessage(DebugSource::System, DebugType::Error, 0,
+                DebugSeverity::High, std::string_view{evt.msg});
+
+            if(enabledevts.test(al::to_underlying(AsyncEnableBits::Disconnected)))
+                add_record(AL_EVENT_TYPE_DISCONNECTED_SOFT, 0, 0, evt.mTime);
+        };
+
+        VisitEvent(event, proc_srcstate, proc_buffercomp, proc_queuelow, proc_release,
+            proc_disconnect, proc_killthread);
+    }
+    return total;
+}
+
 AL_API DECL_FUNCEXT3(void, alEventControl,SOFT, ALsizei, const ALenum*, ALboolean)
 AL_API DECL_FUNCEXT2(void, alEventCallback,SOFT, ALEVENTPROCSOFT, void*)
+AL_API DECL_FUNCEXT2(void, alEventBatchCallback,SOFT, ALEVENTBATCHPROCSOFT, void*)
+AL_API DECL_FUNCEXT2(ALsizei, alPollEvents,SOFT, ALsizei, ALeventRecordSOFT*)
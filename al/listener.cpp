@@ -22,6 +22,7 @@
 
 #include "listener.h"
 
+#include <algorithm>
 #include <cmath>
 #include <mutex>
 
@@ -167,11 +168,19 @@ FORCE_ALIGN void AL_APIENTRY alListenerfvDirect(ALCcontext *context, ALenum para
 }
 
 
-FORCE_ALIGN void AL_APIENTRY alListeneriDirect(ALCcontext *context, ALenum param, ALint /*value*/) noexcept
+FORCE_ALIGN void AL_APIENTRY alListeneriDirect(ALCcontext *context, ALenum param, ALint value) noexcept
 {
+    ALlistener &listener = context->mListener;
     std::lock_guard<std::mutex> _{context->mPropLock};
     switch(param)
     {
+    case AL_NUM_LISTENERS_SOFT:
+        if(!(value >= 1 && static_cast<ALuint>(value) <= MaxListeners))
+            return context->setError(AL_INVALID_VALUE, "Listener count %d out of range", value);
+        listener.mNumListeners = static_cast<ALuint>(value);
+        CommitAndUpdateProps(context);
+        break;
+
     default:
         context->setError(AL_INVALID_ENUM, "Invalid listener integer property");
     }
@@ -205,6 +214,10 @@ FORCE_ALIGN void AL_APIENTRY alListenerivDirect(ALCcontext *context, ALenum para
 
     switch(param)
     {
+    case AL_NUM_LISTENERS_SOFT:
+        alListeneriDirect(context, param, values[0]);
+        return;
+
     case AL_POSITION:
     case AL_VELOCITY:
         alListener3fDirect(context, param, static_cast<ALfloat>(values[0]),
@@ -321,11 +334,16 @@ FORCE_ALIGN void AL_APIENTRY alGetListenerfvDirect(ALCcontext *context, ALenum p
 
 FORCE_ALIGN void AL_APIENTRY alGetListeneriDirect(ALCcontext *context, ALenum param, ALint *value) noexcept
 {
+    ALlistener &listener = context->mListener;
     std::lock_guard<std::mutex> _{context->mPropLock};
     if(!value)
         context->setError(AL_INVALID_VALUE, "NULL pointer");
     else switch(param)
     {
+    case AL_NUM_LISTENERS_SOFT:
+        *value = static_cast<ALint>(listener.mNumListeners);
+        break;
+
     default:
         context->setError(AL_INVALID_ENUM, "Invalid listener integer property");
     }
@@ -362,6 +380,10 @@ FORCE_ALIGN void AL_APIENTRY alGetListenerivDirect(ALCcontext *context, ALenum p
 {
     switch(param)
     {
+    case AL_NUM_LISTENERS_SOFT:
+        alGetListeneriDirect(context, param, values);
+        return;
+
     case AL_POSITION:
     case AL_VELOCITY:
         alGetListener3iDirect(context, param, values+0, values+1, values+2);
@@ -389,6 +411,86 @@ FORCE_ALIGN void AL_APIENTRY alGetListenerivDirect(ALCcontext *context, ALenum p
     }
 }
 
+
+FORCE_ALIGN void AL_APIENTRY alListenerIndexedfvDirectSOFT(ALCcontext *context, ALuint index,
+    ALenum param, const ALfloat *values) noexcept
+{
+    /* The main listener is index 0. */
+    if(index == 0)
+        return alListenerfvDirect(context, param, values);
+
+    if(index >= MaxListeners) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "Invalid listener index %u", index);
+    if(!values) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "NULL pointer");
+
+    ALlistener::Placement &listener = context->mListener.mExtra[index-1];
+    std::lock_guard<std::mutex> _{context->mPropLock};
+    switch(param)
+    {
+    case AL_POSITION:
+        if(!(std::isfinite(values[0]) && std::isfinite(values[1]) && std::isfinite(values[2])))
+            return context->setError(AL_INVALID_VALUE, "Listener position out of range");
+        std::copy_n(values, 3, listener.Position.begin());
+        CommitAndUpdateProps(context);
+        break;
+
+    case AL_VELOCITY:
+        if(!(std::isfinite(values[0]) && std::isfinite(values[1]) && std::isfinite(values[2])))
+            return context->setError(AL_INVALID_VALUE, "Listener velocity out of range");
+        std::copy_n(values, 3, listener.Velocity.begin());
+        CommitAndUpdateProps(context);
+        break;
+
+    case AL_ORIENTATION:
+        if(!(std::isfinite(values[0]) && std::isfinite(values[1]) && std::isfinite(values[2]) &&
+             std::isfinite(values[3]) && std::isfinite(values[4]) && std::isfinite(values[5])))
+            return context->setError(AL_INVALID_VALUE, "Listener orientation out of range");
+        /* AT then UP */
+        std::copy_n(values, 3, listener.OrientAt.begin());
+        std::copy_n(values+3, 3, listener.OrientUp.begin());
+        CommitAndUpdateProps(context);
+        break;
+
+    default:
+        context->setError(AL_INVALID_ENUM, "Invalid indexed listener float-vector property");
+    }
+}
+
+FORCE_ALIGN void AL_APIENTRY alGetListenerIndexedfvDirectSOFT(ALCcontext *context, ALuint index,
+    ALenum param, ALfloat *values) noexcept
+{
+    if(index == 0)
+        return alGetListenerfvDirect(context, param, values);
+
+    if(index >= MaxListeners) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "Invalid listener index %u", index);
+
+    const ALlistener::Placement &listener = context->mListener.mExtra[index-1];
+    std::lock_guard<std::mutex> _{context->mPropLock};
+    if(!values)
+        context->setError(AL_INVALID_VALUE, "NULL pointer");
+    else switch(param)
+    {
+    case AL_POSITION:
+        std::copy_n(listener.Position.cbegin(), 3, values);
+        break;
+
+    case AL_VELOCITY:
+        std::copy_n(listener.Velocity.cbegin(), 3, values);
+        break;
+
+    case AL_ORIENTATION:
+        // AT then UP
+        std::copy_n(listener.OrientAt.cbegin(), 3, values);
+        std::copy_n(listener.OrientUp.cbegin(), 3, values+3);
+        break;
+
+    default:
+        context->setError(AL_INVALID_ENUM, "Invalid indexed listener float-vector property");
+    }
+}
+
 AL_API DECL_FUNC2(void, alListenerf, ALenum, ALfloat)
 AL_API DECL_FUNC4(void, alListener3f, ALenum, ALfloat, ALfloat, ALfloat)
 AL_API DECL_FUNC2(void, alListenerfv, ALenum, const ALfloat*)
@@ -401,3 +503,6 @@ AL_API DECL_FUNC2(void, alGetListenerfv, ALenum, ALfloat*)
 AL_API DECL_FUNC2(void, alGetListeneri, ALenum, ALint*)
 AL_API DECL_FUNC4(void, alGetListener3i, ALenum, ALint*, ALint*, ALint*)
 AL_API DECL_FUNC2(void, alGetListeneriv, ALenum, ALint*)
+
+FORCE_ALIGN DECL_FUNCEXT3(void, alListenerIndexedfv,SOFT, ALuint, ALenum, const ALfloat*)
+FORCE_ALIGN DECL_FUNCEXT3(void, alGetListenerIndexedfv,SOFT, ALuint, ALenum, ALfloat*)
@@ -8,6 +8,7 @@
 #include "AL/efx.h"
 
 #include "almalloc.h"
+#include "core/context.h"
 
 
 struct ALlistener {
@@ -18,6 +19,18 @@ struct ALlistener {
     float Gain{1.0f};
     float mMetersPerUnit{AL_DEFAULT_METERS_PER_UNIT};
 
+    /* Placement of the additional listeners (indices 1 and up), which share
+     * the main listener's gain and scale.
+     */
+    struct Placement {
+        std::array<float,3> Position{{0.0f, 0.0f, 0.0f}};
+        std::array<float,3> Velocity{{0.0f, 0.0f, 0.0f}};
+        std::array<float,3> OrientAt{{0.0f, 0.0f, -1.0f}};
+        std::array<float,3> OrientUp{{0.0f, 1.0f, 0.0f}};
+    };
+    std::array<Placement,MaxListeners-1> mExtra{};
+    uint mNumListeners{1};
+
     DISABLE_ALLOC()
 };
 
@@ -30,6 +30,7 @@
 #include <cinttypes>
 #include <climits>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <iterator>
@@ -66,6 +67,7 @@
 #include "core/except.h"
 #include "core/filters/nfc.h"
 #include "core/filters/splitter.h"
+#include "core/helpers.h"
 #include "core/logging.h"
 #include "core/voice_change.h"
 #include "direct_defs.h"
@@ -73,6 +75,7 @@
 #include "filter.h"
 #include "opthelpers.h"
 #include "ringbuffer.h"
+#include "sourcegroup.h"
 
 #ifdef ALSOFT_EAX
 #include <cassert>
@@ -85,10 +88,44 @@ namespace {
 using namespace std::placeholders;
 using std::chrono::nanoseconds;
 
+/* Decoded ADPCM and resampled samples can be cached by the mixer when the
+ * buffer data only changes through calls that invalidate the cache. Callback,
+ * ring, caller-provided, and persistently mapped storage can change at any
+ * time, while file-backed and shared storage can't change at all.
+ */
+bool IsCacheable(const ALbuffer *buffer) noexcept
+{
+    return !buffer->mCallback && !buffer->mRing
+        && (buffer->mData.data() == buffer->mDataStorage.data() || buffer->mFileMapping
+            || buffer->mSharedData)
+        && !(buffer->Access&AL_MAP_PERSISTENT_BIT_SOFT);
+}
+
+/* Hints for the start of a file-backed buffer's samples to be paged in, from
+ * the given sample position, before the mixer gets to them. About a second is
+ * prefetched, leaving the rest to the system's read-ahead.
+ */
+void PrefetchBufferData(const ALbuffer *buffer, const int pos) noexcept
+{
+    if(!buffer || !buffer->mFileMapping)
+        return;
+
+    const size_t blockSize{buffer->blockSizeFromFmt()};
+    const size_t startBlock{static_cast<uint>(std::max(pos, 0)) / buffer->mBlockAlign};
+    const size_t numBlocks{buffer->mSampleRate/buffer->mBlockAlign + 1};
+    const size_t offset{std::min(startBlock*blockSize, buffer->mData.size())};
+    const size_t length{std::min(numBlocks*blockSize, buffer->mData.size()-offset)};
+    PrefetchMappedFile({reinterpret_cast<const char*>(buffer->mData.data()+offset), length});
+}
+
 Voice *GetSourceVoice(ALsource *source, ALCcontext *context)
 {
-    auto voicelist = context->getVoicesSpan();
-    ALuint idx{source->VoiceIdx};
+    /* This may be called without the source lock, so check against the whole
+     * voice array rather than the active count, which may be updated out of
+     * sync with a new array.
+     */
+    auto &voicelist = *context->mVoices.load(std::memory_order_acquire);
+    ALuint idx{source->VoiceIdx.load(std::memory_order_relaxed)};
     if(idx < voicelist.size())
     {
         ALuint sid{source->id};
@@ -96,25 +133,25 @@ Voice *GetSourceVoice(ALsource *source, ALCcontext *context)
         if(voice->mSourceID.load(std::memory_order_acquire) == sid)
             return voice;
     }
-    source->VoiceIdx = INVALID_VOICE_IDX;
+    /* Don't reset the index if it was just set for a new voice. */
+    source->VoiceIdx.compare_exchange_strong(idx, INVALID_VOICE_IDX, std::memory_order_relaxed);
     return nullptr;
 }
 
 
+/* Sources may be updated from multiple threads at once, so taking property
+ * containers from the pool needs to be serialized to avoid ABA problems. The
+ * mixer only returns them to the pool, which is safe to do concurrently.
+ */
+VoicePropsItem *GetVoicePropsItem(ALCcontext *context)
+{
+    std::lock_guard<std::mutex> _{context->mVoicePropsLock};
+    return context->mVoicePropsPool.get();
+}
+
 void UpdateSourceProps(const ALsource *source, Voice *voice, ALCcontext *context)
 {
-    /* Get an unused property container, or allocate a new one as needed. */
-    VoicePropsItem *props{context->mFreeVoiceProps.load(std::memory_order_acquire)};
-    if(!props)
-    {
-        context->allocVoiceProps();
-        props = context->mFreeVoiceProps.load(std::memory_order_acquire);
-    }
-    VoicePropsItem *next;
-    do {
-        next = props->next.load(std::memory_order_relaxed);
-    } while(context->mFreeVoiceProps.compare_exchange_weak(props, next,
-        std::memory_order_acq_rel, std::memory_order_acquire) == false);
+    VoicePropsItem *props{GetVoicePropsItem(context)};
 
     props->Pitch = source->Pitch;
     props->Gain = source->Gain;
@@ -140,6 +177,8 @@ void UpdateSourceProps(const ALsource *source, Voice *voice, ALCcontext *context
     props->mResampler = source->mResampler;
     props->DirectChannels = source->DirectChannels;
     props->mSpatializeMode = source->mSpatialize;
+    props->Priority = source->mPriority;
+    props->Group = source->mGroup ? source->mGroup->mGroup : nullptr;
 
     props->DryGainHFAuto = source->DryGainHFAuto;
     props->WetGainAuto = source->WetGainAuto;
@@ -176,6 +215,8 @@ void UpdateSourceProps(const ALsource *source, Voice *voice, ALCcontext *context
     if(!props->Send[0].Slot && context->mDefaultSlot)
         props->Send[0].Slot = context->mDefaultSlot->mSlot;
 
+    props->Ramps = source->mRamps;
+
     /* Set the new container for updating internal parameters. */
     props = voice->mUpdate.exchange(props, std::memory_order_acq_rel);
     if(props)
@@ -183,8 +224,32 @@ void UpdateSourceProps(const ALsource *source, Voice *voice, ALCcontext *context
         /* If there was an unused update container, put it back in the
          * freelist.
          */
-        AtomicReplaceHead(context->mFreeVoiceProps, props);
+        context->mVoicePropsPool.put(props);
+    }
+}
+
+/** Gets the first buffer in the queue, which sets the queue's format. */
+const ALbuffer *GetQueueFormat(const BufferQueue &queue) noexcept
+{
+    for(const auto &item : queue)
+    {
+        if(item.mBuffer)
+            return item.mBuffer;
     }
+    return nullptr;
+}
+
+/**
+ * Gets the offset of the given queue item from the start of the queue, in
+ * samples. A null item gives the length of the whole queue.
+ */
+uint64_t GetQueueOffset(const BufferQueue &queue, const VoiceBufferItem *item) noexcept
+{
+    if(queue.empty())
+        return 0;
+    if(!item)
+        return queue.back().mStart + queue.back().mSampleLen - queue.front().mStart;
+    return static_cast<const ALbufferQueueItem*>(item)->mStart - queue.front().mStart;
 }
 
 /* GetSourceSampleOffset
@@ -218,11 +283,7 @@ int64_t GetSourceSampleOffset(ALsource *Source, ALCcontext *context, nanoseconds
     if(!voice)
         return 0;
 
-    for(auto &item : Source->mQueue)
-    {
-        if(&item == Current) break;
-        readPos += int64_t{item.mSampleLen} << MixerFracBits;
-    }
+    readPos += static_cast<int64_t>(GetQueueOffset(Source->mQueue, Current)) << MixerFracBits;
     if(readPos > std::numeric_limits<int64_t>::max() >> (32-MixerFracBits))
         return std::numeric_limits<int64_t>::max();
     return readPos << (32-MixerFracBits);
@@ -258,19 +319,8 @@ double GetSourceSecOffset(ALsource *Source, ALCcontext *context, nanoseconds *cl
     if(!voice)
         return 0.0f;
 
-    const ALbuffer *BufferFmt{nullptr};
-    auto BufferList = Source->mQueue.cbegin();
-    while(BufferList != Source->mQueue.cend() && al::to_address(BufferList) != Current)
-    {
-        if(!BufferFmt) BufferFmt = BufferList->mBuffer;
-        readPos += int64_t{BufferList->mSampleLen} << MixerFracBits;
-        ++BufferList;
-    }
-    while(BufferList != Source->mQueue.cend() && !BufferFmt)
-    {
-        BufferFmt = BufferList->mBuffer;
-        ++BufferList;
-    }
+    readPos += static_cast<int64_t>(GetQueueOffset(Source->mQueue, Current)) << MixerFracBits;
+    const ALbuffer *BufferFmt{GetQueueFormat(Source->mQueue)};
     ASSUME(BufferFmt != nullptr);
 
     return static_cast<double>(readPos) / double{MixerFracOne} / BufferFmt->mSampleRate;
@@ -285,42 +335,34 @@ double GetSourceSecOffset(ALsource *Source, ALCcontext *context, nanoseconds *cl
 template<typename T>
 T GetSourceOffset(ALsource *Source, ALenum name, ALCcontext *context)
 {
-    ALCdevice *device{context->mALDevice.get()};
+    Voice *voice{GetSourceVoice(Source, context)};
+    if(!voice)
+        return T{0};
+
+    /* Without a clock time to go with it, only the voice's own position needs
+     * to be consistent, which doesn't need to wait for the mixer to finish.
+     */
     const VoiceBufferItem *Current{};
     int64_t readPos{};
     uint readPosFrac{};
     uint refcount;
-    Voice *voice;
-
     do {
-        refcount = device->waitForMix();
-        voice = GetSourceVoice(Source, context);
-        if(voice)
-        {
-            Current = voice->mCurrentBuffer.load(std::memory_order_relaxed);
-
-            readPos = voice->mPosition.load(std::memory_order_relaxed);
-            readPosFrac = voice->mPositionFrac.load(std::memory_order_relaxed);
+        while((refcount=voice->mPositionCount.load(std::memory_order_acquire))&1) {
         }
+        Current = voice->mCurrentBuffer.load(std::memory_order_relaxed);
+        readPos = voice->mPosition.load(std::memory_order_relaxed);
+        readPosFrac = voice->mPositionFrac.load(std::memory_order_relaxed);
         std::atomic_thread_fence(std::memory_order_acquire);
-    } while(refcount != device->MixCount.load(std::memory_order_relaxed));
+    } while(refcount != voice->mPositionCount.load(std::memory_order_relaxed));
 
-    if(!voice)
+    /* A stopped voice has no current buffer, and may have been stopped by
+     * the mixer after finding it.
+     */
+    if(!Current)
         return T{0};
 
-    const ALbuffer *BufferFmt{nullptr};
-    auto BufferList = Source->mQueue.cbegin();
-    while(BufferList != Source->mQueue.cend() && al::to_address(BufferList) != Current)
-    {
-        if(!BufferFmt) BufferFmt = BufferList->mBuffer;
-        readPos += BufferList->mSampleLen;
-        ++BufferList;
-    }
-    while(BufferList != Source->mQueue.cend() && !BufferFmt)
-    {
-        BufferFmt = BufferList->mBuffer;
-        ++BufferList;
-    }
+    readPos += static_cast<int64_t>(GetQueueOffset(Source->mQueue, Current));
+    const ALbuffer *BufferFmt{GetQueueFormat(Source->mQueue)};
     ASSUME(BufferFmt != nullptr);
 
     T offset{};
@@ -378,17 +420,11 @@ T GetSourceOffset(ALsource *Source, ALenum name, ALCcontext *context)
 template<typename T>
 T GetSourceLength(const ALsource *source, ALenum name)
 {
-    uint64_t length{0};
-    const ALbuffer *BufferFmt{nullptr};
-    for(auto &listitem : source->mQueue)
-    {
-        if(!BufferFmt)
-            BufferFmt = listitem.mBuffer;
-        length += listitem.mSampleLen;
-    }
+    uint64_t length{GetQueueOffset(source->mQueue, nullptr)};
     if(length == 0)
         return T{0};
 
+    const ALbuffer *BufferFmt{GetQueueFormat(source->mQueue)};
     ASSUME(BufferFmt != nullptr);
     switch(name)
     {
@@ -437,16 +473,11 @@ struct VoicePos {
  * using the givem offset type and offset. If the offset is out of range,
  * returns an empty optional.
  */
-std::optional<VoicePos> GetSampleOffset(al::deque<ALbufferQueueItem> &BufferList,
+std::optional<VoicePos> GetSampleOffset(BufferQueue &BufferList,
     ALenum OffsetType, double Offset)
 {
     /* Find the first valid Buffer in the Queue */
-    const ALbuffer *BufferFmt{nullptr};
-    for(auto &item : BufferList)
-    {
-        BufferFmt = item.mBuffer;
-        if(BufferFmt) break;
-    }
+    const ALbuffer *BufferFmt{GetQueueFormat(BufferList)};
     if(!BufferFmt) UNLIKELY
         return std::nullopt;
 
@@ -498,38 +529,57 @@ std::optional<VoicePos> GetSampleOffset(al::deque<ALbufferQueueItem> &BufferList
         return VoicePos{static_cast<int>(offset), frac, &BufferList.front()};
     }
 
-    if(BufferFmt->mCallback)
+    if(BufferFmt->mCallback || BufferFmt->mRing)
         return std::nullopt;
 
-    int64_t totalBufferLen{0};
-    for(auto &item : BufferList)
-    {
-        if(totalBufferLen > offset)
-            break;
-        if(item.mSampleLen > offset-totalBufferLen)
-        {
-            /* Offset is in this buffer */
-            return VoicePos{static_cast<int>(offset-totalBufferLen), frac, &item};
-        }
-        totalBufferLen += item.mSampleLen;
-    }
+    /* Find the last item starting at or before the offset, which holds it if
+     * it's not past the end of the queue.
+     */
+    const uint64_t target{BufferList.front().mStart + static_cast<uint64_t>(offset)};
+    auto iter = std::upper_bound(BufferList.begin(), BufferList.end(), target,
+        [](const uint64_t value, const ALbufferQueueItem &item) noexcept
+        { return value < item.mStart; });
+    ALbufferQueueItem &item = *(--iter);
+    if(item.mSampleLen > target-item.mStart)
+        return VoicePos{static_cast<int>(target-item.mStart), frac, &item};
 
     /* Offset is out of range of the queue */
     return std::nullopt;
 }
 
 
+/* Gets the channel format a voice plays the source's buffer with. */
+inline FmtChannels GetVoiceChannels(const ALsource *source, const ALbuffer *buffer) noexcept
+{
+    return (buffer->mChannels == FmtStereo && source->mStereoMode == SourceStereo::Enhanced) ?
+        FmtSuperStereo : buffer->mChannels;
+}
+
 void InitVoice(Voice *voice, ALsource *source, ALbufferQueueItem *BufferList, ALCcontext *context,
     ALCdevice *device)
 {
     voice->mLoopBuffer.store(source->Looping ? &source->mQueue.front() : nullptr,
         std::memory_order_relaxed);
+    voice->mBufferSerial.store(voice->mCurrentBuffer.load(std::memory_order_relaxed)->mSerial,
+        std::memory_order_relaxed);
+    voice->mLowWatermark.store(source->mLowWatermark, std::memory_order_relaxed);
+    voice->mLowWatermarkSent = false;
+    voice->mMixTime.store(0u, std::memory_order_relaxed);
+
+    /* A new voice starts with the source's current parameters, not partway
+     * through a ramp.
+     */
+    for(size_t i{0};i < NumRampParams;++i)
+    {
+        voice->mRamps[i].mSerial = source->mRamps[i].Serial;
+        voice->mRamps[i].mActive = false;
+    }
+    voice->mRampTargetsKnown = false;
+    voice->mHasRamps = false;
 
     ALbuffer *buffer{BufferList->mBuffer};
     voice->mFrequency = buffer->mSampleRate;
-    voice->mFmtChannels =
-        (buffer->mChannels == FmtStereo && source->mStereoMode == SourceStereo::Enhanced) ?
-        FmtSuperStereo : buffer->mChannels;
+    voice->mFmtChannels = GetVoiceChannels(source, buffer);
     voice->mFmtType = buffer->mType;
     voice->mFrameStep = buffer->channelsFromFmt();
     voice->mBytesPerBlock = buffer->blockSizeFromFmt();
@@ -538,7 +588,9 @@ void InitVoice(Voice *voice, ALsource *source, ALbufferQueueItem *BufferList, AL
     voice->mAmbiScaling = IsUHJ(voice->mFmtChannels) ? AmbiScaling::UHJ : buffer->mAmbiScaling;
     voice->mAmbiOrder = (voice->mFmtChannels == FmtSuperStereo) ? 1 : buffer->mAmbiOrder;
 
-    if(buffer->mCallback) voice->mFlags.set(VoiceIsCallback);
+    /* A prefetched callback buffer plays from the ring its callback fills. */
+    if(buffer->mRing) voice->mFlags.set(VoiceIsRing);
+    else if(buffer->mCallback) voice->mFlags.set(VoiceIsCallback);
     else if(source->SourceType == AL_STATIC) voice->mFlags.set(VoiceIsStatic);
     voice->mNumCallbackBlocks = 0;
     voice->mCallbackBlockBase = 0;
@@ -566,21 +618,32 @@ VoiceChange *GetVoiceChanger(ALCcontext *ctx)
     return vchg;
 }
 
-void SendVoiceChanges(ALCcontext *ctx, VoiceChange *tail)
+void SendVoiceChanges(ALCcontext *ctx, VoiceChange *tail, VoiceChange *last)
 {
     ALCdevice *device{ctx->mALDevice.get()};
 
-    VoiceChange *oldhead{ctx->mCurrentVoiceChange.load(std::memory_order_acquire)};
-    while(VoiceChange *next{oldhead->mNext.load(std::memory_order_relaxed)})
-        oldhead = next;
-    oldhead->mNext.store(tail, std::memory_order_release);
+    /* Claim the end of the list before linking the new changes to the old
+     * end. The mixer stops at an unlinked end, picking up the rest with the
+     * next update, so this never needs to walk the pending changes.
+     */
+    VoiceChange *oldlast{ctx->mLastVoiceChange.exchange(last, std::memory_order_acq_rel)};
+    oldlast->mNext.store(tail, std::memory_order_release);
 
+    /* The changes are picked up by the mixer at the start of its next update,
+     * so there's no need to wait on it here. The source state already
+     * reflects the pending changes, and callers that need to see the result
+     * of a mix in progress wait for it themselves.
+     */
     const bool connected{device->Connected.load(std::memory_order_acquire)};
-    device->waitForMix();
     if(!connected) UNLIKELY
     {
         if(ctx->mStopVoicesOnDisconnect.load(std::memory_order_acquire))
         {
+            /* Make sure the disconnect is finished being handled before
+             * clearing the changes.
+             */
+            device->waitForMix();
+
             /* If the device is disconnected and voices are stopped, just
              * ignore all pending changes.
              */
@@ -597,46 +660,40 @@ void SendVoiceChanges(ALCcontext *ctx, VoiceChange *tail)
 }
 
 
+/**
+ * Gets an unused voice to play a source with, from the context's free list if
+ * there are any (preferably one last used with the same channel format), or
+ * else by adding another voice to the active list (which is allocated as
+ * needed). The voice stays marked as listed so the mixer won't add it back,
+ * until the caller has initialized it and calls ReleaseVoiceClaim.
+ */
+Voice *GetFreeVoice(ALCcontext *context, const FmtChannels chans)
+{
+    if(Voice *voice{context->popFreeVoice(chans)}) LIKELY
+        return voice;
+
+    const size_t vidx{context->mActiveVoiceCount.load(std::memory_order_relaxed)};
+    if(context->mVoices.load(std::memory_order_relaxed)->size() == vidx)
+        context->allocVoices(1);
+    Voice *voice{(*context->mVoices.load(std::memory_order_relaxed))[vidx]};
+    voice->mFreeListed.store(true, std::memory_order_relaxed);
+    context->mActiveVoiceCount.fetch_add(1, std::memory_order_release);
+    return voice;
+}
+
+/**
+ * Lets the mixer put the voice back on the free list once it becomes idle.
+ * Must be called after the voice is given its source ID.
+ */
+inline void ReleaseVoiceClaim(Voice *voice)
+{ voice->mFreeListed.store(false, std::memory_order_release); }
+
+
 bool SetVoiceOffset(Voice *oldvoice, const VoicePos &vpos, ALsource *source, ALCcontext *context,
     ALCdevice *device)
 {
     /* First, get a free voice to start at the new offset. */
-    auto voicelist = context->getVoicesSpan();
-    Voice *newvoice{};
-    ALuint vidx{0};
-    for(Voice *voice : voicelist)
-    {
-        if(voice->mPlayState.load(std::memory_order_acquire) == Voice::Stopped
-            && voice->mSourceID.load(std::memory_order_relaxed) == 0u
-            && voice->mPendingChange.load(std::memory_order_relaxed) == false)
-        {
-            newvoice = voice;
-            break;
-        }
-        ++vidx;
-    }
-    if(!newvoice) UNLIKELY
-    {
-        auto &allvoices = *context->mVoices.load(std::memory_order_relaxed);
-        if(allvoices.size() == voicelist.size())
-            context->allocVoices(1);
-        context->mActiveVoiceCount.fetch_add(1, std::memory_order_release);
-        voicelist = context->getVoicesSpan();
-
-        vidx = 0;
-        for(Voice *voice : voicelist)
-        {
-            if(voice->mPlayState.load(std::memory_order_acquire) == Voice::Stopped
-                && voice->mSourceID.load(std::memory_order_relaxed) == 0u
-                && voice->mPendingChange.load(std::memory_order_relaxed) == false)
-            {
-                newvoice = voice;
-                break;
-            }
-            ++vidx;
-        }
-        ASSUME(newvoice != nullptr);
-    }
+    Voice *newvoice{GetFreeVoice(context, oldvoice->mFmtChannels)};
 
     /* Initialize the new voice and set its starting offset.
      * TODO: It might be better to have the VoiceChange processing copy the old
@@ -655,7 +712,11 @@ bool SetVoiceOffset(Voice *oldvoice, const VoicePos &vpos, ALsource *source, ALC
         || vpos.bufferitem != &source->mQueue.front())
         newvoice->mFlags.set(VoiceIsFading);
     InitVoice(newvoice, source, vpos.bufferitem, context, device);
-    source->VoiceIdx = vidx;
+    newvoice->mMixTime.store(oldvoice->mMixTime.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    ReleaseVoiceClaim(newvoice);
+    PrefetchBufferData(vpos.bufferitem->mBuffer, vpos.pos);
+    source->VoiceIdx = newvoice->mIndex;
 
     /* Set the old voice as having a pending change, and send it off with the
      * new one with a new offset voice change.
@@ -667,7 +728,12 @@ bool SetVoiceOffset(Voice *oldvoice, const VoicePos &vpos, ALsource *source, ALC
     vchg->mVoice = newvoice;
     vchg->mSourceID = source->id;
     vchg->mState = VChangeState::Restart;
-    SendVoiceChanges(context, vchg);
+    SendVoiceChanges(context, vchg, vchg);
+
+    /* Wait for any mix in progress to finish, since it may have already
+     * processed the voice changes when the old voice stops.
+     */
+    device->waitForMix();
 
     /* If the old voice still has a sourceID, it's still active and the change-
      * over will work on the next update.
@@ -708,13 +774,45 @@ inline bool IsPlayingOrPaused(ALsource *source)
  * Returns an updated source state using the matching voice's status (or lack
  * thereof).
  */
-inline ALenum GetSourceState(ALsource *source, Voice *voice)
+ALenum GetSourceState(ALsource *source, Voice *voice)
 {
     if(!voice && source->state == AL_PLAYING)
         source->state = AL_STOPPED;
     return source->state;
 }
 
+/* Like GetSourceState, but without updating the source, for queries made
+ * without the source lock.
+ */
+inline ALenum PeekSourceState(ALsource *source, Voice *voice)
+{
+    const ALenum state{source->state.load(std::memory_order_acquire)};
+    return (!voice && state == AL_PLAYING) ? AL_STOPPED : state;
+}
+
+/* Gets the number of processed buffers in the source's queue from the queue
+ * serials and the voice's current item. This doesn't need the source lock,
+ * since the voice's current item can't be unqueued, so reading the head serial
+ * first keeps the count from going negative.
+ */
+uint GetProcessedCount(ALsource *source, ALCcontext *context)
+{
+    if(!source->mCountsProcessed.load(std::memory_order_acquire)
+        || source->state.load(std::memory_order_acquire) == AL_INITIAL)
+        return 0u;
+
+    const uint head{source->mHeadSerial.load(std::memory_order_acquire)};
+    if(Voice *voice{GetSourceVoice(source, context)})
+        return voice->mBufferSerial.load(std::memory_order_acquire) - head;
+    return source->mTailSerial.load(std::memory_order_acquire) - head;
+}
+
+inline void UpdateCountsProcessed(ALsource *source)
+{
+    source->mCountsProcessed.store(!source->Looping && source->SourceType == AL_STREAMING,
+        std::memory_order_release);
+}
+
 
 bool EnsureSources(ALCcontext *context, size_t needed)
 {
@@ -723,10 +821,11 @@ bool EnsureSources(ALCcontext *context, size_t needed)
         [](size_t cur, const SourceSubList &sublist) noexcept -> size_t
         { return cur + static_cast<ALuint>(al::popcount(sublist.FreeMask)); })};
 
+    const size_t oldsize{context->mSourceList.size()};
     while(needed > count)
     {
         if(context->mSourceList.size() >= 1<<25) UNLIKELY
-            return false;
+            break;
 
         context->mSourceList.emplace_back();
         auto sublist = context->mSourceList.end() - 1;
@@ -735,11 +834,28 @@ bool EnsureSources(ALCcontext *context, size_t needed)
         if(!sublist->Sources) UNLIKELY
         {
             context->mSourceList.pop_back();
-            return false;
+            break;
         }
         count += 64;
     }
-    return true;
+
+    /* Replace the lookup table if any sublists were added, and delete the old
+     * one once it's unused.
+     */
+    if(context->mSourceList.size() != oldsize)
+    {
+        auto table = ALCcontext::SourceTable::Create(context->mSourceList.size());
+        std::transform(context->mSourceList.begin(), context->mSourceList.end(), table->begin(),
+            [](SourceSubList &sublist) noexcept { return &sublist; });
+        if(auto *oldtable = context->mSourceTable.exchange(table.release(),
+            std::memory_order_acq_rel))
+        {
+            SourceWriteGuard _{context};
+            delete oldtable;
+            context->freeRetiredVoices();
+        }
+    }
+    return needed <= count;
 }
 
 ALsource *AllocSource(ALCcontext *context)
@@ -751,17 +867,43 @@ ALsource *AllocSource(ALCcontext *context)
     auto slidx = static_cast<ALuint>(al::countr_zero(sublist->FreeMask));
     ASSUME(slidx < 64);
 
-    ALsource *source{al::construct_at(sublist->Sources + slidx)};
+    ALsource *source{al::construct_at(sublist->Sources + slidx, context->mQueuePool)};
 
     /* Add 1 to avoid source ID 0. */
     source->id = ((lidx<<6) | slidx) + 1;
 
     context->mNumSources += 1;
     sublist->FreeMask &= ~(1_u64 << slidx);
+    sublist->LiveMask.fetch_or(1_u64 << slidx, std::memory_order_release);
 
     return source;
 }
 
+/* Notes the mix that may still be using a source's buffer queue, after
+ * sending voice changes that detach its voice.
+ */
+void MarkVoiceDetached(ALCcontext *context, ALsource *source)
+{ source->mDetachMixCount = context->mALDevice->MixCount.load(std::memory_order_acquire); }
+
+/* Waits for a mix that started before the source's voice was detached, so its
+ * buffer queue can be freed or changed. Voice changes are sent without waiting
+ * on the mixer, so the mix in progress at the time may still be reading from
+ * it.
+ */
+void WaitForDetachedVoice(ALCcontext *context, ALsource *source)
+{
+    const uint detachcount{std::exchange(source->mDetachMixCount, 0u)};
+    if(!(detachcount&1))
+        return;
+
+    DeviceBase *device{context->mALDevice.get()};
+    if(device->MixCount.load(std::memory_order_acquire) == detachcount)
+        device->waitForMix();
+}
+
+/* Must be called with a SourceWriteGuard held, so the source can't be in use
+ * by other threads.
+ */
 void FreeSource(ALCcontext *context, ALsource *source)
 {
     const ALuint id{source->id - 1};
@@ -777,9 +919,17 @@ void FreeSource(ALCcontext *context, ALsource *source)
         vchg->mSourceID = source->id;
         vchg->mState = VChangeState::Stop;
 
-        SendVoiceChanges(context, vchg);
+        SendVoiceChanges(context, vchg, vchg);
+        MarkVoiceDetached(context, source);
     }
+    WaitForDetachedVoice(context, source);
 
+#ifdef ALSOFT_EAX
+    if(source->mEaxQueued)
+        context->eaxUnqueueSource(source);
+#endif
+
+    context->mSourceList[lidx].LiveMask.fetch_and(~(1_u64 << slidx), std::memory_order_relaxed);
     std::destroy_at(source);
 
     context->mSourceList[lidx].FreeMask |= 1_u64 << slidx;
@@ -787,7 +937,7 @@ void FreeSource(ALCcontext *context, ALsource *source)
 }
 
 
-inline ALsource *LookupSource(ALCcontext *context, ALuint id) noexcept
+ALsource *LookupSource(ALCcontext *context, ALuint id) noexcept
 {
     const size_t lidx{(id-1) >> 6};
     const ALuint slidx{(id-1) & 0x3f};
@@ -800,6 +950,189 @@ inline ALsource *LookupSource(ALCcontext *context, ALuint id) noexcept
     return sublist.Sources + slidx;
 }
 
+/* Looks up a source without the source lock, which must be done with a
+ * SourceReadGuard held.
+ */
+inline ALsource *LookupSourceLockFree(ALCcontext *context, ALuint id) noexcept
+{
+    const size_t lidx{(id-1) >> 6};
+    const ALuint slidx{(id-1) & 0x3f};
+
+    const ALCcontext::SourceTable *table{context->mSourceTable.load(std::memory_order_acquire)};
+    if(!table || lidx >= table->size()) UNLIKELY
+        return nullptr;
+    SourceSubList *sublist{(*table)[lidx]};
+    if(!(sublist->LiveMask.load(std::memory_order_acquire) & (1_u64 << slidx))) UNLIKELY
+        return nullptr;
+    return sublist->Sources + slidx;
+}
+
+/**
+ * Checks if it's time to look for idle voices to compact out of the active
+ * span. This is limited to once a second, and only when the span has grown.
+ */
+bool VoiceCompactionDue(ALCcontext *context)
+{
+    if(context->mActiveVoiceCount.load(std::memory_order_relaxed) <= ALCcontext::MinActiveVoices)
+        return false;
+
+    const auto now = std::chrono::steady_clock::now();
+    if(now - context->mLastVoiceCompaction < std::chrono::seconds{1})
+        return false;
+    context->mLastVoiceCompaction = now;
+    return true;
+}
+
+/**
+ * Shrinks the active voice span after a spike in the number of playing
+ * voices, so the mixer doesn't keep checking the idle ones. The voices still
+ * in use are moved to the front of a new voice array, and the span is cut
+ * down to them (plus idle voices up to the minimum). Voice clusters left with
+ * no voice in the span are freed. Must be called with the source lock and a
+ * SourceWriteGuard held.
+ */
+void CompactVoices(ALCcontext *context)
+{
+    using VoiceArray = ALCcontext::VoiceArray;
+    constexpr size_t clustersize{ALCcontext::VoiceClusterSize};
+
+    VoiceArray &oldvoices = *context->mVoices.load(std::memory_order_relaxed);
+    const size_t oldcount{context->mActiveVoiceCount.load(std::memory_order_relaxed)};
+
+    /* Only the API takes voices off the free list, and the mixer only adds to
+     * the front, so it can be walked safely with the source lock.
+     */
+    size_t numidle{0};
+    for(Voice *voice{context->mFreeVoices.load(std::memory_order_acquire)};voice;
+        voice = voice->mNextFree.load(std::memory_order_relaxed))
+        ++numidle;
+    if(oldcount - std::max(oldcount-numidle, ALCcontext::MinActiveVoices)
+        < ALCcontext::MinActiveVoices)
+        return;
+
+    /* Take the whole free list. Voices the mixer adds from here on stay in the
+     * span with the voices in use.
+     */
+    std::vector<Voice*> idle;
+    for(Voice *voice{context->mFreeVoices.exchange(nullptr, std::memory_order_acq_rel)};voice;
+        voice = voice->mNextFree.load(std::memory_order_relaxed))
+        idle.emplace_back(voice);
+    std::sort(idle.begin(), idle.end());
+    auto is_idle = [&idle](Voice *voice) -> bool
+    { return std::binary_search(idle.cbegin(), idle.cend(), voice); };
+
+    auto &clusters = context->mVoiceClusters;
+    auto cluster_of = [&clusters](Voice *voice) -> size_t
+    {
+        auto iter = std::find_if(clusters.cbegin(), clusters.cend(),
+            [voice](const ALCcontext::VoiceCluster &cluster) noexcept
+            { return voice >= cluster.get() && voice < cluster.get()+clustersize; });
+        return static_cast<size_t>(std::distance(clusters.cbegin(), iter));
+    };
+
+    /* Order the voices in use first, then idle voices from the clusters they
+     * use, then the rest, so whole clusters end up outside of the span.
+     */
+    std::vector<Voice*> ordered;
+    ordered.reserve(oldvoices.size());
+    std::vector<bool> clusterused(clusters.size(), false);
+    for(Voice *voice : al::span<Voice*>{oldvoices.data(), oldcount})
+    {
+        if(is_idle(voice)) continue;
+        ordered.emplace_back(voice);
+        clusterused[cluster_of(voice)] = true;
+    }
+    const size_t livecount{ordered.size()};
+    const size_t newcount{std::max(livecount, ALCcontext::MinActiveVoices)};
+
+    std::vector<bool> kept(idle.size(), false);
+    auto fill_idle = [&](const bool fromused)
+    {
+        for(size_t i{0};i < idle.size() && ordered.size() < newcount;++i)
+        {
+            if(kept[i] || clusterused[cluster_of(idle[i])] != fromused)
+                continue;
+            ordered.emplace_back(idle[i]);
+            kept[i] = true;
+        }
+    };
+    fill_idle(true);
+    fill_idle(false);
+    for(size_t i{livecount};i < ordered.size();++i)
+        clusterused[cluster_of(ordered[i])] = true;
+    const size_t keptidle{ordered.size()};
+
+    /* Add the remaining voices of the clusters that are staying. */
+    for(size_t i{0};i < idle.size();++i)
+    {
+        if(!kept[i] && clusterused[cluster_of(idle[i])])
+            ordered.emplace_back(idle[i]);
+    }
+    for(Voice *voice : al::span<Voice*>{oldvoices.data()+oldcount, oldvoices.end()})
+    {
+        if(clusterused[cluster_of(voice)])
+            ordered.emplace_back(voice);
+    }
+    const size_t keepsize{ordered.size()};
+
+    for(size_t i{0};i < keepsize;++i)
+    {
+        Voice *voice{ordered[i]};
+        const uint oldidx{voice->mIndex};
+        voice->mIndex = static_cast<uint>(i);
+        if(i >= livecount) continue;
+
+        if(const ALuint sid{voice->mSourceID.load(std::memory_order_relaxed)})
+        {
+            ALsource *source{LookupSource(context, sid)};
+            if(source && source->VoiceIdx.load(std::memory_order_relaxed) == oldidx)
+                source->VoiceIdx.store(voice->mIndex, std::memory_order_relaxed);
+        }
+    }
+
+    /* The mixer gets the voice array before the count, so shrinking the count
+     * first keeps it from pairing the new array with the old count. A mix
+     * still using the old array can use either count with it, and the old
+     * array is retired to be freed once the mixer is done with it.
+     */
+    ALCdevice *device{context->mALDevice.get()};
+    auto keptarray = VoiceArray::Create(keepsize);
+    std::copy_n(ordered.cbegin(), keepsize, keptarray->begin());
+    context->mActiveVoiceCount.store(newcount, std::memory_order_release);
+    context->mRetiredVoices.emplace_back(
+        context->mVoices.exchange(keptarray.release(), std::memory_order_acq_rel));
+
+    for(size_t i{livecount};i < keptidle;++i)
+    {
+        ordered[i]->mFreeListed.store(false, std::memory_order_relaxed);
+        context->pushFreeVoice(ordered[i]);
+    }
+
+    /* Free the clusters no longer in the array, after any mix still using
+     * the old span is done with them.
+     */
+    size_t numfreed{0};
+    for(size_t i{clusters.size()};i > 0;)
+    {
+        --i;
+        if(clusterused[i]) continue;
+
+        std::lock_guard<std::mutex> _{context->mVoicePropsLock};
+        for(size_t j{0};j < clustersize;++j)
+        {
+            if(VoicePropsItem *props{clusters[i][j].mUpdate.exchange(nullptr)})
+                context->mVoicePropsPool.put(props);
+        }
+        device->retireObject(clusters[i].release(),
+            [](void *ptr) noexcept { delete[] static_cast<Voice*>(ptr); });
+        clusters.erase(clusters.begin() + static_cast<ptrdiff_t>(i));
+        ++numfreed;
+    }
+
+    TRACE("Compacted voices from %zu to %zu active (%zu in use), freed %zu voices\n", oldcount,
+        newcount, livecount, numfreed*clustersize);
+}
+
 auto LookupBuffer = [](ALCdevice *device, auto id) noexcept -> ALbuffer*
 {
     const auto lidx{(id-1) >> 6};
@@ -839,6 +1172,19 @@ auto LookupEffectSlot = [](ALCcontext *context, auto id) noexcept -> ALeffectslo
     return sublist.EffectSlots + static_cast<size_t>(slidx);
 };
 
+auto LookupSourceGroup = [](ALCcontext *context, auto id) noexcept -> ALsourcegroup*
+{
+    const auto lidx{(id-1) >> 6};
+    const auto slidx{(id-1) & 0x3f};
+
+    if(lidx >= context->mSourceGroupList.size()) UNLIKELY
+        return nullptr;
+    SourceGroupSubList &sublist{context->mSourceGroupList[static_cast<size_t>(lidx)]};
+    if(sublist.FreeMask & (1_u64 << slidx)) UNLIKELY
+        return nullptr;
+    return sublist.SourceGroups + static_cast<size_t>(slidx);
+};
+
 
 auto StereoModeFromEnum = [](auto mode) noexcept -> std::optional<SourceStereo>
 {
@@ -1009,6 +1355,18 @@ enum SourceProp : ALenum {
     /* AL_SOFT_buffer_sub_data */
     srcByteRWOffsetsSOFT = AL_BYTE_RW_OFFSETS_SOFT,
     srcSampleRWOffsetsSOFT = AL_SAMPLE_RW_OFFSETS_SOFT,
+
+    /* AL_SOFT_voice_budget */
+    srcPriority = AL_SOURCE_PRIORITY_SOFT,
+
+    /* AL_SOFTX_source_groups */
+    srcSourceGroup = AL_SOURCE_GROUP_SOFT,
+
+    /* AL_SOFTX_queue_low_watermark */
+    srcQueueLowWatermark = AL_QUEUE_LOW_WATERMARK_SOFT,
+
+    /* AL_SOFTX_source_mix_time */
+    srcMixTime = AL_SOURCE_MIX_TIME_SOFT,
 };
 
 
@@ -1035,7 +1393,10 @@ constexpr ALuint IntValsByProp(ALenum prop)
     case AL_DISTANCE_MODEL:
     case AL_SOURCE_RESAMPLER_SOFT:
     case AL_SOURCE_SPATIALIZE_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
     case AL_STEREO_MODE_SOFT:
+    case AL_SOURCE_GROUP_SOFT:
+    case AL_QUEUE_LOW_WATERMARK_SOFT:
         return 1;
 
     case AL_SOURCE_RADIUS: /*AL_BYTE_RW_OFFSETS_SOFT:*/
@@ -1080,6 +1441,7 @@ constexpr ALuint IntValsByProp(ALenum prop)
     case AL_SAMPLE_OFFSET_LATENCY_SOFT:
     case AL_SAMPLE_OFFSET_CLOCK_SOFT:
     case AL_STEREO_ANGLES:
+    case AL_SOURCE_MIX_TIME_SOFT:
         break; /* i64 only */
     case AL_SEC_OFFSET_LATENCY_SOFT:
     case AL_SEC_OFFSET_CLOCK_SOFT:
@@ -1112,7 +1474,11 @@ constexpr ALuint Int64ValsByProp(ALenum prop)
     case AL_DISTANCE_MODEL:
     case AL_SOURCE_RESAMPLER_SOFT:
     case AL_SOURCE_SPATIALIZE_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
     case AL_STEREO_MODE_SOFT:
+    case AL_SOURCE_GROUP_SOFT:
+    case AL_QUEUE_LOW_WATERMARK_SOFT:
+    case AL_SOURCE_MIX_TIME_SOFT:
         return 1;
 
     case AL_SOURCE_RADIUS: /*AL_BYTE_RW_OFFSETS_SOFT:*/
@@ -1201,6 +1567,7 @@ constexpr ALuint FloatValsByProp(ALenum prop)
     case AL_SOURCE_TYPE:
     case AL_SOURCE_RESAMPLER_SOFT:
     case AL_SOURCE_SPATIALIZE_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
     case AL_BYTE_LENGTH_SOFT:
     case AL_SAMPLE_LENGTH_SOFT:
     case AL_SEC_LENGTH_SOFT:
@@ -1233,9 +1600,12 @@ constexpr ALuint FloatValsByProp(ALenum prop)
     case AL_BUFFER:
     case AL_DIRECT_FILTER:
     case AL_AUXILIARY_SEND_FILTER:
+    case AL_SOURCE_GROUP_SOFT:
+    case AL_QUEUE_LOW_WATERMARK_SOFT:
         break; /* i/i64 only */
     case AL_SAMPLE_OFFSET_LATENCY_SOFT:
     case AL_SAMPLE_OFFSET_CLOCK_SOFT:
+    case AL_SOURCE_MIX_TIME_SOFT:
         break; /* i64 only */
     }
     return 0;
@@ -1274,6 +1644,7 @@ constexpr ALuint DoubleValsByProp(ALenum prop)
     case AL_SOURCE_TYPE:
     case AL_SOURCE_RESAMPLER_SOFT:
     case AL_SOURCE_SPATIALIZE_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
     case AL_BYTE_LENGTH_SOFT:
     case AL_SAMPLE_LENGTH_SOFT:
     case AL_SEC_LENGTH_SOFT:
@@ -1304,9 +1675,12 @@ constexpr ALuint DoubleValsByProp(ALenum prop)
     case AL_BUFFER:
     case AL_DIRECT_FILTER:
     case AL_AUXILIARY_SEND_FILTER:
+    case AL_SOURCE_GROUP_SOFT:
+    case AL_QUEUE_LOW_WATERMARK_SOFT:
         break; /* i/i64 only */
     case AL_SAMPLE_OFFSET_LATENCY_SOFT:
     case AL_SAMPLE_OFFSET_CLOCK_SOFT:
+    case AL_SOURCE_MIX_TIME_SOFT:
         break; /* i64 only */
     }
     return 0;
@@ -1359,6 +1733,39 @@ inline void CommitAndUpdateSourceProps(ALsource *source, ALCcontext *context)
 { UpdateSourceProps(source, context); }
 #endif
 
+/* Stops any ramp on a parameter that's being set directly. */
+inline void CancelSourceRamp(ALsource *source, const size_t idx) noexcept
+{
+    ParamRamp &ramp = source->mRamps[idx];
+    if(ramp.Duration > 0.0f)
+    {
+        ramp.Duration = 0.0f;
+        ++ramp.Serial;
+    }
+}
+
+/* Sets a parameter's new value and has the mixer ramp to it. */
+void SetSourceRamp(ALsource *source, ALCcontext *context, const size_t idx, float &param,
+    const float value, const float seconds, const RampCurve curve)
+{
+    param = value;
+    ParamRamp &ramp = source->mRamps[idx];
+    ramp.Duration = seconds;
+    ramp.Curve = curve;
+    ++ramp.Serial;
+    UpdateSourceProps(source, context);
+}
+
+std::optional<RampCurve> RampCurveFromEnum(ALenum curve) noexcept
+{
+    switch(curve)
+    {
+    case AL_RAMP_LINEAR_SOFT: return RampCurve::Linear;
+    case AL_RAMP_EXPONENTIAL_SOFT: return RampCurve::Exponential;
+    }
+    return std::nullopt;
+}
+
 
 template<typename T>
 struct PropType { };
@@ -1423,6 +1830,7 @@ template<typename T, size_t N>
 void SetProperty(ALsource *const Source, ALCcontext *const Context, const SourceProp prop,
     const al::span<const T,N> values) try
 {
+    std::lock_guard<std::mutex> srclock{Source->mPropLock};
     auto&& [CheckSize, CheckValue] = GetCheckers(Context, prop, values);
     ALCdevice *device{Context->mALDevice.get()};
 
@@ -1447,6 +1855,7 @@ void SetProperty(ALsource *const Source, ALCcontext *const Context, const Source
     case AL_SEC_OFFSET_LATENCY_SOFT:
     case AL_SAMPLE_OFFSET_CLOCK_SOFT:
     case AL_SEC_OFFSET_CLOCK_SOFT:
+    case AL_SOURCE_MIX_TIME_SOFT:
         /* Query only */
         return Context->setError(AL_INVALID_OPERATION,
             "Setting read-only source property 0x%04x", prop);
@@ -1456,6 +1865,7 @@ void SetProperty(ALsource *const Source, ALCcontext *const Context, const Source
         CheckValue(values[0] >= T{0});
 
         Source->Pitch = static_cast<float>(values[0]);
+        CancelSourceRamp(Source, RampPitch);
         return UpdateSourceProps(Source, Context);
 
     case AL_CONE_INNER_ANGLE:
@@ -1477,6 +1887,7 @@ void SetProperty(ALsource *const Source, ALCcontext *const Context, const Source
         CheckValue(values[0] >= T{0});
 
         Source->Gain = static_cast<float>(values[0]);
+        CancelSourceRamp(Source, RampGain);
         return UpdateSourceProps(Source, Context);
 
     case AL_MAX_DISTANCE:
@@ -1568,6 +1979,7 @@ void SetProperty(ALsource *const Source, ALCcontext *const Context, const Source
             CheckValue(values[0] == AL_FALSE || values[0] == AL_TRUE);
 
             Source->Looping = values[0] != AL_FALSE;
+            UpdateCountsProcessed(Source);
             if(Voice *voice{GetSourceVoice(Source, Context)})
             {
                 if(Source->Looping)
@@ -1585,6 +1997,19 @@ void SetProperty(ALsource *const Source, ALCcontext *const Context, const Source
         }
         break;
 
+    case AL_QUEUE_LOW_WATERMARK_SOFT:
+        if constexpr(std::is_integral_v<T>)
+        {
+            CheckSize(1);
+            CheckValue(values[0] >= 0 && values[0] <= std::numeric_limits<int>::max());
+
+            Source->mLowWatermark = static_cast<uint>(values[0]);
+            if(Voice *voice{GetSourceVoice(Source, Context)})
+                voice->mLowWatermark.store(Source->mLowWatermark, std::memory_order_relaxed);
+            return;
+        }
+        break;
+
     case AL_BUFFER:
         if constexpr(std::is_integral_v<T>)
         {
@@ -1595,32 +2020,39 @@ void SetProperty(ALsource *const Source, ALCcontext *const Context, const Source
                     return Context->setError(AL_INVALID_OPERATION,
                         "Setting buffer on playing or paused source %u", Source->id);
             }
-            al::deque<ALbufferQueueItem> oldlist;
+            BufferQueue oldlist{Source->mQueue.get_allocator()};
             if(values[0])
             {
                 using UT = std::make_unsigned_t<T>;
-                std::lock_guard<std::mutex> _{device->BufferLock};
+                std::unique_lock<std::mutex> buflock{device->BufferLock};
                 ALbuffer *buffer{LookupBuffer(device, static_cast<UT>(values[0]))};
                 if(!buffer) UNLIKELY
                     return Context->setError(AL_INVALID_VALUE, "Invalid buffer ID %s",
                         std::to_string(values[0]).c_str());
+                WaitForBufferLoad(device, buflock, buffer);
                 if(buffer->MappedAccess && !(buffer->MappedAccess&AL_MAP_PERSISTENT_BIT_SOFT)) UNLIKELY
                     return Context->setError(AL_INVALID_OPERATION,
                         "Setting non-persistently mapped buffer %u", buffer->id);
                 if(buffer->mCallback && ReadRef(buffer->ref) != 0) UNLIKELY
                     return Context->setError(AL_INVALID_OPERATION,
                         "Setting already-set callback buffer %u", buffer->id);
+                if(buffer->mRing && ReadRef(buffer->ref) != 0) UNLIKELY
+                    return Context->setError(AL_INVALID_OPERATION,
+                        "Setting already-set ring buffer %u", buffer->id);
 
                 /* Add the selected buffer to a one-item queue */
-                al::deque<ALbufferQueueItem> newlist;
+                BufferQueue newlist{Source->mQueue.get_allocator()};
                 newlist.emplace_back();
                 newlist.back().mCallback = buffer->mCallback;
                 newlist.back().mUserData = buffer->mUserData;
+                newlist.back().mRing = buffer->mRing;
                 newlist.back().mBlockAlign = buffer->mBlockAlign;
                 newlist.back().mSampleLen = buffer->mSampleLen;
                 newlist.back().mLoopStart = buffer->mLoopStart;
                 newlist.back().mLoopEnd = buffer->mLoopEnd;
+                newlist.back().mPlaneSize = buffer->mPlaneSize;
                 newlist.back().mSamples = buffer->mData.data();
+                newlist.back().mCacheable = IsCacheable(buffer);
                 newlist.back().mBuffer = buffer;
                 IncrementRef(buffer->ref);
 
@@ -1635,8 +2067,14 @@ void SetProperty(ALsource *const Source, ALCcontext *const Context, const Source
                 Source->SourceType = AL_UNDETERMINED;
                 Source->mQueue.swap(oldlist);
             }
+            UpdateCountsProcessed(Source);
+            Source->mHeadSerial.store(Source->mTailSerial.load(std::memory_order_relaxed),
+                std::memory_order_release);
 
-            /* Delete all elements in the previous queue */
+            /* Delete all elements in the previous queue, once the mixer can't
+             * be using them.
+             */
+            WaitForDetachedVoice(Context, Source);
             for(auto &item : oldlist)
             {
                 if(ALbuffer *buffer{item.mBuffer})
@@ -1797,6 +2235,8 @@ void SetProperty(ALsource *const Source, ALCcontext *const Context, const Source
                 Source->Direct.GainLF = 1.0f;
                 Source->Direct.LFReference = HIGHPASSFREQREF;
             }
+            CancelSourceRamp(Source, RampDirectGain);
+            CancelSourceRamp(Source, RampDirectGainHF);
             return UpdateSourceProps(Source, Context);
         }
         break;
@@ -1875,18 +2315,52 @@ void SetProperty(ALsource *const Source, ALCcontext *const Context, const Source
         }
         break;
 
-    case AL_SOURCE_SPATIALIZE_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         if constexpr(std::is_integral_v<T>)
         {
             CheckSize(1);
-            if(auto mode = SpatializeModeFromEnum(values[0]))
-            {
-                Source->mSpatialize = *mode;
-                return UpdateSourceProps(Source, Context);
-            }
-            return Context->setError(AL_INVALID_VALUE, "Invalid source spatialize mode: %s\n",
-                HexPrinter{values[0]}.c_str());
-        }
+            CheckValue(values[0] >= std::numeric_limits<int>::min()
+                && values[0] <= std::numeric_limits<int>::max());
+
+            Source->mPriority = static_cast<int>(values[0]);
+            return UpdateSourceProps(Source, Context);
+        }
+        break;
+
+    case AL_SOURCE_GROUP_SOFT:
+        if constexpr(std::is_integral_v<T>)
+        {
+            CheckSize(1);
+            const auto groupid = static_cast<std::make_unsigned_t<T>>(values[0]);
+            std::lock_guard<std::mutex> _{Context->mSourceGroupLock};
+            ALsourcegroup *group{};
+            if(values[0])
+            {
+                group = LookupSourceGroup(Context, groupid);
+                if(!group) UNLIKELY
+                    return Context->setError(AL_INVALID_VALUE, "Invalid source group ID %s",
+                        std::to_string(groupid).c_str());
+            }
+
+            if(group) IncrementRef(group->ref);
+            if(auto *oldgroup = std::exchange(Source->mGroup, group))
+                DecrementRef(oldgroup->ref);
+            return UpdateSourceProps(Source, Context);
+        }
+        break;
+
+    case AL_SOURCE_SPATIALIZE_SOFT:
+        if constexpr(std::is_integral_v<T>)
+        {
+            CheckSize(1);
+            if(auto mode = SpatializeModeFromEnum(values[0]))
+            {
+                Source->mSpatialize = *mode;
+                return UpdateSourceProps(Source, Context);
+            }
+            return Context->setError(AL_INVALID_VALUE, "Invalid source spatialize mode: %s\n",
+                HexPrinter{values[0]}.c_str());
+        }
         break;
 
     case AL_STEREO_MODE_SOFT:
@@ -1954,6 +2428,8 @@ void SetProperty(ALsource *const Source, ALCcontext *const Context, const Source
                 send.GainLF = 1.0f;
                 send.LFReference = HIGHPASSFREQREF;
             }
+            CancelSourceRamp(Source, RampSendGain + static_cast<size_t>(sendidx)*2);
+            CancelSourceRamp(Source, RampSendGain + static_cast<size_t>(sendidx)*2 + 1);
 
             /* We must force an update if the current auxiliary slot is valid
              * and about to be changed on an active source, in case the old
@@ -2009,6 +2485,7 @@ template<typename T, size_t N>
 bool GetProperty(ALsource *const Source, ALCcontext *const Context, const SourceProp prop,
     const al::span<T,N> values) try
 {
+    std::lock_guard<std::mutex> srclock{Source->mPropLock};
     auto CheckSize = GetSizeChecker(Context, prop, values);
     ALCdevice *device{Context->mALDevice.get()};
     ClockLatency clocktime;
@@ -2330,30 +2807,10 @@ bool GetProperty(ALsource *const Source, ALCcontext *const Context, const Source
         if constexpr(std::is_integral_v<T>)
         {
             CheckSize(1);
-            if(Source->Looping || Source->SourceType != AL_STREAMING)
-            {
-                /* Buffers on a looping source are in a perpetual state of
-                 * PENDING, so don't report any as PROCESSED
-                 */
-                values[0] = 0;
-            }
-            else
-            {
-                int played{0};
-                if(Source->state != AL_INITIAL)
-                {
-                    const VoiceBufferItem *Current{nullptr};
-                    if(Voice *voice{GetSourceVoice(Source, Context)})
-                        Current = voice->mCurrentBuffer.load(std::memory_order_relaxed);
-                    for(auto &item : Source->mQueue)
-                    {
-                        if(&item == Current)
-                            break;
-                        ++played;
-                    }
-                }
-                values[0] = played;
-            }
+            /* Buffers on a looping source are in a perpetual state of PENDING,
+             * so none are reported as PROCESSED.
+             */
+            values[0] = static_cast<T>(GetProcessedCount(Source, Context));
             return true;
         }
         break;
@@ -2421,6 +2878,44 @@ bool GetProperty(ALsource *const Source, ALCcontext *const Context, const Source
         }
         break;
 
+    case AL_SOURCE_PRIORITY_SOFT:
+        if constexpr(std::is_integral_v<T>)
+        {
+            CheckSize(1);
+            values[0] = static_cast<T>(Source->mPriority);
+            return true;
+        }
+        break;
+
+    case AL_SOURCE_GROUP_SOFT:
+        if constexpr(std::is_integral_v<T>)
+        {
+            CheckSize(1);
+            values[0] = static_cast<T>(Source->mGroup ? Source->mGroup->id : 0u);
+            return true;
+        }
+        break;
+
+    case AL_QUEUE_LOW_WATERMARK_SOFT:
+        if constexpr(std::is_integral_v<T>)
+        {
+            CheckSize(1);
+            values[0] = static_cast<T>(Source->mLowWatermark);
+            return true;
+        }
+        break;
+
+    case AL_SOURCE_MIX_TIME_SOFT:
+        if constexpr(std::is_same_v<T,int64_t>)
+        {
+            CheckSize(1);
+            const Voice *voice{GetSourceVoice(Source, Context)};
+            values[0] = voice ? static_cast<T>(voice->mMixTime.load(std::memory_order_relaxed))
+                : T{0};
+            return true;
+        }
+        break;
+
     case AL_SOURCE_SPATIALIZE_SOFT:
         if constexpr(std::is_integral_v<T>)
         {
@@ -2476,32 +2971,16 @@ void StartSources(ALCcontext *const context, const al::span<ALsource*> srchandle
         }
     }
 
-    /* Count the number of reusable voices. */
-    auto voicelist = context->getVoicesSpan();
-    size_t free_voices{0};
-    for(const Voice *voice : voicelist)
-    {
-        free_voices += (voice->mPlayState.load(std::memory_order_acquire) == Voice::Stopped
-            && voice->mSourceID.load(std::memory_order_relaxed) == 0u
-            && voice->mPendingChange.load(std::memory_order_relaxed) == false);
-        if(free_voices == srchandles.size())
-            break;
-    }
-    if(srchandles.size() != free_voices) UNLIKELY
+    /* Playing a burst of sources after a spike is a good time to drop idle
+     * voices from the active span, before getting more.
+     */
+    if(VoiceCompactionDue(context)) UNLIKELY
     {
-        const size_t inc_amount{srchandles.size() - free_voices};
-        auto &allvoices = *context->mVoices.load(std::memory_order_relaxed);
-        if(inc_amount > allvoices.size() - voicelist.size())
-        {
-            /* Increase the number of voices to handle the request. */
-            context->allocVoices(inc_amount - (allvoices.size() - voicelist.size()));
-        }
-        context->mActiveVoiceCount.fetch_add(inc_amount, std::memory_order_release);
-        voicelist = context->getVoicesSpan();
+        SourceWriteGuard srcguard{context};
+        CompactVoices(context);
+        context->freeRetiredVoices();
     }
 
-    auto voiceiter = voicelist.begin();
-    ALuint vidx{0};
     VoiceChange *tail{}, *cur{};
     for(ALsource *source : srchandles)
     {
@@ -2509,7 +2988,10 @@ void StartSources(ALCcontext *const context, const al::span<ALsource*> srchandle
          * length buffer.
          */
         auto find_buffer = [](ALbufferQueueItem &entry) noexcept
-        { return entry.mSampleLen != 0 || entry.mCallback != nullptr; };
+        {
+            return entry.mSampleLen != 0 || entry.mCallback != nullptr
+                || entry.mRing != nullptr;
+        };
         auto BufferList = std::find_if(source->mQueue.begin(), source->mQueue.end(), find_buffer);
 
         /* If there's nothing to play, go right to stopped. */
@@ -2573,19 +3055,8 @@ void StartSources(ALCcontext *const context, const al::span<ALsource*> srchandle
             break;
         }
 
-        /* Find the next unused voice to play this source with. */
-        for(;voiceiter != voicelist.end();++voiceiter,++vidx)
-        {
-            Voice *v{*voiceiter};
-            if(v->mPlayState.load(std::memory_order_acquire) == Voice::Stopped
-                && v->mSourceID.load(std::memory_order_relaxed) == 0u
-                && v->mPendingChange.load(std::memory_order_relaxed) == false)
-            {
-                voice = v;
-                break;
-            }
-        }
-        ASSUME(voice != nullptr);
+        /* Get an unused voice to play this source with. */
+        voice = GetFreeVoice(context, GetVoiceChannels(source, BufferList->mBuffer));
 
         voice->mPosition.store(0, std::memory_order_relaxed);
         voice->mPositionFrac.store(0, std::memory_order_relaxed);
@@ -2610,9 +3081,21 @@ void StartSources(ALCcontext *const context, const al::span<ALsource*> srchandle
                     voice->mFlags.set(VoiceIsFading);
             }
         }
-        InitVoice(voice, source, al::to_address(BufferList), context, device);
+        {
+            /* Set the voice index with the voice's initial properties, so a
+             * lock-free property update either goes into the initial
+             * properties or gets sent to the voice.
+             */
+            std::lock_guard<std::mutex> srclock{source->mPropLock};
+            InitVoice(voice, source, al::to_address(BufferList), context, device);
+            source->VoiceIdx = voice->mIndex;
+        }
+        ReleaseVoiceClaim(voice);
+
+        auto *curitem = static_cast<ALbufferQueueItem*>(voice->mCurrentBuffer.load(
+            std::memory_order_relaxed));
+        PrefetchBufferData(curitem->mBuffer, voice->mPosition.load(std::memory_order_relaxed));
 
-        source->VoiceIdx = vidx;
         source->state = AL_PLAYING;
 
         cur->mVoice = voice;
@@ -2620,7 +3103,92 @@ void StartSources(ALCcontext *const context, const al::span<ALsource*> srchandle
         cur->mState = VChangeState::Play;
     }
     if(tail) LIKELY
-        SendVoiceChanges(context, tail);
+        SendVoiceChanges(context, tail, cur);
+}
+
+
+/* Properties that only need the source's own lock to set or get, which can be
+ * accessed without the context's property and source locks.
+ */
+bool IsLockFreeProp(ALCcontext *context, ALenum prop) noexcept
+{
+#ifdef ALSOFT_EAX
+    if(context->hasEax())
+        return false;
+#else
+    std::ignore = context;
+#endif
+
+    switch(prop)
+    {
+    case AL_PITCH:
+    case AL_GAIN:
+    case AL_MIN_GAIN:
+    case AL_MAX_GAIN:
+    case AL_MAX_DISTANCE:
+    case AL_ROLLOFF_FACTOR:
+    case AL_REFERENCE_DISTANCE:
+    case AL_CONE_INNER_ANGLE:
+    case AL_CONE_OUTER_ANGLE:
+    case AL_CONE_OUTER_GAIN:
+    case AL_CONE_OUTER_GAINHF:
+    case AL_AIR_ABSORPTION_FACTOR:
+    case AL_ROOM_ROLLOFF_FACTOR:
+    case AL_DOPPLER_FACTOR:
+    case AL_POSITION:
+    case AL_VELOCITY:
+    case AL_DIRECTION:
+    case AL_ORIENTATION:
+        return true;
+    }
+    return false;
+}
+
+/* Looks up the source and calls func with it, holding the locks needed for
+ * the given property.
+ */
+template<bool IsSetter, typename F>
+void CallWithSource(ALCcontext *context, ALuint id, ALenum prop, F&& func)
+{
+    if(IsLockFreeProp(context, prop))
+    {
+        SourceReadGuard srcguard{context};
+        ALsource *Source{LookupSourceLockFree(context, id)};
+        if(!Source) UNLIKELY
+            return context->setError(AL_INVALID_NAME, "Invalid source ID %u", id);
+        return func(Source);
+    }
+
+    std::unique_lock<std::mutex> proplock{context->mPropLock, std::defer_lock};
+    if constexpr(IsSetter)
+        proplock.lock();
+    std::lock_guard<std::mutex> srclock{context->mSourceLock};
+    ALsource *Source{LookupSource(context, id)};
+    if(!Source) UNLIKELY
+        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", id);
+    return func(Source);
+}
+
+/* Handles the state and processed buffer queries, which streaming and game
+ * threads tend to make every frame, from the values published by the API
+ * calls and the mixer, without any lock. Returns false for other properties.
+ */
+bool GetPublishedProp(ALCcontext *context, ALuint id, ALenum prop, ALint *value)
+{
+    if(prop != AL_SOURCE_STATE && prop != AL_BUFFERS_PROCESSED)
+        return false;
+
+    SourceReadGuard srcguard{context};
+    ALsource *Source{LookupSourceLockFree(context, id)};
+    if(!Source) UNLIKELY
+        context->setError(AL_INVALID_NAME, "Invalid source ID %u", id);
+    else if(!value) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "NULL pointer");
+    else if(prop == AL_SOURCE_STATE)
+        *value = PeekSourceState(Source, GetSourceVoice(Source, context));
+    else
+        *value = static_cast<ALint>(GetProcessedCount(Source, context));
+    return true;
 }
 
 } // namespace
@@ -2688,13 +3256,19 @@ FORCE_ALIGN void AL_APIENTRY alDeleteSourcesDirect(ALCcontext *context, ALsizei
     if(invsrc != sources_end) UNLIKELY
         return context->setError(AL_INVALID_NAME, "Invalid source ID %u", *invsrc);
 
-    /* All good. Delete source IDs. */
+    /* All good. Delete source IDs, after waiting for other threads to finish
+     * any access without the source lock.
+     */
+    SourceWriteGuard srcguard{context};
     auto delete_source = [&context](const ALuint sid) -> void
     {
         ALsource *src{LookupSource(context, sid)};
         if(src) FreeSource(context, src);
     };
     std::for_each(sources, sources_end, delete_source);
+    if(VoiceCompactionDue(context))
+        CompactVoices(context);
+    context->freeRetiredVoices();
 }
 
 FORCE_ALIGN ALboolean AL_APIENTRY alIsSourceDirect(ALCcontext *context, ALuint source) noexcept
@@ -2709,84 +3283,234 @@ FORCE_ALIGN ALboolean AL_APIENTRY alIsSourceDirect(ALCcontext *context, ALuint s
 FORCE_ALIGN void AL_APIENTRY alSourcefDirect(ALCcontext *context, ALuint source, ALenum param,
     ALfloat value) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mPropLock};
-    std::lock_guard<std::mutex> __{context->mSourceLock};
-    ALsource *Source = LookupSource(context, source);
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-
-    SetProperty(Source, context, static_cast<SourceProp>(param),
-        al::span<const float,1>{&value, 1u});
+    CallWithSource<true>(context, source, param, [=](ALsource *Source)
+    {
+        SetProperty(Source, context, static_cast<SourceProp>(param),
+            al::span<const float,1>{&value, 1u});
+    });
 }
 
 FORCE_ALIGN void AL_APIENTRY alSource3fDirect(ALCcontext *context, ALuint source, ALenum param,
     ALfloat value1, ALfloat value2, ALfloat value3) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mPropLock};
-    std::lock_guard<std::mutex> __{context->mSourceLock};
-    ALsource *Source = LookupSource(context, source);
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-
-    const float fvals[3]{ value1, value2, value3 };
-    SetProperty(Source, context, static_cast<SourceProp>(param), al::span{fvals});
+    CallWithSource<true>(context, source, param, [=](ALsource *Source)
+    {
+        const float fvals[3]{ value1, value2, value3 };
+        SetProperty(Source, context, static_cast<SourceProp>(param), al::span{fvals});
+    });
 }
 
 FORCE_ALIGN void AL_APIENTRY alSourcefvDirect(ALCcontext *context, ALuint source, ALenum param,
     const ALfloat *values) noexcept
 {
+    CallWithSource<true>(context, source, param, [=](ALsource *Source)
+    {
+        if(!values) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "NULL pointer");
+
+        const ALuint count{FloatValsByProp(param)};
+        SetProperty(Source, context, static_cast<SourceProp>(param), al::span{values, count});
+    });
+}
+
+FORCE_ALIGN void AL_APIENTRY alSourceBatchfvDirectSOFT(ALCcontext *context, ALsizei count,
+    const ALuint *sources, ALsizei numprops, const ALenum *props, const ALfloat *const *values)
+    noexcept
+{
+    if(count < 0 || numprops < 0) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "Setting %d properties on %d sources",
+            numprops, count);
+    if(count == 0 || numprops == 0) UNLIKELY return;
+    if(!sources || !props || !values) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "NULL pointer");
+
+    /* Each property has its own array of values, with as many values for each
+     * source as the property takes.
+     */
+    for(ALsizei i{0};i < numprops;++i)
+    {
+        if(!FloatValsByProp(props[i])) UNLIKELY
+            return context->setError(AL_INVALID_ENUM, "Invalid source float property 0x%04x",
+                props[i]);
+        if(!values[i]) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "NULL pointer");
+    }
+
+    std::vector<ALsource*> extra_sources;
+    std::array<ALsource*,8> source_storage;
+    al::span<ALsource*> srchandles;
+    if(static_cast<ALuint>(count) <= source_storage.size()) LIKELY
+        srchandles = {source_storage.data(), static_cast<ALuint>(count)};
+    else
+    {
+        extra_sources.resize(static_cast<ALuint>(count));
+        srchandles = {extra_sources.data(), extra_sources.size()};
+    }
+
     std::lock_guard<std::mutex> _{context->mPropLock};
     std::lock_guard<std::mutex> __{context->mSourceLock};
-    ALsource *Source = LookupSource(context, source);
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-    if(!values) UNLIKELY
-        return context->setError(AL_INVALID_VALUE, "NULL pointer");
+    for(auto &srchdl : srchandles)
+    {
+        srchdl = LookupSource(context, *sources);
+        if(!srchdl)
+            return context->setError(AL_INVALID_NAME, "Invalid source ID %u", *sources);
+        ++sources;
+    }
 
-    const ALuint count{FloatValsByProp(param)};
-    SetProperty(Source, context, static_cast<SourceProp>(param), al::span{values, count});
+    /* Defer updates while setting the properties, so each source only gets
+     * one update with all its new properties, instead of one per property.
+     */
+    const bool deferred{context->mDeferUpdates.exchange(true, std::memory_order_acq_rel)};
+    for(ALsizei i{0};i < numprops;++i)
+    {
+        const auto prop = static_cast<SourceProp>(props[i]);
+        const ALuint numvals{FloatValsByProp(props[i])};
+        const ALfloat *propvals{values[i]};
+        for(ALsource *source : srchandles)
+        {
+            SetProperty(source, context, prop, al::span{propvals, numvals});
+            propvals += numvals;
+        }
+    }
+    context->mDeferUpdates.store(deferred, std::memory_order_release);
+    if(deferred)
+        return;
+
+    /* Hold the mixer from applying updates while providing them, so they all
+     * happen together.
+     */
+    context->mHoldUpdates.store(true, std::memory_order_release);
+    while((context->mUpdateCount.load(std::memory_order_acquire)&1) != 0) {
+        /* busy-wait */
+    }
+
+    for(ALsource *source : srchandles)
+    {
+        std::lock_guard<std::mutex> srclock{source->mPropLock};
+        if(!source->mPropsDirty)
+            continue;
+#ifdef ALSOFT_EAX
+        if(context->hasEax())
+            source->eaxCommit();
+#endif
+        if(Voice *voice{GetSourceVoice(source, context)})
+        {
+            source->mPropsDirty = false;
+            UpdateSourceProps(source, voice, context);
+        }
+    }
+
+    context->mHoldUpdates.store(false, std::memory_order_release);
+}
+
+FORCE_ALIGN void AL_APIENTRY alSourceRampfDirectSOFT(ALCcontext *context, ALuint source,
+    ALenum param, ALfloat value, ALfloat seconds, ALenum curve) noexcept
+{
+    const auto rampcurve = RampCurveFromEnum(curve);
+    if(!rampcurve) UNLIKELY
+        return context->setError(AL_INVALID_ENUM, "Invalid ramp curve 0x%04x", curve);
+    if(!(seconds >= 0.0f && std::isfinite(seconds))) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "Invalid ramp duration %f", seconds);
+
+    switch(param)
+    {
+    case AL_GAIN:
+    case AL_PITCH:
+        if(!(value >= 0.0f && std::isfinite(value))) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "Ramp value %f out of range", value);
+        break;
+    case AL_DIRECT_FILTER_GAIN_SOFT:
+    case AL_DIRECT_FILTER_GAINHF_SOFT:
+        if(!(value >= 0.0f && value <= 1.0f)) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "Ramp value %f out of range", value);
+        break;
+    default:
+        return context->setError(AL_INVALID_ENUM, "Invalid source ramp property 0x%04x",
+            param);
+    }
+
+    CallWithSource<true>(context, source, param, [=](ALsource *Source)
+    {
+        std::lock_guard<std::mutex> srclock{Source->mPropLock};
+        switch(param)
+        {
+        case AL_GAIN:
+            return SetSourceRamp(Source, context, RampGain, Source->Gain, value, seconds,
+                *rampcurve);
+        case AL_PITCH:
+            return SetSourceRamp(Source, context, RampPitch, Source->Pitch, value, seconds,
+                *rampcurve);
+        case AL_DIRECT_FILTER_GAIN_SOFT:
+            return SetSourceRamp(Source, context, RampDirectGain, Source->Direct.Gain, value,
+                seconds, *rampcurve);
+        case AL_DIRECT_FILTER_GAINHF_SOFT:
+            return SetSourceRamp(Source, context, RampDirectGainHF, Source->Direct.GainHF,
+                value, seconds, *rampcurve);
+        }
+    });
+}
+
+FORCE_ALIGN void AL_APIENTRY alSourceSendRampfDirectSOFT(ALCcontext *context, ALuint source,
+    ALint send, ALenum param, ALfloat value, ALfloat seconds, ALenum curve) noexcept
+{
+    const auto rampcurve = RampCurveFromEnum(curve);
+    if(!rampcurve) UNLIKELY
+        return context->setError(AL_INVALID_ENUM, "Invalid ramp curve 0x%04x", curve);
+    if(!(seconds >= 0.0f && std::isfinite(seconds))) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "Invalid ramp duration %f", seconds);
+    if(param != AL_AUXILIARY_SEND_FILTER_GAIN_SOFT
+        && param != AL_AUXILIARY_SEND_FILTER_GAINHF_SOFT) UNLIKELY
+        return context->setError(AL_INVALID_ENUM, "Invalid source send ramp property 0x%04x",
+            param);
+    if(!(value >= 0.0f && value <= 1.0f)) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "Ramp value %f out of range", value);
+    if(send < 0 || static_cast<ALuint>(send) >= context->mALDevice->NumAuxSends) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "Invalid send %d", send);
+
+    CallWithSource<true>(context, source, param, [=](ALsource *Source)
+    {
+        std::lock_guard<std::mutex> srclock{Source->mPropLock};
+        auto &srcsend = Source->Send[static_cast<size_t>(send)];
+        const size_t idx{RampSendGain + static_cast<size_t>(send)*2};
+        if(param == AL_AUXILIARY_SEND_FILTER_GAIN_SOFT)
+            SetSourceRamp(Source, context, idx, srcsend.Gain, value, seconds, *rampcurve);
+        else
+            SetSourceRamp(Source, context, idx+1, srcsend.GainHF, value, seconds, *rampcurve);
+    });
 }
 
 
 FORCE_ALIGN void AL_APIENTRY alSourcedDirectSOFT(ALCcontext *context, ALuint source, ALenum param,
     ALdouble value) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mPropLock};
-    std::lock_guard<std::mutex> __{context->mSourceLock};
-    ALsource *Source = LookupSource(context, source);
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-
-    SetProperty(Source, context, static_cast<SourceProp>(param),
-        al::span<const double,1>{&value, 1});
+    CallWithSource<true>(context, source, param, [=](ALsource *Source)
+    {
+        SetProperty(Source, context, static_cast<SourceProp>(param),
+            al::span<const double,1>{&value, 1});
+    });
 }
 
 FORCE_ALIGN void AL_APIENTRY alSource3dDirectSOFT(ALCcontext *context, ALuint source, ALenum param,
     ALdouble value1, ALdouble value2, ALdouble value3) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mPropLock};
-    std::lock_guard<std::mutex> __{context->mSourceLock};
-    ALsource *Source = LookupSource(context, source);
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-
-    const double dvals[3]{value1, value2, value3};
-    SetProperty(Source, context, static_cast<SourceProp>(param), al::span{dvals});
+    CallWithSource<true>(context, source, param, [=](ALsource *Source)
+    {
+        const double dvals[3]{value1, value2, value3};
+        SetProperty(Source, context, static_cast<SourceProp>(param), al::span{dvals});
+    });
 }
 
 FORCE_ALIGN void AL_APIENTRY alSourcedvDirectSOFT(ALCcontext *context, ALuint source, ALenum param,
     const ALdouble *values) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mPropLock};
-    std::lock_guard<std::mutex> __{context->mSourceLock};
-    ALsource *Source = LookupSource(context, source);
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-    if(!values) UNLIKELY
-        return context->setError(AL_INVALID_VALUE, "NULL pointer");
+    CallWithSource<true>(context, source, param, [=](ALsource *Source)
+    {
+        if(!values) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "NULL pointer");
 
-    const ALuint count{DoubleValsByProp(param)};
-    SetProperty(Source, context, static_cast<SourceProp>(param), al::span{values, count});
+        const ALuint count{DoubleValsByProp(param)};
+        SetProperty(Source, context, static_cast<SourceProp>(param), al::span{values, count});
+    });
 }
 
 
@@ -2877,104 +3601,101 @@ FORCE_ALIGN void AL_APIENTRY alSourcei64vDirectSOFT(ALCcontext *context, ALuint
 FORCE_ALIGN void AL_APIENTRY alGetSourcefDirect(ALCcontext *context, ALuint source, ALenum param,
     ALfloat *value) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mSourceLock};
-    ALsource *Source{LookupSource(context, source)};
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-    if(!value) UNLIKELY
-        return context->setError(AL_INVALID_VALUE, "NULL pointer");
+    CallWithSource<false>(context, source, param, [=](ALsource *Source)
+    {
+        if(!value) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "NULL pointer");
 
-    std::ignore = GetProperty(Source, context, static_cast<SourceProp>(param),
-        al::span<float,1>{value, 1});
+        std::ignore = GetProperty(Source, context, static_cast<SourceProp>(param),
+            al::span<float,1>{value, 1});
+    });
 }
 
 FORCE_ALIGN void AL_APIENTRY alGetSource3fDirect(ALCcontext *context, ALuint source, ALenum param,
     ALfloat *value1, ALfloat *value2, ALfloat *value3) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mSourceLock};
-    ALsource *Source{LookupSource(context, source)};
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-    if(!(value1 && value2 && value3)) UNLIKELY
-        return context->setError(AL_INVALID_VALUE, "NULL pointer");
-
-    float fvals[3];
-    if(GetProperty(Source, context, static_cast<SourceProp>(param), al::span{fvals}))
+    CallWithSource<false>(context, source, param, [=](ALsource *Source)
     {
-        *value1 = fvals[0];
-        *value2 = fvals[1];
-        *value3 = fvals[2];
-    }
+        if(!(value1 && value2 && value3)) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "NULL pointer");
+
+        float fvals[3];
+        if(GetProperty(Source, context, static_cast<SourceProp>(param), al::span{fvals}))
+        {
+            *value1 = fvals[0];
+            *value2 = fvals[1];
+            *value3 = fvals[2];
+        }
+    });
 }
 
 FORCE_ALIGN void AL_APIENTRY alGetSourcefvDirect(ALCcontext *context, ALuint source, ALenum param,
     ALfloat *values) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mSourceLock};
-    ALsource *Source{LookupSource(context, source)};
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-    if(!values) UNLIKELY
-        return context->setError(AL_INVALID_VALUE, "NULL pointer");
+    CallWithSource<false>(context, source, param, [=](ALsource *Source)
+    {
+        if(!values) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "NULL pointer");
 
-    const ALuint count{FloatValsByProp(param)};
-    std::ignore = GetProperty(Source, context, static_cast<SourceProp>(param),
-        al::span{values, count});
+        const ALuint count{FloatValsByProp(param)};
+        std::ignore = GetProperty(Source, context, static_cast<SourceProp>(param),
+            al::span{values, count});
+    });
 }
 
 
 FORCE_ALIGN void AL_APIENTRY alGetSourcedDirectSOFT(ALCcontext *context, ALuint source,
     ALenum param, ALdouble *value) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mSourceLock};
-    ALsource *Source{LookupSource(context, source)};
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-    if(!value) UNLIKELY
-        return context->setError(AL_INVALID_VALUE, "NULL pointer");
+    CallWithSource<false>(context, source, param, [=](ALsource *Source)
+    {
+        if(!value) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "NULL pointer");
 
-    std::ignore = GetProperty(Source, context, static_cast<SourceProp>(param),
-        al::span<double,1>{value, 1u});
+        std::ignore = GetProperty(Source, context, static_cast<SourceProp>(param),
+            al::span<double,1>{value, 1u});
+    });
 }
 
 FORCE_ALIGN void AL_APIENTRY alGetSource3dDirectSOFT(ALCcontext *context, ALuint source,
     ALenum param, ALdouble *value1, ALdouble *value2, ALdouble *value3) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mSourceLock};
-    ALsource *Source{LookupSource(context, source)};
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-    if(!(value1 && value2 && value3)) UNLIKELY
-        return context->setError(AL_INVALID_VALUE, "NULL pointer");
-
-    double dvals[3];
-    if(GetProperty(Source, context, static_cast<SourceProp>(param), al::span{dvals}))
+    CallWithSource<false>(context, source, param, [=](ALsource *Source)
     {
-        *value1 = dvals[0];
-        *value2 = dvals[1];
-        *value3 = dvals[2];
-    }
+        if(!(value1 && value2 && value3)) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "NULL pointer");
+
+        double dvals[3];
+        if(GetProperty(Source, context, static_cast<SourceProp>(param), al::span{dvals}))
+        {
+            *value1 = dvals[0];
+            *value2 = dvals[1];
+            *value3 = dvals[2];
+        }
+    });
 }
 
 FORCE_ALIGN void AL_APIENTRY alGetSourcedvDirectSOFT(ALCcontext *context, ALuint source,
     ALenum param, ALdouble *values) noexcept
 {
-    std::lock_guard<std::mutex> _{context->mSourceLock};
-    ALsource *Source{LookupSource(context, source)};
-    if(!Source) UNLIKELY
-        return context->setError(AL_INVALID_NAME, "Invalid source ID %u", source);
-    if(!values) UNLIKELY
-        return context->setError(AL_INVALID_VALUE, "NULL pointer");
+    CallWithSource<false>(context, source, param, [=](ALsource *Source)
+    {
+        if(!values) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "NULL pointer");
 
-    const ALuint count{DoubleValsByProp(param)};
-    std::ignore = GetProperty(Source, context, static_cast<SourceProp>(param),
-        al::span{values, count});
+        const ALuint count{DoubleValsByProp(param)};
+        std::ignore = GetProperty(Source, context, static_cast<SourceProp>(param),
+            al::span{values, count});
+    });
 }
 
 
 FORCE_ALIGN void AL_APIENTRY alGetSourceiDirect(ALCcontext *context, ALuint source, ALenum param,
     ALint *value) noexcept
 {
+    if(GetPublishedProp(context, source, param, value))
+        return;
+
     std::lock_guard<std::mutex> _{context->mSourceLock};
     ALsource *Source{LookupSource(context, source)};
     if(!Source) UNLIKELY
@@ -3008,6 +3729,9 @@ FORCE_ALIGN void AL_APIENTRY alGetSource3iDirect(ALCcontext *context, ALuint sou
 FORCE_ALIGN void AL_APIENTRY alGetSourceivDirect(ALCcontext *context, ALuint source, ALenum param,
     ALint *values) noexcept
 {
+    if(GetPublishedProp(context, source, param, values))
+        return;
+
     std::lock_guard<std::mutex> _{context->mSourceLock};
     ALsource *Source{LookupSource(context, source)};
     if(!Source) UNLIKELY
@@ -3211,12 +3935,14 @@ FORCE_ALIGN void AL_APIENTRY alSourcePausevDirect(ALCcontext *context, ALsizei n
     }
     if(tail) LIKELY
     {
-        SendVoiceChanges(context, tail);
+        SendVoiceChanges(context, tail, cur);
         /* Second, now that the voice changes have been sent, because it's
          * possible that the voice stopped after it was detected playing and
-         * before the voice got paused, recheck that the source is still
-         * considered playing and set it to paused if so.
+         * before the voice got paused, wait for any mix in progress to finish
+         * then recheck that the source is still considered playing and set it
+         * to paused if so.
          */
+        context->mALDevice->waitForMix();
         for(ALsource *source : srchandles)
         {
             Voice *voice{GetSourceVoice(source, context)};
@@ -3280,7 +4006,11 @@ FORCE_ALIGN void AL_APIENTRY alSourceStopvDirect(ALCcontext *context, ALsizei n,
         source->VoiceIdx = INVALID_VOICE_IDX;
     }
     if(tail) LIKELY
-        SendVoiceChanges(context, tail);
+    {
+        SendVoiceChanges(context, tail, cur);
+        for(ALsource *source : srchandles)
+            MarkVoiceDetached(context, source);
+    }
 }
 
 
@@ -3339,7 +4069,11 @@ FORCE_ALIGN void AL_APIENTRY alSourceRewindvDirect(ALCcontext *context, ALsizei
         source->VoiceIdx = INVALID_VOICE_IDX;
     }
     if(tail) LIKELY
-        SendVoiceChanges(context, tail);
+    {
+        SendVoiceChanges(context, tail, cur);
+        for(ALsource *source : srchandles)
+            MarkVoiceDetached(context, source);
+    }
 }
 
 
@@ -3382,6 +4116,8 @@ FORCE_ALIGN void AL_APIENTRY alSourceQueueBuffersDirect(ALCcontext *context, ALu
         }
         if(buffer)
         {
+            /* Buffers being loaded asynchronously start playing once loaded. */
+            WaitForBufferLoad(device, buflock, buffer);
             if(buffer->mSampleRate < 1)
             {
                 context->setError(AL_INVALID_OPERATION, "Queueing buffer %u with no format",
@@ -3393,6 +4129,11 @@ FORCE_ALIGN void AL_APIENTRY alSourceQueueBuffersDirect(ALCcontext *context, ALu
                 context->setError(AL_INVALID_OPERATION, "Queueing callback buffer %u", buffer->id);
                 goto buffer_error;
             }
+            if(buffer->mRing)
+            {
+                context->setError(AL_INVALID_OPERATION, "Queueing ring buffer %u", buffer->id);
+                goto buffer_error;
+            }
             if(buffer->MappedAccess != 0 && !(buffer->MappedAccess&AL_MAP_PERSISTENT_BIT_SOFT))
             {
                 context->setError(AL_INVALID_OPERATION,
@@ -3402,6 +4143,12 @@ FORCE_ALIGN void AL_APIENTRY alSourceQueueBuffersDirect(ALCcontext *context, ALu
         }
 
         source->mQueue.emplace_back();
+        if(source->mQueue.size() > 1)
+        {
+            /* Each item starts where the previous one ends. */
+            const auto &prev = *(source->mQueue.cend()-2);
+            source->mQueue.back().mStart = prev.mStart + prev.mSampleLen;
+        }
         if(!BufferList)
             BufferList = &source->mQueue.back();
         else
@@ -3414,7 +4161,9 @@ FORCE_ALIGN void AL_APIENTRY alSourceQueueBuffersDirect(ALCcontext *context, ALu
         BufferList->mBlockAlign = buffer->mBlockAlign;
         BufferList->mSampleLen = buffer->mSampleLen;
         BufferList->mLoopEnd = buffer->mSampleLen;
+        BufferList->mPlaneSize = buffer->mPlaneSize;
         BufferList->mSamples = buffer->mData.data();
+        BufferList->mCacheable = IsCacheable(buffer);
         BufferList->mBuffer = buffer;
         IncrementRef(buffer->ref);
 
@@ -3457,8 +4206,14 @@ FORCE_ALIGN void AL_APIENTRY alSourceQueueBuffersDirect(ALCcontext *context, ALu
     /* All buffers good. */
     buflock.unlock();
 
-    /* Source is now streaming */
+    /* Source is now streaming, with serials for the new items. */
     source->SourceType = AL_STREAMING;
+    UpdateCountsProcessed(source);
+    uint serial{source->mTailSerial.load(std::memory_order_relaxed)};
+    for(auto iter = source->mQueue.begin() + ptrdiff_t(NewListStart);
+        iter != source->mQueue.end();++iter)
+        iter->mSerial = serial++;
+    source->mTailSerial.store(serial, std::memory_order_release);
 
     if(NewListStart != 0)
     {
@@ -3486,23 +4241,12 @@ FORCE_ALIGN void AL_APIENTRY alSourceUnqueueBuffersDirect(ALCcontext *context, A
         return context->setError(AL_INVALID_VALUE, "Unqueueing from looping source %u", src);
 
     /* Make sure enough buffers have been processed to unqueue. */
-    uint processed{0u};
-    if(source->state != AL_INITIAL) LIKELY
-    {
-        VoiceBufferItem *Current{nullptr};
-        if(Voice *voice{GetSourceVoice(source, context)})
-            Current = voice->mCurrentBuffer.load(std::memory_order_relaxed);
-        for(auto &item : source->mQueue)
-        {
-            if(&item == Current)
-                break;
-            ++processed;
-        }
-    }
+    const uint processed{GetProcessedCount(source, context)};
     if(processed < static_cast<ALuint>(nb)) UNLIKELY
         return context->setError(AL_INVALID_VALUE, "Unqueueing %d buffer%s (only %u processed)",
             nb, (nb==1)?"":"s", processed);
 
+    WaitForDetachedVoice(context, source);
     do {
         auto &head = source->mQueue.front();
         if(ALbuffer *buffer{head.mBuffer})
@@ -3513,6 +4257,7 @@ FORCE_ALIGN void AL_APIENTRY alSourceUnqueueBuffersDirect(ALCcontext *context, A
         else
             *(buffers++) = 0;
         source->mQueue.pop_front();
+        source->mHeadSerial.fetch_add(1u, std::memory_order_release);
     } while(--nb);
 }
 
@@ -3556,6 +4301,12 @@ AL_API DECL_FUNC3(void, alSourceQueueBuffers, ALuint, ALsizei, const ALuint*)
 AL_API DECL_FUNC3(void, alSourceUnqueueBuffers, ALuint, ALsizei, ALuint*)
 FORCE_ALIGN DECL_FUNCEXT2(void, alSourcePlayAtTime,SOFT, ALuint, ALint64SOFT)
 FORCE_ALIGN DECL_FUNCEXT3(void, alSourcePlayAtTimev,SOFT, ALsizei, const ALuint*, ALint64SOFT)
+FORCE_ALIGN DECL_FUNCEXT5(void, alSourceBatchfv,SOFT, ALsizei, const ALuint*, ALsizei, const ALenum*,
+    const ALfloat*const*)
+
+FORCE_ALIGN DECL_FUNCEXT5(void, alSourceRampf,SOFT, ALuint, ALenum, ALfloat, ALfloat, ALenum)
+FORCE_ALIGN DECL_FUNCEXT6(void, alSourceSendRampf,SOFT, ALuint, ALint, ALenum, ALfloat, ALfloat,
+    ALenum)
 
 AL_API void AL_APIENTRY alSourceQueueBufferLayersSOFT(ALuint, ALsizei, const ALuint*) noexcept
 {
@@ -3566,7 +4317,8 @@ AL_API void AL_APIENTRY alSourceQueueBufferLayersSOFT(ALuint, ALsizei, const ALu
 }
 
 
-ALsource::ALsource()
+ALsource::ALsource(BufferQueuePool &queuePool)
+    : mQueue{BufferQueueAllocator<ALbufferQueueItem>{queuePool}}
 {
     Direct.Gain = 1.0f;
     Direct.GainHF = 1.0f;
@@ -3595,6 +4347,16 @@ ALsource::~ALsource()
     auto clear_send = [](ALsource::SendData &send) -> void
     { if(send.Slot) DecrementRef(send.Slot->ref); };
     std::for_each(Send.begin(), Send.end(), clear_send);
+
+    if(mGroup)
+        DecrementRef(mGroup->ref);
+    mGroup = nullptr;
+}
+
+bool ReserveSources(ALCcontext *context, size_t count)
+{
+    std::lock_guard<std::mutex> _{context->mSourceLock};
+    return EnsureSources(context, count);
 }
 
 void UpdateAllSourceProps(ALCcontext *context)
@@ -3608,6 +4370,7 @@ void UpdateAllSourceProps(ALCcontext *context)
         ALsource *source = sid ? LookupSource(context, sid) : nullptr;
         if(source && source->VoiceIdx == vidx)
         {
+            std::lock_guard<std::mutex> srclock{source->mPropLock};
             if(std::exchange(source->mPropsDirty, false))
                 UpdateSourceProps(source, voice, context);
         }
@@ -3615,6 +4378,41 @@ void UpdateAllSourceProps(ALCcontext *context)
     }
 }
 
+BufferQueuePool::~BufferQueuePool()
+{
+    while(FreeBlock *block{mFreeList})
+    {
+        mFreeList = block->mNext;
+        al_free(block);
+    }
+}
+
+void *BufferQueuePool::allocate(size_t size, size_t alignment)
+{
+    if(size == mBlockSize && mFreeList)
+    {
+        FreeBlock *block{mFreeList};
+        mFreeList = block->mNext;
+        --mNumFree;
+        return block;
+    }
+    if(void *block{al_malloc(std::max(alignment, alignof(std::max_align_t)), size)})
+        return block;
+    throw std::bad_alloc();
+}
+
+void BufferQueuePool::deallocate(void *block, size_t size) noexcept
+{
+    /* Keep the first size that's freed, which will be the item blocks. */
+    if(mBlockSize == 0 && size >= sizeof(FreeBlock))
+        mBlockSize = size;
+    if(size != mBlockSize || mNumFree >= MaxFree)
+        return al_free(block);
+
+    mFreeList = al::construct_at(static_cast<FreeBlock*>(block), FreeBlock{mFreeList});
+    ++mNumFree;
+}
+
 SourceSubList::~SourceSubList()
 {
     if(!Sources)
@@ -3647,7 +4445,7 @@ void ALsource::eaxInitialize(ALCcontext *context) noexcept
 
     eax1_translate(mEax1.i, mEax);
     mEaxVersion = 1;
-    mEaxChanged = true;
+    eaxMarkAsChanged();
 }
 
 void ALsource::eaxDispatch(const EaxCall& call)
@@ -4458,7 +5256,7 @@ void ALsource::eax_set(const EaxCall& call)
     case 5: eax5_set(call, mEax5.d); break;
     default: eax_fail_unknown_property_id();
     }
-    mEaxChanged = true;
+    eaxMarkAsChanged();
     mEaxVersion = eax_version;
 }
 
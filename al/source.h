@@ -7,6 +7,8 @@
 #include <iterator>
 #include <limits>
 #include <deque>
+#include <mutex>
+#include <type_traits>
 
 #include "AL/al.h"
 #include "AL/alc.h"
@@ -14,7 +16,6 @@
 #include "alc/alu.h"
 #include "alc/context.h"
 #include "alc/inprogext.h"
-#include "aldeque.h"
 #include "almalloc.h"
 #include "alnumeric.h"
 #include "atomic.h"
@@ -30,6 +31,7 @@
 
 struct ALbuffer;
 struct ALeffectslot;
+struct ALsourcegroup;
 
 
 enum class SourceStereo : bool {
@@ -46,9 +48,57 @@ extern bool sBufferSubDataCompat;
 struct ALbufferQueueItem : public VoiceBufferItem {
     ALbuffer *mBuffer{nullptr};
 
+    /* Where the item starts in the source's queue, in samples. It's counted
+     * from the first item queued since the queue was last replaced, so the
+     * offset from the front item stays valid as items are unqueued, and the
+     * items can be searched by offset.
+     */
+    uint64_t mStart{0u};
+
     DISABLE_ALLOC()
 };
 
+/* Allocates a source's buffer queue from its context's pool. Only the blocks
+ * holding the queue items are pooled, since the deque's map of them is rarely
+ * reallocated.
+ */
+template<typename T>
+struct BufferQueueAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    BufferQueuePool *mPool;
+
+    explicit BufferQueueAllocator(BufferQueuePool &pool) noexcept : mPool{&pool} { }
+    template<typename U>
+    BufferQueueAllocator(const BufferQueueAllocator<U> &rhs) noexcept : mPool{rhs.mPool} { }
+
+    T *allocate(std::size_t n)
+    {
+        if constexpr(std::is_same_v<T,ALbufferQueueItem>)
+            return static_cast<T*>(mPool->allocate(n*sizeof(T), alignof(T)));
+        else
+            return al::allocator<T>{}.allocate(n);
+    }
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+        if constexpr(std::is_same_v<T,ALbufferQueueItem>)
+            mPool->deallocate(p, n*sizeof(T));
+        else
+            al::allocator<T>{}.deallocate(p, n);
+    }
+};
+template<typename T, typename U>
+bool operator==(const BufferQueueAllocator<T> &lhs, const BufferQueueAllocator<U> &rhs) noexcept
+{ return lhs.mPool == rhs.mPool; }
+template<typename T, typename U>
+bool operator!=(const BufferQueueAllocator<T> &lhs, const BufferQueueAllocator<U> &rhs) noexcept
+{ return lhs.mPool != rhs.mPool; }
+
+using BufferQueue = std::deque<ALbufferQueueItem,BufferQueueAllocator<ALbufferQueueItem>>;
+
 
 #ifdef ALSOFT_EAX
 class EaxSourceException : public EaxException {
@@ -88,6 +138,20 @@ struct ALsource {
     DirectMode DirectChannels{DirectMode::Off};
     SpatializeMode mSpatialize{SpatializeMode::Auto};
     SourceStereo mStereoMode{SourceStereo::Normal};
+    int mPriority{0};
+
+    /* The group this source's output is submixed in, if any. */
+    ALsourcegroup *mGroup{nullptr};
+
+    /* The queued duration, in milliseconds, below which a low watermark event
+     * is sent (0 for none).
+     */
+    uint mLowWatermark{0u};
+
+    /* Mixer-side ramps for the parameters that support them (see RampGain,
+     * etc).
+     */
+    std::array<ParamRamp,NumRampParams> mRamps{};
 
     bool DryGainHFAuto{true};
     bool WetGainAuto{true};
@@ -135,23 +199,46 @@ struct ALsource {
     ALenum SourceType{AL_UNDETERMINED};
 
     /** Source state (initial, playing, paused, or stopped) */
-    ALenum state{AL_INITIAL};
+    std::atomic<ALenum> state{AL_INITIAL};
 
     /** Source Buffer Queue head. */
-    al::deque<ALbufferQueueItem> mQueue;
+    BufferQueue mQueue;
+
+    /* The serials of the queue's front item and of the next item to be
+     * queued. With the voice's current item serial, these give the number of
+     * processed buffers without the source lock.
+     */
+    std::atomic<uint> mHeadSerial{0u};
+    std::atomic<uint> mTailSerial{0u};
+    /* Set for a non-looping streaming source, which reports processed
+     * buffers.
+     */
+    std::atomic<bool> mCountsProcessed{false};
 
     bool mPropsDirty{true};
 
     /* Index into the context's Voices array. Lazily updated, only checked and
      * reset when looking up the voice.
      */
-    ALuint VoiceIdx{INVALID_VOICE_IDX};
+    std::atomic<ALuint> VoiceIdx{INVALID_VOICE_IDX};
+
+    /* Held while getting or setting source properties, which may happen from
+     * multiple threads for the properties that don't need the context's locks
+     * (see IsLockFreeProp).
+     */
+    std::mutex mPropLock;
+
+    /* The device's mix count when the source's voice was last stopped without
+     * waiting for the mixer. If odd, that mix may still be reading the buffer
+     * queue until the count changes.
+     */
+    uint mDetachMixCount{0u};
 
     /** Self ID */
     ALuint id{0};
 
 
-    ALsource();
+    explicit ALsource(BufferQueuePool &queuePool);
     ~ALsource();
 
     ALsource(const ALsource&) = delete;
@@ -164,7 +251,19 @@ public:
     void eaxInitialize(ALCcontext *context) noexcept;
     void eaxDispatch(const EaxCall& call);
     void eaxCommit();
-    void eaxMarkAsChanged() noexcept { mEaxChanged = true; }
+    void eaxMarkAsChanged() noexcept
+    {
+        mEaxChanged = true;
+        mEaxAlContext->eaxQueueSource(this);
+    }
+    bool eaxUsesFxSlot(EaxFxSlotIndexValue index) const noexcept
+    { return mEaxActiveFxSlots[index]; }
+
+    /* The next source in the context's EAX commit queue, and whether this
+     * source is in it.
+     */
+    ALsource *mEaxNextQueued{};
+    bool mEaxQueued{};
 
     static ALsource* EaxLookupSource(ALCcontext& al_context, ALuint source_id) noexcept;
 
@@ -1039,6 +1138,9 @@ private:
 #endif // ALSOFT_EAX
 };
 
+/* Allocates storage so count sources can be generated without allocating. */
+bool ReserveSources(ALCcontext *context, size_t count);
+
 void UpdateAllSourceProps(ALCcontext *context);
 
 #endif
@@ -0,0 +1,539 @@
+
+#include "config.h"
+
+#include "sourcegroup.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+#include "AL/efx.h"
+
+#include "albit.h"
+#include "alc/alu.h"
+#include "alc/context.h"
+#include "alc/device.h"
+#include "alc/inprogext.h"
+#include "almalloc.h"
+#include "alnumeric.h"
+#include "alspan.h"
+#include "auxeffectslot.h"
+#include "core/logging.h"
+#include "core/sourcegroup.h"
+#include "direct_defs.h"
+#include "filter.h"
+#include "opthelpers.h"
+
+
+namespace {
+
+inline ALsourcegroup *LookupSourceGroup(ALCcontext *context, ALuint id) noexcept
+{
+    const size_t lidx{(id-1) >> 6};
+    const ALuint slidx{(id-1) & 0x3f};
+
+    if(lidx >= context->mSourceGroupList.size()) UNLIKELY
+        return nullptr;
+    SourceGroupSubList &sublist{context->mSourceGroupList[lidx]};
+    if(sublist.FreeMask & (1_u64 << slidx)) UNLIKELY
+        return nullptr;
+    return sublist.SourceGroups + slidx;
+}
+
+inline ALeffectslot *LookupEffectSlot(ALCcontext *context, ALuint id) noexcept
+{
+    const size_t lidx{(id-1) >> 6};
+    const ALuint slidx{(id-1) & 0x3f};
+
+    if(lidx >= context->mEffectSlotList.size()) UNLIKELY
+        return nullptr;
+    EffectSlotSubList &sublist{context->mEffectSlotList[lidx]};
+    if(sublist.FreeMask & (1_u64 << slidx)) UNLIKELY
+        return nullptr;
+    return sublist.EffectSlots + slidx;
+}
+
+inline ALfilter *LookupFilter(ALCdevice *device, ALuint id) noexcept
+{
+    const size_t lidx{(id-1) >> 6};
+    const ALuint slidx{(id-1) & 0x3f};
+
+    if(lidx >= device->FilterList.size()) UNLIKELY
+        return nullptr;
+    FilterSubList &sublist = device->FilterList[lidx];
+    if(sublist.FreeMask & (1_u64 << slidx)) UNLIKELY
+        return nullptr;
+    return sublist.Filters + slidx;
+}
+
+
+void AddActiveSourceGroup(ALsourcegroup *group, ALCcontext *context)
+{
+    SourceGroupArray *curarray{context->mActiveSourceGroups.load(std::memory_order_acquire)};
+    SourceGroupArray *newarray{SourceGroup::CreatePtrArray(curarray->size() + 1)};
+    (*newarray)[0] = group->mGroup;
+    std::copy(curarray->begin(), curarray->end(), newarray->begin()+1);
+
+    curarray = context->mActiveSourceGroups.exchange(newarray, std::memory_order_acq_rel);
+    context->mDevice->retire(curarray);
+}
+
+void RemoveActiveSourceGroups(const al::span<ALsourcegroup*> groups, ALCcontext *context)
+{
+    if(groups.empty()) return;
+    SourceGroupArray *curarray{context->mActiveSourceGroups.load(std::memory_order_acquire)};
+
+    auto is_removed = [groups](const SourceGroup *group) noexcept -> bool
+    {
+        return std::any_of(groups.begin(), groups.end(),
+            [group](const ALsourcegroup *algroup) noexcept { return algroup->mGroup == group; });
+    };
+    const auto newsize = static_cast<size_t>(curarray->size() -
+        static_cast<size_t>(std::count_if(curarray->begin(), curarray->end(), is_removed)));
+    SourceGroupArray *newarray{SourceGroup::CreatePtrArray(newsize)};
+    std::remove_copy_if(curarray->begin(), curarray->end(), newarray->begin(), is_removed);
+
+    curarray = context->mActiveSourceGroups.exchange(newarray, std::memory_order_acq_rel);
+    context->mDevice->retire(curarray);
+}
+
+
+bool EnsureSourceGroups(ALCcontext *context, size_t needed)
+{
+    size_t count{std::accumulate(context->mSourceGroupList.cbegin(),
+        context->mSourceGroupList.cend(), size_t{0},
+        [](size_t cur, const SourceGroupSubList &sublist) noexcept -> size_t
+        { return cur + static_cast<ALuint>(al::popcount(sublist.FreeMask)); })};
+
+    while(needed > count)
+    {
+        if(context->mSourceGroupList.size() >= 1<<25) UNLIKELY
+            return false;
+
+        context->mSourceGroupList.emplace_back();
+        auto sublist = context->mSourceGroupList.end() - 1;
+        sublist->FreeMask = ~0_u64;
+        sublist->SourceGroups = static_cast<ALsourcegroup*>(
+            al_calloc(alignof(ALsourcegroup), sizeof(ALsourcegroup)*64));
+        if(!sublist->SourceGroups) UNLIKELY
+        {
+            context->mSourceGroupList.pop_back();
+            return false;
+        }
+        count += 64;
+    }
+    return true;
+}
+
+ALsourcegroup *AllocSourceGroup(ALCcontext *context)
+{
+    auto sublist = std::find_if(context->mSourceGroupList.begin(),
+        context->mSourceGroupList.end(), [](const SourceGroupSubList &entry) noexcept -> bool
+        { return entry.FreeMask != 0; });
+    auto lidx = static_cast<ALuint>(std::distance(context->mSourceGroupList.begin(), sublist));
+    auto slidx = static_cast<ALuint>(al::countr_zero(sublist->FreeMask));
+    ASSUME(slidx < 64);
+
+    ALsourcegroup *group{al::construct_at(sublist->SourceGroups + slidx, context)};
+    aluInitSourceGroupPanning(group->mGroup, context);
+
+    /* Add 1 to avoid ID 0. */
+    group->id = ((lidx<<6) | slidx) + 1;
+
+    context->mNumSourceGroups += 1;
+    sublist->FreeMask &= ~(1_u64 << slidx);
+
+    /* Groups are always active, so member voices' output is mixed as soon as
+     * they start.
+     */
+    group->mPropsDirty = false;
+    group->updateProps(context);
+    AddActiveSourceGroup(group, context);
+
+    return group;
+}
+
+void FreeSourceGroup(ALCcontext *context, ALsourcegroup *group)
+{
+    const ALuint id{group->id - 1};
+    const size_t lidx{id >> 6};
+    const ALuint slidx{id & 0x3f};
+
+    std::destroy_at(group);
+
+    context->mSourceGroupList[lidx].FreeMask |= 1_u64 << slidx;
+    context->mNumSourceGroups--;
+}
+
+
+inline void UpdateProps(ALsourcegroup *group, ALCcontext *context)
+{
+    if(!context->mDeferUpdates)
+    {
+        group->updateProps(context);
+        return;
+    }
+    group->mPropsDirty = true;
+}
+
+} // namespace
+
+
+FORCE_ALIGN void AL_APIENTRY alGenSourceGroupsDirectSOFT(ALCcontext *context, ALsizei n,
+    ALuint *groups) noexcept
+{
+    if(n < 0) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Generating %d source groups", n);
+    if(n <= 0) UNLIKELY return;
+
+    std::lock_guard<std::mutex> _{context->mSourceGroupLock};
+    if(!EnsureSourceGroups(context, static_cast<ALuint>(n)))
+    {
+        context->setError(AL_OUT_OF_MEMORY, "Failed to allocate %d source group%s", n,
+            (n==1) ? "" : "s");
+        return;
+    }
+
+    if(n == 1)
+    {
+        ALsourcegroup *group{AllocSourceGroup(context)};
+        groups[0] = group->id;
+    }
+    else
+    {
+        std::vector<ALuint> ids;
+        ALsizei count{n};
+        ids.reserve(static_cast<ALuint>(count));
+        do {
+            ALsourcegroup *group{AllocSourceGroup(context)};
+            ids.emplace_back(group->id);
+        } while(--count);
+        std::copy(ids.cbegin(), ids.cend(), groups);
+    }
+}
+
+FORCE_ALIGN void AL_APIENTRY alDeleteSourceGroupsDirectSOFT(ALCcontext *context, ALsizei n,
+    const ALuint *groups) noexcept
+{
+    if(n < 0) UNLIKELY
+        context->setError(AL_INVALID_VALUE, "Deleting %d source groups", n);
+    if(n <= 0) UNLIKELY return;
+
+    std::lock_guard<std::mutex> _{context->mSourceGroupLock};
+    auto grouplist = std::vector<ALsourcegroup*>(static_cast<ALuint>(n));
+    for(size_t i{0};i < grouplist.size();++i)
+    {
+        ALsourcegroup *group{LookupSourceGroup(context, groups[i])};
+        if(!group) UNLIKELY
+        {
+            context->setError(AL_INVALID_NAME, "Invalid source group ID %u", groups[i]);
+            return;
+        }
+        if(ReadRef(group->ref) != 0) UNLIKELY
+        {
+            context->setError(AL_INVALID_OPERATION, "Deleting in-use source group %u",
+                groups[i]);
+            return;
+        }
+        grouplist[i] = group;
+    }
+    /* Remove any duplicates. */
+    std::sort(grouplist.begin(), grouplist.end());
+    grouplist.erase(std::unique(grouplist.begin(), grouplist.end()), grouplist.end());
+
+    /* The mixer may still be processing the groups, even though new mixes
+     * won't see them, so wait for it to finish before deleting them.
+     */
+    RemoveActiveSourceGroups(grouplist, context);
+    context->mDevice->waitForMix();
+    for(ALsourcegroup *group : grouplist)
+        FreeSourceGroup(context, group);
+}
+
+FORCE_ALIGN ALboolean AL_APIENTRY alIsSourceGroupDirectSOFT(ALCcontext *context,
+    ALuint group) noexcept
+{
+    std::lock_guard<std::mutex> _{context->mSourceGroupLock};
+    if(LookupSourceGroup(context, group) != nullptr)
+        return AL_TRUE;
+    return AL_FALSE;
+}
+
+
+FORCE_ALIGN void AL_APIENTRY alSourceGroupfDirectSOFT(ALCcontext *context, ALuint groupid,
+    ALenum param, ALfloat value) noexcept
+{
+    std::lock_guard<std::mutex> _{context->mPropLock};
+    std::lock_guard<std::mutex> __{context->mSourceGroupLock};
+    ALsourcegroup *group{LookupSourceGroup(context, groupid)};
+    if(!group) UNLIKELY
+        return context->setError(AL_INVALID_NAME, "Invalid source group ID %u", groupid);
+
+    switch(param)
+    {
+    case AL_GAIN:
+        if(!(value >= 0.0f && std::isfinite(value)))
+            return context->setError(AL_INVALID_VALUE, "Source group gain out of range");
+        if(group->Gain == value) UNLIKELY
+            return;
+        group->Gain = value;
+        break;
+
+    default:
+        return context->setError(AL_INVALID_ENUM, "Invalid source group float property 0x%04x",
+            param);
+    }
+    UpdateProps(group, context);
+}
+
+FORCE_ALIGN void AL_APIENTRY alSourceGroupiDirectSOFT(ALCcontext *context, ALuint groupid,
+    ALenum param, ALint value) noexcept
+{
+    std::lock_guard<std::mutex> _{context->mPropLock};
+    std::lock_guard<std::mutex> __{context->mSourceGroupLock};
+    ALsourcegroup *group{LookupSourceGroup(context, groupid)};
+    if(!group) UNLIKELY
+        return context->setError(AL_INVALID_NAME, "Invalid source group ID %u", groupid);
+
+    ALCdevice *device{context->mALDevice.get()};
+    switch(param)
+    {
+    case AL_DIRECT_FILTER:
+        if(value)
+        {
+            std::lock_guard<std::mutex> filterlock{device->FilterLock};
+            ALfilter *filter{LookupFilter(device, static_cast<ALuint>(value))};
+            if(!filter) UNLIKELY
+                return context->setError(AL_INVALID_VALUE, "Invalid filter ID %u",
+                    static_cast<ALuint>(value));
+            group->Direct.Gain = filter->Gain;
+            group->Direct.GainHF = filter->GainHF;
+            group->Direct.HFReference = filter->HFReference;
+            group->Direct.GainLF = filter->GainLF;
+            group->Direct.LFReference = filter->LFReference;
+        }
+        else
+        {
+            group->Direct.Gain = 1.0f;
+            group->Direct.GainHF = 1.0f;
+            group->Direct.HFReference = LOWPASSFREQREF;
+            group->Direct.GainLF = 1.0f;
+            group->Direct.LFReference = HIGHPASSFREQREF;
+        }
+        break;
+
+    default:
+        return context->setError(AL_INVALID_ENUM, "Invalid source group integer property 0x%04x",
+            param);
+    }
+    UpdateProps(group, context);
+}
+
+FORCE_ALIGN void AL_APIENTRY alSourceGroup3iDirectSOFT(ALCcontext *context, ALuint groupid,
+    ALenum param, ALint value1, ALint value2, ALint value3) noexcept
+{
+    std::lock_guard<std::mutex> _{context->mPropLock};
+    std::lock_guard<std::mutex> __{context->mSourceGroupLock};
+    ALsourcegroup *group{LookupSourceGroup(context, groupid)};
+    if(!group) UNLIKELY
+        return context->setError(AL_INVALID_NAME, "Invalid source group ID %u", groupid);
+
+    ALCdevice *device{context->mALDevice.get()};
+    switch(param)
+    {
+    case AL_AUXILIARY_SEND_FILTER:
+    {
+        std::lock_guard<std::mutex> slotlock{context->mEffectSlotLock};
+        ALeffectslot *slot{};
+        if(value1)
+        {
+            slot = LookupEffectSlot(context, static_cast<ALuint>(value1));
+            if(!slot) UNLIKELY
+                return context->setError(AL_INVALID_VALUE, "Invalid effect ID %u",
+                    static_cast<ALuint>(value1));
+        }
+
+        if(static_cast<ALuint>(value2) >= device->NumAuxSends) UNLIKELY
+            return context->setError(AL_INVALID_VALUE, "Invalid send %u",
+                static_cast<ALuint>(value2));
+        auto &send = group->Send[static_cast<ALuint>(value2)];
+
+        if(value3)
+        {
+            std::lock_guard<std::mutex> filterlock{device->FilterLock};
+            ALfilter *filter{LookupFilter(device, static_cast<ALuint>(value3))};
+            if(!filter) UNLIKELY
+                return context->setError(AL_INVALID_VALUE, "Invalid filter ID %u",
+                    static_cast<ALuint>(value3));
+            send.Gain = filter->Gain;
+            send.GainHF = filter->GainHF;
+            send.HFReference = filter->HFReference;
+            send.GainLF = filter->GainLF;
+            send.LFReference = filter->LFReference;
+        }
+        else
+        {
+            send.Gain = 1.0f;
+            send.GainHF = 1.0f;
+            send.HFReference = LOWPASSFREQREF;
+            send.GainLF = 1.0f;
+            send.LFReference = HIGHPASSFREQREF;
+        }
+
+        if(slot) IncrementRef(slot->ref);
+        if(auto *oldslot = send.Slot)
+            DecrementRef(oldslot->ref);
+        send.Slot = slot;
+        break;
+    }
+
+    default:
+        return context->setError(AL_INVALID_ENUM,
+            "Invalid source group integer-vector property 0x%04x", param);
+    }
+    UpdateProps(group, context);
+}
+
+FORCE_ALIGN void AL_APIENTRY alGetSourceGroupfDirectSOFT(ALCcontext *context, ALuint groupid,
+    ALenum param, ALfloat *value) noexcept
+{
+    std::lock_guard<std::mutex> _{context->mSourceGroupLock};
+    ALsourcegroup *group{LookupSourceGroup(context, groupid)};
+    if(!group) UNLIKELY
+        return context->setError(AL_INVALID_NAME, "Invalid source group ID %u", groupid);
+    if(!value) UNLIKELY
+        return context->setError(AL_INVALID_VALUE, "NULL pointer");
+
+    switch(param)
+    {
+    case AL_GAIN:
+        *value = group->Gain;
+        break;
+
+    default:
+        context->setError(AL_INVALID_ENUM, "Invalid source group float property 0x%04x", param);
+    }
+}
+
+
+FORCE_ALIGN DECL_FUNCEXT2(void, alGenSourceGroups,SOFT, ALsizei, ALuint*)
+FORCE_ALIGN DECL_FUNCEXT2(void, alDeleteSourceGroups,SOFT, ALsizei, const ALuint*)
+FORCE_ALIGN DECL_FUNCEXT1(ALboolean, alIsSourceGroup,SOFT, ALuint)
+FORCE_ALIGN DECL_FUNCEXT3(void, alSourceGroupf,SOFT, ALuint, ALenum, ALfloat)
+FORCE_ALIGN DECL_FUNCEXT3(void, alSourceGroupi,SOFT, ALuint, ALenum, ALint)
+FORCE_ALIGN DECL_FUNCEXT5(void, alSourceGroup3i,SOFT, ALuint, ALenum, ALint, ALint, ALint)
+FORCE_ALIGN DECL_FUNCEXT3(void, alGetSourceGroupf,SOFT, ALuint, ALenum, ALfloat*)
+
+
+ALsourcegroup::ALsourcegroup(ALCcontext *context)
+{
+    Direct.Gain = 1.0f;
+    Direct.GainHF = 1.0f;
+    Direct.HFReference = LOWPASSFREQREF;
+    Direct.GainLF = 1.0f;
+    Direct.LFReference = HIGHPASSFREQREF;
+    for(auto &send : Send)
+    {
+        send.Slot = nullptr;
+        send.Gain = 1.0f;
+        send.GainHF = 1.0f;
+        send.HFReference = LOWPASSFREQREF;
+        send.GainLF = 1.0f;
+        send.LFReference = HIGHPASSFREQREF;
+    }
+
+    mGroup = context->getSourceGroup();
+    mGroup->InUse = true;
+}
+
+ALsourcegroup::~ALsourcegroup()
+{
+    for(auto &send : Send)
+    {
+        if(send.Slot)
+            DecrementRef(send.Slot->ref);
+        send.Slot = nullptr;
+    }
+
+    /* An unapplied update is still owned by the context's property pool, and
+     * gets freed with it.
+     */
+    if(SourceGroupProps *props{mGroup->Update.exchange(nullptr)})
+        TRACE("Dropped unapplied SourceGroup update %p\n",
+            decltype(std::declval<void*>()){props});
+
+    mGroup->InUse = false;
+}
+
+void ALsourcegroup::updateProps(ALCcontext *context)
+{
+    /* Get an unused property container, or allocate a new one as needed. */
+    SourceGroupProps *props{context->mSourceGroupPropsPool.get()};
+
+    /* Copy in current property values. */
+    props->Gain = Gain;
+    props->Direct.Gain = Direct.Gain;
+    props->Direct.GainHF = Direct.GainHF;
+    props->Direct.HFReference = Direct.HFReference;
+    props->Direct.GainLF = Direct.GainLF;
+    props->Direct.LFReference = Direct.LFReference;
+    for(size_t i{0};i < Send.size();++i)
+    {
+        props->Send[i].Slot = Send[i].Slot ? Send[i].Slot->mSlot : nullptr;
+        props->Send[i].Gain = Send[i].Gain;
+        props->Send[i].GainHF = Send[i].GainHF;
+        props->Send[i].HFReference = Send[i].HFReference;
+        props->Send[i].GainLF = Send[i].GainLF;
+        props->Send[i].LFReference = Send[i].LFReference;
+    }
+
+    /* Set the new container for updating internal parameters. */
+    props = mGroup->Update.exchange(props, std::memory_order_acq_rel);
+    if(props)
+    {
+        /* If there was an unused update container, put it back in the
+         * freelist.
+         */
+        context->mSourceGroupPropsPool.put(props);
+    }
+}
+
+void UpdateAllSourceGroupProps(ALCcontext *context)
+{
+    std::lock_guard<std::mutex> _{context->mSourceGroupLock};
+    for(auto &sublist : context->mSourceGroupList)
+    {
+        uint64_t usemask{~sublist.FreeMask};
+        while(usemask)
+        {
+            const int idx{al::countr_zero(usemask)};
+            usemask &= ~(1_u64 << idx);
+            ALsourcegroup *group{sublist.SourceGroups + idx};
+
+            if(std::exchange(group->mPropsDirty, false))
+                group->updateProps(context);
+        }
+    }
+}
+
+SourceGroupSubList::~SourceGroupSubList()
+{
+    if(!SourceGroups)
+        return;
+
+    uint64_t usemask{~FreeMask};
+    while(usemask)
+    {
+        const int idx{al::countr_zero(usemask)};
+        std::destroy_at(SourceGroups+idx);
+        usemask &= ~(1_u64 << idx);
+    }
+    FreeMask = ~usemask;
+    al_free(SourceGroups);
+    SourceGroups = nullptr;
+}
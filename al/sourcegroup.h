@@ -0,0 +1,61 @@
+#ifndef AL_SOURCEGROUP_H
+#define AL_SOURCEGROUP_H
+
+#include <array>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+
+#include "almalloc.h"
+#include "atomic.h"
+#include "core/voice.h"
+
+struct ALCcontext;
+struct ALeffectslot;
+struct SourceGroup;
+
+
+struct ALsourcegroup {
+    float Gain{1.0f};
+
+    /** Direct filter and auxiliary send info. */
+    struct {
+        float Gain;
+        float GainHF;
+        float HFReference;
+        float GainLF;
+        float LFReference;
+    } Direct;
+    struct SendData {
+        ALeffectslot *Slot;
+        float Gain;
+        float GainHF;
+        float HFReference;
+        float GainLF;
+        float LFReference;
+    };
+    std::array<SendData,MAX_SENDS> Send;
+
+    bool mPropsDirty{true};
+
+    /* The number of sources using the group. */
+    RefCount ref{0u};
+
+    SourceGroup *mGroup{nullptr};
+
+    /* Self ID */
+    ALuint id{};
+
+    ALsourcegroup(ALCcontext *context);
+    ALsourcegroup(const ALsourcegroup&) = delete;
+    ALsourcegroup& operator=(const ALsourcegroup&) = delete;
+    ~ALsourcegroup();
+
+    void updateProps(ALCcontext *context);
+
+    DISABLE_ALLOC()
+};
+
+void UpdateAllSourceGroupProps(ALCcontext *context);
+
+#endif
@@ -42,7 +42,9 @@
 #include "alnumeric.h"
 #include "atomic.h"
 #include "core/context.h"
+#include "core/effectslot.h"
 #include "core/except.h"
+#include "core/logging.h"
 #include "core/mixer/defs.h"
 #include "core/voice.h"
 #include "direct_defs.h"
@@ -153,6 +155,9 @@ enum PropertyValue : ALenum {
     MaxDebugLoggedMessages = AL_MAX_DEBUG_LOGGED_MESSAGES_EXT,
     MaxDebugGroupDepth = AL_MAX_DEBUG_GROUP_STACK_DEPTH_EXT,
     ContextFlags = AL_CONTEXT_FLAGS_EXT,
+    PropertyMemorySize = AL_PROPERTY_MEMORY_SIZE_SOFT,
+    PropertyMemoryFree = AL_PROPERTY_MEMORY_FREE_SOFT,
+    MaxListenerCount = AL_MAX_LISTENERS_SOFT,
 #ifdef ALSOFT_EAX
     EaxRamSize = AL_EAX_RAM_SIZE,
     EaxRamFree = AL_EAX_RAM_FREE,
@@ -174,6 +179,23 @@ struct PropertyCastType<ALboolean> {
 };
 
 
+/* Gets the number of bytes allocated for the context's property containers,
+ * or only those that are unused.
+ */
+size_t GetPropertyMemory(ALCcontext *context, bool unused)
+{
+    std::lock_guard<std::mutex> proplock{context->mPropLock};
+    std::lock_guard<std::mutex> voicelock{context->mVoicePropsLock};
+    if(unused)
+        return context->mContextPropsPool.freeCount()*sizeof(ContextProps)
+            + context->mVoicePropsPool.freeCount()*sizeof(VoicePropsItem)
+            + context->mEffectSlotPropsPool.freeCount()*sizeof(EffectSlotProps);
+    return context->mContextPropsPool.allocCount()*sizeof(ContextProps)
+        + context->mVoicePropsPool.allocCount()*sizeof(VoicePropsItem)
+        + context->mEffectSlotPropsPool.allocCount()*sizeof(EffectSlotProps);
+}
+
+
 template<typename T>
 void GetValue(ALCcontext *context, ALenum pname, T *values)
 {
@@ -249,6 +271,18 @@ void GetValue(ALCcontext *context, ALenum pname, T *values)
         *values = cast_value(context->mContextFlags.to_ulong());
         return;
 
+    case AL_PROPERTY_MEMORY_SIZE_SOFT:
+        *values = cast_value(GetPropertyMemory(context, false));
+        return;
+
+    case AL_PROPERTY_MEMORY_FREE_SOFT:
+        *values = cast_value(GetPropertyMemory(context, true));
+        return;
+
+    case AL_MAX_LISTENERS_SOFT:
+        *values = cast_value(MaxListeners);
+        return;
+
 #ifdef ALSOFT_EAX
 
 #define EAX_ERROR "[alGetInteger] EAX not enabled."
@@ -383,7 +417,7 @@ AL_API R AL_APIENTRY Name##Ext(ALenum pname) noexcept                         \
     R value{};                                                                \
     auto context = GetContextRef();                                           \
     if(!context) UNLIKELY return value;                                       \
-    Name##vDirect##Ext(GetContextRef().get(), pname, &value);                 \
+    Name##vDirect##Ext(context.get(), pname, &value);                         \
     return value;                                                             \
 }                                                                             \
 FORCE_ALIGN R AL_APIENTRY Name##Direct##Ext(ALCcontext *context, ALenum pname) noexcept \
@@ -454,6 +488,14 @@ FORCE_ALIGN void AL_APIENTRY alGetPointervDirectSOFT(ALCcontext *context, ALenum
         *values = context->mEventParam;
         break;
 
+    case AL_EVENT_BATCH_CALLBACK_FUNCTION_SOFT:
+        *values = al::bit_cast<void*>(context->mEventBatchCb);
+        break;
+
+    case AL_EVENT_BATCH_CALLBACK_USER_PARAM_SOFT:
+        *values = context->mEventBatchParam;
+        break;
+
     case AL_DEBUG_CALLBACK_FUNCTION_EXT:
         *values = al::bit_cast<void*>(context->mDebugCb);
         break;
@@ -573,10 +615,27 @@ FORCE_ALIGN void AL_APIENTRY alDeferUpdatesDirectSOFT(ALCcontext *context) noexc
 FORCE_ALIGN void AL_APIENTRY alProcessUpdatesDirectSOFT(ALCcontext *context) noexcept
 {
     std::lock_guard<std::mutex> _{context->mPropLock};
+#ifdef ALSOFT_EAX
+    if(context->mBatchedUpdatesPending.load(std::memory_order_acquire))
+        context->eaxCommitBatch();
+#endif
     context->processUpdates();
 }
 
 
+FORCE_ALIGN void AL_APIENTRY alTrimPropertyMemoryDirectSOFT(ALCcontext *context) noexcept
+{
+    std::lock_guard<std::mutex> proplock{context->mPropLock};
+    std::lock_guard<std::mutex> voicelock{context->mVoicePropsLock};
+
+    const size_t ctxcount{context->mContextPropsPool.trim()};
+    const size_t voicecount{context->mVoicePropsPool.trim()};
+    const size_t slotcount{context->mEffectSlotPropsPool.trim()};
+    TRACE("Trimmed %zu context, %zu voice, and %zu effect slot property objects\n", ctxcount,
+        voicecount, slotcount);
+}
+
+
 FORCE_ALIGN const ALchar* AL_APIENTRY alGetStringiDirectSOFT(ALCcontext *context, ALenum pname, ALsizei index) noexcept
 {
     const ALchar *value{nullptr};
@@ -610,6 +669,7 @@ AL_API DECL_FUNC1(void, alSpeedOfSound, ALfloat)
 AL_API DECL_FUNC1(void, alDistanceModel, ALenum)
 AL_API DECL_FUNCEXT(void, alDeferUpdates,SOFT)
 AL_API DECL_FUNCEXT(void, alProcessUpdates,SOFT)
+AL_API DECL_FUNCEXT(void, alTrimPropertyMemory,SOFT)
 AL_API DECL_FUNCEXT2(const ALchar*, alGetStringi,SOFT, ALenum,ALsizei)
 
 AL_API void AL_APIENTRY alDopplerVelocity(ALfloat value) noexcept
@@ -637,17 +697,7 @@ AL_API void AL_APIENTRY alDopplerVelocity(ALfloat value) noexcept
 void UpdateContextProps(ALCcontext *context)
 {
     /* Get an unused proprty container, or allocate a new one as needed. */
-    ContextProps *props{context->mFreeContextProps.load(std::memory_order_acquire)};
-    if(!props)
-        props = new ContextProps{};
-    else
-    {
-        ContextProps *next;
-        do {
-            next = props->next.load(std::memory_order_relaxed);
-        } while(context->mFreeContextProps.compare_exchange_weak(props, next,
-                std::memory_order_seq_cst, std::memory_order_acquire) == 0);
-    }
+    ContextProps *props{context->mContextPropsPool.get()};
 
     /* Copy in current property values. */
     ALlistener &listener = context->mListener;
@@ -657,6 +707,13 @@ void UpdateContextProps(ALCcontext *context)
     props->OrientUp = listener.OrientUp;
     props->Gain = listener.Gain;
     props->MetersPerUnit = listener.mMetersPerUnit;
+    for(size_t i{0};i < listener.mExtra.size();++i)
+    {
+        const auto &extra = listener.mExtra[i];
+        props->ExtraListeners[i] = ListenerPlacement{extra.Position, extra.Velocity,
+            extra.OrientAt, extra.OrientUp};
+    }
+    props->NumListeners = listener.mNumListeners;
 
     props->AirAbsorptionGainHF = context->mAirAbsorptionGainHF;
     props->DopplerFactor = context->mDopplerFactor;
@@ -673,6 +730,6 @@ void UpdateContextProps(ALCcontext *context)
         /* If there was an unused update container, put it back in the
          * freelist.
          */
-        AtomicReplaceHead(context->mFreeContextProps, props);
+        context->mContextPropsPool.put(props);
     }
 }
@@ -53,6 +53,7 @@
 #include <stddef.h>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -69,8 +70,10 @@
 #include "al/filter.h"
 #include "al/listener.h"
 #include "al/source.h"
+#include "al/sourcegroup.h"
 #include "albit.h"
 #include "alconfig.h"
+#include "althrd_setname.h"
 #include "almalloc.h"
 #include "alnumeric.h"
 #include "alspan.h"
@@ -82,6 +85,7 @@
 #include "core/bformatdec.h"
 #include "core/bs2b.h"
 #include "core/context.h"
+#include "core/converter.h"
 #include "core/cpu_caps.h"
 #include "core/devformat.h"
 #include "core/device.h"
@@ -90,18 +94,23 @@
 #include "core/helpers.h"
 #include "core/mastering.h"
 #include "core/mixer/hrtfdefs.h"
+#include "core/mixer_pool.h"
 #include "core/fpu_ctrl.h"
 #include "core/front_stablizer.h"
+#include "core/hrtf.h"
 #include "core/logging.h"
+#include "core/sourcegroup.h"
 #include "core/uhjfilter.h"
 #include "core/voice.h"
 #include "core/voice_change.h"
 #include "device.h"
 #include "effects/base.h"
+#include "events.h"
 #include "export_list.h"
 #include "inprogext.h"
 #include "intrusive_ptr.h"
 #include "opthelpers.h"
+#include "ringbuffer.h"
 #include "strutils.h"
 
 #include "backends/base.h"
@@ -289,8 +298,9 @@ std::atomic<ALCenum> LastNullDeviceError{ALC_NO_ERROR};
 /* Flag to trap ALC device errors */
 bool TrapALCError{false};
 
-/* One-time configuration init control */
+/* One-time configuration and backend init control */
 std::once_flag alc_config_once{};
+std::once_flag alc_backends_once{};
 
 /* Flag to specify if alcSuspendContext/alcProcessContext should defer/process
  * updates.
@@ -313,6 +323,7 @@ constexpr ALCchar alcNoDeviceExtList[] =
     "ALC_EXT_thread_local_context "
     "ALC_SOFT_loopback "
     "ALC_SOFT_loopback_bformat "
+    "ALC_SOFTX_loopback_planar "
     "ALC_SOFT_reopen_device "
     "ALC_SOFTX_system_events";
 constexpr ALCchar alcExtensionList[] =
@@ -325,15 +336,26 @@ constexpr ALCchar alcExtensionList[] =
     "ALC_EXT_disconnect "
     "ALC_EXT_EFX "
     "ALC_EXT_thread_local_context "
+    "ALC_SOFTX_async_hrtf "
+    "ALC_SOFTX_capture_callback "
+    "ALC_SOFTX_capture_map "
     "ALC_SOFT_device_clock "
     "ALC_SOFT_HRTF "
+    "ALC_SOFTX_hrtf_ambisonic_mixing "
+    "ALC_SOFTX_load_governor "
     "ALC_SOFT_loopback "
     "ALC_SOFT_loopback_bformat "
+    "ALC_SOFTX_loopback_planar "
+    "ALC_SOFTX_memory_stats "
+    "ALC_SOFTX_mixer_profile "
+    "ALC_SOFTX_offline_render "
     "ALC_SOFT_output_limiter "
     "ALC_SOFT_output_mode "
     "ALC_SOFT_pause_device "
     "ALC_SOFT_reopen_device "
-    "ALC_SOFTX_system_events";
+    "ALC_SOFTX_reserve_storage "
+    "ALC_SOFTX_system_events "
+    "ALC_SOFTX_thread_affinity";
 constexpr int alcMajorVersion{1};
 constexpr int alcMinorVersion{1};
 
@@ -353,6 +375,70 @@ std::vector<ALCcontext*> ContextList;
 std::recursive_mutex ListLock;
 
 
+/* Handlers for heap use on the mixer's threads, enabled for debugging with the
+ * rt-alloc-check option.
+ */
+void LogRtAlloc(const char *func, size_t size) noexcept
+{
+    if(size > 0)
+        ERR("%s(%zu) called on a real-time thread\n", func, size);
+    else
+        ERR("%s called on a real-time thread\n", func);
+}
+
+[[noreturn]] void AbortRtAlloc(const char *func, size_t size) noexcept
+{
+    LogRtAlloc(func, size);
+    std::abort();
+}
+
+/* Parses a list of CPU numbers and ranges, e.g. "2,3,6-7". */
+std::vector<uint> ParseCpuList(const std::string &str)
+{
+    std::vector<uint> cpus;
+    size_t pos{0};
+    while(pos < str.size())
+    {
+        const size_t next{std::min(str.find(',', pos), str.size())};
+        const std::string entry{str.substr(pos, next-pos)};
+        pos = next + 1;
+
+        unsigned int first{}, last{};
+        char dummy{};
+        if(std::sscanf(entry.c_str(), " %u - %u %c", &first, &last, &dummy) == 2)
+        {
+            if(last < first || last-first >= 1024)
+            {
+                ERR("Invalid CPU range: %s\n", entry.c_str());
+                continue;
+            }
+        }
+        else if(std::sscanf(entry.c_str(), " %u %c", &first, &dummy) == 1)
+            last = first;
+        else
+        {
+            ERR("Invalid CPU: %s\n", entry.c_str());
+            continue;
+        }
+        for(uint cpu{first};cpu <= last;++cpu)
+            cpus.emplace_back(cpu);
+    }
+    return cpus;
+}
+
+/* Gets the CPUs set in a mask given with device attributes. */
+std::vector<uint> CpusFromMask(const uint mask)
+{
+    std::vector<uint> cpus;
+    for(uint cpu{0};cpu < 32;++cpu)
+    {
+        if((mask>>cpu)&1)
+            cpus.emplace_back(cpu);
+    }
+    return cpus;
+}
+
+
 void alc_initconfig(void)
 {
     if(auto loglevel = al::getenv("ALSOFT_LOGLEVEL"))
@@ -418,7 +504,13 @@ void alc_initconfig(void)
     }
 
     int capfilter{0};
-#if defined(HAVE_SSE4_1)
+#if defined(HAVE_AVX512)
+    capfilter |= CPU_CAP_SSE | CPU_CAP_SSE2 | CPU_CAP_SSE3 | CPU_CAP_SSE4_1 | CPU_CAP_AVX2
+        | CPU_CAP_FMA | CPU_CAP_AVX512 | CPU_CAP_F16C;
+#elif defined(HAVE_AVX2)
+    capfilter |= CPU_CAP_SSE | CPU_CAP_SSE2 | CPU_CAP_SSE3 | CPU_CAP_SSE4_1 | CPU_CAP_AVX2
+        | CPU_CAP_FMA | CPU_CAP_F16C;
+#elif defined(HAVE_SSE4_1)
     capfilter |= CPU_CAP_SSE | CPU_CAP_SSE2 | CPU_CAP_SSE3 | CPU_CAP_SSE4_1;
 #elif defined(HAVE_SSE3)
     capfilter |= CPU_CAP_SSE | CPU_CAP_SSE2 | CPU_CAP_SSE3;
@@ -458,6 +550,14 @@ void alc_initconfig(void)
                     capfilter &= ~CPU_CAP_SSE3;
                 else if(len == 6 && al::strncasecmp(str, "sse4.1", len) == 0)
                     capfilter &= ~CPU_CAP_SSE4_1;
+                else if(len == 4 && al::strncasecmp(str, "avx2", len) == 0)
+                    capfilter &= ~CPU_CAP_AVX2;
+                else if(len == 3 && al::strncasecmp(str, "fma", len) == 0)
+                    capfilter &= ~CPU_CAP_FMA;
+                else if(len == 6 && al::strncasecmp(str, "avx512", len) == 0)
+                    capfilter &= ~CPU_CAP_AVX512;
+                else if(len == 4 && al::strncasecmp(str, "f16c", len) == 0)
+                    capfilter &= ~CPU_CAP_F16C;
                 else if(len == 4 && al::strncasecmp(str, "neon", len) == 0)
                     capfilter &= ~CPU_CAP_NEON;
                 else
@@ -473,11 +573,15 @@ void alc_initconfig(void)
             TRACE("Name: \"%s\"\n", cpuopt->mName.c_str());
         }
         const int caps{cpuopt->mCaps};
-        TRACE("Extensions:%s%s%s%s%s%s\n",
+        TRACE("Extensions:%s%s%s%s%s%s%s%s%s%s\n",
             ((capfilter&CPU_CAP_SSE)    ? ((caps&CPU_CAP_SSE)    ? " +SSE"    : " -SSE")    : ""),
             ((capfilter&CPU_CAP_SSE2)   ? ((caps&CPU_CAP_SSE2)   ? " +SSE2"   : " -SSE2")   : ""),
             ((capfilter&CPU_CAP_SSE3)   ? ((caps&CPU_CAP_SSE3)   ? " +SSE3"   : " -SSE3")   : ""),
             ((capfilter&CPU_CAP_SSE4_1) ? ((caps&CPU_CAP_SSE4_1) ? " +SSE4.1" : " -SSE4.1") : ""),
+            ((capfilter&CPU_CAP_AVX2)   ? ((caps&CPU_CAP_AVX2)   ? " +AVX2"   : " -AVX2")   : ""),
+            ((capfilter&CPU_CAP_FMA)    ? ((caps&CPU_CAP_FMA)    ? " +FMA"    : " -FMA")    : ""),
+            ((capfilter&CPU_CAP_AVX512) ? ((caps&CPU_CAP_AVX512) ? " +AVX512" : " -AVX512") : ""),
+            ((capfilter&CPU_CAP_F16C)   ? ((caps&CPU_CAP_F16C)   ? " +F16C"   : " -F16C")   : ""),
             ((capfilter&CPU_CAP_NEON)   ? ((caps&CPU_CAP_NEON)   ? " +NEON"   : " -NEON")   : ""),
             ((!capfilter) ? " -none-" : ""));
         CPUCapFlags = caps & capfilter;
@@ -487,6 +591,16 @@ void alc_initconfig(void)
         RTPrioLevel = *priopt;
     if(auto limopt = ConfigValueBool(nullptr, nullptr, "rt-time-limit"))
         AllowRTTimeLimit = *limopt;
+    if(auto deadlineopt = ConfigValueBool(nullptr, nullptr, "rt-deadline"))
+        UseRTDeadline = *deadlineopt;
+
+    static constexpr std::array<const char*,ThreadRoleCount> affinityKeys{{
+        "mixer-affinity", "worker-affinity", "event-affinity", "capture-affinity"}};
+    for(size_t i{0};i < ThreadRoleCount;++i)
+    {
+        if(auto cpusopt = ConfigValueStr(nullptr, nullptr, affinityKeys[i]))
+            ThreadAffinity[i] = ParseCpuList(*cpusopt);
+    }
 
     {
         CompatFlagBitset compatflags{};
@@ -532,6 +646,10 @@ void alc_initconfig(void)
         else
             WARN("Unsupported uhj/encode-filter: %s\n", uhjfiltopt->c_str());
     }
+    if(auto fftopt = ConfigValueBool(nullptr, "uhj", "fir-fft"))
+        UhjFirFft = *fftopt;
+    if(auto sharedopt = ConfigValueBool(nullptr, "uhj", "shared-super-stereo"))
+        UhjStereoShared = *sharedopt;
 
     auto traperr = al::getenv("ALSOFT_TRAP_ERROR");
     if(traperr && (al::strcasecmp(traperr->c_str(), "true") == 0
@@ -557,12 +675,116 @@ void alc_initconfig(void)
             TrapALCError = !!GetConfigValueBool(nullptr, nullptr, "trap-alc-error", false);
     }
 
+    auto rtalloc = al::getenv("ALSOFT_RT_ALLOC_CHECK");
+    if(!rtalloc) rtalloc = ConfigValueStr(nullptr, nullptr, "rt-alloc-check");
+    if(rtalloc)
+    {
+        if(al::strcasecmp(rtalloc->c_str(), "log") == 0)
+            al::set_rt_alloc_handler(LogRtAlloc);
+        else if(al::strcasecmp(rtalloc->c_str(), "abort") == 0)
+            al::set_rt_alloc_handler(AbortRtAlloc);
+        else if(al::strcasecmp(rtalloc->c_str(), "false") != 0)
+            WARN("Unsupported rt-alloc-check: %s\n", rtalloc->c_str());
+    }
+
+    if(auto pagesopt = ConfigValueStr(nullptr, nullptr, "huge-pages"))
+    {
+        if(al::strcasecmp(pagesopt->c_str(), "transparent") == 0)
+            DeviceBase::sMixPagePolicy = al::page_policy::Transparent;
+        else if(al::strcasecmp(pagesopt->c_str(), "explicit") == 0)
+            DeviceBase::sMixPagePolicy = al::page_policy::Explicit;
+        else if(al::strcasecmp(pagesopt->c_str(), "false") != 0)
+            WARN("Unsupported huge-pages: %s\n", pagesopt->c_str());
+    }
+
     if(auto boostopt = ConfigValueFloat(nullptr, "reverb", "boost"))
     {
         const float valf{std::isfinite(*boostopt) ? clampf(*boostopt, -24.0f, 24.0f) : 0.0f};
         ReverbBoost *= std::pow(10.0f, valf / 20.0f);
     }
+    if(auto liteopt = ConfigValueBool(nullptr, "reverb", "lite"))
+        ReverbLite = *liteopt;
+    if(auto divopt = ConfigValueUInt(nullptr, "reverb", "late-rate-divisor"))
+    {
+        if(*divopt == 1 || *divopt == 2 || *divopt == 4)
+            ReverbLateDivisor = *divopt;
+        else
+            WARN("Unsupported reverb late-rate-divisor: %u\n", *divopt);
+    }
+    if(auto tailopt = ConfigValueBool(nullptr, "convolution", "tail-thread"))
+        ConvolutionTailThread = *tailopt;
+    if(auto qualityopt = ConfigValueStr(nullptr, "pshifter", "quality"))
+    {
+        if(al::strcasecmp(qualityopt->c_str(), "fast") == 0)
+            PshifterFast = true;
+        else if(al::strcasecmp(qualityopt->c_str(), "high") != 0)
+            WARN("Unsupported pshifter quality: %s\n", qualityopt->c_str());
+    }
+
+    LoopbackBackendFactory::getFactory().init();
+
+    if(auto exclopt = ConfigValueStr(nullptr, nullptr, "excludefx"))
+    {
+        const char *next{exclopt->c_str()};
+        do {
+            const char *str{next};
+            next = strchr(str, ',');
+
+            if(!str[0] || next == str)
+                continue;
+
+            size_t len{next ? static_cast<size_t>(next-str) : strlen(str)};
+            for(const EffectList &effectitem : gEffectList)
+            {
+                if(len == strlen(effectitem.name) &&
+                   strncmp(effectitem.name, str, len) == 0)
+                    DisabledEffects[effectitem.type] = true;
+            }
+        } while(next++);
+    }
+
+    InitEffect(&ALCcontext::sDefaultEffect);
+    auto defrevopt = al::getenv("ALSOFT_DEFAULT_REVERB");
+    if(defrevopt || (defrevopt=ConfigValueStr(nullptr, nullptr, "default-reverb")))
+        LoadReverbPreset(defrevopt->c_str(), &ALCcontext::sDefaultEffect);
+
+#ifdef ALSOFT_EAX
+    {
+        static constexpr char eax_block_name[] = "eax";
+
+        if(const auto eax_enable_opt = ConfigValueBool(nullptr, eax_block_name, "enable"))
+        {
+            eax_g_is_enabled = *eax_enable_opt;
+            if(!eax_g_is_enabled)
+                TRACE("%s\n", "EAX disabled by a configuration.");
+        }
+        else
+            eax_g_is_enabled = true;
+
+        if(const auto eax_batch_opt = ConfigValueBool(nullptr, eax_block_name, "batch-commits"))
+            eax_g_batch_commits = *eax_batch_opt;
+
+        if((DisabledEffects[EAXREVERB_EFFECT] || DisabledEffects[CHORUS_EFFECT])
+            && eax_g_is_enabled)
+        {
+            eax_g_is_enabled = false;
+            TRACE("EAX disabled because %s disabled.\n",
+                (DisabledEffects[EAXREVERB_EFFECT] && DisabledEffects[CHORUS_EFFECT])
+                    ? "EAXReverb and Chorus are" :
+                DisabledEffects[EAXREVERB_EFFECT] ? "EAXReverb is" :
+                DisabledEffects[CHORUS_EFFECT] ? "Chorus is" : "");
+        }
+    }
+#endif // ALSOFT_EAX
+}
 
+/* Initializes the backends, selecting the first usable ones for playback and
+ * capture. This is only done once a device needs to be probed or opened, so
+ * applications that only use loopback devices don't load any backend
+ * libraries or connect to any audio servers.
+ */
+void alc_initbackends(void)
+{
     auto BackendListEnd = std::end(BackendList);
     auto devopt = al::getenv("ALSOFT_DRIVERS");
     if(devopt || (devopt=ConfigValueStr(nullptr, nullptr, "drivers")))
@@ -618,13 +840,46 @@ void alc_initconfig(void)
             BackendListEnd = backendlist_cur;
     }
 
-    auto init_backend = [](BackendInfo &backend) -> void
+    /* When enabled, initialize all the usable backends at once on separate
+     * threads. Backends that need to connect to a server can take a while to
+     * succeed or fail, and this avoids each one waiting on the ones before it.
+     * The backends are still selected in priority order afterward, but every
+     * backend in the list ends up initialized.
+     */
+    const auto numBackends = static_cast<size_t>(BackendListEnd - std::begin(BackendList));
+    std::vector<char> initResults;
+    if(numBackends > 1 && GetConfigValueBool(nullptr, nullptr, "parallel-backend-init", false))
+    {
+        initResults.resize(numBackends, 0);
+
+        std::vector<std::thread> initThreads;
+        initThreads.reserve(numBackends);
+        for(size_t i{0};i < numBackends;++i)
+        {
+            auto do_init = [i,&initResults]() -> void
+            { initResults[i] = BackendList[i].getFactory().init(); };
+            try {
+                initThreads.emplace_back(do_init);
+            }
+            catch(std::exception &e) {
+                WARN("Failed to start init thread for \"%s\": %s\n", BackendList[i].name,
+                    e.what());
+                do_init();
+            }
+        }
+        for(auto &thrd : initThreads)
+            thrd.join();
+    }
+
+    auto init_backend = [&initResults](BackendInfo &backend) -> void
     {
         if(PlaybackFactory && CaptureFactory)
             return;
 
         BackendFactory &factory = backend.getFactory();
-        if(!factory.init())
+        const bool initialized{initResults.empty() ? factory.init()
+            : static_cast<bool>(initResults[static_cast<size_t>(&backend - BackendList)])};
+        if(!initialized)
         {
             WARN("Failed to initialize backend \"%s\"\n", backend.name);
             return;
@@ -644,74 +899,28 @@ void alc_initconfig(void)
     };
     std::for_each(std::begin(BackendList), BackendListEnd, init_backend);
 
-    LoopbackBackendFactory::getFactory().init();
-
     if(!PlaybackFactory)
         WARN("No playback backend available!\n");
     if(!CaptureFactory)
         WARN("No capture backend available!\n");
-
-    if(auto exclopt = ConfigValueStr(nullptr, nullptr, "excludefx"))
-    {
-        const char *next{exclopt->c_str()};
-        do {
-            const char *str{next};
-            next = strchr(str, ',');
-
-            if(!str[0] || next == str)
-                continue;
-
-            size_t len{next ? static_cast<size_t>(next-str) : strlen(str)};
-            for(const EffectList &effectitem : gEffectList)
-            {
-                if(len == strlen(effectitem.name) &&
-                   strncmp(effectitem.name, str, len) == 0)
-                    DisabledEffects[effectitem.type] = true;
-            }
-        } while(next++);
-    }
-
-    InitEffect(&ALCcontext::sDefaultEffect);
-    auto defrevopt = al::getenv("ALSOFT_DEFAULT_REVERB");
-    if(defrevopt || (defrevopt=ConfigValueStr(nullptr, nullptr, "default-reverb")))
-        LoadReverbPreset(defrevopt->c_str(), &ALCcontext::sDefaultEffect);
-
-#ifdef ALSOFT_EAX
-    {
-        static constexpr char eax_block_name[] = "eax";
-
-        if(const auto eax_enable_opt = ConfigValueBool(nullptr, eax_block_name, "enable"))
-        {
-            eax_g_is_enabled = *eax_enable_opt;
-            if(!eax_g_is_enabled)
-                TRACE("%s\n", "EAX disabled by a configuration.");
-        }
-        else
-            eax_g_is_enabled = true;
-
-        if((DisabledEffects[EAXREVERB_EFFECT] || DisabledEffects[CHORUS_EFFECT])
-            && eax_g_is_enabled)
-        {
-            eax_g_is_enabled = false;
-            TRACE("EAX disabled because %s disabled.\n",
-                (DisabledEffects[EAXREVERB_EFFECT] && DisabledEffects[CHORUS_EFFECT])
-                    ? "EAXReverb and Chorus are" :
-                DisabledEffects[EAXREVERB_EFFECT] ? "EAXReverb is" :
-                DisabledEffects[CHORUS_EFFECT] ? "Chorus is" : "");
-        }
-    }
-#endif // ALSOFT_EAX
 }
+
 inline void InitConfig()
 { std::call_once(alc_config_once, [](){alc_initconfig();}); }
 
+inline void InitBackends()
+{
+    InitConfig();
+    std::call_once(alc_backends_once, [](){alc_initbackends();});
+}
+
 
 /************************************************
  * Device enumeration
  ************************************************/
 void ProbeAllDevicesList()
 {
-    InitConfig();
+    InitBackends();
 
     std::lock_guard<std::recursive_mutex> _{ListLock};
     if(!PlaybackFactory)
@@ -725,7 +934,7 @@ void ProbeAllDevicesList()
 }
 void ProbeCaptureDeviceList()
 {
-    InitConfig();
+    InitBackends();
 
     std::lock_guard<std::recursive_mutex> _{ListLock};
     if(!CaptureFactory)
@@ -956,14 +1165,14 @@ const std::array<InputRemixMap,1> X71Downmix{{
 }};
 
 
-std::unique_ptr<Compressor> CreateDeviceLimiter(const ALCdevice *device, const float threshold)
+std::unique_ptr<Compressor> CreateDeviceLimiter(const ALCdevice *device, const float threshold,
+    const bool lookahead)
 {
     static constexpr bool AutoKnee{true};
     static constexpr bool AutoAttack{true};
     static constexpr bool AutoRelease{true};
     static constexpr bool AutoPostGain{true};
     static constexpr bool AutoDeclip{true};
-    static constexpr float LookAheadTime{0.001f};
     static constexpr float HoldTime{0.002f};
     static constexpr float PreGainDb{0.0f};
     static constexpr float PostGainDb{0.0f};
@@ -972,11 +1181,83 @@ std::unique_ptr<Compressor> CreateDeviceLimiter(const ALCdevice *device, const f
     static constexpr float AttackTime{0.02f};
     static constexpr float ReleaseTime{0.2f};
 
-    return Compressor::Create(device->RealOut.Buffer.size(), static_cast<float>(device->Frequency),
-        AutoKnee, AutoAttack, AutoRelease, AutoPostGain, AutoDeclip, LookAheadTime, HoldTime,
-        PreGainDb, PostGainDb, threshold, Ratio, KneeDb, AttackTime, ReleaseTime);
+    /* Without the look-ahead, the limiter adds no latency and skips the peak
+     * hold, at the cost of letting the leading edge of fast transients clip.
+     */
+    const float LookAheadTime{lookahead ? 0.001f : 0.0f};
+
+    return Compressor::Create(device->RealOut.Buffer.size(),
+        static_cast<float>(device->MixFrequency), AutoKnee, AutoAttack, AutoRelease,
+        AutoPostGain, AutoDeclip, LookAheadTime, HoldTime, PreGainDb, PostGainDb, threshold,
+        Ratio, KneeDb, AttackTime, ReleaseTime);
+}
+
+/**
+ * Creates the output limiter for the device's current output format, if
+ * enabled by the given option (the config option or sample type default when
+ * unset).
+ */
+std::unique_ptr<Compressor> CreateOutputLimiter(ALCdevice *device,
+    std::optional<bool> optlimit)
+{
+    if(!optlimit)
+        optlimit = device->configValue<bool>(nullptr, "output-limiter");
+
+    /* If the gain limiter is unset, use the limiter for integer-based output
+     * (where samples must be clamped), and don't for floating-point (which can
+     * take unclamped samples).
+     */
+    if(!optlimit)
+    {
+        switch(device->FmtType)
+        {
+        case DevFmtByte:
+        case DevFmtUByte:
+        case DevFmtShort:
+        case DevFmtUShort:
+        case DevFmtInt:
+        case DevFmtUInt:
+            optlimit = true;
+            break;
+        case DevFmtFloat:
+            break;
+        }
+    }
+    if(optlimit.value_or(false) == false)
+    {
+        TRACE("Output limiter disabled\n");
+        return nullptr;
+    }
+
+    float thrshld{1.0f};
+    switch(device->FmtType)
+    {
+    case DevFmtByte:
+    case DevFmtUByte:
+        thrshld = 127.0f / 128.0f;
+        break;
+    case DevFmtShort:
+    case DevFmtUShort:
+        thrshld = 32767.0f / 32768.0f;
+        break;
+    case DevFmtInt:
+    case DevFmtUInt:
+    case DevFmtFloat:
+        break;
+    }
+    if(device->DitherDepth > 0.0f)
+        thrshld -= 1.0f / device->DitherDepth;
+
+    const float thrshld_dB{std::log10(thrshld) * 20.0f};
+    const bool lookahead{device->configValue<bool>(nullptr, "output-limiter-lookahead")
+        .value_or(true)};
+    auto limiter = CreateDeviceLimiter(device, thrshld_dB, lookahead);
+    TRACE("Output limiter enabled, %.4fdB limit, %d sample look-ahead\n", thrshld_dB,
+        limiter->getLookAhead());
+    return limiter;
 }
 
+
 /**
  * Updates the device's base clock time with however many samples have been
  * done. This is used so frequency changes on the device don't cause the time
@@ -986,7 +1267,7 @@ std::unique_ptr<Compressor> CreateDeviceLimiter(const ALCdevice *device, const f
 inline void UpdateClockBase(ALCdevice *device)
 {
     IncrementRef(device->MixCount);
-    device->ClockBase += nanoseconds{seconds{device->SamplesDone}} / device->Frequency;
+    device->ClockBase += nanoseconds{seconds{device->SamplesDone}} / device->MixFrequency;
     device->SamplesDone = 0;
     IncrementRef(device->MixCount);
 }
@@ -1016,6 +1297,7 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
     uint period_size{DEFAULT_UPDATE_SIZE};
     uint buffer_size{DEFAULT_UPDATE_SIZE * DEFAULT_NUM_UPDATES};
     int hrtf_id{-1};
+    std::optional<uint> opthrtforder;
     uint aorder{0u};
 
     if(device->Type != DeviceType::Loopback)
@@ -1157,6 +1439,8 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
         ALenum outmode{ALC_ANY_SOFT};
         std::optional<bool> opthrtf;
         int freqAttr{};
+        uint mixerMask{0u}, workerMask{0u};
+        bool offline{false};
 
 #define ATTRIBUTE(a) a: TRACE("%s = %d\n", #a, attrList[attrIdx + 1]);
         size_t attrIdx{0};
@@ -1222,6 +1506,11 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
                 hrtf_id = attrList[attrIdx + 1];
                 break;
 
+            case ATTRIBUTE(ALC_HRTF_AMBISONIC_ORDER_SOFT)
+                opthrtforder = static_cast<uint>(clampi(attrList[attrIdx + 1], 0,
+                    MaxAmbiOrder));
+                break;
+
             case ATTRIBUTE(ALC_OUTPUT_LIMITER_SOFT)
                 if(attrList[attrIdx + 1] == ALC_FALSE)
                     optlimit = false;
@@ -1235,6 +1524,19 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
                 outmode = attrList[attrIdx + 1];
                 break;
 
+            case ATTRIBUTE(ALC_MIXER_AFFINITY_SOFT)
+                mixerMask = static_cast<uint>(attrList[attrIdx + 1]);
+                break;
+
+            case ATTRIBUTE(ALC_WORKER_AFFINITY_SOFT)
+                workerMask = static_cast<uint>(attrList[attrIdx + 1]);
+                break;
+
+            case ATTRIBUTE(ALC_OFFLINE_RENDER_SOFT)
+                if(device->Type == DeviceType::Loopback)
+                    offline = (attrList[attrIdx + 1] == ALC_TRUE);
+                break;
+
             default:
                 TRACE("0x%04X = %d (0x%x)\n", attrList[attrIdx],
                     attrList[attrIdx + 1], attrList[attrIdx + 1]);
@@ -1245,6 +1547,10 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
         }
 #undef ATTRIBUTE
 
+        device->mMixerAffinity = CpusFromMask(mixerMask);
+        device->mWorkerAffinity = CpusFromMask(workerMask);
+        device->mOfflineRender = offline;
+
         if(device->Type == DeviceType::Loopback)
         {
             if(!optchans || !opttype)
@@ -1352,14 +1658,17 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
     device->AvgSpeakerDist = 0.0f;
     device->mNFCtrlFilter = NfcFilter{};
     device->mUhjEncoder = nullptr;
+    device->mUhjStereoBus = nullptr;
     device->AmbiDecoder = nullptr;
     device->Bs2b = nullptr;
     device->PostProcess = nullptr;
 
     device->Limiter = nullptr;
     device->ChannelDelays = nullptr;
+    device->mOutputUpsampler = nullptr;
+    device->mMixerPool = nullptr;
 
-    std::fill(std::begin(device->HrtfAccumData), std::end(device->HrtfAccumData), float2{});
+    std::fill_n(device->HrtfAccumData, device->HrtfAccumSize, float2{});
 
     device->Dry.AmbiMap.fill(BFChannelConfig{});
     device->Dry.Buffer = {};
@@ -1367,14 +1676,16 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
     device->RealOut.RemixMap = {};
     device->RealOut.ChannelIndex.fill(InvalidChannelIndex);
     device->RealOut.Buffer = {};
-    device->MixBuffer.clear();
-    device->MixBuffer.shrink_to_fit();
+    device->MixBuffer = {};
+    device->mClusterBuffer = {};
+    device->mMixBufferStorage.reset();
 
     UpdateClockBase(device);
     device->FixedLatency = nanoseconds::zero();
 
     device->DitherDepth = 0.0f;
     device->DitherSeed = DitherRNGSeed;
+    device->mIdleSamples = 0;
 
     device->mHrtfStatus = ALC_HRTF_DISABLED_SOFT;
 
@@ -1469,6 +1780,18 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
         DevFmtChannelsString(device->FmtChans), DevFmtTypeString(device->FmtType),
         device->Frequency, device->UpdateSize, device->BufferSize);
 
+    /* The device can mix at a lower rate than it outputs, upsampling the
+     * finished mix once instead of running every voice, effect, and HRTF
+     * filter at the higher rate.
+     */
+    device->MixFrequency = device->Frequency;
+    if(auto mixrateopt = device->configValue<uint>(nullptr, "mix-rate"))
+    {
+        const uint mixrate{clampu(*mixrateopt, MIN_OUTPUT_RATE, MAX_OUTPUT_RATE)};
+        if(mixrate < device->Frequency)
+            device->MixFrequency = mixrate;
+    }
+
     if(device->Type != DeviceType::Loopback)
     {
         if(auto modeopt = device->configValue<std::string>(nullptr, "stereo-mode"))
@@ -1483,7 +1806,169 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
         }
     }
 
-    aluInitRenderer(device, hrtf_id, stereomode);
+    device->mVirtualVoices = device->configValue<bool>(nullptr, "virtual-voices").value_or(true);
+    device->mProfileVoices = device->configValue<bool>(nullptr, "voice-profiling")
+        .value_or(false);
+    device->mVoiceLod = device->configValue<bool>(nullptr, "voice-lod").value_or(false);
+    device->mCallbackPrefetch = minu(device->configValue<uint>(nullptr, "callback-prefetch")
+        .value_or(0u), 64u);
+    /* Prefetching could fall behind when rendering offline, so callbacks are
+     * called by the mixer as it needs them.
+     */
+    if(device->mOfflineRender)
+        device->mCallbackPrefetch = 0u;
+    device->mConvertBuffers = device->configValue<bool>(nullptr, "convert-buffers")
+        .value_or(false);
+    device->mShareBuffers = device->configValue<bool>(nullptr, "share-buffers")
+        .value_or(false);
+
+    device->mProfile.reset();
+    device->mProfileHistory = nullptr;
+    device->mProfileHistoryMemory.reset();
+
+    device->mGovernor.reset();
+    device->mGovernor.mMinQuality = MixQuality::Full;
+    if(auto govopt = device->configValue<std::string>(nullptr, "quality-governor"))
+    {
+        const char *level{govopt->c_str()};
+        if(al::strcasecmp(level, "resampler") == 0)
+            device->mGovernor.mMinQuality = MixQuality::FastResampler;
+        else if(al::strcasecmp(level, "linear") == 0)
+            device->mGovernor.mMinQuality = MixQuality::LinearResampler;
+        else if(al::strcasecmp(level, "voices") == 0 || al::strcasecmp(level, "true") == 0)
+            device->mGovernor.mMinQuality = MixQuality::VoiceLimit;
+        else if(al::strcasecmp(level, "false") != 0)
+            ERR("Unexpected quality-governor: %s\n", level);
+    }
+    if(auto limitopt = device->configValue<uint>(nullptr, "quality-voice-limit"))
+        device->mGovernor.mVoiceLimit = maxu(*limitopt, 1u);
+    /* The governor reacts to how long the mixes take, which would make the
+     * offline output depend on the system's load.
+     */
+    if(device->mOfflineRender)
+        device->mGovernor.mMinQuality = MixQuality::Full;
+    if(device->mGovernor.mMinQuality != MixQuality::Full)
+        TRACE("Quality governor: down to level %u (%u voices)\n",
+            al::to_underlying(device->mGovernor.mMinQuality), device->mGovernor.mVoiceLimit);
+    if(auto histopt = device->configValue<uint>(nullptr, "mixer-profile-history"))
+    {
+        if(const uint count{minu(*histopt, 65536)})
+        {
+            device->mProfileHistory = RingBuffer::Create(count, sizeof(MixerProfileRecord),
+                true);
+            device->mProfileHistoryMemory.set(device->mMemoryStats, MemCategory::RingBuffers,
+                device->mProfileHistory->memoryUsage());
+            TRACE("Mixer profile history: %u mixes\n", count);
+        }
+    }
+
+    /* The send count and voice clustering set how many cluster lines the
+     * mixing buffers need.
+     */
+    if(auto sendsopt = device->configValue<int>(nullptr, "sends"))
+        numSends = minu(numSends, static_cast<uint>(clampi(*sendsopt, 0, MAX_SENDS)));
+    device->NumAuxSends = numSends;
+
+    device->mClusterDistance = maxf(device->configValue<float>(nullptr, "cluster-distance")
+        .value_or(0.0f), 0.0f);
+    if(device->mClusterDistance > 0.0f)
+        TRACE("Clustering voices past %gm\n", device->mClusterDistance);
+
+    device->mHrtfHysteresis = 2.0f;
+    if(auto hystopt = device->configValue<float>(nullptr, "hrtf-hysteresis"))
+    {
+        const float degrees{clampf(*hystopt, 0.0f, 30.0f)};
+        if(degrees > 0.0f)
+        {
+            device->mHrtfHysteresis = std::cos(degrees * al::numbers::pi_v<float>/180.0f);
+            TRACE("HRTF filters updated for moves over %g degrees\n", degrees);
+        }
+    }
+
+    /* Voices can optionally be mixed using multiple threads, which needs to be
+     * set before the mixing buffers are allocated.
+     */
+    device->mNumMixThreads = 1;
+    if(auto threadsopt = device->configValue<uint>(nullptr, "mixer-threads"))
+    {
+        uint numthreads{*threadsopt};
+        if(numthreads == 0)
+            numthreads = std::thread::hardware_concurrency();
+        device->mNumMixThreads = clampu(numthreads, 1, MaxMixThreads);
+    }
+    else if(device->mOfflineRender)
+    {
+        /* Offline rendering isn't competing with anything for the CPU, so it
+         * uses all the cores by default. The parallel mix is combined in a
+         * fixed order, keeping the output the same.
+         */
+        device->mNumMixThreads = clampu(std::thread::hardware_concurrency(), 1, MaxMixThreads);
+    }
+
+    aluInitRenderer(device, hrtf_id, opthrtforder, stereomode);
+    device->updateHrtfMemory();
+
+    if(device->MixFrequency != device->Frequency)
+    {
+        device->mOutputUpsampler = OutputUpsampler::Create(device->RealOut.Buffer.size(),
+            device->MixFrequency, device->Frequency);
+        TRACE("Mixing at %uhz, upsampled to %uhz\n", device->MixFrequency, device->Frequency);
+    }
+
+    if(device->mNumMixThreads > 1)
+    {
+        try {
+            device->mMixerPool = std::make_unique<MixerPool>(device, device->mNumMixThreads);
+        }
+        catch(std::exception &e) {
+            ERR("Failed to start mixer worker threads: %s\n", e.what());
+        }
+    }
+    TRACE("Mixer threads: %u\n", device->mMixerPool ? device->mMixerPool->size() : 1u);
+
+    /* Each mixing thread gets its own resample cache, cleared here since the
+     * device's sample rate may have changed.
+     */
+    {
+        const uint cachekb{device->configValue<uint>(nullptr, "resample-cache").value_or(0u)};
+        const size_t numEntries{size_t{cachekb} * 1024u / sizeof(ResampleCache::Entry)};
+        auto resize_caches = [device](const size_t count)
+        {
+            device->mMixScratch.mResampleCache.resize(count);
+            if(MixerPool *pool{device->mMixerPool.get()})
+            {
+                for(uint i{1};i < pool->size();++i)
+                    pool->getScratch(i).mResampleCache.resize(count);
+            }
+        };
+        try {
+            resize_caches(numEntries);
+        }
+        catch(std::exception &e) {
+            ERR("Failed to allocate resample cache: %s\n", e.what());
+            resize_caches(0);
+        }
+        if(device->mMixScratch.mResampleCache.enabled())
+            TRACE("Resample cache: %zu entries per thread\n",
+                device->mMixScratch.mResampleCache.mEntries.size());
+    }
+
+    /* Super Stereo voices can have their phase-shift filtering done together
+     * on a shared bus, which needs a copy for each mixing thread.
+     */
+    if(UhjStereoShared && UhjDecodeQuality != UhjQualityType::IIR)
+    {
+        const size_t numThreads{device->mMixerPool ? device->mMixerPool->size() : 1u};
+        try {
+            device->mUhjStereoBus = UhjStereoBusBase::Create(UhjDecodeQuality,
+                device->Dry.Buffer.size(), numThreads);
+        }
+        catch(std::exception &e) {
+            ERR("Failed to allocate shared Super Stereo bus: %s\n", e.what());
+        }
+        if(device->mUhjStereoBus)
+            TRACE("Using shared Super Stereo phase-shift bus\n");
+    }
 
     /* Calculate the max number of sources, and split them between the mono and
      * stereo count given the requested number of stereo sources.
@@ -1504,9 +1989,16 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
     device->NumMonoSources = numMono;
     device->NumStereoSources = numStereo;
 
-    if(auto sendsopt = device->configValue<int>(nullptr, "sends"))
-        numSends = minu(numSends, static_cast<uint>(clampi(*sendsopt, 0, MAX_SENDS)));
-    device->NumAuxSends = numSends;
+    device->Flags.set(ShareReverbSlots, device->getConfigValueBool("reverb", "share-slots",
+        false));
+
+    if(auto poolopt = device->configValue<uint>(nullptr, "effect-state-pool"))
+    {
+        std::lock_guard<std::mutex> _{device->EffectStatePoolLock};
+        device->EffectStatePoolSize = *poolopt;
+        if(device->EffectStatePoolSize == 0)
+            device->EffectStatePool.clear();
+    }
 
     TRACE("Max sources: %d (%d + %d), effect slots: %d, sends: %d\n",
         device->SourcesMax, device->NumMonoSources, device->NumStereoSources,
@@ -1531,6 +2023,8 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
     nanoseconds::rep sample_delay{0};
     if(auto *encoder{device->mUhjEncoder.get()})
         sample_delay += encoder->getDelay();
+    if(device->mOutputUpsampler)
+        sample_delay += OutputUpsampler::getDelay();
 
     if(device->getConfigValueBool(nullptr, "dither", true))
     {
@@ -1560,68 +2054,32 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
             device->DitherDepth = std::pow(2.0f, static_cast<float>(depth-1));
         }
     }
+    device->mLowPrecisionMix = false;
+    if(device->getConfigValueBool(nullptr, "low-precision-mixing", false))
+    {
+        if((device->FmtType == DevFmtShort || device->FmtType == DevFmtUShort)
+            && device->FmtChans == DevFmtStereo)
+            device->mLowPrecisionMix = true;
+        else
+            WARN("Low-precision mixing needs 16-bit stereo output, got %s %s\n",
+                DevFmtChannelsString(device->FmtChans), DevFmtTypeString(device->FmtType));
+    }
+    TRACE("Low-precision mixing %s\n", device->mLowPrecisionMix ? "enabled" : "disabled");
+
     if(!(device->DitherDepth > 0.0f))
         TRACE("Dithering disabled\n");
     else
         TRACE("Dithering enabled (%d-bit, %g)\n", float2int(std::log2(device->DitherDepth)+0.5f)+1,
               device->DitherDepth);
 
-    if(!optlimit)
-        optlimit = device->configValue<bool>(nullptr, "output-limiter");
-
-    /* If the gain limiter is unset, use the limiter for integer-based output
-     * (where samples must be clamped), and don't for floating-point (which can
-     * take unclamped samples).
-     */
-    if(!optlimit)
+    if(auto limiter = CreateOutputLimiter(device, optlimit))
     {
-        switch(device->FmtType)
-        {
-        case DevFmtByte:
-        case DevFmtUByte:
-        case DevFmtShort:
-        case DevFmtUShort:
-        case DevFmtInt:
-        case DevFmtUInt:
-            optlimit = true;
-            break;
-        case DevFmtFloat:
-            break;
-        }
-    }
-    if(optlimit.value_or(false) == false)
-        TRACE("Output limiter disabled\n");
-    else
-    {
-        float thrshld{1.0f};
-        switch(device->FmtType)
-        {
-        case DevFmtByte:
-        case DevFmtUByte:
-            thrshld = 127.0f / 128.0f;
-            break;
-        case DevFmtShort:
-        case DevFmtUShort:
-            thrshld = 32767.0f / 32768.0f;
-            break;
-        case DevFmtInt:
-        case DevFmtUInt:
-        case DevFmtFloat:
-            break;
-        }
-        if(device->DitherDepth > 0.0f)
-            thrshld -= 1.0f / device->DitherDepth;
-
-        const float thrshld_dB{std::log10(thrshld) * 20.0f};
-        auto limiter = CreateDeviceLimiter(device, thrshld_dB);
-
         sample_delay += limiter->getLookAhead();
         device->Limiter = std::move(limiter);
-        TRACE("Output limiter enabled, %.4fdB limit\n", thrshld_dB);
     }
 
     /* Convert the sample delay from samples to nanosamples to nanoseconds. */
-    device->FixedLatency += nanoseconds{seconds{sample_delay}} / device->Frequency;
+    device->FixedLatency += nanoseconds{seconds{sample_delay}} / device->MixFrequency;
     TRACE("Fixed device latency: %" PRId64 "ns\n", int64_t{device->FixedLatency.count()});
 
     FPUCtl mixer_mode{};
@@ -1645,6 +2103,7 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
         auto slotcluster_iter = std::remove_if(context->mEffectSlotClusters.begin(),
             context->mEffectSlotClusters.end(), slot_cluster_not_in_use);
         context->mEffectSlotClusters.erase(slotcluster_iter, context->mEffectSlotClusters.end());
+        context->reserveStorage();
 
         /* Free all wet buffers. Any in use will be reallocated with an updated
          * configuration in aluInitEffectPanning.
@@ -1653,8 +2112,9 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
         {
             for(size_t i{0};i < ContextBase::EffectSlotClusterSize;++i)
             {
-                slots[i].mWetBuffer.clear();
-                slots[i].mWetBuffer.shrink_to_fit();
+                slots[i].mWetBuffer = {};
+                slots[i].mWetBufferStorage.reset();
+                slots[i].mWetBufferMemory.reset();
                 slots[i].Wet.Buffer = {};
             }
         }
@@ -1688,10 +2148,59 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
                 slot->updateProps(context);
             }
         }
-        slotlock.unlock();
+        slotlock.unlock();
+
+        const uint num_sends{device->NumAuxSends};
+        std::unique_lock<std::mutex> grouplock{context->mSourceGroupLock};
+        /* Free all group buffers too, reallocating them for the groups in use
+         * in aluInitSourceGroupPanning.
+         */
+        for(auto &groups : context->mSourceGroupClusters)
+        {
+            for(size_t i{0};i < ContextBase::SourceGroupClusterSize;++i)
+            {
+                groups[i].mWetBuffer = {};
+                groups[i].mWetBufferStorage.reset();
+                groups[i].mWetBufferMemory.reset();
+                groups[i].Wet.Buffer = {};
+            }
+        }
+        for(auto &sublist : context->mSourceGroupList)
+        {
+            uint64_t usemask{~sublist.FreeMask};
+            while(usemask)
+            {
+                const int idx{al::countr_zero(usemask)};
+                ALsourcegroup *group{sublist.SourceGroups + idx};
+                usemask &= ~(1_u64 << idx);
+
+                auto clear_send = [](ALsourcegroup::SendData &send) -> void
+                {
+                    if(send.Slot)
+                        DecrementRef(send.Slot->ref);
+                    send.Slot = nullptr;
+                    send.Gain = 1.0f;
+                    send.GainHF = 1.0f;
+                    send.HFReference = LOWPASSFREQREF;
+                    send.GainLF = 1.0f;
+                    send.LFReference = HIGHPASSFREQREF;
+                };
+                auto send_begin = group->Send.begin() + static_cast<ptrdiff_t>(num_sends);
+                std::for_each(send_begin, group->Send.end(), clear_send);
+
+                aluInitSourceGroupPanning(group->mGroup, context);
+                group->mPropsDirty = false;
+                group->updateProps(context);
+            }
+        }
+        grouplock.unlock();
 
-        const uint num_sends{device->NumAuxSends};
         std::unique_lock<std::mutex> srclock{context->mSourceLock};
+        /* Keep out lock-free source updates while the sends and voice
+         * property containers are being cleared.
+         */
+        std::optional<SourceWriteGuard> srcguard;
+        srcguard.emplace(context);
         for(auto &sublist : context->mSourceList)
         {
             uint64_t usemask{~sublist.FreeMask};
@@ -1727,14 +2236,9 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
                 VoiceProps::SendData{});
 
             std::fill(voice->mSend.begin()+num_sends, voice->mSend.end(), Voice::TargetData{});
-            for(auto &chandata : voice->mChans)
-            {
-                std::fill(chandata.mWetParams.begin()+num_sends, chandata.mWetParams.end(),
-                    SendParams{});
-            }
 
             if(VoicePropsItem *props{voice->mUpdate.exchange(nullptr, std::memory_order_relaxed)})
-                AtomicReplaceHead(context->mFreeVoiceProps, props);
+                context->mVoicePropsPool.put(props);
 
             /* Force the voice to stopped if it was stopping. */
             Voice::State vstate{Voice::Stopping};
@@ -1746,8 +2250,9 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
             voice->prepare(device);
         }
         /* Clear all voice props to let them get allocated again. */
-        context->mVoicePropClusters.clear();
-        context->mFreeVoiceProps.store(nullptr, std::memory_order_relaxed);
+        context->mVoicePropsPool.clear();
+        context->mVoicePropsPool.reserve(context->mReservedProps);
+        srcguard.reset();
         srclock.unlock();
 
         context->mPropsDirty = false;
@@ -1798,17 +2303,24 @@ bool ResetDeviceParams(ALCdevice *device, const int *attrList)
              * clean restart.
              */
             std::lock_guard<std::mutex> __{ctx->mSourceLock};
+            SourceWriteGuard srcguard{ctx};
             auto *vchg = ctx->mCurrentVoiceChange.load(std::memory_order_acquire);
             while(auto *next = vchg->mNext.load(std::memory_order_acquire))
                 vchg = next;
             ctx->mCurrentVoiceChange.store(vchg, std::memory_order_release);
 
-            ctx->mVoicePropClusters.clear();
-            ctx->mFreeVoiceProps.store(nullptr, std::memory_order_relaxed);
+            ctx->mVoicePropsPool.clear();
+            ctx->mVoicePropsPool.reserve(ctx->mReservedProps);
 
+            ctx->mFreeVoices.store(nullptr, std::memory_order_relaxed);
+            if(auto *oldvoices = ctx->mVoices.exchange(nullptr, std::memory_order_relaxed))
+                ctx->mRetiredVoices.emplace_back(oldvoices);
             ctx->mVoiceClusters.clear();
-            ctx->allocVoices(std::max<size_t>(256,
-                ctx->mActiveVoiceCount.load(std::memory_order_relaxed)));
+            ctx->freeRetiredVoices();
+            ctx->allocVoices(std::max<size_t>({256, ctx->mReservedVoices,
+                ctx->mActiveVoiceCount.load(std::memory_order_relaxed)}));
+            for(Voice *voice : ctx->getVoicesSpan())
+                ctx->pushFreeVoice(voice);
         }
 
         device->Connected.store(true);
@@ -1851,6 +2363,289 @@ ContextRef VerifyContext(ALCcontext *context)
     return nullptr;
 }
 
+
+/**
+ * Checks if the attributes request an asynchronous reset that only selects an
+ * HRTF, returning the requested HRTF ID (-1 for the default) if so.
+ */
+std::optional<int> GetAsyncHrtfId(const int *attrList)
+{
+    if(!attrList) return std::nullopt;
+
+    bool async{false};
+    int hrtf_id{-1};
+    for(size_t attrIdx{0};attrList[attrIdx];attrIdx += 2)
+    {
+        const int value{attrList[attrIdx + 1]};
+        switch(attrList[attrIdx])
+        {
+        case ALC_HRTF_ASYNC_SOFT:
+            async = (value == ALC_TRUE);
+            break;
+        case ALC_HRTF_SOFT:
+            if(value != ALC_TRUE && value != ALC_DONT_CARE_SOFT)
+                return std::nullopt;
+            break;
+        case ALC_HRTF_ID_SOFT:
+            hrtf_id = value;
+            break;
+        default:
+            return std::nullopt;
+        }
+    }
+    if(!async) return std::nullopt;
+    return hrtf_id;
+}
+
+/**
+ * Checks if the attributes for a reset only change the output limiter, with
+ * any other attributes matching the device's current setup. Returns the
+ * ALC_OUTPUT_LIMITER_SOFT value if so.
+ */
+std::optional<int> GetLimiterOnlyChange(const ALCdevice *device, const int *attrList)
+{
+    if(!attrList) return std::nullopt;
+
+    std::optional<int> limitValue;
+    for(size_t attrIdx{0};attrList[attrIdx];attrIdx += 2)
+    {
+        const int value{attrList[attrIdx + 1]};
+        switch(attrList[attrIdx])
+        {
+        case ALC_OUTPUT_LIMITER_SOFT:
+            limitValue = value;
+            break;
+        case ALC_FREQUENCY:
+            if(value < 0 || static_cast<uint>(value) != device->Frequency)
+                return std::nullopt;
+            break;
+        case ALC_FORMAT_CHANNELS_SOFT:
+            if(DevFmtChannelsFromEnum(value) != device->FmtChans)
+                return std::nullopt;
+            break;
+        case ALC_FORMAT_TYPE_SOFT:
+            if(DevFmtTypeFromEnum(value) != device->FmtType)
+                return std::nullopt;
+            break;
+        case ALC_MONO_SOURCES:
+            if(value < 0 || static_cast<uint>(value) != device->NumMonoSources)
+                return std::nullopt;
+            break;
+        case ALC_STEREO_SOURCES:
+            if(value < 0 || static_cast<uint>(value) != device->NumStereoSources)
+                return std::nullopt;
+            break;
+        case ALC_MAX_AUXILIARY_SENDS:
+            if(value < 0 || static_cast<uint>(value) != device->NumAuxSends)
+                return std::nullopt;
+            break;
+        case ALC_HRTF_SOFT:
+            if(value != (device->mHrtf ? ALC_TRUE : ALC_FALSE))
+                return std::nullopt;
+            break;
+        default:
+            return std::nullopt;
+        }
+    }
+    return limitValue;
+}
+
+/**
+ * Replaces the output limiter for a reset that only changes it. The mixer
+ * keeps going with the old limiter until it swaps in the new one at the start
+ * of its next update. The device's state lock must be held.
+ */
+bool ApplyLimiterChange(ALCdevice *device, const int limitValue)
+{
+    if(device->Type != DeviceType::Playback || !device->Connected.load(std::memory_order_acquire))
+        return false;
+
+    std::optional<bool> optlimit;
+    if(limitValue == ALC_FALSE)
+        optlimit = false;
+    else if(limitValue == ALC_TRUE)
+        optlimit = true;
+
+    ALCdevice::LimiterSwap swap;
+    try {
+        swap.mLimiter = CreateOutputLimiter(device, optlimit);
+    }
+    catch(std::exception &e) {
+        ERR("Failed to create output limiter: %s\n", e.what());
+        return false;
+    }
+    const int newLookAhead{swap.mLimiter ? swap.mLimiter->getLookAhead() : 0};
+
+    device->mPendingLimiter.store(&swap, std::memory_order_release);
+    if(!device->Flags.test(DeviceRunning))
+        device->swapLimiter();
+    while(!swap.mDone.load(std::memory_order_acquire))
+    {
+        if(!device->Connected.load(std::memory_order_acquire)
+            && device->mPendingLimiter.exchange(nullptr, std::memory_order_acq_rel))
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    /* The limiter's look-ahead is part of the device's fixed latency. */
+    const int oldLookAhead{swap.mLimiter ? swap.mLimiter->getLookAhead() : 0};
+    device->FixedLatency += nanoseconds{seconds{newLookAhead - oldLookAhead}}
+        / device->MixFrequency;
+    TRACE("Swapped in new output limiter\n");
+    return true;
+}
+
+/**
+ * Loads the HRTF for an asynchronous reset and swaps it in with the mixer,
+ * sending an event when done.
+ */
+void ApplyHrtfRequest(ALCdevice *device, const ALCdevice::HrtfRequest &request)
+{
+    TRACE("Loading HRTF \"%s\" asynchronously\n", request.mName.c_str());
+    auto swap = aluPrepareHrtf(device, request.mName, request.mFrequency, request.mAmbiOrder,
+        request.mXOverFreq);
+
+    std::string msg;
+    {
+        /* Make sure the device wasn't closed while loading. */
+        std::unique_lock<std::recursive_mutex> listlock{ListLock};
+        auto iter = std::lower_bound(DeviceList.begin(), DeviceList.end(), device);
+        if(iter == DeviceList.end() || *iter != device)
+        {
+            TRACE("Device %p closed, dropping HRTF \"%s\"\n", voidp{device},
+                request.mName.c_str());
+            return;
+        }
+        std::lock_guard<std::mutex> _{device->StateLock};
+        listlock.unlock();
+
+        if(!swap)
+        {
+            ERR("Failed to load HRTF \"%s\"\n", request.mName.c_str());
+            msg = "Failed to load HRTF " + request.mName;
+        }
+        else if(!device->mHrtfState || device->MixFrequency != request.mFrequency
+            || device->mAmbiOrder != request.mAmbiOrder || device->mXOverFreq != request.mXOverFreq)
+        {
+            WARN("Device reset before HRTF \"%s\" was ready, dropping it\n",
+                request.mName.c_str());
+            msg = "HRTF " + request.mName + " dropped after device reset";
+        }
+        else if(device->AvgSpeakerDist > 0.0f
+            && clampf(swap->mHrtf->mFields[0].distance, 0.1f, 10.0f) != device->AvgSpeakerDist)
+        {
+            /* The near-field control distance comes from the HRTF, which the
+             * sources are filtered with. A different distance needs a full
+             * reset.
+             */
+            TRACE("HRTF near-field distance changed, resetting device\n");
+            if(device->Flags.test(DeviceRunning))
+                device->Backend->stop();
+            device->Flags.reset(DeviceRunning);
+
+            if(ResetDeviceParams(device, request.mAttribs.data()) && device->mHrtf)
+                msg = "HRTF changed to " + device->mHrtfName;
+            else
+                msg = "Failed to reset device for HRTF " + request.mName;
+        }
+        else
+        {
+            /* Have the mixer swap it in at the start of its next update, or
+             * do it directly if it's not mixing.
+             */
+            device->mPendingHrtf.store(swap.get(), std::memory_order_release);
+            if(!device->Flags.test(DeviceRunning))
+                device->swapHrtf();
+            while(!swap->mDone.load(std::memory_order_acquire))
+            {
+                /* A disconnected device may stop mixing. Take it back if the
+                 * mixer didn't already.
+                 */
+                if(!device->Connected.load(std::memory_order_acquire)
+                    && device->mPendingHrtf.exchange(nullptr, std::memory_order_acq_rel))
+                    break;
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            }
+
+            if(swap->mDone.load(std::memory_order_acquire))
+            {
+                TRACE("Swapped in HRTF \"%s\"\n", request.mName.c_str());
+                device->mHrtfName = request.mName;
+                msg = "HRTF changed to " + request.mName;
+            }
+            else
+                msg = "Device disconnected before HRTF " + request.mName + " was swapped in";
+        }
+    }
+
+    /* Release the old HRTF, now that the mixer is done with it. */
+    swap = nullptr;
+
+    alc::Event(alc::EventType::HrtfChanged, alc::DeviceType::Playback, device, msg);
+}
+
+void HrtfLoaderThread(ALCdevice *device)
+{
+    althrd_setname(HRTF_LOADER_THREAD_NAME);
+
+    std::unique_lock<std::mutex> reqlock{device->mHrtfRequestLock};
+    while(true)
+    {
+        device->mHrtfRequestCond.wait(reqlock, [device]() noexcept -> bool
+            { return device->mHrtfLoaderQuit || device->mHrtfRequest.has_value(); });
+        if(device->mHrtfLoaderQuit)
+            break;
+
+        ALCdevice::HrtfRequest request{std::move(*device->mHrtfRequest)};
+        device->mHrtfRequest.reset();
+        reqlock.unlock();
+
+        ApplyHrtfRequest(device, request);
+
+        reqlock.lock();
+    }
+}
+
+/**
+ * Queues the HRTF change for an asynchronous reset, if the device can keep
+ * playing while it loads. The device's state lock must be held.
+ */
+bool QueueHrtfRequest(ALCdevice *device, const int hrtf_id, const int *attrList)
+{
+    if(device->Type != DeviceType::Playback || !device->mHrtfState || device->mHrtfList.empty()
+        || !device->Connected.load(std::memory_order_acquire))
+        return false;
+
+    ALCdevice::HrtfRequest request;
+    request.mName = (hrtf_id >= 0 && static_cast<uint>(hrtf_id) < device->mHrtfList.size())
+        ? device->mHrtfList[static_cast<uint>(hrtf_id)] : device->mHrtfList.front();
+    request.mFrequency = device->MixFrequency;
+    request.mAmbiOrder = device->mAmbiOrder;
+    request.mXOverFreq = device->mXOverFreq;
+    for(size_t attrIdx{0};attrList[attrIdx];attrIdx += 2)
+    {
+        request.mAttribs.emplace_back(attrList[attrIdx]);
+        request.mAttribs.emplace_back(attrList[attrIdx + 1]);
+    }
+    request.mAttribs.emplace_back(0);
+
+    try {
+        if(!device->mHrtfLoader.joinable())
+            device->mHrtfLoader = std::thread{HrtfLoaderThread, device};
+    }
+    catch(std::exception& e) {
+        ERR("Failed to start HRTF loader thread: %s\n", e.what());
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> _{device->mHrtfRequestLock};
+        device->mHrtfRequest = std::move(request);
+    }
+    device->mHrtfRequestCond.notify_all();
+    return true;
+}
+
 } // namespace
 
 /** Returns a new reference to the currently active context for this thread. */
@@ -1949,6 +2744,13 @@ ALC_API void ALC_APIENTRY alcProcessContext(ALCcontext *context) noexcept
         std::lock_guard<std::mutex> _{ctx->mPropLock};
         ctx->processUpdates();
     }
+#ifdef ALSOFT_EAX
+    if(ctx->mBatchedUpdatesPending.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> _{ctx->mPropLock};
+        ctx->eaxCommitBatch();
+    }
+#endif
 }
 
 
@@ -2370,6 +3172,15 @@ static size_t GetIntegerv(ALCdevice *device, ALCenum param, const al::span<int>
         values[0] = device->mHrtfStatus;
         return 1;
 
+    case ALC_HRTF_AMBISONIC_ORDER_SOFT:
+        values[0] = (device->mHrtfState && device->mRenderMode != RenderMode::Hrtf)
+            ? static_cast<int>(device->mAmbiOrder) : 0;
+        return 1;
+
+    case ALC_MIX_QUALITY_SOFT:
+        values[0] = al::to_underlying(device->mGovernor.mQuality.load(std::memory_order_relaxed));
+        return 1;
+
     case ALC_NUM_HRTF_SPECIFIERS_SOFT:
         device->enumerateHrtfs();
         values[0] = static_cast<int>(minz(device->mHrtfList.size(),
@@ -2380,6 +3191,10 @@ static size_t GetIntegerv(ALCdevice *device, ALCenum param, const al::span<int>
         values[0] = device->Limiter ? ALC_TRUE : ALC_FALSE;
         return 1;
 
+    case ALC_OFFLINE_RENDER_SOFT:
+        values[0] = device->mOfflineRender ? ALC_TRUE : ALC_FALSE;
+        return 1;
+
     case ALC_MAX_AMBISONIC_ORDER_SOFT:
         values[0] = MaxAmbiOrder;
         return 1;
@@ -2511,7 +3326,7 @@ ALC_API void ALC_APIENTRY alcGetInteger64vSOFT(ALCdevice *device, ALCenum pname,
                 basecount = dev->ClockBase;
                 samplecount = dev->SamplesDone;
             } while(refcount != ReadRef(dev->MixCount));
-            basecount += nanoseconds{seconds{samplecount}} / dev->Frequency;
+            basecount += nanoseconds{seconds{samplecount}} / dev->MixFrequency;
             *values = basecount.count();
         }
         break;
@@ -2531,6 +3346,66 @@ ALC_API void ALC_APIENTRY alcGetInteger64vSOFT(ALCdevice *device, ALCenum pname,
         }
         break;
 
+    case ALC_MIXER_PROFILE_SOFT:
+        if(size < 8)
+            alcSetError(dev.get(), ALC_INVALID_VALUE);
+        else
+        {
+            const MixerProfile &profile = dev->mProfile;
+            auto get = [](const auto &value) noexcept
+            { return static_cast<ALCint64SOFT>(value.load(std::memory_order_relaxed)); };
+            values[0] = get(profile.mPeriods);
+            values[1] = get(profile.mOverruns);
+            values[2] = get(profile.mUpdateTime);
+            values[3] = get(profile.mVoiceTime);
+            values[4] = get(profile.mEffectTime);
+            values[5] = get(profile.mPostProcessTime);
+            values[6] = get(profile.mActiveVoices);
+            values[7] = get(profile.mVirtualVoices);
+            if(size >= 9)
+                values[8] = get(profile.mInstancedVoices);
+            if(size >= 11)
+            {
+                values[9] = get(profile.mHrtfBlends);
+                values[10] = get(profile.mHrtfHeldUpdates);
+            }
+        }
+        break;
+
+    case ALC_MIXER_PROFILE_HISTORY_SOFT:
+        {
+            /* The first value is the number of records read, followed by each
+             * record's values.
+             */
+            static constexpr size_t RecordValues{sizeof(MixerProfileRecord)/sizeof(int64_t)};
+            static_assert(sizeof(MixerProfileRecord) == RecordValues*sizeof(ALCint64SOFT));
+
+            size_t count{0};
+            if(RingBuffer *history{dev->mProfileHistory.get()})
+            {
+                const size_t maxcount{static_cast<uint>(size-1) / RecordValues};
+                count = history->read(values+1, maxcount);
+            }
+            values[0] = static_cast<ALCint64SOFT>(count);
+        }
+        break;
+
+    case ALC_MEMORY_STATS_SOFT:
+        /* The current and peak bytes for each category, in order. */
+        if(static_cast<size_t>(size) < size_t{al::to_underlying(MemCategory::Count)}*2)
+            alcSetError(dev.get(), ALC_INVALID_VALUE);
+        else
+        {
+            const MemoryStats &stats = *dev->mMemoryStats;
+            for(size_t i{0};i < al::to_underlying(MemCategory::Count);++i)
+            {
+                const auto category = static_cast<MemCategory>(i);
+                values[i*2 + 0] = stats.current(category);
+                values[i*2 + 1] = stats.peak(category);
+            }
+        }
+        break;
+
     default:
         auto ivals = std::vector<int>(static_cast<uint>(size));
         if(size_t got{GetIntegerv(dev.get(), pname, ivals)})
@@ -2650,21 +3525,89 @@ ALC_API ALCcontext* ALC_APIENTRY alcCreateContext(ALCdevice *device, const ALCin
     }
 
     ContextFlagBitset ctxflags{0};
+    uint voiceBudget{0u};
+    bool eventPolling{false};
+    uint numSources{0u}, numVoices{0u}, numBuffers{0u}, numSlots{0u}, numProps{0u};
+    uint numVoiceChanges{0u};
     if(attrList)
     {
         for(size_t i{0};attrList[i];i+=2)
         {
             if(attrList[i] == ALC_CONTEXT_FLAGS_EXT)
-            {
                 ctxflags = static_cast<ALuint>(attrList[i+1]);
-                break;
+            else if(attrList[i] == ALC_VOICE_BUDGET_SOFT)
+            {
+                if(attrList[i+1] < 0)
+                {
+                    WARN("Invalid voice budget: %d\n", attrList[i+1]);
+                    alcSetError(dev.get(), ALC_INVALID_VALUE);
+                    return nullptr;
+                }
+                voiceBudget = static_cast<uint>(attrList[i+1]);
+            }
+            else if(attrList[i] == ALC_EVENT_POLLING_SOFT)
+                eventPolling = attrList[i+1] != ALC_FALSE;
+            else if(attrList[i] == ALC_RESERVED_SOURCES_SOFT
+                || attrList[i] == ALC_RESERVED_VOICES_SOFT
+                || attrList[i] == ALC_RESERVED_BUFFERS_SOFT
+                || attrList[i] == ALC_RESERVED_EFFECT_SLOTS_SOFT
+                || attrList[i] == ALC_RESERVED_PROPS_SOFT
+                || attrList[i] == ALC_RESERVED_VOICE_CHANGES_SOFT)
+            {
+                if(attrList[i+1] < 0)
+                {
+                    WARN("Invalid reserved count for 0x%04x: %d\n", attrList[i], attrList[i+1]);
+                    alcSetError(dev.get(), ALC_INVALID_VALUE);
+                    return nullptr;
+                }
+                const auto count = static_cast<uint>(attrList[i+1]);
+                switch(attrList[i])
+                {
+                case ALC_RESERVED_SOURCES_SOFT: numSources = count; break;
+                case ALC_RESERVED_VOICES_SOFT: numVoices = count; break;
+                case ALC_RESERVED_BUFFERS_SOFT: numBuffers = count; break;
+                case ALC_RESERVED_EFFECT_SLOTS_SOFT: numSlots = count; break;
+                case ALC_RESERVED_PROPS_SOFT: numProps = count; break;
+                case ALC_RESERVED_VOICE_CHANGES_SOFT: numVoiceChanges = count; break;
+                }
             }
         }
     }
 
     ContextRef context{new ALCcontext{dev, ctxflags}};
+    context->mEventPolling = eventPolling;
     context->init();
 
+    /* Allocate the requested storage now, so loading a scene with them
+     * doesn't need to allocate in small steps.
+     */
+    numSources = minu(numSources, dev->SourcesMax);
+    numSlots = minu(numSlots, dev->AuxiliaryEffectSlotMax);
+    context->mReservedVoices = numVoices;
+    context->mReservedVoiceChanges = numVoiceChanges;
+    context->mReservedEffectSlots = numSlots;
+    context->mReservedProps = numProps;
+    context->reserveStorage();
+    if(numSources > 0 && !ReserveSources(context.get(), numSources))
+        WARN("Failed to reserve %u sources\n", numSources);
+    if(numSlots > 0 && !ReserveEffectSlots(context.get(), numSlots))
+        WARN("Failed to reserve %u effect slots\n", numSlots);
+    if(numBuffers > 0 && !ReserveBuffers(dev.get(), numBuffers))
+        WARN("Failed to reserve %u buffers\n", numBuffers);
+    if(numSources|numVoices|numBuffers|numSlots|numProps|numVoiceChanges)
+        TRACE("Reserved %u sources, %u voices, %u buffers, %u effect slots, %u props, %u voice changes\n",
+            numSources, numVoices, numBuffers, numSlots, numProps, numVoiceChanges);
+
+    if(voiceBudget > 0)
+    {
+        context->mVoiceBudget = voiceBudget;
+        TRACE("Voice budget: %u\n", voiceBudget);
+    }
+    /* The governor's voice limit uses the same heap as the budget. */
+    if(dev->mGovernor.mMinQuality >= MixQuality::VoiceLimit)
+        voiceBudget = maxu(voiceBudget, dev->mGovernor.mVoiceLimit);
+    context->mVoiceBudgetHeap.reserve(voiceBudget);
+
     if(auto volopt = dev->configValue<float>(nullptr, "volume-adjust"))
     {
         const float valf{*volopt};
@@ -2696,15 +3639,12 @@ ALC_API ALCcontext* ALC_APIENTRY alcCreateContext(ALCdevice *device, const ALCin
         auto iter = std::copy(oldarray->begin(), oldarray->end(), newarray->begin());
         *iter = context.get();
 
-        /* Store the new context array in the device. Wait for any current mix
-         * to finish before deleting the old array.
+        /* Store the new context array in the device. The old array is freed
+         * once any current mix is done with it.
          */
         dev->mContexts.store(newarray.release());
         if(oldarray != &DeviceBase::sEmptyContextArray)
-        {
-            dev->waitForMix();
-            delete oldarray;
-        }
+            dev->retire(oldarray);
     }
     statelock.unlock();
 
@@ -2838,7 +3778,7 @@ ALC_API ALCdevice* ALC_APIENTRY alcGetContextsDevice(ALCcontext *Context) noexce
 
 ALC_API ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar *deviceName) noexcept
 {
-    InitConfig();
+    InitBackends();
 
     if(!PlaybackFactory)
     {
@@ -2883,6 +3823,7 @@ ALC_API ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar *deviceName) noexcep
     device->FmtChans = DevFmtChannelsDefault;
     device->FmtType = DevFmtTypeDefault;
     device->Frequency = DEFAULT_OUTPUT_RATE;
+    device->MixFrequency = device->Frequency;
     device->UpdateSize = DEFAULT_UPDATE_SIZE;
     device->BufferSize = DEFAULT_UPDATE_SIZE * DEFAULT_NUM_UPDATES;
 
@@ -2969,7 +3910,7 @@ ALC_API ALCboolean ALC_APIENTRY alcCloseDevice(ALCdevice *device) noexcept
  ************************************************/
 ALC_API ALCdevice* ALC_APIENTRY alcCaptureOpenDevice(const ALCchar *deviceName, ALCuint frequency, ALCenum format, ALCsizei samples) noexcept
 {
-    InitConfig();
+    InitBackends();
 
     if(!CaptureFactory)
     {
@@ -3003,6 +3944,7 @@ ALC_API ALCdevice* ALC_APIENTRY alcCaptureOpenDevice(const ALCchar *deviceName,
     }
 
     device->Frequency = frequency;
+    device->MixFrequency = device->Frequency;
     device->FmtChans = decompfmt->chans;
     device->FmtType = decompfmt->type;
     device->Flags.set(FrequencyRequest);
@@ -3128,7 +4070,7 @@ ALC_API void ALC_APIENTRY alcCaptureSamples(ALCdevice *device, ALCvoid *buffer,
     BackendBase *backend{dev->Backend.get()};
 
     const auto usamples = static_cast<uint>(samples);
-    if(usamples > backend->availableSamples())
+    if(dev->CaptureMapped > 0 || usamples > backend->availableSamples())
     {
         alcSetError(dev.get(), ALC_INVALID_VALUE);
         return;
@@ -3137,6 +4079,94 @@ ALC_API void ALC_APIENTRY alcCaptureSamples(ALCdevice *device, ALCvoid *buffer,
     backend->captureSamples(static_cast<std::byte*>(buffer), usamples);
 }
 
+/* Maps the next contiguous run of captured samples, for reading them directly
+ * from the device's buffer. Returns NULL with 0 samples if none are available,
+ * or if the device can't provide direct access (use alcCaptureSamples then).
+ */
+FORCE_ALIGN const ALCvoid* ALC_APIENTRY alcCaptureMapSamplesSOFT(ALCdevice *device,
+    ALCsizei *samples) noexcept
+{
+    DeviceRef dev{VerifyDevice(device)};
+    if(!dev || dev->Type != DeviceType::Capture)
+    {
+        alcSetError(dev.get(), ALC_INVALID_DEVICE);
+        return nullptr;
+    }
+    if(!samples)
+    {
+        alcSetError(dev.get(), ALC_INVALID_VALUE);
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> _{dev->StateLock};
+    uint count{0u};
+    const std::byte *data{dev->Backend->mapSamples(&count)};
+    if(!data) count = 0u;
+
+    dev->CaptureMapped = minu(count, std::numeric_limits<int>::max());
+    *samples = static_cast<ALCsizei>(dev->CaptureMapped);
+    return dev->CaptureMapped ? data : nullptr;
+}
+
+/* Releases the mapped samples, removing the given number of them from the
+ * front of the capture buffer.
+ */
+FORCE_ALIGN void ALC_APIENTRY alcCaptureUnmapSamplesSOFT(ALCdevice *device,
+    ALCsizei samples) noexcept
+{
+    DeviceRef dev{VerifyDevice(device)};
+    if(!dev || dev->Type != DeviceType::Capture)
+    {
+        alcSetError(dev.get(), ALC_INVALID_DEVICE);
+        return;
+    }
+
+    std::lock_guard<std::mutex> _{dev->StateLock};
+    if(samples < 0 || static_cast<uint>(samples) > dev->CaptureMapped)
+    {
+        alcSetError(dev.get(), ALC_INVALID_VALUE);
+        return;
+    }
+
+    if(samples > 0)
+        dev->Backend->unmapSamples(static_cast<uint>(samples));
+    dev->CaptureMapped = 0u;
+}
+
+/* Sets a callback to get each period of captured samples as soon as the
+ * device provides them, with the device clock time of the first sample. The
+ * samples go to the callback instead of the capture buffer, so there's nothing
+ * for alcCaptureSamples to read. It can only be changed while capture is
+ * stopped. Devices that can't deliver samples this way give an
+ * ALC_INVALID_DEVICE error.
+ */
+FORCE_ALIGN void ALC_APIENTRY alcCaptureCallbackSOFT(ALCdevice *device,
+    ALCCAPTURECALLBACKTYPESOFT callback, ALCvoid *userptr) noexcept
+{
+    DeviceRef dev{VerifyDevice(device)};
+    if(!dev || dev->Type != DeviceType::Capture)
+    {
+        alcSetError(dev.get(), ALC_INVALID_DEVICE);
+        return;
+    }
+
+    std::lock_guard<std::mutex> _{dev->StateLock};
+    BackendBase *backend{dev->Backend.get()};
+    if(callback && !backend->canCaptureCallback())
+    {
+        alcSetError(dev.get(), ALC_INVALID_DEVICE);
+        return;
+    }
+    if(dev->Flags.test(DeviceRunning))
+    {
+        alcSetError(dev.get(), ALC_INVALID_VALUE);
+        return;
+    }
+
+    backend->mCaptureCallback = callback;
+    backend->mCaptureUserPtr = callback ? userptr : nullptr;
+}
+
 
 /************************************************
  * ALC loopback functions
@@ -3172,6 +4202,7 @@ ALC_API ALCdevice* ALC_APIENTRY alcLoopbackOpenDeviceSOFT(const ALCchar *deviceN
     device->UpdateSize = 0;
 
     device->Frequency = DEFAULT_OUTPUT_RATE;
+    device->MixFrequency = device->Frequency;
     device->FmtChans = DevFmtChannelsDefault;
     device->FmtType = DevFmtTypeDefault;
 
@@ -3241,6 +4272,33 @@ ALC_API void ALC_APIENTRY alcRenderSamplesSOFT(ALCdevice *device, ALCvoid *buffe
         device->renderSamples(buffer, static_cast<uint>(samples), device->channelsFromFmt());
 }
 
+/**
+ * Renders some samples as separate float lines, one for each of the output
+ * channels in the order they'd be interleaved with alcRenderSamplesSOFT. The
+ * samples are rendered as float regardless of the format type set by the
+ * context attributes, though the channel configuration is used.
+ */
+#if defined(__GNUC__) && defined(__i386__)
+[[gnu::force_align_arg_pointer]]
+#endif
+ALC_API void ALC_APIENTRY alcRenderSamplesPlanarSOFT(ALCdevice *device, ALCfloat **channels,
+    ALCsizei samples) noexcept
+{
+    if(!device || device->Type != DeviceType::Loopback) UNLIKELY
+        return alcSetError(device, ALC_INVALID_DEVICE);
+    if(samples < 0) UNLIKELY
+        return alcSetError(device, ALC_INVALID_VALUE);
+    if(samples == 0)
+        return;
+
+    const al::span<float*> outBuffers{channels, channels ? device->channelsFromFmt() : 0u};
+    if(outBuffers.empty()
+        || std::find(outBuffers.begin(), outBuffers.end(), nullptr) != outBuffers.end())
+        UNLIKELY
+        return alcSetError(device, ALC_INVALID_VALUE);
+    device->renderSamples(outBuffers, static_cast<uint>(samples));
+}
+
 
 /************************************************
  * ALC DSP pause/resume functions
@@ -3336,6 +4394,27 @@ ALC_API ALCboolean ALC_APIENTRY alcResetDeviceSOFT(ALCdevice *device, const ALCi
     std::lock_guard<std::mutex> _{dev->StateLock};
     listlock.unlock();
 
+    /* An asynchronous reset that only changes the HRTF keeps the device
+     * playing, while a separate thread loads the new one. Otherwise it's done
+     * as a normal reset.
+     */
+    if(auto hrtf_id = GetAsyncHrtfId(attribs))
+    {
+        if(QueueHrtfRequest(dev.get(), *hrtf_id, attribs))
+            return ALC_TRUE;
+        TRACE("Unable to change HRTF asynchronously, resetting device\n");
+    }
+
+    /* A reset that only changes the output limiter replaces it without
+     * stopping the device.
+     */
+    if(auto limitValue = GetLimiterOnlyChange(dev.get(), attribs))
+    {
+        if(ApplyLimiterChange(dev.get(), *limitValue))
+            return ALC_TRUE;
+        TRACE("Unable to change output limiter in place, resetting device\n");
+    }
+
     /* Force the backend to stop mixing first since we're resetting. Also reset
      * the connected state so lost devices can attempt recover.
      */
@@ -34,8 +34,10 @@
 #endif
 
 #include <algorithm>
+#include <array>
 #include <cstdio>
 #include <string>
+#include <string_view>
 #include <utility>
 
 #include "alfstream.h"
@@ -52,8 +54,40 @@ struct ConfigEntry {
     std::string key;
     std::string value;
 };
+/* Kept sorted by key, so lookups can do a binary search. */
 std::vector<ConfigEntry> ConfOpts;
 
+/* A lookup key, as up to three parts that get joined with '/'. */
+struct ConfigKey {
+    std::array<std::string_view,3> parts;
+    size_t count;
+};
+
+/* Compares a full key string with a lookup key, without having to build the
+ * joined key string. The ordering is the same as std::string's.
+ */
+int CompareKey(std::string_view fullkey, const ConfigKey &key)
+{
+    using traits = std::char_traits<char>;
+    for(size_t i{0};i < key.count;++i)
+    {
+        if(i > 0)
+        {
+            if(fullkey.empty()) return -1;
+            if(fullkey[0] != '/') return traits::lt(fullkey[0], '/') ? -1 : 1;
+            fullkey.remove_prefix(1);
+        }
+
+        const std::string_view part{key.parts[i]};
+        const size_t len{std::min(fullkey.size(), part.size())};
+        if(const int cmp{traits::compare(fullkey.data(), part.data(), len)})
+            return cmp;
+        if(fullkey.size() < part.size()) return -1;
+        fullkey.remove_prefix(len);
+    }
+    return fullkey.empty() ? 0 : 1;
+}
+
 
 std::string &lstrip(std::string &line)
 {
@@ -261,10 +295,10 @@ void LoadConfigFromFile(std::istream &f)
         TRACE(" found '%s' = '%s'\n", fullKey.c_str(), value.c_str());
 
         /* Check if we already have this option set */
-        auto find_key = [&fullKey](const ConfigEntry &entry) -> bool
-        { return entry.key == fullKey; };
-        auto ent = std::find_if(ConfOpts.begin(), ConfOpts.end(), find_key);
-        if(ent != ConfOpts.end())
+        auto ent = std::lower_bound(ConfOpts.begin(), ConfOpts.end(), fullKey,
+            [](const ConfigEntry &entry, const std::string &key) -> bool
+            { return entry.key < key; });
+        if(ent != ConfOpts.end() && ent->key == fullKey)
         {
             if(!value.empty())
                 ent->value = expdup(value.c_str());
@@ -272,7 +306,7 @@ void LoadConfigFromFile(std::istream &f)
                 ConfOpts.erase(ent);
         }
         else if(!value.empty())
-            ConfOpts.emplace_back(ConfigEntry{std::move(fullKey), expdup(value.c_str())});
+            ConfOpts.emplace(ent, ConfigEntry{std::move(fullKey), expdup(value.c_str())});
     }
     ConfOpts.shrink_to_fit();
 }
@@ -282,45 +316,45 @@ const char *GetConfigValue(const char *devName, const char *blockName, const cha
     if(!keyName)
         return nullptr;
 
-    std::string key;
-    if(blockName && al::strcasecmp(blockName, "general") != 0)
+    const bool hasBlock{blockName && al::strcasecmp(blockName, "general") != 0};
+    auto make_key = [hasBlock,blockName,keyName](const char *dev) noexcept -> ConfigKey
     {
-        key = blockName;
-        if(devName)
-        {
-            key += '/';
-            key += devName;
-        }
-        key += '/';
-        key += keyName;
-    }
-    else
-    {
-        if(devName)
-        {
-            key = devName;
-            key += '/';
-        }
-        key += keyName;
-    }
-
-    auto iter = std::find_if(ConfOpts.cbegin(), ConfOpts.cend(),
-        [&key](const ConfigEntry &entry) -> bool
-        { return entry.key == key; });
-    if(iter != ConfOpts.cend())
+        ConfigKey key{};
+        if(hasBlock)
+            key.parts[key.count++] = blockName;
+        if(dev)
+            key.parts[key.count++] = dev;
+        key.parts[key.count++] = keyName;
+        return key;
+    };
+    auto find_key = [](const ConfigKey &key) noexcept -> const ConfigEntry*
     {
-        TRACE("Found %s = \"%s\"\n", key.c_str(), iter->value.c_str());
-        if(!iter->value.empty())
-            return iter->value.c_str();
+        auto iter = std::lower_bound(ConfOpts.cbegin(), ConfOpts.cend(), key,
+            [](const ConfigEntry &entry, const ConfigKey &k) -> bool
+            { return CompareKey(entry.key, k) < 0; });
+        if(iter != ConfOpts.cend() && CompareKey(iter->key, key) == 0)
+            return &*iter;
         return nullptr;
-    }
+    };
 
-    if(!devName)
+    /* Look for a device-specific option first, then fall back to the general
+     * one.
+     */
+    const ConfigEntry *entry{devName ? find_key(make_key(devName)) : nullptr};
+    if(!entry) entry = find_key(make_key(nullptr));
+    if(entry)
     {
-        TRACE("Key %s not found\n", key.c_str());
+        TRACE("Found %s = \"%s\"\n", entry->key.c_str(), entry->value.c_str());
+        if(!entry->value.empty())
+            return entry->value.c_str();
         return nullptr;
     }
-    return GetConfigValue(nullptr, blockName, keyName);
+
+    if(hasBlock)
+        TRACE("Key %s/%s not found\n", blockName, keyName);
+    else
+        TRACE("Key %s not found\n", keyName);
+    return nullptr;
 }
 
 } // namespace
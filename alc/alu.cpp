@@ -31,11 +31,13 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <iterator>
 #include <limits>
 #include <memory>
 #include <new>
+#include <numeric>
 #include <optional>
 #include <stdint.h>
 #include <utility>
@@ -55,6 +57,7 @@
 #include "core/bufferline.h"
 #include "core/buffer_storage.h"
 #include "core/context.h"
+#include "core/converter.h"
 #include "core/cpu_caps.h"
 #include "core/cubic_tables.h"
 #include "core/devformat.h"
@@ -65,11 +68,16 @@
 #include "core/filters/nfc.h"
 #include "core/fpu_ctrl.h"
 #include "core/hrtf.h"
+#include "core/kernels.h"
 #include "core/mastering.h"
 #include "core/mixer.h"
 #include "core/mixer/defs.h"
 #include "core/mixer/hrtfdefs.h"
+#include "core/mixer_pool.h"
+#include "core/outputconv.h"
 #include "core/resampler_limits.h"
+#include "core/sourcegroup.h"
+#include "core/tracing.h"
 #include "core/uhjfilter.h"
 #include "core/voice.h"
 #include "core/voice_change.h"
@@ -90,6 +98,9 @@ struct SSE2Tag;
 #ifdef HAVE_SSE4_1
 struct SSE4Tag;
 #endif
+#ifdef HAVE_AVX2
+struct AVX2Tag;
+#endif
 #ifdef HAVE_NEON
 struct NEONTag;
 #endif
@@ -143,7 +154,8 @@ struct ChanMap {
 
 using HrtfDirectMixerFunc = void(*)(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples, float *TempBuf,
-    HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize);
+    const size_t TempStride, HrtfChannelState *ChanState, const size_t IrSize,
+    const size_t BufferSize);
 
 HrtfDirectMixerFunc MixDirectHrtf{MixDirectHrtf_<CTag>};
 
@@ -153,6 +165,10 @@ inline HrtfDirectMixerFunc SelectHrtfMixer(void)
     if((CPUCapFlags&CPU_CAP_NEON))
         return MixDirectHrtf_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+        return MixDirectHrtf_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return MixDirectHrtf_<SSETag>;
@@ -196,6 +212,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
         if((CPUCapFlags&CPU_CAP_NEON))
             return Resample_<LerpTag,NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+            return Resample_<LerpTag,AVX2Tag>;
+#endif
 #ifdef HAVE_SSE4_1
         if((CPUCapFlags&CPU_CAP_SSE4_1))
             return Resample_<LerpTag,SSE4Tag>;
@@ -210,6 +230,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
         if((CPUCapFlags&CPU_CAP_NEON))
             return Resample_<CubicTag,NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+            return Resample_<CubicTag,AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
         if((CPUCapFlags&CPU_CAP_SSE))
             return Resample_<CubicTag,SSETag>;
@@ -223,6 +247,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
             if((CPUCapFlags&CPU_CAP_NEON))
                 return Resample_<BSincTag,NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+            if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+                return Resample_<BSincTag,AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
             if((CPUCapFlags&CPU_CAP_SSE))
                 return Resample_<BSincTag,SSETag>;
@@ -236,6 +264,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
         if((CPUCapFlags&CPU_CAP_NEON))
             return Resample_<FastBSincTag,NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+            return Resample_<FastBSincTag,AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
         if((CPUCapFlags&CPU_CAP_SSE))
             return Resample_<FastBSincTag,SSETag>;
@@ -251,6 +283,7 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
 void aluInit(CompatFlagBitset flags, const float nfcscale)
 {
     MixDirectHrtf = SelectHrtfMixer();
+    BindKernels();
     XScale = flags.test(CompatFlags::ReverseX) ? -1.0f : 1.0f;
     YScale = flags.test(CompatFlags::ReverseY) ? -1.0f : 1.0f;
     ZScale = flags.test(CompatFlags::ReverseZ) ? -1.0f : 1.0f;
@@ -281,6 +314,70 @@ ResamplerFunc PrepareResampler(Resampler resampler, uint increment, InterpState
     return SelectResampler(resampler, increment);
 }
 
+Resampler16Func PrepareResampler16(Resampler resampler)
+{
+    switch(resampler)
+    {
+    case Resampler::Point:
+        return Resample16_<PointTag,CTag>;
+    case Resampler::Linear:
+#ifdef HAVE_NEON
+        if((CPUCapFlags&CPU_CAP_NEON))
+            return Resample16_<LerpTag,NEONTag>;
+#endif
+#ifdef HAVE_SSE4_1
+        if((CPUCapFlags&CPU_CAP_SSE4_1))
+            return Resample16_<LerpTag,SSE4Tag>;
+#endif
+        return Resample16_<LerpTag,CTag>;
+    case Resampler::Cubic:
+    case Resampler::FastBSinc12:
+    case Resampler::BSinc12:
+    case Resampler::FastBSinc24:
+    case Resampler::BSinc24:
+        break;
+    }
+    return nullptr;
+}
+
+
+void DeviceBase::swapHrtf() noexcept
+{
+    HrtfSwap *pending{mPendingHrtf.exchange(nullptr, std::memory_order_acq_rel)};
+    if(!pending) return;
+
+    /* The ambisonic channels being decoded don't change, so carry over their
+     * band-splitter states to avoid a discontinuity. The HRTF accumulation
+     * buffer is kept with the device.
+     */
+    if(mHrtfState && pending->mState
+        && mHrtfState->mChannels.size() == pending->mState->mChannels.size())
+    {
+        for(size_t i{0};i < mHrtfState->mChannels.size();++i)
+            pending->mState->mChannels[i].mSplitter = mHrtfState->mChannels[i].mSplitter;
+    }
+
+    std::swap(mHrtf, pending->mHrtf);
+    std::swap(mHrtfState, pending->mState);
+    std::swap(mIrSize, pending->mIrSize);
+    ++mHrtfId;
+    updateHrtfMemory();
+
+    /* Sources need to update their HRIRs from the new HRTF. */
+    for(ContextBase *ctx : *mContexts.load(std::memory_order_acquire))
+        ctx->mForceUpdate = true;
+
+    pending->mDone.store(true, std::memory_order_release);
+}
+
+void DeviceBase::swapLimiter() noexcept
+{
+    LimiterSwap *pending{mPendingLimiter.exchange(nullptr, std::memory_order_acq_rel)};
+    if(!pending) return;
+
+    std::swap(Limiter, pending->mLimiter);
+    pending->mDone.store(true, std::memory_order_release);
+}
 
 void DeviceBase::ProcessHrtf(const size_t SamplesToDo)
 {
@@ -288,8 +385,22 @@ void DeviceBase::ProcessHrtf(const size_t SamplesToDo)
     const uint lidx{RealOut.ChannelIndex[FrontLeft]};
     const uint ridx{RealOut.ChannelIndex[FrontRight]};
 
+    DirectHrtfState *hrtfstate{mHrtfState.get()};
+    if(!hrtfstate->mTailSegs)
+    {
+        MixDirectHrtf(RealOut.Buffer[lidx], RealOut.Buffer[ridx], Dry.Buffer, HrtfAccumData,
+            hrtfstate->mTemp.data(), 0, hrtfstate->mChannels.data(), hrtfstate->mIrSize,
+            SamplesToDo);
+        return;
+    }
+
+    /* The head of the response is mixed directly, keeping each channel's input
+     * for the FFT'd tail.
+     */
     MixDirectHrtf(RealOut.Buffer[lidx], RealOut.Buffer[ridx], Dry.Buffer, HrtfAccumData,
-        mHrtfState->mTemp.data(), mHrtfState->mChannels.data(), mHrtfState->mIrSize, SamplesToDo);
+        hrtfstate->mTailInput.data(), BufferLineSize, hrtfstate->mChannels.data(),
+        hrtfstate->mIrSize, SamplesToDo);
+    hrtfstate->processTail(RealOut.Buffer[lidx], RealOut.Buffer[ridx], SamplesToDo);
 }
 
 void DeviceBase::ProcessAmbiDec(const size_t SamplesToDo)
@@ -336,14 +447,73 @@ void DeviceBase::ProcessBs2b(const size_t SamplesToDo)
 
 namespace {
 
-/* This RNG method was created based on the math found in opusdec. It's quick,
- * and starting with a seed value of 22222, is suitable for generating
- * whitenoise.
+/* Limits the resampler for the governor's current mixing quality. */
+inline Resampler GovernResampler(const Resampler resampler, const MixQuality quality) noexcept
+{
+    if(quality >= MixQuality::LinearResampler)
+        return std::min(resampler, Resampler::Linear);
+    if(quality >= MixQuality::FastResampler && resampler > Resampler::FastBSinc12)
+        return Resampler::FastBSinc12;
+    return resampler;
+}
+
+/* Prepares the resampler for the step, getting the band-limited sinc state
+ * from the cache when a step in the same quantized range was prepared.
+ */
+ResamplerFunc PrepareCachedResampler(const Resampler resampler, const uint increment,
+    InterpState *state, ResamplerStateCache &cache)
+{
+    const BSincTable *table{};
+    switch(resampler)
+    {
+    case Resampler::Point:
+    case Resampler::Linear:
+    case Resampler::Cubic:
+        return PrepareResampler(resampler, increment, state);
+    case Resampler::FastBSinc12:
+    case Resampler::BSinc12:
+        table = &gBSinc12;
+        break;
+    case Resampler::FastBSinc24:
+    case Resampler::BSinc24:
+        table = &gBSinc24;
+        break;
+    }
+
+    const uint key{increment >> ResamplerStateCache::QuantizeBits};
+    auto &entry = cache.mEntries[key % ResamplerStateCache::NumEntries];
+    if(entry.mKey != key || entry.mResampler != resampler)
+    {
+        entry.mKey = key;
+        entry.mResampler = resampler;
+        BsincPrepare(key << ResamplerStateCache::QuantizeBits, &entry.mState.bsinc, table);
+    }
+    *state = entry.mState;
+    return SelectResampler(resampler, increment);
+}
+
+/* Sets the voice's resampler for its current step, limited by the voice's LOD
+ * as with the governor. With low-precision mixing, 16-bit voices are limited
+ * to the resamplers that have a Q15 version.
  */
-inline uint dither_rng(uint *seed) noexcept
+void SetVoiceResampler(Voice *voice, const DeviceBase *device, Resampler resampler,
+    ResamplerStateCache &rescache)
 {
-    *seed = (*seed * 96314165) + 907633515;
-    return *seed;
+    resampler = GovernResampler(resampler,
+        device->mGovernor.mQuality.load(std::memory_order_relaxed));
+    if(voice->mLod == VoiceLod::Low)
+        resampler = GovernResampler(resampler, MixQuality::LinearResampler);
+    else if(voice->mLod == VoiceLod::Reduced)
+        resampler = GovernResampler(resampler, MixQuality::FastResampler);
+
+    voice->mResampler16 = nullptr;
+    if(device->mLowPrecisionMix && voice->mFmtType == FmtShort)
+    {
+        resampler = std::min(resampler, Resampler::Linear);
+        voice->mResampler16 = PrepareResampler16(resampler);
+    }
+    voice->mResampler = PrepareCachedResampler(resampler, voice->mStep, &voice->mResampleState,
+        rescache);
 }
 
 
@@ -352,25 +522,29 @@ inline uint dither_rng(uint *seed) noexcept
  * that behaves as if the B-Format input was first decoded to a speaker array
  * at its input order, encoded back into the higher order mix, then finally
  * rotated.
+ *
+ * A rotation never mixes between orders, so the rotator is block-diagonal and
+ * only each order's block of it needs to be applied.
  */
 void UpsampleBFormatTransform(
     const al::span<std::array<float,MaxAmbiChannels>,MaxAmbiChannels> output,
     const al::span<const std::array<float,MaxAmbiChannels>> upsampler,
-    const al::span<std::array<float,MaxAmbiChannels>,MaxAmbiChannels> rotator, size_t coeffs_order)
+    const al::span<const std::array<float,MaxAmbiChannels>,MaxAmbiChannels> rotator,
+    size_t coeffs_order)
 {
-    const size_t num_chans{AmbiChannelsFromOrder(coeffs_order)};
-    for(size_t i{0};i < upsampler.size();++i)
-        output[i].fill(0.0f);
     for(size_t i{0};i < upsampler.size();++i)
     {
-        for(size_t k{0};k < num_chans;++k)
+        float *RESTRICT out{output[i].data()};
+        output[i].fill(0.0f);
+        for(size_t l{0};l <= coeffs_order;++l)
         {
-            float *RESTRICT out{output[i].data()};
-            /* Write the full number of channels. The compiler will have an
-             * easier time optimizing if it has a fixed length.
-             */
-            for(size_t j{0};j < MaxAmbiChannels;++j)
-                out[j] += upsampler[i][k] * rotator[k][j];
+            const size_t start{l*l}, end{(l+1)*(l+1)};
+            for(size_t k{start};k < end;++k)
+            {
+                const float in{upsampler[i][k]};
+                for(size_t j{start};j < end;++j)
+                    out[j] += in * rotator[k][j];
+            }
         }
     }
 }
@@ -401,18 +575,16 @@ inline auto& GetAmbi2DLayout(AmbiLayout layouttype) noexcept
 }
 
 
-bool CalcContextParams(ContextBase *ctx)
+void CalcListenerTransform(ListenerTransform &listener, const std::array<float,3> &position,
+    const std::array<float,3> &velocity, const std::array<float,3> &orientAt,
+    const std::array<float,3> &orientUp)
 {
-    ContextProps *props{ctx->mParams.ContextUpdate.exchange(nullptr, std::memory_order_acq_rel)};
-    if(!props) return false;
-
-    const alu::Vector pos{props->Position[0], props->Position[1], props->Position[2], 1.0f};
-    ctx->mParams.Position = pos;
+    listener.Position = alu::Vector{position[0], position[1], position[2], 1.0f};
 
     /* AT then UP */
-    alu::Vector N{props->OrientAt[0], props->OrientAt[1], props->OrientAt[2], 0.0f};
+    alu::Vector N{orientAt[0], orientAt[1], orientAt[2], 0.0f};
     N.normalize();
-    alu::Vector V{props->OrientUp[0], props->OrientUp[1], props->OrientUp[2], 0.0f};
+    alu::Vector V{orientUp[0], orientUp[1], orientUp[2], 0.0f};
     V.normalize();
     /* Build and normalize right-vector */
     alu::Vector U{N.cross_product(V)};
@@ -423,10 +595,26 @@ bool CalcContextParams(ContextBase *ctx)
         U[1], V[1], -N[1], 0.0,
         U[2], V[2], -N[2], 0.0,
          0.0,  0.0,   0.0, 1.0};
-    const alu::Vector vel{props->Velocity[0], props->Velocity[1], props->Velocity[2], 0.0};
+    const alu::Vector vel{velocity[0], velocity[1], velocity[2], 0.0};
 
-    ctx->mParams.Matrix = rot;
-    ctx->mParams.Velocity = rot * vel;
+    listener.Matrix = rot;
+    listener.Velocity = rot * vel;
+}
+
+bool CalcContextParams(ContextBase *ctx)
+{
+    ContextProps *props{ctx->mParams.ContextUpdate.exchange(nullptr, std::memory_order_acq_rel)};
+    if(!props) return false;
+
+    CalcListenerTransform(ctx->mParams.Listeners[0], props->Position, props->Velocity,
+        props->OrientAt, props->OrientUp);
+    for(uint i{1};i < props->NumListeners;++i)
+    {
+        const ListenerPlacement &extra = props->ExtraListeners[i-1];
+        CalcListenerTransform(ctx->mParams.Listeners[i], extra.Position, extra.Velocity,
+            extra.OrientAt, extra.OrientUp);
+    }
+    ctx->mParams.NumListeners = props->NumListeners;
 
     ctx->mParams.Gain = props->Gain * ctx->mGainBoost;
     ctx->mParams.MetersPerUnit = props->MetersPerUnit;
@@ -438,10 +626,88 @@ bool CalcContextParams(ContextBase *ctx)
     ctx->mParams.SourceDistanceModel = props->SourceDistanceModel;
     ctx->mParams.mDistanceModel = props->mDistanceModel;
 
-    AtomicReplaceHead(ctx->mFreeContextProps, props);
+    ctx->mContextPropsPool.put(props);
     return true;
 }
 
+/* Estimates how many samples an effect's output can continue for after its
+ * input goes silent, before it falls below the silence threshold (-100dB).
+ */
+uint CalcEffectTailSamples(const EffectSlotType type, const EffectProps &props,
+    const float frequency)
+{
+    /* The number of passes through a feedback loop with the given gain until
+     * it's below the silence threshold.
+     */
+    auto feedback_passes = [](const float feedback) noexcept -> float
+    {
+        const float fb{std::fabs(feedback)};
+        if(!(fb < 1.0f)) return std::numeric_limits<float>::infinity();
+        if(!(fb > GainSilenceThreshold)) return 1.0f;
+        return std::log(GainSilenceThreshold)/std::log(fb) + 1.0f;
+    };
+
+    /* Allow some extra time for filters and such to settle. */
+    float seconds{0.1f};
+    switch(type)
+    {
+    case EffectSlotType::None:
+        return 0;
+
+    case EffectSlotType::Reverb:
+    case EffectSlotType::EAXReverb:
+        /* The decay time is how long the late reverb takes to reach -60dB,
+         * which may be lengthened for the low and high frequencies.
+         */
+        seconds += props.Reverb.ReflectionsDelay + props.Reverb.LateReverbDelay
+            + props.Reverb.DecayTime * maxf(1.0f, maxf(props.Reverb.DecayLFRatio,
+                props.Reverb.DecayHFRatio))
+            * (std::log(GainSilenceThreshold)/std::log(ReverbDecayGain));
+        break;
+
+    case EffectSlotType::Chorus:
+        seconds += ChorusMaxDelay*2.0f * feedback_passes(props.Chorus.Feedback);
+        break;
+    case EffectSlotType::Flanger:
+        seconds += FlangerMaxDelay*2.0f * feedback_passes(props.Chorus.Feedback);
+        break;
+
+    case EffectSlotType::Echo:
+        seconds += (props.Echo.Delay+props.Echo.LRDelay) * feedback_passes(props.Echo.Feedback);
+        break;
+
+    case EffectSlotType::Autowah:
+        seconds += props.Autowah.ReleaseTime;
+        break;
+
+    case EffectSlotType::PitchShifter:
+        /* Allow for the STFT's latency. */
+        seconds += 2048.0f / frequency;
+        break;
+
+    case EffectSlotType::Convolution:
+        /* The impulse response length isn't known here, so don't let it go
+         * dormant.
+         */
+        return std::numeric_limits<uint>::max();
+
+    case EffectSlotType::Distortion:
+    case EffectSlotType::FrequencyShifter:
+    case EffectSlotType::VocalMorpher:
+    case EffectSlotType::RingModulator:
+    case EffectSlotType::Compressor:
+    case EffectSlotType::Equalizer:
+    case EffectSlotType::DedicatedLFE:
+    case EffectSlotType::DedicatedDialog:
+        break;
+    }
+
+    const float samples{seconds * frequency};
+    if(!(samples < static_cast<float>(std::numeric_limits<uint>::max())))
+        return std::numeric_limits<uint>::max();
+    return static_cast<uint>(samples);
+}
+
 bool CalcEffectSlotParams(EffectSlot *slot, EffectSlot **sorted_slots, ContextBase *context)
 {
     EffectSlotProps *props{slot->Update.exchange(nullptr, std::memory_order_acq_rel)};
@@ -480,6 +746,19 @@ bool CalcEffectSlotParams(EffectSlot *slot, EffectSlot **sorted_slots, ContextBa
     EffectState *oldstate{slot->mEffectState.release()};
     slot->mEffectState.reset(state);
 
+    /* Only use as much of the wet buffer as the effect needs input for. It's
+     * allocated for the device's full order, so this just shortens the span.
+     * The new layout needs to be cleared before it's mixed to.
+     */
+    const size_t numChans{AmbiChannelsFromOrder(minu(state->inputOrder(),
+        context->mDevice->mAmbiOrder))};
+    if(slot->Wet.Buffer.size() != numChans)
+    {
+        slot->Wet.Buffer = {slot->mWetBuffer.data(), numChans};
+        slot->mWetSilent = false;
+        slot->mWetResized = true;
+    }
+
     /* Only release the old state if it won't get deleted, since we can't be
      * deleting/freeing anything in the mixer.
      */
@@ -505,7 +784,7 @@ bool CalcEffectSlotParams(EffectSlot *slot, EffectSlot **sorted_slots, ContextBa
         }
     }
 
-    AtomicReplaceHead(context->mFreeEffectslotProps, props);
+    context->mEffectSlotPropsPool.put(props);
 
     EffectTarget output;
     if(EffectSlot *target{slot->Target})
@@ -516,9 +795,112 @@ bool CalcEffectSlotParams(EffectSlot *slot, EffectSlot **sorted_slots, ContextBa
         output = EffectTarget{&device->Dry, &device->RealOut};
     }
     state->update(context, slot, &slot->mEffectProps, output);
+
+    /* Make sure the effect is processed again with its new parameters. */
+    slot->mTailSamples = CalcEffectTailSamples(slot->EffectType, slot->mEffectProps,
+        static_cast<float>(context->mDevice->MixFrequency));
+    slot->mSilentSamples = 0;
     return true;
 }
 
+/* Updates the effects and source groups that output to effect slots whose
+ * wet buffers changed size, so they target the slots' current channels.
+ */
+void UpdateResizedSlotOutputs(const EffectSlotArray &slots, const SourceGroupArray &groups,
+    ContextBase *context)
+{
+    auto is_resized = [](const EffectSlot *slot) noexcept -> bool { return slot->mWetResized; };
+    if(std::none_of(slots.begin(), slots.end(), is_resized))
+        return;
+
+    for(EffectSlot *slot : slots)
+    {
+        EffectSlot *target{slot->Target};
+        if(target && target->mWetResized)
+            slot->mEffectState->update(context, slot, &slot->mEffectProps,
+                EffectTarget{&target->Wet, nullptr});
+    }
+
+    const uint numSends{context->mDevice->NumAuxSends};
+    for(SourceGroup *group : groups)
+    {
+        for(uint i{0};i < numSends;++i)
+        {
+            SourceGroup::OutputParams &output = group->mOutputs[1+i];
+            if(!output.Slot || !output.Slot->mWetResized)
+                continue;
+
+            /* The W channel always has a target with unity scale, so its gain
+             * is the output's base gain.
+             */
+            const float gain{output.Chans[0].Gain};
+            auto set_channel = [&output](size_t idx, uint outchan, float outgain)
+            {
+                output.Chans[idx].Target = outchan;
+                output.Chans[idx].Gain = outgain;
+            };
+            output.Slot->Wet.setAmbiMixParams(group->Wet, gain, set_channel);
+        }
+    }
+
+    for(EffectSlot *slot : slots)
+        slot->mWetResized = false;
+}
+
+/* Applies a source group's new properties, setting the filters and gains for
+ * its outputs.
+ */
+void CalcSourceGroupParams(SourceGroup *group, ContextBase *context)
+{
+    SourceGroupProps *props{group->Update.exchange(nullptr, std::memory_order_acq_rel)};
+    if(!props) return;
+
+    DeviceBase *Device{context->mDevice};
+    const auto Frequency = static_cast<float>(Device->MixFrequency);
+    const size_t numChans{group->Wet.Buffer.size()};
+
+    auto set_output = [group,Frequency,numChans](SourceGroup::OutputParams &output,
+        const MixParams &target, const float gain, const float gainHF, const float hfRef,
+        const float gainLF, const float lfRef)
+    {
+        output.FilterType = AF_None;
+        if(gainHF != 1.0f) output.FilterType |= AF_LowPass;
+        if(gainLF != 1.0f) output.FilterType |= AF_HighPass;
+
+        auto &lowpass = output.Chans[0].LowPass;
+        auto &highpass = output.Chans[0].HighPass;
+        lowpass.setParamsFromSlope(BiquadType::HighShelf, hfRef/Frequency, gainHF, 1.0f);
+        highpass.setParamsFromSlope(BiquadType::LowShelf, lfRef/Frequency, gainLF, 1.0f);
+        for(size_t c{1};c < numChans;++c)
+        {
+            output.Chans[c].LowPass.copyParamsFrom(lowpass);
+            output.Chans[c].HighPass.copyParamsFrom(highpass);
+        }
+
+        auto set_channel = [&output](size_t idx, uint outchan, float outgain)
+        {
+            output.Chans[idx].Target = outchan;
+            output.Chans[idx].Gain = outgain;
+        };
+        target.setAmbiMixParams(group->Wet, minf(gain, GainMixMax), set_channel);
+    };
+
+    set_output(group->mOutputs[0], Device->Dry, props->Gain*props->Direct.Gain,
+        props->Direct.GainHF, props->Direct.HFReference, props->Direct.GainLF,
+        props->Direct.LFReference);
+    for(uint i{0};i < Device->NumAuxSends;++i)
+    {
+        const auto &send = props->Send[i];
+        SourceGroup::OutputParams &output = group->mOutputs[1+i];
+        output.Slot = send.Slot;
+        if(send.Slot)
+            set_output(output, send.Slot->Wet, props->Gain*send.Gain, send.GainHF,
+                send.HFReference, send.GainLF, send.LFReference);
+    }
+
+    context->mSourceGroupPropsPool.put(props);
+}
+
 
 /* Scales the given azimuth toward the side (+/- pi/2 radians) for positions in
  * front.
@@ -701,10 +1083,122 @@ constexpr float Deg2Rad(float x) noexcept
 
 struct GainTriplet { float Base, HF, LF; };
 
+/* The audibility below which a voice drops to the reduced and low LODs (-24dB
+ * and -42dB), and the extra audibility needed to step back up (+3dB), so a
+ * voice near a threshold doesn't keep switching.
+ */
+constexpr float LodReducedGain{0.0630957f};
+constexpr float LodLowGain{0.00794328f};
+constexpr float LodHysteresis{1.41254f};
+
+/* Selects the LOD for a spatialized voice from its loudest output gain. Each
+ * step of priority counts as 6dB of audibility.
+ */
+VoiceLod SelectVoiceLod(const VoiceLod current, const GainTriplet &DryGain,
+    const al::span<const GainTriplet,MAX_SENDS> WetGain, EffectSlot *(&SendSlots)[MAX_SENDS],
+    const uint NumSends, const int priority) noexcept
+{
+    float audibility{DryGain.Base};
+    for(uint i{0};i < NumSends;++i)
+    {
+        if(SendSlots[i])
+            audibility = maxf(audibility, WetGain[i].Base);
+    }
+    audibility = std::ldexp(audibility, clampi(priority, -8, 8));
+
+    const float lowThreshold{(current == VoiceLod::Low) ? LodLowGain*LodHysteresis
+        : LodLowGain};
+    if(audibility < lowThreshold)
+        return VoiceLod::Low;
+    const float reducedThreshold{(current != VoiceLod::Full) ? LodReducedGain*LodHysteresis
+        : LodReducedGain};
+    if(audibility < reducedThreshold)
+        return VoiceLod::Reduced;
+    return VoiceLod::Full;
+}
+
+/* Removes the second- and higher-order responses from the panning
+ * coefficients.
+ */
+inline void LimitToFirstOrder(std::array<float,MaxAmbiChannels> &coeffs) noexcept
+{ std::fill(coeffs.begin()+4, coeffs.end(), 0.0f); }
+
+/* Voices are clustered by direction cells of 45 degree azimuth sectors in
+ * three elevation bands (up, level, and down), with the two poles.
+ */
+constexpr uint8_t ClusterCellUp{24};
+constexpr uint8_t ClusterCellDown{25};
+
+uint8_t GetClusterCell(const float xpos, const float ypos, const float zpos) noexcept
+{
+    /* sin(67.5 degrees) and sin(22.5 degrees). */
+    static constexpr float PoleLimit{0.92387953f};
+    static constexpr float LevelLimit{0.38268343f};
+    if(ypos > PoleLimit) return ClusterCellUp;
+    if(ypos < -PoleLimit) return ClusterCellDown;
+
+    const uint band{(ypos > LevelLimit) ? 0u : (ypos < -LevelLimit) ? 2u : 1u};
+    const float az{std::atan2(xpos, -zpos)};
+    const int sector{static_cast<int>(std::floor(az*al::numbers::inv_pi_v<float>*4.0f + 0.5f))};
+    return static_cast<uint8_t>(band*8u + static_cast<uint>(sector&7));
+}
+
+std::array<float,MaxAmbiChannels> GetClusterCellCoeffs(const uint8_t cell, const RenderMode mode)
+{
+    using namespace al::numbers;
+
+    float ev{0.0f}, az{0.0f};
+    if(cell == ClusterCellUp)
+        ev = pi_v<float>/2.0f;
+    else if(cell == ClusterCellDown)
+        ev = -pi_v<float>/2.0f;
+    else
+    {
+        ev = static_cast<float>(1 - cell/8) * pi_v<float>/4.0f;
+        az = static_cast<float>(cell%8) * pi_v<float>/4.0f;
+        if(az > pi_v<float>) az -= pi_v<float>*2.0f;
+    }
+    if(mode == RenderMode::Pairwise)
+        az = ScaleAzimuthFront(az, 1.5f);
+    return CalcAngleCoeffs(az, ev, 0.0f);
+}
+
+/* Sets a voice channel's HRTF target filter for the given direction. The
+ * current filter is kept if the direction moved by less than the device's
+ * hysteresis since it was made, to avoid refetching the coefficients and
+ * blending filters for imperceptible moves.
+ */
+void SetHrtfTarget(DeviceBase *Device, DirectHrtfParams &hrtfparams, const bool hadHrtf,
+    const float ev, const float az, const float distance, const float spread, const float gain)
+{
+    const float evcos{std::cos(ev)};
+    const std::array dir{std::sin(az)*evcos, std::sin(ev), -std::cos(az)*evcos};
+
+    hrtfparams.Target.Gain = gain;
+    if(hadHrtf && hrtfparams.HrtfId == Device->mHrtfId && hrtfparams.Spread == spread
+        && (hrtfparams.Distance == distance
+            || std::abs(hrtfparams.Distance-distance) <= hrtfparams.Distance*(1.0f/128.0f))
+        && (hrtfparams.Dir == dir || dir[0]*hrtfparams.Dir[0] + dir[1]*hrtfparams.Dir[1]
+            + dir[2]*hrtfparams.Dir[2] >= Device->mHrtfHysteresis))
+    {
+        Device->mProfile.mHrtfHeldUpdates.fetch_add(1u, std::memory_order_relaxed);
+        return;
+    }
+
+    Device->mHrtf->getCoeffs(ev, az, distance, spread, hrtfparams.Target.Coeffs,
+        hrtfparams.Target.Delay);
+    hrtfparams.HrtfId = Device->mHrtfId;
+    hrtfparams.Dir = dir;
+    hrtfparams.Distance = distance;
+    hrtfparams.Spread = spread;
+    hrtfparams.Changed = true;
+}
+
 void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, const float zpos,
     const float Distance, const float Spread, const GainTriplet &DryGain,
     const al::span<const GainTriplet,MAX_SENDS> WetGain, EffectSlot *(&SendSlots)[MAX_SENDS],
-    const VoiceProps *props, const ContextParams &Context, DeviceBase *Device)
+    const VoiceProps *props, const ListenerTransform &Listener, DeviceBase *Device,
+    AmbiRotateCache &RotCache)
 {
     static constexpr ChanMap MonoMap[1]{
         { FrontCenter, 0.0f, 0.0f }
@@ -747,18 +1241,31 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
         { FrontRight, Deg2Rad( 30.0f), Deg2Rad(0.0f) }
     };
 
-    const auto Frequency = static_cast<float>(Device->Frequency);
+    const auto Frequency = static_cast<float>(Device->MixFrequency);
     const uint NumSends{Device->NumAuxSends};
 
+    /* Voices in a source group pan to the group's buffer instead of the dry
+     * mix, which gets its filters and gain applied for the whole group.
+     */
+    SourceGroup *Group{props->Group};
+    const MixParams *DryMix{Group ? &Group->Wet : &Device->Dry};
+    if(Group)
+        voice->mDirect.Buffer = Group->Wet.Buffer;
+
     const size_t num_channels{voice->mChans.size()};
     ASSUME(num_channels > 0);
 
     for(auto &chandata : voice->mChans)
     {
-        chandata.mDryParams.Hrtf.Target = HrtfFilter{};
+        /* Keep the HRTF target filter, so it can be reused if the voice
+         * hasn't moved much.
+         */
+        if(DirectHrtfParams *hrtfparams{chandata.mDryParams.Hrtf})
+            hrtfparams->Target.Gain = 0.0f;
         chandata.mDryParams.Gains.Target.fill(0.0f);
         std::for_each(chandata.mWetParams.begin(), chandata.mWetParams.begin()+NumSends,
-            [](SendParams &params) -> void { params.Gains.Target.fill(0.0f); });
+            [](SendParams &params) -> void
+            { std::fill(params.Gains.Target.begin(), params.Gains.Target.end(), 0.0f); });
     }
 
     DirectMode DirectChannels{props->DirectChannels};
@@ -798,8 +1305,21 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
         DirectChannels = DirectMode::Off;
         break;
     }
+    /* The group's buffer is B-Format, which can't channel-match. */
+    if(Group)
+        DirectChannels = DirectMode::Off;
+
+    /* A voice moving in or out of a group has panning gains for a different
+     * buffer, so fade them in from silence.
+     */
+    if(voice->mFlags.test(VoiceInGroup) != (Group != nullptr))
+    {
+        for(auto &chandata : voice->mChans)
+            chandata.mDryParams.Gains.Current.fill(0.0f);
+    }
 
-    voice->mFlags.reset(VoiceHasHrtf).reset(VoiceHasNfc);
+    const bool hadHrtf{voice->mFlags.test(VoiceHasHrtf)};
+    voice->mFlags.reset(VoiceHasHrtf).reset(VoiceHasNfc).set(VoiceInGroup, Group != nullptr);
     if(auto *decoder{voice->mDecoder.get()})
         decoder->mWidthControl = minf(props->EnhWidth, 0.7f);
 
@@ -807,7 +1327,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
     {
         /* Special handling for B-Format and UHJ sources. */
 
-        if(Device->AvgSpeakerDist > 0.0f && voice->mFmtChannels != FmtUHJ2
+        if(Device->AvgSpeakerDist > 0.0f && !Group && voice->mFmtChannels != FmtUHJ2
             && voice->mFmtChannels != FmtSuperStereo)
         {
             if(!(Distance > std::numeric_limits<float>::epsilon()))
@@ -864,7 +1384,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
 
         if(!(coverage > 0.0f))
         {
-            ComputePanGains(&Device->Dry, coeffs.data(), DryGain.Base*scales[0],
+            ComputePanGains(DryMix, coeffs.data(), DryGain.Base*scales[0],
                 voice->mChans[0].mDryParams.Gains.Target);
             for(uint i{0};i < NumSends;i++)
             {
@@ -885,8 +1405,8 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
             V.normalize();
             if(!props->HeadRelative)
             {
-                N = Context.Matrix * N;
-                V = Context.Matrix * V;
+                N = Listener.Matrix * N;
+                V = Listener.Matrix * V;
             }
             /* Build and normalize right-vector */
             alu::Vector U{N.cross_product(V)};
@@ -894,16 +1414,26 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
 
             /* Build a rotation matrix. Manually fill the zeroth- and first-
              * order elements, then construct the rotation for the higher
-             * orders.
+             * orders. The last one built is reused if this voice has the same
+             * orientation.
              */
-            AmbiRotateMatrix &shrot = Device->mAmbiRotateMatrix;
-            shrot.fill(AmbiRotateMatrix::value_type{});
+            AmbiRotateMatrix &shrot = RotCache.mRotate;
+            const std::array<float,9> basis{U[0], U[1], U[2], V[0], V[1], V[2], N[0], N[1],
+                N[2]};
+            if(RotCache.mOrder != Device->mAmbiOrder || RotCache.mBasis != basis)
+            {
+                shrot.fill(AmbiRotateMatrix::value_type{});
+
+                shrot[0][0] = 1.0f;
+                shrot[1][1] =  U[0]; shrot[1][2] = -U[1]; shrot[1][3] =  U[2];
+                shrot[2][1] = -V[0]; shrot[2][2] =  V[1]; shrot[2][3] = -V[2];
+                shrot[3][1] = -N[0]; shrot[3][2] =  N[1]; shrot[3][3] = -N[2];
+                AmbiRotator(shrot, static_cast<int>(Device->mAmbiOrder));
 
-            shrot[0][0] = 1.0f;
-            shrot[1][1] =  U[0]; shrot[1][2] = -U[1]; shrot[1][3] =  U[2];
-            shrot[2][1] = -V[0]; shrot[2][2] =  V[1]; shrot[2][3] = -V[2];
-            shrot[3][1] = -N[0]; shrot[3][2] =  N[1]; shrot[3][3] = -N[2];
-            AmbiRotator(shrot, static_cast<int>(Device->mAmbiOrder));
+                RotCache.mBasis = basis;
+                RotCache.mOrder = Device->mAmbiOrder;
+                RotCache.mUpsampler = nullptr;
+            }
 
             /* If the device is higher order than the voice, "upsample" the
              * matrix.
@@ -914,39 +1444,37 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
              * on various channels (i.e. when elevation=0, those height-related
              * channels should be non-0).
              */
-            AmbiRotateMatrix &mixmatrix = Device->mAmbiRotateMatrix2;
+            const AmbiRotateMatrix *mixmatrix{&shrot};
             if(Device->mAmbiOrder > voice->mAmbiOrder
                 || (Device->mAmbiOrder >= 2 && !Device->m2DMixing
                     && Is2DAmbisonic(voice->mFmtChannels)))
             {
+                al::span<const std::array<float,MaxAmbiChannels>> upsampler;
                 if(voice->mAmbiOrder == 1)
-                {
-                    auto&& upsampler = Is2DAmbisonic(voice->mFmtChannels) ?
-                        AmbiScale::FirstOrder2DUp : AmbiScale::FirstOrderUp;
-                    UpsampleBFormatTransform(mixmatrix, upsampler, shrot, Device->mAmbiOrder);
-                }
+                    upsampler = Is2DAmbisonic(voice->mFmtChannels) ?
+                        al::span{AmbiScale::FirstOrder2DUp} : al::span{AmbiScale::FirstOrderUp};
                 else if(voice->mAmbiOrder == 2)
-                {
-                    auto&& upsampler = Is2DAmbisonic(voice->mFmtChannels) ?
-                        AmbiScale::SecondOrder2DUp : AmbiScale::SecondOrderUp;
-                    UpsampleBFormatTransform(mixmatrix, upsampler, shrot, Device->mAmbiOrder);
-                }
+                    upsampler = Is2DAmbisonic(voice->mFmtChannels) ?
+                        al::span{AmbiScale::SecondOrder2DUp} : al::span{AmbiScale::SecondOrderUp};
                 else if(voice->mAmbiOrder == 3)
-                {
-                    auto&& upsampler = Is2DAmbisonic(voice->mFmtChannels) ?
-                        AmbiScale::ThirdOrder2DUp : AmbiScale::ThirdOrderUp;
-                    UpsampleBFormatTransform(mixmatrix, upsampler, shrot, Device->mAmbiOrder);
-                }
+                    upsampler = Is2DAmbisonic(voice->mFmtChannels) ?
+                        al::span{AmbiScale::ThirdOrder2DUp} : al::span{AmbiScale::ThirdOrderUp};
                 else if(voice->mAmbiOrder == 4)
-                {
-                    auto&& upsampler = AmbiScale::FourthOrder2DUp;
-                    UpsampleBFormatTransform(mixmatrix, upsampler, shrot, Device->mAmbiOrder);
-                }
+                    upsampler = AmbiScale::FourthOrder2DUp;
                 else
                     al::unreachable();
+
+                /* The upsampled matrix is also kept for the next voice with
+                 * the same rotation and input format.
+                 */
+                if(RotCache.mUpsampler != upsampler.data())
+                {
+                    UpsampleBFormatTransform(RotCache.mMix, upsampler, shrot,
+                        Device->mAmbiOrder);
+                    RotCache.mUpsampler = upsampler.data();
+                }
+                mixmatrix = &RotCache.mMix;
             }
-            else
-                mixmatrix = shrot;
 
             /* Convert the rotation matrix for input ordering and scaling, and
              * whether input is 2D or 3D.
@@ -971,9 +1499,9 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
                  * other channels, use just the (scaled) B-Format signal.
                  */
                 for(size_t x{0};x < MaxAmbiChannels;++x)
-                    coeffs[x] += mixmatrix[acn][x] * scale;
+                    coeffs[x] += (*mixmatrix)[acn][x] * scale;
 
-                ComputePanGains(&Device->Dry, coeffs.data(), DryGain.Base,
+                ComputePanGains(DryMix, coeffs.data(), DryGain.Base,
                     voice->mChans[c].mDryParams.Gains.Target);
 
                 for(uint i{0};i < NumSends;i++)
@@ -1037,13 +1565,25 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
             }
         }
     }
-    else if(Device->mRenderMode == RenderMode::Hrtf)
+    else if(Device->mRenderMode == RenderMode::Hrtf && voice->mLod != VoiceLod::Low && !Group)
     {
         /* Full HRTF rendering. Skip the virtual channels and render to the
          * real outputs.
          */
         voice->mDirect.Buffer = Device->RealOut.Buffer;
 
+        /* If the voice was panned to the dry mix, fade its HRTF filters in
+         * from silence.
+         */
+        if(!hadHrtf)
+        {
+            for(auto &chandata : voice->mChans)
+            {
+                if(DirectHrtfParams *hrtfparams{chandata.mDryParams.Hrtf})
+                    hrtfparams->Old.Gain = 0.0f;
+            }
+        }
+
         if(Distance > std::numeric_limits<float>::epsilon())
         {
             const float src_ev{std::asin(clampf(ypos, -1.0f, 1.0f))};
@@ -1051,10 +1591,8 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
 
             if(voice->mFmtChannels == FmtMono)
             {
-                Device->mHrtf->getCoeffs(src_ev, src_az, Distance*NfcScale, Spread,
-                    voice->mChans[0].mDryParams.Hrtf.Target.Coeffs,
-                    voice->mChans[0].mDryParams.Hrtf.Target.Delay);
-                voice->mChans[0].mDryParams.Hrtf.Target.Gain = DryGain.Base;
+                SetHrtfTarget(Device, *voice->mChans[0].mDryParams.Hrtf, hadHrtf, src_ev, src_az,
+                    Distance*NfcScale, Spread, DryGain.Base);
 
                 const auto coeffs = CalcAngleCoeffs(src_az, src_ev, Spread);
                 for(uint i{0};i < NumSends;i++)
@@ -1088,10 +1626,8 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
                 if(az < -pi_v<float>) az += pi_v<float>*2.0f;
                 else if(az > pi_v<float>) az -= pi_v<float>*2.0f;
 
-                Device->mHrtf->getCoeffs(ev, az, Distance*NfcScale, 0.0f,
-                    voice->mChans[c].mDryParams.Hrtf.Target.Coeffs,
-                    voice->mChans[c].mDryParams.Hrtf.Target.Delay);
-                voice->mChans[c].mDryParams.Hrtf.Target.Gain = DryGain.Base;
+                SetHrtfTarget(Device, *voice->mChans[c].mDryParams.Hrtf, hadHrtf, ev, az,
+                    Distance*NfcScale, 0.0f, DryGain.Base);
 
                 const auto coeffs = CalcAngleCoeffs(az, ev, 0.0f);
                 for(uint i{0};i < NumSends;i++)
@@ -1123,11 +1659,9 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
                 /* Get the HRIR coefficients and delays for this channel
                  * position.
                  */
-                Device->mHrtf->getCoeffs(chans[c].elevation, chans[c].angle,
-                    std::numeric_limits<float>::infinity(), spread,
-                    voice->mChans[c].mDryParams.Hrtf.Target.Coeffs,
-                    voice->mChans[c].mDryParams.Hrtf.Target.Delay);
-                voice->mChans[c].mDryParams.Hrtf.Target.Gain = DryGain.Base;
+                SetHrtfTarget(Device, *voice->mChans[c].mDryParams.Hrtf, hadHrtf,
+                    chans[c].elevation, chans[c].angle, std::numeric_limits<float>::infinity(),
+                    spread, DryGain.Base);
 
                 /* Normal panning for auxiliary sends. */
                 const auto coeffs = CalcAngleCoeffs(chans[c].angle, chans[c].elevation, spread);
@@ -1147,10 +1681,19 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
     {
         /* Non-HRTF rendering. Use normal panning to the output. */
 
+        /* A low LOD voice on HRTF output was using its own HRTF filters, so
+         * fade its panning gains in from silence.
+         */
+        if(hadHrtf)
+        {
+            for(auto &chandata : voice->mChans)
+                chandata.mDryParams.Gains.Current.fill(0.0f);
+        }
+
         if(Distance > std::numeric_limits<float>::epsilon())
         {
             /* Calculate NFC filter coefficient if needed. */
-            if(Device->AvgSpeakerDist > 0.0f)
+            if(Device->AvgSpeakerDist > 0.0f && voice->mLod == VoiceLod::Full && !Group)
             {
                 /* Clamp the distance for really close sources, to prevent
                  * excessive bass.
@@ -1175,9 +1718,11 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
                     const float az{std::atan2(xpos, -zpos)};
                     return CalcAngleCoeffs(ScaleAzimuthFront(az, 1.5f), ev, Spread);
                 };
-                const auto coeffs = calc_coeffs(Device->mRenderMode);
+                auto coeffs = calc_coeffs(Device->mRenderMode);
+                if(voice->mLod == VoiceLod::Low)
+                    LimitToFirstOrder(coeffs);
 
-                ComputePanGains(&Device->Dry, coeffs.data(), DryGain.Base,
+                ComputePanGains(DryMix, coeffs.data(), DryGain.Base,
                     voice->mChans[0].mDryParams.Gains.Target);
                 for(uint i{0};i < NumSends;i++)
                 {
@@ -1198,7 +1743,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
                     /* Special-case LFE */
                     if(chans[c].channel == LFE)
                     {
-                        if(Device->Dry.Buffer.data() == Device->RealOut.Buffer.data())
+                        if(!Group && Device->Dry.Buffer.data() == Device->RealOut.Buffer.data())
                         {
                             const uint idx{Device->channelIdxByName(chans[c].channel)};
                             if(idx != InvalidChannelIndex)
@@ -1227,9 +1772,11 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
 
                     if(Device->mRenderMode == RenderMode::Pairwise)
                         az = ScaleAzimuthFront(az, 3.0f);
-                    const auto coeffs = CalcAngleCoeffs(az, ev, 0.0f);
+                    auto coeffs = CalcAngleCoeffs(az, ev, 0.0f);
+                    if(voice->mLod == VoiceLod::Low)
+                        LimitToFirstOrder(coeffs);
 
-                    ComputePanGains(&Device->Dry, coeffs.data(), DryGain.Base,
+                    ComputePanGains(DryMix, coeffs.data(), DryGain.Base,
                         voice->mChans[c].mDryParams.Gains.Target);
                     for(uint i{0};i < NumSends;i++)
                     {
@@ -1242,7 +1789,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
         }
         else
         {
-            if(Device->AvgSpeakerDist > 0.0f)
+            if(Device->AvgSpeakerDist > 0.0f && voice->mLod == VoiceLod::Full && !Group)
             {
                 /* If the source distance is 0, simulate a plane-wave by using
                  * infinite distance, which results in a w0 of 0.
@@ -1264,7 +1811,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
                 /* Special-case LFE */
                 if(chans[c].channel == LFE)
                 {
-                    if(Device->Dry.Buffer.data() == Device->RealOut.Buffer.data())
+                    if(!Group && Device->Dry.Buffer.data() == Device->RealOut.Buffer.data())
                     {
                         const uint idx{Device->channelIdxByName(chans[c].channel)};
                         if(idx != InvalidChannelIndex)
@@ -1273,11 +1820,13 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
                     continue;
                 }
 
-                const auto coeffs = CalcAngleCoeffs((Device->mRenderMode == RenderMode::Pairwise)
+                auto coeffs = CalcAngleCoeffs((Device->mRenderMode == RenderMode::Pairwise)
                     ? ScaleAzimuthFront(chans[c].angle, 3.0f) : chans[c].angle,
                     chans[c].elevation, spread);
+                if(voice->mLod == VoiceLod::Low)
+                    LimitToFirstOrder(coeffs);
 
-                ComputePanGains(&Device->Dry, coeffs.data(), DryGain.Base,
+                ComputePanGains(DryMix, coeffs.data(), DryGain.Base,
                     voice->mChans[c].mDryParams.Gains.Target);
                 for(uint i{0};i < NumSends;i++)
                 {
@@ -1326,9 +1875,12 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
             voice->mChans[c].mWetParams[i].HighPass.copyParamsFrom(highpass);
         }
     }
+
+    voice->updateMixPath();
 }
 
-void CalcNonAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBase *context)
+void CalcNonAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBase *context,
+    AmbiRotateCache &rotcache, ResamplerStateCache &rescache)
 {
     DeviceBase *Device{context->mDevice};
     EffectSlot *SendSlots[MAX_SENDS];
@@ -1348,12 +1900,16 @@ void CalcNonAttnSourceParams(Voice *voice, const VoiceProps *props, const Contex
 
     /* Calculate the stepping value */
     const auto Pitch = static_cast<float>(voice->mFrequency) /
-        static_cast<float>(Device->Frequency) * props->Pitch;
+        static_cast<float>(Device->MixFrequency) * props->Pitch;
     if(Pitch > float{MaxPitch})
         voice->mStep = MaxPitch<<MixerFracBits;
     else
         voice->mStep = maxu(fastf2u(Pitch * MixerFracOne), 1);
-    voice->mResampler = PrepareResampler(props->mResampler, voice->mStep, &voice->mResampleState);
+    voice->mLod = VoiceLod::Full;
+    voice->mClusterCell = NoSpatialCluster;
+    voice->mClusterPending = true;
+    voice->mFlags.set(VoiceGainsChanged);
+    SetVoiceResampler(voice, Device, props->mResampler, rescache);
 
     /* Calculate gains */
     GainTriplet DryGain;
@@ -1371,10 +1927,137 @@ void CalcNonAttnSourceParams(Voice *voice, const VoiceProps *props, const Contex
     }
 
     CalcPanningAndFilters(voice, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, DryGain, WetGain, SendSlots, props,
-        context->mParams, Device);
+        context->mParams.Listeners[0], Device, rotcache);
+}
+
+/* The listener-relative position, distance, and the dot products used for
+ * cones and doppler, for a spatialized source.
+ */
+struct SourceGeometry {
+    float ToSource[3];
+    float Distance;
+    bool Directional;
+    float DirDotSource;
+    float VelDotSource;
+    float ListenerVelDotSource;
+};
+
+/* The number of voices to calculate the geometry of together. Enough for two
+ * SSE or one AVX vector per property.
+ */
+constexpr size_t GeometryBatchSize{8};
+
+/* Calculates the geometry for a batch of voices. The positions, velocities,
+ * and directions are gathered into separate arrays, so the transforms and
+ * normalizations are done on several voices at once. The math mirrors the
+ * scalar alu::Vector and alu::Matrix operations, giving the same results.
+ */
+void CalcSourceGeometry(const ListenerTransform &listener, const al::span<Voice*const> voices,
+    const al::span<SourceGeometry> geoms)
+{
+    ASSUME(voices.size() <= GeometryBatchSize);
+    constexpr size_t N{GeometryBatchSize};
+    alignas(16) float px[N]{}, py[N]{}, pz[N]{};
+    alignas(16) float vx[N]{}, vy[N]{}, vz[N]{};
+    alignas(16) float dx[N]{}, dy[N]{}, dz[N]{};
+    alignas(16) float rel[N]{};
+
+    for(size_t i{0};i < voices.size();++i)
+    {
+        const VoiceProps &props = voices[i]->mProps;
+        px[i] = props.Position[0]; py[i] = props.Position[1]; pz[i] = props.Position[2];
+        vx[i] = props.Velocity[0]; vy[i] = props.Velocity[1]; vz[i] = props.Velocity[2];
+        dx[i] = props.Direction[0]; dy[i] = props.Direction[1]; dz[i] = props.Direction[2];
+        rel[i] = props.HeadRelative ? 1.0f : 0.0f;
+    }
+
+    /* Transform source vectors to listener space (convert to head relative),
+     * or offset the velocity of head-relative sources by the listener's.
+     */
+    const alu::Matrix &mtx = listener.Matrix;
+    const alu::Vector &lpos = listener.Position;
+    const alu::Vector &lvel = listener.Velocity;
+    const float pw{1.0f - lpos[3]};
+    for(size_t i{0};i < N;++i)
+    {
+        const float x{px[i] - lpos[0]}, y{py[i] - lpos[1]}, z{pz[i] - lpos[2]};
+        const float tx{x*mtx[0][0] + y*mtx[1][0] + z*mtx[2][0] + pw*mtx[3][0]};
+        const float ty{x*mtx[0][1] + y*mtx[1][1] + z*mtx[2][1] + pw*mtx[3][1]};
+        const float tz{x*mtx[0][2] + y*mtx[1][2] + z*mtx[2][2] + pw*mtx[3][2]};
+        px[i] = (rel[i] != 0.0f) ? px[i] : tx;
+        py[i] = (rel[i] != 0.0f) ? py[i] : ty;
+        pz[i] = (rel[i] != 0.0f) ? pz[i] : tz;
+    }
+    for(size_t i{0};i < N;++i)
+    {
+        const float tx{vx[i]*mtx[0][0] + vy[i]*mtx[1][0] + vz[i]*mtx[2][0] + 0.0f*mtx[3][0]};
+        const float ty{vx[i]*mtx[0][1] + vy[i]*mtx[1][1] + vz[i]*mtx[2][1] + 0.0f*mtx[3][1]};
+        const float tz{vx[i]*mtx[0][2] + vy[i]*mtx[1][2] + vz[i]*mtx[2][2] + 0.0f*mtx[3][2]};
+        vx[i] = (rel[i] != 0.0f) ? vx[i]+lvel[0] : tx;
+        vy[i] = (rel[i] != 0.0f) ? vy[i]+lvel[1] : ty;
+        vz[i] = (rel[i] != 0.0f) ? vz[i]+lvel[2] : tz;
+    }
+    for(size_t i{0};i < N;++i)
+    {
+        const float tx{dx[i]*mtx[0][0] + dy[i]*mtx[1][0] + dz[i]*mtx[2][0] + 0.0f*mtx[3][0]};
+        const float ty{dx[i]*mtx[0][1] + dy[i]*mtx[1][1] + dz[i]*mtx[2][1] + 0.0f*mtx[3][1]};
+        const float tz{dx[i]*mtx[0][2] + dy[i]*mtx[1][2] + dz[i]*mtx[2][2] + 0.0f*mtx[3][2]};
+        dx[i] = (rel[i] != 0.0f) ? dx[i] : tx;
+        dy[i] = (rel[i] != 0.0f) ? dy[i] : ty;
+        dz[i] = (rel[i] != 0.0f) ? dz[i] : tz;
+    }
+
+    /* Normalize the direction and position, keeping the distance. */
+    static constexpr float limit{std::numeric_limits<float>::epsilon()};
+    alignas(16) float dlen[N], dist[N];
+    for(size_t i{0};i < N;++i)
+    {
+        const float length_sqr{dx[i]*dx[i] + dy[i]*dy[i] + dz[i]*dz[i]};
+        const bool valid{length_sqr > limit*limit};
+        const float length{valid ? std::sqrt(length_sqr) : 0.0f};
+        const float inv_length{1.0f/length};
+        dx[i] = valid ? dx[i]*inv_length : 0.0f;
+        dy[i] = valid ? dy[i]*inv_length : 0.0f;
+        dz[i] = valid ? dz[i]*inv_length : 0.0f;
+        dlen[i] = length;
+    }
+    for(size_t i{0};i < N;++i)
+    {
+        const float length_sqr{px[i]*px[i] + py[i]*py[i] + pz[i]*pz[i]};
+        const bool valid{length_sqr > limit*limit};
+        const float length{valid ? std::sqrt(length_sqr) : 0.0f};
+        const float inv_length{1.0f/length};
+        px[i] = valid ? px[i]*inv_length : 0.0f;
+        py[i] = valid ? py[i]*inv_length : 0.0f;
+        pz[i] = valid ? pz[i]*inv_length : 0.0f;
+        dist[i] = length;
+    }
+
+    alignas(16) float ddot[N], vdot[N], ldot[N];
+    for(size_t i{0};i < N;++i)
+    {
+        ddot[i] = dx[i]*px[i] + dy[i]*py[i] + dz[i]*pz[i];
+        vdot[i] = vx[i]*px[i] + vy[i]*py[i] + vz[i]*pz[i];
+        ldot[i] = lvel[0]*px[i] + lvel[1]*py[i] + lvel[2]*pz[i];
+    }
+
+    for(size_t i{0};i < voices.size();++i)
+    {
+        SourceGeometry &geom = geoms[i];
+        geom.ToSource[0] = px[i];
+        geom.ToSource[1] = py[i];
+        geom.ToSource[2] = pz[i];
+        geom.Distance = dist[i];
+        geom.Directional = dlen[i] > 0.0f;
+        geom.DirDotSource = ddot[i];
+        geom.VelDotSource = vdot[i];
+        geom.ListenerVelDotSource = ldot[i];
+    }
 }
 
-void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBase *context)
+void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBase *context,
+    const ListenerTransform &listener, const SourceGeometry &geom, AmbiRotateCache &rotcache,
+    ResamplerStateCache &rescache)
 {
     DeviceBase *Device{context->mDevice};
     const uint NumSends{Device->NumAuxSends};
@@ -1402,26 +2085,7 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
             voice->mSend[i].Buffer = SendSlots[i]->Wet.Buffer;
     }
 
-    /* Transform source to listener space (convert to head relative) */
-    alu::Vector Position{props->Position[0], props->Position[1], props->Position[2], 1.0f};
-    alu::Vector Velocity{props->Velocity[0], props->Velocity[1], props->Velocity[2], 0.0f};
-    alu::Vector Direction{props->Direction[0], props->Direction[1], props->Direction[2], 0.0f};
-    if(!props->HeadRelative)
-    {
-        /* Transform source vectors */
-        Position = context->mParams.Matrix * (Position - context->mParams.Position);
-        Velocity = context->mParams.Matrix * Velocity;
-        Direction = context->mParams.Matrix * Direction;
-    }
-    else
-    {
-        /* Offset the source velocity to be relative of the listener velocity */
-        Velocity += context->mParams.Velocity;
-    }
-
-    const bool directional{Direction.normalize() > 0.0f};
-    alu::Vector ToSource{Position[0], Position[1], Position[2], 0.0f};
-    const float Distance{ToSource.normalize()};
+    const float Distance{geom.Distance};
 
     /* Calculate distance attenuation */
     float ClampedDist{Distance};
@@ -1482,10 +2146,10 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
 
     /* Calculate directional soundcones */
     float ConeHF{1.0f}, WetConeHF{1.0f};
-    if(directional && props->InnerAngle < 360.0f)
+    if(geom.Directional && props->InnerAngle < 360.0f)
     {
         static constexpr float Rad2Deg{static_cast<float>(180.0 / al::numbers::pi)};
-        const float Angle{Rad2Deg*2.0f * std::acos(-Direction.dot_product(ToSource)) * ConeScale};
+        const float Angle{Rad2Deg*2.0f * std::acos(-geom.DirDotSource) * ConeScale};
 
         float ConeGain{1.0f};
         if(Angle >= props->OuterAngle)
@@ -1615,6 +2279,8 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
         }
     }
 
+    voice->mLod = Device->mVoiceLod ? SelectVoiceLod(voice->mLod, DryGain, WetGain, SendSlots,
+        NumSends, props->Priority) : VoiceLod::Full;
 
     /* Initial source pitch */
     float Pitch{props->Pitch};
@@ -1623,9 +2289,8 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
     float DopplerFactor{props->DopplerFactor * context->mParams.DopplerFactor};
     if(DopplerFactor > 0.0f)
     {
-        const alu::Vector &lvelocity = context->mParams.Velocity;
-        float vss{Velocity.dot_product(ToSource) * -DopplerFactor};
-        float vls{lvelocity.dot_product(ToSource) * -DopplerFactor};
+        const float vss{geom.VelDotSource * -DopplerFactor};
+        const float vls{geom.ListenerVelDotSource * -DopplerFactor};
 
         const float SpeedOfSound{context->mParams.SpeedOfSound};
         if(!(vls < SpeedOfSound))
@@ -1654,12 +2319,12 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
     /* Adjust pitch based on the buffer and output frequencies, and calculate
      * fixed-point stepping value.
      */
-    Pitch *= static_cast<float>(voice->mFrequency) / static_cast<float>(Device->Frequency);
+    Pitch *= static_cast<float>(voice->mFrequency) / static_cast<float>(Device->MixFrequency);
     if(Pitch > float{MaxPitch})
         voice->mStep = MaxPitch<<MixerFracBits;
     else
         voice->mStep = maxu(fastf2u(Pitch * MixerFracOne), 1);
-    voice->mResampler = PrepareResampler(props->mResampler, voice->mStep, &voice->mResampleState);
+    SetVoiceResampler(voice, Device, props->mResampler, rescache);
 
     float spread{0.0f};
     if(props->Radius > Distance)
@@ -1667,31 +2332,284 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
     else if(Distance > 0.0f)
         spread = std::asin(props->Radius/Distance) * 2.0f;
 
-    CalcPanningAndFilters(voice, ToSource[0]*XScale, ToSource[1]*YScale, ToSource[2]*ZScale,
-        Distance, spread, DryGain, WetGain, SendSlots, props, context->mParams, Device);
+    const float xpos{geom.ToSource[0]*XScale};
+    const float ypos{geom.ToSource[1]*YScale};
+    const float zpos{geom.ToSource[2]*ZScale};
+    CalcPanningAndFilters(voice, xpos, ypos, zpos, Distance, spread, DryGain, WetGain, SendSlots,
+        props, listener, Device, rotcache);
+
+    /* Mono voices past the cluster distance can be mixed in the cluster for
+     * their direction, which gets panned for them, so keep their unpanned
+     * gains.
+     */
+    voice->mClusterCell = NoSpatialCluster;
+    if(Device->mClusterDistance > 0.0f && voice->mFmtChannels == FmtMono && !props->Group
+        && Distance*context->mParams.MetersPerUnit >= Device->mClusterDistance)
+    {
+        voice->mClusterCell = GetClusterCell(xpos, ypos, zpos);
+        voice->mClusterDryGain = DryGain.Base;
+        for(uint i{0};i < NumSends;i++)
+            voice->mClusterWetGains[i] = SendSlots[i] ? WetGain[i].Base : 0.0f;
+    }
+    voice->mClusterPending = true;
+    voice->mFlags.set(VoiceGainsChanged);
 }
 
-void CalcSourceParams(Voice *voice, ContextBase *context, bool force)
+/* Calculates the parameters of a spatialized source heard by multiple
+ * listeners, given its geometry relative to each. The voice is still decoded
+ * and resampled once, with the panned gains for each listener mixed together,
+ * weighted by how close the listener is relative to the closest one. The
+ * closest listener is calculated last, so its doppler shift, filters, and
+ * level of detail are what the voice uses. With HRTF, the dry path only uses
+ * the closest listener.
+ */
+void CalcMultiListenerParams(Voice *voice, const VoiceProps *props, const ContextBase *context,
+    const al::span<const SourceGeometry> geoms, AmbiRotateCache &rotcache,
+    ResamplerStateCache &rescache)
 {
-    VoicePropsItem *props{voice->mUpdate.exchange(nullptr, std::memory_order_acq_rel)};
-    if(!props && !force) return;
+    const ContextParams &params = context->mParams;
 
-    if(props)
+    /* Head-relative sources are in the same place for every listener. */
+    if(props->HeadRelative)
+        return CalcAttnSourceParams(voice, props, context, params.Listeners[0], geoms[0],
+            rotcache, rescache);
+
+    size_t closest{0};
+    for(size_t i{1};i < geoms.size();++i)
     {
-        voice->mProps = *props;
+        if(geoms[i].Distance < geoms[closest].Distance)
+            closest = i;
+    }
 
-        AtomicReplaceHead(context->mFreeVoiceProps, props);
+    /* A source on top of the closest listener is only heard by it. */
+    const float mindist{geoms[closest].Distance};
+    std::array<float,MaxListeners> weights{};
+    float total{0.0f};
+    for(size_t i{0};i < geoms.size();++i)
+    {
+        if(i == closest)
+            weights[i] = 1.0f;
+        else if(mindist > 0.0f)
+        {
+            const float ratio{mindist / geoms[i].Distance};
+            weights[i] = ratio * ratio;
+        }
+        total += weights[i];
     }
 
-    if((voice->mProps.DirectChannels != DirectMode::Off && voice->mFmtChannels != FmtMono
-            && !IsAmbisonic(voice->mFmtChannels))
-        || voice->mProps.mSpatializeMode == SpatializeMode::Off
-        || (voice->mProps.mSpatializeMode==SpatializeMode::Auto && voice->mFmtChannels != FmtMono))
-        CalcNonAttnSourceParams(voice, &voice->mProps, context);
-    else
-        CalcAttnSourceParams(voice, &voice->mProps, context);
+    constexpr size_t MaxChans{VoiceMixScratch::MixerChannelsMax};
+    alignas(16) std::array<std::array<float,MAX_OUTPUT_CHANNELS>,MaxChans> drygains{};
+    alignas(16) std::array<float,MaxChans*MAX_SENDS*MaxAmbiChannels> wetgains{};
+    const size_t NumSends{context->mDevice->NumAuxSends};
+
+    const auto lod = voice->mLod;
+    for(size_t i{0};i < geoms.size();++i)
+    {
+        if(i == closest || !(weights[i] > 0.0f))
+            continue;
+
+        voice->mLod = lod;
+        CalcAttnSourceParams(voice, props, context, params.Listeners[i], geoms[i], rotcache,
+            rescache);
+
+        const float weight{weights[i] / total};
+        for(size_t c{0};c < voice->mChans.size();++c)
+        {
+            auto &chan = voice->mChans[c];
+            for(size_t j{0};j < MAX_OUTPUT_CHANNELS;++j)
+                drygains[c][j] += chan.mDryParams.Gains.Target[j] * weight;
+            for(size_t s{0};s < NumSends;++s)
+            {
+                const auto target = chan.mWetParams[s].Gains.Target;
+                float *accum{&wetgains[(c*NumSends + s) * MaxAmbiChannels]};
+                for(size_t j{0};j < target.size();++j)
+                    accum[j] += target[j] * weight;
+            }
+        }
+    }
+
+    voice->mLod = lod;
+    CalcAttnSourceParams(voice, props, context, params.Listeners[closest], geoms[closest],
+        rotcache, rescache);
+
+    const float weight{weights[closest] / total};
+    const bool mixdry{!voice->mFlags.test(VoiceHasHrtf)};
+    for(size_t c{0};c < voice->mChans.size();++c)
+    {
+        auto &chan = voice->mChans[c];
+        if(mixdry)
+        {
+            for(size_t j{0};j < MAX_OUTPUT_CHANNELS;++j)
+                chan.mDryParams.Gains.Target[j] = chan.mDryParams.Gains.Target[j]*weight
+                    + drygains[c][j];
+        }
+        for(size_t s{0};s < NumSends;++s)
+        {
+            const auto target = chan.mWetParams[s].Gains.Target;
+            const float *accum{&wetgains[(c*NumSends + s) * MaxAmbiChannels]};
+            for(size_t j{0};j < target.size();++j)
+                target[j] = target[j]*weight + accum[j];
+        }
+    }
+
+    /* The combined gains don't come from one direction, so the voice can't be
+     * mixed into a spatial cluster.
+     */
+    voice->mClusterCell = NoSpatialCluster;
+}
+
+float &GetRampedParam(VoiceProps &props, const size_t idx) noexcept
+{
+    switch(idx)
+    {
+    case RampGain: return props.Gain;
+    case RampPitch: return props.Pitch;
+    case RampDirectGain: return props.Direct.Gain;
+    case RampDirectGainHF: return props.Direct.GainHF;
+    }
+    auto &send = props.Send[(idx-RampSendGain) / 2];
+    return ((idx-RampSendGain)&1) ? send.GainHF : send.Gain;
 }
 
+/* The level exponential ramps treat silence as (-100dB), so they can fade
+ * from and to it.
+ */
+constexpr float RampSilence{0.00001f};
+
+/* Starts a ramp for each parameter with a new one in the incoming props, from
+ * the parameter's current value. Called before the props replace the voice's.
+ */
+void StartVoiceRamps(Voice *voice, VoiceProps &props, const nanoseconds curtime) noexcept
+{
+    for(size_t i{0};i < NumRampParams;++i)
+    {
+        Voice::RampState &ramp = voice->mRamps[i];
+        const float target{GetRampedParam(props, i)};
+        if(props.Ramps[i].Serial == ramp.mSerial)
+        {
+            if(!ramp.mActive)
+                ramp.mTarget = target;
+            continue;
+        }
+
+        ramp.mStart = ramp.mActive ? GetRampedParam(voice->mProps, i) :
+            voice->mRampTargetsKnown ? ramp.mTarget : target;
+        ramp.mTarget = target;
+        ramp.mStartTime = curtime;
+        ramp.mSerial = props.Ramps[i].Serial;
+        ramp.mActive = props.Ramps[i].Duration > 0.0f && ramp.mStart != target;
+        voice->mHasRamps |= ramp.mActive;
+    }
+    voice->mRampTargetsKnown = true;
+}
+
+/* Sets the voice's ramped parameters for the current time, returning whether
+ * any ramps are still in progress.
+ */
+bool ApplyVoiceRamps(Voice *voice, const nanoseconds curtime) noexcept
+{
+    bool active{false};
+    for(size_t i{0};i < NumRampParams;++i)
+    {
+        Voice::RampState &ramp = voice->mRamps[i];
+        if(!ramp.mActive) continue;
+
+        const ParamRamp &params = voice->mProps.Ramps[i];
+        const float elapsed{std::chrono::duration<float>(curtime - ramp.mStartTime).count()};
+        float &value = GetRampedParam(voice->mProps, i);
+        if(!(elapsed < params.Duration))
+        {
+            value = ramp.mTarget;
+            ramp.mActive = false;
+            continue;
+        }
+
+        const float t{elapsed / params.Duration};
+        if(params.Curve == RampCurve::Exponential)
+        {
+            const float start{maxf(ramp.mStart, RampSilence)};
+            const float end{maxf(ramp.mTarget, RampSilence)};
+            value = start * std::pow(end/start, t);
+        }
+        else
+            value = lerpf(ramp.mStart, ramp.mTarget, t);
+        active = true;
+    }
+    return active;
+}
+
+/* Calculates the parameters of voices with new properties, or all of them
+ * when forced. Spatialized voices are collected so their geometry can be
+ * calculated in batches.
+ */
+void CalcSourceParams(const al::span<Voice*const> voices, ContextBase *context,
+    AmbiRotateCache &rotcache, ResamplerStateCache &rescache, bool force)
+{
+    const nanoseconds curtime{context->mDevice->getMixClockTime()};
+    std::array<Voice*,GeometryBatchSize> attnVoices;
+    std::array<std::array<SourceGeometry,GeometryBatchSize>,MaxListeners> geoms;
+    size_t numAttn{0};
+
+    auto calc_attn_voices = [&attnVoices,&geoms,&rotcache,&rescache,context](const size_t count)
+    {
+        const ContextParams &params = context->mParams;
+        const auto batch = al::span{attnVoices}.first(count);
+        for(uint l{0};l < params.NumListeners;++l)
+            CalcSourceGeometry(params.Listeners[l], batch, geoms[l]);
+        if(params.NumListeners < 2)
+        {
+            for(size_t i{0};i < count;++i)
+                CalcAttnSourceParams(batch[i], &batch[i]->mProps, context, params.Listeners[0],
+                    geoms[0][i], rotcache, rescache);
+            return;
+        }
+        for(size_t i{0};i < count;++i)
+        {
+            std::array<SourceGeometry,MaxListeners> voicegeoms;
+            for(uint l{0};l < params.NumListeners;++l)
+                voicegeoms[l] = geoms[l][i];
+            CalcMultiListenerParams(batch[i], &batch[i]->mProps, context,
+                al::span{voicegeoms}.first(params.NumListeners), rotcache, rescache);
+        }
+    };
+
+    for(Voice *voice : voices)
+    {
+        if(voice->mSourceID.load(std::memory_order_relaxed) == 0)
+            continue;
+
+        VoicePropsItem *props{voice->mUpdate.exchange(nullptr, std::memory_order_acq_rel)};
+        if(!props && !force && !voice->mHasRamps) continue;
+
+        if(props)
+        {
+            StartVoiceRamps(voice, *props, curtime);
+            voice->mProps = *props;
+
+            context->mVoicePropsPool.put(props);
+        }
+        if(voice->mHasRamps)
+            voice->mHasRamps = ApplyVoiceRamps(voice, curtime);
+
+        if((voice->mProps.DirectChannels != DirectMode::Off && voice->mFmtChannels != FmtMono
+                && !IsAmbisonic(voice->mFmtChannels))
+            || voice->mProps.mSpatializeMode == SpatializeMode::Off
+            || (voice->mProps.mSpatializeMode==SpatializeMode::Auto
+                && voice->mFmtChannels != FmtMono))
+            CalcNonAttnSourceParams(voice, &voice->mProps, context, rotcache, rescache);
+        else
+        {
+            attnVoices[numAttn++] = voice;
+            if(numAttn == attnVoices.size())
+            {
+                calc_attn_voices(numAttn);
+                numAttn = 0;
+            }
+        }
+    }
+    if(numAttn > 0)
+        calc_attn_voices(numAttn);
+}
 
 void SendSourceStateEvent(ContextBase *context, uint id, VChangeState state)
 {
@@ -1701,6 +2619,7 @@ void SendSourceStateEvent(ContextBase *context, uint id, VChangeState state)
 
     auto &evt = InitAsyncEvent<AsyncSourceStateEvent>(evt_vec.first.buf);
     evt.mId = id;
+    evt.mTime = context->mDevice->getMixClockTime();
     switch(state)
     {
     case VChangeState::Reset:
@@ -1725,6 +2644,7 @@ void SendSourceStateEvent(ContextBase *context, uint id, VChangeState state)
 
 void ProcessVoiceChanges(ContextBase *ctx)
 {
+    TIMELINE_SCOPE("ProcessVoiceChanges");
     VoiceChange *cur{ctx->mCurrentVoiceChange.load(std::memory_order_acquire)};
     VoiceChange *next{cur->mNext.load(std::memory_order_acquire)};
     if(!next) return;
@@ -1782,7 +2702,9 @@ void ProcessVoiceChanges(ContextBase *ctx)
             else
                 sendevt = true;
 
+            /* A voice starts out mixed, until the voice budget culls it. */
             Voice *voice{cur->mVoice};
+            voice->mCulled.store(false, std::memory_order_relaxed);
             voice->mPlayState.store(Voice::Playing, std::memory_order_release);
         }
         else if(cur->mState == VChangeState::Restart)
@@ -1805,6 +2727,7 @@ void ProcessVoiceChanges(ContextBase *ctx)
                     std::memory_order_relaxed, std::memory_order_acquire);
 
                 Voice *voice{cur->mVoice};
+                voice->mCulled.store(false, std::memory_order_relaxed);
                 voice->mPlayState.store((oldvstate == Voice::Playing) ? Voice::Playing
                     : Voice::Stopped, std::memory_order_release);
             }
@@ -1818,244 +2741,1092 @@ void ProcessVoiceChanges(ContextBase *ctx)
     ctx->mCurrentVoiceChange.store(cur, std::memory_order_release);
 }
 
+/* Checks if the voice has a source. The API only sets up voices without one
+ * to play a source, so the mixer can change the state of a voice with one
+ * while the API may be writing to any other.
+ */
+inline bool HasVoiceSource(const Voice *voice) noexcept
+{ return voice->mSourceID.load(std::memory_order_acquire) != 0; }
+
+/* Gets the loudest target gain the voice's channels have on any output, as a
+ * measure of how audible it is.
+ */
+float GetVoiceAudibility(const Voice *voice, const uint NumSends) noexcept
+{
+    auto absmax = [](const float cur, const float gain) noexcept -> float
+    { return maxf(cur, std::abs(gain)); };
+
+    const size_t numDirect{voice->mDirect.Buffer.size()};
+    float audibility{0.0f};
+    for(const auto &chandata : voice->mChans)
+    {
+        const DirectParams &dryparms = chandata.mDryParams;
+        if(voice->mFlags.test(VoiceHasHrtf))
+            audibility = absmax(audibility, dryparms.Hrtf->Target.Gain);
+        else
+            audibility = std::accumulate(dryparms.Gains.Target.cbegin(),
+                dryparms.Gains.Target.cbegin()+numDirect, audibility, absmax);
+
+        for(uint send{0};send < NumSends;++send)
+        {
+            const size_t numWet{voice->mSend[send].Buffer.size()};
+            const SendParams &wetparms = chandata.mWetParams[send];
+            audibility = std::accumulate(wetparms.Gains.Target.cbegin(),
+                wetparms.Gains.Target.cbegin()+numWet, audibility, absmax);
+        }
+    }
+    return audibility;
+}
+
+/* Keeps the context's voice budget, by culling the playing voices with the
+ * lowest priority, and lowest audibility within the same priority, that don't
+ * fit. Culled voices fade out and are kept virtual until they fit again, so
+ * only up to the budget's number of voices ever get mixed.
+ */
+void ApplyVoiceBudget(ContextBase *ctx, const al::span<Voice*> voices, const size_t maxVoices)
+{
+    const uint NumSends{ctx->mDevice->NumAuxSends};
+    auto &heap = ctx->mVoiceBudgetHeap;
+    /* The heap is reserved ahead of time, so don't let it grow. */
+    const size_t budget{minz(maxVoices, heap.capacity())};
+
+    /* Orders the heap so the front is the least important voice kept. */
+    auto more_important = [](const VoiceBudgetEntry &lhs, const VoiceBudgetEntry &rhs) noexcept
+    {
+        if(lhs.mPriority != rhs.mPriority)
+            return lhs.mPriority > rhs.mPriority;
+        return lhs.mAudibility > rhs.mAudibility;
+    };
+
+    heap.clear();
+    for(Voice *voice : voices)
+    {
+        if(!HasVoiceSource(voice)
+            || voice->mPlayState.load(std::memory_order_acquire) != Voice::Playing)
+        {
+            voice->mCulled.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        float audibility{GetVoiceAudibility(voice, NumSends)};
+        if(!(audibility > GainSilenceThreshold))
+        {
+            /* Silent voices don't need a place in the budget. */
+            voice->mCulled.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        /* Favor voices already being mixed to avoid repeatedly swapping ones
+         * with similar audibility.
+         */
+        if(voice->mCulled.load(std::memory_order_relaxed))
+            audibility *= 0.5f;
+        voice->mCulled.store(true, std::memory_order_relaxed);
+
+        const VoiceBudgetEntry entry{voice, voice->mProps.Priority, audibility};
+        if(heap.size() < budget)
+        {
+            heap.emplace_back(entry);
+            std::push_heap(heap.begin(), heap.end(), more_important);
+        }
+        else if(more_important(entry, heap.front()))
+        {
+            std::pop_heap(heap.begin(), heap.end(), more_important);
+            heap.back() = entry;
+            std::push_heap(heap.begin(), heap.end(), more_important);
+        }
+    }
+
+    for(const VoiceBudgetEntry &entry : heap)
+        entry.mVoice->mCulled.store(false, std::memory_order_relaxed);
+}
+
+/* The minimum number of voices before mixing them, or recalculating all of
+ * their parameters, with the mixer pool. Fewer than this are handled on the
+ * mixer thread alone, to avoid the overhead of waking the workers (and
+ * combining their output).
+ */
+constexpr size_t MinParallelVoices{16};
+
+/* Assigns far-field voices with recalculated parameters to the cluster for
+ * their direction cell and effect slot sends, claiming an unused cluster for
+ * new combinations. The other voices keep their clusters. Voices that don't
+ * get a cluster are mixed with their own panning.
+ */
+void AssignVoiceClusters(ContextBase *ctx, const al::span<Voice*> voices)
+{
+    DeviceBase *device{ctx->mDevice};
+    const uint NumSends{device->NumAuxSends};
+    const size_t stride{1u + NumSends};
+    auto &clusters = ctx->mSpatialClusters;
+
+    for(SpatialCluster &cluster : clusters)
+        cluster.mVoiceCount = 0;
+    /* Paused voices keep their clusters, to resume with them. */
+    for(Voice *voice : voices)
+    {
+        if(HasVoiceSource(voice) && !voice->mClusterPending
+            && voice->mSpatialCluster != NoSpatialCluster)
+            ++clusters[voice->mSpatialCluster].mVoiceCount;
+    }
+
+    /* Paused voices are (re)assigned once they play again. */
+    for(Voice *voice : voices)
+    {
+        if(!voice->mClusterPending || !HasVoiceSource(voice))
+            continue;
+        const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+        if(vstate != Voice::Playing && vstate != Voice::Stopping)
+            continue;
+        voice->mClusterPending = false;
+
+        const uint8_t oldCluster{std::exchange(voice->mSpatialCluster, NoSpatialCluster)};
+        if(voice->mClusterCell != NoSpatialCluster)
+        {
+            std::array<EffectSlot*,MAX_SENDS> slots{};
+            for(uint i{0};i < NumSends;++i)
+            {
+                if(!voice->mSend[i].Buffer.empty())
+                    slots[i] = voice->mProps.Send[i].Slot;
+            }
+
+            auto matches = [voice,&slots](const SpatialCluster &cluster) noexcept
+            {
+                return cluster.mVoiceCount > 0 && cluster.mCell == voice->mClusterCell
+                    && cluster.mSlots == slots;
+            };
+            auto iter = std::find_if(clusters.begin(), clusters.end(), matches);
+            if(iter == clusters.end())
+            {
+                iter = std::find_if(clusters.begin(), clusters.end(),
+                    [](const SpatialCluster &cluster) noexcept { return cluster.mVoiceCount == 0; });
+                if(iter != clusters.end())
+                {
+                    iter->mCell = voice->mClusterCell;
+                    iter->mSlots = slots;
+                }
+            }
+            if(iter != clusters.end())
+            {
+                ++iter->mVoiceCount;
+                voice->mSpatialCluster = static_cast<uint8_t>(std::distance(clusters.begin(), iter));
+            }
+        }
+
+        /* The dry and send outputs change buffers when joining or leaving a
+         * cluster. The signal stays continuous, so just start at the new
+         * gains instead of fading from ones meant for other outputs.
+         */
+        const bool changed{voice->mSpatialCluster != oldCluster};
+        if(voice->mSpatialCluster == NoSpatialCluster)
+        {
+            voice->mFlags.reset(VoiceIsClustered);
+            if(!changed) continue;
+            for(auto &chandata : voice->mChans)
+            {
+                if(!voice->mFlags.test(VoiceHasHrtf))
+                    chandata.mDryParams.Gains.Current = chandata.mDryParams.Gains.Target;
+                for(uint i{0};i < NumSends;++i)
+                {
+                    SendParams &params = chandata.mWetParams[i];
+                    std::copy(params.Gains.Target.begin(), params.Gains.Target.end(),
+                        params.Gains.Current.begin());
+                }
+            }
+            continue;
+        }
+
+        const auto lines = device->mClusterBuffer.subspan(voice->mSpatialCluster*stride, stride);
+        voice->mFlags.reset(VoiceHasHrtf).reset(VoiceHasNfc).set(VoiceIsClustered);
+        voice->updateMixPath();
+        voice->mDirect.Buffer = lines.first(1);
+        for(auto &chandata : voice->mChans)
+        {
+            DirectParams &dryparams = chandata.mDryParams;
+            dryparams.Gains.Target.fill(0.0f);
+            dryparams.Gains.Target[0] = voice->mClusterDryGain;
+            if(changed)
+                dryparams.Gains.Current = dryparams.Gains.Target;
+
+            for(uint i{0};i < NumSends;++i)
+            {
+                if(voice->mSend[i].Buffer.empty())
+                    continue;
+                voice->mSend[i].Buffer = lines.subspan(1u+i, 1);
+
+                SendParams &params = chandata.mWetParams[i];
+                std::fill(params.Gains.Target.begin(), params.Gains.Target.end(), 0.0f);
+                params.Gains.Target[0] = voice->mClusterWetGains[i];
+                if(changed)
+                    std::copy(params.Gains.Target.begin(), params.Gains.Target.end(),
+                        params.Gains.Current.begin());
+            }
+        }
+    }
+}
+
 void ProcessParamUpdates(ContextBase *ctx, const EffectSlotArray &slots,
-    const al::span<Voice*> voices)
+    const SourceGroupArray &groups, const al::span<Voice*> voices, MixerPool *pool,
+    VoiceMixScratch &scratch)
 {
+    TIMELINE_SCOPE("ProcessParamUpdates");
     ProcessVoiceChanges(ctx);
 
     IncrementRef(ctx->mUpdateCount);
     if(!ctx->mHoldUpdates.load(std::memory_order_acquire)) LIKELY
     {
         bool force{CalcContextParams(ctx)};
+        force |= std::exchange(ctx->mForceUpdate, false);
         auto sorted_slots = const_cast<EffectSlot**>(slots.data() + slots.size());
         for(EffectSlot *slot : slots)
             force |= CalcEffectSlotParams(slot, sorted_slots, ctx);
+        UpdateResizedSlotOutputs(slots, groups, ctx);
+        for(SourceGroup *group : groups)
+            CalcSourceGroupParams(group, ctx);
+
+        /* Only update voices that have a source. A forced update, as when
+         * the listener moves, recalculates every voice, so spread them over
+         * the mixer pool. Otherwise only voices with new properties update,
+         * which are usually few.
+         */
+        if(force && pool && voices.size() >= MinParallelVoices)
+        {
+            const size_t numThreads{pool->size()};
+            auto calc_voices = [=,&scratch](const uint index)
+            {
+                VoiceMixScratch &tscratch = index ? pool->getScratch(index) : scratch;
+                const size_t start{voices.size() * index / numThreads};
+                const size_t end{voices.size() * (index+1) / numThreads};
+                CalcSourceParams(voices.subspan(start, end-start), ctx, tscratch.mAmbiRotation,
+                    tscratch.mResamplerStates, true);
+            };
+            pool->run(calc_voices);
+        }
+        else
+            CalcSourceParams(voices, ctx, scratch.mAmbiRotation, scratch.mResamplerStates,
+                force);
+        if(ctx->mDevice->mClusterDistance > 0.0f)
+            AssignVoiceClusters(ctx, voices);
 
-        for(Voice *voice : voices)
+        /* The governor may limit the voices further. When there's no budget
+         * any more, release voices it culled.
+         */
+        const MixGovernor &governor = ctx->mDevice->mGovernor;
+        size_t budget{ctx->mVoiceBudget};
+        if(governor.mQuality.load(std::memory_order_relaxed) >= MixQuality::VoiceLimit)
+            budget = budget ? minz(budget, governor.mVoiceLimit) : governor.mVoiceLimit;
+        if(budget > 0)
+            ApplyVoiceBudget(ctx, voices, budget);
+        else if(force)
         {
-            /* Only update voices that have a source. */
-            if(voice->mSourceID.load(std::memory_order_relaxed) != 0)
-                CalcSourceParams(voice, ctx, force);
+            for(Voice *voice : voices)
+            {
+                if(HasVoiceSource(voice))
+                    voice->mCulled.store(false, std::memory_order_relaxed);
+            }
         }
     }
     IncrementRef(ctx->mUpdateCount);
 }
 
-void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
+/* Adds voices that have become idle to the context's free list, so the API
+ * can get one to play a source without searching for it.
+ */
+void ReclaimVoices(ContextBase *ctx, const al::span<Voice*> voices)
 {
-    ASSUME(SamplesToDo > 0);
+    for(Voice *voice : voices)
+    {
+        if(voice->mFreeListed.load(std::memory_order_acquire))
+            continue;
+        if(voice->mPlayState.load(std::memory_order_acquire) == Voice::Stopped
+            && voice->mSourceID.load(std::memory_order_relaxed) == 0u
+            && voice->mPendingChange.load(std::memory_order_relaxed) == false)
+            ctx->pushFreeVoice(voice);
+    }
+}
 
-    const nanoseconds curtime{device->ClockBase +
-        nanoseconds{seconds{device->SamplesDone}}/device->Frequency};
+/* Adds the other mixing threads' copies of the given buffer lines to the main
+ * set, and clears the copies so they can be mixed to again.
+ */
+void ReduceBuffers(const al::span<FloatBufferLine> dst, const size_t numThreads,
+    const size_t SamplesToDo)
+{
+    for(size_t i{1};i < numThreads;++i)
+    {
+        FloatBufferLine *src{dst.data() + dst.size()*i};
+        for(FloatBufferLine &buffer : dst)
+        {
+            std::transform(src->cbegin(), src->cbegin()+SamplesToDo, buffer.cbegin(),
+                buffer.begin(), std::plus<float>{});
+            std::fill_n(src->begin(), SamplesToDo, 0.0f);
+            ++src;
+        }
+    }
+}
 
-    for(ContextBase *ctx : *device->mContexts.load(std::memory_order_acquire))
+/* Mixes the voice for this update, and counts whether it was mixed or kept
+ * virtual.
+ */
+inline void MixVoice(Voice *voice, const Voice::State vstate, ContextBase *ctx,
+    const nanoseconds curtime, const uint SamplesToDo, VoiceMixScratch &scratch,
+    uint &numActive, uint &numVirtual)
+{
+    TIMELINE_SCOPE("Voice::mix", "source",
+        voice->mSourceID.load(std::memory_order_relaxed));
+    if(!ctx->mDevice->mProfileVoices) LIKELY
+        voice->mix(vstate, ctx, curtime, SamplesToDo, scratch);
+    else
     {
-        const EffectSlotArray &auxslots = *ctx->mActiveAuxSlots.load(std::memory_order_acquire);
-        const al::span<Voice*> voices{ctx->getVoicesSpanAcquired()};
+        const auto start = steady_clock::now();
+        voice->mix(vstate, ctx, curtime, SamplesToDo, scratch);
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+        /* Only the thread mixing the voice updates its time. */
+        voice->mMixTime.store(voice->mMixTime.load(std::memory_order_relaxed)
+            + static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+    }
+    if(voice->mFlags.test(VoiceIsVirtual))
+        ++numVirtual;
+    else
+        ++numActive;
+}
 
-        /* Process pending propery updates for objects on the context. */
-        ProcessParamUpdates(ctx, auxslots, voices);
+/* Marks a voice that no mixer pool thread mixes this update. */
+constexpr uint NoMixThread{~0u};
 
-        /* Clear auxiliary effect slot mixing buffers. */
-        for(EffectSlot *slot : auxslots)
-        {
-            for(auto &buffer : slot->Wet.Buffer)
-                buffer.fill(0.0f);
-        }
+void MixVoicesParallel(DeviceBase *device, MixerPool *pool, ContextBase *ctx,
+    const EffectSlotArray &auxslots, const SourceGroupArray &groups,
+    const al::span<Voice*> voices, const nanoseconds curtime, const uint SamplesToDo,
+    uint &numActive, uint &numVirtual)
+{
+    const uint numThreads{pool->size()};
+    std::atomic<uint> totalActive{0u}, totalVirtual{0u};
+
+    /* Voices are interleaved across the threads for a more even distribution
+     * of playing voices. Callback voices are always mixed on the mixer thread,
+     * so the app's callback isn't invoked from a worker thread. The threads
+     * are picked before starting the pool, since a voice's flags change while
+     * it's being mixed.
+     */
+    for(size_t i{0};i < voices.size();++i)
+    {
+        Voice *voice{voices[i]};
+        const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+        if(vstate == Voice::Stopped || vstate == Voice::Pending)
+            voice->mMixThread = NoMixThread;
+        else if(voice->mFlags.test(VoiceIsCallback))
+            voice->mMixThread = 0u;
+        else
+            voice->mMixThread = static_cast<uint>(i % numThreads);
+    }
 
-        /* Process voices that have a playing source. */
+    auto mix_voices = [=,&totalActive,&totalVirtual](const uint index)
+    {
+        VoiceMixScratch &scratch = index ? pool->getScratch(index) : device->mMixScratch;
+        uint active{0u}, virt{0u};
         for(Voice *voice : voices)
         {
-            const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
-            if(vstate != Voice::Stopped && vstate != Voice::Pending)
-                voice->mix(vstate, ctx, curtime, SamplesToDo);
+            if(voice->mMixThread == index)
+                MixVoice(voice, voice->mPlayState.load(std::memory_order_acquire), ctx, curtime,
+                    SamplesToDo, scratch, active, virt);
         }
+        totalActive.fetch_add(active, std::memory_order_relaxed);
+        totalVirtual.fetch_add(virt, std::memory_order_relaxed);
+    };
+    pool->run(mix_voices);
+    numActive += totalActive.load(std::memory_order_relaxed);
+    numVirtual += totalVirtual.load(std::memory_order_relaxed);
 
-        /* Process effects. */
-        if(const size_t num_slots{auxslots.size()})
+    /* Combine the worker threads' wet and source group mixes, in thread order
+     * for deterministic output. The dry mix is combined after all contexts are
+     * processed.
+     */
+    for(EffectSlot *slot : auxslots)
+        ReduceBuffers(slot->Wet.Buffer, numThreads, SamplesToDo);
+    for(SourceGroup *group : groups)
+        ReduceBuffers(group->Wet.Buffer, numThreads, SamplesToDo);
+}
+
+/* Checks if the effect slot's wet buffer has any input for this update, and
+ * returns whether the effect needs to be processed. Effects that have had no
+ * input for longer than their tail are dormant and don't need processing.
+ */
+bool UpdateSlotActivity(EffectSlot *slot, const uint SamplesToDo) noexcept
+{
+    auto is_silent = [SamplesToDo](const FloatBufferLine &buffer) noexcept -> bool
+    {
+        return std::all_of(buffer.cbegin(), buffer.cbegin()+SamplesToDo,
+            [](const float sample) noexcept -> bool { return sample == 0.0f; });
+    };
+    slot->mWetSilent = std::all_of(slot->Wet.Buffer.begin(), slot->Wet.Buffer.end(), is_silent);
+    if(!slot->mWetSilent)
+    {
+        slot->mSilentSamples = 0;
+        return true;
+    }
+
+    if(slot->mSilentSamples >= slot->mTailSamples)
+        return false;
+    slot->mSilentSamples += minu(SamplesToDo, std::numeric_limits<uint>::max() -
+        slot->mSilentSamples);
+    return true;
+}
+
+/* Moves the wet input of a reverb slot to a later slot in the given list with
+ * identical reverb properties, gain, and target, if there is one, so that one
+ * reverb instance processes the input for both. The slot's own input is left
+ * silent, so it runs out its current tail and goes dormant. A slot's later
+ * sharer has the same target, so it's processed after it, in the same depth
+ * level. Returns true if the input was moved.
+ */
+bool ShareSlotInput(EffectSlot *slot, const al::span<EffectSlot*const> later,
+    const uint SamplesToDo) noexcept
+{
+    if(slot->EffectType != EffectSlotType::Reverb
+        && slot->EffectType != EffectSlotType::EAXReverb)
+        return false;
+
+    auto can_share = [slot](const EffectSlot *other) noexcept -> bool
+    {
+        return other->EffectType == slot->EffectType && other->Target == slot->Target
+            && other->Gain == slot->Gain && other->Wet.Buffer.size() == slot->Wet.Buffer.size()
+            && std::memcmp(&other->mEffectProps.Reverb, &slot->mEffectProps.Reverb,
+                sizeof(slot->mEffectProps.Reverb)) == 0;
+    };
+    auto sharer = std::find_if(later.begin(), later.end(), can_share);
+    if(sharer == later.end())
+        return false;
+
+    auto dst = (*sharer)->Wet.Buffer.begin();
+    for(FloatBufferLine &src : slot->Wet.Buffer)
+    {
+        std::transform(src.cbegin(), src.cbegin()+SamplesToDo, dst->cbegin(), dst->begin(),
+            std::plus<float>{});
+        std::fill_n(src.begin(), SamplesToDo, 0.0f);
+        ++dst;
+    }
+    return true;
+}
+
+/* Returns the number of effect slots between the given slot and the output. */
+uint GetSlotDepth(const EffectSlot *slot) noexcept
+{
+    uint depth{0};
+    for(const EffectSlot *target{slot->Target};target;target = target->Target)
+        ++depth;
+    return depth;
+}
+
+/* Processes the sorted effect slots as a dependency graph. The sorted slots
+ * are grouped by their depth (deepest first), so each group only feeds slots
+ * in the group after it. Slots within a group are independent of each other,
+ * and are processed concurrently on the mixer pool, each thread writing to its
+ * own copy of the output buffers. Returns true if any slot output was written
+ * to the dry buffer copies.
+ */
+bool ProcessEffectsParallel(DeviceBase *device, MixerPool *pool,
+    const al::span<EffectSlot*> sorted_slots, const uint SamplesToDo)
+{
+    const uint numThreads{pool->size()};
+    const bool shareReverb{device->Flags.test(ShareReverbSlots)};
+    bool wroteDry{false};
+
+    auto level_begin = sorted_slots.begin();
+    while(level_begin != sorted_slots.end())
+    {
+        const uint depth{GetSlotDepth(*level_begin)};
+        auto level_end = std::find_if(level_begin+1, sorted_slots.end(),
+            [depth](const EffectSlot *slot) noexcept { return GetSlotDepth(slot) != depth; });
+        const al::span<EffectSlot*> level{level_begin, level_end};
+
+        /* The level's input is complete, so shared reverb input can be moved
+         * before any of the level's slots are processed.
+         */
+        if(shareReverb)
         {
-            auto slots = auxslots.data();
-            auto slots_end = slots + num_slots;
+            for(size_t i{0};i < level.size();++i)
+                ShareSlotInput(level[i], level.subspan(i+1), SamplesToDo);
+        }
 
-            /* Sort the slots into extra storage, so that effect slots come
-             * before their effect slot target (or their targets' target).
-             */
-            const al::span<EffectSlot*> sorted_slots{const_cast<EffectSlot**>(slots_end),
-                num_slots};
-            /* Skip sorting if it has already been done. */
-            if(!sorted_slots[0])
+        if(level.size() == 1)
+        {
+            if(UpdateSlotActivity(level[0], SamplesToDo))
             {
-                /* First, copy the slots to the sorted list, then partition the
-                 * sorted list so that all slots without a target slot go to
-                 * the end.
-                 */
-                std::copy(slots, slots_end, sorted_slots.begin());
-                auto split_point = std::partition(sorted_slots.begin(), sorted_slots.end(),
-                    [](const EffectSlot *slot) noexcept -> bool
-                    { return slot->Target != nullptr; });
-                /* There must be at least one slot without a slot target. */
-                assert(split_point != sorted_slots.end());
-
-                /* Simple case: no more than 1 slot has a target slot. Either
-                 * all slots go right to the output, or the remaining one must
-                 * target an already-partitioned slot.
-                 */
-                if(split_point - sorted_slots.begin() > 1)
+                TIMELINE_SCOPE("EffectState::process", "effect type",
+                    static_cast<int>(level[0]->EffectType));
+                EffectState *state{level[0]->mEffectState.get()};
+                state->process(SamplesToDo, level[0]->Wet.Buffer, state->mOutTarget);
+            }
+        }
+        else
+        {
+            auto process_slots = [=](const uint index)
+            {
+                const VoiceMixScratch &scratch = index ? pool->getScratch(index)
+                    : device->mMixScratch;
+                for(size_t i{index};i < level.size();i += numThreads)
                 {
-                    /* At least two slots target other slots. Starting from the
-                     * back of the sorted list, continue partitioning the front
-                     * of the list given each target until all targets are
-                     * accounted for. This ensures all slots without a target
-                     * go last, all slots directly targeting those last slots
-                     * go second-to-last, all slots directly targeting those
-                     * second-last slots go third-to-last, etc.
+                    EffectSlot *slot{level[i]};
+                    if(!UpdateSlotActivity(slot, SamplesToDo))
+                        continue;
+
+                    TIMELINE_SCOPE("EffectState::process", "effect type",
+                        static_cast<int>(slot->EffectType));
+                    EffectState *state{slot->mEffectState.get()};
+                    /* Slots with a target slot output to its wet buffer, else
+                     * the output is in the device's mixing buffers.
                      */
-                    auto next_target = sorted_slots.end();
-                    do {
-                        /* This shouldn't happen, but if there's unsorted slots
-                         * left that don't target any sorted slots, they can't
-                         * contribute to the output, so leave them.
-                         */
-                        if(next_target == split_point) UNLIKELY
-                            break;
-
-                        --next_target;
-                        split_point = std::partition(sorted_slots.begin(), split_point,
-                            [next_target](const EffectSlot *slot) noexcept -> bool
-                            { return slot->Target != *next_target; });
-                    } while(split_point - sorted_slots.begin() > 1);
+                    state->process(SamplesToDo, slot->Wet.Buffer, slot->Target
+                        ? scratch.getWetTarget(state->mOutTarget)
+                        : scratch.getDryTarget(state->mOutTarget));
                 }
-            }
+            };
+            pool->run(process_slots);
 
-            for(const EffectSlot *slot : sorted_slots)
+            /* Combine the output for the next level's slots so they have their
+             * full input, or note that the dry mix needs to be combined.
+             */
+            if(depth == 0)
+                wroteDry = true;
+            else
             {
-                EffectState *state{slot->mEffectState.get()};
-                state->process(SamplesToDo, slot->Wet.Buffer, state->mOutTarget);
+                auto next_end = std::find_if(level_end, sorted_slots.end(),
+                    [depth](const EffectSlot *slot) noexcept
+                    { return GetSlotDepth(slot) != depth-1; });
+                std::for_each(level_end, next_end, [numThreads,SamplesToDo](EffectSlot *slot)
+                    { ReduceBuffers(slot->Wet.Buffer, numThreads, SamplesToDo); });
             }
         }
 
-        /* Signal the event handler if there are any events to read. */
-        RingBuffer *ring{ctx->mAsyncEvents.get()};
-        if(ring->readSpace() > 0)
-            ctx->mEventSem.post();
+        level_begin = level_end;
     }
+
+    return wroteDry;
 }
 
+/* Adds a worker thread's copy of an effect slot's wet buffer (or a source
+ * group's buffer) to the main one, and clears the copy, for when all of a
+ * context's voices were mixed on the one thread.
+ */
+void ReduceWetBuffer(const al::span<FloatBufferLine> dst, const uint threadIndex,
+    const size_t SamplesToDo)
+{
+    FloatBufferLine *src{dst.data() + dst.size()*threadIndex};
+    for(FloatBufferLine &buffer : dst)
+    {
+        std::transform(src->cbegin(), src->cbegin()+SamplesToDo, buffer.cbegin(), buffer.begin(),
+            std::plus<float>{});
+        std::fill_n(src->begin(), SamplesToDo, 0.0f);
+        ++src;
+    }
+}
 
-void ApplyDistanceComp(const al::span<FloatBufferLine> Samples, const size_t SamplesToDo,
-    const DistanceComp::ChanData *distcomp)
+/* Pans the context's voice clusters to the dry mix and their effect slots,
+ * clearing the cluster lines for the next context. When the voices were mixed
+ * by the mixer pool, the other threads' copies of the lines are added first.
+ */
+void MixVoiceClusters(DeviceBase *device, ContextBase *ctx, const VoiceMixScratch &scratch,
+    const size_t numThreads, const uint SamplesToDo)
 {
-    ASSUME(SamplesToDo > 0);
+    const uint NumSends{device->NumAuxSends};
+    const size_t stride{1u + NumSends};
+    const size_t dryStride{device->MixBuffer.size() / numThreads};
+    const al::span<FloatBufferLine> dryTarget{scratch.getDryTarget(device->Dry.Buffer)};
 
-    for(auto &chanbuffer : Samples)
+    std::array<float,MAX_OUTPUT_CHANNELS> gains{};
+    for(size_t i{0};i < ctx->mSpatialClusters.size();++i)
     {
-        const float gain{distcomp->Gain};
-        const size_t base{distcomp->Length};
-        float *distbuf{al::assume_aligned<16>(distcomp->Buffer)};
-        ++distcomp;
-
-        if(base < 1)
+        const SpatialCluster &cluster = ctx->mSpatialClusters[i];
+        if(!cluster.mVoiceCount)
             continue;
 
-        float *inout{al::assume_aligned<16>(chanbuffer.data())};
-        auto inout_end = inout + SamplesToDo;
-        if(SamplesToDo >= base) LIKELY
+        const al::span<FloatBufferLine> lines{scratch.getDryTarget(
+            device->mClusterBuffer.subspan(i*stride, stride))};
+        for(size_t t{1};t < numThreads;++t)
         {
-            auto delay_end = std::rotate(inout, inout_end - base, inout_end);
-            std::swap_ranges(inout, delay_end, distbuf);
+            FloatBufferLine *src{lines.data() + dryStride*t};
+            for(FloatBufferLine &line : lines)
+            {
+                std::transform(src->cbegin(), src->cbegin()+SamplesToDo, line.cbegin(),
+                    line.begin(), std::plus<float>{});
+                std::fill_n(src->begin(), SamplesToDo, 0.0f);
+                ++src;
+            }
         }
-        else
+
+        const auto coeffs = GetClusterCellCoeffs(cluster.mCell, device->mRenderMode);
+        ComputePanGains(&device->Dry, coeffs.data(), 1.0f, gains);
+        MixSamples({lines[0].data(), SamplesToDo}, dryTarget, gains.data(), gains.data(), 0, 0);
+        std::fill_n(lines[0].begin(), SamplesToDo, 0.0f);
+
+        for(uint send{0};send < NumSends;++send)
         {
-            auto delay_start = std::swap_ranges(inout, inout_end, distbuf);
-            std::rotate(distbuf, delay_start, distbuf + base);
+            EffectSlot *slot{cluster.mSlots[send]};
+            if(!slot) continue;
+
+            FloatBufferLine &line = lines[1u+send];
+            ComputePanGains(&slot->Wet, coeffs.data(), 1.0f, gains);
+            MixSamples({line.data(), SamplesToDo}, slot->Wet.Buffer, gains.data(), gains.data(),
+                0, 0);
+            std::fill_n(line.begin(), SamplesToDo, 0.0f);
         }
-        std::transform(inout, inout_end, inout, [gain](float s) { return s * gain; });
     }
 }
 
-void ApplyDither(const al::span<FloatBufferLine> Samples, uint *dither_seed,
-    const float quant_scale, const size_t SamplesToDo)
+/* Filters and mixes the context's source groups to the dry mix and their
+ * effect slot sends, clearing the group buffers for the next update. Groups
+ * with no input since their last output are skipped.
+ */
+void MixSourceGroups(DeviceBase *device, const SourceGroupArray &groups,
+    VoiceMixScratch &scratch, const uint SamplesToDo)
 {
-    ASSUME(SamplesToDo > 0);
+    static constexpr size_t MaxBatch{BiquadFilter::MaxBatch};
+    static_assert(MaxBatch <= VoiceMixScratch::FilterLinesMax, "Too few filter lines");
 
-    /* Dithering. Generate whitenoise (uniform distribution of random values
-     * between -1 and +1) and add it to the sample values, after scaling up to
-     * the desired quantization depth amd before rounding.
-     */
-    const float invscale{1.0f / quant_scale};
-    uint seed{*dither_seed};
-    auto dither_sample = [&seed,invscale,quant_scale](const float sample) noexcept -> float
-    {
-        float val{sample * quant_scale};
-        uint rng0{dither_rng(&seed)};
-        uint rng1{dither_rng(&seed)};
-        val += static_cast<float>(rng0*(1.0/UINT_MAX) - rng1*(1.0/UINT_MAX));
-        return fast_roundf(val) * invscale;
+    const uint NumSends{device->NumAuxSends};
+    const al::span<FloatBufferLine> dryTarget{scratch.getDryTarget(device->Dry.Buffer)};
+    auto is_silent = [SamplesToDo](const FloatBufferLine &buffer) noexcept -> bool
+    {
+        return std::all_of(buffer.cbegin(), buffer.cbegin()+SamplesToDo,
+            [](const float sample) noexcept -> bool { return sample == 0.0f; });
     };
-    for(FloatBufferLine &inout : Samples)
-        std::transform(inout.begin(), inout.begin()+SamplesToDo, inout.begin(), dither_sample);
-    *dither_seed = seed;
+
+    for(SourceGroup *group : groups)
+    {
+        const al::span<FloatBufferLine> input{group->Wet.Buffer};
+        if(std::all_of(input.begin(), input.end(), is_silent))
+        {
+            /* Let the filters and gains settle while there's no input, so the
+             * group doesn't need processing until it gets some.
+             */
+            if(!group->mSilent)
+            {
+                for(auto &output : group->mOutputs)
+                {
+                    for(auto &chan : output.Chans)
+                    {
+                        chan.LowPass.clear();
+                        chan.HighPass.clear();
+                        chan.Current = chan.Gain;
+                    }
+                }
+                group->mSilent = true;
+            }
+            continue;
+        }
+        const size_t Counter{group->mSilent ? 0u : SamplesToDo};
+        group->mSilent = false;
+
+        for(uint out{0};out <= NumSends;++out)
+        {
+            SourceGroup::OutputParams &output = group->mOutputs[out];
+            al::span<FloatBufferLine> target{dryTarget};
+            if(out > 0)
+            {
+                EffectSlot *slot{output.Slot};
+                if(!slot || slot->EffectType == EffectSlotType::None)
+                    continue;
+                target = slot->Wet.Buffer;
+            }
+
+            /* Filter the channels in batches, with band-pass outputs running
+             * the high-pass filters over the low-pass output.
+             */
+            for(size_t base{0};base < input.size();base += MaxBatch)
+            {
+                const size_t count{minz(input.size()-base, MaxBatch)};
+                std::array<BiquadFilter*,MaxBatch> filters;
+                std::array<const float*,MaxBatch> srcs;
+                std::array<float*,MaxBatch> dsts;
+                for(size_t i{0};i < count;++i)
+                {
+                    srcs[i] = input[base+i].data();
+                    dsts[i] = scratch.FilteredData[i].data();
+                }
+                if(output.FilterType & AF_LowPass)
+                {
+                    for(size_t i{0};i < count;++i)
+                        filters[i] = &output.Chans[base+i].LowPass;
+                    BiquadFilter::processBatch({filters.data(), count}, {srcs.data(), count},
+                        {dsts.data(), count}, SamplesToDo);
+                    std::copy_n(dsts.cbegin(), count, srcs.begin());
+                }
+                if(output.FilterType & AF_HighPass)
+                {
+                    for(size_t i{0};i < count;++i)
+                        filters[i] = &output.Chans[base+i].HighPass;
+                    BiquadFilter::processBatch({filters.data(), count}, {srcs.data(), count},
+                        {dsts.data(), count}, SamplesToDo);
+                    std::copy_n(dsts.cbegin(), count, srcs.begin());
+                }
+
+                for(size_t i{0};i < count;++i)
+                {
+                    SourceGroup::ChannelParams &chan = output.Chans[base+i];
+                    if(chan.Target != InvalidChannelIndex)
+                        MixSamples({srcs[i], SamplesToDo}, target[chan.Target].data(),
+                            chan.Current, chan.Gain, Counter);
+                }
+            }
+        }
+
+        for(FloatBufferLine &line : input)
+            std::fill_n(line.begin(), SamplesToDo, 0.0f);
+    }
 }
 
+/* Processes the context's property updates, voices, and effects for this
+ * update, adding the time spent on each to the profile. The given scratch
+ * storage selects the thread's copy of the dry mix to write to, and the mixer
+ * pool, if given, is used to help with large voice and effect counts. Returns
+ * true if the pool was used and its copies of the dry mix need combining.
+ */
+void SignalBatchedUpdates(ContextBase *ctx)
+{
+    if(ctx->mBatchedUpdatesPending.load(std::memory_order_relaxed)
+        && ctx->mBatchedUpdatesPending.exchange(false, std::memory_order_acquire))
+    {
+        ctx->mBatchedUpdatesDue.store(true, std::memory_order_release);
+        ctx->mEventSem.post();
+    }
+}
 
-/* Base template left undefined. Should be marked =delete, but Clang 3.8.1
- * chokes on that given the inline specializations.
+/* Checks if the context has nothing to mix, with no pending voice changes, no
+ * playing or stopping voices, and all effect slots dormant.
  */
-template<typename T>
-inline T SampleConv(float) noexcept;
+bool IsContextIdle(ContextBase *ctx) noexcept
+{
+    const VoiceChange *cur{ctx->mCurrentVoiceChange.load(std::memory_order_acquire)};
+    if(cur->mNext.load(std::memory_order_acquire) != nullptr)
+        return false;
 
-template<> inline float SampleConv(float val) noexcept
-{ return val; }
-template<> inline int32_t SampleConv(float val) noexcept
+    const al::span<Voice*> voices{ctx->getVoicesSpanAcquired()};
+    auto is_stopped = [](const Voice *voice) noexcept -> bool
+    {
+        const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+        return vstate == Voice::Stopped || vstate == Voice::Pending;
+    };
+    if(!std::all_of(voices.begin(), voices.end(), is_stopped))
+        return false;
+
+    const EffectSlotArray &auxslots = *ctx->mActiveAuxSlots.load(std::memory_order_acquire);
+    return std::all_of(auxslots.begin(), auxslots.end(), [](const EffectSlot *slot) noexcept
+        { return slot->mWetSilent && slot->mSilentSamples >= slot->mTailSamples; });
+}
+
+bool ProcessContext(DeviceBase *device, ContextBase *ctx, MixerPool *pool,
+    VoiceMixScratch &scratch, const nanoseconds curtime, const uint SamplesToDo,
+    MixerProfileRecord &profile)
 {
-    /* Floats have a 23-bit mantissa, plus an implied 1 bit and a sign bit.
-     * This means a normalized float has at most 25 bits of signed precision.
-     * When scaling and clamping for a signed 32-bit integer, these following
-     * values are the best a float can give.
+    bool mixedParallel{false};
+    uint numActive{0u}, numVirtual{0u};
+    auto lasttime = steady_clock::now();
+    auto add_elapsed = [&lasttime](int64_t &total) noexcept
+    {
+        const auto now = steady_clock::now();
+        total += duration_cast<nanoseconds>(now - lasttime).count();
+        lasttime = now;
+    };
+
+    const EffectSlotArray &auxslots = *ctx->mActiveAuxSlots.load(std::memory_order_acquire);
+    const SourceGroupArray &groups = *ctx->mActiveSourceGroups.load(std::memory_order_acquire);
+    const al::span<Voice*> voices{ctx->getVoicesSpanAcquired()};
+
+    /* Have the event thread apply any batched updates, now that a new update
+     * is starting.
+     */
+    SignalBatchedUpdates(ctx);
+
+    /* Process pending propery updates for objects on the context. */
+    ProcessParamUpdates(ctx, auxslots, groups, voices, pool, scratch);
+    add_elapsed(profile.UpdateTime);
+
+    /* Clear auxiliary effect slot mixing buffers (including any copies for
+     * other mixing threads), unless they're already known to be cleared. Only
+     * the channels the slot's effect uses get mixed to.
      */
-    return fastf2i(clampf(val*2147483648.0f, -2147483648.0f, 2147483520.0f));
-}
-template<> inline int16_t SampleConv(float val) noexcept
-{ return static_cast<int16_t>(fastf2i(clampf(val*32768.0f, -32768.0f, 32767.0f))); }
-template<> inline int8_t SampleConv(float val) noexcept
-{ return static_cast<int8_t>(fastf2i(clampf(val*128.0f, -128.0f, 127.0f))); }
-
-/* Define unsigned output variations. */
-template<> inline uint32_t SampleConv(float val) noexcept
-{ return static_cast<uint32_t>(SampleConv<int32_t>(val)) + 2147483648u; }
-template<> inline uint16_t SampleConv(float val) noexcept
-{ return static_cast<uint16_t>(SampleConv<int16_t>(val) + 32768); }
-template<> inline uint8_t SampleConv(float val) noexcept
-{ return static_cast<uint8_t>(SampleConv<int8_t>(val) + 128); }
-
-template<DevFmtType T>
-void Write(const al::span<const FloatBufferLine> InBuffer, void *OutBuffer, const size_t Offset,
-    const size_t SamplesToDo, const size_t FrameStep)
-{
-    ASSUME(FrameStep > 0);
+    for(EffectSlot *slot : auxslots)
+    {
+        if(slot->mWetSilent)
+            continue;
+        const size_t numLines{slot->Wet.Buffer.size() * device->mNumMixThreads};
+        for(auto &buffer : slot->mWetBuffer.first(numLines))
+            buffer.fill(0.0f);
+    }
+
+    /* Process voices that have a playing source. */
+    if(!pool || voices.size() < MinParallelVoices)
+    {
+        for(Voice *voice : voices)
+        {
+            const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+            if(vstate != Voice::Stopped && vstate != Voice::Pending)
+                MixVoice(voice, vstate, ctx, curtime, SamplesToDo, scratch, numActive,
+                    numVirtual);
+        }
+        if(const uint index{scratch.mThreadIndex})
+        {
+            for(EffectSlot *slot : auxslots)
+                ReduceWetBuffer(slot->Wet.Buffer, index, SamplesToDo);
+            for(SourceGroup *group : groups)
+                ReduceWetBuffer(group->Wet.Buffer, index, SamplesToDo);
+        }
+    }
+    else
+    {
+        MixVoicesParallel(device, pool, ctx, auxslots, groups, voices, curtime, SamplesToDo,
+            numActive, numVirtual);
+        mixedParallel = true;
+    }
+    if(device->mClusterDistance > 0.0f)
+        MixVoiceClusters(device, ctx, scratch, mixedParallel ? pool->size() : 1u, SamplesToDo);
+    if(!groups.empty())
+        MixSourceGroups(device, groups, scratch, SamplesToDo);
+    ReclaimVoices(ctx, voices);
+    add_elapsed(profile.VoiceTime);
+    profile.ActiveVoices += numActive;
+    profile.VirtualVoices += numVirtual;
+
+    /* Process effects. */
+    if(const size_t num_slots{auxslots.size()})
+    {
+        auto slots = auxslots.data();
+        auto slots_end = slots + num_slots;
+
+        /* Sort the slots into extra storage, so that effect slots come
+         * before their effect slot target (or their targets' target).
+         */
+        const al::span<EffectSlot*> sorted_slots{const_cast<EffectSlot**>(slots_end),
+            num_slots};
+        /* Skip sorting if it has already been done. */
+        if(!sorted_slots[0])
+        {
+            /* First, copy the slots to the sorted list, then partition the
+             * sorted list so that all slots without a target slot go to
+             * the end.
+             */
+            std::copy(slots, slots_end, sorted_slots.begin());
+            auto split_point = std::partition(sorted_slots.begin(), sorted_slots.end(),
+                [](const EffectSlot *slot) noexcept -> bool
+                { return slot->Target != nullptr; });
+            /* There must be at least one slot without a slot target. */
+            assert(split_point != sorted_slots.end());
+
+            /* Simple case: no more than 1 slot has a target slot. Either
+             * all slots go right to the output, or the remaining one must
+             * target an already-partitioned slot.
+             */
+            if(split_point - sorted_slots.begin() > 1)
+            {
+                /* At least two slots target other slots. Starting from the
+                 * back of the sorted list, continue partitioning the front
+                 * of the list given each target until all targets are
+                 * accounted for. This ensures all slots without a target
+                 * go last, all slots directly targeting those last slots
+                 * go second-to-last, all slots directly targeting those
+                 * second-last slots go third-to-last, etc.
+                 */
+                auto next_target = sorted_slots.end();
+                do {
+                    /* This shouldn't happen, but if there's unsorted slots
+                     * left that don't target any sorted slots, they can't
+                     * contribute to the output, so leave them.
+                     */
+                    if(next_target == split_point) UNLIKELY
+                        break;
+
+                    --next_target;
+                    split_point = std::partition(sorted_slots.begin(), split_point,
+                        [next_target](const EffectSlot *slot) noexcept -> bool
+                        { return slot->Target != *next_target; });
+                } while(split_point - sorted_slots.begin() > 1);
+            }
+        }
+
+        if(!pool || num_slots < 2)
+        {
+            const bool shareReverb{device->Flags.test(ShareReverbSlots)};
+            for(size_t i{0};i < sorted_slots.size();++i)
+            {
+                EffectSlot *slot{sorted_slots[i]};
+                if(shareReverb)
+                    ShareSlotInput(slot, sorted_slots.subspan(i+1), SamplesToDo);
+                if(!UpdateSlotActivity(slot, SamplesToDo))
+                    continue;
+
+                TIMELINE_SCOPE("EffectState::process", "effect type",
+                    static_cast<int>(slot->EffectType));
+                EffectState *state{slot->mEffectState.get()};
+                state->process(SamplesToDo, slot->Wet.Buffer, slot->Target ? state->mOutTarget
+                    : scratch.getDryTarget(state->mOutTarget));
+            }
+        }
+        else
+            mixedParallel |= ProcessEffectsParallel(device, pool, sorted_slots, SamplesToDo);
+        add_elapsed(profile.EffectTime);
+    }
+
+    /* Signal the event handler if there are any events to read. */
+    RingBuffer *ring{ctx->mAsyncEvents.get()};
+    if(!ctx->mEventPolling && ring->readSpace() > 0)
+        ctx->mEventSem.post();
+
+    return mixedParallel;
+}
+
+void ProcessContexts(DeviceBase *device, const uint SamplesToDo, MixerProfileRecord &profile)
+{
     ASSUME(SamplesToDo > 0);
 
-    DevFmtType_t<T> *outbase{static_cast<DevFmtType_t<T>*>(OutBuffer) + Offset*FrameStep};
-    size_t c{0};
-    for(const FloatBufferLine &inbuf : InBuffer)
+    const nanoseconds curtime{device->ClockBase +
+        nanoseconds{seconds{device->SamplesDone}}/device->MixFrequency};
+    const auto &contexts = *device->mContexts.load(std::memory_order_acquire);
+    MixerPool *pool{device->mMixerPool.get()};
+
+    /* Set if anything was mixed with the mixer pool, whose dry mixes need to
+     * be combined. Everything else only adds to the dry mix too, so this can
+     * wait until all contexts are processed.
+     */
+    bool mixedParallel{false};
+
+    if(pool && contexts.size() > 1)
     {
-        DevFmtType_t<T> *out{outbase++};
-        auto conv_sample = [FrameStep,&out](const float s) noexcept -> void
+        /* With multiple contexts, each is processed in full on one of the
+         * pool's threads, into that thread's copy of the dry mix, since the
+         * contexts are independent of each other until the final mix. Contexts
+         * with callback voices are processed on the mixer thread, so the app's
+         * callback isn't invoked from a worker thread.
+         */
+        const auto starttime = steady_clock::now();
+        const uint numThreads{pool->size()};
+        std::array<MixerProfileRecord,MaxMixThreads> threadProfiles{};
+        /* The threads are picked before starting the pool, since the voice
+         * flags change while the voices are being mixed. Voices without a
+         * source that aren't being mixed may be getting set up by the API.
+         */
+        auto has_callback = [](ContextBase *ctx) noexcept -> bool
+        {
+            auto is_callback = [](const Voice *voice) noexcept -> bool
+            {
+                const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+                if(vstate != Voice::Playing && vstate != Voice::Stopping
+                    && !HasVoiceSource(voice))
+                    return false;
+                return voice->mFlags.test(VoiceIsCallback);
+            };
+            const al::span<Voice*> voices{ctx->getVoicesSpanAcquired()};
+            return std::any_of(voices.begin(), voices.end(), is_callback);
+        };
+        for(size_t i{0};i < contexts.size();++i)
+        {
+            ContextBase *ctx{contexts[i]};
+            ctx->mMixThread = has_callback(ctx) ? 0u : static_cast<uint>(i % numThreads);
+        }
+
+        auto mix_contexts = [=,&contexts,&threadProfiles](const uint index)
         {
-            *out = SampleConv<DevFmtType_t<T>>(s);
-            out += FrameStep;
+            VoiceMixScratch &scratch = index ? pool->getScratch(index) : device->mMixScratch;
+            for(ContextBase *ctx : contexts)
+            {
+                if(ctx->mMixThread == index)
+                    ProcessContext(device, ctx, nullptr, scratch, curtime, SamplesToDo,
+                        threadProfiles[index]);
+            }
         };
-        std::for_each(inbuf.begin(), inbuf.begin()+SamplesToDo, conv_sample);
-        ++c;
+        pool->run(mix_contexts);
+        mixedParallel = true;
+
+        /* The stages overlap between threads, so split the elapsed time
+         * between them by their share of the threads' total time.
+         */
+        int64_t updateTime{0}, voiceTime{0}, effectTime{0};
+        for(uint i{0};i < numThreads;++i)
+        {
+            updateTime += threadProfiles[i].UpdateTime;
+            voiceTime += threadProfiles[i].VoiceTime;
+            effectTime += threadProfiles[i].EffectTime;
+            profile.ActiveVoices += threadProfiles[i].ActiveVoices;
+            profile.VirtualVoices += threadProfiles[i].VirtualVoices;
+        }
+        if(const int64_t totalTime{updateTime + voiceTime + effectTime})
+        {
+            const int64_t elapsed{duration_cast<nanoseconds>(steady_clock::now()
+                - starttime).count()};
+            profile.UpdateTime += updateTime * elapsed / totalTime;
+            profile.EffectTime += effectTime * elapsed / totalTime;
+            profile.VoiceTime += elapsed - updateTime*elapsed/totalTime
+                - effectTime*elapsed/totalTime;
+        }
     }
-    if(const size_t extra{FrameStep - c})
+    else
     {
-        const auto silence = SampleConv<DevFmtType_t<T>>(0.0f);
-        for(size_t i{0};i < SamplesToDo;++i)
+        for(ContextBase *ctx : contexts)
+            mixedParallel |= ProcessContext(device, ctx, pool, device->mMixScratch, curtime,
+                SamplesToDo, profile);
+    }
+
+    if(mixedParallel)
+    {
+        const auto starttime = steady_clock::now();
+        const size_t numThreads{pool->size()};
+        const size_t numChans{device->MixBuffer.size() / numThreads};
+        ReduceBuffers({device->MixBuffer.data(), numChans}, numThreads, SamplesToDo);
+        if(device->mHrtfState)
+            pool->reduceHrtfAccum(device, SamplesToDo + device->mIrSize);
+        profile.VoiceTime += duration_cast<nanoseconds>(steady_clock::now() - starttime).count();
+    }
+}
+
+
+/* The number of sample frames to run the fused post-process stages over at a
+ * time. This must be a multiple of 4 to keep each tile's offset 16-byte
+ * aligned for the mixer functions.
+ */
+constexpr uint PostProcessTileSize{256};
+static_assert((PostProcessTileSize%4) == 0, "PostProcessTileSize must be a multiple of 4");
+
+/* How long the output needs to stay silent, with nothing left to mix, before
+ * mixing is skipped. This must cover the longest delay in the post-process
+ * stages (distance compensation, limiter look-ahead, HRTF and UHJ filters),
+ * so their delayed output has drained by then.
+ */
+constexpr uint IdleDrainSamples{BufferLineSize};
+static_assert(IdleDrainSamples >= DistanceComp::MaxDelay,
+    "IdleDrainSamples is less than the distance compensation delay");
+
+void ApplyDistanceComp(const al::span<FloatBufferLine> Samples, const size_t Offset,
+    const size_t SamplesToDo, DistanceComp::ChanData *distcomp)
+{
+    ASSUME(SamplesToDo > 0);
+
+    for(auto &chanbuffer : Samples)
+    {
+        DistanceComp::ChanData &chan = *(distcomp++);
+        const float gain{chan.Gain};
+        const size_t length{chan.Length};
+        if(length < 1)
+            continue;
+
+        /* Exchange the samples with the circular delay line, applying the
+         * gain in the same pass. It's done in spans up to the end of the
+         * delay line, so the inner loop is a plain streaming pass.
+         */
+        float *RESTRICT inout{chanbuffer.data() + Offset};
+        float *RESTRICT distbuf{chan.Buffer};
+        size_t pos{chan.Pos};
+        for(size_t done{0};done < SamplesToDo;)
         {
-            std::fill_n(outbase, extra, silence);
-            outbase += FrameStep;
+            const size_t todo{minz(SamplesToDo-done, length-pos)};
+            for(size_t i{0};i < todo;++i)
+            {
+                const float input{inout[done+i]};
+                inout[done+i] = distbuf[pos+i] * gain;
+                distbuf[pos+i] = input;
+            }
+            done += todo;
+            pos += todo;
+            if(pos == length)
+                pos = 0;
         }
+        chan.Pos = static_cast<uint>(pos);
     }
 }
 
@@ -2063,46 +3834,226 @@ void Write(const al::span<const FloatBufferLine> InBuffer, void *OutBuffer, cons
 
 uint DeviceBase::renderSamples(const uint numSamples)
 {
+    /* Nothing here should need the heap, which could block. */
+    al::rt_alloc_scope rtscope{};
+    TIMELINE_SCOPE("renderSamples", "samples", numSamples);
     const uint samplesToDo{minu(numSamples, BufferLineSize)};
+    const auto starttime = steady_clock::now();
+    MixerProfileRecord profile{};
 
-    /* Clear main mixing buffers. */
-    for(FloatBufferLine &buffer : MixBuffer)
-        buffer.fill(0.0f);
-
-    /* Increment the mix count at the start (lsb should now be 1). */
+    /* Increment the mix count at the start (lsb should now be 1). The
+     * contexts and their effect slots can only be looked at after this.
+     */
     IncrementRef(MixCount);
 
-    /* Process and mix each context's sources and effects. */
-    ProcessContexts(this, samplesToDo);
+    /* When the output has been silent long enough with nothing left to mix,
+     * skip mixing and post-processing until something plays again. Voices
+     * start with a voice change, which ends the idle state.
+     */
+    const auto &contexts = *mContexts.load(std::memory_order_acquire);
+    const bool idle{mIdleSamples >= IdleDrainSamples
+        && !mPendingHrtf.load(std::memory_order_relaxed)
+        && !mPendingLimiter.load(std::memory_order_relaxed)
+        && std::all_of(contexts.begin(), contexts.end(), IsContextIdle)};
+
+    /* Clear main mixing buffers. */
+    if(!idle) LIKELY
+    {
+        for(FloatBufferLine &buffer : MixBuffer)
+            buffer.fill(0.0f);
+    }
+
+    if(!idle) LIKELY
+    {
+        /* Swap in a new HRTF between updates, when one is ready. */
+        if(mPendingHrtf.load(std::memory_order_relaxed)) UNLIKELY
+            swapHrtf();
+        if(mPendingLimiter.load(std::memory_order_relaxed)) UNLIKELY
+            swapLimiter();
+
+        /* Process and mix each context's sources and effects. */
+        ProcessContexts(this, samplesToDo, profile);
+        if(mUhjStereoBus)
+            mUhjStereoBus->process(Dry.Buffer, samplesToDo);
+    }
+    else
+    {
+        /* Property updates wait for the next mix, but batched updates still
+         * need to be applied by the event thread.
+         */
+        std::for_each(contexts.begin(), contexts.end(), SignalBatchedUpdates);
+    }
+    const auto posttime = steady_clock::now();
 
     /* Increment the clock time. Every second's worth of samples is converted
      * and added to clock base so that large sample counts don't overflow
      * during conversion. This also guarantees a stable conversion.
      */
     SamplesDone += samplesToDo;
-    ClockBase += std::chrono::seconds{SamplesDone / Frequency};
-    SamplesDone %= Frequency;
+    ClockBase += std::chrono::seconds{SamplesDone / MixFrequency};
+    SamplesDone %= MixFrequency;
+
+    /* Check if there's anything left to mix while the contexts can still be
+     * looked at.
+     */
+    const bool contextsIdle{!idle
+        && std::all_of(contexts.begin(), contexts.end(), IsContextIdle)};
 
     /* Increment the mix count at the end (lsb should now be 0). */
     IncrementRef(MixCount);
 
-    /* Apply any needed post-process for finalizing the Dry mix to the RealOut
-     * (Ambisonic decode, UHJ encode, etc).
-     */
-    postProcess(samplesToDo);
+    if(idle) UNLIKELY
+    {
+        /* Nothing was mixed, so the output is silence. */
+        for(FloatBufferLine &buffer : RealOut.Buffer)
+            std::fill_n(buffer.begin(), samplesToDo, 0.0f);
+    }
+    else if(!PostProcess || PostProcess == &DeviceBase::ProcessAmbiDec) LIKELY
+    {
+        /* The ambisonic decode, limiter, and distance compensation all stream
+         * through the output sample by sample, so run them together over
+         * small tiles of the mix. This keeps each tile of every channel in
+         * cache between stages, instead of streaming the whole output
+         * through memory for each one.
+         */
+        for(uint base{0};base < samplesToDo;base += PostProcessTileSize)
+        {
+            const uint todo{minu(samplesToDo-base, PostProcessTileSize)};
 
-    /* Apply compression, limiting sample amplitude if needed or desired. */
-    if(Limiter) Limiter->process(samplesToDo, RealOut.Buffer.data());
+            /* Decode the ambisonic Dry mix to the RealOut. */
+            if(PostProcess)
+            {
+                TIMELINE_SCOPE("AmbiDecode");
+                AmbiDecoder->process(RealOut.Buffer, Dry.Buffer.data(), base, todo);
+            }
 
-    /* Apply delays and attenuation for mismatched speaker distances. */
-    if(ChannelDelays)
-        ApplyDistanceComp(RealOut.Buffer, samplesToDo, ChannelDelays->mChannels.data());
+            /* Apply compression, limiting sample amplitude if needed or
+             * desired.
+             */
+            if(Limiter)
+            {
+                TIMELINE_SCOPE("Limiter");
+                Limiter->process(todo, RealOut.Buffer.data(), base);
+            }
+
+            /* Apply delays and attenuation for mismatched speaker distances. */
+            if(ChannelDelays)
+            {
+                TIMELINE_SCOPE("DistanceComp");
+                ApplyDistanceComp(RealOut.Buffer, base, todo, ChannelDelays->mChannels.data());
+            }
+        }
+    }
+    else
+    {
+        /* Apply any needed post-process for finalizing the Dry mix to the
+         * RealOut (UHJ encode, HRTF, etc).
+         */
+        {
+            TIMELINE_SCOPE("DeviceBase::postProcess");
+            postProcess(samplesToDo);
+        }
+
+        if(Limiter)
+        {
+            TIMELINE_SCOPE("Limiter");
+            Limiter->process(samplesToDo, RealOut.Buffer.data());
+        }
+
+        if(ChannelDelays)
+        {
+            TIMELINE_SCOPE("DistanceComp");
+            ApplyDistanceComp(RealOut.Buffer, 0, samplesToDo, ChannelDelays->mChannels.data());
+        }
+    }
+
+    /* Count how long the output has been silent with nothing left to mix. */
+    if(!idle) LIKELY
+    {
+        auto is_silent = [samplesToDo](const FloatBufferLine &buffer) noexcept -> bool
+        {
+            return std::all_of(buffer.cbegin(), buffer.cbegin()+samplesToDo,
+                [](const float sample) noexcept -> bool { return sample == 0.0f; });
+        };
+        if(contextsIdle && std::all_of(RealOut.Buffer.begin(), RealOut.Buffer.end(), is_silent))
+            mIdleSamples += minu(samplesToDo, std::numeric_limits<uint>::max() - mIdleSamples);
+        else
+            mIdleSamples = 0;
+    }
 
     /* Apply dithering. The compressor should have left enough headroom for the
-     * dither noise to not saturate.
+     * dither noise to not saturate. Upsampled output is dithered after being
+     * upsampled.
+     */
+    if(DitherDepth > 0.0f && !mOutputUpsampler)
+    {
+        TIMELINE_SCOPE("Dither");
+        gKernels.mApplyDither(RealOut.Buffer, &DitherSeed, DitherDepth, samplesToDo);
+    }
+
+    /* Update the profile with this mix, noting if it took longer than the
+     * samples will take to play.
+     */
+    const auto endtime = steady_clock::now();
+    profile.PostProcessTime = duration_cast<nanoseconds>(endtime - posttime).count();
+    profile.Overrun = (endtime - starttime)*MixFrequency > seconds{samplesToDo};
+    profile.ClockTime = getMixClockTime().count();
+
+    auto add_relaxed = [](std::atomic<uint64_t> &total, const int64_t value) noexcept
+    {
+        total.store(total.load(std::memory_order_relaxed) + static_cast<uint64_t>(value),
+            std::memory_order_relaxed);
+    };
+    add_relaxed(mProfile.mPeriods, 1);
+    add_relaxed(mProfile.mOverruns, profile.Overrun);
+    add_relaxed(mProfile.mUpdateTime, profile.UpdateTime);
+    add_relaxed(mProfile.mVoiceTime, profile.VoiceTime);
+    add_relaxed(mProfile.mEffectTime, profile.EffectTime);
+    add_relaxed(mProfile.mPostProcessTime, profile.PostProcessTime);
+    mProfile.mActiveVoices.store(static_cast<uint>(profile.ActiveVoices),
+        std::memory_order_relaxed);
+    mProfile.mVirtualVoices.store(static_cast<uint>(profile.VirtualVoices),
+        std::memory_order_relaxed);
+    if(mProfileHistory)
+        mProfileHistory->write(&profile, 1);
+
+    /* If the governor changed the mixing quality, voices need to update for
+     * the new limits.
+     */
+    if(mGovernor.update(endtime - starttime, samplesToDo, MixFrequency)) UNLIKELY
+    {
+        for(ContextBase *ctx : *mContexts.load(std::memory_order_acquire))
+            ctx->mForceUpdate = true;
+    }
+
+    return samplesToDo;
+}
+
+uint DeviceBase::renderUpsampled(const uint numSamples)
+{
+    OutputUpsampler &upsampler = *mOutputUpsampler;
+    const uint todo{minu(numSamples, BufferLineSize)};
+
+    /* Mix only as many samples as the upsampler needs for this output, so the
+     * mix doesn't run ahead of the output.
      */
+    if(const uint needed{upsampler.inputNeeded(todo)})
+    {
+        const uint mixed{renderSamples(needed)};
+        upsampler.addInput(RealOut.Buffer, mixed);
+    }
+
+    uint samplesToDo;
+    {
+        TIMELINE_SCOPE("Upsample");
+        samplesToDo = upsampler.process(todo);
+    }
+
     if(DitherDepth > 0.0f)
-        ApplyDither(RealOut.Buffer, &DitherSeed, DitherDepth, samplesToDo);
+    {
+        TIMELINE_SCOPE("Dither");
+        gKernels.mApplyDither(upsampler.mOutput, &DitherSeed, DitherDepth, samplesToDo);
+    }
 
     return samplesToDo;
 }
@@ -2113,9 +4064,10 @@ void DeviceBase::renderSamples(const al::span<float*> outBuffers, const uint num
     uint total{0};
     while(const uint todo{numSamples - total})
     {
-        const uint samplesToDo{renderSamples(todo)};
+        const uint samplesToDo{mOutputUpsampler ? renderUpsampled(todo) : renderSamples(todo)};
 
-        auto *srcbuf = RealOut.Buffer.data();
+        auto *srcbuf = mOutputUpsampler ? mOutputUpsampler->mOutput.data()
+            : RealOut.Buffer.data();
         for(auto *dstbuf : outBuffers)
         {
             std::copy_n(srcbuf->data(), samplesToDo, dstbuf + total);
@@ -2132,26 +4084,18 @@ void DeviceBase::renderSamples(void *outBuffer, const uint numSamples, const siz
     uint total{0};
     while(const uint todo{numSamples - total})
     {
-        const uint samplesToDo{renderSamples(todo)};
+        const uint samplesToDo{mOutputUpsampler ? renderUpsampled(todo) : renderSamples(todo)};
 
         if(outBuffer) LIKELY
         {
             /* Finally, interleave and convert samples, writing to the device's
              * output buffer.
              */
-            switch(FmtType)
-            {
-#define HANDLE_WRITE(T) case T:                                               \
-    Write<T>(RealOut.Buffer, outBuffer, total, samplesToDo, frameStep); break;
-            HANDLE_WRITE(DevFmtByte)
-            HANDLE_WRITE(DevFmtUByte)
-            HANDLE_WRITE(DevFmtShort)
-            HANDLE_WRITE(DevFmtUShort)
-            HANDLE_WRITE(DevFmtInt)
-            HANDLE_WRITE(DevFmtUInt)
-            HANDLE_WRITE(DevFmtFloat)
-#undef HANDLE_WRITE
-            }
+            const al::span<const FloatBufferLine> output{mOutputUpsampler
+                ? al::span<const FloatBufferLine>{mOutputUpsampler->mOutput}
+                : al::span<const FloatBufferLine>{RealOut.Buffer}};
+            gKernels.mWriteSamples(FmtType, output, outBuffer, total, samplesToDo,
+                frameStep);
         }
 
         total += samplesToDo;
@@ -2165,6 +4109,7 @@ void DeviceBase::handleDisconnect(const char *msg, ...)
     {
         AsyncEvent evt{std::in_place_type<AsyncDisconnectEvent>};
         auto &disconnect = std::get<AsyncDisconnectEvent>(evt);
+        disconnect.mTime = getMixClockTime();
 
         va_list args;
         va_start(args, msg);
@@ -2182,7 +4127,8 @@ void DeviceBase::handleDisconnect(const char *msg, ...)
             {
                 al::construct_at(reinterpret_cast<AsyncEvent*>(evt_data.buf), evt);
                 ring->writeAdvance(1);
-                ctx->mEventSem.post();
+                if(!ctx->mEventPolling)
+                    ctx->mEventSem.post();
             }
 
             if(!ctx->mStopVoicesOnDisconnect)
@@ -2,12 +2,17 @@
 #define ALU_H
 
 #include <bitset>
+#include <memory>
 #include <optional>
 #include <stdint.h>
+#include <string>
+
+#include "core/device.h"
 
 struct ALCcontext;
 struct ALCdevice;
 struct EffectSlot;
+struct SourceGroup;
 
 enum class StereoEncoding : uint8_t;
 
@@ -29,10 +34,22 @@ void aluInit(CompatFlagBitset flags, const float nfcscale);
 /* aluInitRenderer
  *
  * Set up the appropriate panning method and mixing method given the device
- * properties.
+ * properties. The HRTF order, if set, selects full HRTF rendering (0) or
+ * ambisonic mixing of the given order that's binauralized once for output.
+ */
+void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<uint> hrtf_order,
+    std::optional<StereoEncoding> stereomode);
+
+/* aluPrepareHrtf
+ *
+ * Loads the named HRTF and builds its state for swapping with the device's
+ * current HRTF, with the given device parameters. This doesn't modify the
+ * device, so it can be called without holding its state lock.
  */
-void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<StereoEncoding> stereomode);
+std::unique_ptr<DeviceBase::HrtfSwap> aluPrepareHrtf(ALCdevice *device,
+    const std::string &name, const uint frequency, const uint ambiOrder, const float xoverFreq);
 
 void aluInitEffectPanning(EffectSlot *slot, ALCcontext *context);
+void aluInitSourceGroupPanning(SourceGroup *group, ALCcontext *context);
 
 #endif
@@ -43,7 +43,6 @@
 #include "alnumeric.h"
 #include "althrd_setname.h"
 #include "core/device.h"
-#include "core/helpers.h"
 #include "core/logging.h"
 #include "dynload.h"
 #include "ringbuffer.h"
@@ -457,7 +456,7 @@ AlsaPlayback::~AlsaPlayback()
 
 int AlsaPlayback::mixerProc()
 {
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     const snd_pcm_uframes_t update_size{mDevice->UpdateSize};
@@ -540,7 +539,7 @@ int AlsaPlayback::mixerProc()
 
 int AlsaPlayback::mixerNoMMapProc()
 {
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     const snd_pcm_uframes_t update_size{mDevice->UpdateSize};
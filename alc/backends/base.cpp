@@ -18,6 +18,7 @@
 
 #include "atomic.h"
 #include "core/devformat.h"
+#include "ringbuffer.h"
 
 
 namespace al {
@@ -34,6 +35,14 @@ backend_exception::~backend_exception() = default;
 } // namespace al
 
 
+const std::byte *MapRingSamples(const RingBuffer *ring, uint *samples) noexcept
+{
+    const auto vec = ring->getReadVector();
+    *samples = static_cast<uint>(vec.first.len);
+    return vec.first.buf;
+}
+
+
 bool BackendBase::reset()
 { throw al::backend_exception{al::backend_error::DeviceError, "Invalid BackendBase call"}; }
 
@@ -43,6 +52,37 @@ void BackendBase::captureSamples(std::byte*, uint)
 uint BackendBase::availableSamples()
 { return 0; }
 
+const std::byte *BackendBase::mapSamples(uint *samples)
+{
+    *samples = 0;
+    return nullptr;
+}
+
+void BackendBase::unmapSamples(uint)
+{ }
+
+bool BackendBase::canCaptureCallback()
+{ return false; }
+
+bool BackendBase::deliverCapture(const void *samples, uint numsamples)
+{
+    if(!mCaptureCallback)
+        return false;
+
+    /* Split the clock into whole seconds and the remaining samples, so it
+     * doesn't overflow.
+     */
+    using std::chrono::seconds;
+    using std::chrono::nanoseconds;
+    const uint freq{mDevice->Frequency};
+    const auto clocktime = nanoseconds{seconds{mCaptureSamplesDone / freq}}
+        + nanoseconds{seconds{mCaptureSamplesDone % freq}} / freq;
+    mCaptureSamplesDone += numsamples;
+
+    mCaptureCallback(mCaptureUserPtr, samples, static_cast<int>(numsamples), clocktime.count());
+    return true;
+}
+
 ClockLatency BackendBase::getClockLatency()
 {
     ClockLatency ret;
@@ -4,6 +4,7 @@
 #include <chrono>
 #include <cstdarg>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <ratio>
 #include <string>
@@ -11,6 +12,8 @@
 #include "core/device.h"
 #include "core/except.h"
 
+struct RingBuffer;
+
 
 using uint = unsigned int;
 
@@ -29,10 +32,29 @@ struct BackendBase {
     virtual void captureSamples(std::byte *buffer, uint samples);
     virtual uint availableSamples();
 
+    /* Gets direct access to the next contiguous run of captured samples,
+     * setting samples to how many there are, without copying them out of the
+     * backend's buffer. Returns nullptr if the backend can't provide this. The
+     * samples stay valid until released with unmapSamples.
+     */
+    virtual const std::byte *mapSamples(uint *samples);
+    virtual void unmapSamples(uint samples);
+
+    /* Whether the backend can give captured samples to the app's capture
+     * callback (with deliverCapture) as they arrive.
+     */
+    virtual bool canCaptureCallback();
+
     virtual ClockLatency getClockLatency();
 
     DeviceBase *const mDevice;
 
+    /* The app's capture callback, which is only changed while stopped. */
+    using CaptureCallbackT = void(*)(void *userptr, const void *samples, int numsamples,
+        int64_t clocktime);
+    CaptureCallbackT mCaptureCallback{nullptr};
+    void *mCaptureUserPtr{nullptr};
+
     BackendBase(DeviceBase *device) noexcept : mDevice{device} { }
     virtual ~BackendBase() = default;
 
@@ -41,6 +63,18 @@ protected:
     void setDefaultChannelOrder();
     /** Sets the default channel order used by WaveFormatEx. */
     void setDefaultWFXChannelOrder();
+
+    /**
+     * Gives captured samples, in the device's format, to the app's capture
+     * callback if one is set, along with the device clock time of the first
+     * sample. Returns false if there's no callback, and the samples should be
+     * stored for captureSamples as usual.
+     */
+    bool deliverCapture(const void *samples, uint numsamples);
+
+private:
+    /* The number of samples given to the capture callback, for its clock. */
+    uint64_t mCaptureSamplesDone{0u};
 };
 using BackendPtr = std::unique_ptr<BackendBase>;
 
@@ -58,7 +92,7 @@ inline std::chrono::nanoseconds GetDeviceClockTime(DeviceBase *device)
     using std::chrono::seconds;
     using std::chrono::nanoseconds;
 
-    auto ns = nanoseconds{seconds{device->SamplesDone}} / device->Frequency;
+    auto ns = nanoseconds{seconds{device->SamplesDone}} / device->MixFrequency;
     return device->ClockBase + ns;
 }
 
@@ -73,6 +107,12 @@ inline ClockLatency GetClockLatency(DeviceBase *device, BackendBase *backend)
 }
 
 
+/* Helper for capture backends that record into a ring buffer, in the
+ * device's format, to map the next readable segment.
+ */
+const std::byte *MapRingSamples(const RingBuffer *ring, uint *samples) noexcept;
+
+
 struct BackendFactory {
     virtual bool init() = 0;
 
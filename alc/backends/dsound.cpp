@@ -50,7 +50,6 @@
 #include "althrd_setname.h"
 #include "comptr.h"
 #include "core/device.h"
-#include "core/helpers.h"
 #include "core/logging.h"
 #include "dynload.h"
 #include "ringbuffer.h"
@@ -210,7 +209,7 @@ DSoundPlayback::~DSoundPlayback()
 
 FORCE_ALIGN int DSoundPlayback::mixerProc()
 {
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     DSBCAPS DSBCaps{};
@@ -428,7 +428,7 @@ int JackPlayback::process(jack_nframes_t numframes) noexcept
 
 int JackPlayback::mixerProc()
 {
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     const size_t frame_step{mDevice->channelsFromFmt()};
@@ -30,10 +30,12 @@
 #include <functional>
 #include <thread>
 
-#include "althrd_setname.h"
+#include "alc/alconfig.h"
 #include "almalloc.h"
+#include "alnumeric.h"
+#include "althrd_setname.h"
 #include "core/device.h"
-#include "core/helpers.h"
+#include "scheduler.h"
 
 
 namespace {
@@ -45,11 +47,13 @@ using std::chrono::nanoseconds;
 constexpr char nullDevice[] = "No Output";
 
 
-struct NullBackend final : public BackendBase {
+struct NullBackend final : public BackendBase, RenderScheduler::Task {
     NullBackend(DeviceBase *device) noexcept : BackendBase{device} { }
 
     int mixerProc();
 
+    RenderScheduler::clock::time_point runTask() override;
+
     void open(const char *name) override;
     bool reset() override;
     void start() override;
@@ -58,6 +62,11 @@ struct NullBackend final : public BackendBase {
     std::atomic<bool> mKillNow{true};
     std::thread mThread;
 
+    /* When rendering through the shared scheduler instead of a thread. */
+    RenderScheduler *mScheduler{nullptr};
+    RenderScheduler::clock::time_point mStart;
+    int64_t mDone{0};
+
     DEF_NEWDEL(NullBackend)
 };
 
@@ -65,7 +74,7 @@ int NullBackend::mixerProc()
 {
     const milliseconds restTime{mDevice->UpdateSize*1000/mDevice->Frequency / 2};
 
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     int64_t done{0};
@@ -104,6 +113,34 @@ int NullBackend::mixerProc()
     return 0;
 }
 
+RenderScheduler::clock::time_point NullBackend::runTask()
+{
+    const auto now = RenderScheduler::clock::now();
+    if(!mDevice->Connected.load(std::memory_order_acquire))
+        return now + seconds{1};
+
+    /* Same as mixerProc, but rather than sleeping, return when the next
+     * update will be ready. Rounded up so it's not run too early.
+     */
+    int64_t avail{std::chrono::duration_cast<seconds>((now-mStart) * mDevice->Frequency).count()};
+    while(avail-mDone >= mDevice->UpdateSize)
+    {
+        mDevice->renderSamples(nullptr, mDevice->UpdateSize, 0u);
+        mDone += mDevice->UpdateSize;
+    }
+
+    if(mDone >= mDevice->Frequency)
+    {
+        seconds s{mDone/mDevice->Frequency};
+        mStart += s;
+        mDone -= mDevice->Frequency*s.count();
+    }
+
+    const nanoseconds next{(nanoseconds{seconds{mDone + mDevice->UpdateSize}}
+        + nanoseconds{mDevice->Frequency-1}) / mDevice->Frequency};
+    return mStart + next;
+}
+
 
 void NullBackend::open(const char *name)
 {
@@ -124,6 +161,22 @@ bool NullBackend::reset()
 
 void NullBackend::start()
 {
+    if(auto numthreads = ConfigValueUInt(nullptr, "null", "shared-threads"))
+    {
+        if(*numthreads > 0)
+        {
+            RenderScheduler &scheduler = RenderScheduler::Get(minu(*numthreads, 64u));
+            if(scheduler.size() > 0)
+            {
+                mStart = RenderScheduler::clock::now();
+                mDone = 0;
+                mScheduler = &scheduler;
+                mScheduler->add(this, mStart);
+                return;
+            }
+        }
+    }
+
     try {
         mKillNow.store(false, std::memory_order_release);
         mThread = std::thread{std::mem_fn(&NullBackend::mixerProc), this};
@@ -136,6 +189,13 @@ void NullBackend::start()
 
 void NullBackend::stop()
 {
+    if(mScheduler)
+    {
+        mScheduler->remove(this);
+        mScheduler = nullptr;
+        return;
+    }
+
     if(mKillNow.exchange(true, std::memory_order_acq_rel) || !mThread.joinable())
         return;
     mThread.join();
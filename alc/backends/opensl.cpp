@@ -38,7 +38,6 @@
 #include "alsem.h"
 #include "althrd_setname.h"
 #include "core/device.h"
-#include "core/helpers.h"
 #include "core/logging.h"
 #include "opthelpers.h"
 #include "ringbuffer.h"
@@ -230,7 +229,7 @@ void OpenSLPlayback::process(SLAndroidSimpleBufferQueueItf) noexcept
 
 int OpenSLPlayback::mixerProc()
 {
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     SLPlayItf player;
@@ -25,6 +25,7 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -47,6 +48,7 @@
 #include "core/device.h"
 #include "core/helpers.h"
 #include "core/logging.h"
+#include "core/tracing.h"
 #include "ringbuffer.h"
 
 #include <sys/soundcard.h>
@@ -226,6 +228,9 @@ struct OSSPlayback final : public BackendBase {
     ~OSSPlayback() override;
 
     int mixerProc();
+    int mmapMixerProc();
+
+    void unmapBuffer() noexcept;
 
     void open(const char *name) override;
     bool reset() override;
@@ -236,6 +241,12 @@ struct OSSPlayback final : public BackendBase {
 
     std::vector<std::byte> mMixData;
 
+    /* The device's DMA buffer, when mapped for rendering into directly. */
+    std::byte *mMmapBuffer{nullptr};
+    size_t mMmapSize{0u};
+    uint mFragSize{0u};
+    uint mNumFrags{0u};
+
     std::atomic<bool> mKillNow{true};
     std::thread mThread;
 
@@ -244,6 +255,7 @@ struct OSSPlayback final : public BackendBase {
 
 OSSPlayback::~OSSPlayback()
 {
+    unmapBuffer();
     if(mFd != -1)
         ::close(mFd);
     mFd = -1;
@@ -252,7 +264,7 @@ OSSPlayback::~OSSPlayback()
 
 int OSSPlayback::mixerProc()
 {
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     const size_t frame_step{mDevice->channelsFromFmt()};
@@ -265,7 +277,11 @@ int OSSPlayback::mixerProc()
         pollitem.fd = mFd;
         pollitem.events = POLLOUT;
 
-        int pret{poll(&pollitem, 1, 1000)};
+        int pret{};
+        {
+            TIMELINE_SCOPE("OSS wait");
+            pret = poll(&pollitem, 1, 1000);
+        }
         if(pret < 0)
         {
             if(errno == EINTR || errno == EAGAIN)
@@ -283,6 +299,7 @@ int OSSPlayback::mixerProc()
         std::byte *write_ptr{mMixData.data()};
         size_t to_write{mMixData.size()};
         mDevice->renderSamples(write_ptr, static_cast<uint>(to_write/frame_size), frame_step);
+        TIMELINE_SCOPE("OSS write", "bytes", static_cast<int64_t>(to_write));
         while(to_write > 0 && !mKillNow.load(std::memory_order_acquire))
         {
             ssize_t wrote{write(mFd, write_ptr, to_write)};
@@ -304,6 +321,79 @@ int OSSPlayback::mixerProc()
 }
 
 
+int OSSPlayback::mmapMixerProc()
+{
+    mDevice->setupMixerThread();
+    althrd_setname(MIXER_THREAD_NAME);
+
+    const size_t frame_step{mDevice->channelsFromFmt()};
+    const uint frag_frames{mFragSize / mDevice->frameSizeFromFmt()};
+    const int timeout{static_cast<int>(std::max(mDevice->UpdateSize*1000u/mDevice->Frequency,
+        1u))};
+
+    /* The next fragment to render. The device plays the buffer in a loop, so
+     * this stays at least one fragment behind its read position and each
+     * fragment is rendered right after it's played.
+     */
+    uint write_frag{0u};
+    while(!mKillNow.load(std::memory_order_acquire)
+        && mDevice->Connected.load(std::memory_order_acquire))
+    {
+        pollfd pollitem{};
+        pollitem.fd = mFd;
+        pollitem.events = POLLOUT;
+
+        int pret{};
+        {
+            TIMELINE_SCOPE("OSS wait");
+            pret = poll(&pollitem, 1, timeout);
+        }
+        if(pret < 0)
+        {
+            if(errno == EINTR || errno == EAGAIN)
+                continue;
+            ERR("poll failed: %s\n", strerror(errno));
+            mDevice->handleDisconnect("Failed waiting for playback buffer: %s", strerror(errno));
+            break;
+        }
+
+        /* Not every driver signals poll for a mapped buffer, so check the
+         * read position even when it times out.
+         */
+        count_info cinfo{};
+        if(ioctl(mFd, SNDCTL_DSP_GETOPTR, &cinfo) < 0)
+        {
+            ERR("SNDCTL_DSP_GETOPTR failed: %s\n", strerror(errno));
+            mDevice->handleDisconnect("Failed getting playback position: %s", strerror(errno));
+            break;
+        }
+        const uint read_frag{static_cast<uint>(cinfo.ptr) / mFragSize % mNumFrags};
+
+        uint todo{(read_frag + mNumFrags - write_frag) % mNumFrags};
+        while(todo > 0)
+        {
+            const uint frags{std::min(todo, mNumFrags - write_frag)};
+            std::byte *write_ptr{mMmapBuffer + size_t{write_frag}*mFragSize};
+            TIMELINE_SCOPE("OSS mix", "bytes", static_cast<int64_t>(size_t{frags}*mFragSize));
+            mDevice->renderSamples(write_ptr, frags*frag_frames, frame_step);
+            write_frag = (write_frag+frags) % mNumFrags;
+            todo -= frags;
+        }
+    }
+
+    return 0;
+}
+
+
+void OSSPlayback::unmapBuffer() noexcept
+{
+    if(mMmapBuffer)
+        munmap(mMmapBuffer, mMmapSize);
+    mMmapBuffer = nullptr;
+    mMmapSize = 0;
+}
+
+
 void OSSPlayback::open(const char *name)
 {
     const char *devname{DefaultPlayback.c_str()};
@@ -329,6 +419,7 @@ void OSSPlayback::open(const char *name)
         throw al::backend_exception{al::backend_error::NoDevice, "Could not open %s: %s", devname,
             strerror(errno)};
 
+    unmapBuffer();
     if(mFd != -1)
         ::close(mFd);
     mFd = fd;
@@ -338,6 +429,8 @@ void OSSPlayback::open(const char *name)
 
 bool OSSPlayback::reset()
 {
+    unmapBuffer();
+
     int ossFormat{};
     switch(mDevice->FmtType)
     {
@@ -409,16 +502,58 @@ bool OSSPlayback::reset()
 
     setDefaultChannelOrder();
 
-    mMixData.resize(mDevice->UpdateSize * mDevice->frameSizeFromFmt());
+    /* Optionally map the device's buffer to render into it directly, rather
+     * than mixing into a separate buffer and writing it out. Not all devices
+     * can be mapped, so fall back to writing if it fails.
+     */
+    if(GetConfigValueBool(nullptr, "oss", "mmap", false))
+    {
+        const size_t bufsize{static_cast<size_t>(info.fragsize) *
+            static_cast<uint>(info.fragments)};
+        void *ptr{mmap(nullptr, bufsize, PROT_WRITE, MAP_SHARED, mFd, 0)};
+        if(ptr == MAP_FAILED)
+            WARN("Failed to map device buffer, using writes: %s\n", strerror(errno));
+        else
+        {
+            mMmapBuffer = static_cast<std::byte*>(ptr);
+            mMmapSize = bufsize;
+            mFragSize = static_cast<uint>(info.fragsize);
+            mNumFrags = static_cast<uint>(info.fragments);
+            TRACE("Mapped %u fragments of %u bytes\n", mNumFrags, mFragSize);
+        }
+    }
+
+    if(mMmapBuffer)
+        mMixData.clear();
+    else
+        mMixData.resize(mDevice->UpdateSize * mDevice->frameSizeFromFmt());
 
     return true;
 }
 
 void OSSPlayback::start()
 {
+    if(mMmapBuffer)
+    {
+        /* Start the mapped buffer from silence, and trigger the output since
+         * nothing gets written to start it.
+         */
+        const std::byte silence{(mDevice->FmtType == DevFmtUByte) ? std::byte{0x80}
+            : std::byte{}};
+        std::fill_n(mMmapBuffer, mMmapSize, silence);
+
+        int trigger{0};
+        ioctl(mFd, SNDCTL_DSP_SETTRIGGER, &trigger);
+        trigger = PCM_ENABLE_OUTPUT;
+        if(ioctl(mFd, SNDCTL_DSP_SETTRIGGER, &trigger) < 0)
+            throw al::backend_exception{al::backend_error::DeviceError,
+                "Failed to trigger playback: %s", strerror(errno)};
+    }
+
     try {
         mKillNow.store(false, std::memory_order_release);
-        mThread = std::thread{std::mem_fn(&OSSPlayback::mixerProc), this};
+        mThread = std::thread{std::mem_fn(mMmapBuffer ? &OSSPlayback::mmapMixerProc
+            : &OSSPlayback::mixerProc), this};
     }
     catch(std::exception& e) {
         throw al::backend_exception{al::backend_error::DeviceError,
@@ -448,10 +583,15 @@ struct OSScapture final : public BackendBase {
     void stop() override;
     void captureSamples(std::byte *buffer, uint samples) override;
     uint availableSamples() override;
+    const std::byte *mapSamples(uint *samples) override;
+    void unmapSamples(uint samples) override;
+    bool canCaptureCallback() override;
 
     int mFd{-1};
 
     RingBufferPtr mRing{nullptr};
+    /* The period read from the device, with a capture callback. */
+    std::vector<std::byte> mPeriodBuffer;
 
     std::atomic<bool> mKillNow{true};
     std::thread mThread;
@@ -471,6 +611,7 @@ int OSScapture::recordProc()
 {
     SetRTPriority();
     althrd_setname(RECORD_THREAD_NAME);
+    SetThreadAffinity(ThreadRole::Capture);
 
     const size_t frame_size{mDevice->frameSizeFromFmt()};
     while(!mKillNow.load(std::memory_order_acquire))
@@ -494,6 +635,23 @@ int OSScapture::recordProc()
             continue;
         }
 
+        /* With a capture callback, read each period into a local buffer to
+         * give to it, skipping the ring buffer.
+         */
+        if(mCaptureCallback)
+        {
+            ssize_t amt{read(mFd, mPeriodBuffer.data(), mPeriodBuffer.size())};
+            if(amt < 0)
+            {
+                ERR("read failed: %s\n", strerror(errno));
+                mDevice->handleDisconnect("Failed reading capture samples: %s", strerror(errno));
+                break;
+            }
+            if(const auto todo = static_cast<size_t>(amt)/frame_size)
+                deliverCapture(mPeriodBuffer.data(), static_cast<uint>(todo));
+            continue;
+        }
+
         auto vec = mRing->getWriteVector();
         if(vec.first.len > 0)
         {
@@ -590,6 +748,7 @@ void OSScapture::open(const char *name)
             ossFormat};
 
     mRing = RingBuffer::Create(mDevice->BufferSize, frameSize, false);
+    mPeriodBuffer.resize(size_t{1} << log2FragmentSize);
 
     mDevice->DeviceName = name;
 }
@@ -622,6 +781,15 @@ void OSScapture::captureSamples(std::byte *buffer, uint samples)
 uint OSScapture::availableSamples()
 { return static_cast<uint>(mRing->readSpace()); }
 
+const std::byte *OSScapture::mapSamples(uint *samples)
+{ return MapRingSamples(mRing.get(), samples); }
+
+void OSScapture::unmapSamples(uint samples)
+{ mRing->readAdvance(samples); }
+
+bool OSScapture::canCaptureCallback()
+{ return true; }
+
 } // namespace
 
 
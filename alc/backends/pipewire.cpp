@@ -1429,10 +1429,12 @@ void PipeWirePlayback::outputCallback()
     /* If no length is specified, use the device's update size as a fallback. */
     if(!length) UNLIKELY length = mDevice->UpdateSize;
 
-    /* For planar formats, each datas[] seems to contain one channel, so store
-     * the pointers in an array. Limit the render length in case the available
-     * buffer length in any one channel is smaller than we wanted (shouldn't
-     * be, but just in case).
+    /* Playback is always planar float (see open()), so each datas[] contains
+     * one channel, and the mix is written straight into them with no
+     * interleaving or sample conversion on either side. Store the pointers in
+     * an array, and limit the render length in case the available buffer
+     * length in any one channel is smaller than we wanted (shouldn't be, but
+     * just in case).
      */
     float **chanptr_end{mChannelPtrs.get()};
     for(const auto &data : datas)
@@ -0,0 +1,126 @@
+
+#include "config.h"
+
+#include "scheduler.h"
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+
+#include "althrd_setname.h"
+#include "core/device.h"
+#include "core/helpers.h"
+#include "core/logging.h"
+
+
+RenderScheduler::RenderScheduler(const uint numThreads)
+{
+    mThreads.reserve(numThreads);
+    try {
+        for(uint i{0};i < numThreads;++i)
+            mThreads.emplace_back(std::mem_fn(&RenderScheduler::workerProc), this);
+    }
+    catch(std::exception& e) {
+        ERR("Failed to start render thread: %s\n", e.what());
+    }
+    TRACE("Started %zu shared render thread%s\n", mThreads.size(),
+        (mThreads.size()==1) ? "" : "s");
+}
+
+RenderScheduler::~RenderScheduler()
+{
+    {
+        std::lock_guard<std::mutex> _{mMutex};
+        mQuit = true;
+    }
+    mCond.notify_all();
+    for(auto &thread : mThreads)
+        thread.join();
+}
+
+RenderScheduler &RenderScheduler::Get(const uint numThreads)
+{
+    static RenderScheduler scheduler{numThreads};
+    return scheduler;
+}
+
+
+void RenderScheduler::add(Task *task, const clock::time_point due)
+{
+    {
+        std::lock_guard<std::mutex> _{mMutex};
+        mQueue.emplace_back(Entry{due, task});
+        std::push_heap(mQueue.begin(), mQueue.end());
+    }
+    /* The new task may be due sooner than what the workers are waiting for. */
+    mCond.notify_all();
+}
+
+void RenderScheduler::remove(Task *task)
+{
+    std::unique_lock<std::mutex> lock{mMutex};
+    auto iter = std::find_if(mQueue.begin(), mQueue.end(),
+        [task](const Entry &entry) noexcept { return entry.mTask == task; });
+    if(iter != mQueue.end())
+    {
+        mQueue.erase(iter);
+        std::make_heap(mQueue.begin(), mQueue.end());
+        return;
+    }
+
+    if(std::find(mRunning.cbegin(), mRunning.cend(), task) == mRunning.cend())
+        return;
+    mRemoved.emplace_back(task);
+    mCond.wait(lock, [this,task]
+    { return std::find(mRunning.cbegin(), mRunning.cend(), task) == mRunning.cend(); });
+}
+
+
+void RenderScheduler::workerProc()
+{
+    SetRTPriority();
+    SetThreadAffinity(ThreadRole::Mixer);
+    althrd_setname(MIXER_THREAD_NAME);
+
+    std::unique_lock<std::mutex> lock{mMutex};
+    while(!mQuit)
+    {
+        if(mQueue.empty())
+        {
+            mCond.wait(lock);
+            continue;
+        }
+
+        const clock::time_point due{mQueue.front().mDue};
+        if(clock::now() < due)
+        {
+            mCond.wait_until(lock, due);
+            continue;
+        }
+
+        std::pop_heap(mQueue.begin(), mQueue.end());
+        Task *task{mQueue.back().mTask};
+        mQueue.pop_back();
+        mRunning.emplace_back(task);
+
+        lock.unlock();
+        const clock::time_point next{task->runTask()};
+        lock.lock();
+
+        mRunning.erase(std::find(mRunning.begin(), mRunning.end(), task));
+        auto removed = std::find(mRemoved.begin(), mRemoved.end(), task);
+        if(removed != mRemoved.end())
+        {
+            mRemoved.erase(removed);
+            /* Wake the thread waiting on the removal. */
+            mCond.notify_all();
+            continue;
+        }
+
+        mQueue.emplace_back(Entry{next, task});
+        std::push_heap(mQueue.begin(), mQueue.end());
+        /* Let another worker wait on a sooner task, if there is one. */
+        if(mQueue.front().mTask != task)
+            mCond.notify_one();
+    }
+}
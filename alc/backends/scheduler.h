@@ -0,0 +1,78 @@
+#ifndef ALC_BACKENDS_SCHEDULER_H
+#define ALC_BACKENDS_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using uint = unsigned int;
+
+
+/* A process-wide pool of threads for timer-driven backends. Rather than each
+ * device creating its own mixer thread, devices register a task that renders
+ * the device's pending updates. The workers run each task when it's due, in
+ * deadline order, so many devices can share a few threads.
+ */
+class RenderScheduler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Task {
+        /* Renders whatever is due, and returns when the task should run next.
+         * A task is never run on more than one thread at a time.
+         */
+        virtual clock::time_point runTask() = 0;
+
+    protected:
+        ~Task() = default;
+    };
+
+    /* Starts scheduling the task, first running it at the given time. */
+    void add(Task *task, const clock::time_point due);
+
+    /* Stops scheduling the task. If the task is running, this waits for it to
+     * finish.
+     */
+    void remove(Task *task);
+
+    uint size() const noexcept { return static_cast<uint>(mThreads.size()); }
+
+    /* Gets the shared scheduler, starting it with the given number of threads
+     * if it isn't running yet.
+     */
+    static RenderScheduler &Get(const uint numThreads);
+
+    RenderScheduler(const RenderScheduler&) = delete;
+    RenderScheduler& operator=(const RenderScheduler&) = delete;
+
+private:
+    struct Entry {
+        clock::time_point mDue;
+        Task *mTask;
+
+        /* For a min-heap, with the earliest deadline at the front. */
+        bool operator<(const Entry &rhs) const noexcept { return mDue > rhs.mDue; }
+    };
+
+    std::mutex mMutex;
+    std::condition_variable mCond;
+
+    /* Tasks waiting to run, as a heap. */
+    std::vector<Entry> mQueue;
+    /* Tasks currently being run by a worker. */
+    std::vector<Task*> mRunning;
+    /* Tasks that have been removed while running. */
+    std::vector<Task*> mRemoved;
+    bool mQuit{false};
+
+    std::vector<std::thread> mThreads;
+
+    explicit RenderScheduler(const uint numThreads);
+    ~RenderScheduler();
+
+    void workerProc();
+};
+
+#endif /* ALC_BACKENDS_SCHEDULER_H */
@@ -85,7 +85,7 @@ int SndioPlayback::mixerProc()
     const size_t frameStep{mFrameStep};
     const size_t frameSize{frameStep * mDevice->bytesFromFmt()};
 
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     while(!mKillNow.load(std::memory_order_acquire)
@@ -307,6 +307,7 @@ int SndioCapture::recordProc()
 {
     SetRTPriority();
     althrd_setname(RECORD_THREAD_NAME);
+    SetThreadAffinity(ThreadRole::Capture);
 
     const uint frameSize{mDevice->frameSizeFromFmt()};
 
@@ -43,7 +43,6 @@
 #include "alc/alconfig.h"
 #include "althrd_setname.h"
 #include "core/device.h"
-#include "core/helpers.h"
 #include "core/logging.h"
 
 #include <sys/audioio.h>
@@ -87,7 +86,7 @@ SolarisBackend::~SolarisBackend()
 
 int SolarisBackend::mixerProc()
 {
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     const size_t frame_step{mDevice->channelsFromFmt()};
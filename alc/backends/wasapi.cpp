@@ -1064,7 +1064,7 @@ FORCE_ALIGN int WasapiPlayback::mixerProc()
         return 1;
     }
 
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     const uint frame_size{mFormat.Format.nChannels * mFormat.Format.wBitsPerSample / 8u};
@@ -1703,6 +1703,7 @@ FORCE_ALIGN int WasapiCapture::recordProc()
     }
 
     althrd_setname(RECORD_THREAD_NAME);
+    SetThreadAffinity(ThreadRole::Capture);
 
     std::vector<float> samples;
     while(!mKillNow.load(std::memory_order_relaxed))
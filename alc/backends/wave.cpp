@@ -23,14 +23,17 @@
 #include "wave.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cerrno>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <exception>
 #include <functional>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -57,6 +60,9 @@ using ushort = unsigned short;
 
 constexpr char waveDevice[] = "Wave File Writer";
 
+/* The approximate size of each block handed to the writer thread. */
+constexpr size_t WriteBlockBytes{1024*1024};
+
 constexpr ubyte SUBTYPE_PCM[]{
     0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa,
     0x00, 0x38, 0x9b, 0x71
@@ -89,12 +95,42 @@ void fwrite32le(uint val, FILE *f)
     fwrite(data, 1, 4, f);
 }
 
+void fwrite64le(uint64_t val, FILE *f)
+{
+    fwrite32le(static_cast<uint>(val&0xffffffff), f);
+    fwrite32le(static_cast<uint>(val>>32), f);
+}
+
+/* The output can grow past 2GB, which a long offset can't hold everywhere. */
+int64_t ftell64(FILE *f)
+{
+#ifdef _WIN32
+    return _ftelli64(f);
+#else
+    return ftello(f);
+#endif
+}
+
+int fseek64(FILE *f, int64_t offset, int origin)
+{
+#ifdef _WIN32
+    return _fseeki64(f, offset, origin);
+#else
+    return fseeko(f, static_cast<off_t>(offset), origin);
+#endif
+}
+
 
 struct WaveBackend final : public BackendBase {
     WaveBackend(DeviceBase *device) noexcept : BackendBase{device} { }
     ~WaveBackend() override;
 
     int mixerProc();
+    int writerProc();
+
+    std::byte *getFreeBlock();
+    void queueBlock(size_t numBytes);
+    void stopWriter();
 
     void open(const char *name) override;
     bool reset() override;
@@ -102,12 +138,30 @@ struct WaveBackend final : public BackendBase {
     void stop() override;
 
     FILE *mFile{nullptr};
-    long mDataStart{-1};
-
-    std::vector<std::byte> mBuffer;
+    int64_t mDataStart{-1};
+
+    /* Set when the output isn't paced to the sample rate, so the file is
+     * written as fast as the mixer can render.
+     */
+    bool mRealtime{true};
+
+    /* The mixer renders into large blocks, which the writer thread writes out
+     * to the file while the mixer fills the next one. Blocks are used in
+     * order, with mBlocksQueued counting the ones handed to the writer and
+     * mBlocksWritten the ones it's done with.
+     */
+    static constexpr size_t NumBlocks{2};
+    std::array<std::vector<std::byte>,NumBlocks> mBlocks;
+    std::array<size_t,NumBlocks> mBlockSizes{};
+    size_t mBlocksQueued{0};
+    size_t mBlocksWritten{0};
+    bool mWriterQuit{false};
+    std::mutex mBlockLock;
+    std::condition_variable mBlockCond;
 
     std::atomic<bool> mKillNow{true};
     std::thread mThread;
+    std::thread mWriterThread;
 
     DEF_NEWDEL(WaveBackend)
 };
@@ -119,6 +173,35 @@ WaveBackend::~WaveBackend()
     mFile = nullptr;
 }
 
+std::byte *WaveBackend::getFreeBlock()
+{
+    std::unique_lock<std::mutex> blocklock{mBlockLock};
+    mBlockCond.wait(blocklock, [this]{ return mBlocksQueued-mBlocksWritten < NumBlocks; });
+    return mBlocks[mBlocksQueued%NumBlocks].data();
+}
+
+void WaveBackend::queueBlock(size_t numBytes)
+{
+    {
+        std::lock_guard<std::mutex> _{mBlockLock};
+        mBlockSizes[mBlocksQueued%NumBlocks] = numBytes;
+        ++mBlocksQueued;
+    }
+    mBlockCond.notify_all();
+}
+
+void WaveBackend::stopWriter()
+{
+    if(!mWriterThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> _{mBlockLock};
+        mWriterQuit = true;
+    }
+    mBlockCond.notify_all();
+    mWriterThread.join();
+}
+
 int WaveBackend::mixerProc()
 {
     const milliseconds restTime{mDevice->UpdateSize*1000/mDevice->Frequency / 2};
@@ -127,12 +210,33 @@ int WaveBackend::mixerProc()
 
     const size_t frameStep{mDevice->channelsFromFmt()};
     const size_t frameSize{mDevice->frameSizeFromFmt()};
+    const size_t blockLen{mBlocks[0].size() / frameSize};
+
+    std::byte *block{getFreeBlock()};
+    size_t blockPos{0};
+    auto render_update = [this,frameStep,frameSize,blockLen,&block,&blockPos]()
+    {
+        mDevice->renderSamples(block + blockPos*frameSize, mDevice->UpdateSize, frameStep);
+        blockPos += mDevice->UpdateSize;
+        if(blockPos == blockLen)
+        {
+            queueBlock(blockPos * frameSize);
+            block = getFreeBlock();
+            blockPos = 0;
+        }
+    };
 
     int64_t done{0};
     auto start = std::chrono::steady_clock::now();
     while(!mKillNow.load(std::memory_order_acquire)
         && mDevice->Connected.load(std::memory_order_acquire))
     {
+        if(!mRealtime)
+        {
+            render_update();
+            continue;
+        }
+
         auto now = std::chrono::steady_clock::now();
 
         /* This converts from nanoseconds to nanosamples, then to samples. */
@@ -145,50 +249,81 @@ int WaveBackend::mixerProc()
         }
         while(avail-done >= mDevice->UpdateSize)
         {
-            mDevice->renderSamples(mBuffer.data(), mDevice->UpdateSize, frameStep);
+            render_update();
             done += mDevice->UpdateSize;
+        }
+
+        /* For every completed second, increment the start time and reduce the
+         * samples done. This prevents the difference between the start time
+         * and current time from growing too large, while maintaining the
+         * correct number of samples to render.
+         */
+        if(done >= mDevice->Frequency)
+        {
+            seconds s{done/mDevice->Frequency};
+            done %= mDevice->Frequency;
+            start += s;
+        }
+    }
+    if(blockPos > 0)
+        queueBlock(blockPos * frameSize);
 
+    return 0;
+}
+
+int WaveBackend::writerProc()
+{
+    althrd_setname(WAVE_WRITER_THREAD_NAME);
+
+    const uint bytesize{mDevice->bytesFromFmt()};
+
+    bool failed{false};
+    std::unique_lock<std::mutex> blocklock{mBlockLock};
+    while(true)
+    {
+        mBlockCond.wait(blocklock,
+            [this]{ return mBlocksWritten != mBlocksQueued || mWriterQuit; });
+        if(mBlocksWritten == mBlocksQueued)
+            break;
+
+        std::byte *block{mBlocks[mBlocksWritten%NumBlocks].data()};
+        const size_t len{mBlockSizes[mBlocksWritten%NumBlocks]};
+        blocklock.unlock();
+
+        /* Keep consuming blocks after a failure, so the mixer doesn't stall
+         * before it sees the device is disconnected.
+         */
+        if(!failed)
+        {
             if(al::endian::native != al::endian::little)
             {
-                const uint bytesize{mDevice->bytesFromFmt()};
-
                 if(bytesize == 2)
                 {
-                    const size_t len{mBuffer.size() & ~size_t{1}};
-                    for(size_t i{0};i < len;i+=2)
-                        std::swap(mBuffer[i], mBuffer[i+1]);
+                    for(size_t i{0};i < (len&~size_t{1});i+=2)
+                        std::swap(block[i], block[i+1]);
                 }
                 else if(bytesize == 4)
                 {
-                    const size_t len{mBuffer.size() & ~size_t{3}};
-                    for(size_t i{0};i < len;i+=4)
+                    for(size_t i{0};i < (len&~size_t{3});i+=4)
                     {
-                        std::swap(mBuffer[i  ], mBuffer[i+3]);
-                        std::swap(mBuffer[i+1], mBuffer[i+2]);
+                        std::swap(block[i  ], block[i+3]);
+                        std::swap(block[i+1], block[i+2]);
                     }
                 }
             }
 
-            const size_t fs{fwrite(mBuffer.data(), frameSize, mDevice->UpdateSize, mFile)};
-            if(fs < mDevice->UpdateSize || ferror(mFile))
+            const size_t fs{fwrite(block, 1, len, mFile)};
+            if(fs < len || ferror(mFile))
             {
                 ERR("Error writing to file\n");
                 mDevice->handleDisconnect("Failed to write playback samples");
-                break;
+                failed = true;
             }
         }
 
-        /* For every completed second, increment the start time and reduce the
-         * samples done. This prevents the difference between the start time
-         * and current time from growing too large, while maintaining the
-         * correct number of samples to render.
-         */
-        if(done >= mDevice->Frequency)
-        {
-            seconds s{done/mDevice->Frequency};
-            done %= mDevice->Frequency;
-            start += s;
-        }
+        blocklock.lock();
+        ++mBlocksWritten;
+        mBlockCond.notify_all();
     }
 
     return 0;
@@ -289,6 +424,16 @@ bool WaveBackend::reset()
 
     fputs("WAVE", mFile);
 
+    /* Reserve space for an RF64 'ds64' chunk, in case the output grows too
+     * large for the 32-bit sizes. Readers skip it as padding otherwise.
+     */
+    fputs("JUNK", mFile);
+    fwrite32le(28, mFile);
+    fwrite64le(0, mFile);
+    fwrite64le(0, mFile);
+    fwrite64le(0, mFile);
+    fwrite32le(0, mFile);
+
     fputs("fmt ", mFile);
     fwrite32le(40, mFile); // 'fmt ' header len; 40 bytes for EXTENSIBLE
 
@@ -324,25 +469,36 @@ bool WaveBackend::reset()
         ERR("Error writing header: %s\n", strerror(errno));
         return false;
     }
-    mDataStart = ftell(mFile);
+    mDataStart = ftell64(mFile);
 
     setDefaultWFXChannelOrder();
 
-    const uint bufsize{mDevice->frameSizeFromFmt() * mDevice->UpdateSize};
-    mBuffer.resize(bufsize);
+    mRealtime = GetConfigValueBool(nullptr, "wave", "realtime", true);
+
+    const size_t updateBytes{size_t{mDevice->frameSizeFromFmt()} * mDevice->UpdateSize};
+    const size_t blockBytes{std::max(WriteBlockBytes/updateBytes, size_t{1}) * updateBytes};
+    for(auto &block : mBlocks)
+        block.resize(blockBytes);
 
     return true;
 }
 
 void WaveBackend::start()
 {
-    if(mDataStart > 0 && fseek(mFile, 0, SEEK_END) != 0)
+    if(mDataStart > 0 && fseek64(mFile, 0, SEEK_END) != 0)
         WARN("Failed to seek on output file\n");
+
+    mBlocksQueued = 0;
+    mBlocksWritten = 0;
+    mWriterQuit = false;
     try {
+        mWriterThread = std::thread{std::mem_fn(&WaveBackend::writerProc), this};
         mKillNow.store(false, std::memory_order_release);
         mThread = std::thread{std::mem_fn(&WaveBackend::mixerProc), this};
     }
     catch(std::exception& e) {
+        mKillNow.store(true, std::memory_order_release);
+        stopWriter();
         throw al::backend_exception{al::backend_error::DeviceError,
             "Failed to start mixing thread: %s", e.what()};
     }
@@ -353,17 +509,42 @@ void WaveBackend::stop()
     if(mKillNow.exchange(true, std::memory_order_acq_rel) || !mThread.joinable())
         return;
     mThread.join();
+    stopWriter();
 
     if(mDataStart > 0)
     {
-        long size{ftell(mFile)};
+        const int64_t size{ftell64(mFile)};
         if(size > 0)
         {
-            long dataLen{size - mDataStart};
-            if(fseek(mFile, 4, SEEK_SET) == 0)
-                fwrite32le(static_cast<uint>(size-8), mFile); // 'WAVE' header len
-            if(fseek(mFile, mDataStart-4, SEEK_SET) == 0)
-                fwrite32le(static_cast<uint>(dataLen), mFile); // 'data' header len
+            const int64_t dataLen{size - mDataStart};
+            if(static_cast<uint64_t>(size-8) <= 0xFFFFFFFF)
+            {
+                if(fseek64(mFile, 0, SEEK_SET) == 0)
+                {
+                    fputs("RIFF", mFile);
+                    fwrite32le(static_cast<uint>(size-8), mFile); // 'WAVE' header len
+                }
+                if(fseek64(mFile, mDataStart-4, SEEK_SET) == 0)
+                    fwrite32le(static_cast<uint>(dataLen), mFile); // 'data' header len
+            }
+            else if(fseek64(mFile, 0, SEEK_SET) == 0)
+            {
+                /* Too big for a plain RIFF file, so turn it into RF64 with the
+                 * real sizes in the reserved 'ds64' chunk.
+                 */
+                const uint64_t frameSize{mDevice->frameSizeFromFmt()};
+                fputs("RF64", mFile);
+                fwrite32le(0xFFFFFFFF, mFile);
+                fputs("WAVE", mFile);
+                fputs("ds64", mFile);
+                fwrite32le(28, mFile);
+                fwrite64le(static_cast<uint64_t>(size-8), mFile); // 'WAVE' header len
+                fwrite64le(static_cast<uint64_t>(dataLen), mFile); // 'data' header len
+                fwrite64le(static_cast<uint64_t>(dataLen)/frameSize, mFile); // sample count
+                fwrite32le(0, mFile); // table length
+                if(fseek64(mFile, mDataStart-4, SEEK_SET) == 0)
+                    fwrite32le(0xFFFFFFFF, mFile);
+            }
         }
     }
 }
@@ -179,7 +179,7 @@ void CALLBACK WinMMPlayback::waveOutProc(HWAVEOUT, UINT msg, DWORD_PTR, DWORD_PT
 
 FORCE_ALIGN int WinMMPlayback::mixerProc()
 {
-    SetRTPriority();
+    mDevice->setupMixerThread();
     althrd_setname(MIXER_THREAD_NAME);
 
     while(!mKillNow.load(std::memory_order_acquire)
@@ -419,6 +419,7 @@ void CALLBACK WinMMCapture::waveInProc(HWAVEIN, UINT msg, DWORD_PTR, DWORD_PTR)
 int WinMMCapture::captureProc()
 {
     althrd_setname(RECORD_THREAD_NAME);
+    SetThreadAffinity(ThreadRole::Capture);
 
     while(!mKillNow.load(std::memory_order_acquire) &&
           mDevice->Connected.load(std::memory_order_acquire))
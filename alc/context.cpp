@@ -19,6 +19,7 @@
 #include "al/auxeffectslot.h"
 #include "al/debug.h"
 #include "al/source.h"
+#include "al/sourcegroup.h"
 #include "al/effect.h"
 #include "al/event.h"
 #include "al/listener.h"
@@ -29,6 +30,7 @@
 #include "core/device.h"
 #include "core/effectslot.h"
 #include "core/logging.h"
+#include "core/sourcegroup.h"
 #include "core/voice.h"
 #include "core/voice_change.h"
 #include "device.h"
@@ -70,9 +72,11 @@ std::vector<std::string_view> getContextExtensions() noexcept
         "AL_EXT_STATIC_BUFFER",
         "AL_EXT_STEREO_ANGLES",
         "AL_LOKI_quadriphonic",
+        "AL_SOFTX_async_buffer",
         "AL_SOFT_bformat_ex",
         "AL_SOFTX_bformat_hoa",
         "AL_SOFT_block_alignment",
+        "AL_SOFTX_buffer_half_float",
         "AL_SOFT_buffer_length_query",
         "AL_SOFT_callback_buffer",
         "AL_SOFTX_convolution_reverb",
@@ -81,11 +85,21 @@ std::vector<std::string_view> getContextExtensions() noexcept
         "AL_SOFT_direct_channels_remix",
         "AL_SOFT_effect_target",
         "AL_SOFT_events",
+        "AL_SOFTX_event_batch",
+        "AL_SOFTX_file_buffer",
         "AL_SOFT_gain_clamp_ex",
         "AL_SOFTX_hold_on_disconnect",
         "AL_SOFT_loop_points",
         "AL_SOFTX_map_buffer",
         "AL_SOFT_MSADPCM",
+        "AL_SOFTX_multi_listener",
+        "AL_SOFTX_property_memory",
+        "AL_SOFTX_queue_low_watermark",
+        "AL_SOFTX_ring_buffer",
+        "AL_SOFTX_source_batch",
+        "AL_SOFTX_source_groups",
+        "AL_SOFTX_source_mix_time",
+        "AL_SOFTX_source_ramps",
         "AL_SOFT_source_latency",
         "AL_SOFT_source_length",
         "AL_SOFT_source_resampler",
@@ -93,6 +107,7 @@ std::vector<std::string_view> getContextExtensions() noexcept
         "AL_SOFT_source_start_delay",
         "AL_SOFT_UHJ",
         "AL_SOFT_UHJ_ex",
+        "AL_SOFTX_voice_budget",
     };
 }
 
@@ -142,11 +157,20 @@ ALCcontext::~ALCcontext()
         WARN("%zu Source%s not deleted\n", count, (count==1)?"":"s");
     mSourceList.clear();
     mNumSources = 0;
+    delete mSourceTable.exchange(nullptr, std::memory_order_relaxed);
 
 #ifdef ALSOFT_EAX
     eaxUninitialize();
 #endif // ALSOFT_EAX
 
+    count = std::accumulate(mSourceGroupList.cbegin(), mSourceGroupList.cend(), size_t{0u},
+        [](size_t cur, const SourceGroupSubList &sublist) noexcept -> size_t
+        { return cur + static_cast<uint>(al::popcount(~sublist.FreeMask)); });
+    if(count > 0)
+        WARN("%zu SourceGroup%s not deleted\n", count, (count==1)?"":"s");
+    mSourceGroupList.clear();
+    mNumSourceGroups = 0;
+
     mDefaultSlot = nullptr;
     count = std::accumulate(mEffectSlotList.cbegin(), mEffectSlotList.cend(), size_t{0u},
         [](size_t cur, const EffectSlotSubList &sublist) noexcept -> size_t
@@ -175,6 +199,7 @@ void ALCcontext::init()
         mDefaultSlot->mState = SlotState::Playing;
     }
     mActiveAuxSlots.store(auxslots, std::memory_order_relaxed);
+    mActiveSourceGroups.store(SourceGroup::CreatePtrArray(0), std::memory_order_relaxed);
 
     allocVoiceChanges();
     {
@@ -182,6 +207,7 @@ void ALCcontext::init()
         while(VoiceChange *next{cur->mNext.load(std::memory_order_relaxed)})
             cur = next;
         mCurrentVoiceChange.store(cur, std::memory_order_relaxed);
+        mLastVoiceChange.store(cur, std::memory_order_relaxed);
     }
 
     mExtensions = getContextExtensions();
@@ -219,9 +245,13 @@ void ALCcontext::init()
         mExtensionsString = std::move(extensions);
     }
 
-    mParams.Position = alu::Vector{0.0f, 0.0f, 0.0f, 1.0f};
-    mParams.Matrix = alu::Matrix::Identity();
-    mParams.Velocity = alu::Vector{};
+    for(ListenerTransform &listener : mParams.Listeners)
+    {
+        listener.Position = alu::Vector{0.0f, 0.0f, 0.0f, 1.0f};
+        listener.Matrix = alu::Matrix::Identity();
+        listener.Velocity = alu::Vector{};
+    }
+    mParams.NumListeners = 1;
     mParams.Gain = mListener.Gain;
     mParams.MetersPerUnit = mListener.mMetersPerUnit;
     mParams.AirAbsorptionGainHF = mAirAbsorptionGainHF;
@@ -232,11 +262,16 @@ void ALCcontext::init()
 
 
     mAsyncEvents = RingBuffer::Create(511, sizeof(AsyncEvent), false);
-    StartEventThrd(this);
+    mAsyncEventsMemory.set(mDevice->mMemoryStats, MemCategory::RingBuffers,
+        mAsyncEvents->memoryUsage());
+    if(!mEventPolling)
+        StartEventThrd(this);
 
 
     allocVoices(256);
-    mActiveVoiceCount.store(64, std::memory_order_relaxed);
+    mActiveVoiceCount.store(MinActiveVoices, std::memory_order_relaxed);
+    for(Voice *voice : getVoicesSpan())
+        pushFreeVoice(voice);
 }
 
 bool ALCcontext::deinit()
@@ -316,6 +351,7 @@ void ALCcontext::applyAllUpdates()
     if(std::exchange(mPropsDirty, false))
         UpdateContextProps(this);
     UpdateAllEffectSlotProps(this);
+    UpdateAllSourceGroupProps(this);
     UpdateAllSourceProps(this);
 
     /* Now with all updates declared, let the mixer continue applying them so
@@ -398,9 +434,18 @@ ALenum ALCcontext::eax_eax_set(
 
     if(!call.is_deferred())
     {
-        eaxCommit();
-        if(!mDeferUpdates)
-            applyAllUpdates();
+        /* With batched commits, the changes are committed together when the
+         * mixer starts its next update (or the app processes updates),
+         * instead of for each call. This needs the event thread to do it.
+         */
+        if(eax_g_batch_commits && mEventThread.joinable())
+            mBatchedUpdatesPending.store(true, std::memory_order_release);
+        else
+        {
+            eaxCommit();
+            if(!mDeferUpdates)
+                applyAllUpdates();
+        }
     }
 
     return AL_NO_ERROR;
@@ -648,8 +693,15 @@ void ALCcontext::eax_dispatch_fx_slot(const EaxCall& call)
     auto& fx_slot = eaxGetFxSlot(*fx_slot_index);
     if(fx_slot.eax_dispatch(call))
     {
+        /* Only the sources sending to the slot need their filters updated.
+         * Sources that start using it with this commit are already queued.
+         */
         std::lock_guard<std::mutex> source_lock{mSourceLock};
-        ForEachSource(this, std::mem_fn(&ALsource::eaxMarkAsChanged));
+        ForEachSource(this, [index=*fx_slot_index](ALsource &source)
+        {
+            if(source.eaxUsesFxSlot(index))
+                source.eaxMarkAsChanged();
+        });
     }
 }
 
@@ -789,12 +841,43 @@ void ALCcontext::eax_initialize_fx_slots()
     mEaxPrimaryFxSlotIndex = mEax.guidPrimaryFXSlotID;
 }
 
+void ALCcontext::eaxQueueSource(ALsource *source) noexcept
+{
+    if(source->mEaxQueued)
+        return;
+    source->mEaxQueued = true;
+    source->mEaxNextQueued = std::exchange(mEaxQueuedSources, source);
+}
+
+void ALCcontext::eaxUnqueueSource(ALsource *source) noexcept
+{
+    ALsource **next{&mEaxQueuedSources};
+    while(*next && *next != source)
+        next = &(*next)->mEaxNextQueued;
+    if(*next)
+        *next = source->mEaxNextQueued;
+    source->mEaxNextQueued = nullptr;
+    source->mEaxQueued = false;
+}
+
+void ALCcontext::eax_queue_all_sources() noexcept
+{
+    std::lock_guard<std::mutex> source_lock{mSourceLock};
+    ForEachSource(this, [this](ALsource &source) { eaxQueueSource(&source); });
+}
+
 void ALCcontext::eax_update_sources()
 {
     std::unique_lock<std::mutex> source_lock{mSourceLock};
-    auto update_source = [](ALsource &source)
-    { source.eaxCommit(); };
-    ForEachSource(this, update_source);
+    /* Take each source off the queue before committing it, so the rest stay
+     * queued if committing throws.
+     */
+    while(ALsource *source{mEaxQueuedSources})
+    {
+        mEaxQueuedSources = std::exchange(source->mEaxNextQueued, nullptr);
+        source->mEaxQueued = false;
+        source->eaxCommit();
+    }
 }
 
 void ALCcontext::eax_set_misc(const EaxCall& call)
@@ -1008,8 +1091,14 @@ void ALCcontext::eax_context_commit()
     if((dst_df & eax_macro_fx_factor_dirty_bit) != EaxDirtyFlags{})
         eax_context_commit_macro_fx_factor();
 
+    /* Every source may refer to the primary slot, so they all need to check
+     * it.
+     */
     if((dst_df & eax_primary_fx_slot_id_dirty_bit) != EaxDirtyFlags{})
+    {
+        eax_queue_all_sources();
         eax_update_sources();
+    }
 }
 
 void ALCcontext::eaxCommit()
@@ -1020,6 +1109,17 @@ void ALCcontext::eaxCommit()
     eax_update_sources();
 }
 
+void ALCcontext::eaxCommitBatch()
+{
+    mBatchedUpdatesPending.store(false, std::memory_order_relaxed);
+    if(!mEaxNeedsCommit)
+        return;
+
+    eaxCommit();
+    if(!mDeferUpdates)
+        applyAllUpdates();
+}
+
 namespace {
 
 class EaxSetException : public EaxException {
@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -19,6 +20,7 @@
 #include "almalloc.h"
 #include "alnumeric.h"
 #include "atomic.h"
+#include "core/async_event.h"
 #include "core/context.h"
 #include "inprogext.h"
 #include "intrusive_ptr.h"
@@ -34,6 +36,7 @@
 struct ALeffect;
 struct ALeffectslot;
 struct ALsource;
+struct ALsourcegroup;
 struct DebugGroup;
 
 enum class DebugSource : uint8_t;
@@ -67,19 +70,59 @@ struct DebugLogEntry {
 };
 
 
+/* Keeps the storage blocks freed from sources' buffer queues, for the queues
+ * to reuse. A streaming source that keeps queueing and unqueueing buffers
+ * would otherwise keep allocating and freeing the same size of storage. Only
+ * blocks of one size are kept, up to MaxFree. Must be used with the source
+ * lock held.
+ */
+class BufferQueuePool {
+    struct FreeBlock {
+        FreeBlock *mNext;
+    };
+    FreeBlock *mFreeList{nullptr};
+    size_t mBlockSize{0u};
+    uint mNumFree{0u};
+
+public:
+    static constexpr uint MaxFree{64u};
+
+    BufferQueuePool() = default;
+    BufferQueuePool(const BufferQueuePool&) = delete;
+    ~BufferQueuePool();
+    BufferQueuePool& operator=(const BufferQueuePool&) = delete;
+
+    void *allocate(size_t size, size_t alignment);
+    void deallocate(void *block, size_t size) noexcept;
+};
+
 struct SourceSubList {
     uint64_t FreeMask{~0_u64};
     ALsource *Sources{nullptr}; /* 64 */
+    /* The inverse of FreeMask, set after a source is constructed and cleared
+     * before it's destroyed, for looking up sources without the source lock.
+     */
+    std::atomic<uint64_t> LiveMask{0_u64};
 
     SourceSubList() noexcept = default;
     SourceSubList(const SourceSubList&) = delete;
     SourceSubList(SourceSubList&& rhs) noexcept : FreeMask{rhs.FreeMask}, Sources{rhs.Sources}
-    { rhs.FreeMask = ~0_u64; rhs.Sources = nullptr; }
+      , LiveMask{rhs.LiveMask.load(std::memory_order_relaxed)}
+    {
+        rhs.FreeMask = ~0_u64; rhs.Sources = nullptr;
+        rhs.LiveMask.store(0_u64, std::memory_order_relaxed);
+    }
     ~SourceSubList();
 
     SourceSubList& operator=(const SourceSubList&) = delete;
     SourceSubList& operator=(SourceSubList&& rhs) noexcept
-    { std::swap(FreeMask, rhs.FreeMask); std::swap(Sources, rhs.Sources); return *this; }
+    {
+        std::swap(FreeMask, rhs.FreeMask); std::swap(Sources, rhs.Sources);
+        const uint64_t livemask{LiveMask.load(std::memory_order_relaxed)};
+        LiveMask.store(rhs.LiveMask.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        rhs.LiveMask.store(livemask, std::memory_order_relaxed);
+        return *this;
+    }
 };
 
 struct EffectSlotSubList {
@@ -98,12 +141,31 @@ struct EffectSlotSubList {
     { std::swap(FreeMask, rhs.FreeMask); std::swap(EffectSlots, rhs.EffectSlots); return *this; }
 };
 
+struct SourceGroupSubList {
+    uint64_t FreeMask{~0_u64};
+    ALsourcegroup *SourceGroups{nullptr}; /* 64 */
+
+    SourceGroupSubList() noexcept = default;
+    SourceGroupSubList(const SourceGroupSubList&) = delete;
+    SourceGroupSubList(SourceGroupSubList&& rhs) noexcept
+      : FreeMask{rhs.FreeMask}, SourceGroups{rhs.SourceGroups}
+    { rhs.FreeMask = ~0_u64; rhs.SourceGroups = nullptr; }
+    ~SourceGroupSubList();
+
+    SourceGroupSubList& operator=(const SourceGroupSubList&) = delete;
+    SourceGroupSubList& operator=(SourceGroupSubList&& rhs) noexcept
+    { std::swap(FreeMask, rhs.FreeMask); std::swap(SourceGroups, rhs.SourceGroups); return *this; }
+};
+
 struct ALCcontext : public al::intrusive_ref<ALCcontext>, ContextBase {
     const al::intrusive_ptr<ALCdevice> mALDevice;
 
 
     bool mPropsDirty{true};
-    bool mDeferUpdates{false};
+    /* Written with mPropLock held, but also checked by source property
+     * updates that don't hold it.
+     */
+    std::atomic<bool> mDeferUpdates{false};
 
     std::mutex mPropLock;
 
@@ -123,6 +185,14 @@ struct ALCcontext : public al::intrusive_ref<ALCcontext>, ContextBase {
     std::mutex mEventCbLock;
     ALEVENTPROCSOFT mEventCb{};
     void *mEventParam{nullptr};
+    ALEVENTBATCHPROCSOFT mEventBatchCb{};
+    void *mEventBatchParam{nullptr};
+
+    /* Buffers the device finished loading asynchronously, for the event
+     * handler to report.
+     */
+    std::mutex mBufferLoadLock;
+    std::vector<AsyncBufferLoadedEvent> mLoadedBuffers;
 
     std::mutex mDebugCbLock;
     ALDEBUGPROCEXT mDebugCb{};
@@ -132,14 +202,38 @@ struct ALCcontext : public al::intrusive_ref<ALCcontext>, ContextBase {
 
     ALlistener mListener{};
 
-    std::vector<SourceSubList> mSourceList;
+    /* Storage for the sources' buffer queues. */
+    BufferQueuePool mQueuePool;
+
+    /* A deque keeps the sublists in place as more are added, so they can be
+     * found through mSourceTable without the source lock.
+     */
+    std::deque<SourceSubList> mSourceList;
     ALuint mNumSources{0};
     std::mutex mSourceLock;
 
+    /* A copy of the source sublist pointers, for looking up sources without
+     * the source lock. It's replaced when sublists are added, with the old one
+     * deleted once no threads can be using it.
+     */
+    using SourceTable = al::FlexArray<SourceSubList*>;
+    std::atomic<SourceTable*> mSourceTable{nullptr};
+
+    /* The number of threads accessing sources without the source lock, and a
+     * flag to keep them out while sources or their storage get freed or
+     * replaced (see SourceReadGuard and SourceWriteGuard).
+     */
+    std::atomic<uint> mSourceReaders{0u};
+    std::atomic<bool> mSourceWriting{false};
+
     std::vector<EffectSlotSubList> mEffectSlotList;
     ALuint mNumEffectSlots{0u};
     std::mutex mEffectSlotLock;
 
+    std::vector<SourceGroupSubList> mSourceGroupList;
+    ALuint mNumSourceGroups{0u};
+    std::mutex mSourceGroupLock;
+
     /* Default effect slot */
     std::unique_ptr<ALeffectslot> mDefaultSlot;
 
@@ -173,7 +267,7 @@ struct ALCcontext : public al::intrusive_ref<ALCcontext>, ContextBase {
      */
     void processUpdates()
     {
-        if(std::exchange(mDeferUpdates, false))
+        if(mDeferUpdates.exchange(false, std::memory_order_acq_rel))
             applyAllUpdates();
     }
 
@@ -271,10 +365,23 @@ public:
 
     bool eaxNeedsCommit() const noexcept { return mEaxNeedsCommit; }
     void eaxCommit();
+    /**
+     * Commits the EAX changes batched since the last commit, and applies them
+     * unless updates are deferred. mPropLock must be held when called.
+     */
+    void eaxCommitBatch();
 
     void eaxCommitFxSlots()
     { mEaxFxSlots.commit(); }
 
+    /* Queues the source to be committed with the context's next EAX commit,
+     * if it isn't already. Only queued sources are committed, so EAX changes
+     * don't need to visit every source. Must be called with mSourceLock held.
+     */
+    void eaxQueueSource(ALsource *source) noexcept;
+    /* Removes the source from the commit queue, for when it's deleted. */
+    void eaxUnqueueSource(ALsource *source) noexcept;
+
 private:
     static constexpr auto eax_primary_fx_slot_id_dirty_bit = EaxDirtyFlags{1} << 0;
     static constexpr auto eax_distance_factor_dirty_bit = EaxDirtyFlags{1} << 1;
@@ -446,6 +553,10 @@ private:
 
     EaxFxSlotIndex mEaxPrimaryFxSlotIndex{};
     EaxFxSlots mEaxFxSlots{};
+    /* The sources queued for the next EAX commit, linked through their
+     * mEaxNextQueued. Protected by mSourceLock.
+     */
+    ALsource *mEaxQueuedSources{};
 
     int mEaxVersion{}; // Current EAX version.
     bool mEaxNeedsCommit{};
@@ -549,6 +660,7 @@ private:
 
     void eax_initialize_fx_slots();
 
+    void eax_queue_all_sources() noexcept;
     void eax_update_sources();
 
     void eax_set_misc(const EaxCall& call);
@@ -564,6 +676,55 @@ private:
 #endif // ALSOFT_EAX
 };
 
+/**
+ * Keeps sources, the source table, and the voice list from being freed while
+ * accessing them without the source lock. This doesn't keep other threads
+ * from accessing the same source, which needs the source's own mPropLock.
+ */
+class SourceReadGuard {
+    ALCcontext *const mContext;
+
+public:
+    explicit SourceReadGuard(ALCcontext *context) noexcept : mContext{context}
+    {
+        while(true)
+        {
+            mContext->mSourceReaders.fetch_add(1u, std::memory_order_seq_cst);
+            if(!mContext->mSourceWriting.load(std::memory_order_seq_cst)) LIKELY
+                break;
+
+            mContext->mSourceReaders.fetch_sub(1u, std::memory_order_seq_cst);
+            while(mContext->mSourceWriting.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+    }
+    ~SourceReadGuard() { mContext->mSourceReaders.fetch_sub(1u, std::memory_order_release); }
+
+    SourceReadGuard(const SourceReadGuard&) = delete;
+    SourceReadGuard& operator=(const SourceReadGuard&) = delete;
+};
+
+/**
+ * Waits for and holds off threads accessing sources without the source lock,
+ * to safely free sources or replace storage they may be using. mSourceLock
+ * must be held, and no source's mPropLock.
+ */
+class SourceWriteGuard {
+    ALCcontext *const mContext;
+
+public:
+    explicit SourceWriteGuard(ALCcontext *context) noexcept : mContext{context}
+    {
+        mContext->mSourceWriting.store(true, std::memory_order_seq_cst);
+        while(mContext->mSourceReaders.load(std::memory_order_seq_cst) != 0)
+            std::this_thread::yield();
+    }
+    ~SourceWriteGuard() { mContext->mSourceWriting.store(false, std::memory_order_release); }
+
+    SourceWriteGuard(const SourceWriteGuard&) = delete;
+    SourceWriteGuard& operator=(const SourceWriteGuard&) = delete;
+};
+
 using ContextRef = al::intrusive_ptr<ALCcontext>;
 
 ContextRef GetContextRef(void);
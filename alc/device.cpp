@@ -3,6 +3,7 @@
 
 #include "device.h"
 
+#include <algorithm>
 #include <numeric>
 #include <stddef.h>
 
@@ -11,6 +12,7 @@
 #include "backends/base.h"
 #include "core/bformatdec.h"
 #include "core/bs2b.h"
+#include "core/effects/base.h"
 #include "core/front_stablizer.h"
 #include "core/hrtf.h"
 #include "core/logging.h"
@@ -32,6 +34,34 @@ ALCdevice::~ALCdevice()
 {
     TRACE("Freeing device %p\n", voidp{this});
 
+    if(mHrtfLoader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> _{mHrtfRequestLock};
+            mHrtfLoaderQuit = true;
+        }
+        mHrtfRequestCond.notify_all();
+        mHrtfLoader.join();
+    }
+    if(mBufferLoader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> _{mBufferLoadLock};
+            mBufferLoaderQuit = true;
+        }
+        mBufferLoadCond.notify_all();
+        mBufferLoader.join();
+    }
+    if(mPrefetcher.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> _{mPrefetchLock};
+            mPrefetcherQuit = true;
+        }
+        mPrefetchCond.notify_all();
+        mPrefetcher.join();
+    }
+
     Backend = nullptr;
 
     size_t count{std::accumulate(BufferList.cbegin(), BufferList.cend(), size_t{0u},
@@ -53,6 +83,8 @@ ALCdevice::~ALCdevice()
         WARN("%zu Filter%s not deleted\n", count, (count==1)?"":"s");
 }
 
+ALCdevice::HrtfRequest::~HrtfRequest() = default;
+
 void ALCdevice::enumerateHrtfs()
 {
     mHrtfList = EnumerateHrtf(configValue<std::string>(nullptr, "hrtf-paths"));
@@ -91,3 +123,39 @@ auto ALCdevice::getOutputMode1() const noexcept -> OutputMode1
     }
     return OutputMode1::Any;
 }
+
+
+al::intrusive_ptr<EffectState> ALCdevice::takeEffectState(EffectStateFactory *factory,
+    const EffectProps &props)
+{
+    std::lock_guard<std::mutex> _{EffectStatePoolLock};
+    auto iter = std::find_if(EffectStatePool.begin(), EffectStatePool.end(),
+        [factory,&props](const al::intrusive_ptr<EffectState> &state) noexcept -> bool
+        { return state->mFactory == factory && state->canApply(&props); });
+    if(iter == EffectStatePool.end())
+        return nullptr;
+
+    al::intrusive_ptr<EffectState> state{std::move(*iter)};
+    EffectStatePool.erase(iter);
+    return state;
+}
+
+void ALCdevice::recycleEffectState(EffectState *state)
+{
+    al::intrusive_ptr<EffectState> oldstate{state};
+    if(!oldstate->mFactory)
+        return;
+
+    /* The lock is released before the state is deleted, if it isn't kept. */
+    std::lock_guard<std::mutex> _{EffectStatePoolLock};
+    const auto count = std::count_if(EffectStatePool.cbegin(), EffectStatePool.cend(),
+        [factory=oldstate->mFactory](const al::intrusive_ptr<EffectState> &pooled) noexcept
+        { return pooled->mFactory == factory; });
+    if(static_cast<size_t>(count) >= EffectStatePoolSize)
+        return;
+    try {
+        EffectStatePool.emplace_back(std::move(oldstate));
+    }
+    catch(...) {
+    }
+}
@@ -2,11 +2,16 @@
 #define ALC_DEVICE_H
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <stdint.h>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -28,6 +33,10 @@ struct ALbuffer;
 struct ALeffect;
 struct ALfilter;
 struct BackendBase;
+struct CallbackPrefetch;
+struct EffectState;
+struct EffectStateFactory;
+union EffectProps;
 
 using uint = unsigned int;
 
@@ -86,6 +95,9 @@ struct ALCdevice : public al::intrusive_ref<ALCdevice>, DeviceBase {
     std::mutex StateLock;
     std::unique_ptr<BackendBase> Backend;
 
+    /* The number of capture samples the app has mapped. */
+    uint CaptureMapped{0u};
+
     ALCuint NumMonoSources{};
     ALCuint NumStereoSources{};
 
@@ -98,6 +110,66 @@ struct ALCdevice : public al::intrusive_ref<ALCdevice>, DeviceBase {
     std::vector<std::string> mHrtfList;
     ALCenum mHrtfStatus{ALC_FALSE};
 
+    /* An HRTF change requested by an asynchronous reset, for the loader
+     * thread to prepare and swap in while the device keeps playing.
+     */
+    struct HrtfRequest {
+        std::string mName;
+        uint mFrequency{};
+        uint mAmbiOrder{};
+        float mXOverFreq{};
+        /* The reset attributes, in case a full reset is needed. */
+        std::vector<int> mAttribs;
+
+        HrtfRequest() = default;
+        HrtfRequest(HrtfRequest&&) = default;
+        ~HrtfRequest();
+        HrtfRequest& operator=(HrtfRequest&&) = default;
+    };
+    std::thread mHrtfLoader;
+    std::mutex mHrtfRequestLock;
+    std::condition_variable mHrtfRequestCond;
+    std::optional<HrtfRequest> mHrtfRequest;
+    bool mHrtfLoaderQuit{false};
+
+    /* Buffer data for the loader thread to copy in, from alBufferDataAsync. */
+    struct BufferLoad {
+        ALuint mId;
+        const std::byte *mData;
+        size_t mSize;
+        bool mShare;
+    };
+    std::thread mBufferLoader;
+    std::mutex mBufferLoadLock;
+    std::condition_variable mBufferLoadCond;
+    std::deque<BufferLoad> mBufferLoads;
+    bool mBufferLoaderQuit{false};
+    /* Notified, with BufferLock held, when a buffer finishes loading. */
+    std::condition_variable mBufferLoadedCond;
+
+    /* Callback buffers the prefetch thread keeps filled ahead of the mixer,
+     * with the callback-prefetch option giving how many updates ahead. The
+     * thread wakes every interval, or when a buffer is added.
+     */
+    uint mCallbackPrefetch{0u};
+    std::thread mPrefetcher;
+    std::mutex mPrefetchLock;
+    std::condition_variable mPrefetchCond;
+    std::vector<std::shared_ptr<CallbackPrefetch>> mPrefetches;
+    std::chrono::nanoseconds mPrefetchInterval{};
+    bool mPrefetcherQuit{false};
+
+    /* Set for a loopback device rendering offline, which keeps the output
+     * independent of how long each mix takes.
+     */
+    bool mOfflineRender{false};
+
+    /* Set to convert buffer data on load to the mixer's float layout. */
+    bool mConvertBuffers{false};
+
+    /* Set to share buffer data with other buffers holding the same samples. */
+    bool mShareBuffers{false};
+
     enum class OutputMode1 : ALCenum {
         Any = ALC_ANY_SOFT,
         Mono = ALC_MONO_SOFT,
@@ -128,6 +200,14 @@ struct ALCdevice : public al::intrusive_ref<ALCdevice>, DeviceBase {
     std::mutex FilterLock;
     std::vector<FilterSubList> FilterList;
 
+    /* Effect states the mixer has released, kept for reuse so changing a
+     * slot's effect type doesn't need to allocate a new state (and its delay
+     * lines). Up to EffectStatePoolSize states are kept for each type.
+     */
+    std::mutex EffectStatePoolLock;
+    std::vector<al::intrusive_ptr<EffectState>> EffectStatePool;
+    uint EffectStatePoolSize{2};
+
 #ifdef ALSOFT_EAX
     ALuint eax_x_ram_free_size{eax_x_ram_max_size};
 #endif // ALSOFT_EAX
@@ -138,6 +218,19 @@ struct ALCdevice : public al::intrusive_ref<ALCdevice>, DeviceBase {
 
     void enumerateHrtfs();
 
+    /**
+     * Takes a released state from the pool that was created by the given
+     * factory and can apply the given properties, or returns null if there
+     * isn't one. The state still needs a deviceUpdate before use.
+     */
+    al::intrusive_ptr<EffectState> takeEffectState(EffectStateFactory *factory,
+        const EffectProps &props);
+    /**
+     * Puts a released state in the pool, or deletes it if the pool has enough
+     * of its type. Takes the caller's (last) reference.
+     */
+    void recycleEffectState(EffectState *state);
+
     bool getConfigValueBool(const char *block, const char *key, bool def)
     { return GetConfigValueBool(DeviceName.c_str(), block, key, def); }
 
@@ -26,6 +26,10 @@
 #include <iterator>
 #include <utility>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#endif
+
 #include "alc/effects/base.h"
 #include "almalloc.h"
 #include "alnumbers.h"
@@ -48,6 +52,9 @@ constexpr float MinFreq{20.0f};
 constexpr float MaxFreq{2500.0f};
 constexpr float QFactor{5.0f};
 
+/* The number of channels filtered together. */
+constexpr size_t MaxBatch{4};
+
 struct AutowahState final : public EffectState {
     /* Effect parameters */
     float mAttackRate;
@@ -58,11 +65,15 @@ struct AutowahState final : public EffectState {
     float mBandwidthNorm;
     float mEnvDelay;
 
-    /* Filter components derived from the envelope. */
+    /* Filter coefficients derived from the envelope, normalized by a0. A
+     * peaking filter's b1 and a1 coefficients are the same.
+     */
     struct {
-        float cos_w0;
-        float alpha;
-    } mEnv[BufferLineSize];
+        alignas(16) float b0[BufferLineSize];
+        alignas(16) float b1[BufferLineSize];
+        alignas(16) float b2[BufferLineSize];
+        alignas(16) float a2[BufferLineSize];
+    } mEnv;
 
     struct {
         uint mTargetChannel{InvalidChannelIndex};
@@ -78,7 +89,7 @@ struct AutowahState final : public EffectState {
     } mChans[MaxAmbiChannels];
 
     /* Effects buffers */
-    alignas(16) float mBufferOut[BufferLineSize];
+    alignas(16) float mBufferOut[MaxBatch][BufferLineSize];
 
 
     void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) override;
@@ -102,11 +113,7 @@ void AutowahState::deviceUpdate(const DeviceBase*, const BufferStorage*)
     mBandwidthNorm = 0.05f;
     mEnvDelay      = 0.0f;
 
-    for(auto &e : mEnv)
-    {
-        e.cos_w0 = 0.0f;
-        e.alpha = 0.0f;
-    }
+    mEnv = {};
 
     for(auto &chan : mChans)
     {
@@ -121,7 +128,7 @@ void AutowahState::update(const ContextBase *context, const EffectSlot *slot,
     const EffectProps *props, const EffectTarget target)
 {
     const DeviceBase *device{context->mDevice};
-    const auto frequency = static_cast<float>(device->Frequency);
+    const auto frequency = static_cast<float>(device->MixFrequency);
 
     const float ReleaseTime{clampf(props->Autowah.ReleaseTime, 0.001f, 1.0f)};
 
@@ -155,69 +162,182 @@ void AutowahState::process(const size_t samplesToDo,
     float env_delay{mEnvDelay};
     for(size_t i{0u};i < samplesToDo;i++)
     {
-        float w0, sample, a;
-
         /* Envelope follower described on the book: Audio Effects, Theory,
          * Implementation and Application.
          */
-        sample = peak_gain * std::fabs(samplesIn[0][i]);
-        a = (sample > env_delay) ? attack_rate : release_rate;
+        const float sample{peak_gain * std::fabs(samplesIn[0][i])};
+        const float a{(sample > env_delay) ? attack_rate : release_rate};
         env_delay = lerpf(sample, env_delay, a);
 
-        /* Calculate the cos and alpha components for this sample's filter. */
-        w0 = minf((bandwidth*env_delay + freq_min), 0.46f) * (al::numbers::pi_v<float>*2.0f);
-        mEnv[i].cos_w0 = std::cos(w0);
-        mEnv[i].alpha = std::sin(w0)/(2.0f * QFactor);
+        /* Store the filter's angular frequency for this sample, to calculate
+         * the coefficients from after.
+         */
+        mEnv.b0[i] = minf((bandwidth*env_delay + freq_min), 0.46f)
+            * (al::numbers::pi_v<float>*2.0f);
     }
     mEnvDelay = env_delay;
 
-    auto chandata = std::begin(mChans);
-    for(const auto &insamples : samplesIn)
+    /* This effectively inlines BiquadFilter_setParams for a peaking filter,
+     * for each sample. Since they only depend on the envelope, they're
+     * calculated once for all channels.
+     */
+    size_t pos{0u};
+#ifdef HAVE_SSE_INTRINSICS
     {
-        const size_t outidx{chandata->mTargetChannel};
-        if(outidx == InvalidChannelIndex)
+        /* w0 is within (0,0.92pi], so offsetting it by -pi/2 puts it within
+         * [-pi/2,pi/2), where short polynomials approximate the sine and
+         * cosine well. cos(w0) is then -sin(x), and sin(w0) is cos(x).
+         */
+        const __m128 halfpi4{_mm_set1_ps(al::numbers::pi_v<float>*0.5f)};
+        const __m128 one4{_mm_set1_ps(1.0f)};
+        const __m128 two4{_mm_set1_ps(2.0f)};
+        const __m128 res4{_mm_set1_ps(res_gain)};
+        const __m128 q2{_mm_set1_ps(2.0f * QFactor)};
+        for(;samplesToDo-pos >= 4;pos += 4)
         {
-            ++chandata;
-            continue;
+            const __m128 x{_mm_sub_ps(_mm_load_ps(&mEnv.b0[pos]), halfpi4)};
+            const __m128 x2{_mm_mul_ps(x, x)};
+
+            __m128 sinx{_mm_set1_ps(-1.0f/39916800.0f)};
+            sinx = _mm_add_ps(_mm_mul_ps(sinx, x2), _mm_set1_ps(1.0f/362880.0f));
+            sinx = _mm_add_ps(_mm_mul_ps(sinx, x2), _mm_set1_ps(-1.0f/5040.0f));
+            sinx = _mm_add_ps(_mm_mul_ps(sinx, x2), _mm_set1_ps(1.0f/120.0f));
+            sinx = _mm_add_ps(_mm_mul_ps(sinx, x2), _mm_set1_ps(-1.0f/6.0f));
+            sinx = _mm_add_ps(_mm_mul_ps(sinx, x2), one4);
+            sinx = _mm_mul_ps(sinx, x);
+
+            __m128 cosx{_mm_set1_ps(1.0f/479001600.0f)};
+            cosx = _mm_add_ps(_mm_mul_ps(cosx, x2), _mm_set1_ps(-1.0f/3628800.0f));
+            cosx = _mm_add_ps(_mm_mul_ps(cosx, x2), _mm_set1_ps(1.0f/40320.0f));
+            cosx = _mm_add_ps(_mm_mul_ps(cosx, x2), _mm_set1_ps(-1.0f/720.0f));
+            cosx = _mm_add_ps(_mm_mul_ps(cosx, x2), _mm_set1_ps(1.0f/24.0f));
+            cosx = _mm_add_ps(_mm_mul_ps(cosx, x2), _mm_set1_ps(-1.0f/2.0f));
+            cosx = _mm_add_ps(_mm_mul_ps(cosx, x2), one4);
+
+            const __m128 alpha{_mm_div_ps(cosx, q2)};
+            const __m128 a0{_mm_add_ps(one4, _mm_div_ps(alpha, res4))};
+            const __m128 alpha_res{_mm_mul_ps(alpha, res4)};
+            _mm_store_ps(&mEnv.b0[pos], _mm_div_ps(_mm_add_ps(one4, alpha_res), a0));
+            _mm_store_ps(&mEnv.b1[pos], _mm_div_ps(_mm_mul_ps(two4, sinx), a0));
+            _mm_store_ps(&mEnv.b2[pos], _mm_div_ps(_mm_sub_ps(one4, alpha_res), a0));
+            _mm_store_ps(&mEnv.a2[pos],
+                _mm_div_ps(_mm_sub_ps(one4, _mm_div_ps(alpha, res4)), a0));
         }
+    }
+#endif
+    for(;pos < samplesToDo;++pos)
+    {
+        const float w0{mEnv.b0[pos]};
+        const float cos_w0{std::cos(w0)};
+        const float alpha{std::sin(w0)/(2.0f * QFactor)};
+        const float a0{1.0f + alpha/res_gain};
+
+        mEnv.b0[pos] = (1.0f + alpha*res_gain) / a0;
+        mEnv.b1[pos] = (-2.0f * cos_w0) / a0;
+        mEnv.b2[pos] = (1.0f - alpha*res_gain) / a0;
+        mEnv.a2[pos] = (1.0f - alpha/res_gain) / a0;
+    }
 
-        /* This effectively inlines BiquadFilter_setParams for a peaking
-         * filter and BiquadFilter_processC. The alpha and cosine components
-         * for the filter coefficients were previously calculated with the
-         * envelope. Because the filter changes for each sample, the
-         * coefficients are transient and don't need to be held.
+    /* Filter a batch of channels with the transient coefficients, then mix
+     * the results to the output.
+     */
+    std::array<size_t,MaxBatch> chanidx{};
+    size_t count{0};
+    auto flush_batch = [&,this]()
+    {
+        auto process_sample = [this](const size_t i, const float input, float &z1, float &z2)
+            noexcept -> float
+        {
+            const float output{input*mEnv.b0[i] + z1};
+            z1 = input*mEnv.b1[i] - output*mEnv.b1[i] + z2;
+            z2 = input*mEnv.b2[i] - output*mEnv.a2[i];
+            return output;
+        };
+
+        size_t i{0u};
+#ifdef HAVE_SSE_INTRINSICS
+        /* Each channel gets a lane of the vectors, processing 4 samples of
+         * each channel at a time by transposing them so each vector holds one
+         * sample from each channel. Unused lanes process the first channel's
+         * input again.
          */
-        float z1{chandata->mFilter.z1};
-        float z2{chandata->mFilter.z2};
+        alignas(16) std::array<std::array<float,MaxBatch>,2> history{};
+        std::array<const float*,MaxBatch> src{};
+        std::fill(src.begin(), src.end(), samplesIn[chanidx[0]].data());
+        for(size_t c{0};c < count;++c)
+        {
+            history[0][c] = mChans[chanidx[c]].mFilter.z1;
+            history[1][c] = mChans[chanidx[c]].mFilter.z2;
+            src[c] = samplesIn[chanidx[c]].data();
+        }
+
+        __m128 z1{_mm_load_ps(history[0].data())};
+        __m128 z2{_mm_load_ps(history[1].data())};
+        auto process_vec = [this,&z1,&z2](const size_t idx, const __m128 input) noexcept
+            -> __m128
+        {
+            const __m128 b0{_mm_set1_ps(mEnv.b0[idx])};
+            const __m128 b1{_mm_set1_ps(mEnv.b1[idx])};
+            const __m128 b2{_mm_set1_ps(mEnv.b2[idx])};
+            const __m128 a2{_mm_set1_ps(mEnv.a2[idx])};
+            const __m128 output{_mm_add_ps(_mm_mul_ps(input, b0), z1)};
+            z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(input, b1), _mm_mul_ps(output, b1)), z2);
+            z2 = _mm_sub_ps(_mm_mul_ps(input, b2), _mm_mul_ps(output, a2));
+            return output;
+        };
+        for(;samplesToDo-i >= 4;i += 4)
+        {
+            __m128 s0{_mm_loadu_ps(src[0]+i)};
+            __m128 s1{_mm_loadu_ps(src[1]+i)};
+            __m128 s2{_mm_loadu_ps(src[2]+i)};
+            __m128 s3{_mm_loadu_ps(src[3]+i)};
+            _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+            s0 = process_vec(i, s0);
+            s1 = process_vec(i+1, s1);
+            s2 = process_vec(i+2, s2);
+            s3 = process_vec(i+3, s3);
+            _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+            const __m128 out[MaxBatch]{s0, s1, s2, s3};
+            for(size_t c{0};c < count;++c)
+                _mm_store_ps(&mBufferOut[c][i], out[c]);
+        }
+        _mm_store_ps(history[0].data(), z1);
+        _mm_store_ps(history[1].data(), z2);
+        for(size_t c{0};c < count;++c)
+        {
+            mChans[chanidx[c]].mFilter.z1 = history[0][c];
+            mChans[chanidx[c]].mFilter.z2 = history[1][c];
+        }
+#endif
 
-        for(size_t i{0u};i < samplesToDo;i++)
+        for(size_t c{0};c < count;++c)
         {
-            const float alpha{mEnv[i].alpha};
-            const float cos_w0{mEnv[i].cos_w0};
-            float input, output;
-            float a[3], b[3];
-
-            b[0] =  1.0f + alpha*res_gain;
-            b[1] = -2.0f * cos_w0;
-            b[2] =  1.0f - alpha*res_gain;
-            a[0] =  1.0f + alpha/res_gain;
-            a[1] = -2.0f * cos_w0;
-            a[2] =  1.0f - alpha/res_gain;
-
-            input = insamples[i];
-            output = input*(b[0]/a[0]) + z1;
-            z1 = input*(b[1]/a[0]) - output*(a[1]/a[0]) + z2;
-            z2 = input*(b[2]/a[0]) - output*(a[2]/a[0]);
-            mBufferOut[i] = output;
+            auto &chandata = mChans[chanidx[c]];
+            const float *RESTRICT insamples{samplesIn[chanidx[c]].data()};
+            float z1s{chandata.mFilter.z1}, z2s{chandata.mFilter.z2};
+            for(size_t j{i};j < samplesToDo;++j)
+                mBufferOut[c][j] = process_sample(j, insamples[j], z1s, z2s);
+            chandata.mFilter.z1 = z1s;
+            chandata.mFilter.z2 = z2s;
+
+            /* Now, mix the processed sound data to the output. */
+            MixSamples({mBufferOut[c], samplesToDo}, samplesOut[chandata.mTargetChannel].data(),
+                chandata.mCurrentGain, chandata.mTargetGain, samplesToDo);
         }
-        chandata->mFilter.z1 = z1;
-        chandata->mFilter.z2 = z2;
+        count = 0;
+    };
+
+    for(size_t c{0};c < samplesIn.size();++c)
+    {
+        if(mChans[c].mTargetChannel == InvalidChannelIndex)
+            continue;
 
-        /* Now, mix the processed sound data to the output. */
-        MixSamples({mBufferOut, samplesToDo}, samplesOut[outidx].data(), chandata->mCurrentGain,
-            chandata->mTargetGain, samplesToDo);
-        ++chandata;
+        chanidx[count] = c;
+        if(++count == MaxBatch)
+            flush_batch();
     }
+    if(count > 0)
+        flush_batch();
 }
 
 
@@ -27,6 +27,10 @@
 #include <iterator>
 #include <vector>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <emmintrin.h>
+#endif
+
 #include "alc/effects/base.h"
 #include "almalloc.h"
 #include "alnumbers.h"
@@ -34,6 +38,7 @@
 #include "alspan.h"
 #include "core/bufferline.h"
 #include "core/context.h"
+#include "core/cubic_tables.h"
 #include "core/devformat.h"
 #include "core/device.h"
 #include "core/effectslot.h"
@@ -48,6 +53,104 @@ namespace {
 
 using uint = unsigned int;
 
+constexpr uint CubicPhaseDiffBits{MixerFracBits - CubicPhaseBits};
+constexpr uint CubicPhaseDiffOne{1 << CubicPhaseDiffBits};
+constexpr uint CubicPhaseDiffMask{CubicPhaseDiffOne - 1u};
+
+/* Extra samples at the end of the delay buffer, mirroring the start, so the
+ * cubic taps can always read four contiguous samples.
+ */
+constexpr size_t DelayPadding{3};
+
+
+/* Generates count samples of the triangle LFO, starting at the given offset
+ * in the cycle.
+ */
+void GenTriangleLfo(uint *RESTRICT dst, uint offset, const size_t count, const float lfo_scale,
+    const float depth, const int delay)
+{
+    auto gen_lfo = [lfo_scale,depth,delay](const uint off) -> uint
+    {
+        const float offset_norm{static_cast<float>(off) * lfo_scale};
+        return static_cast<uint>(fastf2i((1.0f-std::abs(2.0f-offset_norm)) * depth) + delay);
+    };
+
+    size_t i{0};
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 scale4{_mm_set1_ps(lfo_scale)};
+    const __m128 depth4{_mm_set1_ps(depth)};
+    const __m128 two4{_mm_set1_ps(2.0f)};
+    const __m128 one4{_mm_set1_ps(1.0f)};
+    const __m128 absmask{_mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))};
+    const __m128i delay4{_mm_set1_epi32(delay)};
+    __m128 offset4{_mm_setr_ps(static_cast<float>(offset), static_cast<float>(offset+1),
+        static_cast<float>(offset+2), static_cast<float>(offset+3))};
+    for(;count-i >= 4;i += 4)
+    {
+        const __m128 offset_norm{_mm_mul_ps(offset4, scale4)};
+        const __m128 tri{_mm_sub_ps(one4, _mm_and_ps(_mm_sub_ps(two4, offset_norm), absmask))};
+        const __m128i lfo{_mm_add_epi32(_mm_cvtps_epi32(_mm_mul_ps(tri, depth4)), delay4)};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), lfo);
+        offset4 = _mm_add_ps(offset4, _mm_set1_ps(4.0f));
+    }
+    offset += static_cast<uint>(i);
+#endif
+    for(;i < count;++i)
+        dst[i] = gen_lfo(offset++);
+}
+
+/* Generates count samples of the sinusoid LFO, starting at the given offset
+ * in the cycle.
+ */
+void GenSinusoidLfo(uint *RESTRICT dst, uint offset, const size_t count, const float lfo_scale,
+    const float depth, const int delay)
+{
+    auto gen_lfo = [lfo_scale,depth,delay](const uint off) -> uint
+    {
+        const float offset_norm{static_cast<float>(off) * lfo_scale};
+        return static_cast<uint>(fastf2i(std::sin(offset_norm)*depth) + delay);
+    };
+
+    size_t i{0};
+#ifdef HAVE_SSE_INTRINSICS
+    /* The normalized offset is within [0,2pi). Shifting it to [-pi,pi)
+     * negates the result, and folding the magnitude to [0,pi/2] lets a short
+     * odd polynomial approximate the sine well within the precision of the
+     * delay.
+     */
+    const __m128 scale4{_mm_set1_ps(lfo_scale)};
+    const __m128 ndepth4{_mm_set1_ps(-depth)};
+    const __m128 pi4{_mm_set1_ps(al::numbers::pi_v<float>)};
+    const __m128 signmask{_mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u)))};
+    const __m128i delay4{_mm_set1_epi32(delay)};
+    __m128 offset4{_mm_setr_ps(static_cast<float>(offset), static_cast<float>(offset+1),
+        static_cast<float>(offset+2), static_cast<float>(offset+3))};
+    for(;count-i >= 4;i += 4)
+    {
+        const __m128 phase{_mm_sub_ps(_mm_mul_ps(offset4, scale4), pi4)};
+        const __m128 sign{_mm_and_ps(phase, signmask)};
+        const __m128 absphase{_mm_andnot_ps(signmask, phase)};
+        const __m128 x{_mm_min_ps(absphase, _mm_sub_ps(pi4, absphase))};
+        const __m128 x2{_mm_mul_ps(x, x)};
+
+        __m128 poly{_mm_set1_ps(-1.0f/39916800.0f)};
+        poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(1.0f/362880.0f));
+        poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(-1.0f/5040.0f));
+        poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(1.0f/120.0f));
+        poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(-1.0f/6.0f));
+        poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(1.0f));
+        const __m128 sine{_mm_xor_ps(_mm_mul_ps(poly, x), sign)};
+
+        const __m128i lfo{_mm_add_epi32(_mm_cvtps_epi32(_mm_mul_ps(sine, ndepth4)), delay4)};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), lfo);
+        offset4 = _mm_add_ps(offset4, _mm_set1_ps(4.0f));
+    }
+    offset += static_cast<uint>(i);
+#endif
+    for(;i < count;++i)
+        dst[i] = gen_lfo(offset++);
+}
+
 struct ChorusState final : public EffectState {
     std::vector<float> mDelayBuffer;
     uint mOffset{0};
@@ -75,9 +178,10 @@ struct ChorusState final : public EffectState {
     float mDepth{0.0f};
     float mFeedback{0.0f};
 
-    void calcTriangleDelays(const size_t todo);
-    void calcSinusoidDelays(const size_t todo);
+    template<typename T>
+    void calcDelays(const size_t todo, T gen_lfo);
 
+    uint inputOrder() const noexcept override { return 0; }
     void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
         const EffectTarget target) override;
@@ -91,10 +195,12 @@ void ChorusState::deviceUpdate(const DeviceBase *Device, const BufferStorage*)
 {
     constexpr float max_delay{maxf(ChorusMaxDelay, FlangerMaxDelay)};
 
-    const auto frequency = static_cast<float>(Device->Frequency);
+    const auto frequency = static_cast<float>(Device->MixFrequency);
     const size_t maxlen{NextPowerOf2(float2uint(max_delay*2.0f*frequency) + 1u)};
-    if(maxlen != mDelayBuffer.size())
-        decltype(mDelayBuffer)(maxlen).swap(mDelayBuffer);
+    if(maxlen+DelayPadding != mDelayBuffer.size())
+        decltype(mDelayBuffer)(maxlen+DelayPadding).swap(mDelayBuffer);
+    mMemory.set(Device->mMemoryStats, MemCategory::Effects,
+        mDelayBuffer.capacity()*sizeof(float));
 
     std::fill(mDelayBuffer.begin(), mDelayBuffer.end(), 0.0f);
     for(auto &e : mGains)
@@ -113,7 +219,7 @@ void ChorusState::update(const ContextBase *Context, const EffectSlot *Slot,
      * delay and depth to allow enough padding for resampling.
      */
     const DeviceBase *device{Context->mDevice};
-    const auto frequency = static_cast<float>(device->Frequency);
+    const auto frequency = static_cast<float>(device->MixFrequency);
 
     mWaveform = props->Chorus.Waveform;
 
@@ -171,7 +277,8 @@ void ChorusState::update(const ContextBase *Context, const EffectSlot *Slot,
 }
 
 
-void ChorusState::calcTriangleDelays(const size_t todo)
+template<typename T>
+void ChorusState::calcDelays(const size_t todo, T gen_lfo)
 {
     const uint lfo_range{mLfoRange};
     const float lfo_scale{mLfoScale};
@@ -181,19 +288,13 @@ void ChorusState::calcTriangleDelays(const size_t todo)
     ASSUME(lfo_range > 0);
     ASSUME(todo > 0);
 
-    auto gen_lfo = [lfo_scale,depth,delay](const uint offset) -> uint
-    {
-        const float offset_norm{static_cast<float>(offset) * lfo_scale};
-        return static_cast<uint>(fastf2i((1.0f-std::abs(2.0f-offset_norm)) * depth) + delay);
-    };
-
     uint offset{mLfoOffset};
     for(size_t i{0};i < todo;)
     {
-        size_t rem{minz(todo-i, lfo_range-offset)};
-        do {
-            mModDelays[0][i++] = gen_lfo(offset++);
-        } while(--rem);
+        const size_t rem{minz(todo-i, lfo_range-offset)};
+        gen_lfo(&mModDelays[0][i], offset, rem, lfo_scale, depth, delay);
+        i += rem;
+        offset += static_cast<uint>(rem);
         if(offset == lfo_range)
             offset = 0;
     }
@@ -201,51 +302,10 @@ void ChorusState::calcTriangleDelays(const size_t todo)
     offset = (mLfoOffset+mLfoDisp) % lfo_range;
     for(size_t i{0};i < todo;)
     {
-        size_t rem{minz(todo-i, lfo_range-offset)};
-        do {
-            mModDelays[1][i++] = gen_lfo(offset++);
-        } while(--rem);
-        if(offset == lfo_range)
-            offset = 0;
-    }
-
-    mLfoOffset = static_cast<uint>(mLfoOffset+todo) % lfo_range;
-}
-
-void ChorusState::calcSinusoidDelays(const size_t todo)
-{
-    const uint lfo_range{mLfoRange};
-    const float lfo_scale{mLfoScale};
-    const float depth{mDepth};
-    const int delay{mDelay};
-
-    ASSUME(lfo_range > 0);
-    ASSUME(todo > 0);
-
-    auto gen_lfo = [lfo_scale,depth,delay](const uint offset) -> uint
-    {
-        const float offset_norm{static_cast<float>(offset) * lfo_scale};
-        return static_cast<uint>(fastf2i(std::sin(offset_norm)*depth) + delay);
-    };
-
-    uint offset{mLfoOffset};
-    for(size_t i{0};i < todo;)
-    {
-        size_t rem{minz(todo-i, lfo_range-offset)};
-        do {
-            mModDelays[0][i++] = gen_lfo(offset++);
-        } while(--rem);
-        if(offset == lfo_range)
-            offset = 0;
-    }
-
-    offset = (mLfoOffset+mLfoDisp) % lfo_range;
-    for(size_t i{0};i < todo;)
-    {
-        size_t rem{minz(todo-i, lfo_range-offset)};
-        do {
-            mModDelays[1][i++] = gen_lfo(offset++);
-        } while(--rem);
+        const size_t rem{minz(todo-i, lfo_range-offset)};
+        gen_lfo(&mModDelays[1][i], offset, rem, lfo_scale, depth, delay);
+        i += rem;
+        offset += static_cast<uint>(rem);
         if(offset == lfo_range)
             offset = 0;
     }
@@ -255,49 +315,91 @@ void ChorusState::calcSinusoidDelays(const size_t todo)
 
 void ChorusState::process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
 {
-    const size_t bufmask{mDelayBuffer.size()-1};
+    const size_t bufmask{mDelayBuffer.size()-DelayPadding-1};
     const float feedback{mFeedback};
     const uint avgdelay{(static_cast<uint>(mDelay) + MixerFracHalf) >> MixerFracBits};
     float *RESTRICT delaybuf{mDelayBuffer.data()};
     uint offset{mOffset};
 
     if(mWaveform == ChorusWaveform::Sinusoid)
-        calcSinusoidDelays(samplesToDo);
+        calcDelays(samplesToDo, GenSinusoidLfo);
     else /*if(mWaveform == ChorusWaveform::Triangle)*/
-        calcTriangleDelays(samplesToDo);
+        calcDelays(samplesToDo, GenTriangleLfo);
+
+    /* Feed the input to the delay buffer, accumulating feedback from the
+     * average delay of the taps. The taps are always delayed by at least half
+     * the resampler padding (see update), so they only read samples that are
+     * already complete and this can be done for the whole update first.
+     */
+    for(size_t i{0u};i < samplesToDo;++i)
+    {
+        delaybuf[offset&bufmask] = samplesIn[0][i]
+            + delaybuf[(offset-avgdelay) & bufmask]*feedback;
+        ++offset;
+    }
+    std::copy_n(delaybuf, DelayPadding, delaybuf+bufmask+1);
+    offset = mOffset;
 
+    /* Each tap reads the four samples around its delayed position, and uses
+     * the same cubic spline filter as the resampler. The delay is subtracted
+     * from the current position, so the position's fraction is the delay's
+     * fraction negated.
+     */
+    const CubicCoefficients *RESTRICT filter{al::assume_aligned<16>(gCubicSpline.Tab.data())};
     const uint *RESTRICT ldelays{mModDelays[0]};
     const uint *RESTRICT rdelays{mModDelays[1]};
     float *RESTRICT lbuffer{al::assume_aligned<16>(mBuffer[0])};
     float *RESTRICT rbuffer{al::assume_aligned<16>(mBuffer[1])};
+    auto get_pos = [offset,bufmask](const size_t i, const uint delay) noexcept -> size_t
+    { return (offset + i - ((delay+MixerFracMask)>>MixerFracBits) - 1) & bufmask; };
+#ifdef HAVE_SSE_INTRINSICS
+    auto get_filter = [filter](const uint delay) noexcept -> __m128
+    {
+        const uint frac{(0u-delay) & MixerFracMask};
+        const uint pi{frac >> CubicPhaseDiffBits};
+        const float pf{static_cast<float>(frac&CubicPhaseDiffMask) * (1.0f/CubicPhaseDiffOne)};
+        return _mm_add_ps(_mm_load_ps(filter[pi].mCoeffs),
+            _mm_mul_ps(_mm_set1_ps(pf), _mm_load_ps(filter[pi].mDeltas)));
+    };
     for(size_t i{0u};i < samplesToDo;++i)
     {
-        // Feed the buffer's input first (necessary for delays < 1).
-        delaybuf[offset&bufmask] = samplesIn[0][i];
-
-        // Tap for the left output.
-        uint delay{offset - (ldelays[i]>>MixerFracBits)};
-        float mu{static_cast<float>(ldelays[i]&MixerFracMask) * (1.0f/MixerFracOne)};
-        lbuffer[i] = cubic(delaybuf[(delay+1) & bufmask], delaybuf[(delay  ) & bufmask],
-            delaybuf[(delay-1) & bufmask], delaybuf[(delay-2) & bufmask], mu);
-
-        // Tap for the right output.
-        delay = offset - (rdelays[i]>>MixerFracBits);
-        mu = static_cast<float>(rdelays[i]&MixerFracMask) * (1.0f/MixerFracOne);
-        rbuffer[i] = cubic(delaybuf[(delay+1) & bufmask], delaybuf[(delay  ) & bufmask],
-            delaybuf[(delay-1) & bufmask], delaybuf[(delay-2) & bufmask], mu);
-
-        // Accumulate feedback from the average delay of the taps.
-        delaybuf[offset&bufmask] += delaybuf[(offset-avgdelay) & bufmask] * feedback;
-        ++offset;
+        const __m128 l4{_mm_mul_ps(get_filter(ldelays[i]),
+            _mm_loadu_ps(&delaybuf[get_pos(i, ldelays[i])]))};
+        const __m128 r4{_mm_mul_ps(get_filter(rdelays[i]),
+            _mm_loadu_ps(&delaybuf[get_pos(i, rdelays[i])]))};
+
+        /* Sum the left and right taps together. */
+        __m128 lr{_mm_add_ps(_mm_unpacklo_ps(l4, r4), _mm_unpackhi_ps(l4, r4))};
+        lr = _mm_add_ps(lr, _mm_movehl_ps(lr, lr));
+        lbuffer[i] = _mm_cvtss_f32(lr);
+        rbuffer[i] = _mm_cvtss_f32(_mm_shuffle_ps(lr, lr, _MM_SHUFFLE(1, 1, 1, 1)));
+    }
+#else
+    auto do_tap = [filter,delaybuf](const size_t pos, const uint delay) noexcept -> float
+    {
+        const uint frac{(0u-delay) & MixerFracMask};
+        const uint pi{frac >> CubicPhaseDiffBits};
+        const float pf{static_cast<float>(frac&CubicPhaseDiffMask) * (1.0f/CubicPhaseDiffOne)};
+        const CubicCoefficients &coeffs = filter[pi];
+        const float *RESTRICT src{&delaybuf[pos]};
+        return (coeffs.mCoeffs[0] + pf*coeffs.mDeltas[0])*src[0]
+            + (coeffs.mCoeffs[1] + pf*coeffs.mDeltas[1])*src[1]
+            + (coeffs.mCoeffs[2] + pf*coeffs.mDeltas[2])*src[2]
+            + (coeffs.mCoeffs[3] + pf*coeffs.mDeltas[3])*src[3];
+    };
+    for(size_t i{0u};i < samplesToDo;++i)
+    {
+        lbuffer[i] = do_tap(get_pos(i, ldelays[i]), ldelays[i]);
+        rbuffer[i] = do_tap(get_pos(i, rdelays[i]), rdelays[i]);
     }
+#endif
 
     MixSamples({lbuffer, samplesToDo}, samplesOut, mGains[0].Current, mGains[0].Target,
         samplesToDo, 0);
     MixSamples({rbuffer, samplesToDo}, samplesOut, mGains[1].Current, mGains[1].Target,
         samplesToDo, 0);
 
-    mOffset = offset;
+    mOffset = offset + static_cast<uint>(samplesToDo);
 }
 
 
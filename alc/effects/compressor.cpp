@@ -37,6 +37,10 @@
 #include <iterator>
 #include <utility>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#endif
+
 #include "alc/effects/base.h"
 #include "almalloc.h"
 #include "alnumeric.h"
@@ -90,8 +94,8 @@ void CompressorState::deviceUpdate(const DeviceBase *device, const BufferStorage
     /* Number of samples to do a full attack and release (non-integer sample
      * counts are okay).
      */
-    const float attackCount{static_cast<float>(device->Frequency) * ATTACK_TIME};
-    const float releaseCount{static_cast<float>(device->Frequency) * RELEASE_TIME};
+    const float attackCount{static_cast<float>(device->MixFrequency) * ATTACK_TIME};
+    const float releaseCount{static_cast<float>(device->MixFrequency) * RELEASE_TIME};
 
     /* Calculate per-sample multipliers to attack and release at the desired
      * rates.
@@ -119,29 +123,29 @@ void CompressorState::process(const size_t samplesToDo,
 {
     for(size_t base{0u};base < samplesToDo;)
     {
-        float gains[256];
+        alignas(16) float gains[256];
         const size_t td{minz(256, samplesToDo-base)};
 
         /* Generate the per-sample gains from the signal envelope. */
         float env{mEnvFollower};
         if(mEnabled)
         {
+            /* Clamp the absolute amplitude to the defined envelope limits
+             * first, which doesn't depend on the envelope.
+             */
+            const float *RESTRICT src{samplesIn[0].data() + base};
+            for(size_t i{0u};i < td;++i)
+                gains[i] = clampf(std::fabs(src[i]), AMP_ENVELOPE_MIN, AMP_ENVELOPE_MAX);
+
             for(size_t i{0u};i < td;++i)
             {
-                /* Clamp the absolute amplitude to the defined envelope limits,
-                 * then attack or release the envelope to reach it.
-                 */
-                const float amplitude{clampf(std::fabs(samplesIn[0][base+i]), AMP_ENVELOPE_MIN,
-                    AMP_ENVELOPE_MAX)};
+                /* Attack or release the envelope to reach the amplitude. */
+                const float amplitude{gains[i]};
                 if(amplitude > env)
                     env = minf(env*mAttackMult, amplitude);
                 else if(amplitude < env)
                     env = maxf(env*mReleaseMult, amplitude);
-
-                /* Apply the reciprocal of the envelope to normalize the volume
-                 * (compress the dynamic range).
-                 */
-                gains[i] = 1.0f / env;
+                gains[i] = env;
             }
         }
         else
@@ -157,27 +161,46 @@ void CompressorState::process(const size_t samplesToDo,
                     env = minf(env*mAttackMult, amplitude);
                 else if(amplitude < env)
                     env = maxf(env*mReleaseMult, amplitude);
-
-                gains[i] = 1.0f / env;
+                gains[i] = env;
             }
         }
         mEnvFollower = env;
 
+        /* Apply the reciprocal of the envelope to normalize the volume
+         * (compress the dynamic range). This is kept out of the envelope loop
+         * so the divisions don't hold up the envelope's dependency chain.
+         */
+        size_t pos{0u};
+#ifdef HAVE_SSE_INTRINSICS
+        const __m128 one4{_mm_set1_ps(1.0f)};
+        for(;td-pos >= 4;pos += 4)
+            _mm_store_ps(gains+pos, _mm_div_ps(one4, _mm_load_ps(gains+pos)));
+#endif
+        for(;pos < td;++pos)
+            gains[pos] = 1.0f / gains[pos];
+
         /* Now compress the signal amplitude to output. */
         auto chan = std::cbegin(mChans);
         for(const auto &input : samplesIn)
         {
             const size_t outidx{chan->mTarget};
-            if(outidx != InvalidChannelIndex)
+            const float gain{chan->mGain};
+            if(outidx != InvalidChannelIndex && std::fabs(gain) > GainSilenceThreshold)
             {
                 const float *RESTRICT src{input.data() + base};
                 float *RESTRICT dst{samplesOut[outidx].data() + base};
-                const float gain{chan->mGain};
-                if(!(std::fabs(gain) > GainSilenceThreshold))
+                size_t i{0u};
+#ifdef HAVE_SSE_INTRINSICS
+                const __m128 gain4{_mm_set1_ps(gain)};
+                for(;td-i >= 4;i += 4)
                 {
-                    for(size_t i{0u};i < td;i++)
-                        dst[i] += src[i] * gains[i] * gain;
+                    const __m128 smp{_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(src+i),
+                        _mm_load_ps(gains+i)), gain4)};
+                    _mm_storeu_ps(dst+i, _mm_add_ps(_mm_loadu_ps(dst+i), smp));
                 }
+#endif
+                for(;i < td;i++)
+                    dst[i] += src[i] * gains[i] * gain;
             }
             ++chan;
         }
@@ -3,12 +3,15 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <complex>
 #include <cstddef>
+#include <exception>
 #include <functional>
 #include <iterator>
 #include <memory>
 #include <stdint.h>
+#include <thread>
 #include <utility>
 
 #ifdef HAVE_SSE_INTRINSICS
@@ -21,7 +24,9 @@
 #include "almalloc.h"
 #include "alnumbers.h"
 #include "alnumeric.h"
+#include "alsem.h"
 #include "alspan.h"
+#include "althrd_setname.h"
 #include "base.h"
 #include "core/ambidefs.h"
 #include "core/bufferline.h"
@@ -32,42 +37,73 @@
 #include "core/effectslot.h"
 #include "core/filters/splitter.h"
 #include "core/fmt_traits.h"
+#include "core/fpu_ctrl.h"
+#include "core/logging.h"
 #include "core/mixer.h"
 #include "intrusive_ptr.h"
 #include "polyphase_resampler.h"
 #include "vector.h"
 
+/* This is a user config option for processing the last stage of long impulse
+ * responses with a separate thread.
+ */
+bool ConvolutionTailThread{false};
+
 
 namespace {
 
 /* Convolution reverb is implemented using a segmented overlap-add method. The
- * impulse response is broken up into multiple segments of 128 samples, and
- * each segment has an FFT applied with a 256-sample buffer (the latter half
- * left silent) to get its frequency-domain response. The resulting response
- * has its positive/non-mirrored frequencies saved (129 bins) in each segment.
+ * impulse response is broken up into multiple segments of N samples, and each
+ * segment has an FFT applied with a 2N-sample buffer (the latter half left
+ * silent) to get its frequency-domain response. The resulting response has its
+ * positive/non-mirrored frequencies saved (N+1 bins) in each segment.
  *
- * Input samples are similarly broken up into 128-sample segments, with an FFT
- * applied to each new incoming segment to get its 129 bins. A history of FFT'd
+ * Input samples are similarly broken up into N-sample segments, with an FFT
+ * applied to each new incoming segment to get its N+1 bins. A history of FFT'd
  * input segments is maintained, equal to the length of the impulse response.
+ * Since the input and output are real, the FFTs are done with real FFTs, which
+ * are about half the cost of complex FFTs. The frequency-domain data is stored with separate arrays of real and
+ * imaginary values, making the convolution easier to vectorize.
  *
  * To apply the reverberation, each impulse response segment is convolved with
  * its paired input segment (using complex multiplies, far cheaper than FIRs),
- * accumulating into a 256-bin FFT buffer. The input history is then shifted to
+ * accumulating into a 2N-bin FFT buffer. The input history is then shifted to
  * align with later impulse response segments for next time.
  *
- * An inverse FFT is then applied to the accumulated FFT buffer to get a 256-
+ * An inverse FFT is then applied to the accumulated FFT buffer to get a 2N-
  * sample time-domain response for output, which is split in two halves. The
- * first half is the 128-sample output, and the second half is a 128-sample
- * (really, 127) delayed extension, which gets added to the output next time.
+ * first half is the N-sample output, and the second half is an N-sample
+ * (really, N-1) delayed extension, which gets added to the output next time.
  * Convolving two time-domain responses of lengths N and M results in a time-
  * domain signal of length N+M-1, and this holds true regardless of the
  * convolution being applied in the frequency domain, so these "overflow"
  * samples need to be accounted for.
  *
+ * The cost of each output sample grows with the number of segments, so using
+ * one small segment size for a long impulse response gets expensive. Instead,
+ * the response is split into a few stages with increasingly larger segments.
+ * The first stage uses 128-sample segments for the start of the response, and
+ * each following stage uses segments 4 times larger for a later part of the
+ * response, calculated 4 times less often. A stage with N-sample segments
+ * starts no earlier than N samples into the response, so its output is always
+ * ready by the time it's needed. Any remaining gap between when it's ready and
+ * when it's needed is handled by pairing its filter segments with older input
+ * segments from its history.
+ *
+ * Optionally, the last stage can be processed with a separate lower priority
+ * thread, so that long responses don't need a lot of processing time in the
+ * mixer. The stage is then placed at least two segments into the response,
+ * and each new input segment is handed off to the thread to be processed
+ * while the mixer plays the previous segment's output, giving the thread a
+ * full segment's worth of time to finish it. If the thread keeps missing that
+ * deadline, the mixer stops handing segments off and processes them itself,
+ * with the same double-buffering so the output doesn't change.
+ *
  * To avoid a delay with gathering enough input samples to apply an FFT with,
- * the first segment is applied directly in the time-domain as the samples come
- * in. Once enough have been retrieved, the FFT is applied on the input and
- * it's paired with the remaining (FFT'd) filter segments for processing.
+ * the first 128 samples are applied directly in the time-domain as the
+ * samples come in. Once enough have been retrieved, the FFT is applied on the
+ * input and it's paired with the remaining (FFT'd) filter segments for
+ * processing.
  */
 
 
@@ -81,6 +117,7 @@ void LoadSamples(float *RESTRICT dst, const std::byte *src, const size_t srcstep
     HANDLE_FMT(FmtShort);
     HANDLE_FMT(FmtFloat);
     HANDLE_FMT(FmtDouble);
+    HANDLE_FMT(FmtHalf);
     HANDLE_FMT(FmtMulaw);
     HANDLE_FMT(FmtAlaw);
     /* FIXME: Handle ADPCM decoding here. */
@@ -133,6 +170,18 @@ using complex_f = std::complex<float>;
 constexpr size_t ConvolveUpdateSize{256};
 constexpr size_t ConvolveUpdateSamples{ConvolveUpdateSize / 2};
 
+/* The segment sizes for each stage of the impulse response. Each needs to be a
+ * power of two, and a multiple of the previous. The FFTs are calculated with
+ * single-precision floats, so the largest size is limited to keep the
+ * rounding errors low.
+ */
+constexpr std::array<size_t,4> ConvolveStageSamples{{ConvolveUpdateSamples, 512, 2048, 8192}};
+
+/* The number of consecutive segments the tail thread can be late with, each
+ * mixed without the tail, before the mixer processes the tail stage itself.
+ */
+constexpr uint TailMissLimit{4};
+
 
 void apply_fir(al::span<float> dst, const float *RESTRICT src, const float *RESTRICT filter)
 {
@@ -180,6 +229,36 @@ void apply_fir(al::span<float> dst, const float *RESTRICT src, const float *REST
 #endif
 }
 
+} // namespace
+
+/* The frequency-domain filter prepared from an impulse response buffer for a
+ * given mix rate. It's read-only once prepared, so effects using the same
+ * buffer on the device share it.
+ */
+struct ConvolutionFilter {
+    uint64_t mSerial{0u};
+    uint mSampleRate{0u};
+
+    /* The segment size, number of filter segments, and number of extra
+     * (older) input segments to delay the output, for each stage.
+     */
+    struct StageLayout {
+        size_t mSegSamples{0};
+        size_t mNumSegs{0};
+        size_t mDelaySegs{0};
+    };
+    std::array<StageLayout,ConvolveStageSamples.size()> mStages{};
+    size_t mNumStages{0};
+
+    /* The first segment for each channel, reversed to apply as a time-domain
+     * FIR filter, and the FFT'd filter segments for all stages.
+     */
+    al::vector<std::array<float,ConvolveUpdateSamples>,16> mFir;
+    al::vector<float,16> mSegments;
+};
+
+namespace {
+
 struct ConvolutionState final : public EffectState {
     FmtChannels mChannels{};
     AmbiLayout mAmbiLayout{};
@@ -188,13 +267,71 @@ struct ConvolutionState final : public EffectState {
 
     size_t mFifoPos{0};
     std::array<float,ConvolveUpdateSamples*2> mInput{};
-    al::vector<std::array<float,ConvolveUpdateSamples>,16> mFilter;
-    al::vector<std::array<float,ConvolveUpdateSamples*2>,16> mOutput;
+    std::shared_ptr<const ConvolutionFilter> mFilter;
 
-    alignas(16) std::array<complex_f,ConvolveUpdateSize> mFftBuffer{};
+    /* Scratch space for processing a stage, for a real FFT of the largest
+     * segment size (packed as half as many complex values), and the
+     * accumulated bins of each output channel.
+     */
+    struct ConvolveScratch {
+        al::vector<complex_f,16> mFftBuffer;
+        al::vector<float,16> mAccum;
+    };
+    ConvolveScratch mScratch;
 
-    size_t mCurrentSegment{0};
-    size_t mNumConvolveSegs{0};
+    struct ConvolveStage {
+        size_t mSegSamples{0};
+        /* The number of floats for the real or imaginary values of each FFT'd
+         * segment's mSegSamples+1 bins, padded for alignment.
+         */
+        size_t mBinStride{0};
+        /* The real FFT plan for the stage's segments, as mSegSamples complex
+         * values (mSegSamples*2 real samples).
+         */
+        FftPlan<float> mFft;
+        /* The number of filter segments, and the number of extra (older)
+         * input segments kept to delay the stage's output.
+         */
+        size_t mNumSegs{0};
+        size_t mDelaySegs{0};
+
+        size_t mCurrentSegment{0};
+        size_t mPos{0};
+
+        /* Set when processed by the tail thread, which needs the input and
+         * output double-buffered. The mixer fills the input and plays the
+         * output in mBufferIndex, while the thread processes the other.
+         */
+        bool mAsync{false};
+        size_t mBufferIndex{0};
+
+        /* The time-domain input for the next segment (mSegSamples per buffer),
+         * the output for each channel (mSegSamples per buffer, plus
+         * mSegSamples for the overlap), the FFT'd input history
+         * ((mDelaySegs+mNumSegs) * mBinStride*2), and the shared FFT'd
+         * filter segments for each channel (mNumSegs * mBinStride*2). Each
+         * FFT'd segment holds the real values followed by the imaginary
+         * values.
+         */
+        float *mInput{nullptr};
+        float *mOutput{nullptr};
+        float *mHistory{nullptr};
+        const float *mFilter{nullptr};
+    };
+    std::array<ConvolveStage,ConvolveStageSamples.size()> mStages{};
+    size_t mNumStages{0};
+
+    std::thread mTailThread;
+    al::semaphore mTailStartSem;
+    al::semaphore mTailDoneSem;
+    std::atomic<bool> mTailQuit{false};
+    bool mTailPending{false};
+    /* Consecutive segments the tail thread wasn't finished with in time, and
+     * whether the mixer has taken over processing the tail stage.
+     */
+    uint mTailMisses{0};
+    bool mTailFallback{false};
+    ConvolveScratch mTailScratch;
 
     struct ChannelData {
         alignas(16) FloatBufferLine mBuffer{};
@@ -205,17 +342,25 @@ struct ConvolutionState final : public EffectState {
     };
     using ChannelDataArray = al::FlexArray<ChannelData>;
     std::unique_ptr<ChannelDataArray> mChans;
-    std::unique_ptr<complex_f[]> mComplexData;
+    al::vector<float,16> mComplexData;
+    std::unique_ptr<float[]> mStageSamples;
 
 
     ConvolutionState() = default;
-    ~ConvolutionState() override = default;
+    ~ConvolutionState() override { stopTailThread(); }
+
+    /* Processes a full input segment for the stage. */
+    void processStage(ConvolveStage &stage, ConvolveScratch &scratch);
+
+    void tailThreadProc();
+    void stopTailThread();
 
     void NormalMix(const al::span<FloatBufferLine> samplesOut, const size_t samplesToDo);
     void UpsampleMix(const al::span<FloatBufferLine> samplesOut, const size_t samplesToDo);
     void (ConvolutionState::*mMix)(const al::span<FloatBufferLine>,const size_t)
     {&ConvolutionState::NormalMix};
 
+    uint inputOrder() const noexcept override { return 0; }
     void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
         const EffectTarget target) override;
@@ -236,48 +381,76 @@ void ConvolutionState::NormalMix(const al::span<FloatBufferLine> samplesOut,
 void ConvolutionState::UpsampleMix(const al::span<FloatBufferLine> samplesOut,
     const size_t samplesToDo)
 {
-    for(auto &chan : *mChans)
+    std::array<BandSplitter*,MaxAmbiChannels> filters;
+    std::array<float*,MaxAmbiChannels> buffers;
+    std::array<float,MaxAmbiChannels> hfscales, lfscales;
+    const size_t numchans{mChans->size()};
+    for(size_t c{0};c < numchans;++c)
     {
-        const al::span<float> src{chan.mBuffer.data(), samplesToDo};
-        chan.mFilter.processScale(src, chan.mHfScale, chan.mLfScale);
-        MixSamples(src, samplesOut, chan.Current, chan.Target, samplesToDo, 0);
+        ChannelData &chan = (*mChans)[c];
+        filters[c] = &chan.mFilter;
+        buffers[c] = chan.mBuffer.data();
+        hfscales[c] = chan.mHfScale;
+        lfscales[c] = chan.mLfScale;
     }
+    BandSplitter::processScaleBatch({filters.data(), numchans}, {buffers.data(), numchans},
+        {hfscales.data(), numchans}, {lfscales.data(), numchans}, samplesToDo);
+
+    for(auto &chan : *mChans)
+        MixSamples({chan.mBuffer.data(), samplesToDo}, samplesOut, chan.Current, chan.Target,
+            samplesToDo, 0);
 }
 
 
-void ConvolutionState::deviceUpdate(const DeviceBase *device, const BufferStorage *buffer)
+void ConvolutionState::tailThreadProc()
 {
-    using UhjDecoderType = UhjDecoder<512>;
-    static constexpr auto DecoderPadding = UhjDecoderType::sInputPadding;
+    althrd_setname(CONVOLUTION_THREAD_NAME);
 
-    constexpr uint MaxConvolveAmbiOrder{1u};
+    FPUCtl mixer_mode{};
+    ConvolveStage &stage = mStages[mNumStages-1];
+    while(true)
+    {
+        mTailStartSem.wait();
+        if(mTailQuit.load(std::memory_order_acquire)) UNLIKELY
+            break;
 
-    mFifoPos = 0;
-    mInput.fill(0.0f);
-    decltype(mFilter){}.swap(mFilter);
-    decltype(mOutput){}.swap(mOutput);
-    mFftBuffer.fill(complex_f{});
+        processStage(stage, mTailScratch);
+        mTailDoneSem.post();
+    }
+}
 
-    mCurrentSegment = 0;
-    mNumConvolveSegs = 0;
+void ConvolutionState::stopTailThread()
+{
+    if(!mTailThread.joinable())
+        return;
 
-    mChans = nullptr;
-    mComplexData = nullptr;
+    if(mTailPending)
+        mTailDoneSem.wait();
+    mTailPending = false;
 
-    /* An empty buffer doesn't need a convolution filter. */
-    if(!buffer || buffer->mSampleLen < 1) return;
+    mTailQuit.store(true, std::memory_order_release);
+    mTailStartSem.post();
+    mTailThread.join();
+    mTailQuit.store(false, std::memory_order_relaxed);
+}
 
-    mChannels = buffer->mChannels;
-    mAmbiLayout = IsUHJ(mChannels) ? AmbiLayout::FuMa : buffer->mAmbiLayout;
-    mAmbiScaling = IsUHJ(mChannels) ? AmbiScaling::UHJ : buffer->mAmbiScaling;
-    mAmbiOrder = minu(buffer->mAmbiOrder, MaxConvolveAmbiOrder);
 
-    constexpr size_t m{ConvolveUpdateSize/2 + 1};
+/* Prepares the convolution filter for the buffer at the device's mix rate.
+ * This resamples the impulse response, splits it into stages and segments,
+ * and applies the FFT to each segment.
+ */
+std::shared_ptr<const ConvolutionFilter> PrepareConvolutionFilter(const DeviceBase *device,
+    const BufferStorage *buffer, const size_t numChannels)
+{
+    using UhjDecoderType = UhjDecoder<512>;
+    static constexpr auto DecoderPadding = UhjDecoderType::sInputPadding;
+
+    auto filter = std::make_shared<ConvolutionFilter>();
+    filter->mSerial = buffer->mSerial;
+    filter->mSampleRate = device->MixFrequency;
+
     const auto bytesPerSample = BytesFromFmt(buffer->mType);
     const auto realChannels = buffer->channelsFromFmt();
-    const auto numChannels = (mChannels == FmtUHJ2) ? 3u : ChannelsFromFmt(mChannels, mAmbiOrder);
-
-    mChans = ChannelDataArray::Create(numChannels);
 
     /* The impulse response needs to have the same sample rate as the input and
      * output. The bsinc24 resampler is decent, but there is high-frequency
@@ -285,40 +458,74 @@ void ConvolutionState::deviceUpdate(const DeviceBase *device, const BufferStorag
      * called very infrequently, go ahead and use the polyphase resampler.
      */
     PPhaseResampler resampler;
-    if(device->Frequency != buffer->mSampleRate)
-        resampler.init(buffer->mSampleRate, device->Frequency);
+    if(device->MixFrequency != buffer->mSampleRate)
+        resampler.init(buffer->mSampleRate, device->MixFrequency);
     const auto resampledCount = static_cast<uint>(
-        (uint64_t{buffer->mSampleLen}*device->Frequency+(buffer->mSampleRate-1)) /
+        (uint64_t{buffer->mSampleLen}*device->MixFrequency+(buffer->mSampleRate-1)) /
         buffer->mSampleRate);
 
-    const BandSplitter splitter{device->mXOverFreq / static_cast<float>(device->Frequency)};
-    for(auto &e : *mChans)
-        e.mFilter = splitter;
-
-    mFilter.resize(numChannels, {});
-    mOutput.resize(numChannels, {});
+    filter->mFir.resize(numChannels, {});
 
-    /* Calculate the number of segments needed to hold the impulse response and
-     * the input history (rounded up), and allocate them. Exclude one segment
-     * which gets applied as a time-domain FIR filter. Make sure at least one
-     * segment is allocated to simplify handling.
+    /* Split the impulse response into stages, excluding the first segment
+     * which gets applied as a time-domain FIR filter. Each stage covers the
+     * response up to where the next stage's larger segments can start, unless
+     * the remaining response is too short to bother with the next stage, in
+     * which case it covers the rest. Make sure at least one segment is
+     * allocated to simplify handling. The last stage needs to start at least
+     * two segments in to be processed by the tail thread.
      */
-    mNumConvolveSegs = (resampledCount+(ConvolveUpdateSamples-1)) / ConvolveUpdateSamples;
-    mNumConvolveSegs = maxz(mNumConvolveSegs, 2) - 1;
+    size_t offset{ConvolveUpdateSamples};
+    for(size_t i{0};i < ConvolveStageSamples.size();++i)
+    {
+        const size_t segsamples{ConvolveStageSamples[i]};
+        auto &stage = filter->mStages[filter->mNumStages++];
+        stage.mSegSamples = segsamples;
+        stage.mDelaySegs = offset/segsamples - 1;
+
+        if(i+1 < ConvolveStageSamples.size())
+        {
+            const size_t nextsamples{ConvolveStageSamples[i+1]};
+            const size_t minoffset{(ConvolutionTailThread && i+2 == ConvolveStageSamples.size())
+                ? nextsamples*2 : nextsamples};
+            const size_t nextoffset{RoundUp(maxz(offset+segsamples, minoffset), nextsamples)};
+            if(resampledCount > nextoffset+nextsamples)
+            {
+                stage.mNumSegs = (nextoffset-offset) / segsamples;
+                offset = nextoffset;
+                continue;
+            }
+        }
+        const size_t remaining{(resampledCount > offset) ? resampledCount-offset : 0};
+        stage.mNumSegs = maxz((remaining+(segsamples-1)) / segsamples, 1);
+        break;
+    }
 
-    const size_t complex_length{mNumConvolveSegs * m * (numChannels+1)};
-    mComplexData = std::make_unique<complex_f[]>(complex_length);
-    std::fill_n(mComplexData.get(), complex_length, complex_f{});
+    size_t segments_length{0};
+    for(size_t i{0};i < filter->mNumStages;++i)
+    {
+        const auto &stage = filter->mStages[i];
+        segments_length += stage.mNumSegs * RoundUp(stage.mSegSamples+1, 4)*2 * numChannels;
+    }
+    filter->mSegments.resize(segments_length, 0.0f);
 
     /* Load the samples from the buffer. */
     const size_t srclinelength{RoundUp(buffer->mSampleLen+DecoderPadding, 16)};
     auto srcsamples = std::make_unique<float[]>(srclinelength * numChannels);
     std::fill_n(srcsamples.get(), srclinelength * numChannels, 0.0f);
     for(size_t c{0};c < numChannels && c < realChannels;++c)
-        LoadSamples(srcsamples.get() + srclinelength*c, buffer->mData.data() + bytesPerSample*c,
-            realChannels, buffer->mType, buffer->mSampleLen);
+    {
+        /* Buffers converted on load hold a float plane per channel. */
+        if(const size_t planeSize{buffer->mPlaneSize})
+            LoadSamples(srcsamples.get() + srclinelength*c,
+                buffer->mData.data() + planeSize*sizeof(float)*c, 1, FmtFloat,
+                buffer->mSampleLen);
+        else
+            LoadSamples(srcsamples.get() + srclinelength*c,
+                buffer->mData.data() + bytesPerSample*c, realChannels, buffer->mType,
+                buffer->mSampleLen);
+    }
 
-    if(IsUHJ(mChannels))
+    if(IsUHJ(buffer->mChannels))
     {
         auto decoder = std::make_unique<UhjDecoderType>();
         std::array<float*,4> samples{};
@@ -329,7 +536,8 @@ void ConvolutionState::deviceUpdate(const DeviceBase *device, const BufferStorag
 
     auto ressamples = std::make_unique<double[]>(buffer->mSampleLen +
         (resampler ? resampledCount : 0));
-    complex_f *filteriter = mComplexData.get() + mNumConvolveSegs*m;
+    auto fftbuffer = std::vector<std::complex<double>>(
+        filter->mStages[filter->mNumStages-1].mSegSamples * 2);
     for(size_t c{0};c < numChannels;++c)
     {
         /* Resample to match the device. */
@@ -347,23 +555,198 @@ void ConvolutionState::deviceUpdate(const DeviceBase *device, const BufferStorag
          * apply as a FIR filter.
          */
         const size_t first_size{minz(resampledCount, ConvolveUpdateSamples)};
-        std::transform(ressamples.get(), ressamples.get()+first_size, mFilter[c].rbegin(),
+        std::transform(ressamples.get(), ressamples.get()+first_size, filter->mFir[c].rbegin(),
             [](const double d) noexcept -> float { return static_cast<float>(d); });
 
-        auto fftbuffer = std::vector<std::complex<double>>(ConvolveUpdateSize);
         size_t done{first_size};
-        for(size_t s{0};s < mNumConvolveSegs;++s)
+        float *stageiter{filter->mSegments.data()};
+        for(size_t i{0};i < filter->mNumStages;++i)
+        {
+            const auto &stage = filter->mStages[i];
+            const size_t binstride{RoundUp(stage.mSegSamples+1, 4)};
+            const size_t m{stage.mSegSamples + 1};
+            const al::span<std::complex<double>> fftspan{fftbuffer.data(), stage.mSegSamples*2};
+            float *filteriter{stageiter + stage.mNumSegs*binstride*2*c};
+            for(size_t s{0};s < stage.mNumSegs;++s)
+            {
+                const size_t todo{minz(resampledCount-done, stage.mSegSamples)};
+
+                auto iter = std::copy_n(&ressamples[done], todo, fftspan.begin());
+                done += todo;
+                std::fill(iter, fftspan.end(), std::complex<double>{});
+
+                forward_fft(fftspan);
+                std::transform(fftspan.cbegin(), fftspan.cbegin()+m, filteriter,
+                    [](const std::complex<double> &cd) { return static_cast<float>(cd.real()); });
+                std::transform(fftspan.cbegin(), fftspan.cbegin()+m, filteriter+binstride,
+                    [](const std::complex<double> &cd) { return static_cast<float>(cd.imag()); });
+                filteriter += binstride*2;
+            }
+            stageiter += stage.mNumSegs*binstride*2 * numChannels;
+        }
+    }
+
+    return filter;
+}
+
+/* Gets the convolution filter for the buffer from the device's cache, or
+ * prepares it if no other effect is using it.
+ */
+std::shared_ptr<const ConvolutionFilter> GetConvolutionFilter(const DeviceBase *device,
+    const BufferStorage *buffer, const size_t numChannels)
+{
+    auto &cache = *device->mConvolutionCache;
+    std::lock_guard<std::mutex> _{cache.mLock};
+
+    std::shared_ptr<const ConvolutionFilter> filter;
+    for(auto iter = cache.mFilters.begin();iter != cache.mFilters.end();)
+    {
+        auto entry = iter->lock();
+        if(!entry)
         {
-            const size_t todo{minz(resampledCount-done, ConvolveUpdateSamples)};
+            iter = cache.mFilters.erase(iter);
+            continue;
+        }
+        if(entry->mSerial == buffer->mSerial && entry->mSampleRate == device->MixFrequency)
+            filter = std::move(entry);
+        ++iter;
+    }
+    if(filter)
+    {
+        TRACE("Reusing prepared convolution filter\n");
+        return filter;
+    }
+
+    filter = PrepareConvolutionFilter(device, buffer, numChannels);
+    cache.mFilters.emplace_back(filter);
+    return filter;
+}
+
+
+void ConvolutionState::deviceUpdate(const DeviceBase *device, const BufferStorage *buffer)
+{
+    constexpr uint MaxConvolveAmbiOrder{1u};
+
+    stopTailThread();
+    mTailScratch = ConvolveScratch{};
+    mTailMisses = 0;
+    mTailFallback = false;
 
-            auto iter = std::copy_n(&ressamples[done], todo, fftbuffer.begin());
-            done += todo;
-            std::fill(iter, fftbuffer.end(), std::complex<double>{});
+    mFifoPos = 0;
+    mInput.fill(0.0f);
+    mScratch = ConvolveScratch{};
+
+    mStages.fill(ConvolveStage{});
+    mNumStages = 0;
+
+    mChans = nullptr;
+    decltype(mComplexData){}.swap(mComplexData);
+    mStageSamples = nullptr;
+    mMemory.reset();
+
+    /* An empty buffer doesn't need a convolution filter. The current filter
+     * is otherwise kept until the new one is found, so a device reset at the
+     * same rate can reuse it.
+     */
+    if(!buffer || buffer->mSampleLen < 1)
+    {
+        mFilter = nullptr;
+        return;
+    }
 
-            forward_fft(al::span{fftbuffer});
-            filteriter = std::copy_n(fftbuffer.cbegin(), m, filteriter);
+    mChannels = buffer->mChannels;
+    mAmbiLayout = IsUHJ(mChannels) ? AmbiLayout::FuMa : buffer->mAmbiLayout;
+    mAmbiScaling = IsUHJ(mChannels) ? AmbiScaling::UHJ : buffer->mAmbiScaling;
+    mAmbiOrder = minu(buffer->mAmbiOrder, MaxConvolveAmbiOrder);
+
+    const auto numChannels = (mChannels == FmtUHJ2) ? 3u : ChannelsFromFmt(mChannels, mAmbiOrder);
+
+    mChans = ChannelDataArray::Create(numChannels);
+
+    const BandSplitter splitter{device->mXOverFreq / static_cast<float>(device->MixFrequency)};
+    for(auto &e : *mChans)
+        e.mFilter = splitter;
+
+    mFilter = GetConvolutionFilter(device, buffer, numChannels);
+
+    mNumStages = mFilter->mNumStages;
+    for(size_t i{0};i < mNumStages;++i)
+    {
+        const auto &layout = mFilter->mStages[i];
+        ConvolveStage &stage = mStages[i];
+        stage.mSegSamples = layout.mSegSamples;
+        stage.mBinStride = RoundUp(layout.mSegSamples+1, 4);
+        stage.mFft = FftPlan<float>{layout.mSegSamples};
+        stage.mNumSegs = layout.mNumSegs;
+        stage.mDelaySegs = layout.mDelaySegs;
+    }
+
+    if(ConvolutionTailThread && mNumStages == ConvolveStageSamples.size())
+    {
+        ConvolveStage &stage = mStages[mNumStages-1];
+        mTailScratch.mFftBuffer.resize(stage.mSegSamples);
+        mTailScratch.mAccum.resize(stage.mBinStride * 2);
+        try {
+            mTailThread = std::thread{std::mem_fn(&ConvolutionState::tailThreadProc), this};
+            stage.mAsync = true;
+        }
+        catch(std::exception &e) {
+            WARN("Failed to start convolution tail thread: %s\n", e.what());
         }
     }
+
+    /* Allocate the input and output samples, and the FFT'd input history, for
+     * all stages. The FFT'd filter segments come from the shared filter.
+     */
+    size_t complex_length{0}, sample_length{0};
+    for(size_t i{0};i < mNumStages;++i)
+    {
+        const ConvolveStage &stage = mStages[i];
+        const size_t segsize{stage.mBinStride * 2};
+        const size_t numbufs{stage.mAsync ? 2u : 1u};
+        complex_length += (stage.mDelaySegs + stage.mNumSegs) * segsize;
+        sample_length += stage.mSegSamples * (numbufs + (numbufs+1)*numChannels);
+    }
+    mComplexData.resize(complex_length, 0.0f);
+    mStageSamples = std::make_unique<float[]>(sample_length);
+    std::fill_n(mStageSamples.get(), sample_length, 0.0f);
+
+    float *complexiter{mComplexData.data()};
+    float *sampleiter{mStageSamples.get()};
+    const float *filteriter{mFilter->mSegments.data()};
+    for(size_t i{0};i < mNumStages;++i)
+    {
+        ConvolveStage &stage = mStages[i];
+        const size_t segsize{stage.mBinStride * 2};
+        const size_t numbufs{stage.mAsync ? 2u : 1u};
+        stage.mInput = sampleiter;
+        sampleiter += stage.mSegSamples * numbufs;
+        stage.mOutput = sampleiter;
+        sampleiter += stage.mSegSamples*(numbufs+1) * numChannels;
+        stage.mHistory = complexiter;
+        complexiter += (stage.mDelaySegs + stage.mNumSegs) * segsize;
+        stage.mFilter = filteriter;
+        filteriter += stage.mNumSegs*segsize * numChannels;
+    }
+    mScratch.mFftBuffer.resize(mStages[mNumStages-1].mSegSamples);
+    mScratch.mAccum.resize(mStages[mNumStages-1].mBinStride * 2);
+
+    if(mTailThread.joinable())
+        TRACE("Processing last %zu convolution segments with the tail thread\n",
+            mStages[mNumStages-1].mNumSegs);
+
+    auto scratch_size = [](const ConvolveScratch &scratch) noexcept -> size_t
+    {
+        return scratch.mFftBuffer.capacity()*sizeof(complex_f)
+            + scratch.mAccum.capacity()*sizeof(float);
+    };
+    /* Like shared buffer data, the shared filter is counted for each effect
+     * using it.
+     */
+    mMemory.set(device->mMemoryStats, MemCategory::Effects,
+        mFilter->mFir.capacity()*sizeof(mFilter->mFir[0]) + ChannelDataArray::Sizeof(numChannels)
+        + mFilter->mSegments.capacity()*sizeof(float) + mComplexData.capacity()*sizeof(float)
+        + sample_length*sizeof(float) + scratch_size(mScratch) + scratch_size(mTailScratch));
 }
 
 
@@ -417,7 +800,7 @@ void ConvolutionState::update(const ContextBase *context, const EffectSlot *slot
         { SideRight,   Deg2Rad(  90.0f), Deg2Rad(0.0f) }
     };
 
-    if(mNumConvolveSegs < 1) UNLIKELY
+    if(mNumStages < 1) UNLIKELY
         return;
 
     mMix = &ConvolutionState::NormalMix;
@@ -518,14 +901,108 @@ void ConvolutionState::update(const ContextBase *context, const EffectSlot *slot
     }
 }
 
+void ConvolutionState::processStage(ConvolveStage &stage, ConvolveScratch &scratch)
+{
+    const size_t halfsize{stage.mSegSamples / 2};
+    const size_t binstride{stage.mBinStride};
+    const size_t numsegs{stage.mDelaySegs + stage.mNumSegs};
+    const al::span<complex_f> fftbuffer{scratch.mFftBuffer.data(), stage.mSegSamples};
+    float *RESTRICT accumre{scratch.mAccum.data()};
+    float *RESTRICT accumim{accumre + binstride};
+    size_t curseg{stage.mCurrentSegment};
+
+    /* The tail thread processes the buffers the mixer isn't using. Its output
+     * plays one segment later than what was just input, so it pairs one
+     * segment less of delay.
+     */
+    const size_t numbufs{stage.mAsync ? 2u : 1u};
+    const size_t bufidx{stage.mAsync ? (stage.mBufferIndex^1) : 0u};
+    const size_t delaysegs{stage.mAsync ? (stage.mDelaySegs-1) : stage.mDelaySegs};
+
+    /* Calculate the frequency domain response and add the relevant frequency
+     * bins to the FFT history. The latter half of the FFT's input is silent.
+     */
+    const float *input{stage.mInput + stage.mSegSamples*bufidx};
+    for(size_t i{0};i < halfsize;++i)
+        fftbuffer[i] = complex_f{input[i*2], input[i*2 + 1]};
+    std::fill(fftbuffer.begin()+halfsize, fftbuffer.end(), complex_f{});
+    stage.mFft.forwardReal(fftbuffer);
+
+    float *RESTRICT historyre{stage.mHistory + curseg*binstride*2};
+    float *RESTRICT historyim{historyre + binstride};
+    historyre[0] = fftbuffer[0].real();
+    historyim[0] = 0.0f;
+    for(size_t i{1};i < stage.mSegSamples;++i)
+    {
+        historyre[i] = fftbuffer[i].real();
+        historyim[i] = fftbuffer[i].imag();
+    }
+    historyre[stage.mSegSamples] = fftbuffer[0].imag();
+    historyim[stage.mSegSamples] = 0.0f;
+
+    /* The delay segments are skipped, so the first filter segment pairs with
+     * an older input segment.
+     */
+    const size_t firstseg{(curseg+delaysegs) % numsegs};
+    const float *filter{stage.mFilter};
+    for(size_t c{0};c < mChans->size();++c)
+    {
+        std::fill_n(accumre, binstride*2, 0.0f);
+
+        /* Convolve each input segment with its IR filter counterpart (aligned
+         * in time).
+         */
+        size_t seg{firstseg};
+        for(size_t s{0};s < stage.mNumSegs;++s)
+        {
+            const float *segin{stage.mHistory + seg*binstride*2};
+            complex_mac(accumre, accumim, segin, segin+binstride, filter, filter+binstride,
+                binstride);
+            filter += binstride*2;
+            if(++seg == numsegs) seg = 0;
+        }
+
+        /* Apply iFFT to get the 2N (really 2N-1) samples for output. The N
+         * output samples are combined with the last output's N-1 second-half
+         * samples (and this output's second half is subsequently saved for
+         * next time).
+         */
+        fftbuffer[0] = complex_f{accumre[0], accumre[stage.mSegSamples]};
+        for(size_t i{1};i < stage.mSegSamples;++i)
+            fftbuffer[i] = complex_f{accumre[i], accumim[i]};
+        stage.mFft.inverseReal(fftbuffer);
+
+        /* The iFFT'd response is scaled up by the number of samples, so apply
+         * the inverse to normalize the output. Each even and odd sample pair is
+         * packed as one complex value.
+         */
+        float *chanoutput{stage.mOutput + stage.mSegSamples*(numbufs+1)*c};
+        float *RESTRICT output{chanoutput + stage.mSegSamples*bufidx};
+        float *RESTRICT overlap{chanoutput + stage.mSegSamples*numbufs};
+        const float scale{1.0f / static_cast<float>(stage.mSegSamples*2)};
+        for(size_t i{0};i < halfsize;++i)
+        {
+            output[i*2] = (fftbuffer[i].real()+overlap[i*2]) * scale;
+            output[i*2 + 1] = (fftbuffer[i].imag()+overlap[i*2 + 1]) * scale;
+        }
+        for(size_t i{0};i < halfsize;++i)
+        {
+            overlap[i*2] = fftbuffer[halfsize+i].real();
+            overlap[i*2 + 1] = fftbuffer[halfsize+i].imag();
+        }
+    }
+
+    /* Shift the input history. */
+    stage.mCurrentSegment = curseg ? (curseg-1) : (numsegs-1);
+}
+
 void ConvolutionState::process(const size_t samplesToDo,
     const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
 {
-    if(mNumConvolveSegs < 1) UNLIKELY
+    if(mNumStages < 1) UNLIKELY
         return;
 
-    constexpr size_t m{ConvolveUpdateSize/2 + 1};
-    size_t curseg{mCurrentSegment};
+    const al::span<ConvolveStage> stages{mStages.data(), mNumStages};
     auto &chans = *mChans;
 
     for(size_t base{0u};base < samplesToDo;)
@@ -536,15 +1013,20 @@ void ConvolutionState::process(const size_t samplesToDo,
             mInput.begin()+ConvolveUpdateSamples+mFifoPos);
 
         /* Apply the FIR for the newly retrieved input samples, and combine it
-         * with the inverse FFT'd output samples.
+         * with each stage's inverse FFT'd output samples.
          */
         for(size_t c{0};c < chans.size();++c)
         {
             auto buf_iter = chans[c].mBuffer.begin() + base;
-            apply_fir({buf_iter, todo}, mInput.data()+1 + mFifoPos, mFilter[c].data());
+            apply_fir({buf_iter, todo}, mInput.data()+1 + mFifoPos, mFilter->mFir[c].data());
 
-            auto fifo_iter = mOutput[c].begin() + mFifoPos;
-            std::transform(fifo_iter, fifo_iter+todo, buf_iter, buf_iter, std::plus<>{});
+            for(const ConvolveStage &stage : stages)
+            {
+                const size_t numbufs{stage.mAsync ? 2u : 1u};
+                const float *fifo_iter{stage.mOutput + stage.mSegSamples*(numbufs+1)*c +
+                    stage.mSegSamples*stage.mBufferIndex + stage.mPos + mFifoPos};
+                std::transform(fifo_iter, fifo_iter+todo, buf_iter, buf_iter, std::plus<>{});
+            }
         }
 
         mFifoPos += todo;
@@ -554,67 +1036,63 @@ void ConvolutionState::process(const size_t samplesToDo,
         if(mFifoPos < ConvolveUpdateSamples) break;
         mFifoPos = 0;
 
-        /* Move the newest input to the front for the next iteration's history. */
-        std::copy(mInput.cbegin()+ConvolveUpdateSamples, mInput.cend(), mInput.begin());
-
-        /* Calculate the frequency domain response and add the relevant
-         * frequency bins to the FFT history.
+        /* Add the new input to each stage, and process the stages that have
+         * a full segment.
          */
-        auto fftiter = std::copy_n(mInput.cbegin(), ConvolveUpdateSamples, mFftBuffer.begin());
-        std::fill(fftiter, mFftBuffer.end(), complex_f{});
-        forward_fft(al::span{mFftBuffer});
-
-        std::copy_n(mFftBuffer.cbegin(), m, &mComplexData[curseg*m]);
-
-        const complex_f *RESTRICT filter{mComplexData.get() + mNumConvolveSegs*m};
-        for(size_t c{0};c < chans.size();++c)
+        for(ConvolveStage &stage : stages)
         {
-            std::fill_n(mFftBuffer.begin(), m, complex_f{});
+            std::copy_n(mInput.cbegin()+ConvolveUpdateSamples, ConvolveUpdateSamples,
+                stage.mInput + stage.mSegSamples*stage.mBufferIndex + stage.mPos);
+            stage.mPos += ConvolveUpdateSamples;
+            if(stage.mPos < stage.mSegSamples)
+                continue;
+            stage.mPos = 0;
+
+            if(!stage.mAsync)
+            {
+                processStage(stage, mScratch);
+                continue;
+            }
 
-            /* Convolve each input segment with its IR filter counterpart
-             * (aligned in time).
+            /* The tail thread should have finished the previous segment long
+             * before now, so swap buffers to play its output and hand it the
+             * new input. The mixer can't wait on it, so if it's still busy,
+             * this segment's input is dropped and the tail is left out of the
+             * mix until it catches up. If the thread is late too often, the
+             * mixer takes over processing new input once it's finished.
              */
-            const complex_f *RESTRICT input{&mComplexData[curseg*m]};
-            for(size_t s{curseg};s < mNumConvolveSegs;++s)
+            if(mTailPending)
             {
-                for(size_t i{0};i < m;++i,++input,++filter)
-                    mFftBuffer[i] += *input * *filter;
+                if(!mTailDoneSem.try_wait())
+                {
+                    /* Each channel's output has two buffers and the overlap. */
+                    for(size_t c{0};c < chans.size();++c)
+                        std::fill_n(stage.mOutput + stage.mSegSamples*(c*3 + stage.mBufferIndex),
+                            stage.mSegSamples, 0.0f);
+                    if(++mTailMisses == TailMissLimit)
+                    {
+                        WARN("Convolution tail thread missed %u segments, processing in mixer\n",
+                            mTailMisses);
+                        mTailFallback = true;
+                    }
+                    continue;
+                }
+                mTailMisses = 0;
+                mTailPending = false;
             }
-            input = mComplexData.get();
-            for(size_t s{0};s < curseg;++s)
+            stage.mBufferIndex ^= 1;
+            if(mTailFallback)
+                processStage(stage, mTailScratch);
+            else
             {
-                for(size_t i{0};i < m;++i,++input,++filter)
-                    mFftBuffer[i] += *input * *filter;
+                mTailPending = true;
+                mTailStartSem.post();
             }
-
-            /* Reconstruct the mirrored/negative frequencies to do a proper
-             * inverse FFT.
-             */
-            for(size_t i{m};i < ConvolveUpdateSize;++i)
-                mFftBuffer[i] = std::conj(mFftBuffer[ConvolveUpdateSize-i]);
-
-            /* Apply iFFT to get the 256 (really 255) samples for output. The
-             * 128 output samples are combined with the last output's 127
-             * second-half samples (and this output's second half is
-             * subsequently saved for next time).
-             */
-            inverse_fft(al::span{mFftBuffer});
-
-            /* The iFFT'd response is scaled up by the number of bins, so apply
-             * the inverse to normalize the output.
-             */
-            for(size_t i{0};i < ConvolveUpdateSamples;++i)
-                mOutput[c][i] =
-                    (mFftBuffer[i].real()+mOutput[c][ConvolveUpdateSamples+i]) *
-                    (1.0f/float{ConvolveUpdateSize});
-            for(size_t i{0};i < ConvolveUpdateSamples;++i)
-                mOutput[c][ConvolveUpdateSamples+i] = mFftBuffer[ConvolveUpdateSamples+i].real();
         }
 
-        /* Shift the input history. */
-        curseg = curseg ? (curseg-1) : (mNumConvolveSegs-1);
+        /* Move the newest input to the front for the next iteration's history. */
+        std::copy(mInput.cbegin()+ConvolveUpdateSamples, mInput.cend(), mInput.begin());
     }
-    mCurrentSegment = curseg;
 
     /* Finally, mix to the output. */
     (this->*mMix)(samplesOut, samplesToDo);
@@ -25,6 +25,10 @@
 #include <cstdlib>
 #include <iterator>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#endif
+
 #include "alc/effects/base.h"
 #include "almalloc.h"
 #include "alnumbers.h"
@@ -56,6 +60,7 @@ struct DistortionState final : public EffectState {
     alignas(16) float mBuffer[2][BufferLineSize]{};
 
 
+    uint inputOrder() const noexcept override { return 0; }
     void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
         const EffectTarget target) override;
@@ -87,7 +92,7 @@ void DistortionState::update(const ContextBase *context, const EffectSlot *slot,
     /* Divide normalized frequency by the amount of oversampling done during
      * processing.
      */
-    auto frequency = static_cast<float>(device->Frequency);
+    auto frequency = static_cast<float>(device->MixFrequency);
     mLowpass.setParamsFromBandwidth(BiquadType::LowPass, cutoff/frequency/4.0f, 1.0f, bandwidth);
 
     cutoff = props->Distortion.EQCenter;
@@ -116,8 +121,9 @@ void DistortionState::process(const size_t samplesToDo, const al::span<const Flo
         /* Fill oversample buffer using zero stuffing. Multiply the sample by
          * the amount of oversampling to maintain the signal's power.
          */
-        for(size_t i{0u};i < todo;i++)
-            mBuffer[0][i] = !(i&3) ? samplesIn[0][(i>>2)+base] * 4.0f : 0.0f;
+        std::fill_n(mBuffer[0], todo, 0.0f);
+        for(size_t i{0u};i < todo;i += 4)
+            mBuffer[0][i] = samplesIn[0][(i>>2)+base] * 4.0f;
 
         /* First step, do lowpass filtering of original signal. Additionally
          * perform buffer interpolation and lowpass cutoff for oversampling
@@ -138,8 +144,29 @@ void DistortionState::process(const size_t samplesToDo, const al::span<const Flo
             smp = (1.0f + fc) * smp/(1.0f + fc*std::abs(smp));
             return smp;
         };
-        std::transform(std::begin(mBuffer[1]), std::begin(mBuffer[1])+todo, std::begin(mBuffer[0]),
-            proc_sample);
+        size_t pos{0u};
+#ifdef HAVE_SSE_INTRINSICS
+        /* The waveshaper has no state, so four samples can be shaped at once
+         * with the same operations as above.
+         */
+        const __m128 fc4{_mm_set1_ps(fc)};
+        const __m128 fc1{_mm_set1_ps(1.0f + fc)};
+        const __m128 one4{_mm_set1_ps(1.0f)};
+        const __m128 signmask{_mm_set1_ps(-0.0f)};
+        auto shape4 = [fc4,fc1,one4,signmask](const __m128 smp) -> __m128
+        {
+            const __m128 den{_mm_add_ps(one4, _mm_mul_ps(fc4, _mm_andnot_ps(signmask, smp)))};
+            return _mm_div_ps(_mm_mul_ps(fc1, smp), den);
+        };
+        for(;todo-pos >= 4;pos += 4)
+        {
+            __m128 smp{_mm_load_ps(&mBuffer[1][pos])};
+            smp = _mm_xor_ps(shape4(shape4(smp)), signmask);
+            _mm_store_ps(&mBuffer[0][pos], shape4(smp));
+        }
+#endif
+        std::transform(std::begin(mBuffer[1])+pos, std::begin(mBuffer[1])+todo,
+            std::begin(mBuffer[0])+pos, proc_sample);
 
         /* Third step, do bandpass filtering of distorted signal. */
         mBandpass.process({mBuffer[0], todo}, mBuffer[1]);
@@ -24,7 +24,6 @@
 #include <array>
 #include <cstdlib>
 #include <iterator>
-#include <tuple>
 #include <vector>
 
 #include "alc/effects/base.h"
@@ -48,8 +47,15 @@ using uint = unsigned int;
 
 constexpr float LowpassFreqRef{5000.0f};
 
+/* The minimum delay to reserve, so small increases in the delay parameters
+ * don't need a new state.
+ */
+constexpr float EchoMinReserveDelay{0.25f};
+
 struct EchoState final : public EffectState {
     std::vector<float> mSampleBuffer;
+    /* The total delay (in seconds) the sample buffer is sized for. */
+    float mMaxDelay{EchoMaxDelay + EchoMaxLRDelay};
 
     // The echo is two tap. The delay is the number of samples from before the
     // current offset
@@ -68,7 +74,11 @@ struct EchoState final : public EffectState {
     float mFeedGain{0.0f};
 
     alignas(16) float mTempBuffer[2][BufferLineSize];
+    alignas(16) float mFeedBuffer[BufferLineSize];
 
+    void reserve(const EffectProps *props) override;
+    bool canApply(const EffectProps *props) const noexcept override;
+    uint inputOrder() const noexcept override { return 0; }
     void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
         const EffectTarget target) override;
@@ -78,16 +88,27 @@ struct EchoState final : public EffectState {
     DEF_NEWDEL(EchoState)
 };
 
+void EchoState::reserve(const EffectProps *props)
+{
+    mMaxDelay = clampf(props->Echo.Delay + props->Echo.LRDelay, EchoMinReserveDelay,
+        EchoMaxDelay + EchoMaxLRDelay);
+}
+
+bool EchoState::canApply(const EffectProps *props) const noexcept
+{ return props->Echo.Delay + props->Echo.LRDelay <= mMaxDelay; }
+
 void EchoState::deviceUpdate(const DeviceBase *Device, const BufferStorage*)
 {
-    const auto frequency = static_cast<float>(Device->Frequency);
+    const auto frequency = static_cast<float>(Device->MixFrequency);
 
     // Use the next power of 2 for the buffer length, so the tap offsets can be
-    // wrapped using a mask instead of a modulo
-    const uint maxlen{NextPowerOf2(float2uint(EchoMaxDelay*frequency + 0.5f) +
-        float2uint(EchoMaxLRDelay*frequency + 0.5f))};
+    // wrapped using a mask instead of a modulo. An extra sample is needed for
+    // the rounding of each tap delay.
+    const uint maxlen{NextPowerOf2(float2uint(mMaxDelay*frequency + 0.5f) + 2)};
     if(maxlen != mSampleBuffer.size())
         decltype(mSampleBuffer)(maxlen).swap(mSampleBuffer);
+    mMemory.set(Device->mMemoryStats, MemCategory::Effects,
+        mSampleBuffer.capacity()*sizeof(float));
 
     std::fill(mSampleBuffer.begin(), mSampleBuffer.end(), 0.0f);
     for(auto &e : mGains)
@@ -101,10 +122,15 @@ void EchoState::update(const ContextBase *context, const EffectSlot *slot,
     const EffectProps *props, const EffectTarget target)
 {
     const DeviceBase *device{context->mDevice};
-    const auto frequency = static_cast<float>(device->Frequency);
+    const auto frequency = static_cast<float>(device->MixFrequency);
 
-    mTap[0].delay = maxu(float2uint(props->Echo.Delay*frequency + 0.5f), 1);
-    mTap[1].delay = float2uint(props->Echo.LRDelay*frequency + 0.5f) + mTap[0].delay;
+    /* Keep the taps within the sample buffer, in case the properties
+     * couldn't be reserved for.
+     */
+    const size_t maxdelay{mSampleBuffer.size() - 1};
+    mTap[0].delay = clampz(float2uint(props->Echo.Delay*frequency + 0.5f), 1, maxdelay);
+    mTap[1].delay = minz(float2uint(props->Echo.LRDelay*frequency + 0.5f) + mTap[0].delay,
+        maxdelay);
 
     const float gainhf{maxf(1.0f - props->Echo.Damping, 0.0625f)}; /* Limit -24dB */
     mFilter.setParamsFromSlope(BiquadType::HighShelf, LowpassFreqRef/frequency, gainhf, 1.0f);
@@ -127,38 +153,50 @@ void EchoState::process(const size_t samplesToDo, const al::span<const FloatBuff
     const size_t mask{mSampleBuffer.size()-1};
     float *RESTRICT delaybuf{mSampleBuffer.data()};
     size_t offset{mOffset};
-    size_t tap1{offset - mTap[0].delay};
-    size_t tap2{offset - mTap[1].delay};
-    float z1, z2;
 
     ASSUME(samplesToDo > 0);
 
-    const BiquadFilter filter{mFilter};
-    std::tie(z1, z2) = mFilter.getComponents();
-    for(size_t i{0u};i < samplesToDo;)
+    /* Copies to and from the delay buffer, splitting where it wraps around. */
+    auto read_delay = [delaybuf,mask](size_t pos, float *RESTRICT dst, const size_t count)
     {
-        offset &= mask;
-        tap1 &= mask;
-        tap2 &= mask;
-
-        size_t td{minz(mask+1 - maxz(offset, maxz(tap1, tap2)), samplesToDo-i)};
-        do {
-            /* Feed the delay buffer's input first. */
-            delaybuf[offset] = samplesIn[0][i];
-
-            /* Get delayed output from the first and second taps. Use the
-             * second tap for feedback.
-             */
-            mTempBuffer[0][i] = delaybuf[tap1++];
-            mTempBuffer[1][i] = delaybuf[tap2++];
-            const float feedb{mTempBuffer[1][i++]};
-
-            /* Add feedback to the delay buffer with damping and attenuation. */
-            delaybuf[offset++] += filter.processOne(feedb, z1, z2) * mFeedGain;
-        } while(--td);
+        pos &= mask;
+        const size_t todo{minz(count, mask+1 - pos)};
+        std::copy_n(delaybuf+pos, todo, dst);
+        std::copy_n(delaybuf, count-todo, dst+todo);
+    };
+    auto write_delay = [delaybuf,mask](size_t pos, const float *RESTRICT src, const size_t count)
+    {
+        pos &= mask;
+        const size_t todo{minz(count, mask+1 - pos)};
+        std::copy_n(src, todo, delaybuf+pos);
+        std::copy_n(src+todo, count-todo, delaybuf);
+    };
+
+    /* The taps only read samples from before the first tap's delay, so blocks
+     * no longer than that can be processed whole: read the delayed output
+     * from the two taps, then feed the delay buffer with the input and the
+     * damped and attenuated second tap as feedback. With a delay longer than
+     * the update, the whole update is one block.
+     */
+    const size_t blocksize{mTap[0].delay};
+    for(size_t base{0u};base < samplesToDo;)
+    {
+        const size_t todo{minz(samplesToDo-base, blocksize)};
+
+        read_delay(offset - mTap[0].delay, &mTempBuffer[0][base], todo);
+        read_delay(offset - mTap[1].delay, &mTempBuffer[1][base], todo);
+
+        mFilter.process({&mTempBuffer[1][base], todo}, mFeedBuffer);
+        const float feedgain{mFeedGain};
+        std::transform(samplesIn[0].cbegin()+base, samplesIn[0].cbegin()+base+todo,
+            mFeedBuffer, mFeedBuffer, [feedgain](const float in, const float feedb) noexcept
+            { return in + feedb*feedgain; });
+        write_delay(offset, mFeedBuffer, todo);
+
+        offset += todo;
+        base += todo;
     }
-    mFilter.setComponents(z1, z2);
-    mOffset = offset;
+    mOffset = offset & mask;
 
     for(size_t c{0};c < 2;c++)
         MixSamples({mTempBuffer[c], samplesToDo}, samplesOut, mGains[c].Current, mGains[c].Target,
@@ -86,18 +86,24 @@ namespace {
 
 
 struct EqualizerState final : public EffectState {
+    static constexpr size_t NumBands{4};
+    static_assert(NumBands <= BiquadFilter::MaxCascade, "Too many equalizer bands");
+
     struct {
         uint mTargetChannel{InvalidChannelIndex};
 
         /* Effect parameters */
-        BiquadFilter mFilter[4];
+        std::array<BiquadFilter,NumBands> mFilter;
 
         /* Effect gains for each channel */
         float mCurrentGain{};
         float mTargetGain{};
     } mChans[MaxAmbiChannels];
 
-    alignas(16) FloatBufferLine mSampleBuffer{};
+    /* The channels' bands are processed together, a batch of channels at a
+     * time.
+     */
+    alignas(16) std::array<FloatBufferLine,BiquadFilter::MaxBatch> mSampleBuffer{};
 
 
     void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) override;
@@ -114,8 +120,7 @@ void EqualizerState::deviceUpdate(const DeviceBase*, const BufferStorage*)
     for(auto &e : mChans)
     {
         e.mTargetChannel = InvalidChannelIndex;
-        std::for_each(std::begin(e.mFilter), std::end(e.mFilter),
-            std::mem_fn(&BiquadFilter::clear));
+        std::for_each(e.mFilter.begin(), e.mFilter.end(), std::mem_fn(&BiquadFilter::clear));
         e.mCurrentGain = 0.0f;
     }
 }
@@ -124,7 +129,7 @@ void EqualizerState::update(const ContextBase *context, const EffectSlot *slot,
     const EffectProps *props, const EffectTarget target)
 {
     const DeviceBase *device{context->mDevice};
-    auto frequency = static_cast<float>(device->Frequency);
+    auto frequency = static_cast<float>(device->MixFrequency);
     float gain, f0norm;
 
     /* Calculate coefficients for the each type of filter. Note that the shelf
@@ -154,10 +159,8 @@ void EqualizerState::update(const ContextBase *context, const EffectSlot *slot,
     /* Copy the filter coefficients for the other input channels. */
     for(size_t i{1u};i < slot->Wet.Buffer.size();++i)
     {
-        mChans[i].mFilter[0].copyParamsFrom(mChans[0].mFilter[0]);
-        mChans[i].mFilter[1].copyParamsFrom(mChans[0].mFilter[1]);
-        mChans[i].mFilter[2].copyParamsFrom(mChans[0].mFilter[2]);
-        mChans[i].mFilter[3].copyParamsFrom(mChans[0].mFilter[3]);
+        for(size_t band{0u};band < NumBands;++band)
+            mChans[i].mFilter[band].copyParamsFrom(mChans[0].mFilter[band]);
     }
 
     mOutTarget = target.Main->Buffer;
@@ -171,22 +174,41 @@ void EqualizerState::update(const ContextBase *context, const EffectSlot *slot,
 
 void EqualizerState::process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
 {
-    const al::span<float> buffer{mSampleBuffer.data(), samplesToDo};
-    auto chan = std::begin(mChans);
-    for(const auto &input : samplesIn)
+    constexpr size_t MaxBatch{BiquadFilter::MaxBatch};
+    std::array<BiquadFilter*,MaxBatch> cascades{};
+    std::array<const float*,MaxBatch> srcs{};
+    std::array<float*,MaxBatch> dsts{};
+    std::array<size_t,MaxBatch> chanidx{};
+    size_t count{0};
+
+    /* Run all bands of a batch of channels together, then mix the results. */
+    auto flush_batch = [&,this]()
     {
-        const size_t outidx{chan->mTargetChannel};
-        if(outidx != InvalidChannelIndex)
+        BiquadFilter::processCascadeBatch({cascades.data(), count}, NumBands,
+            {srcs.data(), count}, {dsts.data(), count}, samplesToDo);
+        for(size_t i{0};i < count;++i)
         {
-            const al::span<const float> inbuf{input.data(), samplesToDo};
-            DualBiquad{chan->mFilter[0], chan->mFilter[1]}.process(inbuf, buffer.begin());
-            DualBiquad{chan->mFilter[2], chan->mFilter[3]}.process(buffer, buffer.begin());
-
-            MixSamples(buffer, samplesOut[outidx].data(), chan->mCurrentGain, chan->mTargetGain,
-                samplesToDo);
+            auto &chan = mChans[chanidx[i]];
+            MixSamples({dsts[i], samplesToDo}, samplesOut[chan.mTargetChannel].data(),
+                chan.mCurrentGain, chan.mTargetGain, samplesToDo);
         }
-        ++chan;
+        count = 0;
+    };
+
+    for(size_t c{0};c < samplesIn.size();++c)
+    {
+        if(mChans[c].mTargetChannel == InvalidChannelIndex)
+            continue;
+
+        cascades[count] = mChans[c].mFilter.data();
+        srcs[count] = samplesIn[c].data();
+        dsts[count] = mSampleBuffer[count].data();
+        chanidx[count] = c;
+        if(++count == MaxBatch)
+            flush_batch();
     }
+    if(count > 0)
+        flush_batch();
 }
 
 
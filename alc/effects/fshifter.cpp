@@ -46,7 +46,7 @@
 namespace {
 
 using uint = unsigned int;
-using complex_d = std::complex<double>;
+using complex_f = std::complex<float>;
 
 constexpr size_t HilSize{1024};
 constexpr size_t HilHalfSize{HilSize >> 1};
@@ -57,7 +57,7 @@ constexpr size_t HilStep{HilSize / OversampleFactor};
 
 /* Define a Hann window, used to filter the HIL input and output. */
 struct Windower {
-    alignas(16) std::array<double,HilSize> mData;
+    alignas(16) std::array<float,HilSize> mData;
 
     Windower()
     {
@@ -66,7 +66,7 @@ struct Windower {
         {
             constexpr double scale{al::numbers::pi / double{HilSize}};
             const double val{std::sin((static_cast<double>(i)+0.5) * scale)};
-            mData[i] = mData[HilSize-1-i] = val * val;
+            mData[i] = mData[HilSize-1-i] = static_cast<float>(val * val);
         }
     }
 };
@@ -82,11 +82,19 @@ struct FshifterState final : public EffectState {
     std::array<double,2> mSign{};
 
     /* Effects buffers */
-    std::array<double,HilSize> mInFIFO{};
-    std::array<complex_d,HilStep> mOutFIFO{};
-    std::array<complex_d,HilSize> mOutputAccum{};
-    std::array<complex_d,HilSize> mAnalytic{};
-    std::array<complex_d,BufferLineSize> mOutdata{};
+    std::array<float,HilSize> mInFIFO{};
+    std::array<complex_f,HilStep> mOutFIFO{};
+    std::array<complex_f,HilSize> mOutputAccum{};
+    std::array<complex_f,BufferLineSize> mOutdata{};
+
+    /* The real FFT buffer, as HilSize samples or HilHalfSize bins (with the
+     * DC and Nyquist bins packed together in the first), and the full complex
+     * spectrum of the analytic signal.
+     */
+    std::array<complex_f,HilHalfSize> mFftBuffer{};
+    std::array<complex_f,HilSize> mAnalytic{};
+    FftPlan<float> mRealFft;
+    FftPlan<float> mFft;
 
     alignas(16) FloatBufferLine mBufferOut{};
 
@@ -97,6 +105,7 @@ struct FshifterState final : public EffectState {
     } mGains[2];
 
 
+    uint inputOrder() const noexcept override { return 0; }
     void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
         const EffectTarget target) override;
@@ -115,10 +124,15 @@ void FshifterState::deviceUpdate(const DeviceBase*, const BufferStorage*)
     mPhaseStep.fill(0u);
     mPhase.fill(0u);
     mSign.fill(1.0);
-    mInFIFO.fill(0.0);
-    mOutFIFO.fill(complex_d{});
-    mOutputAccum.fill(complex_d{});
-    mAnalytic.fill(complex_d{});
+    mInFIFO.fill(0.0f);
+    mOutFIFO.fill(complex_f{});
+    mOutputAccum.fill(complex_f{});
+    mFftBuffer.fill(complex_f{});
+    mAnalytic.fill(complex_f{});
+    if(mRealFft.size() != HilHalfSize)
+        mRealFft = FftPlan<float>{HilHalfSize};
+    if(mFft.size() != HilSize)
+        mFft = FftPlan<float>{HilSize};
 
     for(auto &gain : mGains)
     {
@@ -132,7 +146,7 @@ void FshifterState::update(const ContextBase *context, const EffectSlot *slot,
 {
     const DeviceBase *device{context->mDevice};
 
-    const float step{props->Fshifter.Frequency / static_cast<float>(device->Frequency)};
+    const float step{props->Fshifter.Frequency / static_cast<float>(device->MixFrequency)};
     mPhaseStep[0] = mPhaseStep[1] = fastf2u(minf(step, 1.0f) * MixerFracOne);
 
     switch(props->Fshifter.LeftDirection)
@@ -197,42 +211,66 @@ void FshifterState::process(const size_t samplesToDo, const al::span<const Float
         mCount = 0;
         mPos = (mPos+HilStep) & (HilSize-1);
 
-        /* Real signal windowing and store in Analytic buffer */
+        /* Real signal windowing, and apply a forward real FFT. The real FFT
+         * takes the samples packed as pairs of real and imaginary values.
+         */
+        float *fftsamples{reinterpret_cast<float*>(mFftBuffer.data())};
         for(size_t src{mPos}, k{0u};src < HilSize;++src,++k)
-            mAnalytic[k] = mInFIFO[src]*gWindow.mData[k];
+            fftsamples[k] = mInFIFO[src]*gWindow.mData[k];
         for(size_t src{0u}, k{HilSize-mPos};src < mPos;++src,++k)
-            mAnalytic[k] = mInFIFO[src]*gWindow.mData[k];
-
-        /* Processing signal by Discrete Hilbert Transform (analytical signal). */
-        complex_hilbert(mAnalytic);
-
-        /* Windowing and add to output accumulator */
+            fftsamples[k] = mInFIFO[src]*gWindow.mData[k];
+        mRealFft.forwardReal(mFftBuffer);
+
+        /* Get the (conjugated) analytic signal by keeping the DC and Nyquist
+         * bins, doubling the positive frequencies, and clearing the negative
+         * frequencies. Applying a forward FFT to the conjugated bins gives the
+         * conjugated inverse, which is what the shifter expects.
+         */
+        mAnalytic[0] = complex_f{mFftBuffer[0].real()};
+        std::transform(mFftBuffer.cbegin()+1, mFftBuffer.cend(), mAnalytic.begin()+1,
+            [](const complex_f bin) noexcept { return std::conj(bin) * 2.0f; });
+        mAnalytic[HilHalfSize] = complex_f{mFftBuffer[0].imag()};
+        std::fill(mAnalytic.begin()+HilHalfSize+1, mAnalytic.end(), complex_f{});
+        mFft.forward(mAnalytic);
+
+        /* Windowing and add to output accumulator. The FFT scales the output
+         * by the FFT size.
+         */
+        static constexpr float scale{2.0f / OversampleFactor / HilSize};
         for(size_t dst{mPos}, k{0u};dst < HilSize;++dst,++k)
-            mOutputAccum[dst] += 2.0/OversampleFactor*gWindow.mData[k]*mAnalytic[k];
+            mOutputAccum[dst] += gWindow.mData[k]*mAnalytic[k] * scale;
         for(size_t dst{0u}, k{HilSize-mPos};dst < mPos;++dst,++k)
-            mOutputAccum[dst] += 2.0/OversampleFactor*gWindow.mData[k]*mAnalytic[k];
+            mOutputAccum[dst] += gWindow.mData[k]*mAnalytic[k] * scale;
 
         /* Copy out the accumulated result, then clear for the next iteration. */
         std::copy_n(mOutputAccum.cbegin() + mPos, HilStep, mOutFIFO.begin());
-        std::fill_n(mOutputAccum.begin() + mPos, HilStep, complex_d{});
+        std::fill_n(mOutputAccum.begin() + mPos, HilStep, complex_f{});
     }
 
-    /* Process frequency shifter using the analytic signal obtained. */
+    /* Process frequency shifter using the analytic signal obtained. The
+     * oscillator is rotated by the phase step each sample, starting from the
+     * exact phase each update so it doesn't drift.
+     */
     float *RESTRICT BufferOut{al::assume_aligned<16>(mBufferOut.data())};
     for(size_t c{0};c < 2;++c)
     {
+        constexpr double phase_scale{al::numbers::pi*2.0 / MixerFracOne};
         const uint phase_step{mPhaseStep[c]};
-        uint phase_idx{mPhase[c]};
+        const double rotcos{std::cos(phase_step * phase_scale)};
+        const double rotsin{std::sin(phase_step * phase_scale)};
+        double osccos{std::cos(mPhase[c] * phase_scale)};
+        double oscsin{std::sin(mPhase[c] * phase_scale) * mSign[c]};
+        const double rotsin_signed{rotsin * mSign[c]};
         for(size_t k{0};k < samplesToDo;++k)
         {
-            const double phase{phase_idx * (al::numbers::pi*2.0 / MixerFracOne)};
-            BufferOut[k] = static_cast<float>(mOutdata[k].real()*std::cos(phase) +
-                mOutdata[k].imag()*std::sin(phase)*mSign[c]);
+            BufferOut[k] = static_cast<float>(mOutdata[k].real()*osccos
+                + mOutdata[k].imag()*oscsin);
 
-            phase_idx += phase_step;
-            phase_idx &= MixerFracMask;
+            const double newcos{osccos*rotcos - oscsin*rotsin_signed};
+            oscsin = oscsin*rotcos + osccos*rotsin_signed;
+            osccos = newcos;
         }
-        mPhase[c] = phase_idx;
+        mPhase[c] = (mPhase[c] + phase_step*static_cast<uint>(samplesToDo)) & MixerFracMask;
 
         /* Now, mix the processed sound data to the output. */
         MixSamples({BufferOut, samplesToDo}, samplesOut, mGains[c].Current, mGains[c].Target,
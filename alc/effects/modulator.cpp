@@ -25,6 +25,10 @@
 #include <cstdlib>
 #include <iterator>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <emmintrin.h>
+#endif
+
 #include "alc/effects/base.h"
 #include "almalloc.h"
 #include "alnumbers.h"
@@ -51,28 +55,97 @@ using uint = unsigned int;
 #define WAVEFORM_FRACONE   (1<<WAVEFORM_FRACBITS)
 #define WAVEFORM_FRACMASK  (WAVEFORM_FRACONE-1)
 
-inline float Sin(uint index)
-{
-    constexpr float scale{al::numbers::pi_v<float>*2.0f / WAVEFORM_FRACONE};
-    return std::sin(static_cast<float>(index) * scale);
-}
+/* Each waveform generates a sample for an index into its cycle, and with SSE,
+ * four samples for four indices at once.
+ */
+struct SinWave {
+    static float gen(uint index)
+    {
+        constexpr float scale{al::numbers::pi_v<float>*2.0f / WAVEFORM_FRACONE};
+        return std::sin(static_cast<float>(index) * scale);
+    }
+#ifdef HAVE_SSE_INTRINSICS
+    /* Shifting the phase from [0,2pi) to [-pi,pi) negates the result, and
+     * folding the magnitude to [0,pi/2] lets a short odd polynomial
+     * approximate the sine.
+     */
+    static __m128 gen4(const __m128i index)
+    {
+        constexpr float scale{al::numbers::pi_v<float>*2.0f / WAVEFORM_FRACONE};
+        const __m128 pi4{_mm_set1_ps(al::numbers::pi_v<float>)};
+        const __m128 signmask{_mm_set1_ps(-0.0f)};
+        const __m128 phase{_mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(index), _mm_set1_ps(scale)),
+            pi4)};
+        const __m128 nsign{_mm_xor_ps(_mm_and_ps(phase, signmask), signmask)};
+        const __m128 absphase{_mm_andnot_ps(signmask, phase)};
+        const __m128 x{_mm_min_ps(absphase, _mm_sub_ps(pi4, absphase))};
+        const __m128 x2{_mm_mul_ps(x, x)};
+
+        __m128 poly{_mm_set1_ps(-1.0f/39916800.0f)};
+        poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(1.0f/362880.0f));
+        poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(-1.0f/5040.0f));
+        poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(1.0f/120.0f));
+        poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(-1.0f/6.0f));
+        poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(1.0f));
+        return _mm_xor_ps(_mm_mul_ps(poly, x), nsign);
+    }
+#endif
+};
 
-inline float Saw(uint index)
-{ return static_cast<float>(index)*(2.0f/WAVEFORM_FRACONE) - 1.0f; }
+struct SawWave {
+    static float gen(uint index)
+    { return static_cast<float>(index)*(2.0f/WAVEFORM_FRACONE) - 1.0f; }
+#ifdef HAVE_SSE_INTRINSICS
+    static __m128 gen4(const __m128i index)
+    {
+        return _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(index), _mm_set1_ps(2.0f/WAVEFORM_FRACONE)),
+            _mm_set1_ps(1.0f));
+    }
+#endif
+};
 
-inline float Square(uint index)
-{ return static_cast<float>(static_cast<int>((index>>(WAVEFORM_FRACBITS-2))&2) - 1); }
+struct SquareWave {
+    static float gen(uint index)
+    { return static_cast<float>(static_cast<int>((index>>(WAVEFORM_FRACBITS-2))&2) - 1); }
+#ifdef HAVE_SSE_INTRINSICS
+    static __m128 gen4(const __m128i index)
+    {
+        const __m128i half{_mm_and_si128(_mm_srli_epi32(index, WAVEFORM_FRACBITS-2),
+            _mm_set1_epi32(2))};
+        return _mm_cvtepi32_ps(_mm_sub_epi32(half, _mm_set1_epi32(1)));
+    }
+#endif
+};
 
-inline float One(uint) { return 1.0f; }
+struct OneWave {
+    static float gen(uint) { return 1.0f; }
+#ifdef HAVE_SSE_INTRINSICS
+    static __m128 gen4(const __m128i) { return _mm_set1_ps(1.0f); }
+#endif
+};
 
-template<float (&func)(uint)>
+template<typename Wave>
 void Modulate(float *RESTRICT dst, uint index, const uint step, size_t todo)
 {
-    for(size_t i{0u};i < todo;i++)
+    size_t i{0u};
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128i mask4{_mm_set1_epi32(WAVEFORM_FRACMASK)};
+    const __m128i step4{_mm_set1_epi32(static_cast<int>(step*4u))};
+    __m128i index4{_mm_setr_epi32(static_cast<int>(index+step), static_cast<int>(index+step*2u),
+        static_cast<int>(index+step*3u), static_cast<int>(index+step*4u))};
+    index4 = _mm_and_si128(index4, mask4);
+    for(;todo-i >= 4;i += 4)
+    {
+        _mm_store_ps(dst+i, Wave::gen4(index4));
+        index4 = _mm_and_si128(_mm_add_epi32(index4, step4), mask4);
+    }
+    index += static_cast<uint>(step * i);
+#endif
+    for(;i < todo;i++)
     {
         index += step;
         index &= WAVEFORM_FRACMASK;
-        dst[i] = func(index);
+        dst[i] = Wave::gen(index);
     }
 }
 
@@ -117,19 +190,19 @@ void ModulatorState::update(const ContextBase *context, const EffectSlot *slot,
 {
     const DeviceBase *device{context->mDevice};
 
-    const float step{props->Modulator.Frequency / static_cast<float>(device->Frequency)};
+    const float step{props->Modulator.Frequency / static_cast<float>(device->MixFrequency)};
     mStep = fastf2u(clampf(step*WAVEFORM_FRACONE, 0.0f, float{WAVEFORM_FRACONE-1}));
 
     if(mStep == 0)
-        mGetSamples = Modulate<One>;
+        mGetSamples = Modulate<OneWave>;
     else if(props->Modulator.Waveform == ModulatorWaveform::Sinusoid)
-        mGetSamples = Modulate<Sin>;
+        mGetSamples = Modulate<SinWave>;
     else if(props->Modulator.Waveform == ModulatorWaveform::Sawtooth)
-        mGetSamples = Modulate<Saw>;
+        mGetSamples = Modulate<SawWave>;
     else /*if(props->Modulator.Waveform == ModulatorWaveform::Square)*/
-        mGetSamples = Modulate<Square>;
+        mGetSamples = Modulate<SquareWave>;
 
-    float f0norm{props->Modulator.HighPassCutoff / static_cast<float>(device->Frequency)};
+    float f0norm{props->Modulator.HighPassCutoff / static_cast<float>(device->MixFrequency)};
     f0norm = clampf(f0norm, 1.0f/512.0f, 0.49f);
     /* Bandwidth value is constant in octaves. */
     mChans[0].mFilter.setParamsFromBandwidth(BiquadType::HighPass, f0norm, 1.0f, 0.75f);
@@ -156,23 +229,48 @@ void ModulatorState::process(const size_t samplesToDo, const al::span<const Floa
         mIndex += static_cast<uint>(mStep * td);
         mIndex &= WAVEFORM_FRACMASK;
 
-        auto chandata = std::begin(mChans);
-        for(const auto &input : samplesIn)
+        /* High-pass a batch of channels together, then apply the modulation
+         * and mix the results.
+         */
+        constexpr size_t MaxBatch{BiquadFilter::MaxBatch};
+        alignas(16) float temps[MaxBatch][MAX_UPDATE_SAMPLES];
+        std::array<BiquadFilter*,MaxBatch> filters{};
+        std::array<const float*,MaxBatch> srcs{};
+        std::array<float*,MaxBatch> dsts{};
+        std::array<size_t,MaxBatch> chanidx{};
+        size_t count{0};
+
+        auto flush_batch = [&,this]()
         {
-            const size_t outidx{chandata->mTargetChannel};
-            if(outidx != InvalidChannelIndex)
+            BiquadFilter::processBatch({filters.data(), count}, {srcs.data(), count},
+                {dsts.data(), count}, td);
+            for(size_t c{0};c < count;++c)
             {
-                alignas(16) float temps[MAX_UPDATE_SAMPLES];
-
-                chandata->mFilter.process({&input[base], td}, temps);
+                auto &chandata = mChans[chanidx[c]];
+                float *RESTRICT temp{dsts[c]};
                 for(size_t i{0u};i < td;i++)
-                    temps[i] *= modsamples[i];
+                    temp[i] *= modsamples[i];
 
-                MixSamples({temps, td}, samplesOut[outidx].data()+base, chandata->mCurrentGain,
-                    chandata->mTargetGain, samplesToDo-base);
+                MixSamples({temp, td}, samplesOut[chandata.mTargetChannel].data()+base,
+                    chandata.mCurrentGain, chandata.mTargetGain, samplesToDo-base);
             }
-            ++chandata;
+            count = 0;
+        };
+
+        for(size_t c{0};c < samplesIn.size();++c)
+        {
+            if(mChans[c].mTargetChannel == InvalidChannelIndex)
+                continue;
+
+            filters[count] = &mChans[c].mFilter;
+            srcs[count] = &samplesIn[c][base];
+            dsts[count] = temps[count];
+            chanidx[count] = c;
+            if(++count == MaxBatch)
+                flush_batch();
         }
+        if(count > 0)
+            flush_batch();
 
         base += td;
     }
@@ -20,6 +20,7 @@ struct NullState final : public EffectState {
     NullState();
     ~NullState() override;
 
+    uint inputOrder() const noexcept override { return 0; }
     void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
         const EffectTarget target) override;
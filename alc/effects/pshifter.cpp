@@ -44,6 +44,11 @@
 struct ContextBase;
 
 
+/* This is a user config option for a cheaper pitch shifter, using less
+ * overlap between STFT frames along with phase locking.
+ */
+bool PshifterFast{false};
+
 namespace {
 
 using uint = unsigned int;
@@ -51,10 +56,24 @@ using complex_f = std::complex<float>;
 
 constexpr size_t StftSize{1024};
 constexpr size_t StftHalfSize{StftSize >> 1};
-constexpr size_t OversampleFactor{8};
+/* The high quality mode overlaps eight frames. The fast mode only overlaps
+ * four, using phase locking to keep the partials' phases coherent with the
+ * larger step.
+ */
+constexpr size_t HighOversampleFactor{8};
+constexpr size_t FastOversampleFactor{4};
+
+static_assert(StftSize%HighOversampleFactor == 0, "Factor must be a clean divisor of the size");
+static_assert(StftSize%FastOversampleFactor == 0, "Factor must be a clean divisor of the size");
 
-static_assert(StftSize%OversampleFactor == 0, "Factor must be a clean divisor of the size");
-constexpr size_t StftStep{StftSize / OversampleFactor};
+/* Wraps the given phase to between -pi and +pi. */
+inline float WrapPhase(float phase) noexcept
+{
+    phase *= al::numbers::inv_pi_v<float>;
+    const int qpd{float2int(phase)};
+    phase -= static_cast<float>(qpd + (qpd%2));
+    return phase * al::numbers::pi_v<float>;
+}
 
 /* Define a Hann window, used to filter the STFT input and output. */
 struct Windower {
@@ -82,6 +101,9 @@ struct FrequencyBin {
 
 struct PshifterState final : public EffectState {
     /* Effect parameters */
+    size_t mOversample;
+    size_t mStep;
+    bool mPhaseLock;
     size_t mCount;
     size_t mPos;
     uint mPitchShiftI;
@@ -93,10 +115,19 @@ struct PshifterState final : public EffectState {
     std::array<float,StftHalfSize+1> mSumPhase;
     std::array<float,StftSize> mOutputAccum;
 
-    std::array<complex_f,StftSize> mFftBuffer;
+    /* The real FFT buffer, as StftSize samples or StftHalfSize bins (with the
+     * DC and Nyquist bins packed together in the first).
+     */
+    std::array<complex_f,StftHalfSize> mFftBuffer;
+    FftPlan<float> mFft;
 
     std::array<FrequencyBin,StftHalfSize+1> mAnalysisBuffer;
     std::array<FrequencyBin,StftHalfSize+1> mSynthesisBuffer;
+    /* The analysis bin each synthesis bin's frequency came from, and the
+     * spectral peaks found for phase locking.
+     */
+    std::array<uint,StftHalfSize+1> mSynthesisSource;
+    std::array<uint,StftHalfSize+1> mPeaks;
 
     alignas(16) FloatBufferLine mBufferOut;
 
@@ -105,6 +136,9 @@ struct PshifterState final : public EffectState {
     float mTargetGains[MaxAmbiChannels];
 
 
+    void lockPhases(const float expected_cycles);
+
+    uint inputOrder() const noexcept override { return 0; }
     void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
         const EffectTarget target) override;
@@ -117,8 +151,11 @@ struct PshifterState final : public EffectState {
 void PshifterState::deviceUpdate(const DeviceBase*, const BufferStorage*)
 {
     /* (Re-)initializing parameters and clear the buffers. */
+    mOversample  = PshifterFast ? FastOversampleFactor : HighOversampleFactor;
+    mStep        = StftSize / mOversample;
+    mPhaseLock   = PshifterFast;
     mCount       = 0;
-    mPos         = StftSize - StftStep;
+    mPos         = StftSize - mStep;
     mPitchShiftI = MixerFracOne;
     mPitchShift  = 1.0f;
 
@@ -127,8 +164,11 @@ void PshifterState::deviceUpdate(const DeviceBase*, const BufferStorage*)
     mSumPhase.fill(0.0f);
     mOutputAccum.fill(0.0f);
     mFftBuffer.fill(complex_f{});
+    if(mFft.size() != StftHalfSize)
+        mFft = FftPlan<float>{StftHalfSize};
     mAnalysisBuffer.fill(FrequencyBin{});
     mSynthesisBuffer.fill(FrequencyBin{});
+    mSynthesisSource.fill(0u);
 
     std::fill(std::begin(mCurrentGains), std::end(mCurrentGains), 0.0f);
     std::fill(std::begin(mTargetGains),  std::end(mTargetGains),  0.0f);
@@ -148,6 +188,48 @@ void PshifterState::update(const ContextBase*, const EffectSlot *slot,
     ComputePanGains(target.Main, coeffs.data(), slot->Gain, mTargetGains);
 }
 
+/* Identity phase locking (Laroche and Dolson). Only the spectral peaks have
+ * their phase accumulated from their frequency, and the bins around each peak
+ * keep the same phase offset from it as they had in the analysis. This keeps
+ * the partials coherent, which avoids the "phasiness" otherwise caused by a
+ * larger step between frames.
+ */
+void PshifterState::lockPhases(const float expected_cycles)
+{
+    size_t numpeaks{0};
+    for(size_t k{0u};k < StftHalfSize+1;k++)
+    {
+        const float mag{mSynthesisBuffer[k].Magnitude};
+        if(!(mag > 0.0f)) continue;
+        if(k > 0 && !(mag > mSynthesisBuffer[k-1].Magnitude)) continue;
+        if(k < StftHalfSize && !(mag >= mSynthesisBuffer[k+1].Magnitude)) continue;
+        mPeaks[numpeaks++] = static_cast<uint>(k);
+    }
+    if(numpeaks == 0)
+        return;
+
+    /* Each bin is locked to the nearest peak. */
+    size_t start{0u};
+    for(size_t p{0u};p < numpeaks;++p)
+    {
+        const size_t peak{mPeaks[p]};
+        const size_t end{(p+1 < numpeaks) ? (peak+mPeaks[p+1])/2 + 1 : StftHalfSize+1};
+
+        const float peakphase{WrapPhase(mSumPhase[peak]
+            + mSynthesisBuffer[peak].FreqBin*expected_cycles)};
+        const float peaksrcphase{mLastPhase[mSynthesisSource[peak]]};
+        for(size_t k{start};k < end;++k)
+        {
+            if(k == peak)
+                mSumPhase[k] = peakphase;
+            else
+                mSumPhase[k] = WrapPhase(peakphase + mLastPhase[mSynthesisSource[k]]
+                    - peaksrcphase);
+        }
+        start = end;
+    }
+}
+
 void PshifterState::process(const size_t samplesToDo,
     const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
 {
@@ -158,11 +240,13 @@ void PshifterState::process(const size_t samplesToDo,
     /* Cycle offset per update expected of each frequency bin (bin 0 is none,
      * bin 1 is x1, bin 2 is x2, etc).
      */
-    constexpr float expected_cycles{al::numbers::pi_v<float>*2.0f / OversampleFactor};
+    const size_t oversample{mOversample};
+    const size_t step{mStep};
+    const float expected_cycles{al::numbers::pi_v<float>*2.0f / static_cast<float>(oversample)};
 
     for(size_t base{0u};base < samplesToDo;)
     {
-        const size_t todo{minz(StftStep-mCount, samplesToDo-base)};
+        const size_t todo{minz(step-mCount, samplesToDo-base)};
 
         /* Retrieve the output samples from the FIFO and fill in the new input
          * samples.
@@ -175,35 +259,40 @@ void PshifterState::process(const size_t samplesToDo,
         base += todo;
 
         /* Check whether FIFO buffer is filled with new samples. */
-        if(mCount < StftStep) break;
+        if(mCount < step) break;
         mCount = 0;
-        mPos = (mPos+StftStep) & (mFIFO.size()-1);
+        mPos = (mPos+step) & (mFIFO.size()-1);
 
         /* Time-domain signal windowing, store in FftBuffer, and apply a
-         * forward FFT to get the frequency-domain signal.
+         * forward FFT to get the frequency-domain signal. The real FFT takes
+         * the samples packed as pairs of real and imaginary values.
          */
+        float *fftsamples{reinterpret_cast<float*>(mFftBuffer.data())};
         for(size_t src{mPos}, k{0u};src < StftSize;++src,++k)
-            mFftBuffer[k] = mFIFO[src] * gWindow.mData[k];
+            fftsamples[k] = mFIFO[src] * gWindow.mData[k];
         for(size_t src{0u}, k{StftSize-mPos};src < mPos;++src,++k)
-            mFftBuffer[k] = mFIFO[src] * gWindow.mData[k];
-        forward_fft(al::span{mFftBuffer});
+            fftsamples[k] = mFIFO[src] * gWindow.mData[k];
+        mFft.forwardReal(mFftBuffer);
 
         /* Analyze the obtained data. Since the real FFT is symmetric, only
          * StftHalfSize+1 samples are needed.
          */
+        const complex_f dcbin{mFftBuffer[0].real()}, nyquistbin{mFftBuffer[0].imag()};
         for(size_t k{0u};k < StftHalfSize+1;k++)
         {
-            const float magnitude{std::abs(mFftBuffer[k])};
-            const float phase{std::arg(mFftBuffer[k])};
+            const complex_f bin{(k == 0) ? dcbin : (k == StftHalfSize) ? nyquistbin
+                : mFftBuffer[k]};
+            const float magnitude{std::abs(bin)};
+            const float phase{std::arg(bin)};
 
             /* Compute the phase difference from the last update and subtract
              * the expected phase difference for this bin.
              *
              * When oversampling, the expected per-update offset increments by
-             * 1/OversampleFactor for every frequency bin. So, the offset wraps
-             * every 'OversampleFactor' bin.
+             * 1/oversample for every frequency bin. So, the offset wraps
+             * every 'oversample' bin.
              */
-            const auto bin_offset = static_cast<float>(k % OversampleFactor);
+            const auto bin_offset = static_cast<float>(k % oversample);
             float tmp{(phase - mLastPhase[k]) - bin_offset*expected_cycles};
             /* Store the actual phase for the next update. */
             mLastPhase[k] = phase;
@@ -216,7 +305,7 @@ void PshifterState::process(const size_t samplesToDo,
             /* Get deviation from bin frequency (-0.5 to +0.5), and account for
              * oversampling.
              */
-            tmp *= 0.5f * OversampleFactor;
+            tmp *= 0.5f * static_cast<float>(oversample);
 
             /* Compute the k-th partials' frequency bin target and store the
              * magnitude and frequency bin in the analysis buffer. We don't
@@ -243,48 +332,54 @@ void PshifterState::process(const size_t samplesToDo,
              * better way to handle this, but it's better than last-index-wins.
              */
             if(mAnalysisBuffer[k].Magnitude > mSynthesisBuffer[j].Magnitude)
+            {
                 mSynthesisBuffer[j].FreqBin = mAnalysisBuffer[k].FreqBin * mPitchShift;
+                mSynthesisSource[j] = static_cast<uint>(k);
+            }
             mSynthesisBuffer[j].Magnitude += mAnalysisBuffer[k].Magnitude;
         }
 
         /* Reconstruct the frequency-domain signal from the adjusted frequency
          * bins.
          */
-        for(size_t k{0u};k < StftHalfSize+1;k++)
+        if(!mPhaseLock)
         {
-            /* Calculate the actual delta phase for this bin's target frequency
-             * bin, and accumulate it to get the actual bin phase.
-             */
-            float tmp{mSumPhase[k] + mSynthesisBuffer[k].FreqBin*expected_cycles};
-
-            /* Wrap between -pi and +pi for the sum. If mSumPhase is left to
-             * grow indefinitely, it will lose precision and produce less exact
-             * phase over time.
-             */
-            tmp *= al::numbers::inv_pi_v<float>;
-            int qpd{float2int(tmp)};
-            tmp -= static_cast<float>(qpd + (qpd%2));
-            mSumPhase[k] = tmp * al::numbers::pi_v<float>;
-
-            mFftBuffer[k] = std::polar(mSynthesisBuffer[k].Magnitude, mSumPhase[k]);
+            for(size_t k{0u};k < StftHalfSize+1;k++)
+            {
+                /* Calculate the actual delta phase for this bin's target
+                 * frequency bin, and accumulate it to get the actual bin
+                 * phase. Wrap between -pi and +pi for the sum. If mSumPhase
+                 * is left to grow indefinitely, it will lose precision and
+                 * produce less exact phase over time.
+                 */
+                mSumPhase[k] = WrapPhase(mSumPhase[k]
+                    + mSynthesisBuffer[k].FreqBin*expected_cycles);
+            }
         }
-        for(size_t k{StftHalfSize+1};k < StftSize;++k)
-            mFftBuffer[k] = std::conj(mFftBuffer[StftSize-k]);
+        else
+            lockPhases(expected_cycles);
+        for(size_t k{1u};k < StftHalfSize;k++)
+            mFftBuffer[k] = std::polar(mSynthesisBuffer[k].Magnitude, mSumPhase[k]);
+        /* The imaginary parts of the DC and Nyquist bins don't contribute to
+         * the real output, so only their real parts are packed together.
+         */
+        mFftBuffer[0] = complex_f{mSynthesisBuffer[0].Magnitude * std::cos(mSumPhase[0]),
+            mSynthesisBuffer[StftHalfSize].Magnitude * std::cos(mSumPhase[StftHalfSize])};
 
         /* Apply an inverse FFT to get the time-domain signal, and accumulate
          * for the output with windowing.
          */
-        inverse_fft(al::span{mFftBuffer});
+        mFft.inverseReal(mFftBuffer);
 
-        static constexpr float scale{3.0f / OversampleFactor / StftSize};
+        const float scale{3.0f / static_cast<float>(oversample) / StftSize};
         for(size_t dst{mPos}, k{0u};dst < StftSize;++dst,++k)
-            mOutputAccum[dst] += gWindow.mData[k]*mFftBuffer[k].real() * scale;
+            mOutputAccum[dst] += gWindow.mData[k]*fftsamples[k] * scale;
         for(size_t dst{0u}, k{StftSize-mPos};dst < mPos;++dst,++k)
-            mOutputAccum[dst] += gWindow.mData[k]*mFftBuffer[k].real() * scale;
+            mOutputAccum[dst] += gWindow.mData[k]*fftsamples[k] * scale;
 
         /* Copy out the accumulated result, then clear for the next iteration. */
-        std::copy_n(mOutputAccum.begin() + mPos, StftStep, mFIFO.begin() + mPos);
-        std::fill_n(mOutputAccum.begin() + mPos, StftStep, 0.0f);
+        std::copy_n(mOutputAccum.begin() + mPos, step, mFIFO.begin() + mPos);
+        std::fill_n(mOutputAccum.begin() + mPos, step, 0.0f);
     }
 
     /* Now, mix the processed sound data to the output. */
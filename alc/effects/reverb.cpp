@@ -27,6 +27,13 @@
 #include <iterator>
 #include <numeric>
 #include <stdint.h>
+#include <tuple>
+
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "alc/effects/base.h"
 #include "almalloc.h"
@@ -53,6 +60,16 @@
  */
 float ReverbBoost = 1.0f;
 
+/* This is a user config option for using a cheaper reverb, without modulation
+ * or cross-fading between parameter changes.
+ */
+bool ReverbLite{false};
+
+/* This is a user config option for running the late reverb at a reduced rate,
+ * given as a divisor of the device's mixing rate (1, 2, or 4).
+ */
+unsigned int ReverbLateDivisor{1};
+
 namespace {
 
 using uint = unsigned int;
@@ -429,6 +446,21 @@ struct LateReverb {
     }
 };
 
+/* Filters for running the late reverb at a reduced rate. The same low-pass
+ * filter is used to decimate the late reverb input and, split into its
+ * polyphase components, to interpolate the output back to the full rate.
+ */
+struct LateResampler {
+    static constexpr uint sMaxShift{2};
+    static constexpr uint sPhaseTaps{4};
+
+    uint Shift{0};
+    std::array<float,sPhaseTaps << sMaxShift> Decimate{};
+    std::array<std::array<float,sPhaseTaps>,1u << sMaxShift> Interpolate{};
+
+    void init(const uint shift);
+};
+
 struct ReverbPipeline {
     /* Master effect filters */
     struct {
@@ -447,6 +479,13 @@ struct ReverbPipeline {
     /* Tap points for late reverb feed and delay. */
     size_t mLateDelayTap[NUM_LINES][2]{};
 
+    /* When the late reverb runs at a reduced rate, the late feed above only
+     * holds what's needed for decimating into this line, which the late taps
+     * then read from. The output history is kept for interpolating.
+     */
+    DelayLineI mLateDecimated;
+    DelayLineI mLateOut;
+
     /* Coefficients for the all-pass and line scattering matrices. */
     float mMixX{0.0f};
     float mMixY{0.0f};
@@ -460,16 +499,21 @@ struct ReverbPipeline {
     size_t mFadeSampleCount{1};
 
     void updateDelayLine(const float earlyDelay, const float lateDelay, const float density_mult,
-        const float decayTime, const float frequency);
+        const float decayTime, const float frequency, const float lateFrequency);
     void update3DPanning(const float *ReflectionsPan, const float *LateReverbPan,
         const float earlyGain, const float lateGain, const bool doUpmix, const MixParams *mainMix);
 
     void processEarly(size_t offset, const size_t samplesToDo,
         const al::span<ReverbUpdateLine,NUM_LINES> tempSamples,
         const al::span<FloatBufferLine,NUM_LINES> outSamples);
-    void processLate(size_t offset, const size_t samplesToDo,
+    template<bool Modulate>
+    void processLate(const DelayLineI in_delay, size_t offset, const size_t samplesToDo,
         const al::span<ReverbUpdateLine,NUM_LINES> tempSamples,
         const al::span<FloatBufferLine,NUM_LINES> outSamples);
+    template<bool Modulate>
+    void processLateDecimated(size_t offset, const size_t samplesToDo,
+        const LateResampler &resampler, const al::span<ReverbUpdateLine,NUM_LINES> tempSamples,
+        const al::span<FloatBufferLine,NUM_LINES> outSamples);
 
     void clear() noexcept
     {
@@ -508,6 +552,30 @@ struct ReverbState final : public EffectState {
         float LFReference{250.0f};
     } mParams;
 
+    struct {
+        /* Parameters last applied to the current pipeline, which indicate
+         * what needs recalculating when there's no full update.
+         */
+        std::array<float,3> ReflectionsPan{};
+        std::array<float,3> LateReverbPan{};
+        float EarlyGain{0.0f};
+        float LateGain{0.0f};
+        const MixParams *Target{nullptr};
+        float GainHF{1.0f};
+        float GainLF{1.0f};
+        float ReflectionsDelay{0.0f};
+        float LateReverbDelay{0.0f};
+    } mApplied;
+
+    enum UpdateFlags : uint8_t {
+        PanningDirty = 1<<0,
+        FilterDirty  = 1<<1,
+        DelayDirty   = 1<<2,
+        LinesDirty   = 1<<3,
+
+        AllDirty = PanningDirty | FilterDirty | DelayDirty | LinesDirty
+    };
+
     enum PipelineState : uint8_t {
         DeviceClear,
         StartFade,
@@ -518,6 +586,17 @@ struct ReverbState final : public EffectState {
     PipelineState mPipelineState{DeviceClear};
     uint8_t mCurrentPipeline{0};
 
+    /* Set for the lite reverb, which only uses the first pipeline and has no
+     * late reverb modulation.
+     */
+    bool mLite{false};
+
+    /* Filters for the late reverb when it runs at a reduced rate. */
+    LateResampler mLateResampler;
+
+    /* The largest reflections delay the early delay line is allocated for. */
+    float mMaxReflectionsDelay{ReverbMaxReflectionsDelay};
+
     ReverbPipeline mPipelines[2];
 
     /* The current write offset for all delay lines. */
@@ -563,23 +642,19 @@ struct ReverbState final : public EffectState {
     {
         ASSUME(todo > 0);
 
+        /* Mixes the 4 lines into one output row in one pass. */
         auto DoMixRow = [](const al::span<float> OutBuffer, const al::span<const float,4> Gains,
-            const float *InSamples, const size_t InStride)
+            const al::span<const FloatBufferLine,NUM_LINES> InSamples)
         {
-            std::fill(OutBuffer.begin(), OutBuffer.end(), 0.0f);
-            for(const float gain : Gains)
-            {
-                const float *RESTRICT input{al::assume_aligned<16>(InSamples)};
-                InSamples += InStride;
-
-                if(!(std::fabs(gain) > GainSilenceThreshold))
-                    continue;
-
-                auto mix_sample = [gain](const float sample, const float in) noexcept -> float
-                { return sample + in*gain; };
-                std::transform(OutBuffer.begin(), OutBuffer.end(), input, OutBuffer.begin(),
-                    mix_sample);
-            }
+            const float *RESTRICT input0{al::assume_aligned<16>(InSamples[0].data())};
+            const float *RESTRICT input1{al::assume_aligned<16>(InSamples[1].data())};
+            const float *RESTRICT input2{al::assume_aligned<16>(InSamples[2].data())};
+            const float *RESTRICT input3{al::assume_aligned<16>(InSamples[3].data())};
+            const float gain0{Gains[0]}, gain1{Gains[1]}, gain2{Gains[2]}, gain3{Gains[3]};
+
+            for(size_t i{0};i < OutBuffer.size();++i)
+                OutBuffer[i] = input0[i]*gain0 + input1[i]*gain1 + input2[i]*gain2 +
+                    input3[i]*gain3;
         };
 
         /* When upsampling, the B-Format conversion needs to be done separately
@@ -589,7 +664,7 @@ struct ReverbState final : public EffectState {
         const al::span<float> tmpspan{al::assume_aligned<16>(mTempLine.data()), todo};
         for(size_t c{0u};c < NUM_LINES;c++)
         {
-            DoMixRow(tmpspan, EarlyA2B[c], mEarlySamples[0].data(), mEarlySamples[0].size());
+            DoMixRow(tmpspan, EarlyA2B[c], mEarlySamples);
 
             /* Apply scaling to the B-Format's HF response to "upsample" it to
              * higher-order output.
@@ -602,7 +677,7 @@ struct ReverbState final : public EffectState {
         }
         for(size_t c{0u};c < NUM_LINES;c++)
         {
-            DoMixRow(tmpspan, LateA2B[c], mLateSamples[0].data(), mLateSamples[0].size());
+            DoMixRow(tmpspan, LateA2B[c], mLateSamples);
 
             const float hfscale{(c==0) ? mOrderScales[0] : mOrderScales[1]};
             pipeline.mAmbiSplitter[1][c].processHfScale(tmpspan, hfscale);
@@ -612,6 +687,17 @@ struct ReverbState final : public EffectState {
         }
     }
 
+    template<bool Modulate>
+    void processLate(ReverbPipeline &pipeline, const size_t offset, const size_t todo)
+    {
+        if(mLateResampler.Shift == 0)
+            pipeline.processLate<Modulate>(pipeline.mLateDelayIn, offset, todo, mTempSamples,
+                mLateSamples);
+        else
+            pipeline.processLateDecimated<Modulate>(offset, todo, mLateResampler, mTempSamples,
+                mLateSamples);
+    }
+
     void mixOut(ReverbPipeline &pipeline, const al::span<FloatBufferLine> samplesOut, const size_t todo)
     {
         if(mUpmixOutput)
@@ -622,6 +708,9 @@ struct ReverbState final : public EffectState {
 
     void allocLines(const float frequency);
 
+    void reserve(const EffectProps *props) override;
+    bool canApply(const EffectProps *props) const noexcept override;
+    uint inputOrder() const noexcept override { return 1; }
     void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
         const EffectTarget target) override;
@@ -657,24 +746,46 @@ void ReverbState::allocLines(const float frequency)
      * time and depth coefficient, and halfed for the low-to-high frequency
      * swing.
      */
-    constexpr float max_mod_delay{MaxModulationTime*MODULATION_DEPTH_COEFF / 2.0f};
+    const float max_mod_delay{mLite ? 0.0f : MaxModulationTime*MODULATION_DEPTH_COEFF / 2.0f};
 
-    for(auto &pipeline : mPipelines)
+    /* The late reverb's own lines run at the reduced rate, while its input is
+     * read from the full-rate late delay line through the decimation filter.
+     */
+    const uint lateShift{mLateResampler.Shift};
+    const float lateFrequency{frequency / static_cast<float>(1u << lateShift)};
+    const uint decimateTaps{uint{LateResampler::sPhaseTaps} << lateShift};
+
+    /* The lite reverb doesn't cross-fade, so only needs lines for the first
+     * pipeline.
+     */
+    const auto pipelines = al::span{mPipelines}.first(mLite ? 1 : 2);
+    for(auto &pipeline : pipelines)
     {
-        /* The main delay length includes the maximum early reflection delay,
+        /* The main delay length includes the reserved early reflection delay,
          * the largest early tap width, the maximum late reverb delay, and the
          * largest late tap width.  Finally, it must also be extended by the
          * update size (BufferLineSize) for block processing.
          */
-        float length{ReverbMaxReflectionsDelay + EARLY_TAP_LENGTHS.back()*multiplier};
+        float length{mMaxReflectionsDelay + EARLY_TAP_LENGTHS.back()*multiplier};
         totalSamples += pipeline.mEarlyDelayIn.calcLineLength(length, totalSamples, frequency,
             BufferLineSize);
 
         constexpr float LateLineDiffAvg{(LATE_LINE_LENGTHS.back()-LATE_LINE_LENGTHS.front()) /
             float{NUM_LINES}};
         length = ReverbMaxLateReverbDelay + LateLineDiffAvg*multiplier;
-        totalSamples += pipeline.mLateDelayIn.calcLineLength(length, totalSamples, frequency,
-            BufferLineSize);
+        if(!lateShift)
+        {
+            totalSamples += pipeline.mLateDelayIn.calcLineLength(length, totalSamples, frequency,
+                BufferLineSize);
+            pipeline.mLateDecimated = DelayLineI{};
+        }
+        else
+        {
+            totalSamples += pipeline.mLateDelayIn.calcLineLength(0.0f, totalSamples, frequency,
+                BufferLineSize + decimateTaps);
+            totalSamples += pipeline.mLateDecimated.calcLineLength(length, totalSamples,
+                lateFrequency, (BufferLineSize >> lateShift) + 1);
+        }
 
         /* The early vector all-pass line. */
         length = EARLY_ALLPASS_LENGTHS.back() * multiplier;
@@ -688,15 +799,25 @@ void ReverbState::allocLines(const float frequency)
 
         /* The late vector all-pass line. */
         length = LATE_ALLPASS_LENGTHS.back() * multiplier;
-        totalSamples += pipeline.mLate.VecAp.Delay.calcLineLength(length, totalSamples, frequency,
-            0);
+        totalSamples += pipeline.mLate.VecAp.Delay.calcLineLength(length, totalSamples,
+            lateFrequency, 0);
 
         /* The late delay lines are calculated from the largest maximum density
          * line length, and the maximum modulation delay. Four additional
          * samples are needed for resampling the modulator delay.
          */
         length = LATE_LINE_LENGTHS.back()*multiplier + max_mod_delay;
-        totalSamples += pipeline.mLate.Delay.calcLineLength(length, totalSamples, frequency, 4);
+        totalSamples += pipeline.mLate.Delay.calcLineLength(length, totalSamples, lateFrequency,
+            4);
+
+        /* The late output history holds an update's worth of reduced-rate
+         * samples, plus those still needed by the interpolation filter.
+         */
+        if(lateShift)
+            totalSamples += pipeline.mLateOut.calcLineLength(0.0f, totalSamples, lateFrequency,
+                (BufferLineSize >> lateShift) + LateResampler::sPhaseTaps);
+        else
+            pipeline.mLateOut = DelayLineI{};
     }
 
     if(totalSamples != mSampleBuffer.size())
@@ -705,8 +826,10 @@ void ReverbState::allocLines(const float frequency)
     /* Clear the sample buffer. */
     std::fill(mSampleBuffer.begin(), mSampleBuffer.end(), decltype(mSampleBuffer)::value_type{});
 
-    /* Update all delays to reflect the new sample buffer. */
-    for(auto &pipeline : mPipelines)
+    /* Update the delays to reflect the new sample buffer. An unused pipeline's
+     * lines don't have offsets to update.
+     */
+    for(auto &pipeline : pipelines)
     {
         pipeline.mEarlyDelayIn.realizeLineOffset(mSampleBuffer.data());
         pipeline.mLateDelayIn.realizeLineOffset(mSampleBuffer.data());
@@ -714,15 +837,79 @@ void ReverbState::allocLines(const float frequency)
         pipeline.mEarly.Delay.realizeLineOffset(mSampleBuffer.data());
         pipeline.mLate.VecAp.Delay.realizeLineOffset(mSampleBuffer.data());
         pipeline.mLate.Delay.realizeLineOffset(mSampleBuffer.data());
+        pipeline.mLateDecimated.realizeLineOffset(mSampleBuffer.data());
+        pipeline.mLateOut.realizeLineOffset(mSampleBuffer.data());
     }
 }
 
+void LateResampler::init(const uint shift)
+{
+    Shift = shift;
+    if(!shift)
+        return;
+
+    /* A Blackman-windowed sinc, cutting off a bit below the reduced rate's
+     * Nyquist frequency.
+     */
+    const size_t divisor{size_t{1} << shift};
+    const size_t taps{sPhaseTaps << shift};
+    const double cutoff{0.45 / static_cast<double>(divisor)};
+    const double center{static_cast<double>(taps-1) / 2.0};
+    double sum{0.0};
+    std::array<double,sPhaseTaps << sMaxShift> filter{};
+    for(size_t i{0};i < taps;++i)
+    {
+        const double x{static_cast<double>(i) - center};
+        const double w{static_cast<double>(i+1) / static_cast<double>(taps+1)};
+        const double window{0.42 - 0.5*std::cos(2.0*al::numbers::pi*w)
+            + 0.08*std::cos(4.0*al::numbers::pi*w)};
+        const double sinc{(x == 0.0) ? 2.0*cutoff
+            : std::sin(2.0*al::numbers::pi*cutoff*x) / (al::numbers::pi*x)};
+        filter[i] = sinc * window;
+        sum += filter[i];
+    }
+    for(size_t i{0};i < taps;++i)
+        Decimate[i] = static_cast<float>(filter[i] / sum);
+
+    /* Each interpolation phase is normalized separately so a constant input
+     * doesn't gain a ripple at the reduced rate.
+     */
+    for(size_t phase{0};phase < divisor;++phase)
+    {
+        double phasesum{0.0};
+        for(size_t i{0};i < sPhaseTaps;++i)
+            phasesum += filter[phase + i*divisor];
+        for(size_t i{0};i < sPhaseTaps;++i)
+            Interpolate[phase][i] = static_cast<float>(filter[phase + i*divisor] / phasesum);
+    }
+}
+
+/* The reflections delay can be up to 300ms, but is typically much smaller.
+ * Only reserve the early delay line for what's needed (with some room to grow
+ * without needing a new state), as it's the largest of the lines.
+ */
+void ReverbState::reserve(const EffectProps *props)
+{
+    constexpr float MinReserveDelay{0.1f};
+    mMaxReflectionsDelay = clampf(props->Reverb.ReflectionsDelay, MinReserveDelay,
+        ReverbMaxReflectionsDelay);
+}
+
+bool ReverbState::canApply(const EffectProps *props) const noexcept
+{ return props->Reverb.ReflectionsDelay <= mMaxReflectionsDelay; }
+
 void ReverbState::deviceUpdate(const DeviceBase *device, const BufferStorage*)
 {
-    const auto frequency = static_cast<float>(device->Frequency);
+    const auto frequency = static_cast<float>(device->MixFrequency);
+
+    mLite = ReverbLite;
+    mCurrentPipeline = 0;
+    mLateResampler.init((ReverbLateDivisor >= 4) ? 2u : (ReverbLateDivisor >= 2) ? 1u : 0u);
 
     /* Allocate the delay lines. */
     allocLines(frequency);
+    mMemory.set(device->mMemoryStats, MemCategory::Effects,
+        mSampleBuffer.capacity()*sizeof(mSampleBuffer[0]));
 
     for(auto &pipeline : mPipelines)
     {
@@ -999,7 +1186,8 @@ void LateReverb::updateLines(const float density_mult, const float diffusion,
 
 /* Update the offsets for the main effect delay line. */
 void ReverbPipeline::updateDelayLine(const float earlyDelay, const float lateDelay,
-    const float density_mult, const float decayTime, const float frequency)
+    const float density_mult, const float decayTime, const float frequency,
+    const float lateFrequency)
 {
     /* Early reflection taps are decorrelated by means of an average room
      * reflection approximation described above the definition of the taps.
@@ -1019,7 +1207,7 @@ void ReverbPipeline::updateDelayLine(const float earlyDelay, const float lateDel
 
         length = (LATE_LINE_LENGTHS[i] - LATE_LINE_LENGTHS.front())/float{NUM_LINES}*density_mult +
             lateDelay;
-        mLateDelayTap[i][1] = float2uint(length * frequency);
+        mLateDelayTap[i][1] = float2uint(length * lateFrequency);
     }
 }
 
@@ -1147,7 +1335,7 @@ void ReverbState::update(const ContextBase *Context, const EffectSlot *Slot,
     const EffectProps *props, const EffectTarget target)
 {
     const DeviceBase *Device{Context->mDevice};
-    const auto frequency = static_cast<float>(Device->Frequency);
+    const auto frequency = static_cast<float>(Device->MixFrequency);
 
     /* If the HF limit parameter is flagged, calculate an appropriate limit
      * based on the air absorption parameter.
@@ -1196,37 +1384,89 @@ void ReverbState::update(const ContextBase *Context, const EffectSlot *Slot,
         mParams.HFReference = props->Reverb.HFReference;
         mParams.LFReference = props->Reverb.LFReference;
 
-        mPipelineState = (mPipelineState != DeviceClear) ? StartFade : Normal;
-        mCurrentPipeline ^= 1;
+        /* The lite reverb updates the current pipeline in place. */
+        if(mLite)
+            mPipelineState = Normal;
+        else
+        {
+            mPipelineState = (mPipelineState != DeviceClear) ? StartFade : Normal;
+            mCurrentPipeline ^= 1;
+        }
     }
     auto &pipeline = mPipelines[mCurrentPipeline];
 
+    /* A full update prepares a fresh pipeline (or resets the lite one), so
+     * everything needs calculating. Otherwise, only recalculate what depends
+     * on the parameters that changed since the last update.
+     */
+    const float gain{props->Reverb.Gain * Slot->Gain * ReverbBoost};
+    const float earlyGain{props->Reverb.ReflectionsGain * gain};
+    const float lateGain{props->Reverb.LateReverbGain * gain};
+    uint dirty{fullUpdate ? uint{AllDirty} : 0u};
+    if(!std::equal(std::begin(props->Reverb.ReflectionsPan), std::end(props->Reverb.ReflectionsPan),
+            mApplied.ReflectionsPan.begin())
+        || !std::equal(std::begin(props->Reverb.LateReverbPan), std::end(props->Reverb.LateReverbPan),
+            mApplied.LateReverbPan.begin())
+        || mApplied.EarlyGain != earlyGain || mApplied.LateGain != lateGain
+        || mApplied.Target != target.Main)
+        dirty |= PanningDirty;
+    if(mApplied.GainHF != props->Reverb.GainHF || mApplied.GainLF != props->Reverb.GainLF)
+        dirty |= FilterDirty;
+    if(mApplied.ReflectionsDelay != props->Reverb.ReflectionsDelay
+        || mApplied.LateReverbDelay != props->Reverb.LateReverbDelay)
+        dirty |= DelayDirty;
+
+    /* The late reverb may run at a reduced rate. */
+    const float lateFrequency{frequency / static_cast<float>(1u << mLateResampler.Shift)};
+
     /* Update early and late 3D panning. */
     mOutTarget = target.Main->Buffer;
-    const float gain{props->Reverb.Gain * Slot->Gain * ReverbBoost};
-    pipeline.update3DPanning(props->Reverb.ReflectionsPan, props->Reverb.LateReverbPan,
-        props->Reverb.ReflectionsGain*gain, props->Reverb.LateReverbGain*gain, mUpmixOutput,
-        target.Main);
+    if((dirty&PanningDirty))
+    {
+        std::copy_n(std::begin(props->Reverb.ReflectionsPan), 3, mApplied.ReflectionsPan.begin());
+        std::copy_n(std::begin(props->Reverb.LateReverbPan), 3, mApplied.LateReverbPan.begin());
+        mApplied.EarlyGain = earlyGain;
+        mApplied.LateGain = lateGain;
+        mApplied.Target = target.Main;
+
+        pipeline.update3DPanning(props->Reverb.ReflectionsPan, props->Reverb.LateReverbPan,
+            earlyGain, lateGain, mUpmixOutput, target.Main);
+    }
 
     /* Calculate the master filters */
-    float hf0norm{minf(props->Reverb.HFReference/frequency, 0.49f)};
-    pipeline.mFilter[0].Lp.setParamsFromSlope(BiquadType::HighShelf, hf0norm, props->Reverb.GainHF, 1.0f);
-    float lf0norm{minf(props->Reverb.LFReference/frequency, 0.49f)};
-    pipeline.mFilter[0].Hp.setParamsFromSlope(BiquadType::LowShelf, lf0norm, props->Reverb.GainLF, 1.0f);
-    for(size_t i{1u};i < NUM_LINES;i++)
+    if((dirty&FilterDirty))
     {
-        pipeline.mFilter[i].Lp.copyParamsFrom(pipeline.mFilter[0].Lp);
-        pipeline.mFilter[i].Hp.copyParamsFrom(pipeline.mFilter[0].Hp);
+        mApplied.GainHF = props->Reverb.GainHF;
+        mApplied.GainLF = props->Reverb.GainLF;
+
+        float hf0norm{minf(props->Reverb.HFReference/frequency, 0.49f)};
+        pipeline.mFilter[0].Lp.setParamsFromSlope(BiquadType::HighShelf, hf0norm, props->Reverb.GainHF, 1.0f);
+        float lf0norm{minf(props->Reverb.LFReference/frequency, 0.49f)};
+        pipeline.mFilter[0].Hp.setParamsFromSlope(BiquadType::LowShelf, lf0norm, props->Reverb.GainLF, 1.0f);
+        for(size_t i{1u};i < NUM_LINES;i++)
+        {
+            pipeline.mFilter[i].Lp.copyParamsFrom(pipeline.mFilter[0].Lp);
+            pipeline.mFilter[i].Hp.copyParamsFrom(pipeline.mFilter[0].Hp);
+        }
     }
 
     /* The density-based room size (delay length) multiplier. */
     const float density_mult{CalcDelayLengthMult(props->Reverb.Density)};
 
-    /* Update the main effect delay and associated taps. */
-    pipeline.updateDelayLine(props->Reverb.ReflectionsDelay, props->Reverb.LateReverbDelay,
-        density_mult, props->Reverb.DecayTime, frequency);
+    /* Update the main effect delay and associated taps, keeping within the
+     * allocated early delay line.
+     */
+    if((dirty&DelayDirty))
+    {
+        mApplied.ReflectionsDelay = props->Reverb.ReflectionsDelay;
+        mApplied.LateReverbDelay = props->Reverb.LateReverbDelay;
+
+        pipeline.updateDelayLine(minf(props->Reverb.ReflectionsDelay, mMaxReflectionsDelay),
+            props->Reverb.LateReverbDelay, density_mult, props->Reverb.DecayTime, frequency,
+            lateFrequency);
+    }
 
-    if(fullUpdate)
+    if((dirty&LinesDirty))
     {
         /* Update the early lines. */
         pipeline.mEarly.updateLines(density_mult, props->Reverb.Diffusion, props->Reverb.DecayTime,
@@ -1236,12 +1476,15 @@ void ReverbState::update(const ContextBase *Context, const EffectSlot *Slot,
         CalcMatrixCoeffs(props->Reverb.Diffusion, &pipeline.mMixX, &pipeline.mMixY);
 
         /* Update the modulator rate and depth. */
-        pipeline.mLate.Mod.updateModulator(props->Reverb.ModulationTime,
-            props->Reverb.ModulationDepth, frequency);
+        if(!mLite)
+            pipeline.mLate.Mod.updateModulator(props->Reverb.ModulationTime,
+                props->Reverb.ModulationDepth, lateFrequency);
 
         /* Update the late lines. */
         pipeline.mLate.updateLines(density_mult, props->Reverb.Diffusion, lfDecayTime,
-            props->Reverb.DecayTime, hfDecayTime, lf0norm, hf0norm, frequency);
+            props->Reverb.DecayTime, hfDecayTime,
+            minf(props->Reverb.LFReference/lateFrequency, 0.49f),
+            minf(props->Reverb.HFReference/lateFrequency, 0.49f), lateFrequency);
     }
 
     const float decaySamples{(props->Reverb.ReflectionsDelay + props->Reverb.LateReverbDelay
@@ -1303,24 +1546,122 @@ inline auto VectorPartialScatter(const std::array<float,NUM_LINES> &RESTRICT in,
     }};
 }
 
+#ifdef HAVE_SSE_INTRINSICS
+/* The same as above, with the lines as one vector. Each line's other three
+ * inputs are shuffled into three vectors and have their signs flipped as
+ * needed.
+ */
+inline __m128 VectorPartialScatter(const __m128 in, const __m128 xCoeff, const __m128 yCoeff)
+    noexcept
+{
+    const __m128 sign0{_mm_setr_ps( 0.0f, -0.0f,  0.0f, -0.0f)};
+    const __m128 sign1{_mm_setr_ps(-0.0f,  0.0f, -0.0f, -0.0f)};
+    const __m128 sign2{_mm_setr_ps( 0.0f,  0.0f,  0.0f, -0.0f)};
+    const __m128 in0{_mm_xor_ps(_mm_shuffle_ps(in, in, _MM_SHUFFLE(0, 0, 0, 1)), sign0)};
+    const __m128 in1{_mm_xor_ps(_mm_shuffle_ps(in, in, _MM_SHUFFLE(1, 1, 2, 2)), sign1)};
+    const __m128 in2{_mm_xor_ps(_mm_shuffle_ps(in, in, _MM_SHUFFLE(2, 3, 3, 3)), sign2)};
+    const __m128 sum{_mm_add_ps(_mm_add_ps(in0, in1), in2)};
+    return _mm_add_ps(_mm_mul_ps(xCoeff, in), _mm_mul_ps(yCoeff, sum));
+}
+
+/* Transposes 4 samples of each line to 4 vectors of the lines' samples, or
+ * vice-versa.
+ */
+inline void TransposeLines(__m128 &row0, __m128 &row1, __m128 &row2, __m128 &row3) noexcept
+{ _MM_TRANSPOSE4_PS(row0, row1, row2, row3); }
+
+#elif defined(HAVE_NEON)
+
+inline float32x4_t VectorPartialScatter(const float32x4_t in, const float32x4_t xCoeff,
+    const float32x4_t yCoeff) noexcept
+{
+    static constexpr float signs0[4]{ 1.0f, -1.0f,  1.0f, -1.0f};
+    static constexpr float signs1[4]{-1.0f,  1.0f, -1.0f, -1.0f};
+    static constexpr float signs2[4]{ 1.0f,  1.0f,  1.0f, -1.0f};
+    const float32x2_t lo{vget_low_f32(in)}, hi{vget_high_f32(in)};
+    const float32x4_t in0{vmulq_f32(vcombine_f32(vrev64_f32(lo), vdup_lane_f32(lo, 0)),
+        vld1q_f32(signs0))};
+    const float32x4_t in1{vmulq_f32(vcombine_f32(vdup_lane_f32(hi, 0), vdup_lane_f32(lo, 1)),
+        vld1q_f32(signs1))};
+    const float32x4_t in2{vmulq_f32(vcombine_f32(vdup_lane_f32(hi, 1), vrev64_f32(hi)),
+        vld1q_f32(signs2))};
+    const float32x4_t sum{vaddq_f32(vaddq_f32(in0, in1), in2)};
+    return vaddq_f32(vmulq_f32(xCoeff, in), vmulq_f32(yCoeff, sum));
+}
+
+inline void TransposeLines(float32x4_t &row0, float32x4_t &row1, float32x4_t &row2,
+    float32x4_t &row3) noexcept
+{
+    const float32x4x2_t t01{vtrnq_f32(row0, row1)};
+    const float32x4x2_t t23{vtrnq_f32(row2, row3)};
+    row0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    row1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    row2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    row3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+#endif
+
 /* Utilizes the above, but reverses the input channels. */
 void VectorScatterRevDelayIn(const DelayLineI delay, size_t offset, const float xCoeff,
     const float yCoeff, const al::span<const ReverbUpdateLine,NUM_LINES> in, const size_t count)
 {
     ASSUME(count > 0);
 
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 xCoeff4{_mm_set1_ps(xCoeff)};
+    const __m128 yCoeff4{_mm_set1_ps(yCoeff)};
+#elif defined(HAVE_NEON)
+    const float32x4_t xCoeff4{vdupq_n_f32(xCoeff)};
+    const float32x4_t yCoeff4{vdupq_n_f32(yCoeff)};
+#endif
     for(size_t i{0u};i < count;)
     {
         offset &= delay.Mask;
         size_t td{minz(delay.Mask+1 - offset, count-i)};
-        do {
+
+        /* Transpose 4 samples of the lines at a time (in reverse order) to
+         * scatter and write them as vectors.
+         */
+#ifdef HAVE_SSE_INTRINSICS
+        for(;td >= 4;td-=4)
+        {
+            __m128 f0{_mm_loadu_ps(&in[3][i])};
+            __m128 f1{_mm_loadu_ps(&in[2][i])};
+            __m128 f2{_mm_loadu_ps(&in[1][i])};
+            __m128 f3{_mm_loadu_ps(&in[0][i])};
+            i += 4;
+            TransposeLines(f0, f1, f2, f3);
+
+            _mm_store_ps(delay.Line[offset++].data(), VectorPartialScatter(f0, xCoeff4, yCoeff4));
+            _mm_store_ps(delay.Line[offset++].data(), VectorPartialScatter(f1, xCoeff4, yCoeff4));
+            _mm_store_ps(delay.Line[offset++].data(), VectorPartialScatter(f2, xCoeff4, yCoeff4));
+            _mm_store_ps(delay.Line[offset++].data(), VectorPartialScatter(f3, xCoeff4, yCoeff4));
+        }
+#elif defined(HAVE_NEON)
+        for(;td >= 4;td-=4)
+        {
+            float32x4_t f0{vld1q_f32(&in[3][i])};
+            float32x4_t f1{vld1q_f32(&in[2][i])};
+            float32x4_t f2{vld1q_f32(&in[1][i])};
+            float32x4_t f3{vld1q_f32(&in[0][i])};
+            i += 4;
+            TransposeLines(f0, f1, f2, f3);
+
+            vst1q_f32(delay.Line[offset++].data(), VectorPartialScatter(f0, xCoeff4, yCoeff4));
+            vst1q_f32(delay.Line[offset++].data(), VectorPartialScatter(f1, xCoeff4, yCoeff4));
+            vst1q_f32(delay.Line[offset++].data(), VectorPartialScatter(f2, xCoeff4, yCoeff4));
+            vst1q_f32(delay.Line[offset++].data(), VectorPartialScatter(f3, xCoeff4, yCoeff4));
+        }
+#endif
+        for(;td;--td)
+        {
             std::array<float,NUM_LINES> f;
             for(size_t j{0u};j < NUM_LINES;j++)
                 f[NUM_LINES-1-j] = in[j][i];
             ++i;
 
             delay.Line[offset++] = VectorPartialScatter(f, xCoeff, yCoeff);
-        } while(--td);
+        }
     }
 }
 
@@ -1342,6 +1683,16 @@ void VecAllpass::process(const al::span<ReverbUpdateLine,NUM_LINES> samples, siz
 
     ASSUME(todo > 0);
 
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 xCoeff4{_mm_set1_ps(xCoeff)};
+    const __m128 yCoeff4{_mm_set1_ps(yCoeff)};
+    const __m128 feedCoeff4{_mm_set1_ps(feedCoeff)};
+#elif defined(HAVE_NEON)
+    const float32x4_t xCoeff4{vdupq_n_f32(xCoeff)};
+    const float32x4_t yCoeff4{vdupq_n_f32(yCoeff)};
+    const float32x4_t feedCoeff4{vdupq_n_f32(feedCoeff)};
+#endif
+
     size_t vap_offset[NUM_LINES];
     for(size_t j{0u};j < NUM_LINES;j++)
         vap_offset[j] = offset - Offset[j];
@@ -1356,7 +1707,82 @@ void VecAllpass::process(const al::span<ReverbUpdateLine,NUM_LINES> samples, siz
             maxoff = maxz(maxoff, vap_offset[j]);
         size_t td{minz(delay.Mask+1 - maxoff, todo - i)};
 
-        do {
+        /* Transpose 4 samples of the lines at a time, to process each sample
+         * of the lines as a vector. The delayed lines need to be read
+         * individually since they have different offsets.
+         */
+#ifdef HAVE_SSE_INTRINSICS
+        auto process_vec = [&](__m128 &input) noexcept
+        {
+            const __m128 delayed{_mm_setr_ps(delay.Line[vap_offset[0]][0],
+                delay.Line[vap_offset[1]][1], delay.Line[vap_offset[2]][2],
+                delay.Line[vap_offset[3]][3])};
+            for(size_t j{0u};j < NUM_LINES;j++)
+                ++vap_offset[j];
+
+            const __m128 out{_mm_sub_ps(delayed, _mm_mul_ps(feedCoeff4, input))};
+            const __m128 f{_mm_add_ps(input, _mm_mul_ps(feedCoeff4, out))};
+            _mm_store_ps(delay.Line[offset++].data(), VectorPartialScatter(f, xCoeff4, yCoeff4));
+            input = out;
+        };
+        for(;td >= 4;td-=4)
+        {
+            __m128 f0{_mm_loadu_ps(&samples[0][i])};
+            __m128 f1{_mm_loadu_ps(&samples[1][i])};
+            __m128 f2{_mm_loadu_ps(&samples[2][i])};
+            __m128 f3{_mm_loadu_ps(&samples[3][i])};
+            TransposeLines(f0, f1, f2, f3);
+
+            process_vec(f0);
+            process_vec(f1);
+            process_vec(f2);
+            process_vec(f3);
+
+            TransposeLines(f0, f1, f2, f3);
+            _mm_storeu_ps(&samples[0][i], f0);
+            _mm_storeu_ps(&samples[1][i], f1);
+            _mm_storeu_ps(&samples[2][i], f2);
+            _mm_storeu_ps(&samples[3][i], f3);
+            i += 4;
+        }
+#elif defined(HAVE_NEON)
+        auto process_vec = [&](float32x4_t &input) noexcept
+        {
+            float32x4_t delayed{vdupq_n_f32(delay.Line[vap_offset[0]][0])};
+            delayed = vsetq_lane_f32(delay.Line[vap_offset[1]][1], delayed, 1);
+            delayed = vsetq_lane_f32(delay.Line[vap_offset[2]][2], delayed, 2);
+            delayed = vsetq_lane_f32(delay.Line[vap_offset[3]][3], delayed, 3);
+            for(size_t j{0u};j < NUM_LINES;j++)
+                ++vap_offset[j];
+
+            const float32x4_t out{vsubq_f32(delayed, vmulq_f32(feedCoeff4, input))};
+            const float32x4_t f{vaddq_f32(input, vmulq_f32(feedCoeff4, out))};
+            vst1q_f32(delay.Line[offset++].data(), VectorPartialScatter(f, xCoeff4, yCoeff4));
+            input = out;
+        };
+        for(;td >= 4;td-=4)
+        {
+            float32x4_t f0{vld1q_f32(&samples[0][i])};
+            float32x4_t f1{vld1q_f32(&samples[1][i])};
+            float32x4_t f2{vld1q_f32(&samples[2][i])};
+            float32x4_t f3{vld1q_f32(&samples[3][i])};
+            TransposeLines(f0, f1, f2, f3);
+
+            process_vec(f0);
+            process_vec(f1);
+            process_vec(f2);
+            process_vec(f3);
+
+            TransposeLines(f0, f1, f2, f3);
+            vst1q_f32(&samples[0][i], f0);
+            vst1q_f32(&samples[1][i], f1);
+            vst1q_f32(&samples[2][i], f2);
+            vst1q_f32(&samples[3][i], f3);
+            i += 4;
+        }
+#endif
+        for(;td;--td)
+        {
             std::array<float,NUM_LINES> f;
             for(size_t j{0u};j < NUM_LINES;j++)
             {
@@ -1369,8 +1795,165 @@ void VecAllpass::process(const al::span<ReverbUpdateLine,NUM_LINES> samples, siz
             ++i;
 
             delay.Line[offset++] = VectorPartialScatter(f, xCoeff, yCoeff);
-        } while(--td);
+        }
+    }
+}
+
+/* Applies the T60 damping filters of each line. With SIMD, the lines are
+ * filtered together with each line's filters and samples in one vector lane.
+ */
+void T60FilterLines(const al::span<T60Filter,NUM_LINES> filters,
+    const al::span<ReverbUpdateLine,NUM_LINES> samples, const size_t todo)
+{
+    ASSUME(todo > 0);
+
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+    alignas(16) float coeffs[10][NUM_LINES];
+    alignas(16) float state[4][NUM_LINES];
+    for(size_t j{0u};j < NUM_LINES;j++)
+    {
+        const auto hfcoeffs = filters[j].HFFilter.getCoefficients();
+        const auto lfcoeffs = filters[j].LFFilter.getCoefficients();
+        for(size_t k{0u};k < hfcoeffs.size();k++)
+        {
+            coeffs[k][j] = hfcoeffs[k];
+            coeffs[hfcoeffs.size()+k][j] = lfcoeffs[k];
+        }
+        std::tie(state[0][j], state[1][j]) = filters[j].HFFilter.getComponents();
+        std::tie(state[2][j], state[3][j]) = filters[j].LFFilter.getComponents();
+    }
+#endif
+
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 hb0{_mm_load_ps(coeffs[0])}, hb1{_mm_load_ps(coeffs[1])};
+    const __m128 hb2{_mm_load_ps(coeffs[2])}, ha1{_mm_load_ps(coeffs[3])};
+    const __m128 ha2{_mm_load_ps(coeffs[4])};
+    const __m128 lb0{_mm_load_ps(coeffs[5])}, lb1{_mm_load_ps(coeffs[6])};
+    const __m128 lb2{_mm_load_ps(coeffs[7])}, la1{_mm_load_ps(coeffs[8])};
+    const __m128 la2{_mm_load_ps(coeffs[9])};
+    __m128 hz1{_mm_load_ps(state[0])}, hz2{_mm_load_ps(state[1])};
+    __m128 lz1{_mm_load_ps(state[2])}, lz2{_mm_load_ps(state[3])};
+
+    auto process_vec = [&](__m128 &input) noexcept
+    {
+        const __m128 tmpout{_mm_add_ps(_mm_mul_ps(input, hb0), hz1)};
+        hz1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(input, hb1), _mm_mul_ps(tmpout, ha1)), hz2);
+        hz2 = _mm_sub_ps(_mm_mul_ps(input, hb2), _mm_mul_ps(tmpout, ha2));
+
+        const __m128 output{_mm_add_ps(_mm_mul_ps(tmpout, lb0), lz1)};
+        lz1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(tmpout, lb1), _mm_mul_ps(output, la1)), lz2);
+        lz2 = _mm_sub_ps(_mm_mul_ps(tmpout, lb2), _mm_mul_ps(output, la2));
+        input = output;
+    };
+
+    size_t i{0u};
+    for(;todo-i >= 4;i+=4)
+    {
+        __m128 f0{_mm_loadu_ps(&samples[0][i])};
+        __m128 f1{_mm_loadu_ps(&samples[1][i])};
+        __m128 f2{_mm_loadu_ps(&samples[2][i])};
+        __m128 f3{_mm_loadu_ps(&samples[3][i])};
+        TransposeLines(f0, f1, f2, f3);
+
+        process_vec(f0);
+        process_vec(f1);
+        process_vec(f2);
+        process_vec(f3);
+
+        TransposeLines(f0, f1, f2, f3);
+        _mm_storeu_ps(&samples[0][i], f0);
+        _mm_storeu_ps(&samples[1][i], f1);
+        _mm_storeu_ps(&samples[2][i], f2);
+        _mm_storeu_ps(&samples[3][i], f3);
+    }
+    for(;i < todo;++i)
+    {
+        alignas(16) float f[NUM_LINES]{samples[0][i], samples[1][i], samples[2][i],
+            samples[3][i]};
+        __m128 f4{_mm_load_ps(f)};
+        process_vec(f4);
+        _mm_store_ps(f, f4);
+        for(size_t j{0u};j < NUM_LINES;j++)
+            samples[j][i] = f[j];
+    }
+
+    _mm_store_ps(state[0], hz1);
+    _mm_store_ps(state[1], hz2);
+    _mm_store_ps(state[2], lz1);
+    _mm_store_ps(state[3], lz2);
+
+#elif defined(HAVE_NEON)
+
+    const float32x4_t hb0{vld1q_f32(coeffs[0])}, hb1{vld1q_f32(coeffs[1])};
+    const float32x4_t hb2{vld1q_f32(coeffs[2])}, ha1{vld1q_f32(coeffs[3])};
+    const float32x4_t ha2{vld1q_f32(coeffs[4])};
+    const float32x4_t lb0{vld1q_f32(coeffs[5])}, lb1{vld1q_f32(coeffs[6])};
+    const float32x4_t lb2{vld1q_f32(coeffs[7])}, la1{vld1q_f32(coeffs[8])};
+    const float32x4_t la2{vld1q_f32(coeffs[9])};
+    float32x4_t hz1{vld1q_f32(state[0])}, hz2{vld1q_f32(state[1])};
+    float32x4_t lz1{vld1q_f32(state[2])}, lz2{vld1q_f32(state[3])};
+
+    auto process_vec = [&](float32x4_t &input) noexcept
+    {
+        const float32x4_t tmpout{vaddq_f32(vmulq_f32(input, hb0), hz1)};
+        hz1 = vaddq_f32(vsubq_f32(vmulq_f32(input, hb1), vmulq_f32(tmpout, ha1)), hz2);
+        hz2 = vsubq_f32(vmulq_f32(input, hb2), vmulq_f32(tmpout, ha2));
+
+        const float32x4_t output{vaddq_f32(vmulq_f32(tmpout, lb0), lz1)};
+        lz1 = vaddq_f32(vsubq_f32(vmulq_f32(tmpout, lb1), vmulq_f32(output, la1)), lz2);
+        lz2 = vsubq_f32(vmulq_f32(tmpout, lb2), vmulq_f32(output, la2));
+        input = output;
+    };
+
+    size_t i{0u};
+    for(;todo-i >= 4;i+=4)
+    {
+        float32x4_t f0{vld1q_f32(&samples[0][i])};
+        float32x4_t f1{vld1q_f32(&samples[1][i])};
+        float32x4_t f2{vld1q_f32(&samples[2][i])};
+        float32x4_t f3{vld1q_f32(&samples[3][i])};
+        TransposeLines(f0, f1, f2, f3);
+
+        process_vec(f0);
+        process_vec(f1);
+        process_vec(f2);
+        process_vec(f3);
+
+        TransposeLines(f0, f1, f2, f3);
+        vst1q_f32(&samples[0][i], f0);
+        vst1q_f32(&samples[1][i], f1);
+        vst1q_f32(&samples[2][i], f2);
+        vst1q_f32(&samples[3][i], f3);
+    }
+    for(;i < todo;++i)
+    {
+        alignas(16) float f[NUM_LINES]{samples[0][i], samples[1][i], samples[2][i],
+            samples[3][i]};
+        float32x4_t f4{vld1q_f32(f)};
+        process_vec(f4);
+        vst1q_f32(f, f4);
+        for(size_t j{0u};j < NUM_LINES;j++)
+            samples[j][i] = f[j];
+    }
+
+    vst1q_f32(state[0], hz1);
+    vst1q_f32(state[1], hz2);
+    vst1q_f32(state[2], lz1);
+    vst1q_f32(state[3], lz2);
+
+#else
+
+    for(size_t j{0u};j < NUM_LINES;j++)
+        filters[j].process({samples[j].data(), todo});
+#endif
+
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+    for(size_t j{0u};j < NUM_LINES;j++)
+    {
+        filters[j].HFFilter.setComponents(state[0][j], state[1][j]);
+        filters[j].LFFilter.setComponents(state[2][j], state[3][j]);
     }
+#endif
 }
 
 /* This generates early reflections.
@@ -1499,13 +2082,16 @@ void Modulation::calcDelays(size_t todo)
  *
  * Finally, the lines are reversed (so they feed their opposite directions)
  * and scattered with the FDN matrix before re-feeding the delay lines.
+ *
+ * Without modulation (for the lite reverb), the feedback is read directly
+ * from the late delay lines.
  */
-void ReverbPipeline::processLate(size_t offset, const size_t samplesToDo,
-    const al::span<ReverbUpdateLine, NUM_LINES> tempSamples,
+template<bool Modulate>
+void ReverbPipeline::processLate(const DelayLineI in_delay, size_t offset,
+    const size_t samplesToDo, const al::span<ReverbUpdateLine, NUM_LINES> tempSamples,
     const al::span<FloatBufferLine, NUM_LINES> outSamples)
 {
     const DelayLineI late_delay{mLate.Delay};
-    const DelayLineI in_delay{mLateDelayIn};
     const float mixX{mMixX};
     const float mixY{mMixY};
 
@@ -1517,7 +2103,8 @@ void ReverbPipeline::processLate(size_t offset, const size_t samplesToDo,
         ASSUME(todo > 0);
 
         /* First, calculate the modulated delays for the late feedback. */
-        mLate.Mod.calcDelays(todo);
+        if constexpr(Modulate)
+            mLate.Mod.calcDelays(todo);
 
         /* Next, load decorrelated samples from the main and feedback delay
          * lines. Filter the signal to apply its frequency-dependent decay.
@@ -1540,29 +2127,35 @@ void ReverbPipeline::processLate(size_t offset, const size_t samplesToDo,
                 late_delay_tap1 &= in_delay.Mask;
                 size_t td{minz(todo-i, in_delay.Mask+1 - maxz(late_delay_tap0, late_delay_tap1))};
                 do {
-                    /* Calculate the read offset and offset between it and the
-                     * next sample.
-                     */
-                    const float fdelay{mLate.Mod.ModDelays[i]};
-                    const size_t idelay{float2uint(fdelay * float{gCubicTable.sTableSteps})};
-                    const size_t delay{late_feedb_tap - (idelay>>gCubicTable.sTableBits)};
-                    const size_t delayoffset{idelay & gCubicTable.sTableMask};
-                    ++late_feedb_tap;
-
-                    /* Get the samples around by the delayed offset. */
-                    const float out0{late_delay.Line[(delay  ) & late_delay.Mask][j]};
-                    const float out1{late_delay.Line[(delay-1) & late_delay.Mask][j]};
-                    const float out2{late_delay.Line[(delay-2) & late_delay.Mask][j]};
-                    const float out3{late_delay.Line[(delay-3) & late_delay.Mask][j]};
-
-                    /* The output is obtained by interpolating the four samples
-                     * that were acquired above, and combined with the main
-                     * delay tap.
-                     */
-                    const float out{out0*gCubicTable.getCoeff0(delayoffset)
-                        + out1*gCubicTable.getCoeff1(delayoffset)
-                        + out2*gCubicTable.getCoeff2(delayoffset)
-                        + out3*gCubicTable.getCoeff3(delayoffset)};
+                    float out{};
+                    if constexpr(Modulate)
+                    {
+                        /* Calculate the read offset and offset between it and
+                         * the next sample.
+                         */
+                        const float fdelay{mLate.Mod.ModDelays[i]};
+                        const size_t idelay{float2uint(fdelay * float{gCubicTable.sTableSteps})};
+                        const size_t delay{late_feedb_tap - (idelay>>gCubicTable.sTableBits)};
+                        const size_t delayoffset{idelay & gCubicTable.sTableMask};
+                        ++late_feedb_tap;
+
+                        /* Get the samples around by the delayed offset. */
+                        const float out0{late_delay.Line[(delay  ) & late_delay.Mask][j]};
+                        const float out1{late_delay.Line[(delay-1) & late_delay.Mask][j]};
+                        const float out2{late_delay.Line[(delay-2) & late_delay.Mask][j]};
+                        const float out3{late_delay.Line[(delay-3) & late_delay.Mask][j]};
+
+                        /* The output is obtained by interpolating the four
+                         * samples that were acquired above, and combined with
+                         * the main delay tap.
+                         */
+                        out = out0*gCubicTable.getCoeff0(delayoffset)
+                            + out1*gCubicTable.getCoeff1(delayoffset)
+                            + out2*gCubicTable.getCoeff2(delayoffset)
+                            + out3*gCubicTable.getCoeff3(delayoffset);
+                    }
+                    else
+                        out = late_delay.Line[late_feedb_tap++ & late_delay.Mask][j];
                     const float fade0{densityGain - densityStep*fadeCount};
                     const float fade1{densityStep*fadeCount};
                     fadeCount += 1.0f;
@@ -1573,9 +2166,8 @@ void ReverbPipeline::processLate(size_t offset, const size_t samplesToDo,
                 } while(--td);
             }
             mLateDelayTap[j][0] = mLateDelayTap[j][1];
-
-            mLate.T60[j].process({tempSamples[j].data(), todo});
         }
+        T60FilterLines(mLate.T60, tempSamples, todo);
 
         /* Apply a vector all-pass to improve micro-surface diffusion, and
          * write out the results for mixing.
@@ -1592,6 +2184,79 @@ void ReverbPipeline::processLate(size_t offset, const size_t samplesToDo,
     }
 }
 
+/* This generates the reverb tail like the above, but with the FDN running at a
+ * reduced rate.
+ *
+ * Every late sample lands on a full-rate position that's a multiple of the
+ * divisor. The full-rate late feed is low-pass filtered and decimated at those
+ * positions into the reduced-rate late delay line, the FDN is run over them,
+ * and the output is kept in a reduced-rate history that the polyphase
+ * interpolation filter reads to produce the full-rate output.
+ */
+template<bool Modulate>
+void ReverbPipeline::processLateDecimated(size_t offset, const size_t samplesToDo,
+    const LateResampler &resampler, const al::span<ReverbUpdateLine, NUM_LINES> tempSamples,
+    const al::span<FloatBufferLine, NUM_LINES> outSamples)
+{
+    const DelayLineI feed_delay{mLateDelayIn};
+    const DelayLineI in_delay{mLateDecimated};
+    const DelayLineI out_delay{mLateOut};
+    const uint shift{resampler.Shift};
+    const size_t divisor{size_t{1} << shift};
+    const al::span<const float> decimate{resampler.Decimate.data(),
+        LateResampler::sPhaseTaps << shift};
+
+    ASSUME(samplesToDo > 0);
+    ASSUME(shift > 0);
+
+    /* Find the late samples that land in this update. */
+    const size_t skip{(divisor - (offset&(divisor-1))) & (divisor-1)};
+    const size_t lateCount{(skip < samplesToDo) ? (samplesToDo-skip + divisor-1) >> shift : 0};
+    const size_t lateOffset{(offset+skip) >> shift};
+
+    if(lateCount > 0)
+    {
+        /* All lines share the filter, so they're decimated together. */
+        for(size_t i{0u};i < lateCount;++i)
+        {
+            size_t pos{(lateOffset+i) << shift};
+            std::array<float,NUM_LINES> f{};
+            for(const float coeff : decimate)
+            {
+                const auto &in = feed_delay.Line[pos-- & feed_delay.Mask];
+                for(size_t j{0u};j < NUM_LINES;j++)
+                    f[j] += in[j] * coeff;
+            }
+            in_delay.Line[(lateOffset+i) & in_delay.Mask] = f;
+        }
+
+        processLate<Modulate>(in_delay, lateOffset, lateCount, tempSamples, outSamples);
+        for(size_t j{0u};j < NUM_LINES;j++)
+            out_delay.write(lateOffset, j, outSamples[j].data(), lateCount);
+    }
+
+    /* Interpolate the late output back to the full rate. Each full-rate
+     * sample uses the filter phase for its position between late samples,
+     * applied to the most recent late samples.
+     */
+    for(size_t i{0u};i < samplesToDo;++i)
+    {
+        const size_t pos{offset + i};
+        const auto &coeffs = resampler.Interpolate[pos & (divisor-1)];
+        size_t latepos{pos >> shift};
+
+        std::array<float,NUM_LINES> f{};
+        for(const float coeff : coeffs)
+        {
+            const auto &in = out_delay.Line[latepos-- & out_delay.Mask];
+            for(size_t j{0u};j < NUM_LINES;j++)
+                f[j] += in[j] * coeff;
+        }
+        for(size_t j{0u};j < NUM_LINES;j++)
+            outSamples[j][i] = f[j];
+    }
+}
+
 void ReverbState::process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
 {
     const size_t offset{mOffset};
@@ -1700,7 +2365,10 @@ void ReverbState::process(const size_t samplesToDo, const al::span<const FloatBu
 
     /* Process reverb for these samples. and mix them to the output. */
     pipeline.processEarly(offset, samplesToDo, mTempSamples, mEarlySamples);
-    pipeline.processLate(offset, samplesToDo, mTempSamples, mLateSamples);
+    if(mLite)
+        processLate<false>(pipeline, offset, samplesToDo);
+    else
+        processLate<true>(pipeline, offset, samplesToDo);
     mixOut(pipeline, samplesOut, samplesToDo);
 
     if(mPipelineState != Normal)
@@ -1736,7 +2404,7 @@ void ReverbState::process(const size_t samplesToDo, const al::span<const FloatBu
 
             /* Process the old reverb for these samples. */
             oldpipeline.processEarly(offset, samplesToDo, mTempSamples, mEarlySamples);
-            oldpipeline.processLate(offset, samplesToDo, mTempSamples, mLateSamples);
+            processLate<true>(oldpipeline, offset, samplesToDo);
             mixOut(oldpipeline, samplesOut, samplesToDo);
         }
     }
@@ -38,6 +38,10 @@
 #include <functional>
 #include <iterator>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#endif
+
 #include "alc/effects/base.h"
 #include "almalloc.h"
 #include "alnumbers.h"
@@ -141,6 +145,91 @@ struct FormantFilter
 };
 
 
+#ifdef HAVE_SSE_INTRINSICS
+/* Processes both vowels' formant filters together, as two 4-lane banks fed
+ * the same input, and blends them with the LFO. Each sample's lanes are
+ * summed four samples at a time by transposing them.
+ */
+void ProcessFormantBank(FormantFilter (&formants)[NUM_FILTERS][NUM_FORMANTS],
+    const float *RESTRICT samplesIn, const float *RESTRICT lfo, float *RESTRICT samplesOut,
+    const size_t todo)
+{
+    struct Bank {
+        __m128 g, h, k, gain, s1, s2;
+    };
+    auto load_bank = [](const FormantFilter (&filters)[NUM_FORMANTS]) noexcept -> Bank
+    {
+        Bank bank;
+        bank.g = _mm_setr_ps(filters[0].mCoeff, filters[1].mCoeff, filters[2].mCoeff,
+            filters[3].mCoeff);
+        bank.h = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_add_ps(_mm_set1_ps(1.0f),
+            _mm_mul_ps(bank.g, _mm_set1_ps(1.0f/Q_FACTOR))), _mm_mul_ps(bank.g, bank.g)));
+        bank.k = _mm_add_ps(_mm_set1_ps(1.0f/Q_FACTOR), bank.g);
+        bank.gain = _mm_setr_ps(filters[0].mGain, filters[1].mGain, filters[2].mGain,
+            filters[3].mGain);
+        bank.s1 = _mm_setr_ps(filters[0].mS1, filters[1].mS1, filters[2].mS1, filters[3].mS1);
+        bank.s2 = _mm_setr_ps(filters[0].mS2, filters[1].mS2, filters[2].mS2, filters[3].mS2);
+        return bank;
+    };
+    auto store_bank = [](const Bank &bank, FormantFilter (&filters)[NUM_FORMANTS]) noexcept
+    {
+        alignas(16) float s1[NUM_FORMANTS], s2[NUM_FORMANTS];
+        _mm_store_ps(s1, bank.s1);
+        _mm_store_ps(s2, bank.s2);
+        for(size_t i{0u};i < NUM_FORMANTS;++i)
+        {
+            filters[i].mS1 = s1[i];
+            filters[i].mS2 = s2[i];
+        }
+    };
+    /* Returns the peak outputs of the bank's filters for the input. */
+    auto proc_bank = [](Bank &bank, const __m128 input) noexcept -> __m128
+    {
+        const __m128 H{_mm_mul_ps(_mm_sub_ps(_mm_sub_ps(input, _mm_mul_ps(bank.k, bank.s1)),
+            bank.s2), bank.h)};
+        const __m128 B{_mm_add_ps(_mm_mul_ps(bank.g, H), bank.s1)};
+        const __m128 L{_mm_add_ps(_mm_mul_ps(bank.g, B), bank.s2)};
+
+        bank.s1 = _mm_add_ps(_mm_mul_ps(bank.g, H), B);
+        bank.s2 = _mm_add_ps(_mm_mul_ps(bank.g, B), L);
+        return _mm_mul_ps(B, bank.gain);
+    };
+
+    Bank vowelA{load_bank(formants[VOWEL_A_INDEX])};
+    Bank vowelB{load_bank(formants[VOWEL_B_INDEX])};
+    /* Gets each formant's output, blended between the vowels. */
+    auto proc_sample = [&vowelA,&vowelB,proc_bank](const float input, const float mu) noexcept
+    {
+        const __m128 in4{_mm_set1_ps(input)};
+        const __m128 a{proc_bank(vowelA, in4)};
+        const __m128 b{proc_bank(vowelB, in4)};
+        return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(mu)));
+    };
+
+    size_t i{0u};
+    for(;todo-i >= 4;i += 4)
+    {
+        __m128 r0{proc_sample(samplesIn[i  ], lfo[i  ])};
+        __m128 r1{proc_sample(samplesIn[i+1], lfo[i+1])};
+        __m128 r2{proc_sample(samplesIn[i+2], lfo[i+2])};
+        __m128 r3{proc_sample(samplesIn[i+3], lfo[i+3])};
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(&samplesOut[i], _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3)));
+    }
+    for(;i < todo;++i)
+    {
+        __m128 r{proc_sample(samplesIn[i], lfo[i])};
+        r = _mm_add_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 1, 2, 3)));
+        r = _mm_add_ps(r, _mm_movehl_ps(r, r));
+        samplesOut[i] = _mm_cvtss_f32(r);
+    }
+
+    store_bank(vowelA, formants[VOWEL_A_INDEX]);
+    store_bank(vowelB, formants[VOWEL_B_INDEX]);
+}
+#endif
+
+
 struct VmorpherState final : public EffectState {
     struct {
         uint mTargetChannel{InvalidChannelIndex};
@@ -244,7 +333,7 @@ void VmorpherState::update(const ContextBase *context, const EffectSlot *slot,
     const EffectProps *props, const EffectTarget target)
 {
     const DeviceBase *device{context->mDevice};
-    const float frequency{static_cast<float>(device->Frequency)};
+    const float frequency{static_cast<float>(device->MixFrequency)};
     const float step{props->Vmorpher.Rate / frequency};
     mStep = fastf2u(clampf(step*WAVEFORM_FRACONE, 0.0f, float{WAVEFORM_FRACONE-1}));
 
@@ -304,6 +393,10 @@ void VmorpherState::process(const size_t samplesToDo, const al::span<const Float
                 continue;
             }
 
+            alignas(16) float blended[MAX_UPDATE_SAMPLES];
+#ifdef HAVE_SSE_INTRINSICS
+            ProcessFormantBank(chandata->mFormants, &input[base], mLfo, blended, td);
+#else
             auto& vowelA = chandata->mFormants[VOWEL_A_INDEX];
             auto& vowelB = chandata->mFormants[VOWEL_B_INDEX];
 
@@ -321,9 +414,9 @@ void VmorpherState::process(const size_t samplesToDo, const al::span<const Float
             vowelB[2].process(&input[base], mSampleBufferB, td);
             vowelB[3].process(&input[base], mSampleBufferB, td);
 
-            alignas(16) float blended[MAX_UPDATE_SAMPLES];
             for(size_t i{0u};i < td;i++)
                 blended[i] = lerpf(mSampleBufferA[i], mSampleBufferB[i], mLfo[i]);
+#endif
 
             /* Now, mix the processed sound data to the output. */
             MixSamples({blended, td}, samplesOut[outidx].data()+base, chandata->mCurrentGain,
@@ -15,6 +15,7 @@ enum class EventType : uint8_t {
     DefaultDeviceChanged,
     DeviceAdded,
     DeviceRemoved,
+    HrtfChanged,
 
     Count
 };
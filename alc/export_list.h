@@ -45,6 +45,7 @@ inline const FuncExport alcFunctions[]{
     DECL(alcLoopbackOpenDeviceSOFT),
     DECL(alcIsRenderFormatSupportedSOFT),
     DECL(alcRenderSamplesSOFT),
+    DECL(alcRenderSamplesPlanarSOFT),
 
     DECL(alcDevicePauseSOFT),
     DECL(alcDeviceResumeSOFT),
@@ -189,10 +190,17 @@ inline const FuncExport alcFunctions[]{
 
     DECL(alEventControlSOFT),
     DECL(alEventCallbackSOFT),
+    DECL(alEventBatchCallbackSOFT),
+    DECL(alPollEventsSOFT),
     DECL(alGetPointerSOFT),
     DECL(alGetPointervSOFT),
 
     DECL(alBufferCallbackSOFT),
+    DECL(alBufferRingSOFT),
+    DECL(alBufferFileSOFT),
+    DECL(alBufferDataAsyncSOFT),
+    DECL(alMapBufferRingSOFT),
+    DECL(alCommitBufferRingSOFT),
     DECL(alGetBufferPtrSOFT),
     DECL(alGetBuffer3PtrSOFT),
     DECL(alGetBufferPtrvSOFT),
@@ -205,6 +213,24 @@ inline const FuncExport alcFunctions[]{
     DECL(alSourcePlayAtTimeSOFT),
     DECL(alSourcePlayAtTimevSOFT),
 
+    DECL(alSourceBatchfvSOFT),
+
+    DECL(alGenSourceGroupsSOFT),
+    DECL(alDeleteSourceGroupsSOFT),
+    DECL(alIsSourceGroupSOFT),
+    DECL(alSourceGroupfSOFT),
+    DECL(alSourceGroupiSOFT),
+    DECL(alSourceGroup3iSOFT),
+    DECL(alGetSourceGroupfSOFT),
+
+    DECL(alSourceRampfSOFT),
+    DECL(alSourceSendRampfSOFT),
+
+    DECL(alListenerIndexedfvSOFT),
+    DECL(alGetListenerIndexedfvSOFT),
+
+    DECL(alTrimPropertyMemorySOFT),
+
     DECL(alBufferSubDataSOFT),
 
     DECL(alBufferDataStatic),
@@ -235,7 +261,7 @@ inline const FuncExport alcFunctions[]{
 
     DECL(alGetErrorDirect),
     DECL(alIsExtensionPresentDirect),
-    DECL(alGetProcAddress),
+    DECL(alGetProcAddressDirect),
     DECL(alGetEnumValueDirect),
 
     DECL(alListeneriDirect),
@@ -339,6 +365,14 @@ inline const FuncExport alcFunctions[]{
     DECL(alMapBufferDirectSOFT),
     DECL(alUnmapBufferDirectSOFT),
     DECL(alFlushMappedBufferDirectSOFT),
+    DECL(alBufferRingDirectSOFT),
+    DECL(alBufferFileDirectSOFT),
+    DECL(alBufferDataAsyncDirectSOFT),
+    DECL(alMapBufferRingDirectSOFT),
+    DECL(alCommitBufferRingDirectSOFT),
+    DECL(alGetBufferPtrDirectSOFT),
+    DECL(alGetBuffer3PtrDirectSOFT),
+    DECL(alGetBufferPtrvDirectSOFT),
 
     DECL(alSourcei64DirectSOFT),
     DECL(alSource3i64DirectSOFT),
@@ -354,9 +388,31 @@ inline const FuncExport alcFunctions[]{
     DECL(alGetSourcedvDirectSOFT),
     DECL(alSourcePlayAtTimeDirectSOFT),
     DECL(alSourcePlayAtTimevDirectSOFT),
+    DECL(alSourceBatchfvDirectSOFT),
+    DECL(alGenSourceGroupsDirectSOFT),
+    DECL(alDeleteSourceGroupsDirectSOFT),
+    DECL(alIsSourceGroupDirectSOFT),
+    DECL(alSourceGroupfDirectSOFT),
+    DECL(alSourceGroupiDirectSOFT),
+    DECL(alSourceGroup3iDirectSOFT),
+    DECL(alGetSourceGroupfDirectSOFT),
+    DECL(alSourceRampfDirectSOFT),
+    DECL(alSourceSendRampfDirectSOFT),
+    DECL(alListenerIndexedfvDirectSOFT),
+    DECL(alGetListenerIndexedfvDirectSOFT),
+    DECL(alTrimPropertyMemoryDirectSOFT),
+
+    DECL(alAuxiliaryEffectSlotPlayDirectSOFT),
+    DECL(alAuxiliaryEffectSlotPlayvDirectSOFT),
+    DECL(alAuxiliaryEffectSlotStopDirectSOFT),
+    DECL(alAuxiliaryEffectSlotStopvDirectSOFT),
 
     DECL(alEventControlDirectSOFT),
     DECL(alEventCallbackDirectSOFT),
+    DECL(alEventBatchCallbackDirectSOFT),
+    DECL(alPollEventsDirectSOFT),
+    DECL(alGetPointerDirectSOFT),
+    DECL(alGetPointervDirectSOFT),
 
     DECL(alDebugMessageCallbackDirectEXT),
     DECL(alDebugMessageInsertDirectEXT),
@@ -367,6 +423,11 @@ inline const FuncExport alcFunctions[]{
 
     DECL(alcEventControlSOFT),
     DECL(alcEventCallbackSOFT),
+
+    DECL(alcCaptureMapSamplesSOFT),
+    DECL(alcCaptureUnmapSamplesSOFT),
+
+    DECL(alcCaptureCallbackSOFT),
 #ifdef ALSOFT_EAX
 }, eaxFunctions[]{
     DECL(EAXGet),
@@ -790,6 +851,9 @@ inline const EnumExport alcEnumerations[]{
     DECL(AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT),
     DECL(AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT),
     DECL(AL_EVENT_TYPE_DISCONNECTED_SOFT),
+    DECL(AL_EVENT_BATCH_CALLBACK_FUNCTION_SOFT),
+    DECL(AL_EVENT_BATCH_CALLBACK_USER_PARAM_SOFT),
+    DECL(ALC_EVENT_POLLING_SOFT),
 
     DECL(AL_DROP_UNMATCHED_SOFT),
     DECL(AL_REMIX_UNMATCHED_SOFT),
@@ -863,6 +927,57 @@ inline const EnumExport alcEnumerations[]{
     DECL(AL_STACK_UNDERFLOW_EXT),
 
     DECL(AL_STOP_SOURCES_ON_DISCONNECT_SOFT),
+
+    DECL(ALC_VOICE_BUDGET_SOFT),
+    DECL(AL_SOURCE_PRIORITY_SOFT),
+
+    DECL(ALC_MIXER_PROFILE_SOFT),
+    DECL(ALC_MIXER_PROFILE_HISTORY_SOFT),
+
+    DECL(ALC_HRTF_ASYNC_SOFT),
+    DECL(ALC_EVENT_TYPE_HRTF_CHANGED_SOFT),
+
+    DECL(ALC_HRTF_AMBISONIC_ORDER_SOFT),
+
+    DECL(AL_PROPERTY_MEMORY_SIZE_SOFT),
+    DECL(AL_PROPERTY_MEMORY_FREE_SOFT),
+
+    DECL(ALC_MIX_QUALITY_SOFT),
+
+    DECL(AL_EVENT_TYPE_BUFFER_LOADED_SOFT),
+    DECL(AL_BUFFER_LOADING_SOFT),
+
+    DECL(AL_FORMAT_MONO_HALF_SOFT),
+    DECL(AL_FORMAT_STEREO_HALF_SOFT),
+
+    DECL(ALC_MEMORY_STATS_SOFT),
+
+    DECL(AL_SOURCE_GROUP_SOFT),
+
+    DECL(AL_QUEUE_LOW_WATERMARK_SOFT),
+    DECL(AL_EVENT_TYPE_QUEUE_LOW_WATERMARK_SOFT),
+
+    DECL(AL_RAMP_LINEAR_SOFT),
+    DECL(AL_RAMP_EXPONENTIAL_SOFT),
+    DECL(AL_DIRECT_FILTER_GAIN_SOFT),
+    DECL(AL_DIRECT_FILTER_GAINHF_SOFT),
+    DECL(AL_AUXILIARY_SEND_FILTER_GAIN_SOFT),
+    DECL(AL_AUXILIARY_SEND_FILTER_GAINHF_SOFT),
+
+    DECL(AL_NUM_LISTENERS_SOFT),
+    DECL(AL_MAX_LISTENERS_SOFT),
+
+    DECL(ALC_RESERVED_SOURCES_SOFT),
+    DECL(ALC_RESERVED_VOICES_SOFT),
+    DECL(ALC_RESERVED_BUFFERS_SOFT),
+    DECL(ALC_RESERVED_EFFECT_SLOTS_SOFT),
+    DECL(ALC_RESERVED_PROPS_SOFT),
+    DECL(ALC_RESERVED_VOICE_CHANGES_SOFT),
+
+    DECL(ALC_MIXER_AFFINITY_SOFT),
+    DECL(ALC_WORKER_AFFINITY_SOFT),
+
+    DECL(AL_SOURCE_MIX_TIME_SOFT),
 #ifdef ALSOFT_EAX
 }, eaxEnumerations[]{
     DECL(AL_EAX_RAM_SIZE),
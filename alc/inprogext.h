@@ -62,6 +62,262 @@ AL_API void AL_APIENTRY alAuxiliaryEffectSlotStopvSOFT(ALsizei n, const ALuint *
 #define AL_STOP_SOURCES_ON_DISCONNECT_SOFT       0x19AB
 #endif
 
+#ifndef AL_SOFT_voice_budget
+#define AL_SOFT_voice_budget
+#define ALC_VOICE_BUDGET_SOFT                    0x19D4
+#define AL_SOURCE_PRIORITY_SOFT                  0x19D5
+#endif
+
+#ifndef ALC_SOFT_mixer_profile
+#define ALC_SOFT_mixer_profile
+#define ALC_MIXER_PROFILE_SOFT                   0x19D6
+#define ALC_MIXER_PROFILE_HISTORY_SOFT           0x19D7
+#endif
+
+#ifndef ALC_SOFT_async_hrtf
+#define ALC_SOFT_async_hrtf
+#define ALC_HRTF_ASYNC_SOFT                      0x19D8
+#define ALC_EVENT_TYPE_HRTF_CHANGED_SOFT         0x19D9
+#endif
+
+#ifndef ALC_SOFT_hrtf_ambisonic_mixing
+#define ALC_SOFT_hrtf_ambisonic_mixing
+#define ALC_HRTF_AMBISONIC_ORDER_SOFT            0x19DA
+#endif
+
+#ifndef AL_SOFT_ring_buffer
+#define AL_SOFT_ring_buffer
+typedef void (AL_APIENTRY*LPALBUFFERRINGSOFT)(ALuint buffer, ALenum format, ALsizei size, ALsizei freq) AL_API_NOEXCEPT17;
+typedef void* (AL_APIENTRY*LPALMAPBUFFERRINGSOFT)(ALuint buffer, ALsizei *length) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALCOMMITBUFFERRINGSOFT)(ALuint buffer, ALsizei length) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALBUFFERRINGDIRECTSOFT)(ALCcontext *context, ALuint buffer, ALenum format, ALsizei size, ALsizei freq) AL_API_NOEXCEPT17;
+typedef void* (AL_APIENTRY*LPALMAPBUFFERRINGDIRECTSOFT)(ALCcontext *context, ALuint buffer, ALsizei *length) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALCOMMITBUFFERRINGDIRECTSOFT)(ALCcontext *context, ALuint buffer, ALsizei length) AL_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferRingSOFT(ALuint buffer, ALenum format, ALsizei size, ALsizei freq) AL_API_NOEXCEPT;
+AL_API void* AL_APIENTRY alMapBufferRingSOFT(ALuint buffer, ALsizei *length) AL_API_NOEXCEPT;
+AL_API void AL_APIENTRY alCommitBufferRingSOFT(ALuint buffer, ALsizei length) AL_API_NOEXCEPT;
+void AL_APIENTRY alBufferRingDirectSOFT(ALCcontext *context, ALuint buffer, ALenum format, ALsizei size, ALsizei freq) AL_API_NOEXCEPT;
+void* AL_APIENTRY alMapBufferRingDirectSOFT(ALCcontext *context, ALuint buffer, ALsizei *length) AL_API_NOEXCEPT;
+void AL_APIENTRY alCommitBufferRingDirectSOFT(ALCcontext *context, ALuint buffer, ALsizei length) AL_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef AL_SOFT_file_buffer
+#define AL_SOFT_file_buffer
+typedef void (AL_APIENTRY*LPALBUFFERFILESOFT)(ALuint buffer, ALenum format, const ALchar *filename, ALint64SOFT offset, ALsizei size, ALsizei freq) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALBUFFERFILEDIRECTSOFT)(ALCcontext *context, ALuint buffer, ALenum format, const ALchar *filename, ALint64SOFT offset, ALsizei size, ALsizei freq) AL_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferFileSOFT(ALuint buffer, ALenum format, const ALchar *filename, ALint64SOFT offset, ALsizei size, ALsizei freq) AL_API_NOEXCEPT;
+void AL_APIENTRY alBufferFileDirectSOFT(ALCcontext *context, ALuint buffer, ALenum format, const ALchar *filename, ALint64SOFT offset, ALsizei size, ALsizei freq) AL_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef AL_SOFT_source_batch
+#define AL_SOFT_source_batch
+typedef void (AL_APIENTRY*LPALSOURCEBATCHFVSOFT)(ALsizei count, const ALuint *sources, ALsizei numprops, const ALenum *props, const ALfloat *const *values) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALSOURCEBATCHFVDIRECTSOFT)(ALCcontext *context, ALsizei count, const ALuint *sources, ALsizei numprops, const ALenum *props, const ALfloat *const *values) AL_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alSourceBatchfvSOFT(ALsizei count, const ALuint *sources, ALsizei numprops, const ALenum *props, const ALfloat *const *values) AL_API_NOEXCEPT;
+void AL_APIENTRY alSourceBatchfvDirectSOFT(ALCcontext *context, ALsizei count, const ALuint *sources, ALsizei numprops, const ALenum *props, const ALfloat *const *values) AL_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef AL_SOFT_property_memory
+#define AL_SOFT_property_memory
+#define AL_PROPERTY_MEMORY_SIZE_SOFT             0x19DB
+#define AL_PROPERTY_MEMORY_FREE_SOFT             0x19DC
+typedef void (AL_APIENTRY*LPALTRIMPROPERTYMEMORYSOFT)(void) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALTRIMPROPERTYMEMORYDIRECTSOFT)(ALCcontext *context) AL_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alTrimPropertyMemorySOFT(void) AL_API_NOEXCEPT;
+void AL_APIENTRY alTrimPropertyMemoryDirectSOFT(ALCcontext *context) AL_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef ALC_SOFT_load_governor
+#define ALC_SOFT_load_governor
+#define ALC_MIX_QUALITY_SOFT                     0x19DE
+#endif
+
+#ifndef ALC_SOFT_capture_map
+#define ALC_SOFT_capture_map
+typedef const ALCvoid* (ALC_APIENTRY*LPALCCAPTUREMAPSAMPLESSOFT)(ALCdevice *device, ALCsizei *samples) ALC_API_NOEXCEPT17;
+typedef void (ALC_APIENTRY*LPALCCAPTUREUNMAPSAMPLESSOFT)(ALCdevice *device, ALCsizei samples) ALC_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+const ALCvoid* ALC_APIENTRY alcCaptureMapSamplesSOFT(ALCdevice *device, ALCsizei *samples) ALC_API_NOEXCEPT;
+void ALC_APIENTRY alcCaptureUnmapSamplesSOFT(ALCdevice *device, ALCsizei samples) ALC_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef ALC_SOFT_offline_render
+#define ALC_SOFT_offline_render
+#define ALC_OFFLINE_RENDER_SOFT                  0x19FB
+#endif
+
+#ifndef ALC_SOFT_loopback_planar
+#define ALC_SOFT_loopback_planar
+typedef void (ALC_APIENTRY*LPALCRENDERSAMPLESPLANARSOFT)(ALCdevice *device, ALCfloat **channels, ALCsizei samples) ALC_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+void ALC_APIENTRY alcRenderSamplesPlanarSOFT(ALCdevice *device, ALCfloat **channels, ALCsizei samples) ALC_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef AL_SOFT_event_batch
+#define AL_SOFT_event_batch
+#define AL_EVENT_BATCH_CALLBACK_FUNCTION_SOFT    0x19DF
+#define AL_EVENT_BATCH_CALLBACK_USER_PARAM_SOFT  0x19E0
+#define ALC_EVENT_POLLING_SOFT                   0x19E1
+typedef struct ALeventRecordSOFT {
+    ALint64SOFT timestamp;
+    ALenum type;
+    ALuint object;
+    ALuint param;
+    ALuint reserved;
+} ALeventRecordSOFT;
+typedef void (AL_APIENTRY*ALEVENTBATCHPROCSOFT)(ALsizei count, const ALeventRecordSOFT *events, void *userParam) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALEVENTBATCHCALLBACKSOFT)(ALEVENTBATCHPROCSOFT callback, void *userParam) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALEVENTBATCHCALLBACKDIRECTSOFT)(ALCcontext *context, ALEVENTBATCHPROCSOFT callback, void *userParam) AL_API_NOEXCEPT17;
+typedef ALsizei (AL_APIENTRY*LPALPOLLEVENTSSOFT)(ALsizei count, ALeventRecordSOFT *events) AL_API_NOEXCEPT17;
+typedef ALsizei (AL_APIENTRY*LPALPOLLEVENTSDIRECTSOFT)(ALCcontext *context, ALsizei count, ALeventRecordSOFT *events) AL_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alEventBatchCallbackSOFT(ALEVENTBATCHPROCSOFT callback, void *userParam) AL_API_NOEXCEPT;
+void AL_APIENTRY alEventBatchCallbackDirectSOFT(ALCcontext *context, ALEVENTBATCHPROCSOFT callback, void *userParam) AL_API_NOEXCEPT;
+AL_API ALsizei AL_APIENTRY alPollEventsSOFT(ALsizei count, ALeventRecordSOFT *events) AL_API_NOEXCEPT;
+ALsizei AL_APIENTRY alPollEventsDirectSOFT(ALCcontext *context, ALsizei count, ALeventRecordSOFT *events) AL_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef AL_SOFT_async_buffer
+#define AL_SOFT_async_buffer
+#define AL_EVENT_TYPE_BUFFER_LOADED_SOFT         0x19E2
+#define AL_BUFFER_LOADING_SOFT                   0x19E3
+typedef void (AL_APIENTRY*LPALBUFFERDATAASYNCSOFT)(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALBUFFERDATAASYNCDIRECTSOFT)(ALCcontext *context, ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq) AL_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferDataAsyncSOFT(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq) AL_API_NOEXCEPT;
+void AL_APIENTRY alBufferDataAsyncDirectSOFT(ALCcontext *context, ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq) AL_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef AL_SOFT_buffer_half_float
+#define AL_SOFT_buffer_half_float
+#define AL_FORMAT_MONO_HALF_SOFT                 0x19E4
+#define AL_FORMAT_STEREO_HALF_SOFT               0x19E5
+#endif
+
+#ifndef ALC_SOFT_memory_stats
+#define ALC_SOFT_memory_stats
+#define ALC_MEMORY_STATS_SOFT                    0x19E6
+#endif
+
+#ifndef AL_SOFT_source_groups
+#define AL_SOFT_source_groups
+#define AL_SOURCE_GROUP_SOFT                     0x19E7
+typedef void (AL_APIENTRY*LPALGENSOURCEGROUPSSOFT)(ALsizei n, ALuint *groups) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALDELETESOURCEGROUPSSOFT)(ALsizei n, const ALuint *groups) AL_API_NOEXCEPT17;
+typedef ALboolean (AL_APIENTRY*LPALISSOURCEGROUPSOFT)(ALuint group) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALSOURCEGROUPFSOFT)(ALuint group, ALenum param, ALfloat value) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALSOURCEGROUPISOFT)(ALuint group, ALenum param, ALint value) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALSOURCEGROUP3ISOFT)(ALuint group, ALenum param, ALint value1, ALint value2, ALint value3) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALGETSOURCEGROUPFSOFT)(ALuint group, ALenum param, ALfloat *value) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALGENSOURCEGROUPSDIRECTSOFT)(ALCcontext *context, ALsizei n, ALuint *groups) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALDELETESOURCEGROUPSDIRECTSOFT)(ALCcontext *context, ALsizei n, const ALuint *groups) AL_API_NOEXCEPT17;
+typedef ALboolean (AL_APIENTRY*LPALISSOURCEGROUPDIRECTSOFT)(ALCcontext *context, ALuint group) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALSOURCEGROUPFDIRECTSOFT)(ALCcontext *context, ALuint group, ALenum param, ALfloat value) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALSOURCEGROUPIDIRECTSOFT)(ALCcontext *context, ALuint group, ALenum param, ALint value) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALSOURCEGROUP3IDIRECTSOFT)(ALCcontext *context, ALuint group, ALenum param, ALint value1, ALint value2, ALint value3) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALGETSOURCEGROUPFDIRECTSOFT)(ALCcontext *context, ALuint group, ALenum param, ALfloat *value) AL_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alGenSourceGroupsSOFT(ALsizei n, ALuint *groups) AL_API_NOEXCEPT;
+AL_API void AL_APIENTRY alDeleteSourceGroupsSOFT(ALsizei n, const ALuint *groups) AL_API_NOEXCEPT;
+AL_API ALboolean AL_APIENTRY alIsSourceGroupSOFT(ALuint group) AL_API_NOEXCEPT;
+AL_API void AL_APIENTRY alSourceGroupfSOFT(ALuint group, ALenum param, ALfloat value) AL_API_NOEXCEPT;
+AL_API void AL_APIENTRY alSourceGroupiSOFT(ALuint group, ALenum param, ALint value) AL_API_NOEXCEPT;
+AL_API void AL_APIENTRY alSourceGroup3iSOFT(ALuint group, ALenum param, ALint value1, ALint value2, ALint value3) AL_API_NOEXCEPT;
+AL_API void AL_APIENTRY alGetSourceGroupfSOFT(ALuint group, ALenum param, ALfloat *value) AL_API_NOEXCEPT;
+void AL_APIENTRY alGenSourceGroupsDirectSOFT(ALCcontext *context, ALsizei n, ALuint *groups) AL_API_NOEXCEPT;
+void AL_APIENTRY alDeleteSourceGroupsDirectSOFT(ALCcontext *context, ALsizei n, const ALuint *groups) AL_API_NOEXCEPT;
+ALboolean AL_APIENTRY alIsSourceGroupDirectSOFT(ALCcontext *context, ALuint group) AL_API_NOEXCEPT;
+void AL_APIENTRY alSourceGroupfDirectSOFT(ALCcontext *context, ALuint group, ALenum param, ALfloat value) AL_API_NOEXCEPT;
+void AL_APIENTRY alSourceGroupiDirectSOFT(ALCcontext *context, ALuint group, ALenum param, ALint value) AL_API_NOEXCEPT;
+void AL_APIENTRY alSourceGroup3iDirectSOFT(ALCcontext *context, ALuint group, ALenum param, ALint value1, ALint value2, ALint value3) AL_API_NOEXCEPT;
+void AL_APIENTRY alGetSourceGroupfDirectSOFT(ALCcontext *context, ALuint group, ALenum param, ALfloat *value) AL_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef AL_SOFT_queue_low_watermark
+#define AL_SOFT_queue_low_watermark
+#define AL_QUEUE_LOW_WATERMARK_SOFT              0x19E8
+#define AL_EVENT_TYPE_QUEUE_LOW_WATERMARK_SOFT   0x19E9
+#endif
+
+#ifndef AL_SOFT_source_ramps
+#define AL_SOFT_source_ramps
+#define AL_RAMP_LINEAR_SOFT                      0x19EA
+#define AL_RAMP_EXPONENTIAL_SOFT                 0x19EB
+#define AL_DIRECT_FILTER_GAIN_SOFT               0x19EC
+#define AL_DIRECT_FILTER_GAINHF_SOFT             0x19ED
+#define AL_AUXILIARY_SEND_FILTER_GAIN_SOFT       0x19EE
+#define AL_AUXILIARY_SEND_FILTER_GAINHF_SOFT     0x19EF
+typedef void (AL_APIENTRY*LPALSOURCERAMPFSOFT)(ALuint source, ALenum param, ALfloat value, ALfloat seconds, ALenum curve) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALSOURCESENDRAMPFSOFT)(ALuint source, ALint send, ALenum param, ALfloat value, ALfloat seconds, ALenum curve) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALSOURCERAMPFDIRECTSOFT)(ALCcontext *context, ALuint source, ALenum param, ALfloat value, ALfloat seconds, ALenum curve) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALSOURCESENDRAMPFDIRECTSOFT)(ALCcontext *context, ALuint source, ALint send, ALenum param, ALfloat value, ALfloat seconds, ALenum curve) AL_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alSourceRampfSOFT(ALuint source, ALenum param, ALfloat value, ALfloat seconds, ALenum curve) AL_API_NOEXCEPT;
+AL_API void AL_APIENTRY alSourceSendRampfSOFT(ALuint source, ALint send, ALenum param, ALfloat value, ALfloat seconds, ALenum curve) AL_API_NOEXCEPT;
+void AL_APIENTRY alSourceRampfDirectSOFT(ALCcontext *context, ALuint source, ALenum param, ALfloat value, ALfloat seconds, ALenum curve) AL_API_NOEXCEPT;
+void AL_APIENTRY alSourceSendRampfDirectSOFT(ALCcontext *context, ALuint source, ALint send, ALenum param, ALfloat value, ALfloat seconds, ALenum curve) AL_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef AL_SOFT_multi_listener
+#define AL_SOFT_multi_listener
+#define AL_NUM_LISTENERS_SOFT                    0x19F0
+#define AL_MAX_LISTENERS_SOFT                    0x19F1
+typedef void (AL_APIENTRY*LPALLISTENERINDEXEDFVSOFT)(ALuint listener, ALenum param, const ALfloat *values) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALGETLISTENERINDEXEDFVSOFT)(ALuint listener, ALenum param, ALfloat *values) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALLISTENERINDEXEDFVDIRECTSOFT)(ALCcontext *context, ALuint listener, ALenum param, const ALfloat *values) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY*LPALGETLISTENERINDEXEDFVDIRECTSOFT)(ALCcontext *context, ALuint listener, ALenum param, ALfloat *values) AL_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alListenerIndexedfvSOFT(ALuint listener, ALenum param, const ALfloat *values) AL_API_NOEXCEPT;
+AL_API void AL_APIENTRY alGetListenerIndexedfvSOFT(ALuint listener, ALenum param, ALfloat *values) AL_API_NOEXCEPT;
+void AL_APIENTRY alListenerIndexedfvDirectSOFT(ALCcontext *context, ALuint listener, ALenum param, const ALfloat *values) AL_API_NOEXCEPT;
+void AL_APIENTRY alGetListenerIndexedfvDirectSOFT(ALCcontext *context, ALuint listener, ALenum param, ALfloat *values) AL_API_NOEXCEPT;
+#endif
+#endif
+
+#ifndef ALC_SOFT_reserve_storage
+#define ALC_SOFT_reserve_storage
+#define ALC_RESERVED_SOURCES_SOFT                0x19F2
+#define ALC_RESERVED_VOICES_SOFT                 0x19F3
+#define ALC_RESERVED_BUFFERS_SOFT                0x19F4
+#define ALC_RESERVED_EFFECT_SLOTS_SOFT           0x19F5
+#define ALC_RESERVED_PROPS_SOFT                  0x19F6
+#define ALC_RESERVED_VOICE_CHANGES_SOFT          0x19F7
+#endif
+
+#ifndef ALC_SOFT_thread_affinity
+#define ALC_SOFT_thread_affinity
+#define ALC_MIXER_AFFINITY_SOFT                  0x19F8
+#define ALC_WORKER_AFFINITY_SOFT                 0x19F9
+#endif
+
+#ifndef AL_SOFT_source_mix_time
+#define AL_SOFT_source_mix_time
+#define AL_SOURCE_MIX_TIME_SOFT                  0x19FA
+#endif
+
+#ifndef ALC_SOFT_capture_callback
+#define ALC_SOFT_capture_callback
+typedef void (ALC_APIENTRY*ALCCAPTURECALLBACKTYPESOFT)(ALCvoid *userptr, const ALCvoid *samples, ALCsizei numsamples, ALCint64SOFT clocktime) ALC_API_NOEXCEPT17;
+typedef void (ALC_APIENTRY*LPALCCAPTURECALLBACKSOFT)(ALCdevice *device, ALCCAPTURECALLBACKTYPESOFT callback, ALCvoid *userptr) ALC_API_NOEXCEPT17;
+#ifdef AL_ALEXT_PROTOTYPES
+void ALC_APIENTRY alcCaptureCallbackSOFT(ALCdevice *device, ALCCAPTURECALLBACKTYPESOFT callback, ALCvoid *userptr) ALC_API_NOEXCEPT;
+#endif
+#endif
+
 #ifndef ALC_EXT_debug
 #define ALC_EXT_debug
 #define ALC_CONTEXT_FLAGS_EXT                    0x19CE
@@ -277,6 +533,10 @@ typedef void (AL_APIENTRY *LPALGETBUFFERPTRVDIRECTSOFT)(ALCcontext *context, ALu
 /* AL_SOFT_source_start_delay */
 typedef void (AL_APIENTRY *LPALSOURCEPLAYATTIMEDIRECTSOFT)(ALCcontext *context, ALuint source, ALint64SOFT start_time) AL_API_NOEXCEPT17;
 typedef void (AL_APIENTRY *LPALSOURCEPLAYATTIMEVDIRECTSOFT)(ALCcontext *context, ALsizei n, const ALuint *sources, ALint64SOFT start_time) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY *LPALAUXILIARYEFFECTSLOTPLAYDIRECTSOFT)(ALCcontext *context, ALuint slotid) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY *LPALAUXILIARYEFFECTSLOTPLAYVDIRECTSOFT)(ALCcontext *context, ALsizei n, const ALuint *slotids) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY *LPALAUXILIARYEFFECTSLOTSTOPDIRECTSOFT)(ALCcontext *context, ALuint slotid) AL_API_NOEXCEPT17;
+typedef void (AL_APIENTRY *LPALAUXILIARYEFFECTSLOTSTOPVDIRECTSOFT)(ALCcontext *context, ALsizei n, const ALuint *slotids) AL_API_NOEXCEPT17;
 /* EAX */
 typedef ALenum (AL_APIENTRY *LPEAXSETDIRECT)(ALCcontext *context, const struct _GUID *property_set_id, ALuint property_id, ALuint property_source_id, ALvoid *property_buffer, ALuint property_size) AL_API_NOEXCEPT17;
 typedef ALenum (AL_APIENTRY *LPEAXGETDIRECT)(ALCcontext *context, const struct _GUID *property_set_id, ALuint property_id, ALuint property_source_id, ALvoid *property_value, ALuint property_value_size) AL_API_NOEXCEPT17;
@@ -436,6 +696,11 @@ void AL_APIENTRY alGetBufferPtrvDirectSOFT(ALCcontext *context, ALuint buffer, A
 void AL_APIENTRY alSourcePlayAtTimeDirectSOFT(ALCcontext *context, ALuint source, ALint64SOFT start_time) AL_API_NOEXCEPT;
 void AL_APIENTRY alSourcePlayAtTimevDirectSOFT(ALCcontext *context, ALsizei n, const ALuint *sources, ALint64SOFT start_time) AL_API_NOEXCEPT;
 
+void AL_APIENTRY alAuxiliaryEffectSlotPlayDirectSOFT(ALCcontext *context, ALuint slotid) AL_API_NOEXCEPT;
+void AL_APIENTRY alAuxiliaryEffectSlotPlayvDirectSOFT(ALCcontext *context, ALsizei n, const ALuint *slotids) AL_API_NOEXCEPT;
+void AL_APIENTRY alAuxiliaryEffectSlotStopDirectSOFT(ALCcontext *context, ALuint slotid) AL_API_NOEXCEPT;
+void AL_APIENTRY alAuxiliaryEffectSlotStopvDirectSOFT(ALCcontext *context, ALsizei n, const ALuint *slotids) AL_API_NOEXCEPT;
+
 ALenum AL_APIENTRY EAXSetDirect(ALCcontext *context, const struct _GUID *property_set_id, ALuint property_id, ALuint property_source_id, ALvoid *property_value, ALuint property_value_size) AL_API_NOEXCEPT;
 ALenum AL_APIENTRY EAXGetDirect(ALCcontext *context, const struct _GUID *property_set_id, ALuint property_id, ALuint property_source_id, ALvoid *property_value, ALuint property_value_size) AL_API_NOEXCEPT;
 ALboolean AL_APIENTRY EAXSetBufferModeDirect(ALCcontext *context, ALsizei n, const ALuint *buffers, ALint value) AL_API_NOEXCEPT;
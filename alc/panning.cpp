@@ -30,6 +30,7 @@
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <new>
 #include <numeric>
 #include <optional>
@@ -58,7 +59,9 @@
 #include "core/front_stablizer.h"
 #include "core/hrtf.h"
 #include "core/logging.h"
+#include "core/sourcegroup.h"
 #include "core/uhjfilter.h"
+#include "core/voice.h"
 #include "device.h"
 #include "opthelpers.h"
 
@@ -132,12 +135,21 @@ void AllocChannels(ALCdevice *device, const size_t main_chans, const size_t real
 {
     TRACE("Channel config, Main: %zu, Real: %zu\n", main_chans, real_chans);
 
-    /* Allocate extra channels for any post-filter output. */
-    const size_t num_chans{main_chans + real_chans};
+    /* Allocate extra channels for any post-filter output, and voice clusters. */
+    const size_t cluster_chans{(device->mClusterDistance > 0.0f)
+        ? MaxSpatialClusters * (1+device->NumAuxSends) : 0};
+    const size_t num_chans{main_chans + real_chans + cluster_chans};
 
-    TRACE("Allocating %zu channels, %zu bytes\n", num_chans,
-        num_chans*sizeof(device->MixBuffer[0]));
-    device->MixBuffer.resize(num_chans);
+    /* Each additional mixing thread gets its own copy of the channels, after
+     * the main set.
+     */
+    const size_t total_chans{num_chans * device->mNumMixThreads};
+    TRACE("Allocating %zu channels, %zu bytes\n", total_chans,
+        total_chans*sizeof(device->MixBuffer[0]));
+    device->mMixBufferStorage = al::page_buffer{total_chans*sizeof(FloatBufferLine),
+        device->sMixPagePolicy};
+    device->MixBuffer = {static_cast<FloatBufferLine*>(device->mMixBufferStorage.data()),
+        total_chans};
     al::span<FloatBufferLine> buffer{device->MixBuffer};
 
     device->Dry.Buffer = buffer.first(main_chans);
@@ -149,6 +161,7 @@ void AllocChannels(ALCdevice *device, const size_t main_chans, const size_t real
     }
     else
         device->RealOut.Buffer = device->Dry.Buffer;
+    device->mClusterBuffer = buffer.first(cluster_chans);
 }
 
 
@@ -240,7 +253,7 @@ void InitNearFieldCtrl(ALCdevice *device, float ctrl_dist, uint order, bool is3d
     TRACE("Using near-field reference distance: %.2f meters\n", device->AvgSpeakerDist);
 
     const float w1{SpeedOfSoundMetersPerSec /
-        (device->AvgSpeakerDist * static_cast<float>(device->Frequency))};
+        (device->AvgSpeakerDist * static_cast<float>(device->MixFrequency))};
     device->mNFCtrlFilter.init(w1);
 
     auto iter = std::copy_n(is3d ? chans_per_order3d : chans_per_order2d, order+1u,
@@ -256,7 +269,7 @@ void InitDistanceComp(ALCdevice *device, const al::span<const Channel> channels,
     if(!device->getConfigValueBool("decoder", "distance-comp", true) || !(maxdist > 0.0f))
         return;
 
-    const auto distSampleScale = static_cast<float>(device->Frequency) / SpeedOfSoundMetersPerSec;
+    const auto distSampleScale = static_cast<float>(device->MixFrequency) / SpeedOfSoundMetersPerSec;
     std::vector<DistanceComp::ChanData> ChanDelay;
     ChanDelay.reserve(device->RealOut.Buffer.size());
     size_t total{0u};
@@ -298,6 +311,8 @@ void InitDistanceComp(ALCdevice *device, const al::span<const Channel> channels,
     if(total > 0)
     {
         auto chandelays = DistanceComp::Create(total);
+        /* The delay lines start silent. */
+        std::fill(chandelays->mSamples.begin(), chandelays->mSamples.end(), 0.0f);
 
         ChanDelay[0].Buffer = chandelays->mSamples.data();
         auto set_bufptr = [](const DistanceComp::ChanData &last, const DistanceComp::ChanData &cur)
@@ -458,6 +473,65 @@ DecoderView MakeDecoderView(ALCdevice *device, const AmbDecConf *conf,
     return ret;
 }
 
+
+/* Decoders loaded from .ambdec files, kept for the life of the process so
+ * opening more devices or resetting one with the same layout doesn't need to
+ * parse the file and rebuild the matrices again. The result only depends on
+ * the file and the output channel format, and entries are never removed or
+ * moved, so the views into the stored configs stay valid once handed out.
+ */
+struct LoadedDecoder {
+    std::string mFilename;
+    DevFmtChannels mFmtChans;
+    DecoderConfig<DualBand,MAX_OUTPUT_CHANNELS> mConfig;
+    DecoderView mView;
+    float mXOverFreq;
+    std::array<float,MAX_OUTPUT_CHANNELS> mSpeakerDists;
+};
+std::mutex LoadedDecoderLock;
+std::vector<std::unique_ptr<LoadedDecoder>> LoadedDecoders;
+
+const LoadedDecoder *GetLoadedDecoder(ALCdevice *device, const char *fname)
+{
+    std::lock_guard<std::mutex> _{LoadedDecoderLock};
+    for(const auto &entry : LoadedDecoders)
+    {
+        if(entry->mFmtChans == device->FmtChans && entry->mFilename == fname)
+            return entry.get();
+    }
+
+    /* Failed loads aren't cached, so fixing the file doesn't need a restart. */
+    AmbDecConf conf{};
+    if(auto err = conf.load(fname))
+    {
+        ERR("Failed to load layout file %s\n", fname);
+        ERR("  %s\n", err->c_str());
+        return nullptr;
+    }
+    if(conf.NumSpeakers > MAX_OUTPUT_CHANNELS)
+    {
+        ERR("Unsupported decoder speaker count %zu (max %d)\n", conf.NumSpeakers,
+            MAX_OUTPUT_CHANNELS);
+        return nullptr;
+    }
+    if(conf.ChanMask > Ambi3OrderMask)
+    {
+        ERR("Unsupported decoder channel mask 0x%04x (max 0x%x)\n", conf.ChanMask,
+            Ambi3OrderMask);
+        return nullptr;
+    }
+
+    auto entry = std::make_unique<LoadedDecoder>();
+    entry->mFilename = fname;
+    entry->mFmtChans = device->FmtChans;
+    entry->mView = MakeDecoderView(device, &conf, entry->mConfig);
+    entry->mXOverFreq = clampf(conf.XOverFreq, 100.0f, 1000.0f);
+    for(size_t i{0};i < entry->mView.mChannels.size();++i)
+        entry->mSpeakerDists[i] = conf.Speakers[i].Distance;
+
+    return LoadedDecoders.emplace_back(std::move(entry)).get();
+}
+
 constexpr DecoderConfig<SingleBand, 1> MonoConfig{
     0, false, {{FrontCenter}},
     DevAmbiScaling::N3D,
@@ -691,7 +765,7 @@ void InitPanning(ALCdevice *device, const bool hqdec=false, const bool stablize=
         }
         if(!hasfc)
         {
-            stablizer = CreateStablizer(device->channelsFromFmt(), device->Frequency);
+            stablizer = CreateStablizer(device->channelsFromFmt(), device->MixFrequency);
             TRACE("Front stablizer enabled\n");
         }
     }
@@ -703,10 +777,15 @@ void InitPanning(ALCdevice *device, const bool hqdec=false, const bool stablize=
         (decoder.mOrder > 1) ? "second" : "first",
         decoder.mIs3D ? " periphonic" : "");
     device->AmbiDecoder = BFormatDec::Create(ambicount, chancoeffs, chancoeffslf,
-        device->mXOverFreq/static_cast<float>(device->Frequency), std::move(stablizer));
+        device->mXOverFreq/static_cast<float>(device->MixFrequency), std::move(stablizer));
 }
 
-void InitHrtfPanning(ALCdevice *device)
+/* Creates the HRTF state for decoding the given ambisonic order with the HRTF.
+ * This only depends on its parameters, so it can run off the mixer and state
+ * lock for swapping a device's HRTF.
+ */
+std::unique_ptr<DirectHrtfState> MakeHrtfState(const HrtfStore *hrtf, const uint irSize,
+    const uint ambiOrder, const float xoverFreq)
 {
     constexpr float Deg180{al::numbers::pi_v<float>};
     constexpr float Deg_90{Deg180 / 2.0f /* 90 degrees*/};
@@ -823,6 +902,32 @@ void InitHrtfPanning(ALCdevice *device)
     static_assert(std::size(AmbiPoints2O) == std::size(AmbiMatrix2O), "Second-Order Ambisonic HRTF mismatch");
     static_assert(std::size(AmbiPoints3O) == std::size(AmbiMatrix3O), "Third-Order Ambisonic HRTF mismatch");
 
+    bool perHrirMin{false};
+    al::span<const AngularPoint> AmbiPoints{AmbiPoints1O};
+    const float (*AmbiMatrix)[MaxAmbiChannels]{AmbiMatrix1O};
+    al::span<const float,MaxAmbiOrder+1> AmbiOrderHFGain{AmbiOrderHFGain1O};
+    if(ambiOrder >= 3)
+    {
+        perHrirMin = true;
+        AmbiPoints = AmbiPoints3O;
+        AmbiMatrix = AmbiMatrix3O;
+        AmbiOrderHFGain = AmbiOrderHFGain3O;
+    }
+    else if(ambiOrder == 2)
+    {
+        AmbiPoints = AmbiPoints2O;
+        AmbiMatrix = AmbiMatrix2O;
+        AmbiOrderHFGain = AmbiOrderHFGain2O;
+    }
+
+    auto hrtfstate = DirectHrtfState::Create(AmbiChannelsFromOrder(ambiOrder));
+    hrtfstate->build(hrtf, irSize, perHrirMin, AmbiPoints, AmbiMatrix, xoverFreq,
+        AmbiOrderHFGain);
+    return hrtfstate;
+}
+
+void InitHrtfPanning(ALCdevice *device, std::optional<uint> hrtf_order)
+{
     /* A 700hz crossover frequency provides tighter sound imaging at the sweet
      * spot with ambisonic decoding, as the distance between the ears is closer
      * to half this frequency wavelength, which is the optimal point where the
@@ -838,9 +943,19 @@ void InitHrtfPanning(ALCdevice *device)
 
     /* Don't bother with HOA when using full HRTF rendering. Nothing needs it,
      * and it eases the CPU/memory load.
+     *
+     * An app can instead request ambisonic mixing, where every source is
+     * panned to the ambisonic buffer and the HRTF is applied once for the
+     * mix, making the HRTF cost independent of the number of sources. The
+     * user's hrtf-mode config takes precedence.
      */
     device->mRenderMode = RenderMode::Hrtf;
     uint ambi_order{1};
+    if(hrtf_order && *hrtf_order > 0)
+    {
+        device->mRenderMode = RenderMode::Normal;
+        ambi_order = *hrtf_order;
+    }
     if(auto modeopt = device->configValue<std::string>(nullptr, "hrtf-mode"))
     {
         struct HrtfModeEntry {
@@ -881,23 +996,6 @@ void InitHrtfPanning(ALCdevice *device)
         (device->mRenderMode == RenderMode::Hrtf) ? "+ Full " : "",
         device->mHrtfName.c_str());
 
-    bool perHrirMin{false};
-    al::span<const AngularPoint> AmbiPoints{AmbiPoints1O};
-    const float (*AmbiMatrix)[MaxAmbiChannels]{AmbiMatrix1O};
-    al::span<const float,MaxAmbiOrder+1> AmbiOrderHFGain{AmbiOrderHFGain1O};
-    if(ambi_order >= 3)
-    {
-        perHrirMin = true;
-        AmbiPoints = AmbiPoints3O;
-        AmbiMatrix = AmbiMatrix3O;
-        AmbiOrderHFGain = AmbiOrderHFGain3O;
-    }
-    else if(ambi_order == 2)
-    {
-        AmbiPoints = AmbiPoints2O;
-        AmbiMatrix = AmbiMatrix2O;
-        AmbiOrderHFGain = AmbiOrderHFGain2O;
-    }
     device->mAmbiOrder = ambi_order;
     device->m2DMixing = false;
 
@@ -909,14 +1007,36 @@ void InitHrtfPanning(ALCdevice *device)
     AllocChannels(device, count, device->channelsFromFmt());
 
     HrtfStore *Hrtf{device->mHrtf.get()};
-    auto hrtfstate = DirectHrtfState::Create(count);
-    hrtfstate->build(Hrtf, device->mIrSize, perHrirMin, AmbiPoints, AmbiMatrix, device->mXOverFreq,
-        AmbiOrderHFGain);
-    device->mHrtfState = std::move(hrtfstate);
+    device->mHrtfState = MakeHrtfState(Hrtf, device->mIrSize, ambi_order, device->mXOverFreq);
 
     InitNearFieldCtrl(device, Hrtf->mFields[0].distance, ambi_order, true);
 }
 
+/* Loads the named HRTF for the given sample rate, using the device's HRTF
+ * options.
+ */
+HrtfStorePtr LoadDeviceHrtf(ALCdevice *device, const std::string &name, const uint frequency)
+{
+    /* An optional grid of precomputed HRIRs, given in degrees. */
+    const uint hrtfgrid{minu(device->configValue<uint>(nullptr, "hrtf-grid").value_or(0u), 90u)};
+    const bool hrtfcache{device->configValue<bool>(nullptr, "hrtf-cache").value_or(false)};
+    return GetLoadedHrtf(name, frequency, hrtfgrid, hrtfcache);
+}
+
+/* Gets the HRIR length to use with the HRTF, which may be shortened by the
+ * device's hrtf-size option.
+ */
+uint GetHrtfIrSize(ALCdevice *device, const HrtfStore *hrtf)
+{
+    uint irsize{hrtf->mIrSize};
+    if(auto hrtfsizeopt = device->configValue<uint>(nullptr, "hrtf-size"))
+    {
+        if(*hrtfsizeopt > 0 && *hrtfsizeopt < irsize)
+            irsize = maxu(*hrtfsizeopt, MinIrLength);
+    }
+    return irsize;
+}
+
 void InitUhjPanning(ALCdevice *device)
 {
     /* UHJ is always 2D first-order. */
@@ -934,7 +1054,8 @@ void InitUhjPanning(ALCdevice *device)
 
 } // namespace
 
-void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<StereoEncoding> stereomode)
+void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<uint> hrtf_order,
+    std::optional<StereoEncoding> stereomode)
 {
     /* Hold the HRTF the device last used, in case it's used again. */
     HrtfStorePtr old_hrtf{std::move(device->mHrtf)};
@@ -942,6 +1063,7 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<StereoEncodin
     device->mHrtfState = nullptr;
     device->mHrtf = nullptr;
     device->mIrSize = 0;
+    ++device->mHrtfId;
     device->mHrtfName.clear();
     device->mXOverFreq = 400.0f;
     device->m2DMixing = false;
@@ -969,31 +1091,17 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<StereoEncodin
             break;
         }
 
-        std::unique_ptr<DecoderConfig<DualBand,MAX_OUTPUT_CHANNELS>> decoder_store;
         DecoderView decoder{};
         float speakerdists[MAX_OUTPUT_CHANNELS]{};
-        auto load_config = [device,&decoder_store,&decoder,&speakerdists](const char *config)
+        auto load_config = [device,&decoder,&speakerdists](const char *config)
         {
-            AmbDecConf conf{};
-            if(auto err = conf.load(config))
-            {
-                ERR("Failed to load layout file %s\n", config);
-                ERR("  %s\n", err->c_str());
-            }
-            else if(conf.NumSpeakers > MAX_OUTPUT_CHANNELS)
-                ERR("Unsupported decoder speaker count %zu (max %d)\n", conf.NumSpeakers,
-                    MAX_OUTPUT_CHANNELS);
-            else if(conf.ChanMask > Ambi3OrderMask)
-                ERR("Unsupported decoder channel mask 0x%04x (max 0x%x)\n", conf.ChanMask,
-                    Ambi3OrderMask);
-            else
+            if(const LoadedDecoder *loaded{GetLoadedDecoder(device, config)})
             {
-                device->mXOverFreq = clampf(conf.XOverFreq, 100.0f, 1000.0f);
+                device->mXOverFreq = loaded->mXOverFreq;
 
-                decoder_store = std::make_unique<DecoderConfig<DualBand,MAX_OUTPUT_CHANNELS>>();
-                decoder = MakeDecoderView(device, &conf, *decoder_store);
-                for(size_t i{0};i < decoder.mChannels.size();++i)
-                    speakerdists[i] = conf.Speakers[i].Distance;
+                decoder = loaded->mView;
+                std::copy(loaded->mSpeakerDists.cbegin(), loaded->mSpeakerDists.cend(),
+                    std::begin(speakerdists));
             }
         };
         if(layout)
@@ -1051,7 +1159,7 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<StereoEncodin
         if(hrtf_id >= 0 && static_cast<uint>(hrtf_id) < device->mHrtfList.size())
         {
             const std::string &hrtfname = device->mHrtfList[static_cast<uint>(hrtf_id)];
-            if(HrtfStorePtr hrtf{GetLoadedHrtf(hrtfname, device->Frequency)})
+            if(HrtfStorePtr hrtf{LoadDeviceHrtf(device, hrtfname, device->MixFrequency)})
             {
                 device->mHrtf = std::move(hrtf);
                 device->mHrtfName = hrtfname;
@@ -1062,7 +1170,7 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<StereoEncodin
         {
             for(const auto &hrtfname : device->mHrtfList)
             {
-                if(HrtfStorePtr hrtf{GetLoadedHrtf(hrtfname, device->Frequency)})
+                if(HrtfStorePtr hrtf{LoadDeviceHrtf(device, hrtfname, device->MixFrequency)})
                 {
                     device->mHrtf = std::move(hrtf);
                     device->mHrtfName = hrtfname;
@@ -1075,15 +1183,9 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<StereoEncodin
         {
             old_hrtf = nullptr;
 
-            HrtfStore *hrtf{device->mHrtf.get()};
-            device->mIrSize = hrtf->mIrSize;
-            if(auto hrtfsizeopt = device->configValue<uint>(nullptr, "hrtf-size"))
-            {
-                if(*hrtfsizeopt > 0 && *hrtfsizeopt < device->mIrSize)
-                    device->mIrSize = maxu(*hrtfsizeopt, MinIrLength);
-            }
+            device->mIrSize = GetHrtfIrSize(device, device->mHrtf.get());
 
-            InitHrtfPanning(device);
+            InitHrtfPanning(device, hrtf_order);
             device->PostProcess = &ALCdevice::ProcessHrtf;
             device->mHrtfStatus = ALC_HRTF_ENABLED_SOFT;
             return;
@@ -1122,7 +1224,7 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<StereoEncodin
             {
                 device->Bs2b = std::make_unique<bs2b>();
                 bs2b_set_params(device->Bs2b.get(), *cflevopt,
-                    static_cast<int>(device->Frequency));
+                    static_cast<int>(device->MixFrequency));
                 TRACE("BS2B enabled\n");
                 InitPanning(device);
                 device->PostProcess = &ALCdevice::ProcessBs2b;
@@ -1137,17 +1239,81 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, std::optional<StereoEncodin
 }
 
 
+std::unique_ptr<DeviceBase::HrtfSwap> aluPrepareHrtf(ALCdevice *device,
+    const std::string &name, const uint frequency, const uint ambiOrder, const float xoverFreq)
+{
+    HrtfStorePtr hrtf{LoadDeviceHrtf(device, name, frequency)};
+    if(!hrtf) return nullptr;
+
+    auto swap = std::make_unique<DeviceBase::HrtfSwap>();
+    swap->mIrSize = GetHrtfIrSize(device, hrtf.get());
+    swap->mState = MakeHrtfState(hrtf.get(), swap->mIrSize, ambiOrder, xoverFreq);
+    swap->mHrtf = std::move(hrtf);
+    return swap;
+}
+
+
 void aluInitEffectPanning(EffectSlot *slot, ALCcontext *context)
 {
     DeviceBase *device{context->mDevice};
     const size_t count{AmbiChannelsFromOrder(device->mAmbiOrder)};
 
-    slot->mWetBuffer.resize(count);
+    /* Allocate a copy of the wet buffer for each additional mixing thread. */
+    const size_t total{count * device->mNumMixThreads};
+    if(slot->mWetBuffer.size() != total)
+    {
+        slot->mWetBufferStorage = al::page_buffer{total*sizeof(FloatBufferLine),
+            device->sMixPagePolicy};
+        slot->mWetBuffer = {static_cast<FloatBufferLine*>(slot->mWetBufferStorage.data()),
+            total};
+        slot->mWetBufferMemory.set(device->mMemoryStats, MemCategory::Effects,
+            total*sizeof(FloatBufferLine));
+    }
 
     auto acnmap_begin = AmbiIndex::FromACN().begin();
     auto iter = std::transform(acnmap_begin, acnmap_begin + count, slot->Wet.AmbiMap.begin(),
         [](const uint8_t &acn) noexcept -> BFChannelConfig
         { return BFChannelConfig{1.0f, acn}; });
     std::fill(iter, slot->Wet.AmbiMap.end(), BFChannelConfig{});
-    slot->Wet.Buffer = slot->mWetBuffer;
+    slot->Wet.Buffer = {slot->mWetBuffer.data(), count};
+    slot->mWetSilent = false;
+}
+
+void aluInitSourceGroupPanning(SourceGroup *group, ALCcontext *context)
+{
+    DeviceBase *device{context->mDevice};
+    const size_t count{AmbiChannelsFromOrder(device->mAmbiOrder)};
+
+    /* Allocate a copy of the group's buffer for each additional mixing
+     * thread, as with effect slot wet buffers.
+     */
+    const size_t total{count * device->mNumMixThreads};
+    if(group->mWetBuffer.size() != total)
+    {
+        group->mWetBufferStorage = al::page_buffer{total*sizeof(FloatBufferLine),
+            device->sMixPagePolicy};
+        group->mWetBuffer = {static_cast<FloatBufferLine*>(group->mWetBufferStorage.data()),
+            total};
+        group->mWetBufferMemory.set(device->mMemoryStats, MemCategory::Effects,
+            total*sizeof(FloatBufferLine));
+    }
+    else
+        std::fill(group->mWetBuffer.begin(), group->mWetBuffer.end(), FloatBufferLine{});
+
+    auto acnmap_begin = AmbiIndex::FromACN().begin();
+    auto iter = std::transform(acnmap_begin, acnmap_begin + count, group->Wet.AmbiMap.begin(),
+        [](const uint8_t &acn) noexcept -> BFChannelConfig
+        { return BFChannelConfig{1.0f, acn}; });
+    std::fill(iter, group->Wet.AmbiMap.end(), BFChannelConfig{});
+    group->Wet.Buffer = {group->mWetBuffer.data(), count};
+
+    for(auto &output : group->mOutputs)
+    {
+        for(auto &chan : output.Chans)
+        {
+            chan.LowPass.clear();
+            chan.HighPass.clear();
+        }
+    }
+    group->mSilent = true;
 }
@@ -0,0 +1,571 @@
+/*
+ * OpenAL API Contention Benchmark
+ *
+ * Calls source functions as fast as possible from a number of threads on one
+ * context, while another thread renders a loopback device in real time. Each
+ * run reports the call throughput, the call latency percentiles, and how many
+ * mixer periods missed their deadline, to measure the cost of the API's locks
+ * and of waiting on the mixer.
+ *
+ * Each thread has its own sources, so the threads only contend on the
+ * context and device, not on a particular source. The operations are:
+ *
+ *   fv     alSourcefv(AL_POSITION) on a playing source
+ *   3f     alSource3f(AL_VELOCITY) on a playing source
+ *   state  alGetSourcei(AL_SOURCE_STATE) on a playing source
+ *   play   alSourcePlay, restarting a playing source
+ *   queue  alSourceQueueBuffers on a stopped streaming source (the buffer is
+ *          unqueued again outside of the timed call)
+ *   mix    a mix of the above, weighted toward property updates
+ *
+ * For example, to see how position updates scale from 1 to 16 threads:
+ *
+ *   alsoft-api-bench -o fv -t 1,2,4,8,16
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+#include "AL/alext.h"
+
+
+#ifndef ALC_SOFT_mixer_profile
+#define ALC_SOFT_mixer_profile
+#define ALC_MIXER_PROFILE_SOFT                   0x19D6
+#endif
+
+namespace {
+
+using uint = unsigned int;
+
+using std::chrono::steady_clock;
+using std::chrono::nanoseconds;
+using std::chrono::duration_cast;
+
+LPALCLOOPBACKOPENDEVICESOFT alcLoopbackOpenDeviceSOFT;
+LPALCRENDERSAMPLESSOFT alcRenderSamplesSOFT;
+LPALCGETINTEGER64VSOFT alcGetInteger64vSOFT;
+
+constexpr int MaxThreads{64};
+
+enum class Op {
+    Fv, F3, State, Play, Queue, Mix
+};
+
+struct OpName {
+    const char *mName;
+    Op mOp;
+};
+constexpr std::array<OpName,6> OpNames{{
+    {"fv", Op::Fv}, {"3f", Op::F3}, {"state", Op::State}, {"play", Op::Play},
+    {"queue", Op::Queue}, {"mix", Op::Mix}
+}};
+
+
+/* A log-linear histogram of call times in nanoseconds, with 16 steps per
+ * power of two, so percentiles can be found without storing every sample.
+ */
+struct Histogram {
+    static constexpr uint SubBits{4};
+    static constexpr uint SubCount{1u << SubBits};
+    static constexpr uint NumBuckets{(64-SubBits+1) * SubCount};
+
+    std::array<uint64_t,NumBuckets> mCounts{};
+    uint64_t mTotal{0u};
+    uint64_t mMax{0u};
+
+    static uint bucketOf(uint64_t ns) noexcept
+    {
+        if(ns < SubCount)
+            return static_cast<uint>(ns);
+        uint log2{0u};
+        while((ns>>log2) >= SubCount*2)
+            ++log2;
+        const uint sub{static_cast<uint>(ns>>log2) - SubCount};
+        return (log2+1)*SubCount + sub;
+    }
+    static uint64_t bucketValue(uint bucket) noexcept
+    {
+        if(bucket < SubCount)
+            return bucket;
+        const uint log2{bucket/SubCount - 1};
+        const uint64_t sub{bucket%SubCount + SubCount};
+        /* Report the middle of the bucket's range. */
+        return (sub<<log2) + ((uint64_t{1}<<log2) >> 1);
+    }
+
+    void add(uint64_t ns) noexcept
+    {
+        ++mCounts[bucketOf(ns)];
+        ++mTotal;
+        mMax = std::max(mMax, ns);
+    }
+    void merge(const Histogram &rhs) noexcept
+    {
+        for(size_t i{0};i < mCounts.size();++i)
+            mCounts[i] += rhs.mCounts[i];
+        mTotal += rhs.mTotal;
+        mMax = std::max(mMax, rhs.mMax);
+    }
+    uint64_t percentile(double pct) const noexcept
+    {
+        if(mTotal == 0) return 0;
+        const auto target = static_cast<uint64_t>(std::ceil(static_cast<double>(mTotal)*pct/100.0));
+        uint64_t count{0u};
+        for(uint i{0};i < NumBuckets;++i)
+        {
+            count += mCounts[i];
+            if(count >= std::max(target, uint64_t{1}))
+                return std::min(bucketValue(i), mMax);
+        }
+        return mMax;
+    }
+};
+
+
+struct Options {
+    std::vector<int> mThreadCounts{1, 2, 4, 8, 16};
+    std::vector<Op> mOps;
+    int mSourcesPerThread{4};
+    int mFrequency{48000};
+    int mUpdateSize{512};
+    double mSeconds{1.0};
+
+    ~Options();
+};
+Options::~Options() = default;
+
+/* The sources and buffers one worker thread uses. */
+struct WorkerSources {
+    std::vector<ALuint> mPlaying;
+    ALuint mStreaming{0u};
+    ALuint mQueueBuffer{0u};
+};
+
+struct RenderStats {
+    uint64_t mPeriods{0u};
+    uint64_t mMisses{0u};
+    Histogram mTimes;
+};
+
+struct RunResult {
+    Histogram mCalls;
+    RenderStats mRender;
+    double mSeconds{0.0};
+    int64_t mOverruns{-1};
+};
+
+
+std::atomic<bool> gRunning{false};
+std::atomic<bool> gStopped{false};
+
+
+/* Renders the loopback device at its real-time rate, counting the periods
+ * that finished after their deadline.
+ */
+void RenderThread(ALCdevice *device, const Options &opts, RenderStats &stats)
+{
+    std::vector<float> output(static_cast<size_t>(opts.mUpdateSize) * 2);
+    const auto period = nanoseconds{1'000'000'000ll * opts.mUpdateSize / opts.mFrequency};
+
+    auto deadline = steady_clock::now() + period;
+    while(!gStopped.load(std::memory_order_relaxed))
+    {
+        const auto start = steady_clock::now();
+        alcRenderSamplesSOFT(device, output.data(), opts.mUpdateSize);
+        const auto end = steady_clock::now();
+
+        stats.mTimes.add(static_cast<uint64_t>(duration_cast<nanoseconds>(end-start).count()));
+        ++stats.mPeriods;
+        if(end > deadline)
+        {
+            /* Start over from now instead of trying to catch up. */
+            ++stats.mMisses;
+            deadline = end + period;
+            continue;
+        }
+        std::this_thread::sleep_until(deadline);
+        deadline += period;
+    }
+}
+
+/* Does one call of the given operation, returning how long it took. */
+uint64_t DoOp(Op op, WorkerSources &srcs, uint &counter)
+{
+    const ALuint source{srcs.mPlaying[counter % srcs.mPlaying.size()]};
+    const auto t = static_cast<float>(counter&1023) * 0.01f;
+    ++counter;
+
+    if(op == Op::Mix)
+    {
+        /* Mostly property updates, some state queries, and the occasional
+         * restart or queue, as a game's audio thread might do.
+         */
+        const uint sel{counter % 16u};
+        op = (sel < 7) ? Op::Fv : (sel < 11) ? Op::F3 : (sel < 14) ? Op::State
+            : (sel < 15) ? Op::Play : Op::Queue;
+    }
+
+    steady_clock::time_point start, end;
+    switch(op)
+    {
+    case Op::Fv:
+    {
+        const std::array<ALfloat,3> pos{std::sin(t)*2.0f, 0.0f, -std::cos(t)*2.0f};
+        start = steady_clock::now();
+        alSourcefv(source, AL_POSITION, pos.data());
+        end = steady_clock::now();
+        break;
+    }
+    case Op::F3:
+        start = steady_clock::now();
+        alSource3f(source, AL_VELOCITY, std::cos(t), 0.0f, std::sin(t));
+        end = steady_clock::now();
+        break;
+    case Op::State:
+    {
+        ALint state{};
+        start = steady_clock::now();
+        alGetSourcei(source, AL_SOURCE_STATE, &state);
+        end = steady_clock::now();
+        break;
+    }
+    case Op::Play:
+        start = steady_clock::now();
+        alSourcePlay(source);
+        end = steady_clock::now();
+        break;
+    case Op::Queue:
+        start = steady_clock::now();
+        alSourceQueueBuffers(srcs.mStreaming, 1, &srcs.mQueueBuffer);
+        end = steady_clock::now();
+        alSourceUnqueueBuffers(srcs.mStreaming, 1, &srcs.mQueueBuffer);
+        break;
+    case Op::Mix:
+        break;
+    }
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(end-start).count());
+}
+
+void WorkerThread(Op op, WorkerSources &srcs, Histogram &hist)
+{
+    while(!gRunning.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    uint counter{0u};
+    while(!gStopped.load(std::memory_order_relaxed))
+        hist.add(DoOp(op, srcs, counter));
+}
+
+
+RunResult RunTest(ALCdevice *device, const Options &opts, Op op, int numthreads,
+    std::vector<WorkerSources> &sources, bool have_profile)
+{
+    RunResult result;
+
+    /* Only the sources of the running threads play, so the mixer's load
+     * grows with the thread count like an application's would.
+     */
+    for(int i{0};i < numthreads;++i)
+        alSourcePlayv(static_cast<ALsizei>(sources[i].mPlaying.size()),
+            sources[i].mPlaying.data());
+
+    std::array<ALCint64SOFT,9> profile_start{}, profile_end{};
+    if(have_profile)
+        alcGetInteger64vSOFT(device, ALC_MIXER_PROFILE_SOFT,
+            static_cast<ALCsizei>(profile_start.size()), profile_start.data());
+
+    std::vector<Histogram> hists(static_cast<size_t>(numthreads));
+    std::vector<std::thread> threads;
+    threads.reserve(static_cast<size_t>(numthreads)+1);
+
+    gRunning.store(false);
+    gStopped.store(false);
+    threads.emplace_back(RenderThread, device, std::cref(opts), std::ref(result.mRender));
+    for(int i{0};i < numthreads;++i)
+        threads.emplace_back(WorkerThread, op, std::ref(sources[i]), std::ref(hists[i]));
+
+    const auto start = steady_clock::now();
+    gRunning.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(duration_cast<nanoseconds>(
+        std::chrono::duration<double>{opts.mSeconds}));
+    gStopped.store(true);
+    for(auto &thrd : threads)
+        thrd.join();
+    result.mSeconds = std::chrono::duration<double>{steady_clock::now() - start}.count();
+
+    if(have_profile)
+    {
+        alcGetInteger64vSOFT(device, ALC_MIXER_PROFILE_SOFT,
+            static_cast<ALCsizei>(profile_end.size()), profile_end.data());
+        result.mOverruns = profile_end[1] - profile_start[1];
+    }
+
+    for(const auto &hist : hists)
+        result.mCalls.merge(hist);
+
+    for(int i{0};i < numthreads;++i)
+        alSourceStopv(static_cast<ALsizei>(sources[i].mPlaying.size()),
+            sources[i].mPlaying.data());
+    return result;
+}
+
+
+ALuint CreateLoopBuffer(int frequency)
+{
+    std::vector<float> data(static_cast<size_t>(frequency));
+    for(size_t i{0};i < data.size();++i)
+        data[i] = static_cast<float>(std::sin(static_cast<double>(i)*2.0*3.14159265358979323846
+            * 440.0 / frequency)) * 0.25f;
+
+    ALuint buffer{0u};
+    alGenBuffers(1, &buffer);
+    alBufferData(buffer, AL_FORMAT_MONO_FLOAT32, data.data(),
+        static_cast<ALsizei>(data.size()*sizeof(float)), frequency);
+    return buffer;
+}
+
+bool ParseThreadCounts(const char *str, std::vector<int> &counts)
+{
+    counts.clear();
+    while(*str)
+    {
+        char *end{};
+        const long val{std::strtol(str, &end, 10)};
+        if(end == str || val < 1 || val > MaxThreads)
+            return false;
+        counts.emplace_back(static_cast<int>(val));
+        if(*end == ',') ++end;
+        else if(*end != '\0') return false;
+        str = end;
+    }
+    return !counts.empty();
+}
+
+void PrintUsage(const char *name)
+{
+    std::printf("Usage: %s [options]\n\n"
+        "Options:\n"
+        "  -o, --op <name>         Operation to test: fv, 3f, state, play, queue, or\n"
+        "                          mix. May be given more than once (default: all)\n"
+        "  -t, --threads <list>    Comma-separated thread counts to run with\n"
+        "                          (default: 1,2,4,8,16, max %d)\n"
+        "  -s, --sources <count>   Playing sources per thread (default: 4)\n"
+        "  -d, --duration <sec>    Time to run each test for (default: 1)\n"
+        "  -r, --rate <hz>         Output sample rate (default: 48000)\n"
+        "  -u, --update <samples>  Samples to render per period (default: 512)\n",
+        name, MaxThreads);
+}
+
+bool ParseOptions(int argc, char **argv, Options &opts)
+{
+    for(int i{1};i < argc;++i)
+    {
+        const char *arg{argv[i]};
+        const char *val{(i+1 < argc) ? argv[i+1] : nullptr};
+
+        if(std::strcmp(arg, "-h") == 0 || std::strcmp(arg, "--help") == 0)
+        {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        }
+        if(!val)
+        {
+            std::fprintf(stderr, "Unexpected or incomplete option: %s\n", arg);
+            return false;
+        }
+        ++i;
+
+        if(std::strcmp(arg, "-o") == 0 || std::strcmp(arg, "--op") == 0)
+        {
+            auto iter = std::find_if(OpNames.cbegin(), OpNames.cend(),
+                [val](const OpName &name) { return std::strcmp(name.mName, val) == 0; });
+            if(iter == OpNames.cend())
+            {
+                std::fprintf(stderr, "Unknown operation: %s\n", val);
+                return false;
+            }
+            opts.mOps.emplace_back(iter->mOp);
+        }
+        else if(std::strcmp(arg, "-t") == 0 || std::strcmp(arg, "--threads") == 0)
+        {
+            if(!ParseThreadCounts(val, opts.mThreadCounts))
+            {
+                std::fprintf(stderr, "Invalid thread counts: %s\n", val);
+                return false;
+            }
+        }
+        else if(std::strcmp(arg, "-s") == 0 || std::strcmp(arg, "--sources") == 0)
+            opts.mSourcesPerThread = std::atoi(val);
+        else if(std::strcmp(arg, "-d") == 0 || std::strcmp(arg, "--duration") == 0)
+            opts.mSeconds = std::atof(val);
+        else if(std::strcmp(arg, "-r") == 0 || std::strcmp(arg, "--rate") == 0)
+            opts.mFrequency = std::atoi(val);
+        else if(std::strcmp(arg, "-u") == 0 || std::strcmp(arg, "--update") == 0)
+            opts.mUpdateSize = std::atoi(val);
+        else
+        {
+            std::fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+    }
+
+    if(opts.mSourcesPerThread < 1 || opts.mFrequency <= 0 || opts.mUpdateSize <= 0
+        || !(opts.mSeconds > 0.0))
+    {
+        std::fprintf(stderr, "Invalid option value\n");
+        return false;
+    }
+    if(opts.mOps.empty())
+    {
+        for(const auto &name : OpNames)
+            opts.mOps.emplace_back(name.mOp);
+    }
+    return true;
+}
+
+const char *NameOfOp(Op op)
+{
+    for(const auto &name : OpNames)
+    {
+        if(name.mOp == op)
+            return name.mName;
+    }
+    return "(unknown)";
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    Options opts;
+    if(!ParseOptions(argc, argv, opts))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if(!alcIsExtensionPresent(nullptr, "ALC_SOFT_loopback"))
+    {
+        std::fprintf(stderr, "Error: ALC_SOFT_loopback not supported!\n");
+        return 1;
+    }
+
+#define LOAD_PROC(T, x)  ((x) = reinterpret_cast<T>(alcGetProcAddress(nullptr, #x)))
+    LOAD_PROC(LPALCLOOPBACKOPENDEVICESOFT, alcLoopbackOpenDeviceSOFT);
+    LOAD_PROC(LPALCRENDERSAMPLESSOFT, alcRenderSamplesSOFT);
+    LOAD_PROC(LPALCGETINTEGER64VSOFT, alcGetInteger64vSOFT);
+#undef LOAD_PROC
+
+    const int maxthreads{*std::max_element(opts.mThreadCounts.cbegin(),
+        opts.mThreadCounts.cend())};
+
+    ALCdevice *device{alcLoopbackOpenDeviceSOFT(nullptr)};
+    if(!device)
+    {
+        std::fprintf(stderr, "Failed to open loopback device!\n");
+        return 1;
+    }
+
+    const std::array<ALCint,9> attrs{{
+        ALC_FREQUENCY, opts.mFrequency,
+        ALC_FORMAT_TYPE_SOFT, ALC_FLOAT_SOFT,
+        ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+        ALC_MONO_SOURCES, std::max(256, maxthreads*(opts.mSourcesPerThread+1)),
+        0
+    }};
+    ALCcontext *context{alcCreateContext(device, attrs.data())};
+    if(!context || alcMakeContextCurrent(context) == ALC_FALSE)
+    {
+        std::fprintf(stderr, "Failed to set up context!\n");
+        if(context)
+            alcDestroyContext(context);
+        alcCloseDevice(device);
+        return 1;
+    }
+    const bool have_profile{alcIsExtensionPresent(device, "ALC_SOFTX_mixer_profile") != ALC_FALSE};
+
+    const ALuint loopbuf{CreateLoopBuffer(opts.mFrequency)};
+    std::vector<WorkerSources> sources(static_cast<size_t>(maxthreads));
+    for(auto &srcs : sources)
+    {
+        srcs.mPlaying.resize(static_cast<size_t>(opts.mSourcesPerThread));
+        alGenSources(static_cast<ALsizei>(srcs.mPlaying.size()), srcs.mPlaying.data());
+        for(ALuint source : srcs.mPlaying)
+        {
+            alSourcei(source, AL_BUFFER, static_cast<ALint>(loopbuf));
+            alSourcei(source, AL_LOOPING, AL_TRUE);
+        }
+
+        /* The streaming source is left stopped, so its queued buffer is
+         * always processed and can be unqueued right away.
+         */
+        alGenSources(1, &srcs.mStreaming);
+        srcs.mQueueBuffer = CreateLoopBuffer(opts.mFrequency);
+        alSourceQueueBuffers(srcs.mStreaming, 1, &srcs.mQueueBuffer);
+        alSourcePlay(srcs.mStreaming);
+        alSourceStop(srcs.mStreaming);
+        alSourceUnqueueBuffers(srcs.mStreaming, 1, &srcs.mQueueBuffer);
+    }
+    if(alGetError() != AL_NO_ERROR)
+    {
+        std::fprintf(stderr, "Failed to create the sources\n");
+        return 1;
+    }
+
+    const double period_us{opts.mUpdateSize * 1000000.0 / opts.mFrequency};
+    std::printf("%d sources per thread, %d sample periods (%.0fus)\n", opts.mSourcesPerThread,
+        opts.mUpdateSize, period_us);
+    std::printf("%-6s %7s %12s %9s %9s %9s %9s %8s %10s\n", "Op", "Threads", "Calls/s",
+        "p50 ns", "p99 ns", "p99.9 ns", "Max ns", "Misses", "Mix p99 us");
+    std::printf("----------------------------------------------------------------------"
+        "-------------------\n");
+    for(Op op : opts.mOps)
+    {
+        for(int numthreads : opts.mThreadCounts)
+        {
+            const RunResult res{RunTest(device, opts, op, numthreads, sources, have_profile)};
+            if(alGetError() != AL_NO_ERROR)
+                std::fprintf(stderr, "An AL error occurred testing %s\n", NameOfOp(op));
+
+            std::string misses{std::to_string(res.mRender.mMisses)};
+            if(res.mOverruns >= 0)
+                misses += "/" + std::to_string(res.mOverruns);
+            std::printf("%-6s %7d %12.0f %9llu %9llu %9llu %9llu %8s %10.1f\n", NameOfOp(op),
+                numthreads, static_cast<double>(res.mCalls.mTotal) / res.mSeconds,
+                static_cast<unsigned long long>(res.mCalls.percentile(50.0)),
+                static_cast<unsigned long long>(res.mCalls.percentile(99.0)),
+                static_cast<unsigned long long>(res.mCalls.percentile(99.9)),
+                static_cast<unsigned long long>(res.mCalls.mMax), misses.c_str(),
+                static_cast<double>(res.mRender.mTimes.percentile(99.0)) / 1000.0);
+        }
+    }
+    std::printf("\nMisses are the mix periods that finished after their deadline, followed\n"
+        "by the mixer's own overrun count when available.\n");
+
+    for(auto &srcs : sources)
+    {
+        alDeleteSources(static_cast<ALsizei>(srcs.mPlaying.size()), srcs.mPlaying.data());
+        alDeleteSources(1, &srcs.mStreaming);
+        alDeleteBuffers(1, &srcs.mQueueBuffer);
+    }
+    alDeleteBuffers(1, &loopbuf);
+
+    alcMakeContextCurrent(nullptr);
+    alcDestroyContext(context);
+    alcCloseDevice(device);
+    return 0;
+}
@@ -0,0 +1,27 @@
+/*
+ * Definitions the core expects from the rest of the library, for benchmarks
+ * that build the core directly instead of using the library.
+ */
+
+#include "config.h"
+
+#include <cstdio>
+
+#include "core/logging.h"
+#include "core/mixer/defs.h"
+
+
+/* The library defines these with its configuration. */
+FILE *gLogFile{stderr};
+LogLevel gLogLevel{LogLevel::Error};
+
+/* The library's resampler setup is part of its source mixing. Voices are
+ * never played by the benchmarks, so these only need to exist.
+ */
+struct CTag;
+struct PointTag;
+
+ResamplerFunc PrepareResampler(Resampler, uint, InterpState*)
+{ return Resample_<PointTag,CTag>; }
+Resampler16Func PrepareResampler16(Resampler)
+{ return Resample16_<PointTag,CTag>; }
@@ -0,0 +1,533 @@
+/*
+ * Benchmarks for the effects
+ *
+ * Creates each effect state with its default properties, and runs it at 44.1,
+ * 48, and 96kHz with 1st through 3rd order wet buffers, the same as a device
+ * with that ambisonic order would. It reports the time per sample processed,
+ * the time taken by deviceUpdate and update, the number of heap allocations
+ * each makes (processing should make none), and the memory the effect counts
+ * for itself. The convolution effect runs with 0.5s, 2s, and 8s impulse
+ * responses. An optional argument only runs the benchmarks with a name
+ * containing it, and --min-time=<seconds> sets how long each one processes for.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "AL/efx.h"
+
+#include "alc/effects/base.h"
+#include "almalloc.h"
+#include "alnumeric.h"
+#include "alspan.h"
+#include "core/ambidefs.h"
+#include "core/buffer_storage.h"
+#include "core/bufferline.h"
+#include "core/context.h"
+#include "core/cpu_caps.h"
+#include "core/devformat.h"
+#include "core/device.h"
+#include "core/effectslot.h"
+#include "core/fpu_ctrl.h"
+#include "core/memory_stats.h"
+#include "core/voice.h"
+#include "intrusive_ptr.h"
+
+
+namespace {
+
+using std::chrono::steady_clock;
+
+double gMinTime{0.5};
+
+/* Heap allocations are counted while a step runs, for both the library's
+ * allocator (through the real-time allocation handler) and the global
+ * operator new.
+ */
+bool gCountAllocs{false};
+size_t gAllocCount{0};
+
+void CountAlloc(const char*, size_t size) noexcept
+{
+    if(size > 0)
+        ++gAllocCount;
+}
+
+class AllocCounter {
+    al::rt_alloc_scope mScope;
+
+public:
+    AllocCounter() noexcept { gAllocCount = 0; gCountAllocs = true; }
+    ~AllocCounter() { gCountAllocs = false; }
+
+    size_t count() const noexcept { return gAllocCount; }
+};
+
+
+struct EffectTest {
+    const char *mName;
+    EffectStateFactory *(*mGetFactory)();
+    EffectSlotType mType;
+    EffectProps mProps;
+    /* The impulse response length in seconds, for convolution. */
+    float mIrLength;
+};
+
+EffectProps ReverbProps()
+{
+    EffectProps props{};
+    props.Reverb.Density = AL_EAXREVERB_DEFAULT_DENSITY;
+    props.Reverb.Diffusion = AL_EAXREVERB_DEFAULT_DIFFUSION;
+    props.Reverb.Gain = AL_EAXREVERB_DEFAULT_GAIN;
+    props.Reverb.GainHF = AL_EAXREVERB_DEFAULT_GAINHF;
+    props.Reverb.GainLF = AL_EAXREVERB_DEFAULT_GAINLF;
+    props.Reverb.DecayTime = AL_EAXREVERB_DEFAULT_DECAY_TIME;
+    props.Reverb.DecayHFRatio = AL_EAXREVERB_DEFAULT_DECAY_HFRATIO;
+    props.Reverb.DecayLFRatio = AL_EAXREVERB_DEFAULT_DECAY_LFRATIO;
+    props.Reverb.ReflectionsGain = AL_EAXREVERB_DEFAULT_REFLECTIONS_GAIN;
+    props.Reverb.ReflectionsDelay = AL_EAXREVERB_DEFAULT_REFLECTIONS_DELAY;
+    props.Reverb.LateReverbGain = AL_EAXREVERB_DEFAULT_LATE_REVERB_GAIN;
+    props.Reverb.LateReverbDelay = AL_EAXREVERB_DEFAULT_LATE_REVERB_DELAY;
+    props.Reverb.EchoTime = AL_EAXREVERB_DEFAULT_ECHO_TIME;
+    props.Reverb.EchoDepth = AL_EAXREVERB_DEFAULT_ECHO_DEPTH;
+    props.Reverb.ModulationTime = AL_EAXREVERB_DEFAULT_MODULATION_TIME;
+    props.Reverb.ModulationDepth = AL_EAXREVERB_DEFAULT_MODULATION_DEPTH;
+    props.Reverb.AirAbsorptionGainHF = AL_EAXREVERB_DEFAULT_AIR_ABSORPTION_GAINHF;
+    props.Reverb.HFReference = AL_EAXREVERB_DEFAULT_HFREFERENCE;
+    props.Reverb.LFReference = AL_EAXREVERB_DEFAULT_LFREFERENCE;
+    props.Reverb.RoomRolloffFactor = AL_EAXREVERB_DEFAULT_ROOM_ROLLOFF_FACTOR;
+    props.Reverb.DecayHFLimit = AL_EAXREVERB_DEFAULT_DECAY_HFLIMIT;
+    return props;
+}
+
+EffectProps ChorusProps()
+{
+    EffectProps props{};
+    props.Chorus.Waveform = ChorusWaveform::Triangle;
+    props.Chorus.Phase = AL_CHORUS_DEFAULT_PHASE;
+    props.Chorus.Rate = AL_CHORUS_DEFAULT_RATE;
+    props.Chorus.Depth = AL_CHORUS_DEFAULT_DEPTH;
+    props.Chorus.Feedback = AL_CHORUS_DEFAULT_FEEDBACK;
+    props.Chorus.Delay = AL_CHORUS_DEFAULT_DELAY;
+    return props;
+}
+
+EffectProps FlangerProps()
+{
+    EffectProps props{};
+    props.Chorus.Waveform = ChorusWaveform::Triangle;
+    props.Chorus.Phase = AL_FLANGER_DEFAULT_PHASE;
+    props.Chorus.Rate = AL_FLANGER_DEFAULT_RATE;
+    props.Chorus.Depth = AL_FLANGER_DEFAULT_DEPTH;
+    props.Chorus.Feedback = AL_FLANGER_DEFAULT_FEEDBACK;
+    props.Chorus.Delay = AL_FLANGER_DEFAULT_DELAY;
+    return props;
+}
+
+EffectProps EchoProps()
+{
+    EffectProps props{};
+    props.Echo.Delay = AL_ECHO_DEFAULT_DELAY;
+    props.Echo.LRDelay = AL_ECHO_DEFAULT_LRDELAY;
+    props.Echo.Damping = AL_ECHO_DEFAULT_DAMPING;
+    props.Echo.Feedback = AL_ECHO_DEFAULT_FEEDBACK;
+    props.Echo.Spread = AL_ECHO_DEFAULT_SPREAD;
+    return props;
+}
+
+EffectProps EqualizerProps()
+{
+    EffectProps props{};
+    props.Equalizer.LowCutoff = AL_EQUALIZER_DEFAULT_LOW_CUTOFF;
+    props.Equalizer.LowGain = AL_EQUALIZER_DEFAULT_LOW_GAIN;
+    props.Equalizer.Mid1Center = AL_EQUALIZER_DEFAULT_MID1_CENTER;
+    props.Equalizer.Mid1Gain = AL_EQUALIZER_DEFAULT_MID1_GAIN;
+    props.Equalizer.Mid1Width = AL_EQUALIZER_DEFAULT_MID1_WIDTH;
+    props.Equalizer.Mid2Center = AL_EQUALIZER_DEFAULT_MID2_CENTER;
+    props.Equalizer.Mid2Gain = AL_EQUALIZER_DEFAULT_MID2_GAIN;
+    props.Equalizer.Mid2Width = AL_EQUALIZER_DEFAULT_MID2_WIDTH;
+    props.Equalizer.HighCutoff = AL_EQUALIZER_DEFAULT_HIGH_CUTOFF;
+    props.Equalizer.HighGain = AL_EQUALIZER_DEFAULT_HIGH_GAIN;
+    return props;
+}
+
+EffectProps CompressorProps()
+{
+    EffectProps props{};
+    props.Compressor.OnOff = AL_COMPRESSOR_DEFAULT_ONOFF;
+    return props;
+}
+
+EffectProps DistortionProps()
+{
+    EffectProps props{};
+    props.Distortion.Edge = AL_DISTORTION_DEFAULT_EDGE;
+    props.Distortion.Gain = AL_DISTORTION_DEFAULT_GAIN;
+    props.Distortion.LowpassCutoff = AL_DISTORTION_DEFAULT_LOWPASS_CUTOFF;
+    props.Distortion.EQCenter = AL_DISTORTION_DEFAULT_EQCENTER;
+    props.Distortion.EQBandwidth = AL_DISTORTION_DEFAULT_EQBANDWIDTH;
+    return props;
+}
+
+EffectProps AutowahProps()
+{
+    EffectProps props{};
+    props.Autowah.AttackTime = AL_AUTOWAH_DEFAULT_ATTACK_TIME;
+    props.Autowah.ReleaseTime = AL_AUTOWAH_DEFAULT_RELEASE_TIME;
+    props.Autowah.Resonance = AL_AUTOWAH_DEFAULT_RESONANCE;
+    props.Autowah.PeakGain = AL_AUTOWAH_DEFAULT_PEAK_GAIN;
+    return props;
+}
+
+EffectProps ModulatorProps()
+{
+    EffectProps props{};
+    props.Modulator.Frequency = AL_RING_MODULATOR_DEFAULT_FREQUENCY;
+    props.Modulator.HighPassCutoff = AL_RING_MODULATOR_DEFAULT_HIGHPASS_CUTOFF;
+    props.Modulator.Waveform = ModulatorWaveform::Sinusoid;
+    return props;
+}
+
+EffectProps FshifterProps()
+{
+    EffectProps props{};
+    props.Fshifter.Frequency = AL_FREQUENCY_SHIFTER_DEFAULT_FREQUENCY;
+    props.Fshifter.LeftDirection = FShifterDirection::Down;
+    props.Fshifter.RightDirection = FShifterDirection::Down;
+    return props;
+}
+
+EffectProps PshifterProps()
+{
+    EffectProps props{};
+    props.Pshifter.CoarseTune = AL_PITCH_SHIFTER_DEFAULT_COARSE_TUNE;
+    props.Pshifter.FineTune = AL_PITCH_SHIFTER_DEFAULT_FINE_TUNE;
+    return props;
+}
+
+EffectProps VmorpherProps()
+{
+    EffectProps props{};
+    props.Vmorpher.Rate = AL_VOCAL_MORPHER_DEFAULT_RATE;
+    props.Vmorpher.PhonemeA = VMorpherPhenome::A;
+    props.Vmorpher.PhonemeB = VMorpherPhenome::ER;
+    props.Vmorpher.PhonemeACoarseTuning = AL_VOCAL_MORPHER_DEFAULT_PHONEMEA_COARSE_TUNING;
+    props.Vmorpher.PhonemeBCoarseTuning = AL_VOCAL_MORPHER_DEFAULT_PHONEMEB_COARSE_TUNING;
+    props.Vmorpher.Waveform = VMorpherWaveform::Sinusoid;
+    return props;
+}
+
+EffectProps DedicatedProps()
+{
+    EffectProps props{};
+    props.Dedicated.Gain = 1.0f;
+    return props;
+}
+
+std::vector<EffectTest> GetEffectTests()
+{
+    return {
+        {"Reverb", ReverbStateFactory_getFactory, EffectSlotType::EAXReverb, ReverbProps(), 0.0f},
+        {"StdReverb", StdReverbStateFactory_getFactory, EffectSlotType::Reverb, ReverbProps(),
+            0.0f},
+        {"Chorus", ChorusStateFactory_getFactory, EffectSlotType::Chorus, ChorusProps(), 0.0f},
+        {"Flanger", FlangerStateFactory_getFactory, EffectSlotType::Flanger, FlangerProps(), 0.0f},
+        {"Echo", EchoStateFactory_getFactory, EffectSlotType::Echo, EchoProps(), 0.0f},
+        {"Equalizer", EqualizerStateFactory_getFactory, EffectSlotType::Equalizer,
+            EqualizerProps(), 0.0f},
+        {"Compressor", CompressorStateFactory_getFactory, EffectSlotType::Compressor,
+            CompressorProps(), 0.0f},
+        {"Distortion", DistortionStateFactory_getFactory, EffectSlotType::Distortion,
+            DistortionProps(), 0.0f},
+        {"Autowah", AutowahStateFactory_getFactory, EffectSlotType::Autowah, AutowahProps(), 0.0f},
+        {"Modulator", ModulatorStateFactory_getFactory, EffectSlotType::RingModulator,
+            ModulatorProps(), 0.0f},
+        {"Fshifter", FshifterStateFactory_getFactory, EffectSlotType::FrequencyShifter,
+            FshifterProps(), 0.0f},
+        {"Pshifter", PshifterStateFactory_getFactory, EffectSlotType::PitchShifter,
+            PshifterProps(), 0.0f},
+        {"Vmorpher", VmorpherStateFactory_getFactory, EffectSlotType::VocalMorpher,
+            VmorpherProps(), 0.0f},
+        {"Convolution0.5s", ConvolutionStateFactory_getFactory, EffectSlotType::Convolution,
+            EffectProps{}, 0.5f},
+        {"Convolution2s", ConvolutionStateFactory_getFactory, EffectSlotType::Convolution,
+            EffectProps{}, 2.0f},
+        {"Convolution8s", ConvolutionStateFactory_getFactory, EffectSlotType::Convolution,
+            EffectProps{}, 8.0f},
+        {"DedicatedDialog", DedicatedStateFactory_getFactory, EffectSlotType::DedicatedDialog,
+            DedicatedProps(), 0.0f},
+        {"DedicatedLFE", DedicatedStateFactory_getFactory, EffectSlotType::DedicatedLFE,
+            DedicatedProps(), 0.0f},
+    };
+}
+
+
+/* Fills the buffer with a deterministic, band-limited-ish test signal. */
+void FillSignal(const al::span<float> buffer, const float scale)
+{
+    for(size_t i{0};i < buffer.size();++i)
+    {
+        const auto t = static_cast<float>(i);
+        buffer[i] = (std::sin(t*0.05f)*0.5f + std::sin(t*0.31f)*0.25f) * scale;
+    }
+}
+
+/* A stereo impulse response of exponentially decaying noise. */
+struct ImpulseResponse {
+    std::vector<float> mSamples;
+    BufferStorage mStorage;
+
+    ImpulseResponse(const float seconds, const uint rate)
+    {
+        const auto frames = static_cast<uint>(seconds * static_cast<float>(rate));
+        mSamples.resize(size_t{frames} * 2);
+
+        uint32_t seed{22222};
+        const float decay{std::log(ReverbDecayGain) / static_cast<float>(frames)};
+        for(size_t i{0};i < mSamples.size();++i)
+        {
+            seed = seed*96314165u + 907633515u;
+            const float noise{static_cast<float>(seed>>8)/static_cast<float>(1u<<23) - 1.0f};
+            mSamples[i] = noise * std::exp(decay*static_cast<float>(i/2));
+        }
+
+        mStorage.mData = {reinterpret_cast<std::byte*>(mSamples.data()),
+            mSamples.size()*sizeof(float)};
+        mStorage.mSampleRate = rate;
+        mStorage.mChannels = FmtStereo;
+        mStorage.mType = FmtFloat;
+        mStorage.mSampleLen = frames;
+        mStorage.mBlockAlign = 1;
+    }
+};
+
+
+/* Sets up a device, context, and effect slot the same as the library does for
+ * ambisonic output of the given order, so effects can run outside of a device.
+ */
+struct EffectHarness {
+    DeviceBase mDevice{DeviceType::Loopback};
+    std::unique_ptr<ContextBase> mContext;
+    EffectSlot mSlot;
+    std::vector<FloatBufferLine> mDryBuffer;
+    std::vector<FloatBufferLine> mWetBuffer;
+
+    EffectHarness(const uint rate, const uint order)
+    {
+        const size_t count{AmbiChannelsFromOrder(order)};
+
+        mDevice.Frequency = rate;
+        mDevice.MixFrequency = rate;
+        mDevice.UpdateSize = BufferLineSize;
+        mDevice.FmtChans = DevFmtAmbi3D;
+        mDevice.mAmbiOrder = order;
+        mDevice.mRenderMode = RenderMode::Normal;
+
+        mDryBuffer.resize(count);
+        auto acnmap_begin = AmbiIndex::FromACN().begin();
+        std::transform(acnmap_begin, acnmap_begin + count, mDevice.Dry.AmbiMap.begin(),
+            [](const uint8_t &acn) noexcept -> BFChannelConfig
+            { return BFChannelConfig{1.0f, acn}; });
+        mDevice.Dry.Buffer = mDryBuffer;
+        mDevice.RealOut.ChannelIndex.fill(InvalidChannelIndex);
+        mDevice.RealOut.Buffer = mDryBuffer;
+
+        mContext = std::make_unique<ContextBase>(&mDevice);
+
+        mWetBuffer.resize(count);
+        std::transform(acnmap_begin, acnmap_begin + count, mSlot.Wet.AmbiMap.begin(),
+            [](const uint8_t &acn) noexcept -> BFChannelConfig
+            { return BFChannelConfig{1.0f, acn}; });
+        mSlot.Wet.Buffer = mWetBuffer;
+
+        /* Give each input channel some signal, with the higher orders
+         * quieter.
+         */
+        for(size_t c{0};c < count;++c)
+        {
+            const float scale{1.0f / static_cast<float>(1u + AmbiIndex::OrderFromChannel()[c])};
+            FillSignal(mWetBuffer[c], scale);
+        }
+    }
+};
+
+
+template<typename F>
+double TimeIt(F&& func)
+{
+    const auto start = steady_clock::now();
+    func();
+    return std::chrono::duration<double>(steady_clock::now() - start).count();
+}
+
+void RunEffect(const EffectTest &test, const uint rate, const uint order)
+{
+    EffectHarness harness{rate, order};
+    std::optional<ImpulseResponse> ir;
+    if(test.mIrLength > 0.0f)
+        ir.emplace(test.mIrLength, 48000u);
+    const BufferStorage *buffer{ir ? &ir->mStorage : nullptr};
+
+    EffectSlot &slot = harness.mSlot;
+    slot.EffectType = test.mType;
+    slot.mEffectProps = test.mProps;
+    const EffectTarget target{&harness.mDevice.Dry, &harness.mDevice.RealOut};
+
+    /* Count the allocations for the first setup, like when the effect is
+     * first applied to a slot, and time it from the best of a few runs.
+     */
+    al::intrusive_ptr<EffectState> state;
+    size_t setupAllocs{}, updateAllocs{};
+    {
+        AllocCounter counter;
+        state = test.mGetFactory()->create();
+        state->reserve(&test.mProps);
+        state->deviceUpdate(&harness.mDevice, buffer);
+        setupAllocs = counter.count();
+    }
+    {
+        AllocCounter counter;
+        state->update(harness.mContext.get(), &slot, &test.mProps, target);
+        updateAllocs = counter.count();
+    }
+
+    double setupTime{TimeIt([&]{ state->deviceUpdate(&harness.mDevice, buffer); })};
+    double updateTime{TimeIt([&]{ state->update(harness.mContext.get(), &slot, &test.mProps,
+        target); })};
+    for(int i{0};i < 2;++i)
+    {
+        setupTime = std::min(setupTime,
+            TimeIt([&]{ state->deviceUpdate(&harness.mDevice, buffer); }));
+        updateTime = std::min(updateTime, TimeIt([&]{
+            state->update(harness.mContext.get(), &slot, &test.mProps, target); }));
+    }
+
+    /* Process the wet buffer with the effect until the minimum time, with the
+     * mixer's floating-point mode.
+     */
+    FPUCtl mixer_mode{};
+    auto process = [&state,&slot]()
+    { state->process(BufferLineSize, slot.Wet.Buffer, state->mOutTarget); };
+    for(size_t i{0};i < 4;++i)
+        process();
+
+    size_t processAllocs{};
+    size_t iterations{0};
+    double elapsed{0.0};
+    {
+        AllocCounter counter;
+        const auto start = steady_clock::now();
+        do {
+            for(size_t i{0};i < 16;++i)
+                process();
+            iterations += 16;
+            elapsed = std::chrono::duration<double>(steady_clock::now() - start).count();
+        } while(elapsed < gMinTime);
+        processAllocs = counter.count();
+    }
+    mixer_mode.leave();
+
+    const double nsPerSample{elapsed * 1e9 / static_cast<double>(iterations*BufferLineSize)};
+    const int64_t memory{harness.mDevice.mMemoryStats->current(MemCategory::Effects)};
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s/%u/O%u", test.mName, rate, order);
+    std::printf("%-28s %10.2f %7.1f%% %10.3f %10.2f %5zu/%zu/%zu %9.1f\n", name, nsPerSample,
+        nsPerSample * static_cast<double>(rate) / 1e7, setupTime*1e3, updateTime*1e6,
+        setupAllocs, updateAllocs, processAllocs, static_cast<double>(memory) / 1024.0);
+}
+
+} // namespace
+
+
+/* Count the global allocations too, for storage that doesn't use the
+ * library's allocator. These aren't inlined so the compiler doesn't mistake
+ * them for mismatched with the built-in operator new.
+ */
+[[gnu::noinline]] void *operator new(size_t size)
+{
+    if(gCountAllocs)
+        ++gAllocCount;
+    if(void *ret{std::malloc(size ? size : 1)})
+        return ret;
+    throw std::bad_alloc{};
+}
+[[gnu::noinline]] void operator delete(void *block) noexcept { std::free(block); }
+[[gnu::noinline]] void operator delete(void *block, size_t) noexcept { std::free(block); }
+
+[[gnu::noinline]] void *operator new(size_t size, std::align_val_t alignment)
+{
+    if(gCountAllocs)
+        ++gAllocCount;
+    if(void *ret{al_malloc(static_cast<size_t>(alignment), size ? size : 1)})
+        return ret;
+    throw std::bad_alloc{};
+}
+[[gnu::noinline]] void operator delete(void *block, std::align_val_t) noexcept
+{ al_free(block); }
+[[gnu::noinline]] void operator delete(void *block, size_t, std::align_val_t) noexcept
+{ al_free(block); }
+
+
+int main(int argc, char **argv)
+{
+    const char *filter{nullptr};
+    for(int i{1};i < argc;++i)
+    {
+        if(std::strncmp(argv[i], "--min-time=", 11) == 0)
+            gMinTime = std::max(std::atof(argv[i]+11), 0.001);
+        else if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0)
+        {
+            std::printf("Usage: %s [--min-time=<seconds>] [filter]\n", argv[0]);
+            return 0;
+        }
+        else
+            filter = argv[i];
+    }
+
+    if(auto cpuopt = GetCPUInfo())
+    {
+        CPUCapFlags = cpuopt->mCaps;
+        if(!cpuopt->mName.empty())
+            std::printf("CPU: %s\n", cpuopt->mName.c_str());
+    }
+    Voice::InitMixer(std::nullopt);
+    al::set_rt_alloc_handler(CountAlloc);
+
+    std::printf("%-28s %10s %8s %10s %10s %11s %9s\n", "Benchmark", "ns/sample", "CPU",
+        "Setup ms", "Update us", "Allocs", "KiB");
+    std::printf("%s\n", std::string(92, '-').c_str());
+
+    static constexpr std::array<uint,3> rates{{44100u, 48000u, 96000u}};
+    for(const EffectTest &test : GetEffectTests())
+    {
+        for(const uint rate : rates)
+        {
+            for(uint order{1};order <= 3;++order)
+            {
+                char name[64];
+                std::snprintf(name, sizeof(name), "%s/%u/O%u", test.mName, rate, order);
+                if(!filter || std::strstr(name, filter) != nullptr)
+                    RunEffect(test, rate, order);
+            }
+        }
+    }
+    std::printf("\nCPU is the percentage of one core needed to run in real time. Allocs are\n"
+        "for the initial deviceUpdate, update, and all processing.\n");
+
+    return 0;
+}
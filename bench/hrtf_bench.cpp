@@ -0,0 +1,547 @@
+/*
+ * Benchmarks for the HRTF engine
+ *
+ * For each HRTF data set found, measures the time to load it at its own
+ * sample rate and resampled to other rates, the cost of getting the
+ * coefficients for a direction (with and without a precomputed grid), and the
+ * time to build the ambisonic decoder's HRTF state for each order and IR
+ * length. It then measures mixing throughput with the CPU's best HRTF mixers:
+ * the ambisonic decode for each order and IR length, and 16, 64, and 256
+ * per-source HRTF voices at each IR length, both steady and blending to new
+ * coefficients. The CPU load is given for a 48kHz device, to help pick the
+ * hrtf-size for a platform.
+ *
+ * Data sets are found the same way as the library does, in the default data
+ * paths and from the given --hrtf-paths=<list>, a comma-separated list of
+ * directories with .mhr files (a trailing comma also searches the default
+ * paths). An optional argument only runs the benchmarks with a name
+ * containing it, and --min-time=<seconds> sets how long each one runs for.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "alnumbers.h"
+#include "alnumeric.h"
+#include "alspan.h"
+#include "core/ambidefs.h"
+#include "core/bufferline.h"
+#include "core/cpu_caps.h"
+#include "core/hrtf.h"
+#include "core/logging.h"
+#include "core/mixer/defs.h"
+#include "core/mixer/hrtfdefs.h"
+#include "vector.h"
+
+struct CTag;
+struct SSETag;
+struct AVX2Tag;
+struct NEONTag;
+
+
+namespace {
+
+using std::chrono::steady_clock;
+
+double gMinTime{0.5};
+const char *gFilter{nullptr};
+
+/* The sample rate the CPU load is given for. */
+constexpr double LoadRate{48000.0};
+
+constexpr std::array<uint,5> IrSizes{{MinIrLength, 16, 32, 64, HrirLength}};
+constexpr std::array<uint,3> VoiceCounts{{16, 64, 256}};
+
+
+using HrtfMixerFunc = void(*)(const float *InSamples, float2 *AccumSamples, const uint IrSize,
+    const MixHrtfFilter *hrtfparams, const size_t BufferSize);
+using HrtfMixerBlendFunc = void(*)(const float *InSamples, float2 *AccumSamples,
+    const uint IrSize, const HrtfFilter *oldparams, const MixHrtfFilter *newparams,
+    const size_t BufferSize);
+using HrtfDirectMixerFunc = void(*)(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
+    const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples, float *TempBuf,
+    const size_t TempStride, HrtfChannelState *ChanState, const size_t IrSize,
+    const size_t BufferSize);
+
+struct HrtfMixers {
+    const char *mName;
+    HrtfMixerFunc mMix;
+    HrtfMixerBlendFunc mBlend;
+    HrtfDirectMixerFunc mDirect;
+};
+
+/* Picks the mixers the library would use on this CPU. */
+HrtfMixers SelectMixers()
+{
+#ifdef HAVE_NEON
+    if((CPUCapFlags&CPU_CAP_NEON))
+        return {"NEON", MixHrtf_<NEONTag>, MixHrtfBlend_<NEONTag>, MixDirectHrtf_<NEONTag>};
+#endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+        return {"AVX2", MixHrtf_<AVX2Tag>, MixHrtfBlend_<AVX2Tag>, MixDirectHrtf_<AVX2Tag>};
+#endif
+#ifdef HAVE_SSE
+    if((CPUCapFlags&CPU_CAP_SSE))
+        return {"SSE", MixHrtf_<SSETag>, MixHrtfBlend_<SSETag>, MixDirectHrtf_<SSETag>};
+#endif
+    return {"C", MixHrtf_<CTag>, MixHrtfBlend_<CTag>, MixDirectHrtf_<CTag>};
+}
+
+
+template<typename T>
+void DoNotOptimize(const T &value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+bool Selected(const std::string &name)
+{ return !gFilter || name.find(gFilter) != std::string::npos; }
+
+/* Runs the function with increasing iteration counts until it takes at least
+ * the minimum time, and returns the seconds per iteration.
+ */
+double TimeIt(const std::function<void()> &func)
+{
+    for(size_t i{0};i < 4;++i)
+        func();
+
+    size_t iterations{4};
+    while(true)
+    {
+        const auto start = steady_clock::now();
+        for(size_t i{0};i < iterations;++i)
+            func();
+        const double elapsed{std::chrono::duration<double>(steady_clock::now() - start).count()};
+
+        if(elapsed >= gMinTime || iterations >= (size_t{1}<<40))
+            return elapsed / static_cast<double>(iterations);
+
+        const double scale{(elapsed > 0.0) ? gMinTime*1.4 / elapsed : 10.0};
+        iterations = static_cast<size_t>(static_cast<double>(iterations) * std::min(10.0, scale))
+            + 1;
+    }
+}
+
+/* Times a single run of something too slow or stateful to repeat in a loop,
+ * taking the fastest of a few tries.
+ */
+double TimeOnce(const std::function<void()> &func, const int tries=3)
+{
+    double best{};
+    for(int i{0};i < tries;++i)
+    {
+        const auto start = steady_clock::now();
+        func();
+        const double elapsed{std::chrono::duration<double>(steady_clock::now() - start).count()};
+        if(i == 0 || elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+/* A simple LCG, so the directions are the same on every run. */
+float NextRandom(uint &seed)
+{
+    seed = seed*96314165u + 907633515u;
+    return static_cast<float>(seed>>8) / 16777216.0f;
+}
+
+void FillSignal(const al::span<float> buffer)
+{
+    for(size_t i{0};i < buffer.size();++i)
+    {
+        const auto t = static_cast<float>(i);
+        buffer[i] = std::sin(t*0.05f)*0.5f + std::sin(t*0.31f)*0.25f;
+    }
+}
+
+
+/* The decoder for the ambisonic HRTF mix uses the vertices of a cube,
+ * icosahedron, or dodecahedron for 1st, 2nd, or 3rd order, like the library's,
+ * but with a plain sampling decoder. The decoding matrix doesn't change how
+ * long building or mixing takes.
+ */
+struct AmbiDecoder {
+    std::vector<AngularPoint> mPoints;
+    std::vector<std::array<float,MaxAmbiChannels>> mMatrix;
+    std::array<float,MaxAmbiOrder+1> mOrderHFGain{};
+
+    ~AmbiDecoder();
+};
+AmbiDecoder::~AmbiDecoder() = default;
+
+AmbiDecoder MakeDecoder(const uint order)
+{
+    /* The golden ratio. */
+    constexpr float phi{1.618033988749894848f};
+    constexpr float iphi{1.0f / phi};
+
+    std::vector<std::array<float,3>> verts;
+    auto add_signs = [&verts](const std::array<float,3> &v)
+    {
+        for(int i{0};i < 8;++i)
+        {
+            const std::array<float,3> s{{(i&1) ? -v[0] : v[0], (i&2) ? -v[1] : v[1],
+                (i&4) ? -v[2] : v[2]}};
+            if(std::find(verts.begin(), verts.end(), s) == verts.end())
+                verts.emplace_back(s);
+        }
+    };
+    auto add_cyclic = [&add_signs](const std::array<float,3> &v)
+    {
+        add_signs(v);
+        add_signs({{v[1], v[2], v[0]}});
+        add_signs({{v[2], v[0], v[1]}});
+    };
+    if(order <= 1)
+        add_signs({{1.0f, 1.0f, 1.0f}});
+    else if(order == 2)
+        add_cyclic({{0.0f, 1.0f, phi}});
+    else
+    {
+        add_signs({{1.0f, 1.0f, 1.0f}});
+        add_cyclic({{0.0f, iphi, phi}});
+    }
+
+    AmbiDecoder decoder;
+    const size_t numchans{AmbiChannelsFromOrder(order)};
+    for(auto &v : verts)
+    {
+        const float len{std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2])};
+        const float x{v[0]/len}, y{v[1]/len}, z{v[2]/len};
+
+        decoder.mPoints.emplace_back(AngularPoint{EvRadians{std::asin(y)},
+            AzRadians{std::atan2(x, -z)}});
+
+        auto coeffs = CalcAmbiCoeffs(-x, y, -z);
+        std::fill(coeffs.begin()+static_cast<ptrdiff_t>(numchans), coeffs.end(), 0.0f);
+        for(float &coeff : coeffs)
+            coeff /= static_cast<float>(verts.size());
+        decoder.mMatrix.emplace_back(coeffs);
+    }
+    std::fill_n(decoder.mOrderHFGain.begin(), order+1, 1.0f);
+    return decoder;
+}
+
+std::unique_ptr<DirectHrtfState> BuildHrtfState(const HrtfStore *hrtf, const uint irsize,
+    const uint order, const AmbiDecoder &decoder)
+{
+    auto state = DirectHrtfState::Create(AmbiChannelsFromOrder(order));
+    state->build(hrtf, irsize, order >= 3, decoder.mPoints,
+        reinterpret_cast<const float(*)[MaxAmbiChannels]>(decoder.mMatrix.data()),
+        400.0f / static_cast<float>(hrtf->mSampleRate), decoder.mOrderHFGain);
+    return state;
+}
+
+
+/* The data set's own sample rate isn't kept once it's resampled, so it's
+ * found from the library's trace message when loading it at another rate.
+ * Returns 0 if it couldn't be found, such as with trace messages built out.
+ */
+uint FindNativeRate(const std::string &name)
+{
+    FILE *log{std::tmpfile()};
+    if(!log) return 0;
+
+    FILE *oldfile{std::exchange(gLogFile, log)};
+    const LogLevel oldlevel{std::exchange(gLogLevel, LogLevel::Trace)};
+    uint rate{0};
+    if(HrtfStorePtr hrtf{GetLoadedHrtf(name, 48000, 0, false)})
+        rate = hrtf->mSampleRate;
+    gLogFile = oldfile;
+    gLogLevel = oldlevel;
+
+    std::rewind(log);
+    std::array<char,1024> line{};
+    while(std::fgets(line.data(), static_cast<int>(line.size()), log))
+    {
+        if(!std::strstr(line.data(), "Resampling HRTF "))
+            continue;
+        uint from{}, to{};
+        const char *paren{std::strrchr(line.data(), '(')};
+        if(paren && std::sscanf(paren, "(%uhz -> %uhz)", &from, &to) == 2)
+            rate = from;
+    }
+    std::fclose(log);
+    return rate;
+}
+
+void BenchLoad(const std::string &name)
+{
+    /* Releasing the last reference to a data set unloads it, so each load
+     * reads it again.
+     */
+    const uint native_rate{FindNativeRate(name)};
+    if(native_rate)
+        std::printf("  Sample rate:        %9u Hz\n", native_rate);
+
+    for(const uint rate : {44100u, 48000u, 96000u})
+    {
+        HrtfStorePtr hrtf;
+        const double secs{TimeOnce([&name,rate,&hrtf]
+            {
+                hrtf = nullptr;
+                hrtf = GetLoadedHrtf(name, rate, 0, false);
+            })};
+        if(!hrtf)
+        {
+            std::printf("  Failed to load at %uHz\n", rate);
+            continue;
+        }
+
+        constexpr uint gridres{5};
+        HrtfStorePtr gridhrtf;
+        const double gridsecs{TimeOnce([&name,rate,&gridhrtf]
+            {
+                gridhrtf = nullptr;
+                gridhrtf = GetLoadedHrtf(name, rate, gridres, false);
+            })};
+
+        const char *note{!native_rate ? "" : (rate == native_rate) ? " (native)"
+            : " (resampled)"};
+        std::printf("  Load @ %6uHz:     %9.3f ms, %9.3f ms with a %u deg grid, %3u IR, "
+            "%7.1f KiB%s\n", rate, secs*1000.0, gridsecs*1000.0, gridres, hrtf->mIrSize,
+            static_cast<double>(hrtf->memoryUsage())/1024.0, note);
+    }
+}
+
+void BenchCoeffs(HrtfStore *hrtf, HrtfStore *gridhrtf)
+{
+    /* Random directions and spreads, as for moving sources. */
+    constexpr size_t NumDirs{256};
+    struct Direction { float ev, az, spread; };
+    std::vector<Direction> dirs(NumDirs);
+    uint seed{1234};
+    for(auto &dir : dirs)
+    {
+        dir.ev = (NextRandom(seed) - 0.5f) * al::numbers::pi_v<float>;
+        dir.az = (NextRandom(seed)*2.0f - 1.0f) * al::numbers::pi_v<float>;
+        dir.spread = (NextRandom(seed) < 0.25f) ? NextRandom(seed) : 0.0f;
+    }
+
+    auto coeffs = std::make_unique<HrirArray>();
+    std::array<uint,2> delays{};
+    auto run_coeffs = [&dirs,&coeffs,&delays](HrtfStore *store)
+    {
+        for(const auto &dir : dirs)
+        {
+            store->getCoeffs(dir.ev, dir.az, std::numeric_limits<float>::infinity(), dir.spread,
+                *coeffs, delays);
+            DoNotOptimize(coeffs->front());
+        }
+    };
+
+    const double secs{TimeIt([&run_coeffs,hrtf]{ run_coeffs(hrtf); })};
+    std::printf("  getCoeffs:          %9.1f ns/call", secs*1e9/NumDirs);
+    if(gridhrtf)
+    {
+        const double gridsecs{TimeIt([&run_coeffs,gridhrtf]{ run_coeffs(gridhrtf); })};
+        std::printf(", %9.1f ns/call with a %u deg grid", gridsecs*1e9/NumDirs,
+            gridhrtf->mGridRes);
+    }
+    std::printf("\n");
+}
+
+void BenchDirect(const HrtfMixers &mixers, HrtfStore *hrtf)
+{
+    auto input = std::vector<FloatBufferLine>(MaxAmbiChannels);
+    for(auto &line : input)
+        FillSignal(line);
+    auto left = std::make_unique<FloatBufferLine>();
+    auto right = std::make_unique<FloatBufferLine>();
+    al::vector<float2,16> accum(BufferLineSize + HrirLength);
+
+    std::printf("  Ambisonic decode    %9s %12s %12s %8s\n", "IR", "Build", "Mix", "CPU");
+    for(uint order{1};order <= MaxAmbiOrder;++order)
+    {
+        const AmbiDecoder decoder{MakeDecoder(order)};
+        const auto numchans = AmbiChannelsFromOrder(order);
+        for(const uint irsize : IrSizes)
+        {
+            if(irsize > hrtf->mIrSize)
+                continue;
+
+            std::unique_ptr<DirectHrtfState> state;
+            const double buildsecs{TimeOnce([&state,hrtf,irsize,order,&decoder]
+                { state = BuildHrtfState(hrtf, irsize, order, decoder); })};
+
+            const al::span<const FloatBufferLine> inspan{input.data(), numchans};
+            const double mixsecs{TimeIt([&]
+                {
+                    DirectHrtfState &st = *state;
+                    if(!st.mTailSegs)
+                        mixers.mDirect(*left, *right, inspan, accum.data(), st.mTemp.data(), 0,
+                            st.mChannels.data(), st.mIrSize, BufferLineSize);
+                    else
+                    {
+                        mixers.mDirect(*left, *right, inspan, accum.data(),
+                            st.mTailInput.data(), BufferLineSize, st.mChannels.data(),
+                            st.mIrSize, BufferLineSize);
+                        st.processTail(*left, *right, BufferLineSize);
+                    }
+                    DoNotOptimize(left->front());
+                })};
+
+            std::printf("    Order %u           %9u %9.3f ms %9.2f us %7.2f%%\n", order,
+                irsize, buildsecs*1000.0, mixsecs*1e6,
+                mixsecs / (BufferLineSize/LoadRate) * 100.0);
+        }
+    }
+}
+
+void BenchVoices(const HrtfMixers &mixers, HrtfStore *hrtf)
+{
+    constexpr uint MaxVoices{VoiceCounts.back()};
+
+    /* Each voice has its own input, and coefficients for its own direction,
+     * so the mixers don't work from a single set of coefficients that stays
+     * in the cache.
+     */
+    struct VoiceData {
+        std::array<float,HrtfHistoryLength+BufferLineSize> mInput;
+        HrtfFilter mOld;
+        HrtfFilter mTarget;
+    };
+    auto voices = std::make_unique<VoiceData[]>(MaxVoices);
+    uint seed{5678};
+    for(uint i{0};i < MaxVoices;++i)
+    {
+        VoiceData &voice = voices[i];
+        FillSignal(voice.mInput);
+
+        auto get_filter = [hrtf,&seed](HrtfFilter &filter)
+        {
+            const float ev{(NextRandom(seed) - 0.5f) * al::numbers::pi_v<float>};
+            const float az{(NextRandom(seed)*2.0f - 1.0f) * al::numbers::pi_v<float>};
+            hrtf->getCoeffs(ev, az, std::numeric_limits<float>::infinity(), 0.0f,
+                filter.Coeffs, filter.Delay);
+            filter.Gain = 0.5f;
+        };
+        get_filter(voice.mOld);
+        get_filter(voice.mTarget);
+    }
+    al::vector<float2,16> accum(BufferLineSize + HrirLength);
+
+    std::printf("  Voices              %9s %12s %8s %12s %8s\n", "IR", "Mix", "CPU", "Blend",
+        "CPU");
+    for(const uint numvoices : VoiceCounts)
+    {
+        for(const uint irsize : IrSizes)
+        {
+            if(irsize > hrtf->mIrSize)
+                continue;
+
+            const double mixsecs{TimeIt([&]
+                {
+                    for(uint i{0};i < numvoices;++i)
+                    {
+                        const VoiceData &voice = voices[i];
+                        const MixHrtfFilter params{voice.mTarget.Coeffs, voice.mTarget.Delay,
+                            voice.mTarget.Gain, 0.0f};
+                        mixers.mMix(voice.mInput.data(), accum.data(), irsize, &params,
+                            BufferLineSize);
+                    }
+                    DoNotOptimize(accum.front());
+                    std::fill(accum.begin(), accum.end(), float2{});
+                })};
+            const double blendsecs{TimeIt([&]
+                {
+                    for(uint i{0};i < numvoices;++i)
+                    {
+                        const VoiceData &voice = voices[i];
+                        const MixHrtfFilter params{voice.mTarget.Coeffs, voice.mTarget.Delay,
+                            0.0f, voice.mTarget.Gain/float{BufferLineSize}};
+                        mixers.mBlend(voice.mInput.data(), accum.data(), irsize, &voice.mOld,
+                            &params, BufferLineSize);
+                    }
+                    DoNotOptimize(accum.front());
+                    std::fill(accum.begin(), accum.end(), float2{});
+                })};
+
+            const double budget{BufferLineSize / LoadRate};
+            std::printf("    %3u voices        %9u %9.2f us %7.2f%% %9.2f us %7.2f%%\n",
+                numvoices, irsize, mixsecs*1e6, mixsecs/budget*100.0, blendsecs*1e6,
+                blendsecs/budget*100.0);
+        }
+    }
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    std::optional<std::string> hrtfpaths;
+    for(int i{1};i < argc;++i)
+    {
+        if(std::strncmp(argv[i], "--min-time=", 11) == 0)
+            gMinTime = std::max(std::atof(argv[i]+11), 0.001);
+        else if(std::strncmp(argv[i], "--hrtf-paths=", 13) == 0)
+            hrtfpaths = argv[i]+13;
+        else if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0)
+        {
+            std::printf("Usage: %s [--min-time=<seconds>] [--hrtf-paths=<list>] [filter]\n",
+                argv[0]);
+            return 0;
+        }
+        else
+            gFilter = argv[i];
+    }
+
+    if(auto cpuopt = GetCPUInfo())
+    {
+        CPUCapFlags = cpuopt->mCaps;
+        if(!cpuopt->mName.empty())
+            std::printf("CPU: %s\n", cpuopt->mName.c_str());
+    }
+    const HrtfMixers mixers{SelectMixers()};
+    std::printf("HRTF mixers: %s, CPU load for %u sample updates at %.0fHz\n", mixers.mName,
+        BufferLineSize, LoadRate);
+
+    const std::vector<std::string> names{EnumerateHrtf(hrtfpaths)};
+    if(names.empty())
+    {
+        std::fprintf(stderr, "No HRTF data sets found\n");
+        return 1;
+    }
+
+    for(const std::string &name : names)
+    {
+        if(!Selected(name))
+            continue;
+
+        std::printf("\n%s\n", name.c_str());
+        BenchLoad(name);
+
+        HrtfStorePtr hrtf{GetLoadedHrtf(name, static_cast<uint>(LoadRate), 0, false)};
+        HrtfStorePtr gridhrtf{GetLoadedHrtf(name, static_cast<uint>(LoadRate), 5, false)};
+        if(!hrtf)
+            continue;
+
+        BenchCoeffs(hrtf.get(), gridhrtf.get());
+        BenchDirect(mixers, hrtf.get());
+        BenchVoices(mixers, hrtf.get());
+    }
+
+    return 0;
+}
@@ -0,0 +1,1237 @@
+/*
+ * Microbenchmarks for the mixer kernels
+ *
+ * Runs each resampler, gain mixer, HRTF mixer, output converter, and the
+ * biquad, band splitter, and NFC filters for every instruction set the build
+ * and CPU support, along with the FFTs used by the effects, the UHJ filters,
+ * the bs2b crossfeed, the front stablizer, and the ADPCM decoders, and reports
+ * the time per call and the samples processed per second. An optional argument
+ * only runs the benchmarks with a name containing it, and --min-time=<seconds>
+ * sets how long each benchmark runs for.
+ *
+ * With --verify, it instead checks that the output of each resampler, mixer,
+ * output converter, and half-float loader built for an instruction set matches
+ * the C version, and exits with an error if any differ by more than rounding
+ * allows.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "alcomplex.h"
+#include "alnumeric.h"
+#include "alspan.h"
+#include "core/adpcm.h"
+#include "core/bformatdec.h"
+#include "core/bs2b.h"
+#include "core/bsinc_defs.h"
+#include "core/bsinc_tables.h"
+#include "core/bufferline.h"
+#include "core/cpu_caps.h"
+#include "core/cubic_tables.h"
+#include "core/devformat.h"
+#include "core/filters/biquad.h"
+#include "core/filters/nfc.h"
+#include "core/filters/splitter.h"
+#include "core/fmt_traits.h"
+#include "core/front_stablizer.h"
+#include "core/mastering.h"
+#include "core/mixer/defs.h"
+#include "core/mixer/hrtfdefs.h"
+#include "core/outputconv.h"
+#include "core/resampler_limits.h"
+#include "core/uhjfilter.h"
+#include "opthelpers.h"
+
+struct CTag;
+struct SSETag;
+struct SSE2Tag;
+struct SSE4Tag;
+struct AVX2Tag;
+struct AVX512Tag;
+struct F16CTag;
+struct NEONTag;
+
+struct PointTag;
+struct LerpTag;
+struct CubicTag;
+struct BSincTag;
+struct FastBSincTag;
+
+
+namespace {
+
+using std::chrono::steady_clock;
+
+struct Benchmark {
+    std::string mName;
+    /* The number of samples processed by each call. */
+    size_t mSamples;
+    std::function<void()> mFunc;
+
+    ~Benchmark();
+};
+/* Out of line, so each benchmark added doesn't inline cleanup code for it. */
+Benchmark::~Benchmark() = default;
+
+std::vector<Benchmark> gBenchmarks;
+double gMinTime{0.5};
+
+/* A check of a kernel against its C version, for --verify. The function runs
+ * both on the same input and returns the largest difference in their output,
+ * or for the conversions that should be exact, the number of samples that
+ * differ.
+ */
+struct Check {
+    std::string mName;
+    double mTolerance;
+    std::function<double()> mFunc;
+
+    ~Check();
+};
+Check::~Check() = default;
+
+std::vector<Check> gChecks;
+
+/* The objects the benchmarks and checks work on, kept until the program ends.
+ * The functions then only need to capture plain pointers, so they don't have
+ * any cleanup of their own.
+ */
+std::vector<std::shared_ptr<void>> gBenchData;
+
+template<typename T, typename D>
+T *KeepBenchData(std::unique_ptr<T,D> data)
+{
+    T *ret{data.get()};
+    gBenchData.emplace_back(std::move(data));
+    return ret;
+}
+
+template<typename T, typename ...Args>
+T *NewBenchData(Args&& ...args)
+{ return KeepBenchData(std::make_unique<T>(std::forward<Args>(args)...)); }
+
+/* The vectorized float kernels can add in a different order or fuse multiplies
+ * and adds, so allow for some rounding differences on the test signal (which
+ * peaks around 0.75).
+ */
+constexpr double FloatTolerance{1e-5};
+
+
+struct Isa {
+    const char *mName;
+    int mCaps;
+};
+
+/* Checks if the instruction set's functions are in the build and usable. */
+bool IsaAvailable(const Isa &isa)
+{ return (CPUCapFlags&isa.mCaps) == isa.mCaps; }
+
+constexpr Isa IsaC{"C", 0};
+#ifdef HAVE_SSE
+constexpr Isa IsaSSE{"SSE", CPU_CAP_SSE};
+#endif
+#ifdef HAVE_SSE2
+constexpr Isa IsaSSE2{"SSE2", CPU_CAP_SSE2};
+#endif
+#ifdef HAVE_SSE4_1
+constexpr Isa IsaSSE4{"SSE4.1", CPU_CAP_SSE4_1};
+#endif
+#ifdef HAVE_AVX2
+constexpr Isa IsaAVX2{"AVX2", CPU_CAP_AVX2|CPU_CAP_FMA};
+constexpr Isa IsaF16C{"F16C", CPU_CAP_F16C};
+#endif
+#ifdef HAVE_AVX512
+constexpr Isa IsaAVX512{"AVX-512", CPU_CAP_AVX512};
+#endif
+#ifdef HAVE_NEON
+constexpr Isa IsaNEON{"NEON", CPU_CAP_NEON};
+#endif
+
+
+template<typename T>
+void DoNotOptimize(const T &value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+/* Fills the buffer with a deterministic, band-limited-ish test signal. */
+void FillSignal(const al::span<float> buffer)
+{
+    for(size_t i{0};i < buffer.size();++i)
+    {
+        const auto t = static_cast<float>(i);
+        buffer[i] = std::sin(t*0.05f)*0.5f + std::sin(t*0.31f)*0.25f;
+    }
+}
+
+/* Gets the largest difference between the samples, or infinity if either has
+ * a NaN.
+ */
+template<typename T>
+double MaxDifference(const al::span<const T> values, const al::span<const T> refs)
+{
+    double maxdiff{0.0};
+    for(size_t i{0};i < values.size();++i)
+    {
+        const double diff{std::abs(static_cast<double>(values[i])
+            - static_cast<double>(refs[i]))};
+        if(std::isnan(diff))
+            return std::numeric_limits<double>::infinity();
+        maxdiff = std::max(maxdiff, diff);
+    }
+    return maxdiff;
+}
+
+/* Counts the samples, of the given size in bytes, that aren't bit-identical. */
+double CountMismatches(const void *values, const void *refs, const size_t count,
+    const size_t size)
+{
+    const auto *vals = static_cast<const std::byte*>(values);
+    const auto *rvals = static_cast<const std::byte*>(refs);
+    size_t mismatches{0};
+    for(size_t i{0};i < count;++i)
+    {
+        if(std::memcmp(vals + i*size, rvals + i*size, size) != 0)
+            ++mismatches;
+    }
+    return static_cast<double>(mismatches);
+}
+
+double MaxDifference(const al::span<const FloatBufferLine> values,
+    const al::span<const FloatBufferLine> refs)
+{
+    double maxdiff{0.0};
+    for(size_t c{0};c < values.size();++c)
+        maxdiff = std::max(maxdiff, MaxDifference<float>(values[c], refs[c]));
+    return maxdiff;
+}
+
+
+/* Resampler benchmarks. */
+struct ResamplerTest {
+    const char *mName;
+    const BSincTable *mTable; /* Only for the bsinc resamplers. */
+    Resampler mType;
+};
+
+void PrepareState(const ResamplerTest &test, const uint increment, InterpState &state)
+{
+    if(test.mType == Resampler::Cubic)
+        state.cubic.filter = gCubicSpline.Tab.data();
+    else if(test.mTable)
+    {
+        /* Same as the library's setup, without the fitted scale curve. */
+        const BSincTable *table{test.mTable};
+        size_t si{BSincScaleCount - 1};
+        float sf{0.0f};
+        if(increment > MixerFracOne)
+        {
+            sf = MixerFracOne/static_cast<float>(increment) - table->scaleBase;
+            sf = maxf(0.0f, BSincScaleCount*sf*table->scaleRange - 1.0f);
+            si = float2uint(sf);
+            sf -= static_cast<float>(si);
+        }
+        state.bsinc.sf = sf;
+        state.bsinc.m = table->m[si];
+        state.bsinc.l = (state.bsinc.m/2) - 1;
+        state.bsinc.filter = table->Tab + table->filterOffset[si];
+    }
+}
+
+void AddResampler(const Isa &isa, const ResamplerTest &test, ResamplerFunc func,
+    ResamplerFunc reffunc)
+{
+    if(!IsaAvailable(isa))
+        return;
+
+    static constexpr std::array<float,4> pitches{{0.5f, 1.0f, 1.5f, 2.5f}};
+    for(const float pitch : pitches)
+    {
+        const auto increment = static_cast<uint>(pitch*MixerFracOne);
+        const size_t srcLen{MaxResamplerPadding + BufferLineSize*3};
+
+        auto *state = NewBenchData<InterpState>();
+        PrepareState(test, increment, *state);
+
+        auto *src = NewBenchData<std::vector<float>>(srcLen);
+        FillSignal(*src);
+        auto *dst = NewBenchData<std::vector<float>>(BufferLineSize);
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "Resample/%s/%s/%.2f", test.mName, isa.mName, pitch);
+        gBenchmarks.emplace_back(Benchmark{name, BufferLineSize,
+            [func,state,src,dst,increment]()
+            {
+                func(state, src->data()+MaxResamplerEdge, 0x1234, increment, *dst);
+                DoNotOptimize(dst->front());
+            }});
+
+        if(func == reffunc)
+            continue;
+        /* An uneven length also checks the handling of partial vectors. */
+        gChecks.emplace_back(Check{name, FloatTolerance,
+            [func,reffunc,state,src,increment]()
+            {
+                std::vector<float> resampled(BufferLineSize-3), ref(BufferLineSize-3);
+                func(state, src->data()+MaxResamplerEdge, 0x1234, increment, resampled);
+                reffunc(state, src->data()+MaxResamplerEdge, 0x1234, increment, ref);
+                return MaxDifference<float>(resampled, ref);
+            }});
+    }
+}
+
+/* Only references the resamplers each instruction set actually has. */
+template<typename InstTag, bool HasPoint, bool HasLerp, bool HasCubic, bool HasBSinc>
+void AddResamplers(const Isa &isa)
+{
+    if constexpr(HasPoint)
+        AddResampler(isa, {"Point", nullptr, Resampler::Point}, Resample_<PointTag,InstTag>,
+            Resample_<PointTag,CTag>);
+    if constexpr(HasLerp)
+        AddResampler(isa, {"Linear", nullptr, Resampler::Linear}, Resample_<LerpTag,InstTag>,
+            Resample_<LerpTag,CTag>);
+    if constexpr(HasCubic)
+        AddResampler(isa, {"Cubic", nullptr, Resampler::Cubic}, Resample_<CubicTag,InstTag>,
+            Resample_<CubicTag,CTag>);
+    if constexpr(HasBSinc)
+    {
+        AddResampler(isa, {"FastBSinc12", &gBSinc12, Resampler::FastBSinc12},
+            Resample_<FastBSincTag,InstTag>, Resample_<FastBSincTag,CTag>);
+        AddResampler(isa, {"BSinc12", &gBSinc12, Resampler::BSinc12},
+            Resample_<BSincTag,InstTag>, Resample_<BSincTag,CTag>);
+        AddResampler(isa, {"FastBSinc24", &gBSinc24, Resampler::FastBSinc24},
+            Resample_<FastBSincTag,InstTag>, Resample_<FastBSincTag,CTag>);
+        AddResampler(isa, {"BSinc24", &gBSinc24, Resampler::BSinc24},
+            Resample_<BSincTag,InstTag>, Resample_<BSincTag,CTag>);
+    }
+}
+
+
+/* Gain mixer benchmarks, alternating between a gain ramp and a fixed gain as
+ * happens with moving and static sources.
+ */
+template<typename InstTag>
+void AddMixer(const Isa &isa)
+{
+    if(!IsaAvailable(isa))
+        return;
+
+    static constexpr std::array<size_t,3> chancounts{{2, 6, 16}};
+    for(const size_t numchans : chancounts)
+    {
+        auto *src = NewBenchData<std::vector<float>>(BufferLineSize);
+        FillSignal(*src);
+        auto *out = NewBenchData<std::vector<FloatBufferLine>>(numchans);
+        for(auto &line : *out)
+            line.fill(0.0f);
+        auto *gains = NewBenchData<std::vector<float>>(numchans*2);
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "Mix/%zuch/%s", numchans, isa.mName);
+        gBenchmarks.emplace_back(Benchmark{name, BufferLineSize*numchans,
+            [src,out,gains,numchans,ramp=false]() mutable
+            {
+                float *current{gains->data()};
+                float *target{current + numchans};
+                for(size_t c{0};c < numchans;++c)
+                {
+                    current[c] = 0.5f;
+                    target[c] = ramp ? 0.25f : 0.5f;
+                }
+                Mix_<InstTag>(*src, *out, current, target, ramp ? 64u : 0u, 0u);
+                DoNotOptimize(out->front());
+                ramp = !ramp;
+            }});
+
+        if constexpr(!std::is_same_v<InstTag,CTag>)
+        {
+            /* Check a gain ramp that ends partway through, and a fixed gain,
+             * mixing an uneven length to a later (still aligned) position.
+             */
+            gChecks.emplace_back(Check{name, FloatTolerance, [src,numchans]()
+            {
+                const auto in = al::span<const float>{*src}.first(BufferLineSize-5);
+                double maxdiff{0.0};
+                for(const size_t counter : {size_t{61}, size_t{0}})
+                {
+                    std::vector<FloatBufferLine> mixed(numchans), ref(numchans);
+                    std::vector<float> mixgains(numchans*2), refgains(numchans*2);
+                    for(size_t c{0};c < numchans;++c)
+                    {
+                        mixgains[c] = refgains[c] = 0.5f;
+                        mixgains[numchans+c] = refgains[numchans+c]
+                            = 0.5f - static_cast<float>(c)*0.03f;
+                    }
+                    Mix_<InstTag>(in, mixed, mixgains.data(), mixgains.data()+numchans, counter,
+                        4);
+                    Mix_<CTag>(in, ref, refgains.data(), refgains.data()+numchans, counter, 4);
+                    maxdiff = std::max({maxdiff, MaxDifference(mixed, ref),
+                        MaxDifference<float>(mixgains, refgains)});
+                }
+                return maxdiff;
+            }});
+        }
+    }
+}
+
+
+/* Matrix mixer benchmarks, for decoding 3rd order ambisonics to 5.1 and 7.1.4
+ * output, single- and dual-band. The sample count is the number of input to
+ * output sample mixes, to compare with the gain mixer.
+ */
+template<typename InstTag>
+void AddMatrixMixer(const Isa &isa)
+{
+    if(!IsaAvailable(isa))
+        return;
+
+    struct MatrixSize { size_t mInputs, mOutputs; };
+    static constexpr std::array<MatrixSize,3> sizes{{{16, 6}, {16, 12}, {32, 12}}};
+    for(const MatrixSize size : sizes)
+    {
+        auto *srcs = NewBenchData<std::vector<FloatBufferLine>>(size.mInputs);
+        for(auto &line : *srcs)
+            FillSignal(line);
+        auto *out = NewBenchData<std::vector<FloatBufferLine>>(size.mOutputs);
+        for(auto &line : *out)
+            line.fill(0.0f);
+        auto *gains = NewBenchData<std::vector<float>>(size.mInputs*size.mOutputs);
+        for(size_t i{0};i < gains->size();++i)
+            (*gains)[i] = static_cast<float>(i%7) * 0.01f;
+
+        auto *inptrs = NewBenchData<std::vector<const float*>>();
+        auto *gainptrs = NewBenchData<std::vector<const float*>>();
+        for(size_t i{0};i < size.mInputs;++i)
+        {
+            inptrs->emplace_back((*srcs)[i].data());
+            gainptrs->emplace_back(gains->data() + i*size.mOutputs);
+        }
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "MixMatrix/%zux%zu/%s", size.mInputs, size.mOutputs,
+            isa.mName);
+        gBenchmarks.emplace_back(Benchmark{name, BufferLineSize*size.mInputs*size.mOutputs,
+            [out,inptrs,gainptrs]()
+            {
+                MixMatrix_<InstTag>(*inptrs, *gainptrs, *out, 0u, BufferLineSize);
+                DoNotOptimize(out->front());
+            }});
+
+        if constexpr(!std::is_same_v<InstTag,CTag>)
+        {
+            gChecks.emplace_back(Check{name, FloatTolerance,
+                [inptrs,gainptrs,outputs=size.mOutputs]()
+                {
+                    std::vector<FloatBufferLine> mixed(outputs), ref(outputs);
+                    MixMatrix_<InstTag>(*inptrs, *gainptrs, mixed, 4u, BufferLineSize-5);
+                    MixMatrix_<CTag>(*inptrs, *gainptrs, ref, 4u, BufferLineSize-5);
+                    return MaxDifference(mixed, ref);
+                }});
+        }
+    }
+}
+
+
+/* HRTF mixer benchmarks, at different impulse response lengths. */
+template<typename InstTag>
+void AddHrtfMixer(const Isa &isa)
+{
+    if(!IsaAvailable(isa))
+        return;
+
+    static constexpr std::array<uint,4> irsizes{{MinIrLength, 32, 64, HrirLength}};
+    for(const uint irsize : irsizes)
+    {
+        auto *src = NewBenchData<std::vector<float>>(HrtfHistoryLength + BufferLineSize);
+        FillSignal(*src);
+        auto *accum = NewBenchData<std::vector<float2>>(BufferLineSize + HrirLength);
+        auto *coeffs = NewBenchData<HrirArray>();
+        for(size_t i{0};i < irsize;++i)
+        {
+            const float scale{std::exp(-static_cast<float>(i) / 16.0f)};
+            (*coeffs)[i] = {{scale, -scale*0.5f}};
+        }
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "MixHrtf/%uir/%s", irsize, isa.mName);
+        gBenchmarks.emplace_back(Benchmark{name, BufferLineSize,
+            [src,accum,coeffs,irsize]()
+            {
+                const MixHrtfFilter params{*coeffs, {{4, 9}}, 0.5f, 0.0f};
+                MixHrtf_<InstTag>(src->data(), accum->data(), irsize, &params, BufferLineSize);
+                DoNotOptimize(accum->front());
+                std::fill(accum->begin(), accum->end(), float2{});
+            }});
+
+        if constexpr(!std::is_same_v<InstTag,CTag>)
+        {
+            /* Also check a gain ramp, which the benchmark doesn't use. */
+            gChecks.emplace_back(Check{name, FloatTolerance, [src,coeffs,irsize]()
+            {
+                const MixHrtfFilter params{*coeffs, {{4, 9}}, 0.5f, -0.0004f};
+                std::vector<float2> mixed(BufferLineSize + HrirLength);
+                std::vector<float2> ref(mixed.size());
+                MixHrtf_<InstTag>(src->data(), mixed.data(), irsize, &params, BufferLineSize-5);
+                MixHrtf_<CTag>(src->data(), ref.data(), irsize, &params, BufferLineSize-5);
+
+                double maxdiff{0.0};
+                for(size_t i{0};i < mixed.size();++i)
+                    maxdiff = std::max(maxdiff, MaxDifference<float>(mixed[i], ref[i]));
+                return maxdiff;
+            }});
+        }
+    }
+}
+
+
+/* Output benchmarks, interleaving and converting the device's channels to the
+ * common sample types and channel counts, and dithering.
+ */
+template<typename InstTag>
+void AddOutput(const Isa &isa)
+{
+    if(!IsaAvailable(isa))
+        return;
+
+    struct OutputType {
+        const char *mName;
+        DevFmtType mType;
+    };
+    static constexpr std::array types{
+        OutputType{"float", DevFmtFloat},
+        OutputType{"int16", DevFmtShort},
+        OutputType{"int32", DevFmtInt},
+    };
+    static constexpr std::array<size_t,4> chancounts{{1, 2, 6, 8}};
+
+    for(const OutputType &type : types)
+    {
+        for(const size_t numchans : chancounts)
+        {
+            auto *src = NewBenchData<std::vector<FloatBufferLine>>(numchans);
+            for(auto &line : *src)
+                FillSignal(line);
+            auto *dst = NewBenchData<std::vector<int32_t>>(BufferLineSize*numchans);
+            const DevFmtType fmttype{type.mType};
+
+            char name[64];
+            std::snprintf(name, sizeof(name), "Write/%s/%zuch/%s", type.mName, numchans,
+                isa.mName);
+            gBenchmarks.emplace_back(Benchmark{name, BufferLineSize*numchans,
+                [src,dst,fmttype,numchans]()
+                {
+                    WriteSamples<InstTag>(fmttype, *src, dst->data(), 0, BufferLineSize,
+                        numchans);
+                    DoNotOptimize(dst->front());
+                }});
+
+            if constexpr(!std::is_same_v<InstTag,CTag>)
+            {
+                /* The converted samples should be exact, including when
+                 * writing an uneven length at an offset.
+                 */
+                gChecks.emplace_back(Check{name, 0.0, [src,fmttype,numchans]()
+                {
+                    static constexpr size_t todo{BufferLineSize - 7};
+                    std::vector<int32_t> written(BufferLineSize*numchans);
+                    std::vector<int32_t> ref(written.size());
+                    WriteSamples<InstTag>(fmttype, *src, written.data(), 3, todo, numchans);
+                    WriteSamples<CTag>(fmttype, *src, ref.data(), 3, todo, numchans);
+                    const size_t samplesize{BytesFromDevFmt(fmttype)};
+                    return CountMismatches(written.data(), ref.data(),
+                        written.size()*sizeof(int32_t) / samplesize, samplesize);
+                }});
+            }
+        }
+    }
+
+    static constexpr size_t numchans{8};
+    auto *src = NewBenchData<std::vector<FloatBufferLine>>(numchans);
+    for(auto &line : *src)
+        FillSignal(line);
+    auto *buffer = NewBenchData<std::vector<FloatBufferLine>>(numchans);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "Dither/%zuch/%s", numchans, isa.mName);
+    gBenchmarks.emplace_back(Benchmark{name, BufferLineSize*numchans,
+        [src,buffer,seed=22222u]() mutable
+        {
+            std::copy(src->cbegin(), src->cend(), buffer->begin());
+            ApplyDither<InstTag>(*buffer, &seed, 32768.0f, BufferLineSize);
+            DoNotOptimize(buffer->front());
+        }});
+
+    if constexpr(!std::is_same_v<InstTag,CTag>)
+    {
+        /* The noise is made in double precision, so the dithered samples and
+         * the resulting seed should be exact too.
+         */
+        gChecks.emplace_back(Check{name, 0.0, [src]()
+        {
+            std::vector<FloatBufferLine> dithered{src->cbegin(), src->cend()};
+            std::vector<FloatBufferLine> ref{src->cbegin(), src->cend()};
+            uint seed{22222u}, refseed{22222u};
+            ApplyDither<InstTag>(dithered, &seed, 32768.0f, BufferLineSize-5);
+            ApplyDither<CTag>(ref, &refseed, 32768.0f, BufferLineSize-5);
+            if(seed != refseed)
+                return std::numeric_limits<double>::infinity();
+            return MaxDifference(dithered, ref);
+        }});
+    }
+}
+
+
+/* Half-float loading benchmarks, for one channel of a stereo buffer. */
+template<typename InstTag>
+void AddHalfLoader(const Isa &isa)
+{
+    if(!IsaAvailable(isa))
+        return;
+
+    /* Every half-float value, including denormals, infinities, and NaNs. */
+    auto *src = NewBenchData<std::vector<uint16_t>>(65536);
+    std::iota(src->begin(), src->end(), uint16_t{0});
+    auto *dst = NewBenchData<std::vector<float>>(BufferLineSize);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "LoadHalf/%s", isa.mName);
+    gBenchmarks.emplace_back(Benchmark{name, BufferLineSize,
+        [src,dst]()
+        {
+            al::LoadHalfArray_<InstTag>(dst->data(), src->data(), 2, BufferLineSize);
+            DoNotOptimize(dst->front());
+        }});
+
+    if constexpr(!std::is_same_v<InstTag,CTag>)
+    {
+        /* Every value should convert exactly, packed and strided. NaNs only
+         * need to stay NaN.
+         */
+        gChecks.emplace_back(Check{name, 0.0, [src]()
+        {
+            std::vector<float> loaded(src->size()), ref(src->size());
+            size_t mismatches{0};
+            for(const size_t step : {1u, 2u, 3u})
+            {
+                const size_t count{src->size() / step};
+                al::LoadHalfArray_<InstTag>(loaded.data(), src->data(), step, count);
+                al::LoadHalfArray_<CTag>(ref.data(), src->data(), step, count);
+                for(size_t i{0};i < count;++i)
+                {
+                    if(!(std::isnan(loaded[i]) && std::isnan(ref[i]))
+                        && CountMismatches(&loaded[i], &ref[i], 1, sizeof(float)) != 0.0)
+                        ++mismatches;
+                }
+            }
+            return static_cast<double>(mismatches);
+        }});
+    }
+}
+
+
+void AddBiquad()
+{
+    auto *filter = NewBenchData<BiquadFilter>();
+    filter->setParamsFromSlope(BiquadType::HighShelf, 5000.0f/48000.0f, 0.5f, 1.0f);
+    auto *src = NewBenchData<std::vector<float>>(BufferLineSize);
+    FillSignal(*src);
+    auto *dst = NewBenchData<std::vector<float>>(BufferLineSize);
+
+    gBenchmarks.emplace_back(Benchmark{"BiquadFilter/process", BufferLineSize,
+        [filter,src,dst]()
+        {
+            filter->process(*src, dst->data());
+            DoNotOptimize(dst->front());
+        }});
+}
+
+
+/* Band splitter benchmarks, scaling the bands of 4 and 16 channels (as for
+ * first- and third-order ambisonic voices) one at a time and batched.
+ */
+void AddBandSplitter()
+{
+    for(const size_t numchans : {4u, 16u})
+    {
+        auto *splitters = NewBenchData<std::vector<BandSplitter>>(numchans,
+            BandSplitter{400.0f/48000.0f});
+        auto *buffers = NewBenchData<std::vector<FloatBufferLine>>(numchans);
+        for(FloatBufferLine &line : *buffers)
+            FillSignal(line);
+
+        std::string name{"BandSplitter/"+std::to_string(numchans)+"ch"};
+        gBenchmarks.emplace_back(Benchmark{name+"/separate", BufferLineSize*numchans,
+            [splitters,buffers]()
+            {
+                for(size_t c{0};c < splitters->size();++c)
+                    (*splitters)[c].processScale((*buffers)[c], 0.9f, 1.1f);
+                DoNotOptimize(buffers->front().front());
+            }});
+        gBenchmarks.emplace_back(Benchmark{name+"/batch", BufferLineSize*numchans,
+            [splitters,buffers]()
+            {
+                const size_t count{splitters->size()};
+                std::array<BandSplitter*,16> filters;
+                std::array<float*,16> samples;
+                for(size_t c{0};c < count;++c)
+                {
+                    filters[c] = &(*splitters)[c];
+                    samples[c] = (*buffers)[c].data();
+                }
+                std::array<float,16> hfscales, lfscales;
+                std::fill(hfscales.begin(), hfscales.end(), 0.9f);
+                std::fill(lfscales.begin(), lfscales.end(), 1.1f);
+                BandSplitter::processScaleBatch({filters.data(), count}, {samples.data(), count},
+                    {hfscales.data(), count}, {lfscales.data(), count}, BufferLineSize);
+                DoNotOptimize(buffers->front().front());
+            }});
+    }
+}
+
+
+/* The bs2b crossfeed filter on a stereo pair, as for headphones without HRTF. */
+void AddBs2b()
+{
+    auto *bs2b = NewBenchData<struct bs2b>();
+    bs2b_set_params(bs2b, BS2B_DEFAULT_CLEVEL, 48000);
+    bs2b_clear(bs2b);
+    auto *buffers = NewBenchData<std::array<FloatBufferLine,2>>();
+    FillSignal((*buffers)[0]);
+    FillSignal((*buffers)[1]);
+
+    gBenchmarks.emplace_back(Benchmark{"Bs2b/cross_feed", BufferLineSize*2,
+        [bs2b,buffers]()
+        {
+            bs2b_cross_feed(bs2b, (*buffers)[0].data(), (*buffers)[1].data(),
+                BufferLineSize);
+            DoNotOptimize(buffers->front().front());
+        }});
+}
+
+
+/* Second-order ambisonic decoding to 5.1, with and without the front
+ * stablizer. The difference is the stablizer's cost.
+ */
+void AddFrontStablizer()
+{
+    constexpr size_t numinputs{9};
+    constexpr size_t numoutputs{6};
+    constexpr size_t lidx{0}, ridx{1}, cidx{2};
+    constexpr float xover{400.0f / 48000.0f};
+
+    std::array<ChannelDec,numoutputs> coeffs{};
+    for(size_t o{0};o < numoutputs;++o)
+    {
+        for(size_t i{0};i < numinputs;++i)
+            coeffs[o][i] = 0.1f + static_cast<float>((o*numinputs + i) % 7)*0.05f;
+    }
+
+    auto *inputs = NewBenchData<std::array<FloatBufferLine,numinputs>>();
+    for(FloatBufferLine &line : *inputs)
+        FillSignal(line);
+    auto *outputs = NewBenchData<std::array<FloatBufferLine,numoutputs>>();
+
+    auto *plain = KeepBenchData(BFormatDec::Create(numinputs, coeffs, {}, xover, nullptr));
+    gBenchmarks.emplace_back(Benchmark{"BFormatDec/2o-5.1/plain", BufferLineSize*numinputs,
+        [plain,inputs,outputs]()
+        {
+            std::for_each(outputs->begin(), outputs->end(),
+                [](FloatBufferLine &line) { line.fill(0.0f); });
+            plain->process(*outputs, inputs->data(), BufferLineSize);
+            DoNotOptimize(outputs->front().front());
+        }});
+
+    auto stablizer = FrontStablizer::Create(numoutputs);
+    stablizer->MidFilter.init(5000.0f / 48000.0f);
+    for(auto &filter : stablizer->ChannelFilters)
+        filter = stablizer->MidFilter;
+    auto *stablized = KeepBenchData(BFormatDec::Create(numinputs, coeffs, {}, xover,
+        std::move(stablizer)));
+    gBenchmarks.emplace_back(Benchmark{"BFormatDec/2o-5.1/stablized", BufferLineSize*numinputs,
+        [stablized,inputs,outputs]()
+        {
+            std::for_each(outputs->begin(), outputs->end(),
+                [](FloatBufferLine &line) { line.fill(0.0f); });
+            stablized->processStablize(*outputs, inputs->data(), lidx, ridx, cidx,
+                BufferLineSize);
+            DoNotOptimize(outputs->front().front());
+        }});
+}
+
+
+/* Near-field control filter benchmarks for orders 1 through 3, applied
+ * separately and together.
+ */
+void AddNfc()
+{
+    auto *filter = NewBenchData<NfcFilter>();
+    filter->init(343.3f / (1.5f*48000.0f));
+    filter->adjust(343.3f / (0.5f*48000.0f));
+    auto *src = NewBenchData<std::vector<float>>(BufferLineSize);
+    FillSignal(*src);
+    auto *dst = NewBenchData<std::vector<FloatBufferLine>>(3);
+
+    gBenchmarks.emplace_back(Benchmark{"NfcFilter/3-orders/separate", BufferLineSize,
+        [filter,src,dst]()
+        {
+            filter->process1(*src, (*dst)[0].data());
+            filter->process2(*src, (*dst)[1].data());
+            filter->process3(*src, (*dst)[2].data());
+            DoNotOptimize((*dst)[0].front());
+        }});
+    gBenchmarks.emplace_back(Benchmark{"NfcFilter/3-orders/together", BufferLineSize,
+        [filter,src,dst]()
+        {
+            const std::array<float*,3> outputs{{(*dst)[0].data(), (*dst)[1].data(),
+                (*dst)[2].data()}};
+            filter->process(*src, outputs);
+            DoNotOptimize((*dst)[0].front());
+        }});
+}
+
+
+/* Output limiter benchmarks, using the device limiter's settings with and
+ * without look-ahead. The (over-driven) source signal is copied in for each
+ * call, since the limiter processes in-place.
+ */
+void AddLimiter()
+{
+    for(const size_t numchans : {2u, 8u, 16u})
+    {
+        for(const bool lookahead : {true, false})
+        {
+            auto *limiter = KeepBenchData(Compressor::Create(numchans, 48000.0f, true,
+                true, true, true, true, lookahead ? 0.001f : 0.0f, 0.002f, 0.0f, 0.0f,
+                std::log10(32767.0f/32768.0f) * 20.0f, std::numeric_limits<float>::infinity(),
+                0.0f, 0.02f, 0.2f));
+            auto *src = NewBenchData<std::vector<FloatBufferLine>>(numchans);
+            for(FloatBufferLine &line : *src)
+            {
+                FillSignal(line);
+                std::transform(line.begin(), line.end(), line.begin(),
+                    [](float s) { return s * 2.0f; });
+            }
+            auto *buffer = NewBenchData<std::vector<FloatBufferLine>>(numchans);
+
+            std::string name{"Limiter/"+std::to_string(numchans)+"ch"};
+            if(!lookahead) name += "/no-lookahead";
+            gBenchmarks.emplace_back(Benchmark{std::move(name), BufferLineSize,
+                [limiter,src,buffer]()
+                {
+                    std::copy(src->begin(), src->end(), buffer->begin());
+                    limiter->process(BufferLineSize, buffer->data());
+                    DoNotOptimize(buffer->front());
+                }});
+        }
+    }
+}
+
+
+/* UHJ encoder and Super Stereo decoder benchmarks, for the IIR filters and
+ * the FIR filters applied directly and with FFT convolution.
+ */
+template<typename T>
+void AddUhjStereoDecoder(const char *name, const bool usefft)
+{
+    static constexpr size_t padding{T::sInputPadding};
+
+    auto *decoder = NewBenchData<T>();
+    if constexpr(padding > 0)
+        decoder->mUseFft = usefft;
+    auto *src = NewBenchData<std::vector<FloatBufferLine>>(3);
+    FillSignal((*src)[0]);
+    FillSignal((*src)[1]);
+    std::reverse((*src)[1].begin(), (*src)[1].end());
+    auto *buffer = NewBenchData<std::vector<std::vector<float>>>(3,
+        std::vector<float>(BufferLineSize+padding));
+
+    gBenchmarks.emplace_back(Benchmark{std::string{"UHJ/decode-stereo/"}+name, BufferLineSize,
+        [decoder,src,buffer]()
+        {
+            std::array<float*,3> samples{};
+            for(size_t c{0};c < 3;++c)
+            {
+                const FloatBufferLine &input = (*src)[c];
+                std::vector<float> &line = (*buffer)[c];
+                std::copy(input.begin(), input.end(), line.begin());
+                std::copy_n(input.begin(), padding, line.begin()+BufferLineSize);
+                samples[c] = line.data();
+            }
+            decoder->decode(samples, BufferLineSize, true);
+            DoNotOptimize((*buffer)[0].front());
+        }});
+}
+
+template<typename T>
+void AddUhjEncoder(const char *name, const bool usefft)
+{
+    auto *encoder = NewBenchData<T>();
+    if constexpr(T::sFilterDelay > 1)
+        encoder->mUseFft = usefft;
+    auto *src = NewBenchData<std::vector<FloatBufferLine>>(3);
+    for(FloatBufferLine &line : *src)
+        FillSignal(line);
+    std::reverse((*src)[1].begin(), (*src)[1].end());
+    auto *output = NewBenchData<std::vector<FloatBufferLine>>(2);
+
+    gBenchmarks.emplace_back(Benchmark{std::string{"UHJ/encode/"}+name, BufferLineSize,
+        [encoder,src,output]()
+        {
+            const std::array<const float*,3> input{{(*src)[0].data(), (*src)[1].data(),
+                (*src)[2].data()}};
+            std::fill((*output)[0].begin(), (*output)[0].end(), 0.0f);
+            std::fill((*output)[1].begin(), (*output)[1].end(), 0.0f);
+            encoder->encode((*output)[0].data(), (*output)[1].data(), input, BufferLineSize);
+            DoNotOptimize((*output)[0].front());
+        }});
+}
+
+void AddUhj()
+{
+    AddUhjEncoder<UhjEncoderIIR>("iir", false);
+    AddUhjEncoder<UhjEncoder<UhjLength256>>("fir256", false);
+    AddUhjEncoder<UhjEncoder<UhjLength256>>("fir256-fft", true);
+    AddUhjEncoder<UhjEncoder<UhjLength512>>("fir512", false);
+    AddUhjEncoder<UhjEncoder<UhjLength512>>("fir512-fft", true);
+
+    AddUhjStereoDecoder<UhjStereoDecoderIIR>("iir", false);
+    AddUhjStereoDecoder<UhjStereoDecoder<UhjLength256>>("fir256", false);
+    AddUhjStereoDecoder<UhjStereoDecoder<UhjLength256>>("fir256-fft", true);
+    AddUhjStereoDecoder<UhjStereoDecoder<UhjLength512>>("fir512", false);
+    AddUhjStereoDecoder<UhjStereoDecoder<UhjLength512>>("fir512-fft", true);
+}
+
+
+/* FFT benchmarks, comparing the single-use functions with FFT plans. Each call
+ * does a forward and inverse transform of the sizes used by the convolution
+ * and pitch shifter effects.
+ */
+void AddFfts()
+{
+    static constexpr std::array<size_t,4> fftsizes{{128, 512, 2048, 8192}};
+    for(const size_t fftsize : fftsizes)
+    {
+        auto *buffer = NewBenchData<std::vector<std::complex<float>>>(fftsize);
+        for(size_t i{0};i < fftsize;++i)
+        {
+            const auto t = static_cast<float>(i);
+            (*buffer)[i] = std::complex<float>{std::sin(t*0.05f), std::sin(t*0.31f)};
+        }
+        auto *plan = NewBenchData<FftPlan<float>>(fftsize);
+        const float scale{1.0f / static_cast<float>(fftsize)};
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "FFT/complex/%zu", fftsize);
+        gBenchmarks.emplace_back(Benchmark{name, fftsize,
+            [buffer,scale]()
+            {
+                forward_fft(al::span{*buffer});
+                inverse_fft(al::span{*buffer});
+                for(auto &val : *buffer) val *= scale;
+                DoNotOptimize(buffer->front());
+            }});
+        std::snprintf(name, sizeof(name), "FFT/complex-plan/%zu", fftsize);
+        gBenchmarks.emplace_back(Benchmark{name, fftsize,
+            [buffer,plan,scale]()
+            {
+                plan->forward(*buffer);
+                plan->inverse(*buffer);
+                for(auto &val : *buffer) val *= scale;
+                DoNotOptimize(buffer->front());
+            }});
+
+        std::snprintf(name, sizeof(name), "FFT/real/%zu", fftsize*2);
+        gBenchmarks.emplace_back(Benchmark{name, fftsize*2,
+            [buffer,scale]()
+            {
+                forward_real_fft(al::span{*buffer});
+                inverse_real_fft(al::span{*buffer});
+                for(auto &val : *buffer) val *= scale*0.5f;
+                DoNotOptimize(buffer->front());
+            }});
+        std::snprintf(name, sizeof(name), "FFT/real-plan/%zu", fftsize*2);
+        gBenchmarks.emplace_back(Benchmark{name, fftsize*2,
+            [buffer,plan,scale]()
+            {
+                plan->forwardReal(*buffer);
+                plan->inverseReal(*buffer);
+                for(auto &val : *buffer) val *= scale*0.5f;
+                DoNotOptimize(buffer->front());
+            }});
+    }
+}
+
+
+/* ADPCM decoding benchmarks. Each call decodes one channel of a buffer, both
+ * all at once (decoding whole blocks together) and one block at a time (as
+ * when the first block is partially skipped).
+ */
+void AddAdpcm()
+{
+    struct AdpcmTest {
+        const char *mName;
+        decltype(&DecodeIma4Samples) mDecode;
+        size_t mHeaderBytes;
+        size_t mHeaderSamples;
+        std::array<size_t,2> mBlockAligns;
+    };
+    static constexpr std::array tests{
+        AdpcmTest{"IMA4", DecodeIma4Samples, 4, 1, {{65, 1017}}},
+        AdpcmTest{"MSADPCM", DecodeMsAdpcmSamples, 7, 2, {{64, 1016}}},
+    };
+    static constexpr size_t NumBlocks{16};
+
+    for(const AdpcmTest &test : tests)
+    {
+        for(const size_t channels : {size_t{1}, size_t{2}})
+        {
+            for(const size_t align : test.mBlockAligns)
+            {
+                const size_t blockBytes{(test.mHeaderBytes + (align-test.mHeaderSamples)/2)
+                    * channels};
+                auto *src = NewBenchData<std::vector<std::byte>>(blockBytes*NumBlocks);
+                uint seed{22222u};
+                for(std::byte &val : *src)
+                {
+                    seed = seed*96314165u + 907633515u;
+                    val = static_cast<std::byte>(seed >> 24);
+                }
+                auto *dst = NewBenchData<std::vector<float>>(align*NumBlocks);
+                const auto decode = test.mDecode;
+
+                char name[64];
+                std::snprintf(name, sizeof(name), "ADPCM/%s/%zuch/%zu", test.mName, channels,
+                    align);
+                gBenchmarks.emplace_back(Benchmark{name, dst->size(),
+                    [decode,src,dst,channels,align]()
+                    {
+                        decode(dst->data(), src->data(), 0, 0, channels, align, dst->size());
+                        DoNotOptimize(dst->front());
+                    }});
+                std::snprintf(name, sizeof(name), "ADPCM/%s/%zuch/%zu/per-block", test.mName,
+                    channels, align);
+                gBenchmarks.emplace_back(Benchmark{name, dst->size(),
+                    [decode,src,dst,channels,align]()
+                    {
+                        for(size_t i{0};i < NumBlocks;++i)
+                            decode(dst->data() + i*align, src->data(), 0, i*align, channels,
+                                align, align);
+                        DoNotOptimize(dst->front());
+                    }});
+            }
+        }
+    }
+}
+
+
+void AddBenchmarks()
+{
+    AddResamplers<CTag,true,true,true,true>(IsaC);
+#ifdef HAVE_SSE
+    AddResamplers<SSETag,false,false,true,true>(IsaSSE);
+#endif
+#ifdef HAVE_SSE2
+    AddResamplers<SSE2Tag,false,true,false,false>(IsaSSE2);
+#endif
+#ifdef HAVE_SSE4_1
+    AddResamplers<SSE4Tag,false,true,false,false>(IsaSSE4);
+#endif
+#ifdef HAVE_AVX2
+    AddResamplers<AVX2Tag,false,true,true,true>(IsaAVX2);
+#endif
+#ifdef HAVE_NEON
+    AddResamplers<NEONTag,false,true,true,true>(IsaNEON);
+#endif
+
+    AddMixer<CTag>(IsaC);
+#ifdef HAVE_SSE
+    AddMixer<SSETag>(IsaSSE);
+#endif
+#ifdef HAVE_AVX2
+    AddMixer<AVX2Tag>(IsaAVX2);
+#endif
+#ifdef HAVE_AVX512
+    AddMixer<AVX512Tag>(IsaAVX512);
+#endif
+#ifdef HAVE_NEON
+    AddMixer<NEONTag>(IsaNEON);
+#endif
+
+    AddMatrixMixer<CTag>(IsaC);
+#ifdef HAVE_SSE
+    AddMatrixMixer<SSETag>(IsaSSE);
+#endif
+#ifdef HAVE_AVX2
+    AddMatrixMixer<AVX2Tag>(IsaAVX2);
+#endif
+#ifdef HAVE_NEON
+    AddMatrixMixer<NEONTag>(IsaNEON);
+#endif
+
+    AddHrtfMixer<CTag>(IsaC);
+#ifdef HAVE_SSE
+    AddHrtfMixer<SSETag>(IsaSSE);
+#endif
+#ifdef HAVE_AVX2
+    AddHrtfMixer<AVX2Tag>(IsaAVX2);
+#endif
+#ifdef HAVE_NEON
+    AddHrtfMixer<NEONTag>(IsaNEON);
+#endif
+
+    AddOutput<CTag>(IsaC);
+#ifdef HAVE_SSE_INTRINSICS
+    AddOutput<SSE2Tag>(IsaSSE2);
+#endif
+#ifdef HAVE_AVX2
+    AddOutput<AVX2Tag>(IsaAVX2);
+#endif
+
+    AddHalfLoader<CTag>(IsaC);
+#ifdef HAVE_AVX2
+    AddHalfLoader<F16CTag>(IsaF16C);
+#endif
+#ifdef HAVE_NEON
+    AddHalfLoader<NEONTag>(IsaNEON);
+#endif
+
+    AddBiquad();
+    AddBandSplitter();
+    AddNfc();
+    AddLimiter();
+    AddUhj();
+    AddBs2b();
+    AddFrontStablizer();
+    AddFfts();
+    AddAdpcm();
+}
+
+
+/* Runs the benchmark with increasing iteration counts until it takes at least
+ * the minimum time, and reports the last run.
+ */
+void RunBenchmark(const Benchmark &bench)
+{
+    /* Warm up the caches and branch predictors. */
+    for(size_t i{0};i < 16;++i)
+        bench.mFunc();
+
+    size_t iterations{64};
+    double elapsed{0.0};
+    while(true)
+    {
+        const auto start = steady_clock::now();
+        for(size_t i{0};i < iterations;++i)
+            bench.mFunc();
+        elapsed = std::chrono::duration<double>(steady_clock::now() - start).count();
+
+        if(elapsed >= gMinTime || iterations >= (size_t{1}<<40))
+            break;
+
+        /* Aim for a bit more than the minimum time, but don't grow the count
+         * by more than 10x at once.
+         */
+        const double scale{(elapsed > 0.0) ? gMinTime*1.4 / elapsed : 10.0};
+        iterations = static_cast<size_t>(static_cast<double>(iterations) * minf(10.0f,
+            static_cast<float>(scale))) + 1;
+    }
+
+    const double nsPerIter{elapsed * 1e9 / static_cast<double>(iterations)};
+    const double samplesPerSec{static_cast<double>(bench.mSamples*iterations) / elapsed};
+    std::printf("%-32s %12.1f ns %12zu %10.2f M/s\n", bench.mName.c_str(), nsPerIter, iterations,
+        samplesPerSec / 1e6);
+}
+
+/* Runs the check and reports the difference from the C version. Returns false
+ * if it's more than the check allows.
+ */
+bool RunCheck(const Check &check)
+{
+    const double diff{check.mFunc()};
+    const bool passed{diff <= check.mTolerance};
+    std::printf("%-32s %12g %12g %8s\n", check.mName.c_str(), diff, check.mTolerance,
+        passed ? "ok" : "FAILED");
+    return passed;
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    const char *filter{nullptr};
+    bool verify{false};
+    for(int i{1};i < argc;++i)
+    {
+        if(std::strncmp(argv[i], "--min-time=", 11) == 0)
+            gMinTime = std::max(std::atof(argv[i]+11), 0.001);
+        else if(std::strcmp(argv[i], "--verify") == 0)
+            verify = true;
+        else if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0)
+        {
+            std::printf("Usage: %s [--min-time=<seconds>] [--verify] [filter]\n", argv[0]);
+            return 0;
+        }
+        else
+            filter = argv[i];
+    }
+
+    if(auto cpuopt = GetCPUInfo())
+    {
+        CPUCapFlags = cpuopt->mCaps;
+        if(!cpuopt->mName.empty())
+            std::printf("CPU: %s\n", cpuopt->mName.c_str());
+    }
+
+    AddBenchmarks();
+
+    if(verify)
+    {
+        std::printf("%-32s %12s %12s %8s\n", "Check", "Difference", "Tolerance", "Result");
+        std::printf("%s\n", std::string(67, '-').c_str());
+        size_t failed{0};
+        for(const Check &check : gChecks)
+        {
+            if((!filter || check.mName.find(filter) != std::string::npos) && !RunCheck(check))
+                ++failed;
+        }
+        if(failed > 0)
+        {
+            std::printf("%zu check%s failed\n", failed, (failed==1) ? "" : "s");
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    std::printf("%-32s %15s %12s %14s\n", "Benchmark", "Time", "Iterations", "Samples");
+    std::printf("%s\n", std::string(76, '-').c_str());
+    for(const Benchmark &bench : gBenchmarks)
+    {
+        if(!filter || bench.mName.find(filter) != std::string::npos)
+            RunBenchmark(bench);
+    }
+
+    return 0;
+}
@@ -0,0 +1,806 @@
+/*
+ * OpenAL Render Benchmark
+ *
+ * Renders a generated scene with the loopback device as fast as possible, and
+ * reports how much faster than realtime it ran along with the time spent in
+ * each mixing stage. Rendering with the loopback device needs no audio
+ * hardware, and gives the same output for the same scene and settings.
+ *
+ * The output can be written to a file and compared against on a later run,
+ * to measure how far a faster rendering method strays from a reference. For
+ * example, to compare ambisonic HRTF mixing with per-source HRTF:
+ *
+ *   alsoft-render-bench -s 128 --hrtf-order 0 -o full.raw
+ *   alsoft-render-bench -s 128 --hrtf-order 3 -c full.raw
+ *
+ * Effects with a quality setting in the config file can be compared the same
+ * way, e.g. for the pitch shifter's fast mode (with a config file setting
+ * quality = fast in the [pshifter] section):
+ *
+ *   alsoft-render-bench -e pshifter -o high.raw
+ *   ALSOFT_CONF=fast.conf alsoft-render-bench -e pshifter -c high.raw
+ *
+ * Low-precision mixing (low-precision-mixing = true in the [general] section)
+ * needs 16-bit samples and output, with the linear resampler:
+ *
+ *   alsoft-render-bench --int16 -o float.raw
+ *   ALSOFT_CONF=lowprec.conf alsoft-render-bench --int16 -c float.raw
+ *
+ * With --planar, the output is rendered as separate channel lines through
+ * ALC_SOFT_loopback_planar, which should match the interleaved output. With
+ * --offline, the loopback device is set up for offline rendering, which mixes
+ * with all CPU cores unless mixer-threads is set, and should also match.
+ *
+ * Paused sources (--paused) keep voices that the mixer checks each update but
+ * doesn't mix, which measures the cost of going through idle voices:
+ *
+ *   alsoft-render-bench -s 64 --paused 16000 -u 256 -t 5
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+#include "AL/alext.h"
+#include "AL/efx.h"
+
+#include "common/alhelpers.h"
+
+
+#ifndef AL_SOFT_convolution_reverb
+#define AL_SOFT_convolution_reverb
+#define AL_EFFECT_CONVOLUTION_REVERB_SOFT        0xA000
+#endif
+
+#ifndef ALC_SOFT_mixer_profile
+#define ALC_SOFT_mixer_profile
+#define ALC_MIXER_PROFILE_SOFT                   0x19D6
+#endif
+
+#ifndef ALC_SOFT_memory_stats
+#define ALC_SOFT_memory_stats
+#define ALC_MEMORY_STATS_SOFT                    0x19E6
+#endif
+
+#ifndef ALC_SOFT_hrtf_ambisonic_mixing
+#define ALC_SOFT_hrtf_ambisonic_mixing
+#define ALC_HRTF_AMBISONIC_ORDER_SOFT            0x19DA
+#endif
+
+#ifndef ALC_SOFT_loopback_planar
+#define ALC_SOFT_loopback_planar
+typedef void (ALC_APIENTRY*LPALCRENDERSAMPLESPLANARSOFT)(ALCdevice *device, ALCfloat **channels, ALCsizei samples);
+#endif
+
+#ifndef ALC_SOFT_offline_render
+#define ALC_SOFT_offline_render
+#define ALC_OFFLINE_RENDER_SOFT                  0x19FB
+#endif
+
+#ifndef M_PI
+#define M_PI    (3.14159265358979323846)
+#endif
+
+#define MAX_SLOTS 16
+
+
+static LPALCLOOPBACKOPENDEVICESOFT alcLoopbackOpenDeviceSOFT;
+static LPALCRENDERSAMPLESSOFT alcRenderSamplesSOFT;
+static LPALCRENDERSAMPLESPLANARSOFT alcRenderSamplesPlanarSOFT;
+static LPALCGETINTEGER64VSOFT alcGetInteger64vSOFT;
+
+static LPALGENEFFECTS alGenEffects;
+static LPALDELETEEFFECTS alDeleteEffects;
+static LPALEFFECTI alEffecti;
+static LPALGENAUXILIARYEFFECTSLOTS alGenAuxiliaryEffectSlots;
+static LPALDELETEAUXILIARYEFFECTSLOTS alDeleteAuxiliaryEffectSlots;
+static LPALAUXILIARYEFFECTSLOTI alAuxiliaryEffectSloti;
+static LPALAUXILIARYEFFECTSLOTF alAuxiliaryEffectSlotf;
+
+
+typedef struct SceneOptions {
+    int NumSources;
+    int NumPaused;
+    int NumSlots;
+    ALenum SlotEffects[MAX_SLOTS];
+    int Hrtf;
+    int HrtfOrder;
+    int AmbiOrder;
+    int Int16;
+    int Planar;
+    int Offline;
+    int Frequency;
+    int UpdateSize;
+    double Seconds;
+    const char *OutputFile;
+    const char *CompareFile;
+} SceneOptions;
+
+
+static double GetTime(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec/1000000000.0;
+}
+
+/* A simple LCG, so the generated noise is the same on every run. */
+static float NextNoise(uint32_t *seed)
+{
+    *seed = (*seed * 96314165u) + 907633515u;
+    return (float)(int32_t)*seed / 2147483648.0f;
+}
+
+/* Creates a looping test sound with some tones and noise, so the resamplers
+ * and filters have something realistic to work with.
+ */
+static ALuint CreateSoundBuffer(int frequency, int int16)
+{
+    uint32_t seed = 22222;
+    ALuint buffer = 0;
+    float *data;
+    int i;
+
+    data = malloc((size_t)frequency * sizeof(*data));
+    if(!data) return 0;
+
+    for(i = 0;i < frequency;i++)
+    {
+        const double t = (double)i / frequency;
+        data[i] = (float)(sin(t*2.0*M_PI*220.0)*0.3 + sin(t*2.0*M_PI*1375.0)*0.15)
+            + NextNoise(&seed)*0.05f;
+    }
+
+    alGenBuffers(1, &buffer);
+    if(!int16)
+        alBufferData(buffer, AL_FORMAT_MONO_FLOAT32, data, frequency*(ALsizei)sizeof(*data),
+            frequency);
+    else
+    {
+        short *sdata = malloc((size_t)frequency * sizeof(*sdata));
+        if(sdata)
+        {
+            for(i = 0;i < frequency;i++)
+                sdata[i] = (short)lrintf(data[i] * 32767.0f);
+            alBufferData(buffer, AL_FORMAT_MONO16, sdata, frequency*(ALsizei)sizeof(*sdata),
+                frequency);
+            free(sdata);
+        }
+    }
+    free(data);
+
+    if(alGetError() != AL_NO_ERROR)
+    {
+        fprintf(stderr, "Failed to create sound buffer\n");
+        return 0;
+    }
+    return buffer;
+}
+
+/* Creates a half-second exponentially decaying noise burst to use as the
+ * convolution reverb's impulse response.
+ */
+static ALuint CreateImpulseResponse(int frequency)
+{
+    const int length = frequency / 2;
+    uint32_t seed = 12345;
+    ALuint buffer = 0;
+    float *data;
+    int i;
+
+    data = malloc((size_t)length * 2 * sizeof(*data));
+    if(!data) return 0;
+
+    for(i = 0;i < length;i++)
+    {
+        const float env = expf(-6.9f * (float)i / (float)length);
+        data[i*2 + 0] = NextNoise(&seed) * env;
+        data[i*2 + 1] = NextNoise(&seed) * env;
+    }
+
+    alGenBuffers(1, &buffer);
+    alBufferData(buffer, AL_FORMAT_STEREO_FLOAT32, data, length*2*(ALsizei)sizeof(*data),
+        frequency);
+    free(data);
+
+    if(alGetError() != AL_NO_ERROR)
+    {
+        fprintf(stderr, "Failed to create impulse response buffer\n");
+        return 0;
+    }
+    return buffer;
+}
+
+static ALenum EffectFromName(const char *name)
+{
+    if(strcmp(name, "reverb") == 0) return AL_EFFECT_REVERB;
+    if(strcmp(name, "eaxreverb") == 0) return AL_EFFECT_EAXREVERB;
+    if(strcmp(name, "chorus") == 0) return AL_EFFECT_CHORUS;
+    if(strcmp(name, "echo") == 0) return AL_EFFECT_ECHO;
+    if(strcmp(name, "fshifter") == 0) return AL_EFFECT_FREQUENCY_SHIFTER;
+    if(strcmp(name, "pshifter") == 0) return AL_EFFECT_PITCH_SHIFTER;
+    if(strcmp(name, "convolution") == 0) return AL_EFFECT_CONVOLUTION_REVERB_SOFT;
+    if(strcmp(name, "distortion") == 0) return AL_EFFECT_DISTORTION;
+    if(strcmp(name, "autowah") == 0) return AL_EFFECT_AUTOWAH;
+    if(strcmp(name, "modulator") == 0) return AL_EFFECT_RING_MODULATOR;
+    if(strcmp(name, "compressor") == 0) return AL_EFFECT_COMPRESSOR;
+    return AL_EFFECT_NULL;
+}
+
+static const char *NameFromEffect(ALenum type)
+{
+    switch(type)
+    {
+    case AL_EFFECT_REVERB: return "reverb";
+    case AL_EFFECT_EAXREVERB: return "eaxreverb";
+    case AL_EFFECT_CHORUS: return "chorus";
+    case AL_EFFECT_ECHO: return "echo";
+    case AL_EFFECT_FREQUENCY_SHIFTER: return "fshifter";
+    case AL_EFFECT_PITCH_SHIFTER: return "pshifter";
+    case AL_EFFECT_CONVOLUTION_REVERB_SOFT: return "convolution";
+    case AL_EFFECT_DISTORTION: return "distortion";
+    case AL_EFFECT_AUTOWAH: return "autowah";
+    case AL_EFFECT_RING_MODULATOR: return "modulator";
+    case AL_EFFECT_COMPRESSOR: return "compressor";
+    }
+    return "(unknown)";
+}
+
+/* Places the source on a slowly rotating ring around the listener, at a
+ * distance that varies per source.
+ */
+static void PositionSource(ALuint source, int index, double time)
+{
+    const double angle = index*2.399963 + time*(0.2 + (index%7)*0.05);
+    const double dist = 1.0 + (index%16)*0.75;
+    alSource3f(source, AL_POSITION, (ALfloat)(sin(angle)*dist), (ALfloat)((index%3) - 1),
+        (ALfloat)(-cos(angle)*dist));
+}
+
+static void PrintUsage(const char *name)
+{
+    printf("Usage: %s [options]\n\n"
+        "Options:\n"
+        "  -s, --sources <count>   Number of playing sources (default: 64)\n"
+        "  -p, --paused <count>    Number of paused sources, whose voices the mixer\n"
+        "                          checks each update without mixing (default: 0)\n"
+        "  -e, --effect <name>     Add an effect slot with the given effect: reverb,\n"
+        "                          eaxreverb, chorus, echo, fshifter, pshifter,\n"
+        "                          convolution, distortion, autowah, modulator, or\n"
+        "                          compressor. May be given up to %d times\n"
+        "  --hrtf                  Render with HRTF\n"
+        "  --hrtf-order <order>    Render with HRTF, mixing sources to an ambisonic\n"
+        "                          buffer of the given order (1 to 3) that's\n"
+        "                          binauralized once, or 0 for per-source HRTF\n"
+        "  --ambi-order <order>    Render B-Format output of the given ambisonic order\n"
+        "                          (1 to 3) instead of stereo\n"
+        "  --int16                 Use 16-bit samples for the test sound and output\n"
+        "  --planar                Render float output as separate channel lines\n"
+        "  --offline               Set up the device for offline rendering\n"
+        "  -t, --time <seconds>    Amount of audio to render (default: 10)\n"
+        "  -r, --rate <hz>         Output sample rate (default: 48000)\n"
+        "  -u, --update <samples>  Samples to render per call (default: 1024)\n"
+        "  -o, --output <file>     Write the raw 32-bit float output to a file\n"
+        "  -c, --compare <file>    Compare the output with a file written by -o,\n"
+        "                          reporting the difference\n",
+        name, MAX_SLOTS);
+}
+
+static int ParseOptions(int argc, char **argv, SceneOptions *opts)
+{
+    int i;
+
+    opts->NumSources = 64;
+    opts->NumPaused = 0;
+    opts->NumSlots = 0;
+    opts->Hrtf = 0;
+    opts->HrtfOrder = -1;
+    opts->AmbiOrder = 0;
+    opts->Int16 = 0;
+    opts->Planar = 0;
+    opts->Offline = 0;
+    opts->Frequency = 48000;
+    opts->UpdateSize = 1024;
+    opts->Seconds = 10.0;
+    opts->OutputFile = NULL;
+    opts->CompareFile = NULL;
+
+    for(i = 1;i < argc;i++)
+    {
+        const char *arg = argv[i];
+        const char *val = (i+1 < argc) ? argv[i+1] : NULL;
+
+        if(strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0)
+        {
+            PrintUsage(argv[0]);
+            exit(0);
+        }
+        if(strcmp(arg, "--hrtf") == 0)
+        {
+            opts->Hrtf = 1;
+            continue;
+        }
+        if(strcmp(arg, "--int16") == 0)
+        {
+            opts->Int16 = 1;
+            continue;
+        }
+        if(strcmp(arg, "--planar") == 0)
+        {
+            opts->Planar = 1;
+            continue;
+        }
+        if(strcmp(arg, "--offline") == 0)
+        {
+            opts->Offline = 1;
+            continue;
+        }
+
+        if(!val)
+        {
+            fprintf(stderr, "Unexpected or incomplete option: %s\n", arg);
+            return 0;
+        }
+        ++i;
+
+        if(strcmp(arg, "-s") == 0 || strcmp(arg, "--sources") == 0)
+            opts->NumSources = atoi(val);
+        else if(strcmp(arg, "-p") == 0 || strcmp(arg, "--paused") == 0)
+            opts->NumPaused = atoi(val);
+        else if(strcmp(arg, "-e") == 0 || strcmp(arg, "--effect") == 0)
+        {
+            const ALenum type = EffectFromName(val);
+            if(type == AL_EFFECT_NULL)
+            {
+                fprintf(stderr, "Unknown effect: %s\n", val);
+                return 0;
+            }
+            if(opts->NumSlots == MAX_SLOTS)
+            {
+                fprintf(stderr, "Too many effects (max %d)\n", MAX_SLOTS);
+                return 0;
+            }
+            opts->SlotEffects[opts->NumSlots++] = type;
+        }
+        else if(strcmp(arg, "--hrtf-order") == 0)
+        {
+            opts->Hrtf = 1;
+            opts->HrtfOrder = atoi(val);
+        }
+        else if(strcmp(arg, "--ambi-order") == 0)
+            opts->AmbiOrder = atoi(val);
+        else if(strcmp(arg, "-t") == 0 || strcmp(arg, "--time") == 0)
+            opts->Seconds = atof(val);
+        else if(strcmp(arg, "-r") == 0 || strcmp(arg, "--rate") == 0)
+            opts->Frequency = atoi(val);
+        else if(strcmp(arg, "-u") == 0 || strcmp(arg, "--update") == 0)
+            opts->UpdateSize = atoi(val);
+        else if(strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0)
+            opts->OutputFile = val;
+        else if(strcmp(arg, "-c") == 0 || strcmp(arg, "--compare") == 0)
+            opts->CompareFile = val;
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return 0;
+        }
+    }
+
+    if(opts->NumSources < 0 || opts->NumPaused < 0 || opts->Frequency <= 0 || opts->UpdateSize <= 0
+        || !(opts->Seconds > 0.0) || opts->AmbiOrder < 0 || opts->AmbiOrder > 3
+        || opts->HrtfOrder > 3 || (opts->Hrtf && opts->HrtfOrder < -1))
+    {
+        fprintf(stderr, "Invalid option value\n");
+        return 0;
+    }
+    if(opts->Hrtf && opts->AmbiOrder > 0)
+    {
+        fprintf(stderr, "HRTF can't be used with B-Format output\n");
+        return 0;
+    }
+    if(opts->Planar && opts->Int16)
+    {
+        fprintf(stderr, "Planar output is always float\n");
+        return 0;
+    }
+    return 1;
+}
+
+
+int main(int argc, char **argv)
+{
+    ALCint64SOFT profile[11] = {0};
+    ALCint64SOFT memstats[12] = {0};
+    ALuint slots[MAX_SLOTS] = {0};
+    ALuint effects[MAX_SLOTS] = {0};
+    ALuint *sources = NULL;
+    ALuint buffer = 0, irbuffer = 0;
+    int have_profile = 0;
+    int have_memstats = 0;
+    SceneOptions opts;
+    ALCdevice *device;
+    ALCcontext *context;
+    ALCint attrs[20];
+    FILE *outfile = NULL, *cmpfile = NULL;
+    float *output, *reference = NULL, *planar = NULL;
+    float *planes[16];
+    short *output16 = NULL;
+    int numchans, numsources, i;
+    long long frames_done, total_frames, cmp_frames;
+    double start, elapsed, checksum, err_power, ref_power, max_err;
+
+    if(!ParseOptions(argc, argv, &opts))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    numsources = opts.NumSources + opts.NumPaused;
+
+    if(!alcIsExtensionPresent(NULL, "ALC_SOFT_loopback"))
+    {
+        fprintf(stderr, "Error: ALC_SOFT_loopback not supported!\n");
+        return 1;
+    }
+
+    /* Define a macro to help load the function pointers. */
+#define LOAD_PROC(T, x)  ((x) = FUNCTION_CAST(T, alcGetProcAddress(NULL, #x)))
+    LOAD_PROC(LPALCLOOPBACKOPENDEVICESOFT, alcLoopbackOpenDeviceSOFT);
+    LOAD_PROC(LPALCRENDERSAMPLESSOFT, alcRenderSamplesSOFT);
+    LOAD_PROC(LPALCRENDERSAMPLESPLANARSOFT, alcRenderSamplesPlanarSOFT);
+    LOAD_PROC(LPALCGETINTEGER64VSOFT, alcGetInteger64vSOFT);
+#undef LOAD_PROC
+
+    device = alcLoopbackOpenDeviceSOFT(NULL);
+    if(!device)
+    {
+        fprintf(stderr, "Failed to open loopback device!\n");
+        return 1;
+    }
+
+    i = 0;
+    attrs[i++] = ALC_FREQUENCY;
+    attrs[i++] = opts.Frequency;
+    attrs[i++] = ALC_FORMAT_TYPE_SOFT;
+    attrs[i++] = opts.Int16 ? ALC_SHORT_SOFT : ALC_FLOAT_SOFT;
+    attrs[i++] = ALC_MONO_SOURCES;
+    attrs[i++] = (numsources > 256) ? numsources : 256;
+    attrs[i++] = ALC_FORMAT_CHANNELS_SOFT;
+    if(opts.AmbiOrder > 0)
+    {
+        attrs[i++] = ALC_BFORMAT3D_SOFT;
+        attrs[i++] = ALC_AMBISONIC_LAYOUT_SOFT;
+        attrs[i++] = ALC_ACN_SOFT;
+        attrs[i++] = ALC_AMBISONIC_SCALING_SOFT;
+        attrs[i++] = ALC_SN3D_SOFT;
+        attrs[i++] = ALC_AMBISONIC_ORDER_SOFT;
+        attrs[i++] = opts.AmbiOrder;
+        numchans = (opts.AmbiOrder+1) * (opts.AmbiOrder+1);
+    }
+    else
+    {
+        attrs[i++] = ALC_STEREO_SOFT;
+        attrs[i++] = ALC_HRTF_SOFT;
+        attrs[i++] = opts.Hrtf ? ALC_TRUE : ALC_FALSE;
+        if(opts.HrtfOrder >= 0)
+        {
+            attrs[i++] = ALC_HRTF_AMBISONIC_ORDER_SOFT;
+            attrs[i++] = opts.HrtfOrder;
+        }
+        numchans = 2;
+    }
+    if(opts.Offline)
+    {
+        if(!alcIsExtensionPresent(device, "ALC_SOFTX_offline_render"))
+            fprintf(stderr, "Warning: Offline rendering not supported\n");
+        attrs[i++] = ALC_OFFLINE_RENDER_SOFT;
+        attrs[i++] = ALC_TRUE;
+    }
+    attrs[i] = 0;
+
+    context = alcCreateContext(device, attrs);
+    if(!context || alcMakeContextCurrent(context) == ALC_FALSE)
+    {
+        fprintf(stderr, "Failed to set up context!\n");
+        if(context)
+            alcDestroyContext(context);
+        alcCloseDevice(device);
+        return 1;
+    }
+
+    if(opts.Hrtf)
+    {
+        ALCint hrtf_state = ALC_FALSE;
+        alcGetIntegerv(device, ALC_HRTF_SOFT, 1, &hrtf_state);
+        if(!hrtf_state)
+            fprintf(stderr, "Warning: HRTF requested but not enabled\n");
+        else if(opts.HrtfOrder >= 0)
+        {
+            ALCint hrtf_order = 0;
+            if(!alcIsExtensionPresent(device, "ALC_SOFTX_hrtf_ambisonic_mixing"))
+                fprintf(stderr, "Warning: HRTF ambisonic mixing not supported\n");
+            else
+            {
+                alcGetIntegerv(device, ALC_HRTF_AMBISONIC_ORDER_SOFT, 1, &hrtf_order);
+                if(hrtf_order != opts.HrtfOrder)
+                    fprintf(stderr, "Warning: HRTF order %d requested, got %d\n",
+                        opts.HrtfOrder, hrtf_order);
+            }
+        }
+    }
+    have_profile = alcIsExtensionPresent(device, "ALC_SOFTX_mixer_profile");
+    have_memstats = alcIsExtensionPresent(device, "ALC_SOFTX_memory_stats");
+
+    if(opts.NumSlots > 0)
+    {
+#define LOAD_PROC(T, x)  ((x) = FUNCTION_CAST(T, alGetProcAddress(#x)))
+        LOAD_PROC(LPALGENEFFECTS, alGenEffects);
+        LOAD_PROC(LPALDELETEEFFECTS, alDeleteEffects);
+        LOAD_PROC(LPALEFFECTI, alEffecti);
+        LOAD_PROC(LPALGENAUXILIARYEFFECTSLOTS, alGenAuxiliaryEffectSlots);
+        LOAD_PROC(LPALDELETEAUXILIARYEFFECTSLOTS, alDeleteAuxiliaryEffectSlots);
+        LOAD_PROC(LPALAUXILIARYEFFECTSLOTI, alAuxiliaryEffectSloti);
+        LOAD_PROC(LPALAUXILIARYEFFECTSLOTF, alAuxiliaryEffectSlotf);
+#undef LOAD_PROC
+
+        alGenEffects(opts.NumSlots, effects);
+        alGenAuxiliaryEffectSlots(opts.NumSlots, slots);
+        for(i = 0;i < opts.NumSlots;i++)
+        {
+            alEffecti(effects[i], AL_EFFECT_TYPE, opts.SlotEffects[i]);
+            if(opts.SlotEffects[i] == AL_EFFECT_CONVOLUTION_REVERB_SOFT)
+            {
+                if(!irbuffer)
+                    irbuffer = CreateImpulseResponse(opts.Frequency);
+                alAuxiliaryEffectSloti(slots[i], AL_BUFFER, (ALint)irbuffer);
+                alAuxiliaryEffectSlotf(slots[i], AL_EFFECTSLOT_GAIN, 1.0f / 16.0f);
+            }
+            alAuxiliaryEffectSloti(slots[i], AL_EFFECTSLOT_EFFECT, (ALint)effects[i]);
+            if(alGetError() != AL_NO_ERROR)
+            {
+                fprintf(stderr, "Failed to set up %s effect\n", NameFromEffect(opts.SlotEffects[i]));
+                goto done;
+            }
+        }
+    }
+
+    buffer = CreateSoundBuffer(opts.Frequency, opts.Int16);
+    if(!buffer)
+        goto done;
+
+    sources = calloc((size_t)(numsources ? numsources : 1), sizeof(*sources));
+    alGenSources(numsources, sources);
+    if(alGetError() != AL_NO_ERROR)
+    {
+        fprintf(stderr, "Failed to create %d sources\n", numsources);
+        goto done;
+    }
+    for(i = 0;i < numsources;i++)
+    {
+        alSourcei(sources[i], AL_BUFFER, (ALint)buffer);
+        alSourcei(sources[i], AL_LOOPING, AL_TRUE);
+        /* Vary the pitch so the sources need resampling. */
+        alSourcef(sources[i], AL_PITCH, 0.75f + (float)(i%11)*0.05f);
+        alSourcef(sources[i], AL_SEC_OFFSET, (float)(i%10) * 0.1f);
+        PositionSource(sources[i], i, 0.0);
+        if(opts.NumSlots > 0)
+            alSource3i(sources[i], AL_AUXILIARY_SEND_FILTER, (ALint)slots[i%opts.NumSlots], 0,
+                AL_FILTER_NULL);
+    }
+    alSourcePlayv(numsources, sources);
+    /* The paused sources keep their voices, which the mixer still has to go
+     * through each update.
+     */
+    if(opts.NumPaused > 0)
+        alSourcePausev(opts.NumPaused, sources + opts.NumSources);
+
+    if(opts.OutputFile)
+    {
+        outfile = fopen(opts.OutputFile, "wb");
+        if(!outfile)
+        {
+            fprintf(stderr, "Failed to open %s for writing\n", opts.OutputFile);
+            goto done;
+        }
+    }
+    if(opts.CompareFile)
+    {
+        cmpfile = fopen(opts.CompareFile, "rb");
+        reference = malloc((size_t)opts.UpdateSize * (size_t)numchans * sizeof(*reference));
+        if(!cmpfile || !reference)
+        {
+            fprintf(stderr, "Failed to open %s for reading\n", opts.CompareFile);
+            goto done;
+        }
+    }
+
+    if(opts.Planar)
+    {
+        if(!alcIsExtensionPresent(device, "ALC_SOFTX_loopback_planar"))
+        {
+            fprintf(stderr, "Error: ALC_SOFT_loopback_planar not supported!\n");
+            goto done;
+        }
+        planar = malloc((size_t)opts.UpdateSize * (size_t)numchans * sizeof(*planar));
+        if(!planar)
+            goto done;
+        for(i = 0;i < numchans;i++)
+            planes[i] = planar + (size_t)i*(size_t)opts.UpdateSize;
+    }
+
+    output = malloc((size_t)opts.UpdateSize * (size_t)numchans * sizeof(*output));
+    if(opts.Int16)
+        output16 = malloc((size_t)opts.UpdateSize * (size_t)numchans * sizeof(*output16));
+    if(!output || (opts.Int16 && !output16))
+    {
+        free(output);
+        goto done;
+    }
+
+    printf("Rendering %.2fs at %dhz, %d channel%s%s, %d source%s, %d effect slot%s\n",
+        opts.Seconds, opts.Frequency, numchans, (numchans==1)?"":"s",
+        !opts.Hrtf ? "" : (opts.HrtfOrder > 0) ? " (ambisonic HRTF)" : " (HRTF)",
+        opts.NumSources, (opts.NumSources==1)?"":"s", opts.NumSlots, (opts.NumSlots==1)?"":"s");
+    if(opts.NumPaused > 0)
+        printf("  plus %d paused source%s\n", opts.NumPaused, (opts.NumPaused==1)?"":"s");
+
+    total_frames = (long long)(opts.Seconds * opts.Frequency);
+    frames_done = 0;
+    cmp_frames = 0;
+    checksum = 0.0;
+    err_power = ref_power = max_err = 0.0;
+    start = GetTime();
+    while(frames_done < total_frames)
+    {
+        const ALCsizei todo = (ALCsizei)((total_frames-frames_done < opts.UpdateSize)
+            ? total_frames-frames_done : opts.UpdateSize);
+        const double time = (double)frames_done / opts.Frequency;
+        int j;
+
+        /* Move the sources every 50ms or so, batching the updates like an app
+         * would for a frame.
+         */
+        if((frames_done / opts.UpdateSize) % ((opts.Frequency/20 + opts.UpdateSize-1) /
+            opts.UpdateSize) == 0)
+        {
+            alcSuspendContext(context);
+            for(j = 0;j < opts.NumSources;j++)
+                PositionSource(sources[j], j, time);
+            alcProcessContext(context);
+        }
+
+        if(planar)
+        {
+            /* Interleave the channel lines to write and compare them the same
+             * way.
+             */
+            alcRenderSamplesPlanarSOFT(device, planes, todo);
+            for(j = 0;j < todo*numchans;j++)
+                output[j] = planes[j%numchans][j/numchans];
+        }
+        else if(!output16)
+            alcRenderSamplesSOFT(device, output, todo);
+        else
+        {
+            /* Convert 16-bit output to float, to write and compare it the
+             * same way.
+             */
+            alcRenderSamplesSOFT(device, output16, todo);
+            for(j = 0;j < todo*numchans;j++)
+                output[j] = (float)output16[j] * (1.0f/32768.0f);
+        }
+        for(j = 0;j < todo*numchans;j++)
+            checksum += output[j] * (double)((j&7) + 1);
+        frames_done += todo;
+
+        /* Writing and comparing the output is included in the time, though
+         * it's small compared to the mixing.
+         */
+        if(outfile)
+            fwrite(output, sizeof(*output)*(size_t)numchans, (size_t)todo, outfile);
+        if(cmpfile)
+        {
+            const size_t got = fread(reference, sizeof(*reference)*(size_t)numchans,
+                (size_t)todo, cmpfile);
+            for(j = 0;j < (int)got*numchans;j++)
+            {
+                const double diff = (double)output[j] - reference[j];
+                err_power += diff * diff;
+                ref_power += (double)reference[j] * reference[j];
+                if(fabs(diff) > max_err) max_err = fabs(diff);
+            }
+            cmp_frames += (long long)got;
+        }
+    }
+    elapsed = GetTime() - start;
+    free(output);
+
+    printf("Rendered in %.3fs, %.2fx realtime\n", elapsed, opts.Seconds / elapsed);
+    printf("Output checksum: %.9g\n", checksum);
+    if(cmpfile)
+    {
+        if(cmp_frames < total_frames)
+            fprintf(stderr, "Warning: only %lld of %lld frames compared\n", cmp_frames,
+                total_frames);
+        if(err_power > 0.0)
+            printf("Difference from %s: %.2f dB (max %g)\n", opts.CompareFile,
+                10.0*log10(err_power / (ref_power > 0.0 ? ref_power : 1.0)), max_err);
+        else
+            printf("Output matches %s\n", opts.CompareFile);
+    }
+
+    if(have_profile)
+    {
+        static const char *const stages[] = {
+            "Parameter updates", "Voice mixing", "Effects", "Post-processing"
+        };
+        double stagetotal = 0.0;
+
+        alcGetInteger64vSOFT(device, ALC_MIXER_PROFILE_SOFT, 11, profile);
+        for(i = 0;i < 4;i++)
+            stagetotal += (double)profile[2+i];
+
+        printf("\nMixer profile (%lld mixes, %lld overrun%s):\n", (long long)profile[0],
+            (long long)profile[1], (profile[1]==1)?"":"s");
+        for(i = 0;i < 4;i++)
+        {
+            const double secs = (double)profile[2+i] / 1000000000.0;
+            printf("  %-18s %9.3fs  %5.1f%%\n", stages[i], secs,
+                (stagetotal > 0.0) ? (double)profile[2+i] / stagetotal * 100.0 : 0.0);
+        }
+        printf("  Voices in last mix: %lld mixed, %lld virtual\n", (long long)profile[6],
+            (long long)profile[7]);
+        printf("  Voices sharing loaded samples: %lld\n", (long long)profile[8]);
+        if(opts.Hrtf && opts.HrtfOrder <= 0)
+            printf("  HRTF filter blends: %lld, held updates: %lld\n", (long long)profile[9],
+                (long long)profile[10]);
+    }
+    else
+        printf("Mixer profiling not available\n");
+
+    if(have_memstats)
+    {
+        static const char *const categories[] = {
+            "Buffers", "Voices", "Properties", "Effects", "HRTF", "Ring buffers"
+        };
+
+        alcGetInteger64vSOFT(device, ALC_MEMORY_STATS_SOFT, 12, memstats);
+        printf("\nMemory (current / peak KiB):\n");
+        for(i = 0;i < 6;i++)
+            printf("  %-18s %9.1f / %9.1f\n", categories[i], (double)memstats[i*2] / 1024.0,
+                (double)memstats[i*2 + 1] / 1024.0);
+    }
+
+done:
+    if(outfile)
+        fclose(outfile);
+    if(cmpfile)
+        fclose(cmpfile);
+    free(reference);
+    free(output16);
+    free(planar);
+    if(sources)
+    {
+        alDeleteSources(numsources, sources);
+        free(sources);
+    }
+    if(opts.NumSlots > 0 && alDeleteAuxiliaryEffectSlots)
+    {
+        alDeleteAuxiliaryEffectSlots(opts.NumSlots, slots);
+        alDeleteEffects(opts.NumSlots, effects);
+    }
+    if(buffer)
+        alDeleteBuffers(1, &buffer);
+    if(irbuffer)
+        alDeleteBuffers(1, &irbuffer);
+
+    alcMakeContextCurrent(NULL);
+    alcDestroyContext(context);
+    alcCloseDevice(device);
+
+    return 0;
+}
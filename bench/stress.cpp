@@ -0,0 +1,797 @@
+/*
+ * OpenAL Stress Test
+ *
+ * Randomly creates and deletes sources, buffers, effect slots, and filters,
+ * changes effect types, rewrites parts of buffers that are playing, streams
+ * with callback buffers, and resets the device
+ * with HRTF toggled, while a loopback device renders in real time. Every mix
+ * period that took longer than its duration, or that started late, is logged
+ * along with the operation that was running at the time, to find latency
+ * spikes that only show up after a long session.
+ *
+ * Rendering is paused while the device is reset, as an application using a
+ * loopback device would need to. Periods missed because of a reset are still
+ * logged, but counted separately.
+ *
+ * For example, to run for two hours with a fixed seed:
+ *
+ *   alsoft-stress -d 7200 --seed 1234 > stress.log
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+#include "AL/alext.h"
+#include "AL/efx.h"
+
+
+#ifndef AL_SOFT_convolution_reverb
+#define AL_SOFT_convolution_reverb
+#define AL_EFFECT_CONVOLUTION_REVERB_SOFT        0xA000
+#endif
+
+namespace {
+
+using uint = unsigned int;
+
+using std::chrono::steady_clock;
+using std::chrono::nanoseconds;
+using std::chrono::duration_cast;
+
+LPALCLOOPBACKOPENDEVICESOFT alcLoopbackOpenDeviceSOFT;
+LPALCRENDERSAMPLESSOFT alcRenderSamplesSOFT;
+LPALCRESETDEVICESOFT alcResetDeviceSOFT;
+LPALBUFFERCALLBACKSOFT alBufferCallbackSOFT;
+PFNALBUFFERSUBDATASOFTPROC alBufferSubDataSOFT;
+
+LPALGENEFFECTS alGenEffects;
+LPALDELETEEFFECTS alDeleteEffects;
+LPALEFFECTI alEffecti;
+LPALGENFILTERS alGenFilters;
+LPALDELETEFILTERS alDeleteFilters;
+LPALFILTERI alFilteri;
+LPALFILTERF alFilterf;
+LPALGENAUXILIARYEFFECTSLOTS alGenAuxiliaryEffectSlots;
+LPALDELETEAUXILIARYEFFECTSLOTS alDeleteAuxiliaryEffectSlots;
+LPALAUXILIARYEFFECTSLOTI alAuxiliaryEffectSloti;
+
+
+enum class OpType : uint8_t {
+    None,
+    AddSource, RemoveSource, UpdateSources,
+    AddStream, RemoveStream,
+    AddBuffer, RemoveBuffer, BufferSubData,
+    AddSlot, RemoveSlot, ChangeEffect,
+    AddFilter, RemoveFilter,
+    ResetDevice,
+
+    Count
+};
+
+constexpr std::array<const char*,static_cast<size_t>(OpType::Count)> OpNames{{
+    "none",
+    "add-source", "remove-source", "update-sources",
+    "add-stream", "remove-stream",
+    "add-buffer", "remove-buffer", "buffer-sub-data",
+    "add-slot", "remove-slot", "change-effect",
+    "add-filter", "remove-filter",
+    "reset-device",
+}};
+
+/* How often each operation is picked, relative to the others. */
+constexpr std::array<uint,static_cast<size_t>(OpType::Count)> OpWeights{{
+    0,
+    20, 16, 30,
+    3, 3,
+    6, 5, 4,
+    3, 3, 6,
+    4, 4,
+    1,
+}};
+
+constexpr std::array<ALenum,12> EffectTypes{{
+    AL_EFFECT_EAXREVERB, AL_EFFECT_REVERB, AL_EFFECT_CHORUS, AL_EFFECT_FLANGER,
+    AL_EFFECT_ECHO, AL_EFFECT_EQUALIZER, AL_EFFECT_COMPRESSOR, AL_EFFECT_DISTORTION,
+    AL_EFFECT_AUTOWAH, AL_EFFECT_RING_MODULATOR, AL_EFFECT_PITCH_SHIFTER,
+    AL_EFFECT_CONVOLUTION_REVERB_SOFT
+}};
+
+
+struct Options {
+    double mSeconds{60.0};
+    uint mSeed{0u};
+    int mFrequency{48000};
+    int mUpdateSize{512};
+    uint mMaxSources{256};
+    double mOpInterval{0.002};
+    double mReportInterval{10.0};
+};
+
+/* A period that missed its deadline, as sent from the render thread. */
+struct MissRecord {
+    double mTime; /* Seconds since the start. */
+    int64_t mRenderTime; /* Nanoseconds spent rendering. */
+    int64_t mLateness; /* Nanoseconds the period started after it should have. */
+    OpType mOpStart;
+    OpType mOpEnd;
+};
+
+/* A single-producer single-consumer queue for the render thread to pass miss
+ * records to the main thread, without locking or allocating.
+ */
+class MissQueue {
+    static constexpr size_t Size{1024};
+    std::array<MissRecord,Size> mRecords{};
+    std::atomic<size_t> mWritePos{0u};
+    std::atomic<size_t> mReadPos{0u};
+    std::atomic<uint64_t> mDropped{0u};
+
+public:
+    void push(const MissRecord &rec) noexcept
+    {
+        const size_t wpos{mWritePos.load(std::memory_order_relaxed)};
+        if(wpos - mReadPos.load(std::memory_order_acquire) >= Size)
+        {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        mRecords[wpos%Size] = rec;
+        mWritePos.store(wpos+1, std::memory_order_release);
+    }
+    bool pop(MissRecord &rec) noexcept
+    {
+        const size_t rpos{mReadPos.load(std::memory_order_relaxed)};
+        if(rpos == mWritePos.load(std::memory_order_acquire))
+            return false;
+        rec = mRecords[rpos%Size];
+        mReadPos.store(rpos+1, std::memory_order_release);
+        return true;
+    }
+    uint64_t dropped() const noexcept { return mDropped.load(std::memory_order_relaxed); }
+};
+
+
+std::atomic<bool> gQuit{false};
+/* The operation the main thread is currently doing, for the render thread to
+ * note with any missed period.
+ */
+std::atomic<OpType> gCurrentOp{OpType::None};
+/* Held by the render thread while rendering, and by the main thread while
+ * resetting the device.
+ */
+std::mutex gRenderLock;
+
+std::atomic<uint64_t> gPeriods{0u};
+std::atomic<uint64_t> gMisses{0u};
+std::atomic<uint64_t> gResetMisses{0u};
+std::atomic<int64_t> gWorstRenderTime{0};
+MissQueue gMissQueue;
+
+
+void RenderThread(ALCdevice *device, const Options &opts, steady_clock::time_point start)
+{
+    std::vector<float> output(static_cast<size_t>(opts.mUpdateSize) * 2);
+    const auto period = nanoseconds{1'000'000'000ll * opts.mUpdateSize / opts.mFrequency};
+
+    auto deadline = steady_clock::now();
+    while(!gQuit.load(std::memory_order_relaxed))
+    {
+        std::this_thread::sleep_until(deadline);
+
+        const OpType opstart{gCurrentOp.load(std::memory_order_relaxed)};
+        std::unique_lock<std::mutex> renderlock{gRenderLock};
+        const auto rstart = steady_clock::now();
+        alcRenderSamplesSOFT(device, output.data(), opts.mUpdateSize);
+        const auto rend = steady_clock::now();
+        renderlock.unlock();
+        const OpType opend{gCurrentOp.load(std::memory_order_relaxed)};
+
+        const int64_t rendertime{duration_cast<nanoseconds>(rend - rstart).count()};
+        const int64_t lateness{duration_cast<nanoseconds>(rstart - deadline).count()};
+        gPeriods.fetch_add(1, std::memory_order_relaxed);
+        if(rendertime > gWorstRenderTime.load(std::memory_order_relaxed))
+            gWorstRenderTime.store(rendertime, std::memory_order_relaxed);
+
+        /* A period is missed if rendering took longer than the period, or if
+         * it started so late that it couldn't finish in time.
+         */
+        deadline += period;
+        if(rend > deadline)
+        {
+            if(opstart == OpType::ResetDevice || opend == OpType::ResetDevice)
+                gResetMisses.fetch_add(1, std::memory_order_relaxed);
+            gMisses.fetch_add(1, std::memory_order_relaxed);
+            gMissQueue.push(MissRecord{std::chrono::duration<double>{rstart - start}.count(),
+                rendertime, lateness, opstart, opend});
+
+            /* Start over from now instead of trying to catch up. */
+            deadline = rend;
+        }
+    }
+}
+
+
+/* A simple LCG, so a run can be repeated with the same seed. */
+struct Random {
+    uint32_t mSeed;
+
+    uint32_t next() noexcept
+    {
+        mSeed = (mSeed * 96314165u) + 907633515u;
+        return mSeed >> 8;
+    }
+    uint below(size_t count) noexcept { return static_cast<uint>(next() % count); }
+    float unit() noexcept { return static_cast<float>(next()) / 16777216.0f; }
+};
+
+/* The state of a callback-buffer stream, which generates a tone. */
+struct StreamState {
+    float mPhase{0.0f};
+    float mStep{0.0f};
+};
+
+ALsizei AL_APIENTRY StreamCallback(void *userptr, void *data, ALsizei size) noexcept
+{
+    auto *state = static_cast<StreamState*>(userptr);
+    auto *samples = static_cast<float*>(data);
+    const auto count = static_cast<size_t>(size) / sizeof(float);
+    for(size_t i{0};i < count;++i)
+    {
+        samples[i] = std::sin(state->mPhase) * 0.25f;
+        state->mPhase += state->mStep;
+        if(state->mPhase > 6.28318530718f)
+            state->mPhase -= 6.28318530718f;
+    }
+    return size;
+}
+
+struct SourceInfo {
+    ALuint mId;
+    ALuint mBuffer;
+    ALuint mSlot;
+};
+
+struct StreamInfo {
+    ALuint mSource;
+    ALuint mBuffer;
+    std::unique_ptr<StreamState> mState;
+};
+
+class Scene {
+    ALCdevice *mDevice;
+    const Options &mOpts;
+    Random mRand;
+
+    std::vector<SourceInfo> mSources;
+    std::vector<StreamInfo> mStreams;
+    std::vector<ALuint> mBuffers;
+    std::vector<std::pair<ALuint,ALuint>> mSlots; /* slot, effect */
+    std::vector<ALuint> mFilters;
+    bool mHrtf{false};
+    float mTime{0.0f};
+
+    ALuint createBuffer()
+    {
+        /* Between a tenth of a second and two seconds of noisy tone. */
+        const auto length = static_cast<size_t>(mOpts.mFrequency/10)
+            * (1 + mRand.below(20));
+        const float step{(110.0f + mRand.unit()*1000.0f) * 6.28318530718f
+            / static_cast<float>(mOpts.mFrequency)};
+        std::vector<float> data(length);
+        for(size_t i{0};i < length;++i)
+            data[i] = std::sin(static_cast<float>(i)*step)*0.2f + (mRand.unit()-0.5f)*0.05f;
+
+        ALuint buffer{};
+        alGenBuffers(1, &buffer);
+        alBufferData(buffer, AL_FORMAT_MONO_FLOAT32, data.data(),
+            static_cast<ALsizei>(length*sizeof(float)), mOpts.mFrequency);
+        return buffer;
+    }
+
+    bool bufferInUse(ALuint buffer) const
+    {
+        return std::any_of(mSources.cbegin(), mSources.cend(),
+            [buffer](const SourceInfo &info) { return info.mBuffer == buffer; });
+    }
+
+    void addSource()
+    {
+        if(mSources.size() >= mOpts.mMaxSources)
+            return removeSource();
+        if(mBuffers.empty())
+            return addBuffer();
+
+        SourceInfo info{};
+        info.mBuffer = mBuffers[mRand.below(mBuffers.size())];
+        alGenSources(1, &info.mId);
+        alSourcei(info.mId, AL_BUFFER, static_cast<ALint>(info.mBuffer));
+        alSourcei(info.mId, AL_LOOPING, AL_TRUE);
+        alSource3f(info.mId, AL_POSITION, mRand.unit()*20.0f - 10.0f, 0.0f,
+            mRand.unit()*20.0f - 10.0f);
+        if(!mFilters.empty() && mRand.below(2))
+            alSourcei(info.mId, AL_DIRECT_FILTER,
+                static_cast<ALint>(mFilters[mRand.below(mFilters.size())]));
+        if(!mSlots.empty() && mRand.below(2))
+        {
+            info.mSlot = mSlots[mRand.below(mSlots.size())].first;
+            alSource3i(info.mId, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(info.mSlot), 0,
+                AL_FILTER_NULL);
+        }
+        alSourcePlay(info.mId);
+        mSources.emplace_back(info);
+    }
+
+    void removeSource()
+    {
+        if(mSources.empty())
+            return;
+        const size_t idx{mRand.below(mSources.size())};
+        alDeleteSources(1, &mSources[idx].mId);
+        mSources.erase(mSources.begin() + static_cast<ptrdiff_t>(idx));
+    }
+
+    void updateSources()
+    {
+        mTime += 0.01f;
+        for(size_t i{0};i < mSources.size();++i)
+        {
+            const float angle{mTime + static_cast<float>(i)*2.4f};
+            const float dist{1.0f + static_cast<float>(i%16)*0.75f};
+            alSource3f(mSources[i].mId, AL_POSITION, std::sin(angle)*dist, 0.0f,
+                -std::cos(angle)*dist);
+        }
+    }
+
+    void addStream()
+    {
+        if(mStreams.size() >= 8)
+            return removeStream();
+
+        StreamInfo info{};
+        info.mState = std::make_unique<StreamState>();
+        info.mState->mStep = (220.0f + mRand.unit()*660.0f) * 6.28318530718f
+            / static_cast<float>(mOpts.mFrequency);
+        alGenBuffers(1, &info.mBuffer);
+        alBufferCallbackSOFT(info.mBuffer, AL_FORMAT_MONO_FLOAT32, mOpts.mFrequency,
+            StreamCallback, info.mState.get());
+        alGenSources(1, &info.mSource);
+        alSourcei(info.mSource, AL_BUFFER, static_cast<ALint>(info.mBuffer));
+        alSourcePlay(info.mSource);
+        mStreams.emplace_back(std::move(info));
+    }
+
+    void removeStream()
+    {
+        if(mStreams.empty())
+            return;
+        const size_t idx{mRand.below(mStreams.size())};
+        alDeleteSources(1, &mStreams[idx].mSource);
+        alDeleteBuffers(1, &mStreams[idx].mBuffer);
+        mStreams.erase(mStreams.begin() + static_cast<ptrdiff_t>(idx));
+    }
+
+    void addBuffer()
+    {
+        if(mBuffers.size() >= 32)
+            return removeBuffer();
+        mBuffers.emplace_back(createBuffer());
+    }
+
+    void removeBuffer()
+    {
+        if(mBuffers.empty())
+            return;
+        const size_t idx{mRand.below(mBuffers.size())};
+        if(bufferInUse(mBuffers[idx]))
+            return;
+        alDeleteBuffers(1, &mBuffers[idx]);
+        mBuffers.erase(mBuffers.begin() + static_cast<ptrdiff_t>(idx));
+    }
+
+    void bufferSubData()
+    {
+        if(mSources.empty())
+            return;
+
+        /* Rewrite up to a twentieth of a second of a playing source's buffer
+         * with new noise.
+         */
+        const ALuint buffer{mSources[mRand.below(mSources.size())].mBuffer};
+        ALint size{};
+        alGetBufferi(buffer, AL_SIZE, &size);
+        const auto frames = static_cast<size_t>(size) / sizeof(float);
+        const size_t length{std::min(frames, static_cast<size_t>(mOpts.mFrequency/20))};
+        if(length == 0)
+            return;
+        const size_t offset{mRand.below(frames - length + 1)};
+
+        std::vector<float> data(length);
+        for(float &sample : data)
+            sample = (mRand.unit()-0.5f)*0.1f;
+        alBufferSubDataSOFT(buffer, AL_FORMAT_MONO_FLOAT32, data.data(),
+            static_cast<ALsizei>(offset*sizeof(float)),
+            static_cast<ALsizei>(length*sizeof(float)));
+    }
+
+    void addSlot()
+    {
+        if(mSlots.size() >= 8)
+            return removeSlot();
+
+        ALuint slot{}, effect{};
+        alGenAuxiliaryEffectSlots(1, &slot);
+        alGenEffects(1, &effect);
+        alEffecti(effect, AL_EFFECT_TYPE, EffectTypes[mRand.below(EffectTypes.size())]);
+        alAuxiliaryEffectSloti(slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
+        mSlots.emplace_back(slot, effect);
+    }
+
+    void removeSlot()
+    {
+        if(mSlots.empty())
+            return;
+        const size_t idx{mRand.below(mSlots.size())};
+        const ALuint slot{mSlots[idx].first};
+
+        /* The slot can't be deleted while a source sends to it. */
+        for(auto &info : mSources)
+        {
+            if(info.mSlot != slot) continue;
+            alSource3i(info.mId, AL_AUXILIARY_SEND_FILTER, AL_EFFECTSLOT_NULL, 0,
+                AL_FILTER_NULL);
+            info.mSlot = 0;
+        }
+        alDeleteAuxiliaryEffectSlots(1, &mSlots[idx].first);
+        alDeleteEffects(1, &mSlots[idx].second);
+        mSlots.erase(mSlots.begin() + static_cast<ptrdiff_t>(idx));
+    }
+
+    void changeEffect()
+    {
+        if(mSlots.empty())
+            return addSlot();
+        const auto &slot = mSlots[mRand.below(mSlots.size())];
+        alEffecti(slot.second, AL_EFFECT_TYPE, EffectTypes[mRand.below(EffectTypes.size())]);
+        alAuxiliaryEffectSloti(slot.first, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(slot.second));
+    }
+
+    void addFilter()
+    {
+        if(mFilters.size() >= 8)
+            return removeFilter();
+
+        ALuint filter{};
+        alGenFilters(1, &filter);
+        alFilteri(filter, AL_FILTER_TYPE, AL_FILTER_LOWPASS);
+        alFilterf(filter, AL_LOWPASS_GAIN, 0.5f + mRand.unit()*0.5f);
+        alFilterf(filter, AL_LOWPASS_GAINHF, mRand.unit());
+        mFilters.emplace_back(filter);
+    }
+
+    void removeFilter()
+    {
+        if(mFilters.empty())
+            return;
+        /* Sources keep a copy of the filter's properties, so it can be
+         * deleted while in use.
+         */
+        const size_t idx{mRand.below(mFilters.size())};
+        alDeleteFilters(1, &mFilters[idx]);
+        mFilters.erase(mFilters.begin() + static_cast<ptrdiff_t>(idx));
+    }
+
+    void resetDevice()
+    {
+        mHrtf = !mHrtf;
+        const std::array<ALCint,9> attrs{{
+            ALC_FREQUENCY, mOpts.mFrequency,
+            ALC_FORMAT_TYPE_SOFT, ALC_FLOAT_SOFT,
+            ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+            ALC_HRTF_SOFT, mHrtf ? ALC_TRUE : ALC_FALSE,
+            0
+        }};
+        std::lock_guard<std::mutex> _{gRenderLock};
+        if(!alcResetDeviceSOFT(mDevice, attrs.data()))
+            std::fprintf(stderr, "Failed to reset the device\n");
+    }
+
+public:
+    Scene(ALCdevice *device, const Options &opts)
+        : mDevice{device}, mOpts{opts}, mRand{opts.mSeed}
+    { }
+    ~Scene()
+    {
+        for(const auto &info : mSources)
+            alDeleteSources(1, &info.mId);
+        for(const auto &info : mStreams)
+        {
+            alDeleteSources(1, &info.mSource);
+            alDeleteBuffers(1, &info.mBuffer);
+        }
+        for(const auto &slot : mSlots)
+        {
+            alDeleteAuxiliaryEffectSlots(1, &slot.first);
+            alDeleteEffects(1, &slot.second);
+        }
+        if(!mFilters.empty())
+            alDeleteFilters(static_cast<ALsizei>(mFilters.size()), mFilters.data());
+        if(!mBuffers.empty())
+            alDeleteBuffers(static_cast<ALsizei>(mBuffers.size()), mBuffers.data());
+    }
+
+    OpType pickOp()
+    {
+        uint total{0u};
+        for(uint weight : OpWeights)
+            total += weight;
+        uint sel{mRand.below(total)};
+        for(size_t i{0};i < OpWeights.size();++i)
+        {
+            if(sel < OpWeights[i])
+                return static_cast<OpType>(i);
+            sel -= OpWeights[i];
+        }
+        return OpType::UpdateSources;
+    }
+
+    void run(OpType op)
+    {
+        switch(op)
+        {
+        case OpType::None: break;
+        case OpType::AddSource: addSource(); break;
+        case OpType::RemoveSource: removeSource(); break;
+        case OpType::UpdateSources: updateSources(); break;
+        case OpType::AddStream: addStream(); break;
+        case OpType::RemoveStream: removeStream(); break;
+        case OpType::AddBuffer: addBuffer(); break;
+        case OpType::RemoveBuffer: removeBuffer(); break;
+        case OpType::BufferSubData: bufferSubData(); break;
+        case OpType::AddSlot: addSlot(); break;
+        case OpType::RemoveSlot: removeSlot(); break;
+        case OpType::ChangeEffect: changeEffect(); break;
+        case OpType::AddFilter: addFilter(); break;
+        case OpType::RemoveFilter: removeFilter(); break;
+        case OpType::ResetDevice: resetDevice(); break;
+        case OpType::Count: break;
+        }
+    }
+
+    size_t numSources() const noexcept { return mSources.size() + mStreams.size(); }
+    size_t numBuffers() const noexcept { return mBuffers.size(); }
+    size_t numSlots() const noexcept { return mSlots.size(); }
+};
+
+
+void PrintMisses()
+{
+    MissRecord rec{};
+    while(gMissQueue.pop(rec))
+    {
+        std::printf("%10.3fs  miss: render %8.3fms, late %8.3fms, during %s",
+            rec.mTime, static_cast<double>(rec.mRenderTime)/1e6,
+            static_cast<double>(rec.mLateness)/1e6, OpNames[static_cast<size_t>(rec.mOpStart)]);
+        if(rec.mOpEnd != rec.mOpStart)
+            std::printf(" -> %s", OpNames[static_cast<size_t>(rec.mOpEnd)]);
+        std::printf("\n");
+    }
+}
+
+void PrintUsage(const char *name)
+{
+    std::printf("Usage: %s [options]\n\n"
+        "Options:\n"
+        "  -d, --duration <sec>    Time to run for (default: 60)\n"
+        "  --seed <value>          Random seed, to repeat a run (default: 0)\n"
+        "  -s, --sources <count>   Maximum number of static sources (default: 256)\n"
+        "  -i, --interval <ms>     Time between operations (default: 2)\n"
+        "  --report <sec>          Time between status reports (default: 10)\n"
+        "  -r, --rate <hz>         Output sample rate (default: 48000)\n"
+        "  -u, --update <samples>  Samples to render per period (default: 512)\n",
+        name);
+}
+
+bool ParseOptions(int argc, char **argv, Options &opts)
+{
+    for(int i{1};i < argc;++i)
+    {
+        const char *arg{argv[i]};
+        const char *val{(i+1 < argc) ? argv[i+1] : nullptr};
+
+        if(std::strcmp(arg, "-h") == 0 || std::strcmp(arg, "--help") == 0)
+        {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        }
+        if(!val)
+        {
+            std::fprintf(stderr, "Unexpected or incomplete option: %s\n", arg);
+            return false;
+        }
+        ++i;
+
+        if(std::strcmp(arg, "-d") == 0 || std::strcmp(arg, "--duration") == 0)
+            opts.mSeconds = std::atof(val);
+        else if(std::strcmp(arg, "--seed") == 0)
+            opts.mSeed = static_cast<uint>(std::strtoul(val, nullptr, 0));
+        else if(std::strcmp(arg, "-s") == 0 || std::strcmp(arg, "--sources") == 0)
+            opts.mMaxSources = static_cast<uint>(std::atoi(val));
+        else if(std::strcmp(arg, "-i") == 0 || std::strcmp(arg, "--interval") == 0)
+            opts.mOpInterval = std::atof(val) / 1000.0;
+        else if(std::strcmp(arg, "--report") == 0)
+            opts.mReportInterval = std::atof(val);
+        else if(std::strcmp(arg, "-r") == 0 || std::strcmp(arg, "--rate") == 0)
+            opts.mFrequency = std::atoi(val);
+        else if(std::strcmp(arg, "-u") == 0 || std::strcmp(arg, "--update") == 0)
+            opts.mUpdateSize = std::atoi(val);
+        else
+        {
+            std::fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+    }
+
+    if(!(opts.mSeconds > 0.0) || opts.mMaxSources < 1 || !(opts.mOpInterval >= 0.0)
+        || !(opts.mReportInterval > 0.0) || opts.mFrequency <= 0 || opts.mUpdateSize <= 0)
+    {
+        std::fprintf(stderr, "Invalid option value\n");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    Options opts;
+    if(!ParseOptions(argc, argv, opts))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if(!alcIsExtensionPresent(nullptr, "ALC_SOFT_loopback"))
+    {
+        std::fprintf(stderr, "Error: ALC_SOFT_loopback not supported!\n");
+        return 1;
+    }
+
+#define LOAD_PROC(T, x)  ((x) = reinterpret_cast<T>(alcGetProcAddress(nullptr, #x)))
+    LOAD_PROC(LPALCLOOPBACKOPENDEVICESOFT, alcLoopbackOpenDeviceSOFT);
+    LOAD_PROC(LPALCRENDERSAMPLESSOFT, alcRenderSamplesSOFT);
+    LOAD_PROC(LPALCRESETDEVICESOFT, alcResetDeviceSOFT);
+#undef LOAD_PROC
+
+    ALCdevice *device{alcLoopbackOpenDeviceSOFT(nullptr)};
+    if(!device)
+    {
+        std::fprintf(stderr, "Failed to open loopback device!\n");
+        return 1;
+    }
+
+    const std::array<ALCint,11> attrs{{
+        ALC_FREQUENCY, opts.mFrequency,
+        ALC_FORMAT_TYPE_SOFT, ALC_FLOAT_SOFT,
+        ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+        ALC_MONO_SOURCES, static_cast<ALCint>(opts.mMaxSources) + 16,
+        ALC_MAX_AUXILIARY_SENDS, 1,
+        0
+    }};
+    ALCcontext *context{alcCreateContext(device, attrs.data())};
+    if(!context || alcMakeContextCurrent(context) == ALC_FALSE)
+    {
+        std::fprintf(stderr, "Failed to set up context!\n");
+        if(context)
+            alcDestroyContext(context);
+        alcCloseDevice(device);
+        return 1;
+    }
+    if(!alcIsExtensionPresent(device, "ALC_EXT_EFX")
+        || !alIsExtensionPresent("AL_SOFT_callback_buffer"))
+    {
+        std::fprintf(stderr, "Error: EFX and AL_SOFT_callback_buffer are required!\n");
+        alcMakeContextCurrent(nullptr);
+        alcDestroyContext(context);
+        alcCloseDevice(device);
+        return 1;
+    }
+
+#define LOAD_PROC(T, x)  ((x) = reinterpret_cast<T>(alGetProcAddress(#x)))
+    LOAD_PROC(LPALBUFFERCALLBACKSOFT, alBufferCallbackSOFT);
+    /* Only advertised for compatibility, but always available. */
+    LOAD_PROC(PFNALBUFFERSUBDATASOFTPROC, alBufferSubDataSOFT);
+    LOAD_PROC(LPALGENEFFECTS, alGenEffects);
+    LOAD_PROC(LPALDELETEEFFECTS, alDeleteEffects);
+    LOAD_PROC(LPALEFFECTI, alEffecti);
+    LOAD_PROC(LPALGENFILTERS, alGenFilters);
+    LOAD_PROC(LPALDELETEFILTERS, alDeleteFilters);
+    LOAD_PROC(LPALFILTERI, alFilteri);
+    LOAD_PROC(LPALFILTERF, alFilterf);
+    LOAD_PROC(LPALGENAUXILIARYEFFECTSLOTS, alGenAuxiliaryEffectSlots);
+    LOAD_PROC(LPALDELETEAUXILIARYEFFECTSLOTS, alDeleteAuxiliaryEffectSlots);
+    LOAD_PROC(LPALAUXILIARYEFFECTSLOTI, alAuxiliaryEffectSloti);
+#undef LOAD_PROC
+
+    std::printf("Running for %.0fs with seed %u, %d sample periods (%.3fms)\n", opts.mSeconds,
+        opts.mSeed, opts.mUpdateSize, opts.mUpdateSize * 1000.0 / opts.mFrequency);
+    std::fflush(stdout);
+
+    uint64_t errors{0u};
+    {
+        Scene scene{device, opts};
+
+        const auto start = steady_clock::now();
+        const auto end = start + duration_cast<nanoseconds>(
+            std::chrono::duration<double>{opts.mSeconds});
+        const auto interval = duration_cast<nanoseconds>(
+            std::chrono::duration<double>{opts.mOpInterval});
+        const auto report_interval = duration_cast<nanoseconds>(
+            std::chrono::duration<double>{opts.mReportInterval});
+
+        std::thread renderer{RenderThread, device, std::cref(opts), start};
+
+        auto next_report = start + report_interval;
+        auto now = start;
+        while(now < end)
+        {
+            const OpType op{scene.pickOp()};
+            gCurrentOp.store(op, std::memory_order_relaxed);
+            scene.run(op);
+            gCurrentOp.store(OpType::None, std::memory_order_relaxed);
+            if(alGetError() != AL_NO_ERROR)
+                ++errors;
+
+            PrintMisses();
+            now = steady_clock::now();
+            if(now >= next_report)
+            {
+                std::printf("%10.3fs  periods %llu, misses %llu (%llu from resets), worst "
+                    "render %.3fms; %zu sources, %zu buffers, %zu slots\n",
+                    std::chrono::duration<double>{now - start}.count(),
+                    static_cast<unsigned long long>(gPeriods.load()),
+                    static_cast<unsigned long long>(gMisses.load()),
+                    static_cast<unsigned long long>(gResetMisses.load()),
+                    static_cast<double>(gWorstRenderTime.load())/1e6, scene.numSources(),
+                    scene.numBuffers(), scene.numSlots());
+                std::fflush(stdout);
+                next_report += report_interval;
+            }
+            std::this_thread::sleep_for(interval);
+            now = steady_clock::now();
+        }
+
+        gQuit.store(true);
+        renderer.join();
+        PrintMisses();
+    }
+
+    std::printf("Done: %llu periods, %llu misses (%llu from resets, %llu not logged), "
+        "%llu AL errors, worst render %.3fms\n",
+        static_cast<unsigned long long>(gPeriods.load()),
+        static_cast<unsigned long long>(gMisses.load()),
+        static_cast<unsigned long long>(gResetMisses.load()),
+        static_cast<unsigned long long>(gMissQueue.dropped()),
+        static_cast<unsigned long long>(errors),
+        static_cast<double>(gWorstRenderTime.load())/1e6);
+
+    alcMakeContextCurrent(nullptr);
+    alcDestroyContext(context);
+    alcCloseDevice(device);
+    return (errors == 0) ? 0 : 1;
+}
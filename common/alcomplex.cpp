@@ -4,12 +4,19 @@
 #include "alcomplex.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
 #include <functional>
 #include <utility>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "albit.h"
 #include "alnumbers.h"
 #include "alnumeric.h"
@@ -89,6 +96,322 @@ constexpr std::array<al::span<const ushort2>,11> gBitReverses{{
     BitReverser10.mData
 }};
 
+
+/* The largest FFT size to use precomputed twiddle factors with. Larger sizes
+ * calculate them as needed, which is slower and less precise with floats.
+ */
+constexpr size_t TwiddleTableBits{14};
+constexpr size_t TwiddleTableSize{1u << TwiddleTableBits};
+
+/* Holds exp(-2*pi*i*k/TwiddleTableSize) for k = [0...TwiddleTableSize/2).
+ * The twiddle factors for smaller FFT sizes are taken at regular steps.
+ */
+template<typename Real>
+struct TwiddleTable {
+    std::array<std::complex<Real>,TwiddleTableSize/2> mData{};
+
+    TwiddleTable()
+    {
+        for(size_t k{0};k < mData.size();++k)
+        {
+            const double arg{-2.0 * al::numbers::pi * static_cast<double>(k) /
+                double{TwiddleTableSize}};
+            mData[k] = std::complex<Real>{static_cast<Real>(std::cos(arg)),
+                static_cast<Real>(std::sin(arg))};
+        }
+    }
+};
+
+/* Function-local statics, to make sure they're initialized for any FFTs done
+ * during static initialization (e.g. the UHJ phase shifters).
+ */
+template<typename Real>
+const TwiddleTable<Real> &GetTwiddles()
+{
+    static const TwiddleTable<Real> table{};
+    return table;
+}
+
+
+template<typename Real>
+inline std::complex<Real> cmul(const std::complex<Real> a, const std::complex<Real> b) noexcept
+{
+    return std::complex<Real>{a.real()*b.real() - a.imag()*b.imag(),
+        a.real()*b.imag() + a.imag()*b.real()};
+}
+
+/* Applies count radix-2 butterflies between the lower and upper values, using
+ * every twstep'th twiddle factor (conjugated for an inverse FFT).
+ */
+template<typename Real>
+void ApplyButterflies(std::complex<Real> *RESTRICT lower, std::complex<Real> *RESTRICT upper,
+    const std::complex<Real> *RESTRICT twiddles, const size_t twstep, const size_t count,
+    const bool inverse) noexcept
+{
+    for(size_t j{0};j < count;++j)
+    {
+        const std::complex<Real> w{inverse ? std::conj(twiddles[j*twstep]) : twiddles[j*twstep]};
+        const std::complex<Real> temp{cmul(upper[j], w)};
+        upper[j] = lower[j] - temp;
+        lower[j] += temp;
+    }
+}
+
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+/* Single-precision butterflies two at a time, with interleaved real and
+ * imaginary values.
+ */
+template<>
+void ApplyButterflies(std::complex<float> *RESTRICT lower, std::complex<float> *RESTRICT upper,
+    const std::complex<float> *RESTRICT twiddles, const size_t twstep, const size_t count,
+    const bool inverse) noexcept
+{
+    auto lower_f = reinterpret_cast<float*>(lower);
+    auto upper_f = reinterpret_cast<float*>(upper);
+    auto twiddles_f = reinterpret_cast<const float*>(twiddles);
+    const float imsign{inverse ? -1.0f : 1.0f};
+
+    size_t j{0};
+#ifdef HAVE_SSE_INTRINSICS
+    /* Multiplying the swapped value's imaginary parts with the twiddle's, and
+     * negating the real results, gives the cross terms of the complex
+     * multiply.
+     */
+    const __m128 crosssign{_mm_setr_ps(-imsign, imsign, -imsign, imsign)};
+    for(;j+2 <= count;j+=2)
+    {
+        __m128 w{_mm_setzero_ps()};
+        w = _mm_loadl_pi(w, reinterpret_cast<const __m64*>(twiddles_f + j*twstep*2));
+        w = _mm_loadh_pi(w, reinterpret_cast<const __m64*>(twiddles_f + (j+1)*twstep*2));
+        const __m128 wr{_mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0))};
+        const __m128 wi{_mm_mul_ps(_mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1)), crosssign)};
+
+        const __m128 u{_mm_loadu_ps(upper_f + j*2)};
+        const __m128 uswap{_mm_shuffle_ps(u, u, _MM_SHUFFLE(2, 3, 0, 1))};
+        const __m128 temp{_mm_add_ps(_mm_mul_ps(u, wr), _mm_mul_ps(uswap, wi))};
+
+        const __m128 l{_mm_loadu_ps(lower_f + j*2)};
+        _mm_storeu_ps(upper_f + j*2, _mm_sub_ps(l, temp));
+        _mm_storeu_ps(lower_f + j*2, _mm_add_ps(l, temp));
+    }
+#else
+    const float signs[4]{-imsign, imsign, -imsign, imsign};
+    const float32x4_t crosssign{vld1q_f32(signs)};
+    for(;j+2 <= count;j+=2)
+    {
+        const float32x4_t w{vcombine_f32(vld1_f32(twiddles_f + j*twstep*2),
+            vld1_f32(twiddles_f + (j+1)*twstep*2))};
+        const float32x4x2_t wrwi{vtrnq_f32(w, w)};
+        const float32x4_t wi{vmulq_f32(wrwi.val[1], crosssign)};
+
+        const float32x4_t u{vld1q_f32(upper_f + j*2)};
+        const float32x4_t temp{vmlaq_f32(vmulq_f32(u, wrwi.val[0]), vrev64q_f32(u), wi)};
+
+        const float32x4_t l{vld1q_f32(lower_f + j*2)};
+        vst1q_f32(upper_f + j*2, vsubq_f32(l, temp));
+        vst1q_f32(lower_f + j*2, vaddq_f32(l, temp));
+    }
+#endif
+    for(;j < count;++j)
+    {
+        const std::complex<float> w{inverse ? std::conj(twiddles[j*twstep]) : twiddles[j*twstep]};
+        const std::complex<float> temp{cmul(upper[j], w)};
+        upper[j] = lower[j] - temp;
+        lower[j] += temp;
+    }
+}
+#endif
+
+
+/* Splits the FFT of the even and odd real samples, stored as the real and
+ * imaginary values of a half-size complex FFT, and combines them into the
+ * non-mirrored bins of the full real FFT.
+ */
+template<typename Real, typename F>
+void RealFftPostProcess(const al::span<std::complex<Real>> buffer, F&& get_twiddle) noexcept
+{
+    const size_t n{buffer.size()};
+
+    const std::complex<Real> z0{buffer[0]};
+    buffer[0] = std::complex<Real>{z0.real()+z0.imag(), z0.real()-z0.imag()};
+    for(size_t k{1};k <= n/2;++k)
+    {
+        const std::complex<Real> a{buffer[k]}, b{std::conj(buffer[n-k])};
+        const std::complex<Real> even{(a + b) * Real{0.5}};
+        const std::complex<Real> odd{cmul(a - b, std::complex<Real>{0, Real{-0.5}})};
+        const std::complex<Real> t{cmul(get_twiddle(k), odd)};
+
+        buffer[k] = even + t;
+        buffer[n-k] = std::conj(even - t);
+    }
+}
+
+/* Separates the even and odd samples' responses for each pair of bins, and
+ * combines them as real and imaginary values for a half-size inverse complex
+ * FFT. This results in twice the scale, which together with the half-size
+ * complex FFT gives the expected scale of the full inverse FFT.
+ */
+template<typename Real, typename F>
+void RealFftPreProcess(const al::span<std::complex<Real>> buffer, F&& get_twiddle) noexcept
+{
+    const size_t n{buffer.size()};
+
+    const std::complex<Real> x0{buffer[0]};
+    buffer[0] = std::complex<Real>{x0.real()+x0.imag(), x0.real()-x0.imag()};
+    for(size_t k{1};k <= n/2;++k)
+    {
+        const std::complex<Real> a{buffer[k]}, b{std::conj(buffer[n-k])};
+        const std::complex<Real> even{a + b};
+        const std::complex<Real> odd{cmul(a - b, std::conj(get_twiddle(k)))};
+
+        buffer[k] = even + std::complex<Real>{-odd.imag(), odd.real()};
+        buffer[n-k] = std::conj(even) + std::complex<Real>{odd.imag(), odd.real()};
+    }
+}
+
+
+/* Applies the radix-4 butterflies of one stage to each group of 4*quarter
+ * values. This combines two radix-2 stages, so the input is in the same bit-
+ * reversed order. The twiddles hold w, w^2, and w^3 for each butterfly, as
+ * three sequences of quarter values (conjugated for an inverse FFT).
+ */
+template<typename Real>
+void ApplyRadix4(std::complex<Real> *buffer, const size_t fftsize, const size_t quarter,
+    const std::complex<Real> *RESTRICT twiddles, const bool inverse) noexcept
+{
+    for(size_t k{0};k < fftsize;k+=quarter*4)
+    {
+        std::complex<Real> *out0{buffer + k};
+        std::complex<Real> *out1{out0 + quarter};
+        std::complex<Real> *out2{out1 + quarter};
+        std::complex<Real> *out3{out2 + quarter};
+        for(size_t j{0};j < quarter;++j)
+        {
+            std::complex<Real> w1{twiddles[j]};
+            std::complex<Real> w2{twiddles[quarter + j]};
+            std::complex<Real> w3{twiddles[quarter*2 + j]};
+            if(inverse)
+            {
+                w1 = std::conj(w1);
+                w2 = std::conj(w2);
+                w3 = std::conj(w3);
+            }
+
+            const std::complex<Real> a{out0[j]};
+            const std::complex<Real> b{cmul(out1[j], w2)};
+            const std::complex<Real> c{cmul(out2[j], w1)};
+            const std::complex<Real> d{cmul(out3[j], w3)};
+
+            const std::complex<Real> s0{a + b}, s1{a - b};
+            const std::complex<Real> s2{c + d}, s3{c - d};
+            /* Rotate s3 by -i for a forward FFT, or +i for an inverse FFT. */
+            const std::complex<Real> s3r{inverse ? std::complex<Real>{-s3.imag(), s3.real()}
+                : std::complex<Real>{s3.imag(), -s3.real()}};
+
+            out0[j] = s0 + s2;
+            out1[j] = s1 + s3r;
+            out2[j] = s0 - s2;
+            out3[j] = s1 - s3r;
+        }
+    }
+}
+
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+/* Single-precision radix-4 butterflies two at a time. The quarter size is
+ * always even here, since the first stage of the plan is trivial (radix-2 or
+ * a radix-4 without twiddles).
+ */
+template<>
+void ApplyRadix4(std::complex<float> *buffer, const size_t fftsize, const size_t quarter,
+    const std::complex<float> *RESTRICT twiddles, const bool inverse) noexcept
+{
+    auto twiddles_f = reinterpret_cast<const float*>(twiddles);
+    const float imsign{inverse ? -1.0f : 1.0f};
+
+#ifdef HAVE_SSE_INTRINSICS
+    /* The sign to apply to the swapped value's products with the twiddle's
+     * imaginary parts, and the negated sign to rotate by -i (or +i).
+     */
+    const __m128 crosssign{_mm_setr_ps(-imsign, imsign, -imsign, imsign)};
+    const __m128 rotsign{_mm_setr_ps(imsign, -imsign, imsign, -imsign)};
+    auto cmul4 = [crosssign](const __m128 u, const __m128 w) noexcept -> __m128
+    {
+        const __m128 wr{_mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0))};
+        const __m128 wi{_mm_mul_ps(_mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1)), crosssign)};
+        const __m128 uswap{_mm_shuffle_ps(u, u, _MM_SHUFFLE(2, 3, 0, 1))};
+        return _mm_add_ps(_mm_mul_ps(u, wr), _mm_mul_ps(uswap, wi));
+    };
+
+    for(size_t k{0};k < fftsize;k+=quarter*4)
+    {
+        float *out0{reinterpret_cast<float*>(buffer + k)};
+        float *out1{out0 + quarter*2};
+        float *out2{out1 + quarter*2};
+        float *out3{out2 + quarter*2};
+        for(size_t j{0};j < quarter*2;j+=4)
+        {
+            const __m128 w1{_mm_loadu_ps(twiddles_f + j)};
+            const __m128 w2{_mm_loadu_ps(twiddles_f + quarter*2 + j)};
+            const __m128 w3{_mm_loadu_ps(twiddles_f + quarter*4 + j)};
+
+            const __m128 a{_mm_loadu_ps(out0 + j)};
+            const __m128 b{cmul4(_mm_loadu_ps(out1 + j), w2)};
+            const __m128 c{cmul4(_mm_loadu_ps(out2 + j), w1)};
+            const __m128 d{cmul4(_mm_loadu_ps(out3 + j), w3)};
+
+            const __m128 s0{_mm_add_ps(a, b)}, s1{_mm_sub_ps(a, b)};
+            const __m128 s2{_mm_add_ps(c, d)}, s3{_mm_sub_ps(c, d)};
+            const __m128 s3r{_mm_mul_ps(_mm_shuffle_ps(s3, s3, _MM_SHUFFLE(2, 3, 0, 1)),
+                rotsign)};
+
+            _mm_storeu_ps(out0 + j, _mm_add_ps(s0, s2));
+            _mm_storeu_ps(out1 + j, _mm_add_ps(s1, s3r));
+            _mm_storeu_ps(out2 + j, _mm_sub_ps(s0, s2));
+            _mm_storeu_ps(out3 + j, _mm_sub_ps(s1, s3r));
+        }
+    }
+#else
+    const float signs[4]{-imsign, imsign, -imsign, imsign};
+    const float32x4_t crosssign{vld1q_f32(signs)};
+    const float32x4_t rotsign{vnegq_f32(crosssign)};
+    auto cmul4 = [crosssign](const float32x4_t u, const float32x4_t w) noexcept -> float32x4_t
+    {
+        const float32x4x2_t wrwi{vtrnq_f32(w, w)};
+        const float32x4_t wi{vmulq_f32(wrwi.val[1], crosssign)};
+        return vmlaq_f32(vmulq_f32(u, wrwi.val[0]), vrev64q_f32(u), wi);
+    };
+
+    for(size_t k{0};k < fftsize;k+=quarter*4)
+    {
+        float *out0{reinterpret_cast<float*>(buffer + k)};
+        float *out1{out0 + quarter*2};
+        float *out2{out1 + quarter*2};
+        float *out3{out2 + quarter*2};
+        for(size_t j{0};j < quarter*2;j+=4)
+        {
+            const float32x4_t w1{vld1q_f32(twiddles_f + j)};
+            const float32x4_t w2{vld1q_f32(twiddles_f + quarter*2 + j)};
+            const float32x4_t w3{vld1q_f32(twiddles_f + quarter*4 + j)};
+
+            const float32x4_t a{vld1q_f32(out0 + j)};
+            const float32x4_t b{cmul4(vld1q_f32(out1 + j), w2)};
+            const float32x4_t c{cmul4(vld1q_f32(out2 + j), w1)};
+            const float32x4_t d{cmul4(vld1q_f32(out3 + j), w3)};
+
+            const float32x4_t s0{vaddq_f32(a, b)}, s1{vsubq_f32(a, b)};
+            const float32x4_t s2{vaddq_f32(c, d)}, s3{vsubq_f32(c, d)};
+            const float32x4_t s3r{vmulq_f32(vrev64q_f32(s3), rotsign)};
+
+            vst1q_f32(out0 + j, vaddq_f32(s0, s2));
+            vst1q_f32(out1 + j, vaddq_f32(s1, s3r));
+            vst1q_f32(out2 + j, vsubq_f32(s0, s2));
+            vst1q_f32(out3 + j, vsubq_f32(s1, s3r));
+        }
+    }
+#endif
+}
+#endif
+
 } // namespace
 
 template<typename Real>
@@ -119,33 +442,232 @@ complex_fft(const al::span<std::complex<Real>> buffer, const al::type_identity_t
     else for(auto &rev : gBitReverses[log2_size])
         std::swap(buffer[rev.first], buffer[rev.second]);
 
-    /* Iterative form of Danielson-Lanczos lemma */
-    const Real pi{al::numbers::pi_v<Real> * sign};
-    size_t step2{1u};
-    for(size_t i{0};i < log2_size;++i)
+    if(log2_size > TwiddleTableBits) UNLIKELY
     {
-        const Real arg{pi / static_cast<Real>(step2)};
-
-        /* TODO: Would std::polar(1.0, arg) be any better? */
-        const std::complex<Real> w{std::cos(arg), std::sin(arg)};
-        std::complex<Real> u{1.0, 0.0};
-        const size_t step{step2 << 1};
-        for(size_t j{0};j < step2;j++)
+        /* Iterative form of Danielson-Lanczos lemma */
+        const Real pi{al::numbers::pi_v<Real> * sign};
+        size_t step2{1u};
+        for(size_t i{0};i < log2_size;++i)
         {
-            for(size_t k{j};k < fftsize;k+=step)
+            const Real arg{pi / static_cast<Real>(step2)};
+
+            /* TODO: Would std::polar(1.0, arg) be any better? */
+            const std::complex<Real> w{std::cos(arg), std::sin(arg)};
+            std::complex<Real> u{1.0, 0.0};
+            const size_t step{step2 << 1};
+            for(size_t j{0};j < step2;j++)
             {
-                std::complex<Real> temp{buffer[k+step2] * u};
-                buffer[k+step2] = buffer[k] - temp;
-                buffer[k] += temp;
+                for(size_t k{j};k < fftsize;k+=step)
+                {
+                    std::complex<Real> temp{buffer[k+step2] * u};
+                    buffer[k+step2] = buffer[k] - temp;
+                    buffer[k] += temp;
+                }
+
+                u *= w;
             }
 
-            u *= w;
+            step2 <<= 1;
         }
+        return;
+    }
+
+    /* Same as above, but with the precomputed twiddle factors, going through
+     * each group of butterflies in order.
+     */
+    const bool inverse{sign > 0};
+    const std::complex<Real> *twiddles{GetTwiddles<Real>().mData.data()};
+    size_t step2{1u};
+    for(size_t i{0};i < log2_size;++i)
+    {
+        const size_t twstep{TwiddleTableSize/2 / step2};
+        const size_t step{step2 << 1};
+        for(size_t k{0};k < fftsize;k+=step)
+            ApplyButterflies(&buffer[k], &buffer[k+step2], twiddles, twstep, step2, inverse);
 
         step2 <<= 1;
     }
 }
 
+template<typename Real>
+std::enable_if_t<std::is_floating_point<Real>::value>
+real_fft(const al::span<std::complex<Real>> buffer, const al::type_identity_t<Real> sign)
+{
+    const size_t n{buffer.size()};
+    const size_t twstep{TwiddleTableSize/2 / n};
+    const std::complex<Real> *twiddles{GetTwiddles<Real>().mData.data()};
+
+    /* Gets the twiddle factor exp(-pi*i*k/n), for combining the responses of
+     * the even and odd samples.
+     */
+    auto get_twiddle = [n,twstep,twiddles](const size_t k) noexcept -> std::complex<Real>
+    {
+        if(twstep > 0) LIKELY
+            return twiddles[k*twstep];
+        return std::polar(Real{1}, -al::numbers::pi_v<Real>*static_cast<Real>(k) /
+            static_cast<Real>(n));
+    };
+
+    if(sign < 0)
+    {
+        complex_fft(buffer, Real{-1});
+        RealFftPostProcess(buffer, get_twiddle);
+    }
+    else
+    {
+        RealFftPreProcess(buffer, get_twiddle);
+        complex_fft(buffer, Real{1});
+    }
+}
+
+
+template<typename Real>
+FftPlan<Real>::FftPlan(const size_t size) : mSize{size}
+{
+    assert(size > 0 && (size&(size-1)) == 0);
+    const size_t log2_size{static_cast<size_t>(al::countr_zero(size))};
+
+    for(size_t idx{1u};idx+1 < size;++idx)
+    {
+        size_t revidx{0u}, imask{idx};
+        for(size_t i{0};i < log2_size;++i)
+        {
+            revidx = (revidx<<1) | (imask&1);
+            imask >>= 1;
+        }
+        if(idx < revidx)
+            mBitReverse.emplace_back(static_cast<uint>(idx), static_cast<uint>(revidx));
+    }
+
+    /* The first stage (radix-2 for odd powers of two, or radix-4 otherwise)
+     * has no twiddles, so the first stored stage is after that.
+     */
+    auto get_twiddle = [](const size_t k, const size_t n) -> std::complex<Real>
+    {
+        const double arg{-2.0 * al::numbers::pi * static_cast<double>(k) /
+            static_cast<double>(n)};
+        return std::complex<Real>{static_cast<Real>(std::cos(arg)),
+            static_cast<Real>(std::sin(arg))};
+    };
+    for(size_t quarter{(log2_size&1) ? 2u : 4u};quarter*4 <= size;quarter <<= 2)
+    {
+        for(size_t m{1};m <= 3;++m)
+        {
+            for(size_t j{0};j < quarter;++j)
+                mTwiddles.emplace_back(get_twiddle(j*m, quarter*4));
+        }
+    }
+
+    mRealTwiddleOffset = mTwiddles.size();
+    for(size_t k{0};k <= size/2;++k)
+        mTwiddles.emplace_back(get_twiddle(k, size*2));
+}
+
+template<typename Real>
+FftPlan<Real>::~FftPlan() = default;
+
+template<typename Real>
+void FftPlan<Real>::transform(const al::span<std::complex<Real>> buffer, const bool inverse) const noexcept
+{
+    assert(buffer.size() == mSize);
+    for(const auto &rev : mBitReverse)
+        std::swap(buffer[rev.first], buffer[rev.second]);
+
+    size_t quarter{1};
+    if(al::countr_zero(mSize) & 1)
+    {
+        /* Radix-2 butterflies, with all twiddle factors being 1. */
+        for(size_t k{0};k < mSize;k+=2)
+        {
+            const std::complex<Real> temp{buffer[k+1]};
+            buffer[k+1] = buffer[k] - temp;
+            buffer[k] += temp;
+        }
+        quarter = 2;
+    }
+    else if(mSize >= 4)
+    {
+        /* Radix-4 butterflies, with all twiddle factors being 1. */
+        for(size_t k{0};k < mSize;k+=4)
+        {
+            const std::complex<Real> s0{buffer[k] + buffer[k+1]};
+            const std::complex<Real> s1{buffer[k] - buffer[k+1]};
+            const std::complex<Real> s2{buffer[k+2] + buffer[k+3]};
+            const std::complex<Real> s3{buffer[k+2] - buffer[k+3]};
+            const std::complex<Real> s3r{inverse ? std::complex<Real>{-s3.imag(), s3.real()}
+                : std::complex<Real>{s3.imag(), -s3.real()}};
+            buffer[k] = s0 + s2;
+            buffer[k+1] = s1 + s3r;
+            buffer[k+2] = s0 - s2;
+            buffer[k+3] = s1 - s3r;
+        }
+        quarter = 4;
+    }
+
+    const std::complex<Real> *twiddles{mTwiddles.data()};
+    for(;quarter*4 <= mSize;quarter <<= 2)
+    {
+        ApplyRadix4(buffer.data(), mSize, quarter, twiddles, inverse);
+        twiddles += quarter*3;
+    }
+}
+
+template<typename Real>
+void FftPlan<Real>::forwardReal(const al::span<std::complex<Real>> buffer) const noexcept
+{
+    transform(buffer, false);
+    RealFftPostProcess(buffer, [twiddles=&mTwiddles[mRealTwiddleOffset]](const size_t k) noexcept
+        { return twiddles[k]; });
+}
+
+template<typename Real>
+void FftPlan<Real>::inverseReal(const al::span<std::complex<Real>> buffer) const noexcept
+{
+    assert(buffer.size() == mSize);
+    RealFftPreProcess(buffer, [twiddles=&mTwiddles[mRealTwiddleOffset]](const size_t k) noexcept
+        { return twiddles[k]; });
+    transform(buffer, true);
+}
+
+void complex_mac(float *RESTRICT accre, float *RESTRICT accim, const float *RESTRICT inre,
+    const float *RESTRICT inim, const float *RESTRICT filterre, const float *RESTRICT filterim,
+    const size_t count)
+{
+#ifdef HAVE_SSE_INTRINSICS
+    for(size_t i{0};i < count;i+=4)
+    {
+        const __m128 xr{_mm_load_ps(&inre[i])}, xi{_mm_load_ps(&inim[i])};
+        const __m128 hr{_mm_load_ps(&filterre[i])}, hi{_mm_load_ps(&filterim[i])};
+
+        const __m128 r{_mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi))};
+        const __m128 im{_mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr))};
+        _mm_store_ps(&accre[i], _mm_add_ps(_mm_load_ps(&accre[i]), r));
+        _mm_store_ps(&accim[i], _mm_add_ps(_mm_load_ps(&accim[i]), im));
+    }
+
+#elif defined(HAVE_NEON)
+
+    for(size_t i{0};i < count;i+=4)
+    {
+        const float32x4_t xr{vld1q_f32(&inre[i])}, xi{vld1q_f32(&inim[i])};
+        const float32x4_t hr{vld1q_f32(&filterre[i])}, hi{vld1q_f32(&filterim[i])};
+
+        float32x4_t r{vmlaq_f32(vld1q_f32(&accre[i]), xr, hr)};
+        float32x4_t im{vmlaq_f32(vld1q_f32(&accim[i]), xr, hi)};
+        vst1q_f32(&accre[i], vmlsq_f32(r, xi, hi));
+        vst1q_f32(&accim[i], vmlaq_f32(im, xi, hr));
+    }
+
+#else
+
+    for(size_t i{0};i < count;++i)
+    {
+        accre[i] += inre[i]*filterre[i] - inim[i]*filterim[i];
+        accim[i] += inre[i]*filterim[i] + inim[i]*filterre[i];
+    }
+#endif
+}
+
 void complex_hilbert(const al::span<std::complex<double>> buffer)
 {
     using namespace std::placeholders;
@@ -169,3 +691,8 @@ void complex_hilbert(const al::span<std::complex<double>> buffer)
 
 template void complex_fft<>(const al::span<std::complex<float>> buffer, const float sign);
 template void complex_fft<>(const al::span<std::complex<double>> buffer, const double sign);
+template void real_fft<>(const al::span<std::complex<float>> buffer, const float sign);
+template void real_fft<>(const al::span<std::complex<double>> buffer, const double sign);
+
+template class FftPlan<float>;
+template class FftPlan<double>;
@@ -2,9 +2,15 @@
 #define ALCOMPLEX_H
 
 #include <complex>
+#include <cstddef>
 #include <type_traits>
+#include <utility>
 
 #include "alspan.h"
+#include "opthelpers.h"
+#include "vector.h"
+
+using uint = unsigned int;
 
 /**
  * Iterative implementation of 2-radix FFT (In-place algorithm). Sign = -1 is
@@ -33,6 +39,109 @@ std::enable_if_t<std::is_floating_point<Real>::value>
 inverse_fft(const al::span<std::complex<Real>,N> buffer)
 { complex_fft(buffer.subspan(0), 1); }
 
+/**
+ * Real-input FFT, using a complex FFT of half the size. Sign = -1 is FFT and 1
+ * is inverse FFT. Each even and odd sample pair of the real time-domain signal
+ * is stored as the real and imaginary values of one complex value, so N
+ * complex values hold 2N real samples. The frequency-domain response is the N
+ * non-mirrored frequency bins, except the imaginary value of the first (DC)
+ * bin holds the real value of the last (Nyquist) bin, both of which are purely
+ * real. The buffer size MUST BE power of two.
+ */
+template<typename Real>
+std::enable_if_t<std::is_floating_point<Real>::value>
+real_fft(const al::span<std::complex<Real>> buffer, const al::type_identity_t<Real> sign);
+
+/**
+ * Calculate the frequency-domain response of the real time-domain signal in
+ * the provided buffer, packed as described by real_fft. The buffer MUST BE
+ * power of two.
+ */
+template<typename Real, size_t N>
+std::enable_if_t<std::is_floating_point<Real>::value>
+forward_real_fft(const al::span<std::complex<Real>,N> buffer)
+{ real_fft(buffer.subspan(0), -1); }
+
+/**
+ * Calculate the real time-domain signal of the frequency-domain response in
+ * the provided buffer, packed as described by real_fft. Like inverse_fft, the
+ * resulting samples are scaled up by the number of real samples (twice the
+ * buffer size). The buffer MUST BE power of two.
+ */
+template<typename Real, size_t N>
+std::enable_if_t<std::is_floating_point<Real>::value>
+inverse_real_fft(const al::span<std::complex<Real>,N> buffer)
+{ real_fft(buffer.subspan(0), 1); }
+
+/**
+ * A precomputed plan for FFTs of a given (power of two) size, holding the
+ * bit-reversal permutation and the twiddle factors of each stage so they don't
+ * need to be looked up or calculated with each transform. The transforms use
+ * radix-4 butterflies (with one radix-2 stage for odd powers of two), which
+ * are vectorized for single-precision. A plan is meant to be created ahead of
+ * time, e.g. when an effect is updated for a device, and reused for each
+ * transform of its size.
+ */
+template<typename Real>
+class FftPlan {
+    static_assert(std::is_floating_point<Real>::value, "Must be a floating-point type");
+
+    size_t mSize{0};
+
+    /* Index pairs to swap for the bit-reversal permutation. */
+    al::vector<std::pair<uint,uint>> mBitReverse;
+
+    /* The twiddle factors w, w^2, and w^3 (as three sequences) for each
+     * radix-4 stage, followed by exp(-pi*i*k/size) for k = [0...size/2] to
+     * combine the bins of the real transforms.
+     */
+    al::vector<std::complex<Real>,16> mTwiddles;
+    size_t mRealTwiddleOffset{0};
+
+    void transform(const al::span<std::complex<Real>> buffer, const bool inverse) const noexcept;
+
+public:
+    FftPlan() = default;
+    explicit FftPlan(const size_t size);
+    FftPlan(const FftPlan&) = default;
+    FftPlan(FftPlan&&) = default;
+    ~FftPlan();
+
+    FftPlan& operator=(const FftPlan&) = default;
+    FftPlan& operator=(FftPlan&&) = default;
+
+    size_t size() const noexcept { return mSize; }
+
+    /** Same as forward_fft, with a buffer of the plan's size. */
+    void forward(const al::span<std::complex<Real>> buffer) const noexcept
+    { transform(buffer, false); }
+
+    /** Same as inverse_fft, with a buffer of the plan's size. */
+    void inverse(const al::span<std::complex<Real>> buffer) const noexcept
+    { transform(buffer, true); }
+
+    /**
+     * Same as forward_real_fft, with a buffer of the plan's size (holding
+     * twice as many real samples).
+     */
+    void forwardReal(const al::span<std::complex<Real>> buffer) const noexcept;
+
+    /**
+     * Same as inverse_real_fft, with a buffer of the plan's size (holding
+     * twice as many real samples).
+     */
+    void inverseReal(const al::span<std::complex<Real>> buffer) const noexcept;
+};
+
+/**
+ * Multiplies the complex input and filter bins, adding to the accumulation
+ * bins, all held as split real and imaginary arrays. The count must be a
+ * multiple of 4, and the arrays 16-byte aligned.
+ */
+void complex_mac(float *RESTRICT accre, float *RESTRICT accim, const float *RESTRICT inre,
+    const float *RESTRICT inim, const float *RESTRICT filterre, const float *RESTRICT filterim,
+    const size_t count);
+
 /**
  * Calculate the complex helical sequence (discrete-time analytical signal) of
  * the given input using the discrete Hilbert transform (In-place algorithm).
@@ -3,19 +3,58 @@
 
 #include "almalloc.h"
 
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <new>
+#include <utility>
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "opthelpers.h"
+
+
+namespace {
+
+std::atomic<al::rt_alloc_handler> gRtAllocHandler{nullptr};
+thread_local unsigned int tRtAllocDepth{0u};
+
+inline void CheckRtAlloc(const char *func, size_t size) noexcept
+{
+    if(tRtAllocDepth > 0) UNLIKELY
+    {
+        if(auto handler = gRtAllocHandler.load(std::memory_order_relaxed))
+        {
+            /* Don't recurse if the handler itself touches the heap. */
+            const unsigned int depth{std::exchange(tRtAllocDepth, 0u)};
+            handler(func, size);
+            tRtAllocDepth = depth;
+        }
+    }
+}
+
+} // namespace
+
+void al::set_rt_alloc_handler(rt_alloc_handler handler) noexcept
+{ gRtAllocHandler.store(handler, std::memory_order_relaxed); }
+
+al::rt_alloc_scope::rt_alloc_scope() noexcept { ++tRtAllocDepth; }
+al::rt_alloc_scope::~rt_alloc_scope() { --tRtAllocDepth; }
 
 
 void *al_malloc(size_t alignment, size_t size)
 {
     assert((alignment & (alignment-1)) == 0);
+    CheckRtAlloc("al_malloc", size);
     alignment = std::max(alignment, alignof(std::max_align_t));
 
 #if defined(HAVE_POSIX_MEMALIGN)
@@ -50,6 +89,7 @@ void *al_calloc(size_t alignment, size_t size)
 
 void al_free(void *ptr) noexcept
 {
+    if(ptr) CheckRtAlloc("al_free", 0);
 #if defined(HAVE_POSIX_MEMALIGN)
     std::free(ptr);
 #elif defined(HAVE__ALIGNED_MALLOC)
@@ -59,3 +99,104 @@ void al_free(void *ptr) noexcept
         std::free(*(static_cast<void**>(ptr) - 1));
 #endif
 }
+
+
+#ifdef HAVE_SYS_MMAN_H
+namespace {
+
+/* The typical huge page size. Systems with larger huge pages will still have
+ * the mapping aligned to this, which can at least use smaller huge pages.
+ */
+constexpr size_t HugePageSize{2u * 1024u * 1024u};
+
+constexpr size_t RoundUp(const size_t value, const size_t step) noexcept
+{ return (value+step-1) / step * step; }
+
+size_t GetPageSize() noexcept
+{
+    static const size_t pagesize{[]() noexcept -> size_t
+    {
+        const long ret{sysconf(_SC_PAGESIZE)};
+        return (ret > 0) ? static_cast<size_t>(ret) : 4096u;
+    }()};
+    return pagesize;
+}
+
+void *MapPages(const size_t size, const int flags) noexcept
+{
+    void *ret{mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|flags, -1, 0)};
+    return (ret != MAP_FAILED) ? ret : nullptr;
+}
+
+} // namespace
+#endif
+
+al::page_buffer::page_buffer(const size_t size, const page_policy policy) : mSize{size}
+{
+    CheckRtAlloc("al::page_buffer", size);
+    if(size == 0) return;
+
+#ifdef HAVE_SYS_MMAN_H
+#ifdef MAP_HUGETLB
+    if(policy == page_policy::Explicit)
+    {
+        const size_t mapsize{RoundUp(size, HugePageSize)};
+        if(void *ptr{MapPages(mapsize, MAP_HUGETLB)})
+        {
+            mData = ptr;
+            mMapSize = mapsize;
+            return;
+        }
+    }
+#endif
+#ifdef MADV_HUGEPAGE
+    if(policy != page_policy::Normal)
+    {
+        /* Over-allocate to align the mapping to the huge page size, then
+         * unmap the excess from either side.
+         */
+        const size_t mapsize{RoundUp(size, HugePageSize)};
+        if(auto *ptr = static_cast<char*>(MapPages(mapsize + HugePageSize, 0)))
+        {
+            const auto addr = reinterpret_cast<uintptr_t>(ptr);
+            const size_t head{RoundUp(addr, HugePageSize) - addr};
+            if(head > 0) munmap(ptr, head);
+            munmap(ptr + head + mapsize, HugePageSize - head);
+
+            mData = ptr + head;
+            mMapSize = mapsize;
+            madvise(mData, mMapSize, MADV_HUGEPAGE);
+            return;
+        }
+    }
+#endif
+    const size_t mapsize{RoundUp(size, GetPageSize())};
+    if(void *ptr{MapPages(mapsize, 0)})
+    {
+        mData = ptr;
+        mMapSize = mapsize;
+        return;
+    }
+#else
+    (void)policy;
+#endif
+
+    mData = al_calloc(64, size);
+    if(!mData) throw std::bad_alloc();
+}
+
+void al::page_buffer::reset() noexcept
+{
+    if(!mData) return;
+    CheckRtAlloc("al::page_buffer", 0);
+
+#ifdef HAVE_SYS_MMAN_H
+    if(mMapSize > 0)
+        munmap(mData, mMapSize);
+    else
+#endif
+        al_free(mData);
+    mData = nullptr;
+    mSize = 0;
+    mMapSize = 0;
+}
@@ -19,6 +19,29 @@ void *al_malloc(size_t alignment, size_t size);
 [[gnu::alloc_align(1), gnu::alloc_size(2), gnu::malloc]]
 void *al_calloc(size_t alignment, size_t size);
 
+namespace al {
+
+/* Called when al_malloc (or al_calloc) or al_free is used on a thread marked
+ * as real-time, with the name of the function and the requested size (0 when
+ * freeing). Meant for debugging code that shouldn't touch the heap.
+ */
+using rt_alloc_handler = void(*)(const char *func, size_t size) noexcept;
+void set_rt_alloc_handler(rt_alloc_handler handler) noexcept;
+
+/* Marks the calling thread as real-time while in scope, so any heap use goes
+ * to the real-time allocation handler (if set).
+ */
+class rt_alloc_scope {
+public:
+    rt_alloc_scope() noexcept;
+    ~rt_alloc_scope();
+
+    rt_alloc_scope(const rt_alloc_scope&) = delete;
+    rt_alloc_scope& operator=(const rt_alloc_scope&) = delete;
+};
+
+} // namespace al
+
 
 #define DISABLE_ALLOC()                                                       \
     void *operator new(size_t) = delete;                                      \
@@ -108,6 +131,53 @@ template<typename T, std::size_t N, typename U, std::size_t M>
 constexpr bool operator!=(const allocator<T,N>&, const allocator<U,M>&) noexcept { return false; }
 
 
+/* How a page_buffer gets its memory pages. */
+enum class page_policy : unsigned char {
+    Normal,      /* Regular pages. */
+    Transparent, /* Regular pages, hinting the system to use huge pages. */
+    Explicit,    /* Reserved huge pages, falling back to Transparent. */
+};
+
+/* A zero-initialized block of memory allocated directly as whole pages, for
+ * large buffers accessed in real-time. The pages aren't touched until used, so
+ * the system can place them local to the thread that first uses them (e.g. on
+ * the same NUMA node). With huge pages, the size is rounded up to a multiple
+ * of the huge page size. Where pages can't be allocated directly, this falls
+ * back to al_calloc.
+ */
+class page_buffer {
+    void *mData{nullptr};
+    size_t mSize{0u};
+    size_t mMapSize{0u};
+
+public:
+    page_buffer() noexcept = default;
+    page_buffer(const size_t size, const page_policy policy);
+    page_buffer(page_buffer&& rhs) noexcept
+      : mData{std::exchange(rhs.mData, nullptr)}, mSize{std::exchange(rhs.mSize, 0u)}
+      , mMapSize{std::exchange(rhs.mMapSize, 0u)}
+    { }
+    ~page_buffer() { reset(); }
+
+    page_buffer& operator=(page_buffer&& rhs) noexcept
+    {
+        if(&rhs != this)
+        {
+            reset();
+            mData = std::exchange(rhs.mData, nullptr);
+            mSize = std::exchange(rhs.mSize, 0u);
+            mMapSize = std::exchange(rhs.mMapSize, 0u);
+        }
+        return *this;
+    }
+
+    void *data() const noexcept { return mData; }
+    size_t size() const noexcept { return mSize; }
+
+    void reset() noexcept;
+};
+
+
 template<typename T>
 constexpr T *to_address(T *p) noexcept
 {
@@ -7,11 +7,15 @@
 #include <arm_neon.h>
 #endif
 
+#include <algorithm>
 #include <array>
+#include <complex>
+#include <memory>
 #include <stddef.h>
 
 #include "alcomplex.h"
 #include "alspan.h"
+#include "vector.h"
 
 
 /* Implements a wide-band +90 degree phase-shift. Note that this should be
@@ -49,22 +53,31 @@ struct PhaseShifterT {
         constexpr size_t fft_size{FilterSize};
         constexpr size_t half_size{fft_size / 2};
 
-        auto fftBuffer = std::make_unique<complex_d[]>(fft_size);
-        std::fill_n(fftBuffer.get(), fft_size, complex_d{});
-        fftBuffer[half_size] = 1.0;
+        /* The real FFT packs each pair of samples into one complex value, so
+         * the dirac at sample half_size is the real part of value
+         * half_size/2.
+         */
+        auto fftBuffer = std::make_unique<complex_d[]>(half_size);
+        std::fill_n(fftBuffer.get(), half_size, complex_d{});
+        fftBuffer[half_size/2] = 1.0;
 
-        forward_fft(al::span{fftBuffer.get(), fft_size});
-        for(size_t i{0};i < half_size+1;++i)
+        forward_real_fft(al::span{fftBuffer.get(), half_size});
+        /* The DC and Nyquist bins are real, so the phase-shift leaves them
+         * purely imaginary with nothing for the real output.
+         */
+        fftBuffer[0] = complex_d{};
+        for(size_t i{1};i < half_size;++i)
             fftBuffer[i] = complex_d{-fftBuffer[i].imag(), fftBuffer[i].real()};
-        for(size_t i{half_size+1};i < fft_size;++i)
-            fftBuffer[i] = std::conj(fftBuffer[fft_size - i]);
-        inverse_fft(al::span{fftBuffer.get(), fft_size});
+        inverse_real_fft(al::span{fftBuffer.get(), half_size});
 
-        auto fftiter = fftBuffer.get() + half_size + (FilterSize/2 - 1);
+        /* Every odd sample (the imaginary part of each value) is used,
+         * starting from the last.
+         */
+        auto fftiter = fftBuffer.get() + half_size - 1;
         for(float &coeff : mCoeffs)
         {
-            coeff = static_cast<float>(fftiter->real() / double{fft_size});
-            fftiter -= 2;
+            coeff = static_cast<float>(fftiter->imag() / double{fft_size});
+            --fftiter;
         }
     }
 
@@ -211,4 +224,121 @@ inline void PhaseShifterT<S>::process(al::span<float> dst, const float *RESTRICT
 #endif
 }
 
+/* Applies the same phase-shift as PhaseShifterT, using FFT-based overlap-save
+ * convolution. The input is taken from the same history buffer the direct FIR
+ * reads from, so this doesn't add any latency or need any state of its own.
+ *
+ * The filter has FilterSize-1 taps (every other one being 0), so an FFT of M
+ * samples produces M-FilterSize+2 valid output samples. There's a stage for
+ * each power-of-two FFT size from 2*FilterSize up to what's needed for the
+ * given maximum block size (limited to MaxFftSize), and each call uses the
+ * smallest that covers the requested output.
+ */
+template<size_t FilterSize, size_t MaxFftSize=4096>
+class PhaseShifterFftT {
+    static constexpr size_t sMinFftSize{FilterSize * 2};
+    static_assert(MaxFftSize >= sMinFftSize, "MaxFftSize needs to be at least 2*FilterSize");
+    static_assert((MaxFftSize&(MaxFftSize-1)) == 0, "MaxFftSize needs to be power-of-two");
+
+    struct Stage {
+        size_t mFftSize;
+        FftPlan<float> mFft;
+        /* Frequency response of the (reversed) filter, packed as described by
+         * real_fft, and prescaled to normalize the inverse transform.
+         */
+        al::vector<std::complex<float>,16> mFilter;
+    };
+    al::vector<Stage> mStages;
+
+public:
+    PhaseShifterFftT(const PhaseShifterT<FilterSize> &pshift, const size_t maxBlockSize)
+    {
+        size_t maxsize{sMinFftSize};
+        while(maxsize < maxBlockSize+FilterSize && maxsize < MaxFftSize)
+            maxsize <<= 1;
+
+        auto fftBuffer = std::make_unique<std::complex<double>[]>(maxsize/2);
+        for(size_t fftsize{sMinFftSize};fftsize <= maxsize;fftsize <<= 1)
+        {
+            /* The convolution filter is the time-reversed phase-shift filter,
+             * whose non-0 coefficients land on even samples (the real part of
+             * each packed value).
+             */
+            const size_t half_size{fftsize / 2};
+            std::fill_n(fftBuffer.get(), half_size, std::complex<double>{});
+            for(size_t i{0};i < pshift.mCoeffs.size();++i)
+                fftBuffer[i] = pshift.mCoeffs[pshift.mCoeffs.size()-1 - i];
+            forward_real_fft(al::span{fftBuffer.get(), half_size});
+
+            Stage &stage = mStages.emplace_back(Stage{fftsize, FftPlan<float>{half_size}, {}});
+            stage.mFilter.resize(half_size);
+            const double scale{1.0 / static_cast<double>(fftsize)};
+            for(size_t i{0};i < half_size;++i)
+                stage.mFilter[i] = std::complex<float>{fftBuffer[i] * scale};
+        }
+    }
+
+    void process(al::span<float> dst, const float *RESTRICT src) const;
+};
+
+/* Not inline, it's too large to be worth expanding in each caller. */
+template<size_t FilterSize, size_t MaxFftSize>
+void PhaseShifterFftT<FilterSize,MaxFftSize>::process(al::span<float> dst,
+    const float *RESTRICT src) const
+{
+    static constexpr size_t N{FilterSize};
+    alignas(16) std::array<std::complex<float>,MaxFftSize/2> fftBuffer;
+
+    while(!dst.empty())
+    {
+        auto stage = std::find_if(mStages.cbegin(), mStages.cend(),
+            [todo=dst.size()](const Stage &s) noexcept { return s.mFftSize-N+2 >= todo; });
+        if(stage == mStages.cend()) stage = mStages.cend()-1;
+
+        const size_t half_size{stage->mFftSize / 2};
+        const size_t todo{std::min(dst.size(), stage->mFftSize-N+2)};
+        const al::span<std::complex<float>> buffer{fftBuffer.data(), half_size};
+
+        /* Only the input samples needed for the valid output are loaded, the
+         * rest are silent (they'd only affect the samples that get discarded).
+         */
+        const size_t insamples{todo + N-2};
+        for(size_t i{0};i < insamples/2;++i)
+            buffer[i] = std::complex<float>{src[i*2], src[i*2 + 1]};
+        auto bufiter = buffer.begin() + insamples/2;
+        if((insamples&1))
+            *(bufiter++) = std::complex<float>{src[insamples-1], 0.0f};
+        std::fill(bufiter, buffer.end(), std::complex<float>{});
+
+        stage->mFft.forwardReal(buffer);
+
+        /* The DC and Nyquist bins are packed together and purely real. */
+        const std::complex<float> *RESTRICT filter{stage->mFilter.data()};
+        buffer[0] = std::complex<float>{buffer[0].real()*filter[0].real(),
+            buffer[0].imag()*filter[0].imag()};
+        for(size_t i{1};i < half_size;++i)
+        {
+            const float re{buffer[i].real()*filter[i].real() - buffer[i].imag()*filter[i].imag()};
+            const float im{buffer[i].real()*filter[i].imag() + buffer[i].imag()*filter[i].real()};
+            buffer[i] = std::complex<float>{re, im};
+        }
+
+        stage->mFft.inverseReal(buffer);
+
+        /* The first N-2 output samples wrapped around and are discarded. */
+        auto outiter = buffer.cbegin() + (N-2)/2;
+        for(size_t i{0};i < (todo&~size_t{1});i+=2)
+        {
+            dst[i] = outiter->real();
+            dst[i+1] = outiter->imag();
+            ++outiter;
+        }
+        if((todo&1))
+            dst[todo-1] = outiter->real();
+
+        dst = dst.subspan(todo);
+        src += todo;
+    }
+}
+
 #endif /* PHASE_SHIFTER_H */
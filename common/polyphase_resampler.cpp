@@ -169,7 +169,7 @@ void PPhaseResampler::init(const uint srcRate, const uint dstRate)
 
 // Perform the upsample-filter-downsample resampling operation using a
 // polyphase filter implementation.
-void PPhaseResampler::process(const uint inN, const double *in, const uint outN, double *out)
+void PPhaseResampler::process(const uint inN, const double *in, const uint outN, double *out) const
 {
     if(outN == 0) UNLIKELY
         return;
@@ -220,3 +220,57 @@ void PPhaseResampler::process(const uint inN, const double *in, const uint outN,
     if(work != out)
         std::copy_n(work, outN, out);
 }
+
+
+bool PPhaseTable::init(const uint srcRate, const uint dstRate, const uint maxPhases,
+    const uint maxTaps)
+{
+    const uint gcd{Gcd(srcRate, dstRate)};
+    const uint p{dstRate / gcd};
+    const uint q{srcRate / gcd};
+    if(p > maxPhases)
+        return false;
+
+    /* Use the same rejection and transition width as the 24-point bsinc
+     * resampler (a 23rd order Kaiser window at -60dB), with the transition
+     * band ending at the lower rate's nyquist. Unlike the upsample-filter-
+     * downsample view, the frequencies here are normalized to the input rate.
+     */
+    static constexpr double Rejection{60.0};
+    static constexpr double Transition{(Rejection - 7.95) / (2.285 * 2.0*al::numbers::pi * 23.0)};
+    const double scale{(p < q) ? static_cast<double>(p)/q : 1.0};
+    const double width{Transition * scale};
+    const double cutoff{(0.5 - Transition*0.5) * scale};
+
+    const uint taps{(CalcKaiserOrder(Rejection, width) + 1 + 3) & ~3u};
+    if(taps > maxTaps)
+        return false;
+
+    const double beta{CalcKaiserBeta(Rejection)};
+    const double halfwidth{taps * 0.5};
+    const uint l{taps/2 - 1};
+
+    mP = p;
+    mQ = q;
+    mTaps = taps;
+    mFilter.resize(size_t{p} * taps);
+    std::vector<double> coeffs(taps);
+    for(uint phase{0};phase < p;++phase)
+    {
+        float *filter{&mFilter[size_t{phase} * taps]};
+
+        /* Each phase is normalized for unity gain at DC, so the response
+         * doesn't ripple between phases.
+         */
+        double sum{0.0};
+        for(uint i{0};i < taps;++i)
+        {
+            const double x{static_cast<double>(i) - l - static_cast<double>(phase)/p};
+            coeffs[i] = Kaiser(beta, x / halfwidth) * 2.0 * cutoff * Sinc(2.0 * cutoff * x);
+            sum += coeffs[i];
+        }
+        for(uint i{0};i < taps;++i)
+            filter[i] = static_cast<float>(coeffs[i] / sum);
+    }
+    return true;
+}
@@ -3,6 +3,8 @@
 
 #include <vector>
 
+#include "vector.h"
+
 
 using uint = unsigned int;
 
@@ -35,7 +37,7 @@ using uint = unsigned int;
 
 struct PPhaseResampler {
     void init(const uint srcRate, const uint dstRate);
-    void process(const uint inN, const double *in, const uint outN, double *out);
+    void process(const uint inN, const double *in, const uint outN, double *out) const;
 
     explicit operator bool() const noexcept { return !mF.empty(); }
 
@@ -44,4 +46,27 @@ private:
     std::vector<double> mF;
 };
 
+
+/* A table of polyphase filters for streaming resampling in real-time, between
+ * two rates with an exact ratio of P/Q (in lowest terms). Each of the P phases
+ * has its own set of taps, for an output sample that lies phase/P past an
+ * input sample, so nothing needs to be interpolated while resampling. Compared
+ * to PPhaseResampler, the filter has a much lower stop-band rejection and a
+ * wider transition band, to keep the number of taps down.
+ *
+ * The taps of a phase apply to the input samples starting at (taps/2 - 1)
+ * before the output sample's position.
+ */
+struct PPhaseTable {
+    uint mP{}, mQ{};
+    /* The number of taps for each phase. A multiple of 4. */
+    uint mTaps{};
+    al::vector<float,16> mFilter;
+
+    /* Builds the table for the given rates, failing if it needs more than
+     * maxPhases phases or maxTaps taps per phase.
+     */
+    bool init(const uint srcRate, const uint dstRate, const uint maxPhases, const uint maxTaps);
+};
+
 #endif /* POLYPHASE_RESAMPLER_H */
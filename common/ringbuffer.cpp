@@ -59,18 +59,21 @@ RingBufferPtr RingBuffer::Create(std::size_t sz, std::size_t elem_sz, int limit_
 void RingBuffer::reset() noexcept
 {
     mWritePtr.store(0, std::memory_order_relaxed);
+    mWriterReadPtr.store(0, std::memory_order_relaxed);
     mReadPtr.store(0, std::memory_order_relaxed);
+    mReaderWritePtr.store(0, std::memory_order_relaxed);
     std::fill_n(mBuffer.begin(), (mSizeMask+1)*mElemSize, std::byte{});
 }
 
 
 std::size_t RingBuffer::read(void *dest, std::size_t cnt) noexcept
 {
-    const std::size_t free_cnt{readSpace()};
+    const std::size_t r{mReadPtr.load(std::memory_order_relaxed)};
+    const std::size_t free_cnt{readerSpace(r, cnt)};
     if(free_cnt == 0) return 0;
 
     const std::size_t to_read{std::min(cnt, free_cnt)};
-    std::size_t read_ptr{mReadPtr.load(std::memory_order_relaxed) & mSizeMask};
+    std::size_t read_ptr{r & mSizeMask};
 
     std::size_t n1, n2;
     const std::size_t cnt2{read_ptr + to_read};
@@ -99,11 +102,12 @@ std::size_t RingBuffer::read(void *dest, std::size_t cnt) noexcept
 
 std::size_t RingBuffer::peek(void *dest, std::size_t cnt) const noexcept
 {
-    const std::size_t free_cnt{readSpace()};
+    const std::size_t r{mReadPtr.load(std::memory_order_relaxed)};
+    const std::size_t free_cnt{readerSpace(r, cnt)};
     if(free_cnt == 0) return 0;
 
     const std::size_t to_read{std::min(cnt, free_cnt)};
-    std::size_t read_ptr{mReadPtr.load(std::memory_order_relaxed) & mSizeMask};
+    std::size_t read_ptr{r & mSizeMask};
 
     std::size_t n1, n2;
     const std::size_t cnt2{read_ptr + to_read};
@@ -127,11 +131,12 @@ std::size_t RingBuffer::peek(void *dest, std::size_t cnt) const noexcept
 
 std::size_t RingBuffer::write(const void *src, std::size_t cnt) noexcept
 {
-    const std::size_t free_cnt{writeSpace()};
+    const std::size_t w{mWritePtr.load(std::memory_order_relaxed)};
+    const std::size_t free_cnt{writerSpace(w, cnt)};
     if(free_cnt == 0) return 0;
 
     const std::size_t to_write{std::min(cnt, free_cnt)};
-    std::size_t write_ptr{mWritePtr.load(std::memory_order_relaxed) & mSizeMask};
+    std::size_t write_ptr{w & mSizeMask};
 
     std::size_t n1, n2;
     const std::size_t cnt2{write_ptr + to_write};
@@ -163,11 +168,12 @@ auto RingBuffer::getReadVector() const noexcept -> DataPair
 {
     DataPair ret;
 
-    std::size_t w{mWritePtr.load(std::memory_order_acquire)};
-    std::size_t r{mReadPtr.load(std::memory_order_acquire)};
-    w &= mSizeMask;
+    /* The caller wants everything that's readable, so always check for more
+     * than what was last seen.
+     */
+    std::size_t r{mReadPtr.load(std::memory_order_relaxed)};
+    const std::size_t free_cnt{readerSpace(r, mSizeMask+1)};
     r &= mSizeMask;
-    const std::size_t free_cnt{(w-r) & mSizeMask};
 
     const std::size_t cnt2{r + free_cnt};
     if(cnt2 > mSizeMask+1)
@@ -195,11 +201,9 @@ auto RingBuffer::getWriteVector() const noexcept -> DataPair
 {
     DataPair ret;
 
-    std::size_t w{mWritePtr.load(std::memory_order_acquire)};
-    std::size_t r{mReadPtr.load(std::memory_order_acquire) + mWriteSize - mSizeMask};
+    std::size_t w{mWritePtr.load(std::memory_order_relaxed)};
+    const std::size_t free_cnt{writerSpace(w, mSizeMask+1)};
     w &= mSizeMask;
-    r &= mSizeMask;
-    const std::size_t free_cnt{(r-w-1) & mSizeMask};
 
     const std::size_t cnt2{w + free_cnt};
     if(cnt2 > mSizeMask+1)
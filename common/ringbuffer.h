@@ -17,14 +17,52 @@
 
 struct RingBuffer {
 private:
-    std::atomic<std::size_t> mWritePtr{0u};
-    std::atomic<std::size_t> mReadPtr{0u};
-    std::size_t mWriteSize{0u};
+    /* The write and read pointers are kept on separate cache lines, so the
+     * writer and reader don't keep taking the line from each other. Each side
+     * also keeps a copy of the other side's pointer from when it last looked,
+     * only reloading it when the copy doesn't show enough space. The copies
+     * are only touched by their owning side, so relaxed access is enough.
+     */
+    alignas(64) std::atomic<std::size_t> mWritePtr{0u};
+    mutable std::atomic<std::size_t> mWriterReadPtr{0u};
+    alignas(64) std::atomic<std::size_t> mReadPtr{0u};
+    mutable std::atomic<std::size_t> mReaderWritePtr{0u};
+
+    alignas(64) std::size_t mWriteSize{0u};
     std::size_t mSizeMask{0u};
     std::size_t mElemSize{0u};
 
     al::FlexArray<std::byte, 16> mBuffer;
 
+    /* Returns the number of elements the reader can read, given its own read
+     * pointer, reloading the write pointer if the cached copy shows fewer than
+     * `needed'.
+     */
+    std::size_t readerSpace(const std::size_t r, const std::size_t needed) const noexcept
+    {
+        std::size_t w{mReaderWritePtr.load(std::memory_order_relaxed)};
+        if(((w-r) & mSizeMask) < needed)
+        {
+            w = mWritePtr.load(std::memory_order_acquire);
+            mReaderWritePtr.store(w, std::memory_order_relaxed);
+        }
+        return (w-r) & mSizeMask;
+    }
+    /* Returns the number of elements the writer can write, given its own
+     * write pointer, reloading the read pointer if the cached copy shows fewer
+     * than `needed'.
+     */
+    std::size_t writerSpace(const std::size_t w, const std::size_t needed) const noexcept
+    {
+        std::size_t r{mWriterReadPtr.load(std::memory_order_relaxed)};
+        if(((r+mWriteSize-mSizeMask - w - 1) & mSizeMask) < needed)
+        {
+            r = mReadPtr.load(std::memory_order_acquire);
+            mWriterReadPtr.store(r, std::memory_order_relaxed);
+        }
+        return (r+mWriteSize-mSizeMask - w - 1) & mSizeMask;
+    }
+
 public:
     struct Data {
         std::byte *buf;
@@ -74,7 +112,13 @@ public:
     std::size_t peek(void *dest, std::size_t cnt) const noexcept;
     /** Advance the read pointer `cnt' places. */
     void readAdvance(std::size_t cnt) noexcept
-    { mReadPtr.fetch_add(cnt, std::memory_order_acq_rel); }
+    {
+        /* Only the reader changes the read pointer, so this doesn't need an
+         * atomic read-modify-write.
+         */
+        const std::size_t r{mReadPtr.load(std::memory_order_relaxed)};
+        mReadPtr.store(r+cnt, std::memory_order_release);
+    }
 
 
     /**
@@ -95,10 +139,16 @@ public:
     std::size_t write(const void *src, std::size_t cnt) noexcept;
     /** Advance the write pointer `cnt' places. */
     void writeAdvance(std::size_t cnt) noexcept
-    { mWritePtr.fetch_add(cnt, std::memory_order_acq_rel); }
+    {
+        const std::size_t w{mWritePtr.load(std::memory_order_relaxed)};
+        mWritePtr.store(w+cnt, std::memory_order_release);
+    }
 
     std::size_t getElemSize() const noexcept { return mElemSize; }
 
+    /** The total bytes allocated for the ring buffer. */
+    std::size_t memoryUsage() const noexcept { return Sizeof(mBuffer.size()); }
+
     /**
      * Create a new ringbuffer to hold at least `sz' elements of `elem_sz'
      * bytes. The number of elements is rounded up to the next power of two
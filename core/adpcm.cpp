@@ -0,0 +1,419 @@
+#include "config.h"
+
+#include "adpcm.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+
+#include "alnumeric.h"
+#include "alspan.h"
+#include "opthelpers.h"
+
+
+namespace {
+
+/* IMA ADPCM Stepsize table */
+constexpr int IMAStep_size[89] = {
+       7,    8,    9,   10,   11,   12,   13,   14,   16,   17,   19,
+      21,   23,   25,   28,   31,   34,   37,   41,   45,   50,   55,
+      60,   66,   73,   80,   88,   97,  107,  118,  130,  143,  157,
+     173,  190,  209,  230,  253,  279,  307,  337,  371,  408,  449,
+     494,  544,  598,  658,  724,  796,  876,  963, 1060, 1166, 1282,
+    1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660,
+    4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493,10442,
+   11487,12635,13899,15289,16818,18500,20350,22358,24633,27086,29794,
+   32767
+};
+
+/* IMA4 ADPCM Codeword decode table */
+constexpr int IMA4Codeword[16] = {
+    1, 3, 5, 7, 9, 11, 13, 15,
+   -1,-3,-5,-7,-9,-11,-13,-15,
+};
+
+/* IMA4 ADPCM Step index adjust decode table */
+constexpr int IMA4Index_adjust[16] = {
+   -1,-1,-1,-1, 2, 4, 6, 8,
+   -1,-1,-1,-1, 2, 4, 6, 8
+};
+
+/* MSADPCM Adaption table */
+constexpr int MSADPCMAdaption[16] = {
+    230, 230, 230, 230, 307, 409, 512, 614,
+    768, 614, 512, 409, 307, 230, 230, 230
+};
+
+/* MSADPCM Adaption Coefficient tables */
+constexpr int MSADPCMAdaptionCoeff[7][2] = {
+    { 256,    0 },
+    { 512, -256 },
+    {   0,    0 },
+    { 192,   64 },
+    { 240,    0 },
+    { 460, -208 },
+    { 392, -232 }
+};
+
+constexpr int MaxStepIndex{static_cast<int>(std::size(IMAStep_size)) - 1};
+
+/* IMA4 sample deltas and next step indices for each step index and nibble, so
+ * decoding a sample only needs two lookups.
+ */
+struct Ima4DecodeTables {
+    std::array<std::array<int,16>,std::size(IMAStep_size)> mDelta{};
+    std::array<std::array<uint8_t,16>,std::size(IMAStep_size)> mNextIndex{};
+};
+constexpr Ima4DecodeTables GenerateIma4Tables() noexcept
+{
+    Ima4DecodeTables ret{};
+    for(size_t index{0};index < std::size(IMAStep_size);++index)
+    {
+        for(size_t nibble{0};nibble < 16;++nibble)
+        {
+            ret.mDelta[index][nibble] = IMA4Codeword[nibble] * IMAStep_size[index] / 8;
+            const int next{static_cast<int>(index) + IMA4Index_adjust[nibble]};
+            ret.mNextIndex[index][nibble] = static_cast<uint8_t>(
+                std::min(std::max(next, 0), MaxStepIndex));
+        }
+    }
+    return ret;
+}
+constexpr Ima4DecodeTables gIma4Tables{GenerateIma4Tables()};
+
+/* The number of whole blocks decoded together. Each block's decoder state is
+ * independent, so interleaving the blocks gives the CPU several dependency
+ * chains to work on instead of one long one.
+ */
+constexpr size_t NumLanes{4};
+
+
+/* Decodes numBlocks whole IMA4 blocks of one channel, writing samplesPerBlock
+ * samples for each.
+ */
+void DecodeIma4Blocks(float *RESTRICT dstSamples, const std::byte *src, const size_t srcChan,
+    const size_t srcStep, const size_t samplesPerBlock, const size_t numBlocks) noexcept
+{
+    const size_t blockBytes{((samplesPerBlock-1)/2 + 4)*srcStep};
+
+    for(size_t base{0};base < numBlocks;base += NumLanes)
+    {
+        std::array<const std::byte*,NumLanes> nibbleData{};
+        std::array<float*,NumLanes> output{};
+        std::array<int,NumLanes> sample{};
+        std::array<size_t,NumLanes> index{};
+
+        /* Lanes without a block of their own repeat the first block, writing
+         * the same output.
+         */
+        for(size_t l{0};l < NumLanes;++l)
+        {
+            const size_t block{(base+l < numBlocks) ? base+l : base};
+            const std::byte *input{src + block*blockBytes};
+
+            const int s{int(input[srcChan*4]) | (int(input[srcChan*4 + 1]) << 8)};
+            const int idx{int(input[srcChan*4 + 2]) | (int(input[srcChan*4 + 3]) << 8)};
+            sample[l] = (s^0x8000) - 32768;
+            index[l] = static_cast<size_t>(clampi((idx^0x8000) - 32768, 0, MaxStepIndex));
+
+            nibbleData[l] = input + (srcStep+srcChan)*4;
+            output[l] = dstSamples + block*samplesPerBlock;
+            output[l][0] = static_cast<float>(sample[l]) / 32768.0f;
+        }
+
+        for(size_t i{1};i < samplesPerBlock;++i)
+        {
+            const size_t nibbleOffset{i - 1};
+            const size_t byteShift{(nibbleOffset&1) * 4};
+            const size_t wordOffset{(nibbleOffset>>1) & ~size_t{3}};
+            const size_t byteOffset{wordOffset*srcStep + ((nibbleOffset>>1)&3u)};
+
+            for(size_t l{0};l < NumLanes;++l)
+            {
+                const uint nibble{uint(nibbleData[l][byteOffset]>>byteShift) & 15u};
+
+                sample[l] += gIma4Tables.mDelta[index[l]][nibble];
+                sample[l] = clampi(sample[l], -32768, 32767);
+                index[l] = gIma4Tables.mNextIndex[index[l]][nibble];
+
+                output[l][i] = static_cast<float>(sample[l]) / 32768.0f;
+            }
+        }
+    }
+}
+
+/* Same as DecodeIma4Blocks, for MS ADPCM blocks. */
+void DecodeMsAdpcmBlocks(float *RESTRICT dstSamples, const std::byte *src, const size_t srcChan,
+    const size_t srcStep, const size_t samplesPerBlock, const size_t numBlocks) noexcept
+{
+    const size_t blockBytes{((samplesPerBlock-2)/2 + 7)*srcStep};
+
+    for(size_t base{0};base < numBlocks;base += NumLanes)
+    {
+        std::array<const std::byte*,NumLanes> nibbleData{};
+        std::array<float*,NumLanes> output{};
+        std::array<std::array<int,2>,NumLanes> coeffs{};
+        std::array<std::array<int,2>,NumLanes> sampleHistory{};
+        std::array<int,NumLanes> delta{};
+
+        for(size_t l{0};l < NumLanes;++l)
+        {
+            const size_t block{(base+l < numBlocks) ? base+l : base};
+            const std::byte *input{src + block*blockBytes};
+
+            const uint8_t blockpred{std::min(uint8_t(input[srcChan]), uint8_t{6})};
+            input += srcStep;
+            const int d{int(input[2*srcChan + 0]) | (int(input[2*srcChan + 1]) << 8)};
+            input += srcStep*2;
+            const int s0{int(input[2*srcChan + 0]) | (int(input[2*srcChan + 1]) << 8)};
+            input += srcStep*2;
+            const int s1{int(input[2*srcChan + 0]) | (int(input[2*srcChan + 1]) << 8)};
+            input += srcStep*2;
+
+            coeffs[l] = {MSADPCMAdaptionCoeff[blockpred][0], MSADPCMAdaptionCoeff[blockpred][1]};
+            delta[l] = (d^0x8000) - 32768;
+            sampleHistory[l] = {(s0^0x8000) - 32768, (s1^0x8000) - 32768};
+
+            nibbleData[l] = input;
+            output[l] = dstSamples + block*samplesPerBlock;
+            output[l][0] = static_cast<float>(sampleHistory[l][1]) / 32768.0f;
+            output[l][1] = static_cast<float>(sampleHistory[l][0]) / 32768.0f;
+        }
+
+        size_t nibbleOffset{srcChan};
+        for(size_t i{2};i < samplesPerBlock;++i)
+        {
+            const size_t byteOffset{nibbleOffset>>1};
+            const size_t byteShift{((nibbleOffset&1)^1) * 4};
+            nibbleOffset += srcStep;
+
+            for(size_t l{0};l < NumLanes;++l)
+            {
+                const int nibble{int(nibbleData[l][byteOffset]>>byteShift) & 15};
+
+                int pred{(sampleHistory[l][0]*coeffs[l][0] + sampleHistory[l][1]*coeffs[l][1])
+                    / 256};
+                pred += ((nibble^0x08) - 0x08) * delta[l];
+                pred  = clampi(pred, -32768, 32767);
+
+                sampleHistory[l][1] = sampleHistory[l][0];
+                sampleHistory[l][0] = pred;
+
+                delta[l] = (MSADPCMAdaption[nibble] * delta[l]) / 256;
+                delta[l] = maxi(16, delta[l]);
+
+                output[l][i] = static_cast<float>(pred) / 32768.0f;
+            }
+        }
+    }
+}
+
+} // namespace
+
+void DecodeIma4Samples(float *RESTRICT dstSamples, const std::byte *src, const size_t srcChan,
+    const size_t srcOffset, const size_t srcStep, const size_t samplesPerBlock,
+    const size_t samplesToLoad) noexcept
+{
+    const size_t blockBytes{((samplesPerBlock-1)/2 + 4)*srcStep};
+
+    /* Skip to the ADPCM block containing the srcOffset sample. */
+    src += srcOffset/samplesPerBlock*blockBytes;
+    /* Calculate how many samples need to be skipped in the block. */
+    size_t skip{srcOffset % samplesPerBlock};
+
+    size_t wrote{0};
+    do {
+        /* Whole blocks that fit in the output can be decoded together. */
+        if(const size_t numBlocks{(samplesToLoad-wrote) / samplesPerBlock};
+            skip == 0 && numBlocks > 1)
+        {
+            DecodeIma4Blocks(dstSamples+wrote, src, srcChan, srcStep, samplesPerBlock,
+                numBlocks);
+            wrote += numBlocks*samplesPerBlock;
+            if(wrote == samplesToLoad)
+                return;
+            src += numBlocks*blockBytes;
+        }
+
+        /* Each IMA4 block starts with a signed 16-bit sample, and a signed
+         * 16-bit table index. The table index needs to be clamped.
+         */
+        int sample{int(src[srcChan*4]) | (int(src[srcChan*4 + 1]) << 8)};
+        const int idx{int(src[srcChan*4 + 2]) | (int(src[srcChan*4 + 3]) << 8)};
+
+        sample = (sample^0x8000) - 32768;
+        size_t index{static_cast<size_t>(clampi((idx^0x8000) - 32768, 0, MaxStepIndex))};
+
+        if(skip == 0)
+        {
+            dstSamples[wrote++] = static_cast<float>(sample) / 32768.0f;
+            if(wrote == samplesToLoad) return;
+        }
+        else
+            --skip;
+
+        auto decode_sample = [&sample,&index](const uint nibble)
+        {
+            sample += gIma4Tables.mDelta[index][nibble];
+            sample = clampi(sample, -32768, 32767);
+            index = gIma4Tables.mNextIndex[index][nibble];
+
+            return sample;
+        };
+
+        /* The rest of the block is arranged as a series of nibbles, contained
+         * in 4 *bytes* per channel interleaved. So every 8 nibbles we need to
+         * skip 4 bytes per channel to get the next nibbles for this channel.
+         *
+         * First, decode the samples that we need to skip in the block (will
+         * always be less than the block size). They need to be decoded despite
+         * being ignored for proper state on the remaining samples.
+         */
+        const std::byte *nibbleData{src + (srcStep+srcChan)*4};
+        size_t nibbleOffset{0};
+        const size_t startOffset{skip + 1};
+        for(;skip;--skip)
+        {
+            const size_t byteShift{(nibbleOffset&1) * 4};
+            const size_t wordOffset{(nibbleOffset>>1) & ~size_t{3}};
+            const size_t byteOffset{wordOffset*srcStep + ((nibbleOffset>>1)&3u)};
+            ++nibbleOffset;
+
+            std::ignore = decode_sample(uint(nibbleData[byteOffset]>>byteShift) & 15u);
+        }
+
+        /* Second, decode the rest of the block and write to the output, until
+         * the end of the block or the end of output.
+         */
+        const size_t todo{minz(samplesPerBlock-startOffset, samplesToLoad-wrote)};
+        for(size_t i{0};i < todo;++i)
+        {
+            const size_t byteShift{(nibbleOffset&1) * 4};
+            const size_t wordOffset{(nibbleOffset>>1) & ~size_t{3}};
+            const size_t byteOffset{wordOffset*srcStep + ((nibbleOffset>>1)&3u)};
+            ++nibbleOffset;
+
+            const int result{decode_sample(uint(nibbleData[byteOffset]>>byteShift) & 15u)};
+            dstSamples[wrote++] = static_cast<float>(result) / 32768.0f;
+        }
+        if(wrote == samplesToLoad)
+            return;
+
+        src += blockBytes;
+    } while(true);
+}
+
+void DecodeMsAdpcmSamples(float *RESTRICT dstSamples, const std::byte *src, const size_t srcChan,
+    const size_t srcOffset, const size_t srcStep, const size_t samplesPerBlock,
+    const size_t samplesToLoad) noexcept
+{
+    const size_t blockBytes{((samplesPerBlock-2)/2 + 7)*srcStep};
+
+    src += srcOffset/samplesPerBlock*blockBytes;
+    size_t skip{srcOffset % samplesPerBlock};
+
+    size_t wrote{0};
+    do {
+        if(const size_t numBlocks{(samplesToLoad-wrote) / samplesPerBlock};
+            skip == 0 && numBlocks > 1)
+        {
+            DecodeMsAdpcmBlocks(dstSamples+wrote, src, srcChan, srcStep, samplesPerBlock,
+                numBlocks);
+            wrote += numBlocks*samplesPerBlock;
+            if(wrote == samplesToLoad)
+                return;
+            src += numBlocks*blockBytes;
+        }
+
+        /* Each MS ADPCM block starts with an 8-bit block predictor, used to
+         * dictate how the two sample history values are mixed with the decoded
+         * sample, and an initial signed 16-bit delta value which scales the
+         * nibble sample value. This is followed by the two initial 16-bit
+         * sample history values.
+         */
+        const std::byte *input{src};
+        const uint8_t blockpred{std::min(uint8_t(input[srcChan]), uint8_t{6})};
+        input += srcStep;
+        int delta{int(input[2*srcChan + 0]) | (int(input[2*srcChan + 1]) << 8)};
+        input += srcStep*2;
+
+        int sampleHistory[2]{};
+        sampleHistory[0] = int(input[2*srcChan + 0]) | (int(input[2*srcChan + 1])<<8);
+        input += srcStep*2;
+        sampleHistory[1] = int(input[2*srcChan + 0]) | (int(input[2*srcChan + 1])<<8);
+        input += srcStep*2;
+
+        const al::span coeffs{MSADPCMAdaptionCoeff[blockpred]};
+        delta = (delta^0x8000) - 32768;
+        sampleHistory[0] = (sampleHistory[0]^0x8000) - 32768;
+        sampleHistory[1] = (sampleHistory[1]^0x8000) - 32768;
+
+        /* The second history sample is "older", so it's the first to be
+         * written out.
+         */
+        if(skip == 0)
+        {
+            dstSamples[wrote++] = static_cast<float>(sampleHistory[1]) / 32768.0f;
+            if(wrote == samplesToLoad) return;
+            dstSamples[wrote++] = static_cast<float>(sampleHistory[0]) / 32768.0f;
+            if(wrote == samplesToLoad) return;
+        }
+        else if(skip == 1)
+        {
+            --skip;
+            dstSamples[wrote++] = static_cast<float>(sampleHistory[0]) / 32768.0f;
+            if(wrote == samplesToLoad) return;
+        }
+        else
+            skip -= 2;
+
+        auto decode_sample = [&sampleHistory,&delta,coeffs](const int nibble)
+        {
+            int pred{(sampleHistory[0]*coeffs[0] + sampleHistory[1]*coeffs[1]) / 256};
+            pred += ((nibble^0x08) - 0x08) * delta;
+            pred  = clampi(pred, -32768, 32767);
+
+            sampleHistory[1] = sampleHistory[0];
+            sampleHistory[0] = pred;
+
+            delta = (MSADPCMAdaption[nibble] * delta) / 256;
+            delta = maxi(16, delta);
+
+            return pred;
+        };
+
+        /* The rest of the block is a series of nibbles, interleaved per-
+         * channel. First, skip samples.
+         */
+        const size_t startOffset{skip + 2};
+        size_t nibbleOffset{srcChan};
+        for(;skip;--skip)
+        {
+            const size_t byteOffset{nibbleOffset>>1};
+            const size_t byteShift{((nibbleOffset&1)^1) * 4};
+            nibbleOffset += srcStep;
+
+            std::ignore = decode_sample(int(input[byteOffset]>>byteShift) & 15);
+        }
+
+        /* Now decode the rest of the block, until the end of the block or the
+         * dst buffer is filled.
+         */
+        const size_t todo{minz(samplesPerBlock-startOffset, samplesToLoad-wrote)};
+        for(size_t j{0};j < todo;++j)
+        {
+            const size_t byteOffset{nibbleOffset>>1};
+            const size_t byteShift{((nibbleOffset&1)^1) * 4};
+            nibbleOffset += srcStep;
+
+            const int sample{decode_sample(int(input[byteOffset]>>byteShift) & 15)};
+            dstSamples[wrote++] = static_cast<float>(sample) / 32768.0f;
+        }
+        if(wrote == samplesToLoad)
+            return;
+
+        src += blockBytes;
+    } while(true);
+}
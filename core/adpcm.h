@@ -0,0 +1,21 @@
+#ifndef CORE_ADPCM_H
+#define CORE_ADPCM_H
+
+#include <cstddef>
+
+
+/**
+ * Decodes samplesToLoad samples of one channel from IMA4 ADPCM blocks, with
+ * srcStep channels, starting at sample srcOffset. Whole blocks are decoded
+ * several at a time in separate lanes, as each block's state is independent.
+ */
+void DecodeIma4Samples(float *dstSamples, const std::byte *src, const size_t srcChan,
+    const size_t srcOffset, const size_t srcStep, const size_t samplesPerBlock,
+    const size_t samplesToLoad) noexcept;
+
+/** Same as DecodeIma4Samples, for MS ADPCM blocks. */
+void DecodeMsAdpcmSamples(float *dstSamples, const std::byte *src, const size_t srcChan,
+    const size_t srcOffset, const size_t srcStep, const size_t samplesPerBlock,
+    const size_t samplesToLoad) noexcept;
+
+#endif /* CORE_ADPCM_H */
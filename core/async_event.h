@@ -1,6 +1,7 @@
 #ifndef CORE_EVENT_H
 #define CORE_EVENT_H
 
+#include <chrono>
 #include <stdint.h>
 #include <variant>
 
@@ -15,6 +16,8 @@ enum class AsyncEnableBits : uint8_t {
     SourceState,
     BufferCompleted,
     Disconnected,
+    BufferLoaded,
+    QueueLowWatermark,
     Count
 };
 
@@ -28,18 +31,37 @@ enum class AsyncSrcState : uint8_t {
 
 using AsyncKillThread = std::monostate;
 
+/* The mTime fields hold the device clock time of the update that generated
+ * the event.
+ */
 struct AsyncSourceStateEvent {
     uint mId;
     AsyncSrcState mState;
+    std::chrono::nanoseconds mTime;
 };
 
 struct AsyncBufferCompleteEvent {
     uint mId;
     uint mCount;
+    std::chrono::nanoseconds mTime;
+};
+
+struct AsyncQueueLowEvent {
+    uint mId;
+    uint mRemaining; /* In milliseconds. */
+    std::chrono::nanoseconds mTime;
 };
 
 struct AsyncDisconnectEvent {
-    char msg[244];
+    std::chrono::nanoseconds mTime;
+    char msg[232];
+};
+
+/* Not sent by the mixer, so not part of AsyncEvent. */
+struct AsyncBufferLoadedEvent {
+    uint mId;
+    bool mSuccess;
+    std::chrono::nanoseconds mTime;
 };
 
 struct AsyncEffectReleaseEvent {
@@ -49,6 +71,7 @@ struct AsyncEffectReleaseEvent {
 using AsyncEvent = std::variant<AsyncKillThread,
         AsyncSourceStateEvent,
         AsyncBufferCompleteEvent,
+        AsyncQueueLowEvent,
         AsyncEffectReleaseEvent,
         AsyncDisconnectEvent>;
 
@@ -10,6 +10,7 @@
 
 #include "almalloc.h"
 #include "alnumbers.h"
+#include "alnumeric.h"
 #include "filters/splitter.h"
 #include "front_stablizer.h"
 #include "mixer.h"
@@ -51,33 +52,55 @@ BFormatDec::BFormatDec(const size_t inchans, const al::span<const ChannelDec> co
 
 
 void BFormatDec::process(const al::span<FloatBufferLine> OutBuffer,
-    const FloatBufferLine *InSamples, const size_t SamplesToDo)
+    const FloatBufferLine *InSamples, const size_t Offset, const size_t SamplesToDo)
 {
     ASSUME(SamplesToDo > 0);
 
+    /* The decode is a matrix mix of the input channels to the outputs. With
+     * dual-band decoding, each input channel's high and low frequency bands
+     * are separate inputs.
+     */
+    const size_t numInputs{mChannelDec.size() * (mDualBand ? sNumBands : 1)};
+    std::array<const float*,MaxAmbiChannels*sNumBands> inputs;
+    std::array<const float*,MaxAmbiChannels*sNumBands> gains;
+
     if(mDualBand)
     {
-        const al::span<float> hfSamples{mSamples[sHFBand].data(), SamplesToDo};
-        const al::span<float> lfSamples{mSamples[sLFBand].data(), SamplesToDo};
-        for(auto &chandec : mChannelDec)
+        const size_t numChans{mChannelDec.size()};
+        std::array<BandSplitter*,MaxAmbiChannels> splitters;
+        std::array<const float*,MaxAmbiChannels> splitIn;
+        std::array<float*,MaxAmbiChannels> splitHF, splitLF;
+        for(size_t i{0};i < numChans;++i)
+        {
+            inputs[i*sNumBands + sHFBand] = mSamples[i*sNumBands + sHFBand].data();
+            inputs[i*sNumBands + sLFBand] = mSamples[i*sNumBands + sLFBand].data();
+            gains[i*sNumBands + sHFBand] = mChannelDec[i].mGains.Dual[sHFBand];
+            gains[i*sNumBands + sLFBand] = mChannelDec[i].mGains.Dual[sLFBand];
+            splitters[i] = &mChannelDec[i].mXOver;
+            splitHF[i] = mSamples[i*sNumBands + sHFBand].data();
+            splitLF[i] = mSamples[i*sNumBands + sLFBand].data();
+        }
+
+        for(size_t base{0};base < SamplesToDo;base += sBlockSize)
         {
-            chandec.mXOver.process({InSamples->data(), SamplesToDo}, hfSamples.data(),
-                lfSamples.data());
-            MixSamples(hfSamples, OutBuffer, chandec.mGains.Dual[sHFBand],
-                chandec.mGains.Dual[sHFBand], 0, 0);
-            MixSamples(lfSamples, OutBuffer, chandec.mGains.Dual[sLFBand],
-                chandec.mGains.Dual[sLFBand], 0, 0);
-            ++InSamples;
+            const size_t todo{minz(SamplesToDo-base, sBlockSize)};
+            for(size_t i{0};i < numChans;++i)
+                splitIn[i] = InSamples[i].data() + Offset + base;
+            BandSplitter::processBatch({splitters.data(), numChans}, {splitIn.data(), numChans},
+                {splitHF.data(), numChans}, {splitLF.data(), numChans}, todo);
+            MixMatrix({inputs.data(), numInputs}, {gains.data(), numInputs}, OutBuffer,
+                Offset+base, todo);
         }
     }
     else
     {
-        for(auto &chandec : mChannelDec)
+        for(size_t i{0};i < mChannelDec.size();++i)
         {
-            MixSamples({InSamples->data(), SamplesToDo}, OutBuffer, chandec.mGains.Single,
-                chandec.mGains.Single, 0, 0);
-            ++InSamples;
+            inputs[i] = InSamples[i].data() + Offset;
+            gains[i] = mChannelDec[i].mGains.Single;
         }
+        MixMatrix({inputs.data(), numInputs}, {gains.data(), numInputs}, OutBuffer, Offset,
+            SamplesToDo);
     }
 }
 
@@ -120,18 +143,23 @@ void BFormatDec::processStablize(const al::span<FloatBufferLine> OutBuffer,
      * signal and the split mid signal.
      */
     const size_t NumChannels{OutBuffer.size()};
+    std::array<BandSplitter*,MAX_OUTPUT_CHANNELS> filters;
+    std::array<float*,MAX_OUTPUT_CHANNELS> buffers;
     for(size_t i{0u};i < NumChannels;i++)
     {
         /* Skip the left and right channels, which are going to get overwritten,
          * and substitute the direct mid signal and direct+decoded side signal.
          */
+        filters[i] = &mStablizer->ChannelFilters[i];
         if(i == lidx)
-            mStablizer->ChannelFilters[i].processAllPass({mid, SamplesToDo});
+            buffers[i] = mid;
         else if(i == ridx)
-            mStablizer->ChannelFilters[i].processAllPass({side, SamplesToDo});
+            buffers[i] = side;
         else
-            mStablizer->ChannelFilters[i].processAllPass({OutBuffer[i].data(), SamplesToDo});
+            buffers[i] = OutBuffer[i].data();
     }
+    BandSplitter::processAllPassBatch({filters.data(), NumChannels},
+        {buffers.data(), NumChannels}, SamplesToDo);
 
     /* This pans the separate low- and high-frequency signals between being on
      * the center channel and the left+right channels. The low-frequency signal
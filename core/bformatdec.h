@@ -33,7 +33,12 @@ class BFormatDec {
         BandSplitter mXOver;
     };
 
-    alignas(16) std::array<FloatBufferLine,2> mSamples;
+    /* Dual-band decoding splits and mixes the input in blocks of this many
+     * samples, so the split bands of all input channels stay in cache.
+     */
+    static constexpr size_t sBlockSize{128};
+
+    alignas(16) std::array<std::array<float,sBlockSize>,MaxAmbiChannels*sNumBands> mSamples;
 
     const std::unique_ptr<FrontStablizer> mStablizer;
     const bool mDualBand{false};
@@ -52,9 +57,14 @@ public:
 
     bool hasStablizer() const noexcept { return mStablizer != nullptr; }
 
-    /* Decodes the ambisonic input to the given output channels. */
+    /* Decodes the ambisonic input to the given output channels. The offset
+     * allows decoding a period in multiple smaller chunks.
+     */
     void process(const al::span<FloatBufferLine> OutBuffer, const FloatBufferLine *InSamples,
-        const size_t SamplesToDo);
+        const size_t Offset, const size_t SamplesToDo);
+    void process(const al::span<FloatBufferLine> OutBuffer, const FloatBufferLine *InSamples,
+        const size_t SamplesToDo)
+    { process(OutBuffer, InSamples, 0, SamplesToDo); }
 
     /* Decodes the ambisonic input to the given output channels with stablization. */
     void processStablize(const al::span<FloatBufferLine> OutBuffer,
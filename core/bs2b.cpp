@@ -30,6 +30,59 @@
 #include "alnumbers.h"
 #include "bs2b.h"
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+
+namespace {
+
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+#ifdef HAVE_SSE_INTRINSICS
+using float4 = __m128;
+inline float4 set4(const float a, const float b, const float c, const float d) noexcept
+{ return _mm_setr_ps(a, b, c, d); }
+inline float4 load4(const float *src) noexcept { return _mm_loadu_ps(src); }
+inline void store4(float *dst, const float4 val) noexcept { _mm_storeu_ps(dst, val); }
+inline float4 add4(const float4 a, const float4 b) noexcept { return _mm_add_ps(a, b); }
+inline float4 mul4(const float4 a, const float4 b) noexcept { return _mm_mul_ps(a, b); }
+/* Interleaves the low or high halves of two vectors, {a0, b0, a1, b1} or
+ * {a2, b2, a3, b3}.
+ */
+inline float4 ziplo4(const float4 a, const float4 b) noexcept { return _mm_unpacklo_ps(a, b); }
+inline float4 ziphi4(const float4 a, const float4 b) noexcept { return _mm_unpackhi_ps(a, b); }
+inline void transpose4(float4 &r0, float4 &r1, float4 &r2, float4 &r3) noexcept
+{ _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+#else
+using float4 = float32x4_t;
+inline float4 set4(const float a, const float b, const float c, const float d) noexcept
+{
+    const float vals[4]{a, b, c, d};
+    return vld1q_f32(vals);
+}
+inline float4 load4(const float *src) noexcept { return vld1q_f32(src); }
+inline void store4(float *dst, const float4 val) noexcept { vst1q_f32(dst, val); }
+inline float4 add4(const float4 a, const float4 b) noexcept { return vaddq_f32(a, b); }
+inline float4 mul4(const float4 a, const float4 b) noexcept { return vmulq_f32(a, b); }
+inline float4 ziplo4(const float4 a, const float4 b) noexcept { return vzipq_f32(a, b).val[0]; }
+inline float4 ziphi4(const float4 a, const float4 b) noexcept { return vzipq_f32(a, b).val[1]; }
+inline void transpose4(float4 &r0, float4 &r1, float4 &r2, float4 &r3) noexcept
+{
+    const float32x4x2_t t01{vtrnq_f32(r0, r1)};
+    const float32x4x2_t t23{vtrnq_f32(r2, r3)};
+    r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+#endif
+#endif
+
+} // namespace
+
+
 
 /* Set up all data. */
 static void init(struct bs2b *bs2b)
@@ -137,47 +190,78 @@ void bs2b_cross_feed(struct bs2b *bs2b, float *Left, float *Right, size_t Sample
     const float a0_hi{bs2b->a0_hi};
     const float a1_hi{bs2b->a1_hi};
     const float b1_hi{bs2b->b1_hi};
-    float lsamples[128][2];
-    float rsamples[128][2];
+    size_t base{0};
 
-    for(size_t base{0};base < SamplesToDo;)
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+    /* Run the four filters (the lowpass and highboost of each channel) in one
+     * vector, as {left lo, left hi, right lo, right hi}. The lowpass doesn't
+     * use the previous input, so its a1 is 0. Each step filters one sample of
+     * both channels, and four steps are transposed so each vector holds one
+     * filter's output for four samples, to cross-feed them together. The
+     * results are the same as the separate filters.
+     */
+    if(const size_t todo{SamplesToDo & ~size_t{3}})
     {
-        const size_t todo{std::min<size_t>(128, SamplesToDo-base)};
+        const float4 a0{set4(a0_lo, a0_hi, a0_lo, a0_hi)};
+        const float4 a1{set4(0.0f, a1_hi, 0.0f, a1_hi)};
+        const float4 b1{set4(b1_lo, b1_hi, b1_lo, b1_hi)};
+        float4 z{set4(bs2b->history[0].lo, bs2b->history[0].hi, bs2b->history[1].lo,
+            bs2b->history[1].hi)};
+        auto filter = [a0,a1,b1,&z](const float4 in) noexcept -> float4
+        {
+            const float4 out{add4(mul4(a0, in), z)};
+            z = add4(mul4(a1, in), mul4(b1, out));
+            return out;
+        };
 
-        /* Process left input */
-        float z_lo{bs2b->history[0].lo};
-        float z_hi{bs2b->history[0].hi};
-        for(size_t i{0};i < todo;i++)
+        for(;base < todo;base += 4)
         {
-            lsamples[i][0] = a0_lo*Left[i] + z_lo;
-            z_lo = b1_lo*lsamples[i][0];
+            const float4 lr01{ziplo4(load4(Left+base), load4(Right+base))};
+            const float4 lr23{ziphi4(load4(Left+base), load4(Right+base))};
+            float4 out0{filter(ziplo4(lr01, lr01))};
+            float4 out1{filter(ziphi4(lr01, lr01))};
+            float4 out2{filter(ziplo4(lr23, lr23))};
+            float4 out3{filter(ziphi4(lr23, lr23))};
+            transpose4(out0, out1, out2, out3);
 
-            lsamples[i][1] = a0_hi*Left[i] + z_hi;
-            z_hi = a1_hi*Left[i] + b1_hi*lsamples[i][1];
+            /* Crossfeed */
+            store4(Left+base, add4(out1, out2));
+            store4(Right+base, add4(out3, out0));
         }
-        bs2b->history[0].lo = z_lo;
-        bs2b->history[0].hi = z_hi;
 
-        /* Process right input */
-        z_lo = bs2b->history[1].lo;
-        z_hi = bs2b->history[1].hi;
-        for(size_t i{0};i < todo;i++)
-        {
-            rsamples[i][0] = a0_lo*Right[i] + z_lo;
-            z_lo = b1_lo*rsamples[i][0];
+        alignas(16) float hist[4];
+        store4(hist, z);
+        bs2b->history[0].lo = hist[0];
+        bs2b->history[0].hi = hist[1];
+        bs2b->history[1].lo = hist[2];
+        bs2b->history[1].hi = hist[3];
+    }
+#endif
 
-            rsamples[i][1] = a0_hi*Right[i] + z_hi;
-            z_hi = a1_hi*Right[i] + b1_hi*rsamples[i][1];
-        }
-        bs2b->history[1].lo = z_lo;
-        bs2b->history[1].hi = z_hi;
+    float lz_lo{bs2b->history[0].lo};
+    float lz_hi{bs2b->history[0].hi};
+    float rz_lo{bs2b->history[1].lo};
+    float rz_hi{bs2b->history[1].hi};
+    for(;base < SamplesToDo;++base)
+    {
+        const float l{Left[base]}, r{Right[base]};
 
-        /* Crossfeed */
-        for(size_t i{0};i < todo;i++)
-            *(Left++) = lsamples[i][1] + rsamples[i][0];
-        for(size_t i{0};i < todo;i++)
-            *(Right++) = rsamples[i][1] + lsamples[i][0];
+        const float l_lo{a0_lo*l + lz_lo};
+        lz_lo = b1_lo*l_lo;
+        const float l_hi{a0_hi*l + lz_hi};
+        lz_hi = a1_hi*l + b1_hi*l_hi;
 
-        base += todo;
+        const float r_lo{a0_lo*r + rz_lo};
+        rz_lo = b1_lo*r_lo;
+        const float r_hi{a0_hi*r + rz_hi};
+        rz_hi = a1_hi*r + b1_hi*r_hi;
+
+        /* Crossfeed */
+        Left[base] = l_hi + r_lo;
+        Right[base] = r_hi + l_lo;
     }
+    bs2b->history[0].lo = lz_lo;
+    bs2b->history[0].hi = lz_hi;
+    bs2b->history[1].lo = rz_lo;
+    bs2b->history[1].hi = rz_hi;
 } /* bs2b_cross_feed */
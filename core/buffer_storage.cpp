@@ -14,6 +14,7 @@ const char *NameFromFormat(FmtType type) noexcept
     case FmtShort: return "Int16";
     case FmtFloat: return "Float";
     case FmtDouble: return "Double";
+    case FmtHalf: return "Half";
     case FmtMulaw: return "muLaw";
     case FmtAlaw: return "aLaw";
     case FmtIMA4: return "IMA4 ADPCM";
@@ -51,6 +52,7 @@ uint BytesFromFmt(FmtType type) noexcept
     case FmtShort: return sizeof(int16_t);
     case FmtFloat: return sizeof(float);
     case FmtDouble: return sizeof(double);
+    case FmtHalf: return sizeof(uint16_t);
     case FmtMulaw: return sizeof(uint8_t);
     case FmtAlaw: return sizeof(uint8_t);
     case FmtIMA4: break;
@@ -3,6 +3,7 @@
 
 #include <atomic>
 #include <cstddef>
+#include <stdint.h>
 
 #include "alnumeric.h"
 #include "alspan.h"
@@ -17,6 +18,7 @@ enum FmtType : unsigned char {
     FmtShort,
     FmtFloat,
     FmtDouble,
+    FmtHalf,
     FmtMulaw,
     FmtAlaw,
     FmtIMA4,
@@ -81,10 +83,44 @@ constexpr bool Is2DAmbisonic(FmtChannels chans) noexcept
 
 using CallbackType = int(*)(void*, void*, int);
 
+/* The shared positions of a ring buffer's storage, in blocks. The app writes
+ * blocks at the write position and the mixer plays them from the read
+ * position, each only advancing its own. Positions are kept modulo twice the
+ * ring size so a full ring can be told apart from an empty one.
+ */
+struct BufferRing {
+    std::atomic<uint> mWritePos{0u};
+    std::atomic<uint> mReadPos{0u};
+    uint mNumBlocks{0u};
+
+    /* Set for a callback buffer's ring, which the prefetch thread fills from
+     * the callback. Running out of written blocks then counts an underrun and
+     * keeps playing, instead of stopping, until the callback ends the stream.
+     */
+    bool mPrefetch{false};
+    std::atomic<bool> mEnded{false};
+    std::atomic<uint> mUnderruns{0u};
+
+    /** Number of written blocks that haven't been played yet. */
+    uint readable(const uint writePos, const uint readPos) const noexcept
+    { return (writePos - readPos + mNumBlocks*2) % (mNumBlocks*2); }
+
+    /** Storage index of the given ring position. */
+    uint index(const uint pos) const noexcept
+    { return (pos < mNumBlocks) ? pos : (pos - mNumBlocks); }
+
+    /** Advances the given ring position by a number of blocks. */
+    uint advance(const uint pos, const uint count) const noexcept
+    { return (pos + count) % (mNumBlocks*2); }
+};
+
 struct BufferStorage {
     CallbackType mCallback{nullptr};
     void *mUserData{nullptr};
 
+    /* Set for ring buffer storage, where mData is the ring. */
+    BufferRing *mRing{nullptr};
+
     al::span<std::byte> mData;
 
     uint mSampleRate{0u};
@@ -93,10 +129,21 @@ struct BufferStorage {
     uint mSampleLen{0u};
     uint mBlockAlign{0u};
 
+    /* Non-0 when the samples were converted on load to 32-bit float planes,
+     * one per channel with this many samples each, instead of being stored
+     * interleaved in mType.
+     */
+    uint mPlaneSize{0u};
+
     AmbiLayout mAmbiLayout{AmbiLayout::FuMa};
     AmbiScaling mAmbiScaling{AmbiScaling::FuMa};
     uint mAmbiOrder{0u};
 
+    /* Changed whenever the sample data is set or modified, uniquely
+     * identifying the data for anything prepared from it.
+     */
+    uint64_t mSerial{0u};
+
     inline uint bytesFromFmt() const noexcept { return BytesFromFmt(mType); }
     inline uint channelsFromFmt() const noexcept
     { return ChannelsFromFmt(mChannels, mAmbiOrder); }
@@ -5,11 +5,19 @@
 
 #include "alspan.h"
 
+#ifndef ALSOFT_BUFFER_LINE_SIZE
+#error "ALSOFT_BUFFER_LINE_SIZE is not defined, config.h must be included first"
+#endif
+
 /* Size for temporary storage of buffer data, in floats. Larger values need
  * more memory and are harder on cache, while smaller values may need more
- * iterations for mixing.
+ * iterations for mixing. This is set when configuring the build (see the
+ * ALSOFT_BUFFER_LINE_SIZE CMake option), which sizes the mixer's scratch
+ * buffers accordingly.
  */
-constexpr int BufferLineSize{1024};
+constexpr int BufferLineSize{ALSOFT_BUFFER_LINE_SIZE};
+static_assert(BufferLineSize >= 64 && BufferLineSize <= 4096
+    && (BufferLineSize & (BufferLineSize-1)) == 0, "Invalid BufferLineSize");
 
 using FloatBufferLine = std::array<float,BufferLineSize>;
 using FloatBufferSpan = al::span<float,BufferLineSize>;
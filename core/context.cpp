@@ -13,6 +13,7 @@
 #include "effectslot.h"
 #include "logging.h"
 #include "ringbuffer.h"
+#include "sourcegroup.h"
 #include "voice.h"
 #include "voice_change.h"
 
@@ -22,41 +23,31 @@ static_assert(std::atomic<ContextBase::AsyncEventBitset>::is_always_lock_free, "
 #endif
 
 ContextBase::ContextBase(DeviceBase *device) : mDevice{device}
-{ assert(mEnabledEvts.is_lock_free()); }
+{
+    assert(mEnabledEvts.is_lock_free());
+
+    mContextPropsPool.trackMemory(device->mMemoryStats);
+    mVoicePropsPool.trackMemory(device->mMemoryStats);
+    mEffectSlotPropsPool.trackMemory(device->mMemoryStats);
+    mSourceGroupPropsPool.trackMemory(device->mMemoryStats);
+}
 
 ContextBase::~ContextBase()
 {
-    size_t count{0};
-    ContextProps *cprops{mParams.ContextUpdate.exchange(nullptr, std::memory_order_relaxed)};
-    if(cprops)
-    {
-        ++count;
-        delete cprops;
-    }
-    cprops = mFreeContextProps.exchange(nullptr, std::memory_order_acquire);
-    while(cprops)
-    {
-        std::unique_ptr<ContextProps> old{cprops};
-        cprops = old->next.load(std::memory_order_relaxed);
-        ++count;
-    }
+    /* Any pending updates are owned by the property pools. */
+    size_t count{mContextPropsPool.allocCount()};
     TRACE("Freed %zu context property object%s\n", count, (count==1)?"":"s");
-
-    count = 0;
-    EffectSlotProps *eprops{mFreeEffectslotProps.exchange(nullptr, std::memory_order_acquire)};
-    while(eprops)
-    {
-        std::unique_ptr<EffectSlotProps> old{eprops};
-        eprops = old->next.load(std::memory_order_relaxed);
-        ++count;
-    }
+    count = mEffectSlotPropsPool.allocCount();
     TRACE("Freed %zu AuxiliaryEffectSlot property object%s\n", count, (count==1)?"":"s");
+    count = mSourceGroupPropsPool.allocCount();
+    TRACE("Freed %zu SourceGroup property object%s\n", count, (count==1)?"":"s");
 
     if(EffectSlotArray *curarray{mActiveAuxSlots.exchange(nullptr, std::memory_order_relaxed)})
     {
         std::destroy_n(curarray->end(), curarray->size());
         delete curarray;
     }
+    delete mActiveSourceGroups.exchange(nullptr, std::memory_order_relaxed);
 
     delete mVoices.exchange(nullptr, std::memory_order_relaxed);
 
@@ -85,66 +76,135 @@ ContextBase::~ContextBase()
 
 void ContextBase::allocVoiceChanges()
 {
-    constexpr size_t clustersize{128};
-
-    VoiceChangeCluster cluster{std::make_unique<VoiceChange[]>(clustersize)};
-    for(size_t i{1};i < clustersize;++i)
+    VoiceChangeCluster cluster{std::make_unique<VoiceChange[]>(VoiceChangeClusterSize)};
+    for(size_t i{1};i < VoiceChangeClusterSize;++i)
         cluster[i-1].mNext.store(std::addressof(cluster[i]), std::memory_order_relaxed);
-    cluster[clustersize-1].mNext.store(mVoiceChangeTail, std::memory_order_relaxed);
+    cluster[VoiceChangeClusterSize-1].mNext.store(mVoiceChangeTail, std::memory_order_relaxed);
 
     mVoiceChangeClusters.emplace_back(std::move(cluster));
     mVoiceChangeTail = mVoiceChangeClusters.back().get();
-}
-
-void ContextBase::allocVoiceProps()
-{
-    constexpr size_t clustersize{32};
-
-    TRACE("Increasing allocated voice properties to %zu\n",
-        (mVoicePropClusters.size()+1) * clustersize);
-
-    VoicePropsCluster cluster{std::make_unique<VoicePropsItem[]>(clustersize)};
-    for(size_t i{1};i < clustersize;++i)
-        cluster[i-1].next.store(std::addressof(cluster[i]), std::memory_order_relaxed);
-    mVoicePropClusters.emplace_back(std::move(cluster));
-
-    VoicePropsItem *oldhead{mFreeVoiceProps.load(std::memory_order_acquire)};
-    do {
-        mVoicePropClusters.back()[clustersize-1].next.store(oldhead, std::memory_order_relaxed);
-    } while(mFreeVoiceProps.compare_exchange_weak(oldhead, mVoicePropClusters.back().get(),
-        std::memory_order_acq_rel, std::memory_order_acquire) == false);
+    updateVoiceMemory();
 }
 
 void ContextBase::allocVoices(size_t addcount)
 {
-    constexpr size_t clustersize{32};
     /* Convert element count to cluster count. */
-    addcount = (addcount+(clustersize-1)) / clustersize;
+    addcount = (addcount+(VoiceClusterSize-1)) / VoiceClusterSize;
 
-    if(addcount >= std::numeric_limits<int>::max()/clustersize - mVoiceClusters.size())
+    if(addcount >= std::numeric_limits<int>::max()/VoiceClusterSize - mVoiceClusters.size())
         throw std::runtime_error{"Allocating too many voices"};
-    const size_t totalcount{(mVoiceClusters.size()+addcount) * clustersize};
+    const size_t totalcount{(mVoiceClusters.size()+addcount) * VoiceClusterSize};
     TRACE("Increasing allocated voices to %zu\n", totalcount);
 
+    /* Sources refer to their voice by index, so keep the existing voices in
+     * place and add the new ones after them.
+     */
     auto newarray = VoiceArray::Create(totalcount);
-    while(addcount)
-    {
-        mVoiceClusters.emplace_back(std::make_unique<Voice[]>(clustersize));
-        --addcount;
-    }
-
     auto voice_iter = newarray->begin();
-    for(VoiceCluster &cluster : mVoiceClusters)
+    if(auto *oldvoices = mVoices.load(std::memory_order_relaxed))
+        voice_iter = std::copy(oldvoices->begin(), oldvoices->end(), voice_iter);
+    while(addcount)
     {
-        for(size_t i{0};i < clustersize;++i)
+        mVoiceClusters.emplace_back(std::make_unique<Voice[]>(VoiceClusterSize));
+        VoiceCluster &cluster = mVoiceClusters.back();
+        for(size_t i{0};i < VoiceClusterSize;++i)
+        {
+            cluster[i].mIndex = static_cast<uint>(voice_iter - newarray->begin());
             *(voice_iter++) = &cluster[i];
+        }
+        --addcount;
     }
 
     if(auto *oldvoices = mVoices.exchange(newarray.release(), std::memory_order_acq_rel))
+        mRetiredVoices.emplace_back(oldvoices);
+    updateVoiceMemory();
+}
+
+void ContextBase::reserveStorage()
+{
+    const size_t numvoices{mVoiceClusters.size() * VoiceClusterSize};
+    if(numvoices < mReservedVoices)
+        allocVoices(mReservedVoices - numvoices);
+
+    while(mVoiceChangeClusters.size()*VoiceChangeClusterSize < mReservedVoiceChanges)
+        allocVoiceChanges();
+
+    while(mEffectSlotClusters.size()*EffectSlotClusterSize < mReservedEffectSlots)
+        mEffectSlotClusters.emplace_back(std::make_unique<EffectSlot[]>(EffectSlotClusterSize));
+
+    mVoicePropsPool.reserve(mReservedProps);
+    mEffectSlotPropsPool.reserve(mReservedEffectSlots);
+}
+
+void ContextBase::updateVoiceMemory() noexcept
+{
+    /* The voices' own per-channel storage is counted by each voice. */
+    size_t bytes{mVoiceClusters.size() * VoiceClusterSize * sizeof(Voice)};
+    bytes += mVoiceChangeClusters.size() * VoiceChangeClusterSize * sizeof(VoiceChange);
+    if(const VoiceArray *voices{mVoices.load(std::memory_order_relaxed)})
+        bytes += VoiceArray::Sizeof(voices->size());
+    mVoiceMemory.set(mDevice->mMemoryStats, MemCategory::Voices, bytes);
+}
+
+void ContextBase::freeRetiredVoices()
+{
+    for(auto &voices : mRetiredVoices)
+        mDevice->retire(voices.release());
+    mRetiredVoices.clear();
+}
+
+void ContextBase::pushFreeVoice(Voice *voice) noexcept
+{
+    /* Don't add a voice that's already listed. */
+    if(voice->mFreeListed.exchange(true, std::memory_order_acq_rel))
+        return;
+
+    Voice *oldhead{mFreeVoices.load(std::memory_order_acquire)};
+    do {
+        voice->mNextFree.store(oldhead, std::memory_order_relaxed);
+    } while(!mFreeVoices.compare_exchange_weak(oldhead, voice, std::memory_order_acq_rel,
+        std::memory_order_acquire));
+}
+
+Voice *ContextBase::popFreeVoice() noexcept
+{
+    /* With only one thread removing voices, the head can't be removed and
+     * added back while trying to remove it, so there's no ABA problem.
+     */
+    Voice *voice{mFreeVoices.load(std::memory_order_acquire)};
+    Voice *next;
+    do {
+        if(!voice) return nullptr;
+        next = voice->mNextFree.load(std::memory_order_relaxed);
+    } while(!mFreeVoices.compare_exchange_weak(voice, next, std::memory_order_acq_rel,
+        std::memory_order_acquire));
+    return voice;
+}
+
+Voice *ContextBase::popFreeVoice(const FmtChannels chans) noexcept
+{
+    /* A voice last used with the same channel format already has its mixing
+     * state allocated for it, so prefer one of those. The head is taken as
+     * normal, but since the mixer only adds to the front, voices after it can
+     * be unlinked directly.
+     */
+    Voice *prev{mFreeVoices.load(std::memory_order_acquire)};
+    if(!prev || prev->mFmtChannels == chans)
+        return popFreeVoice();
+
+    Voice *voice{prev->mNextFree.load(std::memory_order_relaxed)};
+    for(size_t i{1};voice && i < FreeVoiceSearchLimit;++i)
     {
-        mDevice->waitForMix();
-        delete oldvoices;
+        Voice *next{voice->mNextFree.load(std::memory_order_relaxed)};
+        if(voice->mFmtChannels == chans)
+        {
+            prev->mNextFree.store(next, std::memory_order_relaxed);
+            return voice;
+        }
+        prev = voice;
+        voice = next;
     }
+    return popFreeVoice();
 }
 
 
@@ -167,3 +227,24 @@ EffectSlot *ContextBase::getEffectSlot()
     mEffectSlotClusters.emplace_back(std::make_unique<EffectSlot[]>(EffectSlotClusterSize));
     return getEffectSlot();
 }
+
+
+SourceGroup *ContextBase::getSourceGroup()
+{
+    for(auto& cluster : mSourceGroupClusters)
+    {
+        for(size_t i{0};i < SourceGroupClusterSize;++i)
+        {
+            if(!cluster[i].InUse)
+                return &cluster[i];
+        }
+    }
+
+    if(1 >= std::numeric_limits<int>::max()/SourceGroupClusterSize - mSourceGroupClusters.size())
+        throw std::runtime_error{"Allocating too many source groups"};
+    const size_t totalcount{(mSourceGroupClusters.size()+1) * SourceGroupClusterSize};
+    TRACE("Increasing allocated source groups to %zu\n", totalcount);
+
+    mSourceGroupClusters.emplace_back(std::make_unique<SourceGroup[]>(SourceGroupClusterSize));
+    return getSourceGroup();
+}
@@ -4,8 +4,10 @@
 #include <array>
 #include <atomic>
 #include <bitset>
+#include <chrono>
 #include <cstddef>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -14,13 +16,18 @@
 #include "alspan.h"
 #include "async_event.h"
 #include "atomic.h"
+#include "memory_stats.h"
 #include "opthelpers.h"
+#include "props_pool.h"
 #include "vecmat.h"
+#include "voice.h"
 
 struct DeviceBase;
 struct EffectSlot;
 struct EffectSlotProps;
 struct RingBuffer;
+struct SourceGroup;
+struct SourceGroupProps;
 struct Voice;
 struct VoiceChange;
 struct VoicePropsItem;
@@ -40,11 +47,26 @@ enum class DistanceModel : unsigned char {
 };
 
 
+/* The maximum number of listeners a context can have, including the main
+ * one.
+ */
+inline constexpr uint MaxListeners{4};
+
+struct ListenerPlacement {
+    std::array<float,3> Position;
+    std::array<float,3> Velocity;
+    std::array<float,3> OrientAt;
+    std::array<float,3> OrientUp;
+};
+
 struct ContextProps {
     std::array<float,3> Position;
     std::array<float,3> Velocity;
     std::array<float,3> OrientAt;
     std::array<float,3> OrientUp;
+    /* Additional listeners, which share the main listener's other properties. */
+    std::array<ListenerPlacement,MaxListeners-1> ExtraListeners;
+    uint NumListeners;
     float Gain;
     float MetersPerUnit;
     float AirAbsorptionGainHF;
@@ -60,13 +82,22 @@ struct ContextProps {
     DEF_NEWDEL(ContextProps)
 };
 
+/* A listener's position, orientation matrix, and velocity, for transforming
+ * world-space sources relative to it.
+ */
+struct ListenerTransform {
+    alu::Vector Position{};
+    alu::Matrix Matrix{alu::Matrix::Identity()};
+    alu::Vector Velocity{};
+};
+
 struct ContextParams {
     /* Pointer to the most recent property values that are awaiting an update. */
     std::atomic<ContextProps*> ContextUpdate{nullptr};
 
-    alu::Vector Position{};
-    alu::Matrix Matrix{alu::Matrix::Identity()};
-    alu::Vector Velocity{};
+    /* The main listener, followed by any additional ones. */
+    std::array<ListenerTransform,MaxListeners> Listeners{};
+    uint NumListeners{1};
 
     float Gain{1.0f};
     float MetersPerUnit{1.0f};
@@ -79,6 +110,22 @@ struct ContextParams {
     DistanceModel mDistanceModel{};
 };
 
+struct VoiceBudgetEntry {
+    Voice *mVoice;
+    int mPriority;
+    float mAudibility;
+};
+
+/* A group of far-field voices in one direction cell, with the same effect
+ * slot sends. The voices mix into the cluster's lines, which are then panned
+ * once for the cell.
+ */
+struct SpatialCluster {
+    uint8_t mCell{NoSpatialCluster};
+    uint mVoiceCount{0u};
+    std::array<EffectSlot*,MAX_SENDS> mSlots{};
+};
+
 struct ContextBase {
     DeviceBase *const mDevice;
 
@@ -89,25 +136,43 @@ struct ContextBase {
     std::atomic<bool> mHoldUpdates{false};
     std::atomic<bool> mStopVoicesOnDisconnect{true};
 
+    /* Set by the mixer to recalculate all source parameters with the next
+     * update, e.g. after the device's HRTF changed.
+     */
+    bool mForceUpdate{false};
+
     float mGainBoost{1.0f};
 
-    /* Linked lists of unused property containers, free to use for future
-     * updates.
+    /* Pools of property containers, free to use for future updates. The
+     * context and effect slot pools are used with the AL context's property
+     * lock held, and the source group pool with its source group lock held.
+     */
+    PropsPool<ContextProps,4> mContextPropsPool;
+    PropsPool<VoicePropsItem,32> mVoicePropsPool;
+    PropsPool<EffectSlotProps,4> mEffectSlotPropsPool;
+    PropsPool<SourceGroupProps,4> mSourceGroupPropsPool;
+    /* Serializes getting voice property containers from the pool, since
+     * multiple API threads may update voices at once.
      */
-    std::atomic<ContextProps*> mFreeContextProps{nullptr};
-    std::atomic<VoicePropsItem*> mFreeVoiceProps{nullptr};
-    std::atomic<EffectSlotProps*> mFreeEffectslotProps{nullptr};
+    std::mutex mVoicePropsLock;
+
+    /* Memory counted for the voices and voice changes, and the event queue. */
+    MemoryUsage mVoiceMemory;
+    MemoryUsage mAsyncEventsMemory;
+    void updateVoiceMemory() noexcept;
 
     /* The voice change tail is the beginning of the "free" elements, up to and
      * *excluding* the current. If tail==current, there's no free elements and
      * new ones need to be allocated. The current voice change is the element
-     * last processed, and any after are pending.
+     * last processed, and any after are pending. The last voice change is the
+     * end of the pending list, which new changes are linked after without
+     * walking the list. Since it's never before the current, it's never free.
      */
     VoiceChange *mVoiceChangeTail{};
     std::atomic<VoiceChange*> mCurrentVoiceChange{};
+    std::atomic<VoiceChange*> mLastVoiceChange{};
 
     void allocVoiceChanges();
-    void allocVoiceProps();
 
 
     ContextParams mParams;
@@ -115,8 +180,36 @@ struct ContextBase {
     using VoiceArray = al::FlexArray<Voice*>;
     std::atomic<VoiceArray*> mVoices{};
     std::atomic<size_t> mActiveVoiceCount{};
+    /* The active voice count a context starts with, and which compaction
+     * doesn't go below.
+     */
+    static constexpr size_t MinActiveVoices{64};
+    /* When the API last checked for idle voices to compact out of the active
+     * span.
+     */
+    std::chrono::steady_clock::time_point mLastVoiceCompaction{};
+    /* Voice arrays replaced by allocVoices, kept until no API thread can be
+     * looking up a voice in them. freeRetiredVoices then hands them to the
+     * device, to be freed after the mixer is done with them too.
+     */
+    std::vector<std::unique_ptr<VoiceArray>> mRetiredVoices;
+    void freeRetiredVoices();
+
+    /* Idle voices available to play a source. The mixer adds voices as they
+     * become idle, and the API takes them off (only with the source lock
+     * held) when starting sources.
+     */
+    std::atomic<Voice*> mFreeVoices{nullptr};
+
+    /* How far into the free list to look for a voice last used with the same
+     * channel format.
+     */
+    static constexpr size_t FreeVoiceSearchLimit{16};
 
     void allocVoices(size_t addcount);
+    void pushFreeVoice(Voice *voice) noexcept;
+    Voice *popFreeVoice() noexcept;
+    Voice *popFreeVoice(const FmtChannels chans) noexcept;
     al::span<Voice*> getVoicesSpan() const noexcept
     {
         return {mVoices.load(std::memory_order_relaxed)->data(),
@@ -128,13 +221,45 @@ struct ContextBase {
             mActiveVoiceCount.load(std::memory_order_acquire)};
     }
 
+    /* The maximum number of voices to mix, or 0 for no limit. Voices over the
+     * budget with the lowest priority and audibility get culled, fading out
+     * and only being kept virtual until they fit again. The heap storage is
+     * reserved for the budget ahead of time so the mixer doesn't allocate.
+     */
+    uint mVoiceBudget{0u};
+    std::vector<VoiceBudgetEntry> mVoiceBudgetHeap;
+
+    /* The clusters of far-field voices, when the device clusters them. */
+    std::array<SpatialCluster,MaxSpatialClusters> mSpatialClusters{};
+
+    /* The mixer pool thread that processes the context, when the device mixes
+     * its contexts concurrently. Set by the mixer thread before it starts the
+     * pool.
+     */
+    uint mMixThread{0u};
+
 
     using EffectSlotArray = al::FlexArray<EffectSlot*>;
     std::atomic<EffectSlotArray*> mActiveAuxSlots{nullptr};
 
+    using SourceGroupArray = al::FlexArray<SourceGroup*>;
+    std::atomic<SourceGroupArray*> mActiveSourceGroups{nullptr};
+
     std::thread mEventThread;
     al::semaphore mEventSem;
+    /* When set, there's no event thread and the app polls for events itself,
+     * so the mixer doesn't need to signal anything.
+     */
+    bool mEventPolling{false};
+    /* Set when the API has batched updates waiting to be applied, and set by
+     * the mixer for the event thread to apply them when it starts its next
+     * update.
+     */
+    std::atomic<bool> mBatchedUpdatesPending{false};
+    std::atomic<bool> mBatchedUpdatesDue{false};
     std::unique_ptr<RingBuffer> mAsyncEvents;
+    /* Serializes event writes from voices being mixed on separate threads. */
+    std::atomic<bool> mEventWriteLock{false};
     using AsyncEventBitset = std::bitset<al::to_underlying(AsyncEnableBits::Count)>;
     std::atomic<AsyncEventBitset> mEnabledEvts{0u};
 
@@ -143,15 +268,14 @@ struct ContextBase {
      * However, to avoid allocating each object individually, they're allocated
      * in clusters that are stored in a vector for easy automatic cleanup.
      */
+    static constexpr size_t VoiceChangeClusterSize{128};
     using VoiceChangeCluster = std::unique_ptr<VoiceChange[]>;
     std::vector<VoiceChangeCluster> mVoiceChangeClusters;
 
+    static constexpr size_t VoiceClusterSize{32};
     using VoiceCluster = std::unique_ptr<Voice[]>;
     std::vector<VoiceCluster> mVoiceClusters;
 
-    using VoicePropsCluster = std::unique_ptr<VoicePropsItem[]>;
-    std::vector<VoicePropsCluster> mVoicePropClusters;
-
 
     static constexpr size_t EffectSlotClusterSize{4};
     EffectSlot *getEffectSlot();
@@ -159,6 +283,24 @@ struct ContextBase {
     using EffectSlotCluster = std::unique_ptr<EffectSlot[]>;
     std::vector<EffectSlotCluster> mEffectSlotClusters;
 
+    /* The number of voices, voice changes, effect slots, and voice property
+     * containers to have allocated up front, as requested when creating the
+     * context. reserveStorage allocates whatever's missing, and is called
+     * again after a device reset frees some of them.
+     */
+    uint mReservedVoices{0u};
+    uint mReservedVoiceChanges{0u};
+    uint mReservedEffectSlots{0u};
+    uint mReservedProps{0u};
+    void reserveStorage();
+
+
+    static constexpr size_t SourceGroupClusterSize{4};
+    SourceGroup *getSourceGroup();
+
+    using SourceGroupCluster = std::unique_ptr<SourceGroup[]>;
+    std::vector<SourceGroupCluster> mSourceGroupClusters;
+
 
     ContextBase(DeviceBase *device);
     ContextBase(const ContextBase&) = delete;
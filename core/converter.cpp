@@ -10,10 +10,19 @@
 #include <cstdint>
 #include <iterator>
 #include <limits.h>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+#ifdef HAVE_SSE_INTRINSICS
+#include <emmintrin.h>
+#endif
 
 #include "albit.h"
 #include "alnumeric.h"
 #include "fpu_ctrl.h"
+#include "polyphase_resampler.h"
+#include "resampler_limits.h"
 
 
 namespace {
@@ -21,7 +30,7 @@ namespace {
 constexpr uint MaxPitch{10};
 
 static_assert((BufferLineSize-1)/MaxPitch > 0, "MaxPitch is too large for BufferLineSize!");
-static_assert((INT_MAX>>MixerFracBits)/MaxPitch > BufferLineSize,
+static_assert((UINT_MAX>>MixerFracBits)/MaxPitch > BufferLineSize,
     "MaxPitch and/or BufferLineSize are too large for MixerFracBits!");
 
 /* Base template left undefined. Should be marked =delete, but Clang 3.8.1
@@ -56,9 +65,53 @@ inline void LoadSampleArray(float *RESTRICT dst, const void *src, const size_t s
         dst[i] = LoadSample<T>(ssrc[i*srcstep]);
 }
 
+#ifdef HAVE_SSE_INTRINSICS
+/* 16-bit mono and stereo are the most common capture formats, which SSE2 can
+ * load 4 samples of a channel at a time. The results match the generic loop.
+ */
+void LoadShortsSSE2(float *RESTRICT dst, const int16_t *src, const size_t srcstep,
+    const size_t samples) noexcept
+{
+    const __m128 scale{_mm_set1_ps(1.0f/32768.0f)};
+    size_t i{0u};
+    if(srcstep == 1)
+    {
+        for(;samples-i >= 8;i += 8)
+        {
+            const __m128i vals{_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))};
+            /* Sign-extend by unpacking into the upper halves and shifting down. */
+            const __m128i lo{_mm_srai_epi32(_mm_unpacklo_epi16(vals, vals), 16)};
+            const __m128i hi{_mm_srai_epi32(_mm_unpackhi_epi16(vals, vals), 16)};
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+            _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+        }
+    }
+    else
+    {
+        /* Each 32-bit lane holds this channel's sample in the low half, and
+         * the next channel's in the high half. Stop early enough to not read
+         * past the last frame.
+         */
+        for(;samples-i >= 5;i += 4)
+        {
+            const __m128i vals{_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i*2))};
+            const __m128i chan{_mm_srai_epi32(_mm_slli_epi32(vals, 16), 16)};
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(chan), scale));
+        }
+    }
+    for(;i < samples;++i)
+        dst[i] = LoadSample<DevFmtShort>(src[i*srcstep]);
+}
+#endif
+
 void LoadSamples(float *dst, const void *src, const size_t srcstep, const DevFmtType srctype,
     const size_t samples) noexcept
 {
+#ifdef HAVE_SSE_INTRINSICS
+    if(srctype == DevFmtShort && srcstep <= 2)
+        return LoadShortsSSE2(dst, static_cast<const int16_t*>(src), srcstep, samples);
+#endif
+
 #define HANDLE_FMT(T)                                                         \
     case T: LoadSampleArray<T>(dst, src, srcstep, samples); break
     switch(srctype)
@@ -105,9 +158,37 @@ inline void StoreSampleArray(void *dst, const float *RESTRICT src, const size_t
 }
 
 
+#ifdef HAVE_SSE_INTRINSICS
+/* Stores packed 16-bit samples, for mono output, 8 at a time. The results
+ * match the generic loop.
+ */
+void StoreShortsSSE2(int16_t *dst, const float *RESTRICT src, const size_t samples) noexcept
+{
+    const __m128 scale{_mm_set1_ps(32768.0f)};
+    const __m128 lower{_mm_set1_ps(-32768.0f)};
+    const __m128 upper{_mm_set1_ps(32767.0f)};
+    size_t i{0u};
+    for(;samples-i >= 8;i += 8)
+    {
+        const __m128 vals0{_mm_mul_ps(_mm_loadu_ps(src + i), scale)};
+        const __m128 vals1{_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale)};
+        const __m128i ivals0{_mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(vals0, lower), upper))};
+        const __m128i ivals1{_mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(vals1, lower), upper))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(ivals0, ivals1));
+    }
+    for(;i < samples;++i)
+        dst[i] = StoreSample<DevFmtShort>(src[i]);
+}
+#endif
+
 void StoreSamples(void *dst, const float *src, const size_t dststep, const DevFmtType dsttype,
     const size_t samples) noexcept
 {
+#ifdef HAVE_SSE_INTRINSICS
+    if(dsttype == DevFmtShort && dststep == 1)
+        return StoreShortsSSE2(static_cast<int16_t*>(dst), src, samples);
+#endif
+
 #define HANDLE_FMT(T)                                                         \
     case T: StoreSampleArray<T>(dst, src, dststep, samples); break
     switch(dsttype)
@@ -151,6 +232,75 @@ void Multi2Mono(uint chanmask, const size_t step, const float scale, float *REST
         dst[i] *= scale;
 }
 
+
+/* Polyphase tables are shared by the converters using the same rates. */
+constexpr uint MaxPhases{512};
+
+std::mutex PhaseTableLock;
+std::vector<std::weak_ptr<const PPhaseTable>> PhaseTables;
+
+std::shared_ptr<const PPhaseTable> GetPhaseTable(const uint srcRate, const uint dstRate)
+{
+    const uint gcd{std::gcd(srcRate, dstRate)};
+    const uint p{dstRate / gcd};
+    const uint q{srcRate / gcd};
+
+    std::lock_guard<std::mutex> _{PhaseTableLock};
+    auto expired = [](const std::weak_ptr<const PPhaseTable> &entry) noexcept -> bool
+    { return entry.expired(); };
+    PhaseTables.erase(std::remove_if(PhaseTables.begin(), PhaseTables.end(), expired),
+        PhaseTables.end());
+
+    for(const auto &entry : PhaseTables)
+    {
+        auto table = entry.lock();
+        if(table && table->mP == p && table->mQ == q)
+            return table;
+    }
+
+    auto table = std::make_shared<PPhaseTable>();
+    if(!table->init(srcRate, dstRate, MaxPhases, MaxResamplerPadding))
+        return nullptr;
+    PhaseTables.emplace_back(table);
+    return table;
+}
+
+/* Resamples with a polyphase table, where frac is the phase of the first
+ * output sample and increment is the number of phases to step for each one.
+ */
+void ResamplePolyphase(const PPhaseTable &table, const float *RESTRICT src, uint frac,
+    const uint increment, const al::span<float> dst) noexcept
+{
+    const uint phases{table.mP};
+    const size_t taps{table.mTaps};
+    src -= taps/2 - 1;
+
+    for(float &output : dst)
+    {
+        const float *RESTRICT filter{al::assume_aligned<16>(&table.mFilter[frac*taps])};
+#ifdef HAVE_SSE_INTRINSICS
+        __m128 r4{_mm_setzero_ps()};
+        for(size_t j{0};j < taps;j+=4)
+        {
+            const __m128 f4{_mm_load_ps(filter + j)};
+            r4 = _mm_add_ps(r4, _mm_mul_ps(f4, _mm_loadu_ps(src + j)));
+        }
+        r4 = _mm_add_ps(r4, _mm_shuffle_ps(r4, r4, _MM_SHUFFLE(0, 1, 2, 3)));
+        r4 = _mm_add_ps(r4, _mm_movehl_ps(r4, r4));
+        output = _mm_cvtss_f32(r4);
+#else
+        float r{0.0f};
+        for(size_t j{0};j < taps;++j)
+            r += filter[j] * src[j];
+        output = r;
+#endif
+
+        frac += increment;
+        src += frac / phases;
+        frac %= phases;
+    }
+}
+
 } // namespace
 
 SampleConverterPtr SampleConverter::Create(DevFmtType srcType, DevFmtType dstType, size_t numchans,
@@ -173,6 +323,22 @@ SampleConverterPtr SampleConverter::Create(DevFmtType srcType, DevFmtType dstTyp
         std::fill(buffer.begin(), buffer.end(), 0.0f);
     }
 
+    /* The 24-point bsinc resamplers can be replaced by a polyphase table for
+     * rates with a simple enough ratio, like 44.1khz <-> 48khz, which has a
+     * similar quality and keeps exact positions without interpolating between
+     * filter phases.
+     */
+    if(srcRate != dstRate && resampler >= Resampler::FastBSinc24)
+    {
+        if(auto table = GetPhaseTable(srcRate, dstRate))
+        {
+            converter->mFracOne = table->mP;
+            converter->mIncrement = table->mQ;
+            converter->mPhaseTable = std::move(table);
+            return converter;
+        }
+    }
+
     /* Have to set the mixer FPU mode since that's what the resampler code expects. */
     FPUCtl mixer_mode{};
     auto step = static_cast<uint>(
@@ -206,7 +372,7 @@ uint SampleConverter::availableOut(uint srcframes) const
     uint64_t DataSize64{prepcount};
     DataSize64 += srcframes;
     DataSize64 -= MaxResamplerPadding;
-    DataSize64 <<= MixerFracBits;
+    DataSize64 *= mFracOne;
     DataSize64 -= mFracOffset;
 
     /* If we have a full prep, we can generate at least one sample. */
@@ -219,6 +385,7 @@ uint SampleConverter::convert(const void **src, uint *srcframes, void *dst, uint
     const uint SrcFrameSize{static_cast<uint>(mChan.size()) * mSrcTypeSize};
     const uint DstFrameSize{static_cast<uint>(mChan.size()) * mDstTypeSize};
     const uint increment{mIncrement};
+    const uint fracone{mFracOne};
     auto SamplesIn = static_cast<const std::byte*>(*src);
     uint NumSrcSamples{*srcframes};
 
@@ -249,7 +416,7 @@ uint SampleConverter::convert(const void **src, uint *srcframes, void *dst, uint
         uint64_t DataSize64{prepcount};
         DataSize64 += readable;
         DataSize64 -= MaxResamplerPadding;
-        DataSize64 <<= MixerFracBits;
+        DataSize64 *= fracone;
         DataSize64 -= DataPosFrac;
 
         /* If we have a full prep, we can generate at least one sample. */
@@ -258,7 +425,7 @@ uint SampleConverter::convert(const void **src, uint *srcframes, void *dst, uint
         DstSize = minu(DstSize, dstframes-pos);
 
         const uint DataPosEnd{DstSize*increment + DataPosFrac};
-        const uint SrcDataEnd{DataPosEnd>>MixerFracBits};
+        const uint SrcDataEnd{DataPosEnd / fracone};
 
         assert(prepcount+readable >= SrcDataEnd);
         const uint nextprep{minu(prepcount + readable - SrcDataEnd, MaxResamplerPadding)};
@@ -282,8 +449,12 @@ uint SampleConverter::convert(const void **src, uint *srcframes, void *dst, uint
                 std::end(mChan[chan].PrevSamples), 0.0f);
 
             /* Now resample, and store the result in the output buffer. */
-            mResample(&mState, SrcData+MaxResamplerEdge, DataPosFrac, increment,
-                {DstData, DstSize});
+            if(mPhaseTable)
+                ResamplePolyphase(*mPhaseTable, SrcData+MaxResamplerEdge, DataPosFrac,
+                    increment, {DstData, DstSize});
+            else
+                mResample(&mState, SrcData+MaxResamplerEdge, DataPosFrac, increment,
+                    {DstData, DstSize});
 
             StoreSamples(DstSamples, DstData, mChan.size(), mDstType, DstSize);
         }
@@ -292,7 +463,7 @@ uint SampleConverter::convert(const void **src, uint *srcframes, void *dst, uint
          * fractional offset.
          */
         mSrcPrepCount = nextprep;
-        mFracOffset = DataPosEnd & MixerFracMask;
+        mFracOffset = DataPosEnd % fracone;
 
         /* Update the src and dst pointers in case there's still more to do. */
         const uint srcread{minu(NumSrcSamples, SrcDataEnd + mSrcPrepCount - prepcount)};
@@ -310,6 +481,107 @@ uint SampleConverter::convert(const void **src, uint *srcframes, void *dst, uint
 }
 
 
+std::unique_ptr<OutputUpsampler> OutputUpsampler::Create(size_t numchans, uint srcRate,
+    uint dstRate)
+{
+    if(numchans < 1 || srcRate < 1 || srcRate >= dstRate)
+        return nullptr;
+
+    std::unique_ptr<OutputUpsampler> upsampler{new(FamCount(numchans)) OutputUpsampler{numchans}};
+
+    /* Start with enough silence before the first mixed sample for the
+     * resampler's history, so the output isn't delayed beyond the look-ahead.
+     */
+    upsampler->mInputCount = MaxResamplerEdge;
+    upsampler->mFracOffset = 0;
+    for(auto &chan : upsampler->mChan)
+        std::fill(std::begin(chan.Input), std::end(chan.Input), 0.0f);
+
+    /* Prefer an exact polyphase table for the ratio, like the sample
+     * converter, falling back to the 24-point bsinc resampler.
+     */
+    if(auto table = GetPhaseTable(srcRate, dstRate))
+    {
+        upsampler->mFracOne = table->mP;
+        upsampler->mIncrement = table->mQ;
+        upsampler->mPhaseTable = std::move(table);
+        return upsampler;
+    }
+
+    FPUCtl mixer_mode{};
+    const auto step = static_cast<uint>(srcRate*double{MixerFracOne}/dstRate + 0.5);
+    upsampler->mIncrement = maxu(step, 1);
+    upsampler->mResample = PrepareResampler(Resampler::BSinc24, upsampler->mIncrement,
+        &upsampler->mState);
+    return upsampler;
+}
+
+uint OutputUpsampler::inputNeeded(uint dstframes) const noexcept
+{
+    if(dstframes < 1)
+        return 0;
+
+    /* The last output sample needs the resampler's full padding around its
+     * position.
+     */
+    const uint lastpos{(mFracOffset + (dstframes-1)*mIncrement) / mFracOne};
+    const uint needed{lastpos + MaxResamplerPadding + 1};
+    if(needed <= mInputCount)
+        return 0;
+    return minu(needed - mInputCount, MaxResamplerPadding + BufferLineSize - mInputCount);
+}
+
+void OutputUpsampler::addInput(const al::span<const FloatBufferLine> src, uint frames) noexcept
+{
+    frames = minu(frames, MaxResamplerPadding + BufferLineSize - mInputCount);
+    for(size_t chan{0u};chan < mChan.size();++chan)
+        std::copy_n(src[chan].begin(), frames, mChan[chan].Input + mInputCount);
+    mInputCount += frames;
+}
+
+uint OutputUpsampler::process(uint dstframes) noexcept
+{
+    if(mInputCount <= MaxResamplerPadding)
+        return 0;
+
+    const uint increment{mIncrement};
+    const uint fracone{mFracOne};
+    const uint DataPosFrac{mFracOffset};
+
+    uint64_t DataSize64{mInputCount - MaxResamplerPadding};
+    DataSize64 *= fracone;
+    DataSize64 -= DataPosFrac;
+    const auto DstSize = static_cast<uint>(minu64((DataSize64 + increment-1)/increment,
+        minu(dstframes, BufferLineSize)));
+    if(DstSize < 1)
+        return 0;
+
+    const uint DataPosEnd{DstSize*increment + DataPosFrac};
+    const uint SrcDataEnd{DataPosEnd / fracone};
+
+    for(size_t chan{0u};chan < mChan.size();++chan)
+    {
+        float *RESTRICT SrcData{mChan[chan].Input};
+        const al::span<float> DstData{mOutput[chan].data(), DstSize};
+
+        if(mPhaseTable)
+            ResamplePolyphase(*mPhaseTable, SrcData+MaxResamplerEdge, DataPosFrac, increment,
+                DstData);
+        else
+            mResample(&mState, SrcData+MaxResamplerEdge, DataPosFrac, increment, DstData);
+
+        /* Keep the unused input, including the history for the next output
+         * sample.
+         */
+        std::copy(SrcData+SrcDataEnd, SrcData+mInputCount, SrcData);
+    }
+    mInputCount -= SrcDataEnd;
+    mFracOffset = DataPosEnd % fracone;
+
+    return DstSize;
+}
+
+
 void ChannelConverter::convert(const void *src, float *dst, uint frames) const
 {
     if(mDstChans == DevFmtMono)
@@ -6,11 +6,16 @@
 #include <memory>
 
 #include "almalloc.h"
+#include "alspan.h"
+#include "bufferline.h"
 #include "devformat.h"
 #include "mixer/defs.h"
+#include "vector.h"
 
 using uint = unsigned int;
 
+struct PPhaseTable;
+
 
 struct SampleConverter {
     DevFmtType mSrcType{};
@@ -20,10 +25,16 @@ struct SampleConverter {
 
     uint mSrcPrepCount{};
 
+    /* The fractional offset and increment are in units of 1/mFracOne input
+     * samples. That's normally MixerFracOne, or the number of phases when
+     * resampling with a polyphase table.
+     */
+    uint mFracOne{MixerFracOne};
     uint mFracOffset{};
     uint mIncrement{};
     InterpState mState{};
     ResamplerFunc mResample{};
+    std::shared_ptr<const PPhaseTable> mPhaseTable;
 
     alignas(16) float mSrcSamples[BufferLineSize]{};
     alignas(16) float mDstSamples[BufferLineSize]{};
@@ -42,7 +53,8 @@ struct SampleConverter {
     SampleOffset currentInputDelay() const noexcept
     {
         const int64_t prep{int64_t{mSrcPrepCount} - MaxResamplerEdge};
-        return SampleOffset{(prep<<MixerFracBits) + mFracOffset};
+        const int64_t frac{int64_t{mFracOffset} * MixerFracOne / mFracOne};
+        return SampleOffset{(prep<<MixerFracBits) + frac};
     }
 
     static std::unique_ptr<SampleConverter> Create(DevFmtType srcType, DevFmtType dstType,
@@ -52,6 +64,53 @@ struct SampleConverter {
 };
 using SampleConverterPtr = std::unique_ptr<SampleConverter>;
 
+/* Upsamples the device's planar float mix to its output rate, for when the
+ * mixer runs at a lower rate than the device. The mixed samples are given as
+ * needed to fill each output update, and the resampler's history is kept
+ * between them.
+ */
+struct OutputUpsampler {
+    uint mFracOne{MixerFracOne};
+    uint mFracOffset{};
+    uint mIncrement{};
+    InterpState mState{};
+    ResamplerFunc mResample{};
+    std::shared_ptr<const PPhaseTable> mPhaseTable;
+
+    /* The number of mixed samples held for each channel, which includes the
+     * resampler's history before the next output sample.
+     */
+    uint mInputCount{};
+
+    /* The upsampled output, one line for each channel. */
+    al::vector<FloatBufferLine,16> mOutput;
+
+    struct ChanSamples {
+        alignas(16) float Input[MaxResamplerPadding + BufferLineSize];
+    };
+    al::FlexArray<ChanSamples> mChan;
+
+    OutputUpsampler(size_t numchans) : mOutput(numchans), mChan{numchans} { }
+
+    /** Returns how many more mixed samples are needed for dstframes output. */
+    uint inputNeeded(uint dstframes) const noexcept;
+    /** Appends mixed samples for each channel. */
+    void addInput(const al::span<const FloatBufferLine> src, uint frames) noexcept;
+    /**
+     * Resamples up to dstframes (at most BufferLineSize) into the output
+     * lines, returning the number written.
+     */
+    uint process(uint dstframes) noexcept;
+
+    /** The look-ahead the resampler needs, in mixed samples. */
+    static constexpr uint getDelay() noexcept { return MaxResamplerEdge; }
+
+    static std::unique_ptr<OutputUpsampler> Create(size_t numchans, uint srcRate,
+        uint dstRate);
+
+    DEF_FAM_NEWDEL(OutputUpsampler, mChan)
+};
+
 struct ChannelConverter {
     DevFmtType mSrcType{};
     uint mSrcStep{};
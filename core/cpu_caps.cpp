@@ -36,6 +36,21 @@ inline std::array<reg_type,4> get_cpuid(unsigned int f)
     __get_cpuid(f, ret.data(), &ret[1], &ret[2], &ret[3]);
     return ret;
 }
+inline std::array<reg_type,4> get_cpuid_count(unsigned int f, unsigned int subf)
+{
+    std::array<reg_type,4> ret{};
+    __cpuid_count(f, subf, ret[0], ret[1], ret[2], ret[3]);
+    return ret;
+}
+/* Get the OS-enabled register state mask, to check that the OS saves the AVX
+ * registers on context switches.
+ */
+inline unsigned long long get_xcr0()
+{
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx)<<32) | eax;
+}
 #define CAN_GET_CPUID
 #elif defined(HAVE_CPUID_INTRINSIC) \
     && (defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64))
@@ -46,11 +61,21 @@ inline std::array<reg_type,4> get_cpuid(unsigned int f)
     (__cpuid)(ret.data(), f);
     return ret;
 }
+inline std::array<reg_type,4> get_cpuid_count(unsigned int f, unsigned int subf)
+{
+    std::array<reg_type,4> ret{};
+    (__cpuidex)(ret.data(), static_cast<int>(f), static_cast<int>(subf));
+    return ret;
+}
+inline unsigned long long get_xcr0()
+{ return _xgetbv(0); }
 #define CAN_GET_CPUID
 #endif
 
 } // namespace
 
+CPUInfo::~CPUInfo() = default;
+
 std::optional<CPUInfo> GetCPUInfo()
 {
     CPUInfo ret;
@@ -106,6 +131,27 @@ std::optional<CPUInfo> GetCPUInfo()
             ret.mCaps |= CPU_CAP_SSE3;
         if((ret.mCaps&CPU_CAP_SSE3) && (cpuregs[2]&(1<<19)))
             ret.mCaps |= CPU_CAP_SSE4_1;
+
+        /* AVX2 and FMA need the OS to have enabled the XMM and YMM register
+         * state (OSXSAVE set, and XCR0 bits 1 and 2).
+         */
+        const bool has_avx{(ret.mCaps&CPU_CAP_SSE4_1) && (cpuregs[2]&(1<<27))
+            && (cpuregs[2]&(1<<28)) && (get_xcr0()&0x6) == 0x6};
+        if(has_avx && (cpuregs[2]&(1<<12)))
+            ret.mCaps |= CPU_CAP_FMA;
+        if(has_avx && (cpuregs[2]&(1<<29)))
+            ret.mCaps |= CPU_CAP_F16C;
+        if(has_avx && maxfunc >= 7)
+        {
+            cpuregs = get_cpuid_count(7, 0);
+            if((cpuregs[1]&(1<<5)))
+                ret.mCaps |= CPU_CAP_AVX2;
+            /* AVX-512 also needs the opmask and ZMM register state enabled
+             * (XCR0 bits 5 through 7).
+             */
+            if((ret.mCaps&CPU_CAP_AVX2) && (cpuregs[1]&(1<<16)) && (get_xcr0()&0xe0) == 0xe0)
+                ret.mCaps |= CPU_CAP_AVX512;
+        }
     }
 
 #else
@@ -12,12 +12,21 @@ enum {
     CPU_CAP_SSE3   = 1<<2,
     CPU_CAP_SSE4_1 = 1<<3,
     CPU_CAP_NEON   = 1<<4,
+    CPU_CAP_AVX2   = 1<<5,
+    CPU_CAP_FMA    = 1<<6,
+    CPU_CAP_AVX512 = 1<<7,
+    CPU_CAP_F16C   = 1<<8,
 };
 
 struct CPUInfo {
     std::string mVendor;
     std::string mName;
     int mCaps{0};
+
+    CPUInfo() = default;
+    CPUInfo(CPUInfo&&) = default;
+    ~CPUInfo();
+    CPUInfo& operator=(CPUInfo&&) = default;
 };
 
 std::optional<CPUInfo> GetCPUInfo();
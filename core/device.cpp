@@ -1,23 +1,180 @@
 
 #include "config.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+
 #include "bformatdec.h"
 #include "bs2b.h"
+#include "converter.h"
 #include "device.h"
 #include "front_stablizer.h"
+#include "helpers.h"
 #include "hrtf.h"
 #include "mastering.h"
+#include "mixer_pool.h"
+#include "ringbuffer.h"
 
 
 al::FlexArray<ContextBase*> DeviceBase::sEmptyContextArray{0u};
 
+al::page_policy DeviceBase::sMixPagePolicy{al::page_policy::Normal};
+
+
+namespace {
+
+constexpr size_t HrtfAccumOffset{(sizeof(VoiceMixScratch)+15) & ~size_t{15}};
+
+/* The scratch storage and HRTF accumulation buffer are large and accessed
+ * with every mix, so allocate them together using the mixing page policy. The
+ * scratch storage is default-initialized to avoid touching the pages (the
+ * memory starts zeroed).
+ */
+al::page_buffer AllocMixStorage()
+{
+    return al::page_buffer{HrtfAccumOffset + sizeof(float2)*DeviceBase::HrtfAccumSize,
+        DeviceBase::sMixPagePolicy};
+}
+
+} // namespace
 
-DeviceBase::DeviceBase(DeviceType type) : Type{type}, mContexts{&sEmptyContextArray}
+
+void MixerProfile::reset() noexcept
 {
+    mPeriods.store(0u, std::memory_order_relaxed);
+    mOverruns.store(0u, std::memory_order_relaxed);
+    mUpdateTime.store(0u, std::memory_order_relaxed);
+    mVoiceTime.store(0u, std::memory_order_relaxed);
+    mEffectTime.store(0u, std::memory_order_relaxed);
+    mPostProcessTime.store(0u, std::memory_order_relaxed);
+    mActiveVoices.store(0u, std::memory_order_relaxed);
+    mVirtualVoices.store(0u, std::memory_order_relaxed);
+    mInstancedVoices.store(0u, std::memory_order_relaxed);
+    mHrtfBlends.store(0u, std::memory_order_relaxed);
+    mHrtfHeldUpdates.store(0u, std::memory_order_relaxed);
+}
+
+
+void MixGovernor::reset() noexcept
+{
+    mQuality.store(MixQuality::Full, std::memory_order_relaxed);
+    mLoad = 0.0f;
+    mHoldSamples = 0u;
+    mCalmSamples = 0u;
+}
+
+bool MixGovernor::update(const std::chrono::nanoseconds mixTime, const uint samples,
+    const uint frequency) noexcept
+{
+    /* Step down when the load gets above HighLoad, waiting a moment after
+     * each step for it to take effect. Step back up after the load has been
+     * below LowLoad for a couple seconds.
+     */
+    static constexpr float HighLoad{0.8f};
+    static constexpr float LowLoad{0.4f};
+
+    if(mMinQuality == MixQuality::Full || samples == 0)
+        return false;
+
+    const float playTime{static_cast<float>(samples) / static_cast<float>(frequency)};
+    const float load{std::chrono::duration<float>{mixTime}.count() / playTime};
+    mLoad += (load - mLoad) * 0.25f;
+
+    mHoldSamples = (mHoldSamples < frequency) ? mHoldSamples+samples : mHoldSamples;
+    if(mLoad >= LowLoad)
+        mCalmSamples = 0u;
+    else if(mCalmSamples < frequency*2u)
+        mCalmSamples += samples;
+
+    const auto quality = mQuality.load(std::memory_order_relaxed);
+    if(mLoad > HighLoad && quality < mMinQuality)
+    {
+        if(mHoldSamples < frequency/20u)
+            return false;
+        mQuality.store(static_cast<MixQuality>(al::to_underlying(quality)+1),
+            std::memory_order_relaxed);
+        mHoldSamples = 0u;
+        return true;
+    }
+    if(quality > MixQuality::Full && mCalmSamples >= frequency*2u)
+    {
+        mQuality.store(static_cast<MixQuality>(al::to_underlying(quality)-1),
+            std::memory_order_relaxed);
+        mCalmSamples = 0u;
+        return true;
+    }
+    return false;
+}
+
+
+DeviceBase::DeviceBase(DeviceType type)
+  : Type{type}, mMixStorage{AllocMixStorage()}
+  , mMixScratch{*::new(mMixStorage.data()) VoiceMixScratch}
+  , HrtfAccumData{reinterpret_cast<float2*>(static_cast<char*>(mMixStorage.data())
+        + HrtfAccumOffset)}
+  , mContexts{&sEmptyContextArray}
+{
+    mMixScratch.HrtfAccumData = HrtfAccumData;
 }
 
 DeviceBase::~DeviceBase()
 {
+    for(const RetiredObject &retired : mRetiredObjects)
+        retired.mDelete(retired.mObject);
+    mRetiredObjects.clear();
+
+    std::destroy_at(&mMixScratch);
     auto *oldarray = mContexts.exchange(nullptr, std::memory_order_relaxed);
     if(oldarray != &sEmptyContextArray) delete oldarray;
 }
+
+void DeviceBase::setupMixerThread() const
+{
+    const std::vector<uint> &cpus = !mMixerAffinity.empty() ? mMixerAffinity
+        : ThreadAffinity[static_cast<size_t>(ThreadRole::Mixer)];
+    if(!cpus.empty())
+        SetThreadCpuAffinity(cpus);
+
+    if(UseRTDeadline && Frequency > 0)
+    {
+        /* Ask for half of each update period to mix the update in. */
+        const uint64_t period{uint64_t{UpdateSize} * 1'000'000'000u / Frequency};
+        if(SetRTDeadline(period/2, period))
+            return;
+    }
+    SetRTPriority();
+}
+
+void DeviceBase::updateHrtfMemory() noexcept
+{
+    size_t bytes{0};
+    if(mHrtf) bytes += mHrtf->memoryUsage();
+    if(mHrtfState) bytes += mHrtfState->memoryUsage();
+    mHrtfMemory.set(mMemoryStats, MemCategory::Hrtf, bytes);
+}
+
+void DeviceBase::retireObject(void *object, void (*deleter)(void*) noexcept)
+{
+    /* A mix that started before the object was replaced is still running if
+     * the mix count is odd and unchanged since.
+     */
+    const uint mixcount{MixCount.load(std::memory_order_acquire)};
+
+    std::lock_guard<std::mutex> _{mRetiredLock};
+    auto iter = std::remove_if(mRetiredObjects.begin(), mRetiredObjects.end(),
+        [mixcount](const RetiredObject &retired) noexcept -> bool
+        {
+            if(retired.mMixCount == mixcount)
+                return false;
+            retired.mDelete(retired.mObject);
+            return true;
+        });
+    mRetiredObjects.erase(iter, mRetiredObjects.end());
+
+    if(!(mixcount&1))
+        deleter(object);
+    else
+        mRetiredObjects.emplace_back(RetiredObject{mixcount, object, deleter});
+}
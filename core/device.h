@@ -5,10 +5,14 @@
 #include <atomic>
 #include <bitset>
 #include <chrono>
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <stddef.h>
 #include <stdint.h>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "almalloc.h"
 #include "alspan.h"
@@ -18,6 +22,8 @@
 #include "devformat.h"
 #include "filters/nfc.h"
 #include "intrusive_ptr.h"
+#include "memory_stats.h"
+#include "mixer/defs.h"
 #include "mixer/hrtfdefs.h"
 #include "opthelpers.h"
 #include "resampler_limits.h"
@@ -27,9 +33,13 @@
 class BFormatDec;
 struct bs2b;
 struct Compressor;
+struct ConvolutionFilter;
 struct ContextBase;
 struct DirectHrtfState;
 struct HrtfStore;
+class MixerPool;
+struct OutputUpsampler;
+struct RingBuffer;
 
 using uint = unsigned int;
 
@@ -79,6 +89,8 @@ struct DistanceComp {
     struct ChanData {
         float Gain{1.0f};
         uint Length{0u}; /* Valid range is [0...MaxDelay). */
+        /* The delay line is circular, with the oldest sample at Pos. */
+        uint Pos{0u};
         float *Buffer{nullptr};
     };
 
@@ -139,6 +151,283 @@ struct MixParams {
     }
 };
 
+/* A cache of decoded ADPCM samples, so voices playing the same ADPCM buffer
+ * don't each need to decode it. Each entry holds the samples of one channel
+ * for a chunk of whole blocks. The entries are grouped into sets, with each
+ * chunk belonging to one set where the least recently used entry is replaced
+ * when a new chunk is needed.
+ */
+struct AdpcmCache {
+    static constexpr size_t ChunkSamples{512};
+    static constexpr size_t NumSets{32};
+    static constexpr size_t NumWays{4};
+
+    struct Entry {
+        const std::byte *mData{nullptr};
+        size_t mChannel{0};
+        size_t mChunk{0};
+        uint mLastUse{0};
+        alignas(16) std::array<float,ChunkSamples> mSamples;
+    };
+    std::array<std::array<Entry,NumWays>,NumSets> mSets;
+
+    /* The device's ADPCM generation the entries are valid for. */
+    uint mGeneration{0};
+    uint mUseCount{0};
+
+    /* Clears the cache if the generation changed. */
+    void sync(const uint generation) noexcept
+    {
+        if(generation == mGeneration) LIKELY return;
+        for(auto &entries : mSets)
+        {
+            for(Entry &entry : entries)
+                entry.mData = nullptr;
+        }
+        mGeneration = generation;
+    }
+
+    /* Returns the entry for the given chunk, and whether it already holds the
+     * decoded samples. If not, the returned entry is reset for the samples to
+     * be decoded into.
+     */
+    std::pair<Entry*,bool> get(const std::byte *data, const size_t channel, const size_t chunk)
+        noexcept
+    {
+        /* Consecutive chunks go to consecutive sets. */
+        const size_t setidx{((reinterpret_cast<uintptr_t>(data)>>6) + channel*(NumSets/2+1)
+            + chunk) % NumSets};
+        const uint curUse{++mUseCount};
+        Entry *victim{nullptr};
+        for(Entry &entry : mSets[setidx])
+        {
+            if(entry.mData == data && entry.mChannel == channel && entry.mChunk == chunk)
+            {
+                entry.mLastUse = curUse;
+                return {&entry, true};
+            }
+            /* Prefer unused entries, then the least recently used. */
+            if(!victim || (victim->mData && (!entry.mData
+                || curUse-entry.mLastUse > curUse-victim->mLastUse)))
+                victim = &entry;
+        }
+        victim->mData = data;
+        victim->mChannel = channel;
+        victim->mChunk = chunk;
+        victim->mLastUse = curUse;
+        return {victim, false};
+    }
+};
+
+/* Cache of static buffer samples resampled for the device, used by voices
+ * playing them at a fixed pitch so the sounds played by multiple voices don't
+ * each need to be resampled. Each entry holds the resampled samples of one
+ * channel for a chunk of output, as played from the start of the buffer with
+ * a given pitch step. The entries are grouped into sets like the ADPCM cache,
+ * with the number of entries set when the device is reset (none by default,
+ * disabling the cache).
+ */
+struct ResampleCache {
+    static constexpr size_t ChunkSamples{1024};
+    static constexpr size_t NumWays{4};
+
+    struct Entry {
+        const std::byte *mData{nullptr};
+        /* The sample type and frame step the data is read with. */
+        uint mFormat{0};
+        uint mIncrement{0};
+        size_t mChannel{0};
+        size_t mChunk{0};
+        uint mLastUse{0};
+        alignas(16) std::array<float,ChunkSamples> mSamples;
+    };
+    al::vector<Entry,16> mEntries;
+
+    /* The device's buffer generation the entries are valid for. */
+    uint mGeneration{0};
+    uint mUseCount{0};
+
+    bool enabled() const noexcept { return !mEntries.empty(); }
+
+    /* Reallocates the cache for the given number of entries, rounded down to
+     * whole sets, clearing it.
+     */
+    void resize(const size_t numEntries)
+    {
+        mEntries.clear();
+        mEntries.resize(numEntries / NumWays * NumWays);
+    }
+
+    /* Clears the cache if the generation changed. */
+    void sync(const uint generation) noexcept
+    {
+        if(generation == mGeneration) LIKELY return;
+        for(Entry &entry : mEntries)
+            entry.mData = nullptr;
+        mGeneration = generation;
+    }
+
+    /* Returns the entry for the given chunk, and whether it already holds the
+     * resampled samples. If not, the returned entry is reset for the samples
+     * to be resampled into.
+     */
+    std::pair<Entry*,bool> get(const std::byte *data, const uint format, const uint increment,
+        const size_t channel, const size_t chunk) noexcept
+    {
+        const size_t numSets{mEntries.size() / NumWays};
+        /* Consecutive chunks go to consecutive sets. */
+        const size_t setidx{((reinterpret_cast<uintptr_t>(data)>>6) + increment
+            + channel*(numSets/2+1) + chunk) % numSets};
+        const uint curUse{++mUseCount};
+        const al::span<Entry> entries{&mEntries[setidx*NumWays], NumWays};
+        Entry *victim{nullptr};
+        for(Entry &entry : entries)
+        {
+            if(entry.mData == data && entry.mFormat == format && entry.mIncrement == increment
+                && entry.mChannel == channel && entry.mChunk == chunk)
+            {
+                entry.mLastUse = curUse;
+                return {&entry, true};
+            }
+            /* Prefer unused entries, then the least recently used. */
+            if(!victim || (victim->mData && (!entry.mData
+                || curUse-entry.mLastUse > curUse-victim->mLastUse)))
+                victim = &entry;
+        }
+        victim->mData = data;
+        victim->mFormat = format;
+        victim->mIncrement = increment;
+        victim->mChannel = channel;
+        victim->mChunk = chunk;
+        victim->mLastUse = curUse;
+        return {victim, false};
+    }
+};
+
+/* Samples loaded and resampled by static voices in the current mix. Voices
+ * playing the same buffer data from the same position, with the same step,
+ * resampler, and sample history, share them instead of each loading their
+ * own, leaving only the filtering and panning to be done per voice. A few
+ * recent loads are kept, replacing the oldest.
+ */
+struct VoiceInstanceCache {
+    static constexpr size_t NumSlots{4};
+    static constexpr size_t MaxChannels{2};
+    using HistoryLine = std::array<float,MaxResamplerPadding>;
+
+    struct Slot {
+        /* The device time of the mix the samples were loaded for. */
+        std::chrono::nanoseconds mTime{std::chrono::nanoseconds::min()};
+
+        const std::byte *mData{nullptr};
+        uint mFormat{0};
+        uint mNumChannels{0};
+        uint mSampleLen{0};
+        uint mLoopStart{0};
+        uint mLoopEnd{0};
+        bool mLooping{false};
+        int mPosInt{0};
+        uint mPosFrac{0};
+        uint mIncrement{0};
+        ResamplerFunc mResampler{nullptr};
+        InterpState mResampleState{};
+        uint mSamplesToLoad{0};
+
+        /* The voice's sample history before and after loading. */
+        std::array<HistoryLine,MaxChannels> mPrevBefore;
+        std::array<HistoryLine,MaxChannels> mPrevAfter;
+
+        alignas(16) std::array<std::array<float,BufferLineSize>,MaxChannels> mSamples;
+    };
+    std::array<Slot,NumSlots> mSlots;
+    uint mNextSlot{0};
+};
+
+using AmbiRotateMatrix = std::array<std::array<float,MaxAmbiChannels>,MaxAmbiChannels>;
+
+/* The last B-Format rotation built, and the mix matrix upsampled from it, with
+ * the basis vectors, order, and upsampler they were made with. Ambisonic
+ * voices that share an orientation, such as beds following the listener,
+ * reuse them instead of rebuilding each one.
+ */
+struct AmbiRotateCache {
+    AmbiRotateMatrix mRotate{};
+    AmbiRotateMatrix mMix{};
+    std::array<float,9> mBasis{};
+    uint mOrder{~0u};
+    const void *mUpsampler{nullptr};
+};
+
+/* Band-limited sinc resampler states prepared for recent voice steps. Pitch
+ * and doppler changes give voices a new step with most updates, so the steps
+ * are quantized and those that fall in the same range share a prepared state.
+ */
+struct ResamplerStateCache {
+    /* The number of fractional step bits dropped, sharing a state for steps
+     * within about 0.1% of each other.
+     */
+    static constexpr uint QuantizeBits{6};
+    static constexpr size_t NumEntries{64};
+
+    struct Entry {
+        uint mKey{~0u};
+        Resampler mResampler{Resampler::Point};
+        InterpState mState{};
+    };
+    std::array<Entry,NumEntries> mEntries{};
+};
+
+/* Temporary storage and output placement used for mixing voices. The device
+ * has one for the mixer thread, and each worker thread used for mixing has
+ * its own.
+ */
+struct VoiceMixScratch {
+    static constexpr size_t MixerLineSize{BufferLineSize + DecoderBase::sMaxPadding};
+    static constexpr size_t MixerChannelsMax{16};
+    using MixerBufferLine = std::array<float,MixerLineSize>;
+    alignas(16) std::array<MixerBufferLine,MixerChannelsMax> mSampleData;
+    alignas(16) std::array<float,MixerLineSize+MaxResamplerPadding> mResampleData;
+
+    /* Filtered samples for a batch of a voice's outputs. */
+    static constexpr size_t FilterLinesMax{4};
+    alignas(16) std::array<std::array<float,BufferLineSize>,FilterLinesMax> FilteredData;
+    union {
+        alignas(16) float HrtfSourceData[BufferLineSize + HrtfHistoryLength];
+        alignas(16) float NfcSampleData[MaxAmbiOrder][BufferLineSize];
+    };
+
+    /* Accumulation buffer for direct HRTF mixing. */
+    float2 *HrtfAccumData{nullptr};
+
+    AdpcmCache mAdpcmCache;
+    ResampleCache mResampleCache;
+    VoiceInstanceCache mInstanceCache;
+
+    /* Rotation matrices and resampler states for the voices' parameter
+     * updates on this thread.
+     */
+    AmbiRotateCache mAmbiRotation;
+    ResamplerStateCache mResamplerStates;
+
+    /* The index of the mixing thread this is used with (0 for the device's
+     * mixer thread), and the offset from the device's dry/real output buffer
+     * lines to this thread's copy.
+     */
+    uint mThreadIndex{0};
+    size_t mDryOffset{0};
+
+    /* Returns this thread's copy of a dry/real output buffer target. */
+    al::span<FloatBufferLine> getDryTarget(const al::span<FloatBufferLine> target) const noexcept
+    { return {target.data() + mDryOffset, target.size()}; }
+
+    /* Returns this thread's copy of an effect slot's wet buffer. Each slot
+     * allocates a copy of its wet buffer for each mixing thread, directly
+     * after the first.
+     */
+    al::span<FloatBufferLine> getWetTarget(const al::span<FloatBufferLine> target) const noexcept
+    { return {target.data() + target.size()*mThreadIndex, target.size()}; }
+};
+
 struct RealMixParams {
     al::span<const InputRemixMap> RemixMap;
     std::array<uint,MaxChannels> ChannelIndex{};
@@ -146,8 +435,6 @@ struct RealMixParams {
     al::span<FloatBufferLine> Buffer;
 };
 
-using AmbiRotateMatrix = std::array<std::array<float,MaxAmbiChannels>,MaxAmbiChannels>;
-
 enum {
     // Frequency was requested by the app or config file
     FrequencyRequest,
@@ -165,9 +452,109 @@ enum {
     // ear buds, etc).
     DirectEar,
 
+    // Specifies if effect slots with identical reverb properties and output
+    // can sum their input and share one reverb instance.
+    ShareReverbSlots,
+
     DeviceFlagsCount
 };
 
+/* Running totals of the mixer's work, updated by the mixer thread for each
+ * mix. Times are in nanoseconds.
+ */
+struct MixerProfile {
+    std::atomic<uint64_t> mPeriods{0u};
+    /* Mixes that took longer than the duration of the samples they produced. */
+    std::atomic<uint64_t> mOverruns{0u};
+
+    std::atomic<uint64_t> mUpdateTime{0u};
+    std::atomic<uint64_t> mVoiceTime{0u};
+    std::atomic<uint64_t> mEffectTime{0u};
+    std::atomic<uint64_t> mPostProcessTime{0u};
+
+    /* HRTF filter blends mixed for voice channels, and filter updates skipped
+     * for being under the HRTF hysteresis.
+     */
+    std::atomic<uint64_t> mHrtfBlends{0u};
+    std::atomic<uint64_t> mHrtfHeldUpdates{0u};
+
+    /* The number of voices mixed and kept virtual in the last mix. */
+    std::atomic<uint> mActiveVoices{0u};
+    std::atomic<uint> mVirtualVoices{0u};
+
+    /* Voices that shared another voice's loaded samples instead of loading
+     * their own.
+     */
+    std::atomic<uint64_t> mInstancedVoices{0u};
+
+    void reset() noexcept;
+};
+
+/* The profile of a single mix, as stored in the profile history. */
+struct MixerProfileRecord {
+    int64_t ClockTime; /* Device clock time at the end of the mix. */
+    int64_t UpdateTime;
+    int64_t VoiceTime;
+    int64_t EffectTime;
+    int64_t PostProcessTime;
+    int64_t ActiveVoices;
+    int64_t VirtualVoices;
+    int64_t Overrun;
+};
+
+/* The mixing quality levels the load governor steps through, from best to
+ * cheapest. Each level includes the reductions of the levels before it.
+ */
+enum class MixQuality : uint8_t {
+    Full,
+    /* Sinc resamplers are limited to the 12-point fast bsinc resampler. */
+    FastResampler,
+    /* All resamplers are limited to linear. */
+    LinearResampler,
+    /* Voices past the voice limit, the lowest priority first, are kept
+     * virtual.
+     */
+    VoiceLimit,
+};
+
+/* Steps the mixing quality down when mixes take close to as long as the
+ * samples they produce, and back up once they've had enough headroom for a
+ * while. Only the mixer updates it.
+ */
+struct MixGovernor {
+    /* The lowest quality to step down to. Full disables the governor. */
+    MixQuality mMinQuality{MixQuality::Full};
+    uint mVoiceLimit{64u};
+
+    /* The current quality, for the mixer and for the app to query. */
+    std::atomic<MixQuality> mQuality{MixQuality::Full};
+
+    /* The smoothed ratio of mix time to play time. */
+    float mLoad{0.0f};
+    /* Samples mixed since the last step down, and since the load was last
+     * above the low threshold.
+     */
+    uint mHoldSamples{0u};
+    uint mCalmSamples{0u};
+
+    void reset() noexcept;
+
+    /* Updates the load with the time taken to mix the given number of
+     * samples. Returns true if the quality changed.
+     */
+    bool update(const std::chrono::nanoseconds mixTime, const uint samples,
+        const uint frequency) noexcept;
+};
+
+/* Convolution filters prepared from buffers, which convolution effects using
+ * the same buffer share instead of each preparing their own. Entries expire
+ * with the last effect using them.
+ */
+struct ConvolutionFilterCache {
+    std::mutex mLock;
+    std::vector<std::weak_ptr<const ConvolutionFilter>> mFilters;
+};
+
 struct DeviceBase {
     /* To avoid extraneous allocations, a 0-sized FlexArray<ContextBase*> is
      * defined globally as a sharable object.
@@ -177,7 +564,14 @@ struct DeviceBase {
     std::atomic<bool> Connected{true};
     const DeviceType Type{};
 
+    /* Memory allocated for the device and its contexts. */
+    const std::shared_ptr<MemoryStats> mMemoryStats{std::make_shared<MemoryStats>()};
+
     uint Frequency{};
+    /* The rate the device mixes at. Normally the same as Frequency, but can be
+     * lower with the output upsampled to Frequency (see the mix-rate option).
+     */
+    uint MixFrequency{};
     uint UpdateSize{};
     uint BufferSize{};
 
@@ -217,27 +611,82 @@ struct DeviceBase {
     std::chrono::nanoseconds ClockBase{0};
     std::chrono::nanoseconds FixedLatency{0};
 
-    AmbiRotateMatrix mAmbiRotateMatrix{};
-    AmbiRotateMatrix mAmbiRotateMatrix2{};
-
     /* Temp storage used for mixer processing. */
-    static constexpr size_t MixerLineSize{BufferLineSize + DecoderBase::sMaxPadding};
-    static constexpr size_t MixerChannelsMax{16};
-    using MixerBufferLine = std::array<float,MixerLineSize>;
-    alignas(16) std::array<MixerBufferLine,MixerChannelsMax> mSampleData;
-    alignas(16) std::array<float,MixerLineSize+MaxResamplerPadding> mResampleData;
+    static constexpr size_t MixerLineSize{VoiceMixScratch::MixerLineSize};
+    static constexpr size_t MixerChannelsMax{VoiceMixScratch::MixerChannelsMax};
+    using MixerBufferLine = VoiceMixScratch::MixerBufferLine;
 
-    alignas(16) float FilteredData[BufferLineSize];
-    union {
-        alignas(16) float HrtfSourceData[BufferLineSize + HrtfHistoryLength];
-        alignas(16) float NfcSampleData[BufferLineSize];
-    };
+    /* How the mixing buffers are allocated (see the huge-pages option). */
+    static al::page_policy sMixPagePolicy;
+
+    /* Storage for mMixScratch and HrtfAccumData. */
+    al::page_buffer mMixStorage;
+    VoiceMixScratch &mMixScratch;
 
     /* Persistent storage for HRTF mixing. */
-    alignas(16) float2 HrtfAccumData[BufferLineSize + HrirLength];
+    static constexpr size_t HrtfAccumSize{BufferLineSize + HrirLength};
+    float2 *const HrtfAccumData;
+
+    /* Mixing buffer used by the Dry mix and Real output. When mixing with
+     * multiple threads, this holds a copy of the mix channels for each thread
+     * (see VoiceMixScratch::mDryOffset).
+     */
+    al::page_buffer mMixBufferStorage;
+    al::span<FloatBufferLine> MixBuffer;
+
+    /* Lines in the mixing buffer for voice clusters, with 1+NumAuxSends lines
+     * for each cluster's dry and send mixes.
+     */
+    al::span<FloatBufferLine> mClusterBuffer;
+
+    /* The number of threads used to mix voices, including the mixer thread. */
+    uint mNumMixThreads{1};
+    std::unique_ptr<MixerPool> mMixerPool;
+
+    /* The CPUs to pin the mixer thread and worker threads to, from the device
+     * attributes. When empty, the configured affinity for the role is used.
+     */
+    std::vector<uint> mMixerAffinity;
+    std::vector<uint> mWorkerAffinity;
+
+    /* Sets the calling thread's priority and affinity for mixing this device,
+     * using deadline scheduling based on the update size if enabled. Called
+     * by backends at the start of their mixer thread.
+     */
+    void setupMixerThread() const;
+
+    /* Skips mixing playing voices that are silent, only advancing them. */
+    bool mVirtualVoices{true};
+
+    /* Counts the time spent mixing each voice, for finding costly sources. */
+    bool mProfileVoices{false};
+
+    /* Loads and resamples 16-bit voices in Q15 fixed-point, for 16-bit stereo
+     * output where the extra precision isn't kept.
+     */
+    bool mLowPrecisionMix{false};
 
-    /* Mixing buffer used by the Dry mix and Real output. */
-    al::vector<FloatBufferLine, 16> MixBuffer;
+    /* Lowers the processing quality of quiet spatialized voices. */
+    bool mVoiceLod{false};
+
+    /* The distance in meters past which spatialized mono voices are mixed in
+     * clusters, or 0 to not cluster voices.
+     */
+    float mClusterDistance{0.0f};
+
+    /* The cosine of the angle an HRTF voice needs to move for its filters to
+     * be updated. Greater than 1 only keeps the filters for no movement.
+     */
+    float mHrtfHysteresis{2.0f};
+
+    /* Mixer profiling counters, and an optional history of each mix's profile
+     * for the app to read.
+     */
+    MixerProfile mProfile;
+    std::unique_ptr<RingBuffer> mProfileHistory;
+    MemoryUsage mProfileHistoryMemory;
+
+    MixGovernor mGovernor;
 
     /* The "dry" path corresponds to the main output. */
     MixParams Dry;
@@ -252,10 +701,40 @@ struct DeviceBase {
     std::unique_ptr<DirectHrtfState> mHrtfState;
     al::intrusive_ptr<HrtfStore> mHrtf;
     uint mIrSize{0};
+    MemoryUsage mHrtfMemory;
+    /* Changes with the HRTF, for voices to know when their filters are stale. */
+    uint mHrtfId{1u};
+
+    /** Counts the memory of the current HRTF and its filter state. */
+    void updateHrtfMemory() noexcept;
+
+    /* A replacement HRTF prepared off the mixer thread. The mixer swaps it
+     * with the current HRTF at the start of its next update, and sets mDone
+     * once the pending swap holds the old HRTF for the owner to release.
+     */
+    struct HrtfSwap {
+        al::intrusive_ptr<HrtfStore> mHrtf;
+        std::unique_ptr<DirectHrtfState> mState;
+        uint mIrSize{0};
+        std::atomic<bool> mDone{false};
+    };
+    std::atomic<HrtfSwap*> mPendingHrtf{nullptr};
+
+    /* A replacement output limiter, swapped in by the mixer the same way as a
+     * replacement HRTF.
+     */
+    struct LimiterSwap {
+        std::unique_ptr<Compressor> mLimiter;
+        std::atomic<bool> mDone{false};
+    };
+    std::atomic<LimiterSwap*> mPendingLimiter{nullptr};
 
     /* Ambisonic-to-UHJ encoder */
     std::unique_ptr<UhjEncoderBase> mUhjEncoder;
 
+    /* Shared phase-shift stage for Super Stereo voices. */
+    std::unique_ptr<UhjStereoBusBase> mUhjStereoBus;
+
     /* Ambisonic decoder for speakers */
     std::unique_ptr<BFormatDec> AmbiDecoder;
 
@@ -270,10 +749,21 @@ struct DeviceBase {
     /* Delay buffers used to compensate for speaker distances. */
     std::unique_ptr<DistanceComp> ChannelDelays;
 
+    /* Upsamples the finished mix from MixFrequency to Frequency, when they
+     * differ.
+     */
+    std::unique_ptr<OutputUpsampler> mOutputUpsampler;
+
     /* Dithering control. */
     float DitherDepth{0.0f};
     uint DitherSeed{0u};
 
+    /* How many samples the output has been silent with nothing left to mix.
+     * Once the post-process stages have had time to drain, mixing is skipped
+     * until something plays again.
+     */
+    uint mIdleSamples{0u};
+
     /* Running count of the mixer invocations, in 31.1 fixed point. This
      * actually increments *twice* when mixing, first at the start and then at
      * the end, so the bottom bit indicates if the device is currently mixing
@@ -281,9 +771,35 @@ struct DeviceBase {
      */
     RefCount MixCount{0u};
 
+    /* Incremented whenever ADPCM buffer data is modified, to invalidate the
+     * mixers' decoded sample caches.
+     */
+    std::atomic<uint> mAdpcmGeneration{0u};
+
+    /* Incremented whenever any buffer data is modified, to invalidate the
+     * mixers' resampled sample caches.
+     */
+    std::atomic<uint> mBufferGeneration{0u};
+
+    const std::unique_ptr<ConvolutionFilterCache> mConvolutionCache{
+        std::make_unique<ConvolutionFilterCache>()};
+
     // Contexts created on this device
     std::atomic<al::FlexArray<ContextBase*>*> mContexts{nullptr};
 
+    /* Objects replaced while the mixer may still be using them, along with
+     * the mix count when they were replaced. They're freed once the mix count
+     * shows the mix they could be used by has finished, rather than having
+     * the API thread wait for it.
+     */
+    struct RetiredObject {
+        uint mMixCount;
+        void *mObject;
+        void (*mDelete)(void*) noexcept;
+    };
+    std::mutex mRetiredLock;
+    std::vector<RetiredObject> mRetiredObjects;
+
 
     DeviceBase(DeviceType type);
     DeviceBase(const DeviceBase&) = delete;
@@ -294,6 +810,17 @@ struct DeviceBase {
     uint channelsFromFmt() const noexcept { return ChannelsFromDevFmt(FmtChans, mAmbiOrder); }
     uint frameSizeFromFmt() const noexcept { return bytesFromFmt() * channelsFromFmt(); }
 
+    /**
+     * Returns the device clock time at the start of the current update. Only
+     * valid from the mixer, or while holding the mix count.
+     */
+    std::chrono::nanoseconds getMixClockTime() const noexcept
+    {
+        using std::chrono::seconds;
+        using std::chrono::nanoseconds;
+        return ClockBase + nanoseconds{seconds{SamplesDone}}/MixFrequency;
+    }
+
     uint waitForMix() const noexcept
     {
         uint refcount;
@@ -302,6 +829,21 @@ struct DeviceBase {
         return refcount;
     }
 
+    /**
+     * Frees the given object, which must no longer be reachable by new mixes,
+     * once any mix in progress is done with it. Must be called after the
+     * object is replaced, with the deleter to free it with.
+     */
+    void retireObject(void *object, void (*deleter)(void*) noexcept);
+    template<typename T>
+    void retire(T *object)
+    { retireObject(object, [](void *ptr) noexcept { delete static_cast<T*>(ptr); }); }
+
+    /** Swaps in the pending HRTF, if any. Must be called by the mixer. */
+    void swapHrtf() noexcept;
+    /** Swaps in the pending output limiter, if any. Must be called by the mixer. */
+    void swapLimiter() noexcept;
+
     void ProcessHrtf(const size_t SamplesToDo);
     void ProcessAmbiDec(const size_t SamplesToDo);
     void ProcessAmbiDecStablized(const size_t SamplesToDo);
@@ -333,12 +875,21 @@ struct DeviceBase {
 
 private:
     uint renderSamples(const uint numSamples);
+    uint renderUpsampled(const uint numSamples);
 };
 
 /* Must be less than 15 characters (16 including terminating null) for
  * compatibility with pthread_setname_np limitations. */
 #define MIXER_THREAD_NAME "alsoft-mixer"
 
+#define MIXER_WORKER_THREAD_NAME "alsoft-mixwork"
+
 #define RECORD_THREAD_NAME "alsoft-record"
 
+#define CONVOLUTION_THREAD_NAME "alsoft-conv"
+#define HRTF_LOADER_THREAD_NAME "alsoft-hrtf"
+#define BUFFER_LOADER_THREAD_NAME "alsoft-bufload"
+#define BUFFER_PREFETCH_THREAD_NAME "alsoft-prefetch"
+#define WAVE_WRITER_THREAD_NAME "alsoft-wavewr"
+
 #endif /* CORE_DEVICE_H */
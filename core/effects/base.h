@@ -6,7 +6,9 @@
 #include "almalloc.h"
 #include "alspan.h"
 #include "atomic.h"
+#include "core/ambidefs.h"
 #include "core/bufferline.h"
+#include "core/memory_stats.h"
 #include "intrusive_ptr.h"
 
 struct BufferStorage;
@@ -173,12 +175,41 @@ struct EffectTarget {
     RealMixParams *RealOut;
 };
 
+struct EffectStateFactory;
+
 struct EffectState : public al::intrusive_ref<EffectState> {
     al::span<FloatBufferLine> mOutTarget;
 
+    /* The factory this state was created with, so a released state can be
+     * reused for another slot of the same effect type.
+     */
+    EffectStateFactory *mFactory{nullptr};
+
+    /* The storage allocated by deviceUpdate, like delay lines, counted with
+     * the device's memory.
+     */
+    MemoryUsage mMemory;
+
 
     virtual ~EffectState() = default;
 
+    /* Effects with large delay lines can size them for the properties they're
+     * used with, rather than the full range of the parameters. reserve is
+     * called with the initial properties before the first deviceUpdate, and
+     * canApply checks if the allocated lines can handle the given properties,
+     * otherwise a new state is created for them. Both are called off the
+     * mixer thread.
+     */
+    virtual void reserve(const EffectProps*) { }
+    virtual bool canApply(const EffectProps*) const noexcept { return true; }
+
+    /* The highest ambisonic order of input the effect uses. The slot's wet
+     * buffer is cut down to the channels for it, so voices only mix those and
+     * the effect only gets those as its input. Effects that only process the
+     * first (W) channel return 0.
+     */
+    virtual uint inputOrder() const noexcept { return MaxAmbiOrder; }
+
     virtual void deviceUpdate(const DeviceBase *device, const BufferStorage *buffer) = 0;
     virtual void update(const ContextBase *context, const EffectSlot *slot,
         const EffectProps *props, const EffectTarget target) = 0;
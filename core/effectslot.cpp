@@ -9,6 +9,8 @@
 #include "context.h"
 
 
+EffectSlot::~EffectSlot() = default;
+
 EffectSlotArray *EffectSlot::CreatePtrArray(size_t count) noexcept
 {
     /* Allocate space for twice as many pointers, so the mixer has scratch
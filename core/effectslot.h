@@ -77,9 +77,31 @@ struct EffectSlot {
     bool DecayHFLimit{false};
     float AirAbsorptionGainHF{1.0f};
 
-    /* Mixing buffer used by the Wet mix. */
-    al::vector<FloatBufferLine,16> mWetBuffer;
+    /* Mixing buffer used by the Wet mix, allocated with the device's mixing
+     * page policy.
+     */
+    al::page_buffer mWetBufferStorage;
+    al::span<FloatBufferLine> mWetBuffer;
+    MemoryUsage mWetBufferMemory;
+
+    /* The estimated number of samples the effect output can continue after
+     * its input goes silent, and the number of samples the input has been
+     * silent for. Once the input has been silent longer than the tail, the
+     * slot is dormant and its processing is skipped until it gets input again.
+     */
+    uint mTailSamples{0};
+    uint mSilentSamples{0};
+    /* Set when the wet buffer is known to be cleared, so it doesn't need to
+     * be cleared again before mixing.
+     */
+    bool mWetSilent{false};
+    /* Set for the update the wet buffer changes size for a new effect, so the
+     * effects and source groups outputting to the slot can follow it.
+     */
+    bool mWetResized{false};
 
+    EffectSlot() = default;
+    ~EffectSlot();
 
     static EffectSlotArray *CreatePtrArray(size_t count) noexcept;
 
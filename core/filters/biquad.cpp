@@ -10,6 +10,12 @@
 #include "alnumbers.h"
 #include "opthelpers.h"
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 
 template<typename Real>
 void BiquadFilterR<Real>::setParams(BiquadType type, Real f0norm, Real gain, Real rcpQ)
@@ -164,5 +170,337 @@ void BiquadFilterR<Real>::dualProcess(BiquadFilterR &other, const al::span<const
     other.mZ2 = z12;
 }
 
+template<typename Real>
+void BiquadFilterR<Real>::processBatch(const al::span<BiquadFilterR*const> filters,
+    const al::span<const Real*const> srcs, const al::span<Real*const> dsts, const size_t count)
+{
+    for(size_t i{0};i < filters.size();++i)
+        filters[i]->process({srcs[i], count}, dsts[i]);
+}
+
+template<>
+void BiquadFilterR<float>::processBatch(const al::span<BiquadFilterR*const> filters,
+    const al::span<const float*const> srcs, const al::span<float*const> dsts, const size_t count)
+{
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+    for(size_t base{0};base < filters.size();base += MaxBatch)
+    {
+        const size_t num{std::min(filters.size()-base, MaxBatch)};
+        if(num < 2)
+        {
+            filters[base]->process({srcs[base], count}, dsts[base]);
+            continue;
+        }
+
+        /* Each filter gets a lane of the vectors, and unused lanes process
+         * the first filter's input with a silent filter.
+         */
+        alignas(16) std::array<std::array<float,MaxBatch>,7> params{};
+        std::array<const float*,MaxBatch> src{};
+        std::fill(src.begin(), src.end(), srcs[base]);
+        for(size_t i{0};i < num;++i)
+        {
+            const BiquadFilterR &filter = *filters[base+i];
+            params[0][i] = filter.mB0;
+            params[1][i] = filter.mB1;
+            params[2][i] = filter.mB2;
+            params[3][i] = filter.mA1;
+            params[4][i] = filter.mA2;
+            params[5][i] = filter.mZ1;
+            params[6][i] = filter.mZ2;
+            src[i] = srcs[base+i];
+        }
+
+        /* Process 4 samples of each filter at a time, transposing them so
+         * each vector holds one sample from each filter.
+         */
+        size_t pos{0};
+#ifdef HAVE_SSE_INTRINSICS
+        const __m128 b0{_mm_load_ps(params[0].data())};
+        const __m128 b1{_mm_load_ps(params[1].data())};
+        const __m128 b2{_mm_load_ps(params[2].data())};
+        const __m128 a1{_mm_load_ps(params[3].data())};
+        const __m128 a2{_mm_load_ps(params[4].data())};
+        __m128 z1{_mm_load_ps(params[5].data())};
+        __m128 z2{_mm_load_ps(params[6].data())};
+        auto proc_sample = [b0,b1,b2,a1,a2,&z1,&z2](const __m128 input) noexcept -> __m128
+        {
+            const __m128 output{_mm_add_ps(_mm_mul_ps(input, b0), z1)};
+            z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(input, b1), _mm_mul_ps(output, a1)), z2);
+            z2 = _mm_sub_ps(_mm_mul_ps(input, b2), _mm_mul_ps(output, a2));
+            return output;
+        };
+        for(;count-pos >= 4;pos += 4)
+        {
+            __m128 s0{_mm_loadu_ps(src[0]+pos)};
+            __m128 s1{_mm_loadu_ps(src[1]+pos)};
+            __m128 s2{_mm_loadu_ps(src[2]+pos)};
+            __m128 s3{_mm_loadu_ps(src[3]+pos)};
+            _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+            s0 = proc_sample(s0);
+            s1 = proc_sample(s1);
+            s2 = proc_sample(s2);
+            s3 = proc_sample(s3);
+            _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+            const __m128 out[MaxBatch]{s0, s1, s2, s3};
+            for(size_t i{0};i < num;++i)
+                _mm_storeu_ps(dsts[base+i]+pos, out[i]);
+        }
+        _mm_store_ps(params[5].data(), z1);
+        _mm_store_ps(params[6].data(), z2);
+#else
+        auto transpose = [](float32x4_t &r0, float32x4_t &r1, float32x4_t &r2, float32x4_t &r3)
+        {
+            const float32x4x2_t t01{vtrnq_f32(r0, r1)};
+            const float32x4x2_t t23{vtrnq_f32(r2, r3)};
+            r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+            r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+            r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+            r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+        };
+        const float32x4_t b0{vld1q_f32(params[0].data())};
+        const float32x4_t b1{vld1q_f32(params[1].data())};
+        const float32x4_t b2{vld1q_f32(params[2].data())};
+        const float32x4_t a1{vld1q_f32(params[3].data())};
+        const float32x4_t a2{vld1q_f32(params[4].data())};
+        float32x4_t z1{vld1q_f32(params[5].data())};
+        float32x4_t z2{vld1q_f32(params[6].data())};
+        auto proc_sample = [b0,b1,b2,a1,a2,&z1,&z2](const float32x4_t input) noexcept
+        {
+            const float32x4_t output{vaddq_f32(vmulq_f32(input, b0), z1)};
+            z1 = vaddq_f32(vsubq_f32(vmulq_f32(input, b1), vmulq_f32(output, a1)), z2);
+            z2 = vsubq_f32(vmulq_f32(input, b2), vmulq_f32(output, a2));
+            return output;
+        };
+        for(;count-pos >= 4;pos += 4)
+        {
+            float32x4_t s0{vld1q_f32(src[0]+pos)};
+            float32x4_t s1{vld1q_f32(src[1]+pos)};
+            float32x4_t s2{vld1q_f32(src[2]+pos)};
+            float32x4_t s3{vld1q_f32(src[3]+pos)};
+            transpose(s0, s1, s2, s3);
+            s0 = proc_sample(s0);
+            s1 = proc_sample(s1);
+            s2 = proc_sample(s2);
+            s3 = proc_sample(s3);
+            transpose(s0, s1, s2, s3);
+            const float32x4_t out[MaxBatch]{s0, s1, s2, s3};
+            for(size_t i{0};i < num;++i)
+                vst1q_f32(dsts[base+i]+pos, out[i]);
+        }
+        vst1q_f32(params[5].data(), z1);
+        vst1q_f32(params[6].data(), z2);
+#endif
+
+        /* Finish any remaining samples individually. */
+        for(size_t i{0};i < num;++i)
+        {
+            BiquadFilterR &filter = *filters[base+i];
+            float z1s{params[5][i]}, z2s{params[6][i]};
+            std::transform(src[i]+pos, src[i]+count, dsts[base+i]+pos,
+                [&filter,&z1s,&z2s](const float input) noexcept -> float
+                { return filter.processOne(input, z1s, z2s); });
+            filter.mZ1 = z1s;
+            filter.mZ2 = z2s;
+        }
+    }
+#else
+    for(size_t i{0};i < filters.size();++i)
+        filters[i]->process({srcs[i], count}, dsts[i]);
+#endif
+}
+
+template<typename Real>
+void BiquadFilterR<Real>::processCascadeBatch(const al::span<BiquadFilterR*const> cascades,
+    const size_t numStages, const al::span<const Real*const> srcs,
+    const al::span<Real*const> dsts, const size_t count)
+{
+    assert(numStages > 0 && numStages <= MaxCascade);
+    for(size_t i{0};i < cascades.size();++i)
+    {
+        const Real *src{srcs[i]};
+        for(size_t s{0};s < numStages;++s)
+        {
+            cascades[i][s].process({src, count}, dsts[i]);
+            src = dsts[i];
+        }
+    }
+}
+
+template<>
+void BiquadFilterR<float>::processCascadeBatch(const al::span<BiquadFilterR*const> cascades,
+    const size_t numStages, const al::span<const float*const> srcs,
+    const al::span<float*const> dsts, const size_t count)
+{
+    assert(numStages > 0 && numStages <= MaxCascade);
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+    for(size_t base{0};base < cascades.size();base += MaxBatch)
+    {
+        const size_t num{std::min(cascades.size()-base, MaxBatch)};
+        if(num < 2)
+        {
+            const float *src{srcs[base]};
+            for(size_t s{0};s < numStages;++s)
+            {
+                cascades[base][s].process({src, count}, dsts[base]);
+                src = dsts[base];
+            }
+            continue;
+        }
+
+        /* As with processBatch, each cascade gets a lane of the vectors, and
+         * unused lanes process the first input with silent filters.
+         */
+        alignas(16) std::array<std::array<std::array<float,MaxBatch>,7>,MaxCascade> params{};
+        std::array<const float*,MaxBatch> src{};
+        std::fill(src.begin(), src.end(), srcs[base]);
+        for(size_t i{0};i < num;++i)
+        {
+            for(size_t s{0};s < numStages;++s)
+            {
+                const BiquadFilterR &filter = cascades[base+i][s];
+                params[s][0][i] = filter.mB0;
+                params[s][1][i] = filter.mB1;
+                params[s][2][i] = filter.mB2;
+                params[s][3][i] = filter.mA1;
+                params[s][4][i] = filter.mA2;
+                params[s][5][i] = filter.mZ1;
+                params[s][6][i] = filter.mZ2;
+            }
+            src[i] = srcs[base+i];
+        }
+
+        size_t pos{0};
+#ifdef HAVE_SSE_INTRINSICS
+        __m128 coeffs[MaxCascade][5];
+        __m128 z1[MaxCascade], z2[MaxCascade];
+        for(size_t s{0};s < numStages;++s)
+        {
+            for(size_t c{0};c < 5;++c)
+                coeffs[s][c] = _mm_load_ps(params[s][c].data());
+            z1[s] = _mm_load_ps(params[s][5].data());
+            z2[s] = _mm_load_ps(params[s][6].data());
+        }
+        auto proc_sample = [numStages,&coeffs,&z1,&z2](__m128 input) noexcept -> __m128
+        {
+            for(size_t s{0};s < numStages;++s)
+            {
+                const __m128 (&c)[5] = coeffs[s];
+                const __m128 output{_mm_add_ps(_mm_mul_ps(input, c[0]), z1[s])};
+                z1[s] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(input, c[1]), _mm_mul_ps(output, c[3])),
+                    z2[s]);
+                z2[s] = _mm_sub_ps(_mm_mul_ps(input, c[2]), _mm_mul_ps(output, c[4]));
+                input = output;
+            }
+            return input;
+        };
+        for(;count-pos >= 4;pos += 4)
+        {
+            __m128 s0{_mm_loadu_ps(src[0]+pos)};
+            __m128 s1{_mm_loadu_ps(src[1]+pos)};
+            __m128 s2{_mm_loadu_ps(src[2]+pos)};
+            __m128 s3{_mm_loadu_ps(src[3]+pos)};
+            _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+            s0 = proc_sample(s0);
+            s1 = proc_sample(s1);
+            s2 = proc_sample(s2);
+            s3 = proc_sample(s3);
+            _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+            const __m128 out[MaxBatch]{s0, s1, s2, s3};
+            for(size_t i{0};i < num;++i)
+                _mm_storeu_ps(dsts[base+i]+pos, out[i]);
+        }
+        for(size_t s{0};s < numStages;++s)
+        {
+            _mm_store_ps(params[s][5].data(), z1[s]);
+            _mm_store_ps(params[s][6].data(), z2[s]);
+        }
+#else
+        auto transpose = [](float32x4_t &r0, float32x4_t &r1, float32x4_t &r2, float32x4_t &r3)
+        {
+            const float32x4x2_t t01{vtrnq_f32(r0, r1)};
+            const float32x4x2_t t23{vtrnq_f32(r2, r3)};
+            r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+            r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+            r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+            r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+        };
+        float32x4_t coeffs[MaxCascade][5];
+        float32x4_t z1[MaxCascade], z2[MaxCascade];
+        for(size_t s{0};s < numStages;++s)
+        {
+            for(size_t c{0};c < 5;++c)
+                coeffs[s][c] = vld1q_f32(params[s][c].data());
+            z1[s] = vld1q_f32(params[s][5].data());
+            z2[s] = vld1q_f32(params[s][6].data());
+        }
+        auto proc_sample = [numStages,&coeffs,&z1,&z2](float32x4_t input) noexcept
+        {
+            for(size_t s{0};s < numStages;++s)
+            {
+                const float32x4_t (&c)[5] = coeffs[s];
+                const float32x4_t output{vaddq_f32(vmulq_f32(input, c[0]), z1[s])};
+                z1[s] = vaddq_f32(vsubq_f32(vmulq_f32(input, c[1]), vmulq_f32(output, c[3])),
+                    z2[s]);
+                z2[s] = vsubq_f32(vmulq_f32(input, c[2]), vmulq_f32(output, c[4]));
+                input = output;
+            }
+            return input;
+        };
+        for(;count-pos >= 4;pos += 4)
+        {
+            float32x4_t s0{vld1q_f32(src[0]+pos)};
+            float32x4_t s1{vld1q_f32(src[1]+pos)};
+            float32x4_t s2{vld1q_f32(src[2]+pos)};
+            float32x4_t s3{vld1q_f32(src[3]+pos)};
+            transpose(s0, s1, s2, s3);
+            s0 = proc_sample(s0);
+            s1 = proc_sample(s1);
+            s2 = proc_sample(s2);
+            s3 = proc_sample(s3);
+            transpose(s0, s1, s2, s3);
+            const float32x4_t out[MaxBatch]{s0, s1, s2, s3};
+            for(size_t i{0};i < num;++i)
+                vst1q_f32(dsts[base+i]+pos, out[i]);
+        }
+        for(size_t s{0};s < numStages;++s)
+        {
+            vst1q_f32(params[s][5].data(), z1[s]);
+            vst1q_f32(params[s][6].data(), z2[s]);
+        }
+#endif
+
+        /* Finish any remaining samples individually. */
+        for(size_t i{0};i < num;++i)
+        {
+            BiquadFilterR *cascade{cascades[base+i]};
+            std::transform(src[i]+pos, src[i]+count, dsts[base+i]+pos,
+                [&params,cascade,numStages,i](float sample) noexcept -> float
+                {
+                    for(size_t s{0};s < numStages;++s)
+                        sample = cascade[s].processOne(sample, params[s][5][i],
+                            params[s][6][i]);
+                    return sample;
+                });
+            for(size_t s{0};s < numStages;++s)
+            {
+                cascade[s].mZ1 = params[s][5][i];
+                cascade[s].mZ2 = params[s][6][i];
+            }
+        }
+    }
+#else
+    for(size_t i{0};i < cascades.size();++i)
+    {
+        const float *src{srcs[i]};
+        for(size_t s{0};s < numStages;++s)
+        {
+            cascades[i][s].process({src, count}, dsts[i]);
+            src = dsts[i];
+        }
+    }
+#endif
+}
+
 template class BiquadFilterR<float>;
 template class BiquadFilterR<double>;
@@ -2,6 +2,7 @@
 #define CORE_FILTERS_BIQUAD_H
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstddef>
 #include <utility>
@@ -118,9 +119,36 @@ public:
     /** Processes this filter and the other at the same time. */
     void dualProcess(BiquadFilterR &other, const al::span<const Real> src, Real *dst);
 
+    /**
+     * Processes multiple independent filters together, each with its own
+     * input and output. Rather than running each filter's recursion serially,
+     * up to MaxBatch filters are processed in parallel (using SIMD, where
+     * available). The input and output of one filter may be the same buffer.
+     */
+    static constexpr size_t MaxBatch{4};
+    static void processBatch(const al::span<BiquadFilterR*const> filters,
+        const al::span<const Real*const> srcs, const al::span<Real*const> dsts,
+        const size_t count);
+
+    /**
+     * Like processBatch, but each input is filtered through a cascade of
+     * filters in series (e.g. the bands of an equalizer). Each cascade points
+     * to an array of numStages filters, and each sample is run through every
+     * stage before moving on to the next, with up to MaxBatch cascades
+     * processed in parallel. numStages must be from 1 to MaxCascade.
+     */
+    static constexpr size_t MaxCascade{10};
+    static void processCascadeBatch(const al::span<BiquadFilterR*const> cascades,
+        const size_t numStages, const al::span<const Real*const> srcs,
+        const al::span<Real*const> dsts, const size_t count);
+
     /* Rather hacky. It's just here to support "manual" processing. */
     std::pair<Real,Real> getComponents() const noexcept { return {mZ1, mZ2}; }
     void setComponents(Real z1, Real z2) noexcept { mZ1 = z1; mZ2 = z2; }
+    /* Gets the b0, b1, b2, a1, and a2 coefficients, for processing multiple
+     * filters together (e.g. with SIMD).
+     */
+    std::array<Real,5> getCoefficients() const noexcept { return {{mB0, mB1, mB2, mA1, mA2}}; }
     Real processOne(const Real in, Real &z1, Real &z2) const noexcept
     {
         const Real out{in*mB0 + z1};
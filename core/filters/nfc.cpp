@@ -4,9 +4,17 @@
 #include "nfc.h"
 
 #include <algorithm>
+#include <array>
+#include <cassert>
 
 #include "opthelpers.h"
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 
 /* Near-field control filters are the basis for handling the near-field effect.
  * The near-field effect is a bass-boost present in the directional components
@@ -365,3 +373,186 @@ void NfcFilter::process4(const al::span<const float> src, float *RESTRICT dst)
     fourth.z[2] = z3;
     fourth.z[3] = z4;
 }
+
+void NfcFilter::process(const al::span<const float> src, const al::span<float*const> dst)
+{
+    assert(dst.size() <= 4);
+
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+    /* Each vector lane runs the filter of one order, as a pair of second-order
+     * sections. The lower-order filters use 0 for the coefficients they don't
+     * have, and their unused states are masked to stay at 0 so the results
+     * match the separate filters.
+     */
+    alignas(16) const float gains[4]{first.gain, second.gain, third.gain, fourth.gain};
+    alignas(16) const float a1s[4]{first.a1, second.a1, third.a1, fourth.a1};
+    alignas(16) const float a2s[4]{0.0f, second.a2, third.a2, fourth.a2};
+    alignas(16) const float a3s[4]{0.0f, 0.0f, third.a3, fourth.a3};
+    alignas(16) const float a4s[4]{0.0f, 0.0f, 0.0f, fourth.a4};
+    alignas(16) const float b1s[4]{first.b1, second.b1, third.b1, fourth.b1};
+    alignas(16) const float b2s[4]{0.0f, second.b2, third.b2, fourth.b2};
+    alignas(16) const float b3s[4]{0.0f, 0.0f, third.b3, fourth.b3};
+    alignas(16) const float b4s[4]{0.0f, 0.0f, 0.0f, fourth.b4};
+    alignas(16) std::array<float,4> z1s{first.z[0], second.z[0], third.z[0], fourth.z[0]};
+    alignas(16) std::array<float,4> z2s{0.0f, second.z[1], third.z[1], fourth.z[1]};
+    alignas(16) std::array<float,4> z3s{0.0f, 0.0f, third.z[2], fourth.z[2]};
+    alignas(16) std::array<float,4> z4s{0.0f, 0.0f, 0.0f, fourth.z[3]};
+
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 gain{_mm_load_ps(gains)};
+    const __m128 a1{_mm_load_ps(a1s)}, a2{_mm_load_ps(a2s)};
+    const __m128 a3{_mm_load_ps(a3s)}, a4{_mm_load_ps(a4s)};
+    const __m128 b1{_mm_load_ps(b1s)}, b2{_mm_load_ps(b2s)};
+    const __m128 b3{_mm_load_ps(b3s)}, b4{_mm_load_ps(b4s)};
+    const __m128 mask2{_mm_cmpgt_ps(_mm_setr_ps(0.0f, 1.0f, 1.0f, 1.0f), _mm_setzero_ps())};
+    const __m128 mask3{_mm_cmpgt_ps(_mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f), _mm_setzero_ps())};
+    const __m128 mask4{_mm_cmpgt_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), _mm_setzero_ps())};
+    __m128 z1{_mm_load_ps(z1s.data())}, z2{_mm_load_ps(z2s.data())};
+    __m128 z3{_mm_load_ps(z3s.data())}, z4{_mm_load_ps(z4s.data())};
+
+    auto proc_sample = [=,&z1,&z2,&z3,&z4](const float in) noexcept -> __m128
+    {
+        __m128 y{_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(in), gain), _mm_mul_ps(a1, z1)),
+            _mm_mul_ps(a2, z2))};
+        __m128 out{_mm_add_ps(_mm_add_ps(y, _mm_mul_ps(b1, z1)), _mm_mul_ps(b2, z2))};
+        z2 = _mm_add_ps(z2, _mm_and_ps(z1, mask2));
+        z1 = _mm_add_ps(z1, y);
+
+        y = _mm_sub_ps(_mm_sub_ps(out, _mm_mul_ps(a3, z3)), _mm_mul_ps(a4, z4));
+        out = _mm_add_ps(_mm_add_ps(y, _mm_mul_ps(b3, z3)), _mm_mul_ps(b4, z4));
+        z4 = _mm_add_ps(z4, _mm_and_ps(z3, mask4));
+        z3 = _mm_add_ps(z3, _mm_and_ps(y, mask3));
+        return out;
+    };
+
+    /* Transpose each group of four output samples so each order's samples
+     * can be stored together.
+     */
+    const size_t todo{src.size() & ~size_t{3}};
+    for(size_t i{0};i < todo;i+=4)
+    {
+        __m128 out0{proc_sample(src[i])};
+        __m128 out1{proc_sample(src[i+1])};
+        __m128 out2{proc_sample(src[i+2])};
+        __m128 out3{proc_sample(src[i+3])};
+        _MM_TRANSPOSE4_PS(out0, out1, out2, out3);
+        switch(dst.size())
+        {
+        case 4:
+            _mm_storeu_ps(&dst[3][i], out3);
+            /* fall-through */
+        case 3:
+            _mm_storeu_ps(&dst[2][i], out2);
+            /* fall-through */
+        case 2:
+            _mm_storeu_ps(&dst[1][i], out1);
+            /* fall-through */
+        case 1:
+            _mm_storeu_ps(&dst[0][i], out0);
+        }
+    }
+    for(size_t i{todo};i < src.size();++i)
+    {
+        alignas(16) std::array<float,4> out;
+        _mm_store_ps(out.data(), proc_sample(src[i]));
+        for(size_t j{0};j < dst.size();++j)
+            dst[j][i] = out[j];
+    }
+
+    _mm_store_ps(z1s.data(), z1);
+    _mm_store_ps(z2s.data(), z2);
+    _mm_store_ps(z3s.data(), z3);
+    _mm_store_ps(z4s.data(), z4);
+#else
+    const float32x4_t gain{vld1q_f32(gains)};
+    const float32x4_t a1{vld1q_f32(a1s)}, a2{vld1q_f32(a2s)};
+    const float32x4_t a3{vld1q_f32(a3s)}, a4{vld1q_f32(a4s)};
+    const float32x4_t b1{vld1q_f32(b1s)}, b2{vld1q_f32(b2s)};
+    const float32x4_t b3{vld1q_f32(b3s)}, b4{vld1q_f32(b4s)};
+    alignas(16) static constexpr uint32_t masks[3][4]{
+        {0u, ~0u, ~0u, ~0u}, {0u, 0u, ~0u, ~0u}, {0u, 0u, 0u, ~0u}};
+    const uint32x4_t mask2{vld1q_u32(masks[0])};
+    const uint32x4_t mask3{vld1q_u32(masks[1])};
+    const uint32x4_t mask4{vld1q_u32(masks[2])};
+    float32x4_t z1{vld1q_f32(z1s.data())}, z2{vld1q_f32(z2s.data())};
+    float32x4_t z3{vld1q_f32(z3s.data())}, z4{vld1q_f32(z4s.data())};
+
+    auto and_mask = [](const float32x4_t val, const uint32x4_t mask) noexcept
+    { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(val), mask)); };
+    /* Avoid fused multiply-adds to match the separate filters' results. */
+    auto proc_sample = [=,&z1,&z2,&z3,&z4](const float in) noexcept -> float32x4_t
+    {
+        float32x4_t y{vsubq_f32(vsubq_f32(vmulq_f32(vdupq_n_f32(in), gain),
+            vmulq_f32(a1, z1)), vmulq_f32(a2, z2))};
+        float32x4_t out{vaddq_f32(vaddq_f32(y, vmulq_f32(b1, z1)), vmulq_f32(b2, z2))};
+        z2 = vaddq_f32(z2, and_mask(z1, mask2));
+        z1 = vaddq_f32(z1, y);
+
+        y = vsubq_f32(vsubq_f32(out, vmulq_f32(a3, z3)), vmulq_f32(a4, z4));
+        out = vaddq_f32(vaddq_f32(y, vmulq_f32(b3, z3)), vmulq_f32(b4, z4));
+        z4 = vaddq_f32(z4, and_mask(z3, mask4));
+        z3 = vaddq_f32(z3, and_mask(y, mask3));
+        return out;
+    };
+
+    /* Interleaved stores of four samples at a time leave each order's samples
+     * together.
+     */
+    const size_t todo{src.size() & ~size_t{3}};
+    for(size_t i{0};i < todo;i+=4)
+    {
+        alignas(16) std::array<float,16> out;
+        float32x4x4_t samples;
+        samples.val[0] = proc_sample(src[i]);
+        samples.val[1] = proc_sample(src[i+1]);
+        samples.val[2] = proc_sample(src[i+2]);
+        samples.val[3] = proc_sample(src[i+3]);
+        vst4q_f32(out.data(), samples);
+        for(size_t j{0};j < dst.size();++j)
+            std::copy_n(out.cbegin() + j*4, 4, &dst[j][i]);
+    }
+    for(size_t i{todo};i < src.size();++i)
+    {
+        alignas(16) std::array<float,4> out;
+        vst1q_f32(out.data(), proc_sample(src[i]));
+        for(size_t j{0};j < dst.size();++j)
+            dst[j][i] = out[j];
+    }
+
+    vst1q_f32(z1s.data(), z1);
+    vst1q_f32(z2s.data(), z2);
+    vst1q_f32(z3s.data(), z3);
+    vst1q_f32(z4s.data(), z4);
+#endif
+
+    /* Only update the filters for the orders that were output. */
+    if(dst.size() > 0)
+        first.z[0] = z1s[0];
+    if(dst.size() > 1)
+    {
+        second.z[0] = z1s[1];
+        second.z[1] = z2s[1];
+    }
+    if(dst.size() > 2)
+    {
+        third.z[0] = z1s[2];
+        third.z[1] = z2s[2];
+        third.z[2] = z3s[2];
+    }
+    if(dst.size() > 3)
+    {
+        fourth.z[0] = z1s[3];
+        fourth.z[1] = z2s[3];
+        fourth.z[2] = z3s[3];
+        fourth.z[3] = z4s[3];
+    }
+
+#else
+
+    using FilterProc = void (NfcFilter::*)(const al::span<const float>, float*);
+    static constexpr std::array<FilterProc,4> procs{{&NfcFilter::process1,
+        &NfcFilter::process2, &NfcFilter::process3, &NfcFilter::process4}};
+    for(size_t i{0};i < dst.size();++i)
+        (this->*procs[i])(src, dst[i]);
+#endif
+}
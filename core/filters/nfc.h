@@ -58,6 +58,12 @@ public:
 
     /* Near-field control filter for fourth-order ambisonic channels (16-24). */
     void process4(const al::span<const float> src, float *RESTRICT dst);
+
+    /* Near-field control filters for ambisonic orders 1 through dst.size()
+     * (up to 4), all applied to the same input, with order n's output written
+     * to dst[n-1]. The same as calling each of process1..4, but done together.
+     */
+    void process(const al::span<const float> src, const al::span<float*const> dst);
 };
 
 #endif /* CORE_FILTERS_NFC_H */
@@ -4,12 +4,175 @@
 #include "splitter.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <limits>
 
 #include "alnumbers.h"
 #include "opthelpers.h"
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+
+namespace {
+
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+#ifdef HAVE_SSE_INTRINSICS
+using float4 = __m128;
+inline float4 load4(const float *src) noexcept { return _mm_loadu_ps(src); }
+inline void store4(float *dst, const float4 val) noexcept { _mm_storeu_ps(dst, val); }
+inline float4 add4(const float4 a, const float4 b) noexcept { return _mm_add_ps(a, b); }
+inline float4 sub4(const float4 a, const float4 b) noexcept { return _mm_sub_ps(a, b); }
+inline float4 mul4(const float4 a, const float4 b) noexcept { return _mm_mul_ps(a, b); }
+inline void transpose4(float4 &r0, float4 &r1, float4 &r2, float4 &r3) noexcept
+{ _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+#else
+using float4 = float32x4_t;
+inline float4 load4(const float *src) noexcept { return vld1q_f32(src); }
+inline void store4(float *dst, const float4 val) noexcept { vst1q_f32(dst, val); }
+inline float4 add4(const float4 a, const float4 b) noexcept { return vaddq_f32(a, b); }
+inline float4 sub4(const float4 a, const float4 b) noexcept { return vsubq_f32(a, b); }
+/* Avoid fused multiply-adds to match the single splitter's results. */
+inline float4 mul4(const float4 a, const float4 b) noexcept { return vmulq_f32(a, b); }
+inline void transpose4(float4 &r0, float4 &r1, float4 &r2, float4 &r3) noexcept
+{
+    const float32x4x2_t t01{vtrnq_f32(r0, r1)};
+    const float32x4x2_t t23{vtrnq_f32(r2, r3)};
+    r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+#endif
+
+/* Parameters and state for a batch of splitters, one per vector lane. Unused
+ * lanes read the first splitter's input and don't write any output.
+ */
+struct SplitterLanes {
+    static constexpr size_t MaxLanes{8};
+    alignas(16) std::array<float,MaxLanes> mApCoeff{}, mLpCoeff{};
+    alignas(16) std::array<float,MaxLanes> mHfScale{}, mLfScale{};
+    alignas(16) std::array<float,MaxLanes> mLpZ1{}, mLpZ2{}, mApZ1{};
+    std::array<const float*,MaxLanes> mInput{};
+    std::array<float*,MaxLanes> mOutput{}, mLpOutput{};
+    size_t mCount{0};
+};
+
+enum class LaneMode { Split, Scale, AllPass };
+
+/* Processes the multiple of 4 samples of each lane's input, four samples at a
+ * time, transposing them so each vector holds one sample of four lanes. The
+ * recursions of the NumVecs vectors are independent, and interleaving them
+ * helps hide their latency. Returns the number of samples processed.
+ */
+template<LaneMode Mode, size_t NumVecs>
+size_t ProcessLanes(SplitterLanes &lanes, const size_t count)
+{
+    float4 ap_coeff[NumVecs], lp_coeff[NumVecs], hfscale[NumVecs], lfscale[NumVecs];
+    float4 lp_z1[NumVecs], lp_z2[NumVecs], ap_z1[NumVecs];
+    for(size_t v{0};v < NumVecs;++v)
+    {
+        ap_coeff[v] = load4(&lanes.mApCoeff[v*4]);
+        lp_coeff[v] = load4(&lanes.mLpCoeff[v*4]);
+        hfscale[v] = load4(&lanes.mHfScale[v*4]);
+        lfscale[v] = load4(&lanes.mLfScale[v*4]);
+        lp_z1[v] = load4(&lanes.mLpZ1[v*4]);
+        lp_z2[v] = load4(&lanes.mLpZ2[v*4]);
+        ap_z1[v] = load4(&lanes.mApZ1[v*4]);
+    }
+
+    const size_t todo{count & ~size_t{3}};
+    for(size_t pos{0};pos < todo;pos += 4)
+    {
+        /* All the input is loaded before any output is stored, since the
+         * unused lanes read the first lane's input (which may be processed
+         * in-place).
+         */
+        float4 samples[NumVecs][4];
+        for(size_t v{0};v < NumVecs;++v)
+        {
+            for(size_t i{0};i < 4;++i)
+                samples[v][i] = load4(lanes.mInput[v*4 + i] + pos);
+            transpose4(samples[v][0], samples[v][1], samples[v][2], samples[v][3]);
+        }
+
+        float4 lpsamples[NumVecs][4];
+        for(size_t i{0};i < 4;++i)
+        {
+            for(size_t v{0};v < NumVecs;++v)
+            {
+                const float4 in{samples[v][i]};
+
+                /* All-pass sample processing. */
+                const float4 ap_y{add4(mul4(in, ap_coeff[v]), ap_z1[v])};
+                ap_z1[v] = sub4(in, mul4(ap_y, ap_coeff[v]));
+                if constexpr(Mode == LaneMode::AllPass)
+                {
+                    samples[v][i] = ap_y;
+                    continue;
+                }
+
+                /* Low-pass sample processing. */
+                float4 d{mul4(sub4(in, lp_z1[v]), lp_coeff[v])};
+                float4 lp_y{add4(lp_z1[v], d)};
+                lp_z1[v] = add4(lp_y, d);
+
+                d = mul4(sub4(lp_y, lp_z2[v]), lp_coeff[v]);
+                lp_y = add4(lp_z2[v], d);
+                lp_z2[v] = add4(lp_y, d);
+
+                /* High-pass generated from removing low-passed output, and
+                 * optionally scaling each band.
+                 */
+                if constexpr(Mode == LaneMode::Split)
+                {
+                    samples[v][i] = sub4(ap_y, lp_y);
+                    lpsamples[v][i] = lp_y;
+                }
+                else
+                    samples[v][i] = add4(mul4(sub4(ap_y, lp_y), hfscale[v]),
+                        mul4(lp_y, lfscale[v]));
+            }
+        }
+
+        for(size_t v{0};v < NumVecs;++v)
+        {
+            transpose4(samples[v][0], samples[v][1], samples[v][2], samples[v][3]);
+            if constexpr(Mode == LaneMode::Split)
+                transpose4(lpsamples[v][0], lpsamples[v][1], lpsamples[v][2], lpsamples[v][3]);
+            for(size_t i{0};i < 4 && v*4+i < lanes.mCount;++i)
+            {
+                store4(lanes.mOutput[v*4 + i] + pos, samples[v][i]);
+                if constexpr(Mode == LaneMode::Split)
+                    store4(lanes.mLpOutput[v*4 + i] + pos, lpsamples[v][i]);
+            }
+        }
+    }
+
+    for(size_t v{0};v < NumVecs;++v)
+    {
+        store4(&lanes.mLpZ1[v*4], lp_z1[v]);
+        store4(&lanes.mLpZ2[v*4], lp_z2[v]);
+        store4(&lanes.mApZ1[v*4], ap_z1[v]);
+    }
+    return todo;
+}
+
+template<LaneMode Mode>
+size_t ProcessLanes(SplitterLanes &lanes, const size_t count)
+{
+    if(lanes.mCount > 4)
+        return ProcessLanes<Mode,2>(lanes, count);
+    return ProcessLanes<Mode,1>(lanes, count);
+}
+#endif
+
+} // namespace
+
 
 template<typename Real>
 void BandSplitterR<Real>::init(Real f0norm)
@@ -174,6 +337,108 @@ void BandSplitterR<Real>::processAllPass(const al::span<Real> samples)
     mApZ1 = z1;
 }
 
+template<typename Real>
+void BandSplitterR<Real>::processBatch(const BatchMode mode,
+    const al::span<BandSplitterR*const> splitters, const al::span<const Real*const> inputs,
+    const al::span<Real*const> outputs, const al::span<Real*const> lpouts,
+    const al::span<const Real> hfscales, const al::span<const Real> lfscales, const size_t count)
+{
+    for(size_t i{0};i < splitters.size();++i)
+    {
+        switch(mode)
+        {
+        case BatchMode::Split:
+            splitters[i]->process({inputs[i], count}, outputs[i], lpouts[i]);
+            break;
+        case BatchMode::Scale:
+            splitters[i]->processScale({outputs[i], count}, hfscales[i], lfscales[i]);
+            break;
+        case BatchMode::HfScale:
+            splitters[i]->processHfScale({outputs[i], count}, hfscales[i]);
+            break;
+        case BatchMode::AllPass:
+            splitters[i]->processAllPass({outputs[i], count});
+            break;
+        }
+    }
+}
+
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+template<>
+void BandSplitterR<float>::processBatch(const BatchMode mode,
+    const al::span<BandSplitterR*const> splitters, const al::span<const float*const> inputs,
+    const al::span<float*const> outputs, const al::span<float*const> lpouts,
+    const al::span<const float> hfscales, const al::span<const float> lfscales,
+    const size_t count)
+{
+    for(size_t base{0};base < splitters.size();base += MaxBatch)
+    {
+        const size_t num{std::min(splitters.size()-base, MaxBatch)};
+        const auto batch = splitters.subspan(base, num);
+
+        SplitterLanes lanes{};
+        lanes.mCount = num;
+        std::fill(lanes.mInput.begin(), lanes.mInput.end(), inputs[base]);
+        for(size_t i{0};i < num;++i)
+        {
+            const BandSplitterR &splitter = *batch[i];
+            lanes.mApCoeff[i] = splitter.mCoeff;
+            lanes.mLpCoeff[i] = splitter.mCoeff*0.5f + 0.5f;
+            lanes.mLpZ1[i] = splitter.mLpZ1;
+            lanes.mLpZ2[i] = splitter.mLpZ2;
+            lanes.mApZ1[i] = splitter.mApZ1;
+            lanes.mInput[i] = inputs[base+i];
+            lanes.mOutput[i] = outputs[base+i];
+            if(mode == BatchMode::Split)
+                lanes.mLpOutput[i] = lpouts[base+i];
+            /* The high-frequency scale alone is the same as leaving the low
+             * frequencies unscaled (multiplying by 1 is exact).
+             */
+            if(mode == BatchMode::Scale || mode == BatchMode::HfScale)
+            {
+                lanes.mHfScale[i] = hfscales[base+i];
+                lanes.mLfScale[i] = (mode == BatchMode::Scale) ? lfscales[base+i] : 1.0f;
+            }
+        }
+
+        /* A single splitter gains nothing from the vector lanes. */
+        size_t pos{0};
+        if(num > 1)
+        {
+            switch(mode)
+            {
+            case BatchMode::Split: pos = ProcessLanes<LaneMode::Split>(lanes, count); break;
+            case BatchMode::Scale:
+            case BatchMode::HfScale: pos = ProcessLanes<LaneMode::Scale>(lanes, count); break;
+            case BatchMode::AllPass: pos = ProcessLanes<LaneMode::AllPass>(lanes, count); break;
+            }
+        }
+
+        /* Finish any remaining samples individually. */
+        for(size_t i{0};i < num;++i)
+        {
+            BandSplitterR &splitter = *batch[i];
+            splitter.mApZ1 = lanes.mApZ1[i];
+            if(mode == BatchMode::AllPass)
+            {
+                splitter.processAllPass({outputs[base+i]+pos, count-pos});
+                continue;
+            }
+            splitter.mLpZ1 = lanes.mLpZ1[i];
+            splitter.mLpZ2 = lanes.mLpZ2[i];
+            if(mode == BatchMode::Split)
+                splitter.process({inputs[base+i]+pos, count-pos}, outputs[base+i]+pos,
+                    lpouts[base+i]+pos);
+            else if(mode == BatchMode::Scale)
+                splitter.processScale({outputs[base+i]+pos, count-pos}, hfscales[base+i],
+                    lfscales[base+i]);
+            else
+                splitter.processHfScale({outputs[base+i]+pos, count-pos}, hfscales[base+i]);
+        }
+    }
+}
+#endif
+
 
 template class BandSplitterR<float>;
 template class BandSplitterR<double>;
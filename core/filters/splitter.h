@@ -34,6 +34,46 @@ public:
      * without splitting or scaling the signal.
      */
     void processAllPass(const al::span<Real> samples);
+
+    /**
+     * Multi-channel versions of process, processScale, processHfScale, and
+     * processAllPass, applying each splitter to its own channel of samples.
+     * Rather than running each splitter's recursion serially, up to MaxBatch
+     * splitters are processed in parallel (using SIMD, where available), with
+     * the same results as processing each separately.
+     */
+    static constexpr size_t MaxBatch{8};
+    static void processBatch(const al::span<BandSplitterR*const> splitters,
+        const al::span<const Real*const> inputs, const al::span<Real*const> hpouts,
+        const al::span<Real*const> lpouts, const size_t count)
+    { processBatch(BatchMode::Split, splitters, inputs, hpouts, lpouts, {}, {}, count); }
+    static void processScaleBatch(const al::span<BandSplitterR*const> splitters,
+        const al::span<Real*const> samples, const al::span<const Real> hfscales,
+        const al::span<const Real> lfscales, const size_t count)
+    {
+        processBatch(BatchMode::Scale, splitters, {samples.data(), samples.size()}, samples, {},
+            hfscales, lfscales, count);
+    }
+    static void processHfScaleBatch(const al::span<BandSplitterR*const> splitters,
+        const al::span<Real*const> samples, const al::span<const Real> hfscales,
+        const size_t count)
+    {
+        processBatch(BatchMode::HfScale, splitters, {samples.data(), samples.size()}, samples,
+            {}, hfscales, {}, count);
+    }
+    static void processAllPassBatch(const al::span<BandSplitterR*const> splitters,
+        const al::span<Real*const> samples, const size_t count)
+    {
+        processBatch(BatchMode::AllPass, splitters, {samples.data(), samples.size()}, samples,
+            {}, {}, {}, count);
+    }
+
+private:
+    enum class BatchMode { Split, Scale, HfScale, AllPass };
+    static void processBatch(const BatchMode mode, const al::span<BandSplitterR*const> splitters,
+        const al::span<const Real*const> inputs, const al::span<Real*const> outputs,
+        const al::span<Real*const> lpouts, const al::span<const Real> hfscales,
+        const al::span<const Real> lfscales, const size_t count);
 };
 using BandSplitter = BandSplitterR<float>;
 
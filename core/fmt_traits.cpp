@@ -3,6 +3,15 @@
 
 #include "fmt_traits.h"
 
+#if defined(HAVE_AVX2)
+#include <immintrin.h>
+#endif
+#if defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "kernels.h"
+
 
 namespace al {
 
@@ -76,4 +85,85 @@ const int16_t aLawDecompressionTable[256] = {
        944,   912,  1008,   976,   816,   784,   880,   848
 };
 
+
+template<>
+void LoadHalfArray_<CTag>(float *RESTRICT dst, const uint16_t *src, const size_t srcstep,
+    const size_t samples) noexcept
+{
+    for(size_t i{0u};i < samples;++i)
+        dst[i] = HalfToFloat(src[i*srcstep]);
+}
+
+#if defined(HAVE_AVX2)
+/* F16C comes with AVX, so builds with AVX2 support can target it too. */
+template<>
+#if defined(__GNUC__)
+__attribute__((target("avx,f16c")))
+#endif
+void LoadHalfArray_<F16CTag>(float *RESTRICT dst, const uint16_t *src, const size_t srcstep,
+    const size_t samples) noexcept
+{
+    size_t i{0u};
+    if(srcstep == 1)
+    {
+        for(;samples-i >= 8;i += 8)
+        {
+            const __m128i vals{_mm_loadu_si128(reinterpret_cast<const __m128i*>(src+i))};
+            _mm256_storeu_ps(dst+i, _mm256_cvtph_ps(vals));
+        }
+    }
+    else
+    {
+        for(;samples-i >= 8;i += 8)
+        {
+            const uint16_t *s{src + i*srcstep};
+            const __m128i vals{_mm_setr_epi16(static_cast<short>(s[0]),
+                static_cast<short>(s[srcstep]), static_cast<short>(s[srcstep*2]),
+                static_cast<short>(s[srcstep*3]), static_cast<short>(s[srcstep*4]),
+                static_cast<short>(s[srcstep*5]), static_cast<short>(s[srcstep*6]),
+                static_cast<short>(s[srcstep*7]))};
+            _mm256_storeu_ps(dst+i, _mm256_cvtph_ps(vals));
+        }
+    }
+    for(;i < samples;++i)
+        dst[i] = HalfToFloat(src[i*srcstep]);
+}
+#endif
+
+#if defined(HAVE_NEON)
+/* Only converts with NEON when the FPU has half-precision support, otherwise
+ * it's the same as the C version.
+ */
+template<>
+void LoadHalfArray_<NEONTag>(float *RESTRICT dst, const uint16_t *src, const size_t srcstep,
+    const size_t samples) noexcept
+{
+    size_t i{0u};
+#if defined(__ARM_FP) && (__ARM_FP&2)
+    if(srcstep == 1)
+    {
+        for(;samples-i >= 4;i += 4)
+            vst1q_f32(dst+i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src+i))));
+    }
+    else if(srcstep == 2)
+    {
+        for(;samples-i >= 4;i += 4)
+        {
+            const uint16x4x2_t vals{vld2_u16(src + i*2)};
+            vst1q_f32(dst+i, vcvt_f32_f16(vreinterpret_f16_u16(vals.val[0])));
+        }
+    }
+#endif
+    for(;i < samples;++i)
+        dst[i] = HalfToFloat(src[i*srcstep]);
+}
+#endif
+
+void LoadHalfArray(float *RESTRICT dst, const std::byte *src, const size_t srcstep,
+    const size_t samples) noexcept
+{
+    const auto *ssrc = reinterpret_cast<const uint16_t*>(src);
+    gKernels.mLoadHalfArray(dst, ssrc, srcstep, samples);
+}
+
 } // namespace al
@@ -3,15 +3,50 @@
 
 #include <cstddef>
 #include <stdint.h>
+#include <type_traits>
 
+#include "albit.h"
 #include "buffer_storage.h"
 
+struct CTag;
+struct F16CTag;
+struct NEONTag;
+
 
 namespace al {
 
 extern const int16_t muLawDecompressionTable[256];
 extern const int16_t aLawDecompressionTable[256];
 
+/* Converts an IEEE half-precision float to single-precision. */
+inline float HalfToFloat(const uint16_t val) noexcept
+{
+    static constexpr uint32_t ExpMask{0x0f800000u};
+    const uint32_t sign{uint32_t{val&0x8000u} << 16};
+    uint32_t bits{uint32_t{val&0x7fffu} << 13};
+    const uint32_t exp{bits & ExpMask};
+
+    bits += (127u-15u) << 23;
+    if(exp == ExpMask) /* Inf or NaN */
+        bits += (128u-16u) << 23;
+    else if(exp == 0) /* Zero or denormal, renormalize */
+    {
+        bits += 1u << 23;
+        bits = al::bit_cast<uint32_t>(al::bit_cast<float>(bits) - al::bit_cast<float>(113u<<23));
+    }
+    return al::bit_cast<float>(bits | sign);
+}
+
+/* Converts an array of half-precision samples to float, with the loader
+ * bound in the kernel table.
+ */
+void LoadHalfArray(float *RESTRICT dst, const std::byte *src, const std::size_t srcstep,
+    const std::size_t samples) noexcept;
+
+template<typename InstTag>
+void LoadHalfArray_(float *RESTRICT dst, const uint16_t *src, const std::size_t srcstep,
+    const std::size_t samples) noexcept;
+
 
 template<FmtType T>
 struct FmtTypeTraits { };
@@ -45,6 +80,13 @@ struct FmtTypeTraits<FmtDouble> {
     static constexpr OutT to(const Type val) noexcept { return static_cast<OutT>(val); }
 };
 template<>
+struct FmtTypeTraits<FmtHalf> {
+    using Type = uint16_t;
+
+    template<typename OutT>
+    static OutT to(const Type val) noexcept { return static_cast<OutT>(HalfToFloat(val)); }
+};
+template<>
 struct FmtTypeTraits<FmtMulaw> {
     using Type = uint8_t;
 
@@ -69,9 +111,14 @@ inline void LoadSampleArray(DstT *RESTRICT dst, const std::byte *src, const std:
     using TypeTraits = FmtTypeTraits<SrcType>;
     using SampleType = typename TypeTraits::Type;
 
-    const SampleType *RESTRICT ssrc{reinterpret_cast<const SampleType*>(src)};
-    for(size_t i{0u};i < samples;i++)
-        dst[i] = TypeTraits::template to<DstT>(ssrc[i*srcstep]);
+    if constexpr(SrcType == FmtHalf && std::is_same_v<DstT,float>)
+        LoadHalfArray(dst, src, srcstep, samples);
+    else
+    {
+        const SampleType *RESTRICT ssrc{reinterpret_cast<const SampleType*>(src)};
+        for(size_t i{0u};i < samples;i++)
+            dst[i] = TypeTraits::template to<DstT>(ssrc[i*srcstep]);
+    }
 }
 
 } // namespace al
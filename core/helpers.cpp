@@ -29,6 +29,20 @@ int RTPrioLevel{1};
 /* Allow reducing the process's RTTime limit for RTKit. */
 bool AllowRTTimeLimit{true};
 
+/* The CPUs each role's threads are restricted to, or empty for any. */
+std::array<std::vector<unsigned int>,ThreadRoleCount> ThreadAffinity;
+
+/* Use deadline scheduling for mixing threads, instead of a priority level. */
+bool UseRTDeadline{false};
+
+
+void SetThreadAffinity(ThreadRole role)
+{
+    const std::vector<unsigned int> &cpus = ThreadAffinity[static_cast<size_t>(role)];
+    if(!cpus.empty())
+        SetThreadCpuAffinity(cpus);
+}
+
 
 #ifdef _WIN32
 
@@ -177,6 +191,48 @@ std::vector<std::string> SearchDataFiles(const char *ext, const char *subdir)
     return results;
 }
 
+std::string GetUserCachePath(const char *subdir)
+{
+#if !defined(ALSOFT_UWP)
+    WCHAR buffer[MAX_PATH];
+    if(SHGetSpecialFolderPathW(nullptr, buffer, CSIDL_LOCAL_APPDATA, FALSE) == FALSE)
+        return {};
+
+    std::wstring path{buffer};
+    if(!path.empty() && (path.back() == L'\\' || path.back() == L'/'))
+        path.pop_back();
+
+    /* Create each directory of the subdirectory path as needed. */
+    const std::wstring wsubdir{utf8_to_wstr(subdir)};
+    size_t curpos{0u};
+    while(curpos < wsubdir.size())
+    {
+        size_t nextpos{wsubdir.find_first_of(L"/\\", curpos)};
+        const std::wstring name{(nextpos != std::wstring::npos) ?
+            wsubdir.substr(curpos, nextpos++ - curpos) : wsubdir.substr(curpos)};
+        curpos = nextpos;
+        if(name.empty()) continue;
+
+        path += L'\\';
+        path += name;
+        if(!CreateDirectoryW(path.c_str(), nullptr))
+        {
+            const DWORD err{GetLastError()};
+            if(err != ERROR_ALREADY_EXISTS)
+            {
+                WARN("Failed to create cache directory %s: error %lu\n",
+                    wstr_to_utf8(path.c_str()).c_str(), err);
+                return {};
+            }
+        }
+    }
+
+    return wstr_to_utf8(path.c_str());
+#else
+    return {};
+#endif
+}
+
 void SetRTPriority(void)
 {
 #if !defined(ALSOFT_UWP)
@@ -188,10 +244,93 @@ void SetRTPriority(void)
 #endif
 }
 
+bool SetThreadCpuAffinity(const al::span<const unsigned int> cpus)
+{
+#if !defined(ALSOFT_UWP)
+    DWORD_PTR mask{0};
+    for(const unsigned int cpu : cpus)
+    {
+        if(cpu < sizeof(mask)*8)
+            mask |= DWORD_PTR{1} << cpu;
+    }
+    if(mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0)
+        return true;
+    ERR("Failed to set thread affinity: error %lu\n", GetLastError());
+#endif
+    return false;
+}
+
+bool SetRTDeadline(uint64_t, uint64_t)
+{
+    WARN("Deadline scheduling not supported\n");
+    return false;
+}
+
+std::pair<std::shared_ptr<const void>,al::span<const char>> MapFile(const std::string &fname,
+    uint64_t offset, size_t length)
+{
+    const std::wstring wname{utf8_to_wstr(fname.c_str())};
+    HANDLE file{CreateFileW(wname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr)};
+    if(file == INVALID_HANDLE_VALUE)
+        return {};
+
+    LARGE_INTEGER fsize{};
+    if(!GetFileSizeEx(file, &fsize) || fsize.QuadPart <= 0
+        || offset >= static_cast<ULONGLONG>(fsize.QuadPart))
+    {
+        CloseHandle(file);
+        return {};
+    }
+    const ULONGLONG avail{static_cast<ULONGLONG>(fsize.QuadPart) - offset};
+    if(length == 0)
+    {
+        if(avail > std::numeric_limits<size_t>::max())
+        {
+            CloseHandle(file);
+            return {};
+        }
+        length = static_cast<size_t>(avail);
+    }
+    else if(length > avail)
+    {
+        CloseHandle(file);
+        return {};
+    }
+
+    HANDLE mapping{CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    CloseHandle(file);
+    if(!mapping)
+        return {};
+
+    /* Views need to start on a multiple of the allocation granularity. */
+    SYSTEM_INFO sysinfo{};
+    GetSystemInfo(&sysinfo);
+    const uint64_t base{offset - offset%sysinfo.dwAllocationGranularity};
+    const auto delta = static_cast<size_t>(offset - base);
+    void *ptr{MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(base>>32),
+        static_cast<DWORD>(base), delta+length)};
+    CloseHandle(mapping);
+    if(!ptr)
+        return {};
+
+    auto storage = std::shared_ptr<const void>{ptr,
+        [](const void *view) noexcept { UnmapViewOfFile(view); }};
+    return {std::move(storage), {static_cast<const char*>(ptr)+delta, length}};
+}
+
+void PrefetchMappedFile(const al::span<const char>)
+{
+    /* TODO: PrefetchVirtualMemory could be used on Windows 8 and newer. */
+}
+
 #else
 
 #include <cerrno>
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #ifdef __FreeBSD__
 #include <sys/sysctl.h>
@@ -202,10 +341,13 @@ void SetRTPriority(void)
 #ifdef HAVE_PROC_PIDPATH
 #include <libproc.h>
 #endif
-#if defined(HAVE_PTHREAD_SETSCHEDPARAM) && !defined(__OpenBSD__)
+#if (defined(HAVE_PTHREAD_SETSCHEDPARAM) && !defined(__OpenBSD__)) || defined(__linux__)
 #include <pthread.h>
 #include <sched.h>
 #endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #ifdef HAVE_RTKIT
 #include <sys/resource.h>
 
@@ -559,6 +701,53 @@ bool SetRTPriorityRTKit(int prio [[maybe_unused]])
 
 } // namespace
 
+std::string GetUserCachePath(const char *subdir)
+{
+    std::string path;
+    if(auto cachepath = al::getenv("XDG_CACHE_HOME"))
+    {
+        path = std::move(*cachepath);
+        if(!path.empty() && path.back() == '/')
+            path.pop_back();
+    }
+    else if(auto homepath = al::getenv("HOME"))
+    {
+        path = std::move(*homepath);
+        if(!path.empty() && path.back() == '/')
+            path.pop_back();
+        path += "/.cache";
+    }
+    if(path.empty())
+        return {};
+    if(mkdir(path.c_str(), 0700) != 0 && errno != EEXIST)
+    {
+        WARN("Failed to create cache directory %s: %s\n", path.c_str(), strerror(errno));
+        return {};
+    }
+
+    /* Create each directory of the subdirectory path as needed. */
+    const std::string dirs{subdir};
+    size_t curpos{0u};
+    while(curpos < dirs.size())
+    {
+        size_t nextpos{dirs.find('/', curpos)};
+        const std::string name{(nextpos != std::string::npos) ?
+            dirs.substr(curpos, nextpos++ - curpos) : dirs.substr(curpos)};
+        curpos = nextpos;
+        if(name.empty()) continue;
+
+        path += '/';
+        path += name;
+        if(mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            WARN("Failed to create cache directory %s: %s\n", path.c_str(), strerror(errno));
+            return {};
+        }
+    }
+
+    return path;
+}
+
 void SetRTPriority()
 {
     if(RTPrioLevel <= 0)
@@ -570,4 +759,119 @@ void SetRTPriority()
         return;
 }
 
+bool SetThreadCpuAffinity(const al::span<const unsigned int> cpus)
+{
+#ifdef __linux__
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for(const unsigned int cpu : cpus)
+    {
+        if(cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &cpuset);
+    }
+    const int err{pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)};
+    if(err == 0) return true;
+    WARN("pthread_setaffinity_np failed: %s (%d)\n", std::strerror(err), err);
+#else
+    WARN("Thread affinity not supported\n");
+#endif
+    return false;
+}
+
+bool SetRTDeadline(uint64_t runtime [[maybe_unused]], uint64_t period [[maybe_unused]])
+{
+#if defined(__linux__) && defined(SYS_sched_setattr)
+    /* Older C libraries don't have sched_setattr or its struct, so make the
+     * system call directly with the first version of the struct.
+     */
+    struct {
+        uint32_t size;
+        uint32_t sched_policy;
+        uint64_t sched_flags;
+        int32_t sched_nice;
+        uint32_t sched_priority;
+        uint64_t sched_runtime;
+        uint64_t sched_deadline;
+        uint64_t sched_period;
+    } attr{};
+    static constexpr uint32_t SchedDeadline{6};
+    static constexpr uint64_t SchedFlagResetOnFork{0x01};
+
+    attr.size = sizeof(attr);
+    attr.sched_policy = SchedDeadline;
+    attr.sched_flags = SchedFlagResetOnFork;
+    attr.sched_runtime = runtime;
+    attr.sched_deadline = period;
+    attr.sched_period = period;
+    if(syscall(SYS_sched_setattr, 0, &attr, 0) == 0)
+    {
+        TRACE("Set deadline scheduling, runtime %lluns, period %lluns\n",
+            static_cast<unsigned long long>(runtime), static_cast<unsigned long long>(period));
+        return true;
+    }
+    const int err{errno};
+    WARN("sched_setattr failed: %s (%d)\n", std::strerror(err), err);
+#else
+    WARN("Deadline scheduling not supported\n");
+#endif
+    return false;
+}
+
+std::pair<std::shared_ptr<const void>,al::span<const char>> MapFile(const std::string &fname,
+    uint64_t offset, size_t length)
+{
+    const int fd{open(fname.c_str(), O_RDONLY | O_CLOEXEC)};
+    if(fd == -1)
+        return {};
+
+    struct stat fstats{};
+    if(fstat(fd, &fstats) != 0 || fstats.st_size <= 0
+        || offset >= static_cast<uint64_t>(fstats.st_size))
+    {
+        close(fd);
+        return {};
+    }
+    const uint64_t avail{static_cast<uint64_t>(fstats.st_size) - offset};
+    if(length == 0)
+    {
+        if(avail > std::numeric_limits<size_t>::max())
+        {
+            close(fd);
+            return {};
+        }
+        length = static_cast<size_t>(avail);
+    }
+    else if(length > avail)
+    {
+        close(fd);
+        return {};
+    }
+
+    /* Mappings need to start on a page boundary. */
+    const auto pagesize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t base{offset - offset%pagesize};
+    const auto delta = static_cast<size_t>(offset - base);
+    const size_t mapsize{delta + length};
+    void *ptr{mmap(nullptr, mapsize, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(base))};
+    close(fd);
+    if(ptr == MAP_FAILED)
+        return {};
+
+    auto storage = std::shared_ptr<const void>{ptr,
+        [mapsize](const void *view) noexcept { munmap(const_cast<void*>(view), mapsize); }};
+    return {std::move(storage), {static_cast<const char*>(ptr)+delta, length}};
+}
+
+void PrefetchMappedFile(const al::span<const char> data)
+{
+    if(data.empty())
+        return;
+
+    /* The advice is given for whole pages. */
+    const auto pagesize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto start = reinterpret_cast<uintptr_t>(data.data());
+    const uintptr_t base{start - start%pagesize};
+    posix_madvise(reinterpret_cast<void*>(base), data.size() + (start-base), POSIX_MADV_WILLNEED);
+}
+
 #endif
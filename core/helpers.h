@@ -1,10 +1,16 @@
 #ifndef CORE_HELPERS_H
 #define CORE_HELPERS_H
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <utility>
 #include <string>
 #include <vector>
 
+#include "alspan.h"
+
 
 struct PathNamePair {
     std::string path, fname;
@@ -21,6 +27,46 @@ extern int RTPrioLevel;
 extern bool AllowRTTimeLimit;
 void SetRTPriority(void);
 
+/* The roles of the library's threads that can be pinned to specific CPUs. */
+enum class ThreadRole : uint8_t {
+    Mixer,
+    Worker,
+    Event,
+    Capture
+};
+inline constexpr size_t ThreadRoleCount{4};
+
+extern std::array<std::vector<unsigned int>,ThreadRoleCount> ThreadAffinity;
+extern bool UseRTDeadline;
+
+/* Restricts the calling thread to the given CPUs. */
+bool SetThreadCpuAffinity(const al::span<const unsigned int> cpus);
+/* Restricts the calling thread to the CPUs set for its role, if any. */
+void SetThreadAffinity(ThreadRole role);
+
+/* Switches the calling thread to deadline scheduling, where it's guaranteed
+ * runtime nanoseconds of processing every period nanoseconds. Returns false
+ * if it isn't supported or allowed.
+ */
+bool SetRTDeadline(uint64_t runtime, uint64_t period);
+
 std::vector<std::string> SearchDataFiles(const char *match, const char *subdir);
 
+/* Gets the given subdirectory of the user's cache directory, creating it if
+ * needed. Returns an empty string if it isn't available.
+ */
+std::string GetUserCachePath(const char *subdir);
+
+/* Maps a range of the file into memory, read-only, with a length of 0 mapping
+ * the rest of the file. The returned storage keeps the file mapped until
+ * released, and is null if the range couldn't be mapped.
+ */
+std::pair<std::shared_ptr<const void>,al::span<const char>> MapFile(const std::string &fname,
+    uint64_t offset=0, size_t length=0);
+
+/* Hints that the given range of mapped file data will be read soon, so it can
+ * start being paged in.
+ */
+void PrefetchMappedFile(const al::span<const char> data);
+
 #endif /* CORE_HELPERS_H */
@@ -7,6 +7,8 @@
 #include <array>
 #include <cassert>
 #include <cctype>
+#include <cerrno>
+#include <cinttypes>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -14,10 +16,13 @@
 #include <cstring>
 #include <fstream>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <numeric>
 #include <optional>
+#include <string>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -29,13 +34,24 @@
 #include "alnumeric.h"
 #include "alspan.h"
 #include "ambidefs.h"
+#include "cpu_caps.h"
 #include "filters/splitter.h"
 #include "helpers.h"
+#include "hrtf_pack.h"
 #include "logging.h"
 #include "mixer/hrtfdefs.h"
 #include "opthelpers.h"
 #include "polyphase_resampler.h"
 
+#ifdef _WIN32
+#include <windows.h>
+
+#include "strutils.h"
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 
 namespace {
 
@@ -80,6 +96,9 @@ constexpr uint MaxEvCount{181};
 constexpr uint MinAzCount{1};
 constexpr uint MaxAzCount{255};
 
+constexpr uint MinVariantCount{1};
+constexpr uint MaxVariantCount{16};
+
 constexpr uint MaxHrirDelay{HrtfHistoryLength - 1};
 
 constexpr uint HrirDelayFracBits{2};
@@ -92,6 +111,7 @@ constexpr char magicMarker00[8]{'M','i','n','P','H','R','0','0'};
 constexpr char magicMarker01[8]{'M','i','n','P','H','R','0','1'};
 constexpr char magicMarker02[8]{'M','i','n','P','H','R','0','2'};
 constexpr char magicMarker03[8]{'M','i','n','P','H','R','0','3'};
+constexpr char magicMarker04[8]{'M','i','n','P','H','R','0','4'};
 
 /* First value for pass-through coefficients (remaining are 0), used for omni-
  * directional sounds. */
@@ -171,7 +191,80 @@ public:
     idstream(const char *start_, const char *end_)
       : std::istream{nullptr}, mStreamBuf{start_, end_}
     { init(&mStreamBuf); }
+    ~idstream() override;
 };
+idstream::~idstream() = default;
+
+
+/* Writes the data to the named file. It's first written to a temporary file,
+ * which then replaces the named file so a partially written file is never
+ * seen by other processes.
+ */
+bool StoreFile(const std::string &fname, const al::span<const char> data)
+{
+#ifdef _WIN32
+    const std::wstring wname{utf8_to_wstr(fname.c_str())};
+    const std::wstring tmpname{wname + L'.' + std::to_wstring(GetCurrentProcessId()) + L".tmp"};
+    HANDLE file{CreateFileW(tmpname.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr)};
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    bool ok{true};
+    size_t total{0};
+    while(ok && total < data.size())
+    {
+        const auto todo = static_cast<DWORD>(std::min<size_t>(data.size()-total, 1u<<30));
+        DWORD wrote{};
+        ok = WriteFile(file, data.data()+total, todo, &wrote, nullptr) != FALSE && wrote > 0;
+        total += wrote;
+    }
+    CloseHandle(file);
+
+    if(ok)
+        ok = MoveFileExW(tmpname.c_str(), wname.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+    if(!ok)
+        DeleteFileW(tmpname.c_str());
+#else
+
+    const std::string tmpname{fname + '.' + std::to_string(getpid()) + ".tmp"};
+    const int fd{open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+    if(fd == -1)
+        return false;
+
+    bool ok{true};
+    size_t total{0};
+    while(ok && total < data.size())
+    {
+        const ssize_t wrote{write(fd, data.data()+total, data.size()-total)};
+        if(wrote < 0 && errno == EINTR)
+            continue;
+        ok = wrote > 0;
+        if(ok) total += static_cast<size_t>(wrote);
+    }
+    if(close(fd) != 0)
+        ok = false;
+
+    if(ok)
+        ok = rename(tmpname.c_str(), fname.c_str()) == 0;
+    if(!ok)
+        unlink(tmpname.c_str());
+#endif
+
+    return ok;
+}
+
+/* 64-bit FNV-1a hash of the data, identifying a data set's cached variants. */
+uint64_t HashData(const al::span<const char> data) noexcept
+{
+    uint64_t hash{0xcbf29ce484222325_u64};
+    for(const char c : data)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3_u64;
+    }
+    return hash;
+}
 
 
 struct IdxBlend { uint idx; float blend; };
@@ -199,43 +292,31 @@ IdxBlend CalcAzIndex(uint azcount, float az)
     return IdxBlend{idx%azcount, az-static_cast<float>(idx)};
 }
 
-} // namespace
-
 
-/* Calculates static HRIR coefficients and delays for the given polar elevation
- * and azimuth in radians. The coefficients are normalized.
+/* Blends the four measured HRIRs surrounding the given direction in the field,
+ * attenuated by the directional panning factor, and the matching delays (in
+ * fixed-point fractional samples).
  */
-void HrtfStore::getCoeffs(float elevation, float azimuth, float distance, float spread,
-    HrirArray &coeffs, const al::span<uint,2> delays)
+void BlendHrirs(const HrtfStore &hrtf, const HrtfStore::Field &field, const size_t ebase,
+    const float elevation, const float azimuth, const float dirfact, HrirArray &coeffs,
+    const al::span<float,2> delays)
 {
-    const float dirfact{1.0f - (al::numbers::inv_pi_v<float>/2.0f * spread)};
-
-    size_t ebase{0};
-    auto match_field = [&ebase,distance](const Field &field) noexcept -> bool
-    {
-        if(distance >= field.distance)
-            return true;
-        ebase += field.evCount;
-        return false;
-    };
-    auto field = std::find_if(mFields.begin(), mFields.end()-1, match_field);
-
     /* Calculate the elevation indices. */
-    const auto elev0 = CalcEvIndex(field->evCount, elevation);
-    const size_t elev1_idx{minu(elev0.idx+1, field->evCount-1)};
-    const size_t ir0offset{mElev[ebase + elev0.idx].irOffset};
-    const size_t ir1offset{mElev[ebase + elev1_idx].irOffset};
+    const auto elev0 = CalcEvIndex(field.evCount, elevation);
+    const size_t elev1_idx{minu(elev0.idx+1, field.evCount-1)};
+    const size_t ir0offset{hrtf.mElev[ebase + elev0.idx].irOffset};
+    const size_t ir1offset{hrtf.mElev[ebase + elev1_idx].irOffset};
 
     /* Calculate azimuth indices. */
-    const auto az0 = CalcAzIndex(mElev[ebase + elev0.idx].azCount, azimuth);
-    const auto az1 = CalcAzIndex(mElev[ebase + elev1_idx].azCount, azimuth);
+    const auto az0 = CalcAzIndex(hrtf.mElev[ebase + elev0.idx].azCount, azimuth);
+    const auto az1 = CalcAzIndex(hrtf.mElev[ebase + elev1_idx].azCount, azimuth);
 
     /* Calculate the HRIR indices to blend. */
     const size_t idx[4]{
         ir0offset + az0.idx,
-        ir0offset + ((az0.idx+1) % mElev[ebase + elev0.idx].azCount),
+        ir0offset + ((az0.idx+1) % hrtf.mElev[ebase + elev0.idx].azCount),
         ir1offset + az1.idx,
-        ir1offset + ((az1.idx+1) % mElev[ebase + elev1_idx].azCount)
+        ir1offset + ((az1.idx+1) % hrtf.mElev[ebase + elev1_idx].azCount)
     };
 
     /* Calculate bilinear blending weights, attenuated according to the
@@ -249,12 +330,11 @@ void HrtfStore::getCoeffs(float elevation, float azimuth, float distance, float
     };
 
     /* Calculate the blended HRIR delays. */
-    float d{mDelays[idx[0]][0]*blend[0] + mDelays[idx[1]][0]*blend[1] + mDelays[idx[2]][0]*blend[2]
-        + mDelays[idx[3]][0]*blend[3]};
-    delays[0] = fastf2u(d * float{1.0f/HrirDelayFracOne});
-    d = mDelays[idx[0]][1]*blend[0] + mDelays[idx[1]][1]*blend[1] + mDelays[idx[2]][1]*blend[2]
-        + mDelays[idx[3]][1]*blend[3];
-    delays[1] = fastf2u(d * float{1.0f/HrirDelayFracOne});
+    const ubyte2 *hrirdelays{hrtf.mDelays};
+    delays[0] = hrirdelays[idx[0]][0]*blend[0] + hrirdelays[idx[1]][0]*blend[1]
+        + hrirdelays[idx[2]][0]*blend[2] + hrirdelays[idx[3]][0]*blend[3];
+    delays[1] = hrirdelays[idx[0]][1]*blend[0] + hrirdelays[idx[1]][1]*blend[1]
+        + hrirdelays[idx[2]][1]*blend[2] + hrirdelays[idx[3]][1]*blend[3];
 
     /* Calculate the blended HRIR coefficients. */
     float *coeffout{al::assume_aligned<16>(coeffs[0].data())};
@@ -263,7 +343,7 @@ void HrtfStore::getCoeffs(float elevation, float azimuth, float distance, float
     std::fill_n(coeffout+2, size_t{HrirLength-1}*2, 0.0f);
     for(size_t c{0};c < 4;c++)
     {
-        const float *srccoeffs{al::assume_aligned<16>(mCoeffs[idx[c]][0].data())};
+        const float *srccoeffs{al::assume_aligned<16>(hrtf.mCoeffs[idx[c]][0].data())};
         const float mult{blend[c]};
         auto blend_coeffs = [mult](const float src, const float coeff) noexcept -> float
         { return src*mult + coeff; };
@@ -271,10 +351,184 @@ void HrtfStore::getCoeffs(float elevation, float azimuth, float distance, float
     }
 }
 
+} // namespace
+
+
+/* Calculates static HRIR coefficients and delays for the given polar elevation
+ * and azimuth in radians. The coefficients are normalized.
+ */
+void HrtfStore::getCoeffs(float elevation, float azimuth, float distance, float spread,
+    HrirArray &coeffs, const al::span<uint,2> delays)
+{
+    const float dirfact{1.0f - (al::numbers::inv_pi_v<float>/2.0f * spread)};
+
+    size_t ebase{0};
+    auto match_field = [&ebase,distance](const Field &field) noexcept -> bool
+    {
+        if(distance >= field.distance)
+            return true;
+        ebase += field.evCount;
+        return false;
+    };
+    auto field = std::find_if(mFields.begin(), mFields.end()-1, match_field);
+
+    if(!mGridDelays.empty())
+    {
+        /* Look up the nearest grid direction, and attenuate it according to
+         * the directional panning factor.
+         */
+        const float evscale{static_cast<float>(mGridEvCount-1) * al::numbers::inv_pi_v<float>};
+        const float azscale{static_cast<float>(mGridAzCount) * al::numbers::inv_pi_v<float>
+            * 0.5f};
+        const float ev{maxf((al::numbers::pi_v<float>*0.5f + elevation)*evscale, 0.0f)};
+        const float az{(al::numbers::pi_v<float>*2.0f + azimuth)*azscale};
+        const size_t evidx{minu(float2uint(ev + 0.5f), mGridEvCount-1)};
+        const size_t azidx{float2uint(az + 0.5f) % mGridAzCount};
+        const size_t fidx{static_cast<size_t>(std::distance(mFields.begin(), field))};
+        const size_t point{(fidx*mGridEvCount + evidx)*mGridAzCount + azidx};
+
+        delays[0] = fastf2u(mGridDelays[point][0] * dirfact);
+        delays[1] = fastf2u(mGridDelays[point][1] * dirfact);
+
+        const float2 *srccoeffs{al::assume_aligned<16>(mGridCoeffs.data() + point*mGridStride)};
+        auto scale_coeffs = [dirfact](const float2 &src) noexcept -> float2
+        { return float2{{src[0]*dirfact, src[1]*dirfact}}; };
+        auto coeffout = std::transform(srccoeffs, srccoeffs+mIrSize, coeffs.begin(),
+            scale_coeffs);
+        std::fill(coeffout, coeffs.end(), float2{});
+        coeffs[0][0] += PassthruCoeff * (1.0f-dirfact);
+        coeffs[0][1] += PassthruCoeff * (1.0f-dirfact);
+        return;
+    }
+
+    std::array<float,2> d{};
+    BlendHrirs(*this, *field, ebase, elevation, azimuth, dirfact, coeffs, d);
+    delays[0] = fastf2u(d[0] * float{1.0f/HrirDelayFracOne});
+    delays[1] = fastf2u(d[1] * float{1.0f/HrirDelayFracOne});
+}
+
+void HrtfStore::buildGrid(const uint resolution)
+{
+    /* Space the grid evenly, with the poles included, so that no two
+     * neighboring directions are more than the resolution apart.
+     */
+    mGridRes = resolution;
+    mGridEvCount = (180u+resolution-1u)/resolution + 1u;
+    mGridAzCount = (360u+resolution-1u)/resolution;
+    mGridStride = RoundUp(size_t{mIrSize}, 2);
+
+    const size_t numPoints{mFields.size() * mGridEvCount * mGridAzCount};
+    mGridCoeffs.resize(numPoints * mGridStride);
+    mGridDelays.resize(numPoints);
+
+    alignas(16) HrirArray coeffs{};
+    size_t point{0};
+    size_t ebase{0};
+    for(const Field &field : mFields)
+    {
+        for(uint ei{0};ei < mGridEvCount;++ei)
+        {
+            const float ev{static_cast<float>(ei)/static_cast<float>(mGridEvCount-1)
+                * al::numbers::pi_v<float> - al::numbers::pi_v<float>*0.5f};
+            for(uint ai{0};ai < mGridAzCount;++ai)
+            {
+                const float az{static_cast<float>(ai)/static_cast<float>(mGridAzCount)
+                    * al::numbers::pi_v<float>*2.0f};
+
+                std::array<float,2> d{};
+                BlendHrirs(*this, field, ebase, ev, az, 1.0f, coeffs, d);
+                mGridDelays[point] = float2{{d[0] / float{HrirDelayFracOne},
+                    d[1] / float{HrirDelayFracOne}}};
+                std::copy_n(coeffs.cbegin(), mIrSize, mGridCoeffs.begin() + point*mGridStride);
+                ++point;
+            }
+        }
+        ebase += field.evCount;
+    }
+
+    TRACE("Built %ux%u HRTF grid for %zu field%s (%u degree resolution, %zukb)\n",
+        mGridAzCount, mGridEvCount, mFields.size(), (mFields.size()==1) ? "" : "s", resolution,
+        (mGridCoeffs.size()*sizeof(mGridCoeffs[0]) + mGridDelays.size()*sizeof(mGridDelays[0])
+            + 1023) / 1024);
+}
+
+
+namespace {
+
+/* Stores the packed bins of a real FFT as split real and imaginary values,
+ * with the purely real DC and Nyquist bins unpacked.
+ */
+void UnpackRealBins(const al::span<const std::complex<float>> fftbuffer, float *RESTRICT re,
+    float *RESTRICT im)
+{
+    const size_t count{fftbuffer.size()};
+    re[0] = fftbuffer[0].real();
+    im[0] = 0.0f;
+    for(size_t i{1};i < count;++i)
+    {
+        re[i] = fftbuffer[i].real();
+        im[i] = fftbuffer[i].imag();
+    }
+    re[count] = fftbuffer[0].imag();
+    im[count] = 0.0f;
+}
+
+/* The segment size for applying the tail of a direct HRTF response with FFTs.
+ * Smaller segments replace more of the FIR's coefficients, but the extra FFTs
+ * cost more than they save.
+ */
+constexpr uint HrtfTailSegSamples{32};
+
+/* Chooses the segment size for applying the tail of a direct HRTF response of
+ * the given length with FFTs, or 0 to apply all of it directly.
+ *
+ * The FFT'd tail has a mostly fixed cost for each channel's samples, from the
+ * forward FFTs and the inverse FFTs for each ear (shared by all channels). So
+ * it's only cheaper when it replaces enough of the FIR's coefficients, which
+ * depends on how fast the selected mixer applies them. The base break-even
+ * counts are approximate, as measured.
+ */
+uint ChooseTailSegSamples(const uint irSize, const size_t numChans) noexcept
+{
+    auto get_breakeven = []() noexcept -> float
+    {
+#ifdef HAVE_NEON
+        if((CPUCapFlags&CPU_CAP_NEON))
+            return 40.0f;
+#endif
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+            return 80.0f;
+#endif
+#ifdef HAVE_SSE
+        if((CPUCapFlags&CPU_CAP_SSE))
+            return 40.0f;
+#endif
+        return 28.0f;
+    };
+    const float breakeven{get_breakeven() * (1.0f + 2.0f/static_cast<float>(numChans))};
+
+    if(static_cast<float>(irSize - minu(irSize, HrtfTailSegSamples)) <= breakeven)
+        return 0;
+    return HrtfTailSegSamples;
+}
+
+} // namespace
 
 std::unique_ptr<DirectHrtfState> DirectHrtfState::Create(size_t num_chans)
 { return std::unique_ptr<DirectHrtfState>{new(FamCount(num_chans)) DirectHrtfState{num_chans}}; }
 
+DirectHrtfState::~DirectHrtfState() = default;
+
+size_t DirectHrtfState::memoryUsage() const noexcept
+{
+    return Sizeof(mChannels.size())
+        + (mTailInput.capacity() + mTailSegment.capacity() + mTailHistory.capacity()
+            + mTailFilter.capacity() + mTailOutput.capacity() + mTailAccum.capacity())
+            * sizeof(float)
+        + mTailFftBuffer.capacity()*sizeof(std::complex<float>);
+}
+
 void DirectHrtfState::build(const HrtfStore *Hrtf, const uint irSize, const bool perHrirMin,
     const al::span<const AngularPoint> AmbiPoints, const float (*AmbiMatrix)[MaxAmbiChannels],
     const float XOverFreq, const al::span<const float,MaxAmbiOrder+1> AmbiOrderHFGain)
@@ -368,15 +622,186 @@ void DirectHrtfState::build(const HrtfStore *Hrtf, const uint irSize, const bool
     TRACE("New max delay: %.2f, FIR length: %u\n", max_delay/double{HrirDelayFracOne},
         max_length);
     mIrSize = max_length;
+
+    const uint segsamples{ChooseTailSegSamples(max_length, mChannels.size())};
+    if(!segsamples)
+        return;
+
+    const size_t numchans{mChannels.size()};
+    const size_t numsegs{(max_length-1)/segsamples};
+    const size_t binstride{RoundUp(segsamples+1, 4)};
+    mIrSize = segsamples;
+    mTailSegs = static_cast<uint>(numsegs);
+    mTailSegSamples = segsamples;
+    mTailBinStride = binstride;
+    mTailFft = FftPlan<float>{segsamples};
+
+    mTailInput.resize(numchans * BufferLineSize);
+    mTailSegment.resize(numchans * segsamples);
+    mTailHistory.resize(numchans * numsegs * binstride*2);
+    mTailFilter.resize(2 * numchans * numsegs * binstride*2);
+    mTailOutput.resize(2 * segsamples*2);
+    mTailFftBuffer.resize(segsamples);
+    mTailAccum.resize(binstride*2);
+
+    /* Calculate the frequency-domain response of each filter segment, for each
+     * ear and channel. The iFFT'd output is scaled up by the number of real
+     * samples, so the filters include the inverse to normalize it.
+     */
+    const size_t halfsize{segsamples / 2};
+    const float scale{1.0f / static_cast<float>(segsamples*2)};
+    const al::span<std::complex<float>> fftbuffer{mTailFftBuffer};
+    float *filter{mTailFilter.data()};
+    for(size_t ear{0};ear < 2;++ear)
+    {
+        for(size_t c{0};c < numchans;++c)
+        {
+            const ConstHrirSpan coeffs{mChannels[c].mCoeffs};
+            for(size_t s{0};s < numsegs;++s)
+            {
+                const size_t offset{segsamples*(s+1)};
+                auto get_coeff = [coeffs,offset,ear,max_length,scale](const size_t i) noexcept
+                { return (offset+i < max_length) ? coeffs[offset+i][ear]*scale : 0.0f; };
+                for(size_t i{0};i < halfsize;++i)
+                    fftbuffer[i] = std::complex<float>{get_coeff(i*2), get_coeff(i*2 + 1)};
+                std::fill(fftbuffer.begin()+halfsize, fftbuffer.end(), std::complex<float>{});
+                mTailFft.forwardReal(fftbuffer);
+
+                float *RESTRICT filterre{filter};
+                float *RESTRICT filterim{filter + binstride};
+                UnpackRealBins(fftbuffer, filterre, filterim);
+                filter += binstride*2;
+            }
+        }
+    }
+
+    TRACE("Using %u-sample direct FIR with %zu FFT segment%s\n", segsamples, numsegs,
+        (numsegs==1) ? "" : "s");
+}
+
+void DirectHrtfState::processTail(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
+    const size_t samplesToDo)
+{
+    const size_t segsamples{mTailSegSamples};
+    const size_t numchans{mChannels.size()};
+
+    for(size_t base{0u};base < samplesToDo;)
+    {
+        const size_t todo{minz(segsamples-mTailFifoPos, samplesToDo-base)};
+
+        /* Store the new input for the next segment, and add the tail's output
+         * for the current segment.
+         */
+        for(size_t c{0};c < numchans;++c)
+            std::copy_n(mTailInput.cbegin() + c*BufferLineSize + base, todo,
+                mTailSegment.begin() + c*segsamples + mTailFifoPos);
+
+        const auto left_iter = mTailOutput.cbegin() + mTailFifoPos;
+        const auto right_iter = left_iter + segsamples*2;
+        std::transform(left_iter, left_iter+todo, LeftOut.begin()+base, LeftOut.begin()+base,
+            std::plus<>{});
+        std::transform(right_iter, right_iter+todo, RightOut.begin()+base,
+            RightOut.begin()+base, std::plus<>{});
+
+        mTailFifoPos += todo;
+        base += todo;
+
+        if(mTailFifoPos < segsamples) break;
+        mTailFifoPos = 0;
+
+        processTailSegment();
+    }
+}
+
+void DirectHrtfState::processTailSegment()
+{
+    const size_t segsamples{mTailSegSamples};
+    const size_t halfsize{segsamples / 2};
+    const size_t binstride{mTailBinStride};
+    const size_t numsegs{mTailSegs};
+    const size_t numchans{mChannels.size()};
+    const al::span<std::complex<float>> fftbuffer{mTailFftBuffer};
+    const size_t curseg{mTailCurrentSeg};
+
+    /* Calculate the frequency-domain response of each channel's new segment
+     * and add it to the FFT history. The latter half of the FFT's input is
+     * silent.
+     */
+    for(size_t c{0};c < numchans;++c)
+    {
+        const float *input{mTailSegment.data() + c*segsamples};
+        for(size_t i{0};i < halfsize;++i)
+            fftbuffer[i] = std::complex<float>{input[i*2], input[i*2 + 1]};
+        std::fill(fftbuffer.begin()+halfsize, fftbuffer.end(), std::complex<float>{});
+        mTailFft.forwardReal(fftbuffer);
+
+        float *RESTRICT historyre{mTailHistory.data() + (c*numsegs + curseg)*binstride*2};
+        float *RESTRICT historyim{historyre + binstride};
+        UnpackRealBins(fftbuffer, historyre, historyim);
+    }
+
+    /* Each filter segment plays one segment after the last, so the first one
+     * pairs with the newest input segment, the second with the one before it,
+     * etc. This results in the output for the next segment.
+     */
+    const float *filter{mTailFilter.data()};
+    float *RESTRICT accumre{mTailAccum.data()};
+    float *RESTRICT accumim{accumre + binstride};
+    for(size_t ear{0};ear < 2;++ear)
+    {
+        std::fill(mTailAccum.begin(), mTailAccum.end(), 0.0f);
+        for(size_t c{0};c < numchans;++c)
+        {
+            const float *history{mTailHistory.data() + c*numsegs*binstride*2};
+            size_t seg{curseg};
+            for(size_t s{0};s < numsegs;++s)
+            {
+                const float *segin{history + seg*binstride*2};
+                complex_mac(accumre, accumim, segin, segin+binstride, filter, filter+binstride,
+                    binstride);
+                filter += binstride*2;
+                if(++seg == numsegs) seg = 0;
+            }
+        }
+
+        /* Apply iFFT to get the 2N (really 2N-1) samples. The first N are
+         * combined with the last output's second half for the next segment's
+         * output, and the second half is saved for next time.
+         */
+        fftbuffer[0] = std::complex<float>{accumre[0], accumre[segsamples]};
+        for(size_t i{1};i < segsamples;++i)
+            fftbuffer[i] = std::complex<float>{accumre[i], accumim[i]};
+        mTailFft.inverseReal(fftbuffer);
+
+        float *RESTRICT output{mTailOutput.data() + segsamples*2*ear};
+        float *RESTRICT overlap{output + segsamples};
+        for(size_t i{0};i < halfsize;++i)
+        {
+            output[i*2] = fftbuffer[i].real() + overlap[i*2];
+            output[i*2 + 1] = fftbuffer[i].imag() + overlap[i*2 + 1];
+        }
+        for(size_t i{0};i < halfsize;++i)
+        {
+            overlap[i*2] = fftbuffer[halfsize+i].real();
+            overlap[i*2 + 1] = fftbuffer[halfsize+i].imag();
+        }
+    }
+
+    /* Shift the input history. */
+    mTailCurrentSeg = curseg ? (curseg-1) : (numsegs-1);
 }
 
 
 namespace {
 
+/* Creates an HRTF store with a copy of the given data. If storage is given,
+ * the coefficients and delays are used in place instead of copied, and the
+ * storage is kept alive with the HRTF.
+ */
 std::unique_ptr<HrtfStore> CreateHrtfStore(uint rate, uint8_t irSize,
     const al::span<const HrtfStore::Field> fields,
     const al::span<const HrtfStore::Elevation> elevs, const HrirArray *coeffs,
-    const ubyte2 *delays, const char *filename)
+    const ubyte2 *delays, const char *filename, std::shared_ptr<const void> storage={})
 {
     const size_t irCount{size_t{elevs.back().azCount} + elevs.back().irOffset};
     size_t total{sizeof(HrtfStore)};
@@ -384,9 +809,12 @@ std::unique_ptr<HrtfStore> CreateHrtfStore(uint rate, uint8_t irSize,
     total += sizeof(std::declval<HrtfStore&>().mFields[0])*fields.size();
     total  = RoundUp(total, alignof(HrtfStore::Elevation)); /* Align for elevation infos */
     total += sizeof(std::declval<HrtfStore&>().mElev[0])*elevs.size();
-    total  = RoundUp(total, 16); /* Align for coefficients using SIMD */
-    total += sizeof(std::declval<HrtfStore&>().mCoeffs[0])*irCount;
-    total += sizeof(std::declval<HrtfStore&>().mDelays[0])*irCount;
+    if(!storage)
+    {
+        total  = RoundUp(total, 16); /* Align for coefficients using SIMD */
+        total += sizeof(std::declval<HrtfStore&>().mCoeffs[0])*irCount;
+        total += sizeof(std::declval<HrtfStore&>().mDelays[0])*irCount;
+    }
 
     std::unique_ptr<HrtfStore> Hrtf{};
     if(void *ptr{al_calloc(16, total)})
@@ -395,6 +823,7 @@ std::unique_ptr<HrtfStore> CreateHrtfStore(uint rate, uint8_t irSize,
         InitRef(Hrtf->mRef, 1u);
         Hrtf->mSampleRate = rate & 0xff'ff'ff;
         Hrtf->mIrSize = irSize;
+        Hrtf->mAllocSize = total;
 
         /* Set up pointers to storage following the main HRTF struct. */
         char *base = reinterpret_cast<char*>(Hrtf.get());
@@ -408,27 +837,34 @@ std::unique_ptr<HrtfStore> CreateHrtfStore(uint rate, uint8_t irSize,
         auto elev_ = reinterpret_cast<HrtfStore::Elevation*>(base + offset);
         offset += sizeof(elev_[0])*elevs.size();
 
-        offset = RoundUp(offset, 16); /* Align for coefficients using SIMD */
-        auto coeffs_ = reinterpret_cast<HrirArray*>(base + offset);
-        offset += sizeof(coeffs_[0])*irCount;
+        /* Copy input data to storage. */
+        std::uninitialized_copy(fields.cbegin(), fields.cend(), field_);
+        std::uninitialized_copy(elevs.cbegin(), elevs.cend(), elev_);
+
+        if(!storage)
+        {
+            offset = RoundUp(offset, 16); /* Align for coefficients using SIMD */
+            auto coeffs_ = reinterpret_cast<HrirArray*>(base + offset);
+            offset += sizeof(coeffs_[0])*irCount;
+
+            auto delays_ = reinterpret_cast<ubyte2*>(base + offset);
+            offset += sizeof(delays_[0])*irCount;
 
-        auto delays_ = reinterpret_cast<ubyte2*>(base + offset);
-        offset += sizeof(delays_[0])*irCount;
+            std::uninitialized_copy_n(coeffs, irCount, coeffs_);
+            std::uninitialized_copy_n(delays, irCount, delays_);
+            coeffs = coeffs_;
+            delays = delays_;
+        }
 
         if(offset != total)
             throw std::runtime_error{"HrtfStore allocation size mismatch"};
 
-        /* Copy input data to storage. */
-        std::uninitialized_copy(fields.cbegin(), fields.cend(), field_);
-        std::uninitialized_copy(elevs.cbegin(), elevs.cend(), elev_);
-        std::uninitialized_copy_n(coeffs, irCount, coeffs_);
-        std::uninitialized_copy_n(delays, irCount, delays_);
-
         /* Finally, assign the storage pointers. */
         Hrtf->mFields = {field_, fields.size()};
         Hrtf->mElev = elev_;
-        Hrtf->mCoeffs = coeffs_;
-        Hrtf->mDelays = delays_;
+        Hrtf->mCoeffs = coeffs;
+        Hrtf->mDelays = delays;
+        Hrtf->mStorage = std::move(storage);
     }
     else
         ERR("Out of memory allocating storage for %s.\n", filename);
@@ -471,7 +907,7 @@ T> fixsign(T value) noexcept
 { return value; }
 
 template<typename T, size_t num_bits=sizeof(T)*8>
-inline std::enable_if_t<al::endian::native == al::endian::little,
+std::enable_if_t<al::endian::native == al::endian::little,
 T> readle(std::istream &data)
 {
     static_assert((num_bits&7) == 0, "num_bits must be a multiple of 8");
@@ -485,7 +921,7 @@ T> readle(std::istream &data)
 }
 
 template<typename T, size_t num_bits=sizeof(T)*8>
-inline std::enable_if_t<al::endian::native == al::endian::big,
+std::enable_if_t<al::endian::native == al::endian::big,
 T> readle(std::istream &data)
 {
     static_assert((num_bits&7) == 0, "num_bits must be a multiple of 8");
@@ -1120,6 +1556,282 @@ std::unique_ptr<HrtfStore> LoadHrtf03(std::istream &data, const char *filename)
 }
 
 
+/* Loads a MinPHR04 data set, which holds one or more variants of the HRIRs
+ * for different sample rates. The variant with the closest sample rate is
+ * used, and when it matches the device rate and storage is given, its
+ * coefficients and delays are used directly from the data instead of copied.
+ */
+std::unique_ptr<HrtfStore> LoadHrtf04(const al::span<const char> data,
+    std::shared_ptr<const void> storage, const uint devrate, const char *filename)
+{
+    idstream stream{data.data(), data.data()+data.size()};
+    stream.seekg(sizeof(magicMarker04));
+
+    const uint variantCount{readle<uint32_t>(stream)};
+    std::ignore = readle<uint32_t>(stream);
+    if(!stream || stream.eof())
+    {
+        ERR("Failed reading %s\n", filename);
+        return nullptr;
+    }
+    if(variantCount < MinVariantCount || variantCount > MaxVariantCount)
+    {
+        ERR("Unsupported number of variants: variantCount=%d (%d to %d)\n", variantCount,
+            MinVariantCount, MaxVariantCount);
+        return nullptr;
+    }
+
+    /* Find the variant with the closest sample rate. */
+    uint rate{0}, irSize{0}, varOffset{0};
+    for(uint i{0};i < variantCount;++i)
+    {
+        const uint varRate{readle<uint32_t>(stream)};
+        const uint varIrSize{readle<uint32_t>(stream)};
+        const uint offset{readle<uint32_t>(stream)};
+        std::ignore = readle<uint32_t>(stream);
+        if(!stream || stream.eof())
+        {
+            ERR("Failed reading %s\n", filename);
+            return nullptr;
+        }
+
+        auto rate_diff = [devrate](const uint r) noexcept
+        { return std::max(r, devrate) - std::min(r, devrate); };
+        if(i == 0 || rate_diff(varRate) < rate_diff(rate))
+        {
+            rate = varRate;
+            irSize = varIrSize;
+            varOffset = offset;
+        }
+    }
+
+    if(irSize < MinIrLength || irSize > HrirLength)
+    {
+        ERR("Unsupported HRIR size, irSize=%d (%d to %d)\n", irSize, MinIrLength, HrirLength);
+        return nullptr;
+    }
+    if((varOffset&15) != 0 || varOffset >= data.size())
+    {
+        ERR("Invalid variant offset for %uhz: %u\n", rate, varOffset);
+        return nullptr;
+    }
+
+    stream.seekg(varOffset);
+    const uint fdCount{readle<uint32_t>(stream)};
+    const uint evTotal{readle<uint32_t>(stream)};
+    const uint irTotal{readle<uint32_t>(stream)};
+    std::ignore = readle<uint32_t>(stream);
+    if(!stream || stream.eof())
+    {
+        ERR("Failed reading %s\n", filename);
+        return nullptr;
+    }
+    if(fdCount < MinFdCount || fdCount > MaxFdCount)
+    {
+        ERR("Unsupported number of field-depths: fdCount=%d (%d to %d)\n", fdCount, MinFdCount,
+            MaxFdCount);
+        return nullptr;
+    }
+    if(evTotal > fdCount*MaxEvCount || irTotal > evTotal*MaxAzCount)
+    {
+        ERR("Invalid elevation or HRIR total: evTotal=%u, irTotal=%u\n", evTotal, irTotal);
+        return nullptr;
+    }
+
+    auto fields = std::vector<HrtfStore::Field>(fdCount);
+    size_t evCountTotal{0};
+    for(size_t f{0};f < fdCount;f++)
+    {
+        const float distance{al::bit_cast<float>(readle<uint32_t>(stream))};
+        const ubyte evCount{readle<uint8_t>(stream)};
+        stream.ignore(3);
+        if(!stream || stream.eof())
+        {
+            ERR("Failed reading %s\n", filename);
+            return nullptr;
+        }
+
+        if(!(distance >= MinFdDistance/1000.0f && distance <= MaxFdDistance/1000.0f))
+        {
+            ERR("Unsupported field distance[%zu]=%f (%f to %f meters)\n", f, distance,
+                MinFdDistance/1000.0f, MaxFdDistance/1000.0f);
+            return nullptr;
+        }
+        if(evCount < MinEvCount || evCount > MaxEvCount)
+        {
+            ERR("Unsupported elevation count: evCount[%zu]=%d (%d to %d)\n", f, evCount,
+                MinEvCount, MaxEvCount);
+            return nullptr;
+        }
+
+        fields[f].distance = distance;
+        fields[f].evCount = evCount;
+        if(f > 0 && fields[f].distance > fields[f-1].distance)
+        {
+            ERR("Field distance[%zu] is not before previous (%f <= %f)\n", f, fields[f].distance,
+                fields[f-1].distance);
+            return nullptr;
+        }
+        evCountTotal += evCount;
+    }
+    if(evCountTotal != evTotal)
+    {
+        ERR("Mismatched elevation total: %zu, expected %u\n", evCountTotal, evTotal);
+        return nullptr;
+    }
+
+    auto elevs = std::vector<HrtfStore::Elevation>(evTotal);
+    size_t irCountTotal{0};
+    for(size_t e{0};e < evTotal;++e)
+    {
+        elevs[e].azCount = readle<uint16_t>(stream);
+        elevs[e].irOffset = readle<uint16_t>(stream);
+        if(!stream || stream.eof())
+        {
+            ERR("Failed reading %s\n", filename);
+            return nullptr;
+        }
+        if(elevs[e].azCount < MinAzCount || elevs[e].azCount > MaxAzCount)
+        {
+            ERR("Unsupported azimuth count: azCount[%zu]=%d (%d to %d)\n", e, elevs[e].azCount,
+                MinAzCount, MaxAzCount);
+            return nullptr;
+        }
+        if(elevs[e].irOffset != irCountTotal)
+        {
+            ERR("Invalid HRIR offset: irOffset[%zu]=%d, expected %zu\n", e, elevs[e].irOffset,
+                irCountTotal);
+            return nullptr;
+        }
+        irCountTotal += elevs[e].azCount;
+    }
+    if(irCountTotal != irTotal)
+    {
+        ERR("Mismatched HRIR total: %zu, expected %u\n", irCountTotal, irTotal);
+        return nullptr;
+    }
+
+    /* The coefficients start on a 16-byte boundary, followed by the delays. */
+    const size_t coeffOffset{RoundUp(static_cast<size_t>(stream.tellg()), 16)};
+    const size_t delayOffset{coeffOffset + sizeof(HrirArray)*irTotal};
+    if(delayOffset + sizeof(ubyte2)*irTotal > data.size())
+    {
+        ERR("Failed reading %s\n", filename);
+        return nullptr;
+    }
+
+    const auto delays = reinterpret_cast<const ubyte2*>(data.data() + delayOffset);
+    for(size_t i{0};i < irTotal;++i)
+    {
+        for(size_t j{0};j < 2;++j)
+        {
+            if(delays[i][j] > MaxHrirDelay<<HrirDelayFracBits)
+            {
+                ERR("Invalid delays[%zu][%zu]: %f (%d)\n", i, j,
+                    delays[i][j] / float{HrirDelayFracOne}, MaxHrirDelay);
+                return nullptr;
+            }
+        }
+    }
+
+    /* The coefficients can be used in place if they're for the device rate,
+     * and are aligned and in the native byte order.
+     */
+    const char *coeffdata{data.data() + coeffOffset};
+    if(storage && rate == devrate && al::endian::native == al::endian::little
+        && (reinterpret_cast<uintptr_t>(coeffdata)&15) == 0)
+    {
+        TRACE("Using mapped %uhz HRIRs\n", rate);
+        return CreateHrtfStore(rate, static_cast<uint8_t>(irSize), {fields.data(), fields.size()},
+            {elevs.data(), elevs.size()}, reinterpret_cast<const HrirArray*>(coeffdata), delays,
+            filename, std::move(storage));
+    }
+
+    auto coeffs = std::vector<HrirArray>(irTotal);
+    stream.seekg(static_cast<std::streamoff>(coeffOffset));
+    for(auto &hrir : coeffs)
+    {
+        for(auto &val : hrir)
+        {
+            val[0] = al::bit_cast<float>(readle<uint32_t>(stream));
+            val[1] = al::bit_cast<float>(readle<uint32_t>(stream));
+        }
+    }
+    if(!stream)
+    {
+        ERR("Failed reading %s\n", filename);
+        return nullptr;
+    }
+
+    return CreateHrtfStore(rate, static_cast<uint8_t>(irSize), {fields.data(), fields.size()},
+        {elevs.data(), elevs.size()}, coeffs.data(), delays, filename);
+}
+
+/* Stores the HRTF as a MinPHR04 data set with a single variant, in the layout
+ * LoadHrtf04 can use directly.
+ */
+std::vector<char> StoreHrtf04(const HrtfStore &hrtf)
+{
+    const size_t evTotal{std::accumulate(hrtf.mFields.begin(), hrtf.mFields.end(), size_t{0},
+        [](const size_t curval, const HrtfStore::Field &field) noexcept -> size_t
+        { return curval + field.evCount; })};
+    const size_t irTotal{size_t{hrtf.mElev[evTotal-1].irOffset} + hrtf.mElev[evTotal-1].azCount};
+
+    std::vector<char> out;
+    out.reserve(64 + hrtf.mFields.size()*8 + evTotal*4
+        + irTotal*(sizeof(HrirArray)+sizeof(ubyte2)));
+    auto put_le = [&out](const uint32_t val, const uint bytes)
+    {
+        for(uint i{0};i < bytes;++i)
+            out.push_back(static_cast<char>((val>>(i*8)) & 0xff));
+    };
+
+    out.resize(sizeof(magicMarker04));
+    std::copy(std::begin(magicMarker04), std::end(magicMarker04), out.begin());
+    put_le(1, 4);
+    put_le(0, 4);
+
+    /* The one variant immediately follows its header, on a 16-byte boundary. */
+    put_le(hrtf.mSampleRate, 4);
+    put_le(hrtf.mIrSize, 4);
+    put_le(static_cast<uint32_t>(out.size() + 8), 4);
+    put_le(0, 4);
+
+    put_le(static_cast<uint32_t>(hrtf.mFields.size()), 4);
+    put_le(static_cast<uint32_t>(evTotal), 4);
+    put_le(static_cast<uint32_t>(irTotal), 4);
+    put_le(0, 4);
+    for(const auto &field : hrtf.mFields)
+    {
+        put_le(al::bit_cast<uint32_t>(field.distance), 4);
+        put_le(field.evCount, 1);
+        put_le(0, 3);
+    }
+    for(size_t e{0};e < evTotal;++e)
+    {
+        put_le(hrtf.mElev[e].azCount, 2);
+        put_le(hrtf.mElev[e].irOffset, 2);
+    }
+    out.resize(RoundUp(out.size(), 16), 0);
+
+    for(size_t i{0};i < irTotal;++i)
+    {
+        for(const auto &val : hrtf.mCoeffs[i])
+        {
+            put_le(al::bit_cast<uint32_t>(val[0]), 4);
+            put_le(al::bit_cast<uint32_t>(val[1]), 4);
+        }
+    }
+    for(size_t i{0};i < irTotal;++i)
+    {
+        put_le(hrtf.mDelays[i][0], 1);
+        put_le(hrtf.mDelays[i][1], 1);
+    }
+
+    return out;
+}
+
+
 bool checkName(const std::string &name)
 {
     auto match_name = [&name](const HrtfEntry &entry) -> bool { return name == entry.mDispName; };
@@ -1278,7 +1990,8 @@ std::vector<std::string> EnumerateHrtf(std::optional<std::string> pathopt)
     return list;
 }
 
-HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
+HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate, const uint gridres,
+    const bool usecache)
 {
     std::lock_guard<std::mutex> _{EnumeratedHrtfLock};
     auto entry_iter = std::find_if(EnumeratedHrtfs.cbegin(), EnumeratedHrtfs.cend(),
@@ -1294,7 +2007,7 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
     while(handle != LoadedHrtfs.end() && handle->mFilename == fname)
     {
         HrtfStore *hrtf{handle->mEntry.get()};
-        if(hrtf && hrtf->mSampleRate == devrate)
+        if(hrtf && hrtf->mSampleRate == devrate && hrtf->mGridRes == gridres)
         {
             hrtf->add_ref();
             return HrtfStorePtr{hrtf};
@@ -1302,6 +2015,11 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
         ++handle;
     }
 
+    /* Data sets are read from memory when possible, with the storage of a
+     * memory-mapped file.
+     */
+    std::shared_ptr<const void> storage;
+    al::span<const char> data;
     std::unique_ptr<std::istream> stream;
     int residx{};
     char ch{};
@@ -1314,47 +2032,112 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
             ERR("Could not get resource %u, %s\n", residx, name.c_str());
             return nullptr;
         }
-        stream = std::make_unique<idstream>(res.begin(), res.end());
+        /* Embedded data sets are packed, and only unpacked once they're used. */
+        if(IsPackedHrtf(res))
+        {
+            auto unpacked = std::make_shared<std::vector<char>>(UnpackHrtf(res));
+            if(unpacked->empty())
+            {
+                ERR("Could not unpack resource %u, %s\n", residx, name.c_str());
+                return nullptr;
+            }
+            res = *unpacked;
+            storage = std::move(unpacked);
+        }
+        data = res;
+        stream = std::make_unique<idstream>(data.begin(), data.end());
     }
     else
     {
         TRACE("Loading %s...\n", fname.c_str());
-        auto fstr = std::make_unique<al::ifstream>(fname.c_str(), std::ios::binary);
-        if(!fstr->is_open())
+        std::tie(storage, data) = MapFile(fname);
+        if(storage)
+            stream = std::make_unique<idstream>(data.begin(), data.end());
+        else
         {
-            ERR("Could not open %s\n", fname.c_str());
-            return nullptr;
+            auto fstr = std::make_unique<al::ifstream>(fname.c_str(), std::ios::binary);
+            if(!fstr->is_open())
+            {
+                ERR("Could not open %s\n", fname.c_str());
+                return nullptr;
+            }
+            stream = std::move(fstr);
         }
-        stream = std::move(fstr);
     }
 
+    /* With the cache enabled, first look for the data set already resampled
+     * for the device rate, identified by a hash of the source data.
+     */
     std::unique_ptr<HrtfStore> hrtf;
-    char magic[sizeof(magicMarker03)];
-    stream->read(magic, sizeof(magic));
-    if(stream->gcount() < static_cast<std::streamsize>(sizeof(magicMarker03)))
-        ERR("%s data is too short (%zu bytes)\n", name.c_str(), stream->gcount());
-    else if(memcmp(magic, magicMarker03, sizeof(magicMarker03)) == 0)
-    {
-        TRACE("Detected data set format v3\n");
-        hrtf = LoadHrtf03(*stream, name.c_str());
-    }
-    else if(memcmp(magic, magicMarker02, sizeof(magicMarker02)) == 0)
+    std::string cachename;
+    if(usecache && !data.empty())
     {
-        TRACE("Detected data set format v2\n");
-        hrtf = LoadHrtf02(*stream, name.c_str());
-    }
-    else if(memcmp(magic, magicMarker01, sizeof(magicMarker01)) == 0)
-    {
-        TRACE("Detected data set format v1\n");
-        hrtf = LoadHrtf01(*stream, name.c_str());
+        const std::string cachepath{GetUserCachePath("openal/hrtf")};
+        if(!cachepath.empty())
+        {
+            char key[48];
+            snprintf(key, sizeof(key), "%016" PRIx64 "_%u.mhr", HashData(data), devrate);
+            cachename = cachepath + '/' + key;
+
+            auto cachefile = MapFile(cachename);
+            if(cachefile.first && cachefile.second.size() >= sizeof(magicMarker04)
+                && memcmp(cachefile.second.data(), magicMarker04, sizeof(magicMarker04)) == 0)
+            {
+                hrtf = LoadHrtf04(cachefile.second, std::move(cachefile.first), devrate,
+                    cachename.c_str());
+                if(hrtf && hrtf->mSampleRate != devrate)
+                    hrtf = nullptr;
+                if(hrtf)
+                    TRACE("Using cached %s\n", cachename.c_str());
+            }
+        }
     }
-    else if(memcmp(magic, magicMarker00, sizeof(magicMarker00)) == 0)
+
+    if(!hrtf)
     {
-        TRACE("Detected data set format v0\n");
-        hrtf = LoadHrtf00(*stream, name.c_str());
+        char magic[sizeof(magicMarker03)];
+        stream->read(magic, sizeof(magic));
+        if(stream->gcount() < static_cast<std::streamsize>(sizeof(magicMarker03)))
+            ERR("%s data is too short (%zu bytes)\n", name.c_str(), stream->gcount());
+        else if(memcmp(magic, magicMarker04, sizeof(magicMarker04)) == 0)
+        {
+            TRACE("Detected data set format v4\n");
+            if(data.empty())
+            {
+                /* Without the data in memory, read the whole file. */
+                stream->seekg(0, std::ios::end);
+                auto buffer = std::vector<char>(static_cast<size_t>(std::max<std::streamoff>(
+                    stream->tellg(), 0)));
+                stream->seekg(0);
+                stream->read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                hrtf = LoadHrtf04(buffer, nullptr, devrate, name.c_str());
+            }
+            else
+                hrtf = LoadHrtf04(data, std::move(storage), devrate, name.c_str());
+        }
+        else if(memcmp(magic, magicMarker03, sizeof(magicMarker03)) == 0)
+        {
+            TRACE("Detected data set format v3\n");
+            hrtf = LoadHrtf03(*stream, name.c_str());
+        }
+        else if(memcmp(magic, magicMarker02, sizeof(magicMarker02)) == 0)
+        {
+            TRACE("Detected data set format v2\n");
+            hrtf = LoadHrtf02(*stream, name.c_str());
+        }
+        else if(memcmp(magic, magicMarker01, sizeof(magicMarker01)) == 0)
+        {
+            TRACE("Detected data set format v1\n");
+            hrtf = LoadHrtf01(*stream, name.c_str());
+        }
+        else if(memcmp(magic, magicMarker00, sizeof(magicMarker00)) == 0)
+        {
+            TRACE("Detected data set format v0\n");
+            hrtf = LoadHrtf00(*stream, name.c_str());
+        }
+        else
+            ERR("Invalid header in %s: \"%.8s\"\n", name.c_str(), magic);
     }
-    else
-        ERR("Invalid header in %s: \"%.8s\"\n", name.c_str(), magic);
     stream.reset();
 
     if(!hrtf)
@@ -1431,10 +2214,20 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
         const float newIrSize{std::round(static_cast<float>(hrtf->mIrSize) * rate_scale)};
         hrtf->mIrSize = static_cast<uint8_t>(minf(HrirLength, newIrSize));
         hrtf->mSampleRate = devrate & 0xff'ff'ff;
+
+        if(!cachename.empty())
+        {
+            if(StoreFile(cachename, StoreHrtf04(*hrtf)))
+                TRACE("Stored resampled HRTF in %s\n", cachename.c_str());
+            else
+                WARN("Failed to store resampled HRTF in %s\n", cachename.c_str());
+        }
     }
 
     TRACE("Loaded HRTF %s for sample rate %uhz, %u-sample filter\n", name.c_str(),
         hrtf->mSampleRate, hrtf->mIrSize);
+    if(gridres > 0)
+        hrtf->buildGrid(gridres);
     handle = LoadedHrtfs.emplace(handle, fname, std::move(hrtf));
 
     return HrtfStorePtr{handle->mEntry.get()};
@@ -2,12 +2,14 @@
 #define CORE_HRTF_H
 
 #include <array>
+#include <complex>
 #include <cstddef>
 #include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include "alcomplex.h"
 #include "almalloc.h"
 #include "alspan.h"
 #include "atomic.h"
@@ -15,6 +17,7 @@
 #include "bufferline.h"
 #include "mixer/hrtfdefs.h"
 #include "intrusive_ptr.h"
+#include "vector.h"
 
 
 struct HrtfStore {
@@ -36,10 +39,38 @@ struct HrtfStore {
         ushort azCount;
         ushort irOffset;
     };
-    Elevation *mElev;
+    const Elevation *mElev;
     const HrirArray *mCoeffs;
     const ubyte2 *mDelays;
 
+    /* Read-only storage the coefficients and delays point into, such as a
+     * memory-mapped data set, or null if they follow this struct.
+     */
+    std::shared_ptr<const void> mStorage;
+    /* The size of this struct's allocation, including the data following it. */
+    size_t mAllocSize{0};
+
+    /* An optional grid of precomputed HRIRs and delays for each field, with
+     * mGridEvCount elevations and mGridAzCount azimuths spaced no more than
+     * mGridRes degrees apart. When present, getCoeffs uses the nearest grid
+     * direction instead of blending the measured HRIRs.
+     */
+    uint mGridRes{0};
+    uint mGridEvCount{0};
+    uint mGridAzCount{0};
+    size_t mGridStride{0};
+    al::vector<float2,16> mGridCoeffs;
+    al::vector<float2> mGridDelays;
+
+    void buildGrid(const uint resolution);
+
+    /** The bytes allocated for the HRTF, not including mapped storage. */
+    size_t memoryUsage() const noexcept
+    {
+        return mAllocSize + mGridCoeffs.capacity()*sizeof(float2)
+            + mGridDelays.capacity()*sizeof(float2);
+    }
+
     void getCoeffs(float elevation, float azimuth, float distance, float spread, HrirArray &coeffs,
         const al::span<uint,2> delays);
 
@@ -62,11 +93,43 @@ struct AngularPoint {
 struct DirectHrtfState {
     std::array<float,BufferLineSize> mTemp;
 
-    /* HRTF filter state for dry buffer content */
+    /* HRTF filter state for dry buffer content. With a long enough response,
+     * only the first mIrSize coefficients are applied directly, and the rest
+     * are applied as mTailSegs segments of mTailSegSamples each, using
+     * uniformly partitioned FFT convolution. No latency is added since each
+     * segment only needs input from before the current one.
+     */
     uint mIrSize{0};
+    uint mTailSegs{0};
+    uint mTailSegSamples{0};
+
+    /* The number of floats for the real or imaginary values of each FFT'd
+     * segment's mTailSegSamples+1 bins, padded for alignment.
+     */
+    size_t mTailBinStride{0};
+    FftPlan<float> mTailFft;
+    size_t mTailFifoPos{0};
+    size_t mTailCurrentSeg{0};
+
+    /* The scaled input of each channel for the current mix (BufferLineSize
+     * per channel), each channel's input for the next segment, the FFT'd input
+     * history (mTailSegs per channel), the FFT'd filter segments for each ear
+     * and channel, and the output for each ear (mTailSegSamples, plus
+     * mTailSegSamples for the overlap). Each FFT'd segment holds the real
+     * values followed by the imaginary values.
+     */
+    al::vector<float,16> mTailInput;
+    al::vector<float,16> mTailSegment;
+    al::vector<float,16> mTailHistory;
+    al::vector<float,16> mTailFilter;
+    al::vector<float,16> mTailOutput;
+    al::vector<std::complex<float>,16> mTailFftBuffer;
+    al::vector<float,16> mTailAccum;
+
     al::FlexArray<HrtfChannelState> mChannels;
 
     DirectHrtfState(size_t numchans) : mChannels{numchans} { }
+    ~DirectHrtfState();
     /**
      * Produces HRTF filter coefficients for decoding B-Format, given a set of
      * virtual speaker positions, a matching decoding matrix, and per-order
@@ -77,6 +140,18 @@ struct DirectHrtfState {
         const al::span<const AngularPoint> AmbiPoints, const float (*AmbiMatrix)[MaxAmbiChannels],
         const float XOverFreq, const al::span<const float,MaxAmbiOrder+1> AmbiOrderHFGain);
 
+    /**
+     * Adds the FFT'd tail of the response to the output, for the input that
+     * was kept in mTailInput by the direct HRTF mixer.
+     */
+    void processTail(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
+        const size_t samplesToDo);
+    /* Processes a full input segment for the tail. */
+    void processTailSegment();
+
+    /** The bytes allocated for the state and its tail convolution. */
+    size_t memoryUsage() const noexcept;
+
     static std::unique_ptr<DirectHrtfState> Create(size_t num_chans);
 
     DEF_FAM_NEWDEL(DirectHrtfState, mChannels)
@@ -84,6 +159,13 @@ struct DirectHrtfState {
 
 
 std::vector<std::string> EnumerateHrtf(std::optional<std::string> pathopt);
-HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate);
+/**
+ * Loads the named HRTF for the given sample rate. A non-0 gridres builds a grid
+ * of precomputed HRIRs with that resolution, in degrees. With usecache, an HRTF
+ * that needs resampling is stored in the user's cache directory, and loaded
+ * from there the next time it's needed for the same rate.
+ */
+HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate, const uint gridres,
+    const bool usecache);
 
 #endif /* CORE_HRTF_H */
@@ -0,0 +1,293 @@
+
+#include "config.h"
+
+#include "hrtf_pack.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+using uint = unsigned int;
+
+
+namespace {
+
+constexpr char magicMarker03[8]{'M','i','n','P','H','R','0','3'};
+constexpr char packedMarker03[8]{'M','i','n','P','H','R','z','3'};
+
+/* The packed header is the magic marker followed by the sizes of the data set
+ * header, the coefficient count, the number of coefficients per HRIR, and the
+ * size of the data following the coefficients. The data set header and
+ * trailing data come next, then the coded coefficients.
+ */
+constexpr size_t PackedHeaderSize{sizeof(packedMarker03) + 4*sizeof(uint32_t)};
+
+/* The number of coefficient differences coded with the same Rice parameter. */
+constexpr size_t BlockSize{16};
+/* 24-bit differences need up to 25 bits, or 26 bits with the sign folded. */
+constexpr uint MaxRiceParam{26};
+constexpr uint RiceParamBits{5};
+/* The largest unary-coded part of a value, limiting the bits for outliers. */
+constexpr uint32_t MaxQuotient{64};
+
+
+uint32_t LoadLE32(const char *src) noexcept
+{
+    return uint32_t{static_cast<uint8_t>(src[0])} | (uint32_t{static_cast<uint8_t>(src[1])}<<8)
+        | (uint32_t{static_cast<uint8_t>(src[2])}<<16)
+        | (uint32_t{static_cast<uint8_t>(src[3])}<<24);
+}
+
+void StoreLE32(std::vector<char> &dst, const uint32_t value)
+{
+    dst.push_back(static_cast<char>(value));
+    dst.push_back(static_cast<char>(value>>8));
+    dst.push_back(static_cast<char>(value>>16));
+    dst.push_back(static_cast<char>(value>>24));
+}
+
+int32_t LoadSample24(const char *src) noexcept
+{
+    const uint32_t value{uint32_t{static_cast<uint8_t>(src[0])}
+        | (uint32_t{static_cast<uint8_t>(src[1])}<<8)
+        | (uint32_t{static_cast<uint8_t>(src[2])}<<16)};
+    /* Sign-extend the 24-bit value. */
+    return static_cast<int32_t>(value^0x800000u) - 0x800000;
+}
+
+inline uint32_t FoldSign(const int32_t value) noexcept
+{ return (static_cast<uint32_t>(value)<<1) ^ static_cast<uint32_t>(value>>31); }
+
+inline int32_t UnfoldSign(const uint32_t value) noexcept
+{ return static_cast<int32_t>(value>>1) ^ -static_cast<int32_t>(value&1); }
+
+
+class BitWriter {
+    std::vector<char> &mOutput;
+    uint64_t mBits{0};
+    uint mCount{0};
+
+public:
+    BitWriter(std::vector<char> &output) : mOutput{output} { }
+
+    void put(const uint32_t value, const uint count)
+    {
+        mBits |= uint64_t{value} << mCount;
+        mCount += count;
+        while(mCount >= 8)
+        {
+            mOutput.push_back(static_cast<char>(mBits));
+            mBits >>= 8;
+            mCount -= 8;
+        }
+    }
+
+    /* Writes a run of set bits ended with a clear bit. */
+    void putUnary(uint32_t value)
+    {
+        for(;value >= 16;value -= 16)
+            put(0xffff, 16);
+        put((1u<<value) - 1, value+1);
+    }
+
+    void flush()
+    {
+        if(mCount > 0)
+            mOutput.push_back(static_cast<char>(mBits));
+        mBits = 0;
+        mCount = 0;
+    }
+};
+
+class BitReader {
+    al::span<const char> mInput;
+    size_t mPos{0};
+    uint64_t mBits{0};
+    uint mCount{0};
+    bool mOverrun{false};
+
+public:
+    BitReader(al::span<const char> input) : mInput{input} { }
+
+    uint32_t get(const uint count)
+    {
+        while(mCount < count)
+        {
+            if(mPos == mInput.size())
+            {
+                mOverrun = true;
+                return 0;
+            }
+            mBits |= uint64_t{static_cast<uint8_t>(mInput[mPos++])} << mCount;
+            mCount += 8;
+        }
+        const auto value = static_cast<uint32_t>(mBits & ((uint64_t{1}<<count) - 1));
+        mBits >>= count;
+        mCount -= count;
+        return value;
+    }
+
+    uint32_t getUnary()
+    {
+        uint32_t value{0};
+        while(get(1) && !mOverrun)
+        {
+            if(++value > MaxQuotient)
+            {
+                mOverrun = true;
+                break;
+            }
+        }
+        return value;
+    }
+
+    bool overrun() const noexcept { return mOverrun; }
+};
+
+} // namespace
+
+
+bool IsPackedHrtf(const al::span<const char> data) noexcept
+{
+    return data.size() >= PackedHeaderSize
+        && memcmp(data.data(), packedMarker03, sizeof(packedMarker03)) == 0;
+}
+
+std::vector<char> PackHrtf(const al::span<const char> data)
+{
+    if(data.size() < sizeof(magicMarker03)+7
+        || memcmp(data.data(), magicMarker03, sizeof(magicMarker03)) != 0)
+        return {};
+
+    /* Skip the sample rate, and get the channel type, HRIR size, and field
+     * count.
+     */
+    size_t pos{sizeof(magicMarker03) + 4};
+    const auto channelType = static_cast<uint8_t>(data[pos++]);
+    const auto irSize = static_cast<uint8_t>(data[pos++]);
+    const auto fdCount = static_cast<uint8_t>(data[pos++]);
+    if(channelType > 1)
+        return {};
+
+    /* Count the HRIRs from the fields' elevations, skipping the distances. */
+    size_t irTotal{0};
+    for(size_t f{0};f < fdCount;++f)
+    {
+        if(data.size()-pos < 3)
+            return {};
+        const auto evCount = static_cast<uint8_t>(data[pos+2]);
+        pos += 3;
+        if(data.size()-pos < evCount)
+            return {};
+        for(size_t e{0};e < evCount;++e)
+            irTotal += static_cast<uint8_t>(data[pos++]);
+    }
+
+    const size_t stride{irSize * (channelType+1u)};
+    const size_t count{irTotal * stride};
+    if((data.size()-pos)/3 < count)
+        return {};
+    const size_t trailerSize{data.size() - pos - count*3};
+
+    std::vector<char> output;
+    output.reserve(data.size());
+    output.insert(output.end(), std::begin(packedMarker03), std::end(packedMarker03));
+    StoreLE32(output, static_cast<uint32_t>(pos));
+    StoreLE32(output, static_cast<uint32_t>(count));
+    StoreLE32(output, static_cast<uint32_t>(stride));
+    StoreLE32(output, static_cast<uint32_t>(trailerSize));
+    output.insert(output.end(), data.begin(), data.begin()+static_cast<ptrdiff_t>(pos));
+    output.insert(output.end(), data.end()-static_cast<ptrdiff_t>(trailerSize), data.end());
+
+    /* Each coefficient is predicted from the same one in the previous HRIR,
+     * which is generally the previous azimuth of the same elevation.
+     */
+    const char *coeffs{data.data() + pos};
+    auto residuals = std::vector<uint32_t>(count);
+    for(size_t i{0};i < count;++i)
+    {
+        const int32_t pred{(i >= stride) ? LoadSample24(coeffs + (i-stride)*3) : 0};
+        residuals[i] = FoldSign(LoadSample24(coeffs + i*3) - pred);
+    }
+
+    BitWriter writer{output};
+    for(size_t base{0};base < count;base += BlockSize)
+    {
+        const auto block = al::span{residuals}.subspan(base, std::min(BlockSize, count-base));
+
+        /* Find the Rice parameter that codes the block in the fewest bits. */
+        uint bestParam{0};
+        uint64_t bestBits{std::numeric_limits<uint64_t>::max()};
+        for(uint k{0};k < MaxRiceParam;++k)
+        {
+            uint64_t bits{0};
+            bool fits{true};
+            for(const uint32_t value : block)
+            {
+                fits = fits && (value>>k) <= MaxQuotient;
+                bits += (value>>k) + 1 + k;
+            }
+            if(fits && bits < bestBits)
+            {
+                bestBits = bits;
+                bestParam = k;
+            }
+        }
+
+        writer.put(bestParam, RiceParamBits);
+        for(const uint32_t value : block)
+        {
+            writer.putUnary(value >> bestParam);
+            writer.put(value & ((1u<<bestParam) - 1), bestParam);
+        }
+    }
+    writer.flush();
+
+    return output;
+}
+
+std::vector<char> UnpackHrtf(const al::span<const char> data)
+{
+    if(!IsPackedHrtf(data))
+        return {};
+
+    const size_t headerSize{LoadLE32(data.data() + sizeof(packedMarker03))};
+    const size_t count{LoadLE32(data.data() + sizeof(packedMarker03) + 4)};
+    const size_t stride{LoadLE32(data.data() + sizeof(packedMarker03) + 8)};
+    const size_t trailerSize{LoadLE32(data.data() + sizeof(packedMarker03) + 12)};
+    if(data.size()-PackedHeaderSize < headerSize
+        || data.size()-PackedHeaderSize-headerSize < trailerSize)
+        return {};
+
+    const char *header{data.data() + PackedHeaderSize};
+    const char *trailer{header + headerSize};
+    BitReader reader{data.subspan(PackedHeaderSize + headerSize + trailerSize)};
+
+    std::vector<char> output;
+    output.reserve(headerSize + count*3 + trailerSize);
+    output.insert(output.end(), header, header+headerSize);
+
+    uint param{0};
+    for(size_t i{0};i < count;++i)
+    {
+        if((i%BlockSize) == 0)
+        {
+            param = reader.get(RiceParamBits);
+            if(param >= MaxRiceParam)
+                return {};
+        }
+        const uint32_t residual{(reader.getUnary() << param) | reader.get(param)};
+        if(reader.overrun())
+            return {};
+
+        const int32_t pred{(i >= stride) ? LoadSample24(&output[headerSize + (i-stride)*3]) : 0};
+        const auto value = static_cast<uint32_t>(pred + UnfoldSign(residual));
+        output.push_back(static_cast<char>(value));
+        output.push_back(static_cast<char>(value>>8));
+        output.push_back(static_cast<char>(value>>16));
+    }
+
+    output.insert(output.end(), trailer, trailer+trailerSize);
+    return output;
+}
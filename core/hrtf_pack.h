@@ -0,0 +1,27 @@
+#ifndef CORE_HRTF_PACK_H
+#define CORE_HRTF_PACK_H
+
+#include <vector>
+
+#include "alspan.h"
+
+
+/* Packed HRTF data sets, for embedding a data set in less space. The 24-bit
+ * coefficients of a MinPHR03 data set are stored as the difference from the
+ * same coefficient of the previous HRIR, with each block of differences Rice
+ * coded. The rest of the data set is stored as-is, and unpacking gives back
+ * the original data.
+ */
+
+/* Checks if the data is a packed data set. */
+bool IsPackedHrtf(const al::span<const char> data) noexcept;
+
+/* Packs a MinPHR03 data set, returning an empty vector if the data isn't a
+ * supported data set.
+ */
+std::vector<char> PackHrtf(const al::span<const char> data);
+
+/* Unpacks a packed data set, returning an empty vector if it's invalid. */
+std::vector<char> UnpackHrtf(const al::span<const char> data);
+
+#endif /* CORE_HRTF_PACK_H */
@@ -0,0 +1,72 @@
+#include "config.h"
+
+#include "kernels.h"
+
+#include "cpu_caps.h"
+#include "fmt_traits.h"
+#include "logging.h"
+#include "outputconv.h"
+
+
+DspKernels gKernels{
+    WriteSamples<CTag>,
+    ApplyDither<CTag>,
+    al::LoadHalfArray_<CTag>,
+};
+
+namespace {
+
+/* Each list ends with a variant that needs no CPU capabilities. */
+constexpr KernelVariant<DspKernels::WriteSamplesFunc> WriteSamplesVariants[]{
+#ifdef HAVE_AVX2
+    {"AVX2", CPU_CAP_AVX2, WriteSamples<AVX2Tag>},
+#endif
+#ifdef HAVE_SSE_INTRINSICS
+    {"SSE2", CPU_CAP_SSE2, WriteSamples<SSE2Tag>},
+#endif
+    {"C", 0, WriteSamples<CTag>},
+};
+
+constexpr KernelVariant<DspKernels::ApplyDitherFunc> ApplyDitherVariants[]{
+#ifdef HAVE_AVX2
+    {"AVX2", CPU_CAP_AVX2, ApplyDither<AVX2Tag>},
+#endif
+#ifdef HAVE_SSE_INTRINSICS
+    {"SSE2", CPU_CAP_SSE2, ApplyDither<SSE2Tag>},
+#endif
+    {"C", 0, ApplyDither<CTag>},
+};
+
+constexpr KernelVariant<DspKernels::LoadHalfArrayFunc> LoadHalfArrayVariants[]{
+#ifdef HAVE_NEON
+    {"NEON", CPU_CAP_NEON, al::LoadHalfArray_<NEONTag>},
+#endif
+#ifdef HAVE_AVX2
+    {"F16C", CPU_CAP_F16C, al::LoadHalfArray_<F16CTag>},
+#endif
+    {"C", 0, al::LoadHalfArray_<CTag>},
+};
+
+template<typename T, size_t N>
+T SelectKernel(const char *name, const KernelVariant<T> (&variants)[N])
+{
+    for(const KernelVariant<T> &variant : variants)
+    {
+        if((CPUCapFlags&variant.mCaps) == variant.mCaps)
+        {
+            TRACE("Using %s %s\n", variant.mName, name);
+            return variant.mFunc;
+        }
+    }
+    /* Unreachable, as the last variant needs nothing. */
+    return variants[N-1].mFunc;
+}
+
+} // namespace
+
+void BindKernels()
+{
+    gKernels.mWriteSamples = SelectKernel("output writer", WriteSamplesVariants);
+    gKernels.mApplyDither = SelectKernel("dither", ApplyDitherVariants);
+    gKernels.mLoadHalfArray = SelectKernel("half-float loader", LoadHalfArrayVariants);
+}
@@ -0,0 +1,50 @@
+#ifndef CORE_KERNELS_H
+#define CORE_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "alspan.h"
+#include "bufferline.h"
+#include "devformat.h"
+#include "opthelpers.h"
+
+using uint = unsigned int;
+
+
+/* A version of a kernel built for a particular instruction set, usable when
+ * the CPU has all of the given CPU_CAP_* flags.
+ */
+template<typename T>
+struct KernelVariant {
+    const char *mName;
+    int mCaps;
+    T mFunc;
+};
+
+/* The hot DSP loops outside of the mixer that have versions for different
+ * instruction sets. The table starts with the C versions, and BindKernels
+ * picks the best ones for the CPU once its capabilities are known.
+ */
+struct DspKernels {
+    using WriteSamplesFunc = void(*)(const DevFmtType type,
+        const al::span<const FloatBufferLine> InBuffer, void *OutBuffer, const size_t Offset,
+        const size_t SamplesToDo, const size_t FrameStep);
+    using ApplyDitherFunc = void(*)(const al::span<FloatBufferLine> Samples, uint *dither_seed,
+        const float quant_scale, const size_t SamplesToDo);
+    using LoadHalfArrayFunc = void(*)(float *RESTRICT dst, const uint16_t *src,
+        const size_t srcstep, const size_t samples) noexcept;
+
+    WriteSamplesFunc mWriteSamples;
+    ApplyDitherFunc mApplyDither;
+    LoadHalfArrayFunc mLoadHalfArray;
+};
+extern DspKernels gKernels;
+
+/* Binds each kernel in gKernels to the first of its variants (ordered from
+ * most to least preferred) that CPUCapFlags allows. This must be called after
+ * CPUCapFlags is set and before any mixing, as the table isn't synchronized.
+ */
+void BindKernels();
+
+#endif /* CORE_KERNELS_H */
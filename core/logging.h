@@ -16,6 +16,15 @@ extern LogLevel gLogLevel;
 
 extern FILE *gLogFile;
 
+/* The most verbose log level that's built in (set with the
+ * ALSOFT_MAX_LOG_LEVEL CMake option). Messages above it are removed at compile
+ * time, while the rest are checked against gLogLevel at run time.
+ */
+#ifndef ALSOFT_MAX_LOG_LEVEL
+#define ALSOFT_MAX_LOG_LEVEL 3
+#endif
+constexpr LogLevel MaxLogLevel{static_cast<LogLevel>(ALSOFT_MAX_LOG_LEVEL)};
+
 #ifdef __USE_MINGW_ANSI_STDIO
 [[gnu::format(gnu_printf,3,4)]]
 #else
@@ -23,29 +32,47 @@ extern FILE *gLogFile;
 #endif
 void al_print(LogLevel level, FILE *logfile, const char *fmt, ...);
 
+/* Whether messages of the given level will be printed by the macros below,
+ * for callers that want to avoid building a message nothing will see.
+ */
 #if (!defined(_WIN32) || defined(NDEBUG)) && !defined(__ANDROID__)
+inline bool IsLogLevelEnabled(LogLevel level) noexcept
+{ return MaxLogLevel >= level && gLogLevel >= level; }
+
 #define TRACE(...) do {                                                       \
-    if(gLogLevel >= LogLevel::Trace) UNLIKELY                                 \
+    if(MaxLogLevel >= LogLevel::Trace && gLogLevel >= LogLevel::Trace) UNLIKELY \
         al_print(LogLevel::Trace, gLogFile, __VA_ARGS__);                     \
 } while(0)
 
 #define WARN(...) do {                                                        \
-    if(gLogLevel >= LogLevel::Warning) UNLIKELY                               \
+    if(MaxLogLevel >= LogLevel::Warning && gLogLevel >= LogLevel::Warning) UNLIKELY \
         al_print(LogLevel::Warning, gLogFile, __VA_ARGS__);                   \
 } while(0)
 
 #define ERR(...) do {                                                         \
-    if(gLogLevel >= LogLevel::Error) UNLIKELY                                 \
+    if(MaxLogLevel >= LogLevel::Error && gLogLevel >= LogLevel::Error) UNLIKELY \
         al_print(LogLevel::Error, gLogFile, __VA_ARGS__);                     \
 } while(0)
 
 #else
 
-#define TRACE(...) al_print(LogLevel::Trace, gLogFile, __VA_ARGS__)
+inline bool IsLogLevelEnabled(LogLevel level) noexcept
+{ return MaxLogLevel >= level; }
 
-#define WARN(...) al_print(LogLevel::Warning, gLogFile, __VA_ARGS__)
+#define TRACE(...) do {                                                       \
+    if(MaxLogLevel >= LogLevel::Trace)                                        \
+        al_print(LogLevel::Trace, gLogFile, __VA_ARGS__);                     \
+} while(0)
 
-#define ERR(...) al_print(LogLevel::Error, gLogFile, __VA_ARGS__)
+#define WARN(...) do {                                                        \
+    if(MaxLogLevel >= LogLevel::Warning)                                      \
+        al_print(LogLevel::Warning, gLogFile, __VA_ARGS__);                   \
+} while(0)
+
+#define ERR(...) do {                                                         \
+    if(MaxLogLevel >= LogLevel::Error)                                        \
+        al_print(LogLevel::Error, gLogFile, __VA_ARGS__);                     \
+} while(0)
 #endif
 
 #endif /* CORE_LOGGING_H */
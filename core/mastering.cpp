@@ -6,98 +6,178 @@
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
-#include <functional>
 #include <iterator>
 #include <limits>
 #include <new>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <emmintrin.h>
+#endif
+
 #include "almalloc.h"
 #include "alnumeric.h"
 #include "alspan.h"
 #include "opthelpers.h"
 
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <emmintrin.h>
+#endif
+
+
 /* These structures assume BufferLineSize is a power of 2. */
 static_assert((BufferLineSize & (BufferLineSize-1)) == 0, "BufferLineSize is not a power of 2");
 
 struct SlidingHold {
-    alignas(16) float mValues[BufferLineSize];
-    uint mExpiries[BufferLineSize];
-    uint mLowerIndex;
-    uint mUpperIndex;
+    /* The last mLength-1 input values, followed by the new input. */
+    alignas(16) float mValues[BufferLineSize*2];
+    alignas(16) float mPrefixMax[BufferLineSize*2];
+    alignas(16) float mSuffixMax[BufferLineSize*2];
     uint mLength;
 };
 
 
 namespace {
 
-using namespace std::placeholders;
-
-/* This sliding hold follows the input level with an instant attack and a
- * fixed duration hold before an instant release to the next highest level.
- * It is a sliding window maximum (descending maxima) implementation based on
- * Richard Harter's ascending minima algorithm available at:
- *
- *   http://www.richardhartersworld.com/cri/2001/slidingmin.html
+#ifdef HAVE_SSE_INTRINSICS
+/* Vectorized natural logarithm and exponent, using the range reductions and
+ * polynomial approximations from the Cephes math library. They're accurate to
+ * within a couple ULPs, which is more than enough for control signals, but
+ * won't exactly match the standard library. The logarithm input must be a
+ * positive normal value.
  */
-float UpdateSlidingHold(SlidingHold *Hold, const uint i, const float in)
+inline __m128 log_ps(__m128 x) noexcept
 {
-    static constexpr uint mask{BufferLineSize - 1};
-    const uint length{Hold->mLength};
-    float (&values)[BufferLineSize] = Hold->mValues;
-    uint (&expiries)[BufferLineSize] = Hold->mExpiries;
-    uint lowerIndex{Hold->mLowerIndex};
-    uint upperIndex{Hold->mUpperIndex};
+    const __m128 one{_mm_set1_ps(1.0f)};
+    const __m128i ix{_mm_castps_si128(x)};
 
-    if(i >= expiries[upperIndex])
-        upperIndex = (upperIndex + 1) & mask;
-
-    if(in >= values[upperIndex])
-    {
-        values[upperIndex] = in;
-        expiries[upperIndex] = i + length;
-        lowerIndex = upperIndex;
-    }
-    else
-    {
-        do {
-            do {
-                if(!(in >= values[lowerIndex]))
-                    goto found_place;
-            } while(lowerIndex--);
-            lowerIndex = mask;
-        } while(true);
-    found_place:
-
-        lowerIndex = (lowerIndex + 1) & mask;
-        values[lowerIndex] = in;
-        expiries[lowerIndex] = i + length;
-    }
+    /* Separate the exponent and a mantissa in [0.5,1), then shift the
+     * mantissa to [sqrt(0.5),sqrt(2)) to keep the polynomial centered on 1.
+     */
+    __m128 e{_mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(ix, 23), _mm_set1_epi32(126)))};
+    __m128 m{_mm_or_ps(_mm_castsi128_ps(_mm_and_si128(ix, _mm_set1_epi32(0x007fffff))),
+        _mm_set1_ps(0.5f))};
+    const __m128 under{_mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f))};
+    e = _mm_sub_ps(e, _mm_and_ps(under, one));
+    m = _mm_add_ps(_mm_sub_ps(m, one), _mm_and_ps(under, m));
+
+    const __m128 z{_mm_mul_ps(m, m)};
+    __m128 y{_mm_set1_ps(7.0376836292e-2f)};
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.1514610310e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.1676998740e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.2420140846e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.4249322787e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.6668057665e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(2.0000714765e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-2.4999993993e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(3.3333331174e-1f));
+    y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+
+    y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+    y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+}
 
-    Hold->mLowerIndex = lowerIndex;
-    Hold->mUpperIndex = upperIndex;
+/* The input is clamped to keep the result normal, so very large negative
+ * values give a tiny non-0 result.
+ */
+inline __m128 exp_ps(__m128 x) noexcept
+{
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.0f)), _mm_set1_ps(88.0f));
+
+    /* Split into x = n*ln(2) + r, with |r| <= ln(2)/2. */
+    const __m128i n{_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)))};
+    const __m128 fn{_mm_cvtepi32_ps(n)};
+    __m128 r{_mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)))};
+    r = _mm_sub_ps(r, _mm_mul_ps(fn, _mm_set1_ps(-2.12194440e-4f)));
+
+    __m128 y{_mm_set1_ps(1.9875691500e-4f)};
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(1.3981999507e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(8.3334519073e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(4.1665795894e-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(1.6666665459e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(5.0000001201e-1f));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, r), r), r), _mm_set1_ps(1.0f));
+
+    /* Scale by 2^n. */
+    const __m128i pow2n{_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23)};
+    return _mm_mul_ps(y, _mm_castsi128_ps(pow2n));
+}
+#endif
 
-    return values[upperIndex];
+/* Applies a gain to the given samples. The samples may be unaligned. */
+void ApplyGain(float *RESTRICT samples, const float *RESTRICT gains, const uint SamplesToDo)
+{
+    size_t i{0};
+#ifdef HAVE_SSE_INTRINSICS
+    for(;i+4 <= SamplesToDo;i += 4)
+        _mm_storeu_ps(&samples[i], _mm_mul_ps(_mm_loadu_ps(&samples[i]), _mm_load_ps(&gains[i])));
+#endif
+    for(;i < SamplesToDo;++i)
+        samples[i] *= gains[i];
 }
 
-void ShiftSlidingHold(SlidingHold *Hold, const uint n)
+/* This sliding hold follows the input level with an instant attack and a
+ * fixed duration hold before an instant release to the next highest level.
+ * It is a sliding window maximum implementation based on the van Herk/Gil-
+ * Werman algorithm, which splits the input into blocks of the window length
+ * and combines a running maximum from the start of a block with a running
+ * maximum to the end of the previous one. This takes a constant three
+ * comparisons per sample, regardless of the hold length or input.
+ */
+void UpdateSlidingHold(SlidingHold *Hold, float *RESTRICT output, const uint SamplesToDo)
 {
-    auto exp_begin = std::begin(Hold->mExpiries) + Hold->mUpperIndex;
-    auto exp_last = std::begin(Hold->mExpiries) + Hold->mLowerIndex;
-    if(exp_last-exp_begin < 0)
+    const size_t length{Hold->mLength};
+    const size_t total{length-1 + SamplesToDo};
+    const float *RESTRICT values{Hold->mValues};
+    float *RESTRICT prefix{Hold->mPrefixMax};
+    float *RESTRICT suffix{Hold->mSuffixMax};
+
+    for(size_t base{0};base < total;base += length)
     {
-        std::transform(exp_begin, std::end(Hold->mExpiries), exp_begin,
-            [n](uint e){ return e - n; });
-        exp_begin = std::begin(Hold->mExpiries);
+        const size_t block_end{std::min(base+length, total)};
+
+        float cur{values[base]};
+        prefix[base] = cur;
+        for(size_t i{base+1};i < block_end;++i)
+        {
+            cur = maxf(cur, values[i]);
+            prefix[i] = cur;
+        }
+
+        cur = values[block_end-1];
+        suffix[block_end-1] = cur;
+        for(size_t i{block_end-1};i > base;)
+        {
+            --i;
+            cur = maxf(cur, values[i]);
+            suffix[i] = cur;
+        }
     }
-    std::transform(exp_begin, exp_last+1, exp_begin, [n](uint e){ return e - n; });
+
+    /* The output for each sample is the maximum over the window ending on
+     * it, which spans the end of one block and the start of the next.
+     */
+    size_t i{0};
+    const float *RESTRICT prefix_end{prefix + length-1};
+#ifdef HAVE_SSE_INTRINSICS
+    for(;i+4 <= SamplesToDo;i += 4)
+        _mm_storeu_ps(&output[i], _mm_max_ps(_mm_load_ps(&suffix[i]),
+            _mm_loadu_ps(&prefix_end[i])));
+#endif
+    for(;i < SamplesToDo;++i)
+        output[i] = maxf(suffix[i], prefix_end[i]);
+
+    /* Keep the last length-1 values for the next update. */
+    std::copy_n(values+SamplesToDo, length-1, Hold->mValues);
 }
 
 
 /* Multichannel compression is linked via the absolute maximum of all
  * channels.
  */
-void LinkChannels(Compressor *Comp, const uint SamplesToDo, const FloatBufferLine *OutBuffer)
+void LinkChannels(Compressor *Comp, const uint SamplesToDo, const FloatBufferLine *OutBuffer,
+    const uint Offset)
 {
     const size_t numChans{Comp->mNumChans};
 
@@ -107,11 +187,24 @@ void LinkChannels(Compressor *Comp, const uint SamplesToDo, const FloatBufferLin
     auto side_begin = std::begin(Comp->mSideChain) + Comp->mLookAhead;
     std::fill(side_begin, side_begin+SamplesToDo, 0.0f);
 
-    auto fill_max = [SamplesToDo,side_begin](const FloatBufferLine &input) -> void
+    auto fill_max = [SamplesToDo,Offset,side_begin](const FloatBufferLine &input) -> void
     {
-        const float *RESTRICT buffer{al::assume_aligned<16>(input.data())};
-        auto max_abs = std::bind(maxf, _1, std::bind(static_cast<float(&)(float)>(std::fabs), _2));
-        std::transform(side_begin, side_begin+SamplesToDo, buffer, side_begin, max_abs);
+        const float *RESTRICT buffer{input.data() + Offset};
+        float *RESTRICT side{side_begin};
+        size_t i{0};
+#ifdef HAVE_SSE_INTRINSICS
+        /* The side-chain is offset by the look-ahead, and the input by the
+         * given offset, so neither is necessarily aligned.
+         */
+        const __m128 absmask{_mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))};
+        for(;i+4 <= SamplesToDo;i += 4)
+        {
+            const __m128 s{_mm_and_ps(_mm_loadu_ps(&buffer[i]), absmask)};
+            _mm_storeu_ps(&side[i], _mm_max_ps(_mm_loadu_ps(&side[i]), s));
+        }
+#endif
+        for(;i < SamplesToDo;++i)
+            side[i] = maxf(side[i], std::fabs(buffer[i]));
     };
     std::for_each(OutBuffer, OutBuffer+numChans, fill_max);
 }
@@ -144,6 +237,81 @@ void CrestDetector(Compressor *Comp, const uint SamplesToDo)
     Comp->mLastRmsSq = y2_rms;
 }
 
+/* Calculates the attack and release coefficients for the gain smoothing.
+ * When automated, these depend only on the crest factor, so they're done
+ * ahead of the gain computer to keep the transcendental math out of its
+ * serial dependency chain.
+ */
+void BallisticsCoeffs(Compressor *Comp, const uint SamplesToDo)
+{
+    const bool autoAttack{Comp->mAuto.Attack};
+    const bool autoRelease{Comp->mAuto.Release};
+    const float attack{Comp->mAttack};
+    const float release{Comp->mRelease};
+    const float *RESTRICT crestFactor{Comp->mCrestFactor};
+    float *RESTRICT attackCoeffs{Comp->mAttackCoeffs};
+    float *RESTRICT releaseCoeffs{Comp->mReleaseCoeffs};
+
+    ASSUME(SamplesToDo > 0);
+
+    if(!autoAttack)
+        std::fill_n(attackCoeffs, SamplesToDo, std::exp(-1.0f / attack));
+    if(!autoRelease)
+        std::fill_n(releaseCoeffs, SamplesToDo, std::exp(-1.0f / (release - attack)));
+    if(!autoAttack && !autoRelease)
+        return;
+
+    size_t i{0};
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 att4{_mm_set1_ps(-0.5f / attack)};
+    const __m128 rel4{_mm_set1_ps(2.0f * release)};
+    for(;i+4 <= SamplesToDo;i += 4)
+    {
+        const __m128 y2_crest{_mm_load_ps(&crestFactor[i])};
+        __m128 t_att{_mm_set1_ps(attack)};
+        if(autoAttack)
+        {
+            const __m128 x{_mm_mul_ps(y2_crest, att4)};
+            _mm_store_ps(&attackCoeffs[i], exp_ps(x));
+            t_att = _mm_div_ps(_mm_set1_ps(-1.0f), x);
+        }
+        if(autoRelease)
+        {
+            const __m128 t_rel{_mm_sub_ps(_mm_div_ps(rel4, y2_crest), t_att)};
+            _mm_store_ps(&releaseCoeffs[i], exp_ps(_mm_div_ps(_mm_set1_ps(-1.0f), t_rel)));
+        }
+    }
+#endif
+    for(;i < SamplesToDo;++i)
+    {
+        const float y2_crest{crestFactor[i]};
+        float t_att{attack};
+        if(autoAttack)
+        {
+            t_att = 2.0f*attack/y2_crest;
+            attackCoeffs[i] = std::exp(-1.0f / t_att);
+        }
+        if(autoRelease)
+        {
+            const float t_rel{2.0f*release/y2_crest - t_att};
+            releaseCoeffs[i] = std::exp(-1.0f / t_rel);
+        }
+    }
+}
+
+/* Clamps the minimum amplitude to near-zero and converts to logarithm. */
+void CalcLogLevel(const float *input, float *output, const uint SamplesToDo)
+{
+    size_t i{0};
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 minval{_mm_set1_ps(0.000001f)};
+    for(;i+4 <= SamplesToDo;i += 4)
+        _mm_storeu_ps(&output[i], log_ps(_mm_max_ps(minval, _mm_loadu_ps(&input[i]))));
+#endif
+    for(;i < SamplesToDo;++i)
+        output[i] = std::log(maxf(0.000001f, input[i]));
+}
+
 /* The side-chain starts with a simple peak detector (based on the absolute
  * value of the incoming signal) and performs most of its operations in the
  * log domain.
@@ -152,10 +320,8 @@ void PeakDetector(Compressor *Comp, const uint SamplesToDo)
 {
     ASSUME(SamplesToDo > 0);
 
-    /* Clamp the minimum amplitude to near-zero and convert to logarithm. */
-    auto side_begin = std::begin(Comp->mSideChain) + Comp->mLookAhead;
-    std::transform(side_begin, side_begin+SamplesToDo, side_begin,
-        [](float s) { return std::log(maxf(0.000001f, s)); });
+    float *side_begin{std::begin(Comp->mSideChain) + Comp->mLookAhead};
+    CalcLogLevel(side_begin, side_begin, SamplesToDo);
 }
 
 /* An optional hold can be used to extend the peak detector so it can more
@@ -167,16 +333,9 @@ void PeakHoldDetector(Compressor *Comp, const uint SamplesToDo)
     ASSUME(SamplesToDo > 0);
 
     SlidingHold *hold{Comp->mHold};
-    uint i{0};
-    auto detect_peak = [&i,hold](const float x_abs) -> float
-    {
-        const float x_G{std::log(maxf(0.000001f, x_abs))};
-        return UpdateSlidingHold(hold, i++, x_G);
-    };
-    auto side_begin = std::begin(Comp->mSideChain) + Comp->mLookAhead;
-    std::transform(side_begin, side_begin+SamplesToDo, side_begin, detect_peak);
-
-    ShiftSlidingHold(hold, SamplesToDo);
+    float *side_begin{std::begin(Comp->mSideChain) + Comp->mLookAhead};
+    CalcLogLevel(side_begin, hold->mValues + hold->mLength-1, SamplesToDo);
+    UpdateSlidingHold(hold, side_begin, SamplesToDo);
 }
 
 /* This is the heart of the feed-forward compressor.  It operates in the log
@@ -187,24 +346,17 @@ void PeakHoldDetector(Compressor *Comp, const uint SamplesToDo)
 void GainCompressor(Compressor *Comp, const uint SamplesToDo)
 {
     const bool autoKnee{Comp->mAuto.Knee};
-    const bool autoAttack{Comp->mAuto.Attack};
-    const bool autoRelease{Comp->mAuto.Release};
     const bool autoPostGain{Comp->mAuto.PostGain};
     const bool autoDeclip{Comp->mAuto.Declip};
     const uint lookAhead{Comp->mLookAhead};
     const float threshold{Comp->mThreshold};
     const float slope{Comp->mSlope};
-    const float attack{Comp->mAttack};
-    const float release{Comp->mRelease};
     const float c_est{Comp->mGainEstimate};
     const float a_adp{Comp->mAdaptCoeff};
-    const float *crestFactor{Comp->mCrestFactor};
+    const float *attackCoeffs{Comp->mAttackCoeffs};
+    const float *releaseCoeffs{Comp->mReleaseCoeffs};
     float postGain{Comp->mPostGain};
     float knee{Comp->mKnee};
-    float t_att{attack};
-    float t_rel{release - attack};
-    float a_att{std::exp(-1.0f / t_att)};
-    float a_rel{std::exp(-1.0f / t_rel)};
     float y_1{Comp->mLastRelease};
     float y_L{Comp->mLastAttack};
     float c_dev{Comp->mLastGainDev};
@@ -226,21 +378,13 @@ void GainCompressor(Compressor *Comp, const uint SamplesToDo)
             (std::fabs(x_over) < knee_h) ? (x_over + knee_h) * (x_over + knee_h) / (2.0f * knee) :
             x_over};
 
-        const float y2_crest{*(crestFactor++)};
-        if(autoAttack)
-        {
-            t_att = 2.0f*attack/y2_crest;
-            a_att = std::exp(-1.0f / t_att);
-        }
-        if(autoRelease)
-        {
-            t_rel = 2.0f*release/y2_crest - t_att;
-            a_rel = std::exp(-1.0f / t_rel);
-        }
+        const float a_att{*(attackCoeffs++)};
+        const float a_rel{*(releaseCoeffs++)};
 
         /* Gain smoothing (ballistics) is done via a smooth decoupled peak
          * detector.  The attack time is subtracted from the release time
-         * above to compensate for the chained operating mode.
+         * when calculating the coefficients to compensate for the chained
+         * operating mode.
          */
         const float x_L{-slope * y_G};
         y_1 = maxf(x_L, lerpf(x_L, y_1, a_rel));
@@ -267,12 +411,22 @@ void GainCompressor(Compressor *Comp, const uint SamplesToDo)
             postGain = -(c_dev + c_est);
         }
 
-        sideChain = std::exp(postGain - y_L);
+        /* Leave the log-domain gain, it's converted afterward. */
+        sideChain = postGain - y_L;
     }
 
     Comp->mLastRelease = y_1;
     Comp->mLastAttack = y_L;
     Comp->mLastGainDev = c_dev;
+
+    float *RESTRICT gains{Comp->mSideChain};
+    size_t i{0};
+#ifdef HAVE_SSE_INTRINSICS
+    for(;i+4 <= SamplesToDo;i += 4)
+        _mm_store_ps(&gains[i], exp_ps(_mm_load_ps(&gains[i])));
+#endif
+    for(;i < SamplesToDo;++i)
+        gains[i] = std::exp(gains[i]);
 }
 
 /* Combined with the hold time, a look-ahead delay can improve handling of
@@ -280,7 +434,8 @@ void GainCompressor(Compressor *Comp, const uint SamplesToDo)
  * reaching the offending impulse.  This is best used when operating as a
  * limiter.
  */
-void SignalDelay(Compressor *Comp, const uint SamplesToDo, FloatBufferLine *OutBuffer)
+void SignalDelay(Compressor *Comp, const uint SamplesToDo, FloatBufferLine *OutBuffer,
+    const uint Offset)
 {
     const size_t numChans{Comp->mNumChans};
     const uint lookAhead{Comp->mLookAhead};
@@ -289,21 +444,29 @@ void SignalDelay(Compressor *Comp, const uint SamplesToDo, FloatBufferLine *OutB
     ASSUME(numChans > 0);
     ASSUME(lookAhead > 0);
 
+    /* Shifting with plain copies through a temporary is much faster than
+     * rotating in-place, which can't be vectorized.
+     */
+    alignas(16) float temp[BufferLineSize];
     for(size_t c{0};c < numChans;c++)
     {
-        float *inout{al::assume_aligned<16>(OutBuffer[c].data())};
+        float *inout{OutBuffer[c].data() + Offset};
         float *delaybuf{al::assume_aligned<16>(Comp->mDelay[c].data())};
 
         auto inout_end = inout + SamplesToDo;
         if(SamplesToDo >= lookAhead) LIKELY
         {
-            auto delay_end = std::rotate(inout, inout_end - lookAhead, inout_end);
-            std::swap_ranges(inout, delay_end, delaybuf);
+            std::copy(inout_end - lookAhead, inout_end, temp);
+            std::copy_backward(inout, inout_end - lookAhead, inout_end);
+            std::copy_n(delaybuf, lookAhead, inout);
+            std::copy_n(temp, lookAhead, delaybuf);
         }
         else
         {
-            auto delay_start = std::swap_ranges(inout, inout_end, delaybuf);
-            std::rotate(delaybuf, delay_start, delaybuf + lookAhead);
+            std::copy(inout, inout_end, temp);
+            std::copy_n(delaybuf, SamplesToDo, inout);
+            std::copy(delaybuf + SamplesToDo, delaybuf + lookAhead, delaybuf);
+            std::copy_n(temp, SamplesToDo, delaybuf + lookAhead - SamplesToDo);
         }
     }
 }
@@ -362,8 +525,7 @@ std::unique_ptr<Compressor> Compressor::Create(const size_t NumChans, const floa
         if(hold > 1)
         {
             Comp->mHold = al::construct_at(reinterpret_cast<SlidingHold*>(Comp.get() + 1));
-            Comp->mHold->mValues[0] = -std::numeric_limits<float>::infinity();
-            Comp->mHold->mExpiries[0] = hold;
+            std::fill_n(Comp->mHold->mValues, hold-1, -std::numeric_limits<float>::infinity());
             Comp->mHold->mLength = hold;
             Comp->mDelay = reinterpret_cast<FloatBufferLine*>(Comp->mHold + 1);
         }
@@ -390,7 +552,7 @@ Compressor::~Compressor()
 }
 
 
-void Compressor::process(const uint SamplesToDo, FloatBufferLine *OutBuffer)
+void Compressor::process(const uint SamplesToDo, FloatBufferLine *OutBuffer, const uint Offset)
 {
     const size_t numChans{mNumChans};
 
@@ -400,19 +562,26 @@ void Compressor::process(const uint SamplesToDo, FloatBufferLine *OutBuffer)
     const float preGain{mPreGain};
     if(preGain != 1.0f)
     {
-        auto apply_gain = [SamplesToDo,preGain](FloatBufferLine &input) noexcept -> void
+        auto apply_gain = [SamplesToDo,Offset,preGain](FloatBufferLine &input) noexcept -> void
         {
-            float *buffer{al::assume_aligned<16>(input.data())};
-            std::transform(buffer, buffer+SamplesToDo, buffer,
-                [preGain](float s) { return s * preGain; });
+            float *buffer{input.data() + Offset};
+            size_t i{0};
+#ifdef HAVE_SSE_INTRINSICS
+            const __m128 gain4{_mm_set1_ps(preGain)};
+            for(;i+4 <= SamplesToDo;i += 4)
+                _mm_storeu_ps(&buffer[i], _mm_mul_ps(_mm_loadu_ps(&buffer[i]), gain4));
+#endif
+            for(;i < SamplesToDo;++i)
+                buffer[i] *= preGain;
         };
         std::for_each(OutBuffer, OutBuffer+numChans, apply_gain);
     }
 
-    LinkChannels(this, SamplesToDo, OutBuffer);
+    LinkChannels(this, SamplesToDo, OutBuffer, Offset);
 
     if(mAuto.Attack || mAuto.Release)
         CrestDetector(this, SamplesToDo);
+    BallisticsCoeffs(this, SamplesToDo);
 
     if(mHold)
         PeakHoldDetector(this, SamplesToDo);
@@ -422,15 +591,14 @@ void Compressor::process(const uint SamplesToDo, FloatBufferLine *OutBuffer)
     GainCompressor(this, SamplesToDo);
 
     if(mDelay)
-        SignalDelay(this, SamplesToDo, OutBuffer);
+        SignalDelay(this, SamplesToDo, OutBuffer, Offset);
 
     const float (&sideChain)[BufferLineSize*2] = mSideChain;
-    auto apply_comp = [SamplesToDo,&sideChain](FloatBufferLine &input) noexcept -> void
+    auto apply_comp = [SamplesToDo,Offset,&sideChain](FloatBufferLine &input) noexcept -> void
     {
-        float *buffer{al::assume_aligned<16>(input.data())};
+        float *buffer{input.data() + Offset};
         const float *gains{al::assume_aligned<16>(&sideChain[0])};
-        std::transform(gains, gains+SamplesToDo, buffer, buffer,
-            [](float g, float s) { return g * s; });
+        ApplyGain(buffer, gains, SamplesToDo);
     };
     std::for_each(OutBuffer, OutBuffer+numChans, apply_comp);
 
@@ -46,6 +46,8 @@ struct Compressor {
 
     alignas(16) float mSideChain[2*BufferLineSize]{};
     alignas(16) float mCrestFactor[BufferLineSize]{};
+    alignas(16) float mAttackCoeffs[BufferLineSize]{};
+    alignas(16) float mReleaseCoeffs[BufferLineSize]{};
 
     SlidingHold *mHold{nullptr};
     FloatBufferLine *mDelay{nullptr};
@@ -62,7 +64,13 @@ struct Compressor {
 
 
     ~Compressor();
-    void process(const uint SamplesToDo, FloatBufferLine *OutBuffer);
+    /* Processes the given number of samples in-place, starting at the given
+     * offset of each output line. The compressor's state carries over between
+     * calls, so a period can be processed in multiple smaller chunks.
+     */
+    void process(const uint SamplesToDo, FloatBufferLine *OutBuffer, const uint Offset);
+    void process(const uint SamplesToDo, FloatBufferLine *OutBuffer)
+    { process(SamplesToDo, OutBuffer, 0); }
     int getLookAhead() const noexcept { return static_cast<int>(mLookAhead); }
 
     DEF_PLACE_NEWDEL()
@@ -0,0 +1,97 @@
+#ifndef CORE_MEMORY_STATS_H
+#define CORE_MEMORY_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+
+
+/* The kinds of memory counted for each device. Contexts count theirs with
+ * their device.
+ */
+enum class MemCategory : unsigned char {
+    Buffers, /* Sample storage, including ring buffer storage. */
+    Voices, /* Voices and their per-channel mixing state. */
+    Properties, /* Property update containers. */
+    Effects, /* Effect state storage, such as delay lines. */
+    Hrtf, /* The HRTF data set and the device's HRTF filter state. */
+    RingBuffers, /* Ring buffers for events and mixer profiles. */
+
+    Count
+};
+
+/* The bytes currently allocated for each category, and the most allocated at
+ * once. Counts can be updated from any thread, including the mixer.
+ */
+class MemoryStats {
+    struct Counter {
+        std::atomic<int64_t> mCurrent{0};
+        std::atomic<int64_t> mPeak{0};
+    };
+    std::array<Counter,static_cast<size_t>(MemCategory::Count)> mCounters;
+
+public:
+    void add(const MemCategory category, const int64_t bytes) noexcept
+    {
+        Counter &counter = mCounters[static_cast<size_t>(category)];
+        const int64_t current{counter.mCurrent.fetch_add(bytes, std::memory_order_relaxed)
+            + bytes};
+        int64_t peak{counter.mPeak.load(std::memory_order_relaxed)};
+        while(current > peak && !counter.mPeak.compare_exchange_weak(peak, current,
+            std::memory_order_relaxed))
+        {
+        }
+    }
+
+    int64_t current(const MemCategory category) const noexcept
+    {
+        return mCounters[static_cast<size_t>(category)].mCurrent.load(
+            std::memory_order_relaxed);
+    }
+    int64_t peak(const MemCategory category) const noexcept
+    { return mCounters[static_cast<size_t>(category)].mPeak.load(std::memory_order_relaxed); }
+};
+
+/* An amount of memory counted in a category of a MemoryStats, which is
+ * removed from the count when reset or destroyed. It keeps the stats alive,
+ * since the memory may be freed after the device it was counted with.
+ */
+class MemoryUsage {
+    std::shared_ptr<MemoryStats> mStats;
+    MemCategory mCategory{};
+    size_t mBytes{0};
+
+public:
+    MemoryUsage() = default;
+    MemoryUsage(const MemoryUsage&) = delete;
+    ~MemoryUsage() { reset(); }
+    MemoryUsage& operator=(const MemoryUsage&) = delete;
+
+    /** Sets the number of bytes counted, updating the stats with the change. */
+    void set(const std::shared_ptr<MemoryStats> &stats, const MemCategory category,
+        const size_t bytes) noexcept
+    {
+        if(mStats == stats && mCategory == category)
+            stats->add(category, static_cast<int64_t>(bytes) - static_cast<int64_t>(mBytes));
+        else
+        {
+            reset();
+            stats->add(category, static_cast<int64_t>(bytes));
+            mStats = stats;
+        }
+        mCategory = category;
+        mBytes = bytes;
+    }
+
+    void reset() noexcept
+    {
+        if(mStats)
+            mStats->add(mCategory, -static_cast<int64_t>(mBytes));
+        mStats = nullptr;
+        mBytes = 0;
+    }
+};
+
+#endif /* CORE_MEMORY_STATS_H */
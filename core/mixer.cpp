@@ -15,6 +15,7 @@ struct CTag;
 
 MixerOutFunc MixSamplesOut{Mix_<CTag>};
 MixerOneFunc MixSamplesOne{Mix_<CTag>};
+MixerMatrixFunc MixSamplesMatrix{MixMatrix_<CTag>};
 
 
 std::array<float,MaxAmbiChannels> CalcAmbiCoeffs(const float y, const float z, const float x,
@@ -83,7 +84,7 @@ std::array<float,MaxAmbiChannels> CalcAmbiCoeffs(const float y, const float z, c
 }
 
 void ComputePanGains(const MixParams *mix, const float*RESTRICT coeffs, const float ingain,
-    const al::span<float,MaxAmbiChannels> gains)
+    const al::span<float> gains)
 {
     auto ambimap = mix->AmbiMap.cbegin();
 
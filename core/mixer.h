@@ -24,6 +24,17 @@ inline void MixSamples(const al::span<const float> InSamples,
     const size_t Counter, const size_t OutPos)
 { MixSamplesOut(InSamples, OutBuffer, CurrentGains, TargetGains, Counter, OutPos); }
 
+/* Mixer functions that handle a matrix of inputs and output channels. */
+using MixerMatrixFunc = void(*)(const al::span<const float*const> InSamples,
+    const al::span<const float*const> InGains, const al::span<FloatBufferLine> OutBuffer,
+    const size_t OutPos, const size_t SamplesToDo);
+
+extern MixerMatrixFunc MixSamplesMatrix;
+inline void MixMatrix(const al::span<const float*const> InSamples,
+    const al::span<const float*const> InGains, const al::span<FloatBufferLine> OutBuffer,
+    const size_t OutPos, const size_t SamplesToDo)
+{ MixSamplesMatrix(InSamples, InGains, OutBuffer, OutPos, SamplesToDo); }
+
 /* Mixer functions that handle one input and one output channel. */
 using MixerOneFunc = void(*)(const al::span<const float> InSamples, float *OutBuffer,
     float &CurrentGain, const float TargetGain, const size_t Counter);
@@ -104,6 +115,6 @@ inline std::array<float,MaxAmbiChannels> CalcAngleCoeffs(const float azimuth,
  * scale and orient the sound samples.
  */
 void ComputePanGains(const MixParams *mix, const float*RESTRICT coeffs, const float ingain,
-    const al::span<float,MaxAmbiChannels> gains);
+    const al::span<float> gains);
 
 #endif /* CORE_MIXER_H */
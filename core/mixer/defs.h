@@ -2,6 +2,7 @@
 #define CORE_MIXER_DEFS_H
 
 #include <array>
+#include <cstdint>
 #include <stdlib.h>
 
 #include "alspan.h"
@@ -69,11 +70,27 @@ using ResamplerFunc = void(*)(const InterpState *state, const float *RESTRICT sr
 
 ResamplerFunc PrepareResampler(Resampler resampler, uint increment, InterpState *state);
 
+/* Resamplers for low-precision mixing. These read 16-bit samples directly
+ * from the buffer, with the given sample step between frames, and interpolate
+ * in Q15 fixed-point before writing float samples.
+ */
+using Resampler16Func = void(*)(const int16_t *RESTRICT src, const size_t srcStep, uint frac,
+    const uint increment, const al::span<float> dst);
+
+/* Gets the Q15 resampler for the given resampler, or null if there isn't one
+ * (only point and linear are available).
+ */
+Resampler16Func PrepareResampler16(Resampler resampler);
+
 
 template<typename TypeTag, typename InstTag>
 void Resample_(const InterpState *state, const float *RESTRICT src, uint frac,
     const uint increment, const al::span<float> dst);
 
+template<typename TypeTag, typename InstTag>
+void Resample16_(const int16_t *RESTRICT src, const size_t srcStep, uint frac,
+    const uint increment, const al::span<float> dst);
+
 template<typename InstTag>
 void Mix_(const al::span<const float> InSamples, const al::span<FloatBufferLine> OutBuffer,
     float *CurrentGains, const float *TargetGains, const size_t Counter, const size_t OutPos);
@@ -81,6 +98,15 @@ template<typename InstTag>
 void Mix_(const al::span<const float> InSamples, float *OutBuffer, float &CurrentGain,
     const float TargetGain, const size_t Counter);
 
+/* Mixes a matrix of inputs to the outputs, with the gains for each input to
+ * each output. The gains are constant, and ones at or below the silence
+ * threshold are skipped.
+ */
+template<typename InstTag>
+void MixMatrix_(const al::span<const float*const> InSamples,
+    const al::span<const float*const> InGains, const al::span<FloatBufferLine> OutBuffer,
+    const size_t OutPos, const size_t SamplesToDo);
+
 template<typename InstTag>
 void MixHrtf_(const float *InSamples, float2 *AccumSamples, const uint IrSize,
     const MixHrtfFilter *hrtfparams, const size_t BufferSize);
@@ -90,7 +116,8 @@ void MixHrtfBlend_(const float *InSamples, float2 *AccumSamples, const uint IrSi
 template<typename InstTag>
 void MixDirectHrtf_(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
-    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize);
+    float *TempBuf, const size_t TempStride, HrtfChannelState *ChanState, const size_t IrSize,
+    const size_t BufferSize);
 
 /* Vectorized resampler helpers */
 template<size_t N>
@@ -106,4 +133,14 @@ inline void InitPosArrays(uint frac, uint increment, uint (&frac_arr)[N], uint (
     }
 }
 
+/* Linearly interpolates between two 16-bit samples with a Q15 factor (the
+ * mixer fraction shifted down by one), rounding and saturating the same as
+ * NEON's vqrdmulh and vqadd.
+ */
+inline int16_t LerpQ15(const int val0, const int val1, const int mu) noexcept
+{
+    const int out{((val0*(0x7fff-mu) + 0x4000) >> 15) + ((val1*mu + 0x4000) >> 15)};
+    return static_cast<int16_t>((out > 32767) ? 32767 : (out < -32768) ? -32768 : out);
+}
+
 #endif /* CORE_MIXER_DEFS_H */
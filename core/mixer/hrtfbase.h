@@ -86,7 +86,8 @@ inline void MixHrtfBlendBase(const float *InSamples, float2 *RESTRICT AccumSampl
 template<ApplyCoeffsT ApplyCoeffs>
 inline void MixDirectHrtfBase(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *RESTRICT AccumSamples,
-    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize)
+    float *TempBuf, const size_t TempStride, HrtfChannelState *ChanState, const size_t IrSize,
+    const size_t BufferSize)
 {
     ASSUME(BufferSize > 0);
 
@@ -108,6 +109,10 @@ inline void MixDirectHrtfBase(const FloatBufferSpan LeftOut, const FloatBufferSp
             ApplyCoeffs(AccumSamples+i, IrSize, Coeffs, insample, insample);
         }
 
+        /* A non-0 stride keeps each channel's scaled input, for the caller to
+         * process further.
+         */
+        TempBuf += TempStride;
         ++ChanState;
     }
 
@@ -0,0 +1,536 @@
+#include "config.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "almalloc.h"
+#include "alnumeric.h"
+#include "core/bsinc_defs.h"
+#include "core/cubic_defs.h"
+#include "defs.h"
+#include "hrtfdefs.h"
+#include "opthelpers.h"
+
+struct AVX2Tag;
+struct LerpTag;
+struct CubicTag;
+struct BSincTag;
+struct FastBSincTag;
+
+
+#if defined(__GNUC__) && !defined(__clang__) && !(defined(__AVX2__) && defined(__FMA__))
+#pragma GCC target("avx2,fma")
+#elif defined(__clang__) && !(defined(__AVX2__) && defined(__FMA__))
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to=function)
+#define AVX2_CLANG_ATTRIBUTE_PUSHED
+#endif
+
+/* Included after enabling AVX2 so the HRTF mixer templates get built for it
+ * and can inline ApplyCoeffs. Its own dependencies are included above, so
+ * only the templates themselves are affected.
+ */
+#include "hrtfbase.h"
+
+namespace {
+
+constexpr uint BSincPhaseDiffBits{MixerFracBits - BSincPhaseBits};
+constexpr uint BSincPhaseDiffOne{1 << BSincPhaseDiffBits};
+constexpr uint BSincPhaseDiffMask{BSincPhaseDiffOne - 1u};
+
+constexpr uint CubicPhaseDiffBits{MixerFracBits - CubicPhaseBits};
+constexpr uint CubicPhaseDiffOne{1 << CubicPhaseDiffBits};
+constexpr uint CubicPhaseDiffMask{CubicPhaseDiffOne - 1u};
+
+/* x + y*z, fused. */
+#define FMA4(x, y, z) _mm_fmadd_ps(y, z, x)
+#define FMA8(x, y, z) _mm256_fmadd_ps(y, z, x)
+
+/* Combines two 128-bit vectors into one 256-bit vector, lo in the lower lane. */
+inline __m256 set_m128x2(const __m128 lo, const __m128 hi)
+{ return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1); }
+
+inline float hsum8(const __m256 v8)
+{
+    __m128 r4{_mm_add_ps(_mm256_castps256_ps128(v8), _mm256_extractf128_ps(v8, 1))};
+    r4 = _mm_add_ps(r4, _mm_movehl_ps(r4, r4));
+    r4 = _mm_add_ss(r4, _mm_shuffle_ps(r4, r4, _MM_SHUFFLE(0, 0, 0, 1)));
+    return _mm_cvtss_f32(r4);
+}
+
+inline void ApplyCoeffs(float2 *RESTRICT Values, const size_t IrSize, const ConstHrirSpan Coeffs,
+    const float left, const float right)
+{
+    const __m256 lrlr{_mm256_setr_ps(left, right, left, right, left, right, left, right)};
+
+    ASSUME(IrSize >= MinIrLength);
+    /* Values alternates between 8- and 16-byte alignment, and the coefficients
+     * are only guaranteed 16-byte alignment, so unaligned loads are used for
+     * the 4 coefficient pairs handled per step.
+     */
+    size_t i{0};
+    for(size_t td{IrSize >> 2};td;--td)
+    {
+        const __m256 coeffs{_mm256_loadu_ps(Coeffs[i].data())};
+        __m256 vals{_mm256_loadu_ps(Values[i].data())};
+        vals = FMA8(vals, lrlr, coeffs);
+        _mm256_storeu_ps(Values[i].data(), vals);
+        i += 4;
+    }
+    for(;i < IrSize;++i)
+    {
+        Values[i][0] += Coeffs[i][0]*left;
+        Values[i][1] += Coeffs[i][1]*right;
+    }
+}
+
+force_inline void MixLine(const al::span<const float> InSamples, float *RESTRICT dst,
+    float &CurrentGain, const float TargetGain, const float delta, const size_t min_len,
+    const size_t aligned_len, size_t Counter)
+{
+    float gain{CurrentGain};
+    const float step{(TargetGain-gain) * delta};
+
+    size_t pos{0};
+    if(!(std::abs(step) > std::numeric_limits<float>::epsilon()))
+        gain = TargetGain;
+    else
+    {
+        float step_count{0.0f};
+        /* Mix with applying gain steps in multiples of 8. */
+        if(size_t todo{min_len >> 3})
+        {
+            const __m256 eight8{_mm256_set1_ps(8.0f)};
+            const __m256 step8{_mm256_set1_ps(step)};
+            const __m256 gain8{_mm256_set1_ps(gain)};
+            __m256 step_count8{_mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f)};
+            do {
+                const __m256 val8{_mm256_loadu_ps(&InSamples[pos])};
+                __m256 dry8{_mm256_loadu_ps(&dst[pos])};
+
+                /* dry += val * (gain + step*step_count) */
+                dry8 = FMA8(dry8, val8, FMA8(gain8, step8, step_count8));
+
+                _mm256_storeu_ps(&dst[pos], dry8);
+                step_count8 = _mm256_add_ps(step_count8, eight8);
+                pos += 8;
+            } while(--todo);
+            /* NOTE: step_count8 now represents the next eight counts after the
+             * last eight mixed samples, so the lowest element represents the
+             * next step count to apply.
+             */
+            step_count = _mm256_cvtss_f32(step_count8);
+        }
+        /* Mix with applying left over gain steps that aren't multiples of 8. */
+        for(size_t leftover{min_len&7};leftover;++pos,--leftover)
+        {
+            dst[pos] += InSamples[pos] * (gain + step*step_count);
+            step_count += 1.0f;
+        }
+        if(pos == Counter)
+            gain = TargetGain;
+        else
+            gain += step*step_count;
+
+        /* Mix until pos is a multiple of 8 or the mix is done. */
+        for(size_t leftover{aligned_len&7};leftover;++pos,--leftover)
+            dst[pos] += InSamples[pos] * gain;
+    }
+    CurrentGain = gain;
+
+    if(!(std::abs(gain) > GainSilenceThreshold))
+        return;
+    if(size_t todo{(InSamples.size()-pos) >> 3})
+    {
+        const __m256 gain8{_mm256_set1_ps(gain)};
+        do {
+            const __m256 val8{_mm256_loadu_ps(&InSamples[pos])};
+            __m256 dry8{_mm256_loadu_ps(&dst[pos])};
+            dry8 = FMA8(dry8, val8, gain8);
+            _mm256_storeu_ps(&dst[pos], dry8);
+            pos += 8;
+        } while(--todo);
+    }
+    for(size_t leftover{(InSamples.size()-pos)&7};leftover;++pos,--leftover)
+        dst[pos] += InSamples[pos] * gain;
+}
+
+} // namespace
+
+template<>
+void Resample_<LerpTag,AVX2Tag>(const InterpState*, const float *RESTRICT src, uint frac,
+    const uint increment, const al::span<float> dst)
+{
+    ASSUME(frac < MixerFracOne);
+
+    const __m256i increment8{_mm256_set1_epi32(static_cast<int>(increment*8))};
+    const __m256 fracOne8{_mm256_set1_ps(1.0f/MixerFracOne)};
+    const __m256i fracMask8{_mm256_set1_epi32(MixerFracMask)};
+
+    alignas(32) uint pos_[8], frac_[8];
+    InitPosArrays(frac, increment, frac_, pos_);
+    __m256i frac8{_mm256_load_si256(reinterpret_cast<const __m256i*>(frac_))};
+    __m256i pos8{_mm256_load_si256(reinterpret_cast<const __m256i*>(pos_))};
+
+    auto dst_iter = dst.begin();
+    for(size_t todo{dst.size()>>3};todo;--todo)
+    {
+        /* The positions are relative to src, which won't exceed the int range
+         * for the few thousand samples being resampled at a time.
+         */
+        const __m256 val1{_mm256_i32gather_ps(src, pos8, 4)};
+        const __m256 val2{_mm256_i32gather_ps(src+1, pos8, 4)};
+
+        /* val1 + (val2-val1)*mu */
+        const __m256 r0{_mm256_sub_ps(val2, val1)};
+        const __m256 mu{_mm256_mul_ps(_mm256_cvtepi32_ps(frac8), fracOne8)};
+        const __m256 out{FMA8(val1, mu, r0)};
+
+        _mm256_storeu_ps(dst_iter, out);
+        dst_iter += 8;
+
+        frac8 = _mm256_add_epi32(frac8, increment8);
+        pos8 = _mm256_add_epi32(pos8, _mm256_srli_epi32(frac8, MixerFracBits));
+        frac8 = _mm256_and_si256(frac8, fracMask8);
+    }
+
+    if(size_t todo{dst.size()&7})
+    {
+        src += static_cast<uint>(_mm256_cvtsi256_si32(pos8));
+        frac = static_cast<uint>(_mm256_cvtsi256_si32(frac8));
+
+        do {
+            *(dst_iter++) = lerpf(src[0], src[1], static_cast<float>(frac) * (1.0f/MixerFracOne));
+
+            frac += increment;
+            src  += frac>>MixerFracBits;
+            frac &= MixerFracMask;
+        } while(--todo);
+    }
+}
+
+template<>
+void Resample_<CubicTag,AVX2Tag>(const InterpState *state, const float *RESTRICT src, uint frac,
+    const uint increment, const al::span<float> dst)
+{
+    ASSUME(frac < MixerFracOne);
+
+    const CubicCoefficients *RESTRICT filter = al::assume_aligned<16>(state->cubic.filter);
+
+    src -= 1;
+    auto dst_iter = dst.begin();
+    /* Each output sample only needs 4 taps, so two output samples are
+     * processed together, one in each 128-bit lane.
+     */
+    for(size_t todo{dst.size()>>1};todo;--todo)
+    {
+        const uint pi0{frac >> CubicPhaseDiffBits};
+        const float pf0{static_cast<float>(frac&CubicPhaseDiffMask) * (1.0f/CubicPhaseDiffOne)};
+        const float *RESTRICT src0{src};
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+
+        const uint pi1{frac >> CubicPhaseDiffBits};
+        const float pf1{static_cast<float>(frac&CubicPhaseDiffMask) * (1.0f/CubicPhaseDiffOne)};
+        const float *RESTRICT src1{src};
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+
+        const __m256 pf8{set_m128x2(_mm_set1_ps(pf0), _mm_set1_ps(pf1))};
+        const __m256 coeffs8{set_m128x2(_mm_load_ps(filter[pi0].mCoeffs),
+            _mm_load_ps(filter[pi1].mCoeffs))};
+        const __m256 deltas8{set_m128x2(_mm_load_ps(filter[pi0].mDeltas),
+            _mm_load_ps(filter[pi1].mDeltas))};
+        const __m256 src8{set_m128x2(_mm_loadu_ps(src0), _mm_loadu_ps(src1))};
+
+        /* f = fil + pf*phd */
+        const __m256 f8{FMA8(coeffs8, pf8, deltas8)};
+        /* r = f*src */
+        __m256 r8{_mm256_mul_ps(f8, src8)};
+
+        /* Sum each lane's 4 values in place. */
+        r8 = _mm256_hadd_ps(r8, r8);
+        r8 = _mm256_hadd_ps(r8, r8);
+        dst_iter[0] = _mm_cvtss_f32(_mm256_castps256_ps128(r8));
+        dst_iter[1] = _mm_cvtss_f32(_mm256_extractf128_ps(r8, 1));
+        dst_iter += 2;
+    }
+    if((dst.size()&1))
+    {
+        const uint pi{frac >> CubicPhaseDiffBits};
+        const float pf{static_cast<float>(frac&CubicPhaseDiffMask) * (1.0f/CubicPhaseDiffOne)};
+        const __m128 pf4{_mm_set1_ps(pf)};
+
+        const __m128 f4{FMA4(_mm_load_ps(filter[pi].mCoeffs), pf4,
+            _mm_load_ps(filter[pi].mDeltas))};
+        __m128 r4{_mm_mul_ps(f4, _mm_loadu_ps(src))};
+
+        r4 = _mm_add_ps(r4, _mm_shuffle_ps(r4, r4, _MM_SHUFFLE(0, 1, 2, 3)));
+        r4 = _mm_add_ps(r4, _mm_movehl_ps(r4, r4));
+        *dst_iter = _mm_cvtss_f32(r4);
+    }
+}
+
+template<>
+void Resample_<BSincTag,AVX2Tag>(const InterpState *state, const float *RESTRICT src, uint frac,
+    const uint increment, const al::span<float> dst)
+{
+    const float *const filter{state->bsinc.filter};
+    const __m256 sf8{_mm256_set1_ps(state->bsinc.sf)};
+    const size_t m{state->bsinc.m};
+    ASSUME(m > 0);
+    ASSUME(frac < MixerFracOne);
+
+    src -= state->bsinc.l;
+    for(float &out_sample : dst)
+    {
+        // Calculate the phase index and factor.
+        const uint pi{frac >> BSincPhaseDiffBits};
+        const float pf{static_cast<float>(frac&BSincPhaseDiffMask) * (1.0f/BSincPhaseDiffOne)};
+
+        // Apply the scale and phase interpolated filter.
+        __m256 r8{_mm256_setzero_ps()};
+        {
+            const __m256 pf8{_mm256_set1_ps(pf)};
+            const float *RESTRICT fil{filter + m*pi*2};
+            const float *RESTRICT phd{fil + m};
+            const float *RESTRICT scd{fil + BSincPhaseCount*2*m};
+            const float *RESTRICT spd{scd + m};
+            size_t j{0u};
+
+            for(size_t td{m >> 3};td;--td)
+            {
+                /* f = ((fil + sf*scd) + pf*(phd + sf*spd)) */
+                const __m256 f8 = FMA8(
+                    FMA8(_mm256_loadu_ps(&fil[j]), sf8, _mm256_loadu_ps(&scd[j])),
+                    pf8, FMA8(_mm256_loadu_ps(&phd[j]), sf8, _mm256_loadu_ps(&spd[j])));
+                /* r += f*src */
+                r8 = FMA8(r8, f8, _mm256_loadu_ps(&src[j]));
+                j += 8;
+            }
+            /* The coefficient count is a multiple of 4, so there may be one
+             * more set of 4 left.
+             */
+            if((m&4))
+            {
+                const __m128 sf4{_mm256_castps256_ps128(sf8)};
+                const __m128 pf4{_mm256_castps256_ps128(pf8)};
+                const __m128 f4 = FMA4(
+                    FMA4(_mm_load_ps(&fil[j]), sf4, _mm_load_ps(&scd[j])),
+                    pf4, FMA4(_mm_load_ps(&phd[j]), sf4, _mm_load_ps(&spd[j])));
+                const __m128 r4{_mm_mul_ps(f4, _mm_loadu_ps(&src[j]))};
+                r8 = _mm256_add_ps(r8, _mm256_insertf128_ps(_mm256_setzero_ps(), r4, 0));
+            }
+        }
+        out_sample = hsum8(r8);
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+}
+
+template<>
+void Resample_<FastBSincTag,AVX2Tag>(const InterpState *state, const float *RESTRICT src,
+    uint frac, const uint increment, const al::span<float> dst)
+{
+    const float *const filter{state->bsinc.filter};
+    const size_t m{state->bsinc.m};
+    ASSUME(m > 0);
+    ASSUME(frac < MixerFracOne);
+
+    src -= state->bsinc.l;
+    for(float &out_sample : dst)
+    {
+        // Calculate the phase index and factor.
+        const uint pi{frac >> BSincPhaseDiffBits};
+        const float pf{static_cast<float>(frac&BSincPhaseDiffMask) * (1.0f/BSincPhaseDiffOne)};
+
+        // Apply the phase interpolated filter.
+        __m256 r8{_mm256_setzero_ps()};
+        {
+            const __m256 pf8{_mm256_set1_ps(pf)};
+            const float *RESTRICT fil{filter + m*pi*2};
+            const float *RESTRICT phd{fil + m};
+            size_t j{0u};
+
+            for(size_t td{m >> 3};td;--td)
+            {
+                /* f = fil + pf*phd */
+                const __m256 f8{FMA8(_mm256_loadu_ps(&fil[j]), pf8, _mm256_loadu_ps(&phd[j]))};
+                /* r += f*src */
+                r8 = FMA8(r8, f8, _mm256_loadu_ps(&src[j]));
+                j += 8;
+            }
+            if((m&4))
+            {
+                const __m128 pf4{_mm256_castps256_ps128(pf8)};
+                const __m128 f4{FMA4(_mm_load_ps(&fil[j]), pf4, _mm_load_ps(&phd[j]))};
+                const __m128 r4{_mm_mul_ps(f4, _mm_loadu_ps(&src[j]))};
+                r8 = _mm256_add_ps(r8, _mm256_insertf128_ps(_mm256_setzero_ps(), r4, 0));
+            }
+        }
+        out_sample = hsum8(r8);
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+}
+
+
+template<>
+void MixHrtf_<AVX2Tag>(const float *InSamples, float2 *AccumSamples, const uint IrSize,
+    const MixHrtfFilter *hrtfparams, const size_t BufferSize)
+{ MixHrtfBase<ApplyCoeffs>(InSamples, AccumSamples, IrSize, hrtfparams, BufferSize); }
+
+template<>
+void MixHrtfBlend_<AVX2Tag>(const float *InSamples, float2 *AccumSamples, const uint IrSize,
+    const HrtfFilter *oldparams, const MixHrtfFilter *newparams, const size_t BufferSize)
+{
+    MixHrtfBlendBase<ApplyCoeffs>(InSamples, AccumSamples, IrSize, oldparams, newparams,
+        BufferSize);
+}
+
+template<>
+void MixDirectHrtf_<AVX2Tag>(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
+    const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
+    float *TempBuf, const size_t TempStride, HrtfChannelState *ChanState, const size_t IrSize,
+    const size_t BufferSize)
+{
+    MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf,
+        TempStride, ChanState, IrSize, BufferSize);
+}
+
+
+template<>
+void Mix_<AVX2Tag>(const al::span<const float> InSamples, const al::span<FloatBufferLine> OutBuffer,
+    float *CurrentGains, const float *TargetGains, const size_t Counter, const size_t OutPos)
+{
+    const float delta{(Counter > 0) ? 1.0f / static_cast<float>(Counter) : 0.0f};
+    const auto min_len = minz(Counter, InSamples.size());
+    const auto aligned_len = minz((min_len+7) & ~size_t{7}, InSamples.size()) - min_len;
+
+    for(FloatBufferLine &output : OutBuffer)
+        MixLine(InSamples, al::assume_aligned<16>(output.data()+OutPos), *CurrentGains++,
+            *TargetGains++, delta, min_len, aligned_len, Counter);
+}
+
+template<>
+void Mix_<AVX2Tag>(const al::span<const float> InSamples, float *OutBuffer, float &CurrentGain,
+    const float TargetGain, const size_t Counter)
+{
+    const float delta{(Counter > 0) ? 1.0f / static_cast<float>(Counter) : 0.0f};
+    const auto min_len = minz(Counter, InSamples.size());
+    const auto aligned_len = minz((min_len+7) & ~size_t{7}, InSamples.size()) - min_len;
+
+    MixLine(InSamples, al::assume_aligned<16>(OutBuffer), CurrentGain, TargetGain, delta, min_len,
+        aligned_len, Counter);
+}
+
+template<>
+void MixMatrix_<AVX2Tag>(const al::span<const float*const> InSamples,
+    const al::span<const float*const> InGains, const al::span<FloatBufferLine> OutBuffer,
+    const size_t OutPos, const size_t SamplesToDo)
+{
+    /* Mix up to MaxInputs inputs at a time to four outputs, so each block of
+     * output samples is loaded and stored once for all the inputs instead of
+     * once per input. Silent gains are zeroed for the vector loop, which
+     * leaves the output unchanged, and skipped for the remainder.
+     */
+    static constexpr size_t MaxInputs{32};
+    const size_t todoV{SamplesToDo & ~size_t{7}};
+
+    __m256 gainsV[MaxInputs][4];
+    float gains[MaxInputs][4];
+    for(size_t base{0};base < InSamples.size();base += MaxInputs)
+    {
+        const size_t numIn{minz(InSamples.size()-base, MaxInputs)};
+        const float *const *srcs{&InSamples[base]};
+
+        size_t c{0};
+        for(;c+4 <= OutBuffer.size();c += 4)
+        {
+            for(size_t i{0};i < numIn;++i)
+            {
+                for(size_t j{0};j < 4;++j)
+                {
+                    const float gain{InGains[base+i][c+j]};
+                    gains[i][j] = (std::abs(gain) > GainSilenceThreshold) ? gain : 0.0f;
+                    gainsV[i][j] = _mm256_set1_ps(gains[i][j]);
+                }
+            }
+
+            float *RESTRICT dst0{al::assume_aligned<16>(OutBuffer[c+0].data()+OutPos)};
+            float *RESTRICT dst1{al::assume_aligned<16>(OutBuffer[c+1].data()+OutPos)};
+            float *RESTRICT dst2{al::assume_aligned<16>(OutBuffer[c+2].data()+OutPos)};
+            float *RESTRICT dst3{al::assume_aligned<16>(OutBuffer[c+3].data()+OutPos)};
+            for(size_t pos{0};pos < todoV;pos += 8)
+            {
+                __m256 dry0{_mm256_loadu_ps(&dst0[pos])};
+                __m256 dry1{_mm256_loadu_ps(&dst1[pos])};
+                __m256 dry2{_mm256_loadu_ps(&dst2[pos])};
+                __m256 dry3{_mm256_loadu_ps(&dst3[pos])};
+                for(size_t i{0};i < numIn;++i)
+                {
+                    const __m256 valV{_mm256_loadu_ps(&srcs[i][pos])};
+                    dry0 = FMA8(dry0, valV, gainsV[i][0]);
+                    dry1 = FMA8(dry1, valV, gainsV[i][1]);
+                    dry2 = FMA8(dry2, valV, gainsV[i][2]);
+                    dry3 = FMA8(dry3, valV, gainsV[i][3]);
+                }
+                _mm256_storeu_ps(&dst0[pos], dry0);
+                _mm256_storeu_ps(&dst1[pos], dry1);
+                _mm256_storeu_ps(&dst2[pos], dry2);
+                _mm256_storeu_ps(&dst3[pos], dry3);
+            }
+            float *RESTRICT dsts[4]{dst0, dst1, dst2, dst3};
+            for(size_t j{0};j < 4;++j)
+            {
+                for(size_t i{0};i < numIn;++i)
+                {
+                    const float gain{gains[i][j]};
+                    if(gain == 0.0f) continue;
+                    for(size_t pos{todoV};pos < SamplesToDo;++pos)
+                        dsts[j][pos] += srcs[i][pos] * gain;
+                }
+            }
+        }
+        for(;c < OutBuffer.size();++c)
+        {
+            float *RESTRICT dst{al::assume_aligned<16>(OutBuffer[c].data()+OutPos)};
+            for(size_t i{0};i < numIn;++i)
+            {
+                const float gain{InGains[base+i][c]};
+                gains[i][0] = (std::abs(gain) > GainSilenceThreshold) ? gain : 0.0f;
+                gainsV[i][0] = _mm256_set1_ps(gains[i][0]);
+            }
+
+            for(size_t pos{0};pos < todoV;pos += 8)
+            {
+                __m256 dry{_mm256_loadu_ps(&dst[pos])};
+                for(size_t i{0};i < numIn;++i)
+                    dry = FMA8(dry, _mm256_loadu_ps(&srcs[i][pos]), gainsV[i][0]);
+                _mm256_storeu_ps(&dst[pos], dry);
+            }
+            for(size_t i{0};i < numIn;++i)
+            {
+                const float gain{gains[i][0]};
+                if(gain == 0.0f) continue;
+                for(size_t pos{todoV};pos < SamplesToDo;++pos)
+                    dst[pos] += srcs[i][pos] * gain;
+            }
+        }
+    }
+}
+
+#ifdef AVX2_CLANG_ATTRIBUTE_PUSHED
+#pragma clang attribute pop
+#undef AVX2_CLANG_ATTRIBUTE_PUSHED
+#endif
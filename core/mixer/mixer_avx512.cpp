@@ -0,0 +1,214 @@
+#include "config.h"
+
+#include <immintrin.h>
+
+#include <cmath>
+#include <limits>
+
+#include "alnumeric.h"
+#include "defs.h"
+
+struct AVX512Tag;
+
+
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__AVX512F__)
+#pragma GCC target("avx512f")
+#elif defined(__clang__) && !defined(__AVX512F__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to=function)
+#define AVX512_CLANG_ATTRIBUTE_PUSHED
+#endif
+
+namespace {
+
+/* The number of output channels mixed per pass over the input. More channels
+ * per pass means fewer input loads, but the output lines are all 4KB apart,
+ * and interleaving stores and loads to more than a couple of them at the same
+ * line offset quickly stalls on false store-to-load dependencies (4K
+ * aliasing), outweighing the savings.
+ */
+constexpr size_t MixChannelsPerPass{2};
+
+struct ChannelGain {
+    float *RESTRICT dst;
+    float gain; /* Starting gain of the ramp, or the fixed gain. */
+    float step; /* Gain step per sample during the ramp, or 0 for none. */
+    float target; /* Gain applied after the ramp, 0 if it ends silent. */
+};
+
+/* Sets up the gain ramp for a channel, updating the current gain to what it
+ * will be at the end of the mix. Returns false if the channel is silent and
+ * needs no mixing.
+ */
+inline bool SetupChannel(ChannelGain &chan, float *RESTRICT dst, float &CurrentGain,
+    const float TargetGain, const float delta, const size_t min_len, const size_t Counter)
+{
+    float gain{CurrentGain};
+    const float step{(TargetGain-gain) * delta};
+
+    chan.dst = dst;
+    if(!(std::abs(step) > std::numeric_limits<float>::epsilon()))
+    {
+        gain = TargetGain;
+        chan.gain = gain;
+        chan.step = 0.0f;
+    }
+    else
+    {
+        chan.gain = gain;
+        chan.step = step;
+        if(min_len == Counter)
+            gain = TargetGain;
+        else
+            gain += step*static_cast<float>(min_len);
+    }
+    CurrentGain = gain;
+
+    if(!(std::abs(gain) > GainSilenceThreshold))
+    {
+        if(chan.step == 0.0f)
+            return false;
+        /* Only the ramp needs mixing when it ends silent, but the channel is
+         * kept with its group with nothing added after.
+         */
+        gain = 0.0f;
+    }
+    chan.target = gain;
+    return true;
+}
+
+/* Mixes 16 samples at a time for N output channels, so each block of input
+ * samples is only loaded once for all of them. The ramping gain for each
+ * sample is gain + step*pos while pos is less than min_len, and the target
+ * gain after.
+ */
+template<size_t N>
+void MixChannels(const float *RESTRICT InSamples, const ChannelGain *chans, const size_t min_len,
+    const size_t len)
+{
+    float *RESTRICT dst[N];
+    __m512 gain16[N], step16[N], target16[N];
+    for(size_t c{0};c < N;++c)
+    {
+        dst[c] = chans[c].dst;
+        gain16[c] = _mm512_set1_ps(chans[c].gain);
+        step16[c] = _mm512_set1_ps(chans[c].step);
+        target16[c] = _mm512_set1_ps(chans[c].target);
+    }
+
+    size_t pos{0};
+    if(min_len > 0)
+    {
+        const __m512 sixteen16{_mm512_set1_ps(16.0f)};
+        __m512 step_count16{_mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+            8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f)};
+
+        /* Mix the blocks fully within the ramp. */
+        for(;pos+16 <= min_len;pos += 16)
+        {
+            const __m512 val16{_mm512_loadu_ps(InSamples+pos)};
+            __m512 dry16[N];
+            for(size_t c{0};c < N;++c)
+                dry16[c] = _mm512_loadu_ps(dst[c]+pos);
+            for(size_t c{0};c < N;++c)
+            {
+                const __m512 g16{_mm512_fmadd_ps(step16[c], step_count16, gain16[c])};
+                _mm512_storeu_ps(dst[c]+pos, _mm512_fmadd_ps(val16, g16, dry16[c]));
+            }
+            step_count16 = _mm512_add_ps(step_count16, sixteen16);
+        }
+        /* Mix the block the ramp ends in, with the target gain after it. */
+        if(pos < min_len)
+        {
+            const size_t todo{minz(len-pos, 16)};
+            const __mmask16 loadmask{static_cast<__mmask16>((1u<<todo) - 1u)};
+            const __mmask16 rampmask{static_cast<__mmask16>((1u<<(min_len-pos)) - 1u)};
+            const __m512 val16{_mm512_maskz_loadu_ps(loadmask, InSamples+pos)};
+            for(size_t c{0};c < N;++c)
+            {
+                const __m512 g16{_mm512_mask_blend_ps(rampmask, target16[c],
+                    _mm512_fmadd_ps(step16[c], step_count16, gain16[c]))};
+                const __m512 dry16{_mm512_maskz_loadu_ps(loadmask, dst[c]+pos)};
+                _mm512_mask_storeu_ps(dst[c]+pos, loadmask, _mm512_fmadd_ps(val16, g16, dry16));
+            }
+            pos += todo;
+        }
+    }
+
+    /* Mix the remaining samples with the target gain. */
+    for(;pos+16 <= len;pos += 16)
+    {
+        const __m512 val16{_mm512_loadu_ps(InSamples+pos)};
+        __m512 dry16[N];
+        for(size_t c{0};c < N;++c)
+            dry16[c] = _mm512_loadu_ps(dst[c]+pos);
+        for(size_t c{0};c < N;++c)
+            _mm512_storeu_ps(dst[c]+pos, _mm512_fmadd_ps(val16, target16[c], dry16[c]));
+    }
+    if(pos < len)
+    {
+        const __mmask16 mask{static_cast<__mmask16>((1u<<(len-pos)) - 1u)};
+        const __m512 val16{_mm512_maskz_loadu_ps(mask, InSamples+pos)};
+        for(size_t c{0};c < N;++c)
+        {
+            const __m512 dry16{_mm512_maskz_loadu_ps(mask, dst[c]+pos)};
+            _mm512_mask_storeu_ps(dst[c]+pos, mask, _mm512_fmadd_ps(val16, target16[c], dry16));
+        }
+    }
+}
+
+void MixChannelGroup(const float *RESTRICT InSamples, const ChannelGain *chans,
+    const size_t count, const size_t min_len, const size_t len)
+{
+    if(count == 2)
+        MixChannels<2>(InSamples, chans, min_len, len);
+    else
+        MixChannels<1>(InSamples, chans, min_len, len);
+}
+static_assert(MixChannelsPerPass == 2, "MixChannelGroup needs updating");
+
+} // namespace
+
+template<>
+void Mix_<AVX512Tag>(const al::span<const float> InSamples,
+    const al::span<FloatBufferLine> OutBuffer, float *CurrentGains, const float *TargetGains,
+    const size_t Counter, const size_t OutPos)
+{
+    const float delta{(Counter > 0) ? 1.0f / static_cast<float>(Counter) : 0.0f};
+    const auto min_len = minz(Counter, InSamples.size());
+
+    ChannelGain chans[MixChannelsPerPass];
+    size_t count{0};
+    for(FloatBufferLine &output : OutBuffer)
+    {
+        if(SetupChannel(chans[count], output.data()+OutPos, *CurrentGains, *TargetGains, delta,
+            min_len, Counter))
+        {
+            if(++count == MixChannelsPerPass)
+            {
+                MixChannelGroup(InSamples.data(), chans, count, min_len, InSamples.size());
+                count = 0;
+            }
+        }
+        ++CurrentGains;
+        ++TargetGains;
+    }
+    if(count > 0)
+        MixChannelGroup(InSamples.data(), chans, count, min_len, InSamples.size());
+}
+
+template<>
+void Mix_<AVX512Tag>(const al::span<const float> InSamples, float *OutBuffer, float &CurrentGain,
+    const float TargetGain, const size_t Counter)
+{
+    const float delta{(Counter > 0) ? 1.0f / static_cast<float>(Counter) : 0.0f};
+    const auto min_len = minz(Counter, InSamples.size());
+
+    ChannelGain chan;
+    if(SetupChannel(chan, OutBuffer, CurrentGain, TargetGain, delta, min_len, Counter))
+        MixChannels<1>(InSamples.data(), &chan, min_len, InSamples.size());
+}
+
+#ifdef AVX512_CLANG_ATTRIBUTE_PUSHED
+#pragma clang attribute pop
+#undef AVX512_CLANG_ATTRIBUTE_PUSHED
+#endif
@@ -84,6 +84,11 @@ inline float do_fastbsinc(const InterpState &istate, const float *RESTRICT vals,
     return r;
 }
 
+inline int16_t do_point16(const int16_t *RESTRICT vals, const size_t, const uint)
+{ return vals[0]; }
+inline int16_t do_lerp16(const int16_t *RESTRICT vals, const size_t step, const uint frac)
+{ return LerpQ15(vals[0], vals[step], static_cast<int>(frac>>1)); }
+
 using SamplerT = float(&)(const InterpState&, const float*RESTRICT, const uint);
 template<SamplerT Sampler>
 void DoResample(const InterpState *state, const float *RESTRICT src, uint frac,
@@ -101,6 +106,22 @@ void DoResample(const InterpState *state, const float *RESTRICT src, uint frac,
     }
 }
 
+using Sampler16T = int16_t(&)(const int16_t*RESTRICT, const size_t, const uint);
+template<Sampler16T Sampler>
+void DoResample16(const int16_t *RESTRICT src, const size_t srcStep, uint frac,
+    const uint increment, const al::span<float> dst)
+{
+    ASSUME(frac < MixerFracOne);
+    for(float &out : dst)
+    {
+        out = static_cast<float>(Sampler(src, srcStep, frac)) * (1.0f/32768.0f);
+
+        frac += increment;
+        src  += (frac>>MixerFracBits) * srcStep;
+        frac &= MixerFracMask;
+    }
+}
+
 inline void ApplyCoeffs(float2 *RESTRICT Values, const size_t IrSize, const ConstHrirSpan Coeffs,
     const float left, const float right)
 {
@@ -155,6 +176,16 @@ void Resample_<LerpTag,CTag>(const InterpState *state, const float *RESTRICT src
     const uint increment, const al::span<float> dst)
 { DoResample<do_lerp>(state, src, frac, increment, dst); }
 
+template<>
+void Resample16_<PointTag,CTag>(const int16_t *RESTRICT src, const size_t srcStep, uint frac,
+    const uint increment, const al::span<float> dst)
+{ DoResample16<do_point16>(src, srcStep, frac, increment, dst); }
+
+template<>
+void Resample16_<LerpTag,CTag>(const int16_t *RESTRICT src, const size_t srcStep, uint frac,
+    const uint increment, const al::span<float> dst)
+{ DoResample16<do_lerp16>(src, srcStep, frac, increment, dst); }
+
 template<>
 void Resample_<CubicTag,CTag>(const InterpState *state, const float *RESTRICT src, uint frac,
     const uint increment, const al::span<float> dst)
@@ -187,10 +218,11 @@ void MixHrtfBlend_<CTag>(const float *InSamples, float2 *AccumSamples, const uin
 template<>
 void MixDirectHrtf_<CTag>(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
-    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize)
+    float *TempBuf, const size_t TempStride, HrtfChannelState *ChanState, const size_t IrSize,
+    const size_t BufferSize)
 {
-    MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf, ChanState,
-        IrSize, BufferSize);
+    MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf,
+        TempStride, ChanState, IrSize, BufferSize);
 }
 
 
@@ -216,3 +248,24 @@ void Mix_<CTag>(const al::span<const float> InSamples, float *OutBuffer, float &
     MixLine(InSamples, al::assume_aligned<16>(OutBuffer), CurrentGain,
         TargetGain, delta, min_len, Counter);
 }
+
+template<>
+void MixMatrix_<CTag>(const al::span<const float*const> InSamples,
+    const al::span<const float*const> InGains, const al::span<FloatBufferLine> OutBuffer,
+    const size_t OutPos, const size_t SamplesToDo)
+{
+    for(size_t c{0};c < OutBuffer.size();++c)
+    {
+        float *RESTRICT dst{al::assume_aligned<16>(OutBuffer[c].data()+OutPos)};
+        for(size_t i{0};i < InSamples.size();++i)
+        {
+            const float gain{InGains[i][c]};
+            if(!(std::abs(gain) > GainSilenceThreshold))
+                continue;
+
+            const float *RESTRICT src{al::assume_aligned<16>(InSamples[i])};
+            for(size_t pos{0};pos < SamplesToDo;++pos)
+                dst[pos] += src[pos] * gain;
+        }
+    }
+}
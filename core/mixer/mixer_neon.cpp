@@ -191,6 +191,82 @@ void Resample_<LerpTag,NEONTag>(const InterpState*, const float *RESTRICT src, u
     }
 }
 
+template<>
+void Resample16_<LerpTag,NEONTag>(const int16_t *RESTRICT src, const size_t srcStep, uint frac,
+    const uint increment, const al::span<float> dst)
+{
+    ASSUME(frac < MixerFracOne);
+
+    const uint32x4_t increment4 = vdupq_n_u32(increment*8);
+    const uint32x4_t fracMask4 = vdupq_n_u32(MixerFracMask);
+    const uint32x4_t step4 = vdupq_n_u32(static_cast<uint>(srcStep));
+    const int16x8_t one8 = vdupq_n_s16(0x7fff);
+
+    /* Track the positions and fractions of 8 samples at a time. */
+    alignas(16) uint pos_[8], frac_[8];
+    InitPosArrays(frac, increment, frac_, pos_);
+    uint32x4_t fracA{vld1q_u32(frac_)}, fracB{vld1q_u32(frac_+4)};
+    uint32x4_t posA{vld1q_u32(pos_)}, posB{vld1q_u32(pos_+4)};
+
+    auto dst_iter = dst.begin();
+    for(size_t todo{dst.size()>>3};todo;--todo)
+    {
+        alignas(16) uint offset[8];
+        vst1q_u32(offset, vmulq_u32(posA, step4));
+        vst1q_u32(offset+4, vmulq_u32(posB, step4));
+
+        const int16_t *RESTRICT src2{src + srcStep};
+        int16x8_t val1{vdupq_n_s16(src[offset[0]])};
+        int16x8_t val2{vdupq_n_s16(src2[offset[0]])};
+        val1 = vsetq_lane_s16(src[offset[1]], val1, 1);
+        val2 = vsetq_lane_s16(src2[offset[1]], val2, 1);
+        val1 = vsetq_lane_s16(src[offset[2]], val1, 2);
+        val2 = vsetq_lane_s16(src2[offset[2]], val2, 2);
+        val1 = vsetq_lane_s16(src[offset[3]], val1, 3);
+        val2 = vsetq_lane_s16(src2[offset[3]], val2, 3);
+        val1 = vsetq_lane_s16(src[offset[4]], val1, 4);
+        val2 = vsetq_lane_s16(src2[offset[4]], val2, 4);
+        val1 = vsetq_lane_s16(src[offset[5]], val1, 5);
+        val2 = vsetq_lane_s16(src2[offset[5]], val2, 5);
+        val1 = vsetq_lane_s16(src[offset[6]], val1, 6);
+        val2 = vsetq_lane_s16(src2[offset[6]], val2, 6);
+        val1 = vsetq_lane_s16(src[offset[7]], val1, 7);
+        val2 = vsetq_lane_s16(src2[offset[7]], val2, 7);
+        const int16x8_t mu{vcombine_s16(vreinterpret_s16_u16(vshrn_n_u32(fracA, 1)),
+            vreinterpret_s16_u16(vshrn_n_u32(fracB, 1)))};
+
+        /* val1*(1-mu) + val2*mu */
+        const int16x8_t out{vqaddq_s16(vqrdmulhq_s16(val1, vsubq_s16(one8, mu)),
+            vqrdmulhq_s16(val2, mu))};
+
+        vst1q_f32(dst_iter, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(out)), 15));
+        vst1q_f32(dst_iter+4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(out)), 15));
+        dst_iter += 8;
+
+        fracA = vaddq_u32(fracA, increment4);
+        fracB = vaddq_u32(fracB, increment4);
+        posA = vaddq_u32(posA, vshrq_n_u32(fracA, MixerFracBits));
+        posB = vaddq_u32(posB, vshrq_n_u32(fracB, MixerFracBits));
+        fracA = vandq_u32(fracA, fracMask4);
+        fracB = vandq_u32(fracB, fracMask4);
+    }
+
+    if(size_t todo{dst.size()&7})
+    {
+        src += vgetq_lane_u32(posA, 0) * srcStep;
+        frac = vgetq_lane_u32(fracA, 0);
+
+        do {
+            const int16_t out{LerpQ15(src[0], src[srcStep], static_cast<int>(frac>>1))};
+            *(dst_iter++) = static_cast<float>(out) * (1.0f/32768.0f);
+
+            frac += increment;
+            src  += (frac>>MixerFracBits) * srcStep;
+            frac &= MixerFracMask;
+        } while(--todo);
+    }
+}
+
 template<>
 void Resample_<CubicTag,NEONTag>(const InterpState *state, const float *RESTRICT src, uint frac,
     const uint increment, const al::span<float> dst)
@@ -329,10 +405,11 @@ void MixHrtfBlend_<NEONTag>(const float *InSamples, float2 *AccumSamples, const
 template<>
 void MixDirectHrtf_<NEONTag>(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
-    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize)
+    float *TempBuf, const size_t TempStride, HrtfChannelState *ChanState, const size_t IrSize,
+    const size_t BufferSize)
 {
-    MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf, ChanState,
-        IrSize, BufferSize);
+    MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf,
+        TempStride, ChanState, IrSize, BufferSize);
 }
 
 
@@ -360,3 +437,99 @@ void Mix_<NEONTag>(const al::span<const float> InSamples, float *OutBuffer, floa
     MixLine(InSamples, al::assume_aligned<16>(OutBuffer), CurrentGain, TargetGain, delta, min_len,
         aligned_len, Counter);
 }
+
+template<>
+void MixMatrix_<NEONTag>(const al::span<const float*const> InSamples,
+    const al::span<const float*const> InGains, const al::span<FloatBufferLine> OutBuffer,
+    const size_t OutPos, const size_t SamplesToDo)
+{
+    /* Mix up to MaxInputs inputs at a time to four outputs, so each block of
+     * output samples is loaded and stored once for all the inputs instead of
+     * once per input. Silent gains are zeroed for the vector loop, which
+     * leaves the output unchanged, and skipped for the remainder.
+     */
+    static constexpr size_t MaxInputs{32};
+    const size_t todoV{SamplesToDo & ~size_t{3}};
+
+    float32x4_t gainsV[MaxInputs][4];
+    float gains[MaxInputs][4];
+    for(size_t base{0};base < InSamples.size();base += MaxInputs)
+    {
+        const size_t numIn{minz(InSamples.size()-base, MaxInputs)};
+        const float *const *srcs{&InSamples[base]};
+
+        size_t c{0};
+        for(;c+4 <= OutBuffer.size();c += 4)
+        {
+            for(size_t i{0};i < numIn;++i)
+            {
+                for(size_t j{0};j < 4;++j)
+                {
+                    const float gain{InGains[base+i][c+j]};
+                    gains[i][j] = (std::abs(gain) > GainSilenceThreshold) ? gain : 0.0f;
+                    gainsV[i][j] = vdupq_n_f32(gains[i][j]);
+                }
+            }
+
+            float *RESTRICT dst0{al::assume_aligned<16>(OutBuffer[c+0].data()+OutPos)};
+            float *RESTRICT dst1{al::assume_aligned<16>(OutBuffer[c+1].data()+OutPos)};
+            float *RESTRICT dst2{al::assume_aligned<16>(OutBuffer[c+2].data()+OutPos)};
+            float *RESTRICT dst3{al::assume_aligned<16>(OutBuffer[c+3].data()+OutPos)};
+            for(size_t pos{0};pos < todoV;pos += 4)
+            {
+                float32x4_t dry0{vld1q_f32(&dst0[pos])};
+                float32x4_t dry1{vld1q_f32(&dst1[pos])};
+                float32x4_t dry2{vld1q_f32(&dst2[pos])};
+                float32x4_t dry3{vld1q_f32(&dst3[pos])};
+                for(size_t i{0};i < numIn;++i)
+                {
+                    const float32x4_t valV{vld1q_f32(&srcs[i][pos])};
+                    dry0 = vmlaq_f32(dry0, valV, gainsV[i][0]);
+                    dry1 = vmlaq_f32(dry1, valV, gainsV[i][1]);
+                    dry2 = vmlaq_f32(dry2, valV, gainsV[i][2]);
+                    dry3 = vmlaq_f32(dry3, valV, gainsV[i][3]);
+                }
+                vst1q_f32(&dst0[pos], dry0);
+                vst1q_f32(&dst1[pos], dry1);
+                vst1q_f32(&dst2[pos], dry2);
+                vst1q_f32(&dst3[pos], dry3);
+            }
+            float *RESTRICT dsts[4]{dst0, dst1, dst2, dst3};
+            for(size_t j{0};j < 4;++j)
+            {
+                for(size_t i{0};i < numIn;++i)
+                {
+                    const float gain{gains[i][j]};
+                    if(gain == 0.0f) continue;
+                    for(size_t pos{todoV};pos < SamplesToDo;++pos)
+                        dsts[j][pos] += srcs[i][pos] * gain;
+                }
+            }
+        }
+        for(;c < OutBuffer.size();++c)
+        {
+            float *RESTRICT dst{al::assume_aligned<16>(OutBuffer[c].data()+OutPos)};
+            for(size_t i{0};i < numIn;++i)
+            {
+                const float gain{InGains[base+i][c]};
+                gains[i][0] = (std::abs(gain) > GainSilenceThreshold) ? gain : 0.0f;
+                gainsV[i][0] = vdupq_n_f32(gains[i][0]);
+            }
+
+            for(size_t pos{0};pos < todoV;pos += 4)
+            {
+                float32x4_t dry{vld1q_f32(&dst[pos])};
+                for(size_t i{0};i < numIn;++i)
+                    dry = vmlaq_f32(dry, vld1q_f32(&srcs[i][pos]), gainsV[i][0]);
+                vst1q_f32(&dst[pos], dry);
+            }
+            for(size_t i{0};i < numIn;++i)
+            {
+                const float gain{gains[i][0]};
+                if(gain == 0.0f) continue;
+                for(size_t pos{todoV};pos < SamplesToDo;++pos)
+                    dst[pos] += srcs[i][pos] * gain;
+            }
+        }
+    }
+}
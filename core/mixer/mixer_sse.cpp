@@ -294,10 +294,11 @@ void MixHrtfBlend_<SSETag>(const float *InSamples, float2 *AccumSamples, const u
 template<>
 void MixDirectHrtf_<SSETag>(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
-    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize)
+    float *TempBuf, const size_t TempStride, HrtfChannelState *ChanState, const size_t IrSize,
+    const size_t BufferSize)
 {
-    MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf, ChanState,
-        IrSize, BufferSize);
+    MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf,
+        TempStride, ChanState, IrSize, BufferSize);
 }
 
 
@@ -325,3 +326,99 @@ void Mix_<SSETag>(const al::span<const float> InSamples, float *OutBuffer, float
     MixLine(InSamples, al::assume_aligned<16>(OutBuffer), CurrentGain, TargetGain, delta, min_len,
         aligned_len, Counter);
 }
+
+template<>
+void MixMatrix_<SSETag>(const al::span<const float*const> InSamples,
+    const al::span<const float*const> InGains, const al::span<FloatBufferLine> OutBuffer,
+    const size_t OutPos, const size_t SamplesToDo)
+{
+    /* Mix up to MaxInputs inputs at a time to four outputs, so each block of
+     * output samples is loaded and stored once for all the inputs instead of
+     * once per input. Silent gains are zeroed for the vector loop, which
+     * leaves the output unchanged, and skipped for the remainder.
+     */
+    static constexpr size_t MaxInputs{32};
+    const size_t todoV{SamplesToDo & ~size_t{3}};
+
+    __m128 gainsV[MaxInputs][4];
+    float gains[MaxInputs][4];
+    for(size_t base{0};base < InSamples.size();base += MaxInputs)
+    {
+        const size_t numIn{minz(InSamples.size()-base, MaxInputs)};
+        const float *const *srcs{&InSamples[base]};
+
+        size_t c{0};
+        for(;c+4 <= OutBuffer.size();c += 4)
+        {
+            for(size_t i{0};i < numIn;++i)
+            {
+                for(size_t j{0};j < 4;++j)
+                {
+                    const float gain{InGains[base+i][c+j]};
+                    gains[i][j] = (std::abs(gain) > GainSilenceThreshold) ? gain : 0.0f;
+                    gainsV[i][j] = _mm_set1_ps(gains[i][j]);
+                }
+            }
+
+            float *RESTRICT dst0{al::assume_aligned<16>(OutBuffer[c+0].data()+OutPos)};
+            float *RESTRICT dst1{al::assume_aligned<16>(OutBuffer[c+1].data()+OutPos)};
+            float *RESTRICT dst2{al::assume_aligned<16>(OutBuffer[c+2].data()+OutPos)};
+            float *RESTRICT dst3{al::assume_aligned<16>(OutBuffer[c+3].data()+OutPos)};
+            for(size_t pos{0};pos < todoV;pos += 4)
+            {
+                __m128 dry0{_mm_load_ps(&dst0[pos])};
+                __m128 dry1{_mm_load_ps(&dst1[pos])};
+                __m128 dry2{_mm_load_ps(&dst2[pos])};
+                __m128 dry3{_mm_load_ps(&dst3[pos])};
+                for(size_t i{0};i < numIn;++i)
+                {
+                    const __m128 valV{_mm_load_ps(&srcs[i][pos])};
+                    dry0 = _mm_add_ps(dry0, _mm_mul_ps(valV, gainsV[i][0]));
+                    dry1 = _mm_add_ps(dry1, _mm_mul_ps(valV, gainsV[i][1]));
+                    dry2 = _mm_add_ps(dry2, _mm_mul_ps(valV, gainsV[i][2]));
+                    dry3 = _mm_add_ps(dry3, _mm_mul_ps(valV, gainsV[i][3]));
+                }
+                _mm_store_ps(&dst0[pos], dry0);
+                _mm_store_ps(&dst1[pos], dry1);
+                _mm_store_ps(&dst2[pos], dry2);
+                _mm_store_ps(&dst3[pos], dry3);
+            }
+            float *RESTRICT dsts[4]{dst0, dst1, dst2, dst3};
+            for(size_t j{0};j < 4;++j)
+            {
+                for(size_t i{0};i < numIn;++i)
+                {
+                    const float gain{gains[i][j]};
+                    if(gain == 0.0f) continue;
+                    for(size_t pos{todoV};pos < SamplesToDo;++pos)
+                        dsts[j][pos] += srcs[i][pos] * gain;
+                }
+            }
+        }
+        for(;c < OutBuffer.size();++c)
+        {
+            float *RESTRICT dst{al::assume_aligned<16>(OutBuffer[c].data()+OutPos)};
+            for(size_t i{0};i < numIn;++i)
+            {
+                const float gain{InGains[base+i][c]};
+                gains[i][0] = (std::abs(gain) > GainSilenceThreshold) ? gain : 0.0f;
+                gainsV[i][0] = _mm_set1_ps(gains[i][0]);
+            }
+
+            for(size_t pos{0};pos < todoV;pos += 4)
+            {
+                __m128 dry{_mm_load_ps(&dst[pos])};
+                for(size_t i{0};i < numIn;++i)
+                    dry = _mm_add_ps(dry, _mm_mul_ps(_mm_load_ps(&srcs[i][pos]), gainsV[i][0]));
+                _mm_store_ps(&dst[pos], dry);
+            }
+            for(size_t i{0};i < numIn;++i)
+            {
+                const float gain{gains[i][0]};
+                if(gain == 0.0f) continue;
+                for(size_t pos{todoV};pos < SamplesToDo;++pos)
+                    dst[pos] += srcs[i][pos] * gain;
+            }
+        }
+    }
+}
@@ -93,3 +93,72 @@ void Resample_<LerpTag,SSE4Tag>(const InterpState*, const float *RESTRICT src, u
         } while(--todo);
     }
 }
+
+template<>
+void Resample16_<LerpTag,SSE4Tag>(const int16_t *RESTRICT src, const size_t srcStep, uint frac,
+    const uint increment, const al::span<float> dst)
+{
+    ASSUME(frac < MixerFracOne);
+
+    const __m128i increment4{_mm_set1_epi32(static_cast<int>(increment*8))};
+    const __m128i fracMask4{_mm_set1_epi32(MixerFracMask)};
+    const __m128i step4{_mm_set1_epi32(static_cast<int>(srcStep))};
+    const __m128i one8{_mm_set1_epi16(0x7fff)};
+    const __m128 scale4{_mm_set1_ps(1.0f/32768.0f)};
+
+    /* Track the positions and fractions of 8 samples at a time. */
+    alignas(16) uint pos_[8], frac_[8];
+    InitPosArrays(frac, increment, frac_, pos_);
+    __m128i fracA{_mm_load_si128(reinterpret_cast<const __m128i*>(frac_))};
+    __m128i fracB{_mm_load_si128(reinterpret_cast<const __m128i*>(frac_+4))};
+    __m128i posA{_mm_load_si128(reinterpret_cast<const __m128i*>(pos_))};
+    __m128i posB{_mm_load_si128(reinterpret_cast<const __m128i*>(pos_+4))};
+
+    auto dst_iter = dst.begin();
+    for(size_t todo{dst.size()>>3};todo;--todo)
+    {
+        alignas(16) int offset[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(offset), _mm_mullo_epi32(posA, step4));
+        _mm_store_si128(reinterpret_cast<__m128i*>(offset+4), _mm_mullo_epi32(posB, step4));
+
+        const int16_t *RESTRICT src2{src + srcStep};
+        const __m128i val1{_mm_setr_epi16(src[offset[0]], src[offset[1]], src[offset[2]],
+            src[offset[3]], src[offset[4]], src[offset[5]], src[offset[6]], src[offset[7]])};
+        const __m128i val2{_mm_setr_epi16(src2[offset[0]], src2[offset[1]], src2[offset[2]],
+            src2[offset[3]], src2[offset[4]], src2[offset[5]], src2[offset[6]], src2[offset[7]])};
+        const __m128i mu{_mm_packs_epi32(_mm_srli_epi32(fracA, 1), _mm_srli_epi32(fracB, 1))};
+
+        /* val1*(1-mu) + val2*mu. The factors are never negative, so the
+         * multiply can't overflow and matches NEON's vqrdmulh.
+         */
+        const __m128i out{_mm_adds_epi16(_mm_mulhrs_epi16(val1, _mm_sub_epi16(one8, mu)),
+            _mm_mulhrs_epi16(val2, mu))};
+
+        _mm_storeu_ps(dst_iter, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(out)), scale4));
+        _mm_storeu_ps(dst_iter+4, _mm_mul_ps(_mm_cvtepi32_ps(
+            _mm_cvtepi16_epi32(_mm_srli_si128(out, 8))), scale4));
+        dst_iter += 8;
+
+        fracA = _mm_add_epi32(fracA, increment4);
+        fracB = _mm_add_epi32(fracB, increment4);
+        posA = _mm_add_epi32(posA, _mm_srli_epi32(fracA, MixerFracBits));
+        posB = _mm_add_epi32(posB, _mm_srli_epi32(fracB, MixerFracBits));
+        fracA = _mm_and_si128(fracA, fracMask4);
+        fracB = _mm_and_si128(fracB, fracMask4);
+    }
+
+    if(size_t todo{dst.size()&7})
+    {
+        src += static_cast<uint>(_mm_cvtsi128_si32(posA)) * srcStep;
+        frac = static_cast<uint>(_mm_cvtsi128_si32(fracA));
+
+        do {
+            const int16_t out{LerpQ15(src[0], src[srcStep], static_cast<int>(frac>>1))};
+            *(dst_iter++) = static_cast<float>(out) * (1.0f/32768.0f);
+
+            frac += increment;
+            src  += (frac>>MixerFracBits) * srcStep;
+            frac &= MixerFracMask;
+        } while(--todo);
+    }
+}
@@ -0,0 +1,112 @@
+
+#include "config.h"
+
+#include "mixer_pool.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "althrd_setname.h"
+#include "fpu_ctrl.h"
+#include "helpers.h"
+#include "logging.h"
+
+
+MixerPool::MixerPool(DeviceBase *device, const uint numThreads)
+    : mAffinity{!device->mWorkerAffinity.empty() ? device->mWorkerAffinity
+        : ThreadAffinity[static_cast<size_t>(ThreadRole::Worker)]}
+{
+    const size_t dryStride{device->MixBuffer.size() / numThreads};
+
+    mWorkers.reserve(numThreads-1);
+    for(uint i{1};i < numThreads;++i)
+    {
+        auto worker = std::make_unique<Worker>();
+        worker->mScratch.HrtfAccumData = worker->mHrtfAccumData;
+        worker->mScratch.mThreadIndex = i;
+        worker->mScratch.mDryOffset = dryStride * i;
+        mWorkers.emplace_back(std::move(worker));
+    }
+
+    try {
+        for(auto &worker : mWorkers)
+            worker->mThread = std::thread{std::mem_fn(&MixerPool::workerProc), this,
+                worker.get()};
+    }
+    catch(std::exception& e) {
+        mQuit.store(true, std::memory_order_release);
+        for(auto &worker : mWorkers)
+        {
+            if(worker->mThread.joinable())
+            {
+                worker->mStartSem.post();
+                worker->mThread.join();
+            }
+        }
+        throw;
+    }
+    TRACE("Started %u mixer worker thread%s\n", numThreads-1, (numThreads==2)?"":"s");
+}
+
+MixerPool::~MixerPool()
+{
+    mQuit.store(true, std::memory_order_release);
+    for(auto &worker : mWorkers)
+    {
+        worker->mStartSem.post();
+        worker->mThread.join();
+    }
+}
+
+
+void MixerPool::workerProc(Worker *worker)
+{
+    SetRTPriority();
+    if(!mAffinity.empty())
+        SetThreadCpuAffinity(mAffinity);
+    althrd_setname(MIXER_WORKER_THREAD_NAME);
+
+    FPUCtl mixer_mode{};
+    while(true)
+    {
+        worker->mStartSem.wait();
+        if(mQuit.load(std::memory_order_acquire)) UNLIKELY
+            break;
+
+        {
+            al::rt_alloc_scope rtscope{};
+            mJobFunc(mJobData, worker->mScratch.mThreadIndex);
+        }
+        if(mJobsPending.fetch_sub(1u, std::memory_order_acq_rel) == 1)
+            mDoneSem.post();
+    }
+}
+
+void MixerPool::execute(JobFunc func, void *userptr)
+{
+    mJobFunc = func;
+    mJobData = userptr;
+    mJobsPending.store(static_cast<uint>(mWorkers.size()), std::memory_order_release);
+    for(auto &worker : mWorkers)
+        worker->mStartSem.post();
+
+    func(userptr, 0);
+
+    mDoneSem.wait();
+}
+
+
+void MixerPool::reduceHrtfAccum(DeviceBase *device, const size_t count) noexcept
+{
+    float2 *RESTRICT dst{device->HrtfAccumData};
+    for(auto &worker : mWorkers)
+    {
+        float2 *RESTRICT src{worker->mHrtfAccumData};
+        for(size_t i{0};i < count;++i)
+        {
+            dst[i][0] += src[i][0];
+            dst[i][1] += src[i][1];
+        }
+        std::fill_n(src, count, float2{});
+    }
+}
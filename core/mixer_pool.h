@@ -0,0 +1,94 @@
+#ifndef CORE_MIXER_POOL_H
+#define CORE_MIXER_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "almalloc.h"
+#include "alsem.h"
+#include "alspan.h"
+#include "bufferline.h"
+#include "device.h"
+#include "mixer/hrtfdefs.h"
+#include "opthelpers.h"
+
+using uint = unsigned int;
+
+/* The maximum number of threads used for mixing, including the mixer thread. */
+constexpr uint MaxMixThreads{32};
+
+
+/* A persistent set of worker threads used to help the mixer thread. A job is
+ * run once on each thread, including the calling mixer thread, and the call
+ * returns once all threads are done with it. The thread index is passed to
+ * the job so it can select the work and storage to use.
+ */
+class MixerPool {
+    struct Worker {
+        VoiceMixScratch mScratch;
+        alignas(16) float2 mHrtfAccumData[BufferLineSize + HrirLength]{};
+
+        al::semaphore mStartSem;
+        std::thread mThread;
+
+        DEF_NEWDEL(Worker)
+    };
+
+    using JobFunc = void(*)(void *userptr, const uint index);
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    JobFunc mJobFunc{nullptr};
+    void *mJobData{nullptr};
+    std::atomic<uint> mJobsPending{0u};
+    al::semaphore mDoneSem;
+    std::atomic<bool> mQuit{false};
+
+    /* The CPUs to pin the worker threads to, if any. */
+    std::vector<uint> mAffinity;
+
+    void workerProc(Worker *worker);
+
+    void execute(JobFunc func, void *userptr);
+
+public:
+    /* Creates a pool for numThreads total mixing threads, meaning numThreads-1
+     * worker threads are started. The device's mixing buffers need to be
+     * allocated for that many threads before the pool is used.
+     */
+    MixerPool(DeviceBase *device, const uint numThreads);
+    ~MixerPool();
+
+    /* Returns the number of threads that run each job. */
+    uint size() const noexcept { return static_cast<uint>(mWorkers.size()) + 1; }
+
+    /* Returns the voice mixing scratch storage for the given worker thread
+     * index (1 or more). Index 0 is the mixer thread, which uses the device's.
+     */
+    VoiceMixScratch &getScratch(const uint index) noexcept
+    { return mWorkers[index-1]->mScratch; }
+
+    /* Adds the HRTF accumulation from each worker to the device's, clearing
+     * the worker's for the next mix.
+     */
+    void reduceHrtfAccum(DeviceBase *device, const size_t count) noexcept;
+
+    template<typename F>
+    void run(F&& func)
+    {
+        using FuncType = std::remove_reference_t<F>;
+        execute([](void *userptr, const uint index) { (*static_cast<FuncType*>(userptr))(index); },
+            &func);
+    }
+
+    MixerPool(const MixerPool&) = delete;
+    MixerPool& operator=(const MixerPool&) = delete;
+
+    DEF_NEWDEL(MixerPool)
+};
+
+#endif /* CORE_MIXER_POOL_H */
@@ -0,0 +1,396 @@
+
+#include "config.h"
+
+#include "outputconv.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdint.h>
+
+#ifdef HAVE_SSE_INTRINSICS
+#include <emmintrin.h>
+#endif
+
+#include "alnumeric.h"
+#include "opthelpers.h"
+
+
+namespace {
+
+/* Base template left undefined. Should be marked =delete, but Clang 3.8.1
+ * chokes on that given the inline specializations.
+ */
+template<typename T>
+inline T SampleConv(float) noexcept;
+
+template<> inline float SampleConv(float val) noexcept
+{ return val; }
+template<> inline int32_t SampleConv(float val) noexcept
+{
+    /* Floats have a 23-bit mantissa, plus an implied 1 bit and a sign bit.
+     * This means a normalized float has at most 25 bits of signed precision.
+     * When scaling and clamping for a signed 32-bit integer, these following
+     * values are the best a float can give.
+     */
+    return fastf2i(clampf(val*2147483648.0f, -2147483648.0f, 2147483520.0f));
+}
+template<> inline int16_t SampleConv(float val) noexcept
+{ return static_cast<int16_t>(fastf2i(clampf(val*32768.0f, -32768.0f, 32767.0f))); }
+template<> inline int8_t SampleConv(float val) noexcept
+{ return static_cast<int8_t>(fastf2i(clampf(val*128.0f, -128.0f, 127.0f))); }
+
+/* Define unsigned output variations. */
+template<> inline uint32_t SampleConv(float val) noexcept
+{ return static_cast<uint32_t>(SampleConv<int32_t>(val)) + 2147483648u; }
+template<> inline uint16_t SampleConv(float val) noexcept
+{ return static_cast<uint16_t>(SampleConv<int16_t>(val) + 32768); }
+template<> inline uint8_t SampleConv(float val) noexcept
+{ return static_cast<uint8_t>(SampleConv<int8_t>(val) + 128); }
+
+
+template<typename T>
+void WriteChannels(const al::span<const FloatBufferLine> InBuffer, T *outbase,
+    const size_t Start, const size_t SamplesToDo, const size_t FrameStep)
+{
+    for(const FloatBufferLine &inbuf : InBuffer)
+    {
+        T *out{outbase++};
+        auto conv_sample = [FrameStep,&out](const float s) noexcept -> void
+        {
+            *out = SampleConv<T>(s);
+            out += FrameStep;
+        };
+        std::for_each(inbuf.begin()+Start, inbuf.begin()+SamplesToDo, conv_sample);
+    }
+}
+
+template<typename T>
+void WriteSilence(T *outbase, const size_t Channels, const size_t SamplesToDo,
+    const size_t FrameStep)
+{
+    if(const size_t extra{FrameStep - Channels})
+    {
+        outbase += Channels;
+        const auto silence = SampleConv<T>(0.0f);
+        for(size_t i{0};i < SamplesToDo;++i)
+        {
+            std::fill_n(outbase, extra, silence);
+            outbase += FrameStep;
+        }
+    }
+}
+
+template<DevFmtType T>
+void Write(const al::span<const FloatBufferLine> InBuffer, void *OutBuffer, const size_t Offset,
+    const size_t SamplesToDo, const size_t FrameStep)
+{
+    ASSUME(FrameStep > 0);
+    ASSUME(SamplesToDo > 0);
+
+    DevFmtType_t<T> *outbase{static_cast<DevFmtType_t<T>*>(OutBuffer) + Offset*FrameStep};
+    WriteChannels(InBuffer, outbase, 0, SamplesToDo, FrameStep);
+    WriteSilence(outbase, InBuffer.size(), SamplesToDo, FrameStep);
+}
+
+
+#ifdef HAVE_SSE_INTRINSICS
+
+/* Converts 4 samples to the output type, matching SampleConv, and stores the
+ * first N of them.
+ */
+template<typename T>
+struct SSEConv;
+
+template<>
+struct SSEConv<float> {
+    template<size_t N>
+    static void store(float *dst, const __m128 vals) noexcept
+    {
+        if constexpr(N == 4)
+            _mm_storeu_ps(dst, vals);
+        else if constexpr(N == 3)
+        {
+            _mm_storel_pi(reinterpret_cast<__m64*>(dst), vals);
+            _mm_store_ss(dst+2, _mm_movehl_ps(vals, vals));
+        }
+        else if constexpr(N == 2)
+            _mm_storel_pi(reinterpret_cast<__m64*>(dst), vals);
+        else
+            _mm_store_ss(dst, vals);
+    }
+};
+
+template<>
+struct SSEConv<int32_t> {
+    template<size_t N>
+    static void store(int32_t *dst, const __m128 vals) noexcept
+    {
+        const __m128 scaled{_mm_mul_ps(vals, _mm_set1_ps(2147483648.0f))};
+        const __m128 clamped{_mm_min_ps(_mm_max_ps(scaled, _mm_set1_ps(-2147483648.0f)),
+            _mm_set1_ps(2147483520.0f))};
+        const __m128i ivals{_mm_cvtps_epi32(clamped)};
+        if constexpr(N == 4)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), ivals);
+        else if constexpr(N == 3)
+        {
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), ivals);
+            dst[2] = _mm_cvtsi128_si32(_mm_shuffle_epi32(ivals, _MM_SHUFFLE(2,2,2,2)));
+        }
+        else if constexpr(N == 2)
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), ivals);
+        else
+            dst[0] = _mm_cvtsi128_si32(ivals);
+    }
+};
+
+template<>
+struct SSEConv<int16_t> {
+    template<size_t N>
+    static void store(int16_t *dst, const __m128 vals) noexcept
+    {
+        const __m128 scaled{_mm_mul_ps(vals, _mm_set1_ps(32768.0f))};
+        const __m128 clamped{_mm_min_ps(_mm_max_ps(scaled, _mm_set1_ps(-32768.0f)),
+            _mm_set1_ps(32767.0f))};
+        const __m128i ivals{_mm_cvtps_epi32(clamped)};
+        const __m128i svals{_mm_packs_epi32(ivals, ivals)};
+        if constexpr(N == 4)
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), svals);
+        else
+        {
+            const auto lo = static_cast<uint>(_mm_cvtsi128_si32(svals));
+            dst[0] = static_cast<int16_t>(lo);
+            if constexpr(N >= 2)
+                dst[1] = static_cast<int16_t>(lo >> 16);
+            if constexpr(N >= 3)
+                dst[2] = static_cast<int16_t>(_mm_extract_epi16(svals, 2));
+        }
+    }
+};
+
+/* Interleaves N (up to 4) channels at a time, by transposing 4 samples of
+ * each channel into 4 frames.
+ */
+template<typename T, size_t N>
+void WriteGroupSSE(const al::span<const FloatBufferLine,N> InBuffer, T *out,
+    const size_t SamplesToDo, const size_t FrameStep)
+{
+    static_assert(N >= 1 && N <= 4, "Invalid channel count");
+
+    const float *in[4]{};
+    for(size_t c{0};c < 4;++c)
+        in[c] = InBuffer[minz(c, N-1)].data();
+
+    for(size_t i{0};i < SamplesToDo;i+=4)
+    {
+        __m128 row0{_mm_loadu_ps(in[0]+i)};
+        __m128 row1{_mm_loadu_ps(in[1]+i)};
+        __m128 row2{_mm_loadu_ps(in[2]+i)};
+        __m128 row3{_mm_loadu_ps(in[3]+i)};
+        _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+        SSEConv<T>::template store<N>(out, row0); out += FrameStep;
+        SSEConv<T>::template store<N>(out, row1); out += FrameStep;
+        SSEConv<T>::template store<N>(out, row2); out += FrameStep;
+        SSEConv<T>::template store<N>(out, row3); out += FrameStep;
+    }
+}
+
+template<DevFmtType T>
+void WriteSSE(const al::span<const FloatBufferLine> InBuffer, void *OutBuffer,
+    const size_t Offset, const size_t SamplesToDo, const size_t FrameStep)
+{
+    ASSUME(FrameStep > 0);
+    ASSUME(SamplesToDo > 0);
+
+    using SampleType = DevFmtType_t<T>;
+    SampleType *outbase{static_cast<SampleType*>(OutBuffer) + Offset*FrameStep};
+
+    /* Frames are written in groups of 4, with any left over done one at a
+     * time.
+     */
+    const size_t todo{SamplesToDo & ~size_t{3}};
+    if(todo > 0)
+    {
+        size_t c{0};
+        for(;InBuffer.size()-c >= 4;c += 4)
+            WriteGroupSSE(InBuffer.subspan(c).first<4>(), outbase+c, todo, FrameStep);
+        switch(InBuffer.size() - c)
+        {
+        case 3: WriteGroupSSE(InBuffer.subspan(c).first<3>(), outbase+c, todo, FrameStep); break;
+        case 2: WriteGroupSSE(InBuffer.subspan(c).first<2>(), outbase+c, todo, FrameStep); break;
+        case 1: WriteGroupSSE(InBuffer.subspan(c).first<1>(), outbase+c, todo, FrameStep); break;
+        }
+    }
+    if(todo < SamplesToDo)
+        WriteChannels(InBuffer, outbase + todo*FrameStep, todo, SamplesToDo, FrameStep);
+    WriteSilence(outbase, InBuffer.size(), SamplesToDo, FrameStep);
+}
+
+
+/* Multiplies the 32-bit integers in each lane, keeping the low 32 bits. */
+inline __m128i mullo_epi32(const __m128i a, const __m128i b) noexcept
+{
+    const __m128i even{_mm_mul_epu32(a, b)};
+    const __m128i odd{_mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32))};
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+        _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+}
+
+/* Converts the low two unsigned 32-bit integers to doubles. */
+inline __m128d cvtepu32_pd(const __m128i vals) noexcept
+{
+    const __m128i bias{_mm_set1_epi32(INT_MIN)};
+    return _mm_add_pd(_mm_cvtepi32_pd(_mm_xor_si128(vals, bias)), _mm_set1_pd(2147483648.0));
+}
+
+#endif /* HAVE_SSE_INTRINSICS */
+
+} // namespace
+
+
+template<>
+void ApplyDither<CTag>(const al::span<FloatBufferLine> Samples, uint *dither_seed,
+    const float quant_scale, const size_t SamplesToDo)
+{
+    ASSUME(SamplesToDo > 0);
+
+    /* Dithering. Generate whitenoise (uniform distribution of random values
+     * between -1 and +1) and add it to the sample values, after scaling up to
+     * the desired quantization depth amd before rounding.
+     */
+    const float invscale{1.0f / quant_scale};
+    uint seed{*dither_seed};
+    auto dither_sample = [&seed,invscale,quant_scale](const float sample) noexcept -> float
+    {
+        float val{sample * quant_scale};
+        uint rng0{dither_rng(&seed)};
+        uint rng1{dither_rng(&seed)};
+        val += static_cast<float>(rng0*(1.0/UINT_MAX) - rng1*(1.0/UINT_MAX));
+        return fast_roundf(val) * invscale;
+    };
+    for(FloatBufferLine &inout : Samples)
+        std::transform(inout.begin(), inout.begin()+SamplesToDo, inout.begin(), dither_sample);
+    *dither_seed = seed;
+}
+
+template<>
+void WriteSamples<CTag>(const DevFmtType type, const al::span<const FloatBufferLine> InBuffer,
+    void *OutBuffer, const size_t Offset, const size_t SamplesToDo, const size_t FrameStep)
+{
+    switch(type)
+    {
+#define HANDLE_WRITE(T) case T:                                               \
+    Write<T>(InBuffer, OutBuffer, Offset, SamplesToDo, FrameStep); break;
+    HANDLE_WRITE(DevFmtByte)
+    HANDLE_WRITE(DevFmtUByte)
+    HANDLE_WRITE(DevFmtShort)
+    HANDLE_WRITE(DevFmtUShort)
+    HANDLE_WRITE(DevFmtInt)
+    HANDLE_WRITE(DevFmtUInt)
+    HANDLE_WRITE(DevFmtFloat)
+#undef HANDLE_WRITE
+    }
+}
+
+#ifdef HAVE_SSE_INTRINSICS
+
+template<>
+void ApplyDither<SSE2Tag>(const al::span<FloatBufferLine> Samples, uint *dither_seed,
+    const float quant_scale, const size_t SamplesToDo)
+{
+    ASSUME(SamplesToDo > 0);
+
+    /* The same as the C version, generating the random values for 4 samples
+     * at once. Each sample uses two consecutive values from the RNG, so the
+     * lanes of the first vector hold the 1st, 3rd, 5th, and 7th next values,
+     * and the second vector the 2nd, 4th, 6th, and 8th, with each lane
+     * stepping 8 values at a time. The noise is calculated in double precision
+     * like the C version, so the results are identical.
+     */
+    static constexpr auto RngStep8 = DitherRngStep<8>();
+    const __m128i rngmul{_mm_set1_epi32(static_cast<int>(RngStep8.first))};
+    const __m128i rngadd{_mm_set1_epi32(static_cast<int>(RngStep8.second))};
+    const __m128d rngscale{_mm_set1_pd(1.0/UINT_MAX)};
+    const __m128 vscale{_mm_set1_ps(quant_scale)};
+    const __m128 vinvscale{_mm_set1_ps(1.0f / quant_scale)};
+    const __m128 signmask{_mm_set1_ps(-0.0f)};
+    const __m128 ilim{_mm_set1_ps(8388608.0f)};
+
+    const size_t todo{SamplesToDo & ~size_t{3}};
+    const float invscale{1.0f / quant_scale};
+    uint seed{*dither_seed};
+    for(FloatBufferLine &inout : Samples)
+    {
+        if(todo > 0)
+        {
+            alignas(16) uint rngs[8];
+            for(uint &rng : rngs)
+                rng = dither_rng(&seed);
+            __m128i rng0{_mm_setr_epi32(static_cast<int>(rngs[0]), static_cast<int>(rngs[2]),
+                static_cast<int>(rngs[4]), static_cast<int>(rngs[6]))};
+            __m128i rng1{_mm_setr_epi32(static_cast<int>(rngs[1]), static_cast<int>(rngs[3]),
+                static_cast<int>(rngs[5]), static_cast<int>(rngs[7]))};
+
+            for(size_t i{0};i < todo;i+=4)
+            {
+                const __m128d noiselo{_mm_sub_pd(_mm_mul_pd(cvtepu32_pd(rng0), rngscale),
+                    _mm_mul_pd(cvtepu32_pd(rng1), rngscale))};
+                const __m128d noisehi{_mm_sub_pd(
+                    _mm_mul_pd(cvtepu32_pd(_mm_unpackhi_epi64(rng0, rng0)), rngscale),
+                    _mm_mul_pd(cvtepu32_pd(_mm_unpackhi_epi64(rng1, rng1)), rngscale))};
+                const __m128 noise{_mm_movelh_ps(_mm_cvtpd_ps(noiselo), _mm_cvtpd_ps(noisehi))};
+
+                __m128 val{_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&inout[i]), vscale), noise)};
+
+                /* Round like fast_roundf, adding and removing the integral
+                 * limit (with a matching sign) for values that have a
+                 * fractional part.
+                 */
+                const __m128 lim{_mm_or_ps(_mm_and_ps(val, signmask), ilim)};
+                const __m128 rounded{_mm_sub_ps(_mm_add_ps(val, lim), lim)};
+                const __m128 integral{_mm_cmpge_ps(_mm_andnot_ps(signmask, val), ilim)};
+                val = _mm_or_ps(_mm_and_ps(integral, val), _mm_andnot_ps(integral, rounded));
+
+                _mm_storeu_ps(&inout[i], _mm_mul_ps(val, vinvscale));
+
+                if(i+4 < todo)
+                {
+                    rng0 = _mm_add_epi32(mullo_epi32(rng0, rngmul), rngadd);
+                    rng1 = _mm_add_epi32(mullo_epi32(rng1, rngmul), rngadd);
+                }
+            }
+            seed = static_cast<uint>(_mm_cvtsi128_si32(_mm_shuffle_epi32(rng1,
+                _MM_SHUFFLE(3,3,3,3))));
+        }
+
+        for(size_t i{todo};i < SamplesToDo;++i)
+        {
+            float val{inout[i] * quant_scale};
+            uint rng0{dither_rng(&seed)};
+            uint rng1{dither_rng(&seed)};
+            val += static_cast<float>(rng0*(1.0/UINT_MAX) - rng1*(1.0/UINT_MAX));
+            inout[i] = fast_roundf(val) * invscale;
+        }
+    }
+    *dither_seed = seed;
+}
+
+template<>
+void WriteSamples<SSE2Tag>(const DevFmtType type, const al::span<const FloatBufferLine> InBuffer,
+    void *OutBuffer, const size_t Offset, const size_t SamplesToDo, const size_t FrameStep)
+{
+    switch(type)
+    {
+    case DevFmtShort: WriteSSE<DevFmtShort>(InBuffer, OutBuffer, Offset, SamplesToDo, FrameStep);
+        break;
+    case DevFmtInt: WriteSSE<DevFmtInt>(InBuffer, OutBuffer, Offset, SamplesToDo, FrameStep);
+        break;
+    case DevFmtFloat: WriteSSE<DevFmtFloat>(InBuffer, OutBuffer, Offset, SamplesToDo, FrameStep);
+        break;
+    default:
+        WriteSamples<CTag>(type, InBuffer, OutBuffer, Offset, SamplesToDo, FrameStep);
+        break;
+    }
+}
+
+#endif /* HAVE_SSE_INTRINSICS */
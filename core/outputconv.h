@@ -0,0 +1,62 @@
+#ifndef CORE_OUTPUTCONV_H
+#define CORE_OUTPUTCONV_H
+
+#include <stddef.h>
+#include <utility>
+
+#include "alspan.h"
+#include "bufferline.h"
+#include "devformat.h"
+
+using uint = unsigned int;
+
+struct CTag;
+struct SSE2Tag;
+struct AVX2Tag;
+
+
+constexpr uint DitherRngMul{96314165u};
+constexpr uint DitherRngAdd{907633515u};
+
+/* This RNG method was created based on the math found in opusdec. It's quick,
+ * and starting with a seed value of 22222, is suitable for generating
+ * whitenoise.
+ */
+inline uint dither_rng(uint *seed) noexcept
+{
+    *seed = (*seed * DitherRngMul) + DitherRngAdd;
+    return *seed;
+}
+
+/* The RNG's multiplier and increment for advancing N steps at once, for
+ * vectorized versions that run a sequence in each lane.
+ */
+template<size_t N>
+constexpr std::pair<uint,uint> DitherRngStep() noexcept
+{
+    uint mul{1u}, add{0u};
+    for(size_t i{0};i < N;++i)
+    {
+        mul *= DitherRngMul;
+        add = add*DitherRngMul + DitherRngAdd;
+    }
+    return {mul, add};
+}
+
+
+/* Dithers the samples to the given quantization scale, with white noise from
+ * the seeded RNG.
+ */
+template<typename InstTag>
+void ApplyDither(const al::span<FloatBufferLine> Samples, uint *dither_seed,
+    const float quant_scale, const size_t SamplesToDo);
+
+/* Converts and interleaves the samples of each channel into the output
+ * buffer, starting at the given frame offset. Output channels past the input
+ * channels (up to the frame step) are silenced.
+ */
+template<typename InstTag>
+void WriteSamples(const DevFmtType type, const al::span<const FloatBufferLine> InBuffer,
+    void *OutBuffer, const size_t Offset, const size_t SamplesToDo, const size_t FrameStep);
+
+#endif /* CORE_OUTPUTCONV_H */
@@ -0,0 +1,256 @@
+#include "config.h"
+
+#include <immintrin.h>
+
+#include <climits>
+#include <stdint.h>
+#include <type_traits>
+
+#include "alnumeric.h"
+#include "opthelpers.h"
+#include "outputconv.h"
+
+
+/* Only AVX2 is enabled, not FMA, so the compiler can't fuse the separate
+ * multiplies and adds and the results stay identical to the other versions.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__AVX2__)
+#pragma GCC target("avx2")
+#elif defined(__clang__) && !defined(__AVX2__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to=function)
+#define AVX2_CLANG_ATTRIBUTE_PUSHED
+#endif
+
+namespace {
+
+/* Scales, clamps, and rounds 8 samples to integers, like SampleConv. */
+inline __m256i cvt8_epi32(const __m256 vals) noexcept
+{
+    const __m256 scaled{_mm256_mul_ps(vals, _mm256_set1_ps(2147483648.0f))};
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(scaled,
+        _mm256_set1_ps(-2147483648.0f)), _mm256_set1_ps(2147483520.0f)));
+}
+/* The same, for 16-bit integers, leaving them in 32-bit lanes. */
+inline __m256i cvt8_epi16_range(const __m256 vals) noexcept
+{
+    const __m256 scaled{_mm256_mul_ps(vals, _mm256_set1_ps(32768.0f))};
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(scaled, _mm256_set1_ps(-32768.0f)),
+        _mm256_set1_ps(32767.0f)));
+}
+
+template<typename T>
+inline T SampleConv(float) noexcept;
+
+template<> inline float SampleConv(float val) noexcept
+{ return val; }
+template<> inline int32_t SampleConv(float val) noexcept
+{ return fastf2i(clampf(val*2147483648.0f, -2147483648.0f, 2147483520.0f)); }
+template<> inline int16_t SampleConv(float val) noexcept
+{ return static_cast<int16_t>(fastf2i(clampf(val*32768.0f, -32768.0f, 32767.0f))); }
+
+/* Converts and stores 8 samples. */
+inline void Store8(float *dst, const __m256 vals) noexcept
+{ _mm256_storeu_ps(dst, vals); }
+inline void Store8(int32_t *dst, const __m256 vals) noexcept
+{ _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), cvt8_epi32(vals)); }
+inline void Store8(int16_t *dst, const __m256 vals) noexcept
+{
+    const __m256i ivals{cvt8_epi16_range(vals)};
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+        _mm_packs_epi32(_mm256_castsi256_si128(ivals), _mm256_extracti128_si256(ivals, 1)));
+}
+
+
+template<typename T>
+void WriteMono(const FloatBufferLine &InBuffer, T *out, const size_t SamplesToDo)
+{
+    const float *in{InBuffer.data()};
+    size_t i{0};
+    for(;SamplesToDo-i >= 8;i += 8)
+        Store8(out+i, _mm256_loadu_ps(in+i));
+    for(;i < SamplesToDo;++i)
+        out[i] = SampleConv<T>(in[i]);
+}
+
+/* Interleaves 8 frames of the two channels at a time. Unpacking the channels
+ * gives frames 0-1 and 4-5 in the first vector and 2-3 and 6-7 in the second,
+ * which the int16 packing (done per 128-bit lane) puts back in order. The
+ * others need the middle halves swapped.
+ */
+template<typename T>
+void WriteStereo(const FloatBufferLine &InLeft, const FloatBufferLine &InRight, T *out,
+    const size_t SamplesToDo)
+{
+    const float *left{InLeft.data()};
+    const float *right{InRight.data()};
+    size_t i{0};
+    for(;SamplesToDo-i >= 8;i += 8)
+    {
+        const __m256 l8{_mm256_loadu_ps(left+i)};
+        const __m256 r8{_mm256_loadu_ps(right+i)};
+        const __m256 lo{_mm256_unpacklo_ps(l8, r8)};
+        const __m256 hi{_mm256_unpackhi_ps(l8, r8)};
+        if constexpr(std::is_same_v<T,int16_t>)
+        {
+            const __m256i svals{_mm256_packs_epi32(cvt8_epi16_range(lo),
+                cvt8_epi16_range(hi))};
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i*2), svals);
+        }
+        else
+        {
+            Store8(out + i*2, _mm256_permute2f128_ps(lo, hi, 0x20));
+            Store8(out + i*2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+    }
+    for(;i < SamplesToDo;++i)
+    {
+        out[i*2 + 0] = SampleConv<T>(left[i]);
+        out[i*2 + 1] = SampleConv<T>(right[i]);
+    }
+}
+
+template<DevFmtType T>
+bool WriteAVX2(const al::span<const FloatBufferLine> InBuffer, void *OutBuffer,
+    const size_t Offset, const size_t SamplesToDo, const size_t FrameStep)
+{
+    using SampleType = DevFmtType_t<T>;
+    SampleType *outbase{static_cast<SampleType*>(OutBuffer) + Offset*FrameStep};
+
+    if(InBuffer.size() == 1 && FrameStep == 1)
+    {
+        WriteMono(InBuffer[0], outbase, SamplesToDo);
+        return true;
+    }
+    if(InBuffer.size() == 2 && FrameStep == 2)
+    {
+        WriteStereo(InBuffer[0], InBuffer[1], outbase, SamplesToDo);
+        return true;
+    }
+    return false;
+}
+
+
+/* Converts the four unsigned 32-bit integers to doubles. */
+inline __m256d cvtepu32_pd(const __m128i vals) noexcept
+{
+    const __m128i bias{_mm_set1_epi32(INT_MIN)};
+    return _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(vals, bias)),
+        _mm256_set1_pd(2147483648.0));
+}
+
+} // namespace
+
+
+template<>
+void ApplyDither<AVX2Tag>(const al::span<FloatBufferLine> Samples, uint *dither_seed,
+    const float quant_scale, const size_t SamplesToDo)
+{
+    ASSUME(SamplesToDo > 0);
+
+    /* The same as the SSE2 version, with 8 lanes that each step the RNG 16
+     * values at a time.
+     */
+    static constexpr auto RngStep16 = DitherRngStep<16>();
+    const __m256i rngmul{_mm256_set1_epi32(static_cast<int>(RngStep16.first))};
+    const __m256i rngadd{_mm256_set1_epi32(static_cast<int>(RngStep16.second))};
+    const __m256d rngscale{_mm256_set1_pd(1.0/UINT_MAX)};
+    const __m256 vscale{_mm256_set1_ps(quant_scale)};
+    const __m256 vinvscale{_mm256_set1_ps(1.0f / quant_scale)};
+    const __m256 signmask{_mm256_set1_ps(-0.0f)};
+    const __m256 ilim{_mm256_set1_ps(8388608.0f)};
+
+    const size_t todo{SamplesToDo & ~size_t{7}};
+    const float invscale{1.0f / quant_scale};
+    uint seed{*dither_seed};
+    for(FloatBufferLine &inout : Samples)
+    {
+        if(todo > 0)
+        {
+            alignas(32) int rngs[16];
+            for(int &rng : rngs)
+                rng = static_cast<int>(dither_rng(&seed));
+            __m256i rng0{_mm256_setr_epi32(rngs[0], rngs[2], rngs[4], rngs[6], rngs[8],
+                rngs[10], rngs[12], rngs[14])};
+            __m256i rng1{_mm256_setr_epi32(rngs[1], rngs[3], rngs[5], rngs[7], rngs[9],
+                rngs[11], rngs[13], rngs[15])};
+
+            for(size_t i{0};i < todo;i+=8)
+            {
+                const __m256d noiselo{_mm256_sub_pd(
+                    _mm256_mul_pd(cvtepu32_pd(_mm256_castsi256_si128(rng0)), rngscale),
+                    _mm256_mul_pd(cvtepu32_pd(_mm256_castsi256_si128(rng1)), rngscale))};
+                const __m256d noisehi{_mm256_sub_pd(
+                    _mm256_mul_pd(cvtepu32_pd(_mm256_extracti128_si256(rng0, 1)), rngscale),
+                    _mm256_mul_pd(cvtepu32_pd(_mm256_extracti128_si256(rng1, 1)), rngscale))};
+                const __m256 noise{_mm256_insertf128_ps(
+                    _mm256_castps128_ps256(_mm256_cvtpd_ps(noiselo)), _mm256_cvtpd_ps(noisehi),
+                    1)};
+
+                __m256 val{_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&inout[i]), vscale),
+                    noise)};
+
+                const __m256 lim{_mm256_or_ps(_mm256_and_ps(val, signmask), ilim)};
+                const __m256 rounded{_mm256_sub_ps(_mm256_add_ps(val, lim), lim)};
+                const __m256 integral{_mm256_cmp_ps(_mm256_andnot_ps(signmask, val), ilim,
+                    _CMP_GE_OQ)};
+                val = _mm256_blendv_ps(rounded, val, integral);
+
+                _mm256_storeu_ps(&inout[i], _mm256_mul_ps(val, vinvscale));
+
+                if(i+8 < todo)
+                {
+                    rng0 = _mm256_add_epi32(_mm256_mullo_epi32(rng0, rngmul), rngadd);
+                    rng1 = _mm256_add_epi32(_mm256_mullo_epi32(rng1, rngmul), rngadd);
+                }
+            }
+            seed = static_cast<uint>(_mm_extract_epi32(_mm256_extracti128_si256(rng1, 1), 3));
+        }
+
+        for(size_t i{todo};i < SamplesToDo;++i)
+        {
+            float val{inout[i] * quant_scale};
+            uint rng0{dither_rng(&seed)};
+            uint rng1{dither_rng(&seed)};
+            val += static_cast<float>(rng0*(1.0/UINT_MAX) - rng1*(1.0/UINT_MAX));
+            inout[i] = fast_roundf(val) * invscale;
+        }
+    }
+    *dither_seed = seed;
+}
+
+template<>
+void WriteSamples<AVX2Tag>(const DevFmtType type, const al::span<const FloatBufferLine> InBuffer,
+    void *OutBuffer, const size_t Offset, const size_t SamplesToDo, const size_t FrameStep)
+{
+    /* Packed mono and stereo output can be written with full vectors. Other
+     * layouts go through the SSE2 version, which interleaves up to four
+     * channels at a time.
+     */
+    bool done{false};
+    switch(type)
+    {
+    case DevFmtShort:
+        done = WriteAVX2<DevFmtShort>(InBuffer, OutBuffer, Offset, SamplesToDo, FrameStep);
+        break;
+    case DevFmtInt:
+        done = WriteAVX2<DevFmtInt>(InBuffer, OutBuffer, Offset, SamplesToDo, FrameStep);
+        break;
+    case DevFmtFloat:
+        done = WriteAVX2<DevFmtFloat>(InBuffer, OutBuffer, Offset, SamplesToDo, FrameStep);
+        break;
+    default:
+        break;
+    }
+    if(done)
+        return;
+#ifdef HAVE_SSE_INTRINSICS
+    WriteSamples<SSE2Tag>(type, InBuffer, OutBuffer, Offset, SamplesToDo, FrameStep);
+#else
+    WriteSamples<CTag>(type, InBuffer, OutBuffer, Offset, SamplesToDo, FrameStep);
+#endif
+}
+
+#ifdef AVX2_CLANG_ATTRIBUTE_PUSHED
+#pragma clang attribute pop
+#undef AVX2_CLANG_ATTRIBUTE_PUSHED
+#endif
@@ -0,0 +1,184 @@
+#ifndef CORE_PROPS_POOL_H
+#define CORE_PROPS_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "atomic.h"
+#include "memory_stats.h"
+#include "opthelpers.h"
+
+
+/* A pool of property containers, allocated in clusters and recycled through an
+ * atomic free list. The mixer returns containers to the list as it's done with
+ * them, which can happen at any time. Getting containers from the list,
+ * trimming, and checking how many are free must be serialized by the caller.
+ */
+template<typename T, size_t ClusterSize>
+class PropsPool {
+    static_assert(ClusterSize > 0, "Invalid cluster size");
+
+    using Cluster = std::unique_ptr<T[]>;
+
+    std::atomic<T*> mFreeList{nullptr};
+    std::vector<Cluster> mClusters;
+
+    std::shared_ptr<MemoryStats> mStats;
+    MemoryUsage mMemory;
+
+    void updateMemory() noexcept
+    {
+        if(mStats)
+            mMemory.set(mStats, MemCategory::Properties, allocCount()*sizeof(T));
+    }
+
+    void pushList(T *first, T *last) noexcept
+    {
+        T *oldhead{mFreeList.load(std::memory_order_acquire)};
+        do {
+            last->next.store(oldhead, std::memory_order_relaxed);
+        } while(mFreeList.compare_exchange_weak(oldhead, first, std::memory_order_acq_rel,
+            std::memory_order_acquire) == false);
+    }
+
+    void alloc()
+    {
+        Cluster cluster{std::make_unique<T[]>(ClusterSize)};
+        for(size_t i{1};i < ClusterSize;++i)
+            cluster[i-1].next.store(std::addressof(cluster[i]), std::memory_order_relaxed);
+        T *first{cluster.get()};
+        T *last{std::addressof(cluster[ClusterSize-1])};
+        mClusters.emplace_back(std::move(cluster));
+        pushList(first, last);
+        updateMemory();
+    }
+
+    size_t clusterIndexOf(const T *item) const noexcept
+    {
+        auto iter = std::find_if(mClusters.cbegin(), mClusters.cend(),
+            [item](const Cluster &cluster) noexcept -> bool
+            { return item >= cluster.get() && item < cluster.get()+ClusterSize; });
+        return static_cast<size_t>(std::distance(mClusters.cbegin(), iter));
+    }
+
+public:
+    PropsPool() = default;
+    PropsPool(const PropsPool&) = delete;
+    ~PropsPool();
+    PropsPool& operator=(const PropsPool&) = delete;
+
+    /** Gets an unused container, allocating more as needed. */
+    T *get()
+    {
+        T *item{mFreeList.load(std::memory_order_acquire)};
+        if(!item) UNLIKELY
+        {
+            alloc();
+            item = mFreeList.load(std::memory_order_acquire);
+        }
+        T *next;
+        do {
+            next = item->next.load(std::memory_order_relaxed);
+        } while(mFreeList.compare_exchange_weak(item, next, std::memory_order_acq_rel,
+            std::memory_order_acquire) == false);
+        return item;
+    }
+
+    /** Counts the pool's allocations in the given stats from now on. */
+    void trackMemory(std::shared_ptr<MemoryStats> stats) noexcept
+    {
+        mStats = std::move(stats);
+        updateMemory();
+    }
+
+    /** Allocates clusters until at least count containers are allocated. */
+    void reserve(size_t count)
+    {
+        while(allocCount() < count)
+            alloc();
+    }
+
+    /** Returns a container to the free list. Safe to call from any thread. */
+    void put(T *item) noexcept { AtomicReplaceHead(mFreeList, item); }
+
+    /** The head of the free list, for walking the unused containers. */
+    T *peekFree() const noexcept { return mFreeList.load(std::memory_order_acquire); }
+
+    /** The total number of containers allocated. */
+    size_t allocCount() const noexcept { return mClusters.size() * ClusterSize; }
+
+    /** The number of containers sitting on the free list. */
+    size_t freeCount() const noexcept
+    {
+        size_t count{0};
+        for(T *item{peekFree()};item;item = item->next.load(std::memory_order_relaxed))
+            ++count;
+        return count;
+    }
+
+    /**
+     * Frees the clusters that don't have any containers in use, returning the
+     * number of containers freed.
+     */
+    size_t trim()
+    {
+        /* Take the whole free list so nothing on it can be used while checking
+         * which clusters are completely unused. Containers the mixer returns in
+         * the mean time go onto a new list, and keep their cluster alive.
+         */
+        T *head{mFreeList.exchange(nullptr, std::memory_order_acquire)};
+
+        std::vector<size_t> freecounts(mClusters.size(), 0);
+        for(T *item{head};item;item = item->next.load(std::memory_order_relaxed))
+            ++freecounts[clusterIndexOf(item)];
+
+        /* Rebuild the list with the containers from clusters being kept. */
+        T *first{nullptr}, *last{nullptr};
+        while(T *item{head})
+        {
+            head = item->next.load(std::memory_order_relaxed);
+            if(freecounts[clusterIndexOf(item)] == ClusterSize)
+                continue;
+            item->next.store(first, std::memory_order_relaxed);
+            if(!last) last = item;
+            first = item;
+        }
+
+        size_t numfreed{0};
+        for(size_t i{freecounts.size()};i > 0;)
+        {
+            --i;
+            if(freecounts[i] != ClusterSize)
+                continue;
+            mClusters.erase(mClusters.begin() + static_cast<ptrdiff_t>(i));
+            numfreed += ClusterSize;
+        }
+
+        if(first)
+            pushList(first, last);
+        updateMemory();
+        return numfreed;
+    }
+
+    /**
+     * Frees all containers. Nothing may be using them, or return them to the
+     * pool afterward.
+     */
+    void clear() noexcept
+    {
+        mFreeList.store(nullptr, std::memory_order_relaxed);
+        mClusters.clear();
+        updateMemory();
+    }
+};
+
+/* Not inline, as it's only needed when destroying the owner or unwinding its
+ * construction.
+ */
+template<typename T, size_t ClusterSize>
+PropsPool<T,ClusterSize>::~PropsPool() = default;
+
+#endif /* CORE_PROPS_POOL_H */
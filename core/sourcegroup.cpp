@@ -0,0 +1,14 @@
+#include "config.h"
+
+#include "sourcegroup.h"
+
+#include <stddef.h>
+
+#include "almalloc.h"
+
+
+SourceGroupArray *SourceGroup::CreatePtrArray(size_t count) noexcept
+{
+    void *ptr{al_calloc(alignof(SourceGroupArray), SourceGroupArray::Sizeof(count))};
+    return al::construct_at(static_cast<SourceGroupArray*>(ptr), count);
+}
@@ -0,0 +1,96 @@
+#ifndef CORE_SOURCEGROUP_H
+#define CORE_SOURCEGROUP_H
+
+#include <array>
+#include <atomic>
+
+#include "almalloc.h"
+#include "alspan.h"
+#include "device.h"
+#include "filters/biquad.h"
+#include "memory_stats.h"
+#include "voice.h"
+
+struct EffectSlot;
+struct SourceGroup;
+
+using SourceGroupArray = al::FlexArray<SourceGroup*>;
+
+
+struct SourceGroupProps {
+    float Gain;
+
+    /** Direct filter and auxiliary send info. */
+    struct {
+        float Gain;
+        float GainHF;
+        float HFReference;
+        float GainLF;
+        float LFReference;
+    } Direct;
+    struct SendData {
+        EffectSlot *Slot;
+        float Gain;
+        float GainHF;
+        float HFReference;
+        float GainLF;
+        float LFReference;
+    } Send[MAX_SENDS];
+
+    std::atomic<SourceGroupProps*> next;
+
+    DEF_NEWDEL(SourceGroupProps)
+};
+
+
+/* A submix bus for a set of sources. Member voices pan to the group's buffer
+ * instead of the dry mix, and the group applies its gain and filters once for
+ * them all, mixing the result to the dry mix and its effect slot sends.
+ */
+struct SourceGroup {
+    bool InUse{false};
+
+    std::atomic<SourceGroupProps*> Update{nullptr};
+
+    /* The members' submix, in ACN channel order with N3D scaling like an
+     * effect slot's wet buffer.
+     */
+    MixParams Wet;
+
+    /* Mixing buffer used by the Wet mix, with a copy for each mixing thread
+     * directly after the first.
+     */
+    al::page_buffer mWetBufferStorage;
+    al::span<FloatBufferLine> mWetBuffer;
+    MemoryUsage mWetBufferMemory;
+
+    struct ChannelParams {
+        BiquadFilter LowPass;
+        BiquadFilter HighPass;
+
+        uint Target{InvalidChannelIndex};
+        float Current{0.0f};
+        float Gain{0.0f};
+    };
+    /* The dry mix output (index 0) and the send outputs. A send without an
+     * effect slot has no output.
+     */
+    struct OutputParams {
+        EffectSlot *Slot{nullptr};
+        int FilterType{0};
+        std::array<ChannelParams,MaxAmbiChannels> Chans{};
+    };
+    std::array<OutputParams,1+MAX_SENDS> mOutputs{};
+
+    /* Set when the group's buffer was silent for the last update, so its
+     * filter history was cleared and output gains don't need to fade.
+     */
+    bool mSilent{true};
+
+
+    static SourceGroupArray *CreatePtrArray(size_t count) noexcept;
+
+    DEF_NEWDEL(SourceGroup)
+};
+
+#endif /* CORE_SOURCEGROUP_H */
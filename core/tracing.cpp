@@ -0,0 +1,167 @@
+
+#include "config.h"
+
+#include "tracing.h"
+
+#ifdef ALSOFT_TRACING
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "logging.h"
+#include "opthelpers.h"
+#include "strutils.h"
+
+
+namespace {
+
+using std::chrono::steady_clock;
+using std::chrono::nanoseconds;
+using std::chrono::duration_cast;
+
+struct TraceEvent {
+    const char *mName;
+    const char *mArgName;
+    int64_t mArg;
+    int64_t mStart;
+    int64_t mDuration;
+};
+
+/* The events recorded by one thread. Only the owning thread writes to it,
+ * keeping the most recent events and overwriting the oldest once it's full.
+ */
+struct ThreadTrace {
+    static constexpr size_t sCapacity{1u << 15};
+
+    std::array<TraceEvent,sCapacity> mEvents{};
+    std::atomic<size_t> mCount{0u};
+    unsigned int mThreadId{};
+};
+
+#ifdef _WIN32
+using TraceFileName = std::optional<std::wstring>;
+const TraceFileName gTraceFile{al::getenv(L"ALSOFT_TRACE_FILE")};
+#else
+using TraceFileName = std::optional<std::string>;
+const TraceFileName gTraceFile{al::getenv("ALSOFT_TRACE_FILE")};
+#endif
+const bool gTraceEnabled{gTraceFile.has_value()};
+const auto gTraceEpoch = steady_clock::now();
+
+/* The thread traces are deliberately never freed, since threads may still be
+ * recording while the library unloads.
+ */
+std::mutex gTraceLock;
+std::vector<ThreadTrace*> gThreadTraces;
+
+thread_local ThreadTrace *tThreadTrace{};
+
+inline int64_t GetTraceTime() noexcept
+{ return duration_cast<nanoseconds>(steady_clock::now() - gTraceEpoch).count(); }
+
+ThreadTrace *GetThreadTrace() noexcept
+{
+    if(ThreadTrace *trace{tThreadTrace}) LIKELY
+        return trace;
+
+    try {
+        std::lock_guard<std::mutex> _{gTraceLock};
+        gThreadTraces.reserve(gThreadTraces.size()+1);
+        auto *trace = new ThreadTrace{};
+        trace->mThreadId = static_cast<unsigned int>(gThreadTraces.size() + 1);
+        gThreadTraces.emplace_back(trace);
+        tThreadTrace = trace;
+    }
+    catch(...) {
+        return nullptr;
+    }
+    return tThreadTrace;
+}
+
+void WriteEvent(FILE *file, const TraceEvent &evt, const unsigned int tid, bool &first)
+{
+    fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+        "\"dur\":%.3f", first ? "" : ",", evt.mName, tid, static_cast<double>(evt.mStart)/1000.0,
+        static_cast<double>(evt.mDuration)/1000.0);
+    if(evt.mArgName)
+        fprintf(file, ",\"args\":{\"%s\":%" PRId64 "}", evt.mArgName, evt.mArg);
+    fputs("}", file);
+    first = false;
+}
+
+struct TraceWriter {
+    ~TraceWriter()
+    {
+        if(!gTraceEnabled)
+            return;
+
+#ifdef _WIN32
+        FILE *file{_wfopen(gTraceFile->c_str(), L"wt")};
+#else
+        FILE *file{fopen(gTraceFile->c_str(), "wt")};
+#endif
+        if(!file)
+        {
+            ERR("Failed to open trace file\n");
+            return;
+        }
+
+        std::lock_guard<std::mutex> _{gTraceLock};
+        fputs("{\"traceEvents\":[", file);
+        bool first{true};
+        for(const ThreadTrace *trace : gThreadTraces)
+        {
+            fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                "\"args\":{\"name\":\"Thread %u\"}}", first ? "" : ",", trace->mThreadId,
+                trace->mThreadId);
+            first = false;
+
+            const size_t count{trace->mCount.load(std::memory_order_acquire)};
+            const size_t start{(count > ThreadTrace::sCapacity) ? count-ThreadTrace::sCapacity
+                : 0u};
+            for(size_t i{start};i < count;++i)
+                WriteEvent(file, trace->mEvents[i%ThreadTrace::sCapacity], trace->mThreadId,
+                    first);
+        }
+        fputs("\n],\"displayTimeUnit\":\"ns\"}\n", file);
+        fclose(file);
+    }
+};
+/* Declared last, so it writes the trace before the other globals are
+ * destroyed.
+ */
+TraceWriter gTraceWriter;
+
+} // namespace
+
+
+al::trace::Scope::Scope(const char *name, const char *argname, int64_t arg) noexcept
+    : mName{name}, mArgName{argname}, mArg{arg}, mStart{-1}
+{
+    if(gTraceEnabled) UNLIKELY
+        mStart = GetTraceTime();
+}
+
+al::trace::Scope::~Scope()
+{
+    if(mStart < 0) LIKELY
+        return;
+
+    const int64_t endtime{GetTraceTime()};
+    if(ThreadTrace *trace{GetThreadTrace()})
+    {
+        const size_t count{trace->mCount.load(std::memory_order_relaxed)};
+        trace->mEvents[count%ThreadTrace::sCapacity] = TraceEvent{mName, mArgName, mArg, mStart,
+            endtime-mStart};
+        trace->mCount.store(count+1, std::memory_order_release);
+    }
+}
+
+#endif /* ALSOFT_TRACING */
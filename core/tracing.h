@@ -0,0 +1,50 @@
+#ifndef CORE_TRACING_H
+#define CORE_TRACING_H
+
+/* Optional timeline tracing, enabled with the ALSOFT_TRACING CMake option.
+ * Scoped markers record their start time and duration to a buffer owned by
+ * the calling thread, without locking or allocating (aside from the first
+ * marker on a thread). When the library unloads, the recorded events are
+ * written to the file named by the ALSOFT_TRACE_FILE environment variable, as
+ * Chrome trace event JSON (which Perfetto can also load).
+ *
+ * Without ALSOFT_TRACING, the markers compile to nothing.
+ */
+
+#ifdef ALSOFT_TRACING
+
+#include <cstdint>
+
+namespace al::trace {
+
+class Scope {
+    const char *mName;
+    const char *mArgName;
+    int64_t mArg;
+    int64_t mStart;
+
+public:
+    /* The name and argument name must be string literals (or otherwise stay
+     * valid until the trace is written).
+     */
+    explicit Scope(const char *name, const char *argname=nullptr, int64_t arg=0) noexcept;
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+};
+
+} // namespace al::trace
+
+#define TIMELINE_CONCAT2(a, b) a##b
+#define TIMELINE_CONCAT(a, b) TIMELINE_CONCAT2(a, b)
+#define TIMELINE_SCOPE(...)                                                   \
+    const al::trace::Scope TIMELINE_CONCAT(timeline_scope_, __LINE__){__VA_ARGS__}
+
+#else
+
+#define TIMELINE_SCOPE(...) static_cast<void>(0)
+
+#endif /* ALSOFT_TRACING */
+
+#endif /* CORE_TRACING_H */
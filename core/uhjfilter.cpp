@@ -4,7 +4,16 @@
 #include "uhjfilter.h"
 
 #include <algorithm>
+#include <complex>
+#include <functional>
 #include <iterator>
+#include <memory>
+
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "alcomplex.h"
 #include "alnumeric.h"
@@ -14,6 +23,8 @@
 
 UhjQualityType UhjDecodeQuality{UhjQualityType::Default};
 UhjQualityType UhjEncodeQuality{UhjQualityType::Default};
+std::optional<bool> UhjFirFft;
+bool UhjStereoShared{false};
 
 
 namespace {
@@ -21,12 +32,36 @@ namespace {
 const PhaseShifterT<UhjLength256> PShiftLq{};
 const PhaseShifterT<UhjLength512> PShiftHq{};
 
+/* The FFT plans (and their twiddle factors) and filter responses are shared
+ * by all encoders and decoders of the same filter length.
+ */
+const PhaseShifterFftT<UhjLength256> PShiftFftLq{PShiftLq, BufferLineSize};
+const PhaseShifterFftT<UhjLength512> PShiftFftHq{PShiftHq, BufferLineSize};
+
 template<size_t N>
 struct GetPhaseShifter;
 template<>
-struct GetPhaseShifter<UhjLength256> { static auto& Get() noexcept { return PShiftLq; } };
+struct GetPhaseShifter<UhjLength256> {
+    static auto& Get() noexcept { return PShiftLq; }
+    static auto& GetFft() noexcept { return PShiftFftLq; }
+};
 template<>
-struct GetPhaseShifter<UhjLength512> { static auto& Get() noexcept { return PShiftHq; } };
+struct GetPhaseShifter<UhjLength512> {
+    static auto& Get() noexcept { return PShiftHq; }
+    static auto& GetFft() noexcept { return PShiftFftHq; }
+};
+
+/* Applies the phase-shift for the given filter length, with either the direct
+ * FIR filter or FFT convolution.
+ */
+template<size_t N>
+void ApplyPhaseShift(const bool usefft, const al::span<float> dst, const float *RESTRICT src)
+{
+    if(usefft)
+        GetPhaseShifter<N>::GetFft().process(dst, src);
+    else
+        GetPhaseShifter<N>::Get().process(dst, src);
+}
 
 
 constexpr float square(float x) noexcept
@@ -55,18 +90,103 @@ void UhjAllPassFilter::process(const al::span<const float,4> coeffs,
 {
     auto state = mState;
 
-    auto proc_sample = [&state,coeffs](float x) noexcept -> float
+    auto proc_section = [&state,coeffs](const size_t i, const float x) noexcept -> float
+    {
+        const float y{x*coeffs[i] + state[i].z[0]};
+        state[i].z[0] = state[i].z[1];
+        state[i].z[1] = y*coeffs[i] - x;
+        return y;
+    };
+
+#if defined(HAVE_SSE_INTRINSICS) || defined(HAVE_NEON)
+    /* The four all-pass sections are chained, so each output sample needs to
+     * go through them serially. To process them in parallel, the sections are
+     * pipelined: section i works on the sample i steps behind the first, so
+     * each step feeds in a new sample and passes the outputs of the first
+     * three sections on to the next. The first three samples fill the
+     * pipeline and the last three drain it, which is done per-section.
+     */
+    if(src.size() > 3)
     {
+        const float s0a{proc_section(0, src[0])};
+        const float s0b{proc_section(1, s0a)};
+        const float s0c{proc_section(2, s0b)};
+        const float s1a{proc_section(0, src[1])};
+        const float s1b{proc_section(1, s1a)};
+        const float s2a{proc_section(0, src[2])};
+
+        std::array<float,4> pending;
+#ifdef HAVE_SSE_INTRINSICS
+        const __m128 coeff4{_mm_loadu_ps(coeffs.data())};
+        __m128 z0{_mm_setr_ps(state[0].z[0], state[1].z[0], state[2].z[0], state[3].z[0])};
+        __m128 z1{_mm_setr_ps(state[0].z[1], state[1].z[1], state[2].z[1], state[3].z[1])};
+        __m128 y{_mm_setr_ps(s2a, s1b, s0c, 0.0f)};
+        for(size_t i{3};i < src.size();++i)
+        {
+            /* x = {src[i], y[0], y[1], y[2]} */
+            const __m128 x{_mm_move_ss(_mm_shuffle_ps(y, y, _MM_SHUFFLE(2,1,0,0)),
+                _mm_load_ss(&src[i]))};
+            y = _mm_add_ps(_mm_mul_ps(x, coeff4), z0);
+            z0 = z1;
+            z1 = _mm_sub_ps(_mm_mul_ps(y, coeff4), x);
+            dst[i-3] = _mm_cvtss_f32(_mm_shuffle_ps(y, y, _MM_SHUFFLE(3,3,3,3)));
+        }
+        std::array<float,4> z0s, z1s;
+        _mm_storeu_ps(z0s.data(), z0);
+        _mm_storeu_ps(z1s.data(), z1);
+        _mm_storeu_ps(pending.data(), y);
+#else
+        const float32x4_t coeff4{vld1q_f32(coeffs.data())};
+        float32x4_t z0{vdupq_n_f32(0.0f)}, z1{vdupq_n_f32(0.0f)};
+        z0 = vsetq_lane_f32(state[0].z[0], z0, 0);
+        z0 = vsetq_lane_f32(state[1].z[0], z0, 1);
+        z0 = vsetq_lane_f32(state[2].z[0], z0, 2);
+        z0 = vsetq_lane_f32(state[3].z[0], z0, 3);
+        z1 = vsetq_lane_f32(state[0].z[1], z1, 0);
+        z1 = vsetq_lane_f32(state[1].z[1], z1, 1);
+        z1 = vsetq_lane_f32(state[2].z[1], z1, 2);
+        z1 = vsetq_lane_f32(state[3].z[1], z1, 3);
+        float32x4_t y{vdupq_n_f32(0.0f)};
+        y = vsetq_lane_f32(s2a, y, 0);
+        y = vsetq_lane_f32(s1b, y, 1);
+        y = vsetq_lane_f32(s0c, y, 2);
+        for(size_t i{3};i < src.size();++i)
+        {
+            /* x = {src[i], y[0], y[1], y[2]} */
+            const float32x4_t x{vextq_f32(vdupq_n_f32(src[i]), y, 3)};
+            /* Avoid fused multiply-adds to match the scalar results. */
+            y = vaddq_f32(vmulq_f32(x, coeff4), z0);
+            z0 = z1;
+            z1 = vsubq_f32(vmulq_f32(y, coeff4), x);
+            dst[i-3] = vgetq_lane_f32(y, 3);
+        }
+        std::array<float,4> z0s, z1s;
+        vst1q_f32(z0s.data(), z0);
+        vst1q_f32(z1s.data(), z1);
+        vst1q_f32(pending.data(), y);
+#endif
         for(size_t i{0};i < 4;++i)
         {
-            const float y{x*coeffs[i] + state[i].z[0]};
-            state[i].z[0] = state[i].z[1];
-            state[i].z[1] = y*coeffs[i] - x;
-            x = y;
+            state[i].z[0] = z0s[i];
+            state[i].z[1] = z1s[i];
         }
-        return x;
-    };
-    std::transform(src.begin(), src.end(), dst, proc_sample);
+
+        const size_t last{src.size() - 1};
+        dst[last-2] = proc_section(3, pending[2]);
+        dst[last-1] = proc_section(3, proc_section(2, pending[1]));
+        dst[last] = proc_section(3, proc_section(2, proc_section(1, pending[0])));
+    }
+    else
+#endif
+    {
+        auto proc_sample = [proc_section](float x) noexcept -> float
+        {
+            for(size_t i{0};i < 4;++i)
+                x = proc_section(i, x);
+            return x;
+        };
+        std::transform(src.begin(), src.end(), dst, proc_sample);
+    }
     if(updateState) LIKELY mState = state;
 }
 
@@ -92,8 +212,6 @@ template<size_t N>
 void UhjEncoder<N>::encode(float *LeftOut, float *RightOut,
     const al::span<const float*const,3> InSamples, const size_t SamplesToDo)
 {
-    const auto &PShift = GetPhaseShifter<N>::Get();
-
     ASSUME(SamplesToDo > 0);
 
     const float *RESTRICT winput{al::assume_aligned<16>(InSamples[0])};
@@ -112,7 +230,7 @@ void UhjEncoder<N>::encode(float *LeftOut, float *RightOut,
     std::transform(winput, winput+SamplesToDo, xinput, mWX.begin() + sWXInOffset,
         [](const float w, const float x) noexcept -> float
         { return -0.3420201f*w + 0.5098604f*x; });
-    PShift.process({mD.data(), SamplesToDo}, mWX.data());
+    ApplyPhaseShift<N>(mUseFft, {mD.data(), SamplesToDo}, mWX.data());
 
     /* D = j(-0.3420201*W + 0.5098604*X) + 0.6554516*Y */
     for(size_t i{0};i < SamplesToDo;++i)
@@ -240,8 +358,6 @@ void UhjDecoder<N>::decode(const al::span<float*> samples, const size_t samplesT
 {
     static_assert(sInputPadding <= sMaxPadding, "Filter padding is too large");
 
-    const auto &PShift = GetPhaseShifter<N>::Get();
-
     ASSUME(samplesToDo > 0);
 
     {
@@ -272,7 +388,7 @@ void UhjDecoder<N>::decode(const al::span<float*> samples, const size_t samplesT
         [](const float d, const float t) noexcept { return 0.828331f*d + 0.767820f*t; });
     if(updateState) LIKELY
         std::copy_n(mTemp.cbegin()+samplesToDo, mDTHistory.size(), mDTHistory.begin());
-    PShift.process({xoutput, samplesToDo}, mTemp.data());
+    ApplyPhaseShift<N>(mUseFft, {xoutput, samplesToDo}, mTemp.data());
 
     /* W = 0.981532*S + 0.197484*j(0.828331*D + 0.767820*T) */
     for(size_t i{0};i < samplesToDo;++i)
@@ -286,7 +402,7 @@ void UhjDecoder<N>::decode(const al::span<float*> samples, const size_t samplesT
     std::copy_n(mS.cbegin(), samplesToDo+sInputPadding, tmpiter);
     if(updateState) LIKELY
         std::copy_n(mTemp.cbegin()+samplesToDo, mSHistory.size(), mSHistory.begin());
-    PShift.process({youtput, samplesToDo}, mTemp.data());
+    ApplyPhaseShift<N>(mUseFft, {youtput, samplesToDo}, mTemp.data());
 
     /* Y = 0.795968*D - 0.676392*T + j(0.186633*S) */
     for(size_t i{0};i < samplesToDo;++i)
@@ -387,13 +503,11 @@ void UhjDecoderIIR::decode(const al::span<float*> samples, const size_t samplesT
  * resulting stereo width, with the range 0 <= w <= 0.7.
  */
 template<size_t N>
-void UhjStereoDecoder<N>::decode(const al::span<float*> samples, const size_t samplesToDo,
+void UhjStereoDecoder<N>::splitInput(const al::span<float*> samples, const size_t samplesToDo,
     const bool updateState)
 {
     static_assert(sInputPadding <= sMaxPadding, "Filter padding is too large");
 
-    const auto &PShift = GetPhaseShifter<N>::Get();
-
     ASSUME(samplesToDo > 0);
 
     {
@@ -428,7 +542,12 @@ void UhjStereoDecoder<N>::decode(const al::span<float*> samples, const size_t sa
             mCurrentWidth = wtarget;
         }
     }
+}
 
+template<size_t N>
+void UhjStereoDecoder<N>::applyPhaseShift(const al::span<float*> samples,
+    const size_t samplesToDo, const bool updateState)
+{
     float *RESTRICT woutput{al::assume_aligned<16>(samples[0])};
     float *RESTRICT xoutput{al::assume_aligned<16>(samples[1])};
     float *RESTRICT youtput{al::assume_aligned<16>(samples[2])};
@@ -438,7 +557,7 @@ void UhjStereoDecoder<N>::decode(const al::span<float*> samples, const size_t sa
     std::copy_n(mD.cbegin(), samplesToDo+sInputPadding, tmpiter);
     if(updateState) LIKELY
         std::copy_n(mTemp.cbegin()+samplesToDo, mDTHistory.size(), mDTHistory.begin());
-    PShift.process({xoutput, samplesToDo}, mTemp.data());
+    ApplyPhaseShift<N>(mUseFft, {xoutput, samplesToDo}, mTemp.data());
 
     /* W = 0.6098637*S - 0.6896511*j*w*D */
     for(size_t i{0};i < samplesToDo;++i)
@@ -452,13 +571,46 @@ void UhjStereoDecoder<N>::decode(const al::span<float*> samples, const size_t sa
     std::copy_n(mS.cbegin(), samplesToDo+sInputPadding, tmpiter);
     if(updateState) LIKELY
         std::copy_n(mTemp.cbegin()+samplesToDo, mSHistory.size(), mSHistory.begin());
-    PShift.process({youtput, samplesToDo}, mTemp.data());
+    ApplyPhaseShift<N>(mUseFft, {youtput, samplesToDo}, mTemp.data());
 
     /* Y = 1.6822415*w*D - 0.2156194*j*S */
     for(size_t i{0};i < samplesToDo;++i)
         youtput[i] = 1.6822415f*mD[i] - 0.2156194f*youtput[i];
 }
 
+template<size_t N>
+void UhjStereoDecoder<N>::decode(const al::span<float*> samples, const size_t samplesToDo,
+    const bool updateState)
+{
+    splitInput(samples, samplesToDo, updateState);
+    applyPhaseShift(samples, samplesToDo, updateState);
+}
+
+template<size_t N>
+void UhjStereoDecoder<N>::decodeMidSide(const al::span<float*> samples, float *mid,
+    float *side, const size_t samplesToDo, const bool updateState, const bool decodeToo)
+{
+    splitInput(samples, samplesToDo, updateState);
+    std::copy_n(mS.cbegin(), samplesToDo+sInputPadding, mid);
+    std::copy_n(mD.cbegin(), samplesToDo+sInputPadding, side);
+
+    if(decodeToo)
+        applyPhaseShift(samples, samplesToDo, updateState);
+    else if(updateState) LIKELY
+    {
+        /* Keep the history the phase shift would use, in case the voice needs
+         * to be decoded later (e.g. when a send gets added).
+         */
+        auto tmpiter = std::copy(mDTHistory.cbegin(), mDTHistory.cend(), mTemp.begin());
+        std::copy_n(mD.cbegin(), samplesToDo, tmpiter);
+        std::copy_n(mTemp.cbegin()+samplesToDo, mDTHistory.size(), mDTHistory.begin());
+
+        tmpiter = std::copy(mSHistory.cbegin(), mSHistory.cend(), mTemp.begin());
+        std::copy_n(mS.cbegin(), samplesToDo, tmpiter);
+        std::copy_n(mTemp.cbegin()+samplesToDo, mSHistory.size(), mSHistory.begin());
+    }
+}
+
 void UhjStereoDecoderIIR::decode(const al::span<float*> samples, const size_t samplesToDo,
     const bool updateState)
 {
@@ -530,10 +682,83 @@ void UhjStereoDecoderIIR::decode(const al::span<float*> samples, const size_t sa
 }
 
 
+UhjStereoBusBase::UhjStereoBusBase(const size_t numchans, const size_t numthreads,
+    const size_t padding)
+    : mBuffer(numchans*numthreads), mHead(numchans*numthreads), mNumChannels{numchans}
+    , mPadding{padding}
+{ }
+
+UhjStereoBusBase::~UhjStereoBusBase() = default;
+
+std::unique_ptr<UhjStereoBusBase> UhjStereoBusBase::Create(UhjQualityType quality,
+    const size_t numchans, const size_t numthreads)
+{
+    switch(quality)
+    {
+    case UhjQualityType::IIR:
+        break;
+    case UhjQualityType::FIR256:
+        return std::make_unique<UhjStereoBus<UhjLength256>>(numchans, numthreads);
+    case UhjQualityType::FIR512:
+        return std::make_unique<UhjStereoBus<UhjLength512>>(numchans, numthreads);
+    }
+    return nullptr;
+}
+
+template<size_t N>
+void UhjStereoBus<N>::process(const al::span<FloatBufferLine> output, const size_t samplesToDo)
+{
+    static_assert(sInputPadding <= DecoderBase::sMaxPadding, "Filter padding is too large");
+
+    const bool hasInput{mHasInput.exchange(false, std::memory_order_relaxed)};
+    if(!hasInput && !mActive)
+        return;
+
+    ASSUME(samplesToDo > 0);
+
+    const size_t numThreads{mBuffer.size() / mNumChannels};
+    bool active{false};
+    for(size_t c{0};c < mNumChannels;++c)
+    {
+        /* Gather the history and each thread's bus samples, adding the head
+         * samples to the end of the history.
+         */
+        auto tmpiter = std::copy(mHistory[c].cbegin(), mHistory[c].cend(), mTemp.begin());
+        std::fill_n(tmpiter, samplesToDo, 0.0f);
+        if(hasInput)
+        {
+            for(size_t t{0};t < numThreads;++t)
+            {
+                auto &head = mHead[t*mNumChannels + c];
+                std::transform(head.cbegin(), head.cbegin()+sInputPadding,
+                    tmpiter-sInputPadding, tmpiter-sInputPadding, std::plus<float>{});
+                std::fill_n(head.begin(), sInputPadding, 0.0f);
+
+                auto &line = mBuffer[t*mNumChannels + c];
+                std::transform(line.cbegin(), line.cbegin()+samplesToDo, tmpiter, tmpiter,
+                    std::plus<float>{});
+                std::fill_n(line.begin(), samplesToDo, 0.0f);
+            }
+        }
+        std::copy_n(mTemp.cbegin()+samplesToDo, mHistory[c].size(), mHistory[c].begin());
+
+        ApplyPhaseShift<N>(mUseFft, {mShifted.data(), samplesToDo}, mTemp.data());
+        std::transform(mShifted.cbegin(), mShifted.cbegin()+samplesToDo, output[c].cbegin(),
+            output[c].begin(), std::plus<float>{});
+
+        active |= std::any_of(mHistory[c].cbegin(), mHistory[c].cend(),
+            [](const float s) noexcept { return s != 0.0f; });
+    }
+    mActive = active;
+}
+
+
 template struct UhjEncoder<UhjLength256>;
 template struct UhjDecoder<UhjLength256>;
 template struct UhjStereoDecoder<UhjLength256>;
+template struct UhjStereoBus<UhjLength256>;
 
 template struct UhjEncoder<UhjLength512>;
 template struct UhjDecoder<UhjLength512>;
 template struct UhjStereoDecoder<UhjLength512>;
+template struct UhjStereoBus<UhjLength512>;
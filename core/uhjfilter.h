@@ -2,10 +2,14 @@
 #define CORE_UHJFILTER_H
 
 #include <array>
+#include <atomic>
+#include <memory>
+#include <optional>
 
 #include "almalloc.h"
 #include "alspan.h"
 #include "bufferline.h"
+#include "vector.h"
 
 
 static constexpr size_t UhjLength256{256};
@@ -20,6 +24,11 @@ enum class UhjQualityType : uint8_t {
 
 extern UhjQualityType UhjDecodeQuality;
 extern UhjQualityType UhjEncodeQuality;
+/* Whether the FIR encoders and decoders apply their phase-shift filter with
+ * FFT convolution instead of directly. When unset, only the 512-point filters
+ * use FFT convolution, being faster than the direct filter.
+ */
+extern std::optional<bool> UhjFirFft;
 
 
 struct UhjAllPassFilter {
@@ -68,6 +77,8 @@ struct UhjEncoder final : public UhjEncoderBase {
 
     alignas(16) std::array<std::array<float,sFilterDelay>,2> mDirectDelay{};
 
+    bool mUseFft{UhjFirFft.value_or(N >= UhjLength512)};
+
     size_t getDelay() noexcept override { return sFilterDelay; }
 
     /**
@@ -124,6 +135,22 @@ struct DecoderBase {
     virtual void decode(const al::span<float*> samples, const size_t samplesToDo,
         const bool updateState) = 0;
 
+    /** Clears the filter history, to decode a new signal. */
+    virtual void clear() noexcept = 0;
+
+    /**
+     * For Super Stereo voices mixed through a shared phase-shift stage (see
+     * UhjStereoBusBase). Writes the sum (S) and width-scaled difference (D)
+     * signals to mid and side, including the input padding. If decodeToo is
+     * true, the samples are also decoded in place as with decode, otherwise
+     * just the filter history is kept up to date. Only implemented by the FIR
+     * Super Stereo decoders.
+     */
+    virtual void decodeMidSide(const al::span<float*> /*samples*/, float* /*mid*/,
+        float* /*side*/, const size_t /*samplesToDo*/, const bool /*updateState*/,
+        const bool /*decodeToo*/)
+    { }
+
     /**
      * The width factor for Super Stereo processing. Can be changed in between
      * calls to decode, with valid values being between 0...0.7.
@@ -145,6 +172,8 @@ struct UhjDecoder final : public DecoderBase {
 
     alignas(16) std::array<float,BufferLineSize + sInputPadding*2> mTemp{};
 
+    bool mUseFft{UhjFirFft.value_or(N >= UhjLength512)};
+
     /**
      * Decodes a 3- or 4-channel UHJ signal into a B-Format signal with FuMa
      * channel ordering and UHJ scaling. For 3-channel, the 3rd channel may be
@@ -156,6 +185,13 @@ struct UhjDecoder final : public DecoderBase {
     void decode(const al::span<float*> samples, const size_t samplesToDo,
         const bool updateState) override;
 
+    void clear() noexcept override
+    {
+        mS.fill(0.0f); mD.fill(0.0f); mT.fill(0.0f);
+        mDTHistory.fill(0.0f); mSHistory.fill(0.0f);
+        mTemp.fill(0.0f);
+    }
+
     DEF_NEWDEL(UhjDecoder)
 };
 
@@ -181,6 +217,13 @@ struct UhjDecoderIIR final : public DecoderBase {
     void decode(const al::span<float*> samples, const size_t samplesToDo,
         const bool updateState) override;
 
+    void clear() noexcept override
+    {
+        mS.fill(0.0f); mD.fill(0.0f); mTemp.fill(0.0f);
+        mDelayS = mDelayDT = mDelayQ = 0.0f;
+        mFilter1S = {}; mFilter2DT = {}; mFilter1DT = {}; mFilter2S = {}; mFilter1Q = {};
+    }
+
     DEF_NEWDEL(UhjDecoderIIR)
 };
 
@@ -198,6 +241,8 @@ struct UhjStereoDecoder final : public DecoderBase {
 
     alignas(16) std::array<float,BufferLineSize + sInputPadding*2> mTemp{};
 
+    bool mUseFft{UhjFirFft.value_or(N >= UhjLength512)};
+
     /**
      * Applies Super Stereo processing on a stereo signal to create a B-Format
      * signal with FuMa channel ordering and UHJ scaling. The samples span
@@ -207,6 +252,24 @@ struct UhjStereoDecoder final : public DecoderBase {
     void decode(const al::span<float*> samples, const size_t samplesToDo,
         const bool updateState) override;
 
+    void decodeMidSide(const al::span<float*> samples, float *mid, float *side,
+        const size_t samplesToDo, const bool updateState, const bool decodeToo) override;
+
+    void clear() noexcept override
+    {
+        mCurrentWidth = -1.0f;
+        mS.fill(0.0f); mD.fill(0.0f);
+        mDTHistory.fill(0.0f); mSHistory.fill(0.0f);
+        mTemp.fill(0.0f);
+    }
+
+private:
+    void splitInput(const al::span<float*> samples, const size_t samplesToDo,
+        const bool updateState);
+    void applyPhaseShift(const al::span<float*> samples, const size_t samplesToDo,
+        const bool updateState);
+
+public:
     DEF_NEWDEL(UhjStereoDecoder)
 };
 
@@ -228,7 +291,76 @@ struct UhjStereoDecoderIIR final : public DecoderBase {
     void decode(const al::span<float*> samples, const size_t samplesToDo,
         const bool updateState) override;
 
+    void clear() noexcept override
+    {
+        mCurrentWidth = -1.0f;
+        mS.fill(0.0f); mD.fill(0.0f); mTemp.fill(0.0f);
+        mDelayS = mDelayD = 0.0f;
+        mFilter1S = {}; mFilter2D = {}; mFilter1D = {}; mFilter2S = {};
+    }
+
     DEF_NEWDEL(UhjStereoDecoderIIR)
 };
 
+
+/* Whether devices should create a shared phase-shift stage for Super Stereo
+ * voices, with the FIR decode filters.
+ */
+extern bool UhjStereoShared;
+
+/* A shared phase-shift stage for Super Stereo voices. Rather than each voice
+ * decoding itself to B-Format and mixing that, voices mix the parts of their
+ * S and D signals that need the +90 degree phase shift to this bus (already
+ * panned, and ahead by the filter's input padding), and mix the rest directly
+ * to the dry buffer. The phase shift is then applied once per dry channel for
+ * all such voices, instead of twice per voice.
+ */
+struct UhjStereoBusBase {
+    /* Each mixing thread gets its own copy of the bus, after the first. The
+     * head lines hold the padding samples that fall before the start of the
+     * update, from voices that start mixing with it.
+     */
+    al::vector<FloatBufferLine,16> mBuffer;
+    al::vector<std::array<float,DecoderBase::sMaxPadding>,16> mHead;
+    size_t mNumChannels{};
+    size_t mPadding{};
+
+    /* Set by voices mixing to the bus, and cleared when processed. Once the
+     * filter history is silent, the bus can be skipped until it's used again.
+     */
+    std::atomic<bool> mHasInput{false};
+    bool mActive{false};
+
+    UhjStereoBusBase(const size_t numchans, const size_t numthreads, const size_t padding);
+    virtual ~UhjStereoBusBase();
+
+    /* Applies the phase shift to the bus, and adds the result to the given
+     * output, which must have one line for each bus channel.
+     */
+    virtual void process(const al::span<FloatBufferLine> output, const size_t samplesToDo) = 0;
+
+    static std::unique_ptr<UhjStereoBusBase> Create(UhjQualityType quality,
+        const size_t numchans, const size_t numthreads);
+};
+
+template<size_t N>
+struct UhjStereoBus final : public UhjStereoBusBase {
+    static constexpr size_t sInputPadding{N/2};
+
+    al::vector<std::array<float,N-1>,16> mHistory;
+
+    alignas(16) std::array<float,BufferLineSize + N-1> mTemp{};
+    alignas(16) std::array<float,BufferLineSize> mShifted{};
+
+    bool mUseFft{UhjFirFft.value_or(N >= UhjLength512)};
+
+    UhjStereoBus(const size_t numchans, const size_t numthreads)
+        : UhjStereoBusBase{numchans, numthreads, sInputPadding}, mHistory(numchans)
+    { }
+
+    void process(const al::span<FloatBufferLine> output, const size_t samplesToDo) override;
+
+    DEF_NEWDEL(UhjStereoBus)
+};
+
 #endif /* CORE_UHJFILTER_H */
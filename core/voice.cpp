@@ -8,6 +8,7 @@
 #include <atomic>
 #include <cassert>
 #include <climits>
+#include <cstring>
 #include <cstdint>
 #include <iterator>
 #include <memory>
@@ -17,6 +18,7 @@
 #include <utility>
 #include <vector>
 
+#include "adpcm.h"
 #include "alnumeric.h"
 #include "alspan.h"
 #include "alstring.h"
@@ -45,17 +47,23 @@ struct CTag;
 #ifdef HAVE_SSE
 struct SSETag;
 #endif
+#ifdef HAVE_AVX2
+struct AVX2Tag;
+#endif
+#ifdef HAVE_AVX512
+struct AVX512Tag;
+#endif
 #ifdef HAVE_NEON
 struct NEONTag;
 #endif
 
 
-static_assert(!(sizeof(DeviceBase::MixerBufferLine)&15),
-    "DeviceBase::MixerBufferLine must be a multiple of 16 bytes");
+static_assert(!(sizeof(VoiceMixScratch::MixerBufferLine)&15),
+    "VoiceMixScratch::MixerBufferLine must be a multiple of 16 bytes");
 static_assert(!(MaxResamplerEdge&3), "MaxResamplerEdge is not a multiple of 4");
 
 static_assert((BufferLineSize-1)/MaxPitch > 0, "MaxPitch is too large for BufferLineSize!");
-static_assert((INT_MAX>>MixerFracBits)/MaxPitch > BufferLineSize,
+static_assert((UINT_MAX>>MixerFracBits)/MaxPitch > BufferLineSize,
     "MaxPitch and/or BufferLineSize are too large for MixerFracBits!");
 
 Resampler ResamplerDefault{Resampler::Cubic};
@@ -80,6 +88,14 @@ inline MixerOutFunc SelectMixer()
     if((CPUCapFlags&CPU_CAP_NEON))
         return Mix_<NEONTag>;
 #endif
+#ifdef HAVE_AVX512
+    if((CPUCapFlags&CPU_CAP_AVX512))
+        return Mix_<AVX512Tag>;
+#endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+        return Mix_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return Mix_<SSETag>;
@@ -93,6 +109,14 @@ inline MixerOneFunc SelectMixerOne()
     if((CPUCapFlags&CPU_CAP_NEON))
         return Mix_<NEONTag>;
 #endif
+#ifdef HAVE_AVX512
+    if((CPUCapFlags&CPU_CAP_AVX512))
+        return Mix_<AVX512Tag>;
+#endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+        return Mix_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return Mix_<SSETag>;
@@ -100,12 +124,33 @@ inline MixerOneFunc SelectMixerOne()
     return Mix_<CTag>;
 }
 
+inline MixerMatrixFunc SelectMatrixMixer()
+{
+#ifdef HAVE_NEON
+    if((CPUCapFlags&CPU_CAP_NEON))
+        return MixMatrix_<NEONTag>;
+#endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+        return MixMatrix_<AVX2Tag>;
+#endif
+#ifdef HAVE_SSE
+    if((CPUCapFlags&CPU_CAP_SSE))
+        return MixMatrix_<SSETag>;
+#endif
+    return MixMatrix_<CTag>;
+}
+
 inline HrtfMixerFunc SelectHrtfMixer()
 {
 #ifdef HAVE_NEON
     if((CPUCapFlags&CPU_CAP_NEON))
         return MixHrtf_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+        return MixHrtf_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return MixHrtf_<SSETag>;
@@ -119,6 +164,10 @@ inline HrtfMixerBlendFunc SelectHrtfBlendMixer()
     if((CPUCapFlags&CPU_CAP_NEON))
         return MixHrtfBlend_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&(CPU_CAP_AVX2|CPU_CAP_FMA)) == (CPU_CAP_AVX2|CPU_CAP_FMA))
+        return MixHrtfBlend_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return MixHrtfBlend_<SSETag>;
@@ -128,6 +177,8 @@ inline HrtfMixerBlendFunc SelectHrtfBlendMixer()
 
 } // namespace
 
+Voice::~Voice() = default;
+
 void Voice::InitMixer(std::optional<std::string> resampler)
 {
     if(resampler)
@@ -170,6 +221,7 @@ void Voice::InitMixer(std::optional<std::string> resampler)
 
     MixSamplesOut = SelectMixer();
     MixSamplesOne = SelectMixerOne();
+    MixSamplesMatrix = SelectMatrixMixer();
     MixHrtfBlendSamples = SelectHrtfBlendMixer();
     MixHrtfSamples = SelectHrtfMixer();
 }
@@ -177,51 +229,42 @@ void Voice::InitMixer(std::optional<std::string> resampler)
 
 namespace {
 
-/* IMA ADPCM Stepsize table */
-constexpr int IMAStep_size[89] = {
-       7,    8,    9,   10,   11,   12,   13,   14,   16,   17,   19,
-      21,   23,   25,   28,   31,   34,   37,   41,   45,   50,   55,
-      60,   66,   73,   80,   88,   97,  107,  118,  130,  143,  157,
-     173,  190,  209,  230,  253,  279,  307,  337,  371,  408,  449,
-     494,  544,  598,  658,  724,  796,  876,  963, 1060, 1166, 1282,
-    1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660,
-    4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493,10442,
-   11487,12635,13899,15289,16818,18500,20350,22358,24633,27086,29794,
-   32767
-};
-
-/* IMA4 ADPCM Codeword decode table */
-constexpr int IMA4Codeword[16] = {
-    1, 3, 5, 7, 9, 11, 13, 15,
-   -1,-3,-5,-7,-9,-11,-13,-15,
-};
-
-/* IMA4 ADPCM Step index adjust decode table */
-constexpr int IMA4Index_adjust[16] = {
-   -1,-1,-1,-1, 2, 4, 6, 8,
-   -1,-1,-1,-1, 2, 4, 6, 8
-};
+/* Tells the CPU the thread is spinning on a lock, letting another hardware
+ * thread on the core run and saving power.
+ */
+inline void CpuRelax() noexcept
+{
+#ifdef HAVE_SSE_INTRINSICS
+    _mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__aarch64__) || defined(__arm__))
+    __asm__ __volatile__("yield");
+#endif
+}
 
-/* MSADPCM Adaption table */
-constexpr int MSADPCMAdaption[16] = {
-    230, 230, 230, 230, 307, 409, 512, 614,
-    768, 614, 512, 409, 307, 230, 230, 230
-};
+/* Voices may be mixed on multiple threads at once, so writes to the event
+ * ringbuffer need to be serialized. The lock is only held long enough to
+ * write an event, so the mixing threads spin rather than sleep to wait for it,
+ * only reading it until it's free to avoid bouncing its cache line.
+ */
+class EventWriteLock {
+    std::atomic<bool> &mLock;
 
-/* MSADPCM Adaption Coefficient tables */
-constexpr int MSADPCMAdaptionCoeff[7][2] = {
-    { 256,    0 },
-    { 512, -256 },
-    {   0,    0 },
-    { 192,   64 },
-    { 240,    0 },
-    { 460, -208 },
-    { 392, -232 }
+public:
+    EventWriteLock(ContextBase *context) noexcept : mLock{context->mEventWriteLock}
+    {
+        while(mLock.exchange(true, std::memory_order_acquire))
+        {
+            do {
+                CpuRelax();
+            } while(mLock.load(std::memory_order_relaxed));
+        }
+    }
+    ~EventWriteLock() { mLock.store(false, std::memory_order_release); }
 };
 
-
 void SendSourceStoppedEvent(ContextBase *context, uint id)
 {
+    EventWriteLock evtlock{context};
     RingBuffer *ring{context->mAsyncEvents.get()};
     auto evt_vec = ring->getWriteVector();
     if(evt_vec.first.len < 1) return;
@@ -229,36 +272,84 @@ void SendSourceStoppedEvent(ContextBase *context, uint id)
     auto &evt = InitAsyncEvent<AsyncSourceStateEvent>(evt_vec.first.buf);
     evt.mId = id;
     evt.mState = AsyncSrcState::Stop;
+    evt.mTime = context->mDevice->getMixClockTime();
 
     ring->writeAdvance(1);
 }
 
 
-const float *DoFilters(BiquadFilter &lpfilter, BiquadFilter &hpfilter, float *dst,
-    const al::span<const float> src, int type)
-{
-    switch(type)
+/* Gathers the filters for a voice's outputs, so the independent filters can
+ * be processed together.
+ */
+class FilterBatch {
+    static constexpr size_t MaxBatch{BiquadFilter::MaxBatch};
+
+    /* The first stage holds the low-pass or high-pass filters, and the second
+     * holds the high-pass filters of band-pass outputs, which need the
+     * low-pass output.
+     */
+    struct Stage {
+        std::array<BiquadFilter*,MaxBatch> mFilters;
+        std::array<const float*,MaxBatch> mSrcs;
+        std::array<float*,MaxBatch> mDsts;
+        size_t mCount{0};
+
+        void add(BiquadFilter &filter, const float *src, float *dst) noexcept
+        {
+            mFilters[mCount] = &filter;
+            mSrcs[mCount] = src;
+            mDsts[mCount] = dst;
+            ++mCount;
+        }
+        void process(const size_t samplesToDo)
+        {
+            BiquadFilter::processBatch({mFilters.data(), mCount}, {mSrcs.data(), mCount},
+                {mDsts.data(), mCount}, samplesToDo);
+            mCount = 0;
+        }
+    };
+    std::array<Stage,2> mStages;
+
+public:
+    /* Adds the filters for an output, filtering the source samples into dst.
+     * Returns the samples to mix once processed.
+     */
+    const float *add(BiquadFilter &lpfilter, BiquadFilter &hpfilter, float *dst,
+        const float *src, int type) noexcept
     {
-    case AF_None:
-        lpfilter.clear();
-        hpfilter.clear();
-        break;
+        switch(type)
+        {
+        case AF_None:
+            lpfilter.clear();
+            hpfilter.clear();
+            break;
 
-    case AF_LowPass:
-        lpfilter.process(src, dst);
-        hpfilter.clear();
-        return dst;
-    case AF_HighPass:
-        lpfilter.clear();
-        hpfilter.process(src, dst);
-        return dst;
+        case AF_LowPass:
+            mStages[0].add(lpfilter, src, dst);
+            hpfilter.clear();
+            return dst;
+        case AF_HighPass:
+            lpfilter.clear();
+            mStages[0].add(hpfilter, src, dst);
+            return dst;
+
+        case AF_BandPass:
+            mStages[0].add(lpfilter, src, dst);
+            mStages[1].add(hpfilter, dst, dst);
+            return dst;
+        }
+        return src;
+    }
 
-    case AF_BandPass:
-        DualBiquad{lpfilter, hpfilter}.process(src, dst);
-        return dst;
+    void process(const size_t samplesToDo)
+    {
+        for(Stage &stage : mStages)
+        {
+            if(stage.mCount > 0)
+                stage.process(samplesToDo);
+        }
     }
-    return src.data();
-}
+};
 
 
 template<FmtType Type>
@@ -277,85 +368,8 @@ inline void LoadSamples<FmtIMA4>(float *RESTRICT dstSamples, const std::byte *sr
     const size_t srcChan, const size_t srcOffset, const size_t srcStep,
     const size_t samplesPerBlock, const size_t samplesToLoad) noexcept
 {
-    const size_t blockBytes{((samplesPerBlock-1)/2 + 4)*srcStep};
-
-    /* Skip to the ADPCM block containing the srcOffset sample. */
-    src += srcOffset/samplesPerBlock*blockBytes;
-    /* Calculate how many samples need to be skipped in the block. */
-    size_t skip{srcOffset % samplesPerBlock};
-
-    /* NOTE: This could probably be optimized better. */
-    size_t wrote{0};
-    do {
-        static constexpr int MaxStepIndex{static_cast<int>(std::size(IMAStep_size)) - 1};
-        /* Each IMA4 block starts with a signed 16-bit sample, and a signed
-         * 16-bit table index. The table index needs to be clamped.
-         */
-        int sample{int(src[srcChan*4]) | (int(src[srcChan*4 + 1]) << 8)};
-        int index{int(src[srcChan*4 + 2]) | (int(src[srcChan*4 + 3]) << 8)};
-
-        sample = (sample^0x8000) - 32768;
-        index = clampi((index^0x8000) - 32768, 0, MaxStepIndex);
-
-        if(skip == 0)
-        {
-            dstSamples[wrote++] = static_cast<float>(sample) / 32768.0f;
-            if(wrote == samplesToLoad) return;
-        }
-        else
-            --skip;
-
-        auto decode_sample = [&sample,&index](const uint nibble)
-        {
-            sample += IMA4Codeword[nibble] * IMAStep_size[index] / 8;
-            sample = clampi(sample, -32768, 32767);
-
-            index += IMA4Index_adjust[nibble];
-            index = clampi(index, 0, MaxStepIndex);
-
-            return sample;
-        };
-
-        /* The rest of the block is arranged as a series of nibbles, contained
-         * in 4 *bytes* per channel interleaved. So every 8 nibbles we need to
-         * skip 4 bytes per channel to get the next nibbles for this channel.
-         *
-         * First, decode the samples that we need to skip in the block (will
-         * always be less than the block size). They need to be decoded despite
-         * being ignored for proper state on the remaining samples.
-         */
-        const std::byte *nibbleData{src + (srcStep+srcChan)*4};
-        size_t nibbleOffset{0};
-        const size_t startOffset{skip + 1};
-        for(;skip;--skip)
-        {
-            const size_t byteShift{(nibbleOffset&1) * 4};
-            const size_t wordOffset{(nibbleOffset>>1) & ~size_t{3}};
-            const size_t byteOffset{wordOffset*srcStep + ((nibbleOffset>>1)&3u)};
-            ++nibbleOffset;
-
-            std::ignore = decode_sample(uint(nibbleData[byteOffset]>>byteShift) & 15u);
-        }
-
-        /* Second, decode the rest of the block and write to the output, until
-         * the end of the block or the end of output.
-         */
-        const size_t todo{minz(samplesPerBlock-startOffset, samplesToLoad-wrote)};
-        for(size_t i{0};i < todo;++i)
-        {
-            const size_t byteShift{(nibbleOffset&1) * 4};
-            const size_t wordOffset{(nibbleOffset>>1) & ~size_t{3}};
-            const size_t byteOffset{wordOffset*srcStep + ((nibbleOffset>>1)&3u)};
-            ++nibbleOffset;
-
-            const int result{decode_sample(uint(nibbleData[byteOffset]>>byteShift) & 15u)};
-            dstSamples[wrote++] = static_cast<float>(result) / 32768.0f;
-        }
-        if(wrote == samplesToLoad)
-            return;
-
-        src += blockBytes;
-    } while(true);
+    DecodeIma4Samples(dstSamples, src, srcChan, srcOffset, srcStep, samplesPerBlock,
+        samplesToLoad);
 }
 
 template<>
@@ -363,102 +377,8 @@ inline void LoadSamples<FmtMSADPCM>(float *RESTRICT dstSamples, const std::byte
     const size_t srcChan, const size_t srcOffset, const size_t srcStep,
     const size_t samplesPerBlock, const size_t samplesToLoad) noexcept
 {
-    const size_t blockBytes{((samplesPerBlock-2)/2 + 7)*srcStep};
-
-    src += srcOffset/samplesPerBlock*blockBytes;
-    size_t skip{srcOffset % samplesPerBlock};
-
-    size_t wrote{0};
-    do {
-        /* Each MS ADPCM block starts with an 8-bit block predictor, used to
-         * dictate how the two sample history values are mixed with the decoded
-         * sample, and an initial signed 16-bit delta value which scales the
-         * nibble sample value. This is followed by the two initial 16-bit
-         * sample history values.
-         */
-        const std::byte *input{src};
-        const uint8_t blockpred{std::min(uint8_t(input[srcChan]), uint8_t{6})};
-        input += srcStep;
-        int delta{int(input[2*srcChan + 0]) | (int(input[2*srcChan + 1]) << 8)};
-        input += srcStep*2;
-
-        int sampleHistory[2]{};
-        sampleHistory[0] = int(input[2*srcChan + 0]) | (int(input[2*srcChan + 1])<<8);
-        input += srcStep*2;
-        sampleHistory[1] = int(input[2*srcChan + 0]) | (int(input[2*srcChan + 1])<<8);
-        input += srcStep*2;
-
-        const al::span coeffs{MSADPCMAdaptionCoeff[blockpred]};
-        delta = (delta^0x8000) - 32768;
-        sampleHistory[0] = (sampleHistory[0]^0x8000) - 32768;
-        sampleHistory[1] = (sampleHistory[1]^0x8000) - 32768;
-
-        /* The second history sample is "older", so it's the first to be
-         * written out.
-         */
-        if(skip == 0)
-        {
-            dstSamples[wrote++] = static_cast<float>(sampleHistory[1]) / 32768.0f;
-            if(wrote == samplesToLoad) return;
-            dstSamples[wrote++] = static_cast<float>(sampleHistory[0]) / 32768.0f;
-            if(wrote == samplesToLoad) return;
-        }
-        else if(skip == 1)
-        {
-            --skip;
-            dstSamples[wrote++] = static_cast<float>(sampleHistory[0]) / 32768.0f;
-            if(wrote == samplesToLoad) return;
-        }
-        else
-            skip -= 2;
-
-        auto decode_sample = [&sampleHistory,&delta,coeffs](const int nibble)
-        {
-            int pred{(sampleHistory[0]*coeffs[0] + sampleHistory[1]*coeffs[1]) / 256};
-            pred += ((nibble^0x08) - 0x08) * delta;
-            pred  = clampi(pred, -32768, 32767);
-
-            sampleHistory[1] = sampleHistory[0];
-            sampleHistory[0] = pred;
-
-            delta = (MSADPCMAdaption[nibble] * delta) / 256;
-            delta = maxi(16, delta);
-
-            return pred;
-        };
-
-        /* The rest of the block is a series of nibbles, interleaved per-
-         * channel. First, skip samples.
-         */
-        const size_t startOffset{skip + 2};
-        size_t nibbleOffset{srcChan};
-        for(;skip;--skip)
-        {
-            const size_t byteOffset{nibbleOffset>>1};
-            const size_t byteShift{((nibbleOffset&1)^1) * 4};
-            nibbleOffset += srcStep;
-
-            std::ignore = decode_sample(int(input[byteOffset]>>byteShift) & 15);
-        }
-
-        /* Now decode the rest of the block, until the end of the block or the
-         * dst buffer is filled.
-         */
-        const size_t todo{minz(samplesPerBlock-startOffset, samplesToLoad-wrote)};
-        for(size_t j{0};j < todo;++j)
-        {
-            const size_t byteOffset{nibbleOffset>>1};
-            const size_t byteShift{((nibbleOffset&1)^1) * 4};
-            nibbleOffset += srcStep;
-
-            const int sample{decode_sample(int(input[byteOffset]>>byteShift) & 15)};
-            dstSamples[wrote++] = static_cast<float>(sample) / 32768.0f;
-        }
-        if(wrote == samplesToLoad)
-            return;
-
-        src += blockBytes;
-    } while(true);
+    DecodeMsAdpcmSamples(dstSamples, src, srcChan, srcOffset, srcStep, samplesPerBlock,
+        samplesToLoad);
 }
 
 void LoadSamples(float *dstSamples, const std::byte *src, const size_t srcChan,
@@ -476,6 +396,7 @@ void LoadSamples(float *dstSamples, const std::byte *src, const size_t srcChan,
     HANDLE_FMT(FmtShort);
     HANDLE_FMT(FmtFloat);
     HANDLE_FMT(FmtDouble);
+    HANDLE_FMT(FmtHalf);
     HANDLE_FMT(FmtMulaw);
     HANDLE_FMT(FmtAlaw);
     HANDLE_FMT(FmtIMA4);
@@ -484,10 +405,172 @@ void LoadSamples(float *dstSamples, const std::byte *src, const size_t srcChan,
 #undef HANDLE_FMT
 }
 
+/* Loads ADPCM samples through the mixing thread's cache, decoding whole
+ * chunks of blocks as needed.
+ */
+template<FmtType Type>
+void LoadCachedSamples(AdpcmCache &cache, float *dstSamples, const VoiceBufferItem *buffer,
+    const size_t srcChan, size_t srcOffset, const size_t srcStep, const size_t samplesToLoad)
+{
+    static_assert(Type == FmtIMA4 || Type == FmtMSADPCM, "Must be an ADPCM type");
+
+    const size_t samplesPerBlock{buffer->mBlockAlign};
+    const size_t blockBytes{(Type == FmtIMA4) ? ((samplesPerBlock-1)/2 + 4)*srcStep
+        : ((samplesPerBlock-2)/2 + 7)*srcStep};
+    const size_t chunkBlocks{AdpcmCache::ChunkSamples / samplesPerBlock};
+    const size_t chunkSamples{chunkBlocks * samplesPerBlock};
+    const size_t totalBlocks{buffer->mSampleLen / samplesPerBlock};
+
+    size_t wrote{0};
+    while(wrote < samplesToLoad)
+    {
+        const size_t chunk{srcOffset / chunkSamples};
+        const size_t chunkOffset{srcOffset % chunkSamples};
+
+        auto [entry, cached] = cache.get(buffer->mSamples, srcChan, chunk);
+        if(!cached)
+        {
+            const size_t startBlock{chunk * chunkBlocks};
+            const size_t numBlocks{minz(chunkBlocks, totalBlocks - startBlock)};
+            LoadSamples<Type>(entry->mSamples.data(), buffer->mSamples + startBlock*blockBytes,
+                srcChan, 0, srcStep, samplesPerBlock, numBlocks*samplesPerBlock);
+        }
+
+        const size_t todo{minz(chunkSamples-chunkOffset, samplesToLoad-wrote)};
+        std::copy_n(entry->mSamples.cbegin()+chunkOffset, todo, dstSamples+wrote);
+        srcOffset += todo;
+        wrote += todo;
+    }
+}
+
+/* Loads samples from a static or queued buffer, using the cache for ADPCM
+ * buffers that allow it. Buffers converted on load are read from the
+ * channel's float plane instead.
+ */
+void LoadBufferSamples(AdpcmCache *cache, float *dstSamples, const VoiceBufferItem *buffer,
+    const size_t srcChan, const size_t srcOffset, const FmtType srcType, const size_t srcStep,
+    const size_t samplesToLoad)
+{
+    if(const size_t planeSize{buffer->mPlaneSize})
+        return LoadSamples<FmtFloat>(dstSamples, buffer->mSamples, srcChan*planeSize, srcOffset,
+            1, 1, samplesToLoad);
+    if(cache && buffer->mCacheable && buffer->mBlockAlign <= AdpcmCache::ChunkSamples)
+    {
+        if(srcType == FmtIMA4)
+            return LoadCachedSamples<FmtIMA4>(*cache, dstSamples, buffer, srcChan, srcOffset,
+                srcStep, samplesToLoad);
+        if(srcType == FmtMSADPCM)
+            return LoadCachedSamples<FmtMSADPCM>(*cache, dstSamples, buffer, srcChan, srcOffset,
+                srcStep, samplesToLoad);
+    }
+    LoadSamples(dstSamples, buffer->mSamples, srcChan, srcOffset, srcType, srcStep,
+        buffer->mBlockAlign, samplesToLoad);
+}
+
+/* Loads samples from a non-looping static buffer for the given position,
+ * which may be outside of the buffer. Samples before the start are silent,
+ * and samples past the end repeat the last sample like LoadBufferStatic.
+ */
+void LoadStaticRange(float *dstSamples, const VoiceBufferItem *buffer, const FmtType srcType,
+    const size_t srcChan, const size_t srcStep, int64_t srcOffset, const size_t samplesToLoad)
+{
+    size_t wrote{0};
+    if(srcOffset < 0)
+    {
+        wrote = static_cast<size_t>(std::min(-srcOffset, static_cast<int64_t>(samplesToLoad)));
+        std::fill_n(dstSamples, wrote, 0.0f);
+        srcOffset += static_cast<int64_t>(wrote);
+    }
+    if(wrote < samplesToLoad && srcOffset < int64_t{buffer->mSampleLen})
+    {
+        const size_t todo{minz(samplesToLoad-wrote,
+            static_cast<size_t>(buffer->mSampleLen - srcOffset))};
+        LoadBufferSamples(nullptr, dstSamples+wrote, buffer, srcChan,
+            static_cast<size_t>(srcOffset), srcType, srcStep, todo);
+        wrote += todo;
+    }
+    else if(wrote < samplesToLoad && wrote == 0 && buffer->mSampleLen > 0)
+    {
+        /* Starting past the end, so get the last sample to repeat. */
+        LoadBufferSamples(nullptr, dstSamples, buffer, srcChan, buffer->mSampleLen-1u, srcType,
+            srcStep, 1);
+        wrote = 1;
+    }
+    if(wrote < samplesToLoad)
+        std::fill(dstSamples+wrote, dstSamples+samplesToLoad, wrote ? dstSamples[wrote-1] : 0.0f);
+}
+
+/* Resamples a chunk of a non-looping static buffer for the resample cache, as
+ * played from the start of the buffer with the given increment. The best
+ * resampler is used since the result gets reused.
+ */
+void ResampleStaticChunk(float *dstSamples, const VoiceBufferItem *buffer, const FmtType srcType,
+    const size_t srcChan, const size_t srcStep, const uint increment, const size_t chunk,
+    const al::span<float> srcSamples)
+{
+    static constexpr size_t ChunkSamples{ResampleCache::ChunkSamples};
+    const size_t srcSizeMax{srcSamples.size() - MaxResamplerPadding};
+    /* Keep the output offsets a multiple of 4 for the resamplers that want
+     * aligned output.
+     */
+    const size_t dstSizeMax{static_cast<size_t>((uint64_t{srcSizeMax-1}<<MixerFracBits)
+        / increment) & ~size_t{3}};
+
+    InterpState state;
+    const ResamplerFunc resample{PrepareResampler(Resampler::Max, increment, &state)};
+
+    const uint64_t startPos{uint64_t{chunk*ChunkSamples} * increment};
+    for(size_t done{0};done < ChunkSamples;)
+    {
+        const uint64_t pos{startPos + uint64_t{done}*increment};
+        const auto intPos = static_cast<int64_t>(pos >> MixerFracBits);
+        const auto fracPos = static_cast<uint>(pos & MixerFracMask);
+        const size_t todo{minz(ChunkSamples-done, dstSizeMax)};
+        const size_t srcSize{static_cast<size_t>(((todo-1)*uint64_t{increment} + fracPos)
+            >> MixerFracBits) + 1};
+
+        LoadStaticRange(srcSamples.data(), buffer, srcType, srcChan, srcStep,
+            intPos-MaxResamplerEdge, srcSize+MaxResamplerPadding);
+        resample(&state, srcSamples.data()+MaxResamplerEdge, fracPos, increment,
+            {dstSamples+done, todo});
+        done += todo;
+    }
+}
+
+/* Loads resampled samples of a non-looping static buffer through the mixing
+ * thread's resample cache, for a voice at the given output sample offset from
+ * the start of the buffer.
+ */
+void LoadResampledStatic(ResampleCache &cache, const al::span<float> dstSamples,
+    const VoiceBufferItem *buffer, const FmtType srcType, const size_t srcChan,
+    const size_t srcStep, const uint increment, uint64_t outOffset,
+    const al::span<float> srcSamples)
+{
+    static constexpr size_t ChunkSamples{ResampleCache::ChunkSamples};
+    const uint format{(static_cast<uint>(srcType)<<16) | static_cast<uint>(srcStep)};
+
+    size_t wrote{0};
+    while(wrote < dstSamples.size())
+    {
+        const auto chunk = static_cast<size_t>(outOffset / ChunkSamples);
+        const auto chunkOffset = static_cast<size_t>(outOffset % ChunkSamples);
+
+        auto [entry, cached] = cache.get(buffer->mSamples, format, increment, srcChan, chunk);
+        if(!cached)
+            ResampleStaticChunk(entry->mSamples.data(), buffer, srcType, srcChan, srcStep,
+                increment, chunk, srcSamples);
+
+        const size_t todo{minz(ChunkSamples-chunkOffset, dstSamples.size()-wrote)};
+        std::copy_n(entry->mSamples.cbegin()+chunkOffset, todo, dstSamples.begin()+wrote);
+        outOffset += todo;
+        wrote += todo;
+    }
+}
+
 void LoadBufferStatic(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
     const size_t dataPosInt, const FmtType sampleType, const size_t srcChannel,
     const size_t srcStep, size_t samplesLoaded, const size_t samplesToLoad,
-    float *voiceSamples)
+    float *voiceSamples, AdpcmCache *cache)
 {
     if(!bufferLoopItem)
     {
@@ -496,8 +579,8 @@ void LoadBufferStatic(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
         {
             const size_t buffer_remaining{buffer->mSampleLen - dataPosInt};
             const size_t remaining{minz(samplesToLoad-samplesLoaded, buffer_remaining)};
-            LoadSamples(voiceSamples+samplesLoaded, buffer->mSamples, srcChannel, dataPosInt,
-                sampleType, srcStep, buffer->mBlockAlign, remaining);
+            LoadBufferSamples(cache, voiceSamples+samplesLoaded, buffer, srcChannel, dataPosInt,
+                sampleType, srcStep, remaining);
             samplesLoaded += remaining;
         }
 
@@ -518,16 +601,16 @@ void LoadBufferStatic(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
 
         /* Load what's left of this loop iteration */
         const size_t remaining{minz(samplesToLoad-samplesLoaded, loopEnd-dataPosInt)};
-        LoadSamples(voiceSamples+samplesLoaded, buffer->mSamples, srcChannel, intPos, sampleType,
-            srcStep, buffer->mBlockAlign, remaining);
+        LoadBufferSamples(cache, voiceSamples+samplesLoaded, buffer, srcChannel, intPos,
+            sampleType, srcStep, remaining);
         samplesLoaded += remaining;
 
         /* Load repeats of the loop to fill the buffer. */
         const size_t loopSize{loopEnd - loopStart};
         while(const size_t toFill{minz(samplesToLoad - samplesLoaded, loopSize)})
         {
-            LoadSamples(voiceSamples+samplesLoaded, buffer->mSamples, srcChannel, loopStart,
-                sampleType, srcStep, buffer->mBlockAlign, toFill);
+            LoadBufferSamples(cache, voiceSamples+samplesLoaded, buffer, srcChannel, loopStart,
+                sampleType, srcStep, toFill);
             samplesLoaded += toFill;
         }
     }
@@ -553,10 +636,44 @@ void LoadBufferCallback(VoiceBufferItem *buffer, const size_t dataPosInt,
     }
 }
 
+/* Loads samples in place from a ring buffer's storage, given the number of
+ * samples available from the ring's read position.
+ */
+void LoadBufferRing(VoiceBufferItem *buffer, const size_t dataPosInt,
+    const size_t numRingSamples, const FmtType sampleType, const size_t srcChannel,
+    const size_t srcStep, size_t samplesLoaded, const size_t samplesToLoad, float *voiceSamples)
+{
+    if(numRingSamples > dataPosInt) LIKELY
+    {
+        const BufferRing &ring = *buffer->mRing;
+        const size_t ringSize{size_t{ring.mNumBlocks} * buffer->mBlockAlign};
+        const uint readIndex{ring.index(ring.mReadPos.load(std::memory_order_relaxed))};
+
+        size_t ringPos{(size_t{readIndex}*buffer->mBlockAlign + dataPosInt) % ringSize};
+        size_t remaining{minz(samplesToLoad-samplesLoaded, numRingSamples-dataPosInt)};
+        while(remaining > 0)
+        {
+            /* Load up to the end of the storage, then wrap around. */
+            const size_t todo{minz(remaining, ringSize-ringPos)};
+            LoadSamples(voiceSamples+samplesLoaded, buffer->mSamples, srcChannel, ringPos,
+                sampleType, srcStep, buffer->mBlockAlign, todo);
+            samplesLoaded += todo;
+            remaining -= todo;
+            ringPos = 0;
+        }
+    }
+
+    if(const size_t toFill{samplesToLoad - samplesLoaded})
+    {
+        auto srcsamples = voiceSamples + samplesLoaded;
+        std::fill_n(srcsamples, toFill, *(srcsamples-1));
+    }
+}
+
 void LoadBufferQueue(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
     size_t dataPosInt, const FmtType sampleType, const size_t srcChannel,
     const size_t srcStep, size_t samplesLoaded, const size_t samplesToLoad,
-    float *voiceSamples)
+    float *voiceSamples, AdpcmCache *cache)
 {
     /* Crawl the buffer queue to fill in the temp buffer */
     while(buffer && samplesLoaded != samplesToLoad)
@@ -570,8 +687,8 @@ void LoadBufferQueue(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
         }
 
         const size_t remaining{minz(samplesToLoad-samplesLoaded, buffer->mSampleLen-dataPosInt)};
-        LoadSamples(voiceSamples+samplesLoaded, buffer->mSamples, srcChannel, dataPosInt,
-            sampleType, srcStep, buffer->mBlockAlign, remaining);
+        LoadBufferSamples(cache, voiceSamples+samplesLoaded, buffer, srcChannel, dataPosInt,
+            sampleType, srcStep, remaining);
 
         samplesLoaded += remaining;
         if(samplesLoaded == samplesToLoad)
@@ -591,24 +708,26 @@ void LoadBufferQueue(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
 
 void DoHrtfMix(const float *samples, const uint DstBufferSize, DirectParams &parms,
     const float TargetGain, const uint Counter, uint OutPos, const bool IsPlaying,
-    DeviceBase *Device)
+    DeviceBase *Device, VoiceMixScratch &Scratch)
 {
     const uint IrSize{Device->mIrSize};
-    auto &HrtfSamples = Device->HrtfSourceData;
-    auto &AccumSamples = Device->HrtfAccumData;
+    auto &HrtfSamples = Scratch.HrtfSourceData;
+    float2 *AccumSamples{Scratch.HrtfAccumData};
 
     /* Copy the HRTF history and new input samples into a temp buffer. */
-    auto src_iter = std::copy(parms.Hrtf.History.begin(), parms.Hrtf.History.end(),
+    auto src_iter = std::copy(parms.Hrtf->History.begin(), parms.Hrtf->History.end(),
         std::begin(HrtfSamples));
     std::copy_n(samples, DstBufferSize, src_iter);
     /* Copy the last used samples back into the history buffer for later. */
     if(IsPlaying) LIKELY
-        std::copy_n(std::begin(HrtfSamples) + DstBufferSize, parms.Hrtf.History.size(),
-            parms.Hrtf.History.begin());
+        std::copy_n(std::begin(HrtfSamples) + DstBufferSize, parms.Hrtf->History.size(),
+            parms.Hrtf->History.begin());
 
-    /* If fading and this is the first mixing pass, fade between the IRs. */
+    /* If fading to a new filter and this is the first mixing pass, fade
+     * between the IRs. Otherwise only the gain needs to fade.
+     */
     uint fademix{0u};
-    if(Counter && OutPos == 0)
+    if(Counter && OutPos == 0 && parms.Hrtf->Changed)
     {
         fademix = minu(DstBufferSize, Counter);
 
@@ -622,20 +741,23 @@ void DoHrtfMix(const float *samples, const uint DstBufferSize, DirectParams &par
         if(Counter > fademix)
         {
             const float a{static_cast<float>(fademix) / static_cast<float>(Counter)};
-            gain = lerpf(parms.Hrtf.Old.Gain, TargetGain, a);
+            gain = lerpf(parms.Hrtf->Old.Gain, TargetGain, a);
         }
 
         MixHrtfFilter hrtfparams{
-            parms.Hrtf.Target.Coeffs,
-            parms.Hrtf.Target.Delay,
+            parms.Hrtf->Target.Coeffs,
+            parms.Hrtf->Target.Delay,
             0.0f, gain / static_cast<float>(fademix)};
-        MixHrtfBlendSamples(HrtfSamples, AccumSamples+OutPos, IrSize, &parms.Hrtf.Old, &hrtfparams,
+        MixHrtfBlendSamples(HrtfSamples, AccumSamples+OutPos, IrSize, &parms.Hrtf->Old, &hrtfparams,
             fademix);
 
         /* Update the old parameters with the result. */
-        parms.Hrtf.Old = parms.Hrtf.Target;
-        parms.Hrtf.Old.Gain = gain;
+        parms.Hrtf->Old = parms.Hrtf->Target;
+        parms.Hrtf->Old.Gain = gain;
+        parms.Hrtf->Changed = false;
         OutPos += fademix;
+
+        Device->mProfile.mHrtfBlends.fetch_add(1u, std::memory_order_relaxed);
     }
 
     if(fademix < DstBufferSize)
@@ -649,57 +771,269 @@ void DoHrtfMix(const float *samples, const uint DstBufferSize, DirectParams &par
         if(Counter > DstBufferSize)
         {
             const float a{static_cast<float>(todo) / static_cast<float>(Counter-fademix)};
-            gain = lerpf(parms.Hrtf.Old.Gain, TargetGain, a);
+            gain = lerpf(parms.Hrtf->Old.Gain, TargetGain, a);
         }
 
         MixHrtfFilter hrtfparams{
-            parms.Hrtf.Target.Coeffs,
-            parms.Hrtf.Target.Delay,
-            parms.Hrtf.Old.Gain,
-            (gain - parms.Hrtf.Old.Gain) / static_cast<float>(todo)};
+            parms.Hrtf->Target.Coeffs,
+            parms.Hrtf->Target.Delay,
+            parms.Hrtf->Old.Gain,
+            (gain - parms.Hrtf->Old.Gain) / static_cast<float>(todo)};
         MixHrtfSamples(HrtfSamples+fademix, AccumSamples+OutPos, IrSize, &hrtfparams, todo);
 
         /* Store the now-current gain for next time. */
-        parms.Hrtf.Old.Gain = gain;
+        parms.Hrtf->Old.Gain = gain;
     }
 }
 
 void DoNfcMix(const al::span<const float> samples, FloatBufferLine *OutBuffer, DirectParams &parms,
-    const float *TargetGains, const uint Counter, const uint OutPos, DeviceBase *Device)
+    const float *TargetGains, const uint Counter, const uint OutPos, DeviceBase *Device,
+    VoiceMixScratch &Scratch)
 {
-    using FilterProc = void (NfcFilter::*)(const al::span<const float>, float*);
-    static constexpr FilterProc NfcProcess[MaxAmbiOrder+1]{
-        nullptr, &NfcFilter::process1, &NfcFilter::process2, &NfcFilter::process3};
-
     float *CurrentGains{parms.Gains.Current.data()};
     MixSamples(samples, {OutBuffer, 1u}, CurrentGains, TargetGains, Counter, OutPos);
     ++OutBuffer;
     ++CurrentGains;
     ++TargetGains;
 
-    const al::span<float> nfcsamples{Device->NfcSampleData, samples.size()};
-    size_t order{1};
-    while(const size_t chancount{Device->NumChannelsPerOrder[order]})
+    /* Filter all the used orders together, since they have the same input. */
+    std::array<float*,MaxAmbiOrder> nfcsamples{};
+    size_t numorders{0};
+    while(numorders < MaxAmbiOrder && Device->NumChannelsPerOrder[numorders+1])
+    {
+        nfcsamples[numorders] = Scratch.NfcSampleData[numorders];
+        ++numorders;
+    }
+    parms.NFCtrlFilter.process(samples, {nfcsamples.data(), numorders});
+
+    for(size_t order{1};order <= numorders;++order)
     {
-        (parms.NFCtrlFilter.*NfcProcess[order])(samples, nfcsamples.data());
-        MixSamples(nfcsamples, {OutBuffer, chancount}, CurrentGains, TargetGains, Counter, OutPos);
+        const size_t chancount{Device->NumChannelsPerOrder[order]};
+        MixSamples({nfcsamples[order-1], samples.size()}, {OutBuffer, chancount}, CurrentGains,
+            TargetGains, Counter, OutPos);
         OutBuffer += chancount;
         CurrentGains += chancount;
         TargetGains += chancount;
-        if(++order == MaxAmbiOrder+1)
-            break;
     }
 }
 
+/* Filters a line of samples that includes the decoder's input padding. Only
+ * the samples up to samplesToDo update the filter state, with a copy of the
+ * filters continuing over the padding samples.
+ */
+void FilterWithPadding(BiquadFilter &lpfilter, BiquadFilter &hpfilter, float *samples,
+    const size_t samplesToDo, const size_t padding, const int type)
+{
+    auto process = [samples,samplesToDo,padding](BiquadFilter &filter)
+    {
+        filter.process({samples, samplesToDo}, samples);
+        BiquadFilter ahead{filter};
+        ahead.process({samples+samplesToDo, padding}, samples+samplesToDo);
+    };
+    switch(type)
+    {
+    case AF_None:
+        lpfilter.clear();
+        hpfilter.clear();
+        break;
+    case AF_LowPass:
+        process(lpfilter);
+        hpfilter.clear();
+        break;
+    case AF_HighPass:
+        lpfilter.clear();
+        process(hpfilter);
+        break;
+    case AF_BandPass:
+        process(lpfilter);
+        process(hpfilter);
+        break;
+    }
+}
+
+/* Mixes a Super Stereo voice's dry path through the device's shared phase-
+ * shift bus. Given the W, X, and Y panning gains, the parts of the decode
+ *
+ * W = 0.6098637*S - 0.6896511*j*D
+ * X = 0.8624776*S + 0.7626955*j*D
+ * Y = 1.6822415*D - 0.2156194*j*S
+ *
+ * that don't need the phase shift are mixed directly to the output, and the
+ * parts that do are mixed to the bus with the padding samples ahead. The
+ * first mix after the decoder was set up also provides the initial padding
+ * samples, which fall before the start of the output.
+ */
+void DoStereoBusMix(const al::span<Voice::ChannelData> chans, float *mid, float *side,
+    const bool IsAudible, const bool isStart, const uint Counter, const uint OutPos,
+    const uint samplesToMix, const al::span<FloatBufferLine> OutBuffer, UhjStereoBusBase *bus,
+    const uint threadIndex)
+{
+    static constexpr std::array<float,MAX_OUTPUT_CHANNELS> SilentTarget{};
+
+    const size_t numChans{OutBuffer.size()};
+    const size_t padding{bus->mPadding};
+    const DirectParams &wparms = chans[0].mDryParams;
+    const DirectParams &xparms = chans[1].mDryParams;
+    const DirectParams &yparms = chans[2].mDryParams;
+    const float *wtarget{IsAudible ? wparms.Gains.Target.data() : SilentTarget.data()};
+    const float *xtarget{IsAudible ? xparms.Gains.Target.data() : SilentTarget.data()};
+    const float *ytarget{IsAudible ? yparms.Gains.Target.data() : SilentTarget.data()};
+
+    /* Current and target gains for S and D, to the output and to the bus. */
+    std::array<std::array<float,MAX_OUTPUT_CHANNELS>,4> current, target;
+    for(size_t c{0};c < numChans;++c)
+    {
+        const float wcur{wparms.Gains.Current[c]};
+        const float xcur{xparms.Gains.Current[c]};
+        const float ycur{yparms.Gains.Current[c]};
+        current[0][c] = 0.6098637f*wcur + 0.8624776f*xcur;
+        current[1][c] = 1.6822415f*ycur;
+        current[2][c] = -0.2156194f*ycur;
+        current[3][c] = -0.6896511f*wcur + 0.7626955f*xcur;
+
+        target[0][c] = 0.6098637f*wtarget[c] + 0.8624776f*xtarget[c];
+        target[1][c] = 1.6822415f*ytarget[c];
+        target[2][c] = -0.2156194f*ytarget[c];
+        target[3][c] = -0.6896511f*wtarget[c] + 0.7626955f*xtarget[c];
+    }
+
+    /* The gain changes for the bus are applied to samples that are ahead by
+     * the padding, so the direct part holds its gains for as long before
+     * fading, to stay in step (as much as the mix length allows).
+     */
+    uint fadeDelay{0};
+    if(Counter > 0)
+    {
+        fadeDelay = minu(static_cast<uint>(padding), (samplesToMix-Counter) & ~3u);
+        if(fadeDelay > 0)
+        {
+            MixSamples({mid, fadeDelay}, OutBuffer, current[0].data(), current[0].data(), 0,
+                OutPos);
+            MixSamples({side, fadeDelay}, OutBuffer, current[1].data(), current[1].data(), 0,
+                OutPos);
+        }
+    }
+    MixSamples({mid+fadeDelay, samplesToMix-fadeDelay}, OutBuffer, current[0].data(),
+        target[0].data(), Counter, OutPos+fadeDelay);
+    MixSamples({side+fadeDelay, samplesToMix-fadeDelay}, OutBuffer, current[1].data(),
+        target[1].data(), Counter, OutPos+fadeDelay);
+
+    /* The bus samples start with the padding ahead of the output position. At
+     * the start, the padding samples before it are mixed too, with any that
+     * fall before the start of this update going to the head lines, using
+     * the gains the fade starts from.
+     */
+    const al::span<FloatBufferLine> BusBuffer{bus->mBuffer.data() + numChans*threadIndex,
+        numChans};
+    size_t inPos{padding}, busPos{OutPos};
+    if(isStart)
+    {
+        if(OutPos >= padding)
+        {
+            inPos = 0;
+            busPos = OutPos - padding;
+        }
+        else
+        {
+            const size_t headLen{padding - OutPos};
+            auto *head = bus->mHead.data() + numChans*threadIndex;
+            for(size_t c{0};c < numChans;++c)
+            {
+                float gain{current[2][c]};
+                MixSamples({mid, headLen}, head[c].data()+OutPos, gain, gain, 0);
+                gain = current[3][c];
+                MixSamples({side, headLen}, head[c].data()+OutPos, gain, gain, 0);
+            }
+            inPos = headLen;
+            busPos = 0;
+        }
+    }
+    const size_t busLen{samplesToMix + padding - inPos};
+    MixSamples({mid+inPos, busLen}, BusBuffer, current[2].data(), target[2].data(), Counter,
+        busPos);
+    MixSamples({side+inPos, busLen}, BusBuffer, current[3].data(), target[3].data(), Counter,
+        busPos);
+    bus->mHasInput.store(true, std::memory_order_relaxed);
+
+    /* The fades always finish within the mix, so the W, X, and Y gains are
+     * now at their targets.
+     */
+    for(auto &chandata : chans.first(3))
+    {
+        DirectParams &parms = chandata.mDryParams;
+        if(IsAudible)
+            parms.Gains.Current = parms.Gains.Target;
+        else
+            parms.Gains.Current = SilentTarget;
+    }
+}
+
+/* Checks if the voice's current and target gains are all silent, for the
+ * direct output and any used sends. Culled voices are mixed toward silence
+ * regardless of their target gains, so only their current gains are checked.
+ */
+bool IsVoiceSilent(const Voice &voice, const uint NumSends) noexcept
+{
+    const bool culled{voice.mCulled.load(std::memory_order_relaxed)};
+    auto is_silent = [](const float gain) noexcept -> bool
+    { return !(std::abs(gain) > GainSilenceThreshold); };
+
+    const size_t numDirect{voice.mDirect.Buffer.size()};
+    for(const auto &chandata : voice.mChans)
+    {
+        const DirectParams &dryparms = chandata.mDryParams;
+        if(voice.mFlags.test(VoiceHasHrtf))
+        {
+            if(!is_silent(dryparms.Hrtf->Old.Gain)
+                || (!culled && !is_silent(dryparms.Hrtf->Target.Gain)))
+                return false;
+        }
+        else
+        {
+            if(!std::all_of(dryparms.Gains.Current.cbegin(),
+                    dryparms.Gains.Current.cbegin()+numDirect, is_silent)
+                || (!culled && !std::all_of(dryparms.Gains.Target.cbegin(),
+                    dryparms.Gains.Target.cbegin()+numDirect, is_silent)))
+                return false;
+        }
+
+        for(uint send{0};send < NumSends;++send)
+        {
+            const size_t numWet{voice.mSend[send].Buffer.size()};
+            const SendParams &wetparms = chandata.mWetParams[send];
+            if(!std::all_of(wetparms.Gains.Current.cbegin(),
+                    wetparms.Gains.Current.cbegin()+numWet, is_silent)
+                || (!culled && !std::all_of(wetparms.Gains.Target.cbegin(),
+                    wetparms.Gains.Target.cbegin()+numWet, is_silent)))
+                return false;
+        }
+    }
+    return true;
+}
+
 } // namespace
 
-void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds deviceTime,
-    const uint SamplesToDo)
+template<VoiceMixPath Path>
+void Voice::mixPath(const State vstate, ContextBase *Context, const nanoseconds deviceTime,
+    const uint SamplesToDo, VoiceMixScratch &Scratch)
 {
     static constexpr std::array<float,MAX_OUTPUT_CHANNELS> SilentTarget{};
 
     ASSUME(SamplesToDo > 0);
 
+    /* The specialized paths know the voice's channel count and output mode,
+     * letting the checks for them fold away. updateMixPath only selects one
+     * for a voice that matches.
+     */
+    constexpr bool Generic{Path == VoiceMixPath::Generic};
+    const size_t numChans{Generic ? mChans.size() : GetMixPathChannels(Path)};
+    const bool isAmbisonic{Generic ? mFlags.test(VoiceIsAmbisonic)
+        : (Path == VoiceMixPath::FirstOrderAmbi)};
+    const bool hasHrtf{Generic ? mFlags.test(VoiceHasHrtf) : (Path == VoiceMixPath::MonoHrtf)};
+    const bool hasNfc{Generic && mFlags.test(VoiceHasNfc)};
+    DecoderBase *decoder{Generic ? mDecoder.get() : nullptr};
+    const al::span<ChannelData> Chans{mChans.data(), numChans};
+
     DeviceBase *Device{Context->mDevice};
     const uint NumSends{Device->NumAuxSends};
 
@@ -729,6 +1063,7 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
     }
 
     uint OutPos{0u};
+    uint headSamples{0u};
 
     /* Check if we're doing a delayed start, and we start in this update. */
     if(mStartTime > deviceTime) UNLIKELY
@@ -751,34 +1086,91 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
          * should start at. Skip this update if it's beyond the output sample
          * count.
          *
-         * Round the start position to a multiple of 4, which some mixers want.
-         * This makes the start time accurate to 4 samples. This could be made
-         * sample-accurate by forcing non-SIMD functions on the first run.
+         * The mixers want the output position to be a multiple of 4, so start
+         * mixing at the multiple of 4 before it and pad the head with silence.
+         * This keeps the start time sample-accurate with the SIMD mixers.
          */
-        seconds::rep sampleOffset{duration_cast<seconds>(diff * Device->Frequency).count()};
-        sampleOffset = (sampleOffset+2) & ~seconds::rep{3};
+        const seconds::rep sampleOffset{duration_cast<seconds>(diff*Device->MixFrequency).count()};
         if(sampleOffset >= SamplesToDo)
             return;
 
-        OutPos = static_cast<uint>(sampleOffset);
+        OutPos = static_cast<uint>(sampleOffset) & ~3u;
+        headSamples = static_cast<uint>(sampleOffset) & 3u;
     }
 
-    /* Calculate the number of samples to mix, and the number of (resampled)
-     * samples that need to be loaded (mixing samples and decoder padding).
+    /* Calculate the number of samples to mix, the number of them that come
+     * from the source (not the silent head), and the number of (resampled)
+     * samples that need to be loaded (source samples and decoder padding).
      */
     const uint samplesToMix{SamplesToDo - OutPos};
-    const uint samplesToLoad{samplesToMix + mDecoderPadding};
+    const uint srcSamplesToMix{samplesToMix - headSamples};
+    const uint samplesToLoad{srcSamplesToMix + mDecoderPadding};
+
+    /* A playing voice that's currently silent, and was already faded out to
+     * that, becomes virtual and only needs its position and buffers updated.
+     * Callback voices need to keep reading from the callback, so continue to
+     * be mixed normally. Voices culled by the voice budget always become
+     * virtual once faded out.
+     */
+    if(vstate == Playing && (Device->mVirtualVoices || mCulled.load(std::memory_order_relaxed))
+        && !mFlags.test(VoiceIsCallback) && IsVoiceSilent(*this, NumSends))
+    {
+        if(!mFlags.test(VoiceIsVirtual))
+        {
+            /* The sample history will be outdated when the voice becomes
+             * audible again, so clear it to resume from silence as it fades
+             * in.
+             */
+            std::fill(mPrevSamples.begin(), mPrevSamples.end(), HistoryLine{});
+            mFlags.set(VoiceIsVirtual);
+        }
+        updatePosition(Context, DataPosInt, DataPosFrac, BufferListItem, BufferLoopItem,
+            srcSamplesToMix);
+        return;
+    }
+    mFlags.reset(VoiceIsVirtual);
 
     /* Get a span of pointers to hold the floating point, deinterlaced,
      * resampled buffer data to be mixed.
      */
-    std::array<float*,DeviceBase::MixerChannelsMax> SamplePointers;
-    const al::span<float*> MixingSamples{SamplePointers.data(), mChans.size()};
-    auto get_bufferline = [](DeviceBase::MixerBufferLine &bufline) noexcept -> float*
+    std::array<float*,VoiceMixScratch::MixerChannelsMax> SamplePointers;
+    const al::span<float*> MixingSamples{SamplePointers.data(), numChans};
+    auto get_bufferline = [](VoiceMixScratch::MixerBufferLine &bufline) noexcept -> float*
     { return bufline.data(); };
-    std::transform(Device->mSampleData.end() - mChans.size(), Device->mSampleData.end(),
+    std::transform(Scratch.mSampleData.end() - numChans, Scratch.mSampleData.end(),
         MixingSamples.begin(), get_bufferline);
 
+    /* ADPCM samples are loaded through this thread's decoded sample cache,
+     * which is cleared if any ADPCM buffer data was modified.
+     */
+    AdpcmCache *adpcmCache{nullptr};
+    if(mFmtType == FmtIMA4 || mFmtType == FmtMSADPCM)
+    {
+        adpcmCache = &Scratch.mAdpcmCache;
+        adpcmCache->sync(Device->mAdpcmGeneration.load(std::memory_order_acquire));
+    }
+
+    /* A non-looping static voice with a pitch step that needs resampling can
+     * get its resampled samples from this thread's cache, while it's at a
+     * position it would be at from playing the buffer from the start with
+     * this step (so voices playing it at a fixed pitch share the samples).
+     */
+    ResampleCache *resampleCache{nullptr};
+    uint64_t cacheOutOffset{0};
+    if(Scratch.mResampleCache.enabled() && mFlags.test(VoiceIsStatic) && BufferListItem
+        && !BufferLoopItem && BufferListItem->mCacheable && increment != MixerFracOne
+        && DataPosInt >= 0)
+    {
+        const uint64_t srcPos{(uint64_t{static_cast<uint>(DataPosInt)}<<MixerFracBits)
+            + DataPosFrac};
+        if((srcPos%increment) == 0)
+        {
+            resampleCache = &Scratch.mResampleCache;
+            resampleCache->sync(Device->mBufferGeneration.load(std::memory_order_acquire));
+            cacheOutOffset = srcPos / increment;
+        }
+    }
+
     /* If there's a matching sample step and no phase offset, use a simple copy
      * for resampling.
      */
@@ -790,16 +1182,205 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
     /* UHJ2 and SuperStereo only have 2 buffer channels, but 3 mixing channels
      * (3rd channel is generated from decoding).
      */
-    const size_t realChannels{(mFmtChannels == FmtUHJ2 || mFmtChannels == FmtSuperStereo) ? 2u
-        : MixingSamples.size()};
-    for(size_t chan{0};chan < realChannels;++chan)
+    const size_t realChannels{(Generic && (mFmtChannels == FmtUHJ2
+        || mFmtChannels == FmtSuperStereo)) ? 2u : MixingSamples.size()};
+
+    /* A ring buffer voice can play what was written to the ring as the mix
+     * starts, so every channel sees the same amount.
+     */
+    uint ringSamples{0u};
+    if(mFlags.test(VoiceIsRing) && BufferListItem)
+    {
+        const BufferRing &ring = *BufferListItem->mRing;
+        const uint readable{ring.readable(ring.mWritePos.load(std::memory_order_acquire),
+            ring.mReadPos.load(std::memory_order_relaxed))};
+        ringSamples = readable * mSamplesPerBlock;
+    }
+
+    /* A mono float voice, or any voice of a buffer converted to float planes,
+     * that doesn't need resampling can mix directly from its static buffer's
+     * storage, when the samples are all within the buffer (or loop) and
+     * aligned for the mixers. Nothing modifies the mixing samples in place for
+     * such a voice, as long as it doesn't need a silent head for a delayed
+     * start.
+     */
+    bool directMix{false};
+    const size_t planeSize{BufferListItem ? size_t{BufferListItem->mPlaneSize} : 0u};
+    if(mFlags.test(VoiceIsStatic) && BufferListItem
+        && (planeSize || (mFmtType == FmtFloat && mFrameStep == 1 && realChannels == 1))
+        && !decoder && !isAmbisonic
+        && increment == MixerFracOne && DataPosFrac == 0 && DataPosInt >= 0 && headSamples == 0)
     {
-        using ResBufType = decltype(DeviceBase::mResampleData);
+        const size_t dataEnd{BufferLoopItem ? BufferListItem->mLoopEnd
+            : BufferListItem->mSampleLen};
+        const size_t dataPos{static_cast<uint>(DataPosInt)};
+        auto *srcdata = reinterpret_cast<float*>(BufferListItem->mSamples) + dataPos;
+        if(dataPos + samplesToLoad + MaxResamplerEdge <= dataEnd
+            && (reinterpret_cast<uintptr_t>(srcdata)&15) == 0)
+        {
+            directMix = true;
+
+            const auto histStart = static_cast<int64_t>(dataPos + srcSamplesToMix)
+                - MaxResamplerEdge;
+            for(size_t chan{0};chan < realChannels;++chan)
+            {
+                MixingSamples[chan] = srcdata + chan*planeSize;
+
+                /* Store the samples around the end of the mix, in case the
+                 * next mix needs to resample them.
+                 */
+                if(vstate == Playing) LIKELY
+                    LoadStaticRange(mPrevSamples[chan].data(), BufferListItem, mFmtType, chan,
+                        mFrameStep, histStart, mPrevSamples[chan].size());
+            }
+        }
+    }
+
+    /* With low-precision mixing, a 16-bit static voice can resample straight
+     * from its buffer in Q15, when the samples it needs are all within the
+     * buffer (or loop). This skips converting them to float first.
+     */
+    Resampler16Func resample16{nullptr};
+    size_t q15Pos{0};
+    if(mResampler16 && !directMix && !resampleCache && mFmtType == FmtShort && !planeSize
+        && mFlags.test(VoiceIsStatic) && BufferListItem && DataPosInt >= 0 && headSamples == 0)
+    {
+        const size_t dataEnd{BufferLoopItem ? BufferListItem->mLoopEnd
+            : BufferListItem->mSampleLen};
+        q15Pos = static_cast<uint>(DataPosInt);
+        const uint64_t loadEnd{q15Pos + MaxResamplerEdge
+            + ((uint64_t{samplesToLoad}*increment + DataPosFrac) >> MixerFracBits)};
+        if(loadEnd <= dataEnd)
+            resample16 = (increment == MixerFracOne && DataPosFrac == 0)
+                ? PrepareResampler16(Resampler::Point) : mResampler16;
+    }
+
+    /* A static voice playing the same data as another voice in this mix, from
+     * the same position and with the same step and history, can share its
+     * loaded samples. Otherwise it loads into a new instance slot for later
+     * voices to share, as long as nothing modifies the samples in place.
+     */
+    VoiceInstanceCache::Slot *instance{nullptr};
+    bool haveSamples{directMix};
+    if(!haveSamples && !resampleCache && vstate == Playing && mFlags.test(VoiceIsStatic)
+        && BufferListItem && !decoder && !isAmbisonic && headSamples == 0
+        && realChannels == MixingSamples.size()
+        && realChannels <= VoiceInstanceCache::MaxChannels)
+    {
+        const uint format{(static_cast<uint>(mFmtType)<<16) | mFrameStep};
+        const uint numChannels{static_cast<uint>(realChannels)};
+        auto matches = [&](const VoiceInstanceCache::Slot &slot) noexcept -> bool
+        {
+            if(slot.mTime != deviceTime || slot.mData != BufferListItem->mSamples
+                || slot.mFormat != format || slot.mNumChannels != numChannels
+                || slot.mSampleLen != BufferListItem->mSampleLen
+                || slot.mLooping != (BufferLoopItem != nullptr)
+                || (BufferLoopItem && (slot.mLoopStart != BufferListItem->mLoopStart
+                    || slot.mLoopEnd != BufferListItem->mLoopEnd))
+                || slot.mPosInt != DataPosInt || slot.mPosFrac != DataPosFrac
+                || slot.mIncrement != increment || slot.mResampler != Resample
+                || std::memcmp(&slot.mResampleState, &mResampleState, sizeof(InterpState)) != 0
+                || slot.mSamplesToLoad != samplesToLoad)
+                return false;
+            for(size_t chan{0};chan < numChannels;++chan)
+            {
+                if(!std::equal(mPrevSamples[chan].cbegin(), mPrevSamples[chan].cend(),
+                    slot.mPrevBefore[chan].cbegin()))
+                    return false;
+            }
+            return true;
+        };
+
+        auto &slots = Scratch.mInstanceCache.mSlots;
+        auto slot = std::find_if(slots.begin(), slots.end(), matches);
+        if(slot != slots.end())
+        {
+            for(size_t chan{0};chan < numChannels;++chan)
+            {
+                MixingSamples[chan] = slot->mSamples[chan].data();
+                mPrevSamples[chan] = slot->mPrevAfter[chan];
+            }
+            haveSamples = true;
+            Device->mProfile.mInstancedVoices.fetch_add(1u, std::memory_order_relaxed);
+        }
+        else
+        {
+            auto &cache = Scratch.mInstanceCache;
+            instance = &slots[cache.mNextSlot];
+            cache.mNextSlot = (cache.mNextSlot+1) % VoiceInstanceCache::NumSlots;
+
+            instance->mTime = deviceTime;
+            instance->mData = BufferListItem->mSamples;
+            instance->mFormat = format;
+            instance->mNumChannels = numChannels;
+            instance->mSampleLen = BufferListItem->mSampleLen;
+            instance->mLooping = (BufferLoopItem != nullptr);
+            instance->mLoopStart = BufferListItem->mLoopStart;
+            instance->mLoopEnd = BufferListItem->mLoopEnd;
+            instance->mPosInt = DataPosInt;
+            instance->mPosFrac = DataPosFrac;
+            instance->mIncrement = increment;
+            instance->mResampler = Resample;
+            instance->mResampleState = mResampleState;
+            instance->mSamplesToLoad = samplesToLoad;
+            for(size_t chan{0};chan < numChannels;++chan)
+            {
+                instance->mPrevBefore[chan] = mPrevSamples[chan];
+                MixingSamples[chan] = instance->mSamples[chan].data();
+            }
+        }
+    }
+
+    if(!haveSamples && resample16)
+    {
+        const auto *srcdata = reinterpret_cast<const int16_t*>(BufferListItem->mSamples)
+            + q15Pos*mFrameStep;
+        const auto histStart = static_cast<int64_t>(q15Pos
+            + ((uint64_t{srcSamplesToMix}*increment + DataPosFrac) >> MixerFracBits))
+            - MaxResamplerEdge;
+
+        for(size_t chan{0};chan < realChannels;++chan)
+        {
+            resample16(srcdata+chan, mFrameStep, DataPosFrac, increment,
+                {MixingSamples[chan], samplesToLoad});
+
+            /* Store the samples around the end of the mix, in case the next
+             * mix needs to resample them.
+             */
+            if(vstate == Playing) LIKELY
+                LoadStaticRange(mPrevSamples[chan].data(), BufferListItem, mFmtType, chan,
+                    mFrameStep, histStart, mPrevSamples[chan].size());
+        }
+        haveSamples = true;
+    }
+
+    if(!haveSamples) for(size_t chan{0};chan < realChannels;++chan)
+    {
+        using ResBufType = decltype(VoiceMixScratch::mResampleData);
         static constexpr uint srcSizeMax{static_cast<uint>(ResBufType{}.size()-MaxResamplerEdge)};
 
         const al::span prevSamples{mPrevSamples[chan]};
+        if(resampleCache)
+        {
+            LoadResampledStatic(*resampleCache, {MixingSamples[chan], samplesToLoad},
+                BufferListItem, mFmtType, chan, mFrameStep, increment, cacheOutOffset,
+                Scratch.mResampleData);
+
+            /* Store the source samples around the end of the mix, in case the
+             * next mix needs to resample them itself.
+             */
+            if(vstate == Playing) LIKELY
+            {
+                const uint64_t endPos{(cacheOutOffset+srcSamplesToMix) * increment};
+                LoadStaticRange(prevSamples.data(), BufferListItem, mFmtType, chan, mFrameStep,
+                    static_cast<int64_t>(endPos>>MixerFracBits) - MaxResamplerEdge,
+                    prevSamples.size());
+            }
+            continue;
+        }
+
         const auto resampleBuffer = std::copy(prevSamples.cbegin(), prevSamples.cend(),
-            Device->mResampleData.begin()) - MaxResamplerEdge;
+            Scratch.mResampleData.begin()) - MaxResamplerEdge;
         int intPos{DataPosInt};
         uint fracPos{DataPosFrac};
 
@@ -893,7 +1474,8 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
 
                 if(mFlags.test(VoiceIsStatic))
                     LoadBufferStatic(BufferListItem, BufferLoopItem, uintPos, mFmtType, chan,
-                        mFrameStep, srcSampleDelay, srcBufferSize, al::to_address(resampleBuffer));
+                        mFrameStep, srcSampleDelay, srcBufferSize, al::to_address(resampleBuffer),
+                        adpcmCache);
                 else if(mFlags.test(VoiceIsCallback))
                 {
                     const uint callbackBase{mCallbackBlockBase * mSamplesPerBlock};
@@ -921,9 +1503,16 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
                     LoadBufferCallback(BufferListItem, bufferOffset, numSamples, mFmtType, chan,
                         mFrameStep, srcSampleDelay, srcBufferSize, al::to_address(resampleBuffer));
                 }
+                else if(mFlags.test(VoiceIsRing))
+                {
+                    const size_t bufferOffset{uintPos - mCallbackBlockBase*mSamplesPerBlock};
+                    LoadBufferRing(BufferListItem, bufferOffset, ringSamples, mFmtType, chan,
+                        mFrameStep, srcSampleDelay, srcBufferSize, al::to_address(resampleBuffer));
+                }
                 else
                     LoadBufferQueue(BufferListItem, BufferLoopItem, uintPos, mFmtType, chan,
-                        mFrameStep, srcSampleDelay, srcBufferSize, al::to_address(resampleBuffer));
+                        mFrameStep, srcSampleDelay, srcBufferSize, al::to_address(resampleBuffer),
+                        adpcmCache);
             }
 
             Resample(&mResampleState, al::to_address(resampleBuffer), fracPos, increment,
@@ -936,9 +1525,9 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
                  * gets loaded for decoder padding.
                  */
                 const uint loadEnd{samplesLoaded + dstBufferSize};
-                if(samplesToMix > samplesLoaded && samplesToMix <= loadEnd) LIKELY
+                if(srcSamplesToMix > samplesLoaded && srcSamplesToMix <= loadEnd) LIKELY
                 {
-                    const size_t dstOffset{samplesToMix - samplesLoaded};
+                    const size_t dstOffset{srcSamplesToMix - samplesLoaded};
                     const size_t srcOffset{(dstOffset*increment + fracPos) >> MixerFracBits};
                     std::copy_n(resampleBuffer-MaxResamplerEdge+srcOffset, prevSamples.size(),
                         prevSamples.begin());
@@ -963,35 +1552,75 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
             }
         }
     }
+    if(instance)
+    {
+        for(size_t chan{0};chan < instance->mNumChannels;++chan)
+            instance->mPrevAfter[chan] = mPrevSamples[chan];
+    }
     for(auto &samples : MixingSamples.subspan(realChannels))
         std::fill_n(samples, samplesToLoad, 0.0f);
 
-    if(mDecoder)
-        mDecoder->decode(MixingSamples, samplesToMix, (vstate==Playing));
+    /* Move the loaded samples after the silent head, for a delayed start that
+     * isn't on a multiple of 4.
+     */
+    if(headSamples > 0) UNLIKELY
+    {
+        for(auto &samples : MixingSamples)
+        {
+            std::copy_backward(samples, samples+samplesToLoad, samples+samplesToLoad+headSamples);
+            std::fill_n(samples, headSamples, 0.0f);
+        }
+    }
+
+    /* Super Stereo voices using the device's shared phase-shift bus only need
+     * to be decoded to B-Format for any sends. Voices in a source group are
+     * decoded normally for the group's buffer.
+     */
+    const bool useStereoBus{Generic && mFlags.test(VoiceUsesStereoBus)
+        && !mFlags.test(VoiceInGroup)};
+    float *midSamples{Scratch.mSampleData[0].data()};
+    float *sideSamples{Scratch.mSampleData[1].data()};
+    if(useStereoBus)
+    {
+        const bool hasSends{std::any_of(mSend.cbegin(), mSend.cbegin()+NumSends,
+            [](const TargetData &send) noexcept { return !send.Buffer.empty(); })};
+        decoder->decodeMidSide(MixingSamples, midSamples, sideSamples, samplesToMix,
+            (vstate==Playing), hasSends);
+    }
+    else if(decoder)
+        decoder->decode(MixingSamples, samplesToMix, (vstate==Playing));
 
-    if(mFlags.test(VoiceIsAmbisonic))
+    if(isAmbisonic)
     {
-        auto voiceSamples = MixingSamples.begin();
-        for(auto &chandata : mChans)
+        std::array<BandSplitter*,VoiceMixScratch::MixerChannelsMax> splitters;
+        std::array<float,VoiceMixScratch::MixerChannelsMax> hfscales, lfscales;
+        for(size_t c{0};c < numChans;++c)
         {
-            chandata.mAmbiSplitter.processScale({*voiceSamples, samplesToMix},
-                chandata.mAmbiHFScale, chandata.mAmbiLFScale);
-            ++voiceSamples;
+            splitters[c] = &Chans[c].mAmbiSplitter;
+            hfscales[c] = Chans[c].mAmbiHFScale;
+            lfscales[c] = Chans[c].mAmbiLFScale;
         }
+        BandSplitter::processScaleBatch({splitters.data(), numChans}, MixingSamples,
+            {hfscales.data(), numChans}, {lfscales.data(), numChans}, samplesToMix);
     }
 
+    /* Stopping voices and voices culled by the voice budget fade to silence. */
+    const bool IsAudible{vstate == Playing && !mCulled.load(std::memory_order_relaxed)};
     const uint Counter{mFlags.test(VoiceIsFading) ? minu(samplesToMix, 64u) : 0u};
     if(!Counter)
     {
         /* No fading, just overwrite the old/current params. */
-        for(auto &chandata : mChans)
+        for(auto &chandata : Chans)
         {
             {
                 DirectParams &parms = chandata.mDryParams;
-                if(!mFlags.test(VoiceHasHrtf))
+                if(!hasHrtf)
                     parms.Gains.Current = parms.Gains.Target;
                 else
-                    parms.Hrtf.Old = parms.Hrtf.Target;
+                {
+                    parms.Hrtf->Old = parms.Hrtf->Target;
+                    parms.Hrtf->Changed = false;
+                }
             }
             for(uint send{0};send < NumSends;++send)
             {
@@ -999,39 +1628,121 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
                     continue;
 
                 SendParams &parms = chandata.mWetParams[send];
-                parms.Gains.Current = parms.Gains.Target;
+                std::copy(parms.Gains.Target.begin(), parms.Gains.Target.end(),
+                    parms.Gains.Current.begin());
             }
         }
     }
 
-    auto voiceSamples = MixingSamples.begin();
-    for(auto &chandata : mChans)
+    /* Get this thread's copy of the output buffers to mix to. A cluster's
+     * send lines are with its dry line in the device's mixing buffer, and a
+     * source group's buffer has its copies after it like a wet buffer.
+     */
+    const al::span<FloatBufferLine> DirectBuffer{mFlags.test(VoiceInGroup)
+        ? Scratch.getWetTarget(mDirect.Buffer) : Scratch.getDryTarget(mDirect.Buffer)};
+    std::array<al::span<FloatBufferLine>,MAX_SENDS> SendBuffers;
+    const bool clustered{mFlags.test(VoiceIsClustered)};
+    for(uint send{0};send < NumSends;++send)
+        SendBuffers[send] = clustered ? Scratch.getDryTarget(mSend[send].Buffer)
+            : Scratch.getWetTarget(mSend[send].Buffer);
+
+    if(mFlags.test(VoiceGainsChanged))
     {
-        /* Now filter and mix to the appropriate outputs. */
-        const al::span<float,BufferLineSize> FilterBuf{Device->FilteredData};
+        /* A channel only needs mixing to the outputs it's audible on or still
+         * fading on, which is often just a couple of many.
+         */
+        const size_t numOuts{DirectBuffer.size()};
+        for(auto &chandata : Chans)
         {
             DirectParams &parms = chandata.mDryParams;
-            const float *samples{DoFilters(parms.LowPass, parms.HighPass, FilterBuf.data(),
-                {*voiceSamples, samplesToMix}, mDirect.FilterType)};
+            uint count{0};
+            for(size_t c{0};c < numOuts;++c)
+            {
+                const float cur{parms.Gains.Current[c]};
+                const float target{parms.Gains.Target[c]};
+                if(cur != target || std::abs(target) > GainSilenceThreshold)
+                    parms.ActiveChans[count++] = static_cast<uint8_t>(c);
+            }
+            parms.NumActiveChans = count;
+        }
+        mFlags.reset(VoiceGainsChanged);
+    }
 
-            if(mFlags.test(VoiceHasHrtf))
+    /* Now filter and mix to the appropriate outputs. The filters for each
+     * channel's direct and send outputs are independent, so they're gathered
+     * into batches to process together before mixing.
+     */
+    struct PendingMix {
+        ChannelData *chandata;
+        uint send; /* MAX_SENDS for the direct output. */
+        const float *samples;
+    };
+    constexpr size_t MaxPending{BiquadFilter::MaxBatch};
+    static_assert(MaxPending <= VoiceMixScratch::FilterLinesMax, "Not enough filter lines");
+    std::array<PendingMix,MaxPending> pending;
+    size_t numPending{0};
+    FilterBatch filters;
+
+    auto mix_pending = [&]()
+    {
+        filters.process(samplesToMix);
+        for(const PendingMix &mix : al::span{pending}.first(numPending))
+        {
+            if(mix.send == MAX_SENDS)
             {
-                const float TargetGain{parms.Hrtf.Target.Gain * (vstate == Playing)};
-                DoHrtfMix(samples, samplesToMix, parms, TargetGain, Counter, OutPos,
-                    (vstate == Playing), Device);
+                DirectParams &parms = mix.chandata->mDryParams;
+                if(hasHrtf)
+                {
+                    const float TargetGain{parms.Hrtf->Target.Gain * IsAudible};
+                    DoHrtfMix(mix.samples, samplesToMix, parms, TargetGain, Counter, OutPos,
+                        (vstate == Playing), Device, Scratch);
+                }
+                else
+                {
+                    const float *TargetGains{IsAudible ? parms.Gains.Target.data()
+                        : SilentTarget.data()};
+                    if(hasNfc)
+                        DoNfcMix({mix.samples, samplesToMix}, DirectBuffer.data(), parms,
+                            TargetGains, Counter, OutPos, Device, Scratch);
+                    else if(parms.NumActiveChans < DirectBuffer.size())
+                    {
+                        for(const uint c : al::span{parms.ActiveChans}.first(parms.NumActiveChans))
+                            MixSamples({mix.samples, samplesToMix}, DirectBuffer[c].data()+OutPos,
+                                parms.Gains.Current[c], TargetGains[c], Counter);
+                    }
+                    else
+                        MixSamples({mix.samples, samplesToMix}, DirectBuffer,
+                            parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+                }
             }
             else
             {
-                const float *TargetGains{(vstate == Playing) ? parms.Gains.Target.data()
+                SendParams &parms = mix.chandata->mWetParams[mix.send];
+                const float *TargetGains{IsAudible ? parms.Gains.Target.data()
                     : SilentTarget.data()};
-                if(mFlags.test(VoiceHasNfc))
-                    DoNfcMix({samples, samplesToMix}, mDirect.Buffer.data(), parms,
-                        TargetGains, Counter, OutPos, Device);
-                else
-                    MixSamples({samples, samplesToMix}, mDirect.Buffer,
-                        parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+                MixSamples({mix.samples, samplesToMix}, SendBuffers[mix.send],
+                    parms.Gains.Current.data(), TargetGains, Counter, OutPos);
             }
         }
+        numPending = 0;
+    };
+    auto add_pending = [&](ChannelData &chandata, const uint send, BiquadFilter &lpfilter,
+        BiquadFilter &hpfilter, const float *src, const int type)
+    {
+        float *dst{Scratch.FilteredData[numPending].data()};
+        const float *samples{filters.add(lpfilter, hpfilter, dst, src, type)};
+        pending[numPending++] = PendingMix{&chandata, send, samples};
+        if(numPending == MaxPending)
+            mix_pending();
+    };
+
+    auto voiceSamples = MixingSamples.begin();
+    for(auto &chandata : Chans)
+    {
+        DirectParams &dryparms = chandata.mDryParams;
+        if(!useStereoBus)
+            add_pending(chandata, MAX_SENDS, dryparms.LowPass, dryparms.HighPass,
+                *voiceSamples, mDirect.FilterType);
 
         for(uint send{0};send < NumSends;++send)
         {
@@ -1039,17 +1750,28 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
                 continue;
 
             SendParams &parms = chandata.mWetParams[send];
-            const float *samples{DoFilters(parms.LowPass, parms.HighPass, FilterBuf.data(),
-                {*voiceSamples, samplesToMix}, mSend[send].FilterType)};
-
-            const float *TargetGains{(vstate == Playing) ? parms.Gains.Target.data()
-                : SilentTarget.data()};
-            MixSamples({samples, samplesToMix}, mSend[send].Buffer,
-                parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+            add_pending(chandata, send, parms.LowPass, parms.HighPass, *voiceSamples,
+                mSend[send].FilterType);
         }
 
         ++voiceSamples;
     }
+    if(numPending > 0)
+        mix_pending();
+
+    if(useStereoBus)
+    {
+        /* The S and D signals use the W and X channels' direct filters. */
+        UhjStereoBusBase *bus{Device->mUhjStereoBus.get()};
+        FilterWithPadding(mChans[0].mDryParams.LowPass, mChans[0].mDryParams.HighPass,
+            midSamples, samplesToMix, bus->mPadding, mDirect.FilterType);
+        FilterWithPadding(mChans[1].mDryParams.LowPass, mChans[1].mDryParams.HighPass,
+            sideSamples, samplesToMix, bus->mPadding, mDirect.FilterType);
+        DoStereoBusMix(mChans, midSamples, sideSamples, IsAudible,
+            !mFlags.test(VoiceStereoBusStarted), Counter, OutPos, samplesToMix, DirectBuffer,
+            bus, Scratch.mThreadIndex);
+        mFlags.set(VoiceStereoBusStarted);
+    }
 
     mFlags.set(VoiceIsFading);
 
@@ -1060,8 +1782,51 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
         return;
     }
 
+    updatePosition(Context, DataPosInt, DataPosFrac, BufferListItem, BufferLoopItem,
+        srcSamplesToMix);
+}
+
+void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds deviceTime,
+    const uint SamplesToDo, VoiceMixScratch &Scratch)
+{ (this->*mMixFunc)(vstate, Context, deviceTime, SamplesToDo, Scratch); }
+
+void Voice::updateMixPath() noexcept
+{
+    VoiceMixPath path{VoiceMixPath::Generic};
+    if(!mDecoder && !mFlags.test(VoiceHasNfc))
+    {
+        if(mFlags.test(VoiceIsAmbisonic))
+        {
+            if(mChans.size() == GetMixPathChannels(VoiceMixPath::FirstOrderAmbi))
+                path = VoiceMixPath::FirstOrderAmbi;
+        }
+        else if(mChans.size() == 1)
+            path = mFlags.test(VoiceHasHrtf) ? VoiceMixPath::MonoHrtf : VoiceMixPath::MonoPanned;
+        else if(mChans.size() == 2 && !mFlags.test(VoiceHasHrtf))
+            path = VoiceMixPath::StereoPanned;
+    }
+
+    switch(path)
+    {
+    case VoiceMixPath::Generic: mMixFunc = &Voice::mixPath<VoiceMixPath::Generic>; break;
+    case VoiceMixPath::MonoPanned: mMixFunc = &Voice::mixPath<VoiceMixPath::MonoPanned>; break;
+    case VoiceMixPath::MonoHrtf: mMixFunc = &Voice::mixPath<VoiceMixPath::MonoHrtf>; break;
+    case VoiceMixPath::StereoPanned:
+        mMixFunc = &Voice::mixPath<VoiceMixPath::StereoPanned>;
+        break;
+    case VoiceMixPath::FirstOrderAmbi:
+        mMixFunc = &Voice::mixPath<VoiceMixPath::FirstOrderAmbi>;
+        break;
+    }
+}
+
+void Voice::updatePosition(ContextBase *Context, int DataPosInt, uint DataPosFrac,
+    VoiceBufferItem *BufferListItem, VoiceBufferItem *BufferLoopItem, const uint samplesDone)
+{
+    const uint increment{mStep};
+
     /* Update voice positions and buffers as needed. */
-    DataPosFrac += increment*samplesToMix;
+    DataPosFrac += increment*samplesDone;
     const uint SrcSamplesDone{DataPosFrac>>MixerFracBits};
     DataPosInt  += SrcSamplesDone;
     DataPosFrac &= MixerFracMask;
@@ -1112,6 +1877,32 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
                 mCallbackBlockBase += blocksDone;
             }
         }
+        else if(mFlags.test(VoiceIsRing))
+        {
+            /* Handle ring buffer source, giving the played blocks back to the
+             * app. Like a buffer queue running out, the source stops once it
+             * plays everything that was written, unless the ring is being
+             * prefetched from a callback that hasn't ended yet.
+             */
+            BufferRing &ring = *BufferListItem->mRing;
+            const uint currentBlock{static_cast<uint>(DataPosInt) / mSamplesPerBlock};
+            const uint blocksDone{currentBlock - mCallbackBlockBase};
+            const bool ended{!ring.mPrefetch || ring.mEnded.load(std::memory_order_acquire)};
+            const uint readPos{ring.mReadPos.load(std::memory_order_relaxed)};
+            const uint readable{ring.readable(ring.mWritePos.load(std::memory_order_acquire),
+                readPos)};
+            if(blocksDone < readable)
+                ring.mReadPos.store(ring.advance(readPos, blocksDone), std::memory_order_release);
+            else
+            {
+                ring.mReadPos.store(ring.advance(readPos, readable), std::memory_order_release);
+                if(ended)
+                    BufferListItem = nullptr;
+                else if(blocksDone > readable)
+                    ring.mUnderruns.fetch_add(1u, std::memory_order_relaxed);
+            }
+            mCallbackBlockBase += blocksDone;
+        }
         else
         {
             /* Handle streaming source */
@@ -1132,20 +1923,28 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
     const uint SourceID{mSourceID.load(std::memory_order_relaxed)};
 
     /* Update voice info */
+    IncrementRef(mPositionCount);
     mPosition.store(DataPosInt, std::memory_order_relaxed);
     mPositionFrac.store(DataPosFrac, std::memory_order_relaxed);
     mCurrentBuffer.store(BufferListItem, std::memory_order_relaxed);
-    if(!BufferListItem)
+    if(BufferListItem)
+    {
+        if(buffers_done > 0)
+            mBufferSerial.store(BufferListItem->mSerial, std::memory_order_relaxed);
+    }
+    else
     {
         mLoopBuffer.store(nullptr, std::memory_order_relaxed);
         mSourceID.store(0u, std::memory_order_relaxed);
     }
+    IncrementRef(mPositionCount);
     std::atomic_thread_fence(std::memory_order_release);
 
     /* Send any events now, after the position/buffer info was updated. */
     const auto enabledevt = Context->mEnabledEvts.load(std::memory_order_acquire);
     if(buffers_done > 0 && enabledevt.test(al::to_underlying(AsyncEnableBits::BufferCompleted)))
     {
+        EventWriteLock evtlock{Context};
         RingBuffer *ring{Context->mAsyncEvents.get()};
         auto evt_vec = ring->getWriteVector();
         if(evt_vec.first.len > 0)
@@ -1153,10 +1952,49 @@ void Voice::mix(const State vstate, ContextBase *Context, const nanoseconds devi
             auto &evt = InitAsyncEvent<AsyncBufferCompleteEvent>(evt_vec.first.buf);
             evt.mId = SourceID;
             evt.mCount = buffers_done;
+            evt.mTime = Context->mDevice->getMixClockTime();
             ring->writeAdvance(1);
         }
     }
 
+    /* Check a non-looping streaming queue against its low watermark, sending
+     * one event when the remaining duration drops below it. The event is re-
+     * armed once enough is queued to bring it back above.
+     */
+    const uint watermark{mLowWatermark.load(std::memory_order_relaxed)};
+    if(watermark > 0 && BufferListItem && !BufferLoopItem
+        && !mFlags.test(VoiceIsStatic) && !mFlags.test(VoiceIsCallback)
+        && !mFlags.test(VoiceIsRing))
+    {
+        uint64_t remaining{BufferListItem->mSampleLen
+            - minu(BufferListItem->mSampleLen, static_cast<uint>(maxi(DataPosInt, 0)))};
+        auto *item = BufferListItem->mNext.load(std::memory_order_acquire);
+        for(;item;item = item->mNext.load(std::memory_order_acquire))
+            remaining += item->mSampleLen;
+
+        const uint64_t threshold{uint64_t{watermark} * mFrequency / 1000u};
+        if(remaining >= threshold)
+            mLowWatermarkSent = false;
+        else if(!mLowWatermarkSent)
+        {
+            mLowWatermarkSent = true;
+            if(enabledevt.test(al::to_underlying(AsyncEnableBits::QueueLowWatermark)))
+            {
+                EventWriteLock evtlock{Context};
+                RingBuffer *ring{Context->mAsyncEvents.get()};
+                auto evt_vec = ring->getWriteVector();
+                if(evt_vec.first.len > 0)
+                {
+                    auto &evt = InitAsyncEvent<AsyncQueueLowEvent>(evt_vec.first.buf);
+                    evt.mId = SourceID;
+                    evt.mRemaining = static_cast<uint>(remaining * 1000u / mFrequency);
+                    evt.mTime = Context->mDevice->getMixClockTime();
+                    ring->writeAdvance(1);
+                }
+            }
+        }
+    }
+
     if(!BufferListItem)
     {
         /* If the voice just ended, set it to Stopping so the next render
@@ -1175,11 +2013,11 @@ void Voice::prepare(DeviceBase *device)
      */
     uint num_channels{(mFmtChannels == FmtUHJ2 || mFmtChannels == FmtSuperStereo) ? 3 :
         ChannelsFromFmt(mFmtChannels, minu(mAmbiOrder, device->mAmbiOrder))};
-    if(num_channels > device->mSampleData.size()) UNLIKELY
+    if(num_channels > VoiceMixScratch::MixerChannelsMax) UNLIKELY
     {
         ERR("Unexpected channel count: %u (limit: %zu, %d:%d)\n", num_channels,
-            device->mSampleData.size(), mFmtChannels, mAmbiOrder);
-        num_channels = static_cast<uint>(device->mSampleData.size());
+            VoiceMixScratch::MixerChannelsMax, mFmtChannels, mAmbiOrder);
+        num_channels = static_cast<uint>(VoiceMixScratch::MixerChannelsMax);
     }
     if(mChans.capacity() > 2 && num_channels < mChans.capacity())
     {
@@ -1191,9 +2029,40 @@ void Voice::prepare(DeviceBase *device)
     mPrevSamples.reserve(maxu(2, num_channels));
     mPrevSamples.resize(num_channels);
 
-    mDecoder = nullptr;
-    mDecoderPadding = 0;
-    if(mFmtChannels == FmtSuperStereo)
+    /* Each channel gets a set of send parameters for each of the device's
+     * sends, with a current and target gain for each wet buffer channel.
+     */
+    const size_t num_sends{device->NumAuxSends};
+    const size_t num_wetchans{AmbiChannelsFromOrder(device->mAmbiOrder)};
+    const size_t num_params{num_channels * num_sends};
+    if(mWetParamStore.capacity() > num_params)
+    {
+        decltype(mWetParamStore){}.swap(mWetParamStore);
+        decltype(mWetGainStore){}.swap(mWetGainStore);
+    }
+    mWetParamStore.assign(num_params, SendParams{});
+    mWetGainStore.assign(num_params * num_wetchans * 2, 0.0f);
+    auto wetparams = mWetParamStore.begin();
+    auto wetgains = mWetGainStore.begin();
+    for(auto &chandata : mChans)
+    {
+        chandata.mWetParams = {al::to_address(wetparams), num_sends};
+        for(SendParams &params : chandata.mWetParams)
+        {
+            params.Gains.Current = {al::to_address(wetgains), num_wetchans};
+            wetgains += static_cast<ptrdiff_t>(num_wetchans);
+            params.Gains.Target = {al::to_address(wetgains), num_wetchans};
+            wetgains += static_cast<ptrdiff_t>(num_wetchans);
+        }
+        wetparams += static_cast<ptrdiff_t>(num_sends);
+    }
+
+    /* A decoder kept from the last play of the same kind of format only needs
+     * its history cleared.
+     */
+    if(mDecoder && IsUHJ(mFmtChannels) && mStereoDecoder == (mFmtChannels == FmtSuperStereo))
+        mDecoder->clear();
+    else if(mFmtChannels == FmtSuperStereo)
     {
         switch(UhjDecodeQuality)
         {
@@ -1229,11 +2098,21 @@ void Voice::prepare(DeviceBase *device)
             break;
         }
     }
+    else
+    {
+        mDecoder = nullptr;
+        mDecoderPadding = 0;
+    }
+    mStereoDecoder = (mFmtChannels == FmtSuperStereo);
 
     /* Clear the stepping value explicitly so the mixer knows not to mix this
      * until the update gets applied.
      */
     mStep = 0;
+    mLod = VoiceLod::Full;
+    mClusterCell = NoSpatialCluster;
+    mSpatialCluster = NoSpatialCluster;
+    mFlags.reset(VoiceIsClustered).reset(VoiceInGroup).set(VoiceGainsChanged);
 
     /* Make sure the sample history is cleared. */
     std::fill(mPrevSamples.begin(), mPrevSamples.end(), HistoryLine{});
@@ -1252,7 +2131,7 @@ void Voice::prepare(DeviceBase *device)
          * Note this isn't needed with UHJ output (UHJ2->B-Format->UHJ2 is
          * identity, so don't mess with it).
          */
-        const BandSplitter splitter{device->mXOverFreq / static_cast<float>(device->Frequency)};
+        const BandSplitter splitter{device->mXOverFreq / static_cast<float>(device->MixFrequency)};
         for(auto &chandata : mChans)
         {
             chandata.mAmbiHFScale = 1.0f;
@@ -1260,7 +2139,6 @@ void Voice::prepare(DeviceBase *device)
             chandata.mAmbiSplitter = splitter;
             chandata.mDryParams = DirectParams{};
             chandata.mDryParams.NFCtrlFilter = device->mNFCtrlFilter;
-            std::fill_n(chandata.mWetParams.begin(), device->NumAuxSends, SendParams{});
         }
         mChans[0].mAmbiLFScale = DecoderBase::sWLFScale;
         mChans[1].mAmbiLFScale = DecoderBase::sXYLFScale;
@@ -1277,7 +2155,7 @@ void Voice::prepare(DeviceBase *device)
         const auto scales = AmbiScale::GetHFOrderScales(mAmbiOrder, device->mAmbiOrder,
             device->m2DMixing);
 
-        const BandSplitter splitter{device->mXOverFreq / static_cast<float>(device->Frequency)};
+        const BandSplitter splitter{device->mXOverFreq / static_cast<float>(device->MixFrequency)};
         for(auto &chandata : mChans)
         {
             chandata.mAmbiHFScale = scales[*(OrderFromChan++)];
@@ -1285,7 +2163,6 @@ void Voice::prepare(DeviceBase *device)
             chandata.mAmbiSplitter = splitter;
             chandata.mDryParams = DirectParams{};
             chandata.mDryParams.NFCtrlFilter = device->mNFCtrlFilter;
-            std::fill_n(chandata.mWetParams.begin(), device->NumAuxSends, SendParams{});
         }
         mFlags.set(VoiceIsAmbisonic);
     }
@@ -1295,8 +2172,35 @@ void Voice::prepare(DeviceBase *device)
         {
             chandata.mDryParams = DirectParams{};
             chandata.mDryParams.NFCtrlFilter = device->mNFCtrlFilter;
-            std::fill_n(chandata.mWetParams.begin(), device->NumAuxSends, SendParams{});
         }
         mFlags.reset(VoiceIsAmbisonic);
     }
+
+    /* Super Stereo voices can use the device's shared phase-shift bus, unless
+     * they need per-channel HF scaling, which the bus can't apply.
+     */
+    mFlags.reset(VoiceUsesStereoBus).reset(VoiceStereoBusStarted);
+    if(mFmtChannels == FmtSuperStereo && device->mUhjStereoBus
+        && !mFlags.test(VoiceIsAmbisonic))
+        mFlags.set(VoiceUsesStereoBus);
+
+    /* Only non-ambisonic voices on an HRTF device mix with HRTF, so others
+     * don't need the (large) HRTF filter state.
+     */
+    if(device->mRenderMode == RenderMode::Hrtf && !IsAmbisonic(mFmtChannels))
+    {
+        mHrtfStore.assign(num_channels, DirectHrtfParams{});
+        auto hrtfparams = mHrtfStore.begin();
+        for(auto &chandata : mChans)
+            chandata.mDryParams.Hrtf = al::to_address(hrtfparams++);
+    }
+    else
+        decltype(mHrtfStore){}.swap(mHrtfStore);
+
+    mMemory.set(device->mMemoryStats, MemCategory::Voices,
+        mPrevSamples.capacity()*sizeof(HistoryLine) + mChans.capacity()*sizeof(ChannelData)
+        + mWetParamStore.capacity()*sizeof(SendParams) + mWetGainStore.capacity()*sizeof(float)
+        + mHrtfStore.capacity()*sizeof(DirectHrtfParams));
+
+    updateMixPath();
 }
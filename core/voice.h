@@ -12,12 +12,14 @@
 
 #include "almalloc.h"
 #include "alspan.h"
+#include "atomic.h"
 #include "bufferline.h"
 #include "buffer_storage.h"
 #include "devformat.h"
 #include "filters/biquad.h"
 #include "filters/nfc.h"
 #include "filters/splitter.h"
+#include "memory_stats.h"
 #include "mixer/defs.h"
 #include "mixer/hrtfdefs.h"
 #include "resampler_limits.h"
@@ -27,6 +29,8 @@
 struct ContextBase;
 struct DeviceBase;
 struct EffectSlot;
+struct SourceGroup;
+struct VoiceMixScratch;
 enum class DistanceModel : unsigned char;
 
 using uint = unsigned int;
@@ -59,31 +63,58 @@ enum {
 };
 
 
+struct DirectHrtfParams {
+    HrtfFilter Old;
+    HrtfFilter Target;
+    alignas(16) std::array<float,HrtfHistoryLength> History;
+
+    /* The HRTF, direction, distance, and spread the target filter was made
+     * for, so small moves can keep using it.
+     */
+    uint HrtfId{0u};
+    std::array<float,3> Dir{};
+    float Distance{0.0f};
+    float Spread{0.0f};
+
+    /* Set when the target filter is replaced, for the mixer to blend to it. */
+    bool Changed{false};
+};
+
 struct DirectParams {
     BiquadFilter LowPass;
     BiquadFilter HighPass;
 
     NfcFilter NFCtrlFilter;
 
-    struct {
-        HrtfFilter Old;
-        HrtfFilter Target;
-        alignas(16) std::array<float,HrtfHistoryLength> History;
-    } Hrtf;
-
     struct {
         std::array<float,MAX_OUTPUT_CHANNELS> Current;
         std::array<float,MAX_OUTPUT_CHANNELS> Target;
     } Gains;
+
+    /* The output channels with an audible current or target gain, so sources
+     * panned to only a few of many outputs don't mix silence to the rest.
+     * Rebuilt when the gains are recalculated.
+     */
+    std::array<uint8_t,MAX_OUTPUT_CHANNELS> ActiveChans;
+    uint NumActiveChans{0};
+
+    /* The HRTF filters and history are by far the largest part, and are only
+     * used when mixing with HRTF, so they're kept in the voice's HRTF store
+     * and only set for voices that can use them.
+     */
+    DirectHrtfParams *Hrtf{nullptr};
 };
 
 struct SendParams {
     BiquadFilter LowPass;
     BiquadFilter HighPass;
 
+    /* Refers to the voice's gain storage, with one gain per wet buffer
+     * channel.
+     */
     struct {
-        std::array<float,MaxAmbiChannels> Current;
-        std::array<float,MaxAmbiChannels> Target;
+        al::span<float> Current;
+        al::span<float> Target;
     } Gains;
 };
 
@@ -94,12 +125,53 @@ struct VoiceBufferItem {
     CallbackType mCallback{nullptr};
     void *mUserData{nullptr};
 
+    BufferRing *mRing{nullptr};
+
     uint mBlockAlign{0u};
     uint mSampleLen{0u};
     uint mLoopStart{0u};
     uint mLoopEnd{0u};
+    /* Set for samples stored as float planes (see BufferStorage). */
+    uint mPlaneSize{0u};
+    /* Counts up as items are added to a queue, so the number of items between
+     * two can be found without walking it.
+     */
+    uint mSerial{0u};
 
     std::byte *mSamples{nullptr};
+
+    /* Set if the decoded or resampled samples can be cached, which needs the
+     * data to only change through calls that invalidate the cache.
+     */
+    bool mCacheable{false};
+};
+
+
+/* Parameters the mixer can ramp to a new value over time. Each send has a Gain
+ * and GainHF ramp, in order, after RampSendGain.
+ */
+enum : size_t {
+    RampGain,
+    RampPitch,
+    RampDirectGain,
+    RampDirectGainHF,
+    RampSendGain,
+
+    NumRampParams = RampSendGain + MAX_SENDS*2
+};
+
+enum class RampCurve : unsigned char {
+    Linear,
+    Exponential
+};
+
+/* A ramp of a parameter to its value in the props. The mixer starts a new one
+ * from the parameter's current value when the serial changes.
+ */
+struct ParamRamp {
+    float Duration{0.0f}; /* In seconds, 0 to change immediately. */
+    RampCurve Curve{RampCurve::Linear};
+    uint Serial{0u};
 };
 
 
@@ -124,6 +196,7 @@ struct VoiceProps {
     Resampler mResampler;
     DirectMode DirectChannels;
     SpatializeMode mSpatializeMode;
+    int Priority;
 
     bool DryGainHFAuto;
     bool WetGainAuto;
@@ -155,8 +228,44 @@ struct VoiceProps {
         float GainLF;
         float LFReference;
     } Send[MAX_SENDS];
+
+    /* The source group the voice's direct output is submixed in, if any. */
+    SourceGroup *Group;
+
+    std::array<ParamRamp,NumRampParams> Ramps;
+};
+
+/* The paths voices can be mixed with. Common voice configurations get a path
+ * specialized for them, which knows the channel count and output mode at
+ * compile time. Anything else uses the generic path.
+ */
+enum class VoiceMixPath : uint8_t {
+    Generic,
+    /* Mono voices panned to the output, without near-field control. */
+    MonoPanned,
+    /* Mono voices with their own HRTF filters. */
+    MonoHrtf,
+    /* Stereo voices panned or sent directly to the output, without
+     * near-field control.
+     */
+    StereoPanned,
+    /* First-order 3D B-Format voices, without near-field control. */
+    FirstOrderAmbi,
 };
 
+constexpr size_t GetMixPathChannels(const VoiceMixPath path) noexcept
+{
+    switch(path)
+    {
+    case VoiceMixPath::Generic: break;
+    case VoiceMixPath::MonoPanned: return 1;
+    case VoiceMixPath::MonoHrtf: return 1;
+    case VoiceMixPath::StereoPanned: return 2;
+    case VoiceMixPath::FirstOrderAmbi: return 4;
+    }
+    return 0;
+}
+
 struct VoicePropsItem : public VoiceProps {
     std::atomic<VoicePropsItem*> next{nullptr};
 
@@ -166,16 +275,56 @@ struct VoicePropsItem : public VoiceProps {
 enum : uint {
     VoiceIsStatic,
     VoiceIsCallback,
+    VoiceIsRing,
     VoiceIsAmbisonic,
     VoiceCallbackStopped,
     VoiceIsFading,
     VoiceHasHrtf,
     VoiceHasNfc,
+    VoiceIsVirtual,
+    /* Set when the voice's direct gains or output changed, so its list of
+     * active output channels needs to be rebuilt.
+     */
+    VoiceGainsChanged,
+    /* The voice's dry and send outputs go to a cluster's lines. */
+    VoiceIsClustered,
+    /* The voice's direct output goes to its source group's buffer. */
+    VoiceInGroup,
+    VoiceUsesStereoBus,
+    VoiceStereoBusStarted,
 
     VoiceFlagCount
 };
 
-struct Voice {
+/* The processing quality a spatialized voice is mixed at, lowered when it's
+ * quiet enough for the difference not to be heard (see the voice-lod option).
+ */
+enum class VoiceLod : uint8_t {
+    Full,
+    /* Sinc resamplers are limited to the 12-point fast bsinc resampler, and no
+     * near-field control filter is applied.
+     */
+    Reduced,
+    /* Resampling is limited to linear, and panning to first order. With HRTF
+     * output, the voice pans to the ambisonic mix instead of using its own
+     * HRTF filters.
+     */
+    Low,
+};
+
+/* Far-field voices in the same direction can be mixed into a shared cluster,
+ * which gets spatialized once for them all (see the cluster-distance option).
+ */
+constexpr uint MaxSpatialClusters{32};
+constexpr uint8_t NoSpatialCluster{0xff};
+
+/* The members are ordered so what the mixer checks for every voice each
+ * update comes first, in a single cache line, followed by the source
+ * properties and the rest of the mixing state. This keeps walking the voice
+ * list to one line for each inactive voice. Mixing measured slower with the
+ * properties moved to the end, so they're kept near the front.
+ */
+struct alignas(64) Voice {
     enum State {
         Stopped,
         Playing,
@@ -183,13 +332,22 @@ struct Voice {
         Pending
     };
 
-    std::atomic<VoicePropsItem*> mUpdate{nullptr};
-
-    VoiceProps mProps;
-
     std::atomic<uint> mSourceID{0u};
     std::atomic<State> mPlayState{Stopped};
     std::atomic<bool> mPendingChange{false};
+    /* Set while the voice is on the context's free list, or after being taken
+     * from it until it's set up to play a source.
+     */
+    std::atomic<bool> mFreeListed{false};
+
+    /* The next voice on the free list, and this voice's index in the voice
+     * array.
+     */
+    std::atomic<Voice*> mNextFree{nullptr};
+    uint mIndex{0u};
+
+    std::atomic<VoicePropsItem*> mUpdate{nullptr};
+    VoiceProps mProps;
 
     /**
      * Source offset in samples, relative to the currently playing buffer, NOT
@@ -201,16 +359,52 @@ struct Voice {
 
     /* Current buffer queue item being played. */
     std::atomic<VoiceBufferItem*> mCurrentBuffer;
+    /* The current item's serial, so the source's processed buffers can be
+     * counted without locks.
+     */
+    std::atomic<uint> mBufferSerial{0u};
+
+    /* Incremented by the mixer before and after updating the position and
+     * current buffer (so it's odd while they're being updated), letting them
+     * be read together without waiting for the whole mix to finish.
+     */
+    RefCount mPositionCount{0u};
 
     /* Buffer queue item to loop to at end of queue (will be NULL for non-
      * looping voices).
      */
     std::atomic<VoiceBufferItem*> mLoopBuffer;
 
+    /* Queued duration, in milliseconds, below which a streaming voice sends a
+     * low watermark event (0 for none), and if one was sent since the queue
+     * last rose above it.
+     */
+    std::atomic<uint> mLowWatermark{0u};
+    bool mLowWatermarkSent{false};
+
     std::chrono::nanoseconds mStartTime{};
 
-    /* Properties for the attached buffer(s). */
-    FmtChannels mFmtChannels;
+    /* Nanoseconds spent mixing the voice since it started playing its source,
+     * counted when the device profiles voices.
+     */
+    std::atomic<uint64_t> mMixTime{0u};
+
+    /* Set when the voice budget culls the voice, fading it out and keeping it
+     * virtual. Unlike mFlags, which the API writes when setting up a voice,
+     * only the mixer writes this.
+     */
+    std::atomic<bool> mCulled{false};
+
+    /* The mixer pool thread that mixes the voice, set by the mixer thread for
+     * each update before it starts the pool.
+     */
+    uint mMixThread{0u};
+
+    /* Properties for the attached buffer(s). The channel format is kept after
+     * the voice stops, so a source with the same format can be given a voice
+     * whose storage is already set up for it.
+     */
+    FmtChannels mFmtChannels{FmtMono};
     FmtType mFmtType;
     uint mFrequency;
     uint mFrameStep; /**< In steps of the sample type size. */
@@ -222,13 +416,31 @@ struct Voice {
 
     std::unique_ptr<DecoderBase> mDecoder;
     uint mDecoderPadding{};
+    /* Set when mDecoder is for Super Stereo, rather than UHJ. */
+    bool mStereoDecoder{false};
 
     /** Current target parameters used for mixing. */
     uint mStep{0};
 
     ResamplerFunc mResampler;
+    /* The Q15 resampler for low-precision mixing, if the voice can use it. */
+    Resampler16Func mResampler16{nullptr};
+    VoiceLod mLod{VoiceLod::Full};
 
-    InterpState mResampleState;
+    /* The direction cell the voice can be clustered in (NoSpatialCluster if it
+     * can't be) with its unpanned dry and send gains, and the cluster it's
+     * mixed in.
+     */
+    uint8_t mClusterCell{NoSpatialCluster};
+    uint8_t mSpatialCluster{NoSpatialCluster};
+    /* Set when the voice's parameters were recalculated, so it needs to be
+     * (re)assigned to a cluster. Only the mixer uses this.
+     */
+    bool mClusterPending{false};
+    float mClusterDryGain{};
+    std::array<float,MAX_SENDS> mClusterWetGains{};
+
+    InterpState mResampleState{};
 
     std::bitset<VoiceFlagCount> mFlags{};
     uint mNumCallbackBlocks{0};
@@ -254,18 +466,70 @@ struct Voice {
         BandSplitter mAmbiSplitter;
 
         DirectParams mDryParams;
-        std::array<SendParams,MAX_SENDS> mWetParams;
+        /* One per device send, referring to mWetParamStore. */
+        al::span<SendParams> mWetParams;
     };
     al::vector<ChannelData> mChans{2};
 
+    /* The send parameters and gains for each channel, sized by prepare() to
+     * the device's send count and wet buffer channel count rather than the
+     * maximum of each.
+     */
+    al::vector<SendParams> mWetParamStore;
+    al::vector<float,16> mWetGainStore;
+
+    /* The HRTF state for each channel, only allocated when the device renders
+     * with HRTF and the voice isn't ambisonic.
+     */
+    al::vector<DirectHrtfParams,16> mHrtfStore;
+
+    /* The per-channel storage above, as counted with the device. */
+    MemoryUsage mMemory;
+
+
+    /* The ramps being applied to mProps. mTarget holds the parameter's last
+     * known value, which is only unknown until the voice gets its first props.
+     */
+    struct RampState {
+        float mStart;
+        float mTarget;
+        std::chrono::nanoseconds mStartTime;
+        uint mSerial;
+        bool mActive;
+    };
+    std::array<RampState,NumRampParams> mRamps{};
+    bool mRampTargetsKnown{false};
+    bool mHasRamps{false};
+
     Voice() = default;
-    ~Voice() = default;
+    ~Voice();
 
     Voice(const Voice&) = delete;
     Voice& operator=(const Voice&) = delete;
 
     void mix(const State vstate, ContextBase *Context, const std::chrono::nanoseconds deviceTime,
-        const uint SamplesToDo);
+        const uint SamplesToDo, VoiceMixScratch &Scratch);
+
+    template<VoiceMixPath Path>
+    void mixPath(const State vstate, ContextBase *Context,
+        const std::chrono::nanoseconds deviceTime, const uint SamplesToDo,
+        VoiceMixScratch &Scratch);
+
+    /* The mixing path for the voice's current configuration. Set by prepare,
+     * and updated with updateMixPath when the output mode changes.
+     */
+    using MixFunc = void(Voice::*)(const State vstate, ContextBase *Context,
+        const std::chrono::nanoseconds deviceTime, const uint SamplesToDo,
+        VoiceMixScratch &Scratch);
+    MixFunc mMixFunc{nullptr};
+
+    void updateMixPath() noexcept;
+
+    /* Advances the voice position by the given number of output samples,
+     * updating the buffer queue and sending events as needed.
+     */
+    void updatePosition(ContextBase *Context, int DataPosInt, uint DataPosFrac,
+        VoiceBufferItem *BufferListItem, VoiceBufferItem *BufferLoopItem, const uint samplesDone);
 
     void prepare(DeviceBase *device);
 
@@ -315,6 +315,14 @@ struct AudioState {
     std::atomic<size_t> mReadPos{0};
     std::atomic<size_t> mWritePos{0};
 
+    /* Set once the decoder has nothing more to write to the buffer, so the
+     * callback running dry isn't counted as an underrun.
+     */
+    std::atomic<bool> mBufferDataEnd{false};
+    /* The number of times, and total sample frames, the callback was short. */
+    std::atomic<ALuint> mUnderrunCount{0u};
+    std::atomic<uint64_t> mUnderrunSamples{0u};
+
     /* OpenAL format */
     ALenum mFormat{AL_NONE};
     ALuint mFrameSize{0};
@@ -358,6 +366,8 @@ struct AudioState {
     bool startPlayback();
 
     int getSync();
+    int receiveFrame();
+    int convertFrame(uint8_t *dst, int maxSamples);
     int decodeFrame();
     bool readAudio(uint8_t *samples, unsigned int length, int &sample_skip);
     bool readAudio(int sample_skip);
@@ -663,7 +673,10 @@ int AudioState::getSync()
     return static_cast<int>(duration_cast<seconds>(diff*mCodecCtx->sample_rate).count());
 }
 
-int AudioState::decodeFrame()
+/* Gets the next decoded frame, returning its length in sample frames (0 at
+ * the end of the stream).
+ */
+int AudioState::receiveFrame()
 {
     do {
         while(int ret{mQueue.receiveFrame(mCodecCtx.get(), mDecodedFrame.get())})
@@ -678,21 +691,39 @@ int AudioState::decodeFrame()
         mCurrentPts = duration_cast<nanoseconds>(seconds_d64{av_q2d(mStream->time_base) *
             static_cast<double>(mDecodedFrame->best_effort_timestamp)});
 
-    if(mDecodedFrame->nb_samples > mSamplesMax)
-    {
-        av_freep(&mSamples);
-        av_samples_alloc(&mSamples, nullptr, mCodecCtx->ch_layout.nb_channels,
-            mDecodedFrame->nb_samples, mDstSampleFmt, 0);
-        mSamplesMax = mDecodedFrame->nb_samples;
-    }
-    /* Return the amount of sample frames converted */
-    int data_size{swr_convert(mSwresCtx.get(), &mSamples, mDecodedFrame->nb_samples,
+    return mDecodedFrame->nb_samples;
+}
+
+/* Converts the received frame to the output format, writing to dst which has
+ * room for maxSamples sample frames. Returns the number of sample frames
+ * written.
+ */
+int AudioState::convertFrame(uint8_t *dst, int maxSamples)
+{
+    int data_size{swr_convert(mSwresCtx.get(), &dst, maxSamples,
         const_cast<const uint8_t**>(mDecodedFrame->data), mDecodedFrame->nb_samples)};
 
     av_frame_unref(mDecodedFrame.get());
     return data_size;
 }
 
+int AudioState::decodeFrame()
+{
+    const int nb_samples{receiveFrame()};
+    if(nb_samples <= 0)
+        return 0;
+
+    if(nb_samples > mSamplesMax)
+    {
+        av_freep(&mSamples);
+        av_samples_alloc(&mSamples, nullptr, mCodecCtx->ch_layout.nb_channels, nb_samples,
+            mDstSampleFmt, 0);
+        mSamplesMax = nb_samples;
+    }
+    /* Return the amount of sample frames converted */
+    return convertFrame(mSamples, nb_samples);
+}
+
 /* Duplicates the sample at in to out, count times. The frame size is a
  * multiple of the template type size.
  */
@@ -809,30 +840,72 @@ bool AudioState::readAudio(int sample_skip)
             continue;
         }
 
-        const size_t rem{std::min<size_t>(nsamples, static_cast<ALuint>(mSamplesLen-mSamplesPos))};
-        const size_t boffset{static_cast<ALuint>(mSamplesPos) * size_t{mFrameSize}};
-        const size_t nbytes{rem * mFrameSize};
+        if(mSamplesPos < mSamplesLen)
+        {
+            const size_t rem{std::min<size_t>(nsamples,
+                static_cast<ALuint>(mSamplesLen-mSamplesPos))};
+            const size_t boffset{static_cast<ALuint>(mSamplesPos) * size_t{mFrameSize}};
+            const size_t nbytes{rem * mFrameSize};
 
-        memcpy(&mBufferData[woffset], mSamples + boffset, nbytes);
-        woffset += nbytes;
-        if(woffset == mBufferDataSize) woffset = 0;
-        mWritePos.store(woffset, std::memory_order_release);
+            memcpy(&mBufferData[woffset], mSamples + boffset, nbytes);
+            woffset += nbytes;
+            if(woffset == mBufferDataSize) woffset = 0;
+            mWritePos.store(woffset, std::memory_order_release);
 
-        mCurrentPts += nanoseconds{seconds{rem}} / mCodecCtx->sample_rate;
-        mSamplesPos += static_cast<int>(rem);
+            mCurrentPts += nanoseconds{seconds{rem}} / mCodecCtx->sample_rate;
+            mSamplesPos += static_cast<int>(rem);
+            continue;
+        }
 
-        while(mSamplesPos >= mSamplesLen)
+        /* The current frame is used up, so get the next one. If none of it
+         * needs to be skipped and the buffer has room for all of it, convert
+         * it directly into the buffer instead of going through mSamples.
+         */
+        const int nb_samples{receiveFrame()};
+        if(nb_samples <= 0)
         {
-            mSamplesLen = decodeFrame();
-            mSamplesPos = std::min(mSamplesLen, sample_skip);
-            if(mSamplesLen <= 0) return false;
+            mSamplesLen = 0;
+            mBufferDataEnd.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        if(sample_skip == 0 && static_cast<ALuint>(nb_samples) <= nsamples)
+        {
+            const int got{convertFrame(&mBufferData[woffset], static_cast<int>(nsamples))};
+            if(got <= 0)
+            {
+                mSamplesLen = 0;
+                mBufferDataEnd.store(true, std::memory_order_relaxed);
+                return false;
+            }
 
-            sample_skip -= mSamplesPos;
+            woffset += static_cast<ALuint>(got) * size_t{mFrameSize};
+            if(woffset == mBufferDataSize) woffset = 0;
+            mWritePos.store(woffset, std::memory_order_release);
 
-            auto skip = nanoseconds{seconds{mSamplesPos}} / mCodecCtx->sample_rate;
-            mDeviceStartTime -= skip;
-            mCurrentPts += skip;
+            mCurrentPts += nanoseconds{seconds{got}} / mCodecCtx->sample_rate;
+            mSamplesLen = mSamplesPos = got;
+            continue;
         }
+
+        if(nb_samples > mSamplesMax)
+        {
+            av_freep(&mSamples);
+            av_samples_alloc(&mSamples, nullptr, mCodecCtx->ch_layout.nb_channels, nb_samples,
+                mDstSampleFmt, 0);
+            mSamplesMax = nb_samples;
+        }
+        mSamplesLen = convertFrame(mSamples, nb_samples);
+        mSamplesPos = std::min(mSamplesLen, sample_skip);
+        if(mSamplesLen <= 0)
+        {
+            mBufferDataEnd.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        sample_skip -= mSamplesPos;
+
+        auto skip = nanoseconds{seconds{mSamplesPos}} / mCodecCtx->sample_rate;
+        mDeviceStartTime -= skip;
+        mCurrentPts += skip;
     }
 
     return true;
@@ -901,6 +974,16 @@ ALsizei AudioState::bufferCallback(void *data, ALsizei size) noexcept
     }
     mReadPos.store(roffset, std::memory_order_release);
 
+    /* Note when the decoder couldn't keep up, to report later. The callback
+     * can't print anything itself.
+     */
+    if(got < size && !mBufferDataEnd.load(std::memory_order_relaxed))
+    {
+        mUnderrunCount.fetch_add(1u, std::memory_order_relaxed);
+        mUnderrunSamples.fetch_add(static_cast<ALuint>(size-got) / mFrameSize,
+            std::memory_order_relaxed);
+    }
+
     return got;
 }
 
@@ -1286,6 +1369,8 @@ int AudioState::handler()
         mDeviceStartTime -= skip;
         mCurrentPts += skip;
     }
+    else
+        mBufferDataEnd.store(true, std::memory_order_relaxed);
 
     while(1)
     {
@@ -1386,6 +1471,11 @@ finish:
     alSourcei(mSource, AL_BUFFER, 0);
     srclock.unlock();
 
+    if(const ALuint underruns{mUnderrunCount.load(std::memory_order_relaxed)})
+        std::cerr<< "\nAudio underran "<<underruns<<" time"<<((underruns==1)?"":"s")<<", "
+            <<mUnderrunSamples.load(std::memory_order_relaxed)<<" sample frames dropped"
+            <<std::endl;
+
     return 0;
 }
 
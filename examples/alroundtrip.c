@@ -0,0 +1,428 @@
+/*
+ * OpenAL Round-Trip Latency Example
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* This file contains an example for measuring the round-trip latency from
+ * playback to capture. A short pulse is scheduled on the playback device's
+ * clock, and a capture device listens for it (e.g. through a loopback cable,
+ * or a microphone near the speakers). The time from the pulse being mixed to
+ * it being captured is measured repeatedly, and compared to the latency the
+ * playback device reports, to show the total latency and how much it varies.
+ *
+ * The playback backend and its period settings are chosen the usual way
+ * (e.g. with the ALSOFT_DRIVERS environment variable, and the period_size and
+ * periods config options), so different setups can be compared by running
+ * this with each of them.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+#include "AL/alext.h"
+
+#include "common/alhelpers.h"
+
+#include "win_main_utf8.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+
+/* The length of the pulse, and the lead time for scheduling it, in
+ * milliseconds.
+ */
+#define PULSE_LENGTH 2
+#define SCHEDULE_LEAD 50
+/* The width of each histogram bin, in microseconds, and the number of bins. */
+#define HISTOGRAM_BIN_US 250
+#define HISTOGRAM_BINS 24
+
+static LPALCGETINTEGER64VSOFT alcGetInteger64vSOFT;
+static LPALSOURCEPLAYATTIMESOFT alSourcePlayAtTimeSOFT;
+
+
+/* Returns the host's monotonic clock, in nanoseconds. */
+static ALint64SOFT get_host_time(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+    if(!freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (ALint64SOFT)((double)count.QuadPart * 1000000000.0 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ALint64SOFT)ts.tv_sec*1000000000 + ts.tv_nsec;
+#endif
+}
+
+
+typedef struct CaptureState {
+    ALCdevice *mDevice;
+    ALCuint mRate;
+
+    ALshort *mSamples;
+    ALCint mMaxSamples;
+} CaptureState;
+
+/* Reads what's available from the capture device, and looks for the first
+ * sample at or above the threshold. Returns the host time the found sample
+ * was captured, or -1 if not found. The time is estimated from the time of the
+ * read, assuming the newest sample was captured just before it.
+ */
+static ALint64SOFT capture_find_pulse(CaptureState *state, ALshort threshold)
+{
+    ALint64SOFT now;
+    ALCint avail, i;
+
+    alcGetIntegerv(state->mDevice, ALC_CAPTURE_SAMPLES, 1, &avail);
+    now = get_host_time();
+    if(avail > state->mMaxSamples)
+        avail = state->mMaxSamples;
+    if(avail <= 0)
+        return -1;
+
+    alcCaptureSamples(state->mDevice, state->mSamples, avail);
+
+    for(i = 0;i < avail;++i)
+    {
+        if(abs(state->mSamples[i]) >= threshold)
+        {
+            const ALint64SOFT age = (ALint64SOFT)(avail-1 - i) * 1000000000 / state->mRate;
+            return now - age;
+        }
+    }
+    return -1;
+}
+
+/* Discards anything available from the capture device, returning the loudest
+ * sample found.
+ */
+static ALshort capture_drain(CaptureState *state)
+{
+    ALshort peak = 0;
+    ALCint avail, i;
+
+    alcGetIntegerv(state->mDevice, ALC_CAPTURE_SAMPLES, 1, &avail);
+    while(avail > 0)
+    {
+        const ALCint todo = (avail < state->mMaxSamples) ? avail : state->mMaxSamples;
+        alcCaptureSamples(state->mDevice, state->mSamples, todo);
+        for(i = 0;i < todo;++i)
+        {
+            const int val = abs(state->mSamples[i]);
+            if(val > peak) peak = (ALshort)((val > 32767) ? 32767 : val);
+        }
+        avail -= todo;
+    }
+    return peak;
+}
+
+
+static int compare_int64(const void *a, const void *b)
+{
+    const ALint64SOFT lhs = *(const ALint64SOFT*)a;
+    const ALint64SOFT rhs = *(const ALint64SOFT*)b;
+    return (lhs < rhs) ? -1 : (lhs > rhs) ? 1 : 0;
+}
+
+static void print_stats(const char *name, ALint64SOFT *values, ALuint count)
+{
+    double mean = 0.0, var = 0.0;
+    ALuint i;
+
+    for(i = 0;i < count;++i)
+        mean += (double)values[i];
+    mean /= count;
+    for(i = 0;i < count;++i)
+        var += ((double)values[i]-mean) * ((double)values[i]-mean);
+    var /= count;
+
+    qsort(values, count, sizeof(*values), compare_int64);
+    printf("%s: min %.3f ms, median %.3f ms, mean %.3f ms, max %.3f ms, stddev %.3f ms\n",
+        name, (double)values[0]/1000000.0, (double)values[count/2]/1000000.0, mean/1000000.0,
+        (double)values[count-1]/1000000.0, sqrt(var)/1000000.0);
+}
+
+/* Prints a histogram of the (sorted) values, relative to the smallest, to show
+ * the jitter.
+ */
+static void print_histogram(const ALint64SOFT *values, ALuint count)
+{
+    ALuint bins[HISTOGRAM_BINS] = {0};
+    ALuint i, maxbin = 0;
+
+    for(i = 0;i < count;++i)
+    {
+        ALint64SOFT bin = (values[i] - values[0]) / (HISTOGRAM_BIN_US*1000);
+        if(bin >= HISTOGRAM_BINS) bin = HISTOGRAM_BINS-1;
+        if(++bins[bin] > maxbin) maxbin = bins[bin];
+    }
+
+    printf("Jitter histogram (relative to min):\n");
+    for(i = 0;i < HISTOGRAM_BINS;++i)
+    {
+        const ALuint width = (bins[i]*50 + maxbin-1) / maxbin;
+        ALuint j;
+
+        if(i < HISTOGRAM_BINS-1)
+            printf(" +%6.2f ms |", (double)(i*HISTOGRAM_BIN_US) / 1000.0);
+        else
+            printf(">=%6.2f ms |", (double)(i*HISTOGRAM_BIN_US) / 1000.0);
+        for(j = 0;j < width;++j)
+            putchar('#');
+        printf(" %u\n", bins[i]);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    static const char optlist[] =
+"    --capture/-c <name>       Capture device to listen with (default: default)\n"
+"    --count/-n <count>        Number of pulses to measure (default: 50)\n"
+"    --interval/-i <ms>        Time between pulses in milliseconds (default: 250)\n"
+"    --threshold/-t <level>    Minimum detection level, 0 to 1 (default: 0.1)";
+    const char *capname = NULL;
+    const char *progname;
+    ALuint count = 50, interval = 250;
+    float threshold = 0.1f;
+    ALint64SOFT *roundtrips, *unreported;
+    ALuint num_measured = 0, i;
+    CaptureState capture;
+    ALCdevice *device;
+    ALCint rate, refresh;
+    ALshort *pulse, noise, thresh;
+    ALuint source, buffer;
+    ALsizei pulse_len;
+
+    progname = argv[0];
+
+    /* Initialize OpenAL. */
+    argv++; argc--;
+    if(InitAL(&argv, &argc) != 0)
+        return 1;
+
+    while(argc > 0)
+    {
+        char *end;
+        if(strcmp(argv[0], "--help") == 0 || strcmp(argv[0], "-h") == 0)
+        {
+            fprintf(stderr, "Measure the round-trip latency from playback to capture.\n\n"
+                "Usage: %s [-device <name>] [options...]\n\n"
+                "Available options:\n%s\n", progname, optlist);
+            CloseAL();
+            return 0;
+        }
+        if(argc < 2)
+        {
+            fprintf(stderr, "Missing argument for option: %s\n", argv[0]);
+            CloseAL();
+            return 1;
+        }
+        if(strcmp(argv[0], "--capture") == 0 || strcmp(argv[0], "-c") == 0)
+            capname = argv[1];
+        else if(strcmp(argv[0], "--count") == 0 || strcmp(argv[0], "-n") == 0)
+        {
+            count = (ALuint)strtoul(argv[1], &end, 0);
+            if(!end || *end != '\0' || count < 1 || count > 100000)
+            {
+                fprintf(stderr, "Invalid count: %s\n", argv[1]);
+                CloseAL();
+                return 1;
+            }
+        }
+        else if(strcmp(argv[0], "--interval") == 0 || strcmp(argv[0], "-i") == 0)
+        {
+            interval = (ALuint)strtoul(argv[1], &end, 0);
+            if(!end || *end != '\0' || interval < 50 || interval > 10000)
+            {
+                fprintf(stderr, "Invalid interval: %s\n", argv[1]);
+                CloseAL();
+                return 1;
+            }
+        }
+        else if(strcmp(argv[0], "--threshold") == 0 || strcmp(argv[0], "-t") == 0)
+        {
+            threshold = strtof(argv[1], &end);
+            if(!end || *end != '\0' || !(threshold > 0.0f && threshold <= 1.0f))
+            {
+                fprintf(stderr, "Invalid threshold: %s\n", argv[1]);
+                CloseAL();
+                return 1;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Invalid option: %s\n", argv[0]);
+            CloseAL();
+            return 1;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+
+    device = alcGetContextsDevice(alcGetCurrentContext());
+    if(!alcIsExtensionPresent(device, "ALC_SOFT_device_clock")
+        || !alIsExtensionPresent("AL_SOFT_source_start_delay"))
+    {
+        fprintf(stderr, "Error: ALC_SOFT_device_clock and AL_SOFT_source_start_delay required\n");
+        CloseAL();
+        return 1;
+    }
+    alcGetInteger64vSOFT = FUNCTION_CAST(LPALCGETINTEGER64VSOFT,
+        alcGetProcAddress(device, "alcGetInteger64vSOFT"));
+    alSourcePlayAtTimeSOFT = FUNCTION_CAST(LPALSOURCEPLAYATTIMESOFT,
+        alGetProcAddress("alSourcePlayAtTimeSOFT"));
+
+    alcGetIntegerv(device, ALC_FREQUENCY, 1, &rate);
+    alcGetIntegerv(device, ALC_REFRESH, 1, &refresh);
+    printf("Playback: %dhz, %d updates per second (%d sample update size)\n", rate, refresh,
+        rate/refresh);
+
+    /* Open the capture device at the same rate, with a second of buffering. */
+    memset(&capture, 0, sizeof(capture));
+    capture.mRate = (ALCuint)rate;
+    capture.mMaxSamples = rate;
+    capture.mDevice = alcCaptureOpenDevice(capname, capture.mRate, AL_FORMAT_MONO16,
+        capture.mMaxSamples);
+    if(!capture.mDevice)
+    {
+        fprintf(stderr, "Failed to open capture device \"%s\"\n", capname ? capname : "default");
+        CloseAL();
+        return 1;
+    }
+    printf("Capture: \"%s\"\n", alcGetString(capture.mDevice, ALC_CAPTURE_DEVICE_SPECIFIER));
+    capture.mSamples = calloc((size_t)capture.mMaxSamples, sizeof(ALshort));
+
+    /* Make a short full-scale square pulse to play. */
+    pulse_len = rate * PULSE_LENGTH / 1000;
+    pulse = calloc((size_t)pulse_len, sizeof(ALshort));
+    for(i = 0;i < (ALuint)pulse_len;++i)
+        pulse[i] = ((i/8)&1) ? -32767 : 32767;
+
+    buffer = 0;
+    alGenBuffers(1, &buffer);
+    alBufferData(buffer, AL_FORMAT_MONO16, pulse, pulse_len*(ALsizei)sizeof(ALshort), rate);
+    free(pulse);
+
+    source = 0;
+    alGenSources(1, &source);
+    alSourcei(source, AL_SOURCE_RELATIVE, AL_TRUE);
+    alSourcei(source, AL_BUFFER, (ALint)buffer);
+    if(alGetError() != AL_NO_ERROR)
+    {
+        fprintf(stderr, "Failed to setup pulse source\n");
+        goto done;
+    }
+
+    /* Listen to the background noise for a bit, to make sure the detection
+     * threshold is above it.
+     */
+    alcCaptureStart(capture.mDevice);
+    al_nssleep(200000000);
+    capture_drain(&capture);
+    al_nssleep(300000000);
+    noise = capture_drain(&capture);
+    thresh = (ALshort)(threshold * 32767.0f);
+    if(noise >= thresh/2)
+    {
+        thresh = (noise < 16384) ? (ALshort)(noise*2) : 32767;
+        printf("Raised detection threshold to %.3f due to noise\n", thresh / 32767.0f);
+    }
+
+    roundtrips = calloc(count, sizeof(ALint64SOFT));
+    unreported = calloc(count, sizeof(ALint64SOFT));
+    for(i = 0;i < count;++i)
+    {
+        ALint64SOFT clocklat[2], hosttime, start, mixtime, found = -1;
+
+        /* Schedule the pulse a bit ahead on the device clock, noting the host
+         * time the device clock was read at to correlate the two.
+         */
+        capture_drain(&capture);
+        alcGetInteger64vSOFT(device, ALC_DEVICE_CLOCK_LATENCY_SOFT, 2, clocklat);
+        hosttime = get_host_time();
+        start = clocklat[0] + (ALint64SOFT)SCHEDULE_LEAD*1000000;
+        alSourcePlayAtTimeSOFT(source, start);
+
+        /* The host time the pulse gets mixed at. */
+        mixtime = hosttime + (start - clocklat[0]);
+
+        /* Wait up to the interval for the pulse to come back. */
+        while(get_host_time() - hosttime < (ALint64SOFT)interval*1000000)
+        {
+            found = capture_find_pulse(&capture, thresh);
+            if(found >= 0) break;
+            al_nssleep(500000);
+        }
+        if(found < 0)
+            printf("\rPulse %u: not detected\n", i+1);
+        else
+        {
+            roundtrips[num_measured] = found - mixtime;
+            unreported[num_measured] = roundtrips[num_measured] - clocklat[1];
+            printf("\rPulse %u: %.3f ms (reported playback latency %.3f ms)   ", i+1,
+                (double)roundtrips[num_measured]/1000000.0, (double)clocklat[1]/1000000.0);
+            fflush(stdout);
+            ++num_measured;
+        }
+
+        /* Let the pulse (and any echo of it) finish before the next one. */
+        while(get_host_time() - hosttime < (ALint64SOFT)interval*1000000)
+            al_nssleep(1000000);
+        alSourceStop(source);
+        alSourceRewind(source);
+    }
+    printf("\n");
+    alcCaptureStop(capture.mDevice);
+
+    if(num_measured == 0)
+        fprintf(stderr, "No pulses were detected. Check the loopback connection and levels.\n");
+    else
+    {
+        printf("\nMeasured %u of %u pulses\n", num_measured, count);
+        print_stats("Round trip", roundtrips, num_measured);
+        print_stats("Unreported (capture path)", unreported, num_measured);
+        print_histogram(roundtrips, num_measured);
+    }
+    free(unreported);
+    free(roundtrips);
+
+done:
+    alDeleteSources(1, &source);
+    alDeleteBuffers(1, &buffer);
+    alcCaptureCloseDevice(capture.mDevice);
+    free(capture.mSamples);
+    CloseAL();
+
+    return 0;
+}
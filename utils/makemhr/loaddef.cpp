@@ -30,10 +30,12 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iterator>
 #include <limits>
 #include <memory>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "alfstream.h"
@@ -1712,8 +1714,8 @@ static int MatchTargetEar(const char *ident)
 // Calculate the onset time of an HRIR and average it with any existing
 // timing for its field, elevation, azimuth, and ear.
 static constexpr int OnsetRateMultiple{10};
-static double AverageHrirOnset(PPhaseResampler &rs, al::span<double> upsampled, const uint rate,
-    const uint n, const double *hrir, const double f, const double onset)
+static double AverageHrirOnset(const PPhaseResampler &rs, al::span<double> upsampled,
+    const uint rate, const uint n, const double *hrir, const double f, const double onset)
 {
     rs.process(n, hrir, static_cast<uint>(upsampled.size()), upsampled.data());
 
@@ -1742,7 +1744,8 @@ static void AverageHrirMagnitude(const uint points, const uint n, const double *
 }
 
 // Process the list of sources in the data set definition.
-static int ProcessSources(TokenReaderT *tr, HrirDataT *hData, const uint outRate)
+static int ProcessSources(TokenReaderT *tr, HrirDataT *hData, const uint outRate,
+    const uint numThreads)
 {
     const uint channels{(hData->mChannelType == CT_STEREO) ? 2u : 1u};
     hData->mHrirsBase.resize(channels * hData->mIrCount * hData->mIrSize);
@@ -1829,6 +1832,10 @@ static int ProcessSources(TokenReaderT *tr, HrirDataT *hData, const uint outRate
             sofa = LoadSofaFile(&src, hData->mIrRate, hData->mIrPoints);
             if(!sofa) return 0;
 
+            /* Find the HRIR for each measurement first, then process the
+             * responses in parallel since they don't depend on each other.
+             */
+            std::vector<std::pair<uint,HrirAzT*>> measures;
             for(si = 0;si < sofa->hrtf->M;si++)
             {
                 printf("\rLoading sources... %d of %d", si+1, sofa->hrtf->M);
@@ -1875,31 +1882,45 @@ static int ProcessSources(TokenReaderT *tr, HrirDataT *hData, const uint outRate
                     return 0;
                 }
 
-                ExtractSofaHrir(sofa, si, 0, src.mOffset, hData->mIrPoints, hrir.get());
                 azd->mIrs[0] = &hrirs[hData->mIrSize * azd->mIndex];
-                azd->mDelays[0] = AverageHrirOnset(onsetResampler, onsetSamples, hData->mIrRate,
-                    hData->mIrPoints, hrir.get(), 1.0, azd->mDelays[0]);
-                if(resampler)
-                    resampler->process(hData->mIrPoints, hrir.get(), hData->mIrSize, hrir.get());
-                AverageHrirMagnitude(irPoints, hData->mFftSize, hrir.get(), 1.0, azd->mIrs[0]);
-
                 if(src.mChannel == 1)
-                {
-                    ExtractSofaHrir(sofa, si, 1, src.mOffset, hData->mIrPoints, hrir.get());
                     azd->mIrs[1] = &hrirs[hData->mIrSize * (hData->mIrCount + azd->mIndex)];
-                    azd->mDelays[1] = AverageHrirOnset(onsetResampler, onsetSamples,
-                        hData->mIrRate, hData->mIrPoints, hrir.get(), 1.0, azd->mDelays[1]);
-                    if(resampler)
-                        resampler->process(hData->mIrPoints, hrir.get(), hData->mIrSize,
-                            hrir.get());
-                    AverageHrirMagnitude(irPoints, hData->mFftSize, hrir.get(), 1.0, azd->mIrs[1]);
-                }
+                measures.emplace_back(si, azd);
 
                 // TODO: Since some SOFA files contain minimum phase HRIRs,
                 // it would be beneficial to check for per-measurement delays
                 // (when available) to reconstruct the HRTDs.
             }
 
+            /* The resamplers aren't modified when processing, so they can be
+             * shared between threads.
+             */
+            const uint srcChannels{src.mChannel + 1u};
+            ParallelProcess(numThreads, measures.size()*srcChannels, nullptr,
+                [&,srcChannels]() -> std::function<void(size_t)>
+                {
+                    auto samples = std::vector<double>(hData->mIrSize);
+                    auto upsampled = std::vector<double>(onsetSamples.size());
+                    return [&,srcChannels,samples=std::move(samples),
+                        upsampled=std::move(upsampled)](const size_t idx) mutable
+                    {
+                        const uint msi{measures[idx / srcChannels].first};
+                        HrirAzT *mazd{measures[idx / srcChannels].second};
+                        const uint ti{static_cast<uint>(idx % srcChannels)};
+
+                        ExtractSofaHrir(sofa, msi, ti, src.mOffset, hData->mIrPoints,
+                            samples.data());
+                        mazd->mDelays[ti] = AverageHrirOnset(onsetResampler, upsampled,
+                            hData->mIrRate, hData->mIrPoints, samples.data(), 1.0,
+                            mazd->mDelays[ti]);
+                        if(resampler)
+                            resampler->process(hData->mIrPoints, samples.data(),
+                                hData->mIrSize, samples.data());
+                        AverageHrirMagnitude(irPoints, hData->mFftSize, samples.data(), 1.0,
+                            mazd->mIrs[ti]);
+                    };
+                });
+
             continue;
         }
 
@@ -2043,14 +2064,14 @@ static int ProcessSources(TokenReaderT *tr, HrirDataT *hData, const uint outRate
 
 
 bool LoadDefInput(std::istream &istream, const char *startbytes, std::streamsize startbytecount,
-    const char *filename, const uint fftSize, const uint truncSize, const uint outRate,
-    const ChannelModeT chanMode, HrirDataT *hData)
+    const char *filename, const uint numThreads, const uint fftSize, const uint truncSize,
+    const uint outRate, const ChannelModeT chanMode, HrirDataT *hData)
 {
     TokenReaderT tr{istream};
 
     TrSetup(startbytes, startbytecount, filename, &tr);
     if(!ProcessMetrics(&tr, fftSize, truncSize, chanMode, hData)
-        || !ProcessSources(&tr, hData, outRate))
+        || !ProcessSources(&tr, hData, outRate, numThreads))
         return false;
 
     return true;
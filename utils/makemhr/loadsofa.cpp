@@ -25,17 +25,15 @@
 
 #include <algorithm>
 #include <atomic>
-#include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <functional>
-#include <future>
 #include <iterator>
 #include <memory>
 #include <numeric>
 #include <optional>
 #include <string>
-#include <thread>
+#include <utility>
 #include <vector>
 
 #include "alspan.h"
@@ -231,7 +229,7 @@ bool CheckIrData(MYSOFA_HRTF *sofaHrtf)
 
 /* Calculate the onset time of a HRIR. */
 static constexpr int OnsetRateMultiple{10};
-static double CalcHrirOnset(PPhaseResampler &rs, const uint rate, const uint n,
+static double CalcHrirOnset(const PPhaseResampler &rs, const uint rate, const uint n,
     al::span<double> upsampled, const double *hrir)
 {
     rs.process(n, hrir, static_cast<uint>(upsampled.size()), upsampled.data());
@@ -254,156 +252,120 @@ static void CalcHrirMagnitude(const uint points, const uint n, al::span<complex_
 }
 
 static bool LoadResponses(MYSOFA_HRTF *sofaHrtf, HrirDataT *hData, const DelayType delayType,
-    const uint outRate)
+    const uint outRate, const uint numThreads)
 {
-    std::atomic<uint> loaded_count{0u};
+    const uint channels{(hData->mChannelType == CT_STEREO) ? 2u : 1u};
+    hData->mHrirsBase.resize(channels * hData->mIrCount * hData->mIrSize, 0.0);
+    double *hrirs = hData->mHrirsBase.data();
 
-    auto load_proc = [sofaHrtf,hData,delayType,outRate,&loaded_count]() -> bool
+    /* Map each measurement to its place in the layout first. This is quick,
+     * and lets the responses be copied (and resampled) in parallel after.
+     */
+    std::vector<std::pair<uint,HrirAzT*>> loads;
+    loads.reserve(sofaHrtf->M);
+    for(uint si{0u};si < sofaHrtf->M;++si)
     {
-        const uint channels{(hData->mChannelType == CT_STEREO) ? 2u : 1u};
-        hData->mHrirsBase.resize(channels * hData->mIrCount * hData->mIrSize, 0.0);
-        double *hrirs = hData->mHrirsBase.data();
-
-        std::unique_ptr<double[]> restmp;
-        std::optional<PPhaseResampler> resampler;
-        if(outRate && outRate != hData->mIrRate)
+        float aer[3]{
+            sofaHrtf->SourcePosition.values[3*si],
+            sofaHrtf->SourcePosition.values[3*si + 1],
+            sofaHrtf->SourcePosition.values[3*si + 2]
+        };
+        mysofa_c2s(aer);
+
+        if(std::abs(aer[1]) >= 89.999f)
+            aer[0] = 0.0f;
+        else
+            aer[0] = std::fmod(360.0f - aer[0], 360.0f);
+
+        auto field = std::find_if(hData->mFds.cbegin(), hData->mFds.cend(),
+            [&aer](const HrirFdT &fld) -> bool
+            { return (std::abs(aer[2] - fld.mDistance) < 0.001); });
+        if(field == hData->mFds.cend())
+            continue;
+
+        const double evscale{180.0 / static_cast<double>(field->mEvs.size()-1)};
+        double ef{(90.0 + aer[1]) / evscale};
+        auto ei = static_cast<uint>(std::round(ef));
+        ef = (ef - ei) * evscale;
+        if(std::abs(ef) >= 0.1) continue;
+
+        const double azscale{360.0 / static_cast<double>(field->mEvs[ei].mAzs.size())};
+        double af{aer[0] / azscale};
+        auto ai = static_cast<uint>(std::round(af));
+        af = (af-ai) * azscale;
+        ai %= static_cast<uint>(field->mEvs[ei].mAzs.size());
+        if(std::abs(af) >= 0.1) continue;
+
+        HrirAzT *azd = &field->mEvs[ei].mAzs[ai];
+        if(azd->mIrs[0] != nullptr)
         {
-            resampler.emplace().init(hData->mIrRate, outRate);
-            restmp = std::make_unique<double[]>(sofaHrtf->N);
+            fprintf(stderr, "Multiple measurements near [ a=%f, e=%f, r=%f ].\n",
+                aer[0], aer[1], aer[2]);
+            return false;
         }
 
-        for(uint si{0u};si < sofaHrtf->M;++si)
+        /* The responses are stored by channel, then in layout order (field,
+         * elevation, then azimuth), which is the order they're written out.
+         */
+        for(uint ti{0u};ti < channels;++ti)
+            azd->mIrs[ti] = &hrirs[hData->mIrSize * (hData->mIrCount*ti + azd->mIndex)];
+
+        /* Include any per-channel or per-HRIR delays. */
+        if(delayType == DelayType::I_R)
+        {
+            const float *delayValues{sofaHrtf->DataDelay.values};
+            for(uint ti{0u};ti < channels;++ti)
+                azd->mDelays[ti] = delayValues[ti] / static_cast<float>(hData->mIrRate);
+        }
+        else if(delayType == DelayType::M_R)
         {
-            loaded_count.fetch_add(1u);
+            const float *delayValues{sofaHrtf->DataDelay.values};
+            for(uint ti{0u};ti < channels;++ti)
+                azd->mDelays[ti] = delayValues[si*sofaHrtf->R + ti] /
+                    static_cast<float>(hData->mIrRate);
+        }
 
-            float aer[3]{
-                sofaHrtf->SourcePosition.values[3*si],
-                sofaHrtf->SourcePosition.values[3*si + 1],
-                sofaHrtf->SourcePosition.values[3*si + 2]
-            };
-            mysofa_c2s(aer);
-
-            if(std::abs(aer[1]) >= 89.999f)
-                aer[0] = 0.0f;
-            else
-                aer[0] = std::fmod(360.0f - aer[0], 360.0f);
-
-            auto field = std::find_if(hData->mFds.cbegin(), hData->mFds.cend(),
-                [&aer](const HrirFdT &fld) -> bool
-                { return (std::abs(aer[2] - fld.mDistance) < 0.001); });
-            if(field == hData->mFds.cend())
-                continue;
-
-            const double evscale{180.0 / static_cast<double>(field->mEvs.size()-1)};
-            double ef{(90.0 + aer[1]) / evscale};
-            auto ei = static_cast<uint>(std::round(ef));
-            ef = (ef - ei) * evscale;
-            if(std::abs(ef) >= 0.1) continue;
-
-            const double azscale{360.0 / static_cast<double>(field->mEvs[ei].mAzs.size())};
-            double af{aer[0] / azscale};
-            auto ai = static_cast<uint>(std::round(af));
-            af = (af-ai) * azscale;
-            ai %= static_cast<uint>(field->mEvs[ei].mAzs.size());
-            if(std::abs(af) >= 0.1) continue;
-
-            HrirAzT *azd = &field->mEvs[ei].mAzs[ai];
-            if(azd->mIrs[0] != nullptr)
-            {
-                fprintf(stderr, "\nMultiple measurements near [ a=%f, e=%f, r=%f ].\n",
-                    aer[0], aer[1], aer[2]);
-                return false;
-            }
+        loads.emplace_back(si, azd);
+    }
 
-            for(uint ti{0u};ti < channels;++ti)
+    /* The resampler isn't modified when processing, so a single one can be
+     * shared by all threads.
+     */
+    std::optional<PPhaseResampler> resampler;
+    if(outRate && outRate != hData->mIrRate)
+        resampler.emplace().init(hData->mIrRate, outRate);
+
+    ParallelProcess(numThreads, loads.size()*channels, "Loading HRIRs... ",
+        [sofaHrtf,hData,channels,&loads,&resampler]() -> std::function<void(size_t)>
+        {
+            auto restmp = std::vector<double>(resampler ? sofaHrtf->N : 0u);
+            return [sofaHrtf,hData,channels,&loads,&resampler,restmp=std::move(restmp)](
+                const size_t idx) mutable
             {
-                azd->mIrs[ti] = &hrirs[hData->mIrSize * (hData->mIrCount*ti + azd->mIndex)];
+                const uint si{loads[idx/channels].first};
+                const auto ti = static_cast<uint>(idx%channels);
+                const float *src{&sofaHrtf->DataIR.values[(si*sofaHrtf->R + ti)*sofaHrtf->N]};
+                double *dst{loads[idx/channels].second->mIrs[ti]};
                 if(!resampler)
-                    std::copy_n(&sofaHrtf->DataIR.values[(si*sofaHrtf->R + ti)*sofaHrtf->N],
-                        sofaHrtf->N, azd->mIrs[ti]);
+                    std::copy_n(src, sofaHrtf->N, dst);
                 else
                 {
-                    std::copy_n(&sofaHrtf->DataIR.values[(si*sofaHrtf->R + ti)*sofaHrtf->N],
-                        sofaHrtf->N, restmp.get());
-                    resampler->process(sofaHrtf->N, restmp.get(), hData->mIrSize, azd->mIrs[ti]);
+                    std::copy_n(src, sofaHrtf->N, restmp.begin());
+                    resampler->process(sofaHrtf->N, restmp.data(), hData->mIrSize, dst);
                 }
-            }
-
-            /* Include any per-channel or per-HRIR delays. */
-            if(delayType == DelayType::I_R)
-            {
-                const float *delayValues{sofaHrtf->DataDelay.values};
-                for(uint ti{0u};ti < channels;++ti)
-                    azd->mDelays[ti] = delayValues[ti] / static_cast<float>(hData->mIrRate);
-            }
-            else if(delayType == DelayType::M_R)
-            {
-                const float *delayValues{sofaHrtf->DataDelay.values};
-                for(uint ti{0u};ti < channels;++ti)
-                    azd->mDelays[ti] = delayValues[si*sofaHrtf->R + ti] /
-                        static_cast<float>(hData->mIrRate);
-            }
-        }
-
-        if(outRate && outRate != hData->mIrRate)
-        {
-            const double scale{static_cast<double>(outRate) / hData->mIrRate};
-            hData->mIrRate = outRate;
-            hData->mIrPoints = std::min(static_cast<uint>(std::ceil(hData->mIrPoints*scale)),
-                hData->mIrSize);
-        }
-        return true;
-    };
-
-    std::future_status load_status{};
-    auto load_future = std::async(std::launch::async, load_proc);
-    do {
-        load_status = load_future.wait_for(std::chrono::milliseconds{50});
-        printf("\rLoading HRIRs... %u of %u", loaded_count.load(), sofaHrtf->M);
-        fflush(stdout);
-    } while(load_status != std::future_status::ready);
-    fputc('\n', stdout);
-    return load_future.get();
-}
-
+            };
+        });
 
-/* Calculates the frequency magnitudes of the HRIR set. Work is delegated to
- * this struct, which runs asynchronously on one or more threads (sharing the
- * same calculator object).
- */
-struct MagCalculator {
-    const uint mFftSize{};
-    const uint mIrPoints{};
-    std::vector<double*> mIrs{};
-    std::atomic<size_t> mCurrent{};
-    std::atomic<size_t> mDone{};
-
-    void Worker()
+    if(outRate && outRate != hData->mIrRate)
     {
-        auto htemp = std::vector<complex_d>(mFftSize);
-
-        while(1)
-        {
-            /* Load the current index to process. */
-            size_t idx{mCurrent.load()};
-            do {
-                /* If the index is at the end, we're done. */
-                if(idx >= mIrs.size())
-                    return;
-                /* Otherwise, increment the current index atomically so other
-                 * threads know to go to the next one. If this call fails, the
-                 * current index was just changed by another thread and the new
-                 * value is loaded into idx, which we'll recheck.
-                 */
-            } while(!mCurrent.compare_exchange_weak(idx, idx+1, std::memory_order_relaxed));
-
-            CalcHrirMagnitude(mIrPoints, mFftSize, htemp, mIrs[idx]);
-
-            /* Increment the number of IRs done. */
-            mDone.fetch_add(1);
-        }
+        const double scale{static_cast<double>(outRate) / hData->mIrRate};
+        hData->mIrRate = outRate;
+        hData->mIrPoints = std::min(static_cast<uint>(std::ceil(hData->mIrPoints*scale)),
+            hData->mIrSize);
     }
-};
+    return true;
+}
+
 
 bool LoadSofaFile(const char *filename, const uint numThreads, const uint fftSize,
     const uint truncSize, const uint outRate, const ChannelModeT chanMode, HrirDataT *hData)
@@ -471,7 +433,7 @@ bool LoadSofaFile(const char *filename, const uint numThreads, const uint fftSiz
         return false;
     if(!PrepareLayout(sofaHrtf->M, sofaHrtf->SourcePosition.values, hData))
         return false;
-    if(!LoadResponses(sofaHrtf.get(), hData, delayType, outRate))
+    if(!LoadResponses(sofaHrtf.get(), hData, delayType, outRate, numThreads))
         return false;
     sofaHrtf = nullptr;
 
@@ -510,9 +472,9 @@ bool LoadSofaFile(const char *filename, const uint numThreads, const uint fftSiz
     }
 
 
-    size_t hrir_total{0};
     const uint channels{(hData->mChannelType == CT_STEREO) ? 2u : 1u};
     double *hrirs = hData->mHrirsBase.data();
+    std::vector<std::pair<double*,double*>> irs;
     for(uint fi{0u};fi < hData->mFds.size();fi++)
     {
         for(uint ei{0u};ei < hData->mFds[fi].mEvStart;ei++)
@@ -525,79 +487,42 @@ bool LoadSofaFile(const char *filename, const uint numThreads, const uint fftSiz
             }
         }
 
-        for(uint ei{hData->mFds[fi].mEvStart};ei < hData->mFds[fi].mEvs.size();ei++)
-            hrir_total += hData->mFds[fi].mEvs[ei].mAzs.size() * channels;
-    }
-
-    std::atomic<size_t> hrir_done{0};
-    auto onset_proc = [hData,channels,&hrir_done]() -> bool
-    {
-        /* Temporary buffer used to calculate the IR's onset. */
-        auto upsampled = std::vector<double>(OnsetRateMultiple * hData->mIrPoints);
-        /* This resampler is used to help detect the response onset. */
-        PPhaseResampler rs;
-        rs.init(hData->mIrRate, OnsetRateMultiple*hData->mIrRate);
-
-        for(auto &field : hData->mFds)
+        for(auto &elev : hData->mFds[fi].mEvs.subspan(hData->mFds[fi].mEvStart))
         {
-            for(auto &elev : field.mEvs.subspan(field.mEvStart))
+            for(auto &azd : elev.mAzs)
             {
-                for(auto &azd : elev.mAzs)
-                {
-                    for(uint ti{0};ti < channels;ti++)
-                    {
-                        hrir_done.fetch_add(1u, std::memory_order_acq_rel);
-                        azd.mDelays[ti] += CalcHrirOnset(rs, hData->mIrRate, hData->mIrPoints,
-                            upsampled, azd.mIrs[ti]);
-                    }
-                }
+                for(uint ti{0u};ti < channels;ti++)
+                    irs.emplace_back(azd.mIrs[ti], &azd.mDelays[ti]);
             }
         }
-        return true;
-    };
-
-    std::future_status load_status{};
-    auto load_future = std::async(std::launch::async, onset_proc);
-    do {
-        load_status = load_future.wait_for(std::chrono::milliseconds{50});
-        printf("\rCalculating HRIR onsets... %zu of %zu", hrir_done.load(), hrir_total);
-        fflush(stdout);
-    } while(load_status != std::future_status::ready);
-    fputc('\n', stdout);
-    if(!load_future.get())
-        return false;
+    }
 
-    MagCalculator calculator{hData->mFftSize, hData->mIrPoints};
-    for(auto &field : hData->mFds)
-    {
-        for(auto &elev : field.mEvs.subspan(field.mEvStart))
+    /* This resampler is used to help detect the response onset. It isn't
+     * modified when processing, so it can be shared between threads.
+     */
+    PPhaseResampler rs;
+    rs.init(hData->mIrRate, OnsetRateMultiple*hData->mIrRate);
+    ParallelProcess(numThreads, irs.size(), "Calculating HRIR onsets... ",
+        [hData,&irs,&rs]() -> std::function<void(size_t)>
         {
-            for(auto &azd : elev.mAzs)
+            /* Temporary buffer used to calculate the IR's onset. */
+            auto upsampled = std::vector<double>(OnsetRateMultiple * hData->mIrPoints);
+            return [hData,&irs,&rs,upsampled=std::move(upsampled)](const size_t idx) mutable
             {
-                for(uint ti{0};ti < channels;ti++)
-                    calculator.mIrs.push_back(azd.mIrs[ti]);
-            }
-        }
-    }
+                *irs[idx].second += CalcHrirOnset(rs, hData->mIrRate, hData->mIrPoints,
+                    upsampled, irs[idx].first);
+            };
+        });
 
-    std::vector<std::thread> thrds;
-    thrds.reserve(numThreads);
-    for(size_t i{0};i < numThreads;++i)
-        thrds.emplace_back(std::mem_fn(&MagCalculator::Worker), &calculator);
-    size_t count;
-    do {
-        std::this_thread::sleep_for(std::chrono::milliseconds{50});
-        count = calculator.mDone.load();
-
-        printf("\rCalculating HRIR magnitudes... %zu of %zu", count, calculator.mIrs.size());
-        fflush(stdout);
-    } while(count != calculator.mIrs.size());
-    fputc('\n', stdout);
-
-    for(auto &thrd : thrds)
-    {
-        if(thrd.joinable())
-            thrd.join();
-    }
+    ParallelProcess(numThreads, irs.size(), "Calculating HRIR magnitudes... ",
+        [hData,&irs]() -> std::function<void(size_t)>
+        {
+            auto htemp = std::vector<complex_d>(hData->mFftSize);
+            return [hData,&irs,htemp=std::move(htemp)](const size_t idx) mutable
+            {
+                CalcHrirMagnitude(hData->mIrPoints, hData->mFftSize, htemp,
+                    irs[idx].first);
+            };
+        });
     return true;
 }
@@ -154,6 +154,16 @@ enum HeadModelT {
 // response protocol 03.
 #define MHR_FORMAT                   ("MinPHR03")
 
+// The mappable OpenAL Soft HRTF format marker, with pre-resampled variants of
+// the HRIRs stored as native floats.
+#define MHR_MAPPED_FORMAT            ("MinPHR04")
+
+// The number of samples each HRIR is padded to in the mappable format.
+#define MAPPED_HRIR_LENGTH           (128)
+
+// The maximum number of sample rate variants in the mappable format.
+#define MAX_MAPPED_VARIANTS          (16)
+
 /* Channel index enums. Mono uses LeftChannel only. */
 enum ChannelIndex : uint {
     LeftChannel = 0u,
@@ -247,6 +257,63 @@ void MagnitudeResponse(const uint n, const complex_d *in, double *out)
         out[i] = std::max(std::abs(in[i]), EPSILON);
 }
 
+void ParallelProcess(const uint numThreads, const size_t count, const char *progress,
+    const std::function<std::function<void(size_t)>()> &makeProc)
+{
+    if(count == 0)
+        return;
+
+    std::atomic<size_t> current{0u};
+    std::atomic<size_t> done{0u};
+    auto worker = [count,&makeProc,&current,&done]()
+    {
+        const auto proc = makeProc();
+        while(1)
+        {
+            /* Claim the next index to process. If it's at the end, we're done.
+             * The index may overshoot the count, but it only ever increases
+             * and there's nowhere near enough threads for it to wrap.
+             */
+            const size_t idx{current.fetch_add(1, std::memory_order_relaxed)};
+            if(idx >= count)
+                return;
+
+            proc(idx);
+
+            /* Increment the number of items done. */
+            done.fetch_add(1);
+        }
+    };
+
+    const size_t threadCount{std::min<size_t>(std::max(numThreads, 1u), count)};
+    std::vector<std::thread> thrds;
+    thrds.reserve(threadCount);
+    for(size_t i{0};i < threadCount;++i)
+        thrds.emplace_back(worker);
+
+    /* Keep track of the number of items done, periodically reporting it. */
+    if(progress)
+    {
+        size_t total;
+        do {
+            std::this_thread::sleep_for(std::chrono::milliseconds{50});
+
+            total = done.load();
+            size_t pcdone{total * 100 / count};
+
+            printf("\r%s%3zu%% done (%zu of %zu)", progress, pcdone, total, count);
+            fflush(stdout);
+        } while(total < count);
+        fputc('\n', stdout);
+    }
+
+    for(auto &thrd : thrds)
+    {
+        if(thrd.joinable())
+            thrd.join();
+    }
+}
+
 /* Apply a range limit (in dB) to the given magnitude response.  This is used
  * to adjust the effects of the diffuse-field average on the equalization
  * process.
@@ -426,11 +493,175 @@ static int StoreMhr(const HrirDataT *hData, const char *filename)
     return 1;
 }
 
+// Store the OpenAL Soft HRTF data set in the mappable format, with a variant
+// of the HRIRs resampled for each of the given rates. The HRIRs and delays are
+// resampled the same way the library would when loading the data set.
+static int StoreMappedMhr(const HrirDataT *hData, const al::span<const uint> rates,
+    const char *filename)
+{
+    const uint n{hData->mIrPoints};
+    std::vector<uint8_t> out;
+
+    auto put_bin = [&out](const uint bytes, const uint32_t in)
+    {
+        for(uint i{0};i < bytes;i++)
+            out.push_back(static_cast<uint8_t>((in>>(i*8)) & 0x000000FF));
+    };
+    auto pad_to_16 = [&out]()
+    {
+        while((out.size()&15) != 0)
+            out.push_back(0);
+    };
+    auto put_float = [&put_bin](const float in)
+    {
+        uint32_t bits;
+        memcpy(&bits, &in, sizeof(bits));
+        put_bin(4, bits);
+    };
+
+    out.insert(out.end(), MHR_MAPPED_FORMAT, MHR_MAPPED_FORMAT+8);
+    put_bin(4, static_cast<uint32_t>(rates.size()));
+    put_bin(4, 0);
+    const size_t varTableStart{out.size()};
+    out.resize(out.size() + rates.size()*16, 0);
+
+    std::vector<double> ir(MAPPED_HRIR_LENGTH), resampled(MAPPED_HRIR_LENGTH);
+    for(size_t vi{0};vi < rates.size();vi++)
+    {
+        const uint rate{rates[vi]};
+        const double rateScale{static_cast<double>(rate) / hData->mIrRate};
+        const uint irSize{static_cast<uint>(Clamp(std::round(n*rateScale), 8.0,
+            MAPPED_HRIR_LENGTH))};
+
+        pad_to_16();
+        const auto varOffset = static_cast<uint32_t>(out.size());
+        for(uint i{0};i < 4;i++)
+        {
+            const uint32_t val{(i == 0) ? rate : (i == 1) ? irSize : (i == 2) ? varOffset : 0u};
+            for(uint b{0};b < 4;b++)
+                out[varTableStart + vi*16 + i*4 + b] = static_cast<uint8_t>(val >> (b*8));
+        }
+
+        uint evTotal{0};
+        for(const auto &field : hData->mFds)
+            evTotal += static_cast<uint>(field.mEvs.size());
+        put_bin(4, static_cast<uint32_t>(hData->mFds.size()));
+        put_bin(4, evTotal);
+        put_bin(4, hData->mIrCount);
+        put_bin(4, 0);
+
+        // Fields are stored farthest first.
+        std::vector<const HrirEvT*> evs;
+        for(uint fi{static_cast<uint>(hData->mFds.size()-1)};fi < hData->mFds.size();fi--)
+        {
+            const auto &field = hData->mFds[fi];
+            put_float(static_cast<float>(std::round(1000.0 * field.mDistance) / 1000.0));
+            put_bin(1, static_cast<uint32_t>(field.mEvs.size()));
+            put_bin(3, 0);
+            for(const auto &elev : field.mEvs)
+                evs.push_back(&elev);
+        }
+        uint irOffset{0};
+        for(const HrirEvT *elev : evs)
+        {
+            put_bin(2, static_cast<uint32_t>(elev->mAzs.size()));
+            put_bin(2, irOffset);
+            irOffset += static_cast<uint>(elev->mAzs.size());
+        }
+        pad_to_16();
+
+        PPhaseResampler rs;
+        if(rate != hData->mIrRate)
+            rs.init(hData->mIrRate, rate);
+        auto store_ir = [&](const double *src, const uint channel, std::vector<float> &dst)
+        {
+            std::fill(ir.begin(), ir.end(), 0.0);
+            std::copy_n(src, std::min(n, uint{MAPPED_HRIR_LENGTH}), ir.begin());
+            if(rate != hData->mIrRate)
+                rs.process(MAPPED_HRIR_LENGTH, ir.data(), MAPPED_HRIR_LENGTH, resampled.data());
+            else
+                resampled = ir;
+            for(uint i{0};i < irSize;i++)
+                dst[i*2 + channel] = static_cast<float>(resampled[i]);
+        };
+
+        // Mono data sets mirror the left ear responses for the right ear.
+        std::vector<float> hrir(MAPPED_HRIR_LENGTH*2);
+        std::vector<double> delays;
+        for(const HrirEvT *elev : evs)
+        {
+            const auto azCount = static_cast<uint>(elev->mAzs.size());
+            for(uint ai{0};ai < azCount;ai++)
+            {
+                const HrirAzT &azd = elev->mAzs[ai];
+                const HrirAzT &razd = (hData->mChannelType == CT_STEREO) ? azd
+                    : elev->mAzs[(azCount-ai) % azCount];
+                const uint rchan{(hData->mChannelType == CT_STEREO) ? 1u : 0u};
+
+                std::fill(hrir.begin(), hrir.end(), 0.0f);
+                store_ir(azd.mIrs[0], 0, hrir);
+                store_ir(razd.mIrs[rchan], 1, hrir);
+                for(const float val : hrir)
+                    put_float(val);
+
+                /* Delays have 2 bits of extra precision, and are rounded to
+                 * that precision at the data set rate before being scaled.
+                 */
+                delays.push_back(std::round(std::round(azd.mDelays[0]*4.0)*rateScale) / 4.0);
+                delays.push_back(std::round(std::round(razd.mDelays[rchan]*4.0)*rateScale)
+                    / 4.0);
+            }
+        }
+
+        // Scale the delays down to fit if they exceed the max.
+        const double maxDelay{*std::max_element(delays.cbegin(), delays.cend())};
+        const double delayScale{(maxDelay > MAX_HRTD) ? 4.0*MAX_HRTD/maxDelay : 4.0};
+        for(const double delay : delays)
+            put_bin(1, static_cast<uint>(delay*delayScale + 0.5));
+    }
+
+    FILE *fp{fopen(filename, "wb")};
+    if(!fp)
+    {
+        fprintf(stderr, "\nError: Could not open MHR file '%s'.\n", filename);
+        return 0;
+    }
+    if(fwrite(out.data(), 1, out.size(), fp) != out.size())
+    {
+        fclose(fp);
+        fprintf(stderr, "\nError: Bad write to file '%s'.\n", filename);
+        return 0;
+    }
+    fclose(fp);
+    return 1;
+}
+
 
 /***********************
  *** HRTF processing ***
  ***********************/
 
+/* Collects the response pointers of each HRIR channel in the data set, with
+ * the option of skipping the elevations that have yet to be synthesized.
+ */
+static std::vector<double*> GatherHrirs(const HrirDataT *hData, const uint channels,
+    const bool measuredOnly)
+{
+    std::vector<double*> irs;
+    for(const auto &field : hData->mFds)
+    {
+        for(const auto &elev : field.mEvs.subspan(measuredOnly ? field.mEvStart : 0u))
+        {
+            for(const auto &azd : elev.mAzs)
+            {
+                for(uint ti{0u};ti < channels;ti++)
+                    irs.push_back(azd.mIrs[ti]);
+            }
+        }
+    }
+    return irs;
+}
+
 /* Balances the maximum HRIR magnitudes of multi-field data sets by
  * independently normalizing each field in relation to the overall maximum.
  * This is done to ignore distance attenuation.
@@ -539,10 +770,10 @@ static void CalculateDfWeights(const HrirDataT *hData, double *weights)
  * specified magnitude range (in positive dB; 0.0 to skip).
  */
 static void CalculateDiffuseFieldAverage(const HrirDataT *hData, const uint channels, const uint m,
-    const int weighted, const double limit, double *dfa)
+    const int weighted, const double limit, const uint numThreads, double *dfa)
 {
     std::vector<double> weights(hData->mFds.size() * MAX_EV_COUNT);
-    uint count, ti, fi, ei, i, ai;
+    uint count, ti, fi, ei, i;
 
     if(weighted)
     {
@@ -569,56 +800,77 @@ static void CalculateDiffuseFieldAverage(const HrirDataT *hData, const uint chan
                 weights[(fi * MAX_EV_COUNT) + ei] = weight;
         }
     }
-    for(ti = 0;ti < channels;ti++)
+    // Pair each HRIR with the weight of its contribution.
+    std::vector<std::pair<const HrirAzT*,double>> azds;
+    for(fi = 0;fi < hData->mFds.size();fi++)
     {
-        for(i = 0;i < m;i++)
-            dfa[(ti * m) + i] = 0.0;
-        for(fi = 0;fi < hData->mFds.size();fi++)
+        for(ei = hData->mFds[fi].mEvStart;ei < hData->mFds[fi].mEvs.size();ei++)
         {
-            for(ei = hData->mFds[fi].mEvStart;ei < hData->mFds[fi].mEvs.size();ei++)
+            for(const auto &azd : hData->mFds[fi].mEvs[ei].mAzs)
+                azds.emplace_back(&azd, weights[(fi * MAX_EV_COUNT) + ei]);
+        }
+    }
+
+    /* Split each channel's response into blocks of bins that can be summed
+     * independently. Each bin still accumulates the HRIRs in the same order,
+     * so the result doesn't depend on the number of threads.
+     */
+    static constexpr uint BinBlockSize{64};
+    const uint blocks{(m+BinBlockSize-1) / BinBlockSize};
+    ParallelProcess(numThreads, size_t{channels} * blocks, nullptr,
+        [&azds,blocks,m,dfa]() -> std::function<void(size_t)>
+        {
+            return [&azds,blocks,m,dfa](const size_t idx)
             {
-                for(ai = 0;ai < hData->mFds[fi].mEvs[ei].mAzs.size();ai++)
-                {
-                    HrirAzT *azd = &hData->mFds[fi].mEvs[ei].mAzs[ai];
-                    // Get the weight for this HRIR's contribution.
-                    double weight = weights[(fi * MAX_EV_COUNT) + ei];
+                const uint chan{static_cast<uint>(idx / blocks)};
+                const uint start{static_cast<uint>(idx%blocks) * BinBlockSize};
+                const uint end{std::min(start+BinBlockSize, m)};
+                double *out{&dfa[chan * m]};
 
+                std::fill(out+start, out+end, 0.0);
+                for(const auto &azdweight : azds)
+                {
                     // Add this HRIR's weighted power average to the total.
-                    for(i = 0;i < m;i++)
-                        dfa[(ti * m) + i] += weight * azd->mIrs[ti][i] * azd->mIrs[ti][i];
+                    const double *ir{azdweight.first->mIrs[chan]};
+                    const double weight{azdweight.second};
+                    for(uint j{start};j < end;j++)
+                        out[j] += weight * ir[j] * ir[j];
                 }
-            }
-        }
-        // Finish the average calculation and keep it from being too small.
-        for(i = 0;i < m;i++)
-            dfa[(ti * m) + i] = std::max(sqrt(dfa[(ti * m) + i]), EPSILON);
-        // Apply a limit to the magnitude range of the diffuse-field average
-        // if desired.
-        if(limit > 0.0)
+                // Finish the average calculation and keep it from being too
+                // small.
+                for(uint j{start};j < end;j++)
+                    out[j] = std::max(std::sqrt(out[j]), EPSILON);
+            };
+        });
+
+    // Apply a limit to the magnitude range of the diffuse-field average if
+    // desired.
+    if(limit > 0.0)
+    {
+        for(ti = 0;ti < channels;ti++)
             LimitMagnitudeResponse(hData->mFftSize, m, limit, &dfa[ti * m], &dfa[ti * m]);
     }
 }
 
 // Perform diffuse-field equalization on the magnitude responses of the HRIR
 // set using the given average response.
-static void DiffuseFieldEqualize(const uint channels, const uint m, const double *dfa, const HrirDataT *hData)
+static void DiffuseFieldEqualize(const uint channels, const uint m, const double *dfa,
+    const HrirDataT *hData, const uint numThreads)
 {
-    uint ti, fi, ei, i;
+    const auto irs = GatherHrirs(hData, channels, true);
 
-    for(fi = 0;fi < hData->mFds.size();fi++)
-    {
-        for(ei = hData->mFds[fi].mEvStart;ei < hData->mFds[fi].mEvs.size();ei++)
+    ParallelProcess(numThreads, irs.size(), nullptr,
+        [&irs,channels,m,dfa]() -> std::function<void(size_t)>
         {
-            for(auto &azd : hData->mFds[fi].mEvs[ei].mAzs)
+            return [&irs,channels,m,dfa](const size_t idx)
             {
-                for(ti = 0;ti < channels;ti++)
-                {
-                    for(i = 0;i < m;i++)
-                        azd.mIrs[ti][i] /= dfa[(ti * m) + i];
-                }
-            }
-        }
-    }
+                /* The IRs are gathered with their channels interleaved. */
+                const double *avg{&dfa[(idx%channels) * m]};
+                double *ir{irs[idx]};
+                for(uint i{0};i < m;i++)
+                    ir[i] /= avg[i];
+            };
+        });
 }
 
 /* Given field and elevation indices and an azimuth, calculate the indices of
@@ -764,15 +1016,42 @@ static void SynthesizeOnsets(HrirDataT *hData)
  * applies a low-pass filter to simulate body occlusion.  It is a simple, if
  * inaccurate model.
  */
-static void SynthesizeHrirs(HrirDataT *hData)
+static void SynthesizeHrirs(HrirDataT *hData, const uint numThreads)
 {
     const uint channels{(hData->mChannelType == CT_STEREO) ? 2u : 1u};
-    auto htemp = std::vector<complex_d>(hData->mFftSize);
+    const uint fftSize{hData->mFftSize};
     const uint m{hData->mFftSize/2u + 1u};
-    auto filter = std::vector<double>(m);
     const double beta{3.5e-6 * hData->mIrRate};
 
-    auto proc_field = [channels,m,beta,&htemp,&filter](HrirFdT &field) -> void
+    /* Calculate the magnitude response of a low-pass filter, used to simulate
+     * body occlusion.
+     */
+    auto calc_filter = [m](const double b, std::vector<complex_d> &htemp,
+        std::vector<double> &filter) -> void
+    {
+        double lp[4]{};
+        lp[0] = Lerp(1.0, lp[0], b);
+        lp[1] = Lerp(lp[0], lp[1], b);
+        lp[2] = Lerp(lp[1], lp[2], b);
+        lp[3] = Lerp(lp[2], lp[3], b);
+        htemp[0] = lp[3];
+        for(size_t i{1u};i < htemp.size();i++)
+        {
+            lp[0] = Lerp(0.0, lp[0], b);
+            lp[1] = Lerp(lp[0], lp[1], b);
+            lp[2] = Lerp(lp[1], lp[2], b);
+            lp[3] = Lerp(lp[2], lp[3], b);
+            htemp[i] = lp[3];
+        }
+        /* Get the filter's frequency-domain response and extract the
+         * frequency magnitudes (phase will be reconstructed later)).
+         */
+        FftForward(static_cast<uint>(htemp.size()), htemp.data());
+        std::transform(htemp.cbegin(), htemp.cbegin()+m, filter.begin(),
+            [](const complex_d &c) -> double { return std::abs(c); });
+    };
+
+    auto proc_field = [channels,fftSize,m,beta,numThreads,calc_filter](HrirFdT &field) -> void
     {
         const uint oi{field.mEvStart};
         if(oi <= 0) return;
@@ -796,72 +1075,50 @@ static void SynthesizeHrirs(HrirDataT *hData)
             }
         }
 
-        for(uint ei{1u};ei < field.mEvStart;ei++)
-        {
-            const double of{static_cast<double>(ei) / field.mEvStart};
-            const double b{(1.0 - of) * beta};
-            double lp[4]{};
-
-            /* Calculate a low-pass filter to simulate body occlusion. */
-            lp[0] = Lerp(1.0, lp[0], b);
-            lp[1] = Lerp(lp[0], lp[1], b);
-            lp[2] = Lerp(lp[1], lp[2], b);
-            lp[3] = Lerp(lp[2], lp[3], b);
-            htemp[0] = lp[3];
-            for(size_t i{1u};i < htemp.size();i++)
+        /* Each synthesized elevation only reads from the lowest measured and
+         * the -90 elevations, so they can be processed independently.
+         */
+        ParallelProcess(numThreads, oi-1u, nullptr,
+            [&field,channels,fftSize,m,beta,oi,calc_filter]() -> std::function<void(size_t)>
             {
-                lp[0] = Lerp(0.0, lp[0], b);
-                lp[1] = Lerp(lp[0], lp[1], b);
-                lp[2] = Lerp(lp[1], lp[2], b);
-                lp[3] = Lerp(lp[2], lp[3], b);
-                htemp[i] = lp[3];
-            }
-            /* Get the filter's frequency-domain response and extract the
-             * frequency magnitudes (phase will be reconstructed later)).
-             */
-            FftForward(static_cast<uint>(htemp.size()), htemp.data());
-            std::transform(htemp.cbegin(), htemp.cbegin()+m, filter.begin(),
-                [](const complex_d &c) -> double { return std::abs(c); });
+                auto htemp = std::vector<complex_d>(fftSize);
+                auto filter = std::vector<double>(m);
+                return [&field,channels,m,beta,oi,calc_filter,htemp=std::move(htemp),
+                    filter=std::move(filter)](const size_t idx) mutable
+                {
+                    const uint ei{static_cast<uint>(idx) + 1u};
+                    const double of{static_cast<double>(ei) / field.mEvStart};
 
-            for(uint ai{0u};ai < field.mEvs[ei].mAzs.size();ai++)
-            {
-                uint a0, a1;
-                double af;
+                    calc_filter((1.0 - of) * beta, htemp, filter);
 
-                CalcAzIndices(field, oi, field.mEvs[ei].mAzs[ai].mAzimuth, &a0, &a1, &af);
-                for(uint ti{0u};ti < channels;ti++)
-                {
-                    for(uint i{0u};i < m;i++)
+                    for(uint ai{0u};ai < field.mEvs[ei].mAzs.size();ai++)
                     {
-                        /* Blend the two defined HRIRs closest to this azimuth,
-                         * then blend that with the synthesized -90 elevation.
-                         */
-                        const double s1{Lerp(field.mEvs[oi].mAzs[a0].mIrs[ti][i],
-                            field.mEvs[oi].mAzs[a1].mIrs[ti][i], af)};
-                        const double s{Lerp(field.mEvs[0].mAzs[0].mIrs[ti][i], s1, of)};
-                        field.mEvs[ei].mAzs[ai].mIrs[ti][i] = s * filter[i];
+                        uint a0, a1;
+                        double af;
+
+                        CalcAzIndices(field, oi, field.mEvs[ei].mAzs[ai].mAzimuth, &a0, &a1,
+                            &af);
+                        for(uint ti{0u};ti < channels;ti++)
+                        {
+                            for(uint i{0u};i < m;i++)
+                            {
+                                /* Blend the two defined HRIRs closest to this
+                                 * azimuth, then blend that with the
+                                 * synthesized -90 elevation.
+                                 */
+                                const double s1{Lerp(field.mEvs[oi].mAzs[a0].mIrs[ti][i],
+                                    field.mEvs[oi].mAzs[a1].mIrs[ti][i], af)};
+                                const double s{Lerp(field.mEvs[0].mAzs[0].mIrs[ti][i], s1, of)};
+                                field.mEvs[ei].mAzs[ai].mIrs[ti][i] = s * filter[i];
+                            }
+                        }
                     }
-                }
-            }
-        }
-        const double b{beta};
-        double lp[4]{};
-        lp[0] = Lerp(1.0, lp[0], b);
-        lp[1] = Lerp(lp[0], lp[1], b);
-        lp[2] = Lerp(lp[1], lp[2], b);
-        lp[3] = Lerp(lp[2], lp[3], b);
-        htemp[0] = lp[3];
-        for(size_t i{1u};i < htemp.size();i++)
-        {
-            lp[0] = Lerp(0.0, lp[0], b);
-            lp[1] = Lerp(lp[0], lp[1], b);
-            lp[2] = Lerp(lp[1], lp[2], b);
-            lp[3] = Lerp(lp[2], lp[3], b);
-            htemp[i] = lp[3];
-        }
-        FftForward(static_cast<uint>(htemp.size()), htemp.data());
-        std::transform(htemp.cbegin(), htemp.cbegin()+m, filter.begin(),
-            [](const complex_d &c) -> double { return std::abs(c); });
+                };
+            });
+
+        auto htemp = std::vector<complex_d>(fftSize);
+        auto filter = std::vector<double>(m);
+        calc_filter(beta, htemp, filter);
 
         for(uint ti{0u};ti < channels;ti++)
         {
@@ -875,101 +1132,37 @@ static void SynthesizeHrirs(HrirDataT *hData)
 // The following routines assume a full set of HRIRs for all elevations.
 
 /* Perform minimum-phase reconstruction using the magnitude responses of the
- * HRIR set. Work is delegated to this struct, which runs asynchronously on one
- * or more threads (sharing the same reconstructor object).
+ * HRIR set. Work is spread over one or more threads, each with its own
+ * scratch buffers.
  */
-struct HrirReconstructor {
-    std::vector<double*> mIrs;
-    std::atomic<size_t> mCurrent;
-    std::atomic<size_t> mDone;
-    uint mFftSize;
-    uint mIrPoints;
-
-    void Worker()
-    {
-        auto h = std::vector<complex_d>(mFftSize);
-        auto mags = std::vector<double>(mFftSize);
-        size_t m{(mFftSize/2) + 1};
-
-        while(1)
-        {
-            /* Load the current index to process. */
-            size_t idx{mCurrent.load()};
-            do {
-                /* If the index is at the end, we're done. */
-                if(idx >= mIrs.size())
-                    return;
-                /* Otherwise, increment the current index atomically so other
-                 * threads know to go to the next one. If this call fails, the
-                 * current index was just changed by another thread and the new
-                 * value is loaded into idx, which we'll recheck.
-                 */
-            } while(!mCurrent.compare_exchange_weak(idx, idx+1, std::memory_order_relaxed));
-
-            /* Now do the reconstruction, and apply the inverse FFT to get the
-             * time-domain response.
-             */
-            for(size_t i{0};i < m;++i)
-                mags[i] = std::max(mIrs[idx][i], EPSILON);
-            MinimumPhase(mFftSize, mags.data(), h.data());
-            FftInverse(mFftSize, h.data());
-            for(uint i{0u};i < mIrPoints;++i)
-                mIrs[idx][i] = h[i].real();
-
-            /* Increment the number of IRs done. */
-            mDone.fetch_add(1);
-        }
-    }
-};
-
 static void ReconstructHrirs(const HrirDataT *hData, const uint numThreads)
 {
     const uint channels{(hData->mChannelType == CT_STEREO) ? 2u : 1u};
+    const uint fftSize{hData->mFftSize};
+    const uint irPoints{hData->mIrPoints};
+    const auto irs = GatherHrirs(hData, channels, false);
 
-    /* Set up the reconstructor with the needed size info and pointers to the
-     * IRs to process.
-     */
-    HrirReconstructor reconstructor;
-    reconstructor.mCurrent.store(0, std::memory_order_relaxed);
-    reconstructor.mDone.store(0, std::memory_order_relaxed);
-    reconstructor.mFftSize = hData->mFftSize;
-    reconstructor.mIrPoints = hData->mIrPoints;
-    for(const auto &field : hData->mFds)
-    {
-        for(auto &elev : field.mEvs)
+    ParallelProcess(numThreads, irs.size(), "",
+        [&irs,fftSize,irPoints]() -> std::function<void(size_t)>
         {
-            for(const auto &azd : elev.mAzs)
+            auto h = std::vector<complex_d>(fftSize);
+            auto mags = std::vector<double>(fftSize);
+            return [&irs,fftSize,irPoints,h=std::move(h),mags=std::move(mags)](const size_t idx)
+                mutable
             {
-                for(uint ti{0u};ti < channels;ti++)
-                    reconstructor.mIrs.push_back(azd.mIrs[ti]);
-            }
-        }
-    }
-
-    /* Launch threads to work on reconstruction. */
-    std::vector<std::thread> thrds;
-    thrds.reserve(numThreads);
-    for(size_t i{0};i < numThreads;++i)
-        thrds.emplace_back(std::mem_fn(&HrirReconstructor::Worker), &reconstructor);
-
-    /* Keep track of the number of IRs done, periodically reporting it. */
-    size_t count;
-    do {
-        std::this_thread::sleep_for(std::chrono::milliseconds{50});
-
-        count = reconstructor.mDone.load();
-        size_t pcdone{count * 100 / reconstructor.mIrs.size()};
+                const size_t m{(fftSize/2) + 1};
 
-        printf("\r%3zu%% done (%zu of %zu)", pcdone, count, reconstructor.mIrs.size());
-        fflush(stdout);
-    } while(count < reconstructor.mIrs.size());
-    fputc('\n', stdout);
-
-    for(auto &thrd : thrds)
-    {
-        if(thrd.joinable())
-            thrd.join();
-    }
+                /* Do the reconstruction, and apply the inverse FFT to get the
+                 * time-domain response.
+                 */
+                for(size_t i{0};i < m;++i)
+                    mags[i] = std::max(irs[idx][i], EPSILON);
+                MinimumPhase(fftSize, mags.data(), h.data());
+                FftInverse(fftSize, h.data());
+                for(uint i{0u};i < irPoints;++i)
+                    irs[idx][i] = h[i].real();
+            };
+        });
 }
 
 // Normalize the HRIR set and slightly attenuate the result.
@@ -1174,6 +1367,23 @@ bool PrepareHrirData(const al::span<const double> distances,
 }
 
 
+/* Reports the time taken by each processing stage. */
+class StageTimer {
+    std::chrono::steady_clock::time_point mStart{std::chrono::steady_clock::now()};
+
+public:
+    /* Prints the time elapsed since the last report, and restarts the timer
+     * for the next stage.
+     */
+    void report()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        const std::chrono::duration<double> elapsed{now - mStart};
+        fprintf(stdout, "  Done in %.3f seconds.\n", elapsed.count());
+        mStart = now;
+    }
+};
+
 /* Parse the data set definition and process the source data, storing the
  * resulting data set as desired.  If the input name is NULL it will read
  * from standard input.
@@ -1181,16 +1391,18 @@ bool PrepareHrirData(const al::span<const double> distances,
 static int ProcessDefinition(const char *inName, const uint outRate, const ChannelModeT chanMode,
     const bool farfield, const uint numThreads, const uint fftSize, const int equalize,
     const int surface, const double limit, const uint truncSize, const HeadModelT model,
-    const double radius, const char *outName)
+    const double radius, const std::vector<uint> &mappedRates, const char *outName)
 {
     HrirDataT hData;
 
     fprintf(stdout, "Using %u thread%s.\n", numThreads, (numThreads==1)?"":"s");
+    StageTimer timer;
     if(!inName)
     {
         inName = "stdin";
         fprintf(stdout, "Reading HRIR definition from %s...\n", inName);
-        if(!LoadDefInput(std::cin, nullptr, 0, inName, fftSize, truncSize, outRate, chanMode, &hData))
+        if(!LoadDefInput(std::cin, nullptr, 0, inName, numThreads, fftSize, truncSize, outRate,
+            chanMode, &hData))
             return 0;
     }
     else
@@ -1222,10 +1434,12 @@ static int ProcessDefinition(const char *inName, const uint outRate, const Chann
         else
         {
             fprintf(stdout, "Reading HRIR definition from %s...\n", inName);
-            if(!LoadDefInput(*input, startbytes, startbytecount, inName, fftSize, truncSize, outRate, chanMode, &hData))
+            if(!LoadDefInput(*input, startbytes, startbytecount, inName, numThreads, fftSize,
+                truncSize, outRate, chanMode, &hData))
                 return 0;
         }
     }
+    timer.report();
 
     if(equalize)
     {
@@ -1237,11 +1451,14 @@ static int ProcessDefinition(const char *inName, const uint outRate, const Chann
         {
             fprintf(stdout, "Balancing field magnitudes...\n");
             BalanceFieldMagnitudes(&hData, c, m);
+            timer.report();
         }
         fprintf(stdout, "Calculating diffuse-field average...\n");
-        CalculateDiffuseFieldAverage(&hData, c, m, surface, limit, dfa.data());
+        CalculateDiffuseFieldAverage(&hData, c, m, surface, limit, numThreads, dfa.data());
+        timer.report();
         fprintf(stdout, "Performing diffuse-field equalization...\n");
-        DiffuseFieldEqualize(c, m, dfa.data(), &hData);
+        DiffuseFieldEqualize(c, m, dfa.data(), &hData, numThreads);
+        timer.report();
     }
     if(hData.mFds.size() > 1)
     {
@@ -1259,19 +1476,41 @@ static int ProcessDefinition(const char *inName, const uint outRate, const Chann
     fprintf(stdout, "Synthesizing missing elevations...\n");
     if(model == HM_DATASET)
         SynthesizeOnsets(&hData);
-    SynthesizeHrirs(&hData);
+    SynthesizeHrirs(&hData, numThreads);
+    timer.report();
     fprintf(stdout, "Performing minimum phase reconstruction...\n");
     ReconstructHrirs(&hData, numThreads);
+    timer.report();
     fprintf(stdout, "Truncating minimum-phase HRIRs...\n");
     hData.mIrPoints = truncSize;
     fprintf(stdout, "Normalizing final HRIRs...\n");
     NormalizeHrirs(&hData);
+    timer.report();
     fprintf(stdout, "Calculating impulse delays...\n");
     CalculateHrtds(model, (radius > DEFAULT_CUSTOM_RADIUS) ? radius : hData.mRadius, &hData);
+    timer.report();
 
     const auto rateStr = std::to_string(hData.mIrRate);
     const auto expName = StrSubst({outName, strlen(outName)}, {"%r", 2},
         {rateStr.data(), rateStr.size()});
+    if(!mappedRates.empty())
+    {
+        /* The data set's own rate is always the first variant. */
+        std::vector<uint> rates{hData.mIrRate};
+        for(const uint rate : mappedRates)
+        {
+            if(std::find(rates.cbegin(), rates.cend(), rate) == rates.cend())
+                rates.push_back(rate);
+        }
+        if(rates.size() > MAX_MAPPED_VARIANTS)
+        {
+            fprintf(stderr, "\nError: Too many sample rate variants (%zu, max %d).\n",
+                rates.size(), MAX_MAPPED_VARIANTS);
+            return 0;
+        }
+        fprintf(stdout, "Creating mappable MHR data set %s...\n", expName.c_str());
+        return StoreMappedMhr(&hData, rates, expName.c_str());
+    }
     fprintf(stdout, "Creating MHR data set %s...\n", expName.c_str());
     return StoreMhr(&hData, expName.c_str());
 }
@@ -1296,6 +1535,8 @@ static void PrintHelp(const char *argv0, FILE *ofile)
     fprintf(ofile, " -d {dataset|    Specify the model used for calculating the head-delay timing\n");
     fprintf(ofile, "     sphere}     values (default: %s).\n", ((DEFAULT_HEAD_MODEL == HM_DATASET) ? "dataset" : "sphere"));
     fprintf(ofile, " -c <radius>     Use a customized head radius measured to-ear in meters.\n");
+    fprintf(ofile, " -p <rates>      Store a mappable (MinPHR04) data set, with the HRIRs also\n");
+    fprintf(ofile, "                 resampled for each of the comma-separated sample rates.\n");
     fprintf(ofile, " -i <filename>   Specify an HRIR definition file to use (defaults to stdin).\n");
     fprintf(ofile, " -o <filename>   Specify an output file. Use of '%%r' will be substituted with\n");
     fprintf(ofile, "                 the data set sample rate.\n");
@@ -1315,6 +1556,7 @@ int main(int argc, char *argv[])
     double radius;
     bool farfield;
     double limit;
+    std::vector<uint> mappedRates;
     int opt;
 
     if(argc < 2)
@@ -1337,7 +1579,7 @@ int main(int argc, char *argv[])
     radius = DEFAULT_CUSTOM_RADIUS;
     farfield = false;
 
-    while((opt=getopt(argc, argv, "r:maj:f:e:s:l:w:d:c:e:i:o:h")) != -1)
+    while((opt=getopt(argc, argv, "r:maj:f:e:s:l:w:d:c:e:p:i:o:h")) != -1)
     {
         switch(opt)
         {
@@ -1446,6 +1688,22 @@ int main(int argc, char *argv[])
             }
             break;
 
+        case 'p':
+            for(const char *str{optarg};;str = end+1)
+            {
+                const auto rate = static_cast<uint>(strtoul(str, &end, 10));
+                if(end == str || (end[0] != '\0' && end[0] != ',') || rate < MIN_RATE
+                    || rate > MAX_RATE)
+                {
+                    fprintf(stderr, "\nError: Got unexpected value \"%s\" for option -%c, expected rates between %u to %u.\n", optarg, opt, MIN_RATE, MAX_RATE);
+                    exit(EXIT_FAILURE);
+                }
+                mappedRates.push_back(rate);
+                if(end[0] == '\0')
+                    break;
+            }
+            break;
+
         case 'i':
             inName = optarg;
             break;
@@ -1465,7 +1723,7 @@ int main(int argc, char *argv[])
     }
 
     int ret = ProcessDefinition(inName, outRate, chanMode, farfield, numThreads, fftSize, equalize,
-        surface, limit, truncSize, model, radius, outName);
+        surface, limit, truncSize, model, radius, mappedRates, outName);
     if(!ret) return -1;
     fprintf(stdout, "Operation completed.\n");
 
@@ -1,8 +1,10 @@
 #ifndef MAKEMHR_H
 #define MAKEMHR_H
 
-#include <vector>
 #include <complex>
+#include <cstddef>
+#include <functional>
+#include <vector>
 
 #include "alcomplex.h"
 #include "polyphase_resampler.h"
@@ -111,6 +113,16 @@ bool PrepareHrirData(const al::span<const double> distances,
     const al::span<const std::array<uint,MAX_EV_COUNT>,MAX_FD_COUNT> azCounts, HrirDataT *hData);
 void MagnitudeResponse(const uint n, const complex_d *in, double *out);
 
+/* Calls a processing function for each index in [0, count) using the given
+ * number of threads. Each thread repeatedly claims the next unprocessed index,
+ * so threads that finish early pick up the remaining work. Each thread first
+ * calls makeProc to get its own processing function, so it can set up any
+ * scratch buffers it needs. If progress is non-null, it's printed as a prefix
+ * to a periodic progress report.
+ */
+void ParallelProcess(const uint numThreads, const size_t count, const char *progress,
+    const std::function<std::function<void(size_t)>()> &makeProc);
+
 // Performs a forward FFT.
 inline void FftForward(const uint n, complex_d *inout)
 { forward_fft(al::span{inout, n}); }
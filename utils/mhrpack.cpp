@@ -0,0 +1,81 @@
+/*
+ * HRTF Data Set Packer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Packs a MinPHR03 data set (.mhr) into the smaller form used for the data
+ * sets embedded in the library. For example, the built-in data set is made
+ * with:
+ *
+ *   mhrpack "hrtf/Default HRTF.mhr" "hrtf/Default HRTF.mhrz"
+ */
+
+#include "config.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "core/hrtf_pack.h"
+
+#include "win_main_utf8.h"
+
+
+int main(int argc, char **argv)
+{
+    if(argc != 3 || std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0)
+    {
+        printf("Usage: %s <infile.mhr> <outfile>\n\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream infile{argv[1], std::ios::binary};
+    if(!infile.is_open())
+    {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+    const std::vector<char> data{std::istreambuf_iterator<char>{infile},
+        std::istreambuf_iterator<char>{}};
+
+    const std::vector<char> packed{PackHrtf(data)};
+    if(packed.empty())
+    {
+        fprintf(stderr, "%s is not a supported data set (requires MinPHR03)\n", argv[1]);
+        return 1;
+    }
+    if(UnpackHrtf(packed) != data)
+    {
+        fprintf(stderr, "Failed to verify packed data for %s\n", argv[1]);
+        return 1;
+    }
+
+    std::ofstream outfile{argv[2], std::ios::binary};
+    if(!outfile.write(packed.data(), static_cast<std::streamsize>(packed.size())))
+    {
+        fprintf(stderr, "Failed to write %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("Packed %s: %zu -> %zu bytes\n", argv[1], data.size(), packed.size());
+    return 0;
+}
@@ -23,10 +23,12 @@
  */
 
 #include <assert.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "AL/alc.h"
 #include "AL/al.h"
@@ -47,6 +49,30 @@
 
 #define MAX_WIDTH  80
 
+#ifndef AL_SOFT_convolution_reverb
+#define AL_SOFT_convolution_reverb
+#define AL_EFFECT_CONVOLUTION_REVERB_SOFT        0xA000
+#endif
+
+#ifndef M_PI
+#define M_PI    (3.14159265358979323846)
+#endif
+
+/* The most voices and effect slots the benchmark will try. OpenAL Soft limits
+ * contexts to 64 effect slots by default.
+ */
+#define BENCH_MAX_VOICES 4096
+#define BENCH_MAX_SLOTS  64
+/* The number of voices playing while measuring effect slots. */
+#define BENCH_SLOT_VOICES 16
+/* The amount of audio rendered for each measurement, in seconds. */
+#define BENCH_TIME 0.25
+/* A measurement counts as real-time if rendering takes no more than this
+ * fraction of the audio's duration, leaving headroom for the rest of the
+ * system.
+ */
+#define BENCH_LOAD 0.75
+
 static void printList(const char *list, char separator)
 {
     size_t col = MAX_WIDTH, len;
@@ -376,10 +402,382 @@ static void printEFXInfo(ALCdevice *device)
     checkALErrors();
 }
 
+static LPALCLOOPBACKOPENDEVICESOFT palcLoopbackOpenDeviceSOFT;
+static LPALCRENDERSAMPLESSOFT palcRenderSamplesSOFT;
+static LPALGENEFFECTS palGenEffects;
+static LPALDELETEEFFECTS palDeleteEffects;
+static LPALEFFECTI palEffecti;
+static LPALGENAUXILIARYEFFECTSLOTS palGenAuxiliaryEffectSlots;
+static LPALDELETEAUXILIARYEFFECTSLOTS palDeleteAuxiliaryEffectSlots;
+static LPALAUXILIARYEFFECTSLOTI palAuxiliaryEffectSloti;
+static LPALAUXILIARYEFFECTSLOTF palAuxiliaryEffectSlotf;
+
+typedef struct BenchState {
+    ALCdevice *Device;
+    ALCcontext *Context;
+    ALCint Frequency;
+    ALCint UpdateSize;
+    float *Output;
+
+    ALuint Buffer;
+    ALuint IrBuffer;
+    ALuint Sources[BENCH_MAX_VOICES];
+} BenchState;
+
+static double getTime(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec/1000000000.0;
+}
+
+/* Creates a looping test sound with some tones and noise. */
+static ALuint createBenchBuffer(ALCint frequency, ALsizei channels)
+{
+    unsigned int seed = 22222;
+    ALuint buffer = 0;
+    float *data;
+    ALsizei i, length;
+
+    /* A half-second decaying noise burst for the convolution reverb, or a
+     * second of tones and noise for voices.
+     */
+    length = (channels == 2) ? frequency/2 : frequency;
+    data = calloc((size_t)length*(size_t)channels, sizeof(*data));
+    if(!data) return 0;
+
+    for(i = 0;i < length*channels;i++)
+    {
+        const double t = (double)(i/channels) / frequency;
+        float noise;
+
+        seed = (seed * 96314165u) + 907633515u;
+        noise = (float)((double)seed/2147483648.0 - 1.0);
+        if(channels == 2)
+            data[i] = noise * expf(-6.9f * (float)(i/channels) / (float)length);
+        else
+            data[i] = (float)(sin(t*2.0*M_PI*220.0)*0.3 + sin(t*2.0*M_PI*1375.0)*0.15)
+                + noise*0.05f;
+    }
+
+    alGenBuffers(1, &buffer);
+    alBufferData(buffer, (channels == 2) ? AL_FORMAT_STEREO_FLOAT32 : AL_FORMAT_MONO_FLOAT32,
+        data, length*channels*(ALsizei)sizeof(*data), frequency);
+    free(data);
+
+    if(alGetError() != AL_NO_ERROR)
+    {
+        if(buffer && alIsBuffer(buffer))
+            alDeleteBuffers(1, &buffer);
+        return 0;
+    }
+    return buffer;
+}
+
+static void closeBench(BenchState *bench)
+{
+    if(bench->Context)
+    {
+        alDeleteSources(BENCH_MAX_VOICES, bench->Sources);
+        alDeleteBuffers(1, &bench->Buffer);
+        if(bench->IrBuffer)
+            alDeleteBuffers(1, &bench->IrBuffer);
+        alcMakeContextCurrent(NULL);
+        alcDestroyContext(bench->Context);
+    }
+    if(bench->Device)
+        alcCloseDevice(bench->Device);
+    free(bench->Output);
+    memset(bench, 0, sizeof(*bench));
+}
+
+/* Sets up a loopback device with the given format, and the sources to play. */
+static int openBench(BenchState *bench, ALCint frequency, ALCint updateSize, ALCint hrtf)
+{
+    ALCint attrs[] = {
+        ALC_FREQUENCY, frequency,
+        ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+        ALC_FORMAT_TYPE_SOFT, ALC_FLOAT_SOFT,
+        ALC_HRTF_SOFT, hrtf,
+        ALC_MONO_SOURCES, BENCH_MAX_VOICES,
+        0
+    };
+    ALsizei i;
+
+    memset(bench, 0, sizeof(*bench));
+    bench->Frequency = frequency;
+    bench->UpdateSize = updateSize;
+    bench->Output = calloc((size_t)updateSize*2, sizeof(*bench->Output));
+    bench->Device = palcLoopbackOpenDeviceSOFT(NULL);
+    if(!bench->Output || !bench->Device)
+    {
+        closeBench(bench);
+        return 0;
+    }
+    bench->Context = alcCreateContext(bench->Device, attrs);
+    if(!bench->Context || alcMakeContextCurrent(bench->Context) == ALC_FALSE)
+    {
+        if(bench->Context)
+            alcDestroyContext(bench->Context);
+        bench->Context = NULL;
+        closeBench(bench);
+        return 0;
+    }
+    if(hrtf)
+    {
+        ALCint hrtf_state = ALC_FALSE;
+        alcGetIntegerv(bench->Device, ALC_HRTF_SOFT, 1, &hrtf_state);
+        if(!hrtf_state)
+        {
+            closeBench(bench);
+            return 0;
+        }
+    }
+
+    bench->Buffer = createBenchBuffer(frequency, 1);
+    alGenSources(BENCH_MAX_VOICES, bench->Sources);
+    for(i = 0;i < BENCH_MAX_VOICES;i++)
+    {
+        /* Vary the pitch so the sources need resampling, and spread them
+         * around the listener.
+         */
+        const double angle = i*2.399963;
+        alSourcei(bench->Sources[i], AL_BUFFER, (ALint)bench->Buffer);
+        alSourcei(bench->Sources[i], AL_LOOPING, AL_TRUE);
+        alSourcef(bench->Sources[i], AL_PITCH, 0.75f + (float)(i%11)*0.05f);
+        alSource3f(bench->Sources[i], AL_POSITION, (ALfloat)sin(angle), (ALfloat)((i%3) - 1),
+            (ALfloat)-cos(angle));
+    }
+    if(checkALErrors() != AL_NO_ERROR)
+    {
+        closeBench(bench);
+        return 0;
+    }
+    return 1;
+}
+
+/* Plays the given number of voices, and returns whether it rendered in real
+ * time (with some headroom). Rendering stops early once it's too slow.
+ */
+static int runBench(BenchState *bench, ALsizei voices)
+{
+    const double budget = BENCH_TIME * BENCH_LOAD;
+    const ALCint total = (ALCint)(BENCH_TIME * bench->Frequency);
+    ALCint done = 0;
+    double start, elapsed = 0.0;
+
+    alSourcePlayv(voices, bench->Sources);
+
+    /* Render an update first, so any setup isn't counted. */
+    palcRenderSamplesSOFT(bench->Device, bench->Output, bench->UpdateSize);
+
+    start = getTime();
+    while(done < total)
+    {
+        palcRenderSamplesSOFT(bench->Device, bench->Output, bench->UpdateSize);
+        done += bench->UpdateSize;
+
+        elapsed = getTime() - start;
+        if(elapsed > budget)
+            break;
+    }
+    alSourceStopv(voices, bench->Sources);
+    alSourceRewindv(voices, bench->Sources);
+
+    return elapsed <= budget * (double)done / total;
+}
+
+/* Finds the most voices (or whatever count the callback sets up) that can be
+ * rendered in real time. Returns 0 if even the minimum can't.
+ */
+static ALsizei findMaxCount(BenchState *bench, ALsizei minCount, ALsizei maxCount,
+    int (*run)(BenchState*, ALsizei, void*), void *userdata)
+{
+    ALsizei good = 0, bad = maxCount+1, count = minCount;
+
+    /* Double the count until it's too much, then narrow it down to within a
+     * few percent.
+     */
+    while(count <= maxCount && run(bench, count, userdata))
+    {
+        good = count;
+        count *= 2;
+    }
+    if(count <= maxCount)
+        bad = count;
+    else if(good == maxCount)
+        return good;
+    else if(good > 0)
+    {
+        if(run(bench, maxCount, userdata))
+            return maxCount;
+        bad = maxCount;
+    }
+    while(good > 0 && bad-good > good/32 + 1)
+    {
+        const ALsizei mid = good + (bad-good)/2;
+        if(run(bench, mid, userdata))
+            good = mid;
+        else
+            bad = mid;
+    }
+    return good;
+}
+
+static int runVoiceBench(BenchState *bench, ALsizei voices, void *userdata)
+{
+    const ALint resampler = *(const ALint*)userdata;
+    ALsizei i;
+
+    for(i = 0;i < voices;i++)
+        alSourcei(bench->Sources[i], AL_SOURCE_RESAMPLER_SOFT, resampler);
+    return runBench(bench, voices);
+}
+
+static int runSlotBench(BenchState *bench, ALsizei numslots, void *userdata)
+{
+    const ALenum type = *(const ALenum*)userdata;
+    ALuint slots[BENCH_MAX_SLOTS] = {0};
+    ALuint effect = 0;
+    ALsizei i;
+    int ret = 0;
+
+    palGenEffects(1, &effect);
+    palEffecti(effect, AL_EFFECT_TYPE, type);
+    palGenAuxiliaryEffectSlots(numslots, slots);
+    if(type == AL_EFFECT_CONVOLUTION_REVERB_SOFT && !bench->IrBuffer)
+        bench->IrBuffer = createBenchBuffer(bench->Frequency, 2);
+    for(i = 0;i < numslots;i++)
+    {
+        if(type == AL_EFFECT_CONVOLUTION_REVERB_SOFT)
+        {
+            palAuxiliaryEffectSloti(slots[i], AL_BUFFER, (ALint)bench->IrBuffer);
+            palAuxiliaryEffectSlotf(slots[i], AL_EFFECTSLOT_GAIN, 1.0f / 16.0f);
+        }
+        palAuxiliaryEffectSloti(slots[i], AL_EFFECTSLOT_EFFECT, (ALint)effect);
+    }
+    /* Feed each slot from the voices, so none of them sit idle. */
+    for(i = 0;i < BENCH_SLOT_VOICES;i++)
+        alSource3i(bench->Sources[i], AL_AUXILIARY_SEND_FILTER, (ALint)slots[i%numslots], 0,
+            AL_FILTER_NULL);
+    if(alGetError() == AL_NO_ERROR)
+        ret = runBench(bench, BENCH_SLOT_VOICES);
+
+    for(i = 0;i < BENCH_SLOT_VOICES;i++)
+        alSource3i(bench->Sources[i], AL_AUXILIARY_SEND_FILTER, AL_EFFECTSLOT_NULL, 0,
+            AL_FILTER_NULL);
+    palDeleteAuxiliaryEffectSlots(numslots, slots);
+    palDeleteEffects(1, &effect);
+    return ret;
+}
+
+/* Measures how many voices of each resampler, with and without HRTF, and how
+ * many reverb and convolution slots can be rendered in real time, using a
+ * loopback device with the given format. The results are printed as
+ * "bench.<measure> key=value..." lines, to be easily parsed.
+ */
+static void runBenchmarks(ALCint frequency, ALCint updateSize)
+{
+    LPALGETSTRINGISOFT palGetStringiSOFT;
+    BenchState bench;
+    ALCint hrtf;
+
+    if(alcIsExtensionPresent(NULL, "ALC_SOFT_loopback") == ALC_FALSE)
+    {
+        printf("\n!!! Loopback devices not available for benchmarking !!!\n");
+        return;
+    }
+    palcLoopbackOpenDeviceSOFT = FUNCTION_CAST(LPALCLOOPBACKOPENDEVICESOFT,
+        alcGetProcAddress(NULL, "alcLoopbackOpenDeviceSOFT"));
+    palcRenderSamplesSOFT = FUNCTION_CAST(LPALCRENDERSAMPLESSOFT,
+        alcGetProcAddress(NULL, "alcRenderSamplesSOFT"));
+
+    printf("\n** Benchmark results **\n");
+    printf("bench.format frequency=%d update=%d channels=stereo type=float32 realtime_load=%.2f\n",
+        frequency, updateSize, BENCH_LOAD);
+    fflush(stdout);
+
+    for(hrtf = 0;hrtf < 2;hrtf++)
+    {
+        ALint num_resamplers, i;
+
+        if(!openBench(&bench, frequency, updateSize, hrtf ? ALC_TRUE : ALC_FALSE))
+        {
+            printf("bench.voices hrtf=%d unavailable\n", hrtf);
+            continue;
+        }
+        if(!alIsExtensionPresent("AL_SOFT_source_resampler"))
+        {
+            ALint resampler = 0;
+            printf("bench.voices resampler=default hrtf=%d max=%d\n", hrtf,
+                findMaxCount(&bench, 16, BENCH_MAX_VOICES, runVoiceBench, &resampler));
+            closeBench(&bench);
+            continue;
+        }
+
+        palGetStringiSOFT = FUNCTION_CAST(LPALGETSTRINGISOFT,
+            alGetProcAddress("alGetStringiSOFT"));
+        num_resamplers = alGetInteger(AL_NUM_RESAMPLERS_SOFT);
+        for(i = 0;i < num_resamplers;i++)
+        {
+            printf("bench.voices resampler=\"%s\" hrtf=%d max=%d\n",
+                palGetStringiSOFT(AL_RESAMPLER_NAME_SOFT, i), hrtf,
+                findMaxCount(&bench, 16, BENCH_MAX_VOICES, runVoiceBench, &i));
+            fflush(stdout);
+        }
+        closeBench(&bench);
+    }
+
+    if(!openBench(&bench, frequency, updateSize, ALC_FALSE))
+        return;
+    if(alcIsExtensionPresent(bench.Device, "ALC_EXT_EFX") == ALC_FALSE)
+        printf("bench.slots unavailable\n");
+    else
+    {
+        static const struct {
+            ALenum Type;
+            const char *Name;
+            const char *Extension;
+        } effects[] = {
+            { AL_EFFECT_REVERB, "reverb", NULL },
+            { AL_EFFECT_CONVOLUTION_REVERB_SOFT, "convolution", "AL_SOFTX_convolution_reverb" },
+        };
+        size_t i;
+
+        palGenEffects = FUNCTION_CAST(LPALGENEFFECTS, alGetProcAddress("alGenEffects"));
+        palDeleteEffects = FUNCTION_CAST(LPALDELETEEFFECTS, alGetProcAddress("alDeleteEffects"));
+        palEffecti = FUNCTION_CAST(LPALEFFECTI, alGetProcAddress("alEffecti"));
+        palGenAuxiliaryEffectSlots = FUNCTION_CAST(LPALGENAUXILIARYEFFECTSLOTS,
+            alGetProcAddress("alGenAuxiliaryEffectSlots"));
+        palDeleteAuxiliaryEffectSlots = FUNCTION_CAST(LPALDELETEAUXILIARYEFFECTSLOTS,
+            alGetProcAddress("alDeleteAuxiliaryEffectSlots"));
+        palAuxiliaryEffectSloti = FUNCTION_CAST(LPALAUXILIARYEFFECTSLOTI,
+            alGetProcAddress("alAuxiliaryEffectSloti"));
+        palAuxiliaryEffectSlotf = FUNCTION_CAST(LPALAUXILIARYEFFECTSLOTF,
+            alGetProcAddress("alAuxiliaryEffectSlotf"));
+
+        for(i = 0;i < sizeof(effects)/sizeof(effects[0]);i++)
+        {
+            ALenum type = effects[i].Type;
+            if(effects[i].Extension && !alIsExtensionPresent(effects[i].Extension))
+            {
+                printf("bench.slots effect=%s unavailable\n", effects[i].Name);
+                continue;
+            }
+            printf("bench.slots effect=%s voices=%d max=%d\n", effects[i].Name,
+                BENCH_SLOT_VOICES, findMaxCount(&bench, 1, BENCH_MAX_SLOTS, runSlotBench, &type));
+            fflush(stdout);
+        }
+    }
+    closeBench(&bench);
+}
+
 int main(int argc, char *argv[])
 {
     ALCdevice *device;
     ALCcontext *context;
+    ALCint frequency = 0, refresh = 0;
+    int bench = 0;
 
 #ifdef _WIN32
     /* OpenAL Soft gives UTF-8 strings, so set the console to expect that. */
@@ -389,9 +787,17 @@ int main(int argc, char *argv[])
     if(argc > 1 && (strcmp(argv[1], "--help") == 0 ||
                     strcmp(argv[1], "-h") == 0))
     {
-        printf("Usage: %s [playback device]\n", argv[0]);
+        printf("Usage: %s [--bench] [playback device]\n\n"
+            "  --bench  Measure how many voices and effect slots can be rendered in real\n"
+            "           time, using the playback device's sample rate and update size\n",
+            argv[0]);
         return 0;
     }
+    if(argc > 1 && strcmp(argv[1], "--bench") == 0)
+    {
+        bench = 1;
+        argv++; argc--;
+    }
 
     printf("Available playback devices:\n");
     if(alcIsExtensionPresent(NULL, "ALC_ENUMERATE_ALL_EXT") != AL_FALSE)
@@ -436,9 +842,18 @@ int main(int argc, char *argv[])
     printResamplerInfo();
     printEFXInfo(device);
 
+    alcGetIntegerv(device, ALC_FREQUENCY, 1, &frequency);
+    alcGetIntegerv(device, ALC_REFRESH, 1, &refresh);
+
     alcMakeContextCurrent(NULL);
     alcDestroyContext(context);
     alcCloseDevice(device);
 
+    if(bench)
+    {
+        if(frequency <= 0) frequency = 48000;
+        runBenchmarks(frequency, (refresh > 0) ? frequency/refresh : 1024);
+    }
+
     return 0;
 }
@@ -25,11 +25,17 @@
 #include "config.h"
 
 #include <array>
+#include <atomic>
 #include <complex>
+#include <cstdarg>
 #include <cstddef>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -105,7 +111,11 @@ byte4 f32AsLEBytes<al::endian::big>(const float &value)
 }
 
 
-constexpr uint BufferLineSize{1024};
+/* Files are processed in large blocks. Besides reducing the number of file
+ * reads and writes, larger blocks let the FFT-based phase-shift work with
+ * larger, more efficient FFTs.
+ */
+constexpr uint BufferLineSize{8192};
 
 using FloatBufferLine = std::array<float,BufferLineSize>;
 using FloatBufferSpan = al::span<float,BufferLineSize>;
@@ -134,6 +144,10 @@ struct UhjDecoder {
 };
 
 const PhaseShifterT<UhjDecoder::sFilterDelay*2> PShift{};
+/* The phase-shift filter is long enough that applying it with FFT convolution
+ * is much faster than directly.
+ */
+const PhaseShifterFftT<UhjDecoder::sFilterDelay*2,16384> PShiftFft{PShift, BufferLineSize};
 
 
 /* Decoding UHJ is done as:
@@ -248,7 +262,7 @@ void UhjDecoder::decode(const float *RESTRICT InSamples, const std::size_t InCha
     std::transform(mD.cbegin(), mD.cbegin()+SamplesToDo+sFilterDelay, mT.cbegin(), tmpiter,
         [](const float d, const float t) noexcept { return 0.828331f*d + 0.767820f*t; });
     std::copy_n(mTemp.cbegin()+SamplesToDo, mDTHistory.size(), mDTHistory.begin());
-    PShift.process({xoutput, SamplesToDo}, mTemp.data());
+    PShiftFft.process({xoutput, SamplesToDo}, mTemp.data());
 
     for(std::size_t i{0};i < SamplesToDo;++i)
     {
@@ -262,7 +276,7 @@ void UhjDecoder::decode(const float *RESTRICT InSamples, const std::size_t InCha
     tmpiter = std::copy(mSHistory.cbegin(), mSHistory.cend(), mTemp.begin());
     std::copy_n(mS.cbegin(), SamplesToDo+sFilterDelay, tmpiter);
     std::copy_n(mTemp.cbegin()+SamplesToDo, mSHistory.size(), mSHistory.begin());
-    PShift.process({youtput, SamplesToDo}, mTemp.data());
+    PShiftFft.process({youtput, SamplesToDo}, mTemp.data());
 
     for(std::size_t i{0};i < SamplesToDo;++i)
     {
@@ -324,7 +338,7 @@ void UhjDecoder::decode2(const float *RESTRICT InSamples,
     auto tmpiter = std::copy(mDTHistory.cbegin(), mDTHistory.cend(), mTemp.begin());
     std::copy_n(mD.cbegin(), SamplesToDo+sFilterDelay, tmpiter);
     std::copy_n(mTemp.cbegin()+SamplesToDo, mDTHistory.size(), mDTHistory.begin());
-    PShift.process({xoutput, SamplesToDo}, mTemp.data());
+    PShiftFft.process({xoutput, SamplesToDo}, mTemp.data());
 
     for(std::size_t i{0};i < SamplesToDo;++i)
     {
@@ -338,7 +352,7 @@ void UhjDecoder::decode2(const float *RESTRICT InSamples,
     tmpiter = std::copy(mSHistory.cbegin(), mSHistory.cend(), mTemp.begin());
     std::copy_n(mS.cbegin(), SamplesToDo+sFilterDelay, tmpiter);
     std::copy_n(mTemp.cbegin()+SamplesToDo, mSHistory.size(), mSHistory.begin());
-    PShift.process({youtput, SamplesToDo}, mTemp.data());
+    PShiftFft.process({youtput, SamplesToDo}, mTemp.data());
 
     for(std::size_t i{0};i < SamplesToDo;++i)
     {
@@ -351,12 +365,198 @@ void UhjDecoder::decode2(const float *RESTRICT InSamples,
 }
 
 
+/* Collects the messages for one file, so files converted in parallel don't
+ * interleave their output. The messages are printed together once the file is
+ * done.
+ */
+class FileLog {
+    std::vector<std::pair<FILE*,std::string>> mMessages;
+
+public:
+    [[gnu::format(printf,3,4)]]
+    void add(FILE *stream, const char *fmt, ...)
+    {
+        std::va_list args, args2;
+        va_start(args, fmt);
+        va_copy(args2, args);
+        if(const int msglen{std::vsnprintf(nullptr, 0, fmt, args)}; msglen > 0)
+        {
+            std::string msg(static_cast<size_t>(msglen)+1, '\0');
+            std::vsnprintf(msg.data(), msg.size(), fmt, args2);
+            msg.pop_back();
+            mMessages.emplace_back(stream, std::move(msg));
+        }
+        va_end(args2);
+        va_end(args);
+    }
+
+    void flush()
+    {
+        static std::mutex sPrintLock;
+        std::lock_guard<std::mutex> _{sPrintLock};
+        for(const auto &msg : mMessages)
+            fputs(msg.second.c_str(), msg.first);
+        mMessages.clear();
+    }
+};
+
+
+bool DecodeFile(const char *filename, const bool use_general, FileLog &log)
+{
+    SF_INFO ininfo{};
+    SndFilePtr infile{sf_open(filename, SFM_READ, &ininfo)};
+    if(!infile)
+    {
+        log.add(stderr, "Failed to open %s\n", filename);
+        return false;
+    }
+    if(sf_command(infile.get(), SFC_WAVEX_GET_AMBISONIC, NULL, 0) == SF_AMBISONIC_B_FORMAT)
+    {
+        log.add(stderr, "%s is already B-Format\n", filename);
+        return false;
+    }
+    uint outchans{};
+    if(ininfo.channels == 2)
+        outchans = 3;
+    else if(ininfo.channels == 3 || ininfo.channels == 4)
+        outchans = static_cast<uint>(ininfo.channels);
+    else
+    {
+        log.add(stderr, "%s is not a 2-, 3-, or 4-channel file\n", filename);
+        return false;
+    }
+    log.add(stdout, "Converting %s from %d-channel UHJ%s...\n", filename, ininfo.channels,
+        (ininfo.channels == 2) ? use_general ? " (general)" : " (alternative)" : "");
+
+    std::string outname{filename};
+    auto lastslash = outname.find_last_of('/');
+    if(lastslash != std::string::npos)
+        outname.erase(0, lastslash+1);
+    auto lastdot = outname.find_last_of('.');
+    if(lastdot != std::string::npos)
+        outname.resize(lastdot+1);
+    outname += "amb";
+
+    FilePtr outfile{fopen(outname.c_str(), "wb")};
+    if(!outfile)
+    {
+        log.add(stderr, "Failed to create %s\n", outname.c_str());
+        return false;
+    }
+
+    fputs("RIFF", outfile.get());
+    fwrite32le(0xFFFFFFFF, outfile.get()); // 'RIFF' header len; filled in at close
+
+    fputs("WAVE", outfile.get());
+
+    fputs("fmt ", outfile.get());
+    fwrite32le(40, outfile.get()); // 'fmt ' header len; 40 bytes for EXTENSIBLE
+
+    // 16-bit val, format type id (extensible: 0xFFFE)
+    fwrite16le(0xFFFE, outfile.get());
+    // 16-bit val, channel count
+    fwrite16le(static_cast<ushort>(outchans), outfile.get());
+    // 32-bit val, frequency
+    fwrite32le(static_cast<uint>(ininfo.samplerate), outfile.get());
+    // 32-bit val, bytes per second
+    fwrite32le(static_cast<uint>(ininfo.samplerate)*sizeof(float)*outchans, outfile.get());
+    // 16-bit val, frame size
+    fwrite16le(static_cast<ushort>(sizeof(float)*outchans), outfile.get());
+    // 16-bit val, bits per sample
+    fwrite16le(static_cast<ushort>(sizeof(float)*8), outfile.get());
+    // 16-bit val, extra byte count
+    fwrite16le(22, outfile.get());
+    // 16-bit val, valid bits per sample
+    fwrite16le(static_cast<ushort>(sizeof(float)*8), outfile.get());
+    // 32-bit val, channel mask
+    fwrite32le(0, outfile.get());
+    // 16 byte GUID, sub-type format
+    fwrite(SUBTYPE_BFORMAT_FLOAT, 1, 16, outfile.get());
+
+    fputs("data", outfile.get());
+    fwrite32le(0xFFFFFFFF, outfile.get()); // 'data' header len; filled in at close
+    if(ferror(outfile.get()))
+    {
+        log.add(stderr, "Error writing wave file header: %s (%d)\n", strerror(errno), errno);
+        return false;
+    }
+
+    auto DataStart = ftell(outfile.get());
+
+    auto decoder = std::make_unique<UhjDecoder>();
+    auto inmem = std::make_unique<float[]>(BufferLineSize*static_cast<uint>(ininfo.channels));
+    auto decmem = al::vector<std::array<float,BufferLineSize>, 16>(outchans);
+    auto outmem = std::make_unique<byte4[]>(BufferLineSize*outchans);
+
+    /* A number of initial samples need to be skipped to cut the lead-in
+     * from the all-pass filter delay. The same number of samples need to
+     * be fed through the decoder after reaching the end of the input file
+     * to ensure none of the original input is lost.
+     */
+    std::size_t LeadIn{UhjDecoder::sFilterDelay};
+    sf_count_t LeadOut{UhjDecoder::sFilterDelay};
+    while(LeadOut > 0)
+    {
+        sf_count_t sgot{sf_readf_float(infile.get(), inmem.get(), BufferLineSize)};
+        sgot = std::max<sf_count_t>(sgot, 0);
+        if(sgot < BufferLineSize)
+        {
+            const sf_count_t remaining{std::min(BufferLineSize - sgot, LeadOut)};
+            std::fill_n(inmem.get() + sgot*ininfo.channels, remaining*ininfo.channels, 0.0f);
+            sgot += remaining;
+            LeadOut -= remaining;
+        }
+
+        auto got = static_cast<std::size_t>(sgot);
+        if(ininfo.channels > 2 || use_general)
+            decoder->decode(inmem.get(), static_cast<uint>(ininfo.channels), decmem, got);
+        else
+            decoder->decode2(inmem.get(), decmem, got);
+        if(LeadIn >= got)
+        {
+            LeadIn -= got;
+            continue;
+        }
+
+        got -= LeadIn;
+        for(std::size_t i{0};i < got;++i)
+        {
+            /* Attenuate by -3dB for FuMa output levels. */
+            constexpr auto inv_sqrt2 = static_cast<float>(1.0/al::numbers::sqrt2);
+            for(std::size_t j{0};j < outchans;++j)
+                outmem[i*outchans + j] = f32AsLEBytes(decmem[j][LeadIn+i] * inv_sqrt2);
+        }
+        LeadIn = 0;
+
+        std::size_t wrote{fwrite(outmem.get(), sizeof(byte4)*outchans, got, outfile.get())};
+        if(wrote < got)
+        {
+            log.add(stderr, "Error writing wave data: %s (%d)\n", strerror(errno), errno);
+            break;
+        }
+    }
+
+    auto DataEnd = ftell(outfile.get());
+    if(DataEnd > DataStart)
+    {
+        long dataLen{DataEnd - DataStart};
+        if(fseek(outfile.get(), 4, SEEK_SET) == 0)
+            fwrite32le(static_cast<uint>(DataEnd-8), outfile.get()); // 'WAVE' header len
+        if(fseek(outfile.get(), DataStart-4, SEEK_SET) == 0)
+            fwrite32le(static_cast<uint>(dataLen), outfile.get()); // 'data' header len
+    }
+    fflush(outfile.get());
+    return true;
+}
+
+
 int main(int argc, char **argv)
 {
     if(argc < 2 || std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0)
     {
         printf("Usage: %s <[options] filename.wav...>\n\n"
             "  Options:\n"
+            "    -j <threads>   Number of files to decode in parallel (default: all CPUs).\n"
             "    --general      Use the general equations for 2-channel UHJ (default).\n"
             "    --alternative  Use the alternative equations for 2-channel UHJ.\n"
             "\n"
@@ -367,8 +567,9 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    std::size_t num_files{0}, num_decoded{0};
     bool use_general{true};
+    uint numThreads{std::max(std::thread::hardware_concurrency(), 1u)};
+    std::vector<std::pair<const char*,bool>> files;
     for(int fidx{1};fidx < argc;++fidx)
     {
         if(std::strcmp(argv[fidx], "--general") == 0)
@@ -381,157 +582,49 @@ int main(int argc, char **argv)
             use_general = false;
             continue;
         }
-        ++num_files;
-        SF_INFO ininfo{};
-        SndFilePtr infile{sf_open(argv[fidx], SFM_READ, &ininfo)};
-        if(!infile)
+        if(std::strcmp(argv[fidx], "-j") == 0)
         {
-            fprintf(stderr, "Failed to open %s\n", argv[fidx]);
-            continue;
-        }
-        if(sf_command(infile.get(), SFC_WAVEX_GET_AMBISONIC, NULL, 0) == SF_AMBISONIC_B_FORMAT)
-        {
-            fprintf(stderr, "%s is already B-Format\n", argv[fidx]);
-            continue;
-        }
-        uint outchans{};
-        if(ininfo.channels == 2)
-            outchans = 3;
-        else if(ininfo.channels == 3 || ininfo.channels == 4)
-            outchans = static_cast<uint>(ininfo.channels);
-        else
-        {
-            fprintf(stderr, "%s is not a 2-, 3-, or 4-channel file\n", argv[fidx]);
-            continue;
-        }
-        printf("Converting %s from %d-channel UHJ%s...\n", argv[fidx], ininfo.channels,
-            (ininfo.channels == 2) ? use_general ? " (general)" : " (alternative)" : "");
-
-        std::string outname{argv[fidx]};
-        auto lastslash = outname.find_last_of('/');
-        if(lastslash != std::string::npos)
-            outname.erase(0, lastslash+1);
-        auto lastdot = outname.find_last_of('.');
-        if(lastdot != std::string::npos)
-            outname.resize(lastdot+1);
-        outname += "amb";
-
-        FilePtr outfile{fopen(outname.c_str(), "wb")};
-        if(!outfile)
-        {
-            fprintf(stderr, "Failed to create %s\n", outname.c_str());
-            continue;
-        }
-
-        fputs("RIFF", outfile.get());
-        fwrite32le(0xFFFFFFFF, outfile.get()); // 'RIFF' header len; filled in at close
-
-        fputs("WAVE", outfile.get());
-
-        fputs("fmt ", outfile.get());
-        fwrite32le(40, outfile.get()); // 'fmt ' header len; 40 bytes for EXTENSIBLE
-
-        // 16-bit val, format type id (extensible: 0xFFFE)
-        fwrite16le(0xFFFE, outfile.get());
-        // 16-bit val, channel count
-        fwrite16le(static_cast<ushort>(outchans), outfile.get());
-        // 32-bit val, frequency
-        fwrite32le(static_cast<uint>(ininfo.samplerate), outfile.get());
-        // 32-bit val, bytes per second
-        fwrite32le(static_cast<uint>(ininfo.samplerate)*sizeof(float)*outchans, outfile.get());
-        // 16-bit val, frame size
-        fwrite16le(static_cast<ushort>(sizeof(float)*outchans), outfile.get());
-        // 16-bit val, bits per sample
-        fwrite16le(static_cast<ushort>(sizeof(float)*8), outfile.get());
-        // 16-bit val, extra byte count
-        fwrite16le(22, outfile.get());
-        // 16-bit val, valid bits per sample
-        fwrite16le(static_cast<ushort>(sizeof(float)*8), outfile.get());
-        // 32-bit val, channel mask
-        fwrite32le(0, outfile.get());
-        // 16 byte GUID, sub-type format
-        fwrite(SUBTYPE_BFORMAT_FLOAT, 1, 16, outfile.get());
-
-        fputs("data", outfile.get());
-        fwrite32le(0xFFFFFFFF, outfile.get()); // 'data' header len; filled in at close
-        if(ferror(outfile.get()))
-        {
-            fprintf(stderr, "Error writing wave file header: %s (%d)\n", strerror(errno), errno);
-            continue;
-        }
-
-        auto DataStart = ftell(outfile.get());
-
-        auto decoder = std::make_unique<UhjDecoder>();
-        auto inmem = std::make_unique<float[]>(BufferLineSize*static_cast<uint>(ininfo.channels));
-        auto decmem = al::vector<std::array<float,BufferLineSize>, 16>(outchans);
-        auto outmem = std::make_unique<byte4[]>(BufferLineSize*outchans);
-
-        /* A number of initial samples need to be skipped to cut the lead-in
-         * from the all-pass filter delay. The same number of samples need to
-         * be fed through the decoder after reaching the end of the input file
-         * to ensure none of the original input is lost.
-         */
-        std::size_t LeadIn{UhjDecoder::sFilterDelay};
-        sf_count_t LeadOut{UhjDecoder::sFilterDelay};
-        while(LeadOut > 0)
-        {
-            sf_count_t sgot{sf_readf_float(infile.get(), inmem.get(), BufferLineSize)};
-            sgot = std::max<sf_count_t>(sgot, 0);
-            if(sgot < BufferLineSize)
-            {
-                const sf_count_t remaining{std::min(BufferLineSize - sgot, LeadOut)};
-                std::fill_n(inmem.get() + sgot*ininfo.channels, remaining*ininfo.channels, 0.0f);
-                sgot += remaining;
-                LeadOut -= remaining;
-            }
-
-            auto got = static_cast<std::size_t>(sgot);
-            if(ininfo.channels > 2 || use_general)
-                decoder->decode(inmem.get(), static_cast<uint>(ininfo.channels), decmem, got);
-            else
-                decoder->decode2(inmem.get(), decmem, got);
-            if(LeadIn >= got)
+            char *end{};
+            const unsigned long count{(fidx+1 < argc) ? strtoul(argv[fidx+1], &end, 10) : 0};
+            if(!end || *end != '\0' || count > 64)
             {
-                LeadIn -= got;
-                continue;
-            }
-
-            got -= LeadIn;
-            for(std::size_t i{0};i < got;++i)
-            {
-                /* Attenuate by -3dB for FuMa output levels. */
-                constexpr auto inv_sqrt2 = static_cast<float>(1.0/al::numbers::sqrt2);
-                for(std::size_t j{0};j < outchans;++j)
-                    outmem[i*outchans + j] = f32AsLEBytes(decmem[j][LeadIn+i] * inv_sqrt2);
-            }
-            LeadIn = 0;
-
-            std::size_t wrote{fwrite(outmem.get(), sizeof(byte4)*outchans, got, outfile.get())};
-            if(wrote < got)
-            {
-                fprintf(stderr, "Error writing wave data: %s (%d)\n", strerror(errno), errno);
-                break;
+                fprintf(stderr, "Expected a thread count between 0 and 64 for -j\n");
+                return 1;
             }
+            numThreads = count ? static_cast<uint>(count)
+                : std::max(std::thread::hardware_concurrency(), 1u);
+            ++fidx;
+            continue;
         }
+        files.emplace_back(argv[fidx], use_general);
+    }
 
-        auto DataEnd = ftell(outfile.get());
-        if(DataEnd > DataStart)
+    /* Each thread takes the next file to decode until they're all done. */
+    std::atomic<std::size_t> next_file{0}, num_decoded{0};
+    auto decode_files = [&files,&next_file,&num_decoded]()
+    {
+        FileLog log;
+        std::size_t idx;
+        while((idx=next_file.fetch_add(1, std::memory_order_relaxed)) < files.size())
         {
-            long dataLen{DataEnd - DataStart};
-            if(fseek(outfile.get(), 4, SEEK_SET) == 0)
-                fwrite32le(static_cast<uint>(DataEnd-8), outfile.get()); // 'WAVE' header len
-            if(fseek(outfile.get(), DataStart-4, SEEK_SET) == 0)
-                fwrite32le(static_cast<uint>(dataLen), outfile.get()); // 'data' header len
+            if(DecodeFile(files[idx].first, files[idx].second, log))
+                num_decoded.fetch_add(1, std::memory_order_relaxed);
+            log.flush();
         }
-        fflush(outfile.get());
-        ++num_decoded;
-    }
+    };
+    std::vector<std::thread> thrds;
+    for(std::size_t i{1};i < std::min<std::size_t>(numThreads, files.size());++i)
+        thrds.emplace_back(decode_files);
+    decode_files();
+    for(auto &thrd : thrds)
+        thrd.join();
+
+    const std::size_t num_files{files.size()};
     if(num_decoded == 0)
         fprintf(stderr, "Failed to decode any input files\n");
     else if(num_decoded < num_files)
-        fprintf(stderr, "Decoded %zu of %zu files\n", num_decoded, num_files);
+        fprintf(stderr, "Decoded %zu of %zu files\n", num_decoded.load(), num_files);
     else
-        printf("Decoded %zu file%s\n", num_decoded, (num_decoded==1)?"":"s");
+        printf("Decoded %zu file%s\n", num_decoded.load(), (num_decoded==1)?"":"s");
     return 0;
 }
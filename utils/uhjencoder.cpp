@@ -25,11 +25,17 @@
 #include "config.h"
 
 #include <array>
+#include <atomic>
 #include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <stddef.h>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -55,7 +61,11 @@ using SndFilePtr = std::unique_ptr<SNDFILE,SndFileDeleter>;
 
 using uint = unsigned int;
 
-constexpr uint BufferLineSize{1024};
+/* Files are processed in large blocks. Besides reducing the number of file
+ * reads and writes, larger blocks let the FFT-based phase-shift work with
+ * larger, more efficient FFTs.
+ */
+constexpr uint BufferLineSize{8192};
 
 using FloatBufferLine = std::array<float,BufferLineSize>;
 using FloatBufferSpan = al::span<float,BufferLineSize>;
@@ -87,6 +97,10 @@ struct UhjEncoder {
 };
 
 const PhaseShifterT<UhjEncoder::sFilterDelay*2> PShift{};
+/* The phase-shift filter is long enough that applying it with FFT convolution
+ * is much faster than directly.
+ */
+const PhaseShifterFftT<UhjEncoder::sFilterDelay*2,16384> PShiftFft{PShift, BufferLineSize};
 
 
 /* Encoding UHJ from B-Format is done as:
@@ -126,7 +140,7 @@ void UhjEncoder::encode(const al::span<FloatBufferLine> OutSamples,
         [](const float w, const float x) noexcept -> float
         { return -0.3420201f*w + 0.5098604f*x; });
     std::copy_n(mTemp.cbegin()+SamplesToDo, mWXHistory1.size(), mWXHistory1.begin());
-    PShift.process({mD.data(), SamplesToDo}, mTemp.data());
+    PShiftFft.process({mD.data(), SamplesToDo}, mTemp.data());
 
     /* D = j(-0.3420201*W + 0.5098604*X) + 0.6554516*Y */
     for(size_t i{0};i < SamplesToDo;++i)
@@ -149,7 +163,7 @@ void UhjEncoder::encode(const al::span<FloatBufferLine> OutSamples,
             [](const float w, const float x) noexcept -> float
             { return -0.1432f*w + 0.6512f*x; });
         std::copy_n(mTemp.cbegin()+SamplesToDo, mWXHistory2.size(), mWXHistory2.begin());
-        PShift.process({mT.data(), SamplesToDo}, mTemp.data());
+        PShiftFft.process({mT.data(), SamplesToDo}, mTemp.data());
 
         /* T = j(-0.1432*W + 0.6512*X) - 0.7071068*Y */
         float *RESTRICT t{al::assume_aligned<16>(OutSamples[2].data())};
@@ -236,294 +250,371 @@ constexpr auto GenCoeffs(double x /*+front*/, double y /*+left*/, double z /*+up
     }};
 }
 
-} // namespace
 
+/* Collects the messages for one file, so files converted in parallel don't
+ * interleave their output. The messages are printed together once the file is
+ * done.
+ */
+class FileLog {
+    std::vector<std::pair<FILE*,std::string>> mMessages;
 
-int main(int argc, char **argv)
-{
-    if(argc < 2 || std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0)
+public:
+    [[gnu::format(printf,3,4)]]
+    void add(FILE *stream, const char *fmt, ...)
     {
-        printf("Usage: %s <infile...>\n\n", argv[0]);
-        return 1;
+        std::va_list args, args2;
+        va_start(args, fmt);
+        va_copy(args2, args);
+        if(const int msglen{std::vsnprintf(nullptr, 0, fmt, args)}; msglen > 0)
+        {
+            std::string msg(static_cast<size_t>(msglen)+1, '\0');
+            std::vsnprintf(msg.data(), msg.size(), fmt, args2);
+            msg.pop_back();
+            mMessages.emplace_back(stream, std::move(msg));
+        }
+        va_end(args2);
+        va_end(args);
     }
 
-    uint uhjchans{2};
-    size_t num_files{0}, num_encoded{0};
-    for(int fidx{1};fidx < argc;++fidx)
+    void flush()
     {
-        if(strcmp(argv[fidx], "-bhj") == 0)
-        {
-            uhjchans = 2;
-            continue;
-        }
-        if(strcmp(argv[fidx], "-thj") == 0)
-        {
-            uhjchans = 3;
-            continue;
-        }
-        if(strcmp(argv[fidx], "-phj") == 0)
-        {
-            uhjchans = 4;
-            continue;
-        }
-        ++num_files;
-
-        std::string outname{argv[fidx]};
-        size_t lastslash{outname.find_last_of('/')};
-        if(lastslash != std::string::npos)
-            outname.erase(0, lastslash+1);
-        size_t extpos{outname.find_last_of('.')};
-        if(extpos != std::string::npos)
-            outname.resize(extpos);
-        outname += ".uhj.flac";
-
-        SF_INFO ininfo{};
-        SndFilePtr infile{sf_open(argv[fidx], SFM_READ, &ininfo)};
-        if(!infile)
-        {
-            fprintf(stderr, "Failed to open %s\n", argv[fidx]);
-            continue;
-        }
-        printf("Converting %s to %s...\n", argv[fidx], outname.c_str());
-
-        /* Work out the channel map, preferably using the actual channel map
-         * from the file/format, but falling back to assuming WFX order.
-         */
-        al::span<const SpeakerPos> spkrs;
-        auto chanmap = std::vector<int>(static_cast<uint>(ininfo.channels), SF_CHANNEL_MAP_INVALID);
-        if(sf_command(infile.get(), SFC_GET_CHANNEL_MAP_INFO, chanmap.data(),
-            ininfo.channels*int{sizeof(int)}) == SF_TRUE)
+        static std::mutex sPrintLock;
+        std::lock_guard<std::mutex> _{sPrintLock};
+        for(const auto &msg : mMessages)
+            fputs(msg.second.c_str(), msg.first);
+        mMessages.clear();
+    }
+};
+
+
+bool EncodeFile(const char *filename, const uint uhjchans, FileLog &log)
+{
+    std::string outname{filename};
+    size_t lastslash{outname.find_last_of('/')};
+    if(lastslash != std::string::npos)
+        outname.erase(0, lastslash+1);
+    size_t extpos{outname.find_last_of('.')};
+    if(extpos != std::string::npos)
+        outname.resize(extpos);
+    outname += ".uhj.flac";
+
+    SF_INFO ininfo{};
+    SndFilePtr infile{sf_open(filename, SFM_READ, &ininfo)};
+    if(!infile)
+    {
+        log.add(stderr, "Failed to open %s\n", filename);
+        return false;
+    }
+    log.add(stdout, "Converting %s to %s...\n", filename, outname.c_str());
+
+    /* Work out the channel map, preferably using the actual channel map
+     * from the file/format, but falling back to assuming WFX order.
+     */
+    al::span<const SpeakerPos> spkrs;
+    auto chanmap = std::vector<int>(static_cast<uint>(ininfo.channels), SF_CHANNEL_MAP_INVALID);
+    if(sf_command(infile.get(), SFC_GET_CHANNEL_MAP_INFO, chanmap.data(),
+        ininfo.channels*int{sizeof(int)}) == SF_TRUE)
+    {
+        static const std::array<int,2> stereomap{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT}};
+        static const std::array<int,4> quadmap{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT,
+            SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT}};
+        static const std::array<int,6> x51map{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT,
+            SF_CHANNEL_MAP_CENTER, SF_CHANNEL_MAP_LFE,
+            SF_CHANNEL_MAP_SIDE_LEFT, SF_CHANNEL_MAP_SIDE_RIGHT}};
+        static const std::array<int,6> x51rearmap{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT,
+            SF_CHANNEL_MAP_CENTER, SF_CHANNEL_MAP_LFE,
+            SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT}};
+        static const std::array<int,8> x71map{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT,
+            SF_CHANNEL_MAP_CENTER, SF_CHANNEL_MAP_LFE,
+            SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT,
+            SF_CHANNEL_MAP_SIDE_LEFT, SF_CHANNEL_MAP_SIDE_RIGHT}};
+        static const std::array<int,12> x714map{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT,
+            SF_CHANNEL_MAP_CENTER, SF_CHANNEL_MAP_LFE,
+            SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT,
+            SF_CHANNEL_MAP_SIDE_LEFT, SF_CHANNEL_MAP_SIDE_RIGHT,
+            SF_CHANNEL_MAP_TOP_FRONT_LEFT, SF_CHANNEL_MAP_TOP_FRONT_RIGHT,
+            SF_CHANNEL_MAP_TOP_REAR_LEFT, SF_CHANNEL_MAP_TOP_REAR_RIGHT}};
+        static const std::array<int,3> ambi2dmap{{SF_CHANNEL_MAP_AMBISONIC_B_W,
+            SF_CHANNEL_MAP_AMBISONIC_B_X, SF_CHANNEL_MAP_AMBISONIC_B_Y}};
+        static const std::array<int,4> ambi3dmap{{SF_CHANNEL_MAP_AMBISONIC_B_W,
+            SF_CHANNEL_MAP_AMBISONIC_B_X, SF_CHANNEL_MAP_AMBISONIC_B_Y,
+            SF_CHANNEL_MAP_AMBISONIC_B_Z}};
+
+        auto match_chanmap = [](const al::span<int> a, const al::span<const int> b) -> bool
         {
-            static const std::array<int,2> stereomap{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT}};
-            static const std::array<int,4> quadmap{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT,
-                SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT}};
-            static const std::array<int,6> x51map{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT,
-                SF_CHANNEL_MAP_CENTER, SF_CHANNEL_MAP_LFE,
-                SF_CHANNEL_MAP_SIDE_LEFT, SF_CHANNEL_MAP_SIDE_RIGHT}};
-            static const std::array<int,6> x51rearmap{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT,
-                SF_CHANNEL_MAP_CENTER, SF_CHANNEL_MAP_LFE,
-                SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT}};
-            static const std::array<int,8> x71map{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT,
-                SF_CHANNEL_MAP_CENTER, SF_CHANNEL_MAP_LFE,
-                SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT,
-                SF_CHANNEL_MAP_SIDE_LEFT, SF_CHANNEL_MAP_SIDE_RIGHT}};
-            static const std::array<int,12> x714map{{SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT,
-                SF_CHANNEL_MAP_CENTER, SF_CHANNEL_MAP_LFE,
-                SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT,
-                SF_CHANNEL_MAP_SIDE_LEFT, SF_CHANNEL_MAP_SIDE_RIGHT,
-                SF_CHANNEL_MAP_TOP_FRONT_LEFT, SF_CHANNEL_MAP_TOP_FRONT_RIGHT,
-                SF_CHANNEL_MAP_TOP_REAR_LEFT, SF_CHANNEL_MAP_TOP_REAR_RIGHT}};
-            static const std::array<int,3> ambi2dmap{{SF_CHANNEL_MAP_AMBISONIC_B_W,
-                SF_CHANNEL_MAP_AMBISONIC_B_X, SF_CHANNEL_MAP_AMBISONIC_B_Y}};
-            static const std::array<int,4> ambi3dmap{{SF_CHANNEL_MAP_AMBISONIC_B_W,
-                SF_CHANNEL_MAP_AMBISONIC_B_X, SF_CHANNEL_MAP_AMBISONIC_B_Y,
-                SF_CHANNEL_MAP_AMBISONIC_B_Z}};
-
-            auto match_chanmap = [](const al::span<int> a, const al::span<const int> b) -> bool
+            if(a.size() != b.size())
+                return false;
+            for(const int id : a)
             {
-                if(a.size() != b.size())
+                if(std::find(b.begin(), b.end(), id) != b.end())
                     return false;
-                for(const int id : a)
-                {
-                    if(std::find(b.begin(), b.end(), id) != b.end())
-                        return false;
-                }
-                return true;
-            };
-            if(match_chanmap(chanmap, stereomap))
-                spkrs = StereoMap;
-            else if(match_chanmap(chanmap, quadmap))
-                spkrs = QuadMap;
-            else if(match_chanmap(chanmap, x51map))
-                spkrs = X51Map;
-            else if(match_chanmap(chanmap, x51rearmap))
-                spkrs = X51RearMap;
-            else if(match_chanmap(chanmap, x71map))
-                spkrs = X71Map;
-            else if(match_chanmap(chanmap, x714map))
-                spkrs = X714Map;
-            else if(match_chanmap(chanmap, ambi2dmap) || match_chanmap(chanmap, ambi3dmap))
-            {
-                /* Do nothing. */
-            }
-            else
-            {
-                std::string mapstr;
-                if(!chanmap.empty())
-                {
-                    mapstr = std::to_string(chanmap[0]);
-                    for(int idx : al::span<int>{chanmap}.subspan<1>())
-                    {
-                        mapstr += ',';
-                        mapstr += std::to_string(idx);
-                    }
-                }
-                fprintf(stderr, " ... %zu channels not supported (map: %s)\n", chanmap.size(),
-                    mapstr.c_str());
-                continue;
             }
-        }
-        else if(ininfo.channels == 2)
-        {
-            fprintf(stderr, " ... assuming WFX order stereo\n");
+            return true;
+        };
+        if(match_chanmap(chanmap, stereomap))
             spkrs = StereoMap;
-            chanmap[0] = SF_CHANNEL_MAP_FRONT_LEFT;
-            chanmap[1] = SF_CHANNEL_MAP_FRONT_RIGHT;
-        }
-        else if(ininfo.channels == 6)
-        {
-            fprintf(stderr, " ... assuming WFX order 5.1\n");
+        else if(match_chanmap(chanmap, quadmap))
+            spkrs = QuadMap;
+        else if(match_chanmap(chanmap, x51map))
             spkrs = X51Map;
-            chanmap[0] = SF_CHANNEL_MAP_FRONT_LEFT;
-            chanmap[1] = SF_CHANNEL_MAP_FRONT_RIGHT;
-            chanmap[2] = SF_CHANNEL_MAP_FRONT_CENTER;
-            chanmap[3] = SF_CHANNEL_MAP_LFE;
-            chanmap[4] = SF_CHANNEL_MAP_SIDE_LEFT;
-            chanmap[5] = SF_CHANNEL_MAP_SIDE_RIGHT;
-        }
-        else if(ininfo.channels == 8)
-        {
-            fprintf(stderr, " ... assuming WFX order 7.1\n");
+        else if(match_chanmap(chanmap, x51rearmap))
+            spkrs = X51RearMap;
+        else if(match_chanmap(chanmap, x71map))
             spkrs = X71Map;
-            chanmap[0] = SF_CHANNEL_MAP_FRONT_LEFT;
-            chanmap[1] = SF_CHANNEL_MAP_FRONT_RIGHT;
-            chanmap[2] = SF_CHANNEL_MAP_FRONT_CENTER;
-            chanmap[3] = SF_CHANNEL_MAP_LFE;
-            chanmap[4] = SF_CHANNEL_MAP_REAR_LEFT;
-            chanmap[5] = SF_CHANNEL_MAP_REAR_RIGHT;
-            chanmap[6] = SF_CHANNEL_MAP_SIDE_LEFT;
-            chanmap[7] = SF_CHANNEL_MAP_SIDE_RIGHT;
+        else if(match_chanmap(chanmap, x714map))
+            spkrs = X714Map;
+        else if(match_chanmap(chanmap, ambi2dmap) || match_chanmap(chanmap, ambi3dmap))
+        {
+            /* Do nothing. */
         }
         else
         {
-            fprintf(stderr, " ... unmapped %d-channel audio not supported\n", ininfo.channels);
-            continue;
+            std::string mapstr;
+            if(!chanmap.empty())
+            {
+                mapstr = std::to_string(chanmap[0]);
+                for(int idx : al::span<int>{chanmap}.subspan<1>())
+                {
+                    mapstr += ',';
+                    mapstr += std::to_string(idx);
+                }
+            }
+            log.add(stderr, " ... %zu channels not supported (map: %s)\n", chanmap.size(),
+                mapstr.c_str());
+            return false;
         }
+    }
+    else if(ininfo.channels == 2)
+    {
+        log.add(stderr, " ... assuming WFX order stereo\n");
+        spkrs = StereoMap;
+        chanmap[0] = SF_CHANNEL_MAP_FRONT_LEFT;
+        chanmap[1] = SF_CHANNEL_MAP_FRONT_RIGHT;
+    }
+    else if(ininfo.channels == 6)
+    {
+        log.add(stderr, " ... assuming WFX order 5.1\n");
+        spkrs = X51Map;
+        chanmap[0] = SF_CHANNEL_MAP_FRONT_LEFT;
+        chanmap[1] = SF_CHANNEL_MAP_FRONT_RIGHT;
+        chanmap[2] = SF_CHANNEL_MAP_FRONT_CENTER;
+        chanmap[3] = SF_CHANNEL_MAP_LFE;
+        chanmap[4] = SF_CHANNEL_MAP_SIDE_LEFT;
+        chanmap[5] = SF_CHANNEL_MAP_SIDE_RIGHT;
+    }
+    else if(ininfo.channels == 8)
+    {
+        log.add(stderr, " ... assuming WFX order 7.1\n");
+        spkrs = X71Map;
+        chanmap[0] = SF_CHANNEL_MAP_FRONT_LEFT;
+        chanmap[1] = SF_CHANNEL_MAP_FRONT_RIGHT;
+        chanmap[2] = SF_CHANNEL_MAP_FRONT_CENTER;
+        chanmap[3] = SF_CHANNEL_MAP_LFE;
+        chanmap[4] = SF_CHANNEL_MAP_REAR_LEFT;
+        chanmap[5] = SF_CHANNEL_MAP_REAR_RIGHT;
+        chanmap[6] = SF_CHANNEL_MAP_SIDE_LEFT;
+        chanmap[7] = SF_CHANNEL_MAP_SIDE_RIGHT;
+    }
+    else
+    {
+        log.add(stderr, " ... unmapped %d-channel audio not supported\n", ininfo.channels);
+        return false;
+    }
+
+    SF_INFO outinfo{};
+    outinfo.frames = ininfo.frames;
+    outinfo.samplerate = ininfo.samplerate;
+    outinfo.channels = static_cast<int>(uhjchans);
+    outinfo.format = SF_FORMAT_PCM_24 | SF_FORMAT_FLAC;
+    SndFilePtr outfile{sf_open(outname.c_str(), SFM_WRITE, &outinfo)};
+    if(!outfile)
+    {
+        log.add(stderr, " ... failed to create %s\n", outname.c_str());
+        return false;
+    }
+
+    auto encoder = std::make_unique<UhjEncoder>();
+    auto splbuf = al::vector<FloatBufferLine, 16>(static_cast<uint>(9+ininfo.channels)+uhjchans);
+    auto ambmem = al::span<FloatBufferLine,4>{splbuf.data(), 4};
+    auto encmem = al::span<FloatBufferLine,4>{&splbuf[4], 4};
+    auto srcmem = al::span<float,BufferLineSize>{splbuf[8].data(), BufferLineSize};
+    auto outmem = al::span<float>{splbuf[9].data(), BufferLineSize*uhjchans};
+
+    /* A number of initial samples need to be skipped to cut the lead-in
+     * from the all-pass filter delay. The same number of samples need to
+     * be fed through the encoder after reaching the end of the input file
+     * to ensure none of the original input is lost.
+     */
+    size_t total_wrote{0};
+    size_t LeadIn{UhjEncoder::sFilterDelay};
+    sf_count_t LeadOut{UhjEncoder::sFilterDelay};
+    while(LeadIn > 0 || LeadOut > 0)
+    {
+        auto inmem = outmem.data() + outmem.size();
+        auto sgot = sf_readf_float(infile.get(), inmem, BufferLineSize);
 
-        SF_INFO outinfo{};
-        outinfo.frames = ininfo.frames;
-        outinfo.samplerate = ininfo.samplerate;
-        outinfo.channels = static_cast<int>(uhjchans);
-        outinfo.format = SF_FORMAT_PCM_24 | SF_FORMAT_FLAC;
-        SndFilePtr outfile{sf_open(outname.c_str(), SFM_WRITE, &outinfo)};
-        if(!outfile)
+        sgot = std::max<sf_count_t>(sgot, 0);
+        if(sgot < BufferLineSize)
         {
-            fprintf(stderr, " ... failed to create %s\n", outname.c_str());
-            continue;
+            const sf_count_t remaining{std::min(BufferLineSize - sgot, LeadOut)};
+            std::fill_n(inmem + sgot*ininfo.channels, remaining*ininfo.channels, 0.0f);
+            sgot += remaining;
+            LeadOut -= remaining;
         }
 
-        auto encoder = std::make_unique<UhjEncoder>();
-        auto splbuf = al::vector<FloatBufferLine, 16>(static_cast<uint>(9+ininfo.channels)+uhjchans);
-        auto ambmem = al::span<FloatBufferLine,4>{splbuf.data(), 4};
-        auto encmem = al::span<FloatBufferLine,4>{&splbuf[4], 4};
-        auto srcmem = al::span<float,BufferLineSize>{splbuf[8].data(), BufferLineSize};
-        auto outmem = al::span<float>{splbuf[9].data(), BufferLineSize*uhjchans};
-
-        /* A number of initial samples need to be skipped to cut the lead-in
-         * from the all-pass filter delay. The same number of samples need to
-         * be fed through the encoder after reaching the end of the input file
-         * to ensure none of the original input is lost.
-         */
-        size_t total_wrote{0};
-        size_t LeadIn{UhjEncoder::sFilterDelay};
-        sf_count_t LeadOut{UhjEncoder::sFilterDelay};
-        while(LeadIn > 0 || LeadOut > 0)
+        for(auto&& buf : ambmem)
+            buf.fill(0.0f);
+
+        auto got = static_cast<size_t>(sgot);
+        if(spkrs.empty())
+        {
+            /* B-Format is already in the correct order. It just needs a
+             * +3dB boost.
+             */
+            static constexpr float scale{al::numbers::sqrt2_v<float>};
+            const size_t chans{std::min<size_t>(static_cast<uint>(ininfo.channels), 4u)};
+            for(size_t c{0};c < chans;++c)
+            {
+                for(size_t i{0};i < got;++i)
+                    ambmem[c][i] = inmem[i*static_cast<uint>(ininfo.channels)] * scale;
+                ++inmem;
+            }
+        }
+        else for(const int chanid : chanmap)
         {
-            auto inmem = outmem.data() + outmem.size();
-            auto sgot = sf_readf_float(infile.get(), inmem, BufferLineSize);
+            /* Skip LFE. Or mix directly into W? Or W+X? */
+            if(chanid == SF_CHANNEL_MAP_LFE)
+            {
+                ++inmem;
+                continue;
+            }
 
-            sgot = std::max<sf_count_t>(sgot, 0);
-            if(sgot < BufferLineSize)
+            const auto spkr = std::find_if(spkrs.cbegin(), spkrs.cend(),
+                [chanid](const SpeakerPos &pos){return pos.mChannelID == chanid;});
+            if(spkr == spkrs.cend())
             {
-                const sf_count_t remaining{std::min(BufferLineSize - sgot, LeadOut)};
-                std::fill_n(inmem + sgot*ininfo.channels, remaining*ininfo.channels, 0.0f);
-                sgot += remaining;
-                LeadOut -= remaining;
+                log.add(stderr, " ... failed to find channel ID %d\n", chanid);
+                continue;
             }
 
-            for(auto&& buf : ambmem)
-                buf.fill(0.0f);
+            for(size_t i{0};i < got;++i)
+                srcmem[i] = inmem[i * static_cast<uint>(ininfo.channels)];
+            ++inmem;
 
-            auto got = static_cast<size_t>(sgot);
-            if(spkrs.empty())
+            static constexpr auto Deg2Rad = al::numbers::pi / 180.0;
+            const auto coeffs = GenCoeffs(
+                std::cos(spkr->mAzimuth*Deg2Rad) * std::cos(spkr->mElevation*Deg2Rad),
+                std::sin(spkr->mAzimuth*Deg2Rad) * std::cos(spkr->mElevation*Deg2Rad),
+                std::sin(spkr->mElevation*Deg2Rad));
+            for(size_t c{0};c < 4;++c)
             {
-                /* B-Format is already in the correct order. It just needs a
-                 * +3dB boost.
-                 */
-                static constexpr float scale{al::numbers::sqrt2_v<float>};
-                const size_t chans{std::min<size_t>(static_cast<uint>(ininfo.channels), 4u)};
-                for(size_t c{0};c < chans;++c)
-                {
-                    for(size_t i{0};i < got;++i)
-                        ambmem[c][i] = inmem[i*static_cast<uint>(ininfo.channels)] * scale;
-                    ++inmem;
-                }
+                for(size_t i{0};i < got;++i)
+                    ambmem[c][i] += srcmem[i] * coeffs[c];
             }
-            else for(const int chanid : chanmap)
-            {
-                /* Skip LFE. Or mix directly into W? Or W+X? */
-                if(chanid == SF_CHANNEL_MAP_LFE)
-                {
-                    ++inmem;
-                    continue;
-                }
+        }
 
-                const auto spkr = std::find_if(spkrs.cbegin(), spkrs.cend(),
-                    [chanid](const SpeakerPos &pos){return pos.mChannelID == chanid;});
-                if(spkr == spkrs.cend())
-                {
-                    fprintf(stderr, " ... failed to find channel ID %d\n", chanid);
-                    continue;
-                }
+        encoder->encode(encmem.subspan(0, uhjchans), ambmem, got);
+        if(LeadIn >= got)
+        {
+            LeadIn -= got;
+            continue;
+        }
 
-                for(size_t i{0};i < got;++i)
-                    srcmem[i] = inmem[i * static_cast<uint>(ininfo.channels)];
-                ++inmem;
+        got -= LeadIn;
+        for(size_t c{0};c < uhjchans;++c)
+        {
+            static constexpr float max_val{8388607.0f / 8388608.0f};
+            for(size_t i{0};i < got;++i)
+                outmem[i*uhjchans + c] = std::clamp(encmem[c][LeadIn+i], -1.0f, max_val);
+        }
+        LeadIn = 0;
 
-                static constexpr auto Deg2Rad = al::numbers::pi / 180.0;
-                const auto coeffs = GenCoeffs(
-                    std::cos(spkr->mAzimuth*Deg2Rad) * std::cos(spkr->mElevation*Deg2Rad),
-                    std::sin(spkr->mAzimuth*Deg2Rad) * std::cos(spkr->mElevation*Deg2Rad),
-                    std::sin(spkr->mElevation*Deg2Rad));
-                for(size_t c{0};c < 4;++c)
-                {
-                    for(size_t i{0};i < got;++i)
-                        ambmem[c][i] += srcmem[i] * coeffs[c];
-                }
-            }
+        sf_count_t wrote{sf_writef_float(outfile.get(), outmem.data(),
+            static_cast<sf_count_t>(got))};
+        if(wrote < 0)
+            log.add(stderr, " ... failed to write samples: %d\n", sf_error(outfile.get()));
+        else
+            total_wrote += static_cast<size_t>(wrote);
+    }
+    log.add(stdout, " ... wrote %zu samples (%" PRId64 ").\n", total_wrote,
+        int64_t{ininfo.frames});
+    return true;
+}
 
-            encoder->encode(encmem.subspan(0, uhjchans), ambmem, got);
-            if(LeadIn >= got)
-            {
-                LeadIn -= got;
-                continue;
-            }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if(argc < 2 || std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0)
+    {
+        printf("Usage: %s [-j <threads>] <infile...>\n\n", argv[0]);
+        return 1;
+    }
 
-            got -= LeadIn;
-            for(size_t c{0};c < uhjchans;++c)
+    uint uhjchans{2};
+    uint numThreads{std::max(std::thread::hardware_concurrency(), 1u)};
+    std::vector<std::pair<const char*,uint>> files;
+    for(int fidx{1};fidx < argc;++fidx)
+    {
+        if(strcmp(argv[fidx], "-bhj") == 0)
+        {
+            uhjchans = 2;
+            continue;
+        }
+        if(strcmp(argv[fidx], "-thj") == 0)
+        {
+            uhjchans = 3;
+            continue;
+        }
+        if(strcmp(argv[fidx], "-phj") == 0)
+        {
+            uhjchans = 4;
+            continue;
+        }
+        if(strcmp(argv[fidx], "-j") == 0)
+        {
+            char *end{};
+            const unsigned long count{(fidx+1 < argc) ? strtoul(argv[fidx+1], &end, 10) : 0};
+            if(!end || *end != '\0' || count > 64)
             {
-                static constexpr float max_val{8388607.0f / 8388608.0f};
-                for(size_t i{0};i < got;++i)
-                    outmem[i*uhjchans + c] = std::clamp(encmem[c][LeadIn+i], -1.0f, max_val);
+                fprintf(stderr, "Expected a thread count between 0 and 64 for -j\n");
+                return 1;
             }
-            LeadIn = 0;
-
-            sf_count_t wrote{sf_writef_float(outfile.get(), outmem.data(),
-                static_cast<sf_count_t>(got))};
-            if(wrote < 0)
-                fprintf(stderr, " ... failed to write samples: %d\n", sf_error(outfile.get()));
-            else
-                total_wrote += static_cast<size_t>(wrote);
+            numThreads = count ? static_cast<uint>(count)
+                : std::max(std::thread::hardware_concurrency(), 1u);
+            ++fidx;
+            continue;
         }
-        printf(" ... wrote %zu samples (%" PRId64 ").\n", total_wrote, int64_t{ininfo.frames});
-        ++num_encoded;
+        files.emplace_back(argv[fidx], uhjchans);
     }
+
+    /* Each thread takes the next file to encode until they're all done. */
+    std::atomic<size_t> next_file{0}, num_encoded{0};
+    auto encode_files = [&files,&next_file,&num_encoded]()
+    {
+        FileLog log;
+        size_t idx;
+        while((idx=next_file.fetch_add(1, std::memory_order_relaxed)) < files.size())
+        {
+            if(EncodeFile(files[idx].first, files[idx].second, log))
+                num_encoded.fetch_add(1, std::memory_order_relaxed);
+            log.flush();
+        }
+    };
+    std::vector<std::thread> thrds;
+    for(size_t i{1};i < std::min<size_t>(numThreads, files.size());++i)
+        thrds.emplace_back(encode_files);
+    encode_files();
+    for(auto &thrd : thrds)
+        thrd.join();
+
+    const size_t num_files{files.size()};
     if(num_encoded == 0)
         fprintf(stderr, "Failed to encode any input files\n");
     else if(num_encoded < num_files)
-        fprintf(stderr, "Encoded %zu of %zu files\n", num_encoded, num_files);
+        fprintf(stderr, "Encoded %zu of %zu files\n", num_encoded.load(), num_files);
     else
-        printf("Encoded %s%zu file%s\n", (num_encoded > 1) ? "all " : "", num_encoded,
+        printf("Encoded %s%zu file%s\n", (num_encoded > 1) ? "all " : "", num_encoded.load(),
             (num_encoded == 1) ? "" : "s");
     return 0;
 }